@@ -6,6 +6,7 @@ See License.txt for details.
 
 #include "PlusConfigure.h"
 #include "PlusFidPatternRecognition.h"
+#include "PlusWorkerPool.h"
 #include "vtkMath.h"
 #include "vtkPoints.h"
 #include "vtkLine.h"
@@ -19,6 +20,8 @@ static const double DOT_RADIUS = 6.0;
 //-----------------------------------------------------------------------------
 
 PlusFidPatternRecognition::PlusFidPatternRecognition()
+  : m_MaxLineLengthToleranceMm(0)
+  , m_NumberOfThreads(0)
 {
 
 }
@@ -46,6 +49,12 @@ PlusStatus PlusFidPatternRecognition::ReadConfiguration(vtkXMLDataElement* rootC
   m_FidLineFinder.ReadConfiguration(rootConfigElement);
   m_FidLabeling.ReadConfiguration(rootConfigElement, m_FidLineFinder.GetMinThetaRad(), m_FidLineFinder.GetMaxThetaRad());
 
+  XML_FIND_NESTED_ELEMENT_OPTIONAL(segmentationParameters, rootConfigElement, "Segmentation");
+  if (segmentationParameters)
+  {
+    XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, NumberOfThreads, segmentationParameters);
+  }
+
   return PLUS_SUCCESS;
 }
 
@@ -178,17 +187,58 @@ PlusStatus PlusFidPatternRecognition::RecognizePattern(vtkIGSIOTrackedFrameList*
     *numberOfSuccessfullySegmentedImages = 0;
   }
 
+  // segment only non segmented frames
+  std::vector<unsigned int> frameIndicesToSegment;
   for (unsigned int currentFrameIndex = 0; currentFrameIndex < trackedFrameList->GetNumberOfTrackedFrames(); currentFrameIndex++)
   {
-    igsioTrackedFrame* trackedFrame = trackedFrameList->GetTrackedFrame(currentFrameIndex);
+    if (trackedFrameList->GetTrackedFrame(currentFrameIndex)->GetFiducialPointsCoordinatePx() == NULL)
+    {
+      frameIndicesToSegment.push_back(currentFrameIndex);
+    }
+  }
+  if (frameIndicesToSegment.empty())
+  {
+    return status;
+  }
 
-    // segment only non segmented frames
-    if (trackedFrame->GetFiducialPointsCoordinatePx() != NULL)
+  int numberOfTasks = (m_NumberOfThreads > 0 ? m_NumberOfThreads : PlusWorkerPool::GetInstance().GetNumberOfThreads() + 1);
+  numberOfTasks = (std::min)(numberOfTasks, static_cast<int>(frameIndicesToSegment.size()));
+
+  // Each task segments a contiguous range of frames with its own copy of the algorithm. The last range is segmented
+  // by this object, so that it holds the intermediate results of the last frame, as if the frames were segmented one by one.
+  std::vector<PlusFidPatternRecognition> patternRecognitions(numberOfTasks - 1, *this);
+  std::vector<PatternRecognitionError> frameErrors(frameIndicesToSegment.size(), PATTERN_RECOGNITION_ERROR_NO_ERROR);
+  std::vector<char> frameRecognized(frameIndicesToSegment.size(), 0);
+  auto recognizeFrames = [&](int firstTask, int lastTask)
+  {
+    for (int task = firstTask; task < lastTask; task++)
     {
-      continue;
+      PlusFidPatternRecognition* patternRecognition = (task == numberOfTasks - 1 ? this : &patternRecognitions[task]);
+      const int firstFrame = static_cast<int>(static_cast<long long>(frameIndicesToSegment.size()) * task / numberOfTasks);
+      const int lastFrame = static_cast<int>(static_cast<long long>(frameIndicesToSegment.size()) * (task + 1) / numberOfTasks);
+      for (int i = firstFrame; i < lastFrame; i++)
+      {
+        frameRecognized[i] = (patternRecognition->RecognizePattern(trackedFrameList->GetTrackedFrame(frameIndicesToSegment[i]), frameErrors[i], frameIndicesToSegment[i]) == PLUS_SUCCESS);
+      }
     }
+  };
+  if (numberOfTasks == 1)
+  {
+    recognizeFrames(0, 1);
+  }
+  else
+  {
+    PlusWorkerPool::GetInstance().ParallelFor(0, numberOfTasks, numberOfTasks, recognizeFrames);
+  }
+
+  // Collect the results in the order of the frames
+  for (unsigned int i = 0; i < frameIndicesToSegment.size(); i++)
+  {
+    unsigned int currentFrameIndex = frameIndicesToSegment[i];
+    igsioTrackedFrame* trackedFrame = trackedFrameList->GetTrackedFrame(currentFrameIndex);
+    patternRecognitionError = frameErrors[i];
 
-    if (RecognizePattern(trackedFrame, patternRecognitionError, currentFrameIndex) != PLUS_SUCCESS)
+    if (!frameRecognized[i])
     {
       if (patternRecognitionError != PATTERN_RECOGNITION_ERROR_TOO_MANY_CANDIDATES)
       {
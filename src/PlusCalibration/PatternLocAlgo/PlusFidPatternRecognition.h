@@ -22,6 +22,9 @@ See License.txt for details.
 \brief This class manages the whole pattern recognition algorithm. From a vtk XML data element it handles
 the initialization of the patterns from the phantom definition file, segments the image, find the n-points
 lines and then find the pattern and label the dots.
+
+The intermediate results of the last processed frame are stored in the object, so an object must not be used by multiple
+threads at the same time. A tracked frame list is segmented in parallel by copies of the object (see SetNumberOfThreads).
 \ingroup PlusLibPatternRecognition
 */
 
@@ -44,7 +47,8 @@ public:
 
   /*!
   Run pattern recognition on a tracked frame list.
-  It only segments the tracked frames which were not already segmented
+  It only segments the tracked frames which were not already segmented.
+  The frames are segmented in parallel, by NumberOfThreads copies of this object.
   \param trackedFrameList Tracked frame list to segment
   \param numberOfSuccessfullySegmentedImages Out parameter holding the number of segmented images in this call (it is only equals the number of all segmented images in the tracked frame if it was not segmented at all)
   \param segmentedFramesIndices Indices of the frames that were properly segmented
@@ -95,6 +99,12 @@ public:
   /*! Reads the phantom definition and computes the NWires intersection if needed */
   PlusStatus ReadPhantomDefinition(vtkXMLDataElement* rootConfigElement);
 
+  /*! Set the number of threads that segment a tracked frame list. 1 means that the frames are segmented on the calling thread, 0 means all threads of the shared worker pool. */
+  void SetNumberOfThreads(int value) { m_NumberOfThreads = value; };
+
+  /*! Get the number of threads that segment a tracked frame list */
+  int GetNumberOfThreads() { return m_NumberOfThreads; };
+
 protected:
 
   PlusFidSegmentation           m_FidSegmentation;
@@ -103,6 +113,8 @@ protected:
   std::vector<PlusFidPattern*>  m_Patterns;
 
   double                        m_MaxLineLengthToleranceMm;
+
+  int                           m_NumberOfThreads;
 };
 
 //-----------------------------------------------------------------------------
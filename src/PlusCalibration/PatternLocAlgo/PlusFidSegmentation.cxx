@@ -19,10 +19,146 @@
 #include "itkImageFileWriter.h"
 #include "itkPNGImageIO.h"
 
+// SSE2 is available on all x86-64 processors, so the vectorized morphological operations are selected at compile time
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define PLUS_FIDSEGMENTATION_SSE2
+  #include <emmintrin.h>
+#endif
+
 static const short BLACK            = 0;
 static const short MIN_WINDOW_DIST  = 8;
 static const short MAX_CLUSTER_VALS = 16384;
 
+namespace
+{
+  typedef PlusFidSegmentation::PixelType PixelType;
+
+  struct MinimumOperation
+  {
+    static PixelType Apply(PixelType a, PixelType b) { return (std::min)(a, b); }
+#ifdef PLUS_FIDSEGMENTATION_SSE2
+    static __m128i Apply(__m128i a, __m128i b) { return _mm_min_epu8(a, b); }
+#endif
+  };
+
+  struct MaximumOperation
+  {
+    static PixelType Apply(PixelType a, PixelType b) { return (std::max)(a, b); }
+#ifdef PLUS_FIDSEGMENTATION_SSE2
+    static __m128i Apply(__m128i a, __m128i b) { return _mm_max_epu8(a, b); }
+#endif
+  };
+
+  //-----------------------------------------------------------------------------
+  /*! dest[i] = Operation(a[i], b[i]). dest may be the same as a, and b may point after a in the same buffer. */
+  template<class Operation>
+  void CombinePixels(PixelType* dest, const PixelType* a, const PixelType* b, long count)
+  {
+    long i = 0;
+#ifdef PLUS_FIDSEGMENTATION_SSE2
+    for (; i + 16 <= count; i += 16)
+    {
+      const __m128i result = Operation::Apply(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)), _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), result);
+    }
+#endif
+    for (; i < count; i++)
+    {
+      dest[i] = Operation::Apply(a[i], b[i]);
+    }
+  }
+
+  //-----------------------------------------------------------------------------
+  /*!
+    Minimum or maximum of the bar shaped structuring element (pixels p + k * step, k = -barSize..barSize) for each pixel p
+    of the region of interest, the other pixels of dest are set to 0.
+    Pass n of the buffer holds the result for the 2^n pixels p + k * step, k = 0..2^n-1. The bar is covered by two
+    overlapping runs of the longest such length. Returns false if the bar would reach out of the image.
+  */
+  template<class Operation>
+  bool BarOperation(PixelType* dest, const PixelType* image, const FrameSizeType& frameSize, const std::array<unsigned int, 4>& roi, long barSize, long step, std::vector<PixelType>& buffer)
+  {
+    const long width = frameSize[0];
+    const long height = frameSize[1];
+    const long numberOfPixels = width * height;
+    const long xMin = roi[0];
+    const long yMin = roi[1];
+    const long xMax = roi[2];
+    const long yMax = roi[3];
+    if (xMin >= xMax || yMin >= yMax || xMax > width || yMax > height)
+    {
+      return false;
+    }
+    const long firstPixel = yMin * width + xMin;
+    const long lastPixel = (yMax - 1) * width + xMax - 1;
+    const long bufferStart = firstPixel - barSize * step;
+    const long bufferEnd = lastPixel + barSize * step + 1;
+    if (bufferStart < 0 || bufferEnd > numberOfPixels)
+    {
+      return false;
+    }
+
+    const long count = bufferEnd - bufferStart;
+    buffer.resize(count);
+    memcpy(&buffer[0], image + bufferStart, count * sizeof(PixelType));
+    long runLength = 1;
+    for (; 2 * runLength <= 2 * barSize + 1; runLength *= 2)
+    {
+      CombinePixels<Operation>(&buffer[0], &buffer[0], &buffer[0] + runLength * step, count - (2 * runLength - 1) * step);
+    }
+
+    memset(dest, 0, numberOfPixels * sizeof(PixelType));
+    const long rowLength = xMax - xMin;
+    for (long ir = yMin; ir < yMax; ir++)
+    {
+      const long p = ir * width + xMin;
+      CombinePixels<Operation>(dest + p, &buffer[0] + (p - barSize * step - bufferStart), &buffer[0] + (p + (barSize + 1 - runLength) * step - bufferStart), rowLength);
+    }
+    return true;
+  }
+
+  //-----------------------------------------------------------------------------
+  /*!
+    Minimum or maximum of the structuring element (pixels p + offsets[i]) for each pixel p of the region of interest,
+    the other pixels of dest are set to 0. Returns false if the structuring element would reach out of the image.
+  */
+  template<class Operation>
+  bool ShapeOperation(PixelType* dest, const PixelType* image, const FrameSizeType& frameSize, const std::array<unsigned int, 4>& roi, const std::vector<long>& offsets)
+  {
+    const long width = frameSize[0];
+    const long height = frameSize[1];
+    const long numberOfPixels = width * height;
+    const long xMin = roi[0];
+    const long yMin = roi[1];
+    const long xMax = roi[2];
+    const long yMax = roi[3];
+    if (offsets.empty() || xMin >= xMax || yMin >= yMax || xMax > width || yMax > height)
+    {
+      return false;
+    }
+    const long firstPixel = yMin * width + xMin;
+    const long lastPixel = (yMax - 1) * width + xMax - 1;
+    if (firstPixel + *std::min_element(offsets.begin(), offsets.end()) < 0 || lastPixel + *std::max_element(offsets.begin(), offsets.end()) >= numberOfPixels)
+    {
+      return false;
+    }
+
+    memset(dest, 0, numberOfPixels * sizeof(PixelType));
+    const long rowLength = xMax - xMin;
+    for (long ir = yMin; ir < yMax; ir++)
+    {
+      PixelType* destRow = dest + ir * width + xMin;
+      const PixelType* imageRow = image + ir * width + xMin;
+      memcpy(destRow, imageRow + offsets[0], rowLength * sizeof(PixelType));
+      for (size_t i = 1; i < offsets.size(); i++)
+      {
+        CombinePixels<Operation>(destRow, destRow, imageRow + offsets[i], rowLength);
+      }
+    }
+    return true;
+  }
+}
+
 const double PlusFidSegmentation::DEFAULT_APPROXIMATE_SPACING_MM_PER_PIXEL = 0.078;
 const double PlusFidSegmentation::DEFAULT_MORPHOLOGICAL_OPENING_CIRCLE_RADIUS_MM = 0.27;
 const double PlusFidSegmentation::DEFAULT_MORPHOLOGICAL_OPENING_BAR_SIZE_MM = 2.0;
@@ -91,6 +227,66 @@ PlusFidSegmentation::PlusFidSegmentation()
 
 //-----------------------------------------------------------------------------
 
+PlusFidSegmentation::PlusFidSegmentation(const PlusFidSegmentation& other)
+  : m_Working(new PlusFidSegmentation::PixelType[1])
+  , m_Dilated(new PlusFidSegmentation::PixelType[1])
+  , m_Eroded(new PlusFidSegmentation::PixelType[1])
+  , m_UnalteredImage(new PlusFidSegmentation::PixelType[1])
+{
+  *this = other;
+}
+
+//-----------------------------------------------------------------------------
+
+PlusFidSegmentation& PlusFidSegmentation::operator=(const PlusFidSegmentation& other)
+{
+  if (this == &other)
+  {
+    return *this;
+  }
+
+  m_FrameSize = other.m_FrameSize;
+  m_RegionOfInterest = other.m_RegionOfInterest;
+  m_UseOriginalImageIntensityForDotIntensityScore = other.m_UseOriginalImageIntensityForDotIntensityScore;
+  m_NumberOfMaximumFiducialPointCandidates = other.m_NumberOfMaximumFiducialPointCandidates;
+  m_ThresholdImagePercent = other.m_ThresholdImagePercent;
+  m_MorphologicalOpeningBarSizeMm = other.m_MorphologicalOpeningBarSizeMm;
+  m_MorphologicalOpeningCircleRadiusMm = other.m_MorphologicalOpeningCircleRadiusMm;
+  m_PossibleFiducialsImageFilename = other.m_PossibleFiducialsImageFilename;
+  m_FiducialGeometry = other.m_FiducialGeometry;
+  m_MorphologicalCircle = other.m_MorphologicalCircle;
+  m_ApproximateSpacingMmPerPixel = other.m_ApproximateSpacingMmPerPixel;
+  std::copy(other.m_ImageScalingTolerancePercent, other.m_ImageScalingTolerancePercent + 4, m_ImageScalingTolerancePercent);
+  std::copy(other.m_ImageNormalVectorInPhantomFrameEstimation, other.m_ImageNormalVectorInPhantomFrameEstimation + 3, m_ImageNormalVectorInPhantomFrameEstimation);
+  std::copy(other.m_ImageNormalVectorInPhantomFrameMaximumRotationAngleDeg, other.m_ImageNormalVectorInPhantomFrameMaximumRotationAngleDeg + 6, m_ImageNormalVectorInPhantomFrameMaximumRotationAngleDeg);
+  std::copy(other.m_ImageToPhantomTransform, other.m_ImageToPhantomTransform + 16, m_ImageToPhantomTransform);
+  m_DotsFound = other.m_DotsFound;
+  m_FoundDotsCoordinateValue = other.m_FoundDotsCoordinateValue;
+  m_NumDots = other.m_NumDots;
+  m_CandidateFidValues = other.m_CandidateFidValues;
+  m_DotsVector = other.m_DotsVector;
+  m_DebugOutput = other.m_DebugOutput;
+
+  // The working images are not shared, each object has its own
+  long size = (std::max)(static_cast<long>(m_FrameSize[0] * m_FrameSize[1]), 1L);
+  delete[] m_Dilated;
+  delete[] m_Eroded;
+  delete[] m_Working;
+  delete[] m_UnalteredImage;
+  m_Dilated = new PlusFidSegmentation::PixelType[size];
+  m_Eroded = new PlusFidSegmentation::PixelType[size];
+  m_Working = new PlusFidSegmentation::PixelType[size];
+  m_UnalteredImage = new PlusFidSegmentation::PixelType[size];
+  memcpy(m_Dilated, other.m_Dilated, size * sizeof(PlusFidSegmentation::PixelType));
+  memcpy(m_Eroded, other.m_Eroded, size * sizeof(PlusFidSegmentation::PixelType));
+  memcpy(m_Working, other.m_Working, size * sizeof(PlusFidSegmentation::PixelType));
+  memcpy(m_UnalteredImage, other.m_UnalteredImage, size * sizeof(PlusFidSegmentation::PixelType));
+
+  return *this;
+}
+
+//-----------------------------------------------------------------------------
+
 PlusFidSegmentation::~PlusFidSegmentation()
 {
   delete[] m_Dilated;
@@ -299,6 +495,138 @@ unsigned int PlusFidSegmentation::GetMorphologicalOpeningBarSizePx()
 
 //-----------------------------------------------------------------------------
 
+void PlusFidSegmentation::Erode0(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image)
+{
+  if (!BarOperation<MinimumOperation>(dest, image, m_FrameSize, m_RegionOfInterest, GetMorphologicalOpeningBarSizePx(), 1, m_MorphologyBuffer))
+  {
+    Erode0Scalar(dest, image);
+  }
+}
+
+//-----------------------------------------------------------------------------
+
+void PlusFidSegmentation::Erode45(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image)
+{
+  if (!BarOperation<MinimumOperation>(dest, image, m_FrameSize, m_RegionOfInterest, GetMorphologicalOpeningBarSizePx(), static_cast<long>(m_FrameSize[0]) - 1, m_MorphologyBuffer))
+  {
+    Erode45Scalar(dest, image);
+  }
+}
+
+//-----------------------------------------------------------------------------
+
+void PlusFidSegmentation::Erode90(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image)
+{
+  if (!BarOperation<MinimumOperation>(dest, image, m_FrameSize, m_RegionOfInterest, GetMorphologicalOpeningBarSizePx(), static_cast<long>(m_FrameSize[0]), m_MorphologyBuffer))
+  {
+    Erode90Scalar(dest, image);
+  }
+}
+
+//-----------------------------------------------------------------------------
+
+void PlusFidSegmentation::Erode135(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image)
+{
+  if (!BarOperation<MinimumOperation>(dest, image, m_FrameSize, m_RegionOfInterest, GetMorphologicalOpeningBarSizePx(), static_cast<long>(m_FrameSize[0]) + 1, m_MorphologyBuffer))
+  {
+    Erode135Scalar(dest, image);
+  }
+}
+
+//-----------------------------------------------------------------------------
+
+void PlusFidSegmentation::ErodeCircle(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image)
+{
+  // Same orientation of the circle as in ErodeCircleScalar
+  std::vector<long> offsets;
+  for (std::vector<PlusCoordinate2D>::iterator it = m_MorphologicalCircle.begin(); it != m_MorphologicalCircle.end(); ++it)
+  {
+    offsets.push_back(static_cast<long>(it->X) * static_cast<long>(m_FrameSize[0]) + it->Y);
+  }
+  if (!ShapeOperation<MinimumOperation>(dest, image, m_FrameSize, m_RegionOfInterest, offsets))
+  {
+    ErodeCircleScalar(dest, image);
+  }
+}
+
+//-----------------------------------------------------------------------------
+
+void PlusFidSegmentation::Dilate0(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image)
+{
+  if (!BarOperation<MaximumOperation>(dest, image, m_FrameSize, m_RegionOfInterest, GetMorphologicalOpeningBarSizePx(), 1, m_MorphologyBuffer))
+  {
+    Dilate0Scalar(dest, image);
+  }
+}
+
+//-----------------------------------------------------------------------------
+
+void PlusFidSegmentation::Dilate45(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image)
+{
+  if (!BarOperation<MaximumOperation>(dest, image, m_FrameSize, m_RegionOfInterest, GetMorphologicalOpeningBarSizePx(), static_cast<long>(m_FrameSize[0]) - 1, m_MorphologyBuffer))
+  {
+    Dilate45Scalar(dest, image);
+  }
+}
+
+//-----------------------------------------------------------------------------
+
+void PlusFidSegmentation::Dilate90(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image)
+{
+  if (!BarOperation<MaximumOperation>(dest, image, m_FrameSize, m_RegionOfInterest, GetMorphologicalOpeningBarSizePx(), static_cast<long>(m_FrameSize[0]), m_MorphologyBuffer))
+  {
+    Dilate90Scalar(dest, image);
+  }
+}
+
+//-----------------------------------------------------------------------------
+
+void PlusFidSegmentation::Dilate135(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image)
+{
+  if (!BarOperation<MaximumOperation>(dest, image, m_FrameSize, m_RegionOfInterest, GetMorphologicalOpeningBarSizePx(), static_cast<long>(m_FrameSize[0]) + 1, m_MorphologyBuffer))
+  {
+    Dilate135Scalar(dest, image);
+  }
+}
+
+//-----------------------------------------------------------------------------
+
+void PlusFidSegmentation::DilateCircle(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image)
+{
+  // Same orientation of the circle as in DilateCircleScalar
+  std::vector<long> offsets;
+  for (std::vector<PlusCoordinate2D>::iterator it = m_MorphologicalCircle.begin(); it != m_MorphologicalCircle.end(); ++it)
+  {
+    offsets.push_back(static_cast<long>(it->Y) * static_cast<long>(m_FrameSize[0]) + it->X);
+  }
+  if (!ShapeOperation<MaximumOperation>(dest, image, m_FrameSize, m_RegionOfInterest, offsets))
+  {
+    DilateCircleScalar(dest, image);
+  }
+}
+
+//-----------------------------------------------------------------------------
+
+void PlusFidSegmentation::Subtract(PlusFidSegmentation::PixelType* image, PlusFidSegmentation::PixelType* vals)
+{
+  const long numberOfPixels = static_cast<long>(m_FrameSize[1]) * m_FrameSize[0];
+  long i = 0;
+#ifdef PLUS_FIDSEGMENTATION_SSE2
+  for (; i + 16 <= numberOfPixels; i += 16)
+  {
+    // Saturated subtraction: 0 if vals > image
+    const __m128i result = _mm_subs_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(image + i)), _mm_loadu_si128(reinterpret_cast<const __m128i*>(vals + i)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(image + i), result);
+  }
+#endif
+  for (; i < numberOfPixels; i++)
+  {
+    image[i] = vals[i] > image[i] ? 0 : image[i] - vals[i];
+  }
+}
+
+//-----------------------------------------------------------------------------
+
 inline PlusFidSegmentation::PixelType PlusFidSegmentation::ErodePoint0(PlusFidSegmentation::PixelType* image, unsigned int ir, unsigned int ic)
 {
   //LOG_TRACE("FidSegmentation::ErodePoint0");
@@ -326,7 +654,7 @@ inline PlusFidSegmentation::PixelType PlusFidSegmentation::ErodePoint0(PlusFidSe
 
 //-----------------------------------------------------------------------------
 
-void PlusFidSegmentation::Erode0(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image)
+void PlusFidSegmentation::Erode0Scalar(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image)
 {
   //LOG_TRACE("FidSegmentation::Erode0");
 
@@ -384,7 +712,7 @@ inline PlusFidSegmentation::PixelType PlusFidSegmentation::ErodePoint45(PlusFidS
 
 //-----------------------------------------------------------------------------
 
-void PlusFidSegmentation::Erode45(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image)
+void PlusFidSegmentation::Erode45Scalar(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image)
 {
   //LOG_TRACE("FidSegmentation::Erode45");
 
@@ -463,7 +791,7 @@ inline PlusFidSegmentation::PixelType PlusFidSegmentation::ErodePoint90(PlusFidS
 
 //-----------------------------------------------------------------------------
 
-void PlusFidSegmentation::Erode90(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image)
+void PlusFidSegmentation::Erode90Scalar(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image)
 {
   //LOG_TRACE("FidSegmentation::Erode90");
 
@@ -519,7 +847,7 @@ inline PlusFidSegmentation::PixelType PlusFidSegmentation::ErodePoint135(PlusFid
 
 //-----------------------------------------------------------------------------
 
-void PlusFidSegmentation::Erode135(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image)
+void PlusFidSegmentation::Erode135Scalar(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image)
 {
   //LOG_TRACE("FidSegmentation::Erode135");
 
@@ -574,7 +902,7 @@ void PlusFidSegmentation::Erode135(PlusFidSegmentation::PixelType* dest, PlusFid
 
 //-----------------------------------------------------------------------------
 
-void PlusFidSegmentation::ErodeCircle(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image)
+void PlusFidSegmentation::ErodeCircleScalar(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image)
 {
   //LOG_TRACE("FidSegmentation::ErodeCircle");
 
@@ -633,7 +961,7 @@ inline PlusFidSegmentation::PixelType PlusFidSegmentation::DilatePoint0(PlusFidS
 
 //-----------------------------------------------------------------------------
 
-void PlusFidSegmentation::Dilate0(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image)
+void PlusFidSegmentation::Dilate0Scalar(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image)
 {
   //LOG_TRACE("FidSegmentation::Dilate0");
 
@@ -695,7 +1023,7 @@ inline PlusFidSegmentation::PixelType PlusFidSegmentation::DilatePoint45(PlusFid
 
 //-----------------------------------------------------------------------------
 
-void PlusFidSegmentation::Dilate45(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image)
+void PlusFidSegmentation::Dilate45Scalar(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image)
 {
   //LOG_TRACE("FidSegmentation::Dilate45");
 
@@ -766,7 +1094,7 @@ inline PlusFidSegmentation::PixelType PlusFidSegmentation::DilatePoint90(PlusFid
 
 //-----------------------------------------------------------------------------
 
-void PlusFidSegmentation::Dilate90(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image)
+void PlusFidSegmentation::Dilate90Scalar(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image)
 {
   //LOG_TRACE("FidSegmentation::Dilate90");
 
@@ -816,7 +1144,7 @@ inline PlusFidSegmentation::PixelType PlusFidSegmentation::DilatePoint135(PlusFi
 
 //-----------------------------------------------------------------------------
 
-void PlusFidSegmentation::Dilate135(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image)
+void PlusFidSegmentation::Dilate135Scalar(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image)
 {
   //LOG_TRACE("FidSegmentation::Dilate135");
 
@@ -886,7 +1214,7 @@ inline PlusFidSegmentation::PixelType PlusFidSegmentation::DilatePoint(PlusFidSe
 
 //-----------------------------------------------------------------------------
 
-void PlusFidSegmentation::DilateCircle(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image)
+void PlusFidSegmentation::DilateCircleScalar(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image)
 {
   //LOG_TRACE("FidSegmentation::DilateCircle");
 
@@ -1189,7 +1517,7 @@ void PlusFidSegmentation::WritePossibleFiducialOverlayImage(const std::vector< s
 
 //-----------------------------------------------------------------------------
 
-void PlusFidSegmentation::Subtract(PlusFidSegmentation::PixelType* image, PlusFidSegmentation::PixelType* vals)
+void PlusFidSegmentation::SubtractScalar(PlusFidSegmentation::PixelType* image, PlusFidSegmentation::PixelType* vals)
 {
   //LOG_TRACE("FidSegmentation::Subtract");
 
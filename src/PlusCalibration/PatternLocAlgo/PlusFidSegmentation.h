@@ -36,6 +36,9 @@ public:
 /*!
   \class FidSegmentation
   \brief Algorithm for segmenting dots in an image. The dots correspond to the fiducial lines that are orthogonal to the image plane
+
+  The working images and the results of the last segmented image are stored in the object, therefore an object
+  must not be used by multiple threads at the same time. Copies of the object can be used in parallel.
   \ingroup PlusLibPatternRecognition
 */
 class vtkPlusCalibrationExport PlusFidSegmentation
@@ -68,7 +71,10 @@ public:
   };
 
   PlusFidSegmentation();
+  /*! Copy the parameters and the state. The copy has its own working images, so the copies can segment images in parallel. */
+  PlusFidSegmentation(const PlusFidSegmentation& other);
   virtual ~PlusFidSegmentation();
+  PlusFidSegmentation& operator=(const PlusFidSegmentation& other);
 
   /* Read the configuration file */
   PlusStatus ReadConfiguration(vtkXMLDataElement* rootConfigElement);
@@ -86,28 +92,46 @@ public:
   /*! Check and modify if necessary the region of interest */
   void ValidateRegionOfInterest();
 
-  /*! Morphological operations performed by the algorithm */
-  inline PlusFidSegmentation::PixelType ErodePoint0(PlusFidSegmentation::PixelType* image, unsigned int ir, unsigned int ic);
+  /*!
+    Morphological operations performed by the algorithm.
+    The bar operations compute the minimum or maximum of 2^n pixels with n vectorized passes over the image
+    (the number of operations per pixel only grows with the logarithm of the bar size), the circle operations
+    and Subtract combine whole rows with vector instructions. The results are identical to the scalar implementations.
+  */
   void Erode0(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image);
-  inline PlusFidSegmentation::PixelType ErodePoint45(PlusFidSegmentation::PixelType* image, unsigned int ir, unsigned int ic);
   void Erode45(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image);
-  inline PlusFidSegmentation::PixelType ErodePoint90(PlusFidSegmentation::PixelType* image, unsigned int ir, unsigned int ic);
   void Erode90(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image);
-  inline PlusFidSegmentation::PixelType ErodePoint135(PlusFidSegmentation::PixelType* image, unsigned int ir, unsigned int ic);
   void Erode135(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image);
   void ErodeCircle(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image);
-  inline PlusFidSegmentation::PixelType DilatePoint0(PlusFidSegmentation::PixelType* image, unsigned int ir, unsigned int ic);
   void Dilate0(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image);
-  inline PlusFidSegmentation::PixelType DilatePoint45(PlusFidSegmentation::PixelType* image, unsigned int ir, unsigned int ic);
   void Dilate45(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image);
-  inline PlusFidSegmentation::PixelType DilatePoint90(PlusFidSegmentation::PixelType* image, unsigned int ir, unsigned int ic);
   void Dilate90(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image);
-  inline PlusFidSegmentation::PixelType DilatePoint135(PlusFidSegmentation::PixelType* image, unsigned int ir, unsigned int ic);
   void Dilate135(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image);
-  inline PlusFidSegmentation::PixelType DilatePoint(PlusFidSegmentation::PixelType* image, unsigned int ir, unsigned int ic, PlusCoordinate2D* shape, int slen);
   void DilateCircle(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image);
   void Subtract(PlusFidSegmentation::PixelType* image, PlusFidSegmentation::PixelType* vals);
 
+  /*! Scalar implementations of the morphological operations. They are used when the region of interest is too close to the image border for the vectorized implementations, and as reference in tests. */
+  inline PlusFidSegmentation::PixelType ErodePoint0(PlusFidSegmentation::PixelType* image, unsigned int ir, unsigned int ic);
+  void Erode0Scalar(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image);
+  inline PlusFidSegmentation::PixelType ErodePoint45(PlusFidSegmentation::PixelType* image, unsigned int ir, unsigned int ic);
+  void Erode45Scalar(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image);
+  inline PlusFidSegmentation::PixelType ErodePoint90(PlusFidSegmentation::PixelType* image, unsigned int ir, unsigned int ic);
+  void Erode90Scalar(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image);
+  inline PlusFidSegmentation::PixelType ErodePoint135(PlusFidSegmentation::PixelType* image, unsigned int ir, unsigned int ic);
+  void Erode135Scalar(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image);
+  void ErodeCircleScalar(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image);
+  inline PlusFidSegmentation::PixelType DilatePoint0(PlusFidSegmentation::PixelType* image, unsigned int ir, unsigned int ic);
+  void Dilate0Scalar(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image);
+  inline PlusFidSegmentation::PixelType DilatePoint45(PlusFidSegmentation::PixelType* image, unsigned int ir, unsigned int ic);
+  void Dilate45Scalar(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image);
+  inline PlusFidSegmentation::PixelType DilatePoint90(PlusFidSegmentation::PixelType* image, unsigned int ir, unsigned int ic);
+  void Dilate90Scalar(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image);
+  inline PlusFidSegmentation::PixelType DilatePoint135(PlusFidSegmentation::PixelType* image, unsigned int ir, unsigned int ic);
+  void Dilate135Scalar(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image);
+  inline PlusFidSegmentation::PixelType DilatePoint(PlusFidSegmentation::PixelType* image, unsigned int ir, unsigned int ic, PlusCoordinate2D* shape, int slen);
+  void DilateCircleScalar(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image);
+  void SubtractScalar(PlusFidSegmentation::PixelType* image, PlusFidSegmentation::PixelType* vals);
+
   /*!
     Write image with the selected points on it to an image file (possibleFiducialsNNN.bmp)
     \param fiducials position of fiducial points
@@ -260,6 +284,9 @@ protected:
 
   std::vector<PlusFidDot> m_DotsVector;
 
+  /*! Intermediate results of the vectorized bar operations, not copied between objects */
+  std::vector<PlusFidSegmentation::PixelType> m_MorphologyBuffer;
+
   bool m_DebugOutput;
 };
 
@@ -0,0 +1,193 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file FidSegmentationMorphologyTest.cxx
+  \brief Checks that the vectorized morphological operations of PlusFidSegmentation give the same result as the scalar
+  implementations and measures the time of the operations
+*/
+
+#include "PlusConfigure.h"
+#include "PlusFidSegmentation.h"
+
+// IGSIO includes
+#include <vtkIGSIOAccurateTimer.h>
+
+// VTK includes
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+  typedef void (PlusFidSegmentation::*MorphologicalOperation)(PlusFidSegmentation::PixelType* dest, PlusFidSegmentation::PixelType* image);
+
+  struct OperationPair
+  {
+    const char* Name;
+    MorphologicalOperation Vectorized;
+    MorphologicalOperation Scalar;
+  };
+
+  const OperationPair OPERATIONS[] =
+  {
+    { "Erode0", &PlusFidSegmentation::Erode0, &PlusFidSegmentation::Erode0Scalar },
+    { "Erode45", &PlusFidSegmentation::Erode45, &PlusFidSegmentation::Erode45Scalar },
+    { "Erode90", &PlusFidSegmentation::Erode90, &PlusFidSegmentation::Erode90Scalar },
+    { "Erode135", &PlusFidSegmentation::Erode135, &PlusFidSegmentation::Erode135Scalar },
+    { "ErodeCircle", &PlusFidSegmentation::ErodeCircle, &PlusFidSegmentation::ErodeCircleScalar },
+    { "Dilate0", &PlusFidSegmentation::Dilate0, &PlusFidSegmentation::Dilate0Scalar },
+    { "Dilate45", &PlusFidSegmentation::Dilate45, &PlusFidSegmentation::Dilate45Scalar },
+    { "Dilate90", &PlusFidSegmentation::Dilate90, &PlusFidSegmentation::Dilate90Scalar },
+    { "Dilate135", &PlusFidSegmentation::Dilate135, &PlusFidSegmentation::Dilate135Scalar },
+    { "DilateCircle", &PlusFidSegmentation::DilateCircle, &PlusFidSegmentation::DilateCircleScalar },
+    { "Subtract", &PlusFidSegmentation::Subtract, &PlusFidSegmentation::SubtractScalar }
+  };
+  const int NUMBER_OF_OPERATIONS = sizeof(OPERATIONS) / sizeof(OPERATIONS[0]);
+
+  // Radius of the circle structuring element with the default spacing and circle radius
+  const unsigned int CIRCLE_RADIUS_PX = 3;
+
+  //----------------------------------------------------------------------------
+  /*! Random image with some black pixels, as the scalar erosions handle black pixels separately */
+  void FillRandom(std::vector<PlusFidSegmentation::PixelType>& image)
+  {
+    for (size_t i = 0; i < image.size(); i++)
+    {
+      image[i] = (rand() % 5 == 0 ? 0 : static_cast<PlusFidSegmentation::PixelType>(rand() % 256));
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  void SetupSegmentation(PlusFidSegmentation& segmentation, unsigned int width, unsigned int height, double barSizeMm, unsigned int roiMargin)
+  {
+    segmentation.SetApproximateSpacingMmPerPixel(PlusFidSegmentation::DEFAULT_APPROXIMATE_SPACING_MM_PER_PIXEL);
+    segmentation.SetMorphologicalOpeningBarSizeMm(barSizeMm);
+    segmentation.SetMorphologicalOpeningCircleRadiusMm(PlusFidSegmentation::DEFAULT_MORPHOLOGICAL_OPENING_CIRCLE_RADIUS_MM);
+    segmentation.UpdateParameters();
+    FrameSizeType frameSize = { width, height, 1 };
+    segmentation.SetFrameSize(frameSize);
+    // The structuring elements must not reach out of the image in the region of interest
+    const unsigned int margin = (std::max)(segmentation.GetMorphologicalOpeningBarSizePx(), CIRCLE_RADIUS_PX) + 1 + roiMargin;
+    segmentation.SetRegionOfInterest(margin, margin, width - margin, height - margin);
+    segmentation.ValidateRegionOfInterest();
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Compare the vectorized operations to the scalar operations */
+  bool CheckOperations(unsigned int width, unsigned int height, double barSizeMm, unsigned int roiMargin)
+  {
+    PlusFidSegmentation segmentation;
+    SetupSegmentation(segmentation, width, height, barSizeMm, roiMargin);
+
+    const size_t numberOfPixels = width * height;
+    std::vector<PlusFidSegmentation::PixelType> image(numberOfPixels);
+    std::vector<PlusFidSegmentation::PixelType> values(numberOfPixels);
+    FillRandom(image);
+    FillRandom(values);
+
+    bool equal = true;
+    for (int i = 0; i < NUMBER_OF_OPERATIONS; i++)
+    {
+      // Subtract modifies its first argument in place, the other operations write the first argument
+      std::vector<PlusFidSegmentation::PixelType> result(image);
+      std::vector<PlusFidSegmentation::PixelType> reference(image);
+      (segmentation.*OPERATIONS[i].Vectorized)(&result[0], &values[0]);
+      (segmentation.*OPERATIONS[i].Scalar)(&reference[0], &values[0]);
+      if (result != reference)
+      {
+        LOG_ERROR(OPERATIONS[i].Name << " result differs from the scalar implementation on a " << width << "x" << height
+                  << " image with " << segmentation.GetMorphologicalOpeningBarSizePx() << " pixel bar size");
+        equal = false;
+      }
+    }
+    return equal;
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Time of one operation in milliseconds, averaged over the repetitions */
+  double MeasureOperationTimeMs(PlusFidSegmentation& segmentation, MorphologicalOperation operation, int numberOfRepetitions,
+                                std::vector<PlusFidSegmentation::PixelType>& dest, std::vector<PlusFidSegmentation::PixelType>& image)
+  {
+    const double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+    for (int i = 0; i < numberOfRepetitions; i++)
+    {
+      (segmentation.*operation)(&dest[0], &image[0]);
+    }
+    return (vtkIGSIOAccurateTimer::GetSystemTime() - startTime) * 1000.0 / numberOfRepetitions;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp = false;
+  int numberOfRepetitions = 20;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help");
+  args.AddArgument("--repetitions", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfRepetitions, "Number of operations on a 820x616 image for measuring the operation time (default: 20, 0 = no measurement)");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  srand(1234);
+  bool success = true;
+
+  // Bar sizes of 0, 1, 3 and 26 pixels, odd image sizes and a region of interest that is smaller than the largest possible
+  const double barSizesMm[4] = { 0.0, 0.078, 0.234, PlusFidSegmentation::DEFAULT_MORPHOLOGICAL_OPENING_BAR_SIZE_MM };
+  for (int i = 0; i < 4; i++)
+  {
+    success &= CheckOperations(820, 616, barSizesMm[i], 0);
+    success &= CheckOperations(101, 97, barSizesMm[i], 0);
+    success &= CheckOperations(101, 97, barSizesMm[i], 3);
+  }
+
+  if (!success)
+  {
+    LOG_ERROR("Vectorized morphological operations do not match the scalar implementation");
+    return EXIT_FAILURE;
+  }
+  LOG_INFO("Vectorized morphological operations match the scalar implementation");
+
+  if (numberOfRepetitions > 0)
+  {
+    const unsigned int width = 820;
+    const unsigned int height = 616;
+    PlusFidSegmentation segmentation;
+    SetupSegmentation(segmentation, width, height, PlusFidSegmentation::DEFAULT_MORPHOLOGICAL_OPENING_BAR_SIZE_MM, 0);
+    std::vector<PlusFidSegmentation::PixelType> image(width * height);
+    std::vector<PlusFidSegmentation::PixelType> dest(width * height);
+    FillRandom(image);
+
+    LOG_INFO("Operation time on a " << width << "x" << height << " image with " << segmentation.GetMorphologicalOpeningBarSizePx() << " pixel bar size (vectorized / scalar):");
+    for (int i = 0; i < NUMBER_OF_OPERATIONS; i++)
+    {
+      LOG_INFO("  " << OPERATIONS[i].Name << ": "
+               << MeasureOperationTimeMs(segmentation, OPERATIONS[i].Vectorized, numberOfRepetitions, dest, image) << "ms / "
+               << MeasureOperationTimeMs(segmentation, OPERATIONS[i].Scalar, numberOfRepetitions, dest, image) << "ms");
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
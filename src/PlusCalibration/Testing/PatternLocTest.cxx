@@ -12,6 +12,8 @@ See License.txt for details.
 #include "vtkIGSIOSequenceIO.h"
 #include "vtkSmartPointer.h"
 #include "vtkIGSIOTrackedFrameList.h"
+#include "vtkMath.h"
+#include "vtkPoints.h"
 #include "vtkXMLDataElement.h"
 #include "vtkXMLUtilities.h"
 #include "vtksys/CommandLineArguments.hxx"
@@ -111,6 +113,46 @@ void SegmentImageSequence(vtkIGSIOTrackedFrameList* trackedFrameList, std::ofstr
   }
 }
 
+// Segment the sequence again in parallel and return the number of frames where the result differs from the result of the sequential segmentation
+int CompareParallelSegmentationResults(vtkIGSIOTrackedFrameList* segmentedTrackedFrameList, const std::string& inputImageSequencePath, PlusFidPatternRecognition& patternRecognition)
+{
+  vtkSmartPointer<vtkIGSIOTrackedFrameList> trackedFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+  if (vtkIGSIOSequenceIO::Read(inputImageSequencePath, trackedFrameList) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to read sequence metafile: " << inputImageSequencePath);
+    return 1;
+  }
+
+  PlusFidPatternRecognition parallelPatternRecognition(patternRecognition);
+  parallelPatternRecognition.GetFidSegmentation()->SetDebugOutput(false);
+  parallelPatternRecognition.SetNumberOfThreads(4);
+  PlusFidPatternRecognition::PatternRecognitionError error;
+  parallelPatternRecognition.RecognizePattern(trackedFrameList, error);
+
+  int numberOfFailures = 0;
+  for (unsigned int frameIndex = 0; frameIndex < trackedFrameList->GetNumberOfTrackedFrames(); frameIndex++)
+  {
+    vtkPoints* points = trackedFrameList->GetTrackedFrame(frameIndex)->GetFiducialPointsCoordinatePx();
+    vtkPoints* baselinePoints = segmentedTrackedFrameList->GetTrackedFrame(frameIndex)->GetFiducialPointsCoordinatePx();
+    if (points == NULL || baselinePoints == NULL || points->GetNumberOfPoints() != baselinePoints->GetNumberOfPoints())
+    {
+      LOG_ERROR("Frame " << frameIndex << ": Number of fiducials found by parallel segmentation differs from sequential segmentation");
+      numberOfFailures++;
+      continue;
+    }
+    for (vtkIdType pointIndex = 0; pointIndex < points->GetNumberOfPoints(); pointIndex++)
+    {
+      if (sqrt(vtkMath::Distance2BetweenPoints(points->GetPoint(pointIndex), baselinePoints->GetPoint(pointIndex))) > FIDUCIAL_POSITION_TOLERANCE)
+      {
+        LOG_ERROR("Frame " << frameIndex << ": Fiducial " << pointIndex << " found by parallel segmentation differs from sequential segmentation");
+        numberOfFailures++;
+        break;
+      }
+    }
+  }
+  return numberOfFailures;
+}
+
 // return the number of differences
 int CompareSegmentationResults(const std::string& inputBaselineFileName, const std::string& outputTestResultsFileName, PlusFidPatternRecognition& patternRecognition)
 {
@@ -455,6 +497,13 @@ int main(int argc, char** argv)
 
   LOG_DEBUG("Done!");
 
+  LOG_INFO("Compare parallel segmentation results");
+  if (CompareParallelSegmentationResults(trackedFrameList, inputImageSequencePath, patternRecognition) != 0)
+  {
+    LOG_ERROR("Parallel segmentation results differ from sequential segmentation results");
+    return EXIT_FAILURE;
+  }
+
   if (!inputBaselineFileName.empty())
   {
     LOG_INFO("Compare results");
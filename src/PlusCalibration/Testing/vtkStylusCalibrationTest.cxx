@@ -131,6 +131,8 @@ int main(int argc, char* argv[])
     LOG_ERROR("Unable to read pivot calibration configuration!");
     exit(EXIT_FAILURE);
   }
+  // Compute the incremental solution as well, to compare it with the batch solution
+  pivotCalibration->IncrementalCalibrationOn();
 
   // Create and initialize transform repository
   igsioTrackedFrame trackedFrame;
@@ -221,6 +223,28 @@ int main(int argc, char* argv[])
   LOG_INFO("Number of detected outliers: " << pivotCalibration->GetNumberOfDetectedOutliers());
   LOG_INFO("Mean calibration error: " << pivotCalibration->GetCalibrationError() << " mm");
 
+  double incrementalPivotPoint_Marker[3] = { 0 };
+  if (pivotCalibration->ReweightIncrementalCalibration() != PLUS_SUCCESS
+      || pivotCalibration->GetIncrementalPivotPointToMarkerTranslation(incrementalPivotPoint_Marker) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Incremental calibration error!");
+    exit(EXIT_FAILURE);
+  }
+  LOG_INFO("Number of outliers detected by incremental calibration: " << pivotCalibration->GetNumberOfIncrementalOutliers());
+  LOG_INFO("RMS incremental calibration error: " << pivotCalibration->GetIncrementalCalibrationError() << " mm");
+  double batchPivotPoint_Marker[3] =
+  {
+    pivotCalibration->GetPivotPointToMarkerTransformMatrix()->GetElement(0, 3),
+    pivotCalibration->GetPivotPointToMarkerTransformMatrix()->GetElement(1, 3),
+    pivotCalibration->GetPivotPointToMarkerTransformMatrix()->GetElement(2, 3)
+  };
+  double incrementalDiff = sqrt(vtkMath::Distance2BetweenPoints(incrementalPivotPoint_Marker, batchPivotPoint_Marker));
+  if (incrementalDiff > TRANSLATION_ERROR_THRESHOLD)
+  {
+    LOG_ERROR("Incremental and batch calibration results differ: translation difference is " << incrementalDiff << ", maximum allowed is " << TRANSLATION_ERROR_THRESHOLD);
+    exit(EXIT_FAILURE);
+  }
+
   // Save result
   if (transformRepository->WriteConfiguration(configRootElement) != PLUS_SUCCESS)
   {
@@ -19,6 +19,7 @@ compares the results to a baseline
 #include "vtkMath.h"
 #include "vtkMatrix4x4.h"
 #include "vtkPlusProbeCalibrationAlgo.h"
+#include "vtkIGSIOAccurateTimer.h"
 #include "vtkIGSIOSequenceIO.h"
 #include "vtkSmartPointer.h"
 #include "vtkIGSIOTrackedFrameList.h"
@@ -139,6 +140,7 @@ int main(int argc, char* argv[])
 
   LOG_INFO("Segmentation success rate of calibration images: " << numberOfSuccessfullySegmentedCalibrationImages << " out of " << calibrationTrackedFrameList->GetNumberOfTrackedFrames());
 
+  double calibrationStartTime = 0.0;
   if (!inputValidationSeqMetafile.empty())
   {
     // Load and segment validation image
@@ -161,6 +163,7 @@ int main(int argc, char* argv[])
 
     // Calibrate using independent data for validation
     LOG_INFO("Calibrate...");
+    calibrationStartTime = vtkIGSIOAccurateTimer::GetSystemTime();
     if (freehandCalibration->Calibrate(validationTrackedFrameList, calibrationTrackedFrameList, transformRepository, patternRecognition.GetFidLineFinder()->GetNWires()) != PLUS_SUCCESS)
     {
       LOG_ERROR("Calibration failed!");
@@ -173,6 +176,7 @@ int main(int argc, char* argv[])
     LOG_INFO("Validation data set is not provided, therefore error is computed from the calibration data set");
     // Calibrate using the same data for calibration and validation
     LOG_INFO("Calibrate...");
+    calibrationStartTime = vtkIGSIOAccurateTimer::GetSystemTime();
     if (freehandCalibration->Calibrate(calibrationTrackedFrameList, calibrationTrackedFrameList, transformRepository, patternRecognition.GetFidLineFinder()->GetNWires()) != PLUS_SUCCESS)
     {
       LOG_ERROR("Calibration failed!");
@@ -180,6 +184,15 @@ int main(int argc, char* argv[])
     }
   }
 
+  // Timing report
+  LOG_INFO("Calibration time: " << vtkIGSIOAccurateTimer::GetSystemTime() - calibrationStartTime << " sec");
+  if (freehandCalibration->GetOptimizer()->Enabled())
+  {
+    vtkPlusProbeCalibrationOptimizerAlgo* optimizer = freehandCalibration->GetOptimizer();
+    LOG_INFO("  Optimization time: " << optimizer->GetOptimizationTimeSec() << " sec (" << optimizer->GetNumberOfCostFunctionEvaluations() << " cost function and "
+             << optimizer->GetNumberOfJacobianEvaluations() << " Jacobian evaluations)");
+  }
+
   // Save result to configuration file
   if (!resultConfigFileName.empty())
   {
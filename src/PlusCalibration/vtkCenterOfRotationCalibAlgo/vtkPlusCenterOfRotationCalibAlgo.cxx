@@ -7,6 +7,7 @@
 #include "PlusConfigure.h"
 
 #include "PlusMath.h"
+#include "PlusWorkerPool.h"
 #ifdef PLUS_RENDERING_ENABLED
 #include "PlusPlotter.h"
 #endif
@@ -127,8 +128,8 @@ PlusStatus vtkPlusCenterOfRotationCalibAlgo::Update()
   }
 
   // Data containers
-  std::vector<vnl_vector<double> > aMatrix;
-  std::vector<double> bVector;
+  vnl_matrix<double> aMatrix;
+  vnl_vector<double> bVector;
 
   if (this->ConstructLinearEquationForCalibration(aMatrix, bVector) != PLUS_SUCCESS)
   {
@@ -136,7 +137,7 @@ PlusStatus vtkPlusCenterOfRotationCalibAlgo::Update()
     return PLUS_FAIL;
   }
 
-  if (aMatrix.size() == 0 || bVector.size() == 0)
+  if (aMatrix.rows() == 0 || bVector.size() == 0)
   {
     LOG_WARNING("Center of rotation calculation failed, no data found!");
     return PLUS_FAIL;
@@ -160,8 +161,7 @@ PlusStatus vtkPlusCenterOfRotationCalibAlgo::Update()
   this->CenterOfRotationPx[0] = centerOfRotationInPx[0] / this->Spacing[0];
   this->CenterOfRotationPx[1] = centerOfRotationInPx[1] / this->Spacing[1];
 
-  this->UpdateReportTable();
-
+  // The report table is built by GetReportTable when it is needed
   this->UpdateTime.Modified();
 
   return PLUS_SUCCESS;
@@ -225,7 +225,7 @@ int vtkPlusCenterOfRotationCalibAlgo::GetNumberOfNWirePatterns()
 }
 
 //----------------------------------------------------------------------------
-PlusStatus vtkPlusCenterOfRotationCalibAlgo::ConstructLinearEquationForCalibration(std::vector<vnl_vector<double> >& aMatrix, std::vector<double>& bVector)
+PlusStatus vtkPlusCenterOfRotationCalibAlgo::ConstructLinearEquationForCalibration(vnl_matrix<double>& aMatrix, vnl_vector<double>& bVector)
 {
   LOG_TRACE("vtkPlusCenterOfRotationCalibAlgo::ConstructLinearEquationForCalibration");
   aMatrix.clear();
@@ -270,8 +270,9 @@ PlusStatus vtkPlusCenterOfRotationCalibAlgo::ConstructLinearEquationForCalibrati
     return PLUS_FAIL;
   }
 
-  // Reserve memory for wire points
-  std::vector<vtkSmartPointer<vtkPoints> > vectorOfWirePoints;
+  // Coordinates (in mm) of the non-moving wire points of each frame: x and y of each point, contiguous
+  const int numberOfWirePoints = numberOfNFiduacials * 2;   // Use only the two non-moving points of the N fiducial
+  std::vector<std::vector<double> > vectorOfWirePoints;
   vectorOfWirePoints.reserve(numberOfFrames);
 
   for (unsigned int i = 0; i < this->TrackedFrameListIndices.size(); ++i)
@@ -293,53 +294,78 @@ PlusStatus vtkPlusCenterOfRotationCalibAlgo::ConstructLinearEquationForCalibrati
       continue;
     }
 
-    vtkSmartPointer<vtkPoints> point = vtkSmartPointer<vtkPoints>::New();
-    point->SetDataTypeToDouble();
-    point->SetNumberOfPoints(numberOfNFiduacials * 2);   // Use only the two non-moving points of the N fiducial
-
-    int vectorID(0);   // ID used for point position in vtkPoints for faster execution
-    for (int p = 0; p < trackedFrame->GetFiducialPointsCoordinatePx()->GetNumberOfPoints(); ++p)
+    std::vector<double> points(numberOfWirePoints * 2, 0.0);
+    int vectorID(0);   // ID used for point position in the coordinate vector
+    for (int p = 0; p < trackedFrame->GetFiducialPointsCoordinatePx()->GetNumberOfPoints() && vectorID < numberOfWirePoints; ++p)
     {
       if (((p + 1) % 3) != 2)       // wire #1,#3,#4,#6... => use only non moving points of the N-wire
       {
-        double* wireCoordinatePx = trackedFrame->GetFiducialPointsCoordinatePx()->GetPoint(p);
-        point->SetPoint(vectorID++, wireCoordinatePx[0], wireCoordinatePx[1], wireCoordinatePx[2]);
+        double wireCoordinatePx[3] = {0};
+        trackedFrame->GetFiducialPointsCoordinatePx()->GetPoint(p, wireCoordinatePx);
+        points[2 * vectorID] = wireCoordinatePx[0] * this->Spacing[0];
+        points[2 * vectorID + 1] = wireCoordinatePx[1] * this->Spacing[1];
+        vectorID++;
       }
     }
 
-    vectorOfWirePoints.push_back(point);
+    vectorOfWirePoints.push_back(points);
   }
 
-  for (unsigned int i = 0; i <= vectorOfWirePoints.size() - 2; i++)
+  // Each frame i is paired with frames i+1, i+3, i+5... and each pair adds a row for each wire point.
+  // Compute the first row of each frame so that the frames can be processed in parallel.
+  const int numberOfWireFrames = static_cast<int>(vectorOfWirePoints.size());
+  std::vector<unsigned int> firstRowOfFrame(numberOfWireFrames + 1, 0);
+  for (int i = 0; i < numberOfWireFrames; i++)
   {
-    for (unsigned int j = i + 1; j <= vectorOfWirePoints.size() - 1; j = j + 2)
+    unsigned int numberOfRows = 0;
+    for (int j = i + 1; j < numberOfWireFrames; j = j + 2)
     {
-      if (vectorOfWirePoints[i]->GetNumberOfPoints() != vectorOfWirePoints[j]->GetNumberOfPoints())
+      if (vectorOfWirePoints[i].size() == vectorOfWirePoints[j].size())
       {
-        continue;
+        numberOfRows += vectorOfWirePoints[i].size() / 2;
       }
+    }
+    firstRowOfFrame[i + 1] = firstRowOfFrame[i] + numberOfRows;
+  }
+
+  aMatrix.set_size(firstRowOfFrame[numberOfWireFrames], 2);
+  bVector.set_size(firstRowOfFrame[numberOfWireFrames]);
 
-      for (int point = 0; point < vectorOfWirePoints[i]->GetNumberOfPoints(); point++)
+  PlusWorkerPool::GetInstance().ParallelFor(0, numberOfWireFrames, 0, [&](int firstFrame, int lastFrame)
+  {
+    for (int i = firstFrame; i < lastFrame; i++)
+    {
+      unsigned int row = firstRowOfFrame[i];
+      const std::vector<double>& pointsI = vectorOfWirePoints[i];
+      for (int j = i + 1; j < numberOfWireFrames; j = j + 2)
       {
-        // coordiates of the i-th element
-        double Xi = vectorOfWirePoints[i]->GetPoint(point)[0] * this->Spacing[0];
-        double Yi = vectorOfWirePoints[i]->GetPoint(point)[1] * this->Spacing[1];
-
-        // coordiates of the j-th element
-        double Xj = vectorOfWirePoints[j]->GetPoint(point)[0] * this->Spacing[0];
-        double Yj = vectorOfWirePoints[j]->GetPoint(point)[1] * this->Spacing[1];
-
-        // Populate the list of distance
-        vnl_vector<double> rowOfDistance(2, 0);
-        rowOfDistance.put(0, Xi - Xj);
-        rowOfDistance.put(1, Yi - Yj);
-        aMatrix.push_back(rowOfDistance);
-
-        // Populate the squared distance vector
-        bVector.push_back(0.5 * (Xi * Xi + Yi * Yi - Xj * Xj - Yj * Yj));
+        const std::vector<double>& pointsJ = vectorOfWirePoints[j];
+        if (pointsI.size() != pointsJ.size())
+        {
+          continue;
+        }
+
+        for (size_t point = 0; point < pointsI.size() / 2; point++)
+        {
+          // coordiates of the i-th element
+          double Xi = pointsI[2 * point];
+          double Yi = pointsI[2 * point + 1];
+
+          // coordiates of the j-th element
+          double Xj = pointsJ[2 * point];
+          double Yj = pointsJ[2 * point + 1];
+
+          // Populate the list of distance
+          aMatrix(row, 0) = Xi - Xj;
+          aMatrix(row, 1) = Yi - Yj;
+
+          // Populate the squared distance vector
+          bVector[row] = 0.5 * (Xi * Xi + Yi * Yi - Xj * Xj - Yj * Yj);
+          row++;
+        }
       }
     }
-  }
+  });
 
   return PLUS_SUCCESS;
 }
@@ -349,8 +375,12 @@ PlusStatus vtkPlusCenterOfRotationCalibAlgo::UpdateReportTable()
 {
   LOG_TRACE("vtkPlusCenterOfRotationCalibAlgo::UpdateReportTable");
 
-  // Clear table before update
-  this->SetReportTable(NULL);
+  // Clear table before update - don't use set macro, it changes the modification time of the algorithm
+  if (this->ReportTable != NULL)
+  {
+    this->ReportTable->Delete();
+    this->ReportTable = NULL;
+  }
 
   if (this->ReportTable == NULL)
   {
@@ -502,13 +532,25 @@ PlusStatus vtkPlusCenterOfRotationCalibAlgo::UpdateReportTable()
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+vtkTable* vtkPlusCenterOfRotationCalibAlgo::GetReportTable()
+{
+  // Update calibration result, then build the table if it was not built for this result yet
+  if (this->Update() == PLUS_SUCCESS && this->ReportTableUpdateTime < this->UpdateTime)
+  {
+    this->UpdateReportTable();
+    this->ReportTableUpdateTime.Modified();
+  }
+  return this->ReportTable;
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusCenterOfRotationCalibAlgo::AddNewColumnToReportTable(const char* columnName)
 {
   if (this->ReportTable == NULL)
   {
-    vtkSmartPointer<vtkTable> table = vtkSmartPointer<vtkTable>::New();
-    this->SetReportTable(table);
+    // Don't use set macro, it changes the modification time of the algorithm
+    this->ReportTable = vtkTable::New();
   }
 
   if (columnName == NULL)
@@ -543,7 +585,7 @@ PlusStatus vtkPlusCenterOfRotationCalibAlgo::GenerateReport(vtkPlusHTMLGenerator
     return PLUS_FAIL;
   }
 
-  return vtkPlusCenterOfRotationCalibAlgo::GenerateCenterOfRotationReport(this->GetNumberOfNWirePatterns(), htmlReport, this->ReportTable, this->CenterOfRotationPx);
+  return vtkPlusCenterOfRotationCalibAlgo::GenerateCenterOfRotationReport(this->GetNumberOfNWirePatterns(), htmlReport, this->GetReportTable(), this->CenterOfRotationPx);
 }
 
 //----------------------------------------------------------------------------
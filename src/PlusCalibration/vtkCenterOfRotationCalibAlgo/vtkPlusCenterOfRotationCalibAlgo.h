@@ -14,6 +14,9 @@
 #include "vtkTable.h"
 #include "vtkIGSIOTrackedFrameList.h"
 
+#include <vnl/vnl_matrix.h>
+#include <vnl/vnl_vector.h>
+
 class vtkPlusHTMLGenerator;
 
 /*!
@@ -70,8 +73,11 @@ public:
   /*! Get the center of rotation calibration error */
   virtual PlusStatus GetError(double& mean, double& stdev);
 
-  /*! Get the report table that is used for storing algorithm results */
-  vtkGetObjectMacro(ReportTable, vtkTable);
+  /*!
+    Get the report table that is used for storing algorithm results. The table is built when it is first
+    requested after the calibration, as it is not needed for computing the center of rotation.
+  */
+  virtual vtkTable* GetReportTable();
 
   /*! Add generated html report from center of rotation calibration to the existing html report */
   virtual PlusStatus GenerateReport(vtkPlusHTMLGenerator* htmlReport);
@@ -108,8 +114,11 @@ protected:
   /*! Bring this algorithm's outputs up-to-date. */
   virtual PlusStatus Update();
 
-  /*! Construct linear equation for center of rotation calibration */
-  virtual PlusStatus ConstructLinearEquationForCalibration(std::vector<vnl_vector<double> >& aMatrix, std::vector<double>& bVector);
+  /*!
+    Construct linear equation for center of rotation calibration. The rows of the frame pairs are filled in
+    parallel, at positions that are computed before filling.
+  */
+  virtual PlusStatus ConstructLinearEquationForCalibration(vnl_matrix<double>& aMatrix, vnl_vector<double>& bVector);
 
   /*! Add new column to the report table */
   PlusStatus AddNewColumnToReportTable(const char* columnName);
@@ -146,6 +155,9 @@ protected:
 
   /*! When the results were computed. The result is recomputed only if the inputs changed more recently than UpdateTime. */
   vtkTimeStamp UpdateTime;
+
+  /*! When the report table was built. The table is rebuilt if the results were computed more recently than ReportTableUpdateTime. */
+  vtkTimeStamp ReportTableUpdateTime;
 };
 
 #endif
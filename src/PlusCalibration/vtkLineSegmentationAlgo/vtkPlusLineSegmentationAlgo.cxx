@@ -8,6 +8,7 @@ See License.txt for details.
 #include "PlusConfigure.h"
 #include "igsioTrackedFrame.h"
 #include "vtkIGSIOTrackedFrameList.h"
+#include "PlusWorkerPool.h"
 
 // Utility includes
 #include <PlaneParametersEstimator.h>
@@ -31,6 +32,7 @@ See License.txt for details.
 #include <vtkContextView.h>
 #endif
 #include <vtkDoubleArray.h>
+#include <vtkImageData.h>
 #include <vtkIntArray.h>
 #include <vtkObjectFactory.h>
 #include <vtkPen.h>
@@ -73,6 +75,7 @@ vtkPlusLineSegmentationAlgo::vtkPlusLineSegmentationAlgo()
   , PlotIntensityProfile(false)
   , m_SignalTimeRangeMin(0.0)
   , m_SignalTimeRangeMax(-1.0)
+  , NumberOfThreads(0)
 {
   m_ClipRectangleOrigin[0] = 0;
   m_ClipRectangleOrigin[1] = 0;
@@ -195,201 +198,275 @@ PlusStatus vtkPlusLineSegmentationAlgo::ComputeVideoPositionMetric()
   nonDetectedLineParams.lineDirectionVector_Image[1] = 1;
   m_LineParameters.assign(m_TrackedFrameList->GetNumberOfTrackedFrames(), nonDetectedLineParams);
 
-  //  For each video frame, detect line and extract mindpoint and slope parameters
-  int numberOfSuccessfulLineSegmentations = 0;
-  bool signalTimeRangeDefined = (m_SignalTimeRangeMin <= m_SignalTimeRangeMax);
-  for (unsigned int frameNumber = 0; frameNumber < m_TrackedFrameList->GetNumberOfTrackedFrames(); ++frameNumber)
+  //  For each video frame, detect line and extract mindpoint and slope parameters.
+  //  The frames are processed in parallel, the results are collected in the order of the frames.
+  const int numberOfFrames = m_TrackedFrameList->GetNumberOfTrackedFrames();
+  std::vector<char> lineDetected(numberOfFrames, 0);
+  std::vector<double> signalValues(numberOfFrames, 0.0);
+  // Intermediate images and intensity profile plots are only created on the calling thread
+  const int numberOfTasks = (m_SaveIntermediateImages || this->PlotIntensityProfile) ? 1 : this->NumberOfThreads;
+  PlusWorkerPool::GetInstance().ParallelFor(0, numberOfFrames, numberOfTasks, [&](int firstFrameNumber, int lastFrameNumber)
   {
-    LOG_TRACE("Calculating video position metric for frame " << frameNumber);
-    igsioTrackedFrame* trackedFrame = m_TrackedFrameList->GetTrackedFrame(frameNumber);
-    if (signalTimeRangeDefined && (trackedFrame->GetTimestamp() < m_SignalTimeRangeMin || trackedFrame->GetTimestamp() > m_SignalTimeRangeMax))
+    for (int frameNumber = firstFrameNumber; frameNumber < lastFrameNumber; ++frameNumber)
     {
-      // frame is out of the specified signal range
-      LOG_TRACE("Skip frame, it is out of the valid signal range");
-      continue;
+      if (SegmentFrame(frameNumber, m_LineParameters[frameNumber], signalValues[frameNumber]) == PLUS_SUCCESS)
+      {
+        lineDetected[frameNumber] = 1;
+      }
     }
+  });
 
-    // Get current image
-    if (trackedFrame->GetImageData()->GetVTKScalarPixelType() != VTK_UNSIGNED_CHAR)
-    {
-      LOG_ERROR("vtkPlusLineSegmentationAlgo::ComputeVideoPositionMetric only supports 8-bit images");
-      continue;
-    }
-    CharImageType::Pointer localImage = CharImageType::New();
-    PlusCommon::DeepCopyVtkVolumeToItkImage<CharPixelType>(trackedFrame->GetImageData()->GetImage(), localImage);
-    if (localImage.IsNull())
+  int numberOfSuccessfulLineSegmentations = 0;
+  for (int frameNumber = 0; frameNumber < numberOfFrames; ++frameNumber)
+  {
+    if (!lineDetected[frameNumber])
     {
-      // Dropped frame
-      LOG_ERROR("vtkPlusLineSegmentationAlgo::ComputeVideoPositionMetric failed to retrieve image data from frame");
       continue;
     }
+    ++numberOfSuccessfulLineSegmentations;
+    m_SignalValues.push_back(signalValues[frameNumber]);
 
-    // Create an image duplicator to copy the original image
-    typedef itk::ImageDuplicator<CharImageType> DuplicatorType;
-    DuplicatorType::Pointer duplicator = DuplicatorType::New();
-    CharImageType::Pointer scanlineImage;
-    if (m_SaveIntermediateImages == true)
-    {
-      duplicator->SetInputImage(localImage);
-      duplicator->Update();
+    //  Store timestamp for image frame
+    m_SignalTimestamps.push_back(m_TrackedFrameList->GetTrackedFrame(frameNumber)->GetTimestamp());
+  }
 
-      // Create an image copy to draw the scanlines on
-      scanlineImage = duplicator->GetOutput();
-    }
+  double segmentationSuccessRate = double(numberOfSuccessfulLineSegmentations) / m_TrackedFrameList->GetNumberOfTrackedFrames();
+  if (segmentationSuccessRate < EXPECTED_LINE_SEGMENTATION_SUCCESS_RATE)
+  {
+    LOG_WARNING("Line segmentation success rate is very low (" << segmentationSuccessRate * 100 << "%): a line could only be detected on " << numberOfSuccessfulLineSegmentations << " frames out of " << m_TrackedFrameList->GetNumberOfTrackedFrames());
+  }
 
-    std::vector<itk::Point<double, 2> > intensityPeakPositions;
-    CharImageType::RegionType region = localImage->GetLargestPossibleRegion();
-    LimitToClipRegion(region);
+  bool plotVideoMetric = vtkPlusLogger::Instance()->GetLogLevel() >= vtkPlusLogger::LOG_LEVEL_TRACE;
+  if (plotVideoMetric)
+  {
+    PlotDoubleArray(m_SignalValues);
+  }
 
-    int numOfValidScanlines = 0;
+  return PLUS_SUCCESS;
 
-    for (int currScanlineNum = 0; currScanlineNum < NUMBER_OF_SCANLINES; ++currScanlineNum)
-    {
-      // Set the scanline start pixel
-      CharImageType::IndexType startPixel;
-      double scanlineSpacingPix = static_cast<double>(region.GetSize()[0] - 1) / (NUMBER_OF_SCANLINES - 1);
-      startPixel[0] = region.GetIndex()[0] + scanlineSpacingPix * (currScanlineNum);
-      startPixel[1] = region.GetIndex()[1];
-
-      // Set the scanline end pixel
-      CharImageType::IndexType endPixel;
-      endPixel[0] = startPixel[0];
-      endPixel[1] = startPixel[1] + region.GetSize()[1] - 1;
-
-      std::deque<int> intensityProfile; // Holds intensity profile of the line
-      itk::LineIterator<CharImageType> it(localImage, startPixel, endPixel);
-      it.GoToBegin();
-
-      itk::LineIterator<CharImageType>* itScanlineImage = NULL;
-      if (m_SaveIntermediateImages == true)
-      {
-        // Iterator for the scanline image copy
-        // it's time-consuming to instantiate this iterator, so only do it if intermediate image saving is requested
-        itScanlineImage = new itk::LineIterator<CharImageType>(scanlineImage, startPixel, endPixel);
-        itScanlineImage->GoToBegin();
-      }
+} //  End LineDetection
 
-      while (!it.IsAtEnd())
-      {
-        intensityProfile.push_back((int)it.Get());
-        if (m_SaveIntermediateImages == true)
-        {
-          // Set the pixels on the scanline image copy to white
-          itScanlineImage->Set(255);
-          ++(*itScanlineImage);
-        }
-        ++it;
-      }
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusLineSegmentationAlgo::SegmentFrame(int frameNumber, LineParameters& lineParameters, double& signalValue)
+{
+  LOG_TRACE("Calculating video position metric for frame " << frameNumber);
+  igsioTrackedFrame* trackedFrame = m_TrackedFrameList->GetTrackedFrame(frameNumber);
+  bool signalTimeRangeDefined = (m_SignalTimeRangeMin <= m_SignalTimeRangeMax);
+  if (signalTimeRangeDefined && (trackedFrame->GetTimestamp() < m_SignalTimeRangeMin || trackedFrame->GetTimestamp() > m_SignalTimeRangeMax))
+  {
+    // frame is out of the specified signal range
+    LOG_TRACE("Skip frame, it is out of the valid signal range");
+    return PLUS_FAIL;
+  }
 
-      // Delete the iterator declared with new()
-      if (itScanlineImage != NULL)
-      {
-        delete itScanlineImage;
-        itScanlineImage = NULL;
-      }
+  // Get current image
+  if (trackedFrame->GetImageData()->GetVTKScalarPixelType() != VTK_UNSIGNED_CHAR)
+  {
+    LOG_ERROR("vtkPlusLineSegmentationAlgo::ComputeVideoPositionMetric only supports 8-bit images");
+    return PLUS_FAIL;
+  }
+  CharImageType::Pointer localImage = CharImageType::New();
+  if (CopyFrameToItkImage(trackedFrame->GetImageData()->GetImage(), localImage, m_SaveIntermediateImages) != PLUS_SUCCESS)
+  {
+    // Dropped frame
+    LOG_ERROR("vtkPlusLineSegmentationAlgo::ComputeVideoPositionMetric failed to retrieve image data from frame");
+    return PLUS_FAIL;
+  }
 
-      if (this->PlotIntensityProfile)
-      {
-        // Plot the intensity profile
-        PlotIntArray(intensityProfile);
-      }
+  // Create an image duplicator to copy the original image
+  typedef itk::ImageDuplicator<CharImageType> DuplicatorType;
+  DuplicatorType::Pointer duplicator = DuplicatorType::New();
+  CharImageType::Pointer scanlineImage;
+  if (m_SaveIntermediateImages == true)
+  {
+    duplicator->SetInputImage(localImage);
+    duplicator->Update();
 
-      // Find the max intensity value from the peak with the largest area
-      int maxFromLargestArea = -1;
-      int maxFromLargestAreaIndex = -1;
-      int startOfMaxArea = -1;
-      if (FindLargestPeak(intensityProfile, maxFromLargestArea, maxFromLargestAreaIndex, startOfMaxArea) == PLUS_SUCCESS)
-      {
-        double currPeakPos_y = -1;
-        switch (PEAK_POS_METRIC)
-        {
-          case PEAK_POS_COG:
-            {
-              /* Use center-of-gravity (COG) as peak-position metric*/
-              if (ComputeCenterOfGravity(intensityProfile, startOfMaxArea, currPeakPos_y) != PLUS_SUCCESS)
-              {
-                // unable to compute center-of-gravity; this scanline is invalid
-                continue;
-              }
-              break;
-            }
-          case PEAK_POS_START:
-            {
-              /* Use peak start as peak-position metric*/
-              if (FindPeakStart(intensityProfile, maxFromLargestArea, startOfMaxArea, currPeakPos_y) != PLUS_SUCCESS)
-              {
-                // unable to compute peak start; this scanline is invalid
-                continue;
-              }
-              break;
-            }
-        }
+    // Create an image copy to draw the scanlines on
+    scanlineImage = duplicator->GetOutput();
+  }
 
-        itk::Point<double, 2> currPeakPos;
-        currPeakPos[0] = static_cast<double>(startPixel[0]);
-        currPeakPos[1] = startPixel[1] + currPeakPos_y;
-        intensityPeakPositions.push_back(currPeakPos);
-        ++numOfValidScanlines;
+  std::vector<itk::Point<double, 2> > intensityPeakPositions;
+  CharImageType::RegionType region = localImage->GetLargestPossibleRegion();
+  if (m_SaveIntermediateImages == true)
+  {
+    // The whole frame is copied for the intermediate images, but only the clip rectangle is processed
+    LimitToClipRegion(region);
+  }
 
-      } // end if() found intensity peak
+  int numOfValidScanlines = 0;
 
-    } // end currScanlineNum loop
+  for (int currScanlineNum = 0; currScanlineNum < NUMBER_OF_SCANLINES; ++currScanlineNum)
+  {
+    // Set the scanline start pixel
+    CharImageType::IndexType startPixel;
+    double scanlineSpacingPix = static_cast<double>(region.GetSize()[0] - 1) / (NUMBER_OF_SCANLINES - 1);
+    startPixel[0] = region.GetIndex()[0] + scanlineSpacingPix * (currScanlineNum);
+    startPixel[1] = region.GetIndex()[1];
+
+    // Set the scanline end pixel
+    CharImageType::IndexType endPixel;
+    endPixel[0] = startPixel[0];
+    endPixel[1] = startPixel[1] + region.GetSize()[1] - 1;
+
+    std::deque<int> intensityProfile; // Holds intensity profile of the line
+    itk::LineIterator<CharImageType> it(localImage, startPixel, endPixel);
+    it.GoToBegin();
+
+    itk::LineIterator<CharImageType>* itScanlineImage = NULL;
+    if (m_SaveIntermediateImages == true)
+    {
+      // Iterator for the scanline image copy
+      // it's time-consuming to instantiate this iterator, so only do it if intermediate image saving is requested
+      itScanlineImage = new itk::LineIterator<CharImageType>(scanlineImage, startPixel, endPixel);
+      itScanlineImage->GoToBegin();
+    }
 
-    if (numOfValidScanlines < MINIMUM_NUMBER_OF_VALID_SCANLINES)
+    while (!it.IsAtEnd())
     {
-      //TODO: drop the frame from the analysis
-      LOG_DEBUG("Only " << numOfValidScanlines << " valid scanlines; this is less than the required " << MINIMUM_NUMBER_OF_VALID_SCANLINES << ". Skipping frame" << frameNumber);
+      intensityProfile.push_back((int)it.Get());
+      if (m_SaveIntermediateImages == true)
+      {
+        // Set the pixels on the scanline image copy to white
+        itScanlineImage->Set(255);
+        ++(*itScanlineImage);
+      }
+      ++it;
     }
 
-    LineParameters params;
-    ComputeLineParameters(intensityPeakPositions, params);
-    if (!params.lineDetected)
+    // Delete the iterator declared with new()
+    if (itScanlineImage != NULL)
     {
-      LOG_DEBUG("Unable to compute line parameters for frame " << frameNumber);
-      continue;
+      delete itScanlineImage;
+      itScanlineImage = NULL;
     }
-    if (params.lineDirectionVector_Image[0] < MIN_X_SLOPE_COMPONENT_FOR_DETECTED_LINE)
+
+    if (this->PlotIntensityProfile)
     {
-      // Line is close to vertical, skip frame because intersection of
-      // line with image's horizontal half point is unstable
-      LOG_TRACE("Line on frame " << frameNumber << " is too close to vertical, skip the frame");
-      continue;
+      // Plot the intensity profile
+      PlotIntArray(intensityProfile);
     }
 
-    ++numberOfSuccessfulLineSegmentations;
-    m_LineParameters[frameNumber] = params;
+    // Find the max intensity value from the peak with the largest area
+    int maxFromLargestArea = -1;
+    int maxFromLargestAreaIndex = -1;
+    int startOfMaxArea = -1;
+    if (FindLargestPeak(intensityProfile, maxFromLargestArea, maxFromLargestAreaIndex, startOfMaxArea) == PLUS_SUCCESS)
+    {
+      double currPeakPos_y = -1;
+      switch (PEAK_POS_METRIC)
+      {
+        case PEAK_POS_COG:
+          {
+            /* Use center-of-gravity (COG) as peak-position metric*/
+            if (ComputeCenterOfGravity(intensityProfile, startOfMaxArea, currPeakPos_y) != PLUS_SUCCESS)
+            {
+              // unable to compute center-of-gravity; this scanline is invalid
+              continue;
+            }
+            break;
+          }
+        case PEAK_POS_START:
+          {
+            /* Use peak start as peak-position metric*/
+            if (FindPeakStart(intensityProfile, maxFromLargestArea, startOfMaxArea, currPeakPos_y) != PLUS_SUCCESS)
+            {
+              // unable to compute peak start; this scanline is invalid
+              continue;
+            }
+            break;
+          }
+      }
 
-    // Store the y-value of the line, when the line's x-value is half of the image's width
-    double t = (region.GetIndex()[0] + 0.5 * region.GetSize()[0] - params.lineOriginPoint_Image[0]) / params.lineDirectionVector_Image[0];
-    m_SignalValues.push_back(std::abs(params.lineOriginPoint_Image[1] + t * params.lineDirectionVector_Image[1]));
+      itk::Point<double, 2> currPeakPos;
+      currPeakPos[0] = static_cast<double>(startPixel[0]);
+      currPeakPos[1] = startPixel[1] + currPeakPos_y;
+      intensityPeakPositions.push_back(currPeakPos);
+      ++numOfValidScanlines;
 
-    //  Store timestamp for image frame
-    m_SignalTimestamps.push_back(m_TrackedFrameList->GetTrackedFrame(frameNumber)->GetTimestamp());
+    } // end if() found intensity peak
 
-    if (m_SaveIntermediateImages == true)
-    {
-      SaveIntermediateImage(frameNumber, scanlineImage,
-                            params.lineOriginPoint_Image[0], params.lineOriginPoint_Image[1], params.lineDirectionVector_Image[0], params.lineDirectionVector_Image[1],
-                            numOfValidScanlines, intensityPeakPositions);
-    }
+  } // end currScanlineNum loop
 
-  } // end frameNum loop
+  if (numOfValidScanlines < MINIMUM_NUMBER_OF_VALID_SCANLINES)
+  {
+    //TODO: drop the frame from the analysis
+    LOG_DEBUG("Only " << numOfValidScanlines << " valid scanlines; this is less than the required " << MINIMUM_NUMBER_OF_VALID_SCANLINES << ". Skipping frame" << frameNumber);
+  }
 
-  double segmentationSuccessRate = double(numberOfSuccessfulLineSegmentations) / m_TrackedFrameList->GetNumberOfTrackedFrames();
-  if (segmentationSuccessRate < EXPECTED_LINE_SEGMENTATION_SUCCESS_RATE)
+  LineParameters params;
+  ComputeLineParameters(intensityPeakPositions, params);
+  if (!params.lineDetected)
   {
-    LOG_WARNING("Line segmentation success rate is very low (" << segmentationSuccessRate * 100 << "%): a line could only be detected on " << numberOfSuccessfulLineSegmentations << " frames out of " << m_TrackedFrameList->GetNumberOfTrackedFrames());
+    LOG_DEBUG("Unable to compute line parameters for frame " << frameNumber);
+    return PLUS_FAIL;
+  }
+  if (params.lineDirectionVector_Image[0] < MIN_X_SLOPE_COMPONENT_FOR_DETECTED_LINE)
+  {
+    // Line is close to vertical, skip frame because intersection of
+    // line with image's horizontal half point is unstable
+    LOG_TRACE("Line on frame " << frameNumber << " is too close to vertical, skip the frame");
+    return PLUS_FAIL;
   }
 
-  bool plotVideoMetric = vtkPlusLogger::Instance()->GetLogLevel() >= vtkPlusLogger::LOG_LEVEL_TRACE;
-  if (plotVideoMetric)
+  lineParameters = params;
+
+  // Store the y-value of the line, when the line's x-value is half of the image's width
+  double t = (region.GetIndex()[0] + 0.5 * region.GetSize()[0] - params.lineOriginPoint_Image[0]) / params.lineDirectionVector_Image[0];
+  signalValue = std::abs(params.lineOriginPoint_Image[1] + t * params.lineDirectionVector_Image[1]);
+
+  if (m_SaveIntermediateImages == true)
   {
-    PlotDoubleArray(m_SignalValues);
+    SaveIntermediateImage(frameNumber, scanlineImage,
+                          params.lineOriginPoint_Image[0], params.lineOriginPoint_Image[1], params.lineDirectionVector_Image[0], params.lineDirectionVector_Image[1],
+                          numOfValidScanlines, intensityPeakPositions);
   }
 
   return PLUS_SUCCESS;
+}
 
-} //  End LineDetection
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusLineSegmentationAlgo::CopyFrameToItkImage(vtkImageData* frame, CharImageType::Pointer& itkImage, bool copyWholeFrame)
+{
+  if (copyWholeFrame)
+  {
+    return PlusCommon::DeepCopyVtkVolumeToItkImage<CharPixelType>(frame, itkImage);
+  }
+  if (frame == NULL || frame->GetScalarType() != VTK_UNSIGNED_CHAR)
+  {
+    LOG_ERROR("Failed to copy the frame, it is not an 8-bit image");
+    return PLUS_FAIL;
+  }
+
+  // Copy only the clip rectangle, with the same pixel indices as in the whole frame
+  int extent[6] = {0, 0, 0, 0, 0, 0};
+  frame->GetExtent(extent);
+  const CharImageType::SizeValueType frameWidth = extent[1] - extent[0] + 1;
+  CharImageType::RegionType region;
+  CharImageType::IndexType index = {{0, 0}};
+  CharImageType::SizeType size = {{frameWidth, static_cast<CharImageType::SizeValueType>(extent[3] - extent[2] + 1)}};
+  region.SetIndex(index);
+  region.SetSize(size);
+  LimitToClipRegion(region);
+
+  itkImage->SetRegions(region);
+  try
+  {
+    itkImage->Allocate();
+  }
+  catch (itk::ExceptionObject& err)
+  {
+    LOG_ERROR("Failed to allocate memory for the image copy: " << err.GetDescription());
+    return PLUS_FAIL;
+  }
+  const CharPixelType* framePixels = static_cast<const CharPixelType*>(frame->GetScalarPointer());
+  CharPixelType* itkImagePixels = itkImage->GetBufferPointer();
+  for (CharImageType::SizeValueType y = 0; y < region.GetSize()[1]; ++y)
+  {
+    memcpy(itkImagePixels + y * region.GetSize()[0], framePixels + (region.GetIndex()[1] + y) * frameWidth + region.GetIndex()[0], region.GetSize()[0]);
+  }
+  return PLUS_SUCCESS;
+}
 
 //-----------------------------------------------------------------------------
 PlusStatus vtkPlusLineSegmentationAlgo::FindPeakStart(std::deque<int>& intensityProfile, int maxFromLargestArea, int startOfMaxArea, double& startOfPeak)
@@ -926,6 +1003,7 @@ PlusStatus vtkPlusLineSegmentationAlgo::ReadConfiguration(vtkXMLDataElement* aCo
 
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(SaveIntermediateImages, lineSegmentationElement);
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(PlotIntensityProfile, lineSegmentationElement);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, NumberOfThreads, lineSegmentationElement);
 
   this->IntermediateFilesOutputDirectory = vtkPlusConfig::GetInstance()->GetOutputDirectory();
   XML_READ_CSTRING_ATTRIBUTE_OPTIONAL(IntermediateFilesOutputDirectory, lineSegmentationElement);
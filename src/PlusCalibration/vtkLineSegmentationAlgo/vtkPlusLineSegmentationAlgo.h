@@ -14,6 +14,7 @@
 
 //class igsioTrackedFrame; 
 //class vtkIGSIOTrackedFrameList;
+class vtkImageData;
 
 /*!
   \class vtkPlusLineSegmentationAlgo
@@ -81,6 +82,13 @@ public:
   vtkGetMacro(PlotIntensityProfile, bool);
   vtkSetMacro(PlotIntensityProfile, bool);
 
+  /*!
+    Number of threads that segment the frames in parallel (0 = all threads of the shared worker pool).
+    Frames are processed sequentially if intermediate images are saved or intensity profiles are plotted.
+  */
+  vtkGetMacro(NumberOfThreads, int);
+  vtkSetMacro(NumberOfThreads, int);
+
 protected:
   vtkPlusLineSegmentationAlgo();
   virtual ~vtkPlusLineSegmentationAlgo();
@@ -89,6 +97,20 @@ protected:
 
   PlusStatus ComputeVideoPositionMetric();
 
+  /*!
+    Detect the line in a frame. Only reads the member variables, therefore it can be called for multiple frames in parallel.
+    \param lineParameters Parameters of the detected line, not changed if the line is not detected
+    \param signalValue Position of the line at the horizontal center of the clip rectangle
+    \return PLUS_FAIL if the frame is out of the signal time range or no line is detected
+  */
+  PlusStatus SegmentFrame(int frameNumber, LineParameters& lineParameters, double& signalValue);
+
+  /*!
+    Copy the image of a frame. Only the clip rectangle is copied (with the same pixel indices as in the frame)
+    unless copyWholeFrame is true.
+  */
+  PlusStatus CopyFrameToItkImage(vtkImageData* frame, CharImageType::Pointer& itkImage, bool copyWholeFrame);
+
   PlusStatus FindPeakStart(std::deque<int>& intensityProfile, int maxFromLargestArea, int startOfMaxArea, double& startOfPeak);
 
   PlusStatus FindLargestPeak(std::deque<int>& intensityProfile, int& maxFromLargestArea, int& maxFromLargestAreaIndex, int& startOfMaxArea);
@@ -122,6 +144,9 @@ protected:
   /*! Plot intensity profile for each scanline. Enable for debugging. */
   bool PlotIntensityProfile;
 
+  /*! Number of threads that segment the frames in parallel (0 = all threads of the shared worker pool) */
+  int NumberOfThreads;
+
   double m_SignalTimeRangeMin;
   double m_SignalTimeRangeMax;
 
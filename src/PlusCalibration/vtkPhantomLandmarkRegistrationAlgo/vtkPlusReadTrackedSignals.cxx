@@ -5,6 +5,7 @@
 =========================================================Plus=header=end*/
 
 #include "PlusConfigure.h"
+#include "PlusTrackedFrameColumns.h"
 
 #include "vtkObjectFactory.h"
 #include "vtkTransform.h"
@@ -79,10 +80,20 @@ PlusStatus vtkPlusReadTrackedSignals::VerifyInputFrames()
 //-----------------------------------------------------------------------------
 PlusStatus vtkPlusReadTrackedSignals::ComputeTrackerPositionMetric()
 {
-  vtkSmartPointer<vtkIGSIOTransformRepository> transformRepository = vtkSmartPointer<vtkIGSIOTransformRepository>::New();
-
-  vtkSmartPointer<vtkMatrix4x4> pivotToReferenceTransform = vtkSmartPointer<vtkMatrix4x4>::New();
   igsioTransformName transformName(ObjectMarkerCoordinateFrame, ReferenceCoordinateFrame);
+
+  // Read the transform from all frames at once, instead of a transform repository lookup for each frame
+  PlusTrackedFrameColumns columns;
+  if (columns.Build(m_TrackerFrames, std::vector<igsioTransformName>(1, transformName)) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Cannot compute tracker position metric, failed to read " << transformName.GetTransformName() << " from the tracker frames");
+    return PLUS_FAIL;
+  }
+  const std::vector<double>& timestamps = columns.GetTimestamps();
+  const std::vector<PlusTrackedFrameColumns::Matrix>& probeToReferenceMatrices = columns.GetMatrices(0);
+  const std::vector<ToolStatus>& probeToReferenceStatuses = columns.GetStatuses(0);
+
+  PlusTrackedFrameColumns::Matrix pivotToReferenceMatrix;
   itk::Point<double, 3> stylusTip;
   stylusTip[0] = stylusTip[1] = stylusTip[2] = 0.0;
   itk::Point<double, 3> zeroRef;
@@ -101,48 +112,42 @@ PlusStatus vtkPlusReadTrackedSignals::ComputeTrackerPositionMetric()
   int numberOfValidFrames = 0;
   bool signalTimeRangeDefined = (m_SignalTimeRangeMin <= m_SignalTimeRangeMax);
   double previousStylusTipPosition = 0.0;
-  for (unsigned int frame = 0; frame < m_TrackerFrames->GetNumberOfTrackedFrames(); ++frame)
+  for (unsigned int frame = 0; frame < columns.GetNumberOfFrames(); ++frame)
   {
-    igsioTrackedFrame* trackedFrame = m_TrackerFrames->GetTrackedFrame(frame);
-
-    if (signalTimeRangeDefined && (trackedFrame->GetTimestamp() < m_SignalTimeRangeMin || trackedFrame->GetTimestamp() > m_SignalTimeRangeMax))
+    if (signalTimeRangeDefined && (timestamps[frame] < m_SignalTimeRangeMin || timestamps[frame] > m_SignalTimeRangeMax))
     {
       // frame is out of the specified signal range
       continue;
     }
 
-    transformRepository->SetTransforms(*trackedFrame);
-
-    vtkSmartPointer<vtkMatrix4x4> probeToReferenceTransform = vtkSmartPointer<vtkMatrix4x4>::New();
-    ToolStatus toolStatus(TOOL_INVALID);
-    transformRepository->GetTransform(transformName, probeToReferenceTransform, &toolStatus);
-    if (toolStatus != TOOL_OK)
+    if (probeToReferenceStatuses[frame] != TOOL_OK)
     {
       // There is no available transform for this frame; skip that frame
-      LOG_INFO("There is no available transform for this frame; skip frame " << trackedFrame->GetTimestamp() << " [s]")
+      LOG_INFO("There is no available transform for this frame; skip frame " << timestamps[frame] << " [s]")
       continue;
     }
 
-    //  Store current tracker position
+    //  Store current tracker position (translation column of the matrix)
+    const PlusTrackedFrameColumns::Matrix& probeToReferenceMatrix = probeToReferenceMatrices[frame];
     itk::Point<double, 3> currTrackerPosition;
-    currTrackerPosition[0] = probeToReferenceTransform->GetElement(0, 3);
-    currTrackerPosition[1] = probeToReferenceTransform->GetElement(1, 3);
-    currTrackerPosition[2] = probeToReferenceTransform->GetElement(2, 3);
+    currTrackerPosition[0] = probeToReferenceMatrix[3];
+    currTrackerPosition[1] = probeToReferenceMatrix[7];
+    currTrackerPosition[2] = probeToReferenceMatrix[11];
     trackerPositions.push_back(currTrackerPosition);
 
     // Add current tracker position to the running total
-    trackerPositionSum[0] = trackerPositionSum[0] + probeToReferenceTransform->GetElement(0, 3);
-    trackerPositionSum[1] = trackerPositionSum[1] + probeToReferenceTransform->GetElement(1, 3);
-    trackerPositionSum[2] = trackerPositionSum[2] + probeToReferenceTransform->GetElement(2, 3);
+    trackerPositionSum[0] = trackerPositionSum[0] + currTrackerPosition[0];
+    trackerPositionSum[1] = trackerPositionSum[1] + currTrackerPosition[1];
+    trackerPositionSum[2] = trackerPositionSum[2] + currTrackerPosition[2];
     ++numberOfValidFrames;
 
-    m_SignalTimestamps.push_back(trackedFrame->GetTimestamp());   // These timestamps will be in the desired time range
+    m_SignalTimestamps.push_back(timestamps[frame]);   // These timestamps will be in the desired time range
     m_SignalStylusRef.push_back(currTrackerPosition.EuclideanDistanceTo(zeroRef));
 
-    vtkMatrix4x4::Multiply4x4(probeToReferenceTransform, this->StylusTipToStylusTransform, pivotToReferenceTransform);
-    stylusTip[0] = pivotToReferenceTransform->GetElement(0, 3);
-    stylusTip[1] = pivotToReferenceTransform->GetElement(1, 3);
-    stylusTip[2] = pivotToReferenceTransform->GetElement(2, 3);
+    vtkMatrix4x4::Multiply4x4(probeToReferenceMatrix.data(), &this->StylusTipToStylusTransform->Element[0][0], pivotToReferenceMatrix.data());
+    stylusTip[0] = pivotToReferenceMatrix[3];
+    stylusTip[1] = pivotToReferenceMatrix[7];
+    stylusTip[2] = pivotToReferenceMatrix[11];
 
     m_SignalStylusTipRef.push_back(stylusTip.EuclideanDistanceTo(zeroRef));
     m_SignalStylusTipSpeed.push_back(stylusTip.EuclideanDistanceTo(zeroRef) - previousStylusTipPosition);
@@ -6,9 +6,18 @@ See License.txt for details.
 
 #include "PlusConfigure.h"
 
+#include "PlusWorkerPool.h"
 #include "PointObservationBuffer.h"
 #include "igsioCommon.h"
 
+#include <algorithm>
+
+namespace
+{
+  // Number of cumulative moments stored for each observation: x, y, z, xx, xy, xz, yy, yz, zz
+  const int NUMBER_OF_MOMENTS = 9;
+}
+
 PointObservationBuffer::PointObservationBuffer()
 {
 }
@@ -117,12 +126,12 @@ vnl_matrix<double>* PointObservationBuffer::TranslationalRegistration( std::vect
 LinearObject* PointObservationBuffer::LeastSquaresLinearObject( int dof )
 {
   std::vector<double> centroid = this->CalculateCentroid();
-  vnl_matrix<double>* cov = this->CovarianceMatrix( centroid );
+  vnl_matrix<double> cov = this->CovarianceMatrix( centroid );
 
   //Calculate the eigenvectors of the covariance matrix
   vnl_matrix<double> eigenvectors( PointObservation::SIZE, PointObservation::SIZE, 0.0 );
   vnl_vector<double> eigenvalues( PointObservation::SIZE, 0.0 );
-  vnl_symmetric_eigensystem_compute( *cov, eigenvectors, eigenvalues );
+  vnl_symmetric_eigensystem_compute( cov, eigenvectors, eigenvalues );
   // Note: eigenvectors are ordered in increasing eigenvalue ( 0 = smallest, end = biggest )
 
   // Grab only the most important eigenvectors
@@ -165,10 +174,10 @@ LinearObject* PointObservationBuffer::LeastSquaresLinearObject( int dof )
 
 void PointObservationBuffer::Filter( LinearObject* object, int filterWidth )
 {
-  const int THRESHOLD = 1e-3; // Deal with the case of very little noise
+  const double THRESHOLD = 1e-3; // Deal with the case of very little noise
   bool changed = true;
 
-  while ( changed )
+  while ( changed && this->Size() > 0 )
   {
     std::vector<double> distances( this->Size(), 0 );
     double meanDistance = 0;
@@ -212,6 +221,36 @@ void PointObservationBuffer::Filter( LinearObject* object, int filterWidth )
 
 //-----------------------------------------------------------------------------
 
+std::vector<LinearObject*> PointObservationBuffer::FitLinearObjects( const std::vector<PointObservationBuffer*>& buffers, const std::vector<int>& dof, int filterWidth )
+{
+  std::vector<LinearObject*> objects( buffers.size(), NULL );
+  const int numberOfObjects = std::min( buffers.size(), dof.size() );
+
+  // Each task only changes the observation list of its own buffer, the observations themselves are only read
+  PlusWorkerPool::GetInstance().ParallelFor( 0, numberOfObjects, 0, [&]( int firstObject, int lastObject )
+  {
+    for ( int i = firstObject; i < lastObject; i++ )
+    {
+      if ( buffers.at( i ) == NULL || buffers.at( i )->Size() == 0 )
+      {
+        continue;
+      }
+      LinearObject* object = buffers.at( i )->LeastSquaresLinearObject( dof.at( i ) );
+      if ( object != NULL && filterWidth > 0 )
+      {
+        buffers.at( i )->Filter( object, filterWidth );
+        delete object;
+        object = ( buffers.at( i )->Size() > 0 ? buffers.at( i )->LeastSquaresLinearObject( dof.at( i ) ) : NULL );
+      }
+      objects.at( i ) = object;
+    }
+  } );
+
+  return objects;
+}
+
+//-----------------------------------------------------------------------------
+
 std::string PointObservationBuffer::ToXMLString() const
 {
   std::ostringstream xmlstring;
@@ -247,41 +286,39 @@ void PointObservationBuffer::FromXMLElement( vtkXMLDataElement* element )
 
 //-----------------------------------------------------------------------------
 
-vnl_matrix<double>* PointObservationBuffer::CovarianceMatrix( std::vector<double> centroid )
+vnl_matrix<double> PointObservationBuffer::CovarianceMatrix( const std::vector<double>& centroid )
 {
-  // Construct a buffer for the zero mean data; initialize covariance matrix
-  PointObservationBuffer* zeroMeanBuffer = new PointObservationBuffer();
-  vnl_matrix<double>* cov = new vnl_matrix<double>( PointObservation::SIZE, PointObservation::SIZE );
-  cov->fill( 0.0 );
+  vnl_matrix<double> cov( PointObservation::SIZE, PointObservation::SIZE, 0.0 );
 
-  // Subtract the mean from each observation
+  // Accumulate the products of the zero mean data in a single pass
   for ( unsigned int i = 0; i < this->Size(); i++ )
   {
-    PointObservation* newObservation = new PointObservation();
-    for( int d = 0; d < PointObservation::SIZE; d++ )
+    const std::vector<double>& observation = this->GetObservation( i )->Observation;
+    double zeroMean[ PointObservation::SIZE ];
+    for ( int d = 0; d < PointObservation::SIZE; d++ )
     {
-      newObservation->Observation.push_back( this->GetObservation( i )->Observation.at( d ) - centroid.at( d ) );
+      zeroMean[ d ] = observation.at( d ) - centroid.at( d );
+    }
+    for ( int d1 = 0; d1 < PointObservation::SIZE; d1++ )
+    {
+      for ( int d2 = d1; d2 < PointObservation::SIZE; d2++ )
+      {
+        cov( d1, d2 ) += zeroMean[ d1 ] * zeroMean[ d2 ];
+      }
     }
-    zeroMeanBuffer->AddObservation( newObservation );
   }
 
-  // Pick two dimensions, and find their covariance
+  // Divide by the number of records, the lower triangle is the same as the upper
   for ( int d1 = 0; d1 < PointObservation::SIZE; d1++ )
   {
-    for ( int d2 = 0; d2 < PointObservation::SIZE; d2++ )
+    for ( int d2 = d1; d2 < PointObservation::SIZE; d2++ )
     {
-      // Iterate over all times
-      for ( unsigned int i = 0; i < this->Size(); i++ )
-      {
-        cov->put( d1, d2, cov->get( d1, d2 ) + zeroMeanBuffer->GetObservation( i )->Observation.at( d1 ) * zeroMeanBuffer->GetObservation( i )->Observation.at( d2 ) );
-      }
-      // Divide by the number of records
-      cov->put( d1, d2, cov->get( d1, d2 ) / this->Size() );
+      cov( d1, d2 ) = cov( d1, d2 ) / this->Size();
+      cov( d2, d1 ) = cov( d1, d2 );
     }
   }
 
   return cov;
-
 }
 
 //-----------------------------------------------------------------------------
@@ -310,46 +347,71 @@ std::vector<double> PointObservationBuffer::CalculateCentroid()
 std::vector<PointObservationBuffer*> PointObservationBuffer::ExtractLinearObjects( int collectionFrames, double extractionThreshold, std::vector<int>* dof )
 {
   // First, let us identify the segmentation points and the associated DOFs, then we can divide up the points
-  int TEST_INTERVAL = 21;
+  const int TEST_INTERVAL = 21;
 
-  PointObservationBuffer* eigenBuffer = new PointObservationBuffer(); // Note: 1 < 2 < 3
-  int currStartIndex, currEndIndex;
+  int currStartIndex = 0, currEndIndex = 0;
   bool collecting = false;
 
   std::vector<PointObservationBuffer*> linearObjects;
-
-  // Note: i is the start of the interval over which we will exam for linearity
-  for ( unsigned int i = 0; i < this->Size() - TEST_INTERVAL; i++ )
+  if ( this->Size() <= static_cast<unsigned int>( TEST_INTERVAL ) )
+  {
+    return linearObjects;
+  }
+  const int numberOfObservations = this->Size();
+  const int numberOfIntervals = numberOfObservations - TEST_INTERVAL;
+
+  // Index of the cumulative first and second moments of the observations, so that the covariance of any interval is
+  // computed in constant time instead of a pass over its points. The moments are relative to the first observation to
+  // limit the cancellation error of the subtractions.
+  const std::vector<double> origin = this->GetObservation( 0 )->Observation;
+  std::vector<double> cumulativeMoments( ( numberOfObservations + 1 ) * NUMBER_OF_MOMENTS, 0.0 );
+  for ( int i = 0; i < numberOfObservations; i++ )
   {
-    // Create a smaller point observation buffer to work with at each iteration with the points of interest
-    PointObservationBuffer* tempBuffer = new PointObservationBuffer();
-    for ( unsigned int j = i; j < i + TEST_INTERVAL; j++ )
+    const std::vector<double>& observation = this->GetObservation( i )->Observation;
+    const double x = observation.at( 0 ) - origin.at( 0 );
+    const double y = observation.at( 1 ) - origin.at( 1 );
+    const double z = observation.at( 2 ) - origin.at( 2 );
+    const double moments[ NUMBER_OF_MOMENTS ] = { x, y, z, x * x, x * y, x * z, y * y, y * z, z * z };
+    const double* previous = &cumulativeMoments[ i * NUMBER_OF_MOMENTS ];
+    double* current = &cumulativeMoments[ ( i + 1 ) * NUMBER_OF_MOMENTS ];
+    for ( int m = 0; m < NUMBER_OF_MOMENTS; m++ )
     {
-      tempBuffer->AddObservation( this->GetObservation( j ) );
+      current[ m ] = previous[ m ] + moments[ m ];
     }
+  }
 
-    // Find the eigenvalues of covariance matrix
-    std::vector<double> centroid = tempBuffer->CalculateCentroid();
-    vnl_matrix<double>* cov = tempBuffer->CovarianceMatrix( centroid );
-
-    //Calculate the eigenvectors of the covariance matrix
-    vnl_matrix<double> eigenvectors( PointObservation::SIZE, PointObservation::SIZE, 0.0 );
-    vnl_vector<double> eigenvalues( PointObservation::SIZE, 0.0 );
-    vnl_symmetric_eigensystem_compute( *cov, eigenvectors, eigenvalues );
-    // Note: eigenvectors are ordered in increasing eigenvalue ( 0 = smallest, end = biggest )
-
-    std::vector<double> eigen( 3, 0.0 );
-    eigen.at( 0 ) = eigenvalues.get( 0 );
-    eigen.at( 1 ) = eigenvalues.get( 1 );
-    eigen.at( 2 ) = eigenvalues.get( 2 );
-    eigenBuffer->AddObservation( new PointObservation( eigen ) );
+  // Eigenvalues of the covariance matrix of each interval ( 0 = smallest, end = biggest ).
+  // The intervals are independent, so they are computed in parallel.
+  std::vector<double> eigenvalues( numberOfIntervals * PointObservation::SIZE, 0.0 );
+  PlusWorkerPool::GetInstance().ParallelFor( 0, numberOfIntervals, 0, [&]( int firstInterval, int lastInterval )
+  {
+    for ( int i = firstInterval; i < lastInterval; i++ )
+    {
+      const double* start = &cumulativeMoments[ i * NUMBER_OF_MOMENTS ];
+      const double* end = &cumulativeMoments[ ( i + TEST_INTERVAL ) * NUMBER_OF_MOMENTS ];
+      double mean[ NUMBER_OF_MOMENTS ];
+      for ( int m = 0; m < NUMBER_OF_MOMENTS; m++ )
+      {
+        mean[ m ] = ( end[ m ] - start[ m ] ) / TEST_INTERVAL;
+      }
+      double* intervalEigenvalues = &eigenvalues[ i * PointObservation::SIZE ];
+      vnl_symmetric_eigensystem_compute_eigenvals(
+        mean[ 3 ] - mean[ 0 ] * mean[ 0 ], mean[ 4 ] - mean[ 0 ] * mean[ 1 ], mean[ 5 ] - mean[ 0 ] * mean[ 2 ],
+        mean[ 6 ] - mean[ 1 ] * mean[ 1 ], mean[ 7 ] - mean[ 1 ] * mean[ 2 ],
+        mean[ 8 ] - mean[ 2 ] * mean[ 2 ],
+        intervalEigenvalues[ 0 ], intervalEigenvalues[ 1 ], intervalEigenvalues[ 2 ] );
+    }
+  } );
 
+  // Note: i is the start of the interval over which we will exam for linearity
+  for ( int i = 0; i < numberOfIntervals; i++ )
+  {
     if ( !collecting )
     {
       currStartIndex = i;
     }
 
-    if ( eigenvalues.get( 0 ) < extractionThreshold )
+    if ( eigenvalues[ i * PointObservation::SIZE ] < extractionThreshold )
     {
       collecting = true;
       continue;
@@ -373,7 +435,7 @@ std::vector<PointObservationBuffer*> PointObservationBuffer::ExtractLinearObject
       dofInterval.push_back( currStartIndex );
       for ( int j = currStartIndex; j < currEndIndex; j++ )
       {
-        if ( eigenBuffer->GetObservation( j )->Observation.at( e ) > extractionThreshold )
+        if ( eigenvalues[ j * PointObservation::SIZE + e ] > extractionThreshold )
         {
           dofInterval.push_back( j );
         }
@@ -46,6 +46,11 @@ public:
   LinearObject* LeastSquaresLinearObject( int dof );
   void Filter( LinearObject* object, int filterWidth );
 
+  // Fit a linear object with the given degrees of freedom to each buffer. If filterWidth is positive then the outliers
+  // are filtered and the object is fitted again. The buffers are independent, so they are fitted in parallel.
+  // The caller owns the returned objects, the object of an empty buffer is NULL.
+  static std::vector<LinearObject*> FitLinearObjects( const std::vector<PointObservationBuffer*>& buffers, const std::vector<int>& dof, int filterWidth );
+
   vnl_matrix<double>* SphericalRegistration( PointObservationBuffer* fromPoints );
   vnl_matrix<double>* TranslationalRegistration( std::vector<double> toCentroid, std::vector<double> fromCentroid, vnl_matrix<double>* rotation );
 
@@ -56,7 +61,7 @@ public:
 
 private:
   std::vector<double> CalculateCentroid();
-  vnl_matrix<double>* CovarianceMatrix( std::vector<double> centroid );
+  vnl_matrix<double> CovarianceMatrix( const std::vector<double>& centroid );
 
 };
 
@@ -16,6 +16,14 @@
 #include "vtkMath.h"
 #include "vtksys/SystemTools.hxx"
 
+#include "vnl/algo/vnl_svd.h"
+
+namespace
+{
+  const int DEFAULT_INCREMENTAL_REWEIGHTING_INTERVAL = 100;
+  const int MAX_NUMBER_OF_REWEIGHTING_ITERATIONS = 5;
+}
+
 vtkStandardNewMacro(vtkPlusPivotCalibrationAlgo);
 
 //-----------------------------------------------------------------------------
@@ -31,6 +39,14 @@ vtkPlusPivotCalibrationAlgo::vtkPlusPivotCalibrationAlgo()
   this->PivotPointPosition_Reference[1] = 0.0;
   this->PivotPointPosition_Reference[2] = 0.0;
   this->PivotPointPosition_Reference[3] = 1.0;
+
+  this->IncrementalCalibration = false;
+  this->IncrementalReweightingInterval = DEFAULT_INCREMENTAL_REWEIGHTING_INTERVAL;
+  this->IncrementalAtA.set_size(6, 6);
+  this->IncrementalAtb.set_size(6);
+  this->ClearIncrementalNormalEquations();
+  this->IncrementalNumberOfOutliers = 0;
+  this->IncrementalPointsSinceReweighting = 0;
 }
 
 //-----------------------------------------------------------------------------
@@ -49,6 +65,9 @@ void vtkPlusPivotCalibrationAlgo::RemoveAllCalibrationPoints()
   }
   this->MarkerToReferenceTransformMatrixArray.clear();
   this->OutlierIndices.clear();
+  this->ClearIncrementalNormalEquations();
+  this->IncrementalNumberOfOutliers = 0;
+  this->IncrementalPointsSinceReweighting = 0;
 }
 
 //----------------------------------------------------------------------------
@@ -57,9 +76,201 @@ PlusStatus vtkPlusPivotCalibrationAlgo::InsertNextCalibrationPoint(vtkMatrix4x4*
   vtkMatrix4x4* markerToReferenceTransformMatrixCopy = vtkMatrix4x4::New();
   markerToReferenceTransformMatrixCopy->DeepCopy(aMarkerToReferenceTransformMatrix);
   this->MarkerToReferenceTransformMatrixArray.push_back(markerToReferenceTransformMatrixCopy);
+
+  if (this->IncrementalCalibration)
+  {
+    this->AddToIncrementalNormalEquations(markerToReferenceTransformMatrixCopy);
+    this->IncrementalPointsSinceReweighting++;
+    if (this->IncrementalReweightingInterval > 0 && this->IncrementalPointsSinceReweighting >= this->IncrementalReweightingInterval)
+    {
+      if (this->ReweightIncrementalCalibration() != PLUS_SUCCESS)
+      {
+        // The points may not determine the pivot point yet, it is retried after the next interval
+        LOG_DEBUG("Incremental pivot calibration re-weighting is not possible yet");
+      }
+    }
+  }
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+void vtkPlusPivotCalibrationAlgo::ClearIncrementalNormalEquations()
+{
+  this->IncrementalAtA.fill(0);
+  this->IncrementalAtb.fill(0);
+  this->IncrementalBtb = 0;
+  this->IncrementalNumberOfInliers = 0;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusPivotCalibrationAlgo::AddToIncrementalNormalEquations(vtkMatrix4x4* markerToReferenceTransformMatrix)
+{
+  // Same rows as in GetPivotPointPosition: Ai = [ MarkerToReferenceTransformRotationMatrix | -Identity3x3 ], bi = -MarkerToReferenceTransformTranslationVector
+  double aMatrixRow[6] = { 0 };
+  for (int i = 0; i < 3; i++)
+  {
+    aMatrixRow[0] = markerToReferenceTransformMatrix->Element[i][0];
+    aMatrixRow[1] = markerToReferenceTransformMatrix->Element[i][1];
+    aMatrixRow[2] = markerToReferenceTransformMatrix->Element[i][2];
+    aMatrixRow[3] = (i == 0 ? -1 : 0);
+    aMatrixRow[4] = (i == 1 ? -1 : 0);
+    aMatrixRow[5] = (i == 2 ? -1 : 0);
+    double b = -markerToReferenceTransformMatrix->Element[i][3];
+    for (int row = 0; row < 6; row++)
+    {
+      for (int column = 0; column < 6; column++)
+      {
+        this->IncrementalAtA(row, column) += aMatrixRow[row] * aMatrixRow[column];
+      }
+      this->IncrementalAtb(row) += aMatrixRow[row] * b;
+    }
+    this->IncrementalBtb += b * b;
+  }
+  this->IncrementalNumberOfInliers++;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusPivotCalibrationAlgo::SolveIncrementalNormalEquations(vnl_vector<double>& xVector)
+{
+  if (this->IncrementalNumberOfInliers < 2)
+  {
+    return PLUS_FAIL;
+  }
+  vnl_svd<double> svd(this->IncrementalAtA);
+  if (svd.rank() < 6)
+  {
+    // The marker has not been rotated enough yet
+    return PLUS_FAIL;
+  }
+  xVector = svd.solve(this->IncrementalAtb);
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+double vtkPlusPivotCalibrationAlgo::GetPivotPointResidual(vtkMatrix4x4* markerToReferenceTransformMatrix, const vnl_vector<double>& xVector)
+{
+  double residual2 = 0;
+  for (int i = 0; i < 3; i++)
+  {
+    double pivotPointDifference_Reference = markerToReferenceTransformMatrix->Element[i][0] * xVector[0]
+                                            + markerToReferenceTransformMatrix->Element[i][1] * xVector[1]
+                                            + markerToReferenceTransformMatrix->Element[i][2] * xVector[2]
+                                            + markerToReferenceTransformMatrix->Element[i][3] - xVector[3 + i];
+    residual2 += pivotPointDifference_Reference * pivotPointDifference_Reference;
+  }
+  return sqrt(residual2);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusPivotCalibrationAlgo::ReweightIncrementalCalibration()
+{
+  this->IncrementalPointsSinceReweighting = 0;
+
+  // Start from all the points, so that points that were rejected earlier can become inliers again
+  this->ClearIncrementalNormalEquations();
+  for (std::list< vtkMatrix4x4* >::iterator markerToReferenceTransformIt = this->MarkerToReferenceTransformMatrixArray.begin();
+       markerToReferenceTransformIt != this->MarkerToReferenceTransformMatrixArray.end(); ++markerToReferenceTransformIt)
+  {
+    this->AddToIncrementalNormalEquations(*markerToReferenceTransformIt);
+  }
+  this->IncrementalNumberOfOutliers = 0;
+
+  std::vector<double> residuals(this->MarkerToReferenceTransformMatrixArray.size(), 0.0);
+  std::vector<bool> inliers(this->MarkerToReferenceTransformMatrixArray.size(), true);
+  for (int iteration = 0; iteration < MAX_NUMBER_OF_REWEIGHTING_ITERATIONS; iteration++)
+  {
+    vnl_vector<double> xVector(6, 0);
+    if (this->SolveIncrementalNormalEquations(xVector) != PLUS_SUCCESS)
+    {
+      return PLUS_FAIL;
+    }
+
+    // Points that have larger than 3x error than the standard deviation of the inlier errors are outliers
+    std::vector<double> inlierResiduals;
+    unsigned int pointIndex = 0;
+    for (std::list< vtkMatrix4x4* >::iterator markerToReferenceTransformIt = this->MarkerToReferenceTransformMatrixArray.begin();
+         markerToReferenceTransformIt != this->MarkerToReferenceTransformMatrixArray.end(); ++markerToReferenceTransformIt, ++pointIndex)
+    {
+      residuals[pointIndex] = GetPivotPointResidual(*markerToReferenceTransformIt, xVector);
+      if (inliers[pointIndex])
+      {
+        inlierResiduals.push_back(residuals[pointIndex]);
+      }
+    }
+    double mean = 0;
+    double stdev = 0;
+    igsioMath::ComputeMeanAndStdev(inlierResiduals, mean, stdev);
+    double outlierThreshold = mean + 3.0 * stdev;
+
+    bool inliersChanged = false;
+    int numberOfOutliers = 0;
+    for (pointIndex = 0; pointIndex < residuals.size(); pointIndex++)
+    {
+      bool inlier = (residuals[pointIndex] <= outlierThreshold);
+      inliersChanged |= (inlier != inliers[pointIndex]);
+      inliers[pointIndex] = inlier;
+      numberOfOutliers += (inlier ? 0 : 1);
+    }
+    if (!inliersChanged)
+    {
+      break;
+    }
+
+    // Rebuild the normal equations from the inliers
+    this->ClearIncrementalNormalEquations();
+    pointIndex = 0;
+    for (std::list< vtkMatrix4x4* >::iterator markerToReferenceTransformIt = this->MarkerToReferenceTransformMatrixArray.begin();
+         markerToReferenceTransformIt != this->MarkerToReferenceTransformMatrixArray.end(); ++markerToReferenceTransformIt, ++pointIndex)
+    {
+      if (inliers[pointIndex])
+      {
+        this->AddToIncrementalNormalEquations(*markerToReferenceTransformIt);
+      }
+    }
+    this->IncrementalNumberOfOutliers = numberOfOutliers;
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusPivotCalibrationAlgo::GetIncrementalPivotPointToMarkerTranslation(double pivotPoint_Marker[3])
+{
+  if (!this->IncrementalCalibration)
+  {
+    LOG_ERROR("Incremental pivot calibration is not enabled");
+    return PLUS_FAIL;
+  }
+  vnl_vector<double> xVector(6, 0);
+  if (this->SolveIncrementalNormalEquations(xVector) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  pivotPoint_Marker[0] = xVector[0];
+  pivotPoint_Marker[1] = xVector[1];
+  pivotPoint_Marker[2] = xVector[2];
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+double vtkPlusPivotCalibrationAlgo::GetIncrementalCalibrationError()
+{
+  vnl_vector<double> xVector(6, 0);
+  if (!this->IncrementalCalibration || this->SolveIncrementalNormalEquations(xVector) != PLUS_SUCCESS)
+  {
+    return -1.0;
+  }
+  // Sum of squared residuals: |A*x-b|^2 = x^T*(A^T*A)*x - 2*x^T*(A^T*b) + b^T*b
+  double sumOfSquaredResiduals = dot_product(xVector, this->IncrementalAtA * xVector) - 2.0 * dot_product(xVector, this->IncrementalAtb) + this->IncrementalBtb;
+  return sqrt((std::max)(sumOfSquaredResiduals, 0.0) / this->IncrementalNumberOfInliers);
+}
+
+//----------------------------------------------------------------------------
+int vtkPlusPivotCalibrationAlgo::GetNumberOfIncrementalOutliers()
+{
+  return this->IncrementalNumberOfOutliers;
+}
+
 //----------------------------------------------------------------------------
 /*
 In homogeneous coordinates:
@@ -282,6 +493,8 @@ PlusStatus vtkPlusPivotCalibrationAlgo::ReadConfiguration(vtkXMLDataElement* aCo
   XML_READ_CSTRING_ATTRIBUTE_REQUIRED(ObjectMarkerCoordinateFrame, pivotCalibrationElement);
   XML_READ_CSTRING_ATTRIBUTE_REQUIRED(ReferenceCoordinateFrame, pivotCalibrationElement);
   XML_READ_CSTRING_ATTRIBUTE_REQUIRED(ObjectPivotPointCoordinateFrame, pivotCalibrationElement);
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(IncrementalCalibration, pivotCalibrationElement);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, IncrementalReweightingInterval, pivotCalibrationElement);
   return PLUS_SUCCESS;
 }
 
@@ -15,6 +15,10 @@ See License.txt for details.
 #include <vtkObject.h>
 #include <vtkMatrix4x4.h>
 
+// VNL includes
+#include <vnl/vnl_matrix.h>
+#include <vnl/vnl_vector.h>
+
 // STL includes
 #include <list>
 #include <set>
@@ -40,6 +44,10 @@ class vtkXMLDataElement;
   The method detects outlier points (points that have larger than 3x error than the standard deviation) and ignores them when computing the pivot point
   coordinates and the calibration error.
 
+  In incremental mode the normal equations of the problem are updated with each inserted point, so that the current pivot point
+  and calibration error can be displayed while the points are acquired, at the rate of the tracker. Outliers are rejected by
+  periodically re-weighting all the points.
+
   \ingroup PlusLibCalibrationAlgorithm
 */
 class vtkPlusCalibrationExport vtkPlusPivotCalibrationAlgo : public vtkObject
@@ -86,6 +94,28 @@ public:
   */
   int GetNumberOfDetectedOutliers();
 
+  /*!
+    Get the pivot point position in the marker coordinate system, computed by the incremental calibration from the points inserted so far.
+    Fails if the incremental calibration is not enabled or the inserted points do not determine the pivot point yet
+    (e.g., the marker has not been rotated enough).
+  */
+  PlusStatus GetIncrementalPivotPointToMarkerTranslation(double pivotPoint_Marker[3]);
+
+  /*!
+    Get the root mean square distance (in mm) between the pivot point positions computed from each inlier point and
+    the pivot point position computed by the incremental calibration. Returns -1 if it is not available.
+  */
+  double GetIncrementalCalibrationError();
+
+  /*! Get the number of points that were found to be outliers by the latest re-weighting of the incremental calibration */
+  int GetNumberOfIncrementalOutliers();
+
+  /*!
+    Detect outliers using the current incremental solution and recompute the normal equations from the inlier points.
+    It is called automatically once in every IncrementalReweightingInterval inserted points. It processes all inserted points.
+  */
+  PlusStatus ReweightIncrementalCalibration();
+
 public:
   vtkGetMacro(CalibrationError, double);
   vtkGetObjectMacro(PivotPointToMarkerTransformMatrix, vtkMatrix4x4);
@@ -94,6 +124,18 @@ public:
   vtkGetStringMacro(ReferenceCoordinateFrame);
   vtkGetStringMacro(ObjectPivotPointCoordinateFrame);
 
+  /*!
+    If enabled then each inserted calibration point updates the normal equations of the pivot point problem (see GetIncrementalPivotPointToMarkerTranslation).
+    DoPivotCalibration still computes the final result from all the points. Should be set before inserting calibration points.
+  */
+  vtkSetMacro(IncrementalCalibration, bool);
+  vtkGetMacro(IncrementalCalibration, bool);
+  vtkBooleanMacro(IncrementalCalibration, bool);
+
+  /*! Number of inserted points between automatic re-weightings of the incremental calibration (0 = re-weighting only by calling ReweightIncrementalCalibration) */
+  vtkSetMacro(IncrementalReweightingInterval, int);
+  vtkGetMacro(IncrementalReweightingInterval, int);
+
 protected:
   vtkSetObjectMacro(PivotPointToMarkerTransformMatrix, vtkMatrix4x4);
   vtkSetStringMacro(ObjectMarkerCoordinateFrame);
@@ -110,6 +152,18 @@ protected:
 
   PlusStatus GetPivotPointPosition(double* pivotPoint_Marker, double* pivotPoint_Reference);
 
+  /*! Add the equations of a calibration point to the normal equations of the incremental calibration */
+  void AddToIncrementalNormalEquations(vtkMatrix4x4* markerToReferenceTransformMatrix);
+
+  /*! Clear the normal equations of the incremental calibration */
+  void ClearIncrementalNormalEquations();
+
+  /*! Solve the normal equations of the incremental calibration, the result is [ PivotPoint_Marker | PivotPoint_Reference ] */
+  PlusStatus SolveIncrementalNormalEquations(vnl_vector<double>& xVector);
+
+  /*! Distance between the pivot point position computed from a calibration point and the pivot point position in the reference coordinate system */
+  static double GetPivotPointResidual(vtkMatrix4x4* markerToReferenceTransformMatrix, const vnl_vector<double>& xVector);
+
 protected:
   /*! Pivot point to marker transform (eg. stylus tip to stylus) - the result of the calibration */
   vtkMatrix4x4*             PivotPointToMarkerTransformMatrix;
@@ -134,6 +188,26 @@ protected:
 
   /*! List of outlier sample indices */
   std::set<unsigned int>    OutlierIndices;
+
+  /*! Update the normal equations with each inserted point */
+  bool                      IncrementalCalibration;
+
+  /*! Number of inserted points between automatic re-weightings of the incremental calibration */
+  int                       IncrementalReweightingInterval;
+
+  /*! Normal equations of the inlier points of the incremental calibration: A^T*A (6x6), A^T*b (6) and b^T*b */
+  vnl_matrix<double>        IncrementalAtA;
+  vnl_vector<double>        IncrementalAtb;
+  double                    IncrementalBtb;
+
+  /*! Number of points in the normal equations of the incremental calibration */
+  int                       IncrementalNumberOfInliers;
+
+  /*! Number of points that were found to be outliers by the latest re-weighting */
+  int                       IncrementalNumberOfOutliers;
+
+  /*! Number of points inserted since the latest re-weighting */
+  int                       IncrementalPointsSinceReweighting;
 };
 
 #endif
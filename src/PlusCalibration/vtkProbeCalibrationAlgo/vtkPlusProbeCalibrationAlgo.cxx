@@ -16,6 +16,7 @@ See License.txt for details.
 
 #include "PlusMath.h"
 #include "PlusFidPatternRecognitionCommon.h"
+#include "PlusWorkerPool.h"
 
 #include "vtkObjectFactory.h"
 #include "vtkMatrix4x4.h"
@@ -1145,6 +1146,134 @@ void vtkPlusProbeCalibrationAlgo::ComputeError3d(const vnl_matrix_fixed<double,
   igsioMath::ComputeRms(reprojectionErrors, errorRms);
 }
 
+//--------------------------------------------------------------------------------
+void vtkPlusProbeCalibrationAlgo::ComputeResiduals2d(const vnl_matrix_fixed<double, 4, 4>& imageToProbeMatrix, std::vector<double>& residuals, std::vector<double>* jacobian /*=NULL*/)
+{
+  const std::vector<NWirePositionType>& framePositions = this->PreProcessedWirePositions[CALIBRATION_NOT_OUTLIER].FramePositions;
+  const int numberOfFrames = framePositions.size();
+  const int numberOfPointsPerFrame = 3 * this->NWires.size();
+  residuals.assign(2 * numberOfFrames * numberOfPointsPerFrame, 0.0);
+  if (jacobian != NULL)
+  {
+    jacobian->assign(residuals.size() * NUMBER_OF_RESIDUAL_DERIVATIVES, 0.0);
+  }
+  if (residuals.empty())
+  {
+    return;
+  }
+  double* residualData = &residuals[0];
+  double* jacobianData = (jacobian != NULL ? &(*jacobian)[0] : NULL);
+
+  // Derivative of the inverse matrix: d(M^-1) = -M^-1 * dM * M^-1, therefore the derivative of a point p_Image = probeToImage * p_Probe
+  // with respect to the element (row, column) of the image to probe matrix is -probeToImage.column(row) * p_Image[column]
+  const vnl_matrix_fixed<double, 4, 4> probeToImageMatrix = vnl_inverse(imageToProbeMatrix);
+  const std::vector<PlusNWire>& nWires = this->NWires;
+
+  PlusWorkerPool::GetInstance().ParallelFor(0, numberOfFrames, 0, [&](int firstFrameIndex, int lastFrameIndex)
+  {
+    for (int frameIndex = firstFrameIndex; frameIndex < lastFrameIndex; frameIndex++)
+    {
+      const NWirePositionType& framePosition = framePositions[frameIndex];
+      const vnl_matrix_fixed<double, 4, 4> phantomToImageMatrix = probeToImageMatrix * vnl_inverse(framePosition.ProbeToPhantomTransform);
+      for (int pointIndex = 0; pointIndex < numberOfPointsPerFrame; pointIndex++)
+      {
+        const PlusFidWire& wire = nWires[pointIndex / 3].GetWires()[pointIndex % 3];
+        const vnl_vector_fixed<double, 4> front_Image = phantomToImageMatrix * vnl_vector_fixed<double, 4>(wire.EndPointFront[0], wire.EndPointFront[1], wire.EndPointFront[2], 1.0);
+        const vnl_vector_fixed<double, 4> back_Image = phantomToImageMatrix * vnl_vector_fixed<double, 4>(wire.EndPointBack[0], wire.EndPointBack[1], wire.EndPointBack[2], 1.0);
+
+        // Intersection of the wire and the image plane (z=0): front + t * (back - front)
+        const double zDifference = front_Image[2] - back_Image[2];
+        if (fabs(zDifference) < 1e-6)
+        {
+          LOG_WARNING("Image plane and wire are parallel!");
+          continue;
+        }
+        const double t = front_Image[2] / zDifference;
+        const double intersection_Image[2] =
+        {
+          front_Image[0] + t * (back_Image[0] - front_Image[0]),
+          front_Image[1] + t * (back_Image[1] - front_Image[1])
+        };
+
+        const int residualIndex = 2 * (frameIndex * numberOfPointsPerFrame + pointIndex);
+        const vnl_vector_fixed<double, 4>& segmentedPoint_Image = framePosition.AllWiresIntersectionPointsPos_Image[pointIndex];
+        residualData[residualIndex] = segmentedPoint_Image[0] - intersection_Image[0];
+        residualData[residualIndex + 1] = segmentedPoint_Image[1] - intersection_Image[1];
+
+        if (jacobianData == NULL)
+        {
+          continue;
+        }
+        double* xDerivatives = jacobianData + residualIndex * NUMBER_OF_RESIDUAL_DERIVATIVES;
+        double* yDerivatives = xDerivatives + NUMBER_OF_RESIDUAL_DERIVATIVES;
+        for (int row = 0; row < 3; row++)
+        {
+          for (int column = 0; column < 4; column++)
+          {
+            double frontDerivative[3];
+            double backDerivative[3];
+            for (int i = 0; i < 3; i++)
+            {
+              frontDerivative[i] = -probeToImageMatrix(i, row) * front_Image[column];
+              backDerivative[i] = -probeToImageMatrix(i, row) * back_Image[column];
+            }
+            const double tDerivative = (front_Image[2] * backDerivative[2] - back_Image[2] * frontDerivative[2]) / (zDifference * zDifference);
+            const int derivativeIndex = row * 4 + column;
+            xDerivatives[derivativeIndex] = -((1 - t) * frontDerivative[0] + t * backDerivative[0] + tDerivative * (back_Image[0] - front_Image[0]));
+            yDerivatives[derivativeIndex] = -((1 - t) * frontDerivative[1] + t * backDerivative[1] + tDerivative * (back_Image[1] - front_Image[1]));
+          }
+        }
+      }
+    }
+  });
+}
+
+//--------------------------------------------------------------------------------
+void vtkPlusProbeCalibrationAlgo::ComputeResiduals3d(const vnl_matrix_fixed<double, 4, 4>& imageToProbeMatrix, std::vector<double>& residuals, std::vector<double>* jacobian /*=NULL*/)
+{
+  const std::vector<NWirePositionType>& framePositions = this->PreProcessedWirePositions[CALIBRATION_NOT_OUTLIER].FramePositions;
+  const int numberOfFrames = framePositions.size();
+  const int numberOfPointsPerFrame = this->NWires.size();
+  residuals.assign(3 * numberOfFrames * numberOfPointsPerFrame, 0.0);
+  if (jacobian != NULL)
+  {
+    jacobian->assign(residuals.size() * NUMBER_OF_RESIDUAL_DERIVATIVES, 0.0);
+  }
+  if (residuals.empty())
+  {
+    return;
+  }
+  double* residualData = &residuals[0];
+  double* jacobianData = (jacobian != NULL ? &(*jacobian)[0] : NULL);
+
+  PlusWorkerPool::GetInstance().ParallelFor(0, numberOfFrames, 0, [&](int firstFrameIndex, int lastFrameIndex)
+  {
+    for (int frameIndex = firstFrameIndex; frameIndex < lastFrameIndex; frameIndex++)
+    {
+      const NWirePositionType& framePosition = framePositions[frameIndex];
+      for (int nWireIndex = 0; nWireIndex < numberOfPointsPerFrame; nWireIndex++)
+      {
+        const vnl_vector_fixed<double, 4>& segmentedPoint_Image = framePosition.AllWiresIntersectionPointsPos_Image[nWireIndex * 3 + 1];
+        const vnl_vector_fixed<double, 4> pointError = imageToProbeMatrix * segmentedPoint_Image - framePosition.MiddleWireIntersectionPointsPos_Probe[nWireIndex];
+        const int residualIndex = 3 * (frameIndex * numberOfPointsPerFrame + nWireIndex);
+        for (int row = 0; row < 3; row++)
+        {
+          residualData[residualIndex + row] = pointError[row];
+          if (jacobianData != NULL)
+          {
+            // Only the matrix row of the error component affects the error, by the segmented point coordinates
+            double* derivatives = jacobianData + (residualIndex + row) * NUMBER_OF_RESIDUAL_DERIVATIVES;
+            for (int column = 0; column < 4; column++)
+            {
+              derivatives[row * 4 + column] = segmentedPoint_Image[column];
+            }
+          }
+        }
+      }
+    }
+  });
+}
+
 //--------------------------------------------------------------------------------
 double vtkPlusProbeCalibrationAlgo::GetCalibrationReprojectionError3DMean()
 {
@@ -122,6 +122,29 @@ public:
   void ComputeError2d( const vnl_matrix_fixed<double, 4, 4>& imageToProbeMatrix, double& errorMean, double& errorStDev, double& errorRms );
   void ComputeError3d( const vnl_matrix_fixed<double, 4, 4>& imageToProbeMatrix, double& errorMean, double& errorStDev, double& errorRms );
 
+  /*! Number of derivatives of a residual computed by ComputeResiduals2d and ComputeResiduals3d: one for each element of the top 3 rows of the image to probe matrix */
+  static const int NUMBER_OF_RESIDUAL_DERIVATIVES = 12;
+
+  /*!
+    Compute the in-plane reprojection errors of all wire intersection points of the non-outlier calibration data
+    and optionally their derivatives with respect to the elements of the image to probe matrix.
+    Frames are processed in parallel, the order of the results does not depend on the number of threads.
+    \param imageToProbeMatrix Image to probe transform matrix
+    \param residuals Output: X and Y error of each wire intersection point (2 values per point, 0 if the wire is parallel to the image plane)
+    \param jacobian Optional output: NUMBER_OF_RESIDUAL_DERIVATIVES derivatives for each residual, matrix elements in row-major order. Not computed if NULL.
+  */
+  void ComputeResiduals2d( const vnl_matrix_fixed<double, 4, 4>& imageToProbeMatrix, std::vector<double>& residuals, std::vector<double>* jacobian = NULL );
+
+  /*!
+    Compute the out-of-plane reprojection errors of the middle wire intersection points of the non-outlier calibration data
+    and optionally their derivatives with respect to the elements of the image to probe matrix.
+    Frames are processed in parallel, the order of the results does not depend on the number of threads.
+    \param imageToProbeMatrix Image to probe transform matrix
+    \param residuals Output: X, Y and Z error of each middle wire intersection point in the probe frame (3 values per point)
+    \param jacobian Optional output: NUMBER_OF_RESIDUAL_DERIVATIVES derivatives for each residual, matrix elements in row-major order. Not computed if NULL.
+  */
+  void ComputeResiduals3d( const vnl_matrix_fixed<double, 4, 4>& imageToProbeMatrix, std::vector<double>& residuals, std::vector<double>* jacobian = NULL );
+
 protected:
 
   enum PreProcessedWirePositionIdType
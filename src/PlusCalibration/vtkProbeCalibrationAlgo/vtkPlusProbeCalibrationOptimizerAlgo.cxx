@@ -18,36 +18,53 @@ See License.txt for details.
 
 #include "vtksys/SystemTools.hxx"
 
-#include "itkPowellOptimizer.h"
+#include <algorithm>
+
+#include "vtkIGSIOAccurateTimer.h"
+
+#include "itkLevenbergMarquardtOptimizer.h"
 #include "itkScaleVersor3DTransform.h"
 #include "itkSimilarity3DTransform.h"
 
-typedef  itk::PowellOptimizer  OptimizerType;
+typedef  itk::LevenbergMarquardtOptimizer  OptimizerType;
 
 //-----------------------------------------------------------------------------
-class DistanceToWiresCostFunction : public itk::SingleValuedCostFunction 
+/*!
+  Residuals of the wire intersection points as a function of the image to probe transform parameters.
+  The derivatives are computed analytically from the derivatives of the residuals with respect to the matrix elements
+  and the derivatives of the matrix elements with respect to the transform parameters.
+*/
+class DistanceToWiresCostFunction : public itk::MultipleValuedCostFunction 
 {
 public:
 
   typedef DistanceToWiresCostFunction       Self;
-  typedef itk::SingleValuedCostFunction     Superclass;
+  typedef itk::MultipleValuedCostFunction   Superclass;
   typedef itk::SmartPointer<Self>           Pointer;
   typedef itk::SmartPointer<const Self>     ConstPointer;
   itkNewMacro( Self );
-  itkTypeMacro( DistanceToWiresCostFunction, SingleValuedCostFunction );
+  itkTypeMacro( DistanceToWiresCostFunction, MultipleValuedCostFunction );
 
   typedef Superclass::ParametersType              ParametersType;
+  typedef Superclass::MeasureType                 MeasureType;
   typedef Superclass::DerivativeType              DerivativeType;
   typedef itk::VersorRigid3DTransform< double > RigidTransformType;
+  typedef vnl_vector_fixed<double, vtkPlusProbeCalibrationAlgo::NUMBER_OF_RESIDUAL_DERIVATIVES> MatrixDerivativeType;
 
   DistanceToWiresCostFunction()
   : m_CalibrationOptimizer(NULL)
+  , m_NumberOfValues(0)
+  , m_NumberOfValueEvaluations(0)
+  , m_NumberOfDerivativeEvaluations(0)
   {
   }
 
-  DistanceToWiresCostFunction(vtkPlusProbeCalibrationOptimizerAlgo* calibrationOptimizer) 
+  DistanceToWiresCostFunction(vtkPlusProbeCalibrationOptimizerAlgo* calibrationOptimizer, unsigned int numberOfValues)
+  : m_CalibrationOptimizer(calibrationOptimizer)
+  , m_NumberOfValues(numberOfValues)
+  , m_NumberOfValueEvaluations(0)
+  , m_NumberOfDerivativeEvaluations(0)
   {
-    m_CalibrationOptimizer=calibrationOptimizer;
   }
 
   static PlusStatus GetTransformMatrix(vnl_matrix_fixed<double,4,4>& imageToProbeTransform_vnl, const ParametersType & imageToProbeTransformParameters)
@@ -127,20 +144,135 @@ public:
     return PLUS_SUCCESS;
   }
 
-  double GetValue( const ParametersType & imageToProbeTransformParameters ) const
+  /*!
+    Compute the derivatives of the top 3 rows of the image to probe matrix (elements in row-major order) with respect to each transform parameter.
+    The matrix is computed the same way as in GetTransformMatrix: rotation by the versor (x, y, z, w = sqrt(1-x^2-y^2-z^2)),
+    columns scaled by the pixel spacing, translation in the last column.
+  */
+  static PlusStatus GetTransformMatrixDerivatives(std::vector<MatrixDerivativeType>& matrixDerivatives, const ParametersType & imageToProbeTransformParameters)
+  {
+    const unsigned int numberOfParameters = imageToProbeTransformParameters.GetSize();
+    if (numberOfParameters!=7 && numberOfParameters!=8)
+    {
+      LOG_ERROR("GetTransformMatrixDerivatives expects 7 or 8 parameters");
+      return PLUS_FAIL;
+    }
+    matrixDerivatives.assign(numberOfParameters, MatrixDerivativeType(0.0));
+
+    const double x=imageToProbeTransformParameters[0];
+    const double y=imageToProbeTransformParameters[1];
+    const double z=imageToProbeTransformParameters[2];
+    // The versor parameterization is singular at 180 deg rotation (w=0), limit the derivatives there
+    const double w=std::max(sqrt(std::max(0.0, 1.0-x*x-y*y-z*z)), 1e-6);
+
+    const double rotation[3][3] =
+    {
+      { 1-2*(y*y+z*z), 2*(x*y-z*w), 2*(x*z+y*w) },
+      { 2*(x*y+z*w), 1-2*(x*x+z*z), 2*(y*z-x*w) },
+      { 2*(x*z-y*w), 2*(y*z+x*w), 1-2*(x*x+y*y) }
+    };
+    // Partial derivatives with respect to x, y, z (at constant w) and w
+    const double rotationDerivatives[4][3][3] =
+    {
+      { { 0, 2*y, 2*z }, { 2*y, -4*x, -2*w }, { 2*z, 2*w, -4*x } },
+      { { -4*y, 2*x, 2*w }, { 2*x, 0, 2*z }, { -2*w, 2*z, -4*y } },
+      { { -4*z, -2*w, 2*x }, { 2*w, -4*z, 2*y }, { 2*x, 2*y, 0 } },
+      { { 0, -2*z, 2*y }, { 2*z, 0, -2*x }, { -2*y, 2*x, 0 } }
+    };
+    const double versor[3] = { x, y, z };
+
+    double scale[3] = {0};
+    double scaleDerivatives[2][3] = { {0} };
+    if (numberOfParameters==7)
+    {
+      // X and Y pixel spacing are the same
+      scale[0]=scale[1]=scale[2]=imageToProbeTransformParameters[6];
+      scaleDerivatives[0][0]=scaleDerivatives[0][1]=scaleDerivatives[0][2]=1.0;
+    }
+    else
+    {
+      // X and Y pixel spacing are different
+      scale[0]=imageToProbeTransformParameters[6];
+      scale[1]=imageToProbeTransformParameters[7];
+      scale[2]=(imageToProbeTransformParameters[6]+imageToProbeTransformParameters[7])/2;
+      scaleDerivatives[0][0]=1.0;
+      scaleDerivatives[0][2]=0.5;
+      scaleDerivatives[1][1]=1.0;
+      scaleDerivatives[1][2]=0.5;
+    }
+
+    for (int row=0; row<3; row++)
+    {
+      for (int column=0; column<3; column++)
+      {
+        for (int versorIndex=0; versorIndex<3; versorIndex++)
+        {
+          // w depends on the versor parameters: dw/dx = -x/w
+          const double rotationDerivative=rotationDerivatives[versorIndex][row][column]-rotationDerivatives[3][row][column]*versor[versorIndex]/w;
+          matrixDerivatives[versorIndex][row*4+column]=rotationDerivative*scale[column];
+        }
+        for (unsigned int scaleIndex=0; scaleIndex+6<numberOfParameters; scaleIndex++)
+        {
+          matrixDerivatives[6+scaleIndex][row*4+column]=rotation[row][column]*scaleDerivatives[scaleIndex][column];
+        }
+      }
+      // Translation
+      matrixDerivatives[3+row][row*4+3]=1.0;
+    }
+    return PLUS_SUCCESS;
+  }
+
+  MeasureType GetValue( const ParametersType & imageToProbeTransformParameters ) const
   {
+    ++m_NumberOfValueEvaluations;
     vnl_matrix_fixed<double,4,4> imageToProbeTransform_vnl;
-    GetTransformMatrix(imageToProbeTransform_vnl, imageToProbeTransformParameters);    
-    double errorMean=0.0;
-    double errorStDev=0.0;
-    double errorRms=0.0;
-    m_CalibrationOptimizer->ComputeError(imageToProbeTransform_vnl, errorMean, errorStDev, errorRms);
-    return errorRms;
+    GetTransformMatrix(imageToProbeTransform_vnl, imageToProbeTransformParameters);
+    m_CalibrationOptimizer->ComputeResiduals(imageToProbeTransform_vnl, m_Residuals, NULL);
+    MeasureType value(m_NumberOfValues);
+    value.Fill(0.0);
+    for (unsigned int i=0; i<m_NumberOfValues && i<m_Residuals.size(); i++)
+    {
+      value[i]=m_Residuals[i];
+    }
+    return value;
   }
 
-  void GetDerivative( const ParametersType & parameters, DerivativeType  & derivative ) const
+  void GetDerivative( const ParametersType & imageToProbeTransformParameters, DerivativeType & derivative ) const
   {
-    LOG_ERROR("GetDerivative is not implemented");
+    ++m_NumberOfDerivativeEvaluations;
+    const unsigned int numberOfParameters=GetNumberOfParameters();
+    derivative.SetSize(numberOfParameters, m_NumberOfValues);
+    derivative.Fill(0.0);
+
+    vnl_matrix_fixed<double,4,4> imageToProbeTransform_vnl;
+    std::vector<MatrixDerivativeType> matrixDerivatives;
+    if (GetTransformMatrix(imageToProbeTransform_vnl, imageToProbeTransformParameters)!=PLUS_SUCCESS
+      || GetTransformMatrixDerivatives(matrixDerivatives, imageToProbeTransformParameters)!=PLUS_SUCCESS)
+    {
+      return;
+    }
+    m_CalibrationOptimizer->ComputeResiduals(imageToProbeTransform_vnl, m_Residuals, &m_ResidualDerivatives);
+
+    // Chain rule: d residual / d parameter = sum of (d residual / d matrix element) * (d matrix element / d parameter)
+    const int numberOfMatrixDerivatives=vtkPlusProbeCalibrationAlgo::NUMBER_OF_RESIDUAL_DERIVATIVES;
+    for (unsigned int valueIndex=0; valueIndex<m_NumberOfValues && valueIndex<m_Residuals.size(); valueIndex++)
+    {
+      const double* residualDerivatives=&m_ResidualDerivatives[valueIndex*numberOfMatrixDerivatives];
+      for (unsigned int parameterIndex=0; parameterIndex<numberOfParameters; parameterIndex++)
+      {
+        double parameterDerivative=0.0;
+        for (int i=0; i<numberOfMatrixDerivatives; i++)
+        {
+          parameterDerivative+=residualDerivatives[i]*matrixDerivatives[parameterIndex][i];
+        }
+        derivative(parameterIndex,valueIndex)=parameterDerivative;
+      }
+    }
+  }
+
+  unsigned int GetNumberOfValues(void) const
+  {
+    return m_NumberOfValues;
   }
 
   unsigned int GetNumberOfParameters(void) const
@@ -155,8 +287,17 @@ public:
     }
   }
 
+  unsigned int GetNumberOfValueEvaluations() const { return m_NumberOfValueEvaluations; }
+  unsigned int GetNumberOfDerivativeEvaluations() const { return m_NumberOfDerivativeEvaluations; }
+
 private:
   vtkPlusProbeCalibrationOptimizerAlgo* m_CalibrationOptimizer;
+  unsigned int m_NumberOfValues;
+  mutable unsigned int m_NumberOfValueEvaluations;
+  mutable unsigned int m_NumberOfDerivativeEvaluations;
+  /*! Buffers of the residual computation, kept to avoid reallocation in each iteration */
+  mutable std::vector<double> m_Residuals;
+  mutable std::vector<double> m_ResidualDerivatives;
 }; 
 
 //-----------------------------------------------------------------------------
@@ -166,6 +307,9 @@ vtkStandardNewMacro(vtkPlusProbeCalibrationOptimizerAlgo);
 vtkPlusProbeCalibrationOptimizerAlgo::vtkPlusProbeCalibrationOptimizerAlgo()
 : IsotropicPixelSpacing(true)
 , ProbeCalibrationAlgo(NULL)
+, OptimizationTimeSec(0.0)
+, NumberOfCostFunctionEvaluations(0)
+, NumberOfJacobianEvaluations(0)
 {  
 }
 
@@ -196,6 +340,27 @@ void vtkPlusProbeCalibrationOptimizerAlgo::ComputeError(const vnl_matrix_fixed<d
   }
 }
 
+//--------------------------------------------------------------------------------
+void vtkPlusProbeCalibrationOptimizerAlgo::ComputeResiduals(const vnl_matrix_fixed<double,4,4> &imageToProbeTransformationMatrix, std::vector<double> &residuals, std::vector<double>* jacobian)
+{
+  switch (this->OptimizationMethod)
+  {
+  case MINIMIZE_DISTANCE_OF_MIDDLE_WIRES_IN_3D:
+    this->ProbeCalibrationAlgo->ComputeResiduals3d(imageToProbeTransformationMatrix, residuals, jacobian);
+    break;
+  case MINIMIZE_DISTANCE_OF_ALL_WIRES_IN_2D:
+    this->ProbeCalibrationAlgo->ComputeResiduals2d(imageToProbeTransformationMatrix, residuals, jacobian);
+    break;
+  default:
+    LOG_ERROR("Invalid cost function");
+    residuals.clear();
+    if (jacobian!=NULL)
+    {
+      jacobian->clear();
+    }
+  }
+}
+
 //-----------------------------------------------------------------------------
 PlusStatus vtkPlusProbeCalibrationOptimizerAlgo::ShowTransformation(const vnl_matrix_fixed<double,4,4> &imageToProbeTransformationMatrix)
 {
@@ -227,7 +392,19 @@ PlusStatus vtkPlusProbeCalibrationOptimizerAlgo::ShowTransformation(const vnl_ma
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusProbeCalibrationOptimizerAlgo::Update()
 {  
-  DistanceToWiresCostFunction::Pointer costFunction = new DistanceToWiresCostFunction(this);
+  const double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+  this->OptimizationTimeSec = 0.0;
+  this->NumberOfCostFunctionEvaluations = 0;
+  this->NumberOfJacobianEvaluations = 0;
+
+  std::vector<double> seedResiduals;
+  ComputeResiduals(this->ImageToProbeSeedTransformMatrix, seedResiduals, NULL);
+  DistanceToWiresCostFunction::Pointer costFunction = new DistanceToWiresCostFunction(this, seedResiduals.size());
+  if (costFunction->GetNumberOfValues() < costFunction->GetNumberOfParameters())
+  {
+    LOG_ERROR("Not enough wire intersection points for calibration optimization: " << costFunction->GetNumberOfValues() << " residuals for " << costFunction->GetNumberOfParameters() << " parameters");
+    return PLUS_FAIL;
+  }
 
   DistanceToWiresCostFunction::ParametersType imageToProbeSeedTransformParameters(costFunction->GetNumberOfParameters());
   DistanceToWiresCostFunction::GetTransformParameters(imageToProbeSeedTransformParameters, this->ImageToProbeSeedTransformMatrix);
@@ -243,11 +420,11 @@ PlusStatus vtkPlusProbeCalibrationOptimizerAlgo::Update()
     igsioMath::LogVtkMatrix(vtkMatrix);
   }
 
-  double initialError=costFunction->GetValue(imageToProbeSeedTransformParameters);
-  LOG_INFO("Initial cost function value with constrained matrix= " << initialError );
   {
     vnl_matrix_fixed<double,4,4> imageToProbeTransform_vnl;
     DistanceToWiresCostFunction::GetTransformMatrix(imageToProbeTransform_vnl, imageToProbeSeedTransformParameters);
+    ComputeError(imageToProbeTransform_vnl, errorMean, errorStDev, errorRms);
+    LOG_INFO("Initial cost function value with constrained matrix= " << errorRms );
     vtkSmartPointer<vtkMatrix4x4> vtkMatrix=vtkSmartPointer<vtkMatrix4x4>::New();
     PlusMath::ConvertVnlMatrixToVtkMatrix(imageToProbeTransform_vnl, vtkMatrix); 
     igsioMath::LogVtkMatrix(vtkMatrix);
@@ -264,10 +441,12 @@ PlusStatus vtkPlusProbeCalibrationOptimizerAlgo::Update()
     return PLUS_FAIL;
   }
 
-  optimizer->SetStepLength( 10 );
-  optimizer->SetStepTolerance( 1e-8 );
+  // Use the analytic derivatives of the cost function instead of finite differences
+  optimizer->UseCostFunctionGradientOn();
+  optimizer->SetNumberOfIterations( 300 );
   optimizer->SetValueTolerance( 1e-8 );
-  optimizer->SetMaximumIteration( 300 );
+  optimizer->SetGradientTolerance( 1e-8 );
+  optimizer->SetEpsilonFunction( 1e-10 );
 
 
   const double rotationParametersScale=1.0;
@@ -315,8 +494,14 @@ PlusStatus vtkPlusProbeCalibrationOptimizerAlgo::Update()
     return PLUS_FAIL;
   }
 
+  this->OptimizationTimeSec = vtkIGSIOAccurateTimer::GetSystemTime() - startTime;
+  this->NumberOfCostFunctionEvaluations = costFunction->GetNumberOfValueEvaluations();
+  this->NumberOfJacobianEvaluations = costFunction->GetNumberOfDerivativeEvaluations();
+
   std::string stopCondition=optimizer->GetStopConditionDescription();
-  LOG_INFO("Optimization stopping condition: "<<stopCondition<<". Number of iterations: " << optimizer->GetCurrentIteration());
+  LOG_INFO("Optimization stopping condition: "<<stopCondition<<". Number of iterations: " << optimizer->GetOptimizer()->get_num_iterations());
+  LOG_INFO("Optimization time: " << this->OptimizationTimeSec << " sec (" << this->NumberOfCostFunctionEvaluations << " cost function and "
+    << this->NumberOfJacobianEvaluations << " Jacobian evaluations of " << costFunction->GetNumberOfValues() << " residuals)");
 
   // Store the matrix
 
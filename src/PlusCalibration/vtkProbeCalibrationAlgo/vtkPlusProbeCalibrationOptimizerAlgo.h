@@ -14,6 +14,7 @@ See License.txt for details.
 #include "PlusFidPatternRecognitionCommon.h"
 
 #include <set>
+#include <vector>
 
 class vtkXMLDataElement;
 class vtkPlusProbeCalibrationAlgo;
@@ -31,6 +32,9 @@ class vtkPlusProbeCalibrationAlgo;
   it is more accurate to optimize the in-plane (2D) error. Also this optimizer enforces orthogonality of the image to
   probe matrix and optionally it can enforce isotropic image pixel spacing.
 
+  The errors of the individual wire intersection points are minimized by the Levenberg-Marquardt method, using analytic
+  derivatives of the errors with respect to the transform parameters. The errors are computed for the frames in parallel.
+
   \ingroup PlusLibCalibrationAlgo
 */
 class vtkPlusProbeCalibrationOptimizerAlgo : public vtkObject
@@ -68,6 +72,19 @@ public:
 
   void ComputeError(const vnl_matrix_fixed<double,4,4> &imageToProbeTransformationMatrix, double &errorMean, double &errorStDev, double &errorRms);
 
+  /*!
+    Compute the residuals of the cost function and optionally their derivatives with respect to the elements of the top 3 rows of the matrix
+    (see vtkPlusProbeCalibrationAlgo::ComputeResiduals2d and ComputeResiduals3d)
+  */
+  void ComputeResiduals(const vnl_matrix_fixed<double,4,4> &imageToProbeTransformationMatrix, std::vector<double> &residuals, std::vector<double>* jacobian);
+
+  /*! Duration of the last Update in seconds */
+  double GetOptimizationTimeSec() { return this->OptimizationTimeSec; }
+  /*! Number of cost function evaluations in the last Update */
+  unsigned int GetNumberOfCostFunctionEvaluations() { return this->NumberOfCostFunctionEvaluations; }
+  /*! Number of cost function Jacobian evaluations in the last Update */
+  unsigned int GetNumberOfJacobianEvaluations() { return this->NumberOfJacobianEvaluations; }
+
   bool GetIsotropicPixelSpacing() { return this->IsotropicPixelSpacing; }
   void SetIsotropicPixelSpacing(bool isotropicPixelSpacing) { this->IsotropicPixelSpacing=isotropicPixelSpacing; }
 
@@ -101,6 +118,11 @@ protected:
    
   vtkPlusProbeCalibrationAlgo* ProbeCalibrationAlgo;
 
+  /*! Statistics of the last optimization */
+  double OptimizationTimeSec;
+  unsigned int NumberOfCostFunctionEvaluations;
+  unsigned int NumberOfJacobianEvaluations;
+
 };
 
 #endif
@@ -7,6 +7,7 @@
 #include "PlusConfigure.h"
 
 #include "PlusMath.h"
+#include "PlusWorkerPool.h"
 #ifdef PLUS_RENDERING_ENABLED
 #include "PlusPlotter.h"
 #endif
@@ -121,8 +122,8 @@ PlusStatus vtkPlusSpacingCalibAlgo::Update()
 
   // Construct linear equations Ax = b, where A is a matrix with m rows and
   // n columns, b is an m-vector.
-  std::vector<vnl_vector<double> > aMatrix;
-  std::vector<double> bVector;
+  vnl_matrix<double>& aMatrix = this->CalibrationMatrix;
+  vnl_vector<double>& bVector = this->CalibrationVector;
 
   // Construct linear equation for spacing calibration
   if (this->ConstructLinearEquationForCalibration(aMatrix, bVector) != PLUS_SUCCESS)
@@ -131,7 +132,7 @@ PlusStatus vtkPlusSpacingCalibAlgo::Update()
     return PLUS_FAIL;
   }
 
-  if (aMatrix.size() == 0 || bVector.size() == 0)
+  if (aMatrix.rows() == 0 || bVector.size() == 0)
   {
     LOG_ERROR("Spacing calibration failed, no data found!");
     return PLUS_FAIL;
@@ -154,9 +155,9 @@ PlusStatus vtkPlusSpacingCalibAlgo::Update()
   // don't use set macro, it changes the modification time of the algorithm
   this->Spacing[0] = sqrt(scalingCalibResult[0]);
   this->Spacing[1] = sqrt(scalingCalibResult[1]);
+  this->CalibrationResult = scalingCalibResult;
 
-  this->UpdateReportTable(aMatrix, bVector, scalingCalibResult);
-
+  // The report table is built by GetReportTable when it is needed
   this->UpdateTime.Modified();
 
   return PLUS_SUCCESS;
@@ -164,7 +165,7 @@ PlusStatus vtkPlusSpacingCalibAlgo::Update()
 
 
 //----------------------------------------------------------------------------
-PlusStatus vtkPlusSpacingCalibAlgo::ConstructLinearEquationForCalibration(std::vector<vnl_vector<double> >& aMatrix, std::vector<double>& bVector)
+PlusStatus vtkPlusSpacingCalibAlgo::ConstructLinearEquationForCalibration(vnl_matrix<double>& aMatrix, vnl_vector<double>& bVector)
 {
   LOG_TRACE("vtkPlusSpacingCalibAlgo::ConstructLinearEquationForCalibration");
   aMatrix.clear();
@@ -196,6 +197,8 @@ PlusStatus vtkPlusSpacingCalibAlgo::ConstructLinearEquationForCalibration(std::v
     verticalDistanceMm.push_back(vd);
   }
 
+  // Collect the segmented frames, each of them adds a horizontal and a vertical row for each pair of neighboring N wires
+  std::vector<vtkPoints*> segmentedFramePoints;
   for (unsigned int frame = 0; frame < this->TrackedFrameList->GetNumberOfTrackedFrames(); ++frame)
   {
     igsioTrackedFrame* trackedFrame = this->TrackedFrameList->GetTrackedFrame(frame);
@@ -218,61 +221,73 @@ PlusStatus vtkPlusSpacingCalibAlgo::ConstructLinearEquationForCalibration(std::v
       continue;
     }
 
-    for (unsigned int w = 0; w < this->NWires.size() - 1; ++w)
-    {
-      double wRightPx[3] = {0};
-      fiduacialPointsCoordinatePx->GetPoint(w * 3, wRightPx);
-
-      double wLeftPx[3] = {0};
-      fiduacialPointsCoordinatePx->GetPoint(w * 3 + 2, wLeftPx);
-
-      double wTopPx[3] = {0};
-      fiduacialPointsCoordinatePx->GetPoint((w + 1) * 3 + 2, wTopPx);
-
-      double wBottomPx[3] = {0};
-      fiduacialPointsCoordinatePx->GetPoint(w * 3 + 2, wBottomPx);
-
-      // Compute horizontal distance
-      double xHorizontalDistance = fabs(wRightPx[0] - wLeftPx[0]);
-      double yHorizontalDistance = fabs(wRightPx[1] - wLeftPx[1]);
-
-      // Populate the sparse matrix with squared distances in pixel
-      vnl_vector<double> scaleFactorHorizontal(2, 0);
-      scaleFactorHorizontal.put(0, pow(xHorizontalDistance, 2));
-      scaleFactorHorizontal.put(1, pow(yHorizontalDistance, 2));
-      aMatrix.push_back(scaleFactorHorizontal);
-
-      // Add the squared distance in mm
-      bVector.push_back(pow(horizontalDistanceMm[w], 2));
-
-      // Compute vertical distance
-      double xVerticalDistance = fabs(wBottomPx[0] - wTopPx[0]);
-      double yVerticalDistance = fabs(wBottomPx[1] - wTopPx[1]);
-
-      // Populate the sparse matrix with squared distances in pixel
-      vnl_vector<double> scaleFactorVertical(2, 0);
-      scaleFactorVertical.put(0, pow(xVerticalDistance, 2));
-      scaleFactorVertical.put(1, pow(yVerticalDistance, 2));
-      aMatrix.push_back(scaleFactorVertical);
+    segmentedFramePoints.push_back(fiduacialPointsCoordinatePx);
+  }
 
-      // Add the squared distance in mm
-      bVector.push_back(pow(verticalDistanceMm[w], 2));
+  const int numberOfWirePairs = static_cast<int>(this->NWires.size()) - 1;
+  const int rowsPerFrame = 2 * numberOfWirePairs;
+  aMatrix.set_size(segmentedFramePoints.size() * rowsPerFrame, 2);
+  bVector.set_size(segmentedFramePoints.size() * rowsPerFrame);
 
+  PlusWorkerPool::GetInstance().ParallelFor(0, static_cast<int>(segmentedFramePoints.size()), 0, [&](int firstFrame, int lastFrame)
+  {
+    for (int frame = firstFrame; frame < lastFrame; ++frame)
+    {
+      vtkPoints* fiduacialPointsCoordinatePx = segmentedFramePoints[frame];
+      unsigned int row = frame * rowsPerFrame;
+      for (int w = 0; w < numberOfWirePairs; ++w)
+      {
+        double wRightPx[3] = {0};
+        fiduacialPointsCoordinatePx->GetPoint(w * 3, wRightPx);
+
+        double wLeftPx[3] = {0};
+        fiduacialPointsCoordinatePx->GetPoint(w * 3 + 2, wLeftPx);
+
+        double wTopPx[3] = {0};
+        fiduacialPointsCoordinatePx->GetPoint((w + 1) * 3 + 2, wTopPx);
+
+        double wBottomPx[3] = {0};
+        fiduacialPointsCoordinatePx->GetPoint(w * 3 + 2, wBottomPx);
+
+        // Compute horizontal distance
+        double xHorizontalDistance = fabs(wRightPx[0] - wLeftPx[0]);
+        double yHorizontalDistance = fabs(wRightPx[1] - wLeftPx[1]);
+
+        // Populate the matrix with squared distances in pixel and add the squared distance in mm
+        aMatrix(row, 0) = xHorizontalDistance * xHorizontalDistance;
+        aMatrix(row, 1) = yHorizontalDistance * yHorizontalDistance;
+        bVector[row] = horizontalDistanceMm[w] * horizontalDistanceMm[w];
+        ++row;
+
+        // Compute vertical distance
+        double xVerticalDistance = fabs(wBottomPx[0] - wTopPx[0]);
+        double yVerticalDistance = fabs(wBottomPx[1] - wTopPx[1]);
+
+        // Populate the matrix with squared distances in pixel and add the squared distance in mm
+        aMatrix(row, 0) = xVerticalDistance * xVerticalDistance;
+        aMatrix(row, 1) = yVerticalDistance * yVerticalDistance;
+        bVector[row] = verticalDistanceMm[w] * verticalDistanceMm[w];
+        ++row;
+      }
     }
-  } // end of frames
+  }); // end of frames
 
   return PLUS_SUCCESS;
 }
 
 //----------------------------------------------------------------------------
-PlusStatus vtkPlusSpacingCalibAlgo::UpdateReportTable(const std::vector<vnl_vector<double> >& aMatrix,
-    const std::vector<double>& bVector,
+PlusStatus vtkPlusSpacingCalibAlgo::UpdateReportTable(const vnl_matrix<double>& aMatrix,
+    const vnl_vector<double>& bVector,
     const vnl_vector<double>& resultVector)
 {
   LOG_TRACE("vtkPlusSpacingCalibAlgo::UpdateReportTable");
 
-  // Clear table before update
-  this->SetReportTable(NULL);
+  // Clear table before update - don't use set macro, it changes the modification time of the algorithm
+  if (this->ReportTable != NULL)
+  {
+    this->ReportTable->Delete();
+    this->ReportTable = NULL;
+  }
 
   if (this->ReportTable == NULL)
   {
@@ -291,9 +306,9 @@ PlusStatus vtkPlusSpacingCalibAlgo::UpdateReportTable(const std::vector<vnl_vect
   {
     vtkSmartPointer<vtkVariantArray> tableRow = vtkSmartPointer<vtkVariantArray>::New();
 
-    tableRow->InsertNextValue(sqrt(aMatrix[row].get(0) * sX + aMatrix[row].get(1) * sY) - sqrt(bVector[row]));           // Computed-Measured Distance - X (mm)
+    tableRow->InsertNextValue(sqrt(aMatrix(row, 0) * sX + aMatrix(row, 1) * sY) - sqrt(bVector[row]));           // Computed-Measured Distance - X (mm)
     tableRow->InsertNextValue(sqrt(bVector[row]));     // Measured Distance - X (mm)
-    tableRow->InsertNextValue(sqrt(aMatrix[row + 1].get(0) * sX + aMatrix[row + 1].get(1) * sY) - sqrt(bVector[row + 1]));           // Computed-Measured Distance - Y (mm)
+    tableRow->InsertNextValue(sqrt(aMatrix(row + 1, 0) * sX + aMatrix(row + 1, 1) * sY) - sqrt(bVector[row + 1]));           // Computed-Measured Distance - Y (mm)
     tableRow->InsertNextValue(sqrt(bVector[row + 1]));     // Measured Distance - Y (mm)
 
     if (tableRow->GetNumberOfTuples() == this->ReportTable->GetNumberOfColumns())
@@ -310,13 +325,25 @@ PlusStatus vtkPlusSpacingCalibAlgo::UpdateReportTable(const std::vector<vnl_vect
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+vtkTable* vtkPlusSpacingCalibAlgo::GetReportTable()
+{
+  // Update calibration result, then build the table if it was not built for this result yet
+  if (this->Update() == PLUS_SUCCESS && this->ReportTableUpdateTime < this->UpdateTime)
+  {
+    this->UpdateReportTable(this->CalibrationMatrix, this->CalibrationVector, this->CalibrationResult);
+    this->ReportTableUpdateTime.Modified();
+  }
+  return this->ReportTable;
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusSpacingCalibAlgo::AddNewColumnToReportTable(const char* columnName)
 {
   if (this->ReportTable == NULL)
   {
-    vtkSmartPointer<vtkTable> table = vtkSmartPointer<vtkTable>::New();
-    this->SetReportTable(table);
+    // Don't use set macro, it changes the modification time of the algorithm
+    this->ReportTable = vtkTable::New();
   }
 
   if (columnName == NULL)
@@ -370,15 +397,22 @@ PlusStatus vtkPlusSpacingCalibAlgo::GenerateReport(vtkPlusHTMLGenerator* htmlRep
   int numberOfBins = 41;
   int imageSize[2] = {800, 400};
 
+  vtkTable* reportTable = this->GetReportTable();
+  if (reportTable == NULL)
+  {
+    LOG_ERROR("Unable to generate report - spacing calibration report table is not available!");
+    return PLUS_FAIL;
+  }
+
   std::string outputImageFilename = htmlReport->AddImageAutoFilename("ErrorHistogramX.png", "X spacing calculation error histogram");
 #ifdef PLUS_RENDERING_ENABLED
-  PlusPlotter::WriteHistogramChartToFile("X spacing error histogram", *this->ReportTable, 0 /* "Computed-Measured Distance - X (mm)" */, valueRangeMin, valueRangeMax, numberOfBins, imageSize, outputImageFilename.c_str());
+  PlusPlotter::WriteHistogramChartToFile("X spacing error histogram", *reportTable, 0 /* "Computed-Measured Distance - X (mm)" */, valueRangeMin, valueRangeMax, numberOfBins, imageSize, outputImageFilename.c_str());
 #endif
   htmlReport->AddParagraph("<p>");
 
   outputImageFilename = htmlReport->AddImageAutoFilename("ErrorHistogramY.png", "Y spacing calculation error histogram");
 #ifdef PLUS_RENDERING_ENABLED
-  PlusPlotter::WriteHistogramChartToFile("Y spacing error histogram", *this->ReportTable, 2 /* "Computed-Measured Distance - Y (mm)" */, valueRangeMin, valueRangeMax, numberOfBins, imageSize, outputImageFilename.c_str());
+  PlusPlotter::WriteHistogramChartToFile("Y spacing error histogram", *reportTable, 2 /* "Computed-Measured Distance - Y (mm)" */, valueRangeMin, valueRangeMax, numberOfBins, imageSize, outputImageFilename.c_str());
 #endif
 
   htmlReport->AddHorizontalLine();
@@ -15,6 +15,9 @@
 #include "vtkTable.h"
 #include "PlusFidPatternRecognitionCommon.h"
 
+#include <vnl/vnl_matrix.h>
+#include <vnl/vnl_vector.h>
+
 class vtkPlusHTMLGenerator;
 
 /*!
@@ -43,8 +46,11 @@ public:
   */
   virtual void SetInputs(vtkIGSIOTrackedFrameList* trackedFrameList, const std::vector<PlusNWire>& nWires);
 
-  /*! Report table used for storing algorithm results */
-  vtkGetObjectMacro(ReportTable, vtkTable);
+  /*!
+    Report table used for storing algorithm results. The table is built when it is first requested
+    after the calibration, as it is not needed for computing the spacing.
+  */
+  virtual vtkTable* GetReportTable();
 
   /*! Get the image spacing (mm/pixel; spacing[0]: lateral axis, spacing[1]: axial axis) */
   virtual PlusStatus GetSpacing(double spacing[2]);
@@ -59,16 +65,19 @@ protected:
   /*! Bring this algorithm's outputs up-to-date. */
   virtual PlusStatus Update();
 
-  /*! Construct linear equation for spacing calibration */
-  virtual PlusStatus ConstructLinearEquationForCalibration(std::vector<vnl_vector<double> >& aMatrix, std::vector<double>& bVector);
+  /*!
+    Construct linear equation for spacing calibration. Each segmented frame adds the same number of rows,
+    the rows of the frames are filled in parallel.
+  */
+  virtual PlusStatus ConstructLinearEquationForCalibration(vnl_matrix<double>& aMatrix, vnl_vector<double>& bVector);
 
   /*! Add new column to the report table */
   PlusStatus AddNewColumnToReportTable(const char* columnName);
 
   /*! Update spacing calibration error report table */
   virtual PlusStatus UpdateReportTable(
-    const std::vector<vnl_vector<double> >& aMatrix,
-    const std::vector<double>& bVector,
+    const vnl_matrix<double>& aMatrix,
+    const vnl_vector<double>& bVector,
     const vnl_vector<double>& resultVector);
 
   /*! Set tracked frame list */
@@ -103,6 +112,14 @@ protected:
   /*! When the results were computed. The result is recomputed only if the inputs changed more recently than UpdateTime. */
   vtkTimeStamp UpdateTime;
 
+  /*! Linear equation and result of the last calibration, kept for building the report table */
+  vnl_matrix<double> CalibrationMatrix;
+  vnl_vector<double> CalibrationVector;
+  vnl_vector<double> CalibrationResult;
+
+  /*! When the report table was built. The table is rebuilt if the results were computed more recently than ReportTableUpdateTime. */
+  vtkTimeStamp ReportTableUpdateTime;
+
 };
 
 #endif
\ No newline at end of file
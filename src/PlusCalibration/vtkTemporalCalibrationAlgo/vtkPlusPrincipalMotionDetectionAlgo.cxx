@@ -5,6 +5,7 @@
 =========================================================Plus=header=end*/
 
 #include "PlusConfigure.h"
+#include "PlusTrackedFrameColumns.h"
 
 #include "vtkObjectFactory.h"
 #include "vtkTransform.h"
@@ -14,7 +15,6 @@
 #include "vtkPCAStatistics.h"
 
 #include "vtkPlusPrincipalMotionDetectionAlgo.h"
-#include "vtkIGSIOTransformRepository.h"
 #include "vtkIGSIOTrackedFrameList.h"
 #include "igsioTrackedFrame.h"
 
@@ -78,7 +78,6 @@ PlusStatus vtkPlusPrincipalMotionDetectionAlgo::VerifyInputFrames()
 //-----------------------------------------------------------------------------
 PlusStatus vtkPlusPrincipalMotionDetectionAlgo::ComputeTrackerPositionMetric()
 {
-  vtkSmartPointer<vtkIGSIOTransformRepository> transformRepository = vtkSmartPointer<vtkIGSIOTransformRepository>::New();
   igsioTransformName transformName;
 
   if (transformName.SetTransformName(m_ProbeToReferenceTransformName.c_str()) != PLUS_SUCCESS)
@@ -87,6 +86,17 @@ PlusStatus vtkPlusPrincipalMotionDetectionAlgo::ComputeTrackerPositionMetric()
     return PLUS_FAIL;
   }
 
+  // Read the transform from all frames at once, instead of a transform repository lookup for each frame
+  PlusTrackedFrameColumns columns;
+  if (columns.Build(m_TrackerFrames, std::vector<igsioTransformName>(1, transformName)) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Cannot compute tracker position metric, failed to read " << m_ProbeToReferenceTransformName << " from the tracker frames");
+    return PLUS_FAIL;
+  }
+  const std::vector<double>& timestamps = columns.GetTimestamps();
+  const std::vector<PlusTrackedFrameColumns::Matrix>& probeToReferenceMatrices = columns.GetMatrices(0);
+  const std::vector<ToolStatus>& probeToReferenceStatuses = columns.GetStatuses(0);
+
   // Clear the old tracker timestamps, preparing for an update
   m_SignalTimestamps.clear();
   m_SignalValues.clear();
@@ -97,42 +107,35 @@ PlusStatus vtkPlusPrincipalMotionDetectionAlgo::ComputeTrackerPositionMetric()
   std::deque<itk::Point<double, 3> > trackerPositions;
   int numberOfValidFrames = 0;
   bool signalTimeRangeDefined = (m_SignalTimeRangeMin <= m_SignalTimeRangeMax);
-  for (unsigned int frame = 0; frame < m_TrackerFrames->GetNumberOfTrackedFrames(); ++frame)
+  for (unsigned int frame = 0; frame < columns.GetNumberOfFrames(); ++frame)
   {
-    igsioTrackedFrame* trackedFrame = m_TrackerFrames->GetTrackedFrame(frame);
-
-    if (signalTimeRangeDefined && (trackedFrame->GetTimestamp() < m_SignalTimeRangeMin || trackedFrame->GetTimestamp() > m_SignalTimeRangeMax))
+    if (signalTimeRangeDefined && (timestamps[frame] < m_SignalTimeRangeMin || timestamps[frame] > m_SignalTimeRangeMax))
     {
       // frame is out of the specified signal range
       continue;
     }
 
-    transformRepository->SetTransforms(*trackedFrame);
-
-
-    vtkSmartPointer<vtkMatrix4x4> probeToReferenceTransform = vtkSmartPointer<vtkMatrix4x4>::New();
-    ToolStatus status(TOOL_INVALID);
-    transformRepository->GetTransform(transformName, probeToReferenceTransform, &status);
-    if (status != TOOL_OK)
+    if (probeToReferenceStatuses[frame] != TOOL_OK)
     {
       // There is no available transform for this frame; skip that frame
       continue;
     }
 
-    //  Store current tracker position
+    //  Store current tracker position (translation column of the matrix)
+    const PlusTrackedFrameColumns::Matrix& probeToReferenceMatrix = probeToReferenceMatrices[frame];
     itk::Point<double, 3> currTrackerPosition;
-    currTrackerPosition[0] = probeToReferenceTransform->GetElement(0, 3);
-    currTrackerPosition[1] = probeToReferenceTransform->GetElement(1, 3);
-    currTrackerPosition[2] = probeToReferenceTransform->GetElement(2, 3);
+    currTrackerPosition[0] = probeToReferenceMatrix[3];
+    currTrackerPosition[1] = probeToReferenceMatrix[7];
+    currTrackerPosition[2] = probeToReferenceMatrix[11];
     trackerPositions.push_back(currTrackerPosition);
 
     // Add current tracker position to the running total
-    trackerPositionSum[0] = trackerPositionSum[0] + probeToReferenceTransform->GetElement(0, 3);
-    trackerPositionSum[1] = trackerPositionSum[1] + probeToReferenceTransform->GetElement(1, 3);
-    trackerPositionSum[2] = trackerPositionSum[2] + probeToReferenceTransform->GetElement(2, 3);
+    trackerPositionSum[0] = trackerPositionSum[0] + currTrackerPosition[0];
+    trackerPositionSum[1] = trackerPositionSum[1] + currTrackerPosition[1];
+    trackerPositionSum[2] = trackerPositionSum[2] + currTrackerPosition[2];
     ++numberOfValidFrames;
 
-    m_SignalTimestamps.push_back(trackedFrame->GetTimestamp());   // These timestamps will be in the desired time range
+    m_SignalTimestamps.push_back(timestamps[frame]);   // These timestamps will be in the desired time range
   }
 
   // Calculate the principal axis of motion (using PCA)
@@ -15,6 +15,7 @@
 #include "vtkTable.h"
 #include "vtkPlusTemporalCalibrationAlgo.h"
 #include "vtkIGSIOTrackedFrameList.h"
+#include "PlusWorkerPool.h"
 #include <algorithm>
 #include <fstream>
 #include <iostream>
@@ -59,6 +60,116 @@ namespace
     AMPLITUDE
   };
   MetricNormalizationType METRIC_NORMALIZATION = STD;
+
+  //-----------------------------------------------------------------------------
+  template<class SignalContainerType>
+  PlusStatus NormalizeSignal(SignalContainerType& signal, double& normalizationFactor, int startIndex, int stopIndex)
+  {
+    if (signal.size() == 0)
+    {
+      LOG_ERROR("NormalizeMetricValues failed because the metric vector is empty");
+      return PLUS_FAIL;
+    }
+
+    if (stopIndex < 0)
+    {
+      stopIndex = signal.size() - 1;
+    }
+
+    // Calculate the signal mean
+    double mu = 0;
+    for (int i = startIndex; i <= stopIndex; ++i)
+    {
+      mu += signal[i];
+    }
+    mu /= (stopIndex - startIndex + 1);
+
+    // Calculate the signal "amplitude" and use its inverse as normalizationFactor
+    normalizationFactor = 1.0;
+    switch (METRIC_NORMALIZATION)
+    {
+      case AMPLITUDE:
+        {
+          // Divide by the maximum signal amplitude
+          double maxValue = *(std::max_element(signal.begin() + startIndex, signal.begin() + stopIndex));
+          double minValue = *(std::min_element(signal.begin() + startIndex, signal.begin() + stopIndex));
+          double maxPeakToPeak = fabs(maxValue - minValue);
+          if (maxPeakToPeak < 1e-10)
+          {
+            LOG_ERROR("Cannot normalize data, peak to peak difference is too small");
+          }
+          else
+          {
+            normalizationFactor = 1.0 / maxPeakToPeak;
+          }
+          break;
+        }
+      case STD:
+        {
+          // Calculate standard deviation
+          double stdev = 0;
+          for (int i = startIndex; i <= stopIndex; ++i)
+          {
+            stdev += (signal[i] - mu) * (signal[i] - mu);
+          }
+          stdev = std::sqrt(stdev);
+          stdev /= std::sqrt(static_cast<double>(stopIndex - startIndex + 1) - 1);
+
+          if (stdev < 1e-10)
+          {
+            LOG_ERROR("Cannot normalize data, stdev is too small");
+          }
+          else
+          {
+            normalizationFactor = 1.0 / stdev;
+          }
+          break;
+        }
+    }
+
+    // Normalize the signal values
+    for (unsigned int i = 0; i < signal.size(); ++i)
+    {
+      signal[i] = (signal[i] - mu) * normalizationFactor;
+    }
+
+    return PLUS_SUCCESS;
+  }
+
+  //-----------------------------------------------------------------------------
+  template<class SignalContainerType>
+  PlusStatus NormalizeSignal(SignalContainerType& signal, double& normalizationFactor, double startTime, double stopTime, const SignalContainerType& timestamps)
+  {
+    if (timestamps.size() == 0)
+    {
+      LOG_ERROR("NormalizeMetricValues failed because the metric vector is empty");
+      return PLUS_FAIL;
+    }
+
+    int startIndex = 0;
+    for (unsigned int i = 0; i < timestamps.size(); ++i)
+    {
+      double t = timestamps[i];
+      if (t >= startTime)
+      {
+        startIndex = i;
+        break;
+      }
+    }
+
+    int stopIndex = timestamps.size() - 1;
+    for (unsigned int i = timestamps.size() - 1; i != 0; --i)
+    {
+      double t = timestamps[i];
+      if (t <= stopTime)
+      {
+        stopIndex = i;
+        break;
+      }
+    }
+
+    return NormalizeSignal(signal, normalizationFactor, startIndex, stopIndex);
+  }
 }
 
 //-----------------------------------------------------------------------------
@@ -68,6 +179,7 @@ vtkPlusTemporalCalibrationAlgo::vtkPlusTemporalCalibrationAlgo()
   , SaveIntermediateImages(false)
   , IntermediateFilesOutputDirectory(vtkPlusConfig::GetInstance()->GetOutputDirectory())
   , SamplingResolutionSec(DEFAULT_SAMPLING_RESOLUTION_SEC)
+  , NumberOfThreads(0)
   , BestCorrelationValue(0.0)
   , BestCorrelationLagIndex(-1)
   , BestCorrelationTimeOffset(0.0)
@@ -113,6 +225,18 @@ PlusStatus vtkPlusTemporalCalibrationAlgo::Update(TEMPORAL_CALIBRATION_ERROR& er
   return PLUS_SUCCESS;
 }
 
+//-----------------------------------------------------------------------------
+void vtkPlusTemporalCalibrationAlgo::SetNumberOfThreads(int numberOfThreads)
+{
+  this->NumberOfThreads = numberOfThreads;
+}
+
+//-----------------------------------------------------------------------------
+int vtkPlusTemporalCalibrationAlgo::GetNumberOfThreads() const
+{
+  return this->NumberOfThreads;
+}
+
 //-----------------------------------------------------------------------------
 void vtkPlusTemporalCalibrationAlgo::SetSaveIntermediateImages(bool saveIntermediateImages)
 {
@@ -327,112 +451,26 @@ PlusStatus vtkPlusTemporalCalibrationAlgo::GetSignalRange(const std::deque<doubl
 //-----------------------------------------------------------------------------
 PlusStatus vtkPlusTemporalCalibrationAlgo::NormalizeMetricValues(std::deque<double>& signal, double& normalizationFactor, int startIndex/*=0*/, int stopIndex/*=-1*/)
 {
-  if (signal.size() == 0)
-  {
-    LOG_ERROR("NormalizeMetricValues failed because the metric vector is empty");
-    return PLUS_FAIL;
-  }
-
-  if (stopIndex < 0)
-  {
-    stopIndex = signal.size() - 1;
-  }
-
-  // Calculate the signal mean
-  double mu = 0;
-  for (int i = startIndex; i <= stopIndex; ++i)
-  {
-    mu += signal.at(i);
-  }
-  mu /= (stopIndex - startIndex + 1);
-
-  // Calculate the signal "amplitude" and use its inverse as normalizationFactor
-  normalizationFactor = 1.0;
-  switch (METRIC_NORMALIZATION)
-  {
-    case AMPLITUDE:
-      {
-        // Divide by the maximum signal amplitude
-        double minValue = 0;
-        double maxValue = 0;
-        GetSignalRange(signal, startIndex, stopIndex, minValue, maxValue);
-        double maxPeakToPeak = fabs(maxValue - minValue);
-        if (maxPeakToPeak < 1e-10)
-        {
-          LOG_ERROR("Cannot normalize data, peak to peak difference is too small");
-        }
-        else
-        {
-          normalizationFactor = 1.0 / maxPeakToPeak;
-        }
-        break;
-      }
-    case STD:
-      {
-        // Calculate standard deviation
-        double stdev = 0;
-        for (int i = startIndex; i <= stopIndex; ++i)
-        {
-          stdev += (signal.at(i) - mu) * (signal.at(i) - mu);
-        }
-        stdev = std::sqrt(stdev);
-        stdev /= std::sqrt(static_cast<double>(stopIndex - startIndex + 1) - 1);
-
-        if (stdev < 1e-10)
-        {
-          LOG_ERROR("Cannot normalize data, stdev is too small");
-        }
-        else
-        {
-          normalizationFactor = 1.0 / stdev;
-        }
-        break;
-      }
-  }
-
-  // Normalize the signal values
-  for (unsigned int i = 0; i < signal.size(); ++i)
-  {
-    signal.at(i) = (signal.at(i) - mu) * normalizationFactor;
-  }
+  return NormalizeSignal(signal, normalizationFactor, startIndex, stopIndex);
+}
 
-  return PLUS_SUCCESS;
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusTemporalCalibrationAlgo::NormalizeMetricValues(std::vector<double>& signal, double& normalizationFactor, int startIndex/*=0*/, int stopIndex/*=-1*/)
+{
+  return NormalizeSignal(signal, normalizationFactor, startIndex, stopIndex);
 }
 
 //-----------------------------------------------------------------------------
 PlusStatus vtkPlusTemporalCalibrationAlgo::NormalizeMetricValues(std::deque<double>& signal, double& normalizationFactor, double startTime, double stopTime, const std::deque<double>& timestamps)
 {
-  if (timestamps.size() == 0)
-  {
-    LOG_ERROR("NormalizeMetricValues failed because the metric vector is empty");
-    return PLUS_FAIL;
-  }
-
-  int startIndex = 0;
-  for (unsigned int i = 0; i < timestamps.size(); ++i)
-  {
-    double t = timestamps.at(i);
-    if (t >= startTime)
-    {
-      startIndex = i;
-      break;
-    }
-  }
-
-  int stopIndex = timestamps.size() - 1;
-  for (unsigned int i = timestamps.size() - 1; i != 0; --i)
-  {
-    double t = timestamps.at(i);
-    if (t <= stopTime)
-    {
-      stopIndex = i;
-      break;
-    }
-  }
-
-  return NormalizeMetricValues(signal, normalizationFactor, startIndex, stopIndex);
+  return NormalizeSignal(signal, normalizationFactor, startTime, stopTime, timestamps);
 }
 
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusTemporalCalibrationAlgo::NormalizeMetricValues(std::vector<double>& signal, double& normalizationFactor, double startTime, double stopTime, const std::vector<double>& timestamps)
+{
+  return NormalizeSignal(signal, normalizationFactor, startTime, stopTime, timestamps);
+}
 
 //-----------------------------------------------------------------------------
 PlusStatus vtkPlusTemporalCalibrationAlgo::ResampleSignalLinearly(const std::deque<double>& templateSignalTimestamps,
@@ -447,48 +485,116 @@ PlusStatus vtkPlusTemporalCalibrationAlgo::ResampleSignalLinearly(const std::deq
 }
 
 //-----------------------------------------------------------------------------
-void vtkPlusTemporalCalibrationAlgo::ComputeCorrelationBetweenFixedAndMovingSignal(double minTrackerLagSec, double maxTrackerLagSec, double stepSizeSec, double& bestCorrelationValue, double& bestCorrelationTimeOffset, double& bestCorrelationNormalizationFactor, std::deque<double>& corrTimeOffsets, std::deque<double>& corrValues)
+void vtkPlusTemporalCalibrationAlgo::ResampleSignalLinearly(const std::vector<double>& templateSignalTimestamps,
+    const std::vector<double>& signalTimestamps, const std::vector<double>& signalValues, std::vector<double>& resampledSignalValues)
 {
-  // We will let the tracker metric be the "sliding" metric and let the video metric be the "fixed" metric. Since we are assuming a maximum offset between the two streams.
-
-  // Construct piecewise function for tracker signal
-  vtkSmartPointer<vtkPiecewiseFunction> trackerPositionPiecewiseSignal = vtkSmartPointer<vtkPiecewiseFunction>::New();
-  double midpoint = 0.5;
-  double sharpness = 0;
-  for (unsigned int i = 0; i < this->MovingSignal.signalTimestamps.size(); ++i)
+  resampledSignalValues.resize(templateSignalTimestamps.size());
+  if (signalTimestamps.empty())
+  {
+    std::fill(resampledSignalValues.begin(), resampledSignalValues.end(), 0.0);
+    return;
+  }
+  for (unsigned int i = 0; i < templateSignalTimestamps.size(); ++i)
   {
-    trackerPositionPiecewiseSignal->AddPoint(this->MovingSignal.signalTimestamps.at(i), this->MovingSignal.signalValues.at(i), midpoint, sharpness);
+    const double t = templateSignalTimestamps[i];
+    if (t <= signalTimestamps.front())
+    {
+      resampledSignalValues[i] = signalValues.front();
+      continue;
+    }
+    if (t >= signalTimestamps.back())
+    {
+      resampledSignalValues[i] = signalValues.back();
+      continue;
+    }
+    // Index of the last signal point before t
+    const int index = std::upper_bound(signalTimestamps.begin(), signalTimestamps.end(), t) - signalTimestamps.begin() - 1;
+    const double s = (t - signalTimestamps[index]) / (signalTimestamps[index + 1] - signalTimestamps[index]);
+    resampledSignalValues[i] = (1.0 - s) * signalValues[index] + s * signalValues[index + 1];
   }
+}
+
+//-----------------------------------------------------------------------------
+void vtkPlusTemporalCalibrationAlgo::ComputeCorrelationBetweenFixedAndMovingSignal(double minTrackerLagSec, double maxTrackerLagSec, double stepSizeSec, double& bestCorrelationValue, double& bestCorrelationTimeOffset, double& bestCorrelationNormalizationFactor, std::deque<double>& corrTimeOffsets, std::deque<double>& corrValues)
+{
+  // We will let the tracker metric be the "sliding" metric and let the video metric be the "fixed" metric. Since we are assuming a maximum offset between the two streams.
 
-  // Compute alignment metric for each offset
-  std::deque<double> normalizationFactors;
   if (stepSizeSec < TIMESTAMP_EPSILON_SEC)
   {
     LOG_ERROR("Sampling resolution is too small: " << stepSizeSec << " sec");
     return;
   }
-  std::deque<double> slidingSignalTimestamps(this->FixedSignal.signalTimestamps.size());
-  std::deque<double> resampledTrackerPositionMetric;
   corrValues.clear();
   corrTimeOffsets.clear();
   for (double offsetValueSec = minTrackerLagSec; offsetValueSec <= maxTrackerLagSec; offsetValueSec += stepSizeSec)
   {
-    //LOG_DEBUG("offsetValueSec = " << offsetValueSec);
     corrTimeOffsets.push_back(offsetValueSec);
-    for (unsigned int i = 0; i < slidingSignalTimestamps.size(); ++i)
+  }
+  if (corrTimeOffsets.empty() || this->FixedSignal.signalTimestamps.empty())
+  {
+    LOG_ERROR("Cannot compute correlation between fixed and moving signal: no time offsets or fixed signal samples");
+    return;
+  }
+
+  // Contiguous copies of the signals. The tracker signal is sorted by time and a duplicate timestamp keeps the last value,
+  // the same way as in a piecewise function.
+  const std::vector<double> fixedTimestamps(this->FixedSignal.signalTimestamps.begin(), this->FixedSignal.signalTimestamps.end());
+  const std::vector<double> fixedValues(this->FixedSignal.signalValues.begin(), this->FixedSignal.signalValues.end());
+  std::vector<std::pair<double, double> > movingPoints;
+  for (unsigned int i = 0; i < this->MovingSignal.signalTimestamps.size(); ++i)
+  {
+    movingPoints.push_back(std::make_pair(this->MovingSignal.signalTimestamps.at(i), this->MovingSignal.signalValues.at(i)));
+  }
+  std::stable_sort(movingPoints.begin(), movingPoints.end(),
+                   [](const std::pair<double, double>& a, const std::pair<double, double>& b) { return a.first < b.first; });
+  std::vector<double> movingTimestamps;
+  std::vector<double> movingValues;
+  for (unsigned int i = 0; i < movingPoints.size(); ++i)
+  {
+    if (!movingTimestamps.empty() && movingTimestamps.back() == movingPoints[i].first)
     {
-      slidingSignalTimestamps.at(i) =  this->FixedSignal.signalTimestamps.at(i) + offsetValueSec;
+      movingValues.back() = movingPoints[i].second;
+      continue;
     }
+    movingTimestamps.push_back(movingPoints[i].first);
+    movingValues.push_back(movingPoints[i].second);
+  }
 
-    NormalizeMetricValues(this->FixedSignal.signalValues, this->FixedSignalValuesNormalizationFactor, slidingSignalTimestamps.front(), slidingSignalTimestamps.back(), this->FixedSignal.signalTimestamps);
+  // Compute alignment metric for each offset, in parallel. Normalization does not depend on the scale and offset of the input
+  // values, therefore the fixed signal can be normalized for each time offset independently from its current values.
+  const int numberOfOffsets = corrTimeOffsets.size();
+  std::vector<double> metricValues(numberOfOffsets, 0.0);
+  std::vector<double> normalizationFactors(numberOfOffsets, 1.0);
+  PlusWorkerPool::GetInstance().ParallelFor(0, numberOfOffsets, this->NumberOfThreads, [&](int firstOffsetIndex, int lastOffsetIndex)
+  {
+    std::vector<double> slidingSignalTimestamps(fixedTimestamps.size());
+    std::vector<double> normalizedFixedValues;
+    std::vector<double> resampledTrackerPositionMetric;
+    for (int offsetIndex = firstOffsetIndex; offsetIndex < lastOffsetIndex; ++offsetIndex)
+    {
+      const double offsetValueSec = corrTimeOffsets[offsetIndex];
+      for (unsigned int i = 0; i < slidingSignalTimestamps.size(); ++i)
+      {
+        slidingSignalTimestamps[i] = fixedTimestamps[i] + offsetValueSec;
+      }
 
-    ResampleSignalLinearly(slidingSignalTimestamps, trackerPositionPiecewiseSignal, resampledTrackerPositionMetric);
-    double normalizationFactor = 1.0;
-    NormalizeMetricValues(resampledTrackerPositionMetric, normalizationFactor);
-    normalizationFactors.push_back(normalizationFactor);
+      normalizedFixedValues = fixedValues;
+      double fixedNormalizationFactor = 1.0;
+      NormalizeMetricValues(normalizedFixedValues, fixedNormalizationFactor, slidingSignalTimestamps.front(), slidingSignalTimestamps.back(), fixedTimestamps);
 
-    corrValues.push_back(ComputeAlignmentMetric(this->FixedSignal.signalValues, resampledTrackerPositionMetric));
-  }
+      ResampleSignalLinearly(slidingSignalTimestamps, movingTimestamps, movingValues, resampledTrackerPositionMetric);
+      double normalizationFactor = 1.0;
+      NormalizeMetricValues(resampledTrackerPositionMetric, normalizationFactor);
+      normalizationFactors[offsetIndex] = normalizationFactor;
+
+      metricValues[offsetIndex] = ComputeAlignmentMetric(normalizedFixedValues, resampledTrackerPositionMetric);
+    }
+  });
+  corrValues.assign(metricValues.begin(), metricValues.end());
+
+  // Leave the fixed signal normalized for the last time offset, as if the offsets were processed one after the other
+  NormalizeMetricValues(this->FixedSignal.signalValues, this->FixedSignalValuesNormalizationFactor,
+                        fixedTimestamps.front() + corrTimeOffsets.back(), fixedTimestamps.back() + corrTimeOffsets.back(), this->FixedSignal.signalTimestamps);
 
   // Find the time offset that has the best alignment metric value
   bestCorrelationValue = corrValues.at(0);
@@ -509,7 +615,14 @@ void vtkPlusTemporalCalibrationAlgo::ComputeCorrelationBetweenFixedAndMovingSign
   LOG_DEBUG("numberOfSamples=" << corrValues.size());
 }
 
+//-----------------------------------------------------------------------------
 double vtkPlusTemporalCalibrationAlgo::ComputeAlignmentMetric(const std::deque<double>& signalA, const std::deque<double>& signalB)
+{
+  return ComputeAlignmentMetric(std::vector<double>(signalA.begin(), signalA.end()), std::vector<double>(signalB.begin(), signalB.end()));
+}
+
+//-----------------------------------------------------------------------------
+double vtkPlusTemporalCalibrationAlgo::ComputeAlignmentMetric(const std::vector<double>& signalA, const std::vector<double>& signalB)
 {
   if (signalA.size() != signalB.size())
   {
@@ -524,7 +637,7 @@ double vtkPlusTemporalCalibrationAlgo::ComputeAlignmentMetric(const std::deque<d
         double ssdSum = 0;
         for (unsigned int i = 0; i < signalA.size(); ++i)
         {
-          double diff = signalA.at(i) - signalB.at(i);     //SSD
+          double diff = signalA[i] - signalB[i];     //SSD
           ssdSum -= diff * diff;
         }
         return ssdSum;
@@ -535,7 +648,7 @@ double vtkPlusTemporalCalibrationAlgo::ComputeAlignmentMetric(const std::deque<d
         double xCorrSum = 0;
         for (unsigned int i = 0; i < signalA.size(); ++i)
         {
-          xCorrSum += signalA.at(i) * signalB.at(i);     // XCORR
+          xCorrSum += signalA[i] * signalB[i];     // XCORR
         }
         return xCorrSum;
       }
@@ -545,7 +658,7 @@ double vtkPlusTemporalCalibrationAlgo::ComputeAlignmentMetric(const std::deque<d
         double sadSum = 0;
         for (unsigned int i = 0; i < signalA.size(); ++i)
         {
-          sadSum -= fabs(signalA.at(i) - signalB.at(i));       //SAD
+          sadSum -= fabs(signalA[i] - signalB[i]);       //SAD
         }
         return sadSum;
       }
@@ -598,6 +711,7 @@ PlusStatus vtkPlusTemporalCalibrationAlgo::ComputePositionSignalValues(SignalTyp
         lineSegmenter->SetSignalTimeRange(signal.signalTimeRangeMin, signal.signalTimeRangeMax);
         lineSegmenter->SetSaveIntermediateImages(this->SaveIntermediateImages);
         lineSegmenter->SetIntermediateFilesOutputDirectory(this->IntermediateFilesOutputDirectory);
+        lineSegmenter->SetNumberOfThreads(this->NumberOfThreads);
         if (lineSegmenter->Update() != PLUS_SUCCESS)
         {
           LOG_ERROR("Failed to get line positions from video frames");
@@ -894,6 +1008,7 @@ PlusStatus vtkPlusTemporalCalibrationAlgo::ReadConfiguration(vtkXMLDataElement*
   }
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(SaveIntermediateImages, calibrationParameters);
   XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, MaximumMovingLagSec, calibrationParameters);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, NumberOfThreads, calibrationParameters);
 
   if (calibrationParameters != NULL)
   {
@@ -11,6 +11,7 @@
 #include "vtkPlusCalibrationExport.h"
 
 #include <deque>
+#include <vector>
 
 #include "vtkObject.h"
 
@@ -105,6 +106,10 @@ public:
   /*! Sets the maximum allowable time lag between the corresponding tracker and video frames. Default is 2 seconds */
   void SetMaximumMovingLagSec(double maxLagSec);
 
+  /*! Sets the number of threads that compute the signals and the correlations (0 = all threads of the shared worker pool). Default is 0. */
+  void SetNumberOfThreads(int numberOfThreads);
+  int GetNumberOfThreads() const;
+
   /*! Enable/disable saving of intermediate images for debugging. Need to call before SetVideoFrames. */
   void SetSaveIntermediateImages(bool saveIntermediateImages);
 
@@ -149,14 +154,28 @@ protected:
 
   PlusStatus NormalizeMetricValues(std::deque<double>& signal, double& normalizationFactor, int startIndex = 0, int stopIndex = -1);
   PlusStatus NormalizeMetricValues(std::deque<double>& signal, double& normalizationFactor, double startTime, double stopTime, const std::deque<double>& timestamps);
+  PlusStatus NormalizeMetricValues(std::vector<double>& signal, double& normalizationFactor, int startIndex = 0, int stopIndex = -1);
+  PlusStatus NormalizeMetricValues(std::vector<double>& signal, double& normalizationFactor, double startTime, double stopTime, const std::vector<double>& timestamps);
+
+  /*!
+    Compute the alignment metric of the fixed and the moving signal for each time offset in the range.
+    The offsets are evaluated in parallel, on contiguous copies of the signals.
+  */
   void ComputeCorrelationBetweenFixedAndMovingSignal(double minTrackerLagSec, double maxTrackerLagSec, double stepSizeSec, double& bestCorrelationValue, double& bestCorrelationTimeOffset, double& bestCorrelationNormalizationFactor, std::deque<double>& corrTimeOffsets, std::deque<double>& corrValues);
 
   double ComputeAlignmentMetric(const std::deque<double>& signalA, const std::deque<double>& signalB);
+  double ComputeAlignmentMetric(const std::vector<double>& signalA, const std::vector<double>& signalB);
 
   PlusStatus ConstructTableSignal(std::deque<double>& x, std::deque<double>& y, vtkTable* table, double timeCorrection);
 
   PlusStatus ResampleSignalLinearly(const std::deque<double>& templateSignalTimestamps, const vtkSmartPointer<vtkPiecewiseFunction>& signalFunction, std::deque<double>& resampledSignalValues);
 
+  /*!
+    Resample a signal by linear interpolation, the same way as a clamped piecewise function
+    \param signalTimestamps Timestamps of the signal, in increasing order
+  */
+  static void ResampleSignalLinearly(const std::vector<double>& templateSignalTimestamps, const std::vector<double>& signalTimestamps, const std::vector<double>& signalValues, std::vector<double>& resampledSignalValues);
+
 protected:
   SignalType FixedSignal;
   SignalType MovingSignal;
@@ -174,6 +193,9 @@ protected:
   /*! Resolution used for re-sampling [s]*/
   double SamplingResolutionSec;
 
+  /*! Number of threads that compute the signals and the correlations (0 = all threads of the shared worker pool) */
+  int NumberOfThreads;
+
   /*! The computed signal correlation values (corresponding to the better sign convention) */
   std::deque<double> CorrelationValues;
   /*! The time-offsets used to compute the correlations */
@@ -8,9 +8,19 @@ See License.txt for details.
 #define __PixelCodec_h
 
 #include "PlusConfigure.h"
+#include "PlusPixelKernels.h"
+#include "PlusWorkerPool.h"
 
+#include <algorithm>
+#include <atomic>
 #include <iomanip>
 
+// SSE2 is available on all x86-64 processors, so the vectorized conversions are selected at compile time
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define PLUS_PIXELCODEC_SSE2
+  #include <emmintrin.h>
+#endif
+
 // Helper macros for YUY2 conversion (source: http://sundararajana.blogspot.ca/2007/12/yuy2-to-rgb24-conversion.html)
 #define FIXNUM 16
 #define FIX(a, b) ((int)((a)*(1<<(b))))
@@ -143,8 +153,16 @@ public:
   }
 
   //----------------------------------------------------------------------------
-  static inline PlusStatus ConvertToGray(int inputCompression, int width, int height, unsigned char* s, unsigned char* d)
+  /*!
+  Convert an image to grayscale.
+  \param numberOfThreads If not 1 then the rows of the image are split between this many threads of the shared worker pool (0 = all threads of the pool)
+  */
+  static inline PlusStatus ConvertToGray(int inputCompression, int width, int height, unsigned char* s, unsigned char* d, int numberOfThreads = 1)
   {
+    if (numberOfThreads != 1 && (inputCompression == BI_RGB || inputCompression == VTK_BI_YUY2))
+    {
+      return ConvertToGray(inputCompression == BI_RGB ? PixelEncoding_RGB24 : PixelEncoding_YUY2, width, height, s, d, numberOfThreads);
+    }
     switch (inputCompression)
     {
       case BI_RGB:
@@ -166,8 +184,21 @@ public:
   }
 
   //----------------------------------------------------------------------------
-  static inline PlusStatus ConvertToGray(PixelEncoding inputCompression, int width, int height, unsigned char* s, unsigned char* d)
+  /*!
+  Convert an image to grayscale.
+  \param numberOfThreads If not 1 then the rows of the image are split between this many threads of the shared worker pool (0 = all threads of the pool)
+  */
+  static inline PlusStatus ConvertToGray(PixelEncoding inputCompression, int width, int height, unsigned char* s, unsigned char* d, int numberOfThreads = 1)
   {
+    const int inputRowSize = GetRowSize(inputCompression, width, 0);
+    if (numberOfThreads != 1 && inputRowSize > 0)
+    {
+      const int outputRowSize = GetRowSize(inputCompression, width, 1);
+      return ConvertRowsInParallel(height, numberOfThreads, [ = ](int firstRow, int numberOfRows)
+      {
+        return ConvertToGray(inputCompression, width, numberOfRows, s + firstRow * inputRowSize, d + firstRow * outputRowSize);
+      });
+    }
     switch (inputCompression)
     {
       case PixelEncoding_RGB24:
@@ -194,8 +225,21 @@ public:
   }
 
   //----------------------------------------------------------------------------
-  static inline PlusStatus ConvertToBmp24(ComponentOrdering outputOrdering, PixelEncoding inputCompression, int width, int height, unsigned char* s, unsigned char* d)
+  /*!
+  Convert an image to RGB24 or BGR24.
+  \param numberOfThreads If not 1 then the rows of the image are split between this many threads of the shared worker pool (0 = all threads of the pool)
+  */
+  static inline PlusStatus ConvertToBmp24(ComponentOrdering outputOrdering, PixelEncoding inputCompression, int width, int height, unsigned char* s, unsigned char* d, int numberOfThreads = 1)
   {
+    const int inputRowSize = GetRowSize(inputCompression, width, 0);
+    if (numberOfThreads != 1 && inputRowSize > 0)
+    {
+      const int outputRowSize = GetRowSize(inputCompression, width, 3);
+      return ConvertRowsInParallel(height, numberOfThreads, [ = ](int firstRow, int numberOfRows)
+      {
+        return ConvertToBmp24(outputOrdering, inputCompression, width, numberOfRows, s + firstRow * inputRowSize, d + firstRow * outputRowSize);
+      });
+    }
     switch (inputCompression)
     {
       case PixelEncoding_RGB24:
@@ -291,13 +335,7 @@ public:
   */
   static inline void Rgb24ToGray(int width, int height, unsigned char* s, unsigned char* d)
   {
-    int totalLen = width * height;
-    for (int i = 0; i < totalLen; i++)
-    {
-      *d = ((unsigned short)(s[0]) + s[1] + s[2]) / 3;
-      d++;
-      s += 3;
-    }
+    PlusPixelKernels::ColorToGray<3>(width * height, s, d);
   }
 
   //----------------------------------------------------------------------------
@@ -308,13 +346,35 @@ public:
   */
   static inline void Rgba32ToGray(int width, int height, unsigned char* s, unsigned char* d)
   {
+#ifdef PLUS_PIXELCODEC_SSE2
     int totalLen = width * height;
-    for (int i = 0; i < totalLen; i++)
+    const __m128i lowByteMask = _mm_set1_epi32(0xFF);
+    int i = 0;
+    for (; i + 16 <= totalLen; i += 16)
     {
-      *d = ((unsigned short)(s[0]) + s[1] + s[2]) / 3;
-      d++;
-      s += 4;
+      // 4 pixels in each register, sum of the R, G, B components in the 32-bit lanes
+      __m128i sums[4];
+      for (int j = 0; j < 4; j++)
+      {
+        const __m128i rgba = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 4 * (i + 4 * j)));
+        sums[j] = _mm_add_epi32(_mm_add_epi32(_mm_and_si128(rgba, lowByteMask),
+                                              _mm_and_si128(_mm_srli_epi32(rgba, 8), lowByteMask)),
+                                _mm_and_si128(_mm_srli_epi32(rgba, 16), lowByteMask));
+      }
+      const __m128i gray = _mm_packus_epi16(DivideBy3Sse2(_mm_packs_epi32(sums[0], sums[1])), DivideBy3Sse2(_mm_packs_epi32(sums[2], sums[3])));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(d + i), gray);
     }
+    Rgba32ToGrayScalar(totalLen - i, 1, s + 4 * i, d + i);
+#else
+    Rgba32ToGrayScalar(width, height, s, d);
+#endif
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Reference implementation of Rgba32ToGray, without vectorization */
+  static inline void Rgba32ToGrayScalar(int width, int height, unsigned char* s, unsigned char* d)
+  {
+    PlusPixelKernels::ColorToGray<4>(width * height, s, d);
   }
 
   //----------------------------------------------------------------------------
@@ -367,7 +427,7 @@ public:
   //----------------------------------------------------------------------------
   static PlusStatus MjpgToRgb24(ComponentOrdering outputOrdering, int width, int height, unsigned char* s, unsigned char* d)
   {
-    LOG_ERROR("MJPEG is not supported yet");
+    LOG_ERROR("MJPEG frames cannot be converted without the size of the compressed data, use PlusMjpegDecoder instead");
     return PLUS_FAIL;
   }
 
@@ -378,6 +438,38 @@ public:
   source: http://sundararajana.blogspot.ca/2007/12/yuy2-to-rgb24-conversion.html
   */
   static PlusStatus Yuv422pToBmp24(ComponentOrdering outputOrdering, int width, int height, unsigned char* s, unsigned char* d)
+  {
+#ifdef PLUS_PIXELCODEC_SSE2
+    // 4 macropixels (8 pixels) are converted at once, the components are interleaved from temporary arrays
+    int size = height * (width / 2);
+    unsigned char* rDest = (outputOrdering == ComponentOrder_BGR ? d + 2 : d);
+    unsigned char* bDest = (outputOrdering == ComponentOrder_BGR ? d : d + 2);
+    unsigned char r[16], g[16], b[16];
+    int i = 0;
+    for (; i + 4 <= size; i += 4)
+    {
+      __m128i rgb[3];
+      Yuv422pToRgbSse2(s + 4 * i, rgb);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(r), _mm_packus_epi16(rgb[0], rgb[0]));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(g), _mm_packus_epi16(rgb[1], rgb[1]));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(b), _mm_packus_epi16(rgb[2], rgb[2]));
+      unsigned long dstIndex = 6 * i;
+      for (int j = 0; j < 8; j++, dstIndex += 3)
+      {
+        rDest[dstIndex] = r[j];
+        d[dstIndex + 1] = g[j];
+        bDest[dstIndex] = b[j];
+      }
+    }
+    return Yuv422pToBmp24Scalar(outputOrdering, 2 * (size - i), 1, s + 4 * i, d + 6 * i);
+#else
+    return Yuv422pToBmp24Scalar(outputOrdering, width, height, s, d);
+#endif
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Reference implementation of Yuv422pToBmp24, without vectorization */
+  static PlusStatus Yuv422pToBmp24Scalar(ComponentOrdering outputOrdering, int width, int height, unsigned char* s, unsigned char* d)
   {
     unsigned char* p_dest;
     unsigned char y1, u, y2, v;
@@ -473,6 +565,27 @@ public:
   source: http://sundararajana.blogspot.ca/2007/12/yuy2-to-rgb24-conversion.html
   */
   static void Yuv422pToGray(int width, int height, unsigned char* s, unsigned char* d)
+  {
+#ifdef PLUS_PIXELCODEC_SSE2
+    // 4 macropixels (8 pixels) are converted at once
+    int size = height * (width / 2);
+    int i = 0;
+    for (; i + 4 <= size; i += 4)
+    {
+      __m128i rgb[3];
+      Yuv422pToRgbSse2(s + 4 * i, rgb);
+      const __m128i gray = DivideBy3Sse2(_mm_add_epi16(_mm_add_epi16(rgb[0], rgb[1]), rgb[2]));
+      _mm_storel_epi64(reinterpret_cast<__m128i*>(d + 2 * i), _mm_packus_epi16(gray, gray));
+    }
+    Yuv422pToGrayScalar(2 * (size - i), 1, s + 4 * i, d + 2 * i);
+#else
+    Yuv422pToGrayScalar(width, height, s, d);
+#endif
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Reference implementation of Yuv422pToGray, without vectorization */
+  static void Yuv422pToGrayScalar(int width, int height, unsigned char* s, unsigned char* d)
   {
     int i;
     unsigned char* p_dest;
@@ -517,6 +630,124 @@ public:
   }
 
 private:
+  /*! Parallel conversion does not split the image into parts smaller than this, to keep the thread overhead low */
+  static const int MINIMUM_ROWS_PER_THREAD = 16;
+
+  //----------------------------------------------------------------------------
+  /*!
+  Size of an image row in bytes in the input (outputBytesPerPixel = 0) or in the output of a conversion.
+  YUY2 conversions process width/2 macropixels in each row, therefore the last column of odd width images is not
+  included. Returns 0 for encodings that cannot be converted row by row.
+  */
+  static int GetRowSize(PixelEncoding inputCompression, int width, int outputBytesPerPixel)
+  {
+    switch (inputCompression)
+    {
+      case PixelEncoding_RGB24:
+      case PixelEncoding_BGR24:
+        return width * (outputBytesPerPixel > 0 ? outputBytesPerPixel : 3);
+      case PixelEncoding_RGBA32:
+        return width * (outputBytesPerPixel > 0 ? outputBytesPerPixel : 4);
+      case PixelEncoding_YUY2:
+        return 2 * (width / 2) * (outputBytesPerPixel > 0 ? outputBytesPerPixel : 2);
+      default:
+        return 0;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /*!
+  Split the rows of an image between the threads of the shared worker pool (see PlusWorkerPool).
+  convertRows(firstRow, numberOfRows) converts a range of rows, the first range is converted on the calling thread.
+  */
+  template<typename RowConversion>
+  static PlusStatus ConvertRowsInParallel(int height, int numberOfThreads, RowConversion convertRows)
+  {
+    PlusWorkerPool& workerPool = PlusWorkerPool::GetInstance();
+    if (numberOfThreads < 1)
+    {
+      numberOfThreads = workerPool.GetNumberOfThreads() + 1;
+    }
+    numberOfThreads = std::min(numberOfThreads, std::max(1, height / MINIMUM_ROWS_PER_THREAD));
+    if (numberOfThreads == 1)
+    {
+      return convertRows(0, height);
+    }
+
+    std::atomic<bool> failed(false);
+    workerPool.ParallelFor(0, height, numberOfThreads, [&failed, &convertRows](int firstRow, int lastRow)
+    {
+      if (convertRows(firstRow, lastRow - firstRow) != PLUS_SUCCESS)
+      {
+        failed = true;
+      }
+    });
+    return failed ? PLUS_FAIL : PLUS_SUCCESS;
+  }
+
+#ifdef PLUS_PIXELCODEC_SSE2
+  //----------------------------------------------------------------------------
+  /*! Integer division of 16-bit values in the 0..765 range by 3 */
+  static inline __m128i DivideBy3Sse2(__m128i values)
+  {
+    return _mm_srli_epi16(_mm_mulhi_epu16(values, _mm_set1_epi16((short)0xAAAB)), 1);
+  }
+
+  //----------------------------------------------------------------------------
+  /*!
+  Truncating division of signed 16-bit values in the -256..256 range by 1+fraction/65536.
+  Computed on the absolute value, because the division in ICCIRY and ICCIRUV truncates towards zero.
+  */
+  static inline __m128i ScaleSse2(__m128i values, short fraction)
+  {
+    const __m128i sign = _mm_srai_epi16(values, 15);
+    const __m128i absValues = _mm_sub_epi16(_mm_xor_si128(values, sign), sign);
+    const __m128i scaled = _mm_add_epi16(absValues, _mm_mulhi_epu16(absValues, _mm_set1_epi16(fraction)));
+    return _mm_sub_epi16(_mm_xor_si128(scaled, sign), sign);
+  }
+
+  //----------------------------------------------------------------------------
+  /*!
+  Converts 4 YUY2 macropixels (16 bytes) to clipped R, G, B values of 8 pixels, in 16-bit lanes.
+  Gives exactly the same result as ICCIRY, ICCIRUV, GET_*_FROM_YUV and CLIP in Yuv422pToBmp24Scalar.
+  */
+  static inline void Yuv422pToRgbSse2(const unsigned char* s, __m128i rgb[3])
+  {
+    const __m128i yuy2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+
+    // ICCIRY: t*256/219 = t + t*37/219, computed as t + t*11073/65536, which is exact for all 8-bit inputs
+    const __m128i y = ScaleSse2(_mm_sub_epi16(_mm_and_si128(yuy2, _mm_set1_epi16(0xFF)), _mm_set1_epi16(16)), 11073);
+    // ICCIRUV: t*256/224 = t + t/7, computed as t + t*9363/65536. U and V of each macropixel are next to each other: U0 V0 U1 V1 ...
+    const __m128i uv = ScaleSse2(_mm_sub_epi16(_mm_srli_epi16(yuy2, 8), _mm_set1_epi16(128)), 9363);
+
+    // Fixed point coefficients are split to an integer and a 16-bit fractional part, so that the products
+    // of each macropixel can be computed by one multiply-add. Coefficient pairs are (U, V).
+    const __m128i u32 = _mm_srai_epi32(_mm_slli_epi32(uv, 16), 16);
+    const __m128i v32 = _mm_srai_epi32(uv, 16);
+    const __m128i round = _mm_set1_epi32(32768);
+    // FIX(1.402) = 65536 + 26345
+    const __m128i rOffset = _mm_add_epi32(v32,
+                                          _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(uv, _mm_set_epi16(26345, 0, 26345, 0, 26345, 0, 26345, 0)), round), 16));
+    // FIX(-0.344) = -22544, FIX(-0.714) = -65536 + 18744
+    const __m128i gOffset = _mm_sub_epi32(_mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(uv, _mm_set_epi16(18744, -22544, 18744, -22544, 18744, -22544, 18744, -22544)), round), 16),
+                                          v32);
+    // FIX(1.772) = 2 * 65536 - 14943
+    const __m128i bOffset = _mm_add_epi32(_mm_add_epi32(u32, u32),
+                                          _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(uv, _mm_set_epi16(0, -14943, 0, -14943, 0, -14943, 0, -14943)), round), 16));
+
+    const __m128i minValue = _mm_setzero_si128();
+    const __m128i maxValue = _mm_set1_epi16(255);
+    const __m128i offsets[3] = { rOffset, gOffset, bOffset };
+    for (int component = 0; component < 3; component++)
+    {
+      // Both pixels of a macropixel have the same offset
+      const __m128i offset16 = _mm_packs_epi32(offsets[component], offsets[component]);
+      const __m128i value = _mm_add_epi16(y, _mm_unpacklo_epi16(offset16, offset16));
+      rgb[component] = _mm_min_epi16(_mm_max_epi16(value, minValue), maxValue);
+    }
+  }
+#endif
+
   PixelCodec(); // prevent instantiation
 };
 
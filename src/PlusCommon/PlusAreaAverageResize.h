@@ -0,0 +1,257 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusAreaAverageResize_h
+#define __PlusAreaAverageResize_h
+
+#include "PlusConfigure.h"
+#include "PlusPixelKernels.h"
+
+#include <vtkType.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+/*!
+\class PlusAreaAverageResize
+\brief Crops a rectangle of an image and shrinks it by area averaging, in a single pass
+
+Each output pixel is the average of the input pixels that it covers, weighted by the covered area, so the result is
+free of aliasing at any (not only integer) reduction factor. The filter is separable: the input rows that contribute
+to an output row are accumulated with their weights into a row of floats, then the columns of the accumulated row are
+combined into the output pixels. Accumulating 8-bit rows, which is where most of the time is spent, is vectorized
+with SSE2 when it is available.
+
+Every slice of the image is cropped and resized the same way, components are averaged independently.
+
+\ingroup PlusLibCommon
+*/
+class PlusAreaAverageResize
+{
+public:
+  //----------------------------------------------------------------------------
+  /*! Returns the size of the output image for a crop rectangle size and scale factor, each size is at least 1 pixel */
+  static std::array<int, 2> GetOutputSize(const std::array<int, 2>& cropSize, double scale)
+  {
+    std::array<int, 2> outputSize;
+    for (int axis = 0; axis < 2; axis++)
+    {
+      outputSize[axis] = std::max(1, std::min(cropSize[axis], static_cast<int>(std::floor(cropSize[axis] * scale + 0.5))));
+    }
+    return outputSize;
+  }
+
+  //----------------------------------------------------------------------------
+  /*!
+    Crops the cropOrigin, cropSize rectangle of each slice of the input image and resizes it to outputSize, which must not
+    be larger than cropSize. The output buffer must hold outputSize[0] * outputSize[1] * inputSize[2] pixels.
+  */
+  static PlusStatus Resize(const void* input, const FrameSizeType& inputSize, igsioCommon::VTKScalarPixelType scalarType, unsigned int numberOfScalarComponents,
+                           const std::array<int, 2>& cropOrigin, const std::array<int, 2>& cropSize, const std::array<int, 2>& outputSize, void* output)
+  {
+    if (input == NULL || output == NULL || numberOfScalarComponents == 0)
+    {
+      LOG_ERROR("PlusAreaAverageResize::Resize failed: invalid input or output buffer");
+      return PLUS_FAIL;
+    }
+    for (int axis = 0; axis < 2; axis++)
+    {
+      if (cropOrigin[axis] < 0 || cropSize[axis] <= 0 || static_cast<unsigned int>(cropOrigin[axis] + cropSize[axis]) > inputSize[axis]
+          || outputSize[axis] <= 0 || outputSize[axis] > cropSize[axis])
+      {
+        LOG_ERROR("PlusAreaAverageResize::Resize failed: crop rectangle (" << cropOrigin[0] << ", " << cropOrigin[1] << ") size ("
+                  << cropSize[0] << ", " << cropSize[1] << ") is outside of the " << inputSize[0] << "x" << inputSize[1]
+                  << " image or cannot be shrunk to " << outputSize[0] << "x" << outputSize[1]);
+        return PLUS_FAIL;
+      }
+    }
+
+    switch (scalarType)
+    {
+      case VTK_CHAR:
+        ResizeTyped(static_cast<const char*>(input), inputSize, numberOfScalarComponents, cropOrigin, cropSize, outputSize, static_cast<char*>(output));
+        return PLUS_SUCCESS;
+      case VTK_SIGNED_CHAR:
+        ResizeTyped(static_cast<const signed char*>(input), inputSize, numberOfScalarComponents, cropOrigin, cropSize, outputSize, static_cast<signed char*>(output));
+        return PLUS_SUCCESS;
+      case VTK_UNSIGNED_CHAR:
+        ResizeTyped(static_cast<const unsigned char*>(input), inputSize, numberOfScalarComponents, cropOrigin, cropSize, outputSize, static_cast<unsigned char*>(output));
+        return PLUS_SUCCESS;
+      case VTK_SHORT:
+        ResizeTyped(static_cast<const short*>(input), inputSize, numberOfScalarComponents, cropOrigin, cropSize, outputSize, static_cast<short*>(output));
+        return PLUS_SUCCESS;
+      case VTK_UNSIGNED_SHORT:
+        ResizeTyped(static_cast<const unsigned short*>(input), inputSize, numberOfScalarComponents, cropOrigin, cropSize, outputSize, static_cast<unsigned short*>(output));
+        return PLUS_SUCCESS;
+      case VTK_INT:
+        ResizeTyped(static_cast<const int*>(input), inputSize, numberOfScalarComponents, cropOrigin, cropSize, outputSize, static_cast<int*>(output));
+        return PLUS_SUCCESS;
+      case VTK_UNSIGNED_INT:
+        ResizeTyped(static_cast<const unsigned int*>(input), inputSize, numberOfScalarComponents, cropOrigin, cropSize, outputSize, static_cast<unsigned int*>(output));
+        return PLUS_SUCCESS;
+      case VTK_FLOAT:
+        ResizeTyped(static_cast<const float*>(input), inputSize, numberOfScalarComponents, cropOrigin, cropSize, outputSize, static_cast<float*>(output));
+        return PLUS_SUCCESS;
+      case VTK_DOUBLE:
+        ResizeTyped(static_cast<const double*>(input), inputSize, numberOfScalarComponents, cropOrigin, cropSize, outputSize, static_cast<double*>(output));
+        return PLUS_SUCCESS;
+      default:
+        LOG_ERROR("PlusAreaAverageResize::Resize failed: unsupported scalar type " << scalarType);
+        return PLUS_FAIL;
+    }
+  }
+
+protected:
+  /*! Contribution of an input pixel to an output pixel */
+  struct Tap
+  {
+    int Index;
+    float Weight;
+  };
+
+  //----------------------------------------------------------------------------
+  /*!
+    Computes the input pixels covered by each output pixel along one axis. The taps of output pixel i are
+    taps[firstTap[i]] ... taps[firstTap[i + 1] - 1], their weights sum to 1.
+  */
+  static void ComputeTaps(int inputSize, int outputSize, std::vector<Tap>& taps, std::vector<int>& firstTap)
+  {
+    const double step = static_cast<double>(inputSize) / outputSize;
+    taps.clear();
+    firstTap.resize(outputSize + 1);
+    for (int i = 0; i < outputSize; i++)
+    {
+      firstTap[i] = static_cast<int>(taps.size());
+      const double start = i * step;
+      const double end = (i + 1 == outputSize) ? inputSize : (i + 1) * step;
+      for (int index = static_cast<int>(std::floor(start)); index < end && index < inputSize; index++)
+      {
+        double covered = std::min<double>(end, index + 1) - std::max<double>(start, index);
+        if (covered <= 1e-9)
+        {
+          continue;
+        }
+        Tap tap = { index, static_cast<float>(covered / (end - start)) };
+        taps.push_back(tap);
+      }
+    }
+    firstTap[outputSize] = static_cast<int>(taps.size());
+  }
+
+  //----------------------------------------------------------------------------
+  template<typename ScalarType>
+  static void AccumulateRow(const ScalarType* inputRow, float weight, unsigned int numberOfScalars, float* accumulator)
+  {
+    for (unsigned int i = 0; i < numberOfScalars; i++)
+    {
+      accumulator[i] += weight * static_cast<float>(inputRow[i]);
+    }
+  }
+
+#ifdef PLUS_PIXELKERNELS_SSE2
+  //----------------------------------------------------------------------------
+  /*! Vectorized accumulation of 8-bit rows, the most common case */
+  static void AccumulateRow(const unsigned char* inputRow, float weight, unsigned int numberOfScalars, float* accumulator)
+  {
+    const __m128 weights = _mm_set1_ps(weight);
+    const __m128i zero = _mm_setzero_si128();
+    unsigned int i = 0;
+    for (; i + 16 <= numberOfScalars; i += 16)
+    {
+      __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(inputRow + i));
+      __m128i low = _mm_unpacklo_epi8(bytes, zero);
+      __m128i high = _mm_unpackhi_epi8(bytes, zero);
+      __m128 values[4] =
+      {
+        _mm_cvtepi32_ps(_mm_unpacklo_epi16(low, zero)),
+        _mm_cvtepi32_ps(_mm_unpackhi_epi16(low, zero)),
+        _mm_cvtepi32_ps(_mm_unpacklo_epi16(high, zero)),
+        _mm_cvtepi32_ps(_mm_unpackhi_epi16(high, zero))
+      };
+      for (int j = 0; j < 4; j++)
+      {
+        __m128 sum = _mm_add_ps(_mm_loadu_ps(accumulator + i + j * 4), _mm_mul_ps(weights, values[j]));
+        _mm_storeu_ps(accumulator + i + j * 4, sum);
+      }
+    }
+    for (; i < numberOfScalars; i++)
+    {
+      accumulator[i] += weight * static_cast<float>(inputRow[i]);
+    }
+  }
+#endif
+
+  //----------------------------------------------------------------------------
+  template<typename ScalarType>
+  static void StoreRounded(float value, ScalarType& output)
+  {
+    output = static_cast<ScalarType>(std::floor(value + 0.5f));
+  }
+
+  //----------------------------------------------------------------------------
+  static void StoreRounded(float value, float& output)
+  {
+    output = value;
+  }
+
+  //----------------------------------------------------------------------------
+  static void StoreRounded(float value, double& output)
+  {
+    output = value;
+  }
+
+  //----------------------------------------------------------------------------
+  template<typename ScalarType>
+  static void ResizeTyped(const ScalarType* input, const FrameSizeType& inputSize, unsigned int numberOfScalarComponents,
+                          const std::array<int, 2>& cropOrigin, const std::array<int, 2>& cropSize, const std::array<int, 2>& outputSize, ScalarType* output)
+  {
+    std::vector<Tap> tapsX;
+    std::vector<Tap> tapsY;
+    std::vector<int> firstTapX;
+    std::vector<int> firstTapY;
+    ComputeTaps(cropSize[0], outputSize[0], tapsX, firstTapX);
+    ComputeTaps(cropSize[1], outputSize[1], tapsY, firstTapY);
+
+    const unsigned int components = numberOfScalarComponents;
+    const unsigned int rowScalars = cropSize[0] * components;
+    const size_t inputRowStride = static_cast<size_t>(inputSize[0]) * components;
+    const size_t inputSliceStride = inputRowStride * inputSize[1];
+    std::vector<float> accumulator(rowScalars);
+
+    for (unsigned int z = 0; z < inputSize[2]; z++)
+    {
+      const ScalarType* cropStart = input + z * inputSliceStride + cropOrigin[1] * inputRowStride + cropOrigin[0] * components;
+      for (int outputY = 0; outputY < outputSize[1]; outputY++)
+      {
+        // Vertical pass: weighted sum of the input rows covered by the output row
+        std::fill(accumulator.begin(), accumulator.end(), 0.0f);
+        for (int tapIndex = firstTapY[outputY]; tapIndex < firstTapY[outputY + 1]; tapIndex++)
+        {
+          AccumulateRow(cropStart + tapsY[tapIndex].Index * inputRowStride, tapsY[tapIndex].Weight, rowScalars, &accumulator[0]);
+        }
+
+        // Horizontal pass: weighted sum of the accumulated columns covered by each output pixel
+        for (int outputX = 0; outputX < outputSize[0]; outputX++)
+        {
+          for (unsigned int component = 0; component < components; component++)
+          {
+            float value = 0.0f;
+            for (int tapIndex = firstTapX[outputX]; tapIndex < firstTapX[outputX + 1]; tapIndex++)
+            {
+              value += tapsX[tapIndex].Weight * accumulator[tapsX[tapIndex].Index * components + component];
+            }
+            StoreRounded(value, *(output++));
+          }
+        }
+      }
+    }
+  }
+};
+
+
+#endif
@@ -10,6 +10,7 @@
 
 #include "vnl/vnl_sparse_matrix.h"
 #include "vnl/vnl_sparse_matrix_linear_system.h"
+#include "vnl/algo/vnl_cholesky.h"
 #include "vnl/algo/vnl_lsqr.h"
 #include "vnl/vnl_cross.h"
 
@@ -18,6 +19,45 @@
 
 #define MINIMUM_NUMBER_OF_CALIBRATION_EQUATIONS 8
 
+// Solving the normal equations squares the condition number of the system, if the reciprocal condition number
+// of A^T*A is below this value then the iterative LSQR solver is used instead
+static const double MINIMUM_NORMAL_EQUATIONS_RCOND = 1e-12;
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  /*!
+    Add (sign = 1) or subtract (sign = -1) the contribution of the listed rows of Ax = b to the normal equations
+    (A^T*A)x = A^T*b. Only the upper triangle is accumulated, the lower triangle is mirrored at the end.
+  */
+  void AccumulateNormalEquations(const vnl_matrix<double>& aMatrix, const vnl_vector<double>& bVector, const std::vector<unsigned int>& rows, double sign,
+                                 vnl_matrix<double>& ataMatrix, vnl_vector<double>& atbVector)
+  {
+    const unsigned int numberOfUnknowns = aMatrix.cols();
+    for (std::vector<unsigned int>::const_iterator rowIt = rows.begin(); rowIt != rows.end(); ++rowIt)
+    {
+      const double* row = aMatrix[*rowIt];
+      for (unsigned int i = 0; i < numberOfUnknowns; ++i)
+      {
+        const double a = sign * row[i];
+        double* ataRow = ataMatrix[i];
+        for (unsigned int j = i; j < numberOfUnknowns; ++j)
+        {
+          ataRow[j] += a * row[j];
+        }
+        atbVector[i] += a * bVector[*rowIt];
+      }
+    }
+    for (unsigned int i = 1; i < numberOfUnknowns; ++i)
+    {
+      for (unsigned int j = 0; j < i; ++j)
+      {
+        ataMatrix[i][j] = ataMatrix[j][i];
+      }
+    }
+  }
+}
+
 //----------------------------------------------------------------------------
 PlusMath::PlusMath()
 {
@@ -52,18 +92,16 @@ PlusStatus PlusMath::LSQRMinimize(const std::vector< std::vector<double> >& aMat
   const int n = aMatrix.begin()->size();
   const int m = bVector.size();
 
-  std::vector<vnl_vector<double> > aMatrixVnl(m);
-  vnl_vector<double> row(n);
-  for (unsigned int i = 0; i < aMatrix.size(); ++i)
+  vnl_matrix<double> aMatrixVnl(m, n, 0.0);
+  for (int row = 0; row < m && row < static_cast<int>(aMatrix.size()); ++row)
   {
-    for (unsigned int r = 0; r < aMatrix[i].size(); ++r)
+    for (int i = 0; i < n && i < static_cast<int>(aMatrix[row].size()); ++i)
     {
-      row[r] = aMatrix[i][r];
+      aMatrixVnl(row, i) = aMatrix[row][i];
     }
-    aMatrixVnl.push_back(row);
   }
 
-  return PlusMath::LSQRMinimize(aMatrixVnl, bVector, resultVector, mean, stdev, notOutliersIndices);
+  return PlusMath::LSQRMinimize(aMatrixVnl, vnl_vector<double>(bVector.data(), m), resultVector, mean, stdev, notOutliersIndices);
 }
 
 //----------------------------------------------------------------------------
@@ -88,22 +126,172 @@ PlusStatus PlusMath::LSQRMinimize(const std::vector< vnl_vector<double> >& aMatr
   const int n = aMatrix.begin()->size();
   const int m = bVector.size();
 
-  vnl_sparse_matrix<double> sparseMatrixLeftSide(m, n);
-  vnl_vector<double> vectorRightSide(m);
-
+  vnl_matrix<double> aMatrixVnl(m, n);
   for (int row = 0; row < m; row++)
   {
-    // Populate the sparse matrix
-    for (int i = 0; i < n; i++)
+    aMatrixVnl.set_row(row, aMatrix[row]);
+  }
+
+  return PlusMath::LSQRMinimize(aMatrixVnl, vnl_vector<double>(bVector.data(), m), resultVector, mean, stdev, notOutliersIndices);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusMath::LSQRMinimize(const vnl_matrix<double>& aMatrix, const vnl_vector<double>& bVector, vnl_vector<double>& resultVector, double* mean/*=NULL*/, double* stdev/*=NULL*/, vnl_vector<unsigned int>* notOutliersIndices/*=NULL*/)
+{
+  LOG_TRACE("PlusMath::LSQRMinimize");
+
+  const unsigned int numberOfEquations = aMatrix.rows();
+  const unsigned int numberOfUnknowns = aMatrix.cols();
+  if (numberOfEquations == 0 || numberOfUnknowns == 0)
+  {
+    LOG_ERROR("LSQRMinimize: A matrix is empty");
+    resultVector.clear();
+    return PLUS_FAIL;
+  }
+  if (bVector.size() != numberOfEquations)
+  {
+    LOG_ERROR("Input A matrix and b vector dimensions were not met (number of equations were not the same)!");
+    resultVector.clear();
+    return PLUS_FAIL;
+  }
+  if (notOutliersIndices != NULL && notOutliersIndices->size() != numberOfEquations)
+  {
+    LOG_ERROR("LSQRMinimize: the number of not outlier indices (" << notOutliersIndices->size() << ") does not match the number of equations (" << numberOfEquations << ")");
+    return PLUS_FAIL;
+  }
+
+  // Rows of A that have not been rejected as outliers
+  std::vector<unsigned int> activeRows(numberOfEquations);
+  for (unsigned int row = 0; row < numberOfEquations; ++row)
+  {
+    activeRows[row] = row;
+  }
+
+  vnl_matrix<double> ataMatrix(numberOfUnknowns, numberOfUnknowns, 0.0);
+  vnl_vector<double> atbVector(numberOfUnknowns, 0.0);
+  AccumulateNormalEquations(aMatrix, bVector, activeRows, 1.0, ataMatrix, atbVector);
+
+  std::vector<unsigned int> keptRows;
+  std::vector<unsigned int> outlierRows;
+  std::vector<double> differences(numberOfEquations, 0.0);
+  const double thresholdMultiplier = 3.0;
+  bool outlierFound(true);
+
+  while (outlierFound && (activeRows.size() > MINIMUM_NUMBER_OF_CALIBRATION_EQUATIONS))
+  {
+    vnl_cholesky cholesky(ataMatrix, vnl_cholesky::estimate_condition);
+    if (cholesky.rank_deficiency() > 0 || cholesky.rcond() < MINIMUM_NORMAL_EQUATIONS_RCOND)
+    {
+      LOG_DEBUG("Normal equations are ill-conditioned, solving the remaining " << activeRows.size() << " equations with LSQR");
+      vnl_sparse_matrix<double> sparseMatrixLeftSide(activeRows.size(), numberOfUnknowns);
+      vnl_vector<double> vectorRightSide(activeRows.size());
+      vnl_vector<unsigned int> activeNotOutliersIndices(activeRows.size());
+      for (unsigned int i = 0; i < activeRows.size(); ++i)
+      {
+        for (unsigned int j = 0; j < numberOfUnknowns; ++j)
+        {
+          sparseMatrixLeftSide(i, j) = aMatrix(activeRows[i], j);
+        }
+        vectorRightSide[i] = bVector[activeRows[i]];
+        activeNotOutliersIndices[i] = (notOutliersIndices != NULL ? (*notOutliersIndices)[activeRows[i]] : activeRows[i]);
+      }
+      resultVector.set_size(numberOfUnknowns);
+      resultVector.fill(0.0);
+      PlusStatus status = PlusMath::LSQRMinimize(sparseMatrixLeftSide, vectorRightSide, resultVector, mean, stdev, &activeNotOutliersIndices);
+      if (notOutliersIndices != NULL)
+      {
+        *notOutliersIndices = activeNotOutliersIndices;
+      }
+      return status;
+    }
+    resultVector = cholesky.solve(atbVector);
+
+    // Compute the difference between the measured and computed data ( Ax - b ) and its statistics
+    double meanDifference = 0.0;
+    for (std::vector<unsigned int>::iterator rowIt = activeRows.begin(); rowIt != activeRows.end(); ++rowIt)
+    {
+      const double* row = aMatrix[*rowIt];
+      double difference = -bVector[*rowIt];
+      for (unsigned int i = 0; i < numberOfUnknowns; ++i)
+      {
+        difference += row[i] * resultVector[i];
+      }
+      differences[*rowIt] = difference;
+      meanDifference += difference;
+    }
+    meanDifference /= activeRows.size();
+    double variance = 0.0;
+    for (std::vector<unsigned int>::iterator rowIt = activeRows.begin(); rowIt != activeRows.end(); ++rowIt)
+    {
+      variance += (differences[*rowIt] - meanDifference) * (differences[*rowIt] - meanDifference);
+    }
+    const double stdevDifference = sqrt(variance / activeRows.size());
+
+    LOG_DEBUG("Mean = " << std::fixed << meanDifference << "   Stdev = " << stdevDifference);
+    if (mean != NULL)
+    {
+      *mean = meanDifference;
+    }
+    if (stdev != NULL)
     {
-      sparseMatrixLeftSide(row, i) = aMatrix[row].get(i);
+      *stdev = stdevDifference;
     }
 
-    // Populate the vector
-    vectorRightSide.put(row, bVector[row]);
+    // If the difference from mean larger than thresholdMultiplier * stdev, remove it from equation
+    keptRows.clear();
+    outlierRows.clear();
+    for (std::vector<unsigned int>::iterator rowIt = activeRows.begin(); rowIt != activeRows.end(); ++rowIt)
+    {
+      if (fabs(differences[*rowIt] - meanDifference) < thresholdMultiplier * stdevDifference)
+      {
+        keptRows.push_back(*rowIt);
+      }
+      else
+      {
+        outlierRows.push_back(*rowIt);
+        LOG_DEBUG("Outlier: " << std::fixed << differences[*rowIt] << "(mean: " << meanDifference << "  stdev: " << stdevDifference << "  outlierTreshold: " << thresholdMultiplier * stdevDifference << ")");
+      }
+    }
+
+    outlierFound = !outlierRows.empty();
+    if (!outlierFound)
+    {
+      LOG_DEBUG("*** Outlier removal was successful! No more outlier found!");
+      break;
+    }
+
+    if (outlierRows.size() < keptRows.size())
+    {
+      // Downdate the normal equations with the outlier rows
+      AccumulateNormalEquations(aMatrix, bVector, outlierRows, -1.0, ataMatrix, atbVector);
+    }
+    else
+    {
+      // Most rows are removed, it is cheaper and more accurate to form the normal equations of the remaining rows again
+      ataMatrix.fill(0.0);
+      atbVector.fill(0.0);
+      AccumulateNormalEquations(aMatrix, bVector, keptRows, 1.0, ataMatrix, atbVector);
+    }
+    activeRows.swap(keptRows);
+
+    if (activeRows.size() <= MINIMUM_NUMBER_OF_CALIBRATION_EQUATIONS)
+    {
+      LOG_ERROR("It was not possible calibrate! Not enough equations!");
+      return PLUS_FAIL;
+    }
+  }
+
+  if (notOutliersIndices != NULL)
+  {
+    vnl_vector<unsigned int> activeNotOutliersIndices(activeRows.size());
+    for (unsigned int i = 0; i < activeRows.size(); ++i)
+    {
+      activeNotOutliersIndices[i] = (*notOutliersIndices)[activeRows[i]];
+    }
+    *notOutliersIndices = activeNotOutliersIndices;
   }
 
-  return PlusMath::LSQRMinimize(sparseMatrixLeftSide, vectorRightSide, resultVector, mean, stdev, notOutliersIndices);
+  return PLUS_SUCCESS;
 }
 
 
@@ -12,6 +12,7 @@
 
 #include <vector>
 
+#include "vnl/vnl_matrix.h"
 #include "vnl/vnl_matrix_fixed.h"
 #include "vnl/vnl_vector.h"
 #include "vnl/vnl_sparse_matrix.h"
@@ -67,6 +68,19 @@ public:
     \param resultVector to store the results
   */
   static PlusStatus LSQRMinimize(const vnl_sparse_matrix<double> &sparseMatrixLeftSide, const vnl_vector<double> &vectorRightSide, vnl_vector<double> &resultVector, double* mean = NULL, double* stdev = NULL, vnl_vector<unsigned int>* notOutliersIndices=NULL); 
+  /*!
+    Solve Ax = b dense linear equations with robust linear least squares method (normal equations and outlier removal).
+    The normal equations are formed once and the rows that are rejected as outliers are removed from them (downdated),
+    so an outlier rejection iteration only costs the computation of the residuals and the factorization of an n-by-n matrix.
+    Ill-conditioned systems are solved with the sparse LSQR method instead.
+    \param aMatrix The coefficient matrix of size m-by-n, in contiguous (row-major) storage.
+    \param bVector Column vector of length m.
+    \param mean Pointer to get the resulting mean of the the LSQR fit error
+    \param stdev Pointer to get the resulting standard deviation of the the LSQR fit error
+    \param resultVector to store the results
+    \param notOutlierIndices Row that were not removed during the outliers rejection process
+  */
+  static PlusStatus LSQRMinimize(const vnl_matrix<double> &aMatrix, const vnl_vector<double> &bVector, vnl_vector<double> &resultVector, double* mean = NULL, double* stdev = NULL, vnl_vector<unsigned int>* notOutliersIndices=NULL);
 
   /*! Convert matrix between VTK and VNL */
   static void ConvertVnlMatrixToVtkMatrix(const vnl_matrix_fixed<double,4,4>& inVnlMatrix, vtkMatrix4x4* outVtkMatrix); 
@@ -0,0 +1,164 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "PlusMjpegDecoder.h"
+#include "PlusWorkerPool.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkJPEGReader.h>
+
+// STL includes
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+  const int MINIMUM_ROWS_PER_THREAD = 16;
+
+  //----------------------------------------------------------------------------
+  /*! Call convertRow(outputRow) for each row of the image, split between the threads of the shared worker pool */
+  template<typename RowConversion>
+  PlusStatus ConvertRows(int height, int numberOfThreads, RowConversion convertRow)
+  {
+    PlusWorkerPool& workerPool = PlusWorkerPool::GetInstance();
+    if (numberOfThreads < 1)
+    {
+      numberOfThreads = workerPool.GetNumberOfThreads() + 1;
+    }
+    numberOfThreads = std::min(numberOfThreads, std::max(1, height / MINIMUM_ROWS_PER_THREAD));
+
+    std::atomic<bool> failed(false);
+    workerPool.ParallelFor(0, height, numberOfThreads, [&failed, &convertRow](int firstRow, int lastRow)
+    {
+      for (int row = firstRow; row < lastRow; ++row)
+      {
+        if (convertRow(row) != PLUS_SUCCESS)
+        {
+          failed = true;
+          return;
+        }
+      }
+    });
+    return failed ? PLUS_FAIL : PLUS_SUCCESS;
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusMjpegDecoder::PlusMjpegDecoder()
+  : Reader(vtkSmartPointer<vtkJPEGReader>::New())
+  , LastDecodingTimeSec(0.0)
+{
+}
+
+//----------------------------------------------------------------------------
+PlusMjpegDecoder::~PlusMjpegDecoder()
+{
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusMjpegDecoder::Decode(int width, int height, const unsigned char* input, size_t inputSize, unsigned char*& decodedPixels, int& numberOfComponents)
+{
+  if (input == NULL || inputSize == 0)
+  {
+    LOG_ERROR("Unable to decode MJPEG frame: no input data");
+    return PLUS_FAIL;
+  }
+
+  this->Reader->SetMemoryBuffer(input);
+  this->Reader->SetMemoryBufferLength(static_cast<vtkIdType>(inputSize));
+  // The buffer address may be the same as for the previous frame, while its contents changed
+  this->Reader->Modified();
+  this->Reader->Update();
+
+  vtkImageData* decodedImage = this->Reader->GetOutput();
+  int* dimensions = decodedImage->GetDimensions();
+  if (dimensions[0] != width || dimensions[1] != height || decodedImage->GetScalarType() != VTK_UNSIGNED_CHAR)
+  {
+    LOG_ERROR("Unable to decode MJPEG frame: decoded image size (" << dimensions[0] << "x" << dimensions[1] << ") does not match the expected size (" << width << "x" << height << ")");
+    return PLUS_FAIL;
+  }
+
+  decodedPixels = static_cast<unsigned char*>(decodedImage->GetScalarPointer());
+  numberOfComponents = decodedImage->GetNumberOfScalarComponents();
+  if (decodedPixels == NULL || (numberOfComponents != 1 && numberOfComponents != 3))
+  {
+    LOG_ERROR("Unable to decode MJPEG frame: unsupported number of color components (" << numberOfComponents << ")");
+    return PLUS_FAIL;
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusMjpegDecoder::DecodeToBmp24(PixelCodec::ComponentOrdering outputOrdering, int width, int height, const unsigned char* input, size_t inputSize, unsigned char* output, int numberOfThreads /*= 1*/)
+{
+  std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+  unsigned char* decodedPixels = NULL;
+  int numberOfComponents = 0;
+  if (this->Decode(width, height, input, inputSize, decodedPixels, numberOfComponents) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+
+  // The decoded image is stored with the bottom row first, the output is stored with the top row first
+  const int decodedRowSize = width * numberOfComponents;
+  if (ConvertRows(height, numberOfThreads, [ = ](int row)
+  {
+    unsigned char* decodedRow = decodedPixels + (height - 1 - row) * decodedRowSize;
+    unsigned char* outputRow = output + row * width * 3;
+    if (numberOfComponents == 1)
+    {
+      for (int i = 0; i < width; ++i)
+      {
+        outputRow[3 * i] = outputRow[3 * i + 1] = outputRow[3 * i + 2] = decodedRow[i];
+      }
+      return PLUS_SUCCESS;
+    }
+    return PixelCodec::ConvertToBmp24(outputOrdering, PixelCodec::PixelEncoding_RGB24, width, 1, decodedRow, outputRow);
+  }) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+
+  this->LastDecodingTimeSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusMjpegDecoder::DecodeToGray(int width, int height, const unsigned char* input, size_t inputSize, unsigned char* output, int numberOfThreads /*= 1*/)
+{
+  std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+  unsigned char* decodedPixels = NULL;
+  int numberOfComponents = 0;
+  if (this->Decode(width, height, input, inputSize, decodedPixels, numberOfComponents) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+
+  // The decoded image is stored with the bottom row first, the output is stored with the top row first
+  const int decodedRowSize = width * numberOfComponents;
+  if (ConvertRows(height, numberOfThreads, [ = ](int row)
+  {
+    unsigned char* decodedRow = decodedPixels + (height - 1 - row) * decodedRowSize;
+    unsigned char* outputRow = output + row * width;
+    if (numberOfComponents == 1)
+    {
+      memcpy(outputRow, decodedRow, width);
+      return PLUS_SUCCESS;
+    }
+    return PixelCodec::ConvertToGray(PixelCodec::PixelEncoding_RGB24, width, 1, decodedRow, outputRow);
+  }) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+
+  this->LastDecodingTimeSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+  return PLUS_SUCCESS;
+}
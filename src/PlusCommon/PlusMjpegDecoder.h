@@ -0,0 +1,62 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusMjpegDecoder_h
+#define __PlusMjpegDecoder_h
+
+#include "PlusConfigure.h"
+#include "vtkPlusCommonExport.h"
+#include "PixelCodec.h"
+
+// VTK includes
+#include <vtkSmartPointer.h>
+
+class vtkJPEGReader;
+
+/*!
+  \class PlusMjpegDecoder
+  \brief Decodes the JPEG compressed frames of MJPEG video streams, such as the streams of USB cameras and frame grabbers
+
+  The JPEG data is decoded by the JPEG library of VTK (libjpeg-turbo) directly from memory. The decoded rows are
+  reordered and converted to the requested output format in parallel, by the threads of the shared worker pool.
+
+  The decoder keeps its decoding context between frames, therefore a separate decoder is needed for each video stream.
+  The duration of the decoding is recorded for each frame, so that devices can report the decoding latency.
+
+  \ingroup PlusLibCommon
+*/
+class vtkPlusCommonExport PlusMjpegDecoder
+{
+public:
+  PlusMjpegDecoder();
+  ~PlusMjpegDecoder();
+
+  /*!
+    Decode a frame to RGB24 or BGR24.
+    \param inputSize Number of bytes of the compressed frame
+    \param numberOfThreads If not 1 then the rows of the decoded image are converted by this many threads of the shared worker pool (0 = all threads of the pool)
+  */
+  PlusStatus DecodeToBmp24(PixelCodec::ComponentOrdering outputOrdering, int width, int height, const unsigned char* input, size_t inputSize, unsigned char* output, int numberOfThreads = 1);
+
+  /*! Decode a frame to grayscale. See DecodeToBmp24 for the description of the parameters. */
+  PlusStatus DecodeToGray(int width, int height, const unsigned char* input, size_t inputSize, unsigned char* output, int numberOfThreads = 1);
+
+  /*! Duration of the last successful decoding, including the conversion to the output format */
+  double GetLastDecodingTimeSec() const { return this->LastDecodingTimeSec; }
+
+protected:
+  /*! Decode the compressed frame into the output of the reader. Fails if the size of the decoded image is not width x height. */
+  PlusStatus Decode(int width, int height, const unsigned char* input, size_t inputSize, unsigned char*& decodedPixels, int& numberOfComponents);
+
+  vtkSmartPointer<vtkJPEGReader> Reader;
+  double LastDecodingTimeSec;
+
+private:
+  PlusMjpegDecoder(const PlusMjpegDecoder&);
+  void operator=(const PlusMjpegDecoder&);
+};
+
+#endif
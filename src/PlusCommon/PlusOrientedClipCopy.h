@@ -0,0 +1,171 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusOrientedClipCopy_h
+#define __PlusOrientedClipCopy_h
+
+#include "PlusConfigure.h"
+#include "PlusPixelKernels.h"
+
+#include <algorithm>
+#include <array>
+
+/*!
+\class PlusOrientedClipCopy
+\brief Copies the clip rectangle of an image into a contiguous buffer while flipping and transposing it, in a single pass
+
+Rows that keep their direction are copied by memcpy, rows that are mirrored are copied by the reversed-row kernels
+of PlusPixelKernels, which are instantiated at compile time for each pixel size, so that changing the image
+orientation costs about the same as a plain copy.
+
+Flips are applied to the clipped region: with flipX the first output column is the last column of the clip rectangle.
+Transposing IJK to KIJ is supported without flips; the output size is then (clipSize[2], clipSize[0], clipSize[1]).
+
+\ingroup PlusLibCommon
+*/
+class PlusOrientedClipCopy
+{
+public:
+  //----------------------------------------------------------------------------
+  /*! Returns true if the clip rectangle is within the input image and the flip/transpose combination is handled by Copy */
+  static bool IsSupported(const FrameSizeType& inputSize, const std::array<int, 3>& clipOrigin, const std::array<int, 3>& clipSize,
+                          bool flipX, bool flipY, bool flipZ, bool transposeIJKtoKIJ)
+  {
+    if (transposeIJKtoKIJ && (flipX || flipY || flipZ))
+    {
+      return false;
+    }
+    for (int axis = 0; axis < 3; axis++)
+    {
+      if (clipOrigin[axis] < 0 || clipSize[axis] <= 0
+          || static_cast<unsigned int>(clipOrigin[axis]) + static_cast<unsigned int>(clipSize[axis]) > inputSize[axis])
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  /*!
+    Copies the clip rectangle of the input image into the output buffer, which must hold
+    clipSize[0] * clipSize[1] * clipSize[2] * bytesPerPixel bytes
+  */
+  static PlusStatus Copy(const unsigned char* input, const FrameSizeType& inputSize, unsigned int bytesPerPixel,
+                         const std::array<int, 3>& clipOrigin, const std::array<int, 3>& clipSize,
+                         bool flipX, bool flipY, bool flipZ, bool transposeIJKtoKIJ, unsigned char* output)
+  {
+    if (input == NULL || output == NULL || bytesPerPixel == 0)
+    {
+      LOG_ERROR("PlusOrientedClipCopy::Copy failed: invalid input or output buffer");
+      return PLUS_FAIL;
+    }
+    if (!IsSupported(inputSize, clipOrigin, clipSize, flipX, flipY, flipZ, transposeIJKtoKIJ))
+    {
+      LOG_ERROR("PlusOrientedClipCopy::Copy failed: clip rectangle (" << clipOrigin[0] << ", " << clipOrigin[1] << ", " << clipOrigin[2]
+                << ") size (" << clipSize[0] << ", " << clipSize[1] << ", " << clipSize[2] << ") is outside of the "
+                << inputSize[0] << "x" << inputSize[1] << "x" << inputSize[2] << " image or the requested transposition is not supported");
+      return PLUS_FAIL;
+    }
+
+    CopyFunctor functor = { input, inputSize, clipOrigin, clipSize, flipX, flipY, flipZ, transposeIJKtoKIJ, output };
+    if (PlusPixelKernels::DispatchPixelSize(bytesPerPixel, functor) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("PlusOrientedClipCopy::Copy failed: unsupported pixel size " << bytesPerPixel << " bytes");
+      return PLUS_FAIL;
+    }
+    return PLUS_SUCCESS;
+  }
+
+protected:
+  /*! Arguments of Copy, passed to the kernel instantiated for the pixel size */
+  struct CopyFunctor
+  {
+    const unsigned char* Input;
+    const FrameSizeType& InputSize;
+    const std::array<int, 3>& ClipOrigin;
+    const std::array<int, 3>& ClipSize;
+    bool FlipX;
+    bool FlipY;
+    bool FlipZ;
+    bool TransposeIJKtoKIJ;
+    unsigned char* Output;
+
+    template<class PixelType>
+    void Run() const
+    {
+      CopyTyped<PixelType>(Input, InputSize, ClipOrigin, ClipSize, FlipX, FlipY, FlipZ, TransposeIJKtoKIJ, Output);
+    }
+  };
+
+  //----------------------------------------------------------------------------
+  template<class PixelType>
+  static void CopyTyped(const unsigned char* input, const FrameSizeType& inputSize,
+                        const std::array<int, 3>& clipOrigin, const std::array<int, 3>& clipSize,
+                        bool flipX, bool flipY, bool flipZ, bool transposeIJKtoKIJ, unsigned char* output)
+  {
+    const size_t inputRowPixels = inputSize[0];
+    const size_t inputSlicePixels = inputRowPixels * inputSize[1];
+    const unsigned int width = static_cast<unsigned int>(clipSize[0]);
+    const unsigned int height = static_cast<unsigned int>(clipSize[1]);
+    const unsigned int depth = static_cast<unsigned int>(clipSize[2]);
+    const PixelType* inputPixels = reinterpret_cast<const PixelType*>(input)
+                                   + clipOrigin[0] + clipOrigin[1] * inputRowPixels + clipOrigin[2] * inputSlicePixels;
+    PixelType* outputPixels = reinterpret_cast<PixelType*>(output);
+
+    if (transposeIJKtoKIJ && depth > 1)
+    {
+      TransposeIJKtoKIJ(inputPixels, inputRowPixels, inputSlicePixels, width, height, depth, outputPixels);
+      return;
+    }
+    // A single slice has the same memory layout after IJK to KIJ transposition, so it is copied as is
+
+    for (unsigned int z = 0; z < depth; z++)
+    {
+      const PixelType* inputSlice = inputPixels + (flipZ ? depth - 1 - z : z) * inputSlicePixels;
+      for (unsigned int y = 0; y < height; y++)
+      {
+        const PixelType* inputRow = inputSlice + (flipY ? height - 1 - y : y) * inputRowPixels;
+        if (flipX)
+        {
+          PlusPixelKernels::ReverseRow(inputRow, outputPixels, width);
+        }
+        else
+        {
+          PlusPixelKernels::CopyRow(inputRow, outputPixels, width);
+        }
+        outputPixels += width;
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Output voxel (k, i, j) is input voxel (i, j, k). Processed in tiles along i to keep both reads and writes cache friendly. */
+  template<class PixelType>
+  static void TransposeIJKtoKIJ(const PixelType* inputPixels, size_t inputRowPixels, size_t inputSlicePixels,
+                                unsigned int width, unsigned int height, unsigned int depth, PixelType* outputPixels)
+  {
+    const unsigned int TILE_SIZE = 64;
+    for (unsigned int j = 0; j < height; j++)
+    {
+      PixelType* outputSlice = outputPixels + static_cast<size_t>(j) * width * depth;
+      for (unsigned int iStart = 0; iStart < width; iStart += TILE_SIZE)
+      {
+        const unsigned int iEnd = std::min(iStart + TILE_SIZE, width);
+        for (unsigned int k = 0; k < depth; k++)
+        {
+          const PixelType* inputRow = inputPixels + j * inputRowPixels + k * inputSlicePixels;
+          for (unsigned int i = iStart; i < iEnd; i++)
+          {
+            outputSlice[static_cast<size_t>(i) * depth + k] = inputRow[i];
+          }
+        }
+      }
+    }
+  }
+};
+
+#endif
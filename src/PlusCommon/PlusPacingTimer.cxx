@@ -0,0 +1,144 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "PlusPacingTimer.h"
+#include "vtkIGSIOAccurateTimer.h"
+
+#if defined(_WIN32)
+  #include <windows.h>
+  #include <mmsystem.h>
+  // Not defined in Windows SDKs older than 10.0.17134
+  #ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+    #define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+  #endif
+#elif defined(__linux__)
+  #include <errno.h>
+  #include <time.h>
+#endif
+
+// STL includes
+#include <chrono>
+#include <thread>
+
+namespace
+{
+#if defined(_WIN32)
+  //----------------------------------------------------------------------------
+  /*! Waitable timer of the calling thread, Handle is NULL if high-resolution timers are not supported */
+  struct HighResolutionWaitableTimer
+  {
+    HighResolutionWaitableTimer()
+      : Handle(CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS))
+    {
+    }
+    ~HighResolutionWaitableTimer()
+    {
+      if (this->Handle != NULL)
+      {
+        CloseHandle(this->Handle);
+      }
+    }
+    HANDLE Handle;
+  };
+
+  //----------------------------------------------------------------------------
+  HANDLE GetThreadWaitableTimer()
+  {
+    thread_local HighResolutionWaitableTimer timer;
+    return timer.Handle;
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Raises the system timer resolution to 1 ms for the lifetime of the process */
+  struct SystemTimerResolution
+  {
+    SystemTimerResolution() { timeBeginPeriod(1); }
+    ~SystemTimerResolution() { timeEndPeriod(1); }
+  };
+
+  //----------------------------------------------------------------------------
+  void PreciseSleep(double durationSec)
+  {
+    HANDLE timer = GetThreadWaitableTimer();
+    if (timer != NULL)
+    {
+      // Negative due time is relative, in 100 ns units
+      LARGE_INTEGER dueTime;
+      dueTime.QuadPart = -static_cast<LONGLONG>(durationSec * 1e7);
+      if (SetWaitableTimerEx(timer, &dueTime, 0, NULL, NULL, NULL, 0) && WaitForSingleObject(timer, INFINITE) == WAIT_OBJECT_0)
+      {
+        return;
+      }
+    }
+    static SystemTimerResolution systemTimerResolution;
+    ::Sleep(static_cast<DWORD>(durationSec * 1000.0));
+  }
+#elif defined(__linux__)
+  //----------------------------------------------------------------------------
+  void PreciseSleep(double durationSec)
+  {
+    timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    long long nanoseconds = deadline.tv_nsec + static_cast<long long>(durationSec * 1e9);
+    deadline.tv_sec += static_cast<time_t>(nanoseconds / 1000000000LL);
+    deadline.tv_nsec = static_cast<long>(nanoseconds % 1000000000LL);
+    // The absolute deadline is not extended when the sleep is interrupted by a signal
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR)
+    {
+    }
+  }
+#else
+  //----------------------------------------------------------------------------
+  void PreciseSleep(double durationSec)
+  {
+    std::this_thread::sleep_for(std::chrono::duration<double>(durationSec));
+  }
+#endif
+}
+
+//----------------------------------------------------------------------------
+void PlusPacingTimer::Delay(double durationSec)
+{
+  if (durationSec <= 0)
+  {
+    return;
+  }
+  const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now()
+      + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(durationSec));
+
+  const double sleepDurationSec = durationSec - GetSpinDurationSec();
+  if (sleepDurationSec > 0)
+  {
+    PreciseSleep(sleepDurationSec);
+  }
+
+  // Spin for the rest of the time, letting other ready threads run
+  while (std::chrono::steady_clock::now() < deadline)
+  {
+    std::this_thread::yield();
+  }
+}
+
+//----------------------------------------------------------------------------
+void PlusPacingTimer::DelayUntil(double systemTimeSec)
+{
+  Delay(systemTimeSec - vtkIGSIOAccurateTimer::GetSystemTime());
+}
+
+//----------------------------------------------------------------------------
+double PlusPacingTimer::GetSpinDurationSec()
+{
+#if defined(_WIN32)
+  // High-resolution waitable timers are accurate to about 0.5 ms, Sleep to about 1-2 ms at 1 ms timer resolution
+  return GetThreadWaitableTimer() != NULL ? 0.0005 : 0.002;
+#elif defined(__linux__)
+  // Default timer slack of a thread is 50 us
+  return 0.0001;
+#else
+  return 0.001;
+#endif
+}
@@ -0,0 +1,43 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusPacingTimer_h
+#define __PlusPacingTimer_h
+
+#include "PlusConfigure.h"
+#include "vtkPlusCommonExport.h"
+
+/*!
+  \class PlusPacingTimer
+  \brief High-resolution delays for pacing acquisition and sending loops
+
+  A plain sleep is rounded up to the scheduler granularity of the operating system (15.6 ms on Windows by default),
+  so a 5 ms pause in a polling loop may take three times longer. Delay sleeps for most of the requested time
+  using the most precise timer of the platform, then spins (yielding the processor) for the remaining short period:
+  - Windows: high-resolution waitable timer (Windows 10 1803 or later), otherwise Sleep with the system timer
+    resolution raised to 1 ms (timeBeginPeriod) while the process runs
+  - Linux: clock_nanosleep with an absolute deadline on the monotonic clock
+  - Other platforms: std::this_thread::sleep_for
+
+  Delays are never shorter than requested. Long waits that do not need precise timing (e.g., reconnection attempts)
+  can keep using vtkIGSIOAccurateTimer::Delay.
+
+  \ingroup PlusLibCommon
+*/
+class vtkPlusCommonExport PlusPacingTimer
+{
+public:
+  /*! Wait for the specified time. Returns immediately if the duration is not positive. */
+  static void Delay(double durationSec);
+
+  /*! Wait until the specified system time (see vtkIGSIOAccurateTimer::GetSystemTime) */
+  static void DelayUntil(double systemTimeSec);
+
+  /*! Length of the spin phase at the end of a delay, depends on the precision of the sleep of the platform */
+  static double GetSpinDurationSec();
+};
+
+#endif
@@ -0,0 +1,385 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "PlusParallelCompressor.h"
+#include "PlusWorkerPool.h"
+
+// VTK includes
+#include <vtk_zlib.h>
+
+// STL includes
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+  // Size of the deflate window, the end of the previous block is used as dictionary up to this size
+  const unsigned int DICTIONARY_SIZE_BYTES = 32768;
+
+  //----------------------------------------------------------------------------
+  void WriteUInt32LittleEndian(std::ostream& output, unsigned long value)
+  {
+    unsigned char bytes[4] =
+    {
+      static_cast<unsigned char>(value & 0xff),
+      static_cast<unsigned char>((value >> 8) & 0xff),
+      static_cast<unsigned char>((value >> 16) & 0xff),
+      static_cast<unsigned char>((value >> 24) & 0xff)
+    };
+    output.write(reinterpret_cast<const char*>(bytes), 4);
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusParallelCompressor::PlusParallelCompressor()
+  : NumberOfThreads(0)
+  , CompressionLevel(Z_DEFAULT_COMPRESSION)
+  , BlockSizeBytes(1024 * 1024)
+  , IndependentBlocks(false)
+  , Output(NULL)
+  , Format(GZIP_STREAM)
+  , StreamStatus(PLUS_SUCCESS)
+  , Checksum(0)
+  , TotalInputBytes(0)
+  , OutputPosition(0)
+{
+}
+
+//----------------------------------------------------------------------------
+void PlusParallelCompressor::SetNumberOfThreads(int numberOfThreads)
+{
+  this->NumberOfThreads = std::max(0, numberOfThreads);
+}
+
+//----------------------------------------------------------------------------
+int PlusParallelCompressor::GetNumberOfThreads() const
+{
+  return this->NumberOfThreads;
+}
+
+//----------------------------------------------------------------------------
+void PlusParallelCompressor::SetCompressionLevel(int compressionLevel)
+{
+  if (compressionLevel < Z_DEFAULT_COMPRESSION || compressionLevel > Z_BEST_COMPRESSION)
+  {
+    LOG_WARNING("Invalid compression level: " << compressionLevel << ". Using the default compression level.");
+    compressionLevel = Z_DEFAULT_COMPRESSION;
+  }
+  this->CompressionLevel = compressionLevel;
+}
+
+//----------------------------------------------------------------------------
+int PlusParallelCompressor::GetCompressionLevel() const
+{
+  return this->CompressionLevel;
+}
+
+//----------------------------------------------------------------------------
+void PlusParallelCompressor::SetBlockSizeBytes(unsigned int blockSizeBytes)
+{
+  this->BlockSizeBytes = std::max(blockSizeBytes, 1u);
+}
+
+//----------------------------------------------------------------------------
+unsigned int PlusParallelCompressor::GetBlockSizeBytes() const
+{
+  return this->BlockSizeBytes;
+}
+
+//----------------------------------------------------------------------------
+void PlusParallelCompressor::SetIndependentBlocks(bool independentBlocks)
+{
+  this->IndependentBlocks = independentBlocks;
+}
+
+//----------------------------------------------------------------------------
+bool PlusParallelCompressor::GetIndependentBlocks() const
+{
+  return this->IndependentBlocks;
+}
+
+//----------------------------------------------------------------------------
+const std::vector<PlusParallelCompressor::BlockLocation>& PlusParallelCompressor::GetBlockLocations() const
+{
+  return this->BlockLocations;
+}
+
+//----------------------------------------------------------------------------
+void PlusParallelCompressor::CompressBlock(Block* block, int compressionLevel, StreamFormat format)
+{
+  block->Status = PLUS_FAIL;
+  block->Checksum = (format == GZIP_STREAM) ? crc32(0L, Z_NULL, 0) : adler32(0L, Z_NULL, 0);
+
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  // Raw deflate (negative window bits), the gzip or zlib header and trailer are written for the whole stream
+  if (deflateInit2(&stream, compressionLevel, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+  {
+    return;
+  }
+  if (!block->Dictionary.empty())
+  {
+    deflateSetDictionary(&stream, &block->Dictionary[0], static_cast<uInt>(block->Dictionary.size()));
+  }
+
+  uLong inputSize = static_cast<uLong>(block->Input.size());
+  // A sync flush may add a few bytes to the bound that is computed for a finished stream
+  block->Output.resize(deflateBound(&stream, inputSize) + 16);
+  stream.next_in = block->Input.empty() ? Z_NULL : &block->Input[0];
+  stream.avail_in = static_cast<uInt>(inputSize);
+  stream.next_out = &block->Output[0];
+  stream.avail_out = static_cast<uInt>(block->Output.size());
+
+  // Non-final blocks end on a byte boundary (sync flush), so that the next block can be appended directly
+  int result = deflate(&stream, block->Last ? Z_FINISH : Z_SYNC_FLUSH);
+  bool complete = block->Last ? (result == Z_STREAM_END) : (result == Z_OK && stream.avail_in == 0 && stream.avail_out != 0);
+  block->Output.resize(stream.total_out);
+  deflateEnd(&stream);
+
+  if (!complete)
+  {
+    return;
+  }
+  if (inputSize > 0)
+  {
+    block->Checksum = (format == GZIP_STREAM) ? crc32(block->Checksum, &block->Input[0], static_cast<uInt>(inputSize)) : adler32(block->Checksum, &block->Input[0], static_cast<uInt>(inputSize));
+  }
+  block->Status = PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusParallelCompressor::DecompressBlock(const unsigned char* input, size_t inputSize, unsigned char* output, size_t outputSize)
+{
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+  {
+    return PLUS_FAIL;
+  }
+  stream.next_in = const_cast<Bytef*>(input);
+  stream.avail_in = static_cast<uInt>(inputSize);
+  stream.next_out = output;
+  stream.avail_out = static_cast<uInt>(outputSize);
+
+  // Blocks other than the last one end with a sync flush, so the end of the deflate stream is not reached for them
+  int result = inflate(&stream, Z_SYNC_FLUSH);
+  bool complete = (result == Z_OK || result == Z_STREAM_END || result == Z_BUF_ERROR) && stream.total_out == outputSize;
+  inflateEnd(&stream);
+  return complete ? PLUS_SUCCESS : PLUS_FAIL;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusParallelCompressor::CompressToGzip(std::istream& input, std::ostream& output)
+{
+  if (this->BeginStream(output, GZIP_STREAM) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  std::vector<unsigned char> buffer(this->BlockSizeBytes);
+  while (input && this->StreamStatus == PLUS_SUCCESS)
+  {
+    input.read(reinterpret_cast<char*>(&buffer[0]), this->BlockSizeBytes);
+    size_t readBytes = static_cast<size_t>(input.gcount());
+    if (readBytes > 0)
+    {
+      this->AppendData(&buffer[0], readBytes);
+    }
+  }
+  if (input.bad())
+  {
+    LOG_ERROR("Failed to read the data to compress");
+    this->StreamStatus = PLUS_FAIL;
+  }
+  return this->EndStream();
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusParallelCompressor::BeginStream(std::ostream& output, StreamFormat format/*=GZIP_STREAM*/)
+{
+  if (this->Output != NULL)
+  {
+    LOG_ERROR("Cannot start compressed stream, the previous stream is not completed");
+    return PLUS_FAIL;
+  }
+  this->Output = &output;
+  this->Format = format;
+  this->StreamStatus = PLUS_SUCCESS;
+  this->Tasks.clear();
+  this->PendingBlock.reset();
+  this->Dictionary.clear();
+  this->BlockLocations.clear();
+  this->TotalInputBytes = 0;
+
+  if (format == GZIP_STREAM)
+  {
+    // gzip header: magic, deflate method, no flags, no modification time, unknown OS
+    const unsigned char gzipHeader[10] = { 0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 0xff };
+    output.write(reinterpret_cast<const char*>(gzipHeader), sizeof(gzipHeader));
+    this->OutputPosition = sizeof(gzipHeader);
+    this->Checksum = crc32(0L, Z_NULL, 0);
+  }
+  else
+  {
+    // zlib header: deflate method with 32kB window, default compression level
+    const unsigned char zlibHeader[2] = { 0x78, 0x9c };
+    output.write(reinterpret_cast<const char*>(zlibHeader), sizeof(zlibHeader));
+    this->OutputPosition = sizeof(zlibHeader);
+    this->Checksum = adler32(0L, Z_NULL, 0);
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusParallelCompressor::AppendData(const unsigned char* data, size_t size)
+{
+  if (this->Output == NULL)
+  {
+    LOG_ERROR("Cannot append data, the compressed stream is not started");
+    return PLUS_FAIL;
+  }
+  while (size > 0 && this->StreamStatus == PLUS_SUCCESS)
+  {
+    if (this->PendingBlock && this->PendingBlock->Input.size() >= this->BlockSizeBytes)
+    {
+      // More data follows, so the full pending block is not the last one
+      this->QueueBlock(false);
+      this->WriteCompressedBlocks(false);
+    }
+    if (!this->PendingBlock)
+    {
+      this->PendingBlock = std::make_shared<Block>();
+      this->PendingBlock->Input.reserve(this->BlockSizeBytes);
+    }
+    size_t copiedBytes = std::min<size_t>(size, this->BlockSizeBytes - this->PendingBlock->Input.size());
+    this->PendingBlock->Input.insert(this->PendingBlock->Input.end(), data, data + copiedBytes);
+    data += copiedBytes;
+    size -= copiedBytes;
+  }
+  return this->StreamStatus;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusParallelCompressor::EndStream()
+{
+  if (this->Output == NULL)
+  {
+    LOG_ERROR("Cannot end compressed stream, the stream is not started");
+    return PLUS_FAIL;
+  }
+  if (this->StreamStatus == PLUS_SUCCESS)
+  {
+    if (!this->PendingBlock)
+    {
+      // An empty stream still needs a final block
+      this->PendingBlock = std::make_shared<Block>();
+    }
+    this->QueueBlock(true);
+  }
+  // Wait for all blocks, including the ones that are still in progress if stopped because of an error
+  this->WriteCompressedBlocks(true);
+  this->PendingBlock.reset();
+
+  std::ostream& output = *this->Output;
+  this->Output = NULL;
+  if (this->StreamStatus != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+
+  if (this->Format == GZIP_STREAM)
+  {
+    // gzip trailer: CRC-32 and size of the uncompressed data (modulo 2^32)
+    WriteUInt32LittleEndian(output, this->Checksum);
+    WriteUInt32LittleEndian(output, static_cast<unsigned long>(this->TotalInputBytes & 0xffffffffULL));
+  }
+  else
+  {
+    // zlib trailer: Adler-32 of the uncompressed data, most significant byte first
+    unsigned char bytes[4] =
+    {
+      static_cast<unsigned char>((this->Checksum >> 24) & 0xff),
+      static_cast<unsigned char>((this->Checksum >> 16) & 0xff),
+      static_cast<unsigned char>((this->Checksum >> 8) & 0xff),
+      static_cast<unsigned char>(this->Checksum & 0xff)
+    };
+    output.write(reinterpret_cast<const char*>(bytes), 4);
+  }
+  this->OutputPosition += (this->Format == GZIP_STREAM ? 8 : 4);
+
+  if (!output)
+  {
+    LOG_ERROR("Failed to write the compressed data");
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+unsigned long long PlusParallelCompressor::GetNumberOfWrittenBytes() const
+{
+  return this->OutputPosition;
+}
+
+//----------------------------------------------------------------------------
+void PlusParallelCompressor::QueueBlock(bool last)
+{
+  std::shared_ptr<Block> block = this->PendingBlock;
+  this->PendingBlock.reset();
+  block->Last = last;
+  if (!this->IndependentBlocks)
+  {
+    block->Dictionary = this->Dictionary;
+    size_t dictionarySize = std::min<size_t>(block->Input.size(), DICTIONARY_SIZE_BYTES);
+    this->Dictionary.assign(block->Input.end() - dictionarySize, block->Input.end());
+  }
+
+  // Blocks are compressed by the shared worker pool, the calling thread compresses blocks while it waits
+  int compressionLevel = this->CompressionLevel;
+  StreamFormat format = this->Format;
+  this->Tasks.push_back(CompressionTask(block, PlusWorkerPool::GetInstance().Submit([block, compressionLevel, format]() { CompressBlock(block.get(), compressionLevel, format); })));
+}
+
+//----------------------------------------------------------------------------
+void PlusParallelCompressor::WriteCompressedBlocks(bool waitForAll)
+{
+  PlusWorkerPool& workerPool = PlusWorkerPool::GetInstance();
+  unsigned int numberOfThreads = static_cast<unsigned int>(this->NumberOfThreads);
+  if (numberOfThreads == 0)
+  {
+    numberOfThreads = static_cast<unsigned int>(workerPool.GetNumberOfThreads() + 1);
+  }
+
+  // Write the compressed blocks in order, keeping at most numberOfThreads blocks in progress
+  while (!this->Tasks.empty() && (this->Tasks.size() >= numberOfThreads || waitForAll))
+  {
+    workerPool.Wait(this->Tasks.front().second);
+    std::shared_ptr<Block> compressedBlock = this->Tasks.front().first;
+    this->Tasks.pop_front();
+    if (this->StreamStatus != PLUS_SUCCESS)
+    {
+      continue;
+    }
+    if (compressedBlock->Status != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to compress data block");
+      this->StreamStatus = PLUS_FAIL;
+      continue;
+    }
+    z_off_t inputSize = static_cast<z_off_t>(compressedBlock->Input.size());
+    this->Checksum = (this->Format == GZIP_STREAM) ? crc32_combine(this->Checksum, compressedBlock->Checksum, inputSize) : adler32_combine(this->Checksum, compressedBlock->Checksum, inputSize);
+    this->TotalInputBytes += compressedBlock->Input.size();
+    BlockLocation location;
+    location.Offset = this->OutputPosition;
+    location.Size = compressedBlock->Output.size();
+    this->BlockLocations.push_back(location);
+    this->OutputPosition += compressedBlock->Output.size();
+    if (!compressedBlock->Output.empty())
+    {
+      this->Output->write(reinterpret_cast<const char*>(&compressedBlock->Output[0]), compressedBlock->Output.size());
+    }
+  }
+}
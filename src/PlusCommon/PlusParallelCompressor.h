@@ -0,0 +1,137 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusParallelCompressor_h
+#define __PlusParallelCompressor_h
+
+#include "PlusConfigure.h"
+#include "vtkPlusCommonExport.h"
+
+#include <deque>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+/*!
+  \class PlusParallelCompressor
+  \brief Compresses a data stream into a gzip stream using multiple threads
+
+  The input is split into blocks that are deflated independently and concurrently, and the results are written
+  in order. Each block is primed with the last 32kB of the previous block, so the compression ratio is close to
+  the one of a single-threaded compression. The output is a single standard gzip stream, which can be read by
+  any gzip/zlib decoder.
+
+  If IndependentBlocks is enabled then blocks are not primed, so each block can be decompressed on its own
+  (see DecompressBlock and GetBlockLocations). This allows random access to the compressed data, for example
+  to each frame of a sequence file if the block size is set to the frame size.
+
+  Data can also be compressed incrementally (BeginStream, AppendData, EndStream), so that only the blocks that are
+  being compressed are kept in memory. Incremental streams can be written in zlib format as well.
+
+  \ingroup PlusLibCommon
+*/
+class vtkPlusCommonExport PlusParallelCompressor
+{
+public:
+  PlusParallelCompressor();
+
+  /*!
+    Maximum number of blocks compressed at the same time. 0 means one block for each thread of the shared worker pool
+    (see PlusWorkerPool) and one for the calling thread.
+  */
+  void SetNumberOfThreads(int numberOfThreads);
+  int GetNumberOfThreads() const;
+
+  /*! zlib compression level, from 1 (fastest) to 9 (smallest). -1 selects the zlib default. */
+  void SetCompressionLevel(int compressionLevel);
+  int GetCompressionLevel() const;
+
+  /*! Size of the independently compressed blocks */
+  void SetBlockSizeBytes(unsigned int blockSizeBytes);
+  unsigned int GetBlockSizeBytes() const;
+
+  /*! If enabled then each block can be decompressed without the previous blocks, at the price of a slightly lower compression ratio */
+  void SetIndependentBlocks(bool independentBlocks);
+  bool GetIndependentBlocks() const;
+
+  struct BlockLocation
+  {
+    /*! Position of the compressed block in the output, relative to the beginning of the compressed stream */
+    unsigned long long Offset;
+    /*! Number of bytes of the compressed block */
+    unsigned long long Size;
+  };
+
+  /*! Location of each compressed block written by the last CompressToGzip call or incremental stream */
+  const std::vector<BlockLocation>& GetBlockLocations() const;
+
+  /*! Compress the input from the current position until the end of the stream and write the gzip stream to the output */
+  PlusStatus CompressToGzip(std::istream& input, std::ostream& output);
+
+  enum StreamFormat
+  {
+    GZIP_STREAM,
+    ZLIB_STREAM
+  };
+
+  /*! Start writing an incrementally compressed stream to the output. The output must be available until EndStream returns. */
+  PlusStatus BeginStream(std::ostream& output, StreamFormat format = GZIP_STREAM);
+
+  /*! Compress the data and append it to the stream. The data is copied, so it can be released when the call returns. */
+  PlusStatus AppendData(const unsigned char* data, size_t size);
+
+  /*! Compress the remaining data and complete the stream. If compression of any block failed then the stream is not completed. */
+  PlusStatus EndStream();
+
+  /*! Number of bytes written to the output since the stream was started, including the header and trailer */
+  unsigned long long GetNumberOfWrittenBytes() const;
+
+  /*! Decompress a block that was compressed with IndependentBlocks enabled. outputSize is the size of the uncompressed block. */
+  static PlusStatus DecompressBlock(const unsigned char* input, size_t inputSize, unsigned char* output, size_t outputSize);
+
+protected:
+  struct Block
+  {
+    std::vector<unsigned char> Input;
+    std::vector<unsigned char> Dictionary;
+    std::vector<unsigned char> Output;
+    /*! CRC-32 (gzip stream) or Adler-32 (zlib stream) of the input */
+    unsigned long Checksum;
+    bool Last;
+    PlusStatus Status;
+  };
+
+  /*! Deflate a block into raw deflate data that can be concatenated with the other blocks */
+  static void CompressBlock(Block* block, int compressionLevel, StreamFormat format);
+
+  /*! Start compressing the pending block */
+  void QueueBlock(bool last);
+
+  /*! Write the compressed blocks in order. Waits for all blocks if waitForAll is set, otherwise until fewer blocks than threads are in progress. */
+  void WriteCompressedBlocks(bool waitForAll);
+
+  int NumberOfThreads;
+  int CompressionLevel;
+  unsigned int BlockSizeBytes;
+  bool IndependentBlocks;
+  std::vector<BlockLocation> BlockLocations;
+
+  typedef std::pair<std::shared_ptr<Block>, std::future<void> > CompressionTask;
+
+  std::ostream* Output;
+  StreamFormat Format;
+  PlusStatus StreamStatus;
+  std::deque<CompressionTask> Tasks;
+  /*! Block that is being filled by AppendData, it is only compressed when it is known whether it is the last block */
+  std::shared_ptr<Block> PendingBlock;
+  std::vector<unsigned char> Dictionary;
+  unsigned long Checksum;
+  unsigned long long TotalInputBytes;
+  unsigned long long OutputPosition;
+};
+
+#endif
@@ -0,0 +1,437 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "PlusPerformanceMetrics.h"
+
+// STL includes
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  std::string EscapeJsonString(const std::string& text)
+  {
+    std::string escaped;
+    for (std::string::const_iterator c = text.begin(); c != text.end(); ++c)
+    {
+      if (*c == '"' || *c == '\\')
+      {
+        escaped += '\\';
+      }
+      escaped += *c;
+    }
+    return escaped;
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Reader of the JSON subset that is written by PlusPerformanceMetrics::WriteToFile. Unknown members are skipped. */
+  class JsonReader
+  {
+  public:
+    JsonReader(const std::string& text) : Text(text), Position(0) {}
+
+    bool ReadMetrics(PlusPerformanceMetrics::MetricMap& metrics)
+    {
+      if (!this->Accept('{'))
+      {
+        return false;
+      }
+      if (this->Accept('}'))
+      {
+        return this->IsAtEnd();
+      }
+      do
+      {
+        std::string key;
+        if (!this->ReadString(key) || !this->Accept(':'))
+        {
+          return false;
+        }
+        if (key == "metrics" ? !this->ReadMetricMap(metrics) : !this->SkipValue())
+        {
+          return false;
+        }
+      }
+      while (this->Accept(','));
+      return this->Accept('}') && this->IsAtEnd();
+    }
+
+    size_t GetPosition() const { return this->Position; }
+
+  protected:
+    bool ReadMetricMap(PlusPerformanceMetrics::MetricMap& metrics)
+    {
+      if (!this->Accept('{'))
+      {
+        return false;
+      }
+      if (this->Accept('}'))
+      {
+        return true;
+      }
+      do
+      {
+        std::string name;
+        if (!this->ReadString(name) || !this->Accept(':') || !this->Accept('{'))
+        {
+          return false;
+        }
+        bool hasValue = false;
+        double value = 0.0;
+        bool higherIsBetter = true;
+        if (!this->Accept('}'))
+        {
+          do
+          {
+            std::string key;
+            if (!this->ReadString(key) || !this->Accept(':'))
+            {
+              return false;
+            }
+            if (key == "value")
+            {
+              if (!this->ReadNumber(value))
+              {
+                return false;
+              }
+              hasValue = true;
+            }
+            else if (key == "higherIsBetter")
+            {
+              if (!this->ReadBool(higherIsBetter))
+              {
+                return false;
+              }
+            }
+            else if (!this->SkipValue())
+            {
+              return false;
+            }
+          }
+          while (this->Accept(','));
+          if (!this->Accept('}'))
+          {
+            return false;
+          }
+        }
+        if (!hasValue)
+        {
+          LOG_ERROR("Performance metric " << name << " has no value");
+          return false;
+        }
+        PlusPerformanceMetrics::Metric& metric = metrics[name];
+        metric.Value = value;
+        metric.Type = (higherIsBetter ? PlusPerformanceMetrics::THROUGHPUT : PlusPerformanceMetrics::LATENCY);
+      }
+      while (this->Accept(','));
+      return this->Accept('}');
+    }
+
+    void SkipWhitespace()
+    {
+      while (this->Position < this->Text.size() && isspace(static_cast<unsigned char>(this->Text[this->Position])))
+      {
+        this->Position++;
+      }
+    }
+
+    bool IsAtEnd()
+    {
+      this->SkipWhitespace();
+      return this->Position == this->Text.size();
+    }
+
+    /*! Consume the character if it is the next one */
+    bool Accept(char c)
+    {
+      this->SkipWhitespace();
+      if (this->Position < this->Text.size() && this->Text[this->Position] == c)
+      {
+        this->Position++;
+        return true;
+      }
+      return false;
+    }
+
+    bool ReadString(std::string& value)
+    {
+      if (!this->Accept('"'))
+      {
+        return false;
+      }
+      value.clear();
+      while (this->Position < this->Text.size())
+      {
+        char c = this->Text[this->Position++];
+        if (c == '"')
+        {
+          return true;
+        }
+        if (c == '\\')
+        {
+          if (this->Position >= this->Text.size())
+          {
+            return false;
+          }
+          c = this->Text[this->Position++];
+          switch (c)
+          {
+            case 'n':
+              c = '\n';
+              break;
+            case 't':
+              c = '\t';
+              break;
+            case 'r':
+              c = '\r';
+              break;
+            case '"':
+            case '\\':
+            case '/':
+              break;
+            default:
+              // Unicode escapes are not used in metric names
+              return false;
+          }
+        }
+        value += c;
+      }
+      return false;
+    }
+
+    bool ReadNumber(double& value)
+    {
+      this->SkipWhitespace();
+      const char* start = this->Text.c_str() + this->Position;
+      char* end = NULL;
+      value = strtod(start, &end);
+      if (end == start)
+      {
+        return false;
+      }
+      this->Position += end - start;
+      return true;
+    }
+
+    bool ReadBool(bool& value)
+    {
+      this->SkipWhitespace();
+      if (this->Text.compare(this->Position, 4, "true") == 0)
+      {
+        value = true;
+        this->Position += 4;
+        return true;
+      }
+      if (this->Text.compare(this->Position, 5, "false") == 0)
+      {
+        value = false;
+        this->Position += 5;
+        return true;
+      }
+      return false;
+    }
+
+    bool SkipValue()
+    {
+      this->SkipWhitespace();
+      if (this->Position >= this->Text.size())
+      {
+        return false;
+      }
+      const char c = this->Text[this->Position];
+      if (c == '"')
+      {
+        std::string unused;
+        return this->ReadString(unused);
+      }
+      if (c == '{' || c == '[')
+      {
+        const char closing = (c == '{' ? '}' : ']');
+        this->Position++;
+        if (this->Accept(closing))
+        {
+          return true;
+        }
+        do
+        {
+          std::string unused;
+          if (c == '{' && (!this->ReadString(unused) || !this->Accept(':')))
+          {
+            return false;
+          }
+          if (!this->SkipValue())
+          {
+            return false;
+          }
+        }
+        while (this->Accept(','));
+        return this->Accept(closing);
+      }
+      if (this->Text.compare(this->Position, 4, "null") == 0)
+      {
+        this->Position += 4;
+        return true;
+      }
+      bool unusedBool;
+      if (this->ReadBool(unusedBool))
+      {
+        return true;
+      }
+      double unusedNumber;
+      return this->ReadNumber(unusedNumber);
+    }
+
+    const std::string& Text;
+    size_t Position;
+  };
+}
+
+//----------------------------------------------------------------------------
+PlusPerformanceMetrics::PlusPerformanceMetrics()
+  : MaximumThroughputDecreasePercent(10.0)
+  , MaximumLatencyIncreasePercent(25.0)
+  , MinimumLatencyIncreaseMs(1.0)
+{
+}
+
+//----------------------------------------------------------------------------
+void PlusPerformanceMetrics::SetMetric(const std::string& name, double value, MetricType type)
+{
+  Metric& metric = this->Metrics[name];
+  metric.Value = value;
+  metric.Type = type;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusPerformanceMetrics::GetMetric(const std::string& name, double& value) const
+{
+  MetricMap::const_iterator metric = this->Metrics.find(name);
+  if (metric == this->Metrics.end())
+  {
+    return PLUS_FAIL;
+  }
+  value = metric->second.Value;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusPerformanceMetrics::WriteToFile(const std::string& filename) const
+{
+  std::ofstream file(filename.c_str());
+  if (!file.is_open())
+  {
+    LOG_ERROR("Failed to open performance metrics file for writing: " << filename);
+    return PLUS_FAIL;
+  }
+  file.imbue(std::locale::classic());
+  file << "{" << std::endl << "  \"metrics\": {";
+  for (MetricMap::const_iterator metric = this->Metrics.begin(); metric != this->Metrics.end(); ++metric)
+  {
+    file << (metric == this->Metrics.begin() ? "" : ",") << std::endl
+         << "    \"" << EscapeJsonString(metric->first) << "\": { \"value\": " << std::setprecision(10) << metric->second.Value
+         << ", \"higherIsBetter\": " << (metric->second.Type == THROUGHPUT ? "true" : "false") << " }";
+  }
+  file << std::endl << "  }" << std::endl << "}" << std::endl;
+  if (!file.good())
+  {
+    LOG_ERROR("Failed to write performance metrics file: " << filename);
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusPerformanceMetrics::ReadFromFile(const std::string& filename)
+{
+  std::ifstream file(filename.c_str());
+  if (!file.is_open())
+  {
+    LOG_ERROR("Failed to open performance metrics file: " << filename);
+    return PLUS_FAIL;
+  }
+  std::ostringstream content;
+  content << file.rdbuf();
+  if (this->ReadFromString(content.str()) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to read performance metrics file: " << filename);
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusPerformanceMetrics::ReadFromString(const std::string& json)
+{
+  MetricMap metrics;
+  JsonReader reader(json);
+  if (!reader.ReadMetrics(metrics))
+  {
+    LOG_ERROR("Invalid performance metrics, syntax error at character " << reader.GetPosition());
+    return PLUS_FAIL;
+  }
+  this->Metrics.swap(metrics);
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusPerformanceMetrics::CompareToBaseline(const PlusPerformanceMetrics& baseline, std::vector<std::string>* regressions) const
+{
+  PlusStatus status = PLUS_SUCCESS;
+  for (MetricMap::const_iterator baselineMetric = baseline.Metrics.begin(); baselineMetric != baseline.Metrics.end(); ++baselineMetric)
+  {
+    const std::string& name = baselineMetric->first;
+    const double baselineValue = baselineMetric->second.Value;
+    MetricMap::const_iterator metric = this->Metrics.find(name);
+    if (metric == this->Metrics.end())
+    {
+      status = PLUS_FAIL;
+      if (regressions != NULL)
+      {
+        regressions->push_back(name + " is in the baseline but it was not measured");
+      }
+      continue;
+    }
+    const double value = metric->second.Value;
+    const double changePercent = (baselineValue != 0.0 ? 100.0 * (value - baselineValue) / fabs(baselineValue) : 0.0);
+
+    bool regressed = false;
+    if (baselineMetric->second.Type == THROUGHPUT)
+    {
+      regressed = (-changePercent > this->MaximumThroughputDecreasePercent);
+    }
+    else
+    {
+      regressed = (changePercent > this->MaximumLatencyIncreasePercent && value - baselineValue > this->MinimumLatencyIncreaseMs);
+    }
+
+    std::ostringstream comparison;
+    comparison << name << ": " << value << " (baseline: " << baselineValue << ", " << std::showpos << std::fixed << std::setprecision(1) << changePercent << "%)";
+    LOG_INFO(comparison.str());
+    if (regressed)
+    {
+      status = PLUS_FAIL;
+      if (regressions != NULL)
+      {
+        regressions->push_back(comparison.str());
+      }
+    }
+  }
+
+  for (MetricMap::const_iterator metric = this->Metrics.begin(); metric != this->Metrics.end(); ++metric)
+  {
+    if (baseline.Metrics.find(metric->first) == baseline.Metrics.end())
+    {
+      LOG_INFO(metric->first << ": " << metric->second.Value << " (not in the baseline)");
+    }
+  }
+  return status;
+}
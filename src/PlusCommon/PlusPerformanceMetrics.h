@@ -0,0 +1,97 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusPerformanceMetrics_h
+#define __PlusPerformanceMetrics_h
+
+#include "PlusConfigure.h"
+#include "vtkPlusCommonExport.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+/*!
+  \class PlusPerformanceMetrics
+  \brief Named performance measurements of a workload, stored in a JSON file so that the results of different builds can be compared
+
+  Each metric is either a throughput (e.g., frames per second, higher is better) or a latency (in milliseconds, lower is
+  better). The benchmarks write their results with WriteToFile, and CompareToBaseline reports the metrics that got worse
+  than the same metrics of a baseline file by more than the allowed tolerance. The file format is:
+
+  \code
+  {
+    "metrics": {
+      "ScanConvertLinear/FramesPerSec": { "value": 812.5, "higherIsBetter": true },
+      "TRACKEDFRAME/LatencyP99Ms": { "value": 4.1, "higherIsBetter": false }
+    }
+  }
+  \endcode
+
+  Only this subset of JSON is read, there is no general JSON support.
+
+  \ingroup PlusLibCommon
+*/
+class vtkPlusCommonExport PlusPerformanceMetrics
+{
+public:
+  enum MetricType
+  {
+    THROUGHPUT, ///< Higher is better
+    LATENCY     ///< Lower is better, in milliseconds
+  };
+
+  struct Metric
+  {
+    double Value;
+    MetricType Type;
+  };
+  typedef std::map<std::string, Metric> MetricMap;
+
+  PlusPerformanceMetrics();
+
+  /*! Add a metric or replace the value of an existing one */
+  void SetMetric(const std::string& name, double value, MetricType type);
+  /*! Get the value of a metric. Returns PLUS_FAIL if there is no metric with this name. */
+  PlusStatus GetMetric(const std::string& name, double& value) const;
+  const MetricMap& GetMetrics() const { return this->Metrics; }
+  void Clear() { this->Metrics.clear(); }
+
+  PlusStatus WriteToFile(const std::string& filename) const;
+  PlusStatus ReadFromFile(const std::string& filename);
+  /*! Read the metrics from a JSON string, as written by WriteToFile */
+  PlusStatus ReadFromString(const std::string& json);
+
+  /*! Maximum allowed decrease of a throughput metric compared to the baseline, in percent (default: 10) */
+  void SetMaximumThroughputDecreasePercent(double percent) { this->MaximumThroughputDecreasePercent = percent; }
+  double GetMaximumThroughputDecreasePercent() const { return this->MaximumThroughputDecreasePercent; }
+
+  /*! Maximum allowed increase of a latency metric compared to the baseline, in percent (default: 25) */
+  void SetMaximumLatencyIncreasePercent(double percent) { this->MaximumLatencyIncreasePercent = percent; }
+  double GetMaximumLatencyIncreasePercent() const { return this->MaximumLatencyIncreasePercent; }
+
+  /*!
+    Latency increases that are smaller than this are always allowed, in milliseconds (default: 1).
+    Latencies of a few milliseconds are dominated by scheduling noise, where a percentage tolerance alone would give false alarms.
+  */
+  void SetMinimumLatencyIncreaseMs(double latencyMs) { this->MinimumLatencyIncreaseMs = latencyMs; }
+  double GetMinimumLatencyIncreaseMs() const { return this->MinimumLatencyIncreaseMs; }
+
+  /*!
+    Compare the metrics to the same metrics of a baseline. The comparison of each metric is logged at info level.
+    A description of each metric that got worse than allowed and of each baseline metric that is missing from these
+    metrics is added to the regressions (if not NULL). Returns PLUS_FAIL if there is any regression.
+  */
+  PlusStatus CompareToBaseline(const PlusPerformanceMetrics& baseline, std::vector<std::string>* regressions = NULL) const;
+
+protected:
+  MetricMap Metrics;
+  double MaximumThroughputDecreasePercent;
+  double MaximumLatencyIncreasePercent;
+  double MinimumLatencyIncreaseMs;
+};
+
+#endif
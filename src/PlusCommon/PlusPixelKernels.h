@@ -0,0 +1,346 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusPixelKernels_h
+#define __PlusPixelKernels_h
+
+#include "PlusConfigure.h"
+
+#include <vtkType.h>
+
+#include <cstring>
+
+// SSE2 is available on all x86-64 processors, so the vectorized kernels are selected at compile time
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define PLUS_PIXELKERNELS_SSE2
+  #include <emmintrin.h>
+#endif
+
+/*!
+\class PlusPixelKernels
+\brief Row kernels for frame operations, specialized at compile time for the pixel size
+
+Frame operations only move whole pixels, so the kernels are templated on an opaque pixel type of a fixed number of bytes
+instead of the VTK scalar type. The pixel type is selected once per frame by DispatchPixelType/DispatchPixelSize, which
+call the Run<PixelType>() member template of a functor; the inner loops then copy pixels with fixed-size moves.
+Kernels for 1, 2 and 4 byte pixels are vectorized with SSE2 when it is available, as are the 8-bit threshold and upscale
+kernels that prepare image regions for text recognition.
+
+\ingroup PlusLibCommon
+*/
+class PlusPixelKernels
+{
+public:
+  /*! Opaque pixel of N bytes */
+  template<unsigned int N>
+  struct Pixel
+  {
+    unsigned char Bytes[N];
+  };
+
+  //----------------------------------------------------------------------------
+  /*! Returns the size of a scalar of the given VTK type in bytes, 0 if the type is not known */
+  static unsigned int GetScalarSize(igsioCommon::VTKScalarPixelType pixelType)
+  {
+    switch (pixelType)
+    {
+      case VTK_CHAR:
+      case VTK_SIGNED_CHAR:
+      case VTK_UNSIGNED_CHAR:
+        return 1;
+      case VTK_SHORT:
+      case VTK_UNSIGNED_SHORT:
+        return 2;
+      case VTK_INT:
+      case VTK_UNSIGNED_INT:
+      case VTK_FLOAT:
+        return 4;
+      case VTK_LONG:
+      case VTK_UNSIGNED_LONG:
+        return sizeof(long);
+      case VTK_LONG_LONG:
+      case VTK_UNSIGNED_LONG_LONG:
+      case VTK_DOUBLE:
+        return 8;
+      default:
+        return 0;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /*!
+    Calls functor.Run<Pixel<N> >() where N is the pixel size of the given scalar type and number of components.
+    Returns PLUS_FAIL without calling the functor if the pixel size is not supported.
+  */
+  template<class Functor>
+  static PlusStatus DispatchPixelType(igsioCommon::VTKScalarPixelType pixelType, unsigned int numberOfScalarComponents, Functor& functor)
+  {
+    return DispatchPixelSize(GetScalarSize(pixelType) * numberOfScalarComponents, functor);
+  }
+
+  //----------------------------------------------------------------------------
+  /*!
+    Calls functor.Run<Pixel<bytesPerPixel> >(). All VTK scalar types with 1 to 4 components are supported.
+    Returns PLUS_FAIL without calling the functor if the pixel size is not supported.
+  */
+  template<class Functor>
+  static PlusStatus DispatchPixelSize(unsigned int bytesPerPixel, Functor& functor)
+  {
+    switch (bytesPerPixel)
+    {
+      case 1:
+        functor.template Run<Pixel<1> >();
+        return PLUS_SUCCESS;
+      case 2:
+        functor.template Run<Pixel<2> >();
+        return PLUS_SUCCESS;
+      case 3:
+        functor.template Run<Pixel<3> >();
+        return PLUS_SUCCESS;
+      case 4:
+        functor.template Run<Pixel<4> >();
+        return PLUS_SUCCESS;
+      case 6:
+        functor.template Run<Pixel<6> >();
+        return PLUS_SUCCESS;
+      case 8:
+        functor.template Run<Pixel<8> >();
+        return PLUS_SUCCESS;
+      case 12:
+        functor.template Run<Pixel<12> >();
+        return PLUS_SUCCESS;
+      case 16:
+        functor.template Run<Pixel<16> >();
+        return PLUS_SUCCESS;
+      case 24:
+        functor.template Run<Pixel<24> >();
+        return PLUS_SUCCESS;
+      case 32:
+        functor.template Run<Pixel<32> >();
+        return PLUS_SUCCESS;
+      default:
+        return PLUS_FAIL;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  template<class PixelType>
+  static void CopyRow(const PixelType* inputRow, PixelType* outputRow, unsigned int numberOfPixels)
+  {
+    memcpy(outputRow, inputRow, numberOfPixels * sizeof(PixelType));
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Copy the pixels of a row in reverse order */
+  template<class PixelType>
+  static void ReverseRow(const PixelType* inputRow, PixelType* outputRow, unsigned int numberOfPixels)
+  {
+    const PixelType* inputPixel = inputRow + numberOfPixels;
+    for (unsigned int x = 0; x < numberOfPixels; x++)
+    {
+      outputRow[x] = *(--inputPixel);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Copy the even pixels of a row to evenRow and the odd pixels to oddRow */
+  template<class PixelType>
+  static void DeinterleaveRow(const PixelType* inputRow, unsigned int numberOfPixels, PixelType* evenRow, PixelType* oddRow)
+  {
+    DeinterleaveRowTail(inputRow, 0, numberOfPixels, evenRow, oddRow);
+  }
+
+  //----------------------------------------------------------------------------
+  /*!
+    Convert pixels of NumberOfComponents 8-bit components to grayscale by averaging the first three (R, G, B) components.
+    Further components (alpha) are ignored.
+  */
+  template<unsigned int NumberOfComponents>
+  static void ColorToGray(int numberOfPixels, const unsigned char* s, unsigned char* d)
+  {
+    for (int i = 0; i < numberOfPixels; i++)
+    {
+      *d = ((unsigned short)(s[0]) + s[1] + s[2]) / 3;
+      d++;
+      s += NumberOfComponents;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Set the 8-bit pixels of a row to 255 if they are greater than the threshold, to 0 otherwise */
+  static void ThresholdRow(const unsigned char* inputRow, unsigned char* outputRow, unsigned int numberOfPixels, unsigned char threshold)
+  {
+    unsigned int x = 0;
+#ifdef PLUS_PIXELKERNELS_SSE2
+    // SSE2 only has signed byte comparison, flipping the sign bit of both operands makes it an unsigned comparison
+    const __m128i signBit = _mm_set1_epi8(static_cast<char>(0x80));
+    const __m128i signedThreshold = _mm_xor_si128(_mm_set1_epi8(static_cast<char>(threshold)), signBit);
+    for (; x + 16 <= numberOfPixels; x += 16)
+    {
+      const __m128i v = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(inputRow + x)), signBit);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(outputRow + x), _mm_cmpgt_epi8(v, signedThreshold));
+    }
+#endif
+    for (; x < numberOfPixels; x++)
+    {
+      outputRow[x] = (inputRow[x] > threshold) ? 255 : 0;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Repeat each 8-bit pixel of a row factor times, the output row is numberOfPixels * factor long */
+  static void UpscaleRow(const unsigned char* inputRow, unsigned char* outputRow, unsigned int numberOfPixels, unsigned int factor)
+  {
+    unsigned int x = 0;
+#ifdef PLUS_PIXELKERNELS_SSE2
+    if (factor == 2)
+    {
+      for (; x + 16 <= numberOfPixels; x += 16)
+      {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(inputRow + x));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(outputRow + 2 * x), _mm_unpacklo_epi8(v, v));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(outputRow + 2 * x + 16), _mm_unpackhi_epi8(v, v));
+      }
+    }
+#endif
+    for (; x < numberOfPixels; x++)
+    {
+      memset(outputRow + x * factor, inputRow[x], factor);
+    }
+  }
+
+#ifdef PLUS_PIXELKERNELS_SSE2
+  //----------------------------------------------------------------------------
+  static void ReverseRow(const Pixel<1>* inputRow, Pixel<1>* outputRow, unsigned int numberOfPixels)
+  {
+    const unsigned char* input = reinterpret_cast<const unsigned char*>(inputRow);
+    unsigned char* output = reinterpret_cast<unsigned char*>(outputRow);
+    unsigned int x = 0;
+    for (; x + 16 <= numberOfPixels; x += 16)
+    {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + numberOfPixels - 16 - x));
+      // Swap the bytes in each 16-bit word, then reverse the words
+      v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(output + x), ReverseWords(v));
+    }
+    for (; x < numberOfPixels; x++)
+    {
+      output[x] = input[numberOfPixels - 1 - x];
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  static void ReverseRow(const Pixel<2>* inputRow, Pixel<2>* outputRow, unsigned int numberOfPixels)
+  {
+    unsigned int x = 0;
+    for (; x + 8 <= numberOfPixels; x += 8)
+    {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(inputRow + numberOfPixels - 8 - x));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(outputRow + x), ReverseWords(v));
+    }
+    for (; x < numberOfPixels; x++)
+    {
+      outputRow[x] = inputRow[numberOfPixels - 1 - x];
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  static void ReverseRow(const Pixel<4>* inputRow, Pixel<4>* outputRow, unsigned int numberOfPixels)
+  {
+    unsigned int x = 0;
+    for (; x + 4 <= numberOfPixels; x += 4)
+    {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(inputRow + numberOfPixels - 4 - x));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(outputRow + x), _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3)));
+    }
+    for (; x < numberOfPixels; x++)
+    {
+      outputRow[x] = inputRow[numberOfPixels - 1 - x];
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  // 32 bytes of input are split into 16 bytes of even and 16 bytes of odd pixels in each iteration
+  static void DeinterleaveRow(const Pixel<1>* inputRow, unsigned int numberOfPixels, Pixel<1>* evenRow, Pixel<1>* oddRow)
+  {
+    const __m128i lowBytesMask = _mm_set1_epi16(0x00FF);
+    unsigned int pixel = 0;
+    for (; pixel + 32 <= numberOfPixels; pixel += 32)
+    {
+      const __m128i input0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(inputRow + pixel));
+      const __m128i input1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(inputRow + pixel + 16));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(evenRow + pixel / 2),
+                       _mm_packus_epi16(_mm_and_si128(input0, lowBytesMask), _mm_and_si128(input1, lowBytesMask)));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(oddRow + pixel / 2),
+                       _mm_packus_epi16(_mm_srli_epi16(input0, 8), _mm_srli_epi16(input1, 8)));
+    }
+    DeinterleaveRowTail(inputRow, pixel, numberOfPixels, evenRow, oddRow);
+  }
+
+  //----------------------------------------------------------------------------
+  static void DeinterleaveRow(const Pixel<2>* inputRow, unsigned int numberOfPixels, Pixel<2>* evenRow, Pixel<2>* oddRow)
+  {
+    unsigned int pixel = 0;
+    for (; pixel + 16 <= numberOfPixels; pixel += 16)
+    {
+      const __m128i input0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(inputRow + pixel));
+      const __m128i input1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(inputRow + pixel + 8));
+      // Sign extension makes the signed saturation of the packing exact
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(evenRow + pixel / 2),
+                       _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(input0, 16), 16), _mm_srai_epi32(_mm_slli_epi32(input1, 16), 16)));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(oddRow + pixel / 2),
+                       _mm_packs_epi32(_mm_srai_epi32(input0, 16), _mm_srai_epi32(input1, 16)));
+    }
+    DeinterleaveRowTail(inputRow, pixel, numberOfPixels, evenRow, oddRow);
+  }
+
+  //----------------------------------------------------------------------------
+  static void DeinterleaveRow(const Pixel<4>* inputRow, unsigned int numberOfPixels, Pixel<4>* evenRow, Pixel<4>* oddRow)
+  {
+    unsigned int pixel = 0;
+    for (; pixel + 8 <= numberOfPixels; pixel += 8)
+    {
+      const __m128i sorted0 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(inputRow + pixel)), _MM_SHUFFLE(3, 1, 2, 0));
+      const __m128i sorted1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(inputRow + pixel + 4)), _MM_SHUFFLE(3, 1, 2, 0));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(evenRow + pixel / 2), _mm_unpacklo_epi64(sorted0, sorted1));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(oddRow + pixel / 2), _mm_unpackhi_epi64(sorted0, sorted1));
+    }
+    DeinterleaveRowTail(inputRow, pixel, numberOfPixels, evenRow, oddRow);
+  }
+#endif
+
+protected:
+  //----------------------------------------------------------------------------
+  /*! Deinterleave the pixels of a row starting from an even firstPixel */
+  template<class PixelType>
+  static void DeinterleaveRowTail(const PixelType* inputRow, unsigned int firstPixel, unsigned int numberOfPixels, PixelType* evenRow, PixelType* oddRow)
+  {
+    unsigned int pixel = firstPixel;
+    for (; pixel + 1 < numberOfPixels; pixel += 2)
+    {
+      evenRow[pixel / 2] = inputRow[pixel];
+      oddRow[pixel / 2] = inputRow[pixel + 1];
+    }
+    if (pixel < numberOfPixels)
+    {
+      // Odd number of pixels, the last one only has an even pixel
+      evenRow[pixel / 2] = inputRow[pixel];
+    }
+  }
+
+#ifdef PLUS_PIXELKERNELS_SSE2
+  //----------------------------------------------------------------------------
+  /*! Reverse the order of the 16-bit words in a vector */
+  static __m128i ReverseWords(__m128i v)
+  {
+    v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+    v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+    return _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+  }
+#endif
+};
+
+#endif
@@ -0,0 +1,93 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusProfiler_h
+#define __PlusProfiler_h
+
+#include "PlusConfigure.h"
+
+/*!
+\file PlusProfiler.h
+\brief Instrumentation macros for external profilers
+
+The macros mark zones (scoped time ranges) and name threads, so that a timeline profiler shows where the acquisition,
+buffering, streaming and recording threads spend their time and where they wait for each other. The profiler is
+selected at configuration time with the PLUS_PROFILER CMake variable:
+- TRACY: zones and thread names are reported to the Tracy client
+- ITT: zones are reported as tasks of the "Plus" domain to Intel VTune (instrumentation and tracing technology API)
+- NONE (default): the macros expand to nothing, instrumented code is compiled exactly as without them
+
+Zone names must be string literals, thread names and zone texts are copied. Zones end at the end of the enclosing scope,
+at most one zone per scope.
+
+  PLUS_PROFILE_ZONE(name) - starts a zone
+  PLUS_PROFILE_ZONE_TEXT(text, length) - attaches a text (e.g. a device id) to the current zone
+  PLUS_PROFILE_THREAD_NAME(name) - names the calling thread
+
+\ingroup PlusLibCommon
+*/
+
+#if defined(PLUS_PROFILER_TRACY)
+
+#include <tracy/Tracy.hpp>
+
+#define PLUS_PROFILE_ZONE(name) ZoneScopedN(name)
+#define PLUS_PROFILE_ZONE_TEXT(text, length) ZoneText(text, length)
+#define PLUS_PROFILE_THREAD_NAME(name) tracy::SetThreadName(name)
+
+#elif defined(PLUS_PROFILER_ITT)
+
+#include <ittnotify.h>
+
+namespace PlusProfiler
+{
+  //----------------------------------------------------------------------------
+  inline __itt_domain* GetDomain()
+  {
+    static __itt_domain* domain = __itt_domain_create("Plus");
+    return domain;
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Task of the Plus domain that lasts until the end of the scope */
+  class ScopedTask
+  {
+  public:
+    explicit ScopedTask(__itt_string_handle* name)
+    {
+      __itt_task_begin(GetDomain(), __itt_null, __itt_null, name);
+    }
+    ~ScopedTask()
+    {
+      __itt_task_end(GetDomain());
+    }
+    void SetText(const char* text, size_t length)
+    {
+      static __itt_string_handle* key = __itt_string_handle_create("Text");
+      __itt_metadata_str_add(GetDomain(), __itt_null, key, text, length);
+    }
+  private:
+    ScopedTask(const ScopedTask&);
+    void operator=(const ScopedTask&);
+  };
+}
+
+// The string handle is created once per zone, on the first pass
+#define PLUS_PROFILE_ZONE(name) \
+  static __itt_string_handle* plusProfileZoneName = __itt_string_handle_create(name); \
+  PlusProfiler::ScopedTask plusProfileZone(plusProfileZoneName)
+#define PLUS_PROFILE_ZONE_TEXT(text, length) plusProfileZone.SetText(text, length)
+#define PLUS_PROFILE_THREAD_NAME(name) __itt_thread_set_name(name)
+
+#else
+
+#define PLUS_PROFILE_ZONE(name)
+#define PLUS_PROFILE_ZONE_TEXT(text, length)
+#define PLUS_PROFILE_THREAD_NAME(name)
+
+#endif
+
+#endif
@@ -0,0 +1,79 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "PlusSequenceFrameCache.h"
+
+// IGSIO includes
+#include <igsioTrackedFrame.h>
+
+// STL includes
+#include <algorithm>
+
+//----------------------------------------------------------------------------
+PlusSequenceFrameCache::PlusSequenceFrameCache()
+  : MaximumNumberOfFrames(50)
+{
+}
+
+//----------------------------------------------------------------------------
+PlusSequenceFrameCache::~PlusSequenceFrameCache()
+{
+  this->Close();
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusSequenceFrameCache::Open(const std::string& filename)
+{
+  this->Close();
+  return this->Reader.Open(filename);
+}
+
+//----------------------------------------------------------------------------
+void PlusSequenceFrameCache::Close()
+{
+  this->Frames.clear();
+  this->FrameLookup.clear();
+  this->Reader.Close();
+}
+
+//----------------------------------------------------------------------------
+void PlusSequenceFrameCache::SetMaximumNumberOfFrames(unsigned int maximumNumberOfFrames)
+{
+  this->MaximumNumberOfFrames = std::max(maximumNumberOfFrames, 1u);
+  while (this->Frames.size() > this->MaximumNumberOfFrames)
+  {
+    this->FrameLookup.erase(this->Frames.back().first);
+    this->Frames.pop_back();
+  }
+}
+
+//----------------------------------------------------------------------------
+std::shared_ptr<igsioTrackedFrame> PlusSequenceFrameCache::GetFrame(unsigned int frameIndex)
+{
+  std::map<unsigned int, CachedFrameList::iterator>::iterator cachedFrame = this->FrameLookup.find(frameIndex);
+  if (cachedFrame != this->FrameLookup.end())
+  {
+    // Move the frame to the front of the list, the iterators remain valid
+    this->Frames.splice(this->Frames.begin(), this->Frames, cachedFrame->second);
+    return cachedFrame->second->second;
+  }
+
+  std::shared_ptr<igsioTrackedFrame> frame = std::make_shared<igsioTrackedFrame>();
+  if (this->Reader.ReadFrame(frameIndex, *frame) != PLUS_SUCCESS)
+  {
+    return std::shared_ptr<igsioTrackedFrame>();
+  }
+
+  if (this->Frames.size() >= this->MaximumNumberOfFrames)
+  {
+    this->FrameLookup.erase(this->Frames.back().first);
+    this->Frames.pop_back();
+  }
+  this->Frames.push_front(std::make_pair(frameIndex, frame));
+  this->FrameLookup[frameIndex] = this->Frames.begin();
+  return frame;
+}
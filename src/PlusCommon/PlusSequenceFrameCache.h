@@ -0,0 +1,79 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusSequenceFrameCache_h
+#define __PlusSequenceFrameCache_h
+
+#include "PlusConfigure.h"
+#include "vtkPlusCommonExport.h"
+#include "PlusSequenceStreamReader.h"
+
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+
+class igsioTrackedFrame;
+
+/*!
+  \class PlusSequenceFrameCache
+  \brief Decodes the frames of a sequence file on demand and keeps the most recently used ones in memory
+
+  Frames are read through PlusSequenceStreamReader, so for files with known frame locations (uncompressed or indexed files)
+  only the requested frames are read from the file. When the cache is full, the least recently used frame is released.
+  Intended for viewers that show one frame of a long recording at a time. The class is not thread-safe.
+
+  \ingroup PlusLibCommon
+*/
+class vtkPlusCommonExport PlusSequenceFrameCache
+{
+public:
+  PlusSequenceFrameCache();
+  ~PlusSequenceFrameCache();
+
+  /*! Open a sequence file and release all cached frames */
+  PlusStatus Open(const std::string& filename);
+
+  /*! Close the file and release all cached frames */
+  void Close();
+
+  /*! Maximum number of decoded frames that are kept in memory (at least 1) */
+  void SetMaximumNumberOfFrames(unsigned int maximumNumberOfFrames);
+  unsigned int GetMaximumNumberOfFrames() const { return this->MaximumNumberOfFrames; }
+
+  /*! True if frames are read from the file on demand, false if the whole file has been read into memory */
+  bool IsStreamed() const { return this->Reader.IsStreamed(); }
+
+  unsigned int GetNumberOfFrames() const { return this->Reader.GetNumberOfFrames(); }
+
+  /*! Timestamp of a frame, available without decoding the frame */
+  double GetFrameTimestamp(unsigned int frameIndex) const { return this->Reader.GetFrameTimestamp(frameIndex); }
+
+  /*! Number of frames that are currently kept in memory */
+  unsigned int GetNumberOfCachedFrames() const { return static_cast<unsigned int>(this->Frames.size()); }
+
+  /*!
+    Get a frame, decode it if it is not in the cache. Returns NULL if the frame cannot be read.
+    The returned frame remains valid after it is released from the cache.
+  */
+  std::shared_ptr<igsioTrackedFrame> GetFrame(unsigned int frameIndex);
+
+protected:
+  typedef std::list<std::pair<unsigned int, std::shared_ptr<igsioTrackedFrame> > > CachedFrameList;
+
+  PlusSequenceStreamReader Reader;
+  unsigned int MaximumNumberOfFrames;
+
+  /*! Cached frames, the most recently used one first */
+  CachedFrameList Frames;
+  std::map<unsigned int, CachedFrameList::iterator> FrameLookup;
+
+private:
+  PlusSequenceFrameCache(const PlusSequenceFrameCache&);
+  void operator=(const PlusSequenceFrameCache&);
+};
+
+#endif
@@ -0,0 +1,845 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "PlusParallelCompressor.h"
+#include "PlusSequenceFrameIndex.h"
+
+// IGSIO includes
+#include <igsioTrackedFrame.h>
+
+// VTK includes
+#include <vtkType.h>
+#include <vtksys/SystemTools.hxx>
+
+// STL includes
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+  const char SIDECAR_MAGIC[8] = { 'P', 'L', 'U', 'S', 'F', 'I', 'D', 'X' };
+  const unsigned int SIDECAR_VERSION = 2;
+  const char SIDECAR_FILENAME_EXTENSION[] = ".fidx";
+
+  //----------------------------------------------------------------------------
+  template<typename T>
+  void WriteValue(std::ostream& stream, const T& value)
+  {
+    stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+
+  //----------------------------------------------------------------------------
+  template<typename T>
+  bool ReadValue(std::istream& stream, T& value)
+  {
+    stream.read(reinterpret_cast<char*>(&value), sizeof(T));
+    return stream.good();
+  }
+
+  //----------------------------------------------------------------------------
+  void WriteString(std::ostream& stream, const std::string& value)
+  {
+    WriteValue<unsigned int>(stream, static_cast<unsigned int>(value.size()));
+    stream.write(value.c_str(), value.size());
+  }
+
+  //----------------------------------------------------------------------------
+  bool ReadString(std::istream& stream, std::string& value)
+  {
+    unsigned int length(0);
+    if (!ReadValue(stream, length))
+    {
+      return false;
+    }
+    value.resize(length);
+    if (length > 0)
+    {
+      stream.read(&value[0], length);
+    }
+    return stream.good();
+  }
+
+  //----------------------------------------------------------------------------
+  // Size and modification time identify the version of the sequence file that an index was built from
+  bool GetFileFingerprint(const std::string& filename, unsigned long long& fileSize, long& modifiedTime)
+  {
+    std::ifstream file(filename.c_str(), std::ios::in | std::ios::binary);
+    if (!file.is_open())
+    {
+      return false;
+    }
+    file.seekg(0, std::ios::end);
+    fileSize = static_cast<unsigned long long>(file.tellg());
+    modifiedTime = vtksys::SystemTools::ModifiedTime(filename);
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  std::string ReadHeaderLine(std::istream& header)
+  {
+    std::string line;
+    std::getline(header, line);
+    if (!line.empty() && line[line.size() - 1] == '\r')
+    {
+      line.erase(line.size() - 1);
+    }
+    return line;
+  }
+
+  //----------------------------------------------------------------------------
+  std::vector<unsigned int> ParseUnsignedIntList(const std::string& value)
+  {
+    std::vector<unsigned int> result;
+    std::istringstream stream(value);
+    unsigned int item(0);
+    while (stream >> item)
+    {
+      result.push_back(item);
+    }
+    return result;
+  }
+
+  //----------------------------------------------------------------------------
+  igsioCommon::VTKScalarPixelType GetPixelTypeFromMetaElementType(const std::string& elementType)
+  {
+    if (elementType == "MET_UCHAR") { return VTK_UNSIGNED_CHAR; }
+    if (elementType == "MET_CHAR") { return VTK_CHAR; }
+    if (elementType == "MET_USHORT") { return VTK_UNSIGNED_SHORT; }
+    if (elementType == "MET_SHORT") { return VTK_SHORT; }
+    if (elementType == "MET_UINT") { return VTK_UNSIGNED_INT; }
+    if (elementType == "MET_INT") { return VTK_INT; }
+    if (elementType == "MET_FLOAT") { return VTK_FLOAT; }
+    if (elementType == "MET_DOUBLE") { return VTK_DOUBLE; }
+    return VTK_VOID;
+  }
+
+  //----------------------------------------------------------------------------
+  igsioCommon::VTKScalarPixelType GetPixelTypeFromNrrdType(const std::string& type)
+  {
+    if (type == "uchar" || type == "unsigned char" || type == "uint8" || type == "uint8_t") { return VTK_UNSIGNED_CHAR; }
+    if (type == "signed char" || type == "int8" || type == "int8_t") { return VTK_CHAR; }
+    if (type == "ushort" || type == "unsigned short" || type == "unsigned short int" || type == "uint16" || type == "uint16_t") { return VTK_UNSIGNED_SHORT; }
+    if (type == "short" || type == "short int" || type == "signed short" || type == "signed short int" || type == "int16" || type == "int16_t") { return VTK_SHORT; }
+    if (type == "uint" || type == "unsigned int" || type == "uint32" || type == "uint32_t") { return VTK_UNSIGNED_INT; }
+    if (type == "int" || type == "signed int" || type == "int32" || type == "int32_t") { return VTK_INT; }
+    if (type == "float") { return VTK_FLOAT; }
+    if (type == "double") { return VTK_DOUBLE; }
+    return VTK_VOID;
+  }
+
+  //----------------------------------------------------------------------------
+  // Get the frame number and field name from a frame field key (Seq_Frame0012_Timestamp => 12, Timestamp)
+  bool ParseFrameFieldKey(const std::string& key, unsigned int& frameIndex, std::string& fieldName)
+  {
+    const std::string prefix = "Seq_Frame";
+    if (key.compare(0, prefix.size(), prefix) != 0)
+    {
+      return false;
+    }
+    size_t separator = key.find('_', prefix.size());
+    if (separator == std::string::npos || separator == prefix.size())
+    {
+      return false;
+    }
+    std::string frameIndexStr = key.substr(prefix.size(), separator - prefix.size());
+    if (frameIndexStr.find_first_not_of("0123456789") != std::string::npos)
+    {
+      return false;
+    }
+    frameIndex = static_cast<unsigned int>(strtoul(frameIndexStr.c_str(), NULL, 10));
+    fieldName = key.substr(separator + 1);
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  // MetaImage header fields that are written by the sequence file writer, not stored as custom fields
+  bool IsMetaImageGeometryField(const std::string& key)
+  {
+    static const char* geometryFields[] =
+    {
+      "ObjectType", "NDims", "BinaryData", "BinaryDataByteOrderMSB", "CompressedData", "CompressedDataSize",
+      "TransformMatrix", "Offset", "CenterOfRotation", "AnatomicalOrientation", "ElementSpacing", "DimSize",
+      "ElementNumberOfChannels", "ElementType", "ElementDataFile", "Kinds", NULL
+    };
+    for (const char** field = geometryFields; *field != NULL; ++field)
+    {
+      if (key == *field)
+      {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  //----------------------------------------------------------------------------
+  bool IsFrameEarlier(const PlusSequenceFrameIndex::FrameEntry& frame, double time)
+  {
+    return frame.Timestamp < time;
+  }
+
+  //----------------------------------------------------------------------------
+  bool IsFrameLater(double time, const PlusSequenceFrameIndex::FrameEntry& frame)
+  {
+    return time < frame.Timestamp;
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusSequenceFrameIndex::PlusSequenceFrameIndex()
+{
+  this->Clear();
+}
+
+//----------------------------------------------------------------------------
+void PlusSequenceFrameIndex::Clear()
+{
+  this->SequenceFilename.clear();
+  this->DataFilename.clear();
+  this->FrameSize[0] = 0;
+  this->FrameSize[1] = 0;
+  this->FrameSize[2] = 0;
+  this->PixelType = VTK_VOID;
+  this->NumberOfScalarComponents = 1;
+  this->ImageOrientation = US_IMG_ORIENT_MF;
+  this->ImageType = US_IMG_BRIGHTNESS;
+  this->FrameDataCompressed = false;
+  this->CustomFields.clear();
+  this->Frames.clear();
+}
+
+//----------------------------------------------------------------------------
+void PlusSequenceFrameIndex::SetFrameDataLocation(unsigned int frameIndex, unsigned long long offset, unsigned long long size)
+{
+  this->Frames[frameIndex].Offset = offset;
+  this->Frames[frameIndex].Size = size;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusSequenceFrameIndex::ReadFrameData(std::istream& dataFile, unsigned int frameIndex, std::vector<unsigned char>& pixels) const
+{
+  if (frameIndex >= this->Frames.size())
+  {
+    LOG_ERROR("Frame " << frameIndex << " is not in sequence file " << this->SequenceFilename);
+    return PLUS_FAIL;
+  }
+  const FrameEntry& frame = this->Frames[frameIndex];
+
+  std::vector<unsigned char> compressedPixels;
+  std::vector<unsigned char>& storedPixels = this->FrameDataCompressed ? compressedPixels : pixels;
+  storedPixels.resize(static_cast<size_t>(frame.Size));
+  dataFile.clear();
+  dataFile.seekg(static_cast<std::streamoff>(frame.Offset), std::ios::beg);
+  if (frame.Size > 0)
+  {
+    dataFile.read(reinterpret_cast<char*>(&storedPixels[0]), static_cast<std::streamsize>(frame.Size));
+  }
+  if (!dataFile.good())
+  {
+    LOG_ERROR("Failed to read frame " << frameIndex << " from " << this->DataFilename);
+    return PLUS_FAIL;
+  }
+
+  if (this->FrameDataCompressed)
+  {
+    pixels.resize(static_cast<size_t>(this->GetFrameSizeInBytes()));
+    if (!pixels.empty()
+        && PlusParallelCompressor::DecompressBlock(compressedPixels.empty() ? NULL : &compressedPixels[0], compressedPixels.size(), &pixels[0], pixels.size()) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to decompress frame " << frameIndex << " of " << this->DataFilename);
+      return PLUS_FAIL;
+    }
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusSequenceFrameIndex::ReadTrackedFrame(std::istream& dataFile, unsigned int frameIndex, igsioTrackedFrame& trackedFrame) const
+{
+  std::vector<unsigned char> pixels;
+  if (this->ReadFrameData(dataFile, frameIndex, pixels) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+
+  igsioVideoFrame* image = trackedFrame.GetImageData();
+  if (image->AllocateFrame(this->FrameSize, this->PixelType, this->NumberOfScalarComponents) != PLUS_SUCCESS
+      || image->GetFrameSizeInBytes() != pixels.size())
+  {
+    LOG_ERROR("Failed to allocate image for frame " << frameIndex << " of " << this->SequenceFilename);
+    return PLUS_FAIL;
+  }
+  if (!pixels.empty())
+  {
+    memcpy(image->GetScalarPointer(), &pixels[0], pixels.size());
+  }
+  image->SetImageOrientation(this->ImageOrientation);
+  image->SetImageType(this->ImageType);
+
+  const FrameEntry& frame = this->Frames[frameIndex];
+  trackedFrame.SetTimestamp(frame.Timestamp);
+  for (FrameFieldList::const_iterator field = frame.Fields.begin(); field != frame.Fields.end(); ++field)
+  {
+    trackedFrame.SetFrameField(field->first, field->second);
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+unsigned int PlusSequenceFrameIndex::GetFrameIndexFromTime(double time) const
+{
+  // Frames are stored in time order
+  std::vector<FrameEntry>::const_iterator laterFrame = std::lower_bound(this->Frames.begin(), this->Frames.end(), time, IsFrameEarlier);
+  if (laterFrame == this->Frames.begin())
+  {
+    return 0;
+  }
+  if (laterFrame == this->Frames.end())
+  {
+    return static_cast<unsigned int>(this->Frames.size() - 1);
+  }
+  std::vector<FrameEntry>::const_iterator earlierFrame = laterFrame - 1;
+  if (time - earlierFrame->Timestamp <= laterFrame->Timestamp - time)
+  {
+    return static_cast<unsigned int>(earlierFrame - this->Frames.begin());
+  }
+  return static_cast<unsigned int>(laterFrame - this->Frames.begin());
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusSequenceFrameIndex::GetFrameIndexRange(double startTime, double stopTime, unsigned int& firstFrameIndex, unsigned int& lastFrameIndex) const
+{
+  std::vector<FrameEntry>::const_iterator firstFrame = std::lower_bound(this->Frames.begin(), this->Frames.end(), startTime, IsFrameEarlier);
+  std::vector<FrameEntry>::const_iterator afterLastFrame = std::upper_bound(this->Frames.begin(), this->Frames.end(), stopTime, IsFrameLater);
+  if (firstFrame >= afterLastFrame)
+  {
+    return PLUS_FAIL;
+  }
+  firstFrameIndex = static_cast<unsigned int>(firstFrame - this->Frames.begin());
+  lastFrameIndex = static_cast<unsigned int>(afterLastFrame - this->Frames.begin()) - 1;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+std::string PlusSequenceFrameIndex::GetSidecarFilename(const std::string& sequenceFilename)
+{
+  return sequenceFilename + SIDECAR_FILENAME_EXTENSION;
+}
+
+//----------------------------------------------------------------------------
+unsigned long long PlusSequenceFrameIndex::GetFrameSizeInBytes() const
+{
+  int bytesPerScalar = 0;
+  switch (this->PixelType)
+  {
+    case VTK_CHAR:
+    case VTK_UNSIGNED_CHAR:
+      bytesPerScalar = 1;
+      break;
+    case VTK_SHORT:
+    case VTK_UNSIGNED_SHORT:
+      bytesPerScalar = 2;
+      break;
+    case VTK_INT:
+    case VTK_UNSIGNED_INT:
+    case VTK_FLOAT:
+      bytesPerScalar = 4;
+      break;
+    case VTK_DOUBLE:
+      bytesPerScalar = 8;
+      break;
+    default:
+      return 0;
+  }
+  return static_cast<unsigned long long>(this->FrameSize[0]) * this->FrameSize[1] * this->FrameSize[2] * this->NumberOfScalarComponents * bytesPerScalar;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusSequenceFrameIndex::Load(const std::string& sequenceFilename, bool writeSidecarFile/*=true*/)
+{
+  if (this->ReadSidecarFile(sequenceFilename) == PLUS_SUCCESS)
+  {
+    LOG_DEBUG("Frame index of " << sequenceFilename << " is read from " << GetSidecarFilename(sequenceFilename));
+    return PLUS_SUCCESS;
+  }
+  if (this->BuildFromSequenceFile(sequenceFilename) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  if (writeSidecarFile && this->WriteSidecarFile() != PLUS_SUCCESS)
+  {
+    // not an error, the index is rebuilt next time
+    LOG_DEBUG("Frame index of " << sequenceFilename << " could not be cached");
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusSequenceFrameIndex::BuildFromSequenceFile(const std::string& sequenceFilename)
+{
+  this->Clear();
+
+  std::ifstream header(sequenceFilename.c_str(), std::ios::in | std::ios::binary);
+  if (!header.is_open())
+  {
+    LOG_ERROR("Failed to open sequence file: " << sequenceFilename);
+    return PLUS_FAIL;
+  }
+  this->SequenceFilename = sequenceFilename;
+
+  std::vector<std::pair<std::string, std::string> > fields;
+  unsigned long long dataOffset(0);
+  std::string extension = vtksys::SystemTools::LowerCase(vtksys::SystemTools::GetFilenameLastExtension(sequenceFilename));
+  PlusStatus status = PLUS_FAIL;
+  if (extension == ".mha" || extension == ".mhd")
+  {
+    status = this->ParseMetaImageHeader(header, fields, dataOffset);
+  }
+  else if (extension == ".nrrd" || extension == ".nhdr")
+  {
+    status = this->ParseNrrdHeader(header, fields, dataOffset);
+  }
+  else
+  {
+    LOG_DEBUG("Frame index cannot be built for " << sequenceFilename << ", only MetaImage and NRRD files are supported");
+  }
+  if (status != PLUS_SUCCESS)
+  {
+    this->Clear();
+    return PLUS_FAIL;
+  }
+
+  unsigned long long frameSizeInBytes = this->GetFrameSizeInBytes();
+  if (frameSizeInBytes == 0)
+  {
+    LOG_DEBUG("Frame index cannot be built for " << sequenceFilename << ", unsupported pixel type or empty frames");
+    this->Clear();
+    return PLUS_FAIL;
+  }
+  for (unsigned int frameIndex = 0; frameIndex < this->Frames.size(); ++frameIndex)
+  {
+    this->Frames[frameIndex].Offset = dataOffset + frameIndex * frameSizeInBytes;
+    this->Frames[frameIndex].Size = frameSizeInBytes;
+  }
+
+  for (std::vector<std::pair<std::string, std::string> >::iterator it = fields.begin(); it != fields.end(); ++it)
+  {
+    unsigned int frameIndex(0);
+    std::string fieldName;
+    if (!ParseFrameFieldKey(it->first, frameIndex, fieldName))
+    {
+      if (it->first == "UltrasoundImageOrientation")
+      {
+        this->ImageOrientation = igsioCommon::GetUsImageOrientationFromString(it->second.c_str());
+      }
+      else if (it->first == "UltrasoundImageType")
+      {
+        this->ImageType = igsioCommon::GetUsImageTypeFromString(it->second);
+      }
+      else if (!IsMetaImageGeometryField(it->first))
+      {
+        this->CustomFields.push_back(*it);
+      }
+      continue;
+    }
+    if (frameIndex >= this->Frames.size())
+    {
+      LOG_WARNING("Field " << it->first << " refers to a frame that is not in the sequence file " << sequenceFilename);
+      continue;
+    }
+    if (fieldName == "Timestamp")
+    {
+      this->Frames[frameIndex].Timestamp = atof(it->second.c_str());
+    }
+    else if (fieldName != "UnfilteredTimestamp" && fieldName != "FrameNumber")
+    {
+      this->Frames[frameIndex].Fields.push_back(std::make_pair(fieldName, it->second));
+    }
+  }
+
+  // Make sure that all the frames are in the file
+  std::ifstream data(this->DataFilename.c_str(), std::ios::in | std::ios::binary);
+  if (!data.is_open())
+  {
+    LOG_ERROR("Failed to open data file " << this->DataFilename << " of sequence file " << sequenceFilename);
+    this->Clear();
+    return PLUS_FAIL;
+  }
+  data.seekg(0, std::ios::end);
+  unsigned long long dataFileSize = static_cast<unsigned long long>(data.tellg());
+  if (dataFileSize < dataOffset + this->Frames.size() * frameSizeInBytes)
+  {
+    LOG_ERROR("Data file " << this->DataFilename << " is shorter than expected, the sequence file may be truncated");
+    this->Clear();
+    return PLUS_FAIL;
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusSequenceFrameIndex::ParseMetaImageHeader(std::istream& header, std::vector<std::pair<std::string, std::string> >& fields, unsigned long long& dataOffset)
+{
+  unsigned int numberOfDimensions(0);
+  std::vector<unsigned int> dimSize;
+  bool dataFileFound = false;
+  while (header.good())
+  {
+    std::string line = ReadHeaderLine(header);
+    size_t separator = line.find('=');
+    if (separator == std::string::npos)
+    {
+      continue;
+    }
+    std::string key = igsioCommon::Trim(line.substr(0, separator));
+    std::string value = igsioCommon::Trim(line.substr(separator + 1));
+    if (key == "NDims")
+    {
+      numberOfDimensions = static_cast<unsigned int>(atoi(value.c_str()));
+    }
+    else if (key == "DimSize")
+    {
+      dimSize = ParseUnsignedIntList(value);
+    }
+    else if (key == "ElementNumberOfChannels")
+    {
+      this->NumberOfScalarComponents = static_cast<unsigned int>(atoi(value.c_str()));
+    }
+    else if (key == "ElementType")
+    {
+      this->PixelType = GetPixelTypeFromMetaElementType(value);
+    }
+    else if (key == "CompressedData")
+    {
+      if (igsioCommon::IsEqualInsensitive(value, "True"))
+      {
+        LOG_DEBUG("Frame index cannot be built for " << this->SequenceFilename << ", compressed data is not supported");
+        return PLUS_FAIL;
+      }
+    }
+    else if (key == "BinaryDataByteOrderMSB")
+    {
+      if (igsioCommon::IsEqualInsensitive(value, "True"))
+      {
+        LOG_DEBUG("Frame index cannot be built for " << this->SequenceFilename << ", big endian data is not supported");
+        return PLUS_FAIL;
+      }
+    }
+    else if (key == "ElementDataFile")
+    {
+      // This is the last field of the header
+      if (value == "LOCAL")
+      {
+        this->DataFilename = this->SequenceFilename;
+        dataOffset = static_cast<unsigned long long>(header.tellg());
+      }
+      else if (value == "LIST" || value.find('%') != std::string::npos)
+      {
+        LOG_DEBUG("Frame index cannot be built for " << this->SequenceFilename << ", data split into multiple files is not supported");
+        return PLUS_FAIL;
+      }
+      else
+      {
+        this->DataFilename = vtksys::SystemTools::CollapseFullPath(value, vtksys::SystemTools::GetFilenamePath(this->SequenceFilename));
+        dataOffset = 0;
+      }
+      dataFileFound = true;
+      break;
+    }
+    else
+    {
+      fields.push_back(std::make_pair(key, value));
+    }
+  }
+
+  if (!dataFileFound || numberOfDimensions < 2 || dimSize.size() != numberOfDimensions || this->NumberOfScalarComponents < 1)
+  {
+    LOG_ERROR("Failed to parse MetaImage header of " << this->SequenceFilename);
+    return PLUS_FAIL;
+  }
+
+  // The last dimension is the frame index (a single 2D frame has no frame dimension)
+  this->FrameSize[0] = dimSize[0];
+  this->FrameSize[1] = dimSize[1];
+  this->FrameSize[2] = (numberOfDimensions > 3 ? dimSize[2] : 1);
+  unsigned int numberOfFrames = (numberOfDimensions > 2 ? dimSize[numberOfDimensions - 1] : 1);
+  this->Frames.resize(numberOfFrames);
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusSequenceFrameIndex::ParseNrrdHeader(std::istream& header, std::vector<std::pair<std::string, std::string> >& fields, unsigned long long& dataOffset)
+{
+  if (ReadHeaderLine(header).compare(0, 4, "NRRD") != 0)
+  {
+    LOG_ERROR("Failed to parse NRRD header of " << this->SequenceFilename << ", invalid magic");
+    return PLUS_FAIL;
+  }
+
+  std::vector<unsigned int> sizes;
+  std::vector<std::string> kinds;
+  bool headerComplete = false;
+  while (header.good())
+  {
+    std::string line = ReadHeaderLine(header);
+    if (line.empty())
+    {
+      // The header is terminated by an empty line
+      headerComplete = true;
+      break;
+    }
+    if (line[0] == '#')
+    {
+      continue;
+    }
+    size_t keyValueSeparator = line.find(":=");
+    size_t fieldSeparator = line.find(": ");
+    if (keyValueSeparator != std::string::npos && (fieldSeparator == std::string::npos || keyValueSeparator < fieldSeparator))
+    {
+      fields.push_back(std::make_pair(line.substr(0, keyValueSeparator), line.substr(keyValueSeparator + 2)));
+      continue;
+    }
+    if (fieldSeparator == std::string::npos)
+    {
+      continue;
+    }
+    std::string field = line.substr(0, fieldSeparator);
+    std::string description = igsioCommon::Trim(line.substr(fieldSeparator + 2));
+    if (field == "type")
+    {
+      this->PixelType = GetPixelTypeFromNrrdType(description);
+    }
+    else if (field == "sizes")
+    {
+      sizes = ParseUnsignedIntList(description);
+    }
+    else if (field == "kinds")
+    {
+      kinds = igsioCommon::SplitStringIntoTokens(description, ' ', false);
+    }
+    else if (field == "encoding")
+    {
+      if (description != "raw")
+      {
+        LOG_DEBUG("Frame index cannot be built for " << this->SequenceFilename << ", " << description << " encoding is not supported");
+        return PLUS_FAIL;
+      }
+    }
+    else if (field == "endian")
+    {
+      if (description == "big")
+      {
+        LOG_DEBUG("Frame index cannot be built for " << this->SequenceFilename << ", big endian data is not supported");
+        return PLUS_FAIL;
+      }
+    }
+    else if (field == "line skip" || field == "lineskip" || field == "byte skip" || field == "byteskip")
+    {
+      if (atoi(description.c_str()) != 0)
+      {
+        LOG_DEBUG("Frame index cannot be built for " << this->SequenceFilename << ", skipping data is not supported");
+        return PLUS_FAIL;
+      }
+    }
+    else if (field == "data file" || field == "datafile")
+    {
+      if (description.compare(0, 4, "LIST") == 0 || description.find(' ') != std::string::npos)
+      {
+        LOG_DEBUG("Frame index cannot be built for " << this->SequenceFilename << ", data split into multiple files is not supported");
+        return PLUS_FAIL;
+      }
+      this->DataFilename = vtksys::SystemTools::CollapseFullPath(description, vtksys::SystemTools::GetFilenamePath(this->SequenceFilename));
+    }
+  }
+
+  if (!headerComplete || sizes.size() < 2)
+  {
+    LOG_ERROR("Failed to parse NRRD header of " << this->SequenceFilename);
+    return PLUS_FAIL;
+  }
+  if (this->DataFilename.empty())
+  {
+    this->DataFilename = this->SequenceFilename;
+    dataOffset = static_cast<unsigned long long>(header.tellg());
+  }
+
+  // The first axis holds the scalar components if it is not a spatial axis, the last axis is the frame index
+  size_t firstSpatialAxis = 0;
+  if (kinds.size() == sizes.size() && kinds[0] != "domain" && kinds[0] != "space" && kinds[0] != "list" && kinds[0] != "time")
+  {
+    this->NumberOfScalarComponents = sizes[0];
+    firstSpatialAxis = 1;
+  }
+  size_t numberOfAxes = sizes.size() - firstSpatialAxis;
+  bool hasFrameAxis = (numberOfAxes > 2) || (kinds.size() == sizes.size() && (kinds.back() == "list" || kinds.back() == "time"));
+  size_t numberOfSpatialAxes = hasFrameAxis ? numberOfAxes - 1 : numberOfAxes;
+  if (numberOfSpatialAxes < 1 || numberOfSpatialAxes > 3)
+  {
+    LOG_ERROR("Failed to parse NRRD header of " << this->SequenceFilename << ", unsupported number of dimensions");
+    return PLUS_FAIL;
+  }
+  for (size_t axis = 0; axis < 3; ++axis)
+  {
+    this->FrameSize[axis] = (axis < numberOfSpatialAxes ? sizes[firstSpatialAxis + axis] : 1);
+  }
+  this->Frames.resize(hasFrameAxis ? sizes.back() : 1);
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusSequenceFrameIndex::WriteSidecarFile() const
+{
+  unsigned long long sequenceFileSize(0);
+  long sequenceFileModifiedTime(0);
+  if (!GetFileFingerprint(this->SequenceFilename, sequenceFileSize, sequenceFileModifiedTime))
+  {
+    return PLUS_FAIL;
+  }
+
+  std::string sidecarFilename = GetSidecarFilename(this->SequenceFilename);
+  std::ofstream sidecar(sidecarFilename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!sidecar.is_open())
+  {
+    return PLUS_FAIL;
+  }
+
+  // All values are stored in native byte order, the sidecar is a cache for the local machine
+  sidecar.write(SIDECAR_MAGIC, sizeof(SIDECAR_MAGIC));
+  WriteValue(sidecar, SIDECAR_VERSION);
+  WriteValue(sidecar, sequenceFileSize);
+  WriteValue(sidecar, static_cast<long long>(sequenceFileModifiedTime));
+  WriteString(sidecar, this->DataFilename == this->SequenceFilename ? std::string() : this->DataFilename);
+  for (int axis = 0; axis < 3; ++axis)
+  {
+    WriteValue(sidecar, this->FrameSize[axis]);
+  }
+  WriteValue(sidecar, static_cast<int>(this->PixelType));
+  WriteValue(sidecar, this->NumberOfScalarComponents);
+  WriteValue(sidecar, static_cast<int>(this->ImageOrientation));
+  WriteValue(sidecar, static_cast<int>(this->ImageType));
+  WriteValue(sidecar, static_cast<unsigned char>(this->FrameDataCompressed ? 1 : 0));
+  WriteValue(sidecar, static_cast<unsigned int>(this->Frames.size()));
+  for (std::vector<FrameEntry>::const_iterator frame = this->Frames.begin(); frame != this->Frames.end(); ++frame)
+  {
+    WriteValue(sidecar, frame->Timestamp);
+    WriteValue(sidecar, frame->Offset);
+    WriteValue(sidecar, frame->Size);
+    WriteValue(sidecar, static_cast<unsigned int>(frame->Fields.size()));
+    for (FrameFieldList::const_iterator field = frame->Fields.begin(); field != frame->Fields.end(); ++field)
+    {
+      WriteString(sidecar, field->first);
+      WriteString(sidecar, field->second);
+    }
+  }
+  WriteValue(sidecar, static_cast<unsigned int>(this->CustomFields.size()));
+  for (FrameFieldList::const_iterator field = this->CustomFields.begin(); field != this->CustomFields.end(); ++field)
+  {
+    WriteString(sidecar, field->first);
+    WriteString(sidecar, field->second);
+  }
+
+  sidecar.close();
+  if (sidecar.fail())
+  {
+    vtksys::SystemTools::RemoveFile(sidecarFilename);
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusSequenceFrameIndex::ReadSidecarFile(const std::string& sequenceFilename)
+{
+  this->Clear();
+
+  std::string sidecarFilename = GetSidecarFilename(sequenceFilename);
+  std::ifstream sidecar(sidecarFilename.c_str(), std::ios::in | std::ios::binary);
+  if (!sidecar.is_open())
+  {
+    return PLUS_FAIL;
+  }
+
+  char magic[sizeof(SIDECAR_MAGIC)] = { 0 };
+  sidecar.read(magic, sizeof(magic));
+  unsigned int version(0);
+  if (!sidecar.good() || memcmp(magic, SIDECAR_MAGIC, sizeof(magic)) != 0 || !ReadValue(sidecar, version) || version != SIDECAR_VERSION)
+  {
+    LOG_DEBUG("Ignoring frame index file " << sidecarFilename << ", unknown format");
+    return PLUS_FAIL;
+  }
+
+  unsigned long long sequenceFileSize(0);
+  long sequenceFileModifiedTime(0);
+  unsigned long long indexedFileSize(0);
+  long long indexedFileModifiedTime(0);
+  if (!GetFileFingerprint(sequenceFilename, sequenceFileSize, sequenceFileModifiedTime)
+      || !ReadValue(sidecar, indexedFileSize) || !ReadValue(sidecar, indexedFileModifiedTime)
+      || indexedFileSize != sequenceFileSize || indexedFileModifiedTime != sequenceFileModifiedTime)
+  {
+    LOG_DEBUG("Ignoring frame index file " << sidecarFilename << ", the sequence file has changed since the index was written");
+    return PLUS_FAIL;
+  }
+
+  bool valid = ReadString(sidecar, this->DataFilename);
+  for (int axis = 0; axis < 3; ++axis)
+  {
+    valid = valid && ReadValue(sidecar, this->FrameSize[axis]);
+  }
+  int pixelType(VTK_VOID);
+  int imageOrientation(US_IMG_ORIENT_MF);
+  int imageType(US_IMG_BRIGHTNESS);
+  unsigned char frameDataCompressed(0);
+  unsigned int numberOfFrames(0);
+  valid = valid && ReadValue(sidecar, pixelType) && ReadValue(sidecar, this->NumberOfScalarComponents)
+          && ReadValue(sidecar, imageOrientation) && ReadValue(sidecar, imageType)
+          && ReadValue(sidecar, frameDataCompressed) && ReadValue(sidecar, numberOfFrames);
+  if (valid)
+  {
+    this->Frames.resize(numberOfFrames);
+  }
+  for (unsigned int frameIndex = 0; valid && frameIndex < numberOfFrames; ++frameIndex)
+  {
+    FrameEntry& frame = this->Frames[frameIndex];
+    unsigned int numberOfFields(0);
+    valid = ReadValue(sidecar, frame.Timestamp) && ReadValue(sidecar, frame.Offset) && ReadValue(sidecar, frame.Size) && ReadValue(sidecar, numberOfFields);
+    for (unsigned int fieldIndex = 0; valid && fieldIndex < numberOfFields; ++fieldIndex)
+    {
+      std::string name;
+      std::string value;
+      valid = ReadString(sidecar, name) && ReadString(sidecar, value);
+      frame.Fields.push_back(std::make_pair(name, value));
+    }
+  }
+  unsigned int numberOfCustomFields(0);
+  valid = valid && ReadValue(sidecar, numberOfCustomFields);
+  for (unsigned int fieldIndex = 0; valid && fieldIndex < numberOfCustomFields; ++fieldIndex)
+  {
+    std::string name;
+    std::string value;
+    valid = ReadString(sidecar, name) && ReadString(sidecar, value);
+    this->CustomFields.push_back(std::make_pair(name, value));
+  }
+  if (!valid)
+  {
+    LOG_DEBUG("Ignoring frame index file " << sidecarFilename << ", the file is truncated");
+    this->Clear();
+    return PLUS_FAIL;
+  }
+
+  this->SequenceFilename = sequenceFilename;
+  if (this->DataFilename.empty())
+  {
+    this->DataFilename = sequenceFilename;
+  }
+  this->PixelType = static_cast<igsioCommon::VTKScalarPixelType>(pixelType);
+  this->ImageOrientation = static_cast<US_IMAGE_ORIENTATION>(imageOrientation);
+  this->ImageType = static_cast<US_IMAGE_TYPE>(imageType);
+  this->FrameDataCompressed = (frameDataCompressed != 0);
+  return PLUS_SUCCESS;
+}
@@ -0,0 +1,130 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusSequenceFrameIndex_h
+#define __PlusSequenceFrameIndex_h
+
+#include "PlusConfigure.h"
+#include "vtkPlusCommonExport.h"
+
+#include <igsioCommon.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+class igsioTrackedFrame;
+
+/*!
+  \class PlusSequenceFrameIndex
+  \brief Location and timestamp of each frame in a sequence file, for accessing frames without reading the whole file
+
+  The index is built by parsing the header of a MetaImage (mha/mhd) or NRRD (nrrd/nhdr) sequence file with raw pixel data.
+  As parsing the header of a long recording takes time, the index can be cached in a binary sidecar file next to the
+  sequence file (see GetSidecarFilename). The sidecar stores the size and modification time of the sequence file and it
+  is ignored if the sequence file has changed since the index was written.
+
+  For compressed files the frame locations cannot be determined from the header. These files can only be indexed when
+  they are written: vtkPlusSequenceIO::CompressFile compresses each frame independently and writes the sidecar file,
+  which stores the location of each compressed frame.
+
+  \ingroup PlusLibCommon
+*/
+class vtkPlusCommonExport PlusSequenceFrameIndex
+{
+public:
+  typedef std::vector<std::pair<std::string, std::string> > FrameFieldList;
+
+  struct FrameEntry
+  {
+    FrameEntry() : Timestamp(0.0), Offset(0), Size(0) {}
+    /*! Timestamp of the frame, as stored in the file */
+    double Timestamp;
+    /*! Position of the pixel data of the frame in the data file */
+    unsigned long long Offset;
+    /*! Number of bytes of the pixel data of the frame in the data file (compressed size if the frame data is compressed) */
+    unsigned long long Size;
+    /*! Frame fields (except timestamps and frame number) */
+    FrameFieldList Fields;
+  };
+
+  PlusSequenceFrameIndex();
+
+  /*! Use the sidecar file if it is up to date, otherwise build the index from the sequence file and write the sidecar file */
+  PlusStatus Load(const std::string& sequenceFilename, bool writeSidecarFile = true);
+
+  /*! Build the index by parsing the header of a sequence file */
+  PlusStatus BuildFromSequenceFile(const std::string& sequenceFilename);
+
+  /*! Read the index from a sidecar file. Fails if the sidecar file does not match the current sequence file. */
+  PlusStatus ReadSidecarFile(const std::string& sequenceFilename);
+
+  /*! Write the index to the sidecar file of the sequence file */
+  PlusStatus WriteSidecarFile() const;
+
+  /*! Name of the sidecar file that stores the index of a sequence file */
+  static std::string GetSidecarFilename(const std::string& sequenceFilename);
+
+  /*! Remove all frames and image properties */
+  void Clear();
+
+  unsigned int GetNumberOfFrames() const { return static_cast<unsigned int>(this->Frames.size()); }
+
+  /*! Custom fields of the sequence that are not frame fields (fields that describe the image geometry and encoding are not included) */
+  const FrameFieldList& GetCustomFields() const { return this->CustomFields; }
+  const FrameEntry& GetFrame(unsigned int frameIndex) const { return this->Frames[frameIndex]; }
+
+  /*! Sequence file that the index belongs to */
+  const std::string& GetSequenceFilename() const { return this->SequenceFilename; }
+
+  /*! File that contains the pixel data (same as the sequence file if the data is attached to the header) */
+  const std::string& GetDataFilename() const { return this->DataFilename; }
+
+  const FrameSizeType& GetFrameSize() const { return this->FrameSize; }
+  igsioCommon::VTKScalarPixelType GetPixelType() const { return this->PixelType; }
+  unsigned int GetNumberOfScalarComponents() const { return this->NumberOfScalarComponents; }
+  US_IMAGE_ORIENTATION GetImageOrientation() const { return this->ImageOrientation; }
+  US_IMAGE_TYPE GetImageType() const { return this->ImageType; }
+
+  /*! Number of bytes of the uncompressed pixel data of one frame */
+  unsigned long long GetFrameSizeInBytes() const;
+
+  /*! True if each frame is stored as an independently compressed block (see PlusParallelCompressor::DecompressBlock) */
+  bool IsFrameDataCompressed() const { return this->FrameDataCompressed; }
+  void SetFrameDataCompressed(bool compressed) { this->FrameDataCompressed = compressed; }
+
+  /*! Update the location of the pixel data of a frame in the data file */
+  void SetFrameDataLocation(unsigned int frameIndex, unsigned long long offset, unsigned long long size);
+
+  /*! Read the uncompressed pixel data of a frame from the data file */
+  PlusStatus ReadFrameData(std::istream& dataFile, unsigned int frameIndex, std::vector<unsigned char>& pixels) const;
+
+  /*! Read the image and the frame fields of a frame from the data file */
+  PlusStatus ReadTrackedFrame(std::istream& dataFile, unsigned int frameIndex, igsioTrackedFrame& trackedFrame) const;
+
+  /*! Index of the frame with the timestamp closest to the specified time. The index must not be empty. */
+  unsigned int GetFrameIndexFromTime(double time) const;
+
+  /*! Range of the frames with timestamps between startTime and stopTime (inclusive). Fails if there is no frame in the time range. */
+  PlusStatus GetFrameIndexRange(double startTime, double stopTime, unsigned int& firstFrameIndex, unsigned int& lastFrameIndex) const;
+
+protected:
+  PlusStatus ParseMetaImageHeader(std::istream& header, std::vector<std::pair<std::string, std::string> >& fields, unsigned long long& dataOffset);
+  PlusStatus ParseNrrdHeader(std::istream& header, std::vector<std::pair<std::string, std::string> >& fields, unsigned long long& dataOffset);
+
+  std::string SequenceFilename;
+  std::string DataFilename;
+  FrameSizeType FrameSize;
+  igsioCommon::VTKScalarPixelType PixelType;
+  unsigned int NumberOfScalarComponents;
+  US_IMAGE_ORIENTATION ImageOrientation;
+  US_IMAGE_TYPE ImageType;
+  bool FrameDataCompressed;
+  FrameFieldList CustomFields;
+  std::vector<FrameEntry> Frames;
+};
+
+#endif
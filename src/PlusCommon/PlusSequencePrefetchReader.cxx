@@ -0,0 +1,163 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "PlusSequencePrefetchReader.h"
+#include "PlusWorkerPool.h"
+
+// IGSIO includes
+#include <igsioTrackedFrame.h>
+
+// STL includes
+#include <algorithm>
+
+//----------------------------------------------------------------------------
+PlusSequencePrefetchReader::PlusSequencePrefetchReader()
+  : MaximumNumberOfPrefetchedFrames(8)
+  , NextFrameIndex(0)
+  , NextPrefetchedFrameIndex(0)
+{
+}
+
+//----------------------------------------------------------------------------
+PlusSequencePrefetchReader::~PlusSequencePrefetchReader()
+{
+  this->Close();
+}
+
+//----------------------------------------------------------------------------
+void PlusSequencePrefetchReader::SetMaximumNumberOfPrefetchedFrames(unsigned int maximumNumberOfFrames)
+{
+  this->MaximumNumberOfPrefetchedFrames = std::max(1u, maximumNumberOfFrames);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusSequencePrefetchReader::Open(const std::string& filename)
+{
+  this->Close();
+  if (this->Reader.Open(filename) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  this->PrefetchFrames();
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void PlusSequencePrefetchReader::Close()
+{
+  // The read tasks use the frame index and the file streams, they must be finished before these are released
+  for (std::deque<std::future<std::shared_ptr<igsioTrackedFrame> > >::iterator frame = this->PrefetchedFrames.begin(); frame != this->PrefetchedFrames.end(); ++frame)
+  {
+    PlusWorkerPool::GetInstance().Wait(*frame);
+  }
+  this->PrefetchedFrames.clear();
+  {
+    std::lock_guard<std::mutex> lock(this->DataFilesMutex);
+    this->FreeDataFiles.clear();
+  }
+  this->Reader.Close();
+  this->NextFrameIndex = 0;
+  this->NextPrefetchedFrameIndex = 0;
+}
+
+//----------------------------------------------------------------------------
+std::shared_ptr<igsioTrackedFrame> PlusSequencePrefetchReader::ReadNextFrame()
+{
+  if (this->IsAtEnd())
+  {
+    return NULL;
+  }
+
+  if (!this->Reader.IsStreamed())
+  {
+    // All frames are in memory already
+    std::shared_ptr<igsioTrackedFrame> frame = std::make_shared<igsioTrackedFrame>();
+    if (this->Reader.ReadFrame(this->NextFrameIndex++, *frame) != PLUS_SUCCESS)
+    {
+      return NULL;
+    }
+    return frame;
+  }
+
+  std::future<std::shared_ptr<igsioTrackedFrame> > result = std::move(this->PrefetchedFrames.front());
+  this->PrefetchedFrames.pop_front();
+  this->NextFrameIndex++;
+  // Keep the workers busy while this frame is being processed
+  this->PrefetchFrames();
+
+  PlusWorkerPool::GetInstance().Wait(result);
+  return result.get();
+}
+
+//----------------------------------------------------------------------------
+void PlusSequencePrefetchReader::PrefetchFrames()
+{
+  if (!this->Reader.IsStreamed())
+  {
+    return;
+  }
+  const unsigned int numberOfFrames = this->GetNumberOfFrames();
+  while (this->NextPrefetchedFrameIndex < numberOfFrames && this->PrefetchedFrames.size() < this->MaximumNumberOfPrefetchedFrames)
+  {
+    const unsigned int frameIndex = this->NextPrefetchedFrameIndex++;
+    this->PrefetchedFrames.push_back(PlusWorkerPool::GetInstance().Submit([this, frameIndex]()
+    {
+      return this->ReadFrameFromFile(frameIndex);
+    }));
+  }
+}
+
+//----------------------------------------------------------------------------
+std::shared_ptr<igsioTrackedFrame> PlusSequencePrefetchReader::ReadFrameFromFile(unsigned int frameIndex)
+{
+  std::unique_ptr<std::ifstream> dataFile = this->AcquireDataFile();
+  if (!dataFile)
+  {
+    return NULL;
+  }
+  std::shared_ptr<igsioTrackedFrame> frame = std::make_shared<igsioTrackedFrame>();
+  PlusStatus status = this->Reader.GetFrameIndex().ReadTrackedFrame(*dataFile, frameIndex, *frame);
+  this->ReleaseDataFile(std::move(dataFile));
+  if (status != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to read frame " << frameIndex << " of " << this->Reader.GetFrameIndex().GetSequenceFilename());
+    return NULL;
+  }
+  return frame;
+}
+
+//----------------------------------------------------------------------------
+std::unique_ptr<std::ifstream> PlusSequencePrefetchReader::AcquireDataFile()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->DataFilesMutex);
+    if (!this->FreeDataFiles.empty())
+    {
+      std::unique_ptr<std::ifstream> dataFile = std::move(this->FreeDataFiles.back());
+      this->FreeDataFiles.pop_back();
+      return dataFile;
+    }
+  }
+  // Each concurrent read task needs its own stream, so a new one is opened only if all are in use
+  const std::string& dataFilename = this->Reader.GetFrameIndex().GetDataFilename();
+  std::unique_ptr<std::ifstream> dataFile(new std::ifstream(dataFilename.c_str(), std::ios::in | std::ios::binary));
+  if (!dataFile->is_open())
+  {
+    LOG_ERROR("Failed to open sequence data file: " << dataFilename);
+    return NULL;
+  }
+  return dataFile;
+}
+
+//----------------------------------------------------------------------------
+void PlusSequencePrefetchReader::ReleaseDataFile(std::unique_ptr<std::ifstream> dataFile)
+{
+  // Clear the error state, e.g. after reading past the end of the file
+  dataFile->clear();
+  std::lock_guard<std::mutex> lock(this->DataFilesMutex);
+  this->FreeDataFiles.push_back(std::move(dataFile));
+}
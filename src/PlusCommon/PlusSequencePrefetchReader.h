@@ -0,0 +1,106 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusSequencePrefetchReader_h
+#define __PlusSequencePrefetchReader_h
+
+#include "PlusConfigure.h"
+#include "vtkPlusCommonExport.h"
+#include "PlusSequenceStreamReader.h"
+
+#include <deque>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class igsioTrackedFrame;
+class vtkIGSIOTrackedFrameList;
+
+/*!
+  \class PlusSequencePrefetchReader
+  \brief Reads the frames of a sequence file in order, while the next frames are read and decompressed in the background
+
+  Offline tools that process a recording frame by frame can start processing as soon as the first frame is read, instead of
+  reading the whole file into memory first. If the location of the frames in the file is known (the file is uncompressed, or
+  it has an up-to-date frame index, see PlusSequenceFrameIndex) then the next frames are read and decompressed by tasks of the
+  process-wide worker pool (see PlusWorkerPool), each task with its own file stream, while the caller processes the current
+  frame. At most MaximumNumberOfPrefetchedFrames frames are kept in memory. Other files are read into memory when they are
+  opened, as by PlusSequenceStreamReader. The pixel data is copied from the file as is, without any conversion.
+
+  The class is not thread-safe, the frames must be read by one thread.
+
+  \ingroup PlusLibCommon
+*/
+class vtkPlusCommonExport PlusSequencePrefetchReader
+{
+public:
+  PlusSequencePrefetchReader();
+  ~PlusSequencePrefetchReader();
+
+  /*! Open a sequence file and start prefetching from the first frame */
+  PlusStatus Open(const std::string& filename);
+
+  /*! Stop prefetching, close the file and release all frames */
+  void Close();
+
+  /*! Maximum number of frames that are read ahead of the current frame (at least 1). Takes effect from the next Open call. */
+  void SetMaximumNumberOfPrefetchedFrames(unsigned int maximumNumberOfFrames);
+  unsigned int GetMaximumNumberOfPrefetchedFrames() const { return this->MaximumNumberOfPrefetchedFrames; }
+
+  /*! True if frames are read from the file on demand, false if the whole file has been read into memory */
+  bool IsStreamed() const { return this->Reader.IsStreamed(); }
+
+  unsigned int GetNumberOfFrames() const { return this->Reader.GetNumberOfFrames(); }
+
+  /*! Orientation of the images in the file */
+  US_IMAGE_ORIENTATION GetImageOrientation() const { return this->Reader.GetImageOrientation(); }
+
+  /*! Copy the fields of the sequence (that are not frame fields) into the frame list */
+  void CopyCustomFields(vtkIGSIOTrackedFrameList* frameList) const { this->Reader.CopyCustomFields(frameList); }
+
+  /*! Index of the frame that the next ReadNextFrame call returns */
+  unsigned int GetNextFrameIndex() const { return this->NextFrameIndex; }
+
+  /*! True if all frames have been read */
+  bool IsAtEnd() const { return this->NextFrameIndex >= this->GetNumberOfFrames(); }
+
+  /*!
+    Get the next frame, wait for it if it is not prefetched yet. Returns NULL after the last frame or if the frame cannot be read.
+    The returned frame is owned by the caller.
+  */
+  std::shared_ptr<igsioTrackedFrame> ReadNextFrame();
+
+protected:
+  /*! Queue reading of frames until the maximum number of frames are prefetched */
+  void PrefetchFrames();
+
+  /*! Read a frame from the file, on a worker thread */
+  std::shared_ptr<igsioTrackedFrame> ReadFrameFromFile(unsigned int frameIndex);
+
+  std::unique_ptr<std::ifstream> AcquireDataFile();
+  void ReleaseDataFile(std::unique_ptr<std::ifstream> dataFile);
+
+  PlusSequenceStreamReader Reader;
+  unsigned int MaximumNumberOfPrefetchedFrames;
+  unsigned int NextFrameIndex;
+  unsigned int NextPrefetchedFrameIndex;
+
+  /*! Frames that are being read, in frame order, starting at NextFrameIndex */
+  std::deque<std::future<std::shared_ptr<igsioTrackedFrame> > > PrefetchedFrames;
+
+  /*! File streams that are not used by a read task */
+  std::mutex DataFilesMutex;
+  std::vector<std::unique_ptr<std::ifstream> > FreeDataFiles;
+
+private:
+  PlusSequencePrefetchReader(const PlusSequencePrefetchReader&);
+  void operator=(const PlusSequencePrefetchReader&);
+};
+
+#endif
@@ -0,0 +1,172 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "PlusSequenceStreamReader.h"
+#include "vtkPlusSequenceIO.h"
+
+// IGSIO includes
+#include <igsioTrackedFrame.h>
+#include <vtkIGSIOTrackedFrameList.h>
+
+//----------------------------------------------------------------------------
+PlusSequenceStreamReader::PlusSequenceStreamReader()
+  : Streamed(false)
+{
+}
+
+//----------------------------------------------------------------------------
+PlusSequenceStreamReader::~PlusSequenceStreamReader()
+{
+  this->Close();
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusSequenceStreamReader::Open(const std::string& filename)
+{
+  this->Close();
+
+  // If the file is not found in the current directory then try to find it in the image directory, too
+  std::string sequenceFilePath = filename;
+  if (!vtksys::SystemTools::FileExists(sequenceFilePath.c_str(), true)
+      && vtkPlusConfig::GetInstance()->FindImagePath(filename, sequenceFilePath) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Cannot find sequence file: " << filename);
+    return PLUS_FAIL;
+  }
+  this->Filename = sequenceFilePath;
+
+  // The sidecar file is not written, the input files are not modified
+  if (this->FrameIndex.Load(sequenceFilePath, false) == PLUS_SUCCESS)
+  {
+    this->DataFile.open(this->FrameIndex.GetDataFilename().c_str(), std::ios::in | std::ios::binary);
+    if (!this->DataFile.is_open())
+    {
+      LOG_ERROR("Failed to open sequence data file: " << this->FrameIndex.GetDataFilename());
+      this->Close();
+      return PLUS_FAIL;
+    }
+    this->Streamed = true;
+    return PLUS_SUCCESS;
+  }
+
+  LOG_INFO("Location of the frames is not known in " << sequenceFilePath << ", the whole file is read into memory");
+  this->LoadedFrames = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+  if (vtkPlusSequenceIO::Read(sequenceFilePath, this->LoadedFrames) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Couldn't read sequence file: " << sequenceFilePath);
+    this->Close();
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void PlusSequenceStreamReader::Close()
+{
+  if (this->DataFile.is_open())
+  {
+    this->DataFile.close();
+  }
+  this->FrameIndex.Clear();
+  this->LoadedFrames = NULL;
+  this->Streamed = false;
+  this->Filename.clear();
+}
+
+//----------------------------------------------------------------------------
+unsigned int PlusSequenceStreamReader::GetNumberOfFrames() const
+{
+  if (this->Streamed)
+  {
+    return this->FrameIndex.GetNumberOfFrames();
+  }
+  return this->LoadedFrames ? this->LoadedFrames->GetNumberOfTrackedFrames() : 0;
+}
+
+//----------------------------------------------------------------------------
+double PlusSequenceStreamReader::GetFrameTimestamp(unsigned int frameIndex) const
+{
+  if (this->Streamed)
+  {
+    return this->FrameIndex.GetFrame(frameIndex).Timestamp;
+  }
+  return this->LoadedFrames->GetTrackedFrame(frameIndex)->GetTimestamp();
+}
+
+//----------------------------------------------------------------------------
+US_IMAGE_ORIENTATION PlusSequenceStreamReader::GetImageOrientation() const
+{
+  if (this->Streamed)
+  {
+    return this->FrameIndex.GetImageOrientation();
+  }
+  return this->LoadedFrames ? this->LoadedFrames->GetImageOrientation() : US_IMG_ORIENT_XX;
+}
+
+//----------------------------------------------------------------------------
+void PlusSequenceStreamReader::CopyCustomFields(vtkIGSIOTrackedFrameList* frameList) const
+{
+  if (this->Streamed)
+  {
+    const PlusSequenceFrameIndex::FrameFieldList& fields = this->FrameIndex.GetCustomFields();
+    for (PlusSequenceFrameIndex::FrameFieldList::const_iterator field = fields.begin(); field != fields.end(); ++field)
+    {
+      frameList->SetCustomString(field->first.c_str(), field->second.c_str());
+    }
+    return;
+  }
+  if (!this->LoadedFrames)
+  {
+    return;
+  }
+  std::vector<std::string> fieldNames;
+  this->LoadedFrames->GetCustomFieldNameList(fieldNames);
+  for (std::vector<std::string>::iterator fieldName = fieldNames.begin(); fieldName != fieldNames.end(); ++fieldName)
+  {
+    frameList->SetCustomString(fieldName->c_str(), this->LoadedFrames->GetCustomString(fieldName->c_str()));
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusSequenceStreamReader::ReadFrame(unsigned int frameIndex, vtkIGSIOTrackedFrameList* frameList)
+{
+  if (frameIndex >= this->GetNumberOfFrames())
+  {
+    LOG_ERROR("Frame " << frameIndex << " is not in sequence file " << this->Filename);
+    return PLUS_FAIL;
+  }
+
+  if (!this->Streamed)
+  {
+    return frameList->AddTrackedFrame(this->LoadedFrames->GetTrackedFrame(frameIndex));
+  }
+
+  igsioTrackedFrame trackedFrame;
+  if (this->FrameIndex.ReadTrackedFrame(this->DataFile, frameIndex, trackedFrame) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  return frameList->AddTrackedFrame(&trackedFrame);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusSequenceStreamReader::ReadFrame(unsigned int frameIndex, igsioTrackedFrame& trackedFrame)
+{
+  if (frameIndex >= this->GetNumberOfFrames())
+  {
+    LOG_ERROR("Frame " << frameIndex << " is not in sequence file " << this->Filename);
+    return PLUS_FAIL;
+  }
+
+  if (!this->Streamed)
+  {
+    trackedFrame = *this->LoadedFrames->GetTrackedFrame(frameIndex);
+    return PLUS_SUCCESS;
+  }
+
+  return this->FrameIndex.ReadTrackedFrame(this->DataFile, frameIndex, trackedFrame);
+}
@@ -0,0 +1,84 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusSequenceStreamReader_h
+#define __PlusSequenceStreamReader_h
+
+#include "PlusConfigure.h"
+#include "vtkPlusCommonExport.h"
+#include "PlusSequenceFrameIndex.h"
+
+#include <vtkSmartPointer.h>
+
+#include <fstream>
+#include <string>
+
+class igsioTrackedFrame;
+class vtkIGSIOTrackedFrameList;
+
+/*!
+  \class PlusSequenceStreamReader
+  \brief Reads the frames of a sequence file one by one, for processing sequences that do not fit into memory
+
+  If the location of the frames in the file is known (the file is uncompressed, or it has an up-to-date frame index,
+  see PlusSequenceFrameIndex) then each frame is read from the file when it is requested and only the requested frame
+  is kept in memory. The pixel data is copied from the file as is, without any conversion.
+  Other files (for example compressed MetaImage files) are read into memory when they are opened.
+
+  \ingroup PlusLibCommon
+*/
+class vtkPlusCommonExport PlusSequenceStreamReader
+{
+public:
+  PlusSequenceStreamReader();
+  ~PlusSequenceStreamReader();
+
+  /*! Open a sequence file. The file is read into memory if the location of its frames is not known. */
+  PlusStatus Open(const std::string& filename);
+
+  /*! Close the file and release all frames */
+  void Close();
+
+  /*! True if frames are read from the file on demand, false if the whole file has been read into memory */
+  bool IsStreamed() const { return this->Streamed; }
+
+  unsigned int GetNumberOfFrames() const;
+
+  /*! Timestamp of a frame, available without reading the frame */
+  double GetFrameTimestamp(unsigned int frameIndex) const;
+
+  /*! Orientation of the images in the file */
+  US_IMAGE_ORIENTATION GetImageOrientation() const;
+
+  /*! Location of the frames in the file, only valid if the file is streamed */
+  const PlusSequenceFrameIndex& GetFrameIndex() const { return this->FrameIndex; }
+
+  /*! Copy the fields of the sequence (that are not frame fields) into the frame list */
+  void CopyCustomFields(vtkIGSIOTrackedFrameList* frameList) const;
+
+  /*! Read a frame and append it to the frame list */
+  PlusStatus ReadFrame(unsigned int frameIndex, vtkIGSIOTrackedFrameList* frameList);
+
+  /*! Read a frame into a tracked frame */
+  PlusStatus ReadFrame(unsigned int frameIndex, igsioTrackedFrame& trackedFrame);
+
+protected:
+  std::string Filename;
+  bool Streamed;
+
+  /*! Location of the frames in the file (if streamed) */
+  PlusSequenceFrameIndex FrameIndex;
+  std::ifstream DataFile;
+
+  /*! All frames of the file (if not streamed) */
+  vtkSmartPointer<vtkIGSIOTrackedFrameList> LoadedFrames;
+
+private:
+  PlusSequenceStreamReader(const PlusSequenceStreamReader&);
+  void operator=(const PlusSequenceStreamReader&);
+};
+
+#endif
@@ -0,0 +1,180 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "PlusSequenceStreamWriter.h"
+#include "vtkPlusSequenceIO.h"
+
+// IGSIO includes
+#include <igsioTrackedFrame.h>
+#include <vtkIGSIOMetaImageSequenceIO.h>
+#include <vtkIGSIOSequenceIO.h>
+#include <vtkIGSIOSequenceIOBase.h>
+#include <vtkIGSIOTrackedFrameList.h>
+
+//----------------------------------------------------------------------------
+PlusSequenceStreamWriter::PlusSequenceStreamWriter()
+  : UseCompression(false)
+  , EnableImageDataWrite(true)
+  , ImageOrientationInFile(US_IMG_ORIENT_MF)
+  , NumberOfCompressionThreads(1)
+  , CompressionLevel(-1)
+  , WriteFrameIndex(false)
+  , Writer(NULL)
+  , FrameList(vtkSmartPointer<vtkIGSIOTrackedFrameList>::New())
+  , CompressFileOnClose(false)
+  , IsHeaderPrepared(false)
+  , IsData3D(false)
+  , NumberOfWrittenFrames(0)
+{
+}
+
+//----------------------------------------------------------------------------
+PlusSequenceStreamWriter::~PlusSequenceStreamWriter()
+{
+  this->Discard();
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusSequenceStreamWriter::Open(const std::string& filename)
+{
+  this->Discard();
+
+  this->Filename = filename;
+  if (!vtksys::SystemTools::FileIsFullPath(filename))
+  {
+    this->Filename = vtkPlusConfig::GetInstance()->GetOutputPath(filename);
+  }
+
+  bool useCompression = this->UseCompression && this->EnableImageDataWrite;
+  if (useCompression && vtkIGSIOMetaImageSequenceIO::CanWriteFile(this->Filename))
+  {
+    LOG_WARNING("Compressed saving of metaimage file is not supported when the file is written incrementally. Reverting to uncompressed metaimage file.");
+    useCompression = false;
+  }
+
+  this->Writer = vtkIGSIOSequenceIO::CreateSequenceHandlerForFile(this->Filename);
+  if (!this->Writer)
+  {
+    LOG_ERROR("Could not create writer for file: " << this->Filename);
+    return PLUS_FAIL;
+  }
+  // Compressed files can only be indexed if they are compressed when the file is closed
+  this->CompressFileOnClose = useCompression && (this->NumberOfCompressionThreads != 1 || this->WriteFrameIndex) && vtkPlusSequenceIO::CanCompressInParallel(this->Filename);
+  this->Writer->SetUseCompression(useCompression && !this->CompressFileOnClose);
+  this->Writer->SetEnableImageDataWrite(this->EnableImageDataWrite);
+  this->Writer->SetImageOrientationInFile(this->ImageOrientationInFile);
+  this->Writer->SetTrackedFrameList(this->FrameList);
+  this->Writer->SetFileName(this->Filename);
+
+  this->IsHeaderPrepared = false;
+  this->IsData3D = false;
+  this->NumberOfWrittenFrames = 0;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusSequenceStreamWriter::WriteFrames()
+{
+  if (!this->Writer)
+  {
+    LOG_ERROR("Cannot write frames, the sequence file is not open");
+    return PLUS_FAIL;
+  }
+  unsigned int numberOfFrames = this->FrameList->GetNumberOfTrackedFrames();
+  if (numberOfFrames == 0)
+  {
+    return PLUS_SUCCESS;
+  }
+
+  if (!this->IsHeaderPrepared)
+  {
+    this->IsData3D = this->FrameList->GetTrackedFrame(0)->GetFrameSize()[2] > 1;
+    if (this->Writer->PrepareHeader() != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Unable to prepare header of " << this->Filename);
+      return PLUS_FAIL;
+    }
+    this->IsHeaderPrepared = true;
+  }
+
+  PlusStatus status = PLUS_SUCCESS;
+  if (this->Writer->AppendImagesToHeader() != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to append image data to header of " << this->Filename);
+    status = PLUS_FAIL;
+  }
+  else if (this->Writer->WriteImages() != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to write images to " << this->Filename);
+    status = PLUS_FAIL;
+  }
+  else
+  {
+    this->NumberOfWrittenFrames += numberOfFrames;
+  }
+  this->FrameList->Clear();
+  return status;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusSequenceStreamWriter::Close()
+{
+  if (!this->Writer)
+  {
+    return PLUS_SUCCESS;
+  }
+  if (this->WriteFrames() != PLUS_SUCCESS)
+  {
+    this->Discard();
+    return PLUS_FAIL;
+  }
+  if (!this->IsHeaderPrepared)
+  {
+    LOG_ERROR("No frames were written to " << this->Filename);
+    this->Discard();
+    return PLUS_FAIL;
+  }
+
+  this->Writer->UpdateDimensionsCustomStrings(this->NumberOfWrittenFrames, this->IsData3D);
+  this->Writer->UpdateFieldInImageHeader(this->Writer->GetDimensionSizeString());
+  this->Writer->UpdateFieldInImageHeader(this->Writer->GetDimensionKindsString());
+  this->Writer->FinalizeHeader();
+  this->Writer->Close();
+  this->Writer->Delete();
+  this->Writer = NULL;
+
+  if (this->CompressFileOnClose)
+  {
+    return vtkPlusSequenceIO::CompressFile(this->Filename, this->NumberOfCompressionThreads, this->CompressionLevel, this->WriteFrameIndex);
+  }
+  if (this->WriteFrameIndex && this->EnableImageDataWrite)
+  {
+    if (this->UseCompression && !vtkIGSIOMetaImageSequenceIO::CanWriteFile(this->Filename))
+    {
+      LOG_WARNING("Frame index is not written for " << this->Filename << ", only uncompressed files and compressed nrrd files can be indexed");
+    }
+    else if (vtkPlusSequenceIO::WriteFrameIndex(this->Filename) != PLUS_SUCCESS)
+    {
+      LOG_WARNING("Frame index is not written for " << this->Filename);
+    }
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void PlusSequenceStreamWriter::Discard()
+{
+  if (this->Writer)
+  {
+    this->Writer->Discard();
+    this->Writer->Delete();
+    this->Writer = NULL;
+  }
+  this->FrameList->Clear();
+  this->IsHeaderPrepared = false;
+  this->NumberOfWrittenFrames = 0;
+}
@@ -0,0 +1,92 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusSequenceStreamWriter_h
+#define __PlusSequenceStreamWriter_h
+
+#include "PlusConfigure.h"
+#include "vtkPlusCommonExport.h"
+
+#include <igsioCommon.h>
+#include <vtkSmartPointer.h>
+
+#include <string>
+
+class vtkIGSIOSequenceIOBase;
+class vtkIGSIOTrackedFrameList;
+
+/*!
+  \class PlusSequenceStreamWriter
+  \brief Writes a sequence file incrementally, a batch of frames at a time
+
+  Frames are added to the frame list (GetFrameList) and written to the file by WriteFrames, which then clears the list,
+  so only the current batch of frames is kept in memory. Fields of the sequence must be set in the frame list before
+  the first batch is written. The header is completed when the file is closed.
+
+  Compression, frame index and multi-threaded compression settings work the same way as in vtkPlusSequenceIO::Write.
+
+  \ingroup PlusLibCommon
+*/
+class vtkPlusCommonExport PlusSequenceStreamWriter
+{
+public:
+  PlusSequenceStreamWriter();
+
+  /*! If the file is not closed then it is discarded */
+  ~PlusSequenceStreamWriter();
+
+  void SetUseCompression(bool useCompression) { this->UseCompression = useCompression; }
+  void SetEnableImageDataWrite(bool enableImageDataWrite) { this->EnableImageDataWrite = enableImageDataWrite; }
+  void SetImageOrientationInFile(US_IMAGE_ORIENTATION orientation) { this->ImageOrientationInFile = orientation; }
+  /*! Number of threads used for compressing nrrd files, 0 means the number of processor cores */
+  void SetNumberOfCompressionThreads(int numberOfThreads) { this->NumberOfCompressionThreads = numberOfThreads; }
+  void SetCompressionLevel(int compressionLevel) { this->CompressionLevel = compressionLevel; }
+  /*! Write a frame index sidecar file when the file is closed (see vtkPlusSequenceIO::WriteFrameIndex) */
+  void SetWriteFrameIndex(bool writeFrameIndex) { this->WriteFrameIndex = writeFrameIndex; }
+
+  /*! Create the file. Settings must be set before opening the file. */
+  PlusStatus Open(const std::string& filename);
+
+  /*! Frames to be written by the next WriteFrames call */
+  vtkIGSIOTrackedFrameList* GetFrameList() const { return this->FrameList; }
+
+  /*! Write the frames of the frame list to the file and remove them from the list */
+  PlusStatus WriteFrames();
+
+  /*! Write the remaining frames and complete the file. Fails if no frames were written. */
+  PlusStatus Close();
+
+  /*! Discard the file without completing it */
+  void Discard();
+
+  unsigned int GetNumberOfWrittenFrames() const { return this->NumberOfWrittenFrames; }
+
+  /*! Name of the written file, with full path */
+  const std::string& GetFilename() const { return this->Filename; }
+
+protected:
+  bool UseCompression;
+  bool EnableImageDataWrite;
+  US_IMAGE_ORIENTATION ImageOrientationInFile;
+  int NumberOfCompressionThreads;
+  int CompressionLevel;
+  bool WriteFrameIndex;
+
+  std::string Filename;
+  vtkIGSIOSequenceIOBase* Writer;
+  vtkSmartPointer<vtkIGSIOTrackedFrameList> FrameList;
+  /*! With multi-threaded compression or frame index the frames are written uncompressed and the file is compressed when it is closed */
+  bool CompressFileOnClose;
+  bool IsHeaderPrepared;
+  bool IsData3D;
+  unsigned int NumberOfWrittenFrames;
+
+private:
+  PlusSequenceStreamWriter(const PlusSequenceStreamWriter&);
+  void operator=(const PlusSequenceStreamWriter&);
+};
+
+#endif
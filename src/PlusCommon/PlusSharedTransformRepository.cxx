@@ -0,0 +1,80 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "PlusSharedTransformRepository.h"
+
+//----------------------------------------------------------------------------
+PlusSharedTransformRepository::PlusSharedTransformRepository()
+  : Version(0)
+{
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusSharedTransformRepository::Reset(vtkIGSIOTransformRepository* repository)
+{
+  std::lock_guard<std::mutex> updateLock(this->UpdateMutex);
+  vtkSmartPointer<vtkIGSIOTransformRepository> copy;
+  if (repository != NULL)
+  {
+    copy = vtkSmartPointer<vtkIGSIOTransformRepository>::New();
+    if (copy->DeepCopy(repository) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to copy the transform repository");
+      return PLUS_FAIL;
+    }
+  }
+  std::lock_guard<std::mutex> snapshotLock(this->SnapshotMutex);
+  this->Snapshot = copy;
+  this->Version++;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+vtkSmartPointer<vtkIGSIOTransformRepository> PlusSharedTransformRepository::GetSnapshot() const
+{
+  std::lock_guard<std::mutex> snapshotLock(this->SnapshotMutex);
+  return this->Snapshot;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusSharedTransformRepository::Update(const UpdateFunction& update, vtkSmartPointer<vtkIGSIOTransformRepository>* newSnapshot /*= NULL*/)
+{
+  std::lock_guard<std::mutex> updateLock(this->UpdateMutex);
+  // Only updates replace the snapshot, so it cannot change while the update mutex is held
+  vtkSmartPointer<vtkIGSIOTransformRepository> currentSnapshot = this->GetSnapshot();
+  if (currentSnapshot == NULL)
+  {
+    LOG_ERROR("Failed to update the shared transform repository: the repository is not set");
+    return PLUS_FAIL;
+  }
+
+  vtkSmartPointer<vtkIGSIOTransformRepository> copy = vtkSmartPointer<vtkIGSIOTransformRepository>::New();
+  if (copy->DeepCopy(currentSnapshot) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to copy the transform repository");
+    return PLUS_FAIL;
+  }
+  PlusStatus status = update(copy);
+
+  {
+    std::lock_guard<std::mutex> snapshotLock(this->SnapshotMutex);
+    this->Snapshot = copy;
+    this->Version++;
+  }
+  if (newSnapshot != NULL)
+  {
+    *newSnapshot = copy;
+  }
+  return status;
+}
+
+//----------------------------------------------------------------------------
+unsigned long PlusSharedTransformRepository::GetVersion() const
+{
+  std::lock_guard<std::mutex> snapshotLock(this->SnapshotMutex);
+  return this->Version;
+}
@@ -0,0 +1,69 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusSharedTransformRepository_h
+#define __PlusSharedTransformRepository_h
+
+#include "PlusConfigure.h"
+#include "vtkPlusCommonExport.h"
+
+#include <vtkIGSIOTransformRepository.h>
+#include <vtkSmartPointer.h>
+
+#include <functional>
+#include <mutex>
+
+/*!
+  \class PlusSharedTransformRepository
+  \brief Transform repository that is shared between threads as immutable snapshots, updated copy-on-write
+
+  Each update copies the current snapshot, applies the changes to the copy and publishes the copy as the new snapshot.
+  A snapshot is never modified after it is published, so readers can keep using the snapshot that they got (e.g., all the
+  messages of a frame are packed from the same snapshot) without holding a lock, while other threads update the repository.
+  Updates are serialized, so an update is not lost if multiple threads update the repository at the same time.
+
+  Snapshots must be treated as read-only. vtkIGSIOTransformRepository still locks its own mutex in each call, so readers of
+  the same snapshot are serialized for the duration of a single call, but they never wait for an update.
+
+  \ingroup PlusLibCommon
+*/
+class vtkPlusCommonExport PlusSharedTransformRepository
+{
+public:
+  typedef std::function<PlusStatus(vtkIGSIOTransformRepository*)> UpdateFunction;
+
+  PlusSharedTransformRepository();
+
+  /*! Publish a copy of the repository as the current snapshot. NULL clears the shared repository. */
+  PlusStatus Reset(vtkIGSIOTransformRepository* repository);
+
+  /*! Get the current snapshot, NULL if the repository is not set. The snapshot must not be modified. */
+  vtkSmartPointer<vtkIGSIOTransformRepository> GetSnapshot() const;
+
+  /*!
+    Apply the update to a copy of the current snapshot and publish the copy. The copy is published even if the update
+    function fails (e.g., some of the transforms of a frame are invalid), the status of the update is returned.
+    \param newSnapshot If not NULL then it receives the published snapshot
+  */
+  PlusStatus Update(const UpdateFunction& update, vtkSmartPointer<vtkIGSIOTransformRepository>* newSnapshot = NULL);
+
+  /*! Incremented each time a snapshot is published */
+  unsigned long GetVersion() const;
+
+protected:
+  /*! Serializes the updates */
+  std::mutex UpdateMutex;
+  /*! Guards Snapshot and Version, held only while they are read or replaced */
+  mutable std::mutex SnapshotMutex;
+  vtkSmartPointer<vtkIGSIOTransformRepository> Snapshot;
+  unsigned long Version;
+
+private:
+  PlusSharedTransformRepository(const PlusSharedTransformRepository&);
+  void operator=(const PlusSharedTransformRepository&);
+};
+
+#endif
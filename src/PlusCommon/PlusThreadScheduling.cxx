@@ -0,0 +1,155 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "PlusThreadScheduling.h"
+
+#if defined(_WIN32)
+  #include <windows.h>
+#elif defined(__linux__)
+  #include <pthread.h>
+  #include <sched.h>
+  #include <sys/resource.h>
+  #include <sys/syscall.h>
+  #include <unistd.h>
+#endif
+
+// STL includes
+#include <sstream>
+
+//----------------------------------------------------------------------------
+PlusStatus PlusThreadScheduling::SetCurrentThreadPriority(ThreadPriority priority)
+{
+  if (priority == PRIORITY_NORMAL)
+  {
+    return PLUS_SUCCESS;
+  }
+#if defined(_WIN32)
+  int windowsPriority = (priority == PRIORITY_REALTIME ? THREAD_PRIORITY_TIME_CRITICAL : THREAD_PRIORITY_HIGHEST);
+  if (SetThreadPriority(GetCurrentThread(), windowsPriority) == 0)
+  {
+    LOG_WARNING("Failed to set thread priority to " << GetThreadPriorityAsString(priority) << ", error code: " << GetLastError());
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+#elif defined(__linux__)
+  if (priority == PRIORITY_REALTIME)
+  {
+    // Stay below the maximum so that kernel threads running at the maximum (e.g., watchdogs) are not starved
+    sched_param schedulingParameters;
+    schedulingParameters.sched_priority = (sched_get_priority_min(SCHED_FIFO) + sched_get_priority_max(SCHED_FIFO)) / 2;
+    int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &schedulingParameters);
+    if (error != 0)
+    {
+      LOG_WARNING("Failed to set real-time thread priority (SCHED_FIFO), error code: " << error << ". The process may need the CAP_SYS_NICE capability or an rtprio limit.");
+      return PLUS_FAIL;
+    }
+    return PLUS_SUCCESS;
+  }
+  // The nice value of a thread can be set through its thread id on Linux
+  if (setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), -10) != 0)
+  {
+    LOG_WARNING("Failed to set thread priority to " << GetThreadPriorityAsString(priority) << ". The process may need the CAP_SYS_NICE capability.");
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+#else
+  LOG_WARNING("Setting thread priority is not supported on this platform");
+  return PLUS_FAIL;
+#endif
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusThreadScheduling::SetCurrentThreadAffinity(const std::vector<int>& cpuIndices)
+{
+  if (cpuIndices.empty())
+  {
+    return PLUS_SUCCESS;
+  }
+#if defined(_WIN32)
+  DWORD_PTR affinityMask = 0;
+  for (std::vector<int>::const_iterator cpuIndex = cpuIndices.begin(); cpuIndex != cpuIndices.end(); ++cpuIndex)
+  {
+    if (*cpuIndex < 0 || *cpuIndex >= static_cast<int>(sizeof(DWORD_PTR) * 8))
+    {
+      LOG_WARNING("Failed to bind thread to processor cores " << GetCpuIndicesAsString(cpuIndices) << ": invalid core index " << *cpuIndex);
+      return PLUS_FAIL;
+    }
+    affinityMask |= static_cast<DWORD_PTR>(1) << *cpuIndex;
+  }
+  if (SetThreadAffinityMask(GetCurrentThread(), affinityMask) == 0)
+  {
+    LOG_WARNING("Failed to bind thread to processor cores " << GetCpuIndicesAsString(cpuIndices));
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+#elif defined(__linux__)
+  cpu_set_t cpuSet;
+  CPU_ZERO(&cpuSet);
+  for (std::vector<int>::const_iterator cpuIndex = cpuIndices.begin(); cpuIndex != cpuIndices.end(); ++cpuIndex)
+  {
+    if (*cpuIndex < 0 || *cpuIndex >= CPU_SETSIZE)
+    {
+      LOG_WARNING("Failed to bind thread to processor cores " << GetCpuIndicesAsString(cpuIndices) << ": invalid core index " << *cpuIndex);
+      return PLUS_FAIL;
+    }
+    CPU_SET(*cpuIndex, &cpuSet);
+  }
+  if (pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) != 0)
+  {
+    LOG_WARNING("Failed to bind thread to processor cores " << GetCpuIndicesAsString(cpuIndices));
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+#else
+  LOG_WARNING("Binding threads to processor cores is not supported on this platform");
+  return PLUS_FAIL;
+#endif
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusThreadScheduling::GetCpuIndicesFromString(const std::string& cpuIndicesStr, std::vector<int>& cpuIndices)
+{
+  cpuIndices.clear();
+  std::istringstream cpuIndicesStream(cpuIndicesStr);
+  int cpuIndex = 0;
+  while (cpuIndicesStream >> cpuIndex)
+  {
+    cpuIndices.push_back(cpuIndex);
+  }
+  if (!cpuIndicesStream.eof())
+  {
+    LOG_ERROR("Invalid processor core list: '" << cpuIndicesStr << "', expected a list of processor core indices");
+    cpuIndices.clear();
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+std::string PlusThreadScheduling::GetCpuIndicesAsString(const std::vector<int>& cpuIndices)
+{
+  std::ostringstream cpuIndicesStr;
+  for (std::vector<int>::const_iterator cpuIndex = cpuIndices.begin(); cpuIndex != cpuIndices.end(); ++cpuIndex)
+  {
+    cpuIndicesStr << (cpuIndex == cpuIndices.begin() ? "" : " ") << *cpuIndex;
+  }
+  return cpuIndicesStr.str();
+}
+
+//----------------------------------------------------------------------------
+const char* PlusThreadScheduling::GetThreadPriorityAsString(ThreadPriority priority)
+{
+  switch (priority)
+  {
+    case PRIORITY_HIGH:
+      return "HIGH";
+    case PRIORITY_REALTIME:
+      return "REALTIME";
+    default:
+      return "NORMAL";
+  }
+}
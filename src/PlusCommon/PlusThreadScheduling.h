@@ -0,0 +1,52 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusThreadScheduling_h
+#define __PlusThreadScheduling_h
+
+#include "PlusConfigure.h"
+#include "vtkPlusCommonExport.h"
+
+#include <string>
+#include <vector>
+
+/*!
+  \class PlusThreadScheduling
+  \brief Utility methods for setting the scheduling priority and processor affinity of the calling thread
+
+  Acquisition and sending threads that must keep a steady rate (e.g., to keep the timestamp jitter low) can be given a
+  higher priority and bound to processor cores that are not used by the processing threads.
+  Supported on Windows and Linux. On Linux real-time priority requires the CAP_SYS_NICE capability (or an
+  rtprio limit); if it is not granted then a warning is logged and the thread runs with the default priority.
+
+  \ingroup PlusLibCommon
+*/
+class vtkPlusCommonExport PlusThreadScheduling
+{
+public:
+  enum ThreadPriority
+  {
+    PRIORITY_NORMAL,    /*!< Default priority of the process, the thread is not changed */
+    PRIORITY_HIGH,      /*!< Highest priority without real-time scheduling */
+    PRIORITY_REALTIME   /*!< Real-time scheduling (SCHED_FIFO on Linux, time critical on Windows) */
+  };
+
+  /*! Set the scheduling priority of the calling thread */
+  static PlusStatus SetCurrentThreadPriority(ThreadPriority priority);
+
+  /*! Bind the calling thread to the given processor cores. Does nothing if the list is empty. */
+  static PlusStatus SetCurrentThreadAffinity(const std::vector<int>& cpuIndices);
+
+  /*! Parse a space-separated list of processor core indices (e.g., "2 3") */
+  static PlusStatus GetCpuIndicesFromString(const std::string& cpuIndicesStr, std::vector<int>& cpuIndices);
+
+  /*! Write the processor core indices as a space-separated list */
+  static std::string GetCpuIndicesAsString(const std::vector<int>& cpuIndices);
+
+  static const char* GetThreadPriorityAsString(ThreadPriority priority);
+};
+
+#endif
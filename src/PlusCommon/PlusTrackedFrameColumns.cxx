@@ -0,0 +1,148 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "PlusTrackedFrameColumns.h"
+
+// IGSIO includes
+#include <vtkIGSIOTrackedFrameList.h>
+#include <vtkIGSIOTransformRepository.h>
+
+// VTK includes
+#include <vtkMatrix4x4.h>
+#include <vtkSmartPointer.h>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  void CopyMatrix(vtkMatrix4x4* source, PlusTrackedFrameColumns::Matrix& destination)
+  {
+    for (int row = 0; row < 4; ++row)
+    {
+      for (int column = 0; column < 4; ++column)
+      {
+        destination[4 * row + column] = source->GetElement(row, column);
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusTrackedFrameColumns::PlusTrackedFrameColumns()
+{
+}
+
+//----------------------------------------------------------------------------
+void PlusTrackedFrameColumns::Clear()
+{
+  this->TransformNames.clear();
+  this->Timestamps.clear();
+  this->Matrices.clear();
+  this->Statuses.clear();
+  this->Images.clear();
+}
+
+//----------------------------------------------------------------------------
+int PlusTrackedFrameColumns::GetTransformIndex(const igsioTransformName& transformName) const
+{
+  for (unsigned int i = 0; i < this->TransformNames.size(); ++i)
+  {
+    if (this->TransformNames[i].From() == transformName.From() && this->TransformNames[i].To() == transformName.To())
+    {
+      return static_cast<int>(i);
+    }
+  }
+  return -1;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusTrackedFrameColumns::Build(vtkIGSIOTrackedFrameList* frameList, const std::vector<igsioTransformName>& transformNames, vtkIGSIOTransformRepository* repository/*=NULL*/)
+{
+  this->Clear();
+
+  if (frameList == NULL)
+  {
+    LOG_ERROR("Failed to build tracked frame columns: frame list is invalid");
+    return PLUS_FAIL;
+  }
+  for (std::vector<igsioTransformName>::const_iterator it = transformNames.begin(); it != transformNames.end(); ++it)
+  {
+    if (!it->IsValid())
+    {
+      LOG_ERROR("Failed to build tracked frame columns: transform name is invalid");
+      return PLUS_FAIL;
+    }
+  }
+
+  // Only the transforms that are not stored in the frames are used from this repository
+  vtkSmartPointer<vtkIGSIOTransformRepository> constantRepository = vtkSmartPointer<vtkIGSIOTransformRepository>::New();
+  if (repository != NULL && constantRepository->DeepCopy(repository, false) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to build tracked frame columns: cannot copy transform repository");
+    return PLUS_FAIL;
+  }
+
+  const unsigned int numberOfFrames = frameList->GetNumberOfTrackedFrames();
+  this->TransformNames = transformNames;
+  this->Timestamps.resize(numberOfFrames);
+  this->Images.resize(numberOfFrames);
+  this->Matrices.assign(transformNames.size(), std::vector<Matrix>(numberOfFrames));
+  this->Statuses.assign(transformNames.size(), std::vector<ToolStatus>(numberOfFrames, TOOL_INVALID));
+
+  PlusTransformPlan plan;
+  vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  int numberOfLookups = 0;
+  for (unsigned int frameIndex = 0; frameIndex < numberOfFrames; ++frameIndex)
+  {
+    igsioTrackedFrame* frame = frameList->GetTrackedFrame(frameIndex);
+    this->Timestamps[frameIndex] = frame->GetTimestamp();
+    this->Images[frameIndex] = frame->GetImageData();
+
+    if (plan.IsCompiled() && plan.Evaluate(*frame) == PLUS_SUCCESS)
+    {
+      for (unsigned int t = 0; t < transformNames.size(); ++t)
+      {
+        bool isValid = false;
+        plan.GetTransform(t, this->Matrices[t][frameIndex], &isValid);
+        this->Statuses[t][frameIndex] = isValid ? TOOL_OK : TOOL_INVALID;
+      }
+      continue;
+    }
+
+    // The plan cannot be used for this frame, look up the transforms in a repository that contains only this frame
+    ++numberOfLookups;
+    vtkSmartPointer<vtkIGSIOTransformRepository> frameRepository = vtkSmartPointer<vtkIGSIOTransformRepository>::New();
+    if (frameRepository->DeepCopy(constantRepository, false) != PLUS_SUCCESS || frameRepository->SetTransforms(*frame) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to build tracked frame columns: cannot set the transforms of frame " << frameIndex);
+      this->Clear();
+      return PLUS_FAIL;
+    }
+    bool allTransformsComputable = true;
+    for (unsigned int t = 0; t < transformNames.size(); ++t)
+    {
+      ToolStatus status = TOOL_INVALID;
+      if (frameRepository->IsExistingTransform(transformNames[t]) != PLUS_SUCCESS
+          || frameRepository->GetTransform(transformNames[t], matrix, &status) != PLUS_SUCCESS)
+      {
+        allTransformsComputable = false;
+        continue;
+      }
+      CopyMatrix(matrix, this->Matrices[t][frameIndex]);
+      this->Statuses[t][frameIndex] = status;
+    }
+
+    // Following frames most likely contain the same transforms, so they can use a plan compiled for this frame
+    if (allTransformsComputable)
+    {
+      plan.Compile(constantRepository, *frame, transformNames);
+    }
+  }
+
+  LOG_DEBUG("Tracked frame columns built for " << numberOfFrames << " frames and " << transformNames.size() << " transforms, "
+            << numberOfLookups << " frames were looked up in the transform repository");
+  return PLUS_SUCCESS;
+}
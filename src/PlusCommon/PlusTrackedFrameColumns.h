@@ -0,0 +1,77 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusTrackedFrameColumns_h
+#define __PlusTrackedFrameColumns_h
+
+#include "PlusConfigure.h"
+#include "PlusTransformPlan.h"
+#include "vtkPlusCommonExport.h"
+
+#include <igsioTrackedFrame.h>
+
+#include <string>
+#include <vector>
+
+class vtkIGSIOTrackedFrameList;
+class vtkIGSIOTransformRepository;
+
+/*!
+  \class PlusTrackedFrameColumns
+  \brief Column view of a tracked frame list for offline algorithms that read the same transforms from every frame
+
+  Calibration and reconstruction tools iterate over a loaded frame list several times and look up the same transforms
+  in each frame, which sets all the frame transforms in a transform repository and parses transform names again for every
+  frame. The columns are built once after loading: the timestamps, the matrices and statuses of each requested transform
+  and the images are stored in contiguous arrays, in frame order. The transforms are computed with a PlusTransformPlan,
+  which is compiled again when a frame contains different transforms; frames that the plan cannot be compiled for are
+  looked up in a transform repository, as before.
+
+  Images are not copied, the image pointers are valid as long as the frame list is not modified or deleted.
+
+  \ingroup PlusLibCommon
+*/
+class vtkPlusCommonExport PlusTrackedFrameColumns
+{
+public:
+  typedef PlusTransformPlan::Matrix Matrix;
+
+  PlusTrackedFrameColumns();
+
+  /*!
+    Build the columns for all the frames of the list. Transforms that are not stored in the frames (such as calibrations)
+    are taken from the repository, which may be NULL. The status of a transform is TOOL_OK if it is valid in the frame,
+    TOOL_INVALID if it cannot be computed for the frame.
+  */
+  PlusStatus Build(vtkIGSIOTrackedFrameList* frameList, const std::vector<igsioTransformName>& transformNames, vtkIGSIOTransformRepository* repository = NULL);
+
+  void Clear();
+
+  unsigned int GetNumberOfFrames() const { return static_cast<unsigned int>(this->Timestamps.size()); }
+  unsigned int GetNumberOfTransforms() const { return static_cast<unsigned int>(this->TransformNames.size()); }
+
+  /*! Index of the transform in the columns, -1 if the columns are not built for the transform */
+  int GetTransformIndex(const igsioTransformName& transformName) const;
+
+  const std::vector<double>& GetTimestamps() const { return this->Timestamps; }
+
+  /*! Matrices of a transform in all frames. The transform index must be less than the number of transforms. */
+  const std::vector<Matrix>& GetMatrices(unsigned int transformIndex) const { return this->Matrices[transformIndex]; }
+
+  /*! Statuses of a transform in all frames. The transform index must be less than the number of transforms. */
+  const std::vector<ToolStatus>& GetStatuses(unsigned int transformIndex) const { return this->Statuses[transformIndex]; }
+
+  const std::vector<igsioVideoFrame*>& GetImages() const { return this->Images; }
+
+protected:
+  std::vector<igsioTransformName> TransformNames;
+  std::vector<double> Timestamps;
+  std::vector<std::vector<Matrix> > Matrices;
+  std::vector<std::vector<ToolStatus> > Statuses;
+  std::vector<igsioVideoFrame*> Images;
+};
+
+#endif
@@ -0,0 +1,383 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "PlusTransformPlan.h"
+
+// IGSIO includes
+#include <vtkIGSIOTransformRepository.h>
+
+// VTK includes
+#include <vtkMatrix4x4.h>
+#include <vtkSmartPointer.h>
+
+// STL includes
+#include <deque>
+#include <map>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  void CopyMatrix(vtkMatrix4x4* source, PlusTransformPlan::Matrix& destination)
+  {
+    for (int row = 0; row < 4; ++row)
+    {
+      for (int column = 0; column < 4; ++column)
+      {
+        destination[4 * row + column] = source->GetElement(row, column);
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  void SetIdentity(PlusTransformPlan::Matrix& matrix)
+  {
+    matrix.fill(0.0);
+    matrix[0] = matrix[5] = matrix[10] = matrix[15] = 1.0;
+  }
+
+  //----------------------------------------------------------------------------
+  // Returns the id of the coordinate frame, adds it to the map if it is not found
+  int GetCoordinateFrameId(std::map<std::string, int>& coordinateFrameIds, const std::string& coordinateFrame)
+  {
+    std::map<std::string, int>::iterator it = coordinateFrameIds.find(coordinateFrame);
+    if (it != coordinateFrameIds.end())
+    {
+      return it->second;
+    }
+    int id = static_cast<int>(coordinateFrameIds.size());
+    coordinateFrameIds[coordinateFrame] = id;
+    return id;
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusTransformPlan::PlusTransformPlan()
+  : Compiled(false)
+{
+}
+
+//----------------------------------------------------------------------------
+void PlusTransformPlan::Clear()
+{
+  this->Compiled = false;
+  this->RequestedTransforms.clear();
+  this->Chains.clear();
+  this->FrameTransformNames.clear();
+  this->FrameTransformMatrices.clear();
+  this->FrameTransformInverseMatrices.clear();
+  this->FrameTransformValid.clear();
+  this->FrameTransformInverseUsed.clear();
+  this->ConstantMatrices.clear();
+  this->ConstantInverseMatrices.clear();
+  this->Results.clear();
+  this->ResultValid.clear();
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusTransformPlan::Compile(vtkIGSIOTransformRepository* repository, igsioTrackedFrame& referenceFrame, const std::vector<igsioTransformName>& requestedTransforms)
+{
+  this->Clear();
+
+  if (repository == NULL)
+  {
+    LOG_ERROR("Failed to compile transform plan: transform repository is invalid");
+    return PLUS_FAIL;
+  }
+
+  std::map<std::string, int> coordinateFrameIds;
+  std::vector<Edge> edges;
+
+  // Transforms that are stored in the frames
+  std::vector<igsioTransformName> frameTransformNames;
+  referenceFrame.GetFrameTransformNameList(frameTransformNames);
+  for (unsigned int i = 0; i < frameTransformNames.size(); ++i)
+  {
+    if (!frameTransformNames[i].IsValid())
+    {
+      continue;
+    }
+    Edge edge;
+    edge.From = GetCoordinateFrameId(coordinateFrameIds, frameTransformNames[i].From());
+    edge.To = GetCoordinateFrameId(coordinateFrameIds, frameTransformNames[i].To());
+    edge.FrameTransformIndex = static_cast<int>(i);
+    edge.ConstantIndex = -1;
+    edges.push_back(edge);
+  }
+
+  for (std::vector<igsioTransformName>::const_iterator it = requestedTransforms.begin(); it != requestedTransforms.end(); ++it)
+  {
+    if (!it->IsValid())
+    {
+      LOG_ERROR("Failed to compile transform plan: requested transform name is invalid");
+      return PLUS_FAIL;
+    }
+    GetCoordinateFrameId(coordinateFrameIds, it->From());
+    GetCoordinateFrameId(coordinateFrameIds, it->To());
+  }
+
+  std::vector<std::string> coordinateFrames(coordinateFrameIds.size());
+  for (std::map<std::string, int>::iterator it = coordinateFrameIds.begin(); it != coordinateFrameIds.end(); ++it)
+  {
+    coordinateFrames[it->second] = it->first;
+  }
+
+  // Transforms that are not stored in the frames are constant. They are computed by a copy of the repository
+  // where all the frame transforms are invalid, so transforms that depend on a frame transform are not used.
+  vtkSmartPointer<vtkIGSIOTransformRepository> constantRepository = vtkSmartPointer<vtkIGSIOTransformRepository>::New();
+  if (constantRepository->DeepCopy(repository, false) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to compile transform plan: cannot copy transform repository");
+    return PLUS_FAIL;
+  }
+  vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  for (std::vector<Edge>::iterator edgeIt = edges.begin(); edgeIt != edges.end(); ++edgeIt)
+  {
+    constantRepository->SetTransform(frameTransformNames[edgeIt->FrameTransformIndex], matrix, TOOL_INVALID);
+  }
+
+  const int numberOfFrameTransformEdges = static_cast<int>(edges.size());
+  for (int from = 0; from < static_cast<int>(coordinateFrames.size()); ++from)
+  {
+    for (int to = from + 1; to < static_cast<int>(coordinateFrames.size()); ++to)
+    {
+      bool isFrameTransform = false;
+      for (int e = 0; e < numberOfFrameTransformEdges; ++e)
+      {
+        if ((edges[e].From == from && edges[e].To == to) || (edges[e].From == to && edges[e].To == from))
+        {
+          isFrameTransform = true;
+          break;
+        }
+      }
+      if (isFrameTransform)
+      {
+        continue;
+      }
+      igsioTransformName constantName(coordinateFrames[from], coordinateFrames[to]);
+      if (constantRepository->IsExistingTransform(constantName) != PLUS_SUCCESS)
+      {
+        continue;
+      }
+      bool isValid = false;
+      if (constantRepository->GetTransform(constantName, matrix, &isValid) != PLUS_SUCCESS || !isValid)
+      {
+        continue;
+      }
+      Matrix constant;
+      CopyMatrix(matrix, constant);
+      Matrix constantInverse;
+      vtkMatrix4x4::Invert(constant.data(), constantInverse.data());
+
+      Edge edge;
+      edge.From = from;
+      edge.To = to;
+      edge.FrameTransformIndex = -1;
+      edge.ConstantIndex = static_cast<int>(this->ConstantMatrices.size());
+      edges.push_back(edge);
+      this->ConstantMatrices.push_back(constant);
+      this->ConstantInverseMatrices.push_back(constantInverse);
+    }
+  }
+
+  // Chains, with frame transform indices of the reference frame
+  for (std::vector<igsioTransformName>::const_iterator it = requestedTransforms.begin(); it != requestedTransforms.end(); ++it)
+  {
+    std::vector<Step> chain;
+    if (FindChain(edges, static_cast<int>(coordinateFrames.size()), coordinateFrameIds[it->From()], coordinateFrameIds[it->To()], chain) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to compile transform plan: " << it->GetTransformName() << " cannot be computed from the frame transforms");
+      this->Clear();
+      return PLUS_FAIL;
+    }
+    this->Chains.push_back(chain);
+  }
+
+  // Keep only the frame transforms that are used
+  std::vector<int> usedFrameTransformIndex(frameTransformNames.size(), -1);
+  for (std::vector<std::vector<Step> >::iterator chainIt = this->Chains.begin(); chainIt != this->Chains.end(); ++chainIt)
+  {
+    for (std::vector<Step>::iterator stepIt = chainIt->begin(); stepIt != chainIt->end(); ++stepIt)
+    {
+      if (stepIt->FrameTransformIndex < 0)
+      {
+        continue;
+      }
+      int& usedIndex = usedFrameTransformIndex[stepIt->FrameTransformIndex];
+      if (usedIndex < 0)
+      {
+        usedIndex = static_cast<int>(this->FrameTransformNames.size());
+        this->FrameTransformNames.push_back(frameTransformNames[stepIt->FrameTransformIndex]);
+        this->FrameTransformInverseUsed.push_back(false);
+      }
+      stepIt->FrameTransformIndex = usedIndex;
+      if (stepIt->Inverse)
+      {
+        this->FrameTransformInverseUsed[usedIndex] = true;
+      }
+    }
+  }
+
+  this->RequestedTransforms = requestedTransforms;
+  this->FrameTransformMatrices.resize(this->FrameTransformNames.size());
+  this->FrameTransformInverseMatrices.resize(this->FrameTransformNames.size());
+  this->FrameTransformValid.resize(this->FrameTransformNames.size(), false);
+  this->Results.resize(this->RequestedTransforms.size());
+  this->ResultValid.resize(this->RequestedTransforms.size(), false);
+  this->Compiled = true;
+
+  LOG_DEBUG("Transform plan compiled: " << this->RequestedTransforms.size() << " transforms from " << this->FrameTransformNames.size()
+            << " frame transforms and " << this->ConstantMatrices.size() << " constant transforms");
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusTransformPlan::FindChain(const std::vector<Edge>& edges, int numberOfCoordinateFrames, int from, int to, std::vector<Step>& chain)
+{
+  chain.clear();
+  if (from == to)
+  {
+    return PLUS_SUCCESS;
+  }
+
+  // For each visited coordinate frame the edge that it was reached on, and whether the edge was traversed backward
+  std::vector<int> previousEdge(numberOfCoordinateFrames, -1);
+  std::vector<bool> backward(numberOfCoordinateFrames, false);
+  std::vector<bool> visited(numberOfCoordinateFrames, false);
+  std::deque<int> queue;
+  visited[from] = true;
+  queue.push_back(from);
+  while (!queue.empty() && !visited[to])
+  {
+    int current = queue.front();
+    queue.pop_front();
+    for (unsigned int e = 0; e < edges.size(); ++e)
+    {
+      int next = -1;
+      bool isBackward = false;
+      if (edges[e].From == current)
+      {
+        next = edges[e].To;
+      }
+      else if (edges[e].To == current)
+      {
+        next = edges[e].From;
+        isBackward = true;
+      }
+      if (next < 0 || visited[next])
+      {
+        continue;
+      }
+      visited[next] = true;
+      previousEdge[next] = static_cast<int>(e);
+      backward[next] = isBackward;
+      queue.push_back(next);
+    }
+  }
+
+  if (!visited[to])
+  {
+    return PLUS_FAIL;
+  }
+
+  for (int current = to; current != from;)
+  {
+    const Edge& edge = edges[previousEdge[current]];
+    Step step;
+    step.FrameTransformIndex = edge.FrameTransformIndex;
+    step.ConstantIndex = edge.ConstantIndex;
+    step.Inverse = backward[current];
+    chain.insert(chain.begin(), step);
+    current = backward[current] ? edge.To : edge.From;
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusTransformPlan::Evaluate(igsioTrackedFrame& frame)
+{
+  if (!this->Compiled)
+  {
+    LOG_ERROR("Failed to evaluate transform plan: the plan is not compiled");
+    return PLUS_FAIL;
+  }
+
+  vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  for (unsigned int i = 0; i < this->FrameTransformNames.size(); ++i)
+  {
+    ToolStatus status = TOOL_INVALID;
+    if (frame.GetFrameTransform(this->FrameTransformNames[i], matrix) != PLUS_SUCCESS
+        || frame.GetFrameTransformStatus(this->FrameTransformNames[i], status) != PLUS_SUCCESS)
+    {
+      LOG_DEBUG("Transform plan cannot be evaluated: " << this->FrameTransformNames[i].GetTransformName() << " is not found in the frame");
+      return PLUS_FAIL;
+    }
+    CopyMatrix(matrix, this->FrameTransformMatrices[i]);
+    this->FrameTransformValid[i] = (status == TOOL_OK);
+    if (this->FrameTransformInverseUsed[i])
+    {
+      vtkMatrix4x4::Invert(this->FrameTransformMatrices[i].data(), this->FrameTransformInverseMatrices[i].data());
+    }
+  }
+
+  Matrix product;
+  for (unsigned int i = 0; i < this->Chains.size(); ++i)
+  {
+    Matrix& result = this->Results[i];
+    SetIdentity(result);
+    bool isValid = true;
+    for (std::vector<Step>::const_iterator stepIt = this->Chains[i].begin(); stepIt != this->Chains[i].end(); ++stepIt)
+    {
+      const Matrix* stepMatrix = NULL;
+      if (stepIt->FrameTransformIndex >= 0)
+      {
+        stepMatrix = stepIt->Inverse ? &this->FrameTransformInverseMatrices[stepIt->FrameTransformIndex] : &this->FrameTransformMatrices[stepIt->FrameTransformIndex];
+        isValid = isValid && this->FrameTransformValid[stepIt->FrameTransformIndex];
+      }
+      else
+      {
+        stepMatrix = stepIt->Inverse ? &this->ConstantInverseMatrices[stepIt->ConstantIndex] : &this->ConstantMatrices[stepIt->ConstantIndex];
+      }
+      vtkMatrix4x4::Multiply4x4(stepMatrix->data(), result.data(), product.data());
+      result = product;
+    }
+    this->ResultValid[i] = isValid;
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusTransformPlan::GetTransform(unsigned int requestedTransformIndex, Matrix& matrix, bool* isValid/*=NULL*/) const
+{
+  if (!this->Compiled || requestedTransformIndex >= this->Results.size())
+  {
+    LOG_ERROR("Failed to get transform from transform plan: invalid transform index " << requestedTransformIndex);
+    return PLUS_FAIL;
+  }
+  matrix = this->Results[requestedTransformIndex];
+  if (isValid != NULL)
+  {
+    *isValid = this->ResultValid[requestedTransformIndex];
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusTransformPlan::GetTransform(unsigned int requestedTransformIndex, vtkMatrix4x4* matrix, bool* isValid/*=NULL*/) const
+{
+  if (matrix == NULL)
+  {
+    LOG_ERROR("Failed to get transform from transform plan: output matrix is invalid");
+    return PLUS_FAIL;
+  }
+  Matrix result;
+  if (this->GetTransform(requestedTransformIndex, result, isValid) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  matrix->DeepCopy(result.data());
+  return PLUS_SUCCESS;
+}
@@ -0,0 +1,105 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusTransformPlan_h
+#define __PlusTransformPlan_h
+
+#include "PlusConfigure.h"
+#include "vtkPlusCommonExport.h"
+
+#include <igsioTrackedFrame.h>
+
+#include <array>
+#include <string>
+#include <vector>
+
+class vtkIGSIOTransformRepository;
+class vtkMatrix4x4;
+
+/*!
+  \class PlusTransformPlan
+  \brief Computes a fixed set of transforms from tracked frames, without transform repository lookups for each frame
+
+  Getting a transform from the transform repository requires setting all the transforms of the frame in the repository and
+  finding the path between the coordinate frames by name, for each frame. The plan does this once: coordinate frames are
+  mapped to integer ids, transforms that are not stored in the frames (such as calibrations) are taken from the repository as
+  constant matrices, and for each requested transform the chain of frame transforms and constant matrices is stored.
+  Evaluating the plan for a frame only reads the frame transforms that are used by the chains and multiplies 4x4 matrices.
+
+  The plan has to be compiled again if the repository changes. Evaluation fails if a frame does not contain a transform that
+  the plan uses, in this case the plan can be compiled for the new frame.
+
+  \ingroup PlusLibCommon
+*/
+class vtkPlusCommonExport PlusTransformPlan
+{
+public:
+  /*! 4x4 matrix, element (row, column) is stored at index 4*row+column */
+  typedef std::array<double, 16> Matrix;
+
+  PlusTransformPlan();
+
+  /*!
+    Compile the plan for computing the requested transforms from frames that contain the same transforms as the reference frame.
+    Transforms that are not stored in the frame are taken from the repository. Fails if any of the requested transforms cannot be computed.
+  */
+  PlusStatus Compile(vtkIGSIOTransformRepository* repository, igsioTrackedFrame& referenceFrame, const std::vector<igsioTransformName>& requestedTransforms);
+
+  void Clear();
+  bool IsCompiled() const { return this->Compiled; }
+
+  /*! Transforms that the plan computes, in the order of the results */
+  const std::vector<igsioTransformName>& GetRequestedTransforms() const { return this->RequestedTransforms; }
+
+  /*! Compute the requested transforms from the transforms of the frame */
+  PlusStatus Evaluate(igsioTrackedFrame& frame);
+
+  /*! Get a transform computed by the last Evaluate call. The transform is valid if all the frame transforms that it is computed from are valid. */
+  PlusStatus GetTransform(unsigned int requestedTransformIndex, Matrix& matrix, bool* isValid = NULL) const;
+  PlusStatus GetTransform(unsigned int requestedTransformIndex, vtkMatrix4x4* matrix, bool* isValid = NULL) const;
+
+protected:
+  struct Step
+  {
+    /*! Index of the frame transform, or -1 if the constant matrix is used */
+    int FrameTransformIndex;
+    /*! Index of the constant matrix, if FrameTransformIndex is -1 */
+    int ConstantIndex;
+    /*! The inverse of the frame transform is used */
+    bool Inverse;
+  };
+
+  struct Edge
+  {
+    int From;
+    int To;
+    int FrameTransformIndex;
+    int ConstantIndex;
+  };
+
+  /*! Find the chain of steps from a coordinate frame to another one (breadth-first search, so the chain is the shortest one) */
+  static PlusStatus FindChain(const std::vector<Edge>& edges, int numberOfCoordinateFrames, int from, int to, std::vector<Step>& chain);
+
+  bool Compiled;
+  std::vector<igsioTransformName> RequestedTransforms;
+  std::vector<std::vector<Step> > Chains;
+
+  /*! Frame transforms that are used by the chains */
+  std::vector<igsioTransformName> FrameTransformNames;
+  std::vector<Matrix> FrameTransformMatrices;
+  std::vector<Matrix> FrameTransformInverseMatrices;
+  std::vector<bool> FrameTransformValid;
+  std::vector<bool> FrameTransformInverseUsed;
+
+  /*! Constant matrices and their inverses */
+  std::vector<Matrix> ConstantMatrices;
+  std::vector<Matrix> ConstantInverseMatrices;
+
+  std::vector<Matrix> Results;
+  std::vector<bool> ResultValid;
+};
+
+#endif
@@ -0,0 +1,468 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "PlusProfiler.h"
+#include "PlusUnbufferedFileWriter.h"
+#include "vtkIGSIOAccurateTimer.h"
+
+#if defined(_WIN32)
+  #include <windows.h>
+  #include <malloc.h>
+#else
+  #include <errno.h>
+  #include <fcntl.h>
+  #include <stdlib.h>
+  #include <unistd.h>
+#endif
+
+// STL includes
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+namespace
+{
+  const size_t DEFAULT_BUFFER_SIZE_BYTES = 4 * 1024 * 1024;
+  const int DEFAULT_QUEUE_DEPTH = 4;
+
+  //----------------------------------------------------------------------------
+  unsigned char* AllocateAlignedBuffer(size_t sizeBytes)
+  {
+#if defined(_WIN32)
+    return static_cast<unsigned char*>(_aligned_malloc(sizeBytes, PlusUnbufferedFileWriter::ALIGNMENT));
+#else
+    void* buffer = NULL;
+    if (posix_memalign(&buffer, PlusUnbufferedFileWriter::ALIGNMENT, sizeBytes) != 0)
+    {
+      return NULL;
+    }
+    return static_cast<unsigned char*>(buffer);
+#endif
+  }
+
+  //----------------------------------------------------------------------------
+  void FreeAlignedBuffer(unsigned char* buffer)
+  {
+#if defined(_WIN32)
+    _aligned_free(buffer);
+#else
+    free(buffer);
+#endif
+  }
+
+  //----------------------------------------------------------------------------
+  size_t RoundUpToAlignment(size_t sizeBytes)
+  {
+    return (sizeBytes + PlusUnbufferedFileWriter::ALIGNMENT - 1) / PlusUnbufferedFileWriter::ALIGNMENT * PlusUnbufferedFileWriter::ALIGNMENT;
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusUnbufferedFileWriter::PlusUnbufferedFileWriter()
+  : BufferSizeBytes(DEFAULT_BUFFER_SIZE_BYTES)
+  , QueueDepth(DEFAULT_QUEUE_DEPTH)
+  , PreallocatedSizeBytes(0)
+  , FileOpen(false)
+  , Unbuffered(false)
+#ifdef _WIN32
+  , FileHandle(INVALID_HANDLE_VALUE)
+#else
+  , FileDescriptor(-1)
+#endif
+  , CurrentBuffer(-1)
+  , StopRequested(false)
+  , WriteFailed(false)
+  , NumberOfBytesWritten(0)
+  , NumberOfStalls(0)
+  , MaxWriteTimeSec(0.0)
+  , OpenTimeSec(0.0)
+  , CloseTimeSec(0.0)
+{
+}
+
+//----------------------------------------------------------------------------
+PlusUnbufferedFileWriter::~PlusUnbufferedFileWriter()
+{
+  this->Close();
+}
+
+//----------------------------------------------------------------------------
+void PlusUnbufferedFileWriter::SetBufferSizeBytes(size_t bufferSizeBytes)
+{
+  this->BufferSizeBytes = RoundUpToAlignment(std::max<size_t>(bufferSizeBytes, 1));
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusUnbufferedFileWriter::Open(const std::string& filename)
+{
+  if (this->FileOpen)
+  {
+    LOG_ERROR("Cannot open " << filename << ", the writer has already opened " << this->Filename);
+    return PLUS_FAIL;
+  }
+
+  this->Filename = filename;
+  this->NumberOfBytesWritten = 0;
+  this->NumberOfStalls = 0;
+  this->MaxWriteTimeSec = 0.0;
+
+  // One buffer is filled by the caller while the others are queued or written
+  this->Buffers.resize(this->QueueDepth + 1);
+  for (std::vector<Buffer>::iterator buffer = this->Buffers.begin(); buffer != this->Buffers.end(); ++buffer)
+  {
+    buffer->Data = AllocateAlignedBuffer(this->BufferSizeBytes);
+    buffer->Size = 0;
+    if (buffer->Data == NULL)
+    {
+      LOG_ERROR("Failed to allocate " << this->Buffers.size() << " write buffers of " << this->BufferSizeBytes << " bytes for " << filename);
+      this->FreeBuffers();
+      return PLUS_FAIL;
+    }
+  }
+
+  if (this->OpenFile() != PLUS_SUCCESS)
+  {
+    this->FreeBuffers();
+    return PLUS_FAIL;
+  }
+  LOG_DEBUG("Opened " << filename << (this->Unbuffered ? " for unbuffered writing" : ", the file system does not support unbuffered writing"));
+
+  this->CurrentBuffer = 0;
+  this->FullBuffers.clear();
+  this->EmptyBuffers.clear();
+  for (int i = 1; i < static_cast<int>(this->Buffers.size()); ++i)
+  {
+    this->EmptyBuffers.push_back(i);
+  }
+  this->StopRequested = false;
+  this->WriteFailed = false;
+  this->FileOpen = true;
+  this->OpenTimeSec = vtkIGSIOAccurateTimer::GetSystemTime();
+  this->Thread = std::thread(&PlusUnbufferedFileWriter::ThreadFunction, this);
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusUnbufferedFileWriter::Write(const void* data, size_t sizeBytes)
+{
+  if (!this->FileOpen)
+  {
+    LOG_ERROR("Cannot write data, the file is not open");
+    return PLUS_FAIL;
+  }
+
+  const unsigned char* source = static_cast<const unsigned char*>(data);
+  while (sizeBytes > 0)
+  {
+    Buffer& buffer = this->Buffers[this->CurrentBuffer];
+    size_t copySize = std::min(sizeBytes, this->BufferSizeBytes - buffer.Size);
+    memcpy(buffer.Data + buffer.Size, source, copySize);
+    buffer.Size += copySize;
+    source += copySize;
+    sizeBytes -= copySize;
+    this->NumberOfBytesWritten += copySize;
+    if (buffer.Size == this->BufferSizeBytes && this->SubmitCurrentBuffer() != PLUS_SUCCESS)
+    {
+      return PLUS_FAIL;
+    }
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusUnbufferedFileWriter::SubmitCurrentBuffer()
+{
+  std::unique_lock<std::mutex> lock(this->Mutex);
+  this->FullBuffers.push_back(this->CurrentBuffer);
+  this->CurrentBuffer = -1;
+  this->QueueChanged.notify_all();
+
+  if (this->EmptyBuffers.empty() && !this->WriteFailed)
+  {
+    this->NumberOfStalls++;
+    this->QueueChanged.wait(lock, [this] { return !this->EmptyBuffers.empty() || this->WriteFailed; });
+  }
+  if (this->WriteFailed)
+  {
+    LOG_ERROR("Failed to write " << this->Filename);
+    return PLUS_FAIL;
+  }
+
+  this->CurrentBuffer = this->EmptyBuffers.front();
+  this->EmptyBuffers.pop_front();
+  this->Buffers[this->CurrentBuffer].Size = 0;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void PlusUnbufferedFileWriter::ThreadFunction()
+{
+  PLUS_PROFILE_THREAD_NAME("Plus file writer");
+  std::unique_lock<std::mutex> lock(this->Mutex);
+  for (;;)
+  {
+    this->QueueChanged.wait(lock, [this] { return !this->FullBuffers.empty() || this->StopRequested; });
+    if (this->FullBuffers.empty())
+    {
+      // Stop requested and all the queued buffers are written
+      break;
+    }
+    int bufferIndex = this->FullBuffers.front();
+    this->FullBuffers.pop_front();
+    bool skipWrite = this->WriteFailed;
+    lock.unlock();
+
+    PlusStatus status = PLUS_FAIL;
+    if (!skipWrite)
+    {
+      double startTimeSec = vtkIGSIOAccurateTimer::GetSystemTime();
+      status = this->WriteBlock(this->Buffers[bufferIndex].Data, this->Buffers[bufferIndex].Size);
+      double writeTimeSec = vtkIGSIOAccurateTimer::GetSystemTime() - startTimeSec;
+      if (writeTimeSec > this->MaxWriteTimeSec)
+      {
+        this->MaxWriteTimeSec = writeTimeSec;
+      }
+    }
+
+    lock.lock();
+    if (status != PLUS_SUCCESS)
+    {
+      this->WriteFailed = true;
+    }
+    this->EmptyBuffers.push_back(bufferIndex);
+    this->QueueChanged.notify_all();
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusUnbufferedFileWriter::Close()
+{
+  if (!this->FileOpen)
+  {
+    return PLUS_SUCCESS;
+  }
+
+  // The thread writes the queued buffers before it exits
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    this->StopRequested = true;
+  }
+  this->QueueChanged.notify_all();
+  this->Thread.join();
+
+  PlusStatus status = PLUS_SUCCESS;
+  if (this->WriteFailed)
+  {
+    LOG_ERROR("Failed to write " << this->Filename);
+    status = PLUS_FAIL;
+  }
+  else if (this->CurrentBuffer >= 0 && this->Buffers[this->CurrentBuffer].Size > 0)
+  {
+    // Unbuffered writes must be aligned, the padding is removed when the file is truncated
+    Buffer& buffer = this->Buffers[this->CurrentBuffer];
+    size_t writeSize = buffer.Size;
+    if (this->Unbuffered)
+    {
+      writeSize = RoundUpToAlignment(buffer.Size);
+      memset(buffer.Data + buffer.Size, 0, writeSize - buffer.Size);
+    }
+    status = this->WriteBlock(buffer.Data, writeSize);
+  }
+
+  if (this->TruncateAndCloseFile(this->NumberOfBytesWritten) != PLUS_SUCCESS)
+  {
+    status = PLUS_FAIL;
+  }
+
+  this->FileOpen = false;
+  this->CloseTimeSec = vtkIGSIOAccurateTimer::GetSystemTime();
+  this->FreeBuffers();
+  return status;
+}
+
+//----------------------------------------------------------------------------
+void PlusUnbufferedFileWriter::FreeBuffers()
+{
+  for (std::vector<Buffer>::iterator buffer = this->Buffers.begin(); buffer != this->Buffers.end(); ++buffer)
+  {
+    if (buffer->Data != NULL)
+    {
+      FreeAlignedBuffer(buffer->Data);
+    }
+  }
+  this->Buffers.clear();
+  this->FullBuffers.clear();
+  this->EmptyBuffers.clear();
+  this->CurrentBuffer = -1;
+}
+
+//----------------------------------------------------------------------------
+std::string PlusUnbufferedFileWriter::GetStatisticsString() const
+{
+  double endTimeSec = this->FileOpen ? vtkIGSIOAccurateTimer::GetSystemTime() : this->CloseTimeSec;
+  double writtenMB = this->NumberOfBytesWritten / (1024.0 * 1024.0);
+  double elapsedTimeSec = endTimeSec - this->OpenTimeSec;
+  std::ostringstream ss;
+  ss << std::fixed << std::setprecision(1)
+     << "Unbuffered=" << (this->Unbuffered ? 1 : 0)
+     << " QueueDepth=" << this->QueueDepth
+     << " WrittenMB=" << writtenMB
+     << " ThroughputMBps=" << (elapsedTimeSec > 0 ? writtenMB / elapsedTimeSec : 0.0)
+     << " Stalls=" << this->NumberOfStalls.load()
+     << " MaxWriteMs=" << this->MaxWriteTimeSec.load() * 1000.0;
+  return ss.str();
+}
+
+#if defined(_WIN32)
+
+//----------------------------------------------------------------------------
+PlusStatus PlusUnbufferedFileWriter::OpenFile()
+{
+  HANDLE handle = CreateFileA(this->Filename.c_str(), GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_NO_BUFFERING | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+  this->Unbuffered = (handle != INVALID_HANDLE_VALUE);
+  if (handle == INVALID_HANDLE_VALUE)
+  {
+    handle = CreateFileA(this->Filename.c_str(), GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS,
+                         FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+  }
+  if (handle == INVALID_HANDLE_VALUE)
+  {
+    LOG_ERROR("Failed to open " << this->Filename << " for writing (error code: " << GetLastError() << ")");
+    return PLUS_FAIL;
+  }
+  this->FileHandle = handle;
+
+  if (this->PreallocatedSizeBytes > 0)
+  {
+    // Reserves the space without changing the file size
+    FILE_ALLOCATION_INFO allocationInfo;
+    allocationInfo.AllocationSize.QuadPart = static_cast<LONGLONG>(this->PreallocatedSizeBytes);
+    if (!SetFileInformationByHandle(handle, FileAllocationInfo, &allocationInfo, sizeof(allocationInfo)))
+    {
+      LOG_WARNING("Failed to preallocate " << this->PreallocatedSizeBytes << " bytes for " << this->Filename << " (error code: " << GetLastError() << ")");
+    }
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusUnbufferedFileWriter::WriteBlock(const unsigned char* data, size_t sizeBytes)
+{
+  while (sizeBytes > 0)
+  {
+    DWORD requestedSize = static_cast<DWORD>(std::min<size_t>(sizeBytes, 1 << 30));
+    DWORD writtenSize = 0;
+    if (!WriteFile(static_cast<HANDLE>(this->FileHandle), data, requestedSize, &writtenSize, NULL) || writtenSize == 0)
+    {
+      LOG_ERROR("Failed to write " << this->Filename << " (error code: " << GetLastError() << ")");
+      return PLUS_FAIL;
+    }
+    data += writtenSize;
+    sizeBytes -= writtenSize;
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusUnbufferedFileWriter::TruncateAndCloseFile(unsigned long long sizeBytes)
+{
+  PlusStatus status = PLUS_SUCCESS;
+  FILE_END_OF_FILE_INFO endOfFileInfo;
+  endOfFileInfo.EndOfFile.QuadPart = static_cast<LONGLONG>(sizeBytes);
+  if (!SetFileInformationByHandle(static_cast<HANDLE>(this->FileHandle), FileEndOfFileInfo, &endOfFileInfo, sizeof(endOfFileInfo)))
+  {
+    LOG_ERROR("Failed to set the size of " << this->Filename << " (error code: " << GetLastError() << ")");
+    status = PLUS_FAIL;
+  }
+  CloseHandle(static_cast<HANDLE>(this->FileHandle));
+  this->FileHandle = INVALID_HANDLE_VALUE;
+  return status;
+}
+
+#else
+
+//----------------------------------------------------------------------------
+PlusStatus PlusUnbufferedFileWriter::OpenFile()
+{
+  const int flags = O_WRONLY | O_CREAT | O_TRUNC;
+  int fileDescriptor = -1;
+#ifdef O_DIRECT
+  // O_DIRECT is rejected by some file systems (e.g., tmpfs)
+  fileDescriptor = open(this->Filename.c_str(), flags | O_DIRECT, 0644);
+  this->Unbuffered = (fileDescriptor >= 0);
+#endif
+  if (fileDescriptor < 0)
+  {
+    fileDescriptor = open(this->Filename.c_str(), flags, 0644);
+  }
+  if (fileDescriptor < 0)
+  {
+    LOG_ERROR("Failed to open " << this->Filename << " for writing: " << strerror(errno));
+    return PLUS_FAIL;
+  }
+#ifdef F_NOCACHE
+  this->Unbuffered = (fcntl(fileDescriptor, F_NOCACHE, 1) != -1);
+#endif
+  this->FileDescriptor = fileDescriptor;
+
+#if defined(__linux__)
+  if (this->PreallocatedSizeBytes > 0)
+  {
+    // Reserves the space without changing the file size. Unlike posix_fallocate, it fails instead of writing zeros
+    // if the file system does not support preallocation.
+    if (fallocate(fileDescriptor, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(this->PreallocatedSizeBytes)) != 0)
+    {
+      LOG_WARNING("Failed to preallocate " << this->PreallocatedSizeBytes << " bytes for " << this->Filename << ": " << strerror(errno));
+    }
+  }
+#endif
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusUnbufferedFileWriter::WriteBlock(const unsigned char* data, size_t sizeBytes)
+{
+  while (sizeBytes > 0)
+  {
+    ssize_t writtenSize = write(this->FileDescriptor, data, sizeBytes);
+    if (writtenSize < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      LOG_ERROR("Failed to write " << this->Filename << ": " << strerror(errno));
+      return PLUS_FAIL;
+    }
+    data += writtenSize;
+    sizeBytes -= static_cast<size_t>(writtenSize);
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusUnbufferedFileWriter::TruncateAndCloseFile(unsigned long long sizeBytes)
+{
+  PlusStatus status = PLUS_SUCCESS;
+  // Removes the padding of the last block, the file system releases the preallocated space beyond the end of the file
+  if (ftruncate(this->FileDescriptor, static_cast<off_t>(sizeBytes)) != 0)
+  {
+    LOG_ERROR("Failed to set the size of " << this->Filename << ": " << strerror(errno));
+    status = PLUS_FAIL;
+  }
+  if (close(this->FileDescriptor) != 0)
+  {
+    LOG_ERROR("Failed to close " << this->Filename << ": " << strerror(errno));
+    status = PLUS_FAIL;
+  }
+  this->FileDescriptor = -1;
+  return status;
+}
+
+#endif
@@ -0,0 +1,145 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusUnbufferedFileWriter_h
+#define __PlusUnbufferedFileWriter_h
+
+#include "PlusConfigure.h"
+#include "vtkPlusCommonExport.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*!
+  \class PlusUnbufferedFileWriter
+  \brief Appends data to a file in large aligned blocks that bypass the file cache of the operating system
+
+  Writing hundreds of megabytes per second through buffered stdio fills the page cache with data that is never
+  read again, the cache is then flushed in bursts that stall the writing thread and other processes of the machine.
+  This writer collects the data in aligned buffers and writes each full buffer in one call, by a background thread:
+  - Linux: the file is opened with O_DIRECT, the space is preallocated by fallocate
+  - Windows: the file is opened with FILE_FLAG_NO_BUFFERING, the space is preallocated by setting the allocation size
+  - macOS: caching is disabled by F_NOCACHE
+
+  If the file system does not support unbuffered writing (e.g., tmpfs) then the file is written with regular
+  writes (see IsUnbuffered). While a buffer is written, the caller fills the next one. At most QueueDepth full
+  buffers wait for writing, Write blocks when the queue is full (this is counted as a stall).
+
+  The last block is padded to the alignment when written and the file is truncated to the written size when it is
+  closed. Preallocated space that is not used is released.
+
+  \ingroup PlusLibCommon
+*/
+class vtkPlusCommonExport PlusUnbufferedFileWriter
+{
+public:
+  /*! Alignment of the buffers and of the size of the writes, it is a multiple of the sector size of common disks */
+  static const size_t ALIGNMENT = 4096;
+
+  PlusUnbufferedFileWriter();
+
+  /*! The file is closed if it is open */
+  ~PlusUnbufferedFileWriter();
+
+  /*! Size of one write, rounded up to a multiple of ALIGNMENT */
+  void SetBufferSizeBytes(size_t bufferSizeBytes);
+  size_t GetBufferSizeBytes() const { return this->BufferSizeBytes; }
+
+  /*! Maximum number of full buffers queued for writing, including the one that is being written */
+  void SetQueueDepth(int queueDepth) { this->QueueDepth = (queueDepth > 0 ? queueDepth : 1); }
+  int GetQueueDepth() const { return this->QueueDepth; }
+
+  /*! Disk space to reserve when the file is opened, 0 means no preallocation */
+  void SetPreallocatedSizeBytes(unsigned long long sizeBytes) { this->PreallocatedSizeBytes = sizeBytes; }
+  unsigned long long GetPreallocatedSizeBytes() const { return this->PreallocatedSizeBytes; }
+
+  /*! Create the file. Settings must be set before opening the file. An existing file is overwritten. */
+  PlusStatus Open(const std::string& filename);
+
+  /*! Append data to the file. Fails if a previous write has failed. */
+  PlusStatus Write(const void* data, size_t sizeBytes);
+
+  /*! Write the remaining data, truncate the file to the written size and close it */
+  PlusStatus Close();
+
+  bool IsOpen() const { return this->FileOpen; }
+
+  /*! True if the data of the open file bypasses the file cache of the operating system */
+  bool IsUnbuffered() const { return this->Unbuffered; }
+
+  const std::string& GetFilename() const { return this->Filename; }
+
+  /*! Number of bytes appended since the file was opened */
+  unsigned long long GetNumberOfBytesWritten() const { return this->NumberOfBytesWritten; }
+
+  /*! Number of times Write had to wait for a buffer to be written, because the disk could not keep up */
+  unsigned long long GetNumberOfStalls() const { return this->NumberOfStalls; }
+
+  /*! Summary in the form "Unbuffered=... QueueDepth=... WrittenMB=... ThroughputMBps=... Stalls=... MaxWriteMs=..." */
+  std::string GetStatisticsString() const;
+
+protected:
+  struct Buffer
+  {
+    Buffer() : Data(NULL), Size(0) {}
+    unsigned char* Data;
+    size_t Size;
+  };
+
+  PlusStatus OpenFile();
+  PlusStatus WriteBlock(const unsigned char* data, size_t sizeBytes);
+  PlusStatus TruncateAndCloseFile(unsigned long long sizeBytes);
+
+  void ThreadFunction();
+
+  /*! Queue the current buffer for writing and get an empty one */
+  PlusStatus SubmitCurrentBuffer();
+
+  void FreeBuffers();
+
+  size_t BufferSizeBytes;
+  int QueueDepth;
+  unsigned long long PreallocatedSizeBytes;
+
+  std::string Filename;
+  bool FileOpen;
+  bool Unbuffered;
+#ifdef _WIN32
+  void* FileHandle;
+#else
+  int FileDescriptor;
+#endif
+
+  std::vector<Buffer> Buffers;
+  /*! Buffer that is filled by Write, -1 if none */
+  int CurrentBuffer;
+
+  std::mutex Mutex;
+  std::condition_variable QueueChanged;
+  /*! Indices of the buffers waiting to be written and of the empty buffers */
+  std::deque<int> FullBuffers;
+  std::deque<int> EmptyBuffers;
+  bool StopRequested;
+  bool WriteFailed;
+  std::thread Thread;
+
+  unsigned long long NumberOfBytesWritten;
+  std::atomic<unsigned long long> NumberOfStalls;
+  std::atomic<double> MaxWriteTimeSec;
+  double OpenTimeSec;
+  double CloseTimeSec;
+
+private:
+  PlusUnbufferedFileWriter(const PlusUnbufferedFileWriter&);
+  void operator=(const PlusUnbufferedFileWriter&);
+};
+
+#endif
@@ -0,0 +1,447 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "PlusUnbufferedSequenceWriter.h"
+
+// IGSIO includes
+#include <igsioTrackedFrame.h>
+#include <vtkIGSIOTrackedFrameList.h>
+
+// STL includes
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  // Returns the MetaImage and nrrd name of the scalar type, or false if the type cannot be written
+  bool GetScalarTypeNames(int scalarType, std::string& metaImageType, std::string& nrrdType)
+  {
+    switch (scalarType)
+    {
+      case VTK_CHAR:
+      case VTK_SIGNED_CHAR:
+        metaImageType = "MET_CHAR";
+        nrrdType = "signed char";
+        return true;
+      case VTK_UNSIGNED_CHAR:
+        metaImageType = "MET_UCHAR";
+        nrrdType = "uchar";
+        return true;
+      case VTK_SHORT:
+        metaImageType = "MET_SHORT";
+        nrrdType = "short";
+        return true;
+      case VTK_UNSIGNED_SHORT:
+        metaImageType = "MET_USHORT";
+        nrrdType = "ushort";
+        return true;
+      case VTK_INT:
+        metaImageType = "MET_INT";
+        nrrdType = "int";
+        return true;
+      case VTK_UNSIGNED_INT:
+        metaImageType = "MET_UINT";
+        nrrdType = "uint";
+        return true;
+      case VTK_FLOAT:
+        metaImageType = "MET_FLOAT";
+        nrrdType = "float";
+        return true;
+      case VTK_DOUBLE:
+        metaImageType = "MET_DOUBLE";
+        nrrdType = "double";
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  // Header fields that describe the image geometry and encoding, they are written by the writer, not copied from the custom fields
+  bool IsImageFormatField(const std::string& key)
+  {
+    static const char* imageFormatFields[] =
+    {
+      "ObjectType", "NDims", "BinaryData", "BinaryDataByteOrderMSB", "CompressedData", "CompressedDataSize",
+      "TransformMatrix", "Offset", "CenterOfRotation", "AnatomicalOrientation", "ElementSpacing", "DimSize",
+      "ElementNumberOfChannels", "ElementType", "ElementDataFile", "Kinds", "UltrasoundImageOrientation", "UltrasoundImageType",
+      "type", "dimension", "space", "sizes", "space directions", "kinds", "endian", "encoding", "space origin", "data file", NULL
+    };
+    for (const char** field = imageFormatFields; *field != NULL; ++field)
+    {
+      if (key == *field)
+      {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  //----------------------------------------------------------------------------
+  bool HasExtension(const std::string& filename, const std::string& extension)
+  {
+    if (filename.size() < extension.size())
+    {
+      return false;
+    }
+    std::string filenameExtension = filename.substr(filename.size() - extension.size());
+    std::transform(filenameExtension.begin(), filenameExtension.end(), filenameExtension.begin(), ::tolower);
+    return filenameExtension == extension;
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusUnbufferedSequenceWriter::PlusUnbufferedSequenceWriter()
+  : IsMetaImage(true)
+  , NumberOfWrittenFrames(0)
+  , IsImageFormatSet(false)
+  , PixelType(VTK_VOID)
+  , NumberOfScalarComponents(1)
+  , ImageOrientation(US_IMG_ORIENT_MF)
+  , ImageType(US_IMG_BRIGHTNESS)
+{
+  this->FrameSize[0] = 0;
+  this->FrameSize[1] = 0;
+  this->FrameSize[2] = 0;
+}
+
+//----------------------------------------------------------------------------
+PlusUnbufferedSequenceWriter::~PlusUnbufferedSequenceWriter()
+{
+  this->Discard();
+}
+
+//----------------------------------------------------------------------------
+std::string PlusUnbufferedSequenceWriter::GetHeaderFilename(const std::string& filename)
+{
+  if (HasExtension(filename, ".mhd") || HasExtension(filename, ".nhdr"))
+  {
+    return filename;
+  }
+  if (HasExtension(filename, ".mha"))
+  {
+    return filename.substr(0, filename.size() - 4) + ".mhd";
+  }
+  if (HasExtension(filename, ".nrrd"))
+  {
+    return filename.substr(0, filename.size() - 5) + ".nhdr";
+  }
+  return "";
+}
+
+//----------------------------------------------------------------------------
+std::string PlusUnbufferedSequenceWriter::GetDataFilename(const std::string& headerFilename)
+{
+  size_t extensionStart = headerFilename.find_last_of('.');
+  return headerFilename.substr(0, extensionStart) + ".raw";
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusUnbufferedSequenceWriter::Open(const std::string& filename)
+{
+  this->Discard();
+
+  std::string fullPath = filename;
+  if (!vtksys::SystemTools::FileIsFullPath(filename))
+  {
+    fullPath = vtkPlusConfig::GetInstance()->GetOutputPath(filename);
+  }
+  this->Filename = GetHeaderFilename(fullPath);
+  if (this->Filename.empty())
+  {
+    LOG_ERROR("Cannot write " << fullPath << " without buffering, only MetaImage and NRRD files are supported");
+    return PLUS_FAIL;
+  }
+  this->IsMetaImage = HasExtension(this->Filename, ".mhd");
+
+  this->NumberOfWrittenFrames = 0;
+  this->IsImageFormatSet = false;
+  this->InvalidFrameData.clear();
+  this->CustomFields.clear();
+  this->FrameFields.str("");
+  this->FrameFields.clear();
+  this->FrameFields << std::setprecision(std::numeric_limits<double>::digits10 + 1);
+
+  return this->DataWriter.Open(GetDataFilename(this->Filename));
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusUnbufferedSequenceWriter::SetFilename(const std::string& filename)
+{
+  std::string fullPath = filename;
+  if (!vtksys::SystemTools::FileIsFullPath(filename))
+  {
+    fullPath = vtkPlusConfig::GetInstance()->GetOutputPath(filename);
+  }
+  std::string headerFilename = GetHeaderFilename(fullPath);
+  if (headerFilename.empty() || HasExtension(headerFilename, ".mhd") != this->IsMetaImage)
+  {
+    LOG_ERROR("Cannot save " << this->Filename << " as " << fullPath << ", the file type cannot be changed");
+    return PLUS_FAIL;
+  }
+  this->Filename = headerFilename;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusUnbufferedSequenceWriter::WriteFrames(vtkIGSIOTrackedFrameList* frameList)
+{
+  if (!this->DataWriter.IsOpen())
+  {
+    LOG_ERROR("Cannot write frames, the sequence file is not open");
+    return PLUS_FAIL;
+  }
+
+  std::vector<std::string> fieldNames;
+  frameList->GetCustomFieldNameList(fieldNames);
+  this->CustomFields.clear();
+  for (std::vector<std::string>::iterator fieldName = fieldNames.begin(); fieldName != fieldNames.end(); ++fieldName)
+  {
+    const char* value = frameList->GetCustomString(fieldName->c_str());
+    if (value != NULL && !IsImageFormatField(*fieldName))
+    {
+      this->CustomFields.push_back(std::make_pair(*fieldName, std::string(value)));
+    }
+  }
+
+  const char* keyValueSeparator = this->IsMetaImage ? " = " : ":=";
+  for (unsigned int i = 0; i < frameList->GetNumberOfTrackedFrames(); ++i)
+  {
+    igsioTrackedFrame* trackedFrame = frameList->GetTrackedFrame(i);
+    igsioVideoFrame* image = trackedFrame->GetImageData();
+    bool isImageValid = (image != NULL && image->IsImageValid());
+    if (isImageValid && !this->IsImageFormatSet)
+    {
+      this->FrameSize = image->GetFrameSize();
+      this->PixelType = image->GetVTKScalarPixelType();
+      std::string metaImageType;
+      std::string nrrdType;
+      if (!GetScalarTypeNames(this->PixelType, metaImageType, nrrdType))
+      {
+        LOG_ERROR("Cannot write frames to " << this->Filename << ", unsupported pixel type: " << this->PixelType);
+        return PLUS_FAIL;
+      }
+      if (image->GetNumberOfScalarComponents(this->NumberOfScalarComponents) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to get the number of scalar components of the frames of " << this->Filename);
+        return PLUS_FAIL;
+      }
+      this->ImageOrientation = image->GetImageOrientation();
+      this->ImageType = image->GetImageType();
+      this->InvalidFrameData.assign(image->GetFrameSizeInBytes(), 0);
+      this->IsImageFormatSet = true;
+    }
+    if (!this->IsImageFormatSet)
+    {
+      LOG_ERROR("Cannot write frame " << this->NumberOfWrittenFrames << " to " << this->Filename << ", the image size is not known until a frame with valid image data is written");
+      return PLUS_FAIL;
+    }
+
+    const void* pixels = &this->InvalidFrameData[0];
+    if (isImageValid)
+    {
+      unsigned int numberOfScalarComponents(0);
+      image->GetNumberOfScalarComponents(numberOfScalarComponents);
+      if (image->GetFrameSize() != this->FrameSize || image->GetVTKScalarPixelType() != this->PixelType || numberOfScalarComponents != this->NumberOfScalarComponents)
+      {
+        LOG_ERROR("Cannot write frame " << this->NumberOfWrittenFrames << " to " << this->Filename << ", its size or pixel type is different from the previous frames");
+        return PLUS_FAIL;
+      }
+      pixels = image->GetScalarPointer();
+    }
+    if (this->DataWriter.Write(pixels, this->InvalidFrameData.size()) != PLUS_SUCCESS)
+    {
+      return PLUS_FAIL;
+    }
+
+    std::ostringstream prefix;
+    prefix << "Seq_Frame" << std::setfill('0') << std::setw(4) << this->NumberOfWrittenFrames << "_";
+    const igsioFieldMapType& frameFields = trackedFrame->GetFrameFields();
+    if (frameFields.find("Timestamp") == frameFields.end())
+    {
+      this->FrameFields << prefix.str() << "Timestamp" << keyValueSeparator << trackedFrame->GetTimestamp() << "\n";
+    }
+    for (igsioFieldMapType::const_iterator field = frameFields.begin(); field != frameFields.end(); ++field)
+    {
+      if (field->first != "ImageStatus")
+      {
+        this->FrameFields << prefix.str() << field->first << keyValueSeparator << field->second.second << "\n";
+      }
+    }
+    this->FrameFields << prefix.str() << "ImageStatus" << keyValueSeparator << (isImageValid ? "OK" : "INVALID") << "\n";
+    this->NumberOfWrittenFrames++;
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusUnbufferedSequenceWriter::Close()
+{
+  if (!this->DataWriter.IsOpen())
+  {
+    LOG_ERROR("Cannot close the sequence file, it is not open");
+    return PLUS_FAIL;
+  }
+  if (this->NumberOfWrittenFrames == 0)
+  {
+    LOG_ERROR("No frames were written to " << this->Filename);
+    this->Discard();
+    return PLUS_FAIL;
+  }
+
+  std::string writtenDataFilename = this->DataWriter.GetFilename();
+  if (this->DataWriter.Close() != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+
+  // The file may have been renamed while it was written
+  std::string dataFilename = GetDataFilename(this->Filename);
+  if (dataFilename != writtenDataFilename && !vtksys::SystemTools::RenameFile(writtenDataFilename.c_str(), dataFilename.c_str()))
+  {
+    LOG_ERROR("Failed to rename " << writtenDataFilename << " to " << dataFilename);
+    return PLUS_FAIL;
+  }
+
+  return this->WriteHeader(dataFilename);
+}
+
+//----------------------------------------------------------------------------
+void PlusUnbufferedSequenceWriter::Discard()
+{
+  if (!this->DataWriter.IsOpen())
+  {
+    return;
+  }
+  std::string dataFilename = this->DataWriter.GetFilename();
+  this->DataWriter.Close();
+  vtksys::SystemTools::RemoveFile(dataFilename);
+  this->NumberOfWrittenFrames = 0;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusUnbufferedSequenceWriter::WriteHeader(const std::string& dataFilename)
+{
+  std::ostringstream header;
+  header << std::setprecision(10);
+  if (this->IsMetaImage)
+  {
+    this->WriteMetaImageHeader(header, vtksys::SystemTools::GetFilenameName(dataFilename));
+  }
+  else
+  {
+    this->WriteNrrdHeader(header, vtksys::SystemTools::GetFilenameName(dataFilename));
+  }
+
+  std::ofstream headerFile(this->Filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  headerFile << header.str();
+  headerFile.close();
+  if (!headerFile)
+  {
+    LOG_ERROR("Failed to write header file " << this->Filename);
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void PlusUnbufferedSequenceWriter::WriteMetaImageHeader(std::ostream& header, const std::string& dataFilename)
+{
+  std::string metaImageType;
+  std::string nrrdType;
+  GetScalarTypeNames(this->PixelType, metaImageType, nrrdType);
+  bool isData3D = this->FrameSize[2] > 1;
+
+  header << "ObjectType = Image\n";
+  header << "NDims = " << (isData3D ? 4 : 3) << "\n";
+  // By definition, LPS orientation in DICOM sense = RAI orientation in MetaIO
+  header << "AnatomicalOrientation = RAI\n";
+  header << "BinaryData = True\n";
+#ifdef VTK_WORDS_BIGENDIAN
+  header << "BinaryDataByteOrderMSB = True\n";
+#else
+  header << "BinaryDataByteOrderMSB = False\n";
+#endif
+  header << "CenterOfRotation = 0 0 0" << (isData3D ? " 0" : "") << "\n";
+  header << "CompressedData = False\n";
+  header << "DimSize = " << this->FrameSize[0] << " " << this->FrameSize[1] << " ";
+  if (isData3D)
+  {
+    header << this->FrameSize[2] << " ";
+  }
+  header << this->NumberOfWrittenFrames << "\n";
+  if (this->NumberOfScalarComponents > 1)
+  {
+    header << "ElementNumberOfChannels = " << this->NumberOfScalarComponents << "\n";
+  }
+  header << "ElementSpacing = 1 1 1" << (isData3D ? " 1" : "") << "\n";
+  header << "ElementType = " << metaImageType << "\n";
+  header << "Kinds = domain domain " << (isData3D ? "domain " : "") << "list\n";
+  header << "Offset = 0 0 0" << (isData3D ? " 0" : "") << "\n";
+  header << "TransformMatrix = " << (isData3D ? "1 0 0 0 0 1 0 0 0 0 1 0 0 0 0 1" : "1 0 0 0 1 0 0 0 1") << "\n";
+  header << "UltrasoundImageOrientation = " << igsioCommon::GetStringFromUsImageOrientation(this->ImageOrientation) << "\n";
+  header << "UltrasoundImageType = " << igsioCommon::GetStringFromUsImageType(this->ImageType) << "\n";
+  for (std::vector<std::pair<std::string, std::string> >::const_iterator field = this->CustomFields.begin(); field != this->CustomFields.end(); ++field)
+  {
+    header << field->first << " = " << field->second << "\n";
+  }
+  header << this->FrameFields.str();
+  // ElementDataFile must be the last field of the header
+  header << "ElementDataFile = " << dataFilename << "\n";
+}
+
+//----------------------------------------------------------------------------
+void PlusUnbufferedSequenceWriter::WriteNrrdHeader(std::ostream& header, const std::string& dataFilename)
+{
+  std::string metaImageType;
+  std::string nrrdType;
+  GetScalarTypeNames(this->PixelType, metaImageType, nrrdType);
+  bool isData3D = this->FrameSize[2] > 1;
+  bool hasComponentAxis = this->NumberOfScalarComponents > 1;
+
+  header << "NRRD0004\n";
+  header << "# Complete NRRD file format specification at:\n";
+  header << "# http://teem.sourceforge.net/nrrd/format.html\n";
+  header << "type: " << nrrdType << "\n";
+  header << "dimension: " << (isData3D ? 4 : 3) + (hasComponentAxis ? 1 : 0) << "\n";
+  header << "space: left-posterior-superior\n";
+  header << "sizes: ";
+  if (hasComponentAxis)
+  {
+    header << this->NumberOfScalarComponents << " ";
+  }
+  header << this->FrameSize[0] << " " << this->FrameSize[1] << " ";
+  if (isData3D)
+  {
+    header << this->FrameSize[2] << " ";
+  }
+  header << this->NumberOfWrittenFrames << "\n";
+  header << "space directions: " << (hasComponentAxis ? "none " : "") << "(1,0,0) (0,1,0) " << (isData3D ? "(0,0,1) " : "") << "none\n";
+  header << "kinds: " << (hasComponentAxis ? "vector " : "") << "domain domain " << (isData3D ? "domain " : "") << "list\n";
+#ifdef VTK_WORDS_BIGENDIAN
+  header << "endian: big\n";
+#else
+  header << "endian: little\n";
+#endif
+  header << "encoding: raw\n";
+  header << "space origin: (0,0,0)\n";
+  header << "data file: " << dataFilename << "\n";
+  header << "UltrasoundImageOrientation:=" << igsioCommon::GetStringFromUsImageOrientation(this->ImageOrientation) << "\n";
+  header << "UltrasoundImageType:=" << igsioCommon::GetStringFromUsImageType(this->ImageType) << "\n";
+  for (std::vector<std::pair<std::string, std::string> >::const_iterator field = this->CustomFields.begin(); field != this->CustomFields.end(); ++field)
+  {
+    header << field->first << ":=" << field->second << "\n";
+  }
+  header << this->FrameFields.str();
+  // The header is terminated by an empty line
+  header << "\n";
+}
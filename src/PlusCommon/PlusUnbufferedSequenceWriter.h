@@ -0,0 +1,116 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusUnbufferedSequenceWriter_h
+#define __PlusUnbufferedSequenceWriter_h
+
+#include "PlusConfigure.h"
+#include "vtkPlusCommonExport.h"
+#include "PlusUnbufferedFileWriter.h"
+
+#include <igsioCommon.h>
+
+#include <sstream>
+#include <string>
+
+class vtkIGSIOTrackedFrameList;
+
+/*!
+  \class PlusUnbufferedSequenceWriter
+  \brief Writes uncompressed sequence files for high-throughput recording, the pixel data bypasses the file cache
+
+  The pixel data of the frames is appended to a raw data file by PlusUnbufferedFileWriter. The frame fields are
+  collected in memory and the header is written when the file is closed, to a separate header file that refers to the
+  data file. Sequence files with attached data (.mha, .nrrd) cannot be written this way, because the size of the
+  header is only known at the end of the recording and the data would have to be copied after it. Instead, the header
+  is written to the detached header file type of the same format (.mhd or .nhdr, see GetHeaderFilename) and the data
+  is written to a .raw file next to it. These files can be read by any MetaImage or NRRD reader.
+
+  All frames must have the same size and pixel type. Frames without valid image data are written as zero-filled images
+  with an INVALID image status.
+
+  \ingroup PlusLibCommon
+*/
+class vtkPlusCommonExport PlusUnbufferedSequenceWriter
+{
+public:
+  PlusUnbufferedSequenceWriter();
+
+  /*! If the file is not closed then it is discarded */
+  ~PlusUnbufferedSequenceWriter();
+
+  /*! Write settings of the data file, see PlusUnbufferedFileWriter */
+  void SetQueueDepth(int queueDepth) { this->DataWriter.SetQueueDepth(queueDepth); }
+  void SetBufferSizeBytes(size_t bufferSizeBytes) { this->DataWriter.SetBufferSizeBytes(bufferSizeBytes); }
+  void SetPreallocatedSizeBytes(unsigned long long sizeBytes) { this->DataWriter.SetPreallocatedSizeBytes(sizeBytes); }
+
+  /*!
+    Name of the header file that is written for the requested sequence file name: .mha is replaced by .mhd and
+    .nrrd by .nhdr. Returns an empty string if the file type cannot be written.
+  */
+  static std::string GetHeaderFilename(const std::string& filename);
+
+  /*! Name of the data file that belongs to a header file (the extension is replaced by .raw) */
+  static std::string GetDataFilename(const std::string& headerFilename);
+
+  /*! Create the data file. The header file name is determined by GetHeaderFilename. */
+  PlusStatus Open(const std::string& filename);
+
+  /*!
+    Change the name of the file before it is closed. The data file is renamed when the file is closed.
+    This can be used for saving the recording with a name that is only known at the end of the recording.
+  */
+  PlusStatus SetFilename(const std::string& filename);
+
+  /*! Append the frames of the list to the file. Custom fields of the list are written to the header. */
+  PlusStatus WriteFrames(vtkIGSIOTrackedFrameList* frameList);
+
+  /*! Write the remaining data and the header. Fails if no frames were written. */
+  PlusStatus Close();
+
+  /*! Discard the file without completing it */
+  void Discard();
+
+  bool IsOpen() const { return this->DataWriter.IsOpen(); }
+  unsigned int GetNumberOfWrittenFrames() const { return this->NumberOfWrittenFrames; }
+
+  /*! Name of the header file, with full path */
+  const std::string& GetFilename() const { return this->Filename; }
+
+  /*! Write statistics of the data file, see PlusUnbufferedFileWriter::GetStatisticsString */
+  std::string GetStatisticsString() const { return this->DataWriter.GetStatisticsString(); }
+
+protected:
+  PlusStatus WriteHeader(const std::string& dataFilename);
+  void WriteMetaImageHeader(std::ostream& header, const std::string& dataFilename);
+  void WriteNrrdHeader(std::ostream& header, const std::string& dataFilename);
+
+  PlusUnbufferedFileWriter DataWriter;
+
+  std::string Filename;
+  bool IsMetaImage;
+  unsigned int NumberOfWrittenFrames;
+
+  /*! Image properties, they are set from the first frame with valid image data */
+  bool IsImageFormatSet;
+  FrameSizeType FrameSize;
+  igsioCommon::VTKScalarPixelType PixelType;
+  unsigned int NumberOfScalarComponents;
+  US_IMAGE_ORIENTATION ImageOrientation;
+  US_IMAGE_TYPE ImageType;
+  std::vector<unsigned char> InvalidFrameData;
+
+  /*! Custom fields of the sequence, from the last written frame list */
+  std::vector<std::pair<std::string, std::string> > CustomFields;
+  /*! Header lines of the frame fields of the written frames */
+  std::ostringstream FrameFields;
+
+private:
+  PlusUnbufferedSequenceWriter(const PlusUnbufferedSequenceWriter&);
+  void operator=(const PlusUnbufferedSequenceWriter&);
+};
+
+#endif
@@ -0,0 +1,419 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "PlusVolumeSlabWriter.h"
+
+// VTK includes
+#include <vtkAbstractArray.h>
+#include <vtkImageData.h>
+
+// STL includes
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+  // Width of the CompressedDataSize value in the MetaImage header, the value is padded with spaces
+  const int COMPRESSED_DATA_SIZE_FIELD_WIDTH = 20;
+
+  //----------------------------------------------------------------------------
+  // Returns the MetaImage and nrrd name of the scalar type, or false if the type cannot be written
+  bool GetScalarTypeNames(int scalarType, std::string& metaImageType, std::string& nrrdType)
+  {
+    switch (scalarType)
+    {
+      case VTK_CHAR:
+      case VTK_SIGNED_CHAR:
+        metaImageType = "MET_CHAR";
+        nrrdType = "signed char";
+        return true;
+      case VTK_UNSIGNED_CHAR:
+        metaImageType = "MET_UCHAR";
+        nrrdType = "uchar";
+        return true;
+      case VTK_SHORT:
+        metaImageType = "MET_SHORT";
+        nrrdType = "short";
+        return true;
+      case VTK_UNSIGNED_SHORT:
+        metaImageType = "MET_USHORT";
+        nrrdType = "ushort";
+        return true;
+      case VTK_INT:
+        metaImageType = "MET_INT";
+        nrrdType = "int";
+        return true;
+      case VTK_UNSIGNED_INT:
+        metaImageType = "MET_UINT";
+        nrrdType = "uint";
+        return true;
+      case VTK_FLOAT:
+        metaImageType = "MET_FLOAT";
+        nrrdType = "float";
+        return true;
+      case VTK_DOUBLE:
+        metaImageType = "MET_DOUBLE";
+        nrrdType = "double";
+        return true;
+      default:
+        return false;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusVolumeSlabWriter::PlusVolumeSlabWriter()
+  : UseCompression(false)
+  , NumberOfCompressionThreads(0)
+  , CompressionLevel(-1)
+  , SlabThickness(16)
+  , IsMetaImage(true)
+  , IsCompressedStreamStarted(false)
+  , CompressedDataSizePosition(0)
+  , SliceSizeInBytes(0)
+  , NumberOfSlices(0)
+  , NumberOfWrittenSlices(0)
+{
+}
+
+//----------------------------------------------------------------------------
+PlusVolumeSlabWriter::~PlusVolumeSlabWriter()
+{
+  this->Discard();
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusVolumeSlabWriter::Open(const std::string& filename, const int dimensions[3], const double spacing[3], const double origin[3], int scalarType, int numberOfScalarComponents)
+{
+  this->Discard();
+
+  this->Filename = filename;
+  if (!vtksys::SystemTools::FileIsFullPath(filename))
+  {
+    this->Filename = vtkPlusConfig::GetInstance()->GetOutputPath(filename);
+  }
+
+  std::string extension = vtksys::SystemTools::LowerCase(vtksys::SystemTools::GetFilenameLastExtension(this->Filename));
+  if (extension != ".mha" && extension != ".nrrd")
+  {
+    LOG_ERROR("Cannot write volume to " << this->Filename << ", only .mha and .nrrd files with attached data are supported");
+    return PLUS_FAIL;
+  }
+  this->IsMetaImage = (extension == ".mha");
+
+  if (dimensions[0] <= 0 || dimensions[1] <= 0 || dimensions[2] <= 0 || numberOfScalarComponents <= 0)
+  {
+    LOG_ERROR("Cannot write volume to " << this->Filename << ", invalid volume size: " << dimensions[0] << "x" << dimensions[1] << "x" << dimensions[2]
+              << ", " << numberOfScalarComponents << " components");
+    return PLUS_FAIL;
+  }
+  this->SliceSizeInBytes = static_cast<unsigned long long>(dimensions[0]) * dimensions[1] * numberOfScalarComponents * vtkAbstractArray::GetDataTypeSize(scalarType);
+  this->NumberOfSlices = static_cast<unsigned int>(dimensions[2]);
+  this->NumberOfWrittenSlices = 0;
+  if (this->UseCompression && this->SliceSizeInBytes * this->SlabThickness > 0xffffffffULL)
+  {
+    LOG_ERROR("Cannot write volume to " << this->Filename << ", a slab of " << this->SlabThickness << " slices is too large for compression");
+    return PLUS_FAIL;
+  }
+
+  this->File.open(this->Filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!this->File.is_open())
+  {
+    LOG_ERROR("Failed to open file for writing: " << this->Filename);
+    return PLUS_FAIL;
+  }
+
+  PlusStatus status = this->IsMetaImage
+                      ? this->WriteMetaImageHeader(dimensions, spacing, origin, scalarType, numberOfScalarComponents)
+                      : this->WriteNrrdHeader(dimensions, spacing, origin, scalarType, numberOfScalarComponents);
+  if (status != PLUS_SUCCESS)
+  {
+    this->Discard();
+    return PLUS_FAIL;
+  }
+
+  if (this->UseCompression)
+  {
+    this->Compressor.SetNumberOfThreads(this->NumberOfCompressionThreads);
+    this->Compressor.SetCompressionLevel(this->CompressionLevel);
+    this->Compressor.SetBlockSizeBytes(static_cast<unsigned int>(this->SliceSizeInBytes * this->SlabThickness));
+    if (this->Compressor.BeginStream(this->File, this->IsMetaImage ? PlusParallelCompressor::ZLIB_STREAM : PlusParallelCompressor::GZIP_STREAM) != PLUS_SUCCESS)
+    {
+      this->Discard();
+      return PLUS_FAIL;
+    }
+    this->IsCompressedStreamStarted = true;
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusVolumeSlabWriter::WriteMetaImageHeader(const int dimensions[3], const double spacing[3], const double origin[3], int scalarType, int numberOfScalarComponents)
+{
+  std::string metaImageType;
+  std::string nrrdType;
+  if (!GetScalarTypeNames(scalarType, metaImageType, nrrdType))
+  {
+    LOG_ERROR("Cannot write volume to " << this->Filename << ", unsupported scalar type: " << scalarType);
+    return PLUS_FAIL;
+  }
+
+  std::ostringstream header;
+  header << std::setprecision(10);
+  header << "ObjectType = Image\n";
+  header << "NDims = 3\n";
+  header << "BinaryData = True\n";
+#ifdef VTK_WORDS_BIGENDIAN
+  header << "BinaryDataByteOrderMSB = True\n";
+#else
+  header << "BinaryDataByteOrderMSB = False\n";
+#endif
+  header << "CompressedData = " << (this->UseCompression ? "True" : "False") << "\n";
+  this->File << header.str();
+  header.str("");
+  if (this->UseCompression)
+  {
+    // The compressed size is only known when the file is closed, space is reserved for it here
+    this->File << "CompressedDataSize = ";
+    this->CompressedDataSizePosition = this->File.tellp();
+    this->File << std::string(COMPRESSED_DATA_SIZE_FIELD_WIDTH, ' ') << "\n";
+  }
+  header << "TransformMatrix = 1 0 0 0 1 0 0 0 1\n";
+  header << "Offset = " << origin[0] << " " << origin[1] << " " << origin[2] << "\n";
+  header << "CenterOfRotation = 0 0 0\n";
+  // By definition, LPS orientation in DICOM sense = RAI orientation in MetaIO
+  header << "AnatomicalOrientation = RAI\n";
+  header << "ElementSpacing = " << spacing[0] << " " << spacing[1] << " " << spacing[2] << "\n";
+  header << "DimSize = " << dimensions[0] << " " << dimensions[1] << " " << dimensions[2] << "\n";
+  if (numberOfScalarComponents > 1)
+  {
+    header << "ElementNumberOfChannels = " << numberOfScalarComponents << "\n";
+  }
+  header << "ElementType = " << metaImageType << "\n";
+  header << "ElementDataFile = LOCAL\n";
+  this->File << header.str();
+
+  if (!this->File)
+  {
+    LOG_ERROR("Failed to write header of " << this->Filename);
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusVolumeSlabWriter::WriteNrrdHeader(const int dimensions[3], const double spacing[3], const double origin[3], int scalarType, int numberOfScalarComponents)
+{
+  std::string metaImageType;
+  std::string nrrdType;
+  if (!GetScalarTypeNames(scalarType, metaImageType, nrrdType))
+  {
+    LOG_ERROR("Cannot write volume to " << this->Filename << ", unsupported scalar type: " << scalarType);
+    return PLUS_FAIL;
+  }
+
+  bool hasComponentAxis = (numberOfScalarComponents > 1);
+  std::ostringstream header;
+  header << std::setprecision(10);
+  header << "NRRD0004\n";
+  header << "# Complete NRRD file format specification at:\n";
+  header << "# http://teem.sourceforge.net/nrrd/format.html\n";
+  header << "type: " << nrrdType << "\n";
+  header << "dimension: " << (hasComponentAxis ? 4 : 3) << "\n";
+  header << "space: left-posterior-superior\n";
+  header << "sizes: ";
+  if (hasComponentAxis)
+  {
+    header << numberOfScalarComponents << " ";
+  }
+  header << dimensions[0] << " " << dimensions[1] << " " << dimensions[2] << "\n";
+  header << "space directions: " << (hasComponentAxis ? "none " : "")
+         << "(" << spacing[0] << ",0,0) (0," << spacing[1] << ",0) (0,0," << spacing[2] << ")\n";
+  header << "kinds: " << (hasComponentAxis ? "vector " : "") << "domain domain domain\n";
+#ifdef VTK_WORDS_BIGENDIAN
+  header << "endian: big\n";
+#else
+  header << "endian: little\n";
+#endif
+  header << "encoding: " << (this->UseCompression ? "gzip" : "raw") << "\n";
+  header << "space origin: (" << origin[0] << "," << origin[1] << "," << origin[2] << ")\n";
+  // The header is terminated by an empty line, data follows immediately
+  header << "\n";
+  this->File << header.str();
+
+  if (!this->File)
+  {
+    LOG_ERROR("Failed to write header of " << this->Filename);
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusVolumeSlabWriter::WriteSlices(const void* slices, unsigned int numberOfSlices)
+{
+  if (!this->File.is_open())
+  {
+    LOG_ERROR("Cannot write slices, the volume file is not open");
+    return PLUS_FAIL;
+  }
+  if (this->NumberOfWrittenSlices + numberOfSlices > this->NumberOfSlices)
+  {
+    LOG_ERROR("Cannot write " << numberOfSlices << " slices to " << this->Filename << ", the volume has only " << this->NumberOfSlices - this->NumberOfWrittenSlices << " slices left");
+    return PLUS_FAIL;
+  }
+  if (numberOfSlices == 0)
+  {
+    return PLUS_SUCCESS;
+  }
+
+  size_t sizeInBytes = static_cast<size_t>(this->SliceSizeInBytes * numberOfSlices);
+  if (this->UseCompression)
+  {
+    if (this->Compressor.AppendData(static_cast<const unsigned char*>(slices), sizeInBytes) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to compress slices of " << this->Filename);
+      return PLUS_FAIL;
+    }
+  }
+  else
+  {
+    this->File.write(static_cast<const char*>(slices), sizeInBytes);
+  }
+  if (!this->File)
+  {
+    LOG_ERROR("Failed to write slices to " << this->Filename);
+    return PLUS_FAIL;
+  }
+  this->NumberOfWrittenSlices += numberOfSlices;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusVolumeSlabWriter::Close()
+{
+  if (!this->File.is_open())
+  {
+    return PLUS_SUCCESS;
+  }
+  if (this->NumberOfWrittenSlices != this->NumberOfSlices)
+  {
+    LOG_ERROR("Only " << this->NumberOfWrittenSlices << " of " << this->NumberOfSlices << " slices were written to " << this->Filename);
+    this->Discard();
+    return PLUS_FAIL;
+  }
+
+  if (this->IsCompressedStreamStarted)
+  {
+    this->IsCompressedStreamStarted = false;
+    if (this->Compressor.EndStream() != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to compress " << this->Filename);
+      this->Discard();
+      return PLUS_FAIL;
+    }
+    if (this->IsMetaImage)
+    {
+      this->File.seekp(this->CompressedDataSizePosition);
+      this->File << std::left << std::setw(COMPRESSED_DATA_SIZE_FIELD_WIDTH) << this->Compressor.GetNumberOfWrittenBytes();
+    }
+  }
+
+  this->File.close();
+  if (this->File.fail())
+  {
+    LOG_ERROR("Failed to write " << this->Filename);
+    vtksys::SystemTools::RemoveFile(this->Filename);
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void PlusVolumeSlabWriter::Discard()
+{
+  if (this->IsCompressedStreamStarted)
+  {
+    // Wait for the blocks that are being compressed, the incomplete stream is discarded
+    this->IsCompressedStreamStarted = false;
+    this->Compressor.EndStream();
+  }
+  if (this->File.is_open())
+  {
+    this->File.close();
+    vtksys::SystemTools::RemoveFile(this->Filename);
+  }
+  this->File.clear();
+  this->NumberOfWrittenSlices = 0;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusVolumeSlabWriter::WriteVolume(vtkImageData* volume, const std::string& filename, bool useCompression/*=true*/, int component/*=-1*/, int numberOfCompressionThreads/*=0*/, int compressionLevel/*=-1*/)
+{
+  if (volume == NULL || volume->GetScalarPointer() == NULL)
+  {
+    LOG_ERROR("Cannot write volume to " << filename << ": invalid input image");
+    return PLUS_FAIL;
+  }
+  int dimensions[3] = { 0, 0, 0 };
+  volume->GetDimensions(dimensions);
+  double spacing[3] = { 1.0, 1.0, 1.0 };
+  volume->GetSpacing(spacing);
+  double origin[3] = { 0.0, 0.0, 0.0 };
+  volume->GetOrigin(origin);
+  int numberOfScalarComponents = volume->GetNumberOfScalarComponents();
+  if (component >= numberOfScalarComponents)
+  {
+    LOG_ERROR("Cannot write component " << component << " of the volume to " << filename << ", the volume has " << numberOfScalarComponents << " components");
+    return PLUS_FAIL;
+  }
+
+  PlusVolumeSlabWriter writer;
+  writer.SetUseCompression(useCompression);
+  writer.SetNumberOfCompressionThreads(numberOfCompressionThreads);
+  writer.SetCompressionLevel(compressionLevel);
+  if (writer.Open(filename, dimensions, spacing, origin, volume->GetScalarType(), component < 0 ? numberOfScalarComponents : 1) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+
+  const size_t scalarSize = static_cast<size_t>(volume->GetScalarSize());
+  const size_t sliceSizeInVoxels = static_cast<size_t>(dimensions[0]) * dimensions[1];
+  const size_t sliceSizeInBytes = sliceSizeInVoxels * numberOfScalarComponents * scalarSize;
+  const unsigned char* scalars = static_cast<const unsigned char*>(volume->GetScalarPointer());
+  std::vector<unsigned char> slabComponent;
+  for (unsigned int slice = 0; slice < static_cast<unsigned int>(dimensions[2]); slice += writer.GetSlabThickness())
+  {
+    unsigned int numberOfSlabSlices = std::min(writer.GetSlabThickness(), static_cast<unsigned int>(dimensions[2]) - slice);
+    const unsigned char* slab = scalars + slice * sliceSizeInBytes;
+    if (component < 0)
+    {
+      if (writer.WriteSlices(slab, numberOfSlabSlices) != PLUS_SUCCESS)
+      {
+        return PLUS_FAIL;
+      }
+      continue;
+    }
+    // Only the requested component of the slab is copied
+    const size_t numberOfSlabVoxels = sliceSizeInVoxels * numberOfSlabSlices;
+    slabComponent.resize(numberOfSlabVoxels * scalarSize);
+    const unsigned char* voxel = slab + component * scalarSize;
+    for (size_t i = 0; i < numberOfSlabVoxels; ++i, voxel += numberOfScalarComponents * scalarSize)
+    {
+      memcpy(&slabComponent[i * scalarSize], voxel, scalarSize);
+    }
+    if (writer.WriteSlices(&slabComponent[0], numberOfSlabSlices) != PLUS_SUCCESS)
+    {
+      return PLUS_FAIL;
+    }
+  }
+  return writer.Close();
+}
@@ -0,0 +1,94 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusVolumeSlabWriter_h
+#define __PlusVolumeSlabWriter_h
+
+#include "PlusConfigure.h"
+#include "vtkPlusCommonExport.h"
+#include "PlusParallelCompressor.h"
+
+#include <fstream>
+#include <string>
+
+class vtkImageData;
+
+/*!
+  \class PlusVolumeSlabWriter
+  \brief Writes a volume into a MetaImage (.mha) or nrrd (.nrrd) file incrementally, a slab of slices at a time
+
+  The header is written when the file is opened, then the slices are appended by WriteSlices, so the volume does not
+  have to be copied into a single buffer for writing. If compression is enabled then each slab is compressed in a
+  separate block, concurrently (see PlusParallelCompressor). The compressed data is a single zlib (MetaImage) or
+  gzip (nrrd) stream, so the files can be read by any MetaImage or nrrd reader.
+
+  \ingroup PlusLibCommon
+*/
+class vtkPlusCommonExport PlusVolumeSlabWriter
+{
+public:
+  PlusVolumeSlabWriter();
+
+  /*! If the file is not closed then it is discarded */
+  ~PlusVolumeSlabWriter();
+
+  void SetUseCompression(bool useCompression) { this->UseCompression = useCompression; }
+  /*! Number of slabs compressed at the same time, 0 means the number of processor cores */
+  void SetNumberOfCompressionThreads(int numberOfThreads) { this->NumberOfCompressionThreads = numberOfThreads; }
+  void SetCompressionLevel(int compressionLevel) { this->CompressionLevel = compressionLevel; }
+  /*! Number of slices that are compressed in one block */
+  void SetSlabThickness(unsigned int slabThickness) { this->SlabThickness = (slabThickness > 0 ? slabThickness : 1); }
+  unsigned int GetSlabThickness() const { return this->SlabThickness; }
+
+  /*! Create the file and write the header. Settings must be set before opening the file. */
+  PlusStatus Open(const std::string& filename, const int dimensions[3], const double spacing[3], const double origin[3], int scalarType, int numberOfScalarComponents);
+
+  /*! Append the next slices of the volume. Voxels are stored in x, y, z order, with the scalar components of each voxel next to each other. */
+  PlusStatus WriteSlices(const void* slices, unsigned int numberOfSlices);
+
+  /*! Complete the file. Fails if not all slices of the volume were written. */
+  PlusStatus Close();
+
+  /*! Discard the file without completing it */
+  void Discard();
+
+  unsigned int GetNumberOfWrittenSlices() const { return this->NumberOfWrittenSlices; }
+
+  /*! Name of the written file, with full path */
+  const std::string& GetFilename() const { return this->Filename; }
+
+  /*!
+    Write a volume slab by slab. If component is not negative then only that scalar component is written,
+    so for example the gray levels can be saved from a volume that also contains the alpha channel, without extracting them first.
+  */
+  static PlusStatus WriteVolume(vtkImageData* volume, const std::string& filename, bool useCompression = true, int component = -1, int numberOfCompressionThreads = 0, int compressionLevel = -1);
+
+protected:
+  PlusStatus WriteMetaImageHeader(const int dimensions[3], const double spacing[3], const double origin[3], int scalarType, int numberOfScalarComponents);
+  PlusStatus WriteNrrdHeader(const int dimensions[3], const double spacing[3], const double origin[3], int scalarType, int numberOfScalarComponents);
+
+  bool UseCompression;
+  int NumberOfCompressionThreads;
+  int CompressionLevel;
+  unsigned int SlabThickness;
+
+  std::string Filename;
+  std::ofstream File;
+  bool IsMetaImage;
+  PlusParallelCompressor Compressor;
+  bool IsCompressedStreamStarted;
+  /*! Position of the CompressedDataSize value in the MetaImage header, it is written when the file is closed */
+  std::streampos CompressedDataSizePosition;
+  unsigned long long SliceSizeInBytes;
+  unsigned int NumberOfSlices;
+  unsigned int NumberOfWrittenSlices;
+
+private:
+  PlusVolumeSlabWriter(const PlusVolumeSlabWriter&);
+  void operator=(const PlusVolumeSlabWriter&);
+};
+
+#endif
@@ -0,0 +1,217 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "PlusProfiler.h"
+#include "PlusThreadScheduling.h"
+#include "PlusWorkerPool.h"
+
+// STL includes
+#include <algorithm>
+
+namespace
+{
+  // Pool and queue of the worker thread that runs the current thread, used for adding tasks to the own queue
+  thread_local const PlusWorkerPool* CurrentPool = NULL;
+  thread_local int CurrentQueueIndex = -1;
+}
+
+//----------------------------------------------------------------------------
+PlusWorkerPool::PlusWorkerPool(int numberOfThreads, const std::vector<int>& cpuAffinity)
+  : NextQueueIndex(0)
+  , NumberOfQueuedTasks(0)
+  , Stopping(false)
+{
+  if (numberOfThreads < 1)
+  {
+    numberOfThreads = (std::max)(1u, std::thread::hardware_concurrency());
+  }
+  for (int i = 0; i < numberOfThreads; i++)
+  {
+    this->Queues.push_back(std::unique_ptr<TaskQueue>(new TaskQueue));
+  }
+  for (int i = 0; i < numberOfThreads; i++)
+  {
+    int cpuIndex = cpuAffinity.empty() ? -1 : cpuAffinity[i % cpuAffinity.size()];
+    this->Workers.push_back(std::thread(&PlusWorkerPool::WorkerThreadMain, this, i, cpuIndex));
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusWorkerPool::~PlusWorkerPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->WakeMutex);
+    this->Stopping = true;
+  }
+  this->WakeCondition.notify_all();
+  for (std::vector<std::thread>::iterator worker = this->Workers.begin(); worker != this->Workers.end(); ++worker)
+  {
+    worker->join();
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusWorkerPool& PlusWorkerPool::GetInstance()
+{
+  vtkPlusConfig* config = vtkPlusConfig::GetInstance();
+  static PlusWorkerPool instance(config->GetWorkerThreads(), config->GetWorkerThreadAffinity());
+  return instance;
+}
+
+//----------------------------------------------------------------------------
+int PlusWorkerPool::GetNumberOfThreads() const
+{
+  return static_cast<int>(this->Workers.size());
+}
+
+//----------------------------------------------------------------------------
+void PlusWorkerPool::ParallelFor(int begin, int end, int numberOfTasks, const std::function<void(int, int)>& body)
+{
+  const int count = end - begin;
+  if (count <= 0)
+  {
+    return;
+  }
+  if (numberOfTasks < 1)
+  {
+    numberOfTasks = this->GetNumberOfThreads() + 1;
+  }
+  numberOfTasks = (std::min)(numberOfTasks, count);
+
+  std::vector<std::future<void> > results;
+  for (int i = 1; i < numberOfTasks; i++)
+  {
+    const int first = begin + static_cast<int>(static_cast<long long>(count) * i / numberOfTasks);
+    const int last = begin + static_cast<int>(static_cast<long long>(count) * (i + 1) / numberOfTasks);
+    results.push_back(this->Submit([&body, first, last]() { body(first, last); }));
+  }
+
+  try
+  {
+    body(begin, begin + count / numberOfTasks);
+  }
+  catch (...)
+  {
+    // The tasks refer to body, so they must complete before returning
+    for (std::vector<std::future<void> >::iterator result = results.begin(); result != results.end(); ++result)
+    {
+      this->Wait(*result);
+    }
+    throw;
+  }
+  for (std::vector<std::future<void> >::iterator result = results.begin(); result != results.end(); ++result)
+  {
+    this->Wait(*result);
+  }
+  // Forward exceptions of the tasks
+  for (std::vector<std::future<void> >::iterator result = results.begin(); result != results.end(); ++result)
+  {
+    result->get();
+  }
+}
+
+//----------------------------------------------------------------------------
+void PlusWorkerPool::QueueTask(const Task& task)
+{
+  unsigned int queueIndex = 0;
+  if (CurrentPool == this)
+  {
+    queueIndex = static_cast<unsigned int>(CurrentQueueIndex);
+  }
+  else
+  {
+    queueIndex = this->NextQueueIndex++ % this->Queues.size();
+  }
+  {
+    std::lock_guard<std::mutex> lock(this->Queues[queueIndex]->Mutex);
+    this->Queues[queueIndex]->Tasks.push_back(task);
+  }
+  {
+    std::lock_guard<std::mutex> lock(this->WakeMutex);
+    ++this->NumberOfQueuedTasks;
+  }
+  this->WakeCondition.notify_one();
+}
+
+//----------------------------------------------------------------------------
+bool PlusWorkerPool::TakeTask(int queueIndex, Task& task)
+{
+  const int numberOfQueues = static_cast<int>(this->Queues.size());
+  if (queueIndex >= 0)
+  {
+    // The most recently added task of the own queue, its data is most likely still in the cache
+    TaskQueue& queue = *this->Queues[queueIndex];
+    std::lock_guard<std::mutex> lock(queue.Mutex);
+    if (!queue.Tasks.empty())
+    {
+      task = queue.Tasks.back();
+      queue.Tasks.pop_back();
+      --this->NumberOfQueuedTasks;
+      return true;
+    }
+  }
+  // Steal the oldest task of another queue
+  for (int i = 1; i <= numberOfQueues; i++)
+  {
+    TaskQueue& queue = *this->Queues[((std::max)(queueIndex, 0) + i) % numberOfQueues];
+    std::lock_guard<std::mutex> lock(queue.Mutex);
+    if (!queue.Tasks.empty())
+    {
+      task = queue.Tasks.front();
+      queue.Tasks.pop_front();
+      --this->NumberOfQueuedTasks;
+      return true;
+    }
+  }
+  return false;
+}
+
+//----------------------------------------------------------------------------
+bool PlusWorkerPool::RunQueuedTask()
+{
+  Task task;
+  if (!this->TakeTask(CurrentPool == this ? CurrentQueueIndex : -1, task))
+  {
+    return false;
+  }
+  task();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void PlusWorkerPool::WorkerThreadMain(int workerIndex, int cpuIndex)
+{
+  CurrentPool = this;
+  CurrentQueueIndex = workerIndex;
+  PLUS_PROFILE_THREAD_NAME("Plus worker");
+  if (cpuIndex >= 0)
+  {
+    SetCurrentThreadAffinity(cpuIndex);
+  }
+
+  while (true)
+  {
+    Task task;
+    if (this->TakeTask(workerIndex, task))
+    {
+      task();
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(this->WakeMutex);
+    this->WakeCondition.wait(lock, [this]() { return this->Stopping || this->NumberOfQueuedTasks > 0; });
+    if (this->Stopping && this->NumberOfQueuedTasks <= 0)
+    {
+      return;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+void PlusWorkerPool::SetCurrentThreadAffinity(int cpuIndex)
+{
+  PlusThreadScheduling::SetCurrentThreadAffinity(std::vector<int>(1, cpuIndex));
+}
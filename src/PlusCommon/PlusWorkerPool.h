@@ -0,0 +1,131 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusWorkerPool_h
+#define __PlusWorkerPool_h
+
+#include "PlusConfigure.h"
+#include "vtkPlusCommonExport.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*!
+  \class PlusWorkerPool
+  \brief Pool of worker threads that run tasks submitted by algorithms and devices
+
+  Algorithms and devices submit their parallel work to the process-wide pool (GetInstance) instead of starting their
+  own threads, so the number of busy threads does not grow with the number of devices and processing algorithms.
+  The size of the process-wide pool and the processor cores that its threads are bound to are set by the WorkerThreads
+  and WorkerThreadAffinity attributes of the application configuration (see vtkPlusConfig).
+
+  Each worker thread has its own task queue. Tasks submitted from a worker thread are added to the queue of that
+  thread, other tasks are distributed between the queues. Idle workers take tasks from the queues of other workers.
+
+  A thread that waits for a task (Wait, ParallelFor) runs queued tasks in the meantime, therefore tasks may submit
+  and wait for other tasks without blocking the pool.
+
+  \ingroup PlusLibCommon
+*/
+class vtkPlusCommonExport PlusWorkerPool
+{
+public:
+  /*!
+    Create a pool
+    \param numberOfThreads Number of worker threads, 0 means the number of processor cores
+    \param cpuAffinity Processor cores that the worker threads are bound to, in the order of the threads (repeated if there are more threads). If empty then the threads are not bound.
+  */
+  explicit PlusWorkerPool(int numberOfThreads = 0, const std::vector<int>& cpuAffinity = std::vector<int>());
+
+  /*! Runs the remaining tasks then stops the worker threads */
+  ~PlusWorkerPool();
+
+  /*!
+    Pool shared by the whole process. It is created when it is first used, with the settings of the
+    application configuration at that time.
+  */
+  static PlusWorkerPool& GetInstance();
+
+  int GetNumberOfThreads() const;
+
+  /*! Queue a function to be run by a worker thread. The returned future provides the result of the function. */
+  template<typename Function>
+  std::future<typename std::result_of<Function()>::type> Submit(Function function)
+  {
+    typedef typename std::result_of<Function()>::type ResultType;
+    std::shared_ptr<std::packaged_task<ResultType()> > task = std::make_shared<std::packaged_task<ResultType()> >(function);
+    std::future<ResultType> result = task->get_future();
+    this->QueueTask([task]() { (*task)(); });
+    return result;
+  }
+
+  /*! Wait until the result of a submitted function is available. Queued tasks are run on the calling thread while waiting. */
+  template<typename ResultType>
+  void Wait(std::future<ResultType>& result)
+  {
+    while (result.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+    {
+      if (!this->RunQueuedTask())
+      {
+        // All queued tasks are taken, the result is being computed by another thread
+        result.wait();
+      }
+    }
+  }
+
+  /*!
+    Split the [begin, end) range into numberOfTasks parts and call body(first, last) for each part in parallel.
+    The first part is processed on the calling thread. Returns when all parts are processed.
+    \param numberOfTasks Number of parts, 0 means one part for each worker thread and one for the calling thread
+  */
+  void ParallelFor(int begin, int end, int numberOfTasks, const std::function<void(int, int)>& body);
+
+protected:
+  typedef std::function<void()> Task;
+
+  struct TaskQueue
+  {
+    std::mutex Mutex;
+    std::deque<Task> Tasks;
+  };
+
+  void QueueTask(const Task& task);
+
+  /*! Take a task from the given queue (from the back) or from any other queue (from the front), returns false if there are no tasks */
+  bool TakeTask(int queueIndex, Task& task);
+
+  /*! Run a queued task on the calling thread, returns false if there are no queued tasks */
+  bool RunQueuedTask();
+
+  void WorkerThreadMain(int workerIndex, int cpuIndex);
+
+  /*! Bind the calling thread to a processor core */
+  static void SetCurrentThreadAffinity(int cpuIndex);
+
+  std::vector<std::unique_ptr<TaskQueue> > Queues;
+  std::vector<std::thread> Workers;
+  /*! Queue of the next task that is not submitted from a worker thread */
+  std::atomic<unsigned int> NextQueueIndex;
+
+  /*! Number of tasks in all queues, guarded by WakeMutex when it is increased so that no wake-up is lost */
+  std::atomic<int> NumberOfQueuedTasks;
+  std::mutex WakeMutex;
+  std::condition_variable WakeCondition;
+  bool Stopping;
+
+private:
+  PlusWorkerPool(const PlusWorkerPool&);
+  void operator=(const PlusWorkerPool&);
+};
+
+#endif
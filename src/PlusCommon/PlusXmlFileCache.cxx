@@ -0,0 +1,105 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "PlusXmlFileCache.h"
+
+// VTK includes
+#include <vtkXMLDataElement.h>
+#include <vtkXMLUtilities.h>
+#include <vtksys/SystemTools.hxx>
+
+// STL includes
+#include <fstream>
+#include <functional>
+#include <iterator>
+
+namespace
+{
+  // The cache is cleared when it contains more files, so that it does not grow unbounded if many different files are read
+  const unsigned int MAX_NUMBER_OF_CACHED_FILES = 512;
+}
+
+//----------------------------------------------------------------------------
+PlusXmlFileCache::PlusXmlFileCache()
+{
+}
+
+//----------------------------------------------------------------------------
+PlusXmlFileCache& PlusXmlFileCache::GetInstance()
+{
+  static PlusXmlFileCache instance;
+  return instance;
+}
+
+//----------------------------------------------------------------------------
+vtkSmartPointer<vtkXMLDataElement> PlusXmlFileCache::ReadElementFromFile(const std::string& filePath)
+{
+  std::ifstream file(filePath.c_str(), std::ios::in | std::ios::binary);
+  if (!file.is_open())
+  {
+    LOG_ERROR("Failed to open XML file for reading: " << filePath);
+    return NULL;
+  }
+  std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  file.close();
+
+  const std::string fullPath = vtksys::SystemTools::CollapseFullPath(filePath);
+  const std::size_t contentHash = std::hash<std::string>()(content);
+
+  vtkSmartPointer<vtkXMLDataElement> rootElement;
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    std::map<std::string, CachedFile>::iterator cachedFileIt = this->Files.find(fullPath);
+    if (cachedFileIt != this->Files.end() && cachedFileIt->second.ContentHash == contentHash && cachedFileIt->second.ContentSize == content.size())
+    {
+      LOG_TRACE("XML file is not changed since it was parsed: " << fullPath);
+      rootElement = vtkSmartPointer<vtkXMLDataElement>::New();
+      rootElement->DeepCopy(cachedFileIt->second.RootElement);
+      return rootElement;
+    }
+  }
+
+  // Parse outside the lock, so that other files can be read meanwhile
+  vtkSmartPointer<vtkXMLDataElement> parsedElement = vtkSmartPointer<vtkXMLDataElement>::Take(vtkXMLUtilities::ReadElementFromString(content.c_str()));
+  if (parsedElement == NULL)
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    this->Files.erase(fullPath);
+    return NULL;
+  }
+
+  CachedFile cachedFile;
+  cachedFile.ContentHash = contentHash;
+  cachedFile.ContentSize = content.size();
+  cachedFile.RootElement = parsedElement;
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    if (this->Files.size() >= MAX_NUMBER_OF_CACHED_FILES && this->Files.find(fullPath) == this->Files.end())
+    {
+      this->Files.clear();
+    }
+    this->Files[fullPath] = cachedFile;
+  }
+
+  rootElement = vtkSmartPointer<vtkXMLDataElement>::New();
+  rootElement->DeepCopy(parsedElement);
+  return rootElement;
+}
+
+//----------------------------------------------------------------------------
+void PlusXmlFileCache::Clear()
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  this->Files.clear();
+}
+
+//----------------------------------------------------------------------------
+unsigned int PlusXmlFileCache::GetNumberOfCachedFiles()
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  return static_cast<unsigned int>(this->Files.size());
+}
@@ -0,0 +1,68 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusXmlFileCache_h
+#define __PlusXmlFileCache_h
+
+#include "PlusConfigure.h"
+#include "vtkPlusCommonExport.h"
+
+#include <vtkSmartPointer.h>
+
+#include <map>
+#include <mutex>
+#include <string>
+
+class vtkXMLDataElement;
+
+/*!
+  \class PlusXmlFileCache
+  \brief Keeps the parsed XML trees of configuration files, so that a file is parsed only once while its content does not change
+
+  Applications read the same device set configuration files repeatedly: the device set selector reads all the files of the
+  configuration directory each time the list is refreshed, and the selected file is read again when connecting.
+  The cache stores the parsed tree of each file with the hash of the file content. When the file is read again then only
+  the content is read and hashed, and if it has not changed then a copy of the stored tree is returned instead of parsing it.
+
+  The returned elements are always copies, so they can be modified by the caller without affecting the cache.
+
+  \ingroup PlusLibCommon
+*/
+class vtkPlusCommonExport PlusXmlFileCache
+{
+public:
+  /*! Cache shared by the whole process */
+  static PlusXmlFileCache& GetInstance();
+
+  /*! Read the root element of an XML file. Returns NULL if the file cannot be read or parsed. */
+  vtkSmartPointer<vtkXMLDataElement> ReadElementFromFile(const std::string& filePath);
+
+  /*! Remove all the parsed files from the cache */
+  void Clear();
+
+  /*! Number of files in the cache */
+  unsigned int GetNumberOfCachedFiles();
+
+protected:
+  PlusXmlFileCache();
+
+  struct CachedFile
+  {
+    std::size_t ContentHash;
+    std::size_t ContentSize;
+    vtkSmartPointer<vtkXMLDataElement> RootElement;
+  };
+
+  std::mutex Mutex;
+  /*! Parsed files, by full path */
+  std::map<std::string, CachedFile> Files;
+
+private:
+  PlusXmlFileCache(const PlusXmlFileCache&);
+  void operator=(const PlusXmlFileCache&);
+};
+
+#endif
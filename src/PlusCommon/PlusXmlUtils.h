@@ -8,6 +8,7 @@
 #define __PlusXmlUtils_h
 
 #include <igsioXmlUtils.h>
+#include "PlusXmlFileCache.h"
 #include "vtkXMLUtilities.h"
 
 /*!
@@ -44,7 +45,7 @@ public:
       }
     }
 
-    vtkSmartPointer<vtkXMLDataElement> rootElement = vtkSmartPointer<vtkXMLDataElement>::Take(vtkXMLUtilities::ReadElementFromFile(filePath.c_str()));
+    vtkSmartPointer<vtkXMLDataElement> rootElement = PlusXmlFileCache::GetInstance().ReadElementFromFile(filePath);
     if (rootElement == NULL)
     {
       LOG_ERROR("Reading device set configuration file failed: syntax error in " << filename);
@@ -0,0 +1,136 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file AsynchronousLoggingTest.cxx
+  \brief Checks that messages of asynchronous logging are written in order with the time and thread of the LOG_* call.
+
+  Messages are logged with asynchronous logging enabled and a delay between them, then they are written by a flush.
+  The written lines are captured from the console output and the time of each message is compared to the time range of
+  its LOG_* call.
+*/
+
+#include "PlusConfigure.h"
+
+// VTK includes
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <chrono>
+#include <cstdlib>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace
+{
+  const int NUMBER_OF_MESSAGES = 5;
+  const char QUEUED_PREFIX[] = "[queued ";
+  const char THREAD_PREFIX[] = " thread ";
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+  // The test messages are logged at info level
+  if (verboseLevel < vtkPlusLogger::LOG_LEVEL_INFO)
+  {
+    verboseLevel = vtkPlusLogger::LOG_LEVEL_INFO;
+  }
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  std::ostringstream threadId;
+  threadId << std::this_thread::get_id();
+
+  // Capture the console output of the logger
+  std::ostringstream output;
+  std::streambuf* coutBuffer = std::cout.rdbuf(output.rdbuf());
+  std::streambuf* cerrBuffer = std::cerr.rdbuf(output.rdbuf());
+
+  std::vector<double> callStartTimes;
+  std::vector<double> callEndTimes;
+  vtkPlusLogger::SetAsynchronousLogging(true);
+  for (int i = 0; i < NUMBER_OF_MESSAGES; ++i)
+  {
+    callStartTimes.push_back(vtkIGSIOAccurateTimer::GetSystemTime());
+    LOG_INFO("Asynchronous test message " << i);
+    callEndTimes.push_back(vtkIGSIOAccurateTimer::GetSystemTime());
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+  }
+  vtkPlusLogger::FlushQueuedMessages();
+  vtkPlusLogger::SetAsynchronousLogging(false);
+
+  std::cout.rdbuf(coutBuffer);
+  std::cerr.rdbuf(cerrBuffer);
+
+  const std::string text = output.str();
+  int numberOfErrors = 0;
+  size_t previousPosition = 0;
+  for (int i = 0; i < NUMBER_OF_MESSAGES; ++i)
+  {
+    std::ostringstream message;
+    message << "] Asynchronous test message " << i;
+    const size_t messagePosition = text.find(message.str());
+    const size_t lineStart = (messagePosition == std::string::npos ? std::string::npos : text.rfind('\n', messagePosition) + 1);
+    const size_t prefixPosition = (lineStart == std::string::npos ? std::string::npos : text.find(QUEUED_PREFIX, lineStart));
+    if (prefixPosition == std::string::npos || prefixPosition > messagePosition)
+    {
+      LOG_ERROR("Message " << i << " is not written with the time of the LOG_* call");
+      numberOfErrors++;
+      continue;
+    }
+    if (messagePosition < previousPosition)
+    {
+      LOG_ERROR("Message " << i << " is written before the previous message");
+      numberOfErrors++;
+    }
+    previousPosition = messagePosition;
+
+    std::istringstream prefix(text.substr(prefixPosition + sizeof(QUEUED_PREFIX) - 1, messagePosition - prefixPosition - sizeof(QUEUED_PREFIX) + 1));
+    double time = 0;
+    prefix >> time;
+    const std::string threadText = (prefix.fail() ? std::string() : prefix.str().substr(static_cast<size_t>(prefix.tellg())));
+    // The time is written in microseconds precision
+    if (prefix.fail() || time < callStartTimes[i] - 1e-6 || time > callEndTimes[i] + 1e-6)
+    {
+      LOG_ERROR("Message " << i << " is written with time " << time << ", expected a time between "
+                << callStartTimes[i] << " and " << callEndTimes[i]);
+      numberOfErrors++;
+    }
+    if (threadText != THREAD_PREFIX + threadId.str())
+    {
+      LOG_ERROR("Message " << i << " is written with thread \'" << threadText << "\', expected \'" << THREAD_PREFIX + threadId.str() << "\'");
+      numberOfErrors++;
+    }
+  }
+
+  if (numberOfErrors > 0)
+  {
+    std::cout << "Captured log output:" << std::endl << text << std::endl;
+    return EXIT_FAILURE;
+  }
+  LOG_INFO("Asynchronous logging test passed");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,300 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file PixelCodecTest.cxx
+  \brief Checks that the vectorized and multi-threaded PixelCodec conversions give the same result as the scalar
+  reference implementations, checks the decoding of MJPEG frames and measures the conversion time of full HD frames
+*/
+
+#include "PlusConfigure.h"
+#include "PixelCodec.h"
+#include "PlusMjpegDecoder.h"
+
+// IGSIO includes
+#include <vtkIGSIOAccurateTimer.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkJPEGWriter.h>
+#include <vtkSmartPointer.h>
+#include <vtkUnsignedCharArray.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  void FillRandom(std::vector<unsigned char>& buffer)
+  {
+    srand(1234);
+    for (size_t i = 0; i < buffer.size(); i++)
+    {
+      buffer[i] = static_cast<unsigned char>(rand() % 256);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  bool CheckEqual(const std::vector<unsigned char>& actual, const std::vector<unsigned char>& expected, const std::string& conversionName)
+  {
+    for (size_t i = 0; i < expected.size(); i++)
+    {
+      if (actual[i] != expected[i])
+      {
+        LOG_ERROR(conversionName << " result differs from the reference at byte " << i << ": " << int(actual[i]) << " (expected " << int(expected[i]) << ")");
+        return false;
+      }
+    }
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Encode a smooth color image to JPEG, decode it by PlusMjpegDecoder and compare the result to the original image */
+  bool CheckMjpeg(int width, int height, int numberOfThreads)
+  {
+    vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
+    image->SetDimensions(width, height, 1);
+    image->AllocateScalars(VTK_UNSIGNED_CHAR, 3);
+    for (int y = 0; y < height; y++)
+    {
+      for (int x = 0; x < width; x++)
+      {
+        unsigned char* pixel = static_cast<unsigned char*>(image->GetScalarPointer(x, y, 0));
+        pixel[0] = static_cast<unsigned char>(255 * x / width);
+        pixel[1] = static_cast<unsigned char>(255 * y / height);
+        pixel[2] = 128;
+      }
+    }
+
+    vtkSmartPointer<vtkJPEGWriter> writer = vtkSmartPointer<vtkJPEGWriter>::New();
+    writer->SetInputData(image);
+    writer->SetQuality(100);
+    writer->WriteToMemoryOn();
+    writer->Write();
+    vtkUnsignedCharArray* jpeg = writer->GetResult();
+
+    PlusMjpegDecoder decoder;
+    std::vector<unsigned char> rgb(3 * width * height, 0);
+    std::vector<unsigned char> bgr(3 * width * height, 0);
+    std::vector<unsigned char> gray(width * height, 0);
+    if (decoder.DecodeToBmp24(PixelCodec::ComponentOrder_RGB, width, height, jpeg->GetPointer(0), jpeg->GetNumberOfTuples(), &rgb[0], numberOfThreads) != PLUS_SUCCESS
+        || decoder.DecodeToBmp24(PixelCodec::ComponentOrder_BGR, width, height, jpeg->GetPointer(0), jpeg->GetNumberOfTuples(), &bgr[0]) != PLUS_SUCCESS
+        || decoder.DecodeToGray(width, height, jpeg->GetPointer(0), jpeg->GetNumberOfTuples(), &gray[0], numberOfThreads) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to decode MJPEG frame");
+      return false;
+    }
+
+    // The decoded frame is stored with the top row first, the VTK image with the bottom row first
+    const int maximumDifference = 8;
+    for (int row = 0; row < height; row++)
+    {
+      for (int x = 0; x < width; x++)
+      {
+        const unsigned char* expected = static_cast<unsigned char*>(image->GetScalarPointer(x, height - 1 - row, 0));
+        const unsigned char* actual = &rgb[3 * (row * width + x)];
+        const unsigned char* actualBgr = &bgr[3 * (row * width + x)];
+        for (int c = 0; c < 3; c++)
+        {
+          if (abs(int(actual[c]) - int(expected[c])) > maximumDifference || actualBgr[2 - c] != actual[c])
+          {
+            LOG_ERROR("Decoded MJPEG frame differs from the original image at pixel (" << x << ", " << row << ") component " << c << ": "
+                      << int(actual[c]) << " (expected " << int(expected[c]) << ")");
+            return false;
+          }
+        }
+        if (abs(int(gray[row * width + x]) - (int(expected[0]) + expected[1] + expected[2]) / 3) > maximumDifference)
+        {
+          LOG_ERROR("Decoded grayscale MJPEG frame differs from the original image at pixel (" << x << ", " << row << ")");
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Compare all YUY2 conversions in a frame to the reference implementations */
+  bool CheckYuv422p(int width, int height, std::vector<unsigned char>& yuy2, const std::string& frameName)
+  {
+    // The output buffers are larger than the image, to detect writing out of the image
+    std::vector<unsigned char> gray(width * height + 16, 0);
+    std::vector<unsigned char> grayReference(width * height + 16, 0);
+    PixelCodec::Yuv422pToGray(width, height, &yuy2[0], &gray[0]);
+    PixelCodec::Yuv422pToGrayScalar(width, height, &yuy2[0], &grayReference[0]);
+    bool equal = CheckEqual(gray, grayReference, "Yuv422pToGray of " + frameName);
+
+    PixelCodec::ComponentOrdering orderings[2] = { PixelCodec::ComponentOrder_RGB, PixelCodec::ComponentOrder_BGR };
+    for (int i = 0; i < 2; i++)
+    {
+      std::vector<unsigned char> rgb(3 * width * height + 16, 0);
+      std::vector<unsigned char> rgbReference(3 * width * height + 16, 0);
+      PixelCodec::Yuv422pToBmp24(orderings[i], width, height, &yuy2[0], &rgb[0]);
+      PixelCodec::Yuv422pToBmp24Scalar(orderings[i], width, height, &yuy2[0], &rgbReference[0]);
+      equal &= CheckEqual(rgb, rgbReference, std::string("Yuv422pToBmp24 ") + (i == 0 ? "RGB" : "BGR") + " of " + frameName);
+    }
+    return equal;
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Compare multi-threaded conversions of a frame to the single-threaded conversions */
+  bool CheckParallel(PixelCodec::PixelEncoding encoding, int width, int height, int inputBytesPerPixel, int numberOfThreads)
+  {
+    std::vector<unsigned char> input(inputBytesPerPixel * width * height);
+    FillRandom(input);
+    const std::string frameName = PixelCodec::GetCompressionModeAsString(encoding) + " image";
+
+    std::vector<unsigned char> gray(width * height, 0);
+    std::vector<unsigned char> grayReference(width * height, 0);
+    bool equal = PixelCodec::ConvertToGray(encoding, width, height, &input[0], &gray[0], numberOfThreads) == PLUS_SUCCESS;
+    equal &= PixelCodec::ConvertToGray(encoding, width, height, &input[0], &grayReference[0]) == PLUS_SUCCESS;
+    equal &= CheckEqual(gray, grayReference, "Multi-threaded ConvertToGray of " + frameName);
+
+    std::vector<unsigned char> rgb(3 * width * height, 0);
+    std::vector<unsigned char> rgbReference(3 * width * height, 0);
+    equal &= PixelCodec::ConvertToBmp24(PixelCodec::ComponentOrder_BGR, encoding, width, height, &input[0], &rgb[0], numberOfThreads) == PLUS_SUCCESS;
+    equal &= PixelCodec::ConvertToBmp24(PixelCodec::ComponentOrder_BGR, encoding, width, height, &input[0], &rgbReference[0]) == PLUS_SUCCESS;
+    equal &= CheckEqual(rgb, rgbReference, "Multi-threaded ConvertToBmp24 of " + frameName);
+    return equal;
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Time of one conversion in milliseconds, averaged over the repetitions */
+  template<typename Conversion>
+  double MeasureConversionTimeMs(int numberOfRepetitions, Conversion conversion)
+  {
+    const double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+    for (int i = 0; i < numberOfRepetitions; i++)
+    {
+      conversion();
+    }
+    return (vtkIGSIOAccurateTimer::GetSystemTime() - startTime) * 1000.0 / numberOfRepetitions;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp = false;
+  int numberOfRepetitions = 20;
+  int numberOfThreads = 4;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help");
+  args.AddArgument("--repetitions", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfRepetitions, "Number of conversions of a full HD frame for measuring the conversion time (default: 20, 0 = no measurement)");
+  args.AddArgument("--threads", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfThreads, "Number of threads for testing multi-threaded conversions (default: 4, 0 = all threads of the shared worker pool)");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  bool success = true;
+
+  // Every Y value with every U, V pair
+  {
+    const int width = 2 * 256;
+    const int height = 256;
+    std::vector<unsigned char> yuy2(2 * width * height);
+    for (int u = 0; u < 256 && success; u++)
+    {
+      for (int v = 0; v < 256; v++)
+      {
+        for (int y = 0; y < 256; y++)
+        {
+          unsigned char* macropixel = &yuy2[4 * (v * 256 + y)];
+          macropixel[0] = y;
+          macropixel[1] = u;
+          macropixel[2] = 255 - y;
+          macropixel[3] = v;
+        }
+      }
+      success &= CheckYuv422p(width, height, yuy2, "all YUV values");
+    }
+  }
+
+  // Odd image sizes, the last pixels are converted by the scalar implementation
+  const int sizes[3][2] = { { 7, 3 }, { 641, 5 }, { 1, 1 } };
+  for (int i = 0; i < 3; i++)
+  {
+    const int width = sizes[i][0];
+    const int height = sizes[i][1];
+    std::vector<unsigned char> yuy2(2 * width * height);
+    FillRandom(yuy2);
+    success &= CheckYuv422p(width, height, yuy2, "random image");
+
+    std::vector<unsigned char> rgba(4 * width * height);
+    FillRandom(rgba);
+    std::vector<unsigned char> gray(width * height + 16, 0);
+    std::vector<unsigned char> grayReference(width * height + 16, 0);
+    PixelCodec::Rgba32ToGray(width, height, &rgba[0], &gray[0]);
+    PixelCodec::Rgba32ToGrayScalar(width, height, &rgba[0], &grayReference[0]);
+    success &= CheckEqual(gray, grayReference, "Rgba32ToGray of random image");
+  }
+
+  // Odd widths and a height that is not divisible by the number of threads
+  success &= CheckParallel(PixelCodec::PixelEncoding_YUY2, 1921, 1081, 2, numberOfThreads);
+  success &= CheckParallel(PixelCodec::PixelEncoding_RGB24, 641, 479, 3, numberOfThreads);
+  success &= CheckParallel(PixelCodec::PixelEncoding_RGBA32, 641, 479, 4, numberOfThreads);
+
+  success &= CheckMjpeg(640, 480, numberOfThreads);
+
+  if (!success)
+  {
+    LOG_ERROR("Vectorized, multi-threaded or MJPEG conversions do not match the reference implementation");
+    return EXIT_FAILURE;
+  }
+  LOG_INFO("Vectorized and multi-threaded conversions match the reference implementation");
+
+  if (numberOfRepetitions > 0)
+  {
+    const int width = 1920;
+    const int height = 1080;
+    std::vector<unsigned char> yuy2(2 * width * height);
+    FillRandom(yuy2);
+    std::vector<unsigned char> rgba(4 * width * height);
+    FillRandom(rgba);
+    std::vector<unsigned char> gray(width * height);
+    std::vector<unsigned char> rgb(3 * width * height);
+    unsigned char* yuy2Data = &yuy2[0];
+    unsigned char* rgbaData = &rgba[0];
+    unsigned char* grayData = &gray[0];
+    unsigned char* rgbData = &rgb[0];
+
+    LOG_INFO("Conversion time of a " << width << "x" << height << " frame (vectorized / reference):");
+    LOG_INFO("  YUY2 to gray: "
+             << MeasureConversionTimeMs(numberOfRepetitions, [ = ]() { PixelCodec::Yuv422pToGray(width, height, yuy2Data, grayData); }) << "ms / "
+             << MeasureConversionTimeMs(numberOfRepetitions, [ = ]() { PixelCodec::Yuv422pToGrayScalar(width, height, yuy2Data, grayData); }) << "ms");
+    LOG_INFO("  YUY2 to RGB24: "
+             << MeasureConversionTimeMs(numberOfRepetitions, [ = ]() { PixelCodec::Yuv422pToBmp24(PixelCodec::ComponentOrder_RGB, width, height, yuy2Data, rgbData); }) << "ms / "
+             << MeasureConversionTimeMs(numberOfRepetitions, [ = ]() { PixelCodec::Yuv422pToBmp24Scalar(PixelCodec::ComponentOrder_RGB, width, height, yuy2Data, rgbData); }) << "ms");
+    LOG_INFO("  RGBA32 to gray: "
+             << MeasureConversionTimeMs(numberOfRepetitions, [ = ]() { PixelCodec::Rgba32ToGray(width, height, rgbaData, grayData); }) << "ms / "
+             << MeasureConversionTimeMs(numberOfRepetitions, [ = ]() { PixelCodec::Rgba32ToGrayScalar(width, height, rgbaData, grayData); }) << "ms");
+    LOG_INFO("Conversion time of a " << width << "x" << height << " frame with " << numberOfThreads << " threads:");
+    LOG_INFO("  YUY2 to gray: "
+             << MeasureConversionTimeMs(numberOfRepetitions, [ = ]() { PixelCodec::ConvertToGray(PixelCodec::PixelEncoding_YUY2, width, height, yuy2Data, grayData, numberOfThreads); }) << "ms");
+    LOG_INFO("  YUY2 to RGB24: "
+             << MeasureConversionTimeMs(numberOfRepetitions, [ = ]() { PixelCodec::ConvertToBmp24(PixelCodec::ComponentOrder_RGB, PixelCodec::PixelEncoding_YUY2, width, height, yuy2Data, rgbData, numberOfThreads); }) << "ms");
+  }
+
+  return EXIT_SUCCESS;
+}
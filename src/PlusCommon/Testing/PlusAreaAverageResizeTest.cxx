@@ -0,0 +1,185 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file PlusAreaAverageResizeTest.cxx
+  \brief Checks that the separable crop and area-average resize gives the same result as a pixel-by-pixel reference
+  implementation and measures its time on a full HD frame
+*/
+
+#include "PlusConfigure.h"
+#include "PlusAreaAverageResize.h"
+
+// IGSIO includes
+#include <vtkIGSIOAccurateTimer.h>
+
+// VTK includes
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  template<typename ScalarType>
+  void FillRandom(std::vector<ScalarType>& buffer, int maxValue)
+  {
+    srand(1234);
+    for (size_t i = 0; i < buffer.size(); i++)
+    {
+      buffer[i] = static_cast<ScalarType>(rand() % (maxValue + 1));
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Overlap of the [start1, end1) and [start2, end2) intervals */
+  double Overlap(double start1, double end1, double start2, double end2)
+  {
+    return std::max(0.0, std::min(end1, end2) - std::max(start1, start2));
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Averages the input pixels within the area of each output pixel, in double precision */
+  template<typename ScalarType>
+  void ReferenceResize(const std::vector<ScalarType>& input, const FrameSizeType& inputSize, unsigned int components,
+                       const std::array<int, 2>& cropOrigin, const std::array<int, 2>& cropSize, const std::array<int, 2>& outputSize,
+                       std::vector<double>& output)
+  {
+    const double stepX = static_cast<double>(cropSize[0]) / outputSize[0];
+    const double stepY = static_cast<double>(cropSize[1]) / outputSize[1];
+    output.assign(static_cast<size_t>(outputSize[0]) * outputSize[1] * inputSize[2] * components, 0.0);
+    size_t outputIndex = 0;
+    for (unsigned int z = 0; z < inputSize[2]; z++)
+    {
+      for (int outY = 0; outY < outputSize[1]; outY++)
+      {
+        for (int outX = 0; outX < outputSize[0]; outX++)
+        {
+          for (unsigned int c = 0; c < components; c++)
+          {
+            double sum = 0;
+            for (int y = 0; y < cropSize[1]; y++)
+            {
+              double weightY = Overlap(outY * stepY, (outY + 1) * stepY, y, y + 1);
+              for (int x = 0; weightY > 0 && x < cropSize[0]; x++)
+              {
+                double weightX = Overlap(outX * stepX, (outX + 1) * stepX, x, x + 1);
+                size_t inputIndex = ((z * inputSize[1] + cropOrigin[1] + y) * static_cast<size_t>(inputSize[0]) + cropOrigin[0] + x) * components + c;
+                sum += weightX * weightY * input[inputIndex];
+              }
+            }
+            output[outputIndex++] = sum / (stepX * stepY);
+          }
+        }
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  template<typename ScalarType>
+  bool CheckResize(igsioCommon::VTKScalarPixelType scalarType, int maxValue, const FrameSizeType& inputSize, unsigned int components,
+                   const std::array<int, 2>& cropOrigin, const std::array<int, 2>& cropSize, double scale)
+  {
+    std::vector<ScalarType> input(static_cast<size_t>(inputSize[0]) * inputSize[1] * inputSize[2] * components);
+    FillRandom(input, maxValue);
+    std::array<int, 2> outputSize = PlusAreaAverageResize::GetOutputSize(cropSize, scale);
+    std::vector<ScalarType> output(static_cast<size_t>(outputSize[0]) * outputSize[1] * inputSize[2] * components);
+    if (PlusAreaAverageResize::Resize(&input[0], inputSize, scalarType, components, cropOrigin, cropSize, outputSize, &output[0]) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Resize failed for scalar type " << scalarType << " with " << components << " components");
+      return false;
+    }
+    std::vector<double> expected;
+    ReferenceResize(input, inputSize, components, cropOrigin, cropSize, outputSize, expected);
+    for (size_t i = 0; i < output.size(); i++)
+    {
+      // Integer outputs are rounded, the float accumulator may round the other way at exact halves
+      if (std::abs(static_cast<double>(output[i]) - expected[i]) > 0.51 + expected[i] * 1e-5)
+      {
+        LOG_ERROR("Mismatch at output scalar " << i << " (scalar type " << scalarType << ", " << components << " components, crop ("
+                  << cropOrigin[0] << ", " << cropOrigin[1] << ") size (" << cropSize[0] << ", " << cropSize[1] << "), scale " << scale
+                  << "): " << static_cast<double>(output[i]) << ", expected " << expected[i]);
+        return false;
+      }
+    }
+    return true;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int numberOfRepetitions(20);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help");
+  args.AddArgument("--repetitions", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfRepetitions, "Number of resizes of a full HD frame for measuring the resize time (default: 20, 0 = no measurement)");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  // Odd sizes to exercise the scalar tails after the vectorized loops
+  const FrameSizeType imageSize = { 53, 37, 2 };
+  const std::array<int, 2> fullCropOrigin = { 0, 0 };
+  const std::array<int, 2> fullCropSize = { 53, 37 };
+  const std::array<int, 2> cropOrigin = { 5, 3 };
+  const std::array<int, 2> cropSize = { 41, 29 };
+  const double scales[] = { 1.0, 0.5, 0.37, 0.25, 0.01 };
+  bool success = true;
+  for (double scale : scales)
+  {
+    for (unsigned int components = 1; components <= 4; components++)
+    {
+      success &= CheckResize<unsigned char>(VTK_UNSIGNED_CHAR, 255, imageSize, components, fullCropOrigin, fullCropSize, scale);
+      success &= CheckResize<unsigned char>(VTK_UNSIGNED_CHAR, 255, imageSize, components, cropOrigin, cropSize, scale);
+    }
+    success &= CheckResize<unsigned short>(VTK_UNSIGNED_SHORT, 65535, imageSize, 1, cropOrigin, cropSize, scale);
+    success &= CheckResize<short>(VTK_SHORT, 32767, imageSize, 2, cropOrigin, cropSize, scale);
+    success &= CheckResize<float>(VTK_FLOAT, 1000, imageSize, 1, cropOrigin, cropSize, scale);
+  }
+
+  if (numberOfRepetitions > 0)
+  {
+    // Full HD RGB frame to a quarter of its area, as requested by a remote display client
+    const FrameSizeType hdSize = { 1920, 1080, 1 };
+    const std::array<int, 2> hdCropSize = { 1920, 1080 };
+    std::vector<unsigned char> hdInput(hdSize[0] * hdSize[1] * 3);
+    FillRandom(hdInput, 255);
+    std::array<int, 2> hdOutputSize = PlusAreaAverageResize::GetOutputSize(hdCropSize, 0.5);
+    std::vector<unsigned char> hdOutput(hdOutputSize[0] * hdOutputSize[1] * 3);
+    double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+    for (int i = 0; i < numberOfRepetitions; i++)
+    {
+      PlusAreaAverageResize::Resize(&hdInput[0], hdSize, VTK_UNSIGNED_CHAR, 3, fullCropOrigin, hdCropSize, hdOutputSize, &hdOutput[0]);
+    }
+    double resizeTimeMs = (vtkIGSIOAccurateTimer::GetSystemTime() - startTime) * 1000.0 / numberOfRepetitions;
+    LOG_INFO("Full HD RGB frame resized to " << hdOutputSize[0] << "x" << hdOutputSize[1] << " in " << resizeTimeMs << " ms");
+  }
+
+  if (!success)
+  {
+    LOG_ERROR("PlusAreaAverageResizeTest failed");
+    return EXIT_FAILURE;
+  }
+  LOG_INFO("PlusAreaAverageResizeTest completed successfully");
+  return EXIT_SUCCESS;
+}
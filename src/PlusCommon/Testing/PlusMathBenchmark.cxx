@@ -0,0 +1,312 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file PlusMathBenchmark.cxx
+  \brief Measures the solving time of the robust linear least squares methods of PlusMath on a synthetic pivot calibration problem.
+
+  The problem has three equations for each marker pose and a fraction of the poses is corrupted, so that a few
+  outlier rejection iterations are needed. The sparse LSQR solver and the dense normal equations solver are run on
+  the same equations and the test fails if their solutions differ. As in the other benchmarks, the number of iterations
+  is increased until a run takes at least the minimum time, then the run is repeated and the mean, median and
+  standard deviation of the run times are reported.
+*/
+
+#include "PlusConfigure.h"
+#include "PlusMath.h"
+
+// VTK includes
+#include <vtksys/CommandLineArguments.hxx>
+
+// IGSIO includes
+#include <vtkIGSIOAccurateTimer.h>
+
+// STL includes
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <sstream>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  /*! Small linear congruential generator, so that the synthetic problems are the same on all platforms */
+  class RandomGenerator
+  {
+  public:
+    RandomGenerator() : State(12345) {}
+    /*! Uniform random number in [0, 1) */
+    double Next()
+    {
+      this->State = this->State * 1664525u + 1013904223u;
+      return (this->State >> 8) / 16777216.0;
+    }
+  private:
+    unsigned int State;
+  };
+
+  //----------------------------------------------------------------------------
+  /*!
+    Pivot calibration equations [ R | -I ] * [ pivot_Marker; pivot_Reference ] = -t for random marker orientations.
+    The translations have noise, and the translations of the given fraction of the poses have large errors.
+  */
+  void CreatePivotCalibrationProblem(int numberOfRows, double outlierRatio, vnl_matrix<double>& aMatrix, vnl_vector<double>& bVector)
+  {
+    const double pivot_Marker[3] = { 10.0, -20.0, 150.0 };
+    const double pivot_Reference[3] = { 50.0, 60.0, -30.0 };
+    const int numberOfPoses = numberOfRows / 3;
+    aMatrix.set_size(numberOfPoses * 3, 6);
+    aMatrix.fill(0.0);
+    bVector.set_size(numberOfPoses * 3);
+    RandomGenerator random;
+    for (int pose = 0; pose < numberOfPoses; ++pose)
+    {
+      const double rx = (random.Next() - 0.5) * 1.2;
+      const double ry = (random.Next() - 0.5) * 1.2;
+      const double rz = random.Next() * 2.0 * vtkMath::Pi();
+      const double cx = cos(rx), sx = sin(rx), cy = cos(ry), sy = sin(ry), cz = cos(rz), sz = sin(rz);
+      const double rotation[3][3] =
+      {
+        { cz * cy, cz * sy * sx - sz * cx, cz * sy * cx + sz * sx },
+        { sz * cy, sz * sy * sx + cz * cx, sz * sy * cx - cz * sx },
+        { -sy, cy * sx, cy * cx }
+      };
+      const bool outlier = (random.Next() < outlierRatio);
+      for (int i = 0; i < 3; ++i)
+      {
+        const int row = pose * 3 + i;
+        double translation = pivot_Reference[i];
+        for (int j = 0; j < 3; ++j)
+        {
+          aMatrix(row, j) = rotation[i][j];
+          translation -= rotation[i][j] * pivot_Marker[j];
+        }
+        aMatrix(row, 3 + i) = -1.0;
+        translation += (random.Next() - 0.5) * 0.5;
+        if (outlier)
+        {
+          translation += (random.Next() - 0.5) * 100.0;
+        }
+        bVector[row] = -translation;
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  class LSQRBenchmark
+  {
+  public:
+    LSQRBenchmark(const std::string& name, bool sparse, const vnl_matrix<double>& aMatrix, const vnl_vector<double>& bVector)
+      : Name(name), Sparse(sparse), AMatrix(aMatrix), BVector(bVector), SparseAMatrix(aMatrix.rows(), aMatrix.cols())
+    {
+      for (unsigned int row = 0; row < aMatrix.rows(); ++row)
+      {
+        for (unsigned int i = 0; i < aMatrix.cols(); ++i)
+        {
+          if (aMatrix(row, i) != 0.0)
+          {
+            this->SparseAMatrix(row, i) = aMatrix(row, i);
+          }
+        }
+      }
+    }
+
+    const std::string& GetName() const { return this->Name; }
+
+    PlusStatus RunIteration()
+    {
+      vnl_vector<unsigned int> notOutliersIndices(this->BVector.size());
+      for (unsigned int i = 0; i < notOutliersIndices.size(); ++i)
+      {
+        notOutliersIndices[i] = i;
+      }
+      this->Result.set_size(this->AMatrix.cols());
+      this->Result.fill(0.0);
+      PlusStatus status = this->Sparse
+                          ? PlusMath::LSQRMinimize(this->SparseAMatrix, this->BVector, this->Result, &this->Mean, &this->Stdev, &notOutliersIndices)
+                          : PlusMath::LSQRMinimize(this->AMatrix, this->BVector, this->Result, &this->Mean, &this->Stdev, &notOutliersIndices);
+      this->NumberOfOutliers = this->BVector.size() - notOutliersIndices.size();
+      return status;
+    }
+
+    vnl_vector<double> Result;
+    double Mean;
+    double Stdev;
+    unsigned int NumberOfOutliers;
+
+  private:
+    std::string Name;
+    bool Sparse;
+    const vnl_matrix<double>& AMatrix;
+    const vnl_vector<double>& BVector;
+    vnl_sparse_matrix<double> SparseAMatrix;
+  };
+
+  //----------------------------------------------------------------------------
+  /*! Returns the total time of the iterations in seconds, or a negative value if an iteration failed */
+  double RunIterations(LSQRBenchmark& benchmark, int numberOfIterations)
+  {
+    const double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+    for (int i = 0; i < numberOfIterations; ++i)
+    {
+      if (benchmark.RunIteration() != PLUS_SUCCESS)
+      {
+        return -1.0;
+      }
+    }
+    return vtkIGSIOAccurateTimer::GetSystemTime() - startTime;
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus RunBenchmark(LSQRBenchmark& benchmark, double minTimeSec, int repetitions)
+  {
+    if (benchmark.RunIteration() != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Benchmark " << benchmark.GetName() << " failed");
+      return PLUS_FAIL;
+    }
+
+    // Increase the number of iterations until a run takes at least the minimum time
+    int numberOfIterations = 1;
+    double runTimeSec = 0.0;
+    const int maxNumberOfIterations = 100000;
+    while (true)
+    {
+      runTimeSec = RunIterations(benchmark, numberOfIterations);
+      if (runTimeSec < 0)
+      {
+        LOG_ERROR("Benchmark " << benchmark.GetName() << " failed");
+        return PLUS_FAIL;
+      }
+      if (runTimeSec >= minTimeSec || numberOfIterations >= maxNumberOfIterations)
+      {
+        break;
+      }
+      double multiplier = (runTimeSec > 0 ? 1.4 * minTimeSec / runTimeSec : 10.0);
+      numberOfIterations = std::min(maxNumberOfIterations, static_cast<int>(numberOfIterations * std::max(1.1, std::min(multiplier, 10.0))) + 1);
+    }
+
+    std::vector<double> iterationTimesSec(1, runTimeSec / numberOfIterations);
+    for (int i = 1; i < repetitions; ++i)
+    {
+      runTimeSec = RunIterations(benchmark, numberOfIterations);
+      if (runTimeSec < 0)
+      {
+        LOG_ERROR("Benchmark " << benchmark.GetName() << " failed");
+        return PLUS_FAIL;
+      }
+      iterationTimesSec.push_back(runTimeSec / numberOfIterations);
+    }
+
+    double mean = 0.0;
+    for (std::vector<double>::iterator it = iterationTimesSec.begin(); it != iterationTimesSec.end(); ++it)
+    {
+      mean += *it;
+    }
+    mean /= iterationTimesSec.size();
+    double variance = 0.0;
+    for (std::vector<double>::iterator it = iterationTimesSec.begin(); it != iterationTimesSec.end(); ++it)
+    {
+      variance += (*it - mean) * (*it - mean);
+    }
+    double stdev = (iterationTimesSec.size() > 1 ? sqrt(variance / (iterationTimesSec.size() - 1)) : 0.0);
+    std::sort(iterationTimesSec.begin(), iterationTimesSec.end());
+    double median = iterationTimesSec[iterationTimesSec.size() / 2];
+    if (iterationTimesSec.size() % 2 == 0)
+    {
+      median = (median + iterationTimesSec[iterationTimesSec.size() / 2 - 1]) / 2.0;
+    }
+
+    std::cout << std::left << std::setw(32) << benchmark.GetName() << std::right << std::fixed << std::setprecision(3)
+              << std::setw(12) << mean * 1000.0
+              << std::setw(12) << median * 1000.0
+              << std::setw(12) << stdev * 1000.0
+              << std::setw(12) << numberOfIterations
+              << std::setw(12) << benchmark.NumberOfOutliers
+              << std::endl;
+    return PLUS_SUCCESS;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp = false;
+  int numberOfRows = 10000;
+  double outlierRatio = 0.05;
+  double minTimeSec = 0.5;
+  int repetitions = 3;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help");
+  args.AddArgument("--rows", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfRows, "Number of equations, three for each marker pose (default: 10000)");
+  args.AddArgument("--outlier-ratio", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &outlierRatio, "Fraction of the marker poses that are corrupted (default: 0.05)");
+  args.AddArgument("--min-time-sec", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &minTimeSec, "Minimum duration of a run, the number of iterations is increased until it is reached (default: 0.5)");
+  args.AddArgument("--repetitions", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &repetitions, "Number of runs of each benchmark (default: 3)");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (numberOfRows < 30)
+  {
+    LOG_ERROR("--rows must be at least 30");
+    exit(EXIT_FAILURE);
+  }
+  if (repetitions < 1)
+  {
+    repetitions = 1;
+  }
+
+  vnl_matrix<double> aMatrix;
+  vnl_vector<double> bVector;
+  CreatePivotCalibrationProblem(numberOfRows, outlierRatio, aMatrix, bVector);
+
+  LSQRBenchmark sparseBenchmark("LSQRMinimize/Sparse", true, aMatrix, bVector);
+  LSQRBenchmark denseBenchmark("LSQRMinimize/Dense", false, aMatrix, bVector);
+
+  std::cout << "Number of equations: " << aMatrix.rows() << ", number of unknowns: " << aMatrix.cols() << std::endl;
+  std::cout << std::left << std::setw(32) << "Benchmark" << std::right
+            << std::setw(12) << "Mean [ms]" << std::setw(12) << "Median [ms]" << std::setw(12) << "Stdev [ms]"
+            << std::setw(12) << "Iterations" << std::setw(12) << "Outliers" << std::endl;
+
+  int numberOfFailures = 0;
+  if (RunBenchmark(sparseBenchmark, minTimeSec, repetitions) != PLUS_SUCCESS)
+  {
+    numberOfFailures++;
+  }
+  if (RunBenchmark(denseBenchmark, minTimeSec, repetitions) != PLUS_SUCCESS)
+  {
+    numberOfFailures++;
+  }
+
+  // The two solvers must find the same pivot points (LSQR is iterative, so the agreement is not exact)
+  if (numberOfFailures == 0)
+  {
+    const double maximumDifference = (sparseBenchmark.Result - denseBenchmark.Result).inf_norm();
+    if (maximumDifference > 0.01)
+    {
+      LOG_ERROR("Solutions differ: sparse LSQR: " << sparseBenchmark.Result << ", dense: " << denseBenchmark.Result);
+      numberOfFailures++;
+    }
+  }
+
+  return (numberOfFailures == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
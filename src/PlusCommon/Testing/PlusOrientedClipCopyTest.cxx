@@ -0,0 +1,177 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file PlusOrientedClipCopyTest.cxx
+  \brief Checks that the fused clip, flip and transpose copy gives the same result as a voxel-by-voxel reference
+  implementation and measures its time on a full HD frame compared to a plain memcpy
+*/
+
+#include "PlusConfigure.h"
+#include "PlusOrientedClipCopy.h"
+
+// IGSIO includes
+#include <vtkIGSIOAccurateTimer.h>
+
+// VTK includes
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <cstdlib>
+#include <iomanip>
+#include <vector>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  void FillRandom(std::vector<unsigned char>& buffer)
+  {
+    srand(1234);
+    for (size_t i = 0; i < buffer.size(); i++)
+    {
+      buffer[i] = static_cast<unsigned char>(rand() % 256);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  void ReferenceCopy(const std::vector<unsigned char>& input, const FrameSizeType& inputSize, unsigned int bytesPerPixel,
+                     const std::array<int, 3>& clipOrigin, const std::array<int, 3>& clipSize,
+                     bool flipX, bool flipY, bool flipZ, bool transpose, std::vector<unsigned char>& output)
+  {
+    output.resize(static_cast<size_t>(clipSize[0]) * clipSize[1] * clipSize[2] * bytesPerPixel);
+    for (int k = 0; k < clipSize[2]; k++)
+    {
+      for (int j = 0; j < clipSize[1]; j++)
+      {
+        for (int i = 0; i < clipSize[0]; i++)
+        {
+          const size_t inputIndex = (clipOrigin[0] + (flipX ? clipSize[0] - 1 - i : i))
+                                    + (clipOrigin[1] + (flipY ? clipSize[1] - 1 - j : j)) * static_cast<size_t>(inputSize[0])
+                                    + (clipOrigin[2] + (flipZ ? clipSize[2] - 1 - k : k)) * static_cast<size_t>(inputSize[0]) * inputSize[1];
+          const size_t outputIndex = transpose
+                                     ? k + i * static_cast<size_t>(clipSize[2]) + j * static_cast<size_t>(clipSize[2]) * clipSize[0]
+                                     : i + j * static_cast<size_t>(clipSize[0]) + k * static_cast<size_t>(clipSize[0]) * clipSize[1];
+          memcpy(&output[outputIndex * bytesPerPixel], &input[inputIndex * bytesPerPixel], bytesPerPixel);
+        }
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  bool CheckCopy(const FrameSizeType& inputSize, unsigned int bytesPerPixel, const std::array<int, 3>& clipOrigin, const std::array<int, 3>& clipSize,
+                 bool flipX, bool flipY, bool flipZ, bool transpose)
+  {
+    std::vector<unsigned char> input(static_cast<size_t>(inputSize[0]) * inputSize[1] * inputSize[2] * bytesPerPixel);
+    FillRandom(input);
+    std::vector<unsigned char> expected;
+    ReferenceCopy(input, inputSize, bytesPerPixel, clipOrigin, clipSize, flipX, flipY, flipZ, transpose, expected);
+
+    std::vector<unsigned char> actual(expected.size());
+    if (PlusOrientedClipCopy::Copy(&input[0], inputSize, bytesPerPixel, clipOrigin, clipSize, flipX, flipY, flipZ, transpose, &actual[0]) != PLUS_SUCCESS
+        || actual != expected)
+    {
+      LOG_ERROR("Oriented clipped copy differs from the reference: " << bytesPerPixel << " bytes per pixel, "
+                << inputSize[0] << "x" << inputSize[1] << "x" << inputSize[2] << " image, clip origin ("
+                << clipOrigin[0] << ", " << clipOrigin[1] << ", " << clipOrigin[2] << ") size ("
+                << clipSize[0] << ", " << clipSize[1] << ", " << clipSize[2] << "), flip " << flipX << flipY << flipZ << ", transpose " << transpose);
+      return false;
+    }
+    return true;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int numberOfRepetitions(20);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help");
+  args.AddArgument("--repetitions", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfRepetitions, "Number of copies of a full HD frame for measuring the copy time (default: 20, 0 = no measurement)");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  // Odd sizes to exercise the scalar tails after the vectorized loops
+  const unsigned int pixelSizes[] = { 1, 2, 3, 4, 8 };
+  const FrameSizeType imageSize = { 37, 21, 5 };
+  const std::array<int, 3> fullClipOrigin = { 0, 0, 0 };
+  const std::array<int, 3> fullClipSize = { 37, 21, 5 };
+  const std::array<int, 3> clipOrigin = { 3, 2, 1 };
+  const std::array<int, 3> clipSize = { 33, 17, 3 };
+  bool success = true;
+  for (unsigned int pixelSize : pixelSizes)
+  {
+    for (int flips = 0; flips < 8; flips++)
+    {
+      const bool flipX = (flips & 1) != 0;
+      const bool flipY = (flips & 2) != 0;
+      const bool flipZ = (flips & 4) != 0;
+      success &= CheckCopy(imageSize, pixelSize, fullClipOrigin, fullClipSize, flipX, flipY, flipZ, false);
+      success &= CheckCopy(imageSize, pixelSize, clipOrigin, clipSize, flipX, flipY, flipZ, false);
+    }
+    success &= CheckCopy(imageSize, pixelSize, fullClipOrigin, fullClipSize, false, false, false, true);
+    success &= CheckCopy(imageSize, pixelSize, clipOrigin, clipSize, false, false, false, true);
+  }
+
+  // Clip rectangles outside of the image and transposition with flips are rejected
+  const std::array<int, 3> outsideClipOrigin = { 10, 0, 0 };
+  if (PlusOrientedClipCopy::IsSupported(imageSize, outsideClipOrigin, fullClipSize, false, false, false, false)
+      || PlusOrientedClipCopy::IsSupported(imageSize, fullClipOrigin, fullClipSize, true, false, false, true))
+  {
+    LOG_ERROR("Unsupported clip rectangle or flip/transpose combination is reported as supported");
+    success = false;
+  }
+
+  if (!success)
+  {
+    return EXIT_FAILURE;
+  }
+  LOG_INFO("Oriented clipped copies match the reference implementation");
+
+  if (numberOfRepetitions > 0)
+  {
+    const FrameSizeType frameSize = { 1920, 1080, 1 };
+    const std::array<int, 3> frameClipOrigin = { 0, 0, 0 };
+    const std::array<int, 3> frameClipSize = { 1920, 1080, 1 };
+    std::vector<unsigned char> input(frameSize[0] * frameSize[1]);
+    std::vector<unsigned char> output(input.size());
+    FillRandom(input);
+
+    double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+    for (int i = 0; i < numberOfRepetitions; i++)
+    {
+      memcpy(&output[0], &input[0], input.size());
+    }
+    const double memcpyTimeMs = (vtkIGSIOAccurateTimer::GetSystemTime() - startTime) * 1000.0 / numberOfRepetitions;
+
+    startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+    for (int i = 0; i < numberOfRepetitions; i++)
+    {
+      PlusOrientedClipCopy::Copy(&input[0], frameSize, 1, frameClipOrigin, frameClipSize, true, true, false, false, &output[0]);
+    }
+    const double flipTimeMs = (vtkIGSIOAccurateTimer::GetSystemTime() - startTime) * 1000.0 / numberOfRepetitions;
+
+    LOG_INFO("Copy time of a " << frameSize[0] << "x" << frameSize[1] << " gray frame: memcpy " << std::fixed << std::setprecision(3) << memcpyTimeMs
+             << " ms, flipped in both directions " << flipTimeMs << " ms");
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,96 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file PlusPacingTimerTest.cxx
+  \brief Checks that PlusPacingTimer delays are never shorter than requested and the average overshoot is small
+*/
+
+#include "PlusConfigure.h"
+#include "PlusPacingTimer.h"
+#include "vtkIGSIOAccurateTimer.h"
+
+// VTK includes
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <algorithm>
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp = false;
+  int numberOfRepetitions = 50;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help");
+  args.AddArgument("--repetitions", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfRepetitions, "Number of delays for each tested duration (default: 50)");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  // Generous limit, the test may run on a loaded machine
+  const double maximumMeanOvershootSec = 0.002;
+  const double durationsSec[] = { 0.0002, 0.001, 0.005 };
+
+  bool success = true;
+  LOG_INFO("Spin duration: " << PlusPacingTimer::GetSpinDurationSec() * 1000.0 << " ms");
+  for (double durationSec : durationsSec)
+  {
+    double totalOvershootSec = 0.0;
+    double maximumOvershootSec = 0.0;
+    for (int i = 0; i < numberOfRepetitions; i++)
+    {
+      double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+      PlusPacingTimer::Delay(durationSec);
+      double overshootSec = vtkIGSIOAccurateTimer::GetSystemTime() - startTime - durationSec;
+      // Allow for the resolution of the system time
+      if (overshootSec < -1e-6)
+      {
+        LOG_ERROR("Delay of " << durationSec * 1000.0 << " ms returned " << -overshootSec * 1000.0 << " ms early");
+        success = false;
+      }
+      totalOvershootSec += overshootSec;
+      maximumOvershootSec = std::max(maximumOvershootSec, overshootSec);
+    }
+    double meanOvershootSec = totalOvershootSec / numberOfRepetitions;
+    LOG_INFO("Delay " << durationSec * 1000.0 << " ms: mean overshoot " << meanOvershootSec * 1000.0
+             << " ms, maximum overshoot " << maximumOvershootSec * 1000.0 << " ms");
+    if (meanOvershootSec > maximumMeanOvershootSec)
+    {
+      LOG_ERROR("Mean overshoot of " << durationSec * 1000.0 << " ms delays is " << meanOvershootSec * 1000.0
+                << " ms, more than " << maximumMeanOvershootSec * 1000.0 << " ms");
+      success = false;
+    }
+  }
+
+  // Non-positive durations return immediately
+  PlusPacingTimer::Delay(0.0);
+  PlusPacingTimer::Delay(-1.0);
+  PlusPacingTimer::DelayUntil(vtkIGSIOAccurateTimer::GetSystemTime() - 1.0);
+
+  if (!success)
+  {
+    LOG_ERROR("Test failed");
+    return EXIT_FAILURE;
+  }
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,142 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file PlusPerformanceMetricsTest.cxx
+  \brief Checks that performance metrics are written and read back without loss and that regressions are detected
+  with the configured tolerances
+*/
+
+#include "PlusConfigure.h"
+#include "PlusPerformanceMetrics.h"
+#include "vtkPlusConfig.h"
+
+// VTK includes
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <cmath>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  /*! Returns true if the comparison result is as expected */
+  bool CheckComparison(const PlusPerformanceMetrics& metrics, const PlusPerformanceMetrics& baseline, size_t expectedNumberOfRegressions, const std::string& caseName)
+  {
+    std::vector<std::string> regressions;
+    PlusStatus status = metrics.CompareToBaseline(baseline, &regressions);
+    if (regressions.size() != expectedNumberOfRegressions || (status == PLUS_SUCCESS) != (expectedNumberOfRegressions == 0))
+    {
+      LOG_ERROR(caseName << ": " << regressions.size() << " regressions were found, expected " << expectedNumberOfRegressions);
+      return false;
+    }
+    return true;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  bool success = true;
+
+  PlusPerformanceMetrics baseline;
+  baseline.SetMetric("ScanConvertLinear/FramesPerSec", 812.5, PlusPerformanceMetrics::THROUGHPUT);
+  baseline.SetMetric("IMAGE \"quoted\" \\ name/LatencyP99Ms", 12.25, PlusPerformanceMetrics::LATENCY);
+  baseline.SetMetric("TRANSFORM/LatencyP99Ms", 0.5, PlusPerformanceMetrics::LATENCY);
+
+  // Round trip through a file
+  const std::string filename = vtkPlusConfig::GetInstance()->GetOutputPath("PlusPerformanceMetricsTest.json");
+  PlusPerformanceMetrics readMetrics;
+  if (baseline.WriteToFile(filename) != PLUS_SUCCESS || readMetrics.ReadFromFile(filename) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to write and read back " << filename);
+    return EXIT_FAILURE;
+  }
+  if (readMetrics.GetMetrics().size() != baseline.GetMetrics().size())
+  {
+    LOG_ERROR("Read " << readMetrics.GetMetrics().size() << " metrics, expected " << baseline.GetMetrics().size());
+    success = false;
+  }
+  for (PlusPerformanceMetrics::MetricMap::const_iterator metric = baseline.GetMetrics().begin(); metric != baseline.GetMetrics().end(); ++metric)
+  {
+    PlusPerformanceMetrics::MetricMap::const_iterator readMetric = readMetrics.GetMetrics().find(metric->first);
+    if (readMetric == readMetrics.GetMetrics().end() || readMetric->second.Type != metric->second.Type
+        || fabs(readMetric->second.Value - metric->second.Value) > 1e-9)
+    {
+      LOG_ERROR("Metric " << metric->first << " is not read back as written");
+      success = false;
+    }
+  }
+
+  // Members that are not used by the metrics are skipped
+  PlusPerformanceMetrics extendedMetrics;
+  if (extendedMetrics.ReadFromString("{ \"build\": { \"compiler\": \"gcc\", \"flags\": [\"-O2\", null, 3] },\n"
+                                     "  \"metrics\": { \"A\": { \"unit\": \"fps\", \"value\": 1.5e2, \"higherIsBetter\": true } } }") != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to read metrics with additional members");
+    success = false;
+  }
+  double value = 0.0;
+  if (extendedMetrics.GetMetric("A", value) != PLUS_SUCCESS || value != 150.0)
+  {
+    LOG_ERROR("Metric A is " << value << ", expected 150");
+    success = false;
+  }
+
+  // Changes within the tolerance, and improvements, are not regressions
+  PlusPerformanceMetrics metrics = readMetrics;
+  metrics.SetMetric("ScanConvertLinear/FramesPerSec", 812.5 * 0.95, PlusPerformanceMetrics::THROUGHPUT);
+  metrics.SetMetric("IMAGE \"quoted\" \\ name/LatencyP99Ms", 12.25 * 0.5, PlusPerformanceMetrics::LATENCY);
+  // 3 times the baseline, but only by 1 ms
+  metrics.SetMetric("TRANSFORM/LatencyP99Ms", 1.5, PlusPerformanceMetrics::LATENCY);
+  metrics.SetMetric("NewMetric", 1.0, PlusPerformanceMetrics::THROUGHPUT);
+  success &= CheckComparison(metrics, baseline, 0, "Within tolerance");
+
+  // Throughput decrease and latency increase beyond the tolerance
+  metrics.SetMetric("ScanConvertLinear/FramesPerSec", 812.5 * 0.85, PlusPerformanceMetrics::THROUGHPUT);
+  metrics.SetMetric("IMAGE \"quoted\" \\ name/LatencyP99Ms", 12.25 * 1.3, PlusPerformanceMetrics::LATENCY);
+  success &= CheckComparison(metrics, baseline, 2, "Beyond tolerance");
+
+  // Tolerances are configurable
+  metrics.SetMaximumThroughputDecreasePercent(20.0);
+  metrics.SetMaximumLatencyIncreasePercent(50.0);
+  success &= CheckComparison(metrics, baseline, 0, "Increased tolerance");
+  metrics.SetMinimumLatencyIncreaseMs(0.5);
+  success &= CheckComparison(metrics, baseline, 1, "Decreased minimum latency increase");
+
+  // A metric that is no longer measured is a regression
+  PlusPerformanceMetrics incompleteMetrics;
+  incompleteMetrics.SetMetric("ScanConvertLinear/FramesPerSec", 812.5, PlusPerformanceMetrics::THROUGHPUT);
+  success &= CheckComparison(incompleteMetrics, baseline, 2, "Missing metrics");
+
+  if (!success)
+  {
+    return EXIT_FAILURE;
+  }
+  LOG_INFO("Performance metrics test passed");
+  return EXIT_SUCCESS;
+}
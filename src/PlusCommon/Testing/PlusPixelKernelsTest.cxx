@@ -0,0 +1,179 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file PlusPixelKernelsTest.cxx
+  \brief Checks that the row kernels instantiated by the pixel size dispatch give the same result as byte-by-byte
+  reference implementations, for all supported pixel sizes and for row lengths that exercise the vectorized loops and their tails
+*/
+
+#include "PlusConfigure.h"
+#include "PlusPixelKernels.h"
+
+// VTK includes
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  void FillRandom(std::vector<unsigned char>& buffer)
+  {
+    srand(1234);
+    for (size_t i = 0; i < buffer.size(); i++)
+    {
+      buffer[i] = static_cast<unsigned char>(rand() % 256);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Runs the reverse and deinterleave kernels on a row and compares them to the reference */
+  struct CheckRowKernelsFunctor
+  {
+    const std::vector<unsigned char>& Input;
+    unsigned int NumberOfPixels;
+    unsigned int BytesPerPixel;
+    bool& Success;
+
+    template<class PixelType>
+    void Run() const
+    {
+      if (sizeof(PixelType) != BytesPerPixel)
+      {
+        LOG_ERROR("Dispatched pixel size " << sizeof(PixelType) << " differs from the requested " << BytesPerPixel << " bytes");
+        Success = false;
+        return;
+      }
+      const PixelType* inputRow = reinterpret_cast<const PixelType*>(&Input[0]);
+
+      std::vector<unsigned char> reversed(NumberOfPixels * BytesPerPixel);
+      PlusPixelKernels::ReverseRow(inputRow, reinterpret_cast<PixelType*>(&reversed[0]), NumberOfPixels);
+      for (unsigned int pixel = 0; pixel < NumberOfPixels; pixel++)
+      {
+        if (memcmp(&reversed[pixel * BytesPerPixel], &Input[(NumberOfPixels - 1 - pixel) * BytesPerPixel], BytesPerPixel) != 0)
+        {
+          LOG_ERROR("Reversed row differs from the reference at pixel " << pixel << " (" << BytesPerPixel << " bytes per pixel, " << NumberOfPixels << " pixels)");
+          Success = false;
+          return;
+        }
+      }
+
+      const unsigned int outputPixels = (NumberOfPixels + 1) / 2;
+      std::vector<unsigned char> even(outputPixels * BytesPerPixel, 0);
+      std::vector<unsigned char> odd(outputPixels * BytesPerPixel, 0);
+      PlusPixelKernels::DeinterleaveRow(inputRow, NumberOfPixels, reinterpret_cast<PixelType*>(&even[0]), reinterpret_cast<PixelType*>(&odd[0]));
+      for (unsigned int pixel = 0; pixel < NumberOfPixels; pixel++)
+      {
+        const std::vector<unsigned char>& output = (pixel % 2 == 0) ? even : odd;
+        if (memcmp(&output[(pixel / 2) * BytesPerPixel], &Input[pixel * BytesPerPixel], BytesPerPixel) != 0)
+        {
+          LOG_ERROR("Deinterleaved row differs from the reference at pixel " << pixel << " (" << BytesPerPixel << " bytes per pixel, " << NumberOfPixels << " pixels)");
+          Success = false;
+          return;
+        }
+      }
+    }
+  };
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  bool success = true;
+  const unsigned int pixelSizes[] = { 1, 2, 3, 4, 6, 8, 12, 16, 24, 32 };
+  const unsigned int rowLengths[] = { 1, 2, 15, 16, 33, 64, 101 };
+  for (unsigned int bytesPerPixel : pixelSizes)
+  {
+    for (unsigned int numberOfPixels : rowLengths)
+    {
+      std::vector<unsigned char> input(numberOfPixels * bytesPerPixel);
+      FillRandom(input);
+      CheckRowKernelsFunctor functor = { input, numberOfPixels, bytesPerPixel, success };
+      if (PlusPixelKernels::DispatchPixelSize(bytesPerPixel, functor) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Pixel size " << bytesPerPixel << " is not supported by the dispatch");
+        success = false;
+      }
+    }
+  }
+
+  // 8-bit kernels
+  for (unsigned int numberOfPixels : rowLengths)
+  {
+    std::vector<unsigned char> input(numberOfPixels);
+    FillRandom(input);
+    const unsigned char thresholds[] = { 0, 127, 128, 255 };
+    std::vector<unsigned char> thresholded(numberOfPixels);
+    for (unsigned char threshold : thresholds)
+    {
+      PlusPixelKernels::ThresholdRow(&input[0], &thresholded[0], numberOfPixels, threshold);
+      for (unsigned int pixel = 0; pixel < numberOfPixels; pixel++)
+      {
+        if (thresholded[pixel] != ((input[pixel] > threshold) ? 255 : 0))
+        {
+          LOG_ERROR("Thresholded row differs from the reference at pixel " << pixel << " (threshold " << static_cast<int>(threshold) << ", " << numberOfPixels << " pixels)");
+          success = false;
+          break;
+        }
+      }
+    }
+    for (unsigned int factor = 1; factor <= 3; factor++)
+    {
+      std::vector<unsigned char> upscaled(numberOfPixels * factor);
+      PlusPixelKernels::UpscaleRow(&input[0], &upscaled[0], numberOfPixels, factor);
+      for (unsigned int pixel = 0; pixel < numberOfPixels * factor; pixel++)
+      {
+        if (upscaled[pixel] != input[pixel / factor])
+        {
+          LOG_ERROR("Upscaled row differs from the reference at pixel " << pixel << " (factor " << factor << ", " << numberOfPixels << " pixels)");
+          success = false;
+          break;
+        }
+      }
+    }
+  }
+
+  // Every VTK scalar type with 1 to 4 components has a kernel, other pixel sizes are rejected
+  const std::vector<unsigned char> emptyRow;
+  CheckRowKernelsFunctor unusedFunctor = { emptyRow, 0, 0, success };
+  if (PlusPixelKernels::GetScalarSize(VTK_UNSIGNED_SHORT) != 2 || PlusPixelKernels::GetScalarSize(VTK_DOUBLE) != 8
+      || PlusPixelKernels::DispatchPixelSize(5, unusedFunctor) == PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unexpected scalar size or pixel size dispatch result");
+    success = false;
+  }
+
+  if (!success)
+  {
+    return EXIT_FAILURE;
+  }
+  LOG_INFO("Pixel kernels match the reference implementation");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,164 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file PlusSharedTransformRepositoryTest.cxx
+  \brief Checks that the snapshots of a PlusSharedTransformRepository are not changed by updates, while a reader thread
+  reads the snapshots and a writer thread updates the repository at the same time
+*/
+
+#include "PlusConfigure.h"
+#include "PlusSharedTransformRepository.h"
+
+// VTK includes
+#include <vtkMatrix4x4.h>
+#include <vtkSmartPointer.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <atomic>
+#include <thread>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  PlusStatus SetTranslation(vtkIGSIOTransformRepository* repository, const igsioTransformName& name, double translation)
+  {
+    vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    matrix->SetElement(0, 3, translation);
+    matrix->SetElement(1, 3, translation);
+    return repository->SetTransform(name, matrix);
+  }
+
+  //----------------------------------------------------------------------------
+  bool GetTranslation(vtkIGSIOTransformRepository* repository, const igsioTransformName& name, double& translation)
+  {
+    vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    if (repository->GetTransform(name, matrix) != PLUS_SUCCESS)
+    {
+      return false;
+    }
+    translation = matrix->GetElement(0, 3);
+    // Both elements are set by the same update, a torn read would make them different
+    return matrix->GetElement(1, 3) == translation;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp = false;
+  int numberOfUpdates = 1000;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help");
+  args.AddArgument("--updates", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfUpdates, "Number of updates while the snapshots are read (default: 1000)");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  int numberOfErrors = 0;
+  const igsioTransformName probeToTracker("Probe", "Tracker");
+
+  vtkSmartPointer<vtkIGSIOTransformRepository> initialRepository = vtkSmartPointer<vtkIGSIOTransformRepository>::New();
+  SetTranslation(initialRepository, probeToTracker, 0.0);
+
+  PlusSharedTransformRepository sharedRepository;
+  if (sharedRepository.Reset(initialRepository) != PLUS_SUCCESS || sharedRepository.GetSnapshot() == NULL)
+  {
+    LOG_ERROR("Failed to set the shared transform repository");
+    return EXIT_FAILURE;
+  }
+  if (sharedRepository.GetSnapshot() == initialRepository)
+  {
+    LOG_ERROR("The shared transform repository must be a copy of the initial repository");
+    numberOfErrors++;
+  }
+
+  // A snapshot is not changed by an update
+  vtkSmartPointer<vtkIGSIOTransformRepository> firstSnapshot = sharedRepository.GetSnapshot();
+  unsigned long firstVersion = sharedRepository.GetVersion();
+  vtkSmartPointer<vtkIGSIOTransformRepository> secondSnapshot;
+  sharedRepository.Update([&probeToTracker](vtkIGSIOTransformRepository * repository)
+  {
+    return SetTranslation(repository, probeToTracker, 1.0);
+  }, &secondSnapshot);
+  double translation = -1.0;
+  if (!GetTranslation(firstSnapshot, probeToTracker, translation) || translation != 0.0)
+  {
+    LOG_ERROR("Snapshot was modified by an update, translation: " << translation);
+    numberOfErrors++;
+  }
+  if (secondSnapshot != sharedRepository.GetSnapshot() || !GetTranslation(secondSnapshot, probeToTracker, translation) || translation != 1.0)
+  {
+    LOG_ERROR("Update is not published, translation: " << translation);
+    numberOfErrors++;
+  }
+  if (sharedRepository.GetVersion() != firstVersion + 1)
+  {
+    LOG_ERROR("Version is not incremented by an update");
+    numberOfErrors++;
+  }
+
+  // Snapshots are read while the repository is updated, the translation of the snapshots never decreases
+  std::atomic<bool> writerDone(false);
+  std::atomic<int> readerErrors(0);
+  std::thread reader([&]()
+  {
+    double lastTranslation = 0.0;
+    while (!writerDone)
+    {
+      vtkSmartPointer<vtkIGSIOTransformRepository> snapshot = sharedRepository.GetSnapshot();
+      double snapshotTranslation = 0.0;
+      if (!GetTranslation(snapshot, probeToTracker, snapshotTranslation) || snapshotTranslation < lastTranslation)
+      {
+        readerErrors++;
+      }
+      lastTranslation = snapshotTranslation;
+    }
+  });
+  for (int i = 2; i < numberOfUpdates + 2; i++)
+  {
+    sharedRepository.Update([&probeToTracker, i](vtkIGSIOTransformRepository * repository)
+    {
+      return SetTranslation(repository, probeToTracker, i);
+    });
+  }
+  writerDone = true;
+  reader.join();
+  if (readerErrors > 0)
+  {
+    LOG_ERROR(readerErrors << " inconsistent snapshots were read while the repository was updated");
+    numberOfErrors++;
+  }
+  if (!GetTranslation(sharedRepository.GetSnapshot(), probeToTracker, translation) || translation != numberOfUpdates + 1)
+  {
+    LOG_ERROR("Updates are lost, translation: " << translation);
+    numberOfErrors++;
+  }
+
+  if (numberOfErrors > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfErrors << " errors");
+    return EXIT_FAILURE;
+  }
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,184 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file PlusTrackedFrameColumnsTest.cxx
+  \brief Checks that the columns of a tracked frame list contain the same transforms as transform repository lookups
+  for each frame, also when the transforms stored in the frames change within the list
+*/
+
+#include "PlusConfigure.h"
+#include "PlusTrackedFrameColumns.h"
+
+// IGSIO includes
+#include <vtkIGSIOTrackedFrameList.h>
+#include <vtkIGSIOTransformRepository.h>
+
+// VTK includes
+#include <vtkMatrix4x4.h>
+#include <vtkSmartPointer.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <cmath>
+
+namespace
+{
+  const igsioTransformName PROBE_TO_TRACKER("Probe", "Tracker");
+  const igsioTransformName STYLUS_TO_TRACKER("Stylus", "Tracker");
+  const igsioTransformName IMAGE_TO_PROBE("Image", "Probe");
+  const igsioTransformName IMAGE_TO_TRACKER("Image", "Tracker");
+
+  //----------------------------------------------------------------------------
+  void SetFrameTransform(igsioTrackedFrame& frame, const igsioTransformName& name, double tx, double ty, double tz, ToolStatus status)
+  {
+    vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    matrix->SetElement(0, 3, tx);
+    matrix->SetElement(1, 3, ty);
+    matrix->SetElement(2, 3, tz);
+    frame.SetFrameTransform(name, matrix);
+    frame.SetFrameTransformStatus(name, status);
+  }
+
+  //----------------------------------------------------------------------------
+  // Frames with the probe only, then frames with the probe and the stylus, then frames without the probe
+  void CreateFrames(unsigned int numberOfFrames, vtkIGSIOTrackedFrameList* frameList)
+  {
+    for (unsigned int i = 0; i < numberOfFrames; ++i)
+    {
+      igsioTrackedFrame frame;
+      frame.SetTimestamp(10.0 + i * 0.1);
+      if (i < numberOfFrames * 3 / 4)
+      {
+        SetFrameTransform(frame, PROBE_TO_TRACKER, i, 2.0 * i, -1.0 * i, (i % 5 == 0) ? TOOL_MISSING : TOOL_OK);
+      }
+      if (i >= numberOfFrames / 2)
+      {
+        SetFrameTransform(frame, STYLUS_TO_TRACKER, -1.0 * i, 0.0, 3.0, TOOL_OK);
+      }
+      frameList->AddTrackedFrame(&frame);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp = false;
+  int numberOfFrames = 200;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help");
+  args.AddArgument("--frames", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfFrames, "Number of frames in the list (default: 200)");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  vtkSmartPointer<vtkIGSIOTrackedFrameList> frameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+  CreateFrames(numberOfFrames, frameList);
+
+  // Calibration, not stored in the frames
+  vtkSmartPointer<vtkIGSIOTransformRepository> calibrationRepository = vtkSmartPointer<vtkIGSIOTransformRepository>::New();
+  vtkSmartPointer<vtkMatrix4x4> imageToProbe = vtkSmartPointer<vtkMatrix4x4>::New();
+  imageToProbe->SetElement(0, 0, 0.5);
+  imageToProbe->SetElement(1, 1, 0.5);
+  imageToProbe->SetElement(2, 3, 10.0);
+  calibrationRepository->SetTransform(IMAGE_TO_PROBE, imageToProbe);
+
+  std::vector<igsioTransformName> transformNames;
+  transformNames.push_back(IMAGE_TO_TRACKER);
+  transformNames.push_back(PROBE_TO_TRACKER);
+
+  PlusTrackedFrameColumns columns;
+  if (columns.Build(frameList, transformNames, calibrationRepository) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to build the columns");
+    return EXIT_FAILURE;
+  }
+
+  int numberOfErrors = 0;
+  if (columns.GetNumberOfFrames() != frameList->GetNumberOfTrackedFrames() || columns.GetNumberOfTransforms() != transformNames.size())
+  {
+    LOG_ERROR("Unexpected size of the columns: " << columns.GetNumberOfFrames() << " frames, " << columns.GetNumberOfTransforms() << " transforms");
+    return EXIT_FAILURE;
+  }
+  if (columns.GetTransformIndex(PROBE_TO_TRACKER) != 1 || columns.GetTransformIndex(STYLUS_TO_TRACKER) != -1)
+  {
+    LOG_ERROR("Unexpected transform indices");
+    numberOfErrors++;
+  }
+
+  // Reference: transform repository lookup for each frame
+  vtkSmartPointer<vtkMatrix4x4> expectedMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  for (unsigned int frameIndex = 0; frameIndex < frameList->GetNumberOfTrackedFrames(); ++frameIndex)
+  {
+    igsioTrackedFrame* frame = frameList->GetTrackedFrame(frameIndex);
+    if (columns.GetTimestamps()[frameIndex] != frame->GetTimestamp() || columns.GetImages()[frameIndex] != frame->GetImageData())
+    {
+      LOG_ERROR("Frame " << frameIndex << ": timestamp or image does not match the frame");
+      numberOfErrors++;
+    }
+
+    vtkSmartPointer<vtkIGSIOTransformRepository> frameRepository = vtkSmartPointer<vtkIGSIOTransformRepository>::New();
+    frameRepository->DeepCopy(calibrationRepository, false);
+    frameRepository->SetTransforms(*frame);
+    for (unsigned int t = 0; t < transformNames.size(); ++t)
+    {
+      ToolStatus expectedStatus = TOOL_INVALID;
+      if (frameRepository->IsExistingTransform(transformNames[t]) == PLUS_SUCCESS)
+      {
+        frameRepository->GetTransform(transformNames[t], expectedMatrix, &expectedStatus);
+      }
+      const ToolStatus status = columns.GetStatuses(t)[frameIndex];
+      if ((status == TOOL_OK) != (expectedStatus == TOOL_OK))
+      {
+        LOG_ERROR("Frame " << frameIndex << ": " << transformNames[t].GetTransformName() << " status mismatch");
+        numberOfErrors++;
+        continue;
+      }
+      if (expectedStatus != TOOL_OK)
+      {
+        continue;
+      }
+      const PlusTrackedFrameColumns::Matrix& matrix = columns.GetMatrices(t)[frameIndex];
+      for (int row = 0; row < 4; ++row)
+      {
+        for (int column = 0; column < 4; ++column)
+        {
+          if (std::fabs(matrix[4 * row + column] - expectedMatrix->GetElement(row, column)) > 1e-9)
+          {
+            LOG_ERROR("Frame " << frameIndex << ": " << transformNames[t].GetTransformName() << " element (" << row << ", " << column << ") mismatch: "
+                      << matrix[4 * row + column] << " instead of " << expectedMatrix->GetElement(row, column));
+            numberOfErrors++;
+          }
+        }
+      }
+    }
+  }
+
+  if (numberOfErrors > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfErrors << " errors");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,248 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file PlusUnbufferedSequenceWriterTest.cxx
+  \brief Writes sequence files with PlusUnbufferedSequenceWriter and checks that they are read back unchanged,
+  by vtkPlusSequenceIO and by PlusSequencePrefetchReader
+*/
+
+#include "PlusConfigure.h"
+#include "PlusSequencePrefetchReader.h"
+#include "PlusUnbufferedSequenceWriter.h"
+#include "vtkPlusSequenceIO.h"
+
+// IGSIO includes
+#include <igsioTrackedFrame.h>
+#include <vtkIGSIOTrackedFrameList.h>
+
+// VTK includes
+#include <vtkSmartPointer.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <sstream>
+
+namespace
+{
+  const unsigned int FRAME_SIZE_X = 64;
+  const unsigned int FRAME_SIZE_Y = 48;
+
+  unsigned char GetPixelValue(unsigned int frameIndex, unsigned int pixelIndex)
+  {
+    return static_cast<unsigned char>((frameIndex * 7 + pixelIndex) % 251);
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus CreateFrames(unsigned int firstFrameIndex, unsigned int numberOfFrames, vtkIGSIOTrackedFrameList* frameList)
+  {
+    FrameSizeType frameSize = { FRAME_SIZE_X, FRAME_SIZE_Y, 1 };
+    for (unsigned int frameIndex = firstFrameIndex; frameIndex < firstFrameIndex + numberOfFrames; frameIndex++)
+    {
+      igsioTrackedFrame trackedFrame;
+      igsioVideoFrame* image = trackedFrame.GetImageData();
+      if (image->AllocateFrame(frameSize, VTK_UNSIGNED_CHAR, 1) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to allocate frame " << frameIndex);
+        return PLUS_FAIL;
+      }
+      image->SetImageOrientation(US_IMG_ORIENT_MF);
+      image->SetImageType(US_IMG_BRIGHTNESS);
+      unsigned char* pixels = static_cast<unsigned char*>(image->GetScalarPointer());
+      for (unsigned int i = 0; i < FRAME_SIZE_X * FRAME_SIZE_Y; i++)
+      {
+        pixels[i] = GetPixelValue(frameIndex, i);
+      }
+      trackedFrame.SetTimestamp(10.0 + frameIndex * 0.05);
+      std::ostringstream value;
+      value << "Frame" << frameIndex;
+      trackedFrame.SetFrameField("TestValue", value.str());
+      frameList->AddTrackedFrame(&trackedFrame);
+    }
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus CheckFrame(igsioTrackedFrame* trackedFrame, unsigned int frameIndex)
+  {
+    double expectedTimestamp = 10.0 + frameIndex * 0.05;
+    if (fabs(trackedFrame->GetTimestamp() - expectedTimestamp) > 1e-6)
+    {
+      LOG_ERROR("Timestamp of frame " << frameIndex << " is " << trackedFrame->GetTimestamp() << ", expected " << expectedTimestamp);
+      return PLUS_FAIL;
+    }
+    std::ostringstream expectedValue;
+    expectedValue << "Frame" << frameIndex;
+    if (trackedFrame->GetFrameField("TestValue") != expectedValue.str())
+    {
+      LOG_ERROR("TestValue field of frame " << frameIndex << " is '" << trackedFrame->GetFrameField("TestValue") << "', expected '" << expectedValue.str() << "'");
+      return PLUS_FAIL;
+    }
+    igsioVideoFrame* image = trackedFrame->GetImageData();
+    FrameSizeType frameSize = image->GetFrameSize();
+    if (frameSize[0] != FRAME_SIZE_X || frameSize[1] != FRAME_SIZE_Y)
+    {
+      LOG_ERROR("Size of frame " << frameIndex << " is " << frameSize[0] << "x" << frameSize[1]);
+      return PLUS_FAIL;
+    }
+    const unsigned char* pixels = static_cast<const unsigned char*>(image->GetScalarPointer());
+    for (unsigned int i = 0; i < FRAME_SIZE_X * FRAME_SIZE_Y; i++)
+    {
+      if (pixels[i] != GetPixelValue(frameIndex, i))
+      {
+        LOG_ERROR("Pixel " << i << " of frame " << frameIndex << " is " << int(pixels[i]) << ", expected " << int(GetPixelValue(frameIndex, i)));
+        return PLUS_FAIL;
+      }
+    }
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus TestWriteRead(const std::string& filename, unsigned int numberOfFrames)
+  {
+    PlusUnbufferedSequenceWriter writer;
+    // Small buffers, so that a few frames already fill the queue
+    writer.SetBufferSizeBytes(PlusUnbufferedFileWriter::ALIGNMENT);
+    writer.SetQueueDepth(2);
+    writer.SetPreallocatedSizeBytes(1024 * 1024);
+    if (writer.Open(filename) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to open " << filename);
+      return PLUS_FAIL;
+    }
+
+    // Write the frames in a few chunks, as they are written during recording
+    const unsigned int chunkSize = 7;
+    for (unsigned int firstFrameIndex = 0; firstFrameIndex < numberOfFrames; firstFrameIndex += chunkSize)
+    {
+      vtkSmartPointer<vtkIGSIOTrackedFrameList> frameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+      if (CreateFrames(firstFrameIndex, std::min(chunkSize, numberOfFrames - firstFrameIndex), frameList) != PLUS_SUCCESS
+          || writer.WriteFrames(frameList) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to write frames to " << filename);
+        writer.Discard();
+        return PLUS_FAIL;
+      }
+    }
+    std::string headerFilename = writer.GetFilename();
+    if (writer.Close() != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to close " << headerFilename);
+      return PLUS_FAIL;
+    }
+    LOG_INFO("Written " << headerFilename << ": " << writer.GetStatisticsString());
+
+    vtkSmartPointer<vtkIGSIOTrackedFrameList> readFrames = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+    if (vtkPlusSequenceIO::Read(headerFilename, readFrames) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to read " << headerFilename);
+      return PLUS_FAIL;
+    }
+    if (readFrames->GetNumberOfTrackedFrames() != numberOfFrames)
+    {
+      LOG_ERROR("Number of frames in " << headerFilename << " is " << readFrames->GetNumberOfTrackedFrames() << ", expected " << numberOfFrames);
+      return PLUS_FAIL;
+    }
+
+    for (unsigned int frameIndex = 0; frameIndex < numberOfFrames; frameIndex++)
+    {
+      if (CheckFrame(readFrames->GetTrackedFrame(frameIndex), frameIndex) != PLUS_SUCCESS)
+      {
+        return PLUS_FAIL;
+      }
+    }
+    LOG_INFO("Read back " << numberOfFrames << " frames from " << headerFilename);
+
+    // Frames are read ahead by the worker pool, a few at a time
+    PlusSequencePrefetchReader prefetchReader;
+    prefetchReader.SetMaximumNumberOfPrefetchedFrames(3);
+    if (prefetchReader.Open(headerFilename) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to open " << headerFilename << " for prefetching");
+      return PLUS_FAIL;
+    }
+    if (!prefetchReader.IsStreamed() || prefetchReader.GetNumberOfFrames() != numberOfFrames)
+    {
+      LOG_ERROR("Frames of " << headerFilename << " are not streamed or the number of frames is " << prefetchReader.GetNumberOfFrames());
+      return PLUS_FAIL;
+    }
+    for (unsigned int frameIndex = 0; frameIndex < numberOfFrames; frameIndex++)
+    {
+      std::shared_ptr<igsioTrackedFrame> trackedFrame = prefetchReader.ReadNextFrame();
+      if (trackedFrame == NULL)
+      {
+        LOG_ERROR("Failed to read frame " << frameIndex << " of " << headerFilename << " with prefetching");
+        return PLUS_FAIL;
+      }
+      if (CheckFrame(trackedFrame.get(), frameIndex) != PLUS_SUCCESS)
+      {
+        return PLUS_FAIL;
+      }
+    }
+    if (!prefetchReader.IsAtEnd() || prefetchReader.ReadNextFrame() != NULL)
+    {
+      LOG_ERROR("Prefetch reader returned more frames than the number of frames in " << headerFilename);
+      return PLUS_FAIL;
+    }
+    LOG_INFO("Read back " << numberOfFrames << " frames from " << headerFilename << " with prefetching");
+    return PLUS_SUCCESS;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp = false;
+  int numberOfFrames = 50;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help");
+  args.AddArgument("--frames", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfFrames, "Number of frames to write (default: 50)");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (numberOfFrames < 1)
+  {
+    LOG_ERROR("At least one frame must be written");
+    exit(EXIT_FAILURE);
+  }
+
+  bool success = true;
+  if (TestWriteRead("PlusUnbufferedSequenceWriterTest.mha", numberOfFrames) != PLUS_SUCCESS)
+  {
+    success = false;
+  }
+  if (TestWriteRead("PlusUnbufferedSequenceWriterTest.nrrd", numberOfFrames) != PLUS_SUCCESS)
+  {
+    success = false;
+  }
+
+  if (!success)
+  {
+    LOG_ERROR("PlusUnbufferedSequenceWriterTest failed");
+    return EXIT_FAILURE;
+  }
+  LOG_INFO("PlusUnbufferedSequenceWriterTest completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,144 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file PlusWorkerPoolTest.cxx
+  \brief Runs tasks and nested parallel loops on a PlusWorkerPool and checks that all of them complete
+*/
+
+#include "PlusConfigure.h"
+#include "PlusWorkerPool.h"
+
+// VTK includes
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp = false;
+  int numberOfThreads = 4;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help");
+  args.AddArgument("--threads", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfThreads, "Number of worker threads (default: 4, 0 = number of processor cores)");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  bool success = true;
+  PlusWorkerPool workerPool(numberOfThreads);
+  LOG_INFO("Number of worker threads: " << workerPool.GetNumberOfThreads());
+
+  // Results of submitted functions
+  std::vector<std::future<int> > results;
+  for (int i = 0; i < 100; i++)
+  {
+    results.push_back(workerPool.Submit([i]() { return i * i; }));
+  }
+  for (int i = 0; i < 100; i++)
+  {
+    workerPool.Wait(results[i]);
+    if (results[i].get() != i * i)
+    {
+      LOG_ERROR("Wrong result of task " << i);
+      success = false;
+    }
+  }
+
+  // Nested parallel loops: tasks that wait for other tasks must not block the pool
+  const int numberOfItems = 1000;
+  std::vector<std::atomic<int> > visitCount(numberOfItems * numberOfItems);
+  for (size_t i = 0; i < visitCount.size(); i++)
+  {
+    visitCount[i] = 0;
+  }
+  workerPool.ParallelFor(0, numberOfItems, 0, [&](int first, int last)
+  {
+    for (int i = first; i < last; i++)
+    {
+      workerPool.ParallelFor(0, numberOfItems, 8, [&, i](int innerFirst, int innerLast)
+      {
+        for (int j = innerFirst; j < innerLast; j++)
+        {
+          ++visitCount[i * numberOfItems + j];
+        }
+      });
+    }
+  });
+  for (size_t i = 0; i < visitCount.size(); i++)
+  {
+    if (visitCount[i] != 1)
+    {
+      LOG_ERROR("Item " << i << " of the nested parallel loop is processed " << visitCount[i] << " times instead of once");
+      success = false;
+      break;
+    }
+  }
+
+  // Exceptions of the tasks are forwarded to the caller of ParallelFor
+  bool exceptionForwarded = false;
+  try
+  {
+    workerPool.ParallelFor(0, 100, 10, [](int first, int last)
+    {
+      if (first > 0)
+      {
+        throw std::runtime_error("Test exception");
+      }
+    });
+  }
+  catch (const std::runtime_error&)
+  {
+    exceptionForwarded = true;
+  }
+  if (!exceptionForwarded)
+  {
+    LOG_ERROR("Exception of a task is not forwarded by ParallelFor");
+    success = false;
+  }
+
+  // The shared pool can be used the same way
+  std::atomic<int> sum(0);
+  PlusWorkerPool::GetInstance().ParallelFor(0, 1000, 0, [&sum](int first, int last)
+  {
+    for (int i = first; i < last; i++)
+    {
+      sum += i;
+    }
+  });
+  if (sum != 999 * 1000 / 2)
+  {
+    LOG_ERROR("Wrong sum computed by the shared worker pool: " << sum);
+    success = false;
+  }
+
+  if (!success)
+  {
+    LOG_ERROR("Worker pool test failed");
+    return EXIT_FAILURE;
+  }
+  LOG_INFO("Worker pool test completed successfully");
+  return EXIT_SUCCESS;
+}
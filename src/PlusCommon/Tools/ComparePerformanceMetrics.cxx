@@ -0,0 +1,114 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file ComparePerformanceMetrics.cxx
+  \brief Compares the performance metrics of a benchmark run to a baseline and fails if any of them regressed.
+
+  The metrics files are written by the benchmarks with the --metrics-file argument (see PlusPerformanceMetrics).
+  If the baseline file does not exist yet, or --update-baseline is specified, then the metrics are stored as the new
+  baseline. This way the first run of a reference build records the baseline and the runs of later builds are compared to it.
+*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "PlusPerformanceMetrics.h"
+
+// VTK includes
+#include <vtksys/CommandLineArguments.hxx>
+#include <vtksys/SystemTools.hxx>
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  std::string metricsFileName;
+  std::string baselineFileName;
+  bool updateBaseline(false);
+  double maxThroughputDecreasePercent = 10.0;
+  double maxLatencyIncreasePercent = 25.0;
+  double minLatencyIncreaseMs = 1.0;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--metrics-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &metricsFileName, "Performance metrics file (.json) written by a benchmark.");
+  args.AddArgument("--baseline-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &baselineFileName, "Performance metrics file (.json) of the baseline. It is created from the metrics file if it does not exist.");
+  args.AddArgument("--update-baseline", vtksys::CommandLineArguments::NO_ARGUMENT, &updateBaseline, "Replace the baseline with the metrics file instead of comparing them.");
+  args.AddArgument("--max-throughput-decrease-percent", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &maxThroughputDecreasePercent, "Maximum allowed decrease of throughput metrics compared to the baseline, in percent (default: 10).");
+  args.AddArgument("--max-latency-increase-percent", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &maxLatencyIncreasePercent, "Maximum allowed increase of latency metrics compared to the baseline, in percent (default: 25).");
+  args.AddArgument("--min-latency-increase-ms", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &minLatencyIncreaseMs, "Latency increases smaller than this are always allowed, in milliseconds (default: 1).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments." << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (metricsFileName.empty() || baselineFileName.empty())
+  {
+    LOG_ERROR("--metrics-file and --baseline-file arguments are required!");
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  PlusPerformanceMetrics metrics;
+  if (metrics.ReadFromFile(metricsFileName) != PLUS_SUCCESS)
+  {
+    exit(EXIT_FAILURE);
+  }
+
+  if (updateBaseline || !vtksys::SystemTools::FileExists(baselineFileName.c_str(), true))
+  {
+    std::string baselineDirectory = vtksys::SystemTools::GetFilenamePath(baselineFileName);
+    if (!baselineDirectory.empty() && !vtksys::SystemTools::MakeDirectory(baselineDirectory.c_str()))
+    {
+      LOG_ERROR("Failed to create baseline directory: " << baselineDirectory);
+      exit(EXIT_FAILURE);
+    }
+    if (metrics.WriteToFile(baselineFileName) != PLUS_SUCCESS)
+    {
+      exit(EXIT_FAILURE);
+    }
+    LOG_INFO("Stored " << metrics.GetMetrics().size() << " performance metrics as the baseline: " << baselineFileName);
+    return EXIT_SUCCESS;
+  }
+
+  PlusPerformanceMetrics baseline;
+  if (baseline.ReadFromFile(baselineFileName) != PLUS_SUCCESS)
+  {
+    exit(EXIT_FAILURE);
+  }
+
+  metrics.SetMaximumThroughputDecreasePercent(maxThroughputDecreasePercent);
+  metrics.SetMaximumLatencyIncreasePercent(maxLatencyIncreasePercent);
+  metrics.SetMinimumLatencyIncreaseMs(minLatencyIncreaseMs);
+  std::vector<std::string> regressions;
+  if (metrics.CompareToBaseline(baseline, &regressions) != PLUS_SUCCESS)
+  {
+    for (std::vector<std::string>::iterator regression = regressions.begin(); regression != regressions.end(); ++regression)
+    {
+      LOG_ERROR("Performance regression: " << *regression);
+    }
+    LOG_ERROR(regressions.size() << " of " << baseline.GetMetrics().size() << " performance metrics regressed compared to " << baselineFileName);
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("All " << baseline.GetMetrics().size() << " performance metrics are within the tolerance of the baseline");
+  return EXIT_SUCCESS;
+}
@@ -7,6 +7,8 @@ See License.txt for details.
 // Local includes
 #include "PlusConfigure.h"
 #include "PlusMath.h"
+#include "PlusSequenceStreamReader.h"
+#include "PlusSequenceStreamWriter.h"
 #include "igsioTrackedFrame.h"
 #include "vtkPlusSequenceIO.h"
 #include "vtkIGSIOTrackedFrameList.h"
@@ -22,6 +24,11 @@ See License.txt for details.
 #include <vtksys/CommandLineArguments.hxx>
 #include <vtksys/RegularExpression.hxx>
 
+// STL includes
+#include <algorithm>
+#include <functional>
+#include <limits>
+
 enum OperationType
 {
   UPDATE_FRAME_FIELD_NAME,
@@ -67,6 +74,7 @@ public:
 };
 
 PlusStatus TrimSequenceFile(vtkIGSIOTrackedFrameList* trackedFrameList, unsigned int firstFrameIndex, unsigned int lastFrameIndex);
+PlusStatus TrimSequenceFileByTime(vtkIGSIOTrackedFrameList* trackedFrameList, double firstTimestamp, double lastTimestamp);
 PlusStatus DecimateSequenceFile(vtkIGSIOTrackedFrameList* trackedFrameList, unsigned int decimationFactor);
 PlusStatus UpdateFrameFieldValue(FrameFieldUpdate& fieldUpdate);
 PlusStatus DeleteFrameField(vtkIGSIOTrackedFrameList* trackedFrameList, std::string fieldName);
@@ -74,6 +82,7 @@ PlusStatus ConvertStringToMatrix(std::string& strMatrix, vtkMatrix4x4* matrix);
 PlusStatus AddTransform(vtkIGSIOTrackedFrameList* trackedFrameList, std::vector<std::string> transformNamesToAdd, std::string deviceSetConfigurationFileName);
 PlusStatus FillRectangle(vtkIGSIOTrackedFrameList* trackedFrameList, const std::vector<unsigned int>& fillRectOrigin, const std::vector<unsigned int>& fillRectSize, int fillGrayLevel);
 PlusStatus CropRectangle(vtkIGSIOTrackedFrameList* trackedFrameList, igsioVideoFrame::FlipInfoType& flipInfo, const std::vector<int>& cropRectOrigin, const std::vector<int>& cropRectSize);
+PlusStatus UpdateReferenceTransform(vtkIGSIOTrackedFrameList* trackedFrameList, const std::string& referenceTransformNameStr);
 
 namespace
 {
@@ -198,6 +207,80 @@ PlusStatus AppendTrackedFrameLists(vtkIGSIOTrackedFrameList* trackedFrameList, s
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+// Append the input files (one after the other) to the output file, processing the frames in batches.
+// Only the frames selected by isFrameKept (input frame index in the appended sequence, timestamp) are read.
+// Sequence fields are taken from the first file and they are edited only with the first batch.
+PlusStatus StreamSequenceFiles(const std::vector<std::string>& inputFileNames, const std::string& outputFileName, PlusSequenceStreamWriter& writer,
+                               unsigned int batchSize, bool incrementTimestamps, const std::function<bool(unsigned int, double)>& isFrameKept,
+                               const std::function<PlusStatus(vtkIGSIOTrackedFrameList*, bool)>& editFrames, unsigned int& numberOfInputFrames)
+{
+  numberOfInputFrames = 0;
+  double lastTimestamp = 0;
+  bool firstBatch = true;
+  vtkIGSIOTrackedFrameList* frameList = writer.GetFrameList();
+  for (unsigned int i = 0; i < inputFileNames.size(); i++)
+  {
+    LOG_INFO("Read input sequence file: " << inputFileNames[i]);
+    PlusSequenceStreamReader reader;
+    if (reader.Open(inputFileNames[i]) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Couldn't read sequence file: " << inputFileNames[i]);
+      return PLUS_FAIL;
+    }
+    if (i == 0)
+    {
+      writer.SetImageOrientationInFile(reader.GetImageOrientation());
+      if (writer.Open(outputFileName) != PLUS_SUCCESS)
+      {
+        return PLUS_FAIL;
+      }
+      reader.CopyCustomFields(frameList);
+    }
+
+    double timestampOffset = (incrementTimestamps ? lastTimestamp : 0.0);
+    for (unsigned int f = 0; f < reader.GetNumberOfFrames(); ++f, ++numberOfInputFrames)
+    {
+      double timestamp = timestampOffset + reader.GetFrameTimestamp(f);
+      if (!isFrameKept(numberOfInputFrames, timestamp))
+      {
+        continue;
+      }
+      if (reader.ReadFrame(f, frameList) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Couldn't read frame " << f << " of sequence file: " << inputFileNames[i]);
+        return PLUS_FAIL;
+      }
+      if (incrementTimestamps)
+      {
+        frameList->GetTrackedFrame(frameList->GetNumberOfTrackedFrames() - 1)->SetTimestamp(timestamp);
+      }
+
+      if (frameList->GetNumberOfTrackedFrames() >= batchSize)
+      {
+        if (editFrames(frameList, firstBatch) != PLUS_SUCCESS || writer.WriteFrames() != PLUS_SUCCESS)
+        {
+          return PLUS_FAIL;
+        }
+        firstBatch = false;
+      }
+    }
+    if (incrementTimestamps && reader.GetNumberOfFrames() > 0)
+    {
+      lastTimestamp = timestampOffset + reader.GetFrameTimestamp(reader.GetNumberOfFrames() - 1);
+    }
+  }
+
+  if (frameList->GetNumberOfTrackedFrames() > 0)
+  {
+    if (editFrames(frameList, firstBatch) != PLUS_SUCCESS || writer.WriteFrames() != PLUS_SUCCESS)
+    {
+      return PLUS_FAIL;
+    }
+  }
+  return PLUS_SUCCESS;
+}
+
 //----------------------------------------------------------------------------
 int main(int argc, char** argv)
 {
@@ -212,10 +295,17 @@ int main(int argc, char** argv)
   std::string                     strOperation;
   OperationType                   operation;
   bool                            useCompression = false;
+  int                             numberOfCompressionThreads = 1; // Number of threads used for compression (0 = number of processor cores)
+  int                             compressionLevel = -1; // zlib compression level (-1 = default)
   bool                            incrementTimestamps = false;
+  bool                            writeFrameIndex = false;
+  bool                            streaming = false;
+  int                             streamingBatchSize = 50; // Number of frames that are processed at once in streaming mode
 
   int                             firstFrameIndex = -1; // First frame index used for trimming the sequence file.
   int                             lastFrameIndex = -1; // Last frame index used for trimming the sequence file.
+  double                          firstTimestamp = -std::numeric_limits<double>::max(); // Timestamp of the first frame used for trimming the sequence file.
+  double                          lastTimestamp = std::numeric_limits<double>::max(); // Timestamp of the last frame used for trimming the sequence file.
 
   std::string                     fieldName; // Field name to edit
   std::string                     updatedFieldName;  // Updated field name after edit
@@ -262,6 +352,8 @@ int main(int argc, char** argv)
   // Trimming parameters
   args.AddArgument("--first-frame-index", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &firstFrameIndex, "First frame index used for trimming the sequence file. Index of the first frame of the sequence is 0.");
   args.AddArgument("--last-frame-index", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &lastFrameIndex, "Last frame index used for trimming the sequence file.");
+  args.AddArgument("--first-timestamp", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &firstTimestamp, "Frames before this timestamp (in seconds) are removed when trimming the sequence file. Used instead of the frame indices if specified.");
+  args.AddArgument("--last-timestamp", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &lastTimestamp, "Frames after this timestamp (in seconds) are removed when trimming the sequence file. Used instead of the frame indices if specified.");
 
   // Decimation parameters
   args.AddArgument("--decimation-factor", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &decimationFactor, "Used for DECIMATE operation, where every N-th frame is kept. This parameter specifies N (Default: 2)");
@@ -281,7 +373,12 @@ int main(int argc, char** argv)
   args.AddArgument("--update-reference-transform", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &strUpdatedReferenceTransformName, "Set the reference transform name to update old files by changing all ToolToReference transforms to ToolToTracker transform.");
 
   args.AddArgument("--use-compression", vtksys::CommandLineArguments::NO_ARGUMENT, &useCompression, "Compress sequence file images.");
+  args.AddArgument("--compression-threads", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfCompressionThreads, "Number of threads used for compressing nrrd files. 0 means the number of processor cores (Default: 1).");
+  args.AddArgument("--compression-level", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &compressionLevel, "Compression level, from 1 (fastest) to 9 (smallest). Only used with multi-threaded compression (Default: -1, zlib default).");
   args.AddArgument("--increment-timestamps", vtksys::CommandLineArguments::NO_ARGUMENT, &incrementTimestamps, "Increment timestamps in the order of the input-file-names");
+  args.AddArgument("--write-frame-index", vtksys::CommandLineArguments::NO_ARGUMENT, &writeFrameIndex, "Write a frame index file next to the output file, which allows reading any frame without reading the whole file. Compressed files can only be indexed if they are nrrd files.");
+  args.AddArgument("--streaming", vtksys::CommandLineArguments::NO_ARGUMENT, &streaming, "Process the frames in batches while they are read from the input files and written to the output file, instead of reading all input files into memory. Input files whose frame locations are not known (compressed mha files and compressed nrrd files without frame index) are still read into memory one at a time. Not supported for the MIX operation.");
+  args.AddArgument("--streaming-batch-size", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &streamingBatchSize, "Number of frames that are kept in memory in streaming mode (Default: 50).");
 
   args.AddArgument("--add-transform", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &transformNamesToAdd, "Name of the transform to add to each frame (e.g., StylusTipToTracker); multiple transforms can be added separated by a comma (e.g., StylusTipToReference,ProbeToReference)");
   args.AddArgument("--config-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &deviceSetConfigurationFileName, "Used device set configuration file path and name");
@@ -324,7 +421,8 @@ int main(int argc, char** argv)
     std::cout << "  Requires --add-transform." << std::endl;
 
     std::cout << "- TRIM: Trim sequence file." << std::endl;
-    std::cout << "  Requires --first-frame-index and --last-frame-index." << std::endl;
+    std::cout << "  Requires --first-frame-index and --last-frame-index, or --first-timestamp and/or --last-timestamp." << std::endl;
+    std::cout << "  If there is a single input file that was written with --write-frame-index then only the kept frames are read." << std::endl;
     std::cout << "- DECIMATE: Keep every N-th frame of the sequence file." << std::endl;
     std::cout << "  Requires --decimation-factor." << std::endl;
     std::cout << "- APPEND: Append multiple sequence files (one after the other)." << std::endl;
@@ -341,6 +439,9 @@ int main(int argc, char** argv)
 
     std::cout << "- REMOVE_IMAGE_DATA: Remove image data from a meta file that has both image and tracker data, and keep only the tracker data." << std::endl;
 
+    std::cout << std::endl << "With --streaming all operations except MIX are applied to batches of frames, so the size of the input files is not limited by the available memory." << std::endl;
+    std::cout << "Frames of uncompressed and indexed input files are copied as they are stored in the file, without decoding the whole file." << std::endl;
+
     return EXIT_SUCCESS;
   }
 
@@ -454,319 +555,377 @@ int main(int argc, char** argv)
   ///////////////////////////////////////////////////////////////////
   // Read input files
 
-  vtkSmartPointer<vtkIGSIOTrackedFrameList> trackedFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
-
   if (!inputFileName.empty())
   {
     // Insert file name to the beginning of the list
     inputFileNames.insert(inputFileNames.begin(), inputFileName);
   }
 
-  // Multiple input files are appended unless sequences are mixed
-  PlusStatus status = PLUS_SUCCESS;
-  if (operation == MIX)
-  {
-    status = MixTrackedFrameLists(trackedFrameList, inputFileNames);
-  }
-  else
-  {
-    status = AppendTrackedFrameLists(trackedFrameList, inputFileNames, incrementTimestamps);
-  }
-  if (status == PLUS_FAIL)
-  {
-    return EXIT_FAILURE;
-  }
+  bool trimByTime = (firstTimestamp != -std::numeric_limits<double>::max() || lastTimestamp != std::numeric_limits<double>::max());
+  bool framesSelectedWhileReading = false;
 
   ///////////////////////////////////////////////////////////////////
   // Make the operation
 
-  switch (operation)
+  // Edit a list of frames. Fields of the sequence are only edited if editSequenceFields is true.
+  auto editFrames = [&](vtkIGSIOTrackedFrameList* trackedFrameList, bool editSequenceFields) -> PlusStatus
   {
-    case NO_OPERATION:
-    case APPEND:
-    case MIX:
-      {
-        // No need to do anything just save into output file
-      }
-      break;
-    case TRIM:
-      {
-        if (firstFrameIndex < 0)
+    switch (operation)
+    {
+      case NO_OPERATION:
+      case APPEND:
+      case MIX:
         {
-          firstFrameIndex = 0;
+          // No need to do anything just save into output file
         }
-        if (lastFrameIndex < 0)
+        break;
+      case TRIM:
         {
-          lastFrameIndex = 0;
+          if (framesSelectedWhileReading)
+          {
+            break;
+          }
+          if (trimByTime)
+          {
+            if (TrimSequenceFileByTime(trackedFrameList, firstTimestamp, lastTimestamp) != PLUS_SUCCESS)
+            {
+              LOG_ERROR("Failed to trim sequence file");
+              return PLUS_FAIL;
+            }
+            break;
+          }
+          if (firstFrameIndex < 0)
+          {
+            firstFrameIndex = 0;
+          }
+          if (lastFrameIndex < 0)
+          {
+            lastFrameIndex = 0;
+          }
+          unsigned int firstFrameIndexUint = static_cast<unsigned int>(firstFrameIndex);
+          unsigned int lastFrameIndexUint = static_cast<unsigned int>(lastFrameIndex);
+          if (TrimSequenceFile(trackedFrameList, firstFrameIndexUint, lastFrameIndexUint) != PLUS_SUCCESS)
+          {
+            LOG_ERROR("Failed to trim sequence file");
+            return PLUS_FAIL;
+          }
         }
-        unsigned int firstFrameIndexUint = static_cast<unsigned int>(firstFrameIndex);
-        unsigned int lastFrameIndexUint = static_cast<unsigned int>(lastFrameIndex);
-        if (TrimSequenceFile(trackedFrameList, firstFrameIndexUint, lastFrameIndexUint) != PLUS_SUCCESS)
+        break;
+      case DECIMATE:
         {
-          LOG_ERROR("Failed to trim sequence file");
-          return EXIT_FAILURE;
+          if (framesSelectedWhileReading)
+          {
+            break;
+          }
+          if (DecimateSequenceFile(trackedFrameList, decimationFactor) != PLUS_SUCCESS)
+          {
+            LOG_ERROR("Failed to decimate sequence file");
+            return PLUS_FAIL;
+          }
         }
-      }
-      break;
-    case DECIMATE:
-      {
-        if (DecimateSequenceFile(trackedFrameList, decimationFactor) != PLUS_SUCCESS)
+        break;
+      case UPDATE_FRAME_FIELD_NAME:
         {
-          LOG_ERROR("Failed to decimate sequence file");
-          return EXIT_FAILURE;
-        }
-      }
-      break;
-    case UPDATE_FRAME_FIELD_NAME:
-      {
-        FrameFieldUpdate fieldUpdate;
-        fieldUpdate.TrackedFrameList = trackedFrameList;
-        fieldUpdate.FieldName = fieldName;
-        fieldUpdate.UpdatedFieldName = updatedFieldName;
+          FrameFieldUpdate fieldUpdate;
+          fieldUpdate.TrackedFrameList = trackedFrameList;
+          fieldUpdate.FieldName = fieldName;
+          fieldUpdate.UpdatedFieldName = updatedFieldName;
 
-        if (UpdateFrameFieldValue(fieldUpdate) != PLUS_SUCCESS)
-        {
-          LOG_ERROR("Failed to update frame field name '" << fieldName << "' to '" << updatedFieldName << "'");
-          return EXIT_FAILURE;
-        }
-      }
-      break;
-    case UPDATE_FRAME_FIELD_VALUE:
-      {
-        FrameFieldUpdate fieldUpdate;
-        fieldUpdate.TrackedFrameList = trackedFrameList;
-        fieldUpdate.FieldName = fieldName;
-        fieldUpdate.UpdatedFieldName = updatedFieldName;
-        fieldUpdate.UpdatedFieldValue = updatedFieldValue;
-        fieldUpdate.FrameScalarDecimalDigits = frameScalarDecimalDigits;
-        fieldUpdate.FrameScalarIncrement = frameScalarIncrement;
-        fieldUpdate.FrameScalarStart = frameScalarStart;
-        fieldUpdate.FrameTransformStart = frameTransformStart;
-        fieldUpdate.FrameTransformIncrement = frameTransformIncrement;
-        fieldUpdate.FrameTransformIndexFieldName = strFrameTransformIndexFieldName;
-
-        if (UpdateFrameFieldValue(fieldUpdate) != PLUS_SUCCESS)
-        {
-          LOG_ERROR("Failed to update frame field value");
-          return EXIT_FAILURE;
+          if (UpdateFrameFieldValue(fieldUpdate) != PLUS_SUCCESS)
+          {
+            LOG_ERROR("Failed to update frame field name '" << fieldName << "' to '" << updatedFieldName << "'");
+            return PLUS_FAIL;
+          }
         }
-      }
-      break;
-    case DELETE_FRAME_FIELD:
-      {
-        if (DeleteFrameField(trackedFrameList, fieldName) != PLUS_SUCCESS)
+        break;
+      case UPDATE_FRAME_FIELD_VALUE:
         {
-          LOG_ERROR("Failed to delete frame field");
-          return EXIT_FAILURE;
+          FrameFieldUpdate fieldUpdate;
+          fieldUpdate.TrackedFrameList = trackedFrameList;
+          fieldUpdate.FieldName = fieldName;
+          fieldUpdate.UpdatedFieldName = updatedFieldName;
+          fieldUpdate.UpdatedFieldValue = updatedFieldValue;
+          fieldUpdate.FrameScalarDecimalDigits = frameScalarDecimalDigits;
+          fieldUpdate.FrameScalarIncrement = frameScalarIncrement;
+          fieldUpdate.FrameScalarStart = frameScalarStart;
+          fieldUpdate.FrameTransformStart = frameTransformStart;
+          fieldUpdate.FrameTransformIncrement = frameTransformIncrement;
+          fieldUpdate.FrameTransformIndexFieldName = strFrameTransformIndexFieldName;
+
+          if (UpdateFrameFieldValue(fieldUpdate) != PLUS_SUCCESS)
+          {
+            LOG_ERROR("Failed to update frame field value");
+            return PLUS_FAIL;
+          }
+          // Frame scalar of the next frame, if more frames are edited
+          frameScalarStart = fieldUpdate.FrameScalarStart;
         }
-      }
-      break;
-    case DELETE_FIELD:
-      {
-        // Delete field
-        LOG_INFO("Delete field: " << fieldName);
-        if (trackedFrameList->SetCustomString(fieldName.c_str(), NULL) != PLUS_SUCCESS)
+        break;
+      case DELETE_FRAME_FIELD:
         {
-          LOG_ERROR("Failed to delete field: " << fieldName);
-          return EXIT_FAILURE;
+          if (DeleteFrameField(trackedFrameList, fieldName) != PLUS_SUCCESS)
+          {
+            LOG_ERROR("Failed to delete frame field");
+            return PLUS_FAIL;
+          }
         }
-      }
-      break;
-    case UPDATE_FIELD_NAME:
-      {
-        // Update field name
-        LOG_INFO("Update field name '" << fieldName << "' to  '" << updatedFieldName << "'");
-        const char* fieldValue = trackedFrameList->GetCustomString(fieldName.c_str());
-        if (fieldValue != NULL)
+        break;
+      case DELETE_FIELD:
         {
+          if (!editSequenceFields)
+          {
+            break;
+          }
           // Delete field
+          LOG_INFO("Delete field: " << fieldName);
           if (trackedFrameList->SetCustomString(fieldName.c_str(), NULL) != PLUS_SUCCESS)
           {
             LOG_ERROR("Failed to delete field: " << fieldName);
-            return EXIT_FAILURE;
+            return PLUS_FAIL;
           }
-
-          // Add new field
-          if (trackedFrameList->SetCustomString(updatedFieldName.c_str(), fieldValue) != PLUS_SUCCESS)
+        }
+        break;
+      case UPDATE_FIELD_NAME:
+        {
+          if (!editSequenceFields)
+          {
+            break;
+          }
+          // Update field name
+          LOG_INFO("Update field name '" << fieldName << "' to  '" << updatedFieldName << "'");
+          const char* fieldValue = trackedFrameList->GetCustomString(fieldName.c_str());
+          if (fieldValue != NULL)
           {
-            LOG_ERROR("Failed to update field '" << updatedFieldName << "' with value '" << fieldValue << "'");
-            return EXIT_FAILURE;
+            // Delete field
+            if (trackedFrameList->SetCustomString(fieldName.c_str(), NULL) != PLUS_SUCCESS)
+            {
+              LOG_ERROR("Failed to delete field: " << fieldName);
+              return PLUS_FAIL;
+            }
+
+            // Add new field
+            if (trackedFrameList->SetCustomString(updatedFieldName.c_str(), fieldValue) != PLUS_SUCCESS)
+            {
+              LOG_ERROR("Failed to update field '" << updatedFieldName << "' with value '" << fieldValue << "'");
+              return PLUS_FAIL;
+            }
           }
         }
-      }
-      break;
-    case UPDATE_FIELD_VALUE:
-      {
-        // Update field value
-        LOG_INFO("Update field '" << fieldName << "' with value '" << updatedFieldValue << "'");
-        if (trackedFrameList->SetCustomString(fieldName.c_str(), updatedFieldValue.c_str()) != PLUS_SUCCESS)
+        break;
+      case UPDATE_FIELD_VALUE:
         {
-          LOG_ERROR("Failed to update field '" << fieldName << "' with value '" << updatedFieldValue << "'");
-          return EXIT_FAILURE;
+          if (!editSequenceFields)
+          {
+            break;
+          }
+          // Update field value
+          LOG_INFO("Update field '" << fieldName << "' with value '" << updatedFieldValue << "'");
+          if (trackedFrameList->SetCustomString(fieldName.c_str(), updatedFieldValue.c_str()) != PLUS_SUCCESS)
+          {
+            LOG_ERROR("Failed to update field '" << fieldName << "' with value '" << updatedFieldValue << "'");
+            return PLUS_FAIL;
+          }
         }
-      }
-      break;
-    case ADD_TRANSFORM:
-      {
-        // Add transform
-        LOG_INFO("Add transform '" << transformNamesToAdd << "' using device set configuration file '" << deviceSetConfigurationFileName << "'");
-        std::vector<std::string> transformNamesList;
-        igsioCommon::SplitStringIntoTokens(transformNamesToAdd, ',', transformNamesList);
-        if (AddTransform(trackedFrameList, transformNamesList, deviceSetConfigurationFileName) != PLUS_SUCCESS)
+        break;
+      case ADD_TRANSFORM:
         {
-          LOG_ERROR("Failed to add transform '" << transformNamesToAdd << "' using device set configuration file '" << deviceSetConfigurationFileName << "'");
-          return EXIT_FAILURE;
+          // Add transform
+          LOG_INFO("Add transform '" << transformNamesToAdd << "' using device set configuration file '" << deviceSetConfigurationFileName << "'");
+          std::vector<std::string> transformNamesList;
+          igsioCommon::SplitStringIntoTokens(transformNamesToAdd, ',', transformNamesList);
+          if (AddTransform(trackedFrameList, transformNamesList, deviceSetConfigurationFileName) != PLUS_SUCCESS)
+          {
+            LOG_ERROR("Failed to add transform '" << transformNamesToAdd << "' using device set configuration file '" << deviceSetConfigurationFileName << "'");
+            return PLUS_FAIL;
+          }
         }
-      }
-      break;
-    case FILL_IMAGE_RECTANGLE:
-      {
-        if (rectOriginPix.size() != 2 || rectSizePix.size() != 2)
+        break;
+      case FILL_IMAGE_RECTANGLE:
         {
-          LOG_ERROR("Incorrect size of vector for rectangle origin or size. Aborting.");
-          return PLUS_FAIL;
+          if (rectOriginPix.size() != 2 || rectSizePix.size() != 2)
+          {
+            LOG_ERROR("Incorrect size of vector for rectangle origin or size. Aborting.");
+            return PLUS_FAIL;
+          }
+          if (rectOriginPix[0] < 0 || rectOriginPix[1] < 0 || rectSizePix[0] < 0 || rectSizePix[1] < 0)
+          {
+            LOG_ERROR("Negative value for rectangle origin or size entered. Aborting.");
+            return PLUS_FAIL;
+          }
+          std::vector<unsigned int> rectOriginPixUint(rectOriginPix.begin(), rectOriginPix.end());
+          std::vector<unsigned int> rectSizePixUint(rectSizePix.begin(), rectSizePix.end());
+          // Fill a rectangular region in the image with a solid color
+          if (FillRectangle(trackedFrameList, rectOriginPixUint, rectSizePixUint, fillGrayLevel) != PLUS_SUCCESS)
+          {
+            LOG_ERROR("Failed to fill rectangle");
+            return PLUS_FAIL;
+          }
         }
-        if (rectOriginPix[0] < 0 || rectOriginPix[1] < 0 || rectSizePix[0] < 0 || rectSizePix[1] < 0)
+        break;
+      case CROP:
         {
-          LOG_ERROR("Negative value for rectangle origin or size entered. Aborting.");
-          return PLUS_FAIL;
+          // Crop a rectangular region from the image
+          igsioVideoFrame::FlipInfoType flipInfo;
+          flipInfo.hFlip = flipX;
+          flipInfo.vFlip = flipY;
+          flipInfo.eFlip = flipZ;
+          if (CropRectangle(trackedFrameList, flipInfo, rectOriginPix, rectSizePix) != PLUS_SUCCESS)
+          {
+            LOG_ERROR("Failed to fill rectangle");
+            return PLUS_FAIL;
+          }
         }
-        std::vector<unsigned int> rectOriginPixUint(rectOriginPix.begin(), rectOriginPix.end());
-        std::vector<unsigned int> rectSizePixUint(rectSizePix.begin(), rectSizePix.end());
-        // Fill a rectangular region in the image with a solid color
-        if (FillRectangle(trackedFrameList, rectOriginPixUint, rectSizePixUint, fillGrayLevel) != PLUS_SUCCESS)
+        break;
+      case REMOVE_IMAGE_DATA:
+        // No processing is needed, image data is removed when writing the output
+        break;
+      default:
         {
-          LOG_ERROR("Failed to fill rectangle");
-          return EXIT_FAILURE;
+          LOG_WARNING("Unknown operation is specified: " << strOperation);
+          return PLUS_FAIL;
         }
+    }
+
+    if (!strUpdatedReferenceTransformName.empty())
+    {
+      if (UpdateReferenceTransform(trackedFrameList, strUpdatedReferenceTransformName) != PLUS_SUCCESS)
+      {
+        return PLUS_FAIL;
       }
-      break;
-    case CROP:
+    }
+    return PLUS_SUCCESS;
+  };
+
+  ///////////////////////////////////////////////////////////////////
+  // Edit the frames while they are read and written (streaming)
+
+  if (streaming && operation == MIX)
+  {
+    LOG_WARNING("MIX operation is not supported in streaming mode, all input files are read into memory");
+  }
+  else if (streaming)
+  {
+    unsigned int firstFrameIndexUint = static_cast<unsigned int>(std::max(firstFrameIndex, 0));
+    unsigned int lastFrameIndexUint = static_cast<unsigned int>(std::max(lastFrameIndex, 0));
+    if (operation == TRIM)
+    {
+      if (trimByTime)
       {
-        // Crop a rectangular region from the image
-        igsioVideoFrame::FlipInfoType flipInfo;
-        flipInfo.hFlip = flipX;
-        flipInfo.vFlip = flipY;
-        flipInfo.eFlip = flipZ;
-        if (CropRectangle(trackedFrameList, flipInfo, rectOriginPix, rectSizePix) != PLUS_SUCCESS)
-        {
-          LOG_ERROR("Failed to fill rectangle");
-          return EXIT_FAILURE;
-        }
+        LOG_INFO("Trim sequence file from timestamp " << firstTimestamp << " to timestamp " << lastTimestamp);
       }
-      break;
-    case REMOVE_IMAGE_DATA:
-      // No processing is needed, image data is removed when writing the output
-      break;
-    default:
+      else if (firstFrameIndexUint > lastFrameIndexUint)
       {
-        LOG_WARNING("Unknown operation is specified: " << strOperation);
+        LOG_ERROR("Invalid input range: (" << firstFrameIndexUint << ", " << lastFrameIndexUint << ")");
         return EXIT_FAILURE;
       }
-  }
-
-
-  //////////////////////////////////////////////////////////////////
-  // Convert files to the new file format
-
-  if (!strUpdatedReferenceTransformName.empty())
-  {
-    igsioTransformName referenceTransformName;
-    if (referenceTransformName.SetTransformName(strUpdatedReferenceTransformName.c_str()) != PLUS_SUCCESS)
+      else
+      {
+        LOG_INFO("Trim sequence file from frame #: " << firstFrameIndexUint << " to frame #" << lastFrameIndexUint);
+      }
+    }
+    else if (operation == DECIMATE)
     {
-      LOG_ERROR("Reference transform name is invalid: " << strUpdatedReferenceTransformName);
-      return EXIT_FAILURE;
+      if (decimationFactor < 2)
+      {
+        LOG_ERROR("Invalid decimation factor: " << decimationFactor << ". It must be an integer larger or equal than 2.");
+        return EXIT_FAILURE;
+      }
+      LOG_INFO("Decimate sequence file: keep 1 frame out of every " << decimationFactor << " frames");
     }
 
-    for (unsigned int i = 0; i < trackedFrameList->GetNumberOfTrackedFrames(); ++i)
+    // Frames that are removed by trimming or decimation are not read
+    std::function<bool(unsigned int, double)> isFrameKept = [&](unsigned int frameIndex, double timestamp)
     {
-      igsioTrackedFrame* trackedFrame = trackedFrameList->GetTrackedFrame(i);
-
-      vtkSmartPointer<vtkMatrix4x4> referenceToTrackerMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
-      if (trackedFrame->GetFrameTransform(referenceTransformName, referenceToTrackerMatrix) != PLUS_SUCCESS)
+      if (operation == TRIM)
       {
-        LOG_WARNING("Couldn't get reference transform with name: " << strUpdatedReferenceTransformName);
-        continue;
+        return trimByTime ? (timestamp >= firstTimestamp && timestamp <= lastTimestamp) : (frameIndex >= firstFrameIndexUint && frameIndex <= lastFrameIndexUint);
       }
-
-      std::vector<igsioTransformName> transformNameList;
-      trackedFrame->GetFrameTransformNameList(transformNameList);
-
-      vtkSmartPointer<vtkTransform> toolToTrackerTransform = vtkSmartPointer<vtkTransform>::New();
-      vtkSmartPointer<vtkMatrix4x4> toolToReferenceMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
-      for (unsigned int n = 0; n < transformNameList.size(); ++n)
+      if (operation == DECIMATE)
       {
-        // No need to change the reference transform
-        if (transformNameList[n] == referenceTransformName)
-        {
-          continue;
-        }
-
-        ToolStatus status = TOOL_INVALID;
-        if (trackedFrame->GetFrameTransform(transformNameList[n], toolToReferenceMatrix) != PLUS_SUCCESS)
-        {
-          std::string strTransformName;
-          transformNameList[i].GetTransformName(strTransformName);
-          LOG_ERROR("Failed to get frame transform: " << strTransformName);
-          continue;
-        }
-
-        if (trackedFrame->GetFrameTransformStatus(transformNameList[n], status) != PLUS_SUCCESS)
-        {
-          std::string strTransformName;
-          transformNameList[i].GetTransformName(strTransformName);
-          LOG_ERROR("Failed to get frame transform status: " << strTransformName);
-          continue;
-        }
-
-        // Compute ToolToTracker transform from ToolToReference
-        toolToTrackerTransform->Identity();
-        toolToTrackerTransform->Concatenate(referenceToTrackerMatrix);
-        toolToTrackerTransform->Concatenate(toolToReferenceMatrix);
+        return (frameIndex % decimationFactor) == 0;
+      }
+      return true;
+    };
+    framesSelectedWhileReading = true;
+
+    PlusSequenceStreamWriter writer;
+    writer.SetUseCompression(useCompression);
+    writer.SetEnableImageDataWrite(operation != REMOVE_IMAGE_DATA);
+    writer.SetNumberOfCompressionThreads(numberOfCompressionThreads);
+    writer.SetCompressionLevel(compressionLevel);
+    writer.SetWriteFrameIndex(writeFrameIndex);
+
+    LOG_INFO("Save output sequence file to: " << outputFileName);
+    unsigned int numberOfInputFrames(0);
+    if (StreamSequenceFiles(inputFileNames, outputFileName, writer, static_cast<unsigned int>(std::max(streamingBatchSize, 1)), incrementTimestamps,
+                            isFrameKept, editFrames, numberOfInputFrames) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Couldn't write sequence file: " << outputFileName);
+      return EXIT_FAILURE;
+    }
+    if (operation == TRIM && !trimByTime && lastFrameIndexUint >= numberOfInputFrames)
+    {
+      LOG_ERROR("Invalid input range: (" << firstFrameIndexUint << ", " << lastFrameIndexUint << ")" << " Permitted range within (0, " << static_cast<int>(numberOfInputFrames) - 1 << ")");
+      return EXIT_FAILURE;
+    }
+    if (writer.Close() != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Couldn't write sequence file: " << outputFileName);
+      return EXIT_FAILURE;
+    }
 
-        // Update the name to ToolToTracker
-        igsioTransformName toolToTracker(transformNameList[n].From().c_str(), "Tracker");
-        // Set the new custom transform
-        if (trackedFrame->SetFrameTransform(toolToTracker, toolToTrackerTransform->GetMatrix()) != PLUS_SUCCESS)
-        {
-          std::string strTransformName;
-          transformNameList[i].GetTransformName(strTransformName);
-          LOG_ERROR("Failed to set frame transform: " << strTransformName);
-          continue;
-        }
+    LOG_INFO("Sequence file editing was successful!");
+    return EXIT_SUCCESS;
+  }
 
-        // Use the same status as it was before
-        if (trackedFrame->SetFrameTransformStatus(toolToTracker, status) != PLUS_SUCCESS)
-        {
-          std::string strTransformName;
-          transformNameList[i].GetTransformName(strTransformName);
-          LOG_ERROR("Failed to set frame transform status: " << strTransformName);
-          continue;
-        }
+  ///////////////////////////////////////////////////////////////////
+  // Read input files
 
-        // Delete old transform and status fields
-        std::string oldTransformName, oldTransformStatus;
-        transformNameList[n].GetTransformName(oldTransformName);
-        // Append Transform to the end of the transform name
-        vtksys::RegularExpression isTransform("Transform$");
-        if (!isTransform.find(oldTransformName))
-        {
-          oldTransformName.append("Transform");
-        }
-        oldTransformStatus = oldTransformName;
-        oldTransformStatus.append("Status");
-        trackedFrame->DeleteFrameField(oldTransformName.c_str());
-        trackedFrame->DeleteFrameField(oldTransformStatus.c_str());
+  vtkSmartPointer<vtkIGSIOTrackedFrameList> trackedFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
 
-      }
+  // Multiple input files are appended unless sequences are mixed
+  PlusStatus status = PLUS_SUCCESS;
+  if (operation == MIX)
+  {
+    status = MixTrackedFrameLists(trackedFrameList, inputFileNames);
+  }
+  else if (operation == TRIM && inputFileNames.size() == 1)
+  {
+    // Only read the frames that are kept
+    LOG_INFO("Read input sequence file: " << inputFileNames[0]);
+    if (trimByTime)
+    {
+      LOG_INFO("Trim sequence file from timestamp " << firstTimestamp << " to timestamp " << lastTimestamp);
+      status = vtkPlusSequenceIO::ReadTimeRange(inputFileNames[0], firstTimestamp, lastTimestamp, trackedFrameList);
+    }
+    else
+    {
+      unsigned int firstFrameIndexUint = static_cast<unsigned int>(std::max(firstFrameIndex, 0));
+      unsigned int lastFrameIndexUint = static_cast<unsigned int>(std::max(lastFrameIndex, 0));
+      LOG_INFO("Trim sequence file from frame #: " << firstFrameIndexUint << " to frame #" << lastFrameIndexUint);
+      status = vtkPlusSequenceIO::ReadFrameRange(inputFileNames[0], firstFrameIndexUint, lastFrameIndexUint, trackedFrameList);
     }
+    framesSelectedWhileReading = true;
+  }
+  else
+  {
+    status = AppendTrackedFrameLists(trackedFrameList, inputFileNames, incrementTimestamps);
+  }
+  if (status == PLUS_FAIL)
+  {
+    return EXIT_FAILURE;
+  }
+
+  if (editFrames(trackedFrameList, true) != PLUS_SUCCESS)
+  {
+    return EXIT_FAILURE;
   }
 
   ///////////////////////////////////////////////////////////////////
   // Save output file to file
 
   LOG_INFO("Save output sequence file to: " << outputFileName);
-  if (vtkPlusSequenceIO::Write(outputFileName, trackedFrameList, trackedFrameList->GetImageOrientation(), useCompression, operation != REMOVE_IMAGE_DATA) != PLUS_SUCCESS)
+  if (vtkPlusSequenceIO::Write(outputFileName, trackedFrameList, trackedFrameList->GetImageOrientation(), useCompression, operation != REMOVE_IMAGE_DATA, numberOfCompressionThreads, compressionLevel, writeFrameIndex) != PLUS_SUCCESS)
   {
     LOG_ERROR("Couldn't write sequence file: " << outputFileName);
     return EXIT_FAILURE;
@@ -799,6 +958,32 @@ PlusStatus TrimSequenceFile(vtkIGSIOTrackedFrameList* aTrackedFrameList, unsigne
   return PLUS_SUCCESS;
 }
 
+//-------------------------------------------------------
+PlusStatus TrimSequenceFileByTime(vtkIGSIOTrackedFrameList* aTrackedFrameList, double aFirstTimestamp, double aLastTimestamp)
+{
+  LOG_INFO("Trim sequence file from timestamp " << aFirstTimestamp << " to timestamp " << aLastTimestamp);
+  int firstFrameIndex = -1;
+  int lastFrameIndex = -1;
+  for (unsigned int i = 0; i < aTrackedFrameList->GetNumberOfTrackedFrames(); ++i)
+  {
+    double timestamp = aTrackedFrameList->GetTrackedFrame(i)->GetTimestamp();
+    if (timestamp >= aFirstTimestamp && timestamp <= aLastTimestamp)
+    {
+      if (firstFrameIndex < 0)
+      {
+        firstFrameIndex = i;
+      }
+      lastFrameIndex = i;
+    }
+  }
+  if (firstFrameIndex < 0)
+  {
+    LOG_ERROR("There are no frames between timestamp " << aFirstTimestamp << " and " << aLastTimestamp);
+    return PLUS_FAIL;
+  }
+  return TrimSequenceFile(aTrackedFrameList, static_cast<unsigned int>(firstFrameIndex), static_cast<unsigned int>(lastFrameIndex));
+}
+
 //-------------------------------------------------------
 PlusStatus DecimateSequenceFile(vtkIGSIOTrackedFrameList* aTrackedFrameList, unsigned int decimationFactor)
 {
@@ -963,6 +1148,13 @@ PlusStatus UpdateFrameFieldValue(FrameFieldUpdate& fieldUpdate)
 
   }
 
+  // Continue from the current values if the next frames of the sequence are updated by another call
+  fieldUpdate.FrameScalarStart = scalarVariable;
+  if (fieldUpdate.FrameTransformStart != NULL && fieldUpdate.FrameTransformIndexFieldName.empty())
+  {
+    fieldUpdate.FrameTransformStart->DeepCopy(frameTransform->GetMatrix());
+  }
+
   return (numberOfErrors == 0 ? PLUS_SUCCESS : PLUS_FAIL);
 }
 
@@ -1164,3 +1356,100 @@ PlusStatus CropRectangle(vtkIGSIOTrackedFrameList* trackedFrameList, igsioVideoF
 
   return PLUS_SUCCESS;
 }
+
+//-------------------------------------------------------
+// Change all ToolToReference transforms to ToolToTracker transforms (for updating old files)
+PlusStatus UpdateReferenceTransform(vtkIGSIOTrackedFrameList* trackedFrameList, const std::string& referenceTransformNameStr)
+{
+  igsioTransformName referenceTransformName;
+  if (referenceTransformName.SetTransformName(referenceTransformNameStr.c_str()) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Reference transform name is invalid: " << referenceTransformNameStr);
+    return PLUS_FAIL;
+  }
+
+  for (unsigned int i = 0; i < trackedFrameList->GetNumberOfTrackedFrames(); ++i)
+  {
+    igsioTrackedFrame* trackedFrame = trackedFrameList->GetTrackedFrame(i);
+
+    vtkSmartPointer<vtkMatrix4x4> referenceToTrackerMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    if (trackedFrame->GetFrameTransform(referenceTransformName, referenceToTrackerMatrix) != PLUS_SUCCESS)
+    {
+      LOG_WARNING("Couldn't get reference transform with name: " << referenceTransformNameStr);
+      continue;
+    }
+
+    std::vector<igsioTransformName> transformNameList;
+    trackedFrame->GetFrameTransformNameList(transformNameList);
+
+    vtkSmartPointer<vtkTransform> toolToTrackerTransform = vtkSmartPointer<vtkTransform>::New();
+    vtkSmartPointer<vtkMatrix4x4> toolToReferenceMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    for (unsigned int n = 0; n < transformNameList.size(); ++n)
+    {
+      // No need to change the reference transform
+      if (transformNameList[n] == referenceTransformName)
+      {
+        continue;
+      }
+
+      ToolStatus status = TOOL_INVALID;
+      if (trackedFrame->GetFrameTransform(transformNameList[n], toolToReferenceMatrix) != PLUS_SUCCESS)
+      {
+        std::string strTransformName;
+        transformNameList[i].GetTransformName(strTransformName);
+        LOG_ERROR("Failed to get frame transform: " << strTransformName);
+        continue;
+      }
+
+      if (trackedFrame->GetFrameTransformStatus(transformNameList[n], status) != PLUS_SUCCESS)
+      {
+        std::string strTransformName;
+        transformNameList[i].GetTransformName(strTransformName);
+        LOG_ERROR("Failed to get frame transform status: " << strTransformName);
+        continue;
+      }
+
+      // Compute ToolToTracker transform from ToolToReference
+      toolToTrackerTransform->Identity();
+      toolToTrackerTransform->Concatenate(referenceToTrackerMatrix);
+      toolToTrackerTransform->Concatenate(toolToReferenceMatrix);
+
+      // Update the name to ToolToTracker
+      igsioTransformName toolToTracker(transformNameList[n].From().c_str(), "Tracker");
+      // Set the new custom transform
+      if (trackedFrame->SetFrameTransform(toolToTracker, toolToTrackerTransform->GetMatrix()) != PLUS_SUCCESS)
+      {
+        std::string strTransformName;
+        transformNameList[i].GetTransformName(strTransformName);
+        LOG_ERROR("Failed to set frame transform: " << strTransformName);
+        continue;
+      }
+
+      // Use the same status as it was before
+      if (trackedFrame->SetFrameTransformStatus(toolToTracker, status) != PLUS_SUCCESS)
+      {
+        std::string strTransformName;
+        transformNameList[i].GetTransformName(strTransformName);
+        LOG_ERROR("Failed to set frame transform status: " << strTransformName);
+        continue;
+      }
+
+      // Delete old transform and status fields
+      std::string oldTransformName, oldTransformStatus;
+      transformNameList[n].GetTransformName(oldTransformName);
+      // Append Transform to the end of the transform name
+      vtksys::RegularExpression isTransform("Transform$");
+      if (!isTransform.find(oldTransformName))
+      {
+        oldTransformName.append("Transform");
+      }
+      oldTransformStatus = oldTransformName;
+      oldTransformStatus.append("Status");
+      trackedFrame->DeleteFrameField(oldTransformName.c_str());
+      trackedFrame->DeleteFrameField(oldTransformStatus.c_str());
+
+    }
+  }
+
+  return PLUS_SUCCESS;
+}
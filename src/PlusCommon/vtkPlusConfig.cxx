@@ -5,6 +5,7 @@
 =========================================================Plus=header=end*/
 
 #include "PlusConfigure.h"
+#include "PlusXmlFileCache.h"
 #include "vtkDirectory.h"
 #include "vtkMatrix4x4.h"
 #include "vtkIGSIORecursiveCriticalSection.h"
@@ -125,6 +126,7 @@ void vtkPlusConfig::SetInstance(vtkPlusConfig* instance)
 vtkPlusConfig::vtkPlusConfig()
   : DeviceSetConfigurationData(NULL)
   , ApplicationConfigurationData(NULL)
+  , WorkerThreads(0)
 {
   // vtkIGSIOAccurateTimer will instantiate the logger singleton to a vtkIGSIOLogger
   // Need to instantiate the singleton as a vtkPlusLogger
@@ -238,7 +240,8 @@ vtkXMLDataElement* vtkPlusConfig::CreateDeviceSetConfigurationFromFile(const std
       return NULL;
     }
   }
-  vtkXMLDataElement* configRootElement = vtkXMLUtilities::ReadElementFromFile(configFilePath.c_str());
+  // The file is parsed only if it has changed since it was last read
+  vtkSmartPointer<vtkXMLDataElement> configRootElement = PlusXmlFileCache::GetInstance().ReadElementFromFile(configFilePath);
   if (configRootElement == NULL)
   {
     LOG_ERROR("Reading device set configuration file failed: syntax error in " << aConfigFile);
@@ -247,11 +250,17 @@ vtkXMLDataElement* vtkPlusConfig::CreateDeviceSetConfigurationFromFile(const std
 
   // Print configuration file contents for debugging purposes
   LOG_DEBUG("Device set configuration is read from file: " << aConfigFile);
-  std::ostringstream xmlFileContents;
-  igsioCommon::XML::PrintXML(xmlFileContents, vtkIndent(1), configRootElement);
-  LOG_DEBUG("Device set configuration file contents: " << std::endl << xmlFileContents.str());
+  if (vtkPlusLogger::Instance()->GetLogLevel() >= vtkIGSIOLogger::LOG_LEVEL_DEBUG)
+  {
+    // Printing is expensive for large configurations, so it is skipped if the contents would not be logged anyway
+    std::ostringstream xmlFileContents;
+    igsioCommon::XML::PrintXML(xmlFileContents, vtkIndent(1), configRootElement);
+    LOG_DEBUG("Device set configuration file contents: " << std::endl << xmlFileContents.str());
+  }
 
-  return configRootElement;
+  // The caller takes ownership
+  configRootElement->Register(NULL);
+  return configRootElement.GetPointer();
 }
 
 //-----------------------------------------------------------------------------
@@ -304,6 +313,18 @@ PlusStatus vtkPlusConfig::LoadApplicationConfiguration()
     saveNeeded = true;
   }
 
+  // Read logging options
+  int maximumLogMessageRatePerSource = 0;
+  if (applicationConfigurationRoot->GetScalarAttribute("MaximumLogMessageRatePerSource", maximumLogMessageRatePerSource))
+  {
+    vtkPlusLogger::SetMaximumMessageRatePerSource(maximumLogMessageRatePerSource);
+  }
+  const char* asynchronousLogging = applicationConfigurationRoot->GetAttribute("AsynchronousLogging");
+  if (asynchronousLogging != NULL)
+  {
+    vtkPlusLogger::SetAsynchronousLogging(STRCASECMP(asynchronousLogging, "TRUE") == 0);
+  }
+
   // Read last device set config file
   const char* lastDeviceSetConfigFile = applicationConfigurationRoot->GetAttribute("LastDeviceSetConfigurationFileName");
   if ((lastDeviceSetConfigFile != NULL) && (STRCASECMP(lastDeviceSetConfigFile, "") != 0))
@@ -421,6 +442,24 @@ PlusStatus vtkPlusConfig::LoadApplicationConfiguration()
     saveNeeded = true;
   }
 
+  // Read worker pool settings
+  applicationConfigurationRoot->GetScalarAttribute("WorkerThreads", this->WorkerThreads);
+  this->WorkerThreadAffinity.clear();
+  const char* workerThreadAffinity = applicationConfigurationRoot->GetAttribute("WorkerThreadAffinity");
+  if (workerThreadAffinity != NULL)
+  {
+    std::istringstream cpuIndices(workerThreadAffinity);
+    int cpuIndex = 0;
+    while (cpuIndices >> cpuIndex)
+    {
+      this->WorkerThreadAffinity.push_back(cpuIndex);
+    }
+    if (!cpuIndices.eof())
+    {
+      LOG_WARNING("Invalid WorkerThreadAffinity attribute: '" << workerThreadAffinity << "', expected a list of processor core indices");
+    }
+  }
+
   if (saveNeeded)
   {
     return SaveApplicationConfigurationToFile();
@@ -456,6 +495,14 @@ PlusStatus vtkPlusConfig::WriteApplicationConfiguration()
 
   // Save log level
   applicationConfigurationRoot->SetIntAttribute("LogLevel", vtkPlusLogger::Instance()->GetLogLevel());
+  if (vtkPlusLogger::GetAsynchronousLogging())
+  {
+    applicationConfigurationRoot->SetAttribute("AsynchronousLogging", "TRUE");
+  }
+  if (vtkPlusLogger::GetMaximumMessageRatePerSource() > 0)
+  {
+    applicationConfigurationRoot->SetIntAttribute("MaximumLogMessageRatePerSource", vtkPlusLogger::GetMaximumMessageRatePerSource());
+  }
 
   // Save device set directory
   applicationConfigurationRoot->SetAttribute("DeviceSetConfigurationDirectory", this->DeviceSetConfigurationDirectory.c_str());
@@ -478,9 +525,36 @@ PlusStatus vtkPlusConfig::WriteApplicationConfiguration()
   // Save scripts directory path
   applicationConfigurationRoot->SetAttribute("ScriptsDirectory", this->ScriptsDirectory.c_str());
 
+  // Save worker pool settings
+  if (this->WorkerThreads != 0)
+  {
+    applicationConfigurationRoot->SetIntAttribute("WorkerThreads", this->WorkerThreads);
+  }
+  if (!this->WorkerThreadAffinity.empty())
+  {
+    std::ostringstream cpuIndices;
+    for (std::vector<int>::const_iterator cpuIndex = this->WorkerThreadAffinity.begin(); cpuIndex != this->WorkerThreadAffinity.end(); ++cpuIndex)
+    {
+      cpuIndices << (cpuIndex == this->WorkerThreadAffinity.begin() ? "" : " ") << *cpuIndex;
+    }
+    applicationConfigurationRoot->SetAttribute("WorkerThreadAffinity", cpuIndices.str().c_str());
+  }
+
   return PLUS_SUCCESS;
 }
 
+//-----------------------------------------------------------------------------
+const std::vector<int>& vtkPlusConfig::GetWorkerThreadAffinity() const
+{
+  return this->WorkerThreadAffinity;
+}
+
+//-----------------------------------------------------------------------------
+void vtkPlusConfig::SetWorkerThreadAffinity(const std::vector<int>& cpuIndices)
+{
+  this->WorkerThreadAffinity = cpuIndices;
+}
+
 //-----------------------------------------------------------------------------
 std::string vtkPlusConfig::GetNewDeviceSetConfigurationFileName()
 {
@@ -13,6 +13,8 @@
 #include "vtkObject.h"
 #include "vtkXMLDataElement.h"
 
+#include <vector>
+
 class vtkMatrix4x4;
 class vtkIGSIORecursiveCriticalSection;
 
@@ -213,6 +215,17 @@ public:
   /*! Get application start timestamp */
   vtkGetStdStringMacro(ApplicationStartTimestamp);
 
+  /*!
+    Number of threads of the shared worker pool (see PlusWorkerPool), 0 means the number of processor cores.
+    The pool is created when it is first used, later changes have no effect until the application is restarted.
+  */
+  vtkGetMacro(WorkerThreads, int);
+  vtkSetMacro(WorkerThreads, int);
+
+  /*! Processor cores that the threads of the shared worker pool are bound to. If empty then the threads are not bound. */
+  const std::vector<int>& GetWorkerThreadAffinity() const;
+  void SetWorkerThreadAffinity(const std::vector<int>& cpuIndices);
+
   /*!
     Gets the full path of a Plus executable file.
     executableName should not contain file extension (.exe is added automatically on Windows platforms)
@@ -294,6 +307,12 @@ protected:
   /*! Formatted string timestamp of the application start time - used as a prefix for most outputs */
   std::string ApplicationStartTimestamp;
 
+  /*! Number of threads of the shared worker pool */
+  int WorkerThreads;
+
+  /*! Processor cores of the threads of the shared worker pool */
+  std::vector<int> WorkerThreadAffinity;
+
 private:
   /*! Instance of the singleton */
   static vtkPlusConfig* Instance;
@@ -20,6 +20,7 @@ vtkPlusHTMLGenerator::vtkPlusHTMLGenerator()
   this->Title = NULL;
   this->OutputDirectory = NULL;
   this->BaseFilename = NULL;
+  this->StreamedBodyLength = 0;
   this->SetBaseFilename("PlusReport");
   this->SetTitle("");
   this->HtmlBody.clear();
@@ -29,7 +30,10 @@ vtkPlusHTMLGenerator::vtkPlusHTMLGenerator()
 //----------------------------------------------------------------------------
 vtkPlusHTMLGenerator::~vtkPlusHTMLGenerator()
 {
-
+  if (this->IsStreaming())
+  {
+    this->SaveHtmlPageAutoFilename();
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -43,6 +47,7 @@ void vtkPlusHTMLGenerator::AddHorizontalLine()
 {
   LOG_TRACE("vtkPlusHTMLGenerator::AddHorizontalLine");
   this->HtmlBody << "<hr />" << std::endl;
+  this->FlushStreamedBody();
 }
 
 //----------------------------------------------------------------------------
@@ -69,6 +74,7 @@ void vtkPlusHTMLGenerator::AddImage(const char* imageSource, const char* alt, co
   {
     this->HtmlBody << "<img src='" << imageSource << "' alt='" << alt << "' width='" << widthPx << "' height='" << heightPx << "' />" << std::endl;
   }
+  this->FlushStreamedBody();
 }
 
 //----------------------------------------------------------------------------
@@ -82,6 +88,7 @@ void vtkPlusHTMLGenerator::AddParagraph(const char* paragraph)
   }
 
   this->HtmlBody << "<p>" << paragraph << "</p>" << std::endl;
+  this->FlushStreamedBody();
 }
 
 //----------------------------------------------------------------------------
@@ -101,6 +108,7 @@ void vtkPlusHTMLGenerator::AddLink(const char* linkText, const char* url)
   }
 
   this->HtmlBody << "<a href='" << url << "'>" << linkText << "</a>" << std::endl;
+  this->FlushStreamedBody();
 }
 
 //----------------------------------------------------------------------------
@@ -206,6 +214,7 @@ void vtkPlusHTMLGenerator::AddText(const char* text, HEADINGS h, const char* sty
   }
 
   this->HtmlBody << openTag << text << closeTag << std::endl;
+  this->FlushStreamedBody();
 }
 
 //----------------------------------------------------------------------------
@@ -243,6 +252,7 @@ void vtkPlusHTMLGenerator::AddTable(vtkTable* inputTable, int borderPx)
   }
 
   this->HtmlBody << openTag.str() << table.str() << closeTag << std::endl;
+  this->FlushStreamedBody();
 }
 
 //----------------------------------------------------------------------------
@@ -257,20 +267,36 @@ std::string vtkPlusHTMLGenerator::GetHtmlPage()
 {
   LOG_TRACE("vtkPlusHTMLGenerator::GetHtmlPage");
   std::ostringstream page;
-  page << "<!DOCTYPE html PUBLIC '-//W3C//DTD XHTML 1.0 Transitional//EN' 'http://www.w3.org/TR/xhtml1/DTD/xhtml1-transitional.dtd'>" << std::endl;
-  page << "<html>" << std::endl;
-  page << "<head>" << std::endl;
-  page << "<title>" << this->GetTitle() << "</title>" << std::endl;
-  page << "</head>" << std::endl;
-  page << "<body>" << std::endl;
+  page << this->GetHtmlPageHeader();
   page << this->GetHtmlBody();
-  page << "</body>" << std::endl;
-  page << "</html>";
+  page << this->GetHtmlPageFooter();
   page << std::ends;
 
   return page.str();
 }
 
+//----------------------------------------------------------------------------
+std::string vtkPlusHTMLGenerator::GetHtmlPageHeader()
+{
+  std::ostringstream header;
+  header << "<!DOCTYPE html PUBLIC '-//W3C//DTD XHTML 1.0 Transitional//EN' 'http://www.w3.org/TR/xhtml1/DTD/xhtml1-transitional.dtd'>" << std::endl;
+  header << "<html>" << std::endl;
+  header << "<head>" << std::endl;
+  header << "<title>" << this->GetTitle() << "</title>" << std::endl;
+  header << "</head>" << std::endl;
+  header << "<body>" << std::endl;
+  return header.str();
+}
+
+//----------------------------------------------------------------------------
+std::string vtkPlusHTMLGenerator::GetHtmlPageFooter()
+{
+  std::ostringstream footer;
+  footer << "</body>" << std::endl;
+  footer << "</html>";
+  return footer.str();
+}
+
 //----------------------------------------------------------------------------
 void vtkPlusHTMLGenerator::SaveHtmlPage(const char* fileName)
 {
@@ -282,7 +308,7 @@ void vtkPlusHTMLGenerator::SaveHtmlPage(const char* fileName)
 }
 
 //----------------------------------------------------------------------------
-std::string vtkPlusHTMLGenerator::SaveHtmlPageAutoFilename()
+std::string vtkPlusHTMLGenerator::GetHtmlPageAutoFilename()
 {
   std::string fullPath;
   if (GetOutputDirectory())
@@ -291,11 +317,72 @@ std::string vtkPlusHTMLGenerator::SaveHtmlPageAutoFilename()
     fullPath += "/";
   }
   fullPath += std::string(this->GetBaseFilename()) + "-" + vtkPlusConfig::GetInstance()->GetApplicationStartTimestamp() + ".html";
+  return fullPath;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkPlusHTMLGenerator::SaveHtmlPageAutoFilename()
+{
+  if (this->IsStreaming())
+  {
+    this->FlushStreamedBody();
+    this->StreamedPage << this->GetHtmlPageFooter();
+    this->StreamedPage.close();
+    LOG_INFO("HTML report is completed in " << this->StreamedPageFilename);
+    return this->StreamedPageFilename;
+  }
+
+  std::string fullPath = this->GetHtmlPageAutoFilename();
   LOG_INFO("Write HTML report to " << fullPath);
   SaveHtmlPage(fullPath.c_str());
   return fullPath;
 }
 
+//----------------------------------------------------------------------------
+std::string vtkPlusHTMLGenerator::StartStreamingAutoFilename()
+{
+  if (this->IsStreaming())
+  {
+    return this->StreamedPageFilename;
+  }
+
+  this->StreamedPageFilename = this->GetHtmlPageAutoFilename();
+  this->StreamedPage.open(this->StreamedPageFilename.c_str(), ios::out);
+  if (!this->StreamedPage.is_open())
+  {
+    LOG_ERROR("Failed to open HTML report file for writing: " << this->StreamedPageFilename);
+    return this->StreamedPageFilename;
+  }
+  LOG_INFO("Write HTML report to " << this->StreamedPageFilename);
+  this->StreamedPage << this->GetHtmlPageHeader();
+  this->StreamedBodyLength = 0;
+  this->FlushStreamedBody();
+  return this->StreamedPageFilename;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusHTMLGenerator::IsStreaming() const
+{
+  return this->StreamedPage.is_open();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusHTMLGenerator::FlushStreamedBody()
+{
+  if (!this->IsStreaming())
+  {
+    return;
+  }
+  std::string body = this->HtmlBody.str();
+  if (body.size() > this->StreamedBodyLength)
+  {
+    this->StreamedPage << body.substr(this->StreamedBodyLength);
+    this->StreamedBodyLength = body.size();
+  }
+  // Flush so that the completed sections can be viewed while the report is generated
+  this->StreamedPage.flush();
+}
+
 //----------------------------------------------------------------------------
 std::string vtkPlusHTMLGenerator::AddImageAutoFilename(const char* filenamePostfix, const char* description, const int widthPx/*=0*/, const int heightPx/*=0*/)
 {
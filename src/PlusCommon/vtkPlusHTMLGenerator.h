@@ -11,11 +11,18 @@
 
 #include "vtkObject.h"
 
+#include <fstream>
+
 class vtkTable;
 
 /*!
   \class vtkPlusHTMLGenerator
   \brief class for generating basic html tags
+
+  By default the page is kept in memory and written to file by SaveHtmlPageAutoFilename.
+  In streaming mode (see StartStreamingAutoFilename) each added element is appended to the html file immediately,
+  so that the completed sections of a long report can be viewed while the rest of the report is generated.
+
   \ingroup PlusLibCommon
 */
 class vtkPlusCommonExport vtkPlusHTMLGenerator : public vtkObject
@@ -37,9 +44,22 @@ public:
   vtkTypeMacro(vtkPlusHTMLGenerator, vtkObject);
   virtual void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
 
-  /*! Write the report to html file. Create file in the output directory, including the application start time in the filename. */
+  /*!
+    Write the report to html file. Create file in the output directory, including the application start time in the filename.
+    In streaming mode the end of the page is written and the file is closed.
+  */
   virtual std::string SaveHtmlPageAutoFilename();
 
+  /*!
+    Start writing the report to the html file that SaveHtmlPageAutoFilename would write. Content that is already added and
+    content that is added later is appended to the file immediately.
+    \return Full path to the html file
+  */
+  virtual std::string StartStreamingAutoFilename();
+
+  /*! True if the report is being written to file while it is generated */
+  bool IsStreaming() const;
+
   /*!
     Add image to document.
     \param filenamePostfix Should contain only a simple filename and extension (for example: ErrorHistogram.png).
@@ -95,6 +115,18 @@ protected:
   /*! Get the html page source */
   virtual std::string GetHtmlPage();
 
+  /*! Get the beginning of the html page, up to the body */
+  virtual std::string GetHtmlPageHeader();
+
+  /*! Get the end of the html page, after the body */
+  virtual std::string GetHtmlPageFooter();
+
+  /*! Get the full path of the html file */
+  std::string GetHtmlPageAutoFilename();
+
+  /*! In streaming mode append the part of the body that has not been written yet to the html file */
+  void FlushStreamedBody();
+
   vtkPlusHTMLGenerator();
   virtual ~vtkPlusHTMLGenerator();
 
@@ -104,6 +136,12 @@ protected:
 
   std::ostringstream HtmlBody;
 
+  /*! Html file that the page is written to in streaming mode */
+  std::ofstream StreamedPage;
+  std::string StreamedPageFilename;
+  /*! Number of characters of HtmlBody that have been written to the streamed html file */
+  size_t StreamedBodyLength;
+
 private:
   vtkPlusHTMLGenerator(const vtkPlusHTMLGenerator&);  // Not implemented.
   void operator=(const vtkPlusHTMLGenerator&);  // Not implemented.
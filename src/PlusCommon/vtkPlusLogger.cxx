@@ -8,10 +8,386 @@
 #include "PlusCommon.h"
 #include "vtkPlusLogger.h"
 
+// STL includes
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 //-----------------------------------------------------------------------------
 namespace
 {
   vtkIGSIOSimpleRecursiveCriticalSection LoggerCreationCriticalSection;
+
+  typedef std::chrono::steady_clock Clock;
+
+  /*! Time period of the message rate limit */
+  const double MESSAGE_RATE_PERIOD_SEC = 1.0;
+
+  /*! The writer thread writes the queued messages at least this often */
+  const double FLUSH_INTERVAL_SEC = 0.1;
+
+  //-----------------------------------------------------------------------------
+  struct QueuedLogMessage
+  {
+    vtkIGSIOLogger::LogLevelType Level;
+    std::string Message;
+    const char* FileName;
+    int LineNumber;
+    /*! System time and thread of the LOG_* call, the time column of the log shows when the message is written */
+    double Time;
+    std::thread::id ThreadId;
+  };
+
+  //-----------------------------------------------------------------------------
+  /*! Number of messages that are logged from a source code location in the current rate limit period */
+  struct MessageSourceStatistics
+  {
+    MessageSourceStatistics()
+      : NumberOfLoggedMessages(0)
+      , NumberOfSuppressedMessages(0)
+      , SuppressedMessageLevel(vtkIGSIOLogger::LOG_LEVEL_INFO)
+    {
+    }
+    Clock::time_point PeriodStartTime;
+    int NumberOfLoggedMessages;
+    unsigned long NumberOfSuppressedMessages;
+    vtkIGSIOLogger::LogLevelType SuppressedMessageLevel;
+  };
+
+  //-----------------------------------------------------------------------------
+  /*! Message queue and writer thread of asynchronous logging, and the message rate limit of the LOG_* macros */
+  class LogMessageQueue
+  {
+  public:
+    static LogMessageQueue& GetInstance()
+    {
+      static LogMessageQueue instance;
+      return instance;
+    }
+
+    ~LogMessageQueue()
+    {
+      this->SetAsynchronous(false);
+    }
+
+    //-----------------------------------------------------------------------------
+    void LogMessage(vtkIGSIOLogger::LogLevelType level, const std::string& message, const char* fileName, int lineNumber)
+    {
+      if (this->MaximumMessageRatePerSource > 0)
+      {
+        QueuedLogMessage suppressedMessagesSummary;
+        bool summaryAvailable = false;
+        if (!this->CheckMessageRate(level, fileName, lineNumber, suppressedMessagesSummary, summaryAvailable))
+        {
+          return;
+        }
+        if (summaryAvailable)
+        {
+          this->WriteOrQueue(suppressedMessagesSummary);
+        }
+      }
+      QueuedLogMessage queuedMessage;
+      queuedMessage.Level = level;
+      queuedMessage.Message = message;
+      queuedMessage.FileName = fileName;
+      queuedMessage.LineNumber = lineNumber;
+      queuedMessage.Time = vtkIGSIOAccurateTimer::GetSystemTime();
+      queuedMessage.ThreadId = std::this_thread::get_id();
+      this->WriteOrQueue(queuedMessage);
+    }
+
+    //-----------------------------------------------------------------------------
+    void SetAsynchronous(bool enable)
+    {
+      std::lock_guard<std::mutex> threadGuard(this->ThreadMutex);
+      if (enable == this->Asynchronous)
+      {
+        return;
+      }
+      if (enable)
+      {
+        this->StopRequested = false;
+        this->Asynchronous = true;
+        this->WriterThread = std::thread(&LogMessageQueue::WriterThreadMain, this);
+        return;
+      }
+      {
+        std::lock_guard<std::mutex> queueGuard(this->QueueMutex);
+        this->StopRequested = true;
+        // New messages are written immediately from now on
+        this->Asynchronous = false;
+      }
+      this->QueueNotEmpty.notify_one();
+      this->WriterThread.join();
+      this->Flush();
+    }
+
+    bool IsAsynchronous() const { return this->Asynchronous; }
+
+    //-----------------------------------------------------------------------------
+    void Flush()
+    {
+      // Only one thread writes at a time, so that the messages are written in the order they were queued
+      std::lock_guard<std::mutex> writeGuard(this->WriteMutex);
+      std::vector<QueuedLogMessage> messages;
+      {
+        std::lock_guard<std::mutex> queueGuard(this->QueueMutex);
+        this->TakeQueuedMessages(messages);
+      }
+      this->WriteMessages(messages);
+    }
+
+    //-----------------------------------------------------------------------------
+    void SetMaximumNumberOfQueuedMessages(int maximumNumberOfMessages)
+    {
+      if (maximumNumberOfMessages < 1)
+      {
+        maximumNumberOfMessages = 1;
+      }
+      std::lock_guard<std::mutex> writeGuard(this->WriteMutex);
+      std::vector<QueuedLogMessage> messages;
+      {
+        std::lock_guard<std::mutex> queueGuard(this->QueueMutex);
+        this->TakeQueuedMessages(messages);
+        this->Queue.clear();
+        this->Queue.resize(maximumNumberOfMessages);
+      }
+      this->WriteMessages(messages);
+    }
+
+    int GetMaximumNumberOfQueuedMessages()
+    {
+      std::lock_guard<std::mutex> queueGuard(this->QueueMutex);
+      return static_cast<int>(this->Queue.size());
+    }
+
+    void SetMaximumMessageRatePerSource(int messagesPerSecond)
+    {
+      std::lock_guard<std::mutex> sourceGuard(this->SourceMutex);
+      this->MaximumMessageRatePerSource = (messagesPerSecond > 0 ? messagesPerSecond : 0);
+      this->SourceStatistics.clear();
+    }
+
+    int GetMaximumMessageRatePerSource() const { return this->MaximumMessageRatePerSource; }
+
+    unsigned long GetNumberOfDroppedMessages() const { return this->NumberOfDroppedMessages; }
+    unsigned long GetNumberOfSuppressedMessages() const { return this->NumberOfSuppressedMessages; }
+
+  protected:
+    LogMessageQueue()
+      : Asynchronous(false)
+      , StopRequested(false)
+      , FirstQueuedMessageIndex(0)
+      , NumberOfQueuedMessages(0)
+      , NumberOfDroppedMessages(0)
+      , NumberOfReportedDroppedMessages(0)
+      , NumberOfSuppressedMessages(0)
+      , MaximumMessageRatePerSource(0)
+    {
+      this->Queue.resize(10000);
+    }
+
+    //-----------------------------------------------------------------------------
+    /*! Move all queued messages to the end of the list. QueueMutex must be locked. */
+    void TakeQueuedMessages(std::vector<QueuedLogMessage>& messages)
+    {
+      messages.reserve(messages.size() + this->NumberOfQueuedMessages);
+      for (; this->NumberOfQueuedMessages > 0; --this->NumberOfQueuedMessages)
+      {
+        messages.push_back(std::move(this->Queue[this->FirstQueuedMessageIndex]));
+        this->FirstQueuedMessageIndex = (this->FirstQueuedMessageIndex + 1) % this->Queue.size();
+      }
+      this->FirstQueuedMessageIndex = 0;
+    }
+
+    //-----------------------------------------------------------------------------
+    /*! Write the messages and report the dropped messages. WriteMutex must be locked. */
+    void WriteMessages(const std::vector<QueuedLogMessage>& messages)
+    {
+      for (std::vector<QueuedLogMessage>::const_iterator message = messages.begin(); message != messages.end(); ++message)
+      {
+        WriteQueued(*message);
+      }
+
+      unsigned long numberOfDroppedMessages = this->NumberOfDroppedMessages;
+      if (numberOfDroppedMessages != this->NumberOfReportedDroppedMessages)
+      {
+        std::ostringstream msg;
+        msg << (numberOfDroppedMessages - this->NumberOfReportedDroppedMessages) << " log messages were dropped because the log message queue was full";
+        vtkPlusLogger::Instance()->LogMessage(vtkIGSIOLogger::LOG_LEVEL_WARNING, msg.str().c_str(), __FILE__, __LINE__);
+        this->NumberOfReportedDroppedMessages = numberOfDroppedMessages;
+      }
+    }
+
+    //-----------------------------------------------------------------------------
+    static void Write(const QueuedLogMessage& message)
+    {
+      vtkPlusLogger::Instance()->LogMessage(message.Level, message.Message.c_str(), message.FileName, message.LineNumber);
+    }
+
+    //-----------------------------------------------------------------------------
+    /*! Write a message that was queued, with the time and thread of the LOG_* call in front of it */
+    static void WriteQueued(const QueuedLogMessage& message)
+    {
+      std::ostringstream text;
+      text << "[queued " << std::fixed << std::setprecision(6) << message.Time << " thread " << message.ThreadId << "] " << message.Message;
+      vtkPlusLogger::Instance()->LogMessage(message.Level, text.str().c_str(), message.FileName, message.LineNumber);
+    }
+
+    //-----------------------------------------------------------------------------
+    void WriteOrQueue(QueuedLogMessage& message)
+    {
+      {
+        std::lock_guard<std::mutex> queueGuard(this->QueueMutex);
+        if (this->Asynchronous)
+        {
+          if (this->NumberOfQueuedMessages >= this->Queue.size())
+          {
+            // Never wait for the writer thread
+            ++this->NumberOfDroppedMessages;
+            return;
+          }
+          const vtkIGSIOLogger::LogLevelType level = message.Level;
+          this->Queue[(this->FirstQueuedMessageIndex + this->NumberOfQueuedMessages) % this->Queue.size()] = std::move(message);
+          ++this->NumberOfQueuedMessages;
+          // Errors are written as soon as possible, other messages are collected until the next flush
+          if (level > vtkIGSIOLogger::LOG_LEVEL_ERROR && this->NumberOfQueuedMessages < this->Queue.size() / 2)
+          {
+            return;
+          }
+          this->QueueNotEmpty.notify_one();
+          return;
+        }
+      }
+      Write(message);
+    }
+
+    //-----------------------------------------------------------------------------
+    /*!
+      Returns false if the message exceeds the message rate of its source. If the messages of the source were suppressed in the
+      previous period then summaryAvailable is set and the summary message is returned in suppressedMessagesSummary.
+    */
+    bool CheckMessageRate(vtkIGSIOLogger::LogLevelType level, const char* fileName, int lineNumber, QueuedLogMessage& suppressedMessagesSummary, bool& summaryAvailable)
+    {
+      const Clock::time_point now = Clock::now();
+      std::lock_guard<std::mutex> sourceGuard(this->SourceMutex);
+      MessageSourceStatistics& statistics = this->SourceStatistics[std::make_pair(fileName, lineNumber)];
+      if (std::chrono::duration<double>(now - statistics.PeriodStartTime).count() >= MESSAGE_RATE_PERIOD_SEC)
+      {
+        if (statistics.NumberOfSuppressedMessages > 0)
+        {
+          suppressedMessagesSummary = CreateSummaryMessage(statistics, fileName, lineNumber);
+          summaryAvailable = true;
+        }
+        statistics.PeriodStartTime = now;
+        statistics.NumberOfLoggedMessages = 0;
+        statistics.NumberOfSuppressedMessages = 0;
+      }
+      if (statistics.NumberOfLoggedMessages >= this->MaximumMessageRatePerSource)
+      {
+        ++statistics.NumberOfSuppressedMessages;
+        statistics.SuppressedMessageLevel = level;
+        ++this->NumberOfSuppressedMessages;
+        return false;
+      }
+      ++statistics.NumberOfLoggedMessages;
+      return true;
+    }
+
+    //-----------------------------------------------------------------------------
+    /*! Log the summary of sources that have suppressed messages and did not log since the end of their rate limit period */
+    void LogSuppressedMessagesSummaries()
+    {
+      std::vector<QueuedLogMessage> summaries;
+      {
+        const Clock::time_point now = Clock::now();
+        std::lock_guard<std::mutex> sourceGuard(this->SourceMutex);
+        for (std::map<std::pair<const char*, int>, MessageSourceStatistics>::iterator it = this->SourceStatistics.begin(); it != this->SourceStatistics.end(); ++it)
+        {
+          MessageSourceStatistics& statistics = it->second;
+          if (statistics.NumberOfSuppressedMessages > 0 && std::chrono::duration<double>(now - statistics.PeriodStartTime).count() >= MESSAGE_RATE_PERIOD_SEC)
+          {
+            summaries.push_back(CreateSummaryMessage(statistics, it->first.first, it->first.second));
+            statistics.NumberOfSuppressedMessages = 0;
+          }
+        }
+      }
+      for (std::vector<QueuedLogMessage>::iterator summary = summaries.begin(); summary != summaries.end(); ++summary)
+      {
+        this->WriteOrQueue(*summary);
+      }
+    }
+
+    //-----------------------------------------------------------------------------
+    static QueuedLogMessage CreateSummaryMessage(const MessageSourceStatistics& statistics, const char* fileName, int lineNumber)
+    {
+      std::ostringstream msg;
+      msg << statistics.NumberOfSuppressedMessages << " similar messages were suppressed, because more than " << statistics.NumberOfLoggedMessages
+          << " messages were logged from this location in " << MESSAGE_RATE_PERIOD_SEC << " sec";
+      QueuedLogMessage summary;
+      summary.Level = statistics.SuppressedMessageLevel;
+      summary.Message = msg.str();
+      summary.FileName = fileName;
+      summary.LineNumber = lineNumber;
+      summary.Time = vtkIGSIOAccurateTimer::GetSystemTime();
+      summary.ThreadId = std::this_thread::get_id();
+      return summary;
+    }
+
+    //-----------------------------------------------------------------------------
+    void WriterThreadMain()
+    {
+      Clock::time_point lastSummaryTime = Clock::now();
+      while (true)
+      {
+        {
+          std::unique_lock<std::mutex> queueLock(this->QueueMutex);
+          this->QueueNotEmpty.wait_for(queueLock, std::chrono::duration<double>(FLUSH_INTERVAL_SEC));
+          if (this->StopRequested)
+          {
+            break;
+          }
+        }
+        this->Flush();
+        if (this->MaximumMessageRatePerSource > 0 && std::chrono::duration<double>(Clock::now() - lastSummaryTime).count() >= MESSAGE_RATE_PERIOD_SEC)
+        {
+          this->LogSuppressedMessagesSummaries();
+          lastSummaryTime = Clock::now();
+        }
+      }
+    }
+
+    /*! Guards starting and stopping the writer thread */
+    std::mutex ThreadMutex;
+    std::thread WriterThread;
+    std::atomic<bool> Asynchronous;
+    bool StopRequested;
+
+    /*! Guards the queue */
+    std::mutex QueueMutex;
+    std::condition_variable QueueNotEmpty;
+    /*! Ring buffer of the queued messages */
+    std::vector<QueuedLogMessage> Queue;
+    size_t FirstQueuedMessageIndex;
+    size_t NumberOfQueuedMessages;
+
+    /*! Messages are written by one thread at a time */
+    std::mutex WriteMutex;
+
+    std::atomic<unsigned long> NumberOfDroppedMessages;
+    unsigned long NumberOfReportedDroppedMessages;
+    std::atomic<unsigned long> NumberOfSuppressedMessages;
+
+    /*! Guards the source statistics */
+    std::mutex SourceMutex;
+    std::atomic<int> MaximumMessageRatePerSource;
+    std::map<std::pair<const char*, int>, MessageSourceStatistics> SourceStatistics;
+  };
 }
 
 //-------------------------------------------------------
@@ -54,3 +430,63 @@ vtkIGSIOLogger* vtkPlusLogger::Instance()
 
   return m_pInstance;
 }
+
+//-------------------------------------------------------
+void vtkPlusLogger::LogMessageFromSource(LogLevelType level, const std::string& message, const char* fileName, int lineNumber)
+{
+  LogMessageQueue::GetInstance().LogMessage(level, message, fileName, lineNumber);
+}
+
+//-------------------------------------------------------
+void vtkPlusLogger::SetAsynchronousLogging(bool enable)
+{
+  LogMessageQueue::GetInstance().SetAsynchronous(enable);
+}
+
+//-------------------------------------------------------
+bool vtkPlusLogger::GetAsynchronousLogging()
+{
+  return LogMessageQueue::GetInstance().IsAsynchronous();
+}
+
+//-------------------------------------------------------
+void vtkPlusLogger::SetMaximumNumberOfQueuedMessages(int maximumNumberOfMessages)
+{
+  LogMessageQueue::GetInstance().SetMaximumNumberOfQueuedMessages(maximumNumberOfMessages);
+}
+
+//-------------------------------------------------------
+int vtkPlusLogger::GetMaximumNumberOfQueuedMessages()
+{
+  return LogMessageQueue::GetInstance().GetMaximumNumberOfQueuedMessages();
+}
+
+//-------------------------------------------------------
+void vtkPlusLogger::SetMaximumMessageRatePerSource(int messagesPerSecond)
+{
+  LogMessageQueue::GetInstance().SetMaximumMessageRatePerSource(messagesPerSecond);
+}
+
+//-------------------------------------------------------
+int vtkPlusLogger::GetMaximumMessageRatePerSource()
+{
+  return LogMessageQueue::GetInstance().GetMaximumMessageRatePerSource();
+}
+
+//-------------------------------------------------------
+unsigned long vtkPlusLogger::GetNumberOfDroppedMessages()
+{
+  return LogMessageQueue::GetInstance().GetNumberOfDroppedMessages();
+}
+
+//-------------------------------------------------------
+unsigned long vtkPlusLogger::GetNumberOfSuppressedMessages()
+{
+  return LogMessageQueue::GetInstance().GetNumberOfSuppressedMessages();
+}
+
+//-------------------------------------------------------
+void vtkPlusLogger::FlushQueuedMessages()
+{
+  LogMessageQueue::GetInstance().Flush();
+}
@@ -13,9 +13,24 @@
 // PlusCommon includes
 #include "vtkPlusCommonExport.h"
 
+// STL includes
+#include <sstream>
+#include <string>
+
 /*!
   \class vtkPlusLogger
   \brief Class to abstract away specific sequence file read/write details
+
+  The LOG_* macros of Plus go through LogMessageFromSource. By default messages are written immediately, as in vtkIGSIOLogger.
+  If asynchronous logging is enabled then the calling thread only adds the message to a fixed-size queue and a background
+  thread writes the queued messages to the log file and the console, so that device threads are not stalled by file writes.
+  Messages are dropped (and counted) if the queue is full, the calling thread never waits for the writer.
+  As the time column of the log shows when a queued message is written, the system time and thread id of the LOG_* call
+  are written in front of the message text, for example "[queued 12.345678 thread 140213] message".
+  The number of messages that are logged from the same source code location can be limited, so that a message that is logged
+  for every frame does not flood the log; the number of suppressed messages is logged when the limit is lifted.
+  Messages that are logged by the IGSIO libraries directly are always written immediately.
+
   \ingroup PlusLibCommon
 */
 class vtkPlusCommonExport vtkPlusLogger : public vtkIGSIOLogger
@@ -23,9 +38,63 @@ class vtkPlusCommonExport vtkPlusLogger : public vtkIGSIOLogger
 public:
   static vtkIGSIOLogger* Instance();
 
+  /*!
+    Log a message of the LOG_* macros.
+    The message is written immediately or, if asynchronous logging is enabled, added to the queue of the writer thread.
+  */
+  static void LogMessageFromSource(LogLevelType level, const std::string& message, const char* fileName, int lineNumber);
+
+  /*!
+    Enable or disable asynchronous logging. When it is disabled then the queued messages are written before the writer thread stops.
+    Only messages up to the current log level are queued.
+  */
+  static void SetAsynchronousLogging(bool enable);
+  static bool GetAsynchronousLogging();
+
+  /*! Maximum number of messages in the queue of the writer thread, further messages are dropped. Default: 10000. */
+  static void SetMaximumNumberOfQueuedMessages(int maximumNumberOfMessages);
+  static int GetMaximumNumberOfQueuedMessages();
+
+  /*! Maximum number of messages per second that are logged from the same source code location. 0 means unlimited (default). */
+  static void SetMaximumMessageRatePerSource(int messagesPerSecond);
+  static int GetMaximumMessageRatePerSource();
+
+  /*! Number of messages that were dropped because the queue was full */
+  static unsigned long GetNumberOfDroppedMessages();
+
+  /*! Number of messages that were not logged because their source exceeded the maximum message rate */
+  static unsigned long GetNumberOfSuppressedMessages();
+
+  /*! Write all queued messages now */
+  static void FlushQueuedMessages();
+
 private:
   vtkPlusLogger();
   ~vtkPlusLogger();
 };
 
+// The LOG_* macros of IGSIO are replaced so that the messages go through vtkPlusLogger::LogMessageFromSource
+#define PLUS_LOG_MESSAGE(logLevel, msg) \
+  { \
+    if (vtkPlusLogger::Instance()->GetLogLevel() >= logLevel) \
+    { \
+      std::ostringstream msgStream; \
+      msgStream << msg; \
+      vtkPlusLogger::LogMessageFromSource(logLevel, msgStream.str(), __FILE__, __LINE__); \
+    } \
+  }
+
+#undef LOG_ERROR
+#define LOG_ERROR(msg) PLUS_LOG_MESSAGE(vtkIGSIOLogger::LOG_LEVEL_ERROR, msg)
+#undef LOG_WARNING
+#define LOG_WARNING(msg) PLUS_LOG_MESSAGE(vtkIGSIOLogger::LOG_LEVEL_WARNING, msg)
+#undef LOG_INFO
+#define LOG_INFO(msg) PLUS_LOG_MESSAGE(vtkIGSIOLogger::LOG_LEVEL_INFO, msg)
+#undef LOG_DEBUG
+#define LOG_DEBUG(msg) PLUS_LOG_MESSAGE(vtkIGSIOLogger::LOG_LEVEL_DEBUG, msg)
+#undef LOG_TRACE
+#define LOG_TRACE(msg) PLUS_LOG_MESSAGE(vtkIGSIOLogger::LOG_LEVEL_TRACE, msg)
+#undef LOG_DYNAMIC
+#define LOG_DYNAMIC(msg, logLevel) PLUS_LOG_MESSAGE(logLevel, msg)
+
 #endif // __vtkPlusLogger_h 
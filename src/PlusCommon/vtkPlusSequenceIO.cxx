@@ -5,13 +5,81 @@
 =========================================================Plus=header=end*/
 
 #include "PlusConfigure.h"
+#include "PlusParallelCompressor.h"
+#include "PlusSequenceFrameIndex.h"
 #include "vtkPlusSequenceIO.h"
 
+#include <igsioTrackedFrame.h>
 #include <vtkIGSIOSequenceIO.h>
+#include <vtkIGSIOTrackedFrameList.h>
 
 /// VTK includes
 #include <vtkNew.h>
 
+/// STL includes
+#include <cstdio>
+#include <fstream>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  // If the file is not found in the current directory then try to find it in the image directory, too
+  PlusStatus FindSequenceFile(const std::string& filename, std::string& foundPath)
+  {
+    foundPath = filename;
+    if (!vtksys::SystemTools::FileExists(foundPath.c_str(), true))
+    {
+      if (vtkPlusConfig::GetInstance()->FindImagePath(filename, foundPath) == PLUS_FAIL)
+      {
+        LOG_ERROR("Cannot find sequence metafile: " << filename);
+        return PLUS_FAIL;
+      }
+    }
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  void RemoveFramesOutsideRange(vtkIGSIOTrackedFrameList* frameList, unsigned int firstFrameIndex, unsigned int lastFrameIndex)
+  {
+    if (lastFrameIndex + 1 < frameList->GetNumberOfTrackedFrames())
+    {
+      frameList->RemoveTrackedFrameRange(lastFrameIndex + 1, frameList->GetNumberOfTrackedFrames() - 1);
+    }
+    if (firstFrameIndex > 0)
+    {
+      frameList->RemoveTrackedFrameRange(0, firstFrameIndex - 1);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  // Read a range of frames directly from their location in the file
+  PlusStatus ReadIndexedFrames(const PlusSequenceFrameIndex& frameIndex, unsigned int firstFrameIndex, unsigned int lastFrameIndex, vtkIGSIOTrackedFrameList* frameList)
+  {
+    std::ifstream dataFile(frameIndex.GetDataFilename().c_str(), std::ios::in | std::ios::binary);
+    if (!dataFile.is_open())
+    {
+      LOG_ERROR("Failed to open sequence data file: " << frameIndex.GetDataFilename());
+      return PLUS_FAIL;
+    }
+
+    frameList->Clear();
+    for (PlusSequenceFrameIndex::FrameFieldList::const_iterator field = frameIndex.GetCustomFields().begin(); field != frameIndex.GetCustomFields().end(); ++field)
+    {
+      frameList->SetCustomString(field->first.c_str(), field->second.c_str());
+    }
+    for (unsigned int i = firstFrameIndex; i <= lastFrameIndex; ++i)
+    {
+      igsioTrackedFrame trackedFrame;
+      if (frameIndex.ReadTrackedFrame(dataFile, i, trackedFrame) != PLUS_SUCCESS)
+      {
+        return PLUS_FAIL;
+      }
+      frameList->AddTrackedFrame(&trackedFrame);
+    }
+    return PLUS_SUCCESS;
+  }
+}
+
 //----------------------------------------------------------------------------
 igsioStatus vtkPlusSequenceIO::Write(const std::string& filename, vtkIGSIOTrackedFrameList* frameList, US_IMAGE_ORIENTATION orientationInFile/*=US_IMG_ORIENT_MF*/, bool useCompression/*=true*/, bool enableImageDataWrite/*=true*/)
 {
@@ -23,6 +91,45 @@ igsioStatus vtkPlusSequenceIO::Write(const std::string& filename, vtkIGSIOTracke
   return vtkIGSIOSequenceIO::Write(filename, outputDirectory, frameList, orientationInFile, useCompression, enableImageDataWrite);
 }
 
+//----------------------------------------------------------------------------
+igsioStatus vtkPlusSequenceIO::Write(const std::string& filename, vtkIGSIOTrackedFrameList* frameList, US_IMAGE_ORIENTATION orientationInFile, bool useCompression, bool enableImageDataWrite, int numberOfCompressionThreads, int compressionLevel/*=-1*/, bool writeFrameIndex/*=false*/)
+{
+  std::string fullPath = filename;
+  if (!vtksys::SystemTools::FileIsFullPath(filename))
+  {
+    fullPath = vtkPlusConfig::GetInstance()->GetOutputPath(filename);
+  }
+
+  // Compressed files can only be indexed if they are compressed by CompressFile
+  bool compressAfterWriting = useCompression && enableImageDataWrite && CanCompressInParallel(filename) && (numberOfCompressionThreads != 1 || writeFrameIndex);
+  if (!compressAfterWriting)
+  {
+    if (Write(filename, frameList, orientationInFile, useCompression, enableImageDataWrite) != PLUS_SUCCESS)
+    {
+      return PLUS_FAIL;
+    }
+    if (writeFrameIndex && enableImageDataWrite)
+    {
+      if (useCompression)
+      {
+        LOG_WARNING("Frame index is not written for " << fullPath << ", only uncompressed files and compressed nrrd files can be indexed");
+      }
+      else if (WriteFrameIndex(fullPath) != PLUS_SUCCESS)
+      {
+        LOG_WARNING("Frame index is not written for " << fullPath);
+      }
+    }
+    return PLUS_SUCCESS;
+  }
+
+  // Write the file uncompressed, then compress the image data with multiple threads
+  if (Write(filename, frameList, orientationInFile, false, enableImageDataWrite) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  return CompressFile(fullPath, numberOfCompressionThreads, compressionLevel, writeFrameIndex);
+}
+
 //----------------------------------------------------------------------------
 igsioStatus vtkPlusSequenceIO::Write(const std::string& filename, igsioTrackedFrame* frame, US_IMAGE_ORIENTATION orientationInFile /*= US_IMG_ORIENT_MF*/, bool useCompression /*= true*/, bool enableImageDataWrite /*=true*/)
 {
@@ -37,16 +144,236 @@ igsioStatus vtkPlusSequenceIO::Write(const std::string& filename, igsioTrackedFr
 //----------------------------------------------------------------------------
 igsioStatus vtkPlusSequenceIO::Read(const std::string& trackedSequenceDataFileName, vtkIGSIOTrackedFrameList* frameList)
 {
-  std::string trackedSequenceDataFilePath = trackedSequenceDataFileName;
+  std::string trackedSequenceDataFilePath;
+  if (FindSequenceFile(trackedSequenceDataFileName, trackedSequenceDataFilePath) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  return vtkIGSIOSequenceIO::Read(trackedSequenceDataFilePath, frameList);
+}
+
+//----------------------------------------------------------------------------
+igsioStatus vtkPlusSequenceIO::ReadFrameRange(const std::string& filename, unsigned int firstFrameIndex, unsigned int lastFrameIndex, vtkIGSIOTrackedFrameList* frameList)
+{
+  std::string sequenceFilePath;
+  if (FindSequenceFile(filename, sequenceFilePath) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
 
-  // If file is not found in the current directory then try to find it in the image directory, too
-  if (!vtksys::SystemTools::FileExists(trackedSequenceDataFilePath.c_str(), true))
+  PlusSequenceFrameIndex frameIndex;
+  unsigned int numberOfFrames(0);
+  bool frameIndexAvailable = (frameIndex.ReadSidecarFile(sequenceFilePath) == PLUS_SUCCESS);
+  if (frameIndexAvailable)
+  {
+    numberOfFrames = frameIndex.GetNumberOfFrames();
+  }
+  else
   {
-    if (vtkPlusConfig::GetInstance()->FindImagePath(trackedSequenceDataFileName, trackedSequenceDataFilePath) == PLUS_FAIL)
+    LOG_DEBUG("Location of the frames is not known in " << sequenceFilePath << ", the whole file is read");
+    if (vtkIGSIOSequenceIO::Read(sequenceFilePath, frameList) != PLUS_SUCCESS)
     {
-      LOG_ERROR("Cannot find sequence metafile: " << trackedSequenceDataFileName);
       return PLUS_FAIL;
     }
+    numberOfFrames = frameList->GetNumberOfTrackedFrames();
   }
-  return vtkIGSIOSequenceIO::Read(trackedSequenceDataFilePath, frameList);
+
+  if (firstFrameIndex > lastFrameIndex || lastFrameIndex >= numberOfFrames)
+  {
+    LOG_ERROR("Invalid frame range: (" << firstFrameIndex << ", " << lastFrameIndex << "). Permitted range within (0, " << static_cast<int>(numberOfFrames) - 1 << ")");
+    return PLUS_FAIL;
+  }
+
+  if (!frameIndexAvailable)
+  {
+    RemoveFramesOutsideRange(frameList, firstFrameIndex, lastFrameIndex);
+    return PLUS_SUCCESS;
+  }
+  return ReadIndexedFrames(frameIndex, firstFrameIndex, lastFrameIndex, frameList);
+}
+
+//----------------------------------------------------------------------------
+igsioStatus vtkPlusSequenceIO::ReadTimeRange(const std::string& filename, double startTime, double stopTime, vtkIGSIOTrackedFrameList* frameList)
+{
+  std::string sequenceFilePath;
+  if (FindSequenceFile(filename, sequenceFilePath) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+
+  PlusSequenceFrameIndex frameIndex;
+  unsigned int firstFrameIndex(0);
+  unsigned int lastFrameIndex(0);
+  if (frameIndex.ReadSidecarFile(sequenceFilePath) == PLUS_SUCCESS)
+  {
+    if (frameIndex.GetFrameIndexRange(startTime, stopTime, firstFrameIndex, lastFrameIndex) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("There are no frames between " << startTime << " and " << stopTime << " sec in " << sequenceFilePath);
+      return PLUS_FAIL;
+    }
+    return ReadIndexedFrames(frameIndex, firstFrameIndex, lastFrameIndex, frameList);
+  }
+
+  LOG_DEBUG("Location of the frames is not known in " << sequenceFilePath << ", the whole file is read");
+  if (vtkIGSIOSequenceIO::Read(sequenceFilePath, frameList) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  bool frameFound = false;
+  for (unsigned int i = 0; i < frameList->GetNumberOfTrackedFrames(); ++i)
+  {
+    double timestamp = frameList->GetTrackedFrame(i)->GetTimestamp();
+    if (timestamp >= startTime && timestamp <= stopTime)
+    {
+      if (!frameFound)
+      {
+        firstFrameIndex = i;
+        frameFound = true;
+      }
+      lastFrameIndex = i;
+    }
+  }
+  if (!frameFound)
+  {
+    LOG_ERROR("There are no frames between " << startTime << " and " << stopTime << " sec in " << sequenceFilePath);
+    frameList->Clear();
+    return PLUS_FAIL;
+  }
+  RemoveFramesOutsideRange(frameList, firstFrameIndex, lastFrameIndex);
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+igsioStatus vtkPlusSequenceIO::WriteFrameIndex(const std::string& filename)
+{
+  PlusSequenceFrameIndex frameIndex;
+  if (frameIndex.BuildFromSequenceFile(filename) != PLUS_SUCCESS || frameIndex.WriteSidecarFile() != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to write frame index of " << filename);
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusSequenceIO::CanCompressInParallel(const std::string& filename)
+{
+  return igsioCommon::IsEqualInsensitive(vtksys::SystemTools::GetFilenameLastExtension(filename), ".nrrd");
+}
+
+//----------------------------------------------------------------------------
+igsioStatus vtkPlusSequenceIO::CompressFile(const std::string& filename, int numberOfThreads/*=0*/, int compressionLevel/*=-1*/, bool writeFrameIndex/*=false*/)
+{
+  if (!CanCompressInParallel(filename))
+  {
+    LOG_ERROR("Parallel compression is not supported for file " << filename << ". Only nrrd files can be compressed.");
+    return PLUS_FAIL;
+  }
+
+  // The frame locations are determined from the uncompressed file, then updated with the location of the compressed frames
+  PlusSequenceFrameIndex frameIndex;
+  if (writeFrameIndex && (frameIndex.BuildFromSequenceFile(filename) != PLUS_SUCCESS || frameIndex.GetFrameSizeInBytes() > 0xffffffffULL))
+  {
+    LOG_WARNING("Frame index cannot be written for " << filename);
+    writeFrameIndex = false;
+  }
+
+  std::ifstream input(filename.c_str(), std::ios::in | std::ios::binary);
+  if (!input.is_open())
+  {
+    LOG_ERROR("Failed to open file for compression: " << filename);
+    return PLUS_FAIL;
+  }
+
+  // The header is terminated by an empty line, data follows immediately
+  std::string header;
+  std::string line;
+  bool encodingFound = false;
+  bool headerComplete = false;
+  while (std::getline(input, line))
+  {
+    if (line.empty())
+    {
+      headerComplete = true;
+      break;
+    }
+    if (line.compare(0, 9, "encoding:") == 0)
+    {
+      std::string encoding = igsioCommon::Trim(line.substr(9));
+      if (encoding != "raw")
+      {
+        LOG_ERROR("Cannot compress file " << filename << ", its data is already encoded (" << encoding << ")");
+        return PLUS_FAIL;
+      }
+      line = "encoding: gzip";
+      encodingFound = true;
+    }
+    else if (line.compare(0, 10, "data file:") == 0 || line.compare(0, 9, "datafile:") == 0)
+    {
+      LOG_ERROR("Cannot compress file " << filename << ", files with detached data are not supported");
+      return PLUS_FAIL;
+    }
+    header += line + "\n";
+  }
+  if (!headerComplete || !encodingFound)
+  {
+    LOG_ERROR("Cannot compress file " << filename << ", invalid nrrd header");
+    return PLUS_FAIL;
+  }
+  header += "\n";
+
+  std::string compressedFilename = filename + ".compressing";
+  std::ofstream output(compressedFilename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!output.is_open())
+  {
+    LOG_ERROR("Failed to open file for writing: " << compressedFilename);
+    return PLUS_FAIL;
+  }
+  output.write(header.c_str(), header.size());
+
+  PlusParallelCompressor compressor;
+  compressor.SetNumberOfThreads(numberOfThreads);
+  compressor.SetCompressionLevel(compressionLevel);
+  if (writeFrameIndex)
+  {
+    // Each frame is compressed into a separate block, so that frames can be decompressed individually
+    compressor.SetIndependentBlocks(true);
+    compressor.SetBlockSizeBytes(static_cast<unsigned int>(frameIndex.GetFrameSizeInBytes()));
+  }
+  PlusStatus status = compressor.CompressToGzip(input, output);
+  input.close();
+  output.close();
+  if (status != PLUS_SUCCESS || output.fail())
+  {
+    LOG_ERROR("Failed to compress file " << filename);
+    vtksys::SystemTools::RemoveFile(compressedFilename);
+    return PLUS_FAIL;
+  }
+
+  if (!vtksys::SystemTools::RemoveFile(filename) || std::rename(compressedFilename.c_str(), filename.c_str()) != 0)
+  {
+    LOG_ERROR("Failed to replace " << filename << " by the compressed file " << compressedFilename);
+    return PLUS_FAIL;
+  }
+
+  if (writeFrameIndex)
+  {
+    const std::vector<PlusParallelCompressor::BlockLocation>& blocks = compressor.GetBlockLocations();
+    if (blocks.size() < frameIndex.GetNumberOfFrames())
+    {
+      LOG_WARNING("Frame index cannot be written for " << filename << ", unexpected number of compressed blocks");
+      return PLUS_SUCCESS;
+    }
+    for (unsigned int i = 0; i < frameIndex.GetNumberOfFrames(); ++i)
+    {
+      frameIndex.SetFrameDataLocation(i, header.size() + blocks[i].Offset, blocks[i].Size);
+    }
+    frameIndex.SetFrameDataCompressed(true);
+    if (frameIndex.WriteSidecarFile() != PLUS_SUCCESS)
+    {
+      LOG_WARNING("Failed to write frame index of " << filename);
+    }
+  }
+
+  return PLUS_SUCCESS;
 }
@@ -23,9 +23,46 @@ public:
   /*! Write object contents into file */
   static igsioStatus Write(const std::string& filename, vtkIGSIOTrackedFrameList* frameList, US_IMAGE_ORIENTATION orientationInFile = US_IMG_ORIENT_MF, bool useCompression = true, bool EnableImageDataWrite = true);
 
+  /*!
+    Write object contents into file.
+    If compression is requested and the file format supports it (see CanCompressInParallel) then the image data is compressed
+    by numberOfCompressionThreads threads (0 means the number of processor cores), otherwise the writer compresses the data in a single thread.
+    compressionLevel is the zlib compression level (1 = fastest, 9 = smallest, -1 = default).
+    If writeFrameIndex is true then a frame index sidecar file is written (see WriteFrameIndex).
+  */
+  static igsioStatus Write(const std::string& filename, vtkIGSIOTrackedFrameList* frameList, US_IMAGE_ORIENTATION orientationInFile, bool useCompression, bool EnableImageDataWrite, int numberOfCompressionThreads, int compressionLevel = -1, bool writeFrameIndex = false);
+
   /*! Read file contents into the object */
   static igsioStatus Read(const std::string& filename, vtkIGSIOTrackedFrameList* frameList);
 
+  /*!
+    Read the frames from firstFrameIndex to lastFrameIndex (inclusive) into the object.
+    If the file has an up-to-date frame index (see WriteFrameIndex) then only these frames are read,
+    otherwise the whole file is read. When reading from the frame index, image geometry fields of the file
+    (such as ElementSpacing) are not read into the object.
+  */
+  static igsioStatus ReadFrameRange(const std::string& filename, unsigned int firstFrameIndex, unsigned int lastFrameIndex, vtkIGSIOTrackedFrameList* frameList);
+
+  /*! Read the frames with timestamps between startTime and stopTime (inclusive) into the object, see ReadFrameRange */
+  static igsioStatus ReadTimeRange(const std::string& filename, double startTime, double stopTime, vtkIGSIOTrackedFrameList* frameList);
+
+  /*!
+    Write the frame index sidecar file of an uncompressed MetaImage or NRRD file, which allows direct access to any frame
+    (see PlusSequenceFrameIndex). Compressed files can be indexed by CompressFile.
+  */
+  static igsioStatus WriteFrameIndex(const std::string& filename);
+
+  /*! Returns true if an uncompressed file of this type can be compressed by CompressFile (nrrd file with attached data) */
+  static bool CanCompressInParallel(const std::string& filename);
+
+  /*!
+    Compress the image data of an uncompressed sequence file in place, using multiple threads.
+    Only nrrd files with attached data are supported, the data is written with gzip encoding.
+    If writeFrameIndex is true then each frame is compressed independently and a frame index sidecar file is written,
+    which allows direct access to any compressed frame.
+  */
+  static igsioStatus CompressFile(const std::string& filename, int numberOfThreads = 0, int compressionLevel = -1, bool writeFrameIndex = false);
+
 protected:
   vtkPlusSequenceIO();
   virtual ~vtkPlusSequenceIO();
@@ -686,9 +686,10 @@ std::string AtracsysTracker::ResultToString(AtracsysTracker::ATRACSYS_RESULT res
 }
 
 //----------------------------------------------------------------------------
-AtracsysTracker::ATRACSYS_RESULT AtracsysTracker::GetFiducialsInFrame(std::vector<Fiducial3D>& fiducials)
+AtracsysTracker::ATRACSYS_RESULT AtracsysTracker::GetLastFrame(unsigned int timeoutMs)
 {
-  ftkError err = ftkGetLastFrame(this->Internal->FtkLib, this->Internal->TrackerSN, this->Internal->Frame, 20);
+  // blocks until a new frame is available or the timeout expires
+  ftkError err = ftkGetLastFrame(this->Internal->FtkLib, this->Internal->TrackerSN, this->Internal->Frame, timeoutMs);
   if (err != ftkError::FTK_OK)
   {
     return ERROR_NO_FRAME_AVAILABLE;
@@ -710,6 +711,17 @@ AtracsysTracker::ATRACSYS_RESULT AtracsysTracker::GetFiducialsInFrame(std::vecto
   {
     return ERROR_TOO_MANY_MARKERS;
   }
+  return SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+AtracsysTracker::ATRACSYS_RESULT AtracsysTracker::GetFiducialsInFrame(std::vector<Fiducial3D>& fiducials)
+{
+  ATRACSYS_RESULT result = this->GetLastFrame(20);
+  if (result != SUCCESS)
+  {
+    return result;
+  }
 
   // make sure fiducials vector is empty before populating
   fiducials.clear();
@@ -726,37 +738,41 @@ AtracsysTracker::ATRACSYS_RESULT AtracsysTracker::GetFiducialsInFrame(std::vecto
 //----------------------------------------------------------------------------
 AtracsysTracker::ATRACSYS_RESULT AtracsysTracker::GetMarkersInFrame(std::vector<Marker>& markers)
 {
-  ftkError err = ftkGetLastFrame(this->Internal->FtkLib, this->Internal->TrackerSN, this->Internal->Frame, 20);
-  if (err != ftkError::FTK_OK)
+  size_t numberOfMarkers = 0;
+  ATRACSYS_RESULT result = this->WaitForMarkersInFrame(20, markers, numberOfMarkers);
+  if (result != SUCCESS)
   {
-    return ERROR_NO_FRAME_AVAILABLE;
+    return result;
   }
+  markers.resize(numberOfMarkers);
+  return SUCCESS;
+}
 
-  switch (this->Internal->Frame->markersStat)
+//----------------------------------------------------------------------------
+AtracsysTracker::ATRACSYS_RESULT AtracsysTracker::WaitForMarkersInFrame(unsigned int timeoutMs, std::vector<Marker>& markers, size_t& numberOfMarkers,
+    std::vector<Fiducial3D>* fiducials /* = nullptr */, size_t* numberOfFiducials /* = nullptr */)
+{
+  numberOfMarkers = 0;
+  if (numberOfFiducials != nullptr)
   {
-  case ftkQueryStatus::QS_WAR_SKIPPED:
-    return ERROR_INVALID_FRAME;
-  case ftkQueryStatus::QS_ERR_INVALID_RESERVED_SIZE:
-    return ERROR_INVALID_FRAME;
-  case ftkQueryStatus::QS_OK:
-    break;
-  default:
-    return ERROR_INVALID_FRAME;
+    *numberOfFiducials = 0;
   }
-
-  if (this->Internal->Frame->markersStat == ftkQueryStatus::QS_ERR_OVERFLOW)
+  ATRACSYS_RESULT result = this->GetLastFrame(timeoutMs);
+  if (result != SUCCESS)
   {
-    return ERROR_TOO_MANY_MARKERS;
+    return result;
   }
 
-  // make sure markers vector is empty before populating
-  markers.clear();
-
-  for (size_t m = 0; m < this->Internal->Frame->markersCount; m++)
+  const ftkFrameQuery* frame = this->Internal->Frame;
+  if (markers.size() < frame->markersCount)
   {
-    ftkMarker& marker = this->Internal->Frame->markers[m];
-    vtkNew<vtkMatrix4x4> toolToTracker;
-
+    // markers are kept for the next frames, so the matrices are only allocated when more markers are seen than before
+    markers.resize(frame->markersCount);
+  }
+  for (size_t m = 0; m < frame->markersCount; m++)
+  {
+    const ftkMarker& marker = frame->markers[m];
+    vtkMatrix4x4* toolToTracker = markers[m].GetTransformToTracker();
     for (int row = 0; row < 3; row++)
     {
       toolToTracker->SetElement(row, 3, marker.translationMM[row]);
@@ -765,13 +781,42 @@ AtracsysTracker::ATRACSYS_RESULT AtracsysTracker::GetMarkersInFrame(std::vector<
         toolToTracker->SetElement(row, column, marker.rotation[row][column]);
       }
     }
+    markers[m].SetMarkerInfo((int)marker.geometryId, marker.geometryPresenceMask, marker.registrationErrorMM);
+  }
+  numberOfMarkers = frame->markersCount;
 
-    Marker atracsysMarker((int)marker.geometryId, toolToTracker.GetPointer(), marker.geometryPresenceMask, marker.registrationErrorMM);
-    markers.push_back(atracsysMarker);
+  if (fiducials != nullptr && numberOfFiducials != nullptr)
+  {
+    if (fiducials->size() < frame->threeDFiducialsCount)
+    {
+      fiducials->resize(frame->threeDFiducialsCount);
+    }
+    for (size_t m = 0; m < frame->threeDFiducialsCount; m++)
+    {
+      const ftk3DFiducial& ftkFiducial = frame->threeDFiducials[m];
+      Fiducial3D& fiducial = (*fiducials)[m];
+      fiducial.xMm = ftkFiducial.positionMM.x;
+      fiducial.yMm = ftkFiducial.positionMM.y;
+      fiducial.zMm = ftkFiducial.positionMM.z;
+      fiducial.probability = ftkFiducial.probability;
+    }
+    *numberOfFiducials = frame->threeDFiducialsCount;
   }
   return SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+bool AtracsysTracker::GetLastFrameDeviceTimeSec(double& deviceTimeSec)
+{
+  const ftkFrameQuery* frame = this->Internal->Frame;
+  if (frame == nullptr || frame->imageHeader == nullptr || frame->imageHeaderStat != ftkQueryStatus::QS_OK)
+  {
+    return false;
+  }
+  deviceTimeSec = frame->imageHeader->timestampUS * 1e-6;
+  return true;
+}
+
 //----------------------------------------------------------------------------
 AtracsysTracker::ATRACSYS_RESULT AtracsysTracker::EnableIRStrobe(bool enabled)
 {
@@ -1036,6 +1081,13 @@ AtracsysTracker::Marker::Marker(const AtracsysTracker::Marker& obj)
   this->RegistrationErrorMM = obj.RegistrationErrorMM;
 }
 
+void AtracsysTracker::Marker::SetMarkerInfo(int geometryId, int geometryPresenceMask, float registrationErrorMM)
+{
+  this->GeometryId = geometryId;
+  this->GeometryPresenceMask = geometryPresenceMask;
+  this->RegistrationErrorMM = registrationErrorMM;
+}
+
 int AtracsysTracker::Marker::GetGeometryID()
 {
   return this->GeometryId;
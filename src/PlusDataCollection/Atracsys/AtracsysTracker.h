@@ -90,6 +90,8 @@ public:
     /*! toolToTracker is deep copied */
     Marker(int geometryId, vtkMatrix4x4* toolToTracker, int gpm, float freMm);
     Marker(const Marker&);
+    /*! Set the metadata of the marker, the pose is set in the matrix returned by GetTransformToTracker. Allows reusing markers between frames. */
+    void SetMarkerInfo(int geometryId, int gpm, float freMm);
     int GetGeometryID();
     int GetGeometryPresenceMask();
     vtkMatrix4x4* GetTransformToTracker();
@@ -127,6 +129,18 @@ public:
   /*! */
   ATRACSYS_RESULT GetMarkersInFrame(std::vector<Marker>& markers);
 
+  /*!
+    Wait for a new frame and get the markers (and optionally the fiducials) in it, without allocating memory in the
+    usual case. The elements of the vectors are reused from the previous frames: the vectors are only grown and only
+    their first numberOfMarkers (numberOfFiducials) elements belong to the new frame.
+    Returns ERROR_NO_FRAME_AVAILABLE if no new frame is available within timeoutMs.
+  */
+  ATRACSYS_RESULT WaitForMarkersInFrame(unsigned int timeoutMs, std::vector<Marker>& markers, size_t& numberOfMarkers,
+    std::vector<Fiducial3D>* fiducials = nullptr, size_t* numberOfFiducials = nullptr);
+
+  /*! Get the time when the last frame received by WaitForMarkersInFrame was taken, measured by the clock of the tracker. Returns false if not available. */
+  bool GetLastFrameDeviceTimeSec(double& deviceTimeSec);
+
   /*! */
   ATRACSYS_RESULT EnableIRStrobe(bool enabled);
 
@@ -216,6 +230,9 @@ private:
   // load Atracsys marker geometry ini file
   //bool LoadIniFile(std::ifstream& is, ftkGeometry& geometry);
 
+  // helper function to get the last frame from the tracker into Internal->Frame and check its status
+  ATRACSYS_RESULT GetLastFrame(unsigned int timeoutMs);
+
   // helper function to set spryTrack only options
   ATRACSYS_RESULT SetSpryTrackOnlyOption(int option, int value, ATRACSYS_RESULT errorResult);
 
@@ -19,10 +19,15 @@ See License.txt for details.
 #include <vtkSmartPointer.h>
 
 // System includes
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
 #include <fstream>
 #include <iostream>
 #include <map>
 #include <string>
+#include <thread>
 
 // Atracsys includes
 #include "ftkErrors.h"
@@ -48,6 +53,15 @@ const char* vtkPlusAtracsysTracker::ATRACSYS_COMMAND_SET_LED_RGBF    = "SetLED";
 const char* vtkPlusAtracsysTracker::ATRACSYS_COMMAND_ENABLE_TOOL     = "EnableTool";
 const char* vtkPlusAtracsysTracker::ATRACSYS_COMMAND_ADD_TOOL        = "AddTool";
 
+namespace
+{
+  const char* FIDUCIALS_FIELD_NAME = "AtracsysFiducials";
+  // the acquisition thread checks for stop requests at least this often
+  const unsigned int ACQUISITION_THREAD_FRAME_TIMEOUT_MS = 100;
+  // same as the frame timeout of the polling methods of AtracsysTracker
+  const unsigned int INTERNAL_UPDATE_FRAME_TIMEOUT_MS = 20;
+}
+
 
 //----------------------------------------------------------------------------
 class vtkPlusAtracsysTracker::vtkInternal
@@ -79,6 +93,54 @@ public:
 
   // type of tracker connected
   AtracsysTracker::DEVICE_TYPE DeviceType = AtracsysTracker::UNKNOWN_DEVICE;
+
+  // markers and fiducials of the last frame, the first NumberOfMarkers (NumberOfFiducials) elements are valid.
+  // The elements are reused for all frames to avoid allocations at the tracker frame rate.
+  std::vector<AtracsysTracker::Marker> Markers;
+  size_t NumberOfMarkers = 0;
+  std::vector<AtracsysTracker::Fiducial3D> Fiducials;
+  size_t NumberOfFiducials = 0;
+
+  // frame fields with the fiducials, the string keeps its capacity between frames
+  igsioFieldMapType FiducialFields;
+
+  // matches Plus tool id to the tool source id, to avoid building transform names at each frame
+  std::map<std::string, std::string> ToolIdMappedToSourceId;
+
+  // identity transform for tools that are not seen
+  vtkNew<vtkMatrix4x4> EmptyTransform;
+
+  std::thread AcquisitionThread;
+  std::atomic<bool> AcquisitionThreadRunning{ false };
+
+  const std::string& GetToolSourceId(const std::string& toolId)
+  {
+    std::map<std::string, std::string>::iterator sourceIdIt = this->ToolIdMappedToSourceId.find(toolId);
+    if (sourceIdIt == this->ToolIdMappedToSourceId.end())
+    {
+      igsioTransformName toolTransformName(toolId, this->External->GetToolReferenceFrameName());
+      sourceIdIt = this->ToolIdMappedToSourceId.insert(std::make_pair(toolId, toolTransformName.GetTransformName())).first;
+    }
+    return sourceIdIt->second;
+  }
+
+  void UpdateFiducialFields()
+  {
+    std::pair<igsioFrameFieldFlags, std::string>& field = this->FiducialFields[FIDUCIALS_FIELD_NAME];
+    field.first = FRAMEFIELD_NONE;
+    field.second.clear();
+    char fiducialString[128];
+    for (size_t i = 0; i < this->NumberOfFiducials; i++)
+    {
+      const AtracsysTracker::Fiducial3D& fiducial = this->Fiducials[i];
+      int length = snprintf(fiducialString, sizeof(fiducialString), "%s%.3f %.3f %.3f %.3f", (i > 0 ? " " : ""),
+                            fiducial.xMm, fiducial.yMm, fiducial.zMm, fiducial.probability);
+      if (length > 0)
+      {
+        field.second.append(fiducialString, std::min<size_t>(length, sizeof(fiducialString) - 1));
+      }
+    }
+  }
 };
 
 //----------------------------------------------------------------------------
@@ -91,6 +153,8 @@ vtkPlusAtracsysTracker::vtkPlusAtracsysTracker()
   this->FrameNumber = 0;
   this->StartThreadForInternalUpdates = true;
   this->InternalUpdateRate = 300;
+  this->AsynchronousAcquisition = false;
+  this->RawFiducialsFieldData = false;
 }
 
 //----------------------------------------------------------------------------
@@ -106,6 +170,8 @@ vtkPlusAtracsysTracker::~vtkPlusAtracsysTracker()
 void vtkPlusAtracsysTracker::PrintSelf(ostream& os, vtkIndent indent)
 {
   Superclass::PrintSelf(os, indent);
+  os << indent << "AsynchronousAcquisition: " << this->AsynchronousAcquisition << std::endl;
+  os << indent << "RawFiducialsFieldData: " << this->RawFiducialsFieldData << std::endl;
 }
 
 //----------------------------------------------------------------------------
@@ -129,6 +195,11 @@ PlusStatus vtkPlusAtracsysTracker::ReadConfiguration(vtkXMLDataElement* rootConf
     this->Internal->MaxMeanRegistrationErrorMm = 2.0;
   }
 
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(AsynchronousAcquisition, deviceConfig);
+  // The acquisition thread waits for the frames, so the internal update thread is not needed
+  this->StartThreadForInternalUpdates = !this->AsynchronousAcquisition;
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(RawFiducialsFieldData, deviceConfig);
+
   XML_READ_SCALAR_ATTRIBUTE_NONMEMBER_OPTIONAL(int, ActiveMarkerPairingTimeSec, this->Internal->ActiveMarkerPairingTimeSec, deviceConfig);
   if (this->Internal->ActiveMarkerPairingTimeSec > 15)
   {
@@ -206,6 +277,8 @@ PlusStatus vtkPlusAtracsysTracker::WriteConfiguration(vtkXMLDataElement* rootCon
 {
   LOG_TRACE("vtkPlusAtracsysTracker::WriteConfiguration");
   XML_FIND_DEVICE_ELEMENT_REQUIRED_FOR_WRITING(deviceConfig, rootConfigElement);
+  XML_WRITE_BOOL_ATTRIBUTE(AsynchronousAcquisition, deviceConfig);
+  XML_WRITE_BOOL_ATTRIBUTE(RawFiducialsFieldData, deviceConfig);
   return PLUS_SUCCESS;
 }
 
@@ -330,6 +403,11 @@ PlusStatus vtkPlusAtracsysTracker::InternalDisconnect()
 PlusStatus vtkPlusAtracsysTracker::InternalStartRecording()
 {
   LOG_TRACE("vtkPlusAtracsysTracker::InternalStartRecording");
+  if (this->AsynchronousAcquisition)
+  {
+    this->Internal->AcquisitionThreadRunning = true;
+    this->Internal->AcquisitionThread = std::thread(&vtkPlusAtracsysTracker::AcquisitionThreadFn, this);
+  }
   return PLUS_SUCCESS;
 }
 
@@ -337,6 +415,11 @@ PlusStatus vtkPlusAtracsysTracker::InternalStartRecording()
 PlusStatus vtkPlusAtracsysTracker::InternalStopRecording()
 {
   LOG_TRACE("vtkPlusAtracsysTracker::InternalStopRecording");
+  if (this->Internal->AcquisitionThread.joinable())
+  {
+    this->Internal->AcquisitionThreadRunning = false;
+    this->Internal->AcquisitionThread.join();
+  }
   return PLUS_SUCCESS;
 }
 
@@ -344,11 +427,31 @@ PlusStatus vtkPlusAtracsysTracker::InternalStopRecording()
 PlusStatus vtkPlusAtracsysTracker::InternalUpdate()
 {
   LOG_TRACE("vtkPlusAtracsysTracker::InternalUpdate");
-  const double unfilteredTimestamp = vtkIGSIOAccurateTimer::GetSystemTime();
+  return this->UpdateTools(INTERNAL_UPDATE_FRAME_TIMEOUT_MS);
+}
 
-  std::vector<AtracsysTracker::Marker> markers;
+//----------------------------------------------------------------------------
+void vtkPlusAtracsysTracker::AcquisitionThreadFn()
+{
+  this->ApplyThreadScheduling();
+  while (this->Internal->AcquisitionThreadRunning)
+  {
+    if (this->UpdateTools(ACQUISITION_THREAD_FRAME_TIMEOUT_MS) != PLUS_SUCCESS)
+    {
+      // Give time to the device to recover from errors
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  }
+}
 
-  ATRACSYS_RESULT result = result = this->Internal->Tracker.GetMarkersInFrame(markers);
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusAtracsysTracker::UpdateTools(unsigned int frameTimeoutMs)
+{
+  ATRACSYS_RESULT result = this->Internal->Tracker.WaitForMarkersInFrame(frameTimeoutMs,
+                           this->Internal->Markers, this->Internal->NumberOfMarkers,
+                           this->RawFiducialsFieldData ? &this->Internal->Fiducials : nullptr, &this->Internal->NumberOfFiducials);
+  // the frame is timestamped when it is received
+  const double unfilteredTimestamp = vtkIGSIOAccurateTimer::GetSystemTime();
   if (result == AtracsysTracker::ATRACSYS_RESULT::ERROR_NO_FRAME_AVAILABLE)
   {
     // waiting for frame
@@ -360,29 +463,42 @@ PlusStatus vtkPlusAtracsysTracker::InternalUpdate()
     return PLUS_FAIL;
   }
 
+  // use the exposure time measured by the tracker clock if enabled, otherwise the buffer filters the arrival times
+  double filteredTimestamp = UNDEFINED_TIMESTAMP;
+  double deviceTimeSec = 0.0;
+  if (this->UseDeviceClock && this->Internal->Tracker.GetLastFrameDeviceTimeSec(deviceTimeSec))
+  {
+    filteredTimestamp = this->GetDeviceClockTimestamp(deviceTimeSec, unfilteredTimestamp);
+  }
+
+  const igsioFieldMapType* customFields = nullptr;
+  if (this->RawFiducialsFieldData)
+  {
+    this->Internal->UpdateFiducialFields();
+    customFields = &this->Internal->FiducialFields;
+  }
+
   std::map<int, std::string>::iterator it;
   for (it = this->Internal->FtkGeometryIdMappedToToolId.begin(); it != this->Internal->FtkGeometryIdMappedToToolId.end(); it++)
   {
+    const std::string& toolSourceId = this->Internal->GetToolSourceId(it->second);
     if (std::find(this->DisabledToolIds.begin(), this->DisabledToolIds.end(), it->second) != this->DisabledToolIds.end())
     {
       // tracking of this tool has been disabled
-      vtkNew<vtkMatrix4x4> emptyTransform;
-      igsioTransformName toolTransformName(it->second, this->GetToolReferenceFrameName());
-      std::string toolSourceId = toolTransformName.GetTransformName();
-      ToolTimeStampedUpdate(toolSourceId, emptyTransform.GetPointer(), TOOL_OUT_OF_VIEW, this->FrameNumber, unfilteredTimestamp);
+      this->UpdateTool(toolSourceId, this->Internal->EmptyTransform.GetPointer(), TOOL_OUT_OF_VIEW, this->FrameNumber, unfilteredTimestamp, filteredTimestamp, customFields);
       continue;
     }
     bool toolUpdated = false;
 
-    std::vector<AtracsysTracker::Marker>::iterator mit;
-    for (mit = markers.begin(); mit != markers.end(); mit++)
+    for (size_t markerIndex = 0; markerIndex < this->Internal->NumberOfMarkers; markerIndex++)
     {
-      if (it->first != mit->GetGeometryID())
+      AtracsysTracker::Marker& marker = this->Internal->Markers[markerIndex];
+      if (it->first != marker.GetGeometryID())
       {
         continue;
       }
       // check if tool marker registration falls above maximum
-      if (mit->GetFiducialRegistrationErrorMm() > this->Internal->MaxMeanRegistrationErrorMm)
+      if (marker.GetFiducialRegistrationErrorMm() > this->Internal->MaxMeanRegistrationErrorMm)
       {
         LOG_WARNING("Maximum mean marker fiducial registration error exceeded for tool: " << it->second);
         continue;
@@ -390,26 +506,32 @@ PlusStatus vtkPlusAtracsysTracker::InternalUpdate()
 
       // tool is seen with acceptable registration error
       toolUpdated = true;
-      igsioTransformName toolTransformName(it->second, this->GetToolReferenceFrameName());
-      std::string toolSourceId = toolTransformName.GetTransformName();
-      ToolTimeStampedUpdate(toolSourceId, mit->GetTransformToTracker(), TOOL_OK, this->FrameNumber, unfilteredTimestamp);
+      this->UpdateTool(toolSourceId, marker.GetTransformToTracker(), TOOL_OK, this->FrameNumber, unfilteredTimestamp, filteredTimestamp, customFields);
     }
 
     if (!toolUpdated)
     {
       // tool is not seen in this frame
-      vtkNew<vtkMatrix4x4> emptyTransform;
-      igsioTransformName toolTransformName(it->second, this->GetToolReferenceFrameName());
-      std::string toolSourceId = toolTransformName.GetTransformName();
-      ToolTimeStampedUpdate(toolSourceId, emptyTransform.GetPointer(), TOOL_OUT_OF_VIEW, this->FrameNumber, unfilteredTimestamp);
+      this->UpdateTool(toolSourceId, this->Internal->EmptyTransform.GetPointer(), TOOL_OUT_OF_VIEW, this->FrameNumber, unfilteredTimestamp, filteredTimestamp, customFields);
     }
   }
 
   this->FrameNumber++;
- 
+
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusAtracsysTracker::UpdateTool(const std::string& toolSourceId, vtkMatrix4x4* matrix, ToolStatus status,
+    unsigned long frameNumber, double unfilteredTimestamp, double filteredTimestamp, const igsioFieldMapType* customFields)
+{
+  if (filteredTimestamp == UNDEFINED_TIMESTAMP)
+  {
+    return this->ToolTimeStampedUpdate(toolSourceId, matrix, status, frameNumber, unfilteredTimestamp, customFields);
+  }
+  return this->ToolTimeStampedUpdateWithoutFiltering(toolSourceId, matrix, status, unfilteredTimestamp, filteredTimestamp, customFields);
+}
+
 //----------------------------------------------------------------------------
 // Command methods
 //----------------------------------------------------------------------------
@@ -17,6 +17,13 @@ See License.txt for details.
 \brief Interface to the Atracsys trackers
 This class talks with a Atracsys Tracker over the sTk Passive Tracking SDK.
 Requires PLUS_USE_ATRACSYS option in CMake.
+
+If AsynchronousAcquisition is enabled then an acquisition thread waits for each new frame of the tracker and
+updates the tools as soon as it arrives, so the update rate follows the frame rate of the tracker (up to 335Hz for
+fusionTrack) instead of the AcquisitionRate of the device. The markers of the frames are stored in preallocated
+storage that is reused for all frames.
+If RawFiducialsFieldData is enabled then the 3D positions of all fiducials seen in the frame are stored in the
+AtracsysFiducials field of the tool items, as "x y z probability" values separated by spaces.
 \ingroup PlusLibDataCollection
 */
 class vtkPlusDataCollectionExport vtkPlusAtracsysTracker : public vtkPlusDevice
@@ -48,6 +55,14 @@ public:
   /*!  */
   PlusStatus InternalUpdate();
 
+  /*! Run a thread that waits for the frames of the tracker instead of polling at AcquisitionRate */
+  vtkSetMacro(AsynchronousAcquisition, bool);
+  vtkGetMacro(AsynchronousAcquisition, bool);
+
+  /*! Store the fiducials of each frame in the AtracsysFiducials field of the tool items */
+  vtkSetMacro(RawFiducialsFieldData, bool);
+  vtkGetMacro(RawFiducialsFieldData, bool);
+
 public:
    // Commands
   static const char* ATRACSYS_COMMAND_SET_FLAG;
@@ -83,6 +98,19 @@ private: // Functions
   /*! Stop the tracking system and bring it back to its initial state. */
   PlusStatus InternalStopRecording();
 
+  /*! Get the markers of the next frame (waiting at most frameTimeoutMs for it) and update the tools */
+  PlusStatus UpdateTools(unsigned int frameTimeoutMs);
+
+  /*! Add a tool item, the filtered timestamp is computed by the buffer if it is UNDEFINED_TIMESTAMP (see UseDeviceClock) */
+  PlusStatus UpdateTool(const std::string& toolSourceId, vtkMatrix4x4* matrix, ToolStatus status, unsigned long frameNumber,
+    double unfilteredTimestamp, double filteredTimestamp, const igsioFieldMapType* customFields);
+
+  /*! Update the tools at each new frame until AcquisitionThreadRunning is cleared, used if AsynchronousAcquisition is enabled */
+  void AcquisitionThreadFn();
+
+  bool AsynchronousAcquisition;
+  bool RawFiducialsFieldData;
+
   std::vector<std::string> DisabledToolIds;
 
   class vtkInternal;
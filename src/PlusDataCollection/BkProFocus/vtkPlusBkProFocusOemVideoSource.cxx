@@ -368,7 +368,7 @@ PlusStatus vtkPlusBkProFocusOemVideoSource::InternalUpdate()
       this->Internal->DecodedImageFrame->AllocateScalars(VTK_UNSIGNED_CHAR, 3);
       PlusStatus status = PixelCodec::ConvertToBmp24(PixelCodec::ComponentOrder_RGB, PixelCodec::PixelEncoding_BGR24, this->UltrasoundWindowSize[0], this->UltrasoundWindowSize[1],
         (unsigned char*) & (this->Internal->OemMessage[numBytesProcessed]),
-        (unsigned char*)this->Internal->DecodedImageFrame->GetScalarPointer());
+        (unsigned char*)this->Internal->DecodedImageFrame->GetScalarPointer(), this->PixelConversionThreads);
     }
     else
     {
@@ -1274,7 +1274,7 @@ PlusStatus vtkPlusBkProFocusOemVideoSource::DecodePngImage(unsigned char* pngBuf
 
   if (!this->ColorEnabled)
   {
-    PlusStatus status = PixelCodec::ConvertToGray(PixelCodec::PixelEncoding_RGBA32, width, height, &(this->Internal->DecodingBuffer[0]), (unsigned char*)decodedImage->GetScalarPointer());
+    PlusStatus status = PixelCodec::ConvertToGray(PixelCodec::PixelEncoding_RGBA32, width, height, &(this->Internal->DecodingBuffer[0]), (unsigned char*)decodedImage->GetScalarPointer(), this->PixelConversionThreads);
   }
   else
   {
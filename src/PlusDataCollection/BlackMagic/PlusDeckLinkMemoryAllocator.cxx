@@ -0,0 +1,195 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+
+// Local includes
+#include "PlusDeckLinkMemoryAllocator.h"
+
+// OS includes
+#if WIN32
+  #include <windows.h>
+#else
+  #include <stdlib.h>
+  #include <sys/mman.h>
+  #include <unistd.h>
+#endif
+
+//----------------------------------------------------------------------------
+PlusDeckLinkMemoryAllocator::PlusDeckLinkMemoryAllocator()
+  : PinningFailureReported(false)
+  , ReferenceCount(1)
+{
+}
+
+//----------------------------------------------------------------------------
+PlusDeckLinkMemoryAllocator::~PlusDeckLinkMemoryAllocator()
+{
+  this->Decommit();
+}
+
+//----------------------------------------------------------------------------
+HRESULT STDMETHODCALLTYPE PlusDeckLinkMemoryAllocator::AllocateBuffer(unsigned int bufferSize, void** allocatedBuffer)
+{
+  if (allocatedBuffer == NULL)
+  {
+    return E_INVALIDARG;
+  }
+
+  std::lock_guard<std::mutex> lock(this->Mutex);
+
+  // Reuse a free buffer of the same size, the size only changes if the display mode changes
+  for (std::vector<void*>::iterator bufferIt = this->FreeBuffers.begin(); bufferIt != this->FreeBuffers.end(); ++bufferIt)
+  {
+    if (this->AllocatedBuffers[*bufferIt] == bufferSize)
+    {
+      *allocatedBuffer = *bufferIt;
+      this->FreeBuffers.erase(bufferIt);
+      return S_OK;
+    }
+  }
+
+  *allocatedBuffer = this->AllocatePinnedBuffer(bufferSize);
+  if (*allocatedBuffer == NULL)
+  {
+    LOG_ERROR("Failed to allocate DeckLink frame buffer of " << bufferSize << " bytes");
+    return E_OUTOFMEMORY;
+  }
+  this->AllocatedBuffers[*allocatedBuffer] = bufferSize;
+  return S_OK;
+}
+
+//----------------------------------------------------------------------------
+HRESULT STDMETHODCALLTYPE PlusDeckLinkMemoryAllocator::ReleaseBuffer(void* buffer)
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  if (this->AllocatedBuffers.find(buffer) == this->AllocatedBuffers.end())
+  {
+    return E_INVALIDARG;
+  }
+  this->FreeBuffers.push_back(buffer);
+  return S_OK;
+}
+
+//----------------------------------------------------------------------------
+HRESULT STDMETHODCALLTYPE PlusDeckLinkMemoryAllocator::Commit()
+{
+  return S_OK;
+}
+
+//----------------------------------------------------------------------------
+HRESULT STDMETHODCALLTYPE PlusDeckLinkMemoryAllocator::Decommit()
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  // The SDK releases all buffers before it decommits the allocator
+  for (std::vector<void*>::iterator bufferIt = this->FreeBuffers.begin(); bufferIt != this->FreeBuffers.end(); ++bufferIt)
+  {
+    this->FreePinnedBuffer(*bufferIt, this->AllocatedBuffers[*bufferIt]);
+    this->AllocatedBuffers.erase(*bufferIt);
+  }
+  this->FreeBuffers.clear();
+  if (!this->AllocatedBuffers.empty())
+  {
+    LOG_WARNING(this->AllocatedBuffers.size() << " DeckLink frame buffers are still in use when the allocator is decommitted");
+  }
+  return S_OK;
+}
+
+//----------------------------------------------------------------------------
+unsigned int PlusDeckLinkMemoryAllocator::GetNumberOfAllocatedBuffers()
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  return static_cast<unsigned int>(this->AllocatedBuffers.size());
+}
+
+//----------------------------------------------------------------------------
+void* PlusDeckLinkMemoryAllocator::AllocatePinnedBuffer(unsigned int bufferSize)
+{
+  void* buffer = NULL;
+  bool pinned = false;
+#if WIN32
+  buffer = VirtualAlloc(NULL, bufferSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+  if (buffer == NULL)
+  {
+    return NULL;
+  }
+  pinned = (VirtualLock(buffer, bufferSize) != 0);
+#else
+  if (posix_memalign(&buffer, static_cast<size_t>(sysconf(_SC_PAGESIZE)), bufferSize) != 0)
+  {
+    return NULL;
+  }
+  pinned = (mlock(buffer, bufferSize) == 0);
+#endif
+  if (!pinned && !this->PinningFailureReported)
+  {
+    // Capture still works, but the driver may have to lock the pages of each frame
+    LOG_WARNING("Failed to lock DeckLink frame buffers in physical memory. The process may need a larger working set or memory lock limit.");
+    this->PinningFailureReported = true;
+  }
+  return buffer;
+}
+
+//----------------------------------------------------------------------------
+void PlusDeckLinkMemoryAllocator::FreePinnedBuffer(void* buffer, unsigned int bufferSize)
+{
+#if WIN32
+  VirtualUnlock(buffer, bufferSize);
+  VirtualFree(buffer, 0, MEM_RELEASE);
+#else
+  munlock(buffer, bufferSize);
+  free(buffer);
+#endif
+}
+
+//----------------------------------------------------------------------------
+HRESULT STDMETHODCALLTYPE PlusDeckLinkMemoryAllocator::QueryInterface(REFIID iid, LPVOID* ppv)
+{
+  HRESULT result = E_NOINTERFACE;
+
+  if (ppv == NULL)
+  {
+    return E_INVALIDARG;
+  }
+
+  // Initialize the return result
+  *ppv = NULL;
+
+  // Obtain the IUnknown interface and compare it the provided REFIID
+  if (iid == IID_IUnknown)
+  {
+    *ppv = this;
+    AddRef();
+    result = S_OK;
+  }
+  else if (iid == IID_IDeckLinkMemoryAllocator)
+  {
+    *ppv = (IDeckLinkMemoryAllocator*)this;
+    AddRef();
+    result = S_OK;
+  }
+
+  return result;
+}
+
+//----------------------------------------------------------------------------
+ULONG STDMETHODCALLTYPE PlusDeckLinkMemoryAllocator::AddRef()
+{
+  return ++ReferenceCount;
+}
+
+//----------------------------------------------------------------------------
+ULONG STDMETHODCALLTYPE PlusDeckLinkMemoryAllocator::Release()
+{
+  ULONG newRefValue = --ReferenceCount;
+  if (newRefValue == 0)
+  {
+    delete this;
+    return 0;
+  }
+
+  return newRefValue;
+}
@@ -0,0 +1,66 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusDeckLinkMemoryAllocator_h__
+#define __PlusDeckLinkMemoryAllocator_h__
+
+// DeckLink includes
+#if WIN32
+  // Windows includes
+  #include <comutil.h>
+#endif
+#include <DeckLinkAPI.h>
+
+// STL includes
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <vector>
+
+/*!
+  \class PlusDeckLinkMemoryAllocator
+  \brief Memory allocator for the DeckLink input frames that reuses page-aligned, page-locked buffers
+
+  The capture card transfers the frames by DMA into the buffers of the allocator. The buffers are locked in
+  physical memory (if the operating system allows it) and are kept for the whole capture session, so that
+  no memory is allocated or mapped while frames are arriving.
+*/
+class PlusDeckLinkMemoryAllocator : public IDeckLinkMemoryAllocator
+{
+public:
+  PlusDeckLinkMemoryAllocator();
+  virtual ~PlusDeckLinkMemoryAllocator();
+
+  // IDeckLinkMemoryAllocator interface
+  virtual HRESULT STDMETHODCALLTYPE AllocateBuffer(unsigned int bufferSize, void** allocatedBuffer);
+  virtual HRESULT STDMETHODCALLTYPE ReleaseBuffer(void* buffer);
+  virtual HRESULT STDMETHODCALLTYPE Commit();
+  virtual HRESULT STDMETHODCALLTYPE Decommit();
+
+  // IUnknown interface
+  virtual HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, LPVOID* ppv);
+  virtual ULONG STDMETHODCALLTYPE AddRef();
+  virtual ULONG STDMETHODCALLTYPE Release();
+
+  /*! Number of buffers that have been allocated since the last Decommit */
+  unsigned int GetNumberOfAllocatedBuffers();
+
+protected:
+  void* AllocatePinnedBuffer(unsigned int bufferSize);
+  void FreePinnedBuffer(void* buffer, unsigned int bufferSize);
+
+protected:
+  std::mutex                    Mutex;
+  /*! Size of each allocated buffer */
+  std::map<void*, unsigned int> AllocatedBuffers;
+  /*! Buffers that are not used by the SDK, ready to be reused */
+  std::vector<void*>            FreeBuffers;
+  bool                          PinningFailureReported;
+
+  std::atomic<ULONG>            ReferenceCount;
+};
+
+#endif
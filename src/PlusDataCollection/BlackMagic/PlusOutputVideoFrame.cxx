@@ -14,13 +14,15 @@ PlusOutputVideoFrame::PlusOutputVideoFrame(long width, long height, BMDPixelForm
   , PixelFormat(pixelFormat)
   , FrameFlags(frameFlags)
 {
-  this->Pixels = new unsigned char[this->Height * this->GetRowBytes()];
+  this->InternalPixels = new unsigned char[this->Height * this->GetRowBytes()];
+  this->Pixels = this->InternalPixels;
 }
 
 //----------------------------------------------------------------------------
 PlusOutputVideoFrame::~PlusOutputVideoFrame()
 {
-  delete this->Pixels;
+  delete[] this->InternalPixels;
+  this->InternalPixels = nullptr;
   this->Pixels = nullptr;
 }
 
@@ -136,6 +138,14 @@ HRESULT STDMETHODCALLTYPE PlusOutputVideoFrame::GetBytes(void** buffer)
   return S_OK;
 }
 
+//----------------------------------------------------------------------------
+void PlusOutputVideoFrame::SetBytes(void* buffer)
+{
+  this->Mutex.lock();
+  this->Pixels = (buffer != nullptr ? buffer : this->InternalPixels);
+  this->Mutex.unlock();
+}
+
 //----------------------------------------------------------------------------
 HRESULT STDMETHODCALLTYPE PlusOutputVideoFrame::QueryInterface(REFIID iid, LPVOID* ppv)
 {
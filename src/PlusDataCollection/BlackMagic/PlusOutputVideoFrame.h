@@ -32,6 +32,13 @@ public:
   virtual void STDMETHODCALLTYPE SetFlags(BMDFrameFlags flags);
   virtual HRESULT STDMETHODCALLTYPE GetBytes(void** buffer);
 
+  /*!
+    Use an external buffer (e.g., a frame of the Plus buffer) as pixel storage, so that the converted image
+    is written directly into it. The buffer must be at least GetHeight() * GetRowBytes() bytes.
+    Call with nullptr to switch back to the internal storage of the frame.
+  */
+  void SetBytes(void* buffer);
+
   virtual HRESULT STDMETHODCALLTYPE GetTimecode(BMDTimecodeFormat format, IDeckLinkTimecode** timecode) {return E_NOTIMPL;}
   virtual HRESULT STDMETHODCALLTYPE GetAncillaryData(IDeckLinkVideoFrameAncillary** ancillary) {return E_NOTIMPL;}
 
@@ -47,6 +54,7 @@ protected:
   BMDFrameFlags       FrameFlags;
   BMDTimecodeFormat   TimecodeFormat;
   void*               Pixels;
+  unsigned char*      InternalPixels;
   std::mutex          Mutex;
 
 protected:
@@ -7,6 +7,7 @@ See License.txt for details.
 #include "PlusConfigure.h"
 
 // Local includes
+#include "PlusDeckLinkMemoryAllocator.h"
 #include "PlusOutputVideoFrame.h"
 #include "vtkIGSIOAccurateTimer.h"
 #include "vtkPlusDataSource.h"
@@ -16,7 +17,13 @@ See License.txt for details.
 #include <vtkObject.h>
 
 // System includes
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 // DeckLink SDK includes
 #include "DeckLinkAPIWrapper.h"
@@ -39,6 +46,22 @@ public:
 
   virtual ~vtkInternal() {}
 
+  /*! Input frame that is held by the callback until the processing thread writes it into the buffer */
+  struct CapturedFrame
+  {
+    IDeckLinkVideoInputFrame* Frame = nullptr;
+    double                    SystemTime = 0;
+  };
+
+  /*! Keep a reference to the frame and pass it to the processing thread. Called on the SDK callback thread. */
+  void QueueCapturedFrame(IDeckLinkVideoInputFrame* videoFrame);
+  void StartProcessingThread();
+  void StopProcessingThread();
+  void ProcessingThreadFn();
+  void ProcessCapturedFrame(const CapturedFrame& capturedFrame);
+  /*! Write the frame in BGRA format into the destination, which has room for the whole output frame */
+  PlusStatus WriteFrame(IDeckLinkVideoInputFrame* videoFrame, void* destination);
+
   int                       DeviceIndex = -1;
   bool                      PreviousFrameValid = false;
   std::string               DeviceName = "";
@@ -54,6 +77,22 @@ public:
 
   PlusOutputVideoFrame*     OutputFrame = nullptr;
 
+  /*!
+    If enabled then the SDK captures into page-locked buffers of MemoryAllocator and the frames are converted
+    directly into the Plus buffer on a processing thread, so the SDK callback thread only queues the frames.
+  */
+  bool                          DirectCapture = false;
+  int                           CaptureQueueSize = 4;
+  PlusDeckLinkMemoryAllocator*  MemoryAllocator = nullptr;
+  std::vector<CapturedFrame>    CaptureQueue;
+  std::atomic<unsigned int>     CaptureQueueHead{0};
+  std::atomic<unsigned int>     CaptureQueueTail{0};
+  std::atomic<unsigned long>    NumberOfDroppedFrames{0};
+  std::thread                   ProcessingThread;
+  std::mutex                    ProcessingMutex;
+  std::condition_variable       ProcessingCondition;
+  std::atomic_bool              ProcessingThreadRunning{false};
+
   std::atomic_bool          COMInitialized = false;
 
 private:
@@ -125,6 +164,12 @@ vtkPlusDeckLinkVideoSource::~vtkPlusDeckLinkVideoSource()
 {
   LOG_TRACE("vtkPlusDeckLinkVideoSource::~vtkPlusDeckLinkVideoSource()");
 
+  this->Internal->StopProcessingThread();
+  if (this->Internal->MemoryAllocator != nullptr)
+  {
+    this->Internal->MemoryAllocator->Release();
+    this->Internal->MemoryAllocator = nullptr;
+  }
   if (this->Internal->DeckLinkDisplayMode != nullptr)
   {
     this->Internal->DeckLinkDisplayMode->Release();
@@ -283,6 +328,14 @@ PlusStatus vtkPlusDeckLinkVideoSource::ReadConfiguration(vtkXMLDataElement* root
     }
   }
 
+  XML_READ_BOOL_ATTRIBUTE_NONMEMBER_OPTIONAL(DirectCapture, this->Internal->DirectCapture, deviceConfig);
+  XML_READ_SCALAR_ATTRIBUTE_NONMEMBER_OPTIONAL(int, CaptureQueueSize, this->Internal->CaptureQueueSize, deviceConfig);
+  if (this->Internal->CaptureQueueSize < 1)
+  {
+    LOG_WARNING("CaptureQueueSize must be at least 1, using 1 instead of " << this->Internal->CaptureQueueSize);
+    this->Internal->CaptureQueueSize = 1;
+  }
+
   return PLUS_SUCCESS;
 }
 
@@ -411,6 +464,18 @@ out:
     this->Internal->DeckLinkInput->SetScreenPreviewCallback(nullptr);
     this->Internal->DeckLinkInput->DisableAudioInput();
 
+    if (this->Internal->DirectCapture)
+    {
+      // The allocator has to be set before the video input is enabled
+      this->Internal->MemoryAllocator = new PlusDeckLinkMemoryAllocator();
+      if (this->Internal->DeckLinkInput->SetVideoInputFrameMemoryAllocator(this->Internal->MemoryAllocator) != S_OK)
+      {
+        LOG_WARNING("Unable to set the DeckLink input frame memory allocator, frames are captured into buffers allocated by the SDK.");
+        this->Internal->MemoryAllocator->Release();
+        this->Internal->MemoryAllocator = nullptr;
+      }
+    }
+
     if (this->Internal->DeckLinkInput->EnableVideoInput(this->Internal->DeckLinkDisplayMode->GetDisplayMode(), this->Internal->RequestedPixelFormat, bmdVideoInputFlagDefault) != S_OK)
     {
       LOG_ERROR("Unable to enable video input.");
@@ -444,8 +509,16 @@ PlusStatus vtkPlusDeckLinkVideoSource::InternalDisconnect()
   }
 
   this->StopRecording();
+  this->Internal->StopProcessingThread();
   this->Internal->DeckLinkInput->SetScreenPreviewCallback(NULL);
   this->Internal->DeckLinkInput->SetCallback(NULL);
+  this->Internal->DeckLinkInput->DisableVideoInput();
+  if (this->Internal->MemoryAllocator != nullptr)
+  {
+    this->Internal->DeckLinkInput->SetVideoInputFrameMemoryAllocator(nullptr);
+    this->Internal->MemoryAllocator->Release();
+    this->Internal->MemoryAllocator = nullptr;
+  }
 
   if (this->Internal->DeckLinkDisplayMode != nullptr)
   {
@@ -475,8 +548,13 @@ PlusStatus vtkPlusDeckLinkVideoSource::InternalStartRecording()
 
   if (this->Internal->DeckLinkInput != nullptr)
   {
+    if (this->Internal->DirectCapture)
+    {
+      this->Internal->StartProcessingThread();
+    }
     if (this->Internal->DeckLinkInput->StartStreams() != S_OK)
     {
+      this->Internal->StopProcessingThread();
       return PLUS_FAIL;
     }
   }
@@ -495,7 +573,10 @@ PlusStatus vtkPlusDeckLinkVideoSource::InternalStopRecording()
 
   if (this->Internal->DeckLinkInput != nullptr)
   {
-    if (this->Internal->DeckLinkInput->StopStreams() != S_OK)
+    HRESULT result = this->Internal->DeckLinkInput->StopStreams();
+    // The queued frames are written into the buffer and released before the streams can be restarted
+    this->Internal->StopProcessingThread();
+    if (result != S_OK)
     {
       return PLUS_FAIL;
     }
@@ -577,8 +658,6 @@ HRESULT STDMETHODCALLTYPE vtkPlusDeckLinkVideoSource::VideoInputFrameArrived(IDe
 {
   if (videoFrame)
   {
-    this->Internal->OutputFrame->SetFlags(videoFrame->GetFlags());
-
     bool inputFrameValid = ((videoFrame->GetFlags() & bmdFrameHasNoInputSource) == 0);
 
     if (inputFrameValid && !this->Internal->PreviousFrameValid)
@@ -588,6 +667,19 @@ HRESULT STDMETHODCALLTYPE vtkPlusDeckLinkVideoSource::VideoInputFrameArrived(IDe
       this->Internal->DeckLinkInput->StartStreams();
     }
 
+    if (this->Internal->DirectCapture)
+    {
+      // Conversion and buffering is done on the processing thread
+      if (inputFrameValid && this->Internal->PreviousFrameValid)
+      {
+        this->Internal->QueueCapturedFrame(videoFrame);
+      }
+      this->Internal->PreviousFrameValid = inputFrameValid;
+      return S_OK;
+    }
+
+    this->Internal->OutputFrame->SetFlags(videoFrame->GetFlags());
+
     if (inputFrameValid && this->Internal->PreviousFrameValid && this->Internal->DeckLinkVideoConversion->ConvertFrame(videoFrame, this->Internal->OutputFrame) == S_OK)
     {
       void* buffer;
@@ -608,3 +700,175 @@ HRESULT STDMETHODCALLTYPE vtkPlusDeckLinkVideoSource::VideoInputFrameArrived(IDe
   }
   return S_OK;
 }
+
+
+//----------------------------------------------------------------------------
+void vtkPlusDeckLinkVideoSource::vtkInternal::QueueCapturedFrame(IDeckLinkVideoInputFrame* videoFrame)
+{
+  const unsigned int tail = this->CaptureQueueTail.load(std::memory_order_relaxed);
+  const unsigned int head = this->CaptureQueueHead.load(std::memory_order_acquire);
+  if (this->CaptureQueue.empty() || tail - head >= this->CaptureQueue.size())
+  {
+    this->NumberOfDroppedFrames++;
+    static vtkIGSIOLogHelper helper(5.f, 5000, vtkPlusLogger::LOG_LEVEL_WARNING);
+    if (helper.ShouldWeLog(true))
+    {
+      LOG_WARNING("DeckLink frame is dropped, the processing of the previous frames is too slow. Number of dropped frames: " << this->NumberOfDroppedFrames.load());
+    }
+    return;
+  }
+
+  // The SDK buffer of the frame is kept until the frame is released by the processing thread
+  videoFrame->AddRef();
+  CapturedFrame& capturedFrame = this->CaptureQueue[tail % this->CaptureQueue.size()];
+  capturedFrame.Frame = videoFrame;
+  capturedFrame.SystemTime = vtkIGSIOAccurateTimer::GetSystemTime();
+  this->CaptureQueueTail.store(tail + 1, std::memory_order_release);
+
+  this->ProcessingCondition.notify_one();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusDeckLinkVideoSource::vtkInternal::StartProcessingThread()
+{
+  this->StopProcessingThread();
+
+  this->CaptureQueue.clear();
+  this->CaptureQueue.resize((std::max)(this->CaptureQueueSize, 1));
+  this->CaptureQueueHead = 0;
+  this->CaptureQueueTail = 0;
+  this->NumberOfDroppedFrames = 0;
+
+  this->ProcessingThreadRunning = true;
+  this->ProcessingThread = std::thread(&vtkPlusDeckLinkVideoSource::vtkInternal::ProcessingThreadFn, this);
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusDeckLinkVideoSource::vtkInternal::StopProcessingThread()
+{
+  if (!this->ProcessingThread.joinable())
+  {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(this->ProcessingMutex);
+    this->ProcessingThreadRunning = false;
+  }
+  this->ProcessingCondition.notify_one();
+  this->ProcessingThread.join();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusDeckLinkVideoSource::vtkInternal::ProcessingThreadFn()
+{
+  this->External->ApplyThreadScheduling();
+  while (true)
+  {
+    {
+      // The SDK callback does not lock the mutex when it notifies, so the queue is checked periodically as well
+      std::unique_lock<std::mutex> lock(this->ProcessingMutex);
+      this->ProcessingCondition.wait_for(lock, std::chrono::milliseconds(5), [this]
+      {
+        return !this->ProcessingThreadRunning || this->CaptureQueueHead.load() != this->CaptureQueueTail.load();
+      });
+    }
+
+    // Process all queued frames, the SDK buffer of a frame is returned as soon as the frame is processed
+    unsigned int head = this->CaptureQueueHead.load(std::memory_order_relaxed);
+    const unsigned int tail = this->CaptureQueueTail.load(std::memory_order_acquire);
+    for (; head != tail; ++head)
+    {
+      CapturedFrame& capturedFrame = this->CaptureQueue[head % this->CaptureQueue.size()];
+      this->ProcessCapturedFrame(capturedFrame);
+      capturedFrame.Frame->Release();
+      capturedFrame.Frame = nullptr;
+      this->CaptureQueueHead.store(head + 1, std::memory_order_release);
+    }
+
+    if (!this->ProcessingThreadRunning)
+    {
+      break;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusDeckLinkVideoSource::vtkInternal::ProcessCapturedFrame(const CapturedFrame& capturedFrame)
+{
+  vtkPlusDataSource* source(nullptr);
+  if (this->External->GetFirstVideoSource(source) != PLUS_SUCCESS)
+  {
+    return;
+  }
+
+  const unsigned int frameSizeInBytes = static_cast<unsigned int>(this->OutputFrame->GetHeight() * this->OutputFrame->GetRowBytes());
+
+  // Convert the frame directly into the buffer if possible
+  igsioVideoFrame* bufferFrame = nullptr;
+  if (source->IsInPlaceWritingSupported() && source->AcquireWritableFrame(bufferFrame) == PLUS_SUCCESS)
+  {
+    if (bufferFrame->GetFrameSizeInBytes() < frameSizeInBytes)
+    {
+      LOG_ERROR("Buffer frame size (" << bufferFrame->GetFrameSizeInBytes() << " bytes) is smaller than the DeckLink frame size (" << frameSizeInBytes << " bytes).");
+      source->ReleaseWritableFrame();
+      return;
+    }
+    if (this->WriteFrame(capturedFrame.Frame, bufferFrame->GetScalarPointer()) != PLUS_SUCCESS)
+    {
+      source->ReleaseWritableFrame();
+      return;
+    }
+    if (source->CommitWritableFrame(this->External->FrameNumber, capturedFrame.SystemTime) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Unable to add video item to buffer.");
+      return;
+    }
+    this->External->FrameNumber++;
+    return;
+  }
+
+  void* buffer(nullptr);
+  this->OutputFrame->GetBytes(&buffer);
+  if (this->WriteFrame(capturedFrame.Frame, buffer) != PLUS_SUCCESS)
+  {
+    return;
+  }
+  if (source->AddItem(buffer, this->RequestedFrameSize, frameSizeInBytes, US_IMG_RGB_COLOR, this->External->FrameNumber, capturedFrame.SystemTime) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to add video item to buffer.");
+    return;
+  }
+  this->External->FrameNumber++;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDeckLinkVideoSource::vtkInternal::WriteFrame(IDeckLinkVideoInputFrame* videoFrame, void* destination)
+{
+  const long outputRowBytes = this->OutputFrame->GetRowBytes();
+  if (videoFrame->GetPixelFormat() == bmdFormat8BitBGRA && videoFrame->GetRowBytes() == outputRowBytes && videoFrame->GetHeight() == this->OutputFrame->GetHeight())
+  {
+    // Already in the output format, only a copy from the DMA buffer is needed
+    void* videoFrameBytes(nullptr);
+    if (videoFrame->GetBytes(&videoFrameBytes) != S_OK)
+    {
+      LOG_ERROR("Unable to access DeckLink frame data.");
+      return PLUS_FAIL;
+    }
+    memcpy(destination, videoFrameBytes, static_cast<size_t>(outputRowBytes) * videoFrame->GetHeight());
+    return PLUS_SUCCESS;
+  }
+
+  this->OutputFrame->SetFlags(videoFrame->GetFlags());
+  if (destination != nullptr)
+  {
+    this->OutputFrame->SetBytes(destination);
+  }
+  HRESULT result = this->DeckLinkVideoConversion->ConvertFrame(videoFrame, this->OutputFrame);
+  this->OutputFrame->SetBytes(nullptr);
+  if (result != S_OK)
+  {
+    LOG_ERROR("Unable to convert DeckLink frame.");
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
@@ -32,6 +32,7 @@ public:
   {
     m_BrachyStepperType = UNDEFINED_STEPPER;
     m_PositionRequestNumber = 0;
+    m_LastPositionRequestTime = 0;
   };
   virtual ~PlusBrachyStepper() {};
 
@@ -63,6 +64,15 @@ public:
   /*! Initialize stepper  */
   virtual PlusStatus InitializeStepper(std::string& CalibMsg) = 0;
 
+  /*!
+    Send the next position request to the stepper as soon as the previous position is received, so that the reply
+    is transmitted while the caller is waiting for its next update. Returns PLUS_FAIL if the stepper does not support it.
+  */
+  virtual PlusStatus SetPipelinedPositionRequests(bool enable) { return enable ? PLUS_FAIL : PLUS_SUCCESS; }
+
+  /*! System time when the position returned by the last GetEncoderValues call was requested from the stepper */
+  double GetLastPositionRequestTime() const { return m_LastPositionRequestTime; }
+
   /*! Set/get bracy stepper type from BRACHY_STEPPER_TYPE */
   void SetBrachyStepperType(BRACHY_STEPPER_TYPE type) { m_BrachyStepperType = type; }
   BRACHY_STEPPER_TYPE GetBrachyStepperType() const { return m_BrachyStepperType; }
@@ -105,6 +115,9 @@ protected:
   /*! Number of position requests performed */
   unsigned long m_PositionRequestNumber;
 
+  /*! System time when the position returned by the last GetEncoderValues call was requested */
+  double m_LastPositionRequestTime;
+
 };
 
 #endif
@@ -107,6 +107,10 @@ PlusCmsBrachyStepper::PlusCmsBrachyStepper( unsigned long COMPort/*=1*/, unsigne
   m_IsCalibrated = false; 
   m_RepeatedPositionErrorCount = 0; 
 
+  m_PipelinedPositionRequests = false;
+  m_PositionRequestPending = false;
+  m_PendingPositionRequestTime = 0;
+
   m_BrachyStepperType = BURDETTE_MEDICAL_SYSTEMS_DIGITAL_STEPPER; 
 
   InitializeCriticalSection(&m_CriticalSection);
@@ -188,6 +192,8 @@ PlusStatus PlusCmsBrachyStepper::Connect()
 PlusStatus PlusCmsBrachyStepper::Disconnect()
 {
   this->m_StepperCOMPort->Close();
+  // The reply of a pipelined request is lost when the port is closed
+  m_PositionRequestPending = false;
 
   return PLUS_SUCCESS; 
 }
@@ -346,7 +352,25 @@ PlusStatus PlusCmsBrachyStepper::GetEncoderValues(double &PPosition, double &GPo
   PlusStatus retValue(PLUS_FAIL); 
 
   EnterCriticalSection(&m_CriticalSection); 
-  SendPositionRequestCommand(SC_POSITION_DATA_1, vDecodedMessage);
+  if (m_PositionRequestPending)
+  {
+    // The request has been sent by the previous call, its reply is received already or it is on its way
+    m_PositionRequestPending = false;
+    m_LastPositionRequestTime = m_PendingPositionRequestTime;
+    ReceivePositionMessage(SC_POSITION_DATA_1, vDecodedMessage);
+  }
+  else
+  {
+    m_LastPositionRequestTime = vtkIGSIOAccurateTimer::GetSystemTime();
+    SendPositionRequestCommand(SC_POSITION_DATA_1, vDecodedMessage);
+  }
+  if (m_PipelinedPositionRequests)
+  {
+    // Request the next position before this one is processed, the stepper replies while the caller waits for the next update
+    m_PendingPositionRequestTime = vtkIGSIOAccurateTimer::GetSystemTime();
+    StepperInstruction(SC_POSITION_DATA_1);
+    m_PositionRequestPending = true;
+  }
   LeaveCriticalSection(&m_CriticalSection); 
 
   if (vDecodedMessage.size() >= 7) 
@@ -808,6 +832,14 @@ void PlusCmsBrachyStepper::SendPositionRequestCommand(STEPPERCOMMAND command, st
   }
 
   StepperInstruction(command);
+  ReceivePositionMessage(command, vRawMessage);
+}
+
+//----------------------------------------------------------------------------
+void PlusCmsBrachyStepper::ReceivePositionMessage(STEPPERCOMMAND command, std::vector<BYTE> &vRawMessage)
+{
+  vRawMessage.clear(); 
+
   std::vector<BYTE> StepperMessage; 
   bool ack = IsStepperACKRecieved(StepperMessage, command);
   if( ack )
@@ -828,9 +860,33 @@ void PlusCmsBrachyStepper::SendPositionRequestCommand(STEPPERCOMMAND command, st
 #endif
 }
 
+//----------------------------------------------------------------------------
+void PlusCmsBrachyStepper::CompletePendingPositionRequest()
+{
+  if (!m_PositionRequestPending)
+  {
+    return;
+  }
+  m_PositionRequestPending = false;
+  std::vector<BYTE> vDecodedMessage;
+  ReceivePositionMessage(SC_POSITION_DATA_1, vDecodedMessage);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusCmsBrachyStepper::SetPipelinedPositionRequests(bool enable)
+{
+  EnterCriticalSection(&m_CriticalSection);
+  m_PipelinedPositionRequests = enable;
+  LeaveCriticalSection(&m_CriticalSection);
+  return PLUS_SUCCESS;
+}
+
 //----------------------------------------------------------------------------
 void PlusCmsBrachyStepper::StepperInstruction(STEPPERCOMMAND command)
 {
+  // The stepper replies in the order of the requests, the reply of a pipelined position request must be read first
+  CompletePendingPositionRequest();
+
   const char* p = command; 
 
   m_StepperCOMPort->Write(STX);
@@ -122,6 +122,9 @@ protected:
   /*! Disable stepper rotation calibration */
   PlusStatus StepperRotateCalibrationDisable();
 
+  /*! Enable pipelined position requests, see PlusBrachyStepper::SetPipelinedPositionRequests */
+  virtual PlusStatus SetPipelinedPositionRequests(bool enable);
+
   /*! Set scaling parameters */
   void SetScalingParameters();
 
@@ -141,6 +144,12 @@ protected:
   /*! Send a position request command to the stepper */
   void SendPositionRequestCommand(STEPPERCOMMAND command, std::vector<BYTE> &vRawMessage);
 
+  /*! Receive the reply of a position request command that has been sent already */
+  void ReceivePositionMessage(STEPPERCOMMAND command, std::vector<BYTE> &vRawMessage);
+
+  /*! Receive and discard the reply of a pipelined position request, so that another command can be sent */
+  void CompletePendingPositionRequest();
+
   /*! Send instruction to the stepper */
   void StepperInstruction(STEPPERCOMMAND command);
 
@@ -190,6 +199,15 @@ private:
    */
   int m_RepeatedPositionErrorCount; 
 
+  /*! If true then the next position request is sent as soon as a position is received */
+  bool m_PipelinedPositionRequests;
+
+  /*! True if a pipelined position request is sent and its reply is not read yet */
+  bool m_PositionRequestPending;
+
+  /*! System time when the pending position request was sent */
+  double m_PendingPositionRequestTime;
+
   /*! Critical section object */
   CRITICAL_SECTION m_CriticalSection; 
 
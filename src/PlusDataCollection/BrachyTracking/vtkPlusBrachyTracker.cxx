@@ -63,6 +63,7 @@ vtkPlusBrachyTracker::vtkPlusBrachyTracker()
   this->AddTool(encoderTool);
 
   this->BrachyStepperType = PlusBrachyStepper::BURDETTE_MEDICAL_SYSTEMS_DIGITAL_STEPPER;
+  this->PipelinedPositionRequests = false;
 
   // Stepper calibration parameters
   this->CompensationEnabledOn();
@@ -196,19 +197,28 @@ PlusStatus vtkPlusBrachyTracker::InternalUpdate()
   // get the transforms from stepper
   double dProbePosition(0), dTemplatePosition(0), dProbeRotation(0);
   unsigned long frameNum(0);
+  double unfilteredTimestamp = UNDEFINED_TIMESTAMP;
   if (!this->Device->GetEncoderValues(dProbePosition, dTemplatePosition, dProbeRotation, frameNum))
   {
     LOG_DEBUG("Tracker request timeout...");
     // Unable to get tracking information from tracker
     status = TOOL_REQ_TIMEOUT;
   }
+  else if (this->PipelinedPositionRequests)
+  {
+    // The reply may have been waiting for this update since the previous update, its request time is more accurate
+    unfilteredTimestamp = this->Device->GetLastPositionRequestTime();
+  }
   LOG_TRACE("Encoder values: "
     << "(Probe position) " << dProbePosition << ", "
     << "(Probe rotation) " << dProbeRotation << ", "
     << "(Template position) " << dTemplatePosition << ", "
     << "(Frame number) " << frameNum);
 
-  const double unfilteredTimestamp = vtkIGSIOAccurateTimer::GetSystemTime();
+  if (unfilteredTimestamp == UNDEFINED_TIMESTAMP)
+  {
+    unfilteredTimestamp = vtkIGSIOAccurateTimer::GetSystemTime();
+  }
 
   // Save probe position to the matrix (0,3) element
   // Save probe rotation to the matrix (1,3) element
@@ -374,6 +384,13 @@ PlusStatus vtkPlusBrachyTracker::ReadConfiguration(vtkXMLDataElement* rootConfig
     XML_READ_CSTRING_ATTRIBUTE_OPTIONAL(ModelSerialNumber, deviceConfig);
   }
 
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(PipelinedPositionRequests, deviceConfig);
+  if (this->Device != NULL && this->Device->SetPipelinedPositionRequests(this->PipelinedPositionRequests) != PLUS_SUCCESS)
+  {
+    LOG_WARNING("PipelinedPositionRequests is not supported by " << PlusBrachyStepper::GetBrachyStepperTypeInString(this->Device->GetBrachyStepperType()) << " steppers, the positions are requested one by one");
+    this->PipelinedPositionRequests = false;
+  }
+
   vtkXMLDataElement* calibration = deviceConfig->FindNestedElementWithName("StepperCalibrationResult");
   if (calibration != NULL)
   {
@@ -423,6 +440,7 @@ PlusStatus vtkPlusBrachyTracker::WriteConfiguration(vtkXMLDataElement* rootConfi
 
   trackerConfig->SetUnsignedLongAttribute("SerialPort", this->GetSerialPort());
   trackerConfig->SetDoubleAttribute("BaudRate", this->GetBaudRate());
+  XML_WRITE_BOOL_ATTRIBUTE(PipelinedPositionRequests, trackerConfig);
   trackerConfig->SetAttribute("ModelVersion", this->GetModelVersion());
   trackerConfig->SetAttribute("ModelNumber", this->GetModelNumber());
   trackerConfig->SetAttribute("ModelSerialNumber", this->GetModelSerialNumber());
@@ -162,6 +162,14 @@ public:
   /*! Enable/disable stepper calibration compensation */
   vtkBooleanMacro(CompensationEnabled, bool);
 
+  /*!
+    If enabled, the next position request is sent to the stepper as soon as a position is received, so that the stepper
+    replies while the update thread is waiting for the next update. The positions are timestamped with the time of
+    their request. Only supported by the CMS steppers.
+  */
+  vtkSetMacro(PipelinedPositionRequests, bool);
+  vtkGetMacro(PipelinedPositionRequests, bool);
+
   /*!
   Get brachy stepper type
   \sa BrachyStepper::BRACHY_STEPPER_TYPE
@@ -216,6 +224,8 @@ protected:
   unsigned long SerialPort;
   unsigned long BaudRate;
 
+  bool PipelinedPositionRequests;
+
   //========== Stepper calibration ==================
 
   /*! Enable/diasable stepper compensation */
@@ -32,7 +32,9 @@
 #include <stdlib.h>
 #include <string>
 #include <iostream>
+#include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <thread>
 #include <vector>
 #include <fstream>
@@ -93,6 +95,11 @@ vtkPlusClarius::vtkPlusClarius()
   , CompressRawData(false)
   , IsReceivingRawData(false)
   , RawDataPointer(nullptr)
+  , CallbackQueueHead(0)
+  , CallbackQueueTail(0)
+  , NumberOfDroppedFrames(0)
+  , CallbackQueueSize(16)
+  , ProcessingThreadRunning(false)
 {
   LOG_TRACE("vtkPlusClarius: Constructor");
   this->StartThreadForInternalUpdates = false;
@@ -132,6 +139,8 @@ vtkPlusClarius::~vtkPlusClarius()
     clariusDisconnect(BLOCKINGCALL);
   }
 
+  this->StopProcessingThread();
+
   int destroyed = clariusDestroyListener();
   if (destroyed != 0)
   {
@@ -183,6 +192,12 @@ PlusStatus vtkPlusClarius::ReadConfiguration(vtkXMLDataElement* rootConfigElemen
   XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, FrameHeight, deviceConfig);
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(ImuEnabled, deviceConfig);
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(WriteImagesToDisk, deviceConfig);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, CallbackQueueSize, deviceConfig);
+  if (this->CallbackQueueSize < 1)
+  {
+    LOG_WARNING("CallbackQueueSize must be at least 1, using 1 instead of " << this->CallbackQueueSize);
+    this->CallbackQueueSize = 1;
+  }
   if (this->ImuEnabled)
   {
     XML_READ_STRING_ATTRIBUTE_REQUIRED(ImuOutputFileName, deviceConfig);
@@ -307,6 +322,7 @@ PlusStatus vtkPlusClarius::WriteConfiguration(vtkXMLDataElement* rootConfigEleme
   deviceConfig->SetIntAttribute("TcpPort", this->TcpPort);
   deviceConfig->SetIntAttribute("FrameWidth", this->FrameWidth);
   deviceConfig->SetIntAttribute("FrameHeight", this->FrameHeight);
+  deviceConfig->SetIntAttribute("CallbackQueueSize", this->CallbackQueueSize);
   XML_WRITE_BOOL_ATTRIBUTE(ImuEnabled, deviceConfig);
   if (this->ImuEnabled)
   {
@@ -420,6 +436,9 @@ PlusStatus vtkPlusClarius::InternalConnect()
     ClariusFreezeFn FreezeCallBackFnPtr = static_cast<ClariusFreezeFn>(&vtkPlusClarius::FreezeFn);
     ClariusProgressFn ProgressCallBackFnPtr = static_cast<ClariusProgressFn>(&vtkPlusClarius::ProgressFn);
     ClariusErrorFn ErrorCallBackFnPtr = static_cast<ClariusErrorFn>(&vtkPlusClarius::ErrorFn);
+
+    // The frames received by the callback are processed on this thread
+    device->StartProcessingThread();
     try
     {
       if (clariusInitListener(argc, argv, path,
@@ -518,6 +537,7 @@ PlusStatus vtkPlusClarius::InternalDisconnect()
     else
     {
       device->Connected = 0;
+      device->StopProcessingThread();
       LOG_DEBUG("Clarius device is now disconnected");
       return PLUS_SUCCESS;
     }
@@ -586,9 +606,10 @@ void vtkPlusClarius::NewImageFn(const void* newImage, const ClariusImageInfo* nf
 }
 
 //----------------------------------------------------------------------------
+// Called on the thread of the Clarius SDK. The frame is only copied to the callback queue, it is processed
+// on the processing thread, so that the SDK thread is never blocked by the buffers or file writing.
 void vtkPlusClarius::SaveDataCallback(const void* newImage, const ClariusImageInfo* nfo, int npos, const ClariusPosInfo* pos)
 {
-  LOG_TRACE("vtkPlusClarius::SaveDataCallback");
   vtkPlusClarius* device = vtkPlusClarius::GetInstance();
   if (device == NULL)
   {
@@ -596,10 +617,6 @@ void vtkPlusClarius::SaveDataCallback(const void* newImage, const ClariusImageIn
     return;
   }
 
-
-  LOG_TRACE("new image (" << newImage << "): " << nfo->width << " x " << nfo->height << " @ " << nfo->bitsPerPixel
-    << "bits. @ " << nfo->micronsPerPixel << " microns per pixel. imu points: " << npos);
-
   // Check if still connected
   if (device->Connected == 0)
   {
@@ -614,246 +631,389 @@ void vtkPlusClarius::SaveDataCallback(const void* newImage, const ClariusImageIn
     return;
   }
 
+  const unsigned int tail = device->CallbackQueueTail.load(std::memory_order_relaxed);
+  const unsigned int head = device->CallbackQueueHead.load(std::memory_order_acquire);
+  if (device->CallbackQueue.empty() || tail - head >= device->CallbackQueue.size())
+  {
+    device->NumberOfDroppedFrames++;
+    static vtkIGSIOLogHelper helper(5.f, 5000, vtkPlusLogger::LOG_LEVEL_WARNING);
+    if (helper.ShouldWeLog(true))
+    {
+      LOG_WARNING("Clarius frame is dropped, the processing of the previous frames is too slow. Number of dropped frames: " << device->NumberOfDroppedFrames.load());
+    }
+    return;
+  }
+
+  CallbackFrame& frame = device->CallbackQueue[tail % device->CallbackQueue.size()];
+  frame.SystemTime = vtkIGSIOAccurateTimer::GetSystemTime();
+  frame.Info = *nfo;
+  // the memory of the slot is kept between the frames, so it is only allocated for the first frames
+  const size_t imageSizeInBytes = static_cast<size_t>(nfo->width) * nfo->height * (nfo->bitsPerPixel / 8);
+  frame.Image.resize(imageSizeInBytes);
+  memcpy(frame.Image.data(), newImage, imageSizeInBytes);
+  frame.Poses.assign(pos, pos + std::max(npos, 0));
+  device->CallbackQueueTail.store(tail + 1, std::memory_order_release);
+
+  device->ProcessingCondition.notify_one();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusClarius::StartProcessingThread()
+{
+  this->StopProcessingThread();
+
+  this->CallbackQueue.clear();
+  this->CallbackQueue.resize(std::max(this->CallbackQueueSize, 1));
+  this->CallbackQueueHead = 0;
+  this->CallbackQueueTail = 0;
+  this->NumberOfDroppedFrames = 0;
+
+  this->ProcessingThreadRunning = true;
+  this->ProcessingThread = std::thread(&vtkPlusClarius::ProcessingThreadFn, this);
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusClarius::StopProcessingThread()
+{
+  if (!this->ProcessingThread.joinable())
+  {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(this->ProcessingMutex);
+    this->ProcessingThreadRunning = false;
+  }
+  this->ProcessingCondition.notify_one();
+  this->ProcessingThread.join();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusClarius::ProcessingThreadFn()
+{
+  std::string imuCsv;
+  while (true)
+  {
+    {
+      // The SDK callback does not lock the mutex when it notifies, so the queue is checked periodically as well
+      std::unique_lock<std::mutex> lock(this->ProcessingMutex);
+      this->ProcessingCondition.wait_for(lock, std::chrono::milliseconds(5), [this]
+      {
+        return !this->ProcessingThreadRunning || this->CallbackQueueHead.load() != this->CallbackQueueTail.load();
+      });
+    }
+
+    // Process all queued frames, the slot of a frame is returned to the callback as soon as the frame is processed
+    unsigned int head = this->CallbackQueueHead.load(std::memory_order_relaxed);
+    const unsigned int tail = this->CallbackQueueTail.load(std::memory_order_acquire);
+    for (; head != tail; ++head)
+    {
+      this->ProcessCallbackFrame(this->CallbackQueue[head % this->CallbackQueue.size()], imuCsv);
+      this->CallbackQueueHead.store(head + 1, std::memory_order_release);
+    }
+
+    // The IMU samples of all the processed frames are written to the file at once
+    if (!imuCsv.empty())
+    {
+      this->WriteImuCsv(imuCsv);
+      imuCsv.clear();
+    }
+
+    if (!this->ProcessingThreadRunning)
+    {
+      break;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusClarius::ProcessCallbackFrame(const CallbackFrame& frame, std::string& imuCsv)
+{
+  const ClariusImageInfo* nfo = &frame.Info;
+  LOG_TRACE("new image: " << nfo->width << " x " << nfo->height << " @ " << nfo->bitsPerPixel
+    << "bits. @ " << nfo->micronsPerPixel << " microns per pixel. imu points: " << frame.Poses.size());
+
   // check if there exist active data source;
   vtkPlusDataSource* aSource;
-  if (device->GetFirstActiveOutputVideoSource(aSource) != PLUS_SUCCESS)
+  if (this->GetFirstActiveOutputVideoSource(aSource) != PLUS_SUCCESS)
   {
     LOG_ERROR("Unable to retrieve active data source.");
-    // Cannot return fail because the callback function has to return void
     return;
   }
 
   // Set Image Properties
   aSource->SetInputFrameSize(nfo->width, nfo->height, 1);
   int frameBufferBytesPerPixel = (nfo->bitsPerPixel / 8);
-  int frameSizeInBytes = nfo->width * nfo->height * frameBufferBytesPerPixel;
   aSource->SetNumberOfScalarComponents(frameBufferBytesPerPixel);
 
-  // need to copy newImage to new char vector vtkDataSource::AddItem() do not accept const char array
-  std::vector<char> _image;
-  size_t img_sz = nfo->width * nfo->height * (nfo->bitsPerPixel / 8);
-  if (_image.size() < img_sz)
-  {
-    _image.resize(img_sz);
-  }
-  memcpy(_image.data(), newImage, img_sz);
   // the clarius timestamp is in nanoseconds
-  device->ClariusLastTimestamp = static_cast<double>((double)nfo->tm / (double)1000000000);
-  // Get system time (elapsed time since last reboot), return Internal system time in seconds
-  double systemTime = vtkIGSIOAccurateTimer::GetSystemTime();
-  if (device->FrameNumber == 0)
+  this->ClariusLastTimestamp = static_cast<double>((double)nfo->tm / (double)1000000000);
+  // System time (elapsed time since last reboot) when the frame was received by the callback, in seconds
+  double systemTime = frame.SystemTime;
+  if (this->FrameNumber == 0)
   {
-    device->SystemStartTimestamp = systemTime;
-    device->ClariusStartTimestamp = device->ClariusLastTimestamp;
+    this->SystemStartTimestamp = systemTime;
+    this->ClariusStartTimestamp = this->ClariusLastTimestamp;
   }
 
   // The timestamp that each image is tagged with is
   // (system_start_time + current_clarius_time - clarius_start_time)
-  double converted_timestamp = device->SystemStartTimestamp + (device->ClariusLastTimestamp - device->ClariusStartTimestamp);
+  double converted_timestamp = this->SystemStartTimestamp + (this->ClariusLastTimestamp - this->ClariusStartTimestamp);
+  const int npos = static_cast<int>(frame.Poses.size());
   if (npos != 0)
   {
-    device->WritePosesToCsv(nfo, npos, pos, device->FrameNumber, systemTime, converted_timestamp);
+    this->AppendPosesToCsv(nfo, npos, frame.Poses.data(), this->FrameNumber, systemTime, converted_timestamp, imuCsv);
   }
-  if (device->WriteImagesToDisk)
+  if (this->WriteImagesToDisk)
   {
     // create cvimg to write to disk
-    cv::Mat cvimg = cv::Mat(nfo->width, nfo->height, CV_8UC4);
-    cvimg.data = cvimg.data = (unsigned char*)_image.data();
-    if (cv::imwrite("Clarius_Image" + std::to_string(device->ClariusLastTimestamp) + ".bmp", cvimg) == false)
+    cv::Mat cvimg = cv::Mat(nfo->width, nfo->height, CV_8UC4, const_cast<char*>(frame.Image.data()));
+    if (cv::imwrite("Clarius_Image" + std::to_string(this->ClariusLastTimestamp) + ".bmp", cvimg) == false)
     {
-      LOG_ERROR("ERROR writing clarius image" + std::to_string(device->ClariusLastTimestamp) + " to disk");
+      LOG_ERROR("ERROR writing clarius image" + std::to_string(this->ClariusLastTimestamp) + " to disk");
     }
   }
 
-  aSource->AddItem(
-    _image.data(), // pointer to char array
-    aSource->GetInputImageOrientation(), // refer to this url: http://perk-software.cs.queensu.ca/plus/doc/nightly/dev/UltrasoundImageOrientation.html for reference;
-                                         // Set to UN to keep the orientation of the image the same as on tablet
-    aSource->GetInputFrameSize(),
-    VTK_UNSIGNED_CHAR,
-    frameBufferBytesPerPixel,
-    US_IMG_BRIGHTNESS,
-    0,
-    device->FrameNumber,
-    converted_timestamp,
-    converted_timestamp);
+  // Write the image directly into the buffer if possible, otherwise let the buffer clip and reorient it
+  igsioVideoFrame* bufferFrame = NULL;
+  if (aSource->IsInPlaceWritingSupported() && aSource->AcquireWritableFrame(bufferFrame) == PLUS_SUCCESS)
+  {
+    if (bufferFrame->GetFrameSizeInBytes() < frame.Image.size())
+    {
+      LOG_ERROR("Buffer frame size (" << bufferFrame->GetFrameSizeInBytes() << " bytes) is smaller than the Clarius frame size (" << frame.Image.size() << " bytes).");
+      aSource->ReleaseWritableFrame();
+    }
+    else
+    {
+      memcpy(bufferFrame->GetScalarPointer(), frame.Image.data(), frame.Image.size());
+      aSource->CommitWritableFrame(this->FrameNumber, converted_timestamp, converted_timestamp);
+    }
+  }
+  else
+  {
+    aSource->AddItem(
+      const_cast<char*>(frame.Image.data()), // pointer to char array
+      aSource->GetInputImageOrientation(), // refer to this url: http://perk-software.cs.queensu.ca/plus/doc/nightly/dev/UltrasoundImageOrientation.html for reference;
+                                           // Set to UN to keep the orientation of the image the same as on tablet
+      aSource->GetInputFrameSize(),
+      VTK_UNSIGNED_CHAR,
+      frameBufferBytesPerPixel,
+      US_IMG_BRIGHTNESS,
+      0,
+      this->FrameNumber,
+      converted_timestamp,
+      converted_timestamp);
+  }
 
   for (int i = 0; i < npos; i++)
   {
-    double angularRate[3] = { pos[i].gx , pos[i].gy , pos[i].gz };
-    double magneticField[3] = { pos[i].mx , pos[i].my , pos[i].mz };
-    double acceleration[3] = { pos[i].ax , pos[i].ay , pos[i].az };
+    this->ProcessImuSample(frame.Poses[i], converted_timestamp);
+  }
+  // Add all IMU samples of the frame to the tool buffers at once
+  this->FlushImuToolSamples();
 
-    if (device->AccelerometerTool != NULL)
-    {
-      device->LastAccelerometerToTrackerTransform->Identity();
-      device->LastAccelerometerToTrackerTransform->SetElement(0, 3, acceleration[0]);
-      device->LastAccelerometerToTrackerTransform->SetElement(1, 3, acceleration[1]);
-      device->LastAccelerometerToTrackerTransform->SetElement(2, 3, acceleration[2]);
-      device->ToolTimeStampedUpdateWithoutFiltering(device->AccelerometerTool->GetId(), device->LastAccelerometerToTrackerTransform, TOOL_OK, converted_timestamp, converted_timestamp);
-    }
-    if (device->GyroscopeTool != NULL)
+  this->FrameNumber++;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusClarius::ProcessImuSample(const ClariusPosInfo& pos, double timestamp)
+{
+  double angularRate[3] = { pos.gx , pos.gy , pos.gz };
+  double magneticField[3] = { pos.mx , pos.my , pos.mz };
+  double acceleration[3] = { pos.ax , pos.ay , pos.az };
+
+  if (this->AccelerometerTool != NULL)
+  {
+    this->LastAccelerometerToTrackerTransform->Identity();
+    this->LastAccelerometerToTrackerTransform->SetElement(0, 3, acceleration[0]);
+    this->LastAccelerometerToTrackerTransform->SetElement(1, 3, acceleration[1]);
+    this->LastAccelerometerToTrackerTransform->SetElement(2, 3, acceleration[2]);
+    this->AddImuToolSample(this->AccelerometerTool, this->LastAccelerometerToTrackerTransform, TOOL_OK, timestamp);
+  }
+  if (this->GyroscopeTool != NULL)
+  {
+    this->LastGyroscopeToTrackerTransform->Identity();
+    this->LastGyroscopeToTrackerTransform->SetElement(0, 3, angularRate[0]);
+    this->LastGyroscopeToTrackerTransform->SetElement(1, 3, angularRate[1]);
+    this->LastGyroscopeToTrackerTransform->SetElement(2, 3, angularRate[2]);
+    this->AddImuToolSample(this->GyroscopeTool, this->LastGyroscopeToTrackerTransform, TOOL_OK, timestamp);
+  }
+  if (this->MagnetometerTool != NULL)
+  {
+    if (magneticField[0] > 1e100)
     {
-      device->LastGyroscopeToTrackerTransform->Identity();
-      device->LastGyroscopeToTrackerTransform->SetElement(0, 3, angularRate[0]);
-      device->LastGyroscopeToTrackerTransform->SetElement(1, 3, angularRate[1]);
-      device->LastGyroscopeToTrackerTransform->SetElement(2, 3, angularRate[2]);
-      device->ToolTimeStampedUpdateWithoutFiltering(device->GyroscopeTool->GetId(), device->LastGyroscopeToTrackerTransform, TOOL_OK, converted_timestamp, converted_timestamp);
+      // magnetometer data is not available, use the last transform with an invalid status to not have any missing transform
+      this->AddImuToolSample(this->MagnetometerTool, this->LastMagnetometerToTrackerTransform, TOOL_INVALID, timestamp);
     }
-    if (device->MagnetometerTool != NULL)
+    else
     {
-      if (magneticField[0] > 1e100)
-      {
-        // magnetometer data is not available, use the last transform with an invalid status to not have any missing transform
-        device->ToolTimeStampedUpdateWithoutFiltering(device->MagnetometerTool->GetId(), device->LastMagnetometerToTrackerTransform, TOOL_INVALID, converted_timestamp, converted_timestamp);
-      }
-      else
-      {
-        // magnetometer data is valid
-        device->LastMagnetometerToTrackerTransform->Identity();
-        device->LastMagnetometerToTrackerTransform->SetElement(0, 3, magneticField[0]);
-        device->LastMagnetometerToTrackerTransform->SetElement(1, 3, magneticField[1]);
-        device->LastMagnetometerToTrackerTransform->SetElement(2, 3, magneticField[2]);
-        device->ToolTimeStampedUpdateWithoutFiltering(device->MagnetometerTool->GetId(), device->LastMagnetometerToTrackerTransform, TOOL_OK, converted_timestamp, converted_timestamp);
-      }
+      // magnetometer data is valid
+      this->LastMagnetometerToTrackerTransform->Identity();
+      this->LastMagnetometerToTrackerTransform->SetElement(0, 3, magneticField[0]);
+      this->LastMagnetometerToTrackerTransform->SetElement(1, 3, magneticField[1]);
+      this->LastMagnetometerToTrackerTransform->SetElement(2, 3, magneticField[2]);
+      this->AddImuToolSample(this->MagnetometerTool, this->LastMagnetometerToTrackerTransform, TOOL_OK, timestamp);
     }
+  }
 
-    if (device->TiltSensorTool != NULL)
-    {
-      // Compose matrix that transforms the x axis to the input vector by rotations around two orthogonal axes
-      vtkSmartPointer<vtkTransform> transform = vtkSmartPointer<vtkTransform>::New();
+  if (this->TiltSensorTool != NULL)
+  {
+    // Compose matrix that transforms the x axis to the input vector by rotations around two orthogonal axes
+    vtkSmartPointer<vtkTransform> transform = vtkSmartPointer<vtkTransform>::New();
 
-      double downVector_Sensor[4] = { acceleration[0], acceleration[1], acceleration[2], 0 }; // provided by the sensor
-      vtkMath::Normalize(downVector_Sensor);
+    double downVector_Sensor[4] = { acceleration[0], acceleration[1], acceleration[2], 0 }; // provided by the sensor
+    vtkMath::Normalize(downVector_Sensor);
 
-      igsioMath::ConstrainRotationToTwoAxes(downVector_Sensor, device->TiltSensorWestAxisIndex, device->LastTiltSensorToTrackerTransform);
+    igsioMath::ConstrainRotationToTwoAxes(downVector_Sensor, this->TiltSensorWestAxisIndex, this->LastTiltSensorToTrackerTransform);
 
-      device->ToolTimeStampedUpdateWithoutFiltering(device->TiltSensorTool->GetId(), device->LastTiltSensorToTrackerTransform, TOOL_OK, converted_timestamp, converted_timestamp);
-    }
+    this->AddImuToolSample(this->TiltSensorTool, this->LastTiltSensorToTrackerTransform, TOOL_OK, timestamp);
+  }
 
-    if (device->OrientationSensorTool != NULL)
+  if (this->OrientationSensorTool != NULL)
+  {
+    if (magneticField[0] > 1e100)
     {
-      if (magneticField[0] > 1e100)
+      // magnetometer data is not available, use the last transform with an invalid status to not have any missing transform
+      this->AddImuToolSample(this->OrientationSensorTool, this->LastOrientationSensorToTrackerTransform, TOOL_INVALID, timestamp);
+    }
+    else
+    {
+      // magnetometer data is valid
+
+      //LOG_TRACE("samplingTime(msec)="<<1000.0*timeSinceLastAhrsUpdateSec<<", packetCount="<<count);
+      //LOG_TRACE("gyroX="<<std::fixed<<std::setprecision(2)<<std::setw(6)<<angularRate[0]<<", gyroY="<<angularRate[1]<<", gyroZ="<<angularRate[2]);
+      //LOG_TRACE("magX="<<std::fixed<<std::setprecision(2)<<std::setw(6)<<magneticField[0]<<", magY="<<magneticField[1]<<", magZ="<<magneticField[2]);
+
+      if (this->AhrsUseMagnetometer)
       {
-        // magnetometer data is not available, use the last transform with an invalid status to not have any missing transform
-        device->ToolTimeStampedUpdateWithoutFiltering(device->OrientationSensorTool->GetId(), device->LastOrientationSensorToTrackerTransform, TOOL_INVALID, converted_timestamp, converted_timestamp);
+        this->AhrsAlgo->UpdateWithTimestamp(
+          vtkMath::RadiansFromDegrees(angularRate[0]), vtkMath::RadiansFromDegrees(angularRate[1]), vtkMath::RadiansFromDegrees(angularRate[2]),
+          acceleration[0], acceleration[1], acceleration[2],
+          magneticField[0], magneticField[1], magneticField[2], timestamp);
       }
       else
       {
-        // magnetometer data is valid
-
-        //LOG_TRACE("samplingTime(msec)="<<1000.0*timeSinceLastAhrsUpdateSec<<", packetCount="<<count);
-        //LOG_TRACE("gyroX="<<std::fixed<<std::setprecision(2)<<std::setw(6)<<angularRate[0]<<", gyroY="<<angularRate[1]<<", gyroZ="<<angularRate[2]);
-        //LOG_TRACE("magX="<<std::fixed<<std::setprecision(2)<<std::setw(6)<<magneticField[0]<<", magY="<<magneticField[1]<<", magZ="<<magneticField[2]);
-
-        if (device->AhrsUseMagnetometer)
-        {
-          device->AhrsAlgo->UpdateWithTimestamp(
-            vtkMath::RadiansFromDegrees(angularRate[0]), vtkMath::RadiansFromDegrees(angularRate[1]), vtkMath::RadiansFromDegrees(angularRate[2]),
-            acceleration[0], acceleration[1], acceleration[2],
-            magneticField[0], magneticField[1], magneticField[2], converted_timestamp);
-        }
-        else
-        {
-          device->AhrsAlgo->UpdateIMUWithTimestamp(
-            vtkMath::RadiansFromDegrees(angularRate[0]), vtkMath::RadiansFromDegrees(angularRate[1]), vtkMath::RadiansFromDegrees(angularRate[2]),
-            acceleration[0], acceleration[1], acceleration[2], converted_timestamp);
-        }
+        this->AhrsAlgo->UpdateIMUWithTimestamp(
+          vtkMath::RadiansFromDegrees(angularRate[0]), vtkMath::RadiansFromDegrees(angularRate[1]), vtkMath::RadiansFromDegrees(angularRate[2]),
+          acceleration[0], acceleration[1], acceleration[2], timestamp);
+      }
 
 
-        double rotQuat[4] = { 0 };
-        device->AhrsAlgo->GetOrientation(rotQuat[0], rotQuat[1], rotQuat[2], rotQuat[3]);
+      double rotQuat[4] = { 0 };
+      this->AhrsAlgo->GetOrientation(rotQuat[0], rotQuat[1], rotQuat[2], rotQuat[3]);
 
-        double rotMatrix[3][3] = { 0 };
-        vtkMath::QuaternionToMatrix3x3(rotQuat, rotMatrix);
+      double rotMatrix[3][3] = { 0 };
+      vtkMath::QuaternionToMatrix3x3(rotQuat, rotMatrix);
 
-        for (int c = 0; c < 3; c++)
+      for (int c = 0; c < 3; c++)
+      {
+        for (int r = 0; r < 3; r++)
         {
-          for (int r = 0; r < 3; r++)
-          {
-            device->LastOrientationSensorToTrackerTransform->SetElement(r, c, rotMatrix[r][c]);
-          }
+          this->LastOrientationSensorToTrackerTransform->SetElement(r, c, rotMatrix[r][c]);
         }
-
-        device->ToolTimeStampedUpdateWithoutFiltering(device->OrientationSensorTool->GetId(), device->LastOrientationSensorToTrackerTransform, TOOL_OK, converted_timestamp, converted_timestamp);
       }
+
+      this->AddImuToolSample(this->OrientationSensorTool, this->LastOrientationSensorToTrackerTransform, TOOL_OK, timestamp);
     }
-    if (device->FilteredTiltSensorTool != NULL)
-    {
-      device->FilteredTiltSensorAhrsAlgo->UpdateIMUWithTimestamp(
-        vtkMath::RadiansFromDegrees(angularRate[0]), vtkMath::RadiansFromDegrees(angularRate[1]), vtkMath::RadiansFromDegrees(angularRate[2]),
-        acceleration[0], acceleration[1], acceleration[2], converted_timestamp);
+  }
+  if (this->FilteredTiltSensorTool != NULL)
+  {
+    this->FilteredTiltSensorAhrsAlgo->UpdateIMUWithTimestamp(
+      vtkMath::RadiansFromDegrees(angularRate[0]), vtkMath::RadiansFromDegrees(angularRate[1]), vtkMath::RadiansFromDegrees(angularRate[2]),
+      acceleration[0], acceleration[1], acceleration[2], timestamp);
 
-      double rotQuat[4] = { 0 };
-      device->AhrsAlgo->GetOrientation(rotQuat[0], rotQuat[1], rotQuat[2], rotQuat[3]);
+    double rotQuat[4] = { 0 };
+    this->AhrsAlgo->GetOrientation(rotQuat[0], rotQuat[1], rotQuat[2], rotQuat[3]);
 
-      double rotMatrix[3][3] = { 0 };
-      vtkMath::QuaternionToMatrix3x3(rotQuat, rotMatrix);
+    double rotMatrix[3][3] = { 0 };
+    vtkMath::QuaternionToMatrix3x3(rotQuat, rotMatrix);
 
-      double filteredDownVector_Sensor[4] = { rotMatrix[2][0], rotMatrix[2][1], rotMatrix[2][2], 0 };
-      vtkMath::Normalize(filteredDownVector_Sensor);
+    double filteredDownVector_Sensor[4] = { rotMatrix[2][0], rotMatrix[2][1], rotMatrix[2][2], 0 };
+    vtkMath::Normalize(filteredDownVector_Sensor);
 
-      igsioMath::ConstrainRotationToTwoAxes(filteredDownVector_Sensor, device->FilteredTiltSensorWestAxisIndex, device->LastFilteredTiltSensorToTrackerTransform);
+    igsioMath::ConstrainRotationToTwoAxes(filteredDownVector_Sensor, this->FilteredTiltSensorWestAxisIndex, this->LastFilteredTiltSensorToTrackerTransform);
 
-      device->ToolTimeStampedUpdateWithoutFiltering(device->FilteredTiltSensorTool->GetId(), device->LastFilteredTiltSensorToTrackerTransform, TOOL_OK, converted_timestamp, converted_timestamp);
+    this->AddImuToolSample(this->FilteredTiltSensorTool, this->LastFilteredTiltSensorToTrackerTransform, TOOL_OK, timestamp);
 
-      // write back the results to the FilteredTiltSensor_AHRS algorithm
-      for (int c = 0; c < 3; c++)
+    // write back the results to the FilteredTiltSensor_AHRS algorithm
+    for (int c = 0; c < 3; c++)
+    {
+      for (int r = 0; r < 3; r++)
       {
-        for (int r = 0; r < 3; r++)
-        {
-          rotMatrix[r][c] = device->LastFilteredTiltSensorToTrackerTransform->GetElement(r, c);
-        }
+        rotMatrix[r][c] = this->LastFilteredTiltSensorToTrackerTransform->GetElement(r, c);
       }
-      double filteredTiltSensorRotQuat[4] = { 0 };
-      vtkMath::Matrix3x3ToQuaternion(rotMatrix, filteredTiltSensorRotQuat);
-      device->FilteredTiltSensorAhrsAlgo->SetOrientation(filteredTiltSensorRotQuat[0], filteredTiltSensorRotQuat[1], filteredTiltSensorRotQuat[2], filteredTiltSensorRotQuat[3]);
     }
+    double filteredTiltSensorRotQuat[4] = { 0 };
+    vtkMath::Matrix3x3ToQuaternion(rotMatrix, filteredTiltSensorRotQuat);
+    this->FilteredTiltSensorAhrsAlgo->SetOrientation(filteredTiltSensorRotQuat[0], filteredTiltSensorRotQuat[1], filteredTiltSensorRotQuat[2], filteredTiltSensorRotQuat[3]);
   }
+}
 
-  device->FrameNumber++;
+//----------------------------------------------------------------------------
+void vtkPlusClarius::AddImuToolSample(vtkPlusDataSource* tool, vtkMatrix4x4* toolToTrackerTransform, ToolStatus status, double timestamp)
+{
+  vtkPlusBuffer::ToolSample sample;
+  vtkMatrix4x4::DeepCopy(sample.Matrix, toolToTrackerTransform);
+  sample.Status = status;
+  sample.UnfilteredTimestamp = timestamp;
+  sample.FilteredTimestamp = timestamp;
+  this->ImuToolSamples[tool->GetId()].push_back(sample);
 }
 
 //----------------------------------------------------------------------------
-PlusStatus vtkPlusClarius::WritePosesToCsv(const ClariusImageInfo* nfo, int npos, const ClariusPosInfo* pos, int frameNum, double systemTime, double convertedTime)
+void vtkPlusClarius::FlushImuToolSamples()
 {
-  LOG_TRACE("vtkPlusClarius::WritePosesToCsv");
+  for (auto& toolSamples : this->ImuToolSamples)
+  {
+    if (!toolSamples.second.empty())
+    {
+      this->ToolTimeStampedUpdateBatch(toolSamples.first, toolSamples.second);
+      // keep the allocated memory for the next frame
+      toolSamples.second.clear();
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusClarius::AppendPosesToCsv(const ClariusImageInfo* nfo, int npos, const ClariusPosInfo* pos, int frameNum, double systemTime, double convertedTime, std::string& imuCsv)
+{
+  LOG_TRACE("vtkPlusClarius::AppendPosesToCsv");
   if (npos != 0)
   {
     LOG_TRACE("timestamp in nanoseconds ClariusPosInfo" << pos[0].tm);
-    std::string posInfo = "";
     for (auto i = 0; i < npos; i++)
     {
-      posInfo += (std::to_string(frameNum) + ",");
-      posInfo += (std::to_string(systemTime) + ",");
-      posInfo += (std::to_string(convertedTime) + ",");
-      posInfo += (std::to_string(nfo->tm) + ",");
-      posInfo += (std::to_string(pos[i].tm) + ",");
-      posInfo += (std::to_string(pos[i].ax) + ",");
-      posInfo += (std::to_string(pos[i].ay) + ",");
-      posInfo += (std::to_string(pos[i].az) + ",");
-      posInfo += (std::to_string(pos[i].gx) + ",");
-      posInfo += (std::to_string(pos[i].gy) + ",");
-      posInfo += (std::to_string(pos[i].gz) + ",");
-      posInfo += (std::to_string(pos[i].mx) + ",");
-      posInfo += (std::to_string(pos[i].my) + ",");
-      posInfo += (std::to_string(pos[i].mz) + ",");
-      posInfo += "\n";
-    }
-
-    // write the string to file
-    this->RawImuDataStream.open(this->ImuOutputFileName, std::ofstream::app);
-    if (this->RawImuDataStream.is_open() == false)
-    {
-      LOG_ERROR("Error opening file for raw imu data");
-      return PLUS_FAIL;
+      imuCsv += (std::to_string(frameNum) + ",");
+      imuCsv += (std::to_string(systemTime) + ",");
+      imuCsv += (std::to_string(convertedTime) + ",");
+      imuCsv += (std::to_string(nfo->tm) + ",");
+      imuCsv += (std::to_string(pos[i].tm) + ",");
+      imuCsv += (std::to_string(pos[i].ax) + ",");
+      imuCsv += (std::to_string(pos[i].ay) + ",");
+      imuCsv += (std::to_string(pos[i].az) + ",");
+      imuCsv += (std::to_string(pos[i].gx) + ",");
+      imuCsv += (std::to_string(pos[i].gy) + ",");
+      imuCsv += (std::to_string(pos[i].gz) + ",");
+      imuCsv += (std::to_string(pos[i].mx) + ",");
+      imuCsv += (std::to_string(pos[i].my) + ",");
+      imuCsv += (std::to_string(pos[i].mz) + ",");
+      imuCsv += "\n";
     }
+  }
+}
 
-    this->RawImuDataStream << posInfo;
-    this->RawImuDataStream.close();
-    return PLUS_SUCCESS;
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusClarius::WriteImuCsv(const std::string& imuCsv)
+{
+  // write the string to file
+  this->RawImuDataStream.open(this->ImuOutputFileName, std::ofstream::app);
+  if (this->RawImuDataStream.is_open() == false)
+  {
+    LOG_ERROR("Error opening file for raw imu data");
+    return PLUS_FAIL;
   }
 
+  this->RawImuDataStream << imuCsv;
+  this->RawImuDataStream.close();
   return PLUS_SUCCESS;
 }
 
@@ -14,8 +14,13 @@
 #include "vtkPlusUsDevice.h"
 
 // System Includes
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
 #include <thread>
 #include <string>
+#include <vector>
 #include <stdio.h>
 #include <fstream>
 
@@ -125,13 +130,46 @@ public:
   vtkSetStdStringMacro(RawDataOutputFilename);
   vtkGetStdStringMacro(RawDataOutputFilename);
 
+  /*!
+    Number of frames that can be queued between the Clarius SDK callback and the processing thread.
+    If the queue is full then the new frames are dropped, so that the SDK thread is never blocked.
+    Takes effect at the next connection.
+  */
+  vtkSetMacro(CallbackQueueSize, int);
+  vtkGetMacro(CallbackQueueSize, int);
+
+  /*! Number of frames that were dropped because the callback queue was full */
+  unsigned long long GetNumberOfDroppedFrames() const { return this->NumberOfDroppedFrames.load(); }
+
 protected:
   vtkPlusClarius();
   ~vtkPlusClarius();
 
   virtual PlusStatus InternalConnect();
   virtual PlusStatus InternalDisconnect();
-  PlusStatus WritePosesToCsv(const ClariusImageInfo* nfo, int npos, const ClariusPosInfo* pos, int frameNum, double systemTime, double convertedTime);
+  /*! Append the IMU samples of a frame to imuCsv, the samples of all the frames processed together are written to the file at once */
+  void AppendPosesToCsv(const ClariusImageInfo* nfo, int npos, const ClariusPosInfo* pos, int frameNum, double systemTime, double convertedTime, std::string& imuCsv);
+  PlusStatus WriteImuCsv(const std::string& imuCsv);
+
+  /*! Image and IMU samples copied from the SDK callback, the memory is reused for the following frames */
+  struct CallbackFrame
+  {
+    std::vector<char> Image;
+    ClariusImageInfo Info;
+    std::vector<ClariusPosInfo> Poses;
+    double SystemTime;
+  };
+
+  void StartProcessingThread();
+  void StopProcessingThread();
+  /*! Move the queued frames to the buffers of the data sources, until StopProcessingThread is called */
+  void ProcessingThreadFn();
+  /*! Add the image and the IMU samples of a frame to the data sources */
+  void ProcessCallbackFrame(const CallbackFrame& frame, std::string& imuCsv);
+  void ProcessImuSample(const ClariusPosInfo& pos, double timestamp);
+  /*! Queue a tool sample, the queued samples are added to the tool buffers by FlushImuToolSamples */
+  void AddImuToolSample(vtkPlusDataSource* tool, vtkMatrix4x4* toolToTrackerTransform, ToolStatus status, double timestamp);
+  void FlushImuToolSamples();
 
   /*!
   Receive previously requested data
@@ -156,6 +194,23 @@ protected:
 
   cv::Mat cvImage;
 
+  /*!
+    Single producer (SDK callback), single consumer (processing thread) ring of frames.
+    CallbackQueueHead and CallbackQueueTail are increasing counters, the slot index is the counter modulo the queue size.
+  */
+  std::vector<CallbackFrame> CallbackQueue;
+  std::atomic<unsigned int> CallbackQueueHead;
+  std::atomic<unsigned int> CallbackQueueTail;
+  std::atomic<unsigned long long> NumberOfDroppedFrames;
+  int CallbackQueueSize;
+  std::thread ProcessingThread;
+  std::atomic<bool> ProcessingThreadRunning;
+  std::mutex ProcessingMutex;
+  std::condition_variable ProcessingCondition;
+
+  /*! IMU samples of the current frame for each tool, indexed by tool source ID */
+  std::map<std::string, std::vector<vtkPlusBuffer::ToolSample> > ImuToolSamples;
+
   bool CompressRawData;
   bool IsReceivingRawData;
   int RawDataSize;
@@ -0,0 +1,355 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================================*/
+
+#include "PlusConfigure.h"
+
+#include "vtkPlusHapticLoop.h"
+#include "vtkPlusForceFeedback.h"
+#include "vtkMatrix4x4.h"
+#include "vtkObjectFactory.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace
+{
+  // Marks the middle slot of the pose triple buffer if it contains a pose that the reader has not taken yet
+  const int NEW_POSE_FLAG = 4;
+  const int SLOT_INDEX_MASK = 3;
+
+  typedef std::chrono::steady_clock LoopClock;
+
+  double ToSeconds(LoopClock::duration duration)
+  {
+    return std::chrono::duration<double>(duration).count();
+  }
+}
+
+//----------------------------------------------------------------------------
+
+vtkStandardNewMacro(vtkPlusHapticLoop)
+
+//----------------------------------------------------------------------------
+vtkPlusHapticLoop::vtkPlusHapticLoop()
+  : ForceModel(NULL)
+  , UpdateRateHz(1000.0)
+  , SpinWaitTimeSec(0.0)
+  , LoopActive(false)
+  , ResetStatisticsRequested(false)
+  , PoseMiddleSlot(2)
+  , PoseWriteSlot(0)
+  , PoseReadSlot(1)
+  , NumberOfPoseUpdates(0)
+  , ForceValid(false)
+{
+  for (int slot = 0; slot < 3; slot++)
+  {
+    vtkMatrix4x4::Identity(this->PoseSlots[slot]);
+  }
+  this->Force[0] = 0;
+  this->Force[1] = 0;
+  this->Force[2] = 0;
+  this->Statistics = LoopStatistics();
+}
+
+//----------------------------------------------------------------------------
+vtkPlusHapticLoop::~vtkPlusHapticLoop()
+{
+  this->Stop();
+  if (this->ForceModel != NULL)
+  {
+    this->ForceModel->UnRegister(this);
+    this->ForceModel = NULL;
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusHapticLoop::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "UpdateRateHz: " << this->UpdateRateHz << endl;
+  os << indent << "SpinWaitTimeSec: " << this->SpinWaitTimeSec << endl;
+  os << indent << "Running: " << (this->IsRunning() ? "yes" : "no") << endl;
+  LoopStatistics statistics = this->GetLoopStatistics();
+  os << indent << "Iterations: " << statistics.NumberOfIterations << " (overruns: " << statistics.NumberOfOverruns << ")" << endl;
+  os << indent << "Period: " << statistics.MeanPeriodSec * 1000.0 << " ms (std dev: " << statistics.PeriodStdDevSec * 1000.0
+     << " ms, max jitter: " << statistics.MaxJitterSec * 1000.0 << " ms)" << endl;
+  os << indent << "Force computation: " << statistics.MeanForceComputationTimeSec * 1000.0 << " ms (max: "
+     << statistics.MaxForceComputationTimeSec * 1000.0 << " ms)" << endl;
+  if (this->ForceModel != NULL)
+  {
+    this->ForceModel->PrintSelf(os, indent.GetNextIndent());
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusHapticLoop::SetForceModel(vtkPlusForceFeedback* forceModel)
+{
+  if (this->IsRunning())
+  {
+    vtkErrorMacro("The force model cannot be changed while the haptic loop is running");
+    return PLUS_FAIL;
+  }
+  if (forceModel == this->ForceModel)
+  {
+    return PLUS_SUCCESS;
+  }
+  if (forceModel != NULL)
+  {
+    forceModel->Register(this);
+  }
+  if (this->ForceModel != NULL)
+  {
+    this->ForceModel->UnRegister(this);
+  }
+  this->ForceModel = forceModel;
+  this->Modified();
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusHapticLoop::SetForceCallback(ForceCallbackType callback)
+{
+  if (this->IsRunning())
+  {
+    vtkErrorMacro("The force callback cannot be changed while the haptic loop is running");
+    return PLUS_FAIL;
+  }
+  this->ForceCallback = callback;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusHapticLoop::SetUpdateRateHz(double rate)
+{
+  if (this->IsRunning())
+  {
+    vtkErrorMacro("The update rate cannot be changed while the haptic loop is running");
+    return PLUS_FAIL;
+  }
+  if (rate <= 0)
+  {
+    vtkErrorMacro("Invalid haptic loop update rate: " << rate);
+    return PLUS_FAIL;
+  }
+  this->UpdateRateHz = rate;
+  this->Modified();
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusHapticLoop::Start()
+{
+  if (this->IsRunning())
+  {
+    return PLUS_SUCCESS;
+  }
+  if (this->ForceModel == NULL)
+  {
+    vtkErrorMacro("Cannot start the haptic loop without a force model");
+    return PLUS_FAIL;
+  }
+  {
+    std::lock_guard<std::mutex> lock(this->OutputMutex);
+    this->ForceValid = false;
+    this->Statistics = LoopStatistics();
+  }
+  this->ResetStatisticsRequested = false;
+  this->LoopActive = true;
+  this->LoopThread = std::thread(&vtkPlusHapticLoop::RunLoop, this);
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusHapticLoop::Stop()
+{
+  this->LoopActive = false;
+  if (this->LoopThread.joinable())
+  {
+    this->LoopThread.join();
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusHapticLoop::IsRunning() const
+{
+  return this->LoopThread.joinable();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusHapticLoop::SetToolPose(vtkMatrix4x4* toolToReference)
+{
+  if (toolToReference == NULL)
+  {
+    return;
+  }
+  this->SetToolPose(&toolToReference->Element[0][0]);
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusHapticLoop::SetToolPose(const double toolToReference[16])
+{
+  std::copy(toolToReference, toolToReference + 16, this->PoseSlots[this->PoseWriteSlot]);
+  // Publish the written slot and take the previous middle slot for the next write
+  this->PoseWriteSlot = this->PoseMiddleSlot.exchange(this->PoseWriteSlot | NEW_POSE_FLAG, std::memory_order_acq_rel) & SLOT_INDEX_MASK;
+  ++this->NumberOfPoseUpdates;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusHapticLoop::ReadToolPose(double toolToReference[16])
+{
+  if ((this->PoseMiddleSlot.load(std::memory_order_acquire) & NEW_POSE_FLAG) == 0)
+  {
+    return false;
+  }
+  this->PoseReadSlot = this->PoseMiddleSlot.exchange(this->PoseReadSlot, std::memory_order_acq_rel) & SLOT_INDEX_MASK;
+  std::copy(this->PoseSlots[this->PoseReadSlot], this->PoseSlots[this->PoseReadSlot] + 16, toolToReference);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusHapticLoop::GetForce(double force[3])
+{
+  std::lock_guard<std::mutex> lock(this->OutputMutex);
+  std::copy(this->Force, this->Force + 3, force);
+  return this->ForceValid;
+}
+
+//----------------------------------------------------------------------------
+vtkPlusHapticLoop::LoopStatistics vtkPlusHapticLoop::GetLoopStatistics()
+{
+  LoopStatistics statistics;
+  {
+    std::lock_guard<std::mutex> lock(this->OutputMutex);
+    statistics = this->Statistics;
+  }
+  statistics.NumberOfPoseUpdates = this->NumberOfPoseUpdates;
+  return statistics;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusHapticLoop::ResetLoopStatistics()
+{
+  this->NumberOfPoseUpdates = 0;
+  if (this->IsRunning())
+  {
+    // The haptic thread owns the accumulated values, it resets them in its next iteration
+    this->ResetStatisticsRequested = true;
+    return;
+  }
+  std::lock_guard<std::mutex> lock(this->OutputMutex);
+  this->Statistics = LoopStatistics();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusHapticLoop::RunLoop()
+{
+  const LoopClock::duration period = std::chrono::duration_cast<LoopClock::duration>(std::chrono::duration<double>(1.0 / this->UpdateRateHz));
+  const LoopClock::duration spinWaitTime = std::chrono::duration_cast<LoopClock::duration>(std::chrono::duration<double>(std::max(this->SpinWaitTimeSec, 0.0)));
+  const double nominalPeriodSec = ToSeconds(period);
+
+  vtkSmartPointer<vtkMatrix4x4> toolToReference = vtkSmartPointer<vtkMatrix4x4>::New();
+  bool poseAvailable = false;
+  double force[3] = { 0, 0, 0 };
+
+  // Accumulated on this thread and copied to the published statistics
+  LoopStatistics statistics = LoopStatistics();
+  double periodSum = 0;
+  double periodSquaredSum = 0;
+  double forceComputationTimeSum = 0;
+  long numberOfPeriods = 0;
+  long numberOfForceComputations = 0;
+
+  LoopClock::time_point deadline = LoopClock::now();
+  LoopClock::time_point previousStartTime;
+  bool firstIteration = true;
+  while (this->LoopActive)
+  {
+    LoopClock::time_point startTime = LoopClock::now();
+    if (this->ResetStatisticsRequested.exchange(false))
+    {
+      statistics = LoopStatistics();
+      periodSum = 0;
+      periodSquaredSum = 0;
+      forceComputationTimeSum = 0;
+      numberOfPeriods = 0;
+      numberOfForceComputations = 0;
+      firstIteration = true;
+    }
+    if (!firstIteration)
+    {
+      double periodSec = ToSeconds(startTime - previousStartTime);
+      numberOfPeriods++;
+      periodSum += periodSec;
+      periodSquaredSum += periodSec * periodSec;
+      statistics.MaxJitterSec = std::max(statistics.MaxJitterSec, std::fabs(periodSec - nominalPeriodSec));
+      statistics.MeanPeriodSec = periodSum / numberOfPeriods;
+      statistics.PeriodStdDevSec = std::sqrt(std::max(periodSquaredSum / numberOfPeriods - statistics.MeanPeriodSec * statistics.MeanPeriodSec, 0.0));
+    }
+    previousStartTime = startTime;
+    firstIteration = false;
+
+    if (this->ReadToolPose(&toolToReference->Element[0][0]))
+    {
+      toolToReference->Modified();
+      poseAvailable = true;
+    }
+    if (poseAvailable)
+    {
+      this->ForceModel->GenerateForce(toolToReference, force);
+      double forceComputationTimeSec = ToSeconds(LoopClock::now() - startTime);
+      forceComputationTimeSum += forceComputationTimeSec;
+      numberOfForceComputations++;
+      statistics.MeanForceComputationTimeSec = forceComputationTimeSum / numberOfForceComputations;
+      statistics.MaxForceComputationTimeSec = std::max(statistics.MaxForceComputationTimeSec, forceComputationTimeSec);
+      if (this->ForceCallback)
+      {
+        this->ForceCallback(force);
+      }
+    }
+    statistics.NumberOfIterations++;
+
+    deadline += period;
+    LoopClock::time_point now = LoopClock::now();
+    if (now > deadline)
+    {
+      statistics.NumberOfOverruns++;
+      if (now - deadline > period)
+      {
+        // Skip the missed iterations instead of running them in a burst
+        deadline = now;
+      }
+    }
+
+    // Publish the results without ever waiting for a reader
+    std::unique_lock<std::mutex> lock(this->OutputMutex, std::try_to_lock);
+    if (lock.owns_lock())
+    {
+      if (poseAvailable)
+      {
+        std::copy(force, force + 3, this->Force);
+        this->ForceValid = true;
+      }
+      this->Statistics = statistics;
+      lock.unlock();
+    }
+
+    if (deadline - spinWaitTime > now)
+    {
+      std::this_thread::sleep_until(deadline - spinWaitTime);
+    }
+    while (LoopClock::now() < deadline)
+    {
+      // Spin wait for the remaining time
+    }
+  }
+
+  // The last iterations may not have been published
+  std::lock_guard<std::mutex> lock(this->OutputMutex);
+  this->Statistics = statistics;
+}
@@ -0,0 +1,151 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================================*/
+
+#ifndef __vtkPlusHapticLoop_h
+#define __vtkPlusHapticLoop_h
+
+#include "PlusConfigure.h"
+#include "vtkPlusHapticsExport.h"
+
+#include "vtkObject.h"
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+class vtkMatrix4x4;
+class vtkPlusForceFeedback;
+
+/*!
+  \class vtkPlusHapticLoop
+  \brief Computes the force of a force model on a dedicated thread at a fixed rate
+
+  Haptic rendering needs force updates at about 1 kHz, which is much faster than the update rate of Plus devices.
+  The loop runs on its own thread at UpdateRateHz, independently from the device that provides the tool pose.
+
+  The device sets the latest tool pose by SetToolPose. The pose is exchanged through a triple buffer, so neither the
+  device nor the haptic thread waits for the other. Each iteration of the loop computes the force for the latest
+  pose, passes it to the force callback (that sends it to the haptic device) and publishes it for GetForce.
+
+  The loop measures the period of its iterations. GetLoopStatistics reports the period mean, standard deviation and
+  the largest deviation from the nominal period (jitter), and the number of iterations that missed their deadline.
+
+  The force model and the force callback are used on the haptic thread, so they can be set only while the loop is
+  stopped.
+
+  \ingroup PlusLibDataCollection
+*/
+class vtkPlusHapticsExport vtkPlusHapticLoop : public vtkObject
+{
+public:
+  static vtkPlusHapticLoop* New();
+  vtkTypeMacro(vtkPlusHapticLoop, vtkObject);
+  virtual void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  /*! Function that receives the computed force on the haptic thread */
+  typedef std::function<void(const double force[3])> ForceCallbackType;
+
+  /*! Timing of the loop iterations since the loop was started or the statistics were reset */
+  struct LoopStatistics
+  {
+    /*! Number of completed iterations */
+    long NumberOfIterations;
+    /*! Number of iterations that ended after the start time of the next iteration */
+    long NumberOfOverruns;
+    /*! Number of tool poses that were set */
+    long NumberOfPoseUpdates;
+    /*! Mean time between the start of consecutive iterations */
+    double MeanPeriodSec;
+    /*! Standard deviation of the time between the start of consecutive iterations */
+    double PeriodStdDevSec;
+    /*! Largest difference between the time between the start of consecutive iterations and the nominal period */
+    double MaxJitterSec;
+    /*! Mean and largest time of the force computation */
+    double MeanForceComputationTimeSec;
+    double MaxForceComputationTimeSec;
+  };
+
+  /*! Force model that computes the force from the tool pose. Can only be set while the loop is stopped. */
+  PlusStatus SetForceModel(vtkPlusForceFeedback* forceModel);
+  vtkGetObjectMacro(ForceModel, vtkPlusForceFeedback);
+
+  /*! Called with the computed force in every iteration, on the haptic thread. Can only be set while the loop is stopped. */
+  PlusStatus SetForceCallback(ForceCallbackType callback);
+
+  /*! Rate of the force computation, in Hz. Can only be set while the loop is stopped. */
+  PlusStatus SetUpdateRateHz(double rate);
+  vtkGetMacro(UpdateRateHz, double);
+
+  /*!
+    The loop sleeps until this time before the start of the next iteration, then waits by polling the clock.
+    Increasing it reduces the jitter caused by the sleep resolution of the operating system, for the cost of CPU time.
+  */
+  vtkSetMacro(SpinWaitTimeSec, double);
+  vtkGetMacro(SpinWaitTimeSec, double);
+
+  /*! Start the haptic thread */
+  PlusStatus Start();
+
+  /*! Stop the haptic thread and wait until it exits */
+  PlusStatus Stop();
+
+  bool IsRunning() const;
+
+  /*!
+    Set the latest tool pose (ToolToReference transform). The force is computed for this pose from the next iteration.
+    Does not wait for the haptic thread. Must be called from one thread at a time (usually the device thread).
+  */
+  void SetToolPose(vtkMatrix4x4* toolToReference);
+  void SetToolPose(const double toolToReference[16]);
+
+  /*! Get the latest computed force. Returns false if no force was computed yet. */
+  bool GetForce(double force[3]);
+
+  LoopStatistics GetLoopStatistics();
+  void ResetLoopStatistics();
+
+protected:
+  vtkPlusHapticLoop();
+  virtual ~vtkPlusHapticLoop();
+
+  /*! Body of the haptic thread */
+  void RunLoop();
+
+  /*! Take the latest pose from the triple buffer. Returns false if no new pose was set since the last call. */
+  bool ReadToolPose(double toolToReference[16]);
+
+  vtkPlusForceFeedback* ForceModel;
+  ForceCallbackType ForceCallback;
+  double UpdateRateHz;
+  double SpinWaitTimeSec;
+
+  std::thread LoopThread;
+  std::atomic<bool> LoopActive;
+  std::atomic<bool> ResetStatisticsRequested;
+
+  /*!
+    Triple buffer of the tool pose. The writer fills its slot then swaps it with the middle slot, the reader swaps
+    its slot with the middle slot if the middle slot is marked as new.
+  */
+  double PoseSlots[3][16];
+  std::atomic<int> PoseMiddleSlot;
+  int PoseWriteSlot;
+  int PoseReadSlot;
+  std::atomic<long> NumberOfPoseUpdates;
+
+  /*! Output of the haptic thread. The haptic thread never waits for this mutex, it skips publishing if the mutex is locked. */
+  std::mutex OutputMutex;
+  double Force[3];
+  bool ForceValid;
+  LoopStatistics Statistics;
+
+private:
+  vtkPlusHapticLoop(const vtkPlusHapticLoop&);  // Not implemented.
+  void operator=(const vtkPlusHapticLoop&);  // Not implemented.
+};
+
+#endif
@@ -10,6 +10,18 @@ See License.txt for details.
 #include "vtkPolyData.h"
 #include "vtkPlusPolydataForce.h"
 #include "vtkMatrix4x4.h"
+#include "vtkPointLocator.h"
+#include "vtkPoints.h"
+#include "vtkSmartPointer.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+  // Limits the memory used by the distance field, the node spacing is increased for large surfaces
+  const double MAX_DISTANCE_FIELD_NODES = 8e6;
+}
 
 //----------------------------------------------------------------------------
 
@@ -21,9 +33,20 @@ vtkPlusPolydataForce::vtkPlusPolydataForce()
   // Constant for sigmoid function
   this->gammaSigmoid = 2;
   this->scaleForce = 20.0;
+  this->poly = NULL;
   lastPos[0] = 0;
   lastPos[1] = 0;
   lastPos[2] = 0;
+
+  this->DistanceFieldSpacing = 1.0;
+  this->ForceDistance = 5.0;
+  this->DistanceFieldNodeSpacing = this->DistanceFieldSpacing;
+  this->DistanceFieldBuildTime = 0;
+  for ( int i = 0; i < 3; i++ )
+  {
+    this->DistanceFieldOrigin[i] = 0;
+    this->DistanceFieldDimensions[i] = 0;
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -31,6 +54,10 @@ void vtkPlusPolydataForce::PrintSelf( ostream& os, vtkIndent indent )
 {
   this->Superclass::PrintSelf( os, indent.GetNextIndent() );
   os << indent.GetNextIndent() << "Gamma Sigmoid: " << this->gammaSigmoid << endl;
+  os << indent.GetNextIndent() << "Force Distance: " << this->ForceDistance << endl;
+  os << indent.GetNextIndent() << "Distance Field Spacing: " << this->DistanceFieldNodeSpacing << endl;
+  os << indent.GetNextIndent() << "Distance Field Dimensions: " << this->DistanceFieldDimensions[0] << " x "
+     << this->DistanceFieldDimensions[1] << " x " << this->DistanceFieldDimensions[2] << endl;
 }
 
 //----------------------------------------------------------------------------
@@ -43,6 +70,102 @@ vtkPlusPolydataForce::~vtkPlusPolydataForce()
 void vtkPlusPolydataForce::SetInput( vtkPolyData* poly )
 {
   this->poly = poly;
+  this->BuildDistanceField();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusPolydataForce::SetDistanceFieldSpacing( double spacing )
+{
+  if ( spacing <= 0 || spacing == this->DistanceFieldSpacing )
+  {
+    return;
+  }
+  this->DistanceFieldSpacing = spacing;
+  this->BuildDistanceField();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusPolydataForce::SetForceDistance( double distance )
+{
+  if ( distance < 0 || distance == this->ForceDistance )
+  {
+    return;
+  }
+  this->ForceDistance = distance;
+  // The margin of the grid around the surface depends on the force distance
+  this->BuildDistanceField();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusPolydataForce::BuildDistanceField()
+{
+  this->SurfacePoints.clear();
+  this->ClosestPointIndices.clear();
+  for ( int i = 0; i < 3; i++ )
+  {
+    this->DistanceFieldDimensions[i] = 0;
+  }
+  if ( this->poly == NULL )
+  {
+    return;
+  }
+  this->DistanceFieldBuildTime = this->poly->GetMTime();
+
+  vtkIdType numberOfPoints = this->poly->GetNumberOfPoints();
+  if ( numberOfPoints <= 0 )
+  {
+    return;
+  }
+  this->SurfacePoints.resize( 3 * numberOfPoints );
+  for ( vtkIdType pointId = 0; pointId < numberOfPoints; pointId++ )
+  {
+    this->poly->GetPoint( pointId, &this->SurfacePoints[3 * pointId] );
+  }
+
+  // Grid covers the surface and the force distance around it
+  double bounds[6];
+  this->poly->GetBounds( bounds );
+  double extent[3];
+  for ( int i = 0; i < 3; i++ )
+  {
+    this->DistanceFieldOrigin[i] = bounds[2 * i] - this->ForceDistance;
+    extent[i] = bounds[2 * i + 1] - bounds[2 * i] + 2 * this->ForceDistance;
+  }
+  double spacing = this->DistanceFieldSpacing;
+  double numberOfNodes = ( floor( extent[0] / spacing ) + 2 ) * ( floor( extent[1] / spacing ) + 2 ) * ( floor( extent[2] / spacing ) + 2 );
+  if ( numberOfNodes > MAX_DISTANCE_FIELD_NODES )
+  {
+    spacing *= std::pow( numberOfNodes / MAX_DISTANCE_FIELD_NODES, 1.0 / 3.0 );
+    vtkWarningMacro( "Distance field spacing is increased to " << spacing << "mm to limit the memory usage for the large surface" );
+  }
+  this->DistanceFieldNodeSpacing = spacing;
+  for ( int i = 0; i < 3; i++ )
+  {
+    // +2: round up and include the node at both ends
+    this->DistanceFieldDimensions[i] = static_cast<int>( floor( extent[i] / spacing ) ) + 2;
+  }
+
+  vtkSmartPointer<vtkPointLocator> locator = vtkSmartPointer<vtkPointLocator>::New();
+  locator->SetDataSet( this->poly );
+  locator->BuildLocator();
+
+  const int* dims = this->DistanceFieldDimensions;
+  this->ClosestPointIndices.resize( static_cast<size_t>( dims[0] ) * dims[1] * dims[2] );
+  size_t nodeIndex = 0;
+  double node[3];
+  for ( int k = 0; k < dims[2]; k++ )
+  {
+    node[2] = this->DistanceFieldOrigin[2] + k * spacing;
+    for ( int j = 0; j < dims[1]; j++ )
+    {
+      node[1] = this->DistanceFieldOrigin[1] + j * spacing;
+      for ( int i = 0; i < dims[0]; i++ )
+      {
+        node[0] = this->DistanceFieldOrigin[0] + i * spacing;
+        this->ClosestPointIndices[nodeIndex++] = static_cast<int>( locator->FindClosestPoint( node ) );
+      }
+    }
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -51,7 +174,7 @@ int vtkPlusPolydataForce::GenerateForce( vtkMatrix4x4* transformMatrix, double f
   double distance;
   distance = CalculateDistance( transformMatrix->GetElement( 0, 3 ), transformMatrix->GetElement( 1, 3 ), transformMatrix->GetElement( 2, 3 ) );
 
-  if ( distance <= 5 )
+  if ( distance <= this->ForceDistance )
   {
     CalculateForce( transformMatrix->GetElement( 0, 3 ), transformMatrix->GetElement( 1, 3 ), transformMatrix->GetElement( 2, 3 ), force );
   }
@@ -61,21 +184,65 @@ int vtkPlusPolydataForce::GenerateForce( vtkMatrix4x4* transformMatrix, double f
     force[1] = ( 0 );
     force[2] = ( 0 );
   }
-  cout <<  " FORCE: " << force[0] << ",  " << force[1] << ",  " << force[2] << endl;
+  vtkDebugMacro( " FORCE: " << force[0] << ",  " << force[1] << ",  " << force[2] );
   return 1;
 }
 
 //----------------------------------------------------------------------------
 double vtkPlusPolydataForce::CalculateDistance( double x, double y, double z )
 {
-  int pointID;
-  double distance;
-  pointID = this->poly->FindPoint( x, y, z );
-  this->poly->GetPoint( pointID, this->lastPos );
+  if ( this->poly != NULL && this->poly->GetMTime() != this->DistanceFieldBuildTime )
+  {
+    this->BuildDistanceField();
+  }
+  if ( this->ClosestPointIndices.empty() )
+  {
+    return VTK_DOUBLE_MAX;
+  }
+
+  // Grid cell that contains the position
+  const double position[3] = { x, y, z };
+  int cell[3];
+  for ( int i = 0; i < 3; i++ )
+  {
+    double index = floor( ( position[i] - this->DistanceFieldOrigin[i] ) / this->DistanceFieldNodeSpacing );
+    if ( index < 0 || index > this->DistanceFieldDimensions[i] - 2 )
+    {
+      // Outside the grid, farther from the surface than the force distance
+      return VTK_DOUBLE_MAX;
+    }
+    cell[i] = static_cast<int>( index );
+  }
+
+  // Closest of the closest points of the cell corners
+  const int* dims = this->DistanceFieldDimensions;
+  double minDistanceSquared = VTK_DOUBLE_MAX;
+  int closestPointIndex = -1;
+  for ( int corner = 0; corner < 8; corner++ )
+  {
+    size_t nodeIndex = ( cell[0] + ( corner & 1 ) )
+                       + static_cast<size_t>( dims[0] ) * ( ( cell[1] + ( ( corner >> 1 ) & 1 ) )
+                           + static_cast<size_t>( dims[1] ) * ( cell[2] + ( ( corner >> 2 ) & 1 ) ) );
+    int pointIndex = this->ClosestPointIndices[nodeIndex];
+    if ( pointIndex == closestPointIndex || pointIndex < 0 )
+    {
+      continue;
+    }
+    const double* point = &this->SurfacePoints[3 * pointIndex];
+    double distanceSquared = ( x - point[0] ) * ( x - point[0] ) + ( y - point[1] ) * ( y - point[1] ) + ( z - point[2] ) * ( z - point[2] );
+    if ( distanceSquared < minDistanceSquared )
+    {
+      minDistanceSquared = distanceSquared;
+      closestPointIndex = pointIndex;
+    }
+  }
+  if ( closestPointIndex < 0 )
+  {
+    return VTK_DOUBLE_MAX;
+  }
 
-  double tmp = pow( ( x - lastPos[0] ), 2 ) + pow( ( y - lastPos[1] ), 2 ) + pow( ( z - lastPos[2] ), 2 );
-  distance = sqrt( tmp );
-  return distance;
+  std::copy( &this->SurfacePoints[3 * closestPointIndex], &this->SurfacePoints[3 * closestPointIndex] + 3, this->lastPos );
+  return sqrt( minDistanceSquared );
 }
 
 //----------------------------------------------------------------------------
@@ -95,9 +262,7 @@ void vtkPlusPolydataForce::CalculateForce( double x, double y, double z, double
   vector[1] = fabs( y - this->lastPos[1] );
   vector[2] = fabs( z - this->lastPos[2] );
 
-  cout << "vector[0]: " << vector[0] << endl;
-  cout << "vector[1]: " << vector[1] << endl;
-  cout << "vector[2]: " << vector[2] << endl;
+  vtkDebugMacro( "vector: " << vector[0] << ", " << vector[1] << ", " << vector[2] );
 
   for ( int i = 0; i < 3; i++ )
   {
@@ -106,9 +271,7 @@ void vtkPlusPolydataForce::CalculateForce( double x, double y, double z, double
       force[i] = ( 0.1 / ( vector[i] * vector[i] ) ) * .6;
     }
   }
-  cout << "X: " << force[0] << endl;
-  cout << "Y: " << force[1] << endl;
-  cout << "Z: " << force[2] << endl;
+  vtkDebugMacro( "X: " << force[0] << " Y: " << force[1] << " Z: " << force[2] );
 
   if ( force[0] > 1 )
   {
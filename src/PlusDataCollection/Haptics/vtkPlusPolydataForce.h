@@ -12,8 +12,23 @@ See License.txt for details.
 
 #include "vtkPlusForceFeedback.h"
 
+#include <vector>
+
 class vtkPolyData;
 
+/*!
+  \class vtkPlusPolydataForce
+  \brief Force that pushes the haptic tool away from the points of a surface
+
+  The closest surface point is looked up in a distance field that is precomputed when the input is set: a regular
+  grid around the surface that stores the closest surface point of each grid node. A force query only compares the
+  closest points of the 8 nodes around the tool position, so its cost does not depend on the size of the surface.
+  The found point may differ from the exact closest point by at most the diagonal of a grid cell.
+
+  The grid extends beyond the bounds of the surface by the force distance, positions outside the grid get no force.
+
+  \ingroup PlusLibDataCollection
+*/
 class vtkPlusHapticsExport vtkPlusPolydataForce : public vtkPlusForceFeedback
 {
 public:
@@ -23,8 +38,25 @@ public:
 
   int GenerateForce(vtkMatrix4x4 * transformMatrix, double force[3]);
   int SetGamma(double gamma);
+
+  /*! Set the surface and build its distance field */
   void SetInput(vtkPolyData * poly);
 
+  /*!
+    Build the distance field of the input surface. It is built automatically when the input or the spacing is set,
+    and by the first GenerateForce call after the input surface is modified. Call it after modifying the surface
+    to avoid building the field in the haptic loop.
+  */
+  void BuildDistanceField();
+
+  /*! Distance between the grid nodes of the distance field (in mm). Smaller spacing is more accurate but uses more memory. */
+  void SetDistanceFieldSpacing(double spacing);
+  vtkGetMacro(DistanceFieldSpacing, double);
+
+  /*! Force is generated only if the tool is closer to the surface than this distance (in mm) */
+  void SetForceDistance(double distance);
+  vtkGetMacro(ForceDistance, double);
+
 protected:
   vtkPlusPolydataForce();
   virtual ~vtkPlusPolydataForce();
@@ -36,6 +68,19 @@ private:
   double gammaSigmoid;
   double scaleForce;
   double lastPos[3];
+
+  double DistanceFieldSpacing;
+  double ForceDistance;
+
+  /*! Coordinates of the surface points (x, y, z for each point), copied from the input for fast access */
+  std::vector<double> SurfacePoints;
+  /*! Index of the closest surface point of each grid node, x index changes the fastest */
+  std::vector<int> ClosestPointIndices;
+  double DistanceFieldOrigin[3];
+  double DistanceFieldNodeSpacing;
+  int DistanceFieldDimensions[3];
+  /*! Modification time of the input surface when the distance field was built */
+  vtkMTimeType DistanceFieldBuildTime;
 };
 
 #endif
@@ -15,6 +15,8 @@ See License.txt for details.
 #include "vtkIGSIOTrackedFrameList.h"
 #include "vtkPlusTrackedFrameProcessor.h"
 #include "vtkIGSIOTransformRepository.h"
+#include "vtkIGSIOAccurateTimer.h"
+#include "PlusFrameBacklogPolicy.h"
 #include "vtksys/SystemTools.hxx"
 
 //----------------------------------------------------------------------------
@@ -28,7 +30,10 @@ vtkPlusImageProcessorVideoSource::vtkPlusImageProcessorVideoSource()
   , EnableProcessing(true)
   , ProcessingAlgorithmAccessMutex(vtkSmartPointer<vtkIGSIORecursiveCriticalSection>::New())
   , GracePeriodLogLevel(vtkPlusLogger::LOG_LEVEL_DEBUG)
-  , ProcessorAlgorithm(NULL)
+  , PipelineQueueSize(2)
+  , LastQueuedInputDataTimestamp(0)
+  , PipelineStopping(false)
+  , InputFrames(vtkSmartPointer<vtkIGSIOTrackedFrameList>::New())
 {
   this->MissingInputGracePeriodSec = 2.0;
 
@@ -47,17 +52,31 @@ vtkPlusImageProcessorVideoSource::~vtkPlusImageProcessorVideoSource()
     this->TransformRepository->Delete();
     this->TransformRepository = NULL;
   }
-  if (this->ProcessorAlgorithm)
-  {
-    this->ProcessorAlgorithm->Delete();
-    this->ProcessorAlgorithm = NULL;
-  }
+  this->DeleteProcessorStages();
 }
 
 //----------------------------------------------------------------------------
 void vtkPlusImageProcessorVideoSource::PrintSelf(ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os, indent);
+  os << indent << "PipelineQueueSize: " << this->PipelineQueueSize << std::endl;
+  for (int stageIndex = 0; stageIndex < this->GetNumberOfProcessorStages(); ++stageIndex)
+  {
+    os << indent << "Processor stage " << stageIndex << ": " << this->ProcessorStages[stageIndex]->Processor->GetProcessorTypeName()
+       << ", average latency: " << this->GetStageAverageLatencySec(stageIndex) << "sec" << std::endl;
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusImageProcessorVideoSource::DeleteProcessorStages()
+{
+  this->StopPipeline();
+  for (std::vector<std::unique_ptr<ProcessorStage> >::iterator stage = this->ProcessorStages.begin(); stage != this->ProcessorStages.end(); ++stage)
+  {
+    (*stage)->Processor->Delete();
+    (*stage)->TransformRepository->Delete();
+  }
+  this->ProcessorStages.clear();
 }
 
 //----------------------------------------------------------------------------
@@ -65,6 +84,13 @@ PlusStatus vtkPlusImageProcessorVideoSource::ReadConfiguration(vtkXMLDataElement
 {
   XML_FIND_DEVICE_ELEMENT_REQUIRED_FOR_READING(deviceConfig, rootConfigElement);
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(EnableProcessing, deviceConfig);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, PipelineQueueSize, deviceConfig);
+  if (this->PipelineQueueSize < 1)
+  {
+    LOG_WARNING("PipelineQueueSize must be at least 1, got " << this->PipelineQueueSize << ". Using 1.");
+    this->PipelineQueueSize = 1;
+  }
+  this->BacklogPolicy.ReadConfiguration(deviceConfig);
 
   // Read transform repository configuration
   if (this->TransformRepository->ReadConfiguration(rootConfigElement) != PLUS_SUCCESS)
@@ -74,11 +100,7 @@ PlusStatus vtkPlusImageProcessorVideoSource::ReadConfiguration(vtkXMLDataElement
   }
 
   // Instantiate processor(s)
-  if (this->ProcessorAlgorithm)
-  {
-    this->ProcessorAlgorithm->Delete();
-    this->ProcessorAlgorithm = NULL;
-  }
+  this->DeleteProcessorStages();
   int numberOfNestedElements = deviceConfig->GetNumberOfNestedElements();
   for (int nestedElemIndex = 0; nestedElemIndex < numberOfNestedElements; ++nestedElemIndex)
   {
@@ -90,12 +112,6 @@ PlusStatus vtkPlusImageProcessorVideoSource::ReadConfiguration(vtkXMLDataElement
       continue;
     }
 
-    if (this->ProcessorAlgorithm != NULL)
-    {
-      LOG_WARNING("Multiple " << processorElement->GetName() << " elements found in ImageProcessor configuration. Only the first one is used, all others are ignored");
-      break;
-    }
-
     // Verify type
     const char* processorType = processorElement->GetAttribute("Type");
     if (processorType == NULL)
@@ -105,29 +121,44 @@ PlusStatus vtkPlusImageProcessorVideoSource::ReadConfiguration(vtkXMLDataElement
     }
 
     // Instantiate processor corresponding to the specified type
+    vtkPlusTrackedFrameProcessor* processor = NULL;
     vtkSmartPointer<vtkPlusBoneEnhancer> boneEnhancer = vtkSmartPointer<vtkPlusBoneEnhancer>::New();
     vtkSmartPointer<vtkPlusTransverseProcessEnhancer> TransverseProcessEnhancer = vtkSmartPointer<vtkPlusTransverseProcessEnhancer>::New();
     if (!(STRCASECMP(boneEnhancer->GetProcessorTypeName(), processorType)))
     {
-      boneEnhancer->SetTransformRepository(this->TransformRepository);
-      boneEnhancer->ReadConfiguration(processorElement);
-      this->ProcessorAlgorithm = boneEnhancer;
-      this->ProcessorAlgorithm->Register(this);
-      break;                  // If only one processor is allowed per ImageProcessor class, we can break out when we find it.
+      processor = boneEnhancer;
     }
     else if (!(STRCASECMP(TransverseProcessEnhancer->GetProcessorTypeName(), processorType)))
     {
-      TransverseProcessEnhancer->SetTransformRepository(this->TransformRepository);
-      TransverseProcessEnhancer->ReadConfiguration(processorElement);
-      this->ProcessorAlgorithm = TransverseProcessEnhancer;
-      this->ProcessorAlgorithm->Register(this);
-      break;
+      processor = TransverseProcessEnhancer;
     }
     else
     {
       LOG_ERROR("Unknown processor type: " << processorType);
       return PLUS_FAIL;
     }
+
+    std::unique_ptr<ProcessorStage> stage(new ProcessorStage);
+    stage->TransformRepository = vtkIGSIOTransformRepository::New();
+    if (stage->TransformRepository->ReadConfiguration(rootConfigElement) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to read transform repository configuration");
+      stage->TransformRepository->Delete();
+      return PLUS_FAIL;
+    }
+    processor->SetTransformRepository(stage->TransformRepository);
+    processor->ReadConfiguration(processorElement);
+    stage->Processor = processor;
+    stage->Processor->Register(this);
+    stage->NumberOfProcessedFrames = 0;
+    stage->TotalLatencySec = 0.0;
+    stage->TotalProcessingTimeSec = 0.0;
+    this->ProcessorStages.push_back(std::move(stage));
+  }
+
+  if (this->ProcessorStages.size() > 1)
+  {
+    LOG_INFO("Frames are processed by a pipeline of " << this->ProcessorStages.size() << " processors");
   }
 
   return PLUS_SUCCESS;
@@ -138,17 +169,30 @@ PlusStatus vtkPlusImageProcessorVideoSource::WriteConfiguration(vtkXMLDataElemen
 {
   XML_FIND_DEVICE_ELEMENT_REQUIRED_FOR_WRITING(deviceElement, rootConfig);
   deviceElement->SetAttribute("EnableCapturing", this->EnableProcessing ? "TRUE" : "FALSE");
+  deviceElement->SetIntAttribute("PipelineQueueSize", this->PipelineQueueSize);
+  this->BacklogPolicy.WriteConfiguration(deviceElement);
 
-  // Write processor elements
-  if (this->ProcessorAlgorithm != NULL)
+  // Write processor elements, in the order of the stages
+  if (!this->ProcessorStages.empty())
   {
-    vtkXMLDataElement* processorElement = igsioXmlUtils::GetNestedElementWithName(deviceElement, vtkPlusTrackedFrameProcessor::GetTagName());
-    if (processorElement == NULL)
+    std::vector<vtkXMLDataElement*> processorElements;
+    for (int nestedElemIndex = 0; nestedElemIndex < deviceElement->GetNumberOfNestedElements(); ++nestedElemIndex)
+    {
+      vtkXMLDataElement* processorElement = deviceElement->GetNestedElement(nestedElemIndex);
+      if (processorElement != NULL && STRCASECMP(vtkPlusTrackedFrameProcessor::GetTagName(), processorElement->GetName()) == 0)
+      {
+        processorElements.push_back(processorElement);
+      }
+    }
+    if (processorElements.size() < this->ProcessorStages.size())
     {
-      LOG_ERROR("Cannot find " << vtkPlusTrackedFrameProcessor::GetTagName() << " element in XML tree!");
+      LOG_ERROR("Cannot find " << vtkPlusTrackedFrameProcessor::GetTagName() << " element for each processor in XML tree!");
       return PLUS_FAIL;
     }
-    this->ProcessorAlgorithm->WriteConfiguration(processorElement);
+    for (size_t stageIndex = 0; stageIndex < this->ProcessorStages.size(); ++stageIndex)
+    {
+      this->ProcessorStages[stageIndex]->Processor->WriteConfiguration(processorElements[stageIndex]);
+    }
   }
   else
   {
@@ -187,6 +231,9 @@ PlusStatus vtkPlusImageProcessorVideoSource::InternalConnect()
   }
 
   this->LastProcessedInputDataTimestamp = 0;
+  this->BacklogPolicy.Reset();
+
+  this->StartPipeline();
 
   return PLUS_SUCCESS;
 }
@@ -196,6 +243,12 @@ PlusStatus vtkPlusImageProcessorVideoSource::InternalDisconnect()
 {
   igsioLockGuard<vtkIGSIORecursiveCriticalSection> writerLock(this->ProcessingAlgorithmAccessMutex);
   this->EnableProcessing = false;
+  this->StopPipeline();
+  if (this->BacklogPolicy.GetNumberOfSkippedFrames() > 0)
+  {
+    LOG_INFO("Image processor " << this->GetDeviceId() << " skipped " << this->BacklogPolicy.GetNumberOfSkippedFrames() << " input frames ("
+             << PlusFrameBacklogPolicy::GetBacklogPolicyAsString(this->BacklogPolicy.GetBacklogPolicy()) << " backlog policy)");
+  }
   return PLUS_SUCCESS;
 }
 
@@ -235,21 +288,47 @@ PlusStatus vtkPlusImageProcessorVideoSource::InternalUpdate()
       this->LastProcessedInputDataTimestamp = oldestTrackingTimestamp;
     }
   }
-  igsioTrackedFrame trackedFrame;
-  if (this->InputChannels[0]->GetTrackedFrame(trackedFrame) != PLUS_SUCCESS)
+  // The image data of the input frames is shared with the input buffer
+  this->InputFrames->Clear();
+  if (this->BacklogPolicy.GetFramesToProcess(this->InputChannels[0], this->InputFrames) != PLUS_SUCCESS)
   {
-    LOG_ERROR("Error while getting latest tracked frame. Last recorded timestamp: " << std::fixed << this->LastProcessedInputDataTimestamp << ". Device ID: " << this->GetDeviceId());
+    LOG_ERROR("Error while getting tracked frames. Last recorded timestamp: " << std::fixed << this->LastProcessedInputDataTimestamp << ". Device ID: " << this->GetDeviceId());
     this->LastProcessedInputDataTimestamp = vtkIGSIOAccurateTimer::GetSystemTime(); // forget about the past, try to add frames that are acquired from now on
     return PLUS_FAIL;
   }
 
-  LOG_TRACE("Image to be processed: timestamp=" << trackedFrame.GetTimestamp());
-
   if (this->OutputChannels.empty())
   {
     LOG_ERROR("No output channels defined");
     return PLUS_FAIL;
   }
+  if (this->ProcessorStages.empty())
+  {
+    LOG_ERROR("No processor is defined for ImageProcessor. Device ID: " << this->GetDeviceId());
+    return PLUS_FAIL;
+  }
+
+  PlusStatus status = PLUS_SUCCESS;
+  for (unsigned int frameIndex = 0; frameIndex < this->InputFrames->GetNumberOfTrackedFrames(); ++frameIndex)
+  {
+    igsioTrackedFrame& trackedFrame = *this->InputFrames->GetTrackedFrame(frameIndex);
+    LOG_TRACE("Image to be processed: timestamp=" << trackedFrame.GetTimestamp());
+    if (this->ProcessorStages.size() > 1)
+    {
+      status = (this->UpdatePipeline(trackedFrame) == PLUS_SUCCESS) ? status : PLUS_FAIL;
+    }
+    else
+    {
+      status = (this->ProcessFrame(trackedFrame) == PLUS_SUCCESS) ? status : PLUS_FAIL;
+    }
+  }
+  this->InputFrames->Clear();
+  return status;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusImageProcessorVideoSource::ProcessFrame(igsioTrackedFrame& trackedFrame)
+{
   vtkPlusChannel* outputChannel = this->OutputChannels[0];
   double latestFrameAlreadyAddedTimestamp = 0;
   outputChannel->GetMostRecentTimestamp(latestFrameAlreadyAddedTimestamp);
@@ -261,31 +340,39 @@ PlusStatus vtkPlusImageProcessorVideoSource::InternalUpdate()
     return PLUS_SUCCESS;
   }
 
+  vtkPlusTrackedFrameProcessor* processor = this->ProcessorStages[0]->Processor;
   vtkSmartPointer<vtkIGSIOTrackedFrameList> trackingFrames = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
   trackingFrames->AddTrackedFrame(&trackedFrame);
-  this->ProcessorAlgorithm->SetInputFrames(trackingFrames);
-  if (this->ProcessorAlgorithm->Update() != PLUS_SUCCESS)
+  processor->SetInputFrames(trackingFrames);
+  if (processor->Update() != PLUS_SUCCESS)
   {
     return PLUS_FAIL;
   }
 
-  vtkPlusDataSource* aSource(NULL);
-  if (outputChannel->GetVideoSource(aSource) != PLUS_SUCCESS)
+  vtkIGSIOTrackedFrameList* processedFrames = processor->GetOutputFrames();
+  if (processedFrames == NULL || processedFrames->GetNumberOfTrackedFrames() < 1)
   {
-    LOG_ERROR("Unable to retrieve the video source in the image processor device.");
+    LOG_ERROR("Failed to retrieve processed frame");
     return PLUS_FAIL;
   }
 
-  PlusStatus status = PLUS_SUCCESS;
+  PlusStatus status = this->AddProcessedFrame(processedFrames->GetTrackedFrame(0), frameTimestamp);
+  this->Modified();
+  return status;
+}
 
-  vtkIGSIOTrackedFrameList* processedFrames = this->ProcessorAlgorithm->GetOutputFrames();
-  if (processedFrames == NULL || processedFrames->GetNumberOfTrackedFrames() < 1)
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusImageProcessorVideoSource::AddProcessedFrame(igsioTrackedFrame* processedTrackedFrame, double frameTimestamp)
+{
+  vtkPlusDataSource* aSource(NULL);
+  if (this->OutputChannels[0]->GetVideoSource(aSource) != PLUS_SUCCESS)
   {
-    LOG_ERROR("Failed to retrieve processed frame");
+    LOG_ERROR("Unable to retrieve the video source in the image processor device.");
     return PLUS_FAIL;
   }
 
-  igsioTrackedFrame* processedTrackedFrame = processedFrames->GetTrackedFrame(0);
+  PlusStatus status = PLUS_SUCCESS;
+
   // Generate unique frame number (not used for filtering, so the actual increment value does not matter)
   this->FrameNumber++;
 
@@ -316,10 +403,240 @@ PlusStatus vtkPlusImageProcessorVideoSource::InternalUpdate()
     status = PLUS_FAIL;
   }
 
-  this->Modified();
   return status;
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusImageProcessorVideoSource::UpdatePipeline(igsioTrackedFrame& trackedFrame)
+{
+  // Frames that went through all the stages, they are in the order of acquisition
+  FrameQueueType completedFrames;
+  bool frameQueued = false;
+  {
+    std::lock_guard<std::mutex> lock(this->PipelineMutex);
+    completedFrames.swap(this->CompletedFrames);
+
+    // Start processing the new frame if there is room for it, otherwise skip it to keep up with the acquisition
+    double frameTimestamp = trackedFrame.GetTimestamp();
+    if (frameTimestamp > this->LastQueuedInputDataTimestamp)
+    {
+      FrameQueueType& firstQueue = this->ProcessorStages[0]->Queue;
+      if (static_cast<int>(firstQueue.size()) < this->PipelineQueueSize)
+      {
+        firstQueue.push_back(std::make_pair(new igsioTrackedFrame(trackedFrame), vtkIGSIOAccurateTimer::GetSystemTime()));
+        frameQueued = true;
+      }
+      else
+      {
+        LOG_TRACE("Processing pipeline is full, frame is skipped: timestamp=" << frameTimestamp);
+        this->BacklogPolicy.AddSkippedFrames(1);
+      }
+      this->LastQueuedInputDataTimestamp = frameTimestamp;
+    }
+  }
+  if (frameQueued || !completedFrames.empty())
+  {
+    this->PipelineCondition.notify_all();
+  }
+
+  PlusStatus status = PLUS_SUCCESS;
+  for (FrameQueueType::iterator completedFrame = completedFrames.begin(); completedFrame != completedFrames.end(); ++completedFrame)
+  {
+    if (this->AddProcessedFrame(completedFrame->first, completedFrame->first->GetTimestamp()) != PLUS_SUCCESS)
+    {
+      status = PLUS_FAIL;
+    }
+    delete completedFrame->first;
+  }
+  if (!completedFrames.empty())
+  {
+    this->Modified();
+  }
+  return status;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusImageProcessorVideoSource::StartPipeline()
+{
+  this->StopPipeline();
+  if (this->ProcessorStages.size() < 2)
+  {
+    // A single processor is run synchronously in InternalUpdate
+    return;
+  }
+
+  this->PipelineStopping = false;
+  this->LastQueuedInputDataTimestamp = 0;
+  for (size_t stageIndex = 0; stageIndex < this->ProcessorStages.size(); ++stageIndex)
+  {
+    ProcessorStage& stage = *this->ProcessorStages[stageIndex];
+    stage.NumberOfProcessedFrames = 0;
+    stage.TotalLatencySec = 0.0;
+    stage.TotalProcessingTimeSec = 0.0;
+    stage.Thread = std::thread(&vtkPlusImageProcessorVideoSource::PipelineStageThreadMain, this, static_cast<int>(stageIndex));
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusImageProcessorVideoSource::StopPipeline()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->PipelineMutex);
+    this->PipelineStopping = true;
+  }
+  this->PipelineCondition.notify_all();
+
+  for (int stageIndex = 0; stageIndex < this->GetNumberOfProcessorStages(); ++stageIndex)
+  {
+    ProcessorStage& stage = *this->ProcessorStages[stageIndex];
+    if (!stage.Thread.joinable())
+    {
+      continue;
+    }
+    stage.Thread.join();
+    LOG_INFO("Processor stage " << stageIndex << " (" << stage.Processor->GetProcessorTypeName() << ") processed " << stage.NumberOfProcessedFrames
+             << " frames, average latency: " << 1000.0 * this->GetStageAverageLatencySec(stageIndex)
+             << "ms, average processing time: " << 1000.0 * this->GetStageAverageProcessingTimeSec(stageIndex) << "ms");
+  }
+
+  // Remove the frames that are still in the pipeline
+  for (int stageIndex = 0; stageIndex < this->GetNumberOfProcessorStages(); ++stageIndex)
+  {
+    FrameQueueType& queue = this->ProcessorStages[stageIndex]->Queue;
+    for (FrameQueueType::iterator frame = queue.begin(); frame != queue.end(); ++frame)
+    {
+      delete frame->first;
+    }
+    queue.clear();
+  }
+  for (FrameQueueType::iterator frame = this->CompletedFrames.begin(); frame != this->CompletedFrames.end(); ++frame)
+  {
+    delete frame->first;
+  }
+  this->CompletedFrames.clear();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusImageProcessorVideoSource::PipelineStageThreadMain(int stageIndex)
+{
+  ProcessorStage& stage = *this->ProcessorStages[stageIndex];
+  const bool isLastStage = (stageIndex + 1 == this->GetNumberOfProcessorStages());
+  FrameQueueType& outputQueue = isLastStage ? this->CompletedFrames : this->ProcessorStages[stageIndex + 1]->Queue;
+  vtkSmartPointer<vtkIGSIOTrackedFrameList> inputFrames = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+
+  while (true)
+  {
+    std::pair<igsioTrackedFrame*, double> queuedFrame;
+    {
+      std::unique_lock<std::mutex> lock(this->PipelineMutex);
+      this->PipelineCondition.wait(lock, [this, &stage]() { return this->PipelineStopping || !stage.Queue.empty(); });
+      if (this->PipelineStopping)
+      {
+        return;
+      }
+      queuedFrame = stage.Queue.front();
+      stage.Queue.pop_front();
+    }
+    // There is room in the queue for the previous stage
+    this->PipelineCondition.notify_all();
+
+    // The frame list takes the ownership of the frame
+    const double processingStartTime = vtkIGSIOAccurateTimer::GetSystemTime();
+    inputFrames->Clear();
+    inputFrames->TakeTrackedFrame(queuedFrame.first);
+    stage.Processor->SetInputFrames(inputFrames);
+    igsioTrackedFrame* processedFrame = NULL;
+    vtkIGSIOTrackedFrameList* processedFrames = stage.Processor->GetOutputFrames();
+    if (stage.Processor->Update() == PLUS_SUCCESS && processedFrames != NULL && processedFrames->GetNumberOfTrackedFrames() > 0)
+    {
+      processedFrame = new igsioTrackedFrame(*processedFrames->GetTrackedFrame(0));
+    }
+    else
+    {
+      LOG_ERROR("Processor stage " << stageIndex << " (" << stage.Processor->GetProcessorTypeName() << ") failed to process frame: timestamp=" << queuedFrame.first->GetTimestamp());
+    }
+    const double processingStopTime = vtkIGSIOAccurateTimer::GetSystemTime();
+    LOG_TRACE("Processor stage " << stageIndex << " latency: " << 1000.0 * (processingStopTime - queuedFrame.second) << "ms, processing time: " << 1000.0 * (processingStopTime - processingStartTime) << "ms");
+
+    {
+      std::unique_lock<std::mutex> lock(this->PipelineMutex);
+      stage.NumberOfProcessedFrames++;
+      stage.TotalLatencySec += processingStopTime - queuedFrame.second;
+      stage.TotalProcessingTimeSec += processingStopTime - processingStartTime;
+      if (processedFrame != NULL)
+      {
+        // Wait until the next stage (or InternalUpdate for the last stage) takes a frame from its queue
+        this->PipelineCondition.wait(lock, [this, &outputQueue]() { return this->PipelineStopping || static_cast<int>(outputQueue.size()) < this->PipelineQueueSize; });
+        if (this->PipelineStopping)
+        {
+          delete processedFrame;
+          return;
+        }
+        outputQueue.push_back(std::make_pair(processedFrame, vtkIGSIOAccurateTimer::GetSystemTime()));
+      }
+    }
+    this->PipelineCondition.notify_all();
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkPlusImageProcessorVideoSource::GetNumberOfProcessorStages()
+{
+  return static_cast<int>(this->ProcessorStages.size());
+}
+
+//----------------------------------------------------------------------------
+double vtkPlusImageProcessorVideoSource::GetStageAverageLatencySec(int stageIndex)
+{
+  if (stageIndex < 0 || stageIndex >= this->GetNumberOfProcessorStages())
+  {
+    LOG_ERROR("Invalid processor stage index: " << stageIndex);
+    return 0.0;
+  }
+  std::lock_guard<std::mutex> lock(this->PipelineMutex);
+  const ProcessorStage& stage = *this->ProcessorStages[stageIndex];
+  return stage.NumberOfProcessedFrames > 0 ? stage.TotalLatencySec / stage.NumberOfProcessedFrames : 0.0;
+}
+
+//----------------------------------------------------------------------------
+double vtkPlusImageProcessorVideoSource::GetStageAverageProcessingTimeSec(int stageIndex)
+{
+  if (stageIndex < 0 || stageIndex >= this->GetNumberOfProcessorStages())
+  {
+    LOG_ERROR("Invalid processor stage index: " << stageIndex);
+    return 0.0;
+  }
+  std::lock_guard<std::mutex> lock(this->PipelineMutex);
+  const ProcessorStage& stage = *this->ProcessorStages[stageIndex];
+  return stage.NumberOfProcessedFrames > 0 ? stage.TotalProcessingTimeSec / stage.NumberOfProcessedFrames : 0.0;
+}
+
+//----------------------------------------------------------------------------
+unsigned long long vtkPlusImageProcessorVideoSource::GetInternalMemoryUsageInBytes()
+{
+  std::lock_guard<std::mutex> lock(this->PipelineMutex);
+  std::vector<const FrameQueueType*> queues;
+  for (std::vector<std::unique_ptr<ProcessorStage> >::iterator stageIt = this->ProcessorStages.begin(); stageIt != this->ProcessorStages.end(); ++stageIt)
+  {
+    queues.push_back(&(*stageIt)->Queue);
+  }
+  queues.push_back(&this->CompletedFrames);
+
+  unsigned long long usedBytes = 0;
+  for (std::vector<const FrameQueueType*>::iterator queueIt = queues.begin(); queueIt != queues.end(); ++queueIt)
+  {
+    for (FrameQueueType::const_iterator it = (*queueIt)->begin(); it != (*queueIt)->end(); ++it)
+    {
+      igsioTrackedFrame* frame = it->first;
+      if (frame != NULL && frame->GetImageData() != NULL && frame->GetImageData()->IsImageValid())
+      {
+        usedBytes += static_cast<unsigned long long>(frame->GetImageData()->GetFrameSizeInBytes());
+      }
+    }
+  }
+  return usedBytes;
+}
+
 //-----------------------------------------------------------------------------
 PlusStatus vtkPlusImageProcessorVideoSource::NotifyConfigured()
 {
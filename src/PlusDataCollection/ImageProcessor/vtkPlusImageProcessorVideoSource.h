@@ -10,15 +10,30 @@ See License.txt for details.
 #include "vtkPlusDataCollectionExport.h"
 
 #include "vtkPlusDevice.h"
+#include "PlusFrameBacklogPolicy.h"
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 //class vtkIGSIOTransformRepository;
+class vtkIGSIOTrackedFrameList;
 class vtkPlusTrackedFrameProcessor;
 
 /*!
 \class vtkPlusImageProcessorVideoSource 
 \brief Virtual device that performs real-time image processing on the input channel
 
+If more than one Processor element is defined then the processors form a pipeline: the output of each processor is the
+input of the next one. Each processor stage runs on its own thread and the stages are connected by bounded queues,
+so that the stages process different frames at the same time. Frames leave the pipeline in the order of acquisition.
+If the first queue is full when a new frame is acquired then the frame is skipped.
+
 \ingroup PlusLibDataCollection
 */
 class vtkPlusDataCollectionExport vtkPlusImageProcessorVideoSource : public vtkPlusDevice
@@ -42,6 +57,25 @@ public:
   vtkGetMacro(EnableProcessing, bool);
   void SetEnableProcessing(bool aValue);
 
+  /*! Maximum number of frames waiting in the queue of each processor stage and at the output of the pipeline */
+  vtkSetMacro(PipelineQueueSize, int);
+  vtkGetMacro(PipelineQueueSize, int);
+
+  /*! Number of processors that the frames go through */
+  int GetNumberOfProcessorStages();
+
+  /*! Average time between queuing a frame for a processor stage and the end of its processing in that stage, in seconds */
+  double GetStageAverageLatencySec(int stageIndex);
+
+  /*! Average processing time of a frame in a processor stage, in seconds */
+  double GetStageAverageProcessingTimeSec(int stageIndex);
+
+  /*! Image data of the frames that wait in the queues of the processor stages and at the output of the pipeline */
+  virtual unsigned long long GetInternalMemoryUsageInBytes();
+
+  /*! Selects the input frames to process when frames are acquired faster than they can be processed */
+  PlusFrameBacklogPolicy& GetBacklogPolicy() { return this->BacklogPolicy; }
+
   virtual bool IsTracker() const { return false; }
   virtual bool IsVirtual() const { return true; }
 
@@ -52,6 +86,37 @@ protected:
   vtkPlusImageProcessorVideoSource();
   virtual ~vtkPlusImageProcessorVideoSource();
 
+  /*! Frames and the time when they were added to the queue */
+  typedef std::deque<std::pair<igsioTrackedFrame*, double> > FrameQueueType;
+
+  struct ProcessorStage
+  {
+    vtkPlusTrackedFrameProcessor* Processor;
+    /*! Each stage has its own transform repository, as the stages process different frames at the same time */
+    vtkIGSIOTransformRepository* TransformRepository;
+    /*! Frames waiting for processing in this stage */
+    FrameQueueType Queue;
+    std::thread Thread;
+    int NumberOfProcessedFrames;
+    double TotalLatencySec;
+    double TotalProcessingTimeSec;
+  };
+
+  /*! Start a thread for each processor stage, if there are more than one. */
+  void StartPipeline();
+  /*! Stop the processor stage threads and remove the frames that are still in the pipeline */
+  void StopPipeline();
+  void PipelineStageThreadMain(int stageIndex);
+  /*! Add the frames that went through the pipeline to the output and queue the new input frame */
+  PlusStatus UpdatePipeline(igsioTrackedFrame& trackedFrame);
+  void DeleteProcessorStages();
+
+  /*! Process a frame by the only processor and add the result to the output */
+  PlusStatus ProcessFrame(igsioTrackedFrame& trackedFrame);
+
+  /*! Add a processed frame to the video source of the output channel */
+  PlusStatus AddProcessedFrame(igsioTrackedFrame* processedTrackedFrame, double frameTimestamp);
+
   double LastProcessedInputDataTimestamp;
 
   bool EnableProcessing;
@@ -67,7 +132,22 @@ protected:
 
   vtkPlusLogger::LogLevelType GracePeriodLogLevel;
 
-  vtkPlusTrackedFrameProcessor* ProcessorAlgorithm;
+  /*! Processors in the order of processing */
+  std::vector<std::unique_ptr<ProcessorStage> > ProcessorStages;
+
+  int PipelineQueueSize;
+  /*! Frames that went through all the stages, waiting to be added to the output */
+  FrameQueueType CompletedFrames;
+  /*! Timestamp of the most recent frame that was added to the pipeline */
+  double LastQueuedInputDataTimestamp;
+  /*! Guards the queues and the statistics of the stages */
+  std::mutex PipelineMutex;
+  std::condition_variable PipelineCondition;
+  bool PipelineStopping;
+
+  PlusFrameBacklogPolicy BacklogPolicy;
+  /*! Input frames selected by the backlog policy in the current update */
+  vtkSmartPointer<vtkIGSIOTrackedFrameList> InputFrames;
 
 private:
   vtkPlusImageProcessorVideoSource(const vtkPlusImageProcessorVideoSource&);  // Not implemented.
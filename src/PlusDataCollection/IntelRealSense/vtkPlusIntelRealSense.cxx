@@ -37,6 +37,8 @@ public:
   vtkInternal(vtkPlusIntelRealSense* external)
     : External(external)
     , Align(nullptr)
+    , DepthToDisparity(true)
+    , DisparityToDepth(false)
   {
   }
 
@@ -46,15 +48,18 @@ public:
 
   struct RSFrameConfig
   {
-    RSFrameConfig(rs2_stream st, std::string sn, int width, int height, int fr)
+    RSFrameConfig(rs2_stream st, bool pc, std::string sn, int width, int height, int fr)
     {
       this->StreamType = st;
+      this->PointCloud = pc;
       this->SourceName = sn;
+      this->Source = nullptr;
       this->Height = height;
       this->Width = width;
       this->FrameRate = fr;
     }
     rs2_stream StreamType;
+    bool PointCloud; // if true then the point cloud computed from the depth stream is sent instead of the depth image
     std::string SourceName;
     vtkPlusDataSource* Source;
     unsigned int Height;
@@ -65,6 +70,10 @@ public:
   // Configuration parameters
   bool UseRealSenseColorizer = false;
   bool AlignDepthStream = false;
+  int DecimationMagnitude = 1;
+  bool TemporalFilter = false;
+  double TemporalFilterSmoothAlpha = 0.4;
+  double TemporalFilterSmoothDelta = 20.0;
 
   // Frame setup for RGB & depth
   std::vector<RSFrameConfig> VideoSources;
@@ -80,8 +89,72 @@ public:
   PlusStatus SetStreamToAlign(const std::vector<rs2::stream_profile>& streams);
   rs2_stream AlignTo;
   rs2::align* Align; // rs2::align doesn't have a default constructor, so we must use a pointer
+
+  // Processing blocks, created once and applied to every frame.
+  // Alignment and point cloud computation run on the GPU if librealsense is built with CUDA support.
+  PlusStatus SetupProcessingBlocks();
+  rs2::frameset ProcessFrames(const rs2::frameset& frames);
+  rs2::decimation_filter Decimation;
+  rs2::disparity_transform DepthToDisparity;
+  rs2::temporal_filter Temporal;
+  rs2::disparity_transform DisparityToDepth;
+  rs2::colorizer Colorizer;
+  rs2::pointcloud PointCloud;
+
+  // Point cloud vertices in mm, reused for every frame
+  std::vector<float> PointCloudVerticesMm;
 };
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusIntelRealSense::vtkInternal::SetupProcessingBlocks()
+{
+  try
+  {
+    if (this->DecimationMagnitude > 1)
+    {
+      this->Decimation.set_option(RS2_OPTION_FILTER_MAGNITUDE, static_cast<float>(this->DecimationMagnitude));
+    }
+    if (this->TemporalFilter)
+    {
+      this->Temporal.set_option(RS2_OPTION_FILTER_SMOOTH_ALPHA, static_cast<float>(this->TemporalFilterSmoothAlpha));
+      this->Temporal.set_option(RS2_OPTION_FILTER_SMOOTH_DELTA, static_cast<float>(this->TemporalFilterSmoothDelta));
+    }
+    if (this->UseRealSenseColorizer)
+    {
+      this->Colorizer.set_option(RS2_OPTION_HISTOGRAM_EQUALIZATION_ENABLED, 1);
+      this->Colorizer.set_option(RS2_OPTION_MIN_DISTANCE, 0.6f);
+      this->Colorizer.set_option(RS2_OPTION_MAX_DISTANCE, 1.0f);
+    }
+  }
+  catch (rs2::error e)
+  {
+    LOG_ERROR("Failed to set up IntelRealSense depth filters. Check the DecimationMagnitude and TemporalFilter* attributes. RealSense API gave the error: '" << e.what() << "'");
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+rs2::frameset vtkPlusIntelRealSense::vtkInternal::ProcessFrames(const rs2::frameset& frames)
+{
+  // Filters only process the depth frame of the frameset, the other frames are passed through
+  rs2::frameset processedFrames = frames;
+  if (this->DecimationMagnitude > 1)
+  {
+    processedFrames = processedFrames.apply_filter(this->Decimation);
+  }
+  if (this->TemporalFilter)
+  {
+    // Temporal filtering is more accurate in disparity domain
+    processedFrames = processedFrames.apply_filter(this->DepthToDisparity).apply_filter(this->Temporal).apply_filter(this->DisparityToDepth);
+  }
+  if (this->Align != nullptr)
+  {
+    processedFrames = this->Align->process(processedFrames);
+  }
+  return processedFrames;
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusIntelRealSense::vtkInternal::SetDepthScaleToMm(rs2::device dev)
 {
@@ -175,6 +248,10 @@ PlusStatus vtkPlusIntelRealSense::ReadConfiguration(vtkXMLDataElement* rootConfi
   XML_FIND_DEVICE_ELEMENT_REQUIRED_FOR_READING(deviceConfig, rootConfigElement);
   XML_READ_BOOL_ATTRIBUTE_NONMEMBER_OPTIONAL(UseRealSenseColorizer, this->Internal->UseRealSenseColorizer, deviceConfig);
   XML_READ_BOOL_ATTRIBUTE_NONMEMBER_OPTIONAL(AlignDepthStream, this->Internal->AlignDepthStream, deviceConfig);
+  XML_READ_SCALAR_ATTRIBUTE_NONMEMBER_OPTIONAL(int, DecimationMagnitude, this->Internal->DecimationMagnitude, deviceConfig);
+  XML_READ_BOOL_ATTRIBUTE_NONMEMBER_OPTIONAL(TemporalFilter, this->Internal->TemporalFilter, deviceConfig);
+  XML_READ_SCALAR_ATTRIBUTE_NONMEMBER_OPTIONAL(double, TemporalFilterSmoothAlpha, this->Internal->TemporalFilterSmoothAlpha, deviceConfig);
+  XML_READ_SCALAR_ATTRIBUTE_NONMEMBER_OPTIONAL(double, TemporalFilterSmoothDelta, this->Internal->TemporalFilterSmoothDelta, deviceConfig);
 
   XML_FIND_NESTED_ELEMENT_REQUIRED(dataSourcesElement, deviceConfig, "DataSources");
   for (int nestedElementIndex = 0; nestedElementIndex < dataSourcesElement->GetNumberOfNestedElements(); nestedElementIndex++)
@@ -199,13 +276,33 @@ PlusStatus vtkPlusIntelRealSense::ReadConfiguration(vtkXMLDataElement* rootConfi
       }
 
       // get Intel RealSense video parameters for this source
-      rs2_stream sourceType;
-      XML_READ_ENUM2_ATTRIBUTE_NONMEMBER_REQUIRED(FrameType, sourceType, dataElement, "RGB", RS2_STREAM_COLOR, "DEPTH", RS2_STREAM_DEPTH);
+      // POINTCLOUD sources are computed from the depth stream
+      rs2_stream sourceType = RS2_STREAM_COLOR;
+      bool pointCloud = false;
+      const char* frameType = dataElement->GetAttribute("FrameType");
+      if (frameType != NULL && STRCASECMP(frameType, "RGB") == 0)
+      {
+        sourceType = RS2_STREAM_COLOR;
+      }
+      else if (frameType != NULL && STRCASECMP(frameType, "DEPTH") == 0)
+      {
+        sourceType = RS2_STREAM_DEPTH;
+      }
+      else if (frameType != NULL && STRCASECMP(frameType, "POINTCLOUD") == 0)
+      {
+        sourceType = RS2_STREAM_DEPTH;
+        pointCloud = true;
+      }
+      else
+      {
+        LOG_ERROR("Failed to initialize IntelRealSense DataSource " << toolId << ": FrameType attribute is missing or invalid, it must be RGB, DEPTH or POINTCLOUD");
+        return PLUS_FAIL;
+      }
       int frameSize[2] = { REALSENSE_DEFAULT_FRAME_WIDTH, REALSENSE_DEFAULT_FRAME_HEIGHT };
       XML_READ_VECTOR_ATTRIBUTE_NONMEMBER_OPTIONAL(int, 2, FrameSize, frameSize, dataElement);
       int frameRate = REALSENSE_DEFAULT_FRAME_RATE;
       XML_READ_SCALAR_ATTRIBUTE_NONMEMBER_OPTIONAL(int, FrameRate, frameRate, dataElement);
-      vtkInternal::RSFrameConfig source(sourceType, toolId, frameSize[0], frameSize[1], frameRate);
+      vtkInternal::RSFrameConfig source(sourceType, pointCloud, toolId, frameSize[0], frameSize[1], frameRate);
       this->Internal->VideoSources.push_back(source);
     }
     else
@@ -242,6 +339,11 @@ PlusStatus vtkPlusIntelRealSense::WriteConfiguration(vtkXMLDataElement* rootConf
     deviceConfig->SetAttribute("AlignDepthStream", "FALSE");
   }
 
+  deviceConfig->SetIntAttribute("DecimationMagnitude", this->Internal->DecimationMagnitude);
+  deviceConfig->SetAttribute("TemporalFilter", this->Internal->TemporalFilter ? "TRUE" : "FALSE");
+  deviceConfig->SetDoubleAttribute("TemporalFilterSmoothAlpha", this->Internal->TemporalFilterSmoothAlpha);
+  deviceConfig->SetDoubleAttribute("TemporalFilterSmoothDelta", this->Internal->TemporalFilterSmoothDelta);
+
   return PLUS_SUCCESS;
 }
 
@@ -342,9 +444,16 @@ PlusStatus vtkPlusIntelRealSense::InternalStartRecording()
     {
       return PLUS_FAIL;
     }
+    delete this->Internal->Align;
     this->Internal->Align = new rs2::align(this->Internal->AlignTo);
   }
 
+  if (this->Internal->SetupProcessingBlocks() == PLUS_FAIL)
+  {
+    this->Internal->Pipe.stop();
+    return PLUS_FAIL;
+  }
+
   return PLUS_SUCCESS;
 }
 
@@ -365,15 +474,18 @@ PlusStatus vtkPlusIntelRealSense::NotifyConfigured()
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusIntelRealSense::InternalUpdate()
 {
-  // wait for frame
-  rs2::frameset frames = this->Internal->Pipe.wait_for_frames();
-
-  // if requested, align depth to color
-  if (this->Internal->AlignDepthStream)
+  // wait for frame, then filter the depth frame and if requested, align depth to color
+  rs2::frameset frames;
+  try
   {
-    frames = this->Internal->Align->process(frames);
+    frames = this->Internal->ProcessFrames(this->Internal->Pipe.wait_for_frames());
   }
-  
+  catch (rs2::error e)
+  {
+    LOG_ERROR("Failed to get IntelRealSense frames. RealSense API gave the error: '" << e.what() << "'");
+    return PLUS_FAIL;
+  }
+
   // forward video data to PlusDataSource
   std::vector<vtkInternal::RSFrameConfig>::iterator it;
   for (it = begin(this->Internal->VideoSources); it != end(this->Internal->VideoSources); it++)
@@ -385,81 +497,72 @@ PlusStatus vtkPlusIntelRealSense::InternalUpdate()
       return PLUS_FAIL;
     }
 
-    // if this is the first frame, initialize the buffer
-    if (it->Source->GetNumberOfItems() == 0 && it->StreamType == RS2_STREAM_COLOR)
-    {
-      LOG_INFO("setting up color frame");
-      it->Source->SetImageType(US_IMG_RGB_COLOR);
-      it->Source->SetPixelType(VTK_UNSIGNED_CHAR);
-      it->Source->SetNumberOfScalarComponents(3);
-      it->Source->SetInputFrameSize(it->Width, it->Height, 1);
-    }
-    else if (it->Source->GetNumberOfItems() == 0 && it->StreamType == RS2_STREAM_DEPTH)
-    {
-      if (this->Internal->UseRealSenseColorizer)
-      {
-        // depth output is RGB from rs2::colorizer
-        it->Source->SetImageType(US_IMG_RGB_COLOR);
-        it->Source->SetPixelType(VTK_UNSIGNED_CHAR);
-        it->Source->SetNumberOfScalarComponents(3);
-        it->Source->SetInputFrameSize(it->Width, it->Height, 1);
-      }
-      else
-      {
-        // depth output is raw depth data
-        LOG_INFO("setting up depth frame");
-        it->Source->SetImageType(US_IMG_BRIGHTNESS);
-        it->Source->SetPixelType(VTK_TYPE_UINT16);
-        it->Source->SetNumberOfScalarComponents(1);
-        it->Source->SetInputFrameSize(it->Width, it->Height, 1);
-      }
-    }
-
     // get frame data
-    rs2::frame frame = frames.first(it->StreamType);
+    rs2::video_frame frame = frames.first_or_default(it->StreamType);
     if (!frame)
     {
       LOG_ERROR("Failed to get IntelRealSense frame");
       return PLUS_FAIL;
     }
 
-    // add frame to PLUS buffer
-    if (it->StreamType == RS2_STREAM_COLOR)
+    // decimation and alignment change the size of the depth frame, so the size is taken from the frame
+    FrameSizeType frameSize = { static_cast<unsigned int>(frame.get_width()), static_cast<unsigned int>(frame.get_height()), 1 };
+    const void* frameData = frame.get_data();
+    igsioCommon::VTKScalarPixelType pixelType = VTK_UNSIGNED_CHAR;
+    int numberOfScalarComponents = 3;
+    US_IMAGE_TYPE imageType = US_IMG_RGB_COLOR;
+    rs2::frame colorizedFrame; // keeps the colorized data alive until it is added to the buffer
+    if (it->PointCloud)
     {
-      FrameSizeType frameSizeColor = { it->Width, it->Height, 1 };
-      if (it->Source->AddItem((void *)frame.get_data(), it->Source->GetInputImageOrientation(), frameSizeColor, VTK_UNSIGNED_CHAR, 3, US_IMG_RGB_COLOR, 0, this->FrameNumber) == PLUS_FAIL)
+      // organized point cloud: x, y, z coordinates (in mm, in the camera frame) of each depth pixel
+      rs2::points points = this->Internal->PointCloud.calculate(frame);
+      const rs2::vertex* vertices = points.get_vertices();
+      const size_t numberOfVertices = points.size();
+      this->Internal->PointCloudVerticesMm.resize(numberOfVertices * 3);
+      float* verticesMm = this->Internal->PointCloudVerticesMm.data();
+      for (size_t i = 0; i < numberOfVertices; ++i)
       {
-        LOG_ERROR("vtkPlusIntelRealSense::InternalUpdate Unable to send RGB image. Skipping frame.");
-        return PLUS_FAIL;
+        verticesMm[3 * i] = vertices[i].x * 1000.f;
+        verticesMm[3 * i + 1] = vertices[i].y * 1000.f;
+        verticesMm[3 * i + 2] = vertices[i].z * 1000.f;
       }
+      frameData = verticesMm;
+      pixelType = VTK_FLOAT;
+      numberOfScalarComponents = 3;
+      imageType = US_IMG_BRIGHTNESS;
+    }
+    else if (it->StreamType == RS2_STREAM_DEPTH && this->Internal->UseRealSenseColorizer)
+    {
+      // depth output is RGB from rs2::colorizer
+      colorizedFrame = this->Internal->Colorizer.colorize(frame);
+      frameData = colorizedFrame.get_data();
     }
     else if (it->StreamType == RS2_STREAM_DEPTH)
     {
-      FrameSizeType frameSizeDepth = { it->Width, it->Height, 1 };
-      if (this->Internal->UseRealSenseColorizer)
-      {
-        rs2::colorizer color;
-        color.set_option(RS2_OPTION_HISTOGRAM_EQUALIZATION_ENABLED, 1);
-        color.set_option(RS2_OPTION_MIN_DISTANCE, 0.6);
-        color.set_option(RS2_OPTION_MAX_DISTANCE, 1.0);
-        rs2::video_frame vfr = color.colorize(frame);
-        if (it->Source->AddItem((void *)vfr.get_data(), it->Source->GetInputImageOrientation(), frameSizeDepth, VTK_UNSIGNED_CHAR, 3, US_IMG_RGB_COLOR, 0, this->FrameNumber) == PLUS_FAIL)
-        {
-          LOG_ERROR("vtkPlusIntelRealSense::InternalUpdate Unable to send RGB image. Skipping frame.");
-          return PLUS_FAIL;
-        }
-      }
-      else
-      {
-        if (it->Source->AddItem((void *)frame.get_data(), it->Source->GetInputImageOrientation(), frameSizeDepth, VTK_TYPE_UINT16, 1, US_IMG_BRIGHTNESS, 0, this->FrameNumber) == PLUS_FAIL)
-        {
-          LOG_ERROR("vtkPlusIntelRealSense::InternalUpdate Unable to send DEPTH image. Skipping frame.");
-          return PLUS_FAIL;
-        }
-      }
+      // depth output is raw depth data
+      pixelType = VTK_TYPE_UINT16;
+      numberOfScalarComponents = 1;
+      imageType = US_IMG_BRIGHTNESS;
+    }
+
+    // if this is the first frame, initialize the buffer
+    if (it->Source->GetNumberOfItems() == 0)
+    {
+      LOG_INFO("Setting up IntelRealSense " << (it->PointCloud ? "point cloud" : (it->StreamType == RS2_STREAM_COLOR ? "color" : "depth")) << " frame: " << frameSize[0] << "x" << frameSize[1]);
+      it->Source->SetImageType(imageType);
+      it->Source->SetPixelType(pixelType);
+      it->Source->SetNumberOfScalarComponents(numberOfScalarComponents);
+      it->Source->SetInputFrameSize(frameSize[0], frameSize[1], 1);
+    }
+
+    // add frame to PLUS buffer
+    if (it->Source->AddItem(const_cast<void*>(frameData), it->Source->GetInputImageOrientation(), frameSize, pixelType, numberOfScalarComponents, imageType, 0, this->FrameNumber) == PLUS_FAIL)
+    {
+      LOG_ERROR("vtkPlusIntelRealSense::InternalUpdate Unable to send " << (it->PointCloud ? "POINTCLOUD" : (it->StreamType == RS2_STREAM_COLOR ? "RGB" : "DEPTH")) << " image. Skipping frame.");
+      return PLUS_FAIL;
     }
   }
 
-  this->FrameNumber++; 
+  this->FrameNumber++;
   return PLUS_SUCCESS;
 }
\ No newline at end of file
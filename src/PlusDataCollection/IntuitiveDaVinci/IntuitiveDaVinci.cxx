@@ -97,7 +97,7 @@ ISI_STATUS IntuitiveDaVinci::subscribe(ISI_EVENT_CALLBACK eCB, ISI_STREAM_CALLBA
   setStreamCallback(sCB, streamUserData);
   setEventCallback(eCB, eventUserData);
 
-  // Start streaming information at 60 Hz
+  // Start streaming information at the requested rate
   mStatus = isi_start_stream(mRateHz);
 
   if (mStatus != ISI_SUCCESS)
@@ -308,3 +308,9 @@ void IntuitiveDaVinci::setPassword(const std::string password)
 {
   mPassword = password;
 }
+
+//----------------------------------------------------------------------------
+void IntuitiveDaVinci::setRateHz(const unsigned int rateHz)
+{
+  mRateHz = rateHz;
+}
@@ -85,6 +85,9 @@ public:
 
   void setPassword(const std::string password);
 
+  // Rate of the stream callbacks, takes effect when streaming is started
+  void setRateHz(const unsigned int rateHz);
+
 protected:
   // Moved. Connect with hardcoded arguments for our custom config.
   ISI_STATUS connectWithArgs();
@@ -9,6 +9,9 @@ See License.txt for details.
 #include "PlusConfigure.h"
 #include "vtkPlusIntuitiveDaVinciTracker.h"
 
+// Local includes
+#include "vtkPlusDataSource.h"
+
 // VTK includes
 #include <vtkImageData.h>
 #include <vtkMath.h>
@@ -23,6 +26,7 @@ See License.txt for details.
 #include <time.h>
 
 // STL
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <set>
@@ -40,6 +44,7 @@ vtkPlusIntuitiveDaVinciTracker::vtkPlusIntuitiveDaVinciTracker()
   , IpAddr("10.0.0.5")
   , Port(5002)
   , Password("")
+  , JointValuesFieldData(false)
 #ifdef USE_DAVINCI_TIMESTAMPS
   , TrackerTimeToSystemTimeSec(0.0)
   , TrackerTimeToSystemTimeComputed(false)
@@ -47,7 +52,8 @@ vtkPlusIntuitiveDaVinciTracker::vtkPlusIntuitiveDaVinciTracker()
 {
   this->StartThreadForInternalUpdates = false; // Callback based system
   this->RequirePortNameInDeviceSetConfiguration = true;
-  this->AcquisitionRate = 20;
+  // The stream callbacks are called at the acquisition rate
+  this->AcquisitionRate = 60;
 }
 
 //----------------------------------------------------------------------------
@@ -167,6 +173,7 @@ PlusStatus vtkPlusIntuitiveDaVinciTracker::ReadConfiguration(vtkXMLDataElement*
   XML_READ_STRING_ATTRIBUTE_WARNING(IpAddr, deviceConfig);
   XML_READ_SCALAR_ATTRIBUTE_WARNING(unsigned int, Port, deviceConfig);
   XML_READ_STRING_ATTRIBUTE_WARNING(Password, deviceConfig);
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(JointValuesFieldData, deviceConfig);
 
   return PLUS_SUCCESS;
 }
@@ -178,7 +185,8 @@ PlusStatus vtkPlusIntuitiveDaVinciTracker::WriteConfiguration(vtkXMLDataElement*
 
   XML_WRITE_STRING_ATTRIBUTE_IF_NOT_EMPTY(IpAddr, trackerConfig);
   trackerConfig->SetIntAttribute("Port", this->Port);
-  XML_WRITE_STRING_ATTRIBUTE_IF_NOT_EMPTY(Password, trackerConfig)''
+  XML_WRITE_STRING_ATTRIBUTE_IF_NOT_EMPTY(Password, trackerConfig);
+  XML_WRITE_BOOL_ATTRIBUTE(JointValuesFieldData, trackerConfig);
 
   return PLUS_SUCCESS;
 }
@@ -203,6 +211,7 @@ PlusStatus vtkPlusIntuitiveDaVinciTracker::InternalConnect()
 
   // Set our connection parameters obtained from the config file
   this->DaVinci->setHostInfo(IpAddr, Port, Password);
+  this->DaVinci->setRateHz(static_cast<unsigned int>(this->AcquisitionRate));
 
   while (!initCompleted && connectionAttempts < MAX_ATTEMPTS)
   {
@@ -222,6 +231,9 @@ PlusStatus vtkPlusIntuitiveDaVinciTracker::InternalConnect()
     return PLUS_FAIL;
   }
 
+  // The stream callback only uses the resolved tools
+  this->BuildManipulatorTools();
+
   if (this->DaVinci->subscribe(NULL, vtkPlusIntuitiveDaVinciTrackerUtilities::streamCB, NULL, this) != ISI_SUCCESS)
   {
     LOG_ERROR("Error in subscribing to events and stream! Stream not started!");
@@ -285,36 +297,28 @@ void vtkPlusIntuitiveDaVinciTracker::StreamCallback(void)
   const double timeSystemSec = timeTrackerSec + this->TrackerTimeToSystemTimeSec;
 #endif
 
-  vtkNew<vtkMatrix4x4> transformMatrix;
-
-  ISI_TRANSFORM* transform(NULL);
+  // The callback is called at the stream rate, the tools and their matrices are prepared at connect
   ISI_STREAM_FIELD stream_data;
-  for (DataSourceContainerIterator it = this->Tools.begin(); it != this->Tools.end(); ++it)
+  ISI_TRANSFORM eyeFrame;
+  for (std::vector<ManipulatorTool>::iterator tool = this->ManipulatorTools.begin(); tool != this->ManipulatorTools.end(); ++tool)
   {
-    std::string toolName = it->second->GetPortName();
-
-    ISI_MANIP_INDEX manipIndex = getManipIndexFromName(toolName);
-
-    if (manipIndex == -1)
+    ISI_TRANSFORM* transform(NULL);
+    if (tool->EyeFrame)
     {
-      continue;
+      // Get the eye_frame (current camera frame w.r.t to world coordinates)
+      // It doesn't matter what the manipulator index is, the EYE FRAME will be the same for
+      // all manipulators.
+      if (isi_get_reference_frame(ISI_PSM2, ISI_EYE_FRAME, &eyeFrame) == ISI_SUCCESS)
+      {
+        transform = &eyeFrame;
+      }
     }
-
-    bool inverseTransform(false);
-    if (toolName.find("_TIP") != std::string::npos)
+    else
     {
       // Get the tip transform for this manipulator
-      isi_get_stream_field(manipIndex, ISI_TIP_TRANSFORM, &stream_data);
+      isi_get_stream_field(tool->ManipIndex, ISI_TIP_TRANSFORM, &stream_data);
       transform = (ISI_TRANSFORM*) stream_data.data;
     }
-    else if (toolName.find("_EYE_FRAME") != std::string::npos)
-    {
-      // Get the eye_frame (current camera frame w.r.t to world coordinates)
-      // It doesn't matter what the manipulator index is, the EYE FRAME will be the same fo
-      // all manipulators.
-      isi_get_reference_frame(ISI_PSM2, ISI_EYE_FRAME, transform);
-      inverseTransform = true;  // This transform is the camera to world coordinates. We want our reference to be the inverse.
-    }
 
     // If we really don't have data, keep on keeping on.
     if (transform == NULL)
@@ -322,21 +326,28 @@ void vtkPlusIntuitiveDaVinciTracker::StreamCallback(void)
       continue;
     }
 
-    setVtkMatrixFromISITransform(*transformMatrix, transform);
+    setVtkMatrixFromISITransform(*tool->Matrix, transform);
 
-    if (inverseTransform)
+    if (tool->EyeFrame)
     {
-      vtkMatrix4x4::Invert(transformMatrix, transformMatrix);
+      // This transform is the camera to world coordinates. We want our reference to be the inverse.
+      vtkMatrix4x4::Invert(tool->Matrix, tool->Matrix);
     }
 
-    std::ostringstream transformStream;
-    transformMatrix->Print(transformStream);
-    LOG_TRACE("Updating toolname: " << toolName << " with transform:\n\t" << transformStream << "\n");
+    const igsioFieldMapType* customFields = NULL;
+    if (this->JointValuesFieldData && !tool->EyeFrame)
+    {
+      isi_get_stream_field(tool->ManipIndex, ISI_JOINT_VALUES, &stream_data);
+      this->UpdateJointValuesField(*tool, stream_data);
+      customFields = &tool->JointValuesFields;
+    }
+
+    LOG_TRACE("Updating tool: " << tool->SourceId << " with transform:\n\t" << *tool->Matrix << "\n");
 
 #ifdef USE_DAVINCI_TIMESTAMPS
-    this->ToolTimeStampedUpdateWithoutFiltering(it->second->GetSourceId(), transformMatrix, TOOL_OK, timeSystemSec, timeSystemSec);
+    this->ToolTimeStampedUpdateWithoutFiltering(tool->SourceId, tool->Matrix, TOOL_OK, timeSystemSec, timeSystemSec, customFields);
 #else
-    this->ToolTimeStampedUpdate(it->second->GetSourceId(), transformMatrix, TOOL_OK, this->FrameNumber, unfilteredTimestamp);
+    this->ToolTimeStampedUpdate(tool->SourceId, tool->Matrix, TOOL_OK, this->FrameNumber, unfilteredTimestamp, customFields);
 #endif
   }
 
@@ -344,11 +355,58 @@ void vtkPlusIntuitiveDaVinciTracker::StreamCallback(void)
 }
 
 //----------------------------------------------------------------------------
-ISI_MANIP_INDEX vtkPlusIntuitiveDaVinciTracker::getManipIndexFromName(const std::string& toolName)
+void vtkPlusIntuitiveDaVinciTracker::BuildManipulatorTools()
+{
+  this->ManipulatorTools.clear();
+  for (DataSourceContainerIterator it = this->Tools.begin(); it != this->Tools.end(); ++it)
+  {
+    const std::string toolName = it->second->GetPortName();
+
+    ManipulatorTool tool;
+    if (toolName.find("_TIP") != std::string::npos)
+    {
+      tool.EyeFrame = false;
+    }
+    else if (toolName.find("_EYE_FRAME") != std::string::npos)
+    {
+      tool.EyeFrame = true;
+    }
+    else
+    {
+      LOG_WARNING("Tool " << it->second->GetId() << " is not updated: port name " << toolName << " is neither a manipulator tip nor the eye frame");
+      continue;
+    }
+    tool.ManipIndex = getManipIndexFromName(toolName);
+    tool.SourceId = it->second->GetSourceId();
+    tool.Matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    tool.JointValuesFieldName = it->second->GetId() + "JointValues";
+    this->ManipulatorTools.push_back(tool);
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusIntuitiveDaVinciTracker::UpdateJointValuesField(ManipulatorTool& tool, const ISI_STREAM_FIELD& jointValues)
+{
+  std::pair<igsioFrameFieldFlags, std::string>& field = tool.JointValuesFields[tool.JointValuesFieldName];
+  field.first = FRAMEFIELD_NONE;
+  field.second.clear();
+  char valueString[32];
+  for (int i = 0; i < jointValues.count; i++)
+  {
+    int length = snprintf(valueString, sizeof(valueString), "%s%.5g", (i > 0 ? " " : ""), jointValues.data[i]);
+    if (length > 0)
+    {
+      field.second.append(valueString, std::min<size_t>(length, sizeof(valueString) - 1));
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+ISI_MANIP_INDEX vtkPlusIntuitiveDaVinciTracker::getManipIndexFromName(const std::string& portName)
 {
   ISI_MANIP_INDEX manipIndex = ISI_PSM1;
 
-  toolName = toolName.substr(0, toolName.size() - 4);
+  const std::string toolName = portName.substr(0, portName.size() - 4);
 
   if (igsioCommon::IsEqualInsensitive("ISI_PSM1", toolName))
   {
@@ -409,30 +467,16 @@ ISI_MANIP_INDEX vtkPlusIntuitiveDaVinciTracker::getManipIndexFromName(const std:
 //----------------------------------------------------------------------------
 void vtkPlusIntuitiveDaVinciTracker::setVtkMatrixFromISITransform(vtkMatrix4x4& destVtkMatrix, ISI_TRANSFORM* srcIsiMatrix)
 {
-  destVtkMatrix->Identity();
-
-  // Let's VERY EXPLCITLY copy over the values.
-  destVtkMatrix.SetElement(0, 0, srcIsiMatrix->rot.row0.x);
-  destVtkMatrix.SetElement(1, 0, srcIsiMatrix->rot.row0.y);
-  destVtkMatrix.SetElement(2, 0, srcIsiMatrix->rot.row0.z);
-  destVtkMatrix.SetElement(3, 0, 0);
-
-  destVtkMatrix.SetElement(0, 1, srcIsiMatrix->rot.row1.x);
-  destVtkMatrix.SetElement(1, 1, srcIsiMatrix->rot.row1.y);
-  destVtkMatrix.SetElement(2, 1, srcIsiMatrix->rot.row1.z);
-  destVtkMatrix.SetElement(3, 1, 0);
-
-  destVtkMatrix.SetElement(0, 2, srcIsiMatrix->rot.row2.x);
-  destVtkMatrix.SetElement(1, 2, srcIsiMatrix->rot.row2.y);
-  destVtkMatrix.SetElement(2, 2, srcIsiMatrix->rot.row2.z);
-  destVtkMatrix.SetElement(3, 2, 0);
-
-  destVtkMatrix.SetElement(0, 3, srcIsiMatrix->pos.x);
-  destVtkMatrix.SetElement(1, 3, srcIsiMatrix->pos.y);
-  destVtkMatrix.SetElement(2, 3, srcIsiMatrix->pos.z);
-  destVtkMatrix.SetElement(3, 3, 1);
-
-  return;
+  // Let's VERY EXPLCITLY copy over the values. The rows of the ISI rotation are the columns of the matrix.
+  // The elements are set at once, so that the matrix is modified only once.
+  const double elements[16] =
+  {
+    srcIsiMatrix->rot.row0.x, srcIsiMatrix->rot.row1.x, srcIsiMatrix->rot.row2.x, srcIsiMatrix->pos.x,
+    srcIsiMatrix->rot.row0.y, srcIsiMatrix->rot.row1.y, srcIsiMatrix->rot.row2.y, srcIsiMatrix->pos.y,
+    srcIsiMatrix->rot.row0.z, srcIsiMatrix->rot.row1.z, srcIsiMatrix->rot.row2.z, srcIsiMatrix->pos.z,
+    0.0, 0.0, 0.0, 1.0
+  };
+  destVtkMatrix.DeepCopy(elements);
 }
 
 namespace vtkPlusIntuitiveDaVinciTrackerUtilities
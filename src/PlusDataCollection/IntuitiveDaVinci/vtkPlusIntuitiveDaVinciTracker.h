@@ -13,6 +13,7 @@ See License.txt for details.
 
 // VTK includes
 #include <vtkObjectFactory.h>
+#include <vtkSmartPointer.h>
 
 // Intuitive includes
 #include "IntuitiveDaVinci.h"
@@ -61,6 +62,11 @@ public:
   vtkSetStdStringMacro(Password);
   vtkGetStdStringMacro(Password);
 
+  /*! If enabled then the joint values of each manipulator are stored in the <ToolId>JointValues field of its tool items */
+  vtkSetMacro(JointValuesFieldData, bool);
+  vtkGetMacro(JointValuesFieldData, bool);
+  vtkBooleanMacro(JointValuesFieldData, bool);
+
 protected:
   vtkPlusIntuitiveDaVinciTracker();
   ~vtkPlusIntuitiveDaVinciTracker();
@@ -94,6 +100,22 @@ protected:
   std::string         IpAddr;
   unsigned int        Port;
   std::string         Password;
+  bool                JointValuesFieldData;
+
+  /*! Tool that is updated from the stream, resolved from the port name at connect so that the stream callback does not parse names */
+  struct ManipulatorTool
+  {
+    std::string SourceId;
+    ISI_MANIP_INDEX ManipIndex;
+    /*! The tool is the inverse of the camera (eye) frame instead of the tip of a manipulator */
+    bool EyeFrame;
+    /*! Reused for each stream callback */
+    vtkSmartPointer<vtkMatrix4x4> Matrix;
+    /*! Joint values field, the string keeps its capacity between callbacks */
+    std::string JointValuesFieldName;
+    igsioFieldMapType JointValuesFields;
+  };
+  std::vector<ManipulatorTool> ManipulatorTools;
 
 private:
   vtkPlusIntuitiveDaVinciTracker(const vtkPlusIntuitiveDaVinciTracker&);
@@ -107,6 +129,12 @@ private:
   ISI_MANIP_INDEX getManipIndexFromName(const std::string& toolName);
   void setVtkMatrixFromISITransform(vtkMatrix4x4& vtkMatrix, ISI_TRANSFORM* isiMatrix);
 
+  /*! Resolve the manipulator and the transform of each tool */
+  void BuildManipulatorTools();
+
+  /*! Write the joint values of a stream field into the joint values field of a tool */
+  void UpdateJointValuesField(ManipulatorTool& tool, const ISI_STREAM_FIELD& jointValues);
+
   static const int CONNECT_RETRY_DELAY_SEC = 1.0;
   static const int MAX_ATTEMPTS = 5;
 };
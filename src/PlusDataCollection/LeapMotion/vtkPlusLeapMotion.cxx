@@ -8,14 +8,14 @@ See License.txt for details.
 #include "PlusConfigure.h"
 #include "vtkPlusLeapMotion.h"
 #include "PlusMath.h"
+#include "vtkIGSIOAccurateTimer.h"
 
 // VTK includes
 #include <vtkImageImport.h>
+#include <vtkMath.h>
 #include <vtkMatrix4x4.h>
 #include <vtkObjectFactory.h>
 #include <vtkPlusDataSource.h>
-#include <vtkQuaternion.h>
-#include <vtkTransform.h>
 #include <vtkXMLDataElement.h>
 #include <vtksys/SystemTools.hxx>
 
@@ -23,6 +23,8 @@ See License.txt for details.
 #include <math.h>
 
 // STL includes
+#include <cmath>
+#include <cstdio>
 #include <sstream>
 
 //-------------------------------------------------------------------------
@@ -47,6 +49,41 @@ namespace
     }
     free(ptr);
   }
+
+  const int NUMBER_OF_FINGERS = 5;
+  const int NUMBER_OF_BONES = 4;
+  const char* const HAND_NAMES[2] = { "Left", "Right" };
+  const char* const FINGER_NAMES[NUMBER_OF_FINGERS] = { "Thumb", "Index", "Middle", "Ring", "Pinky" };
+  const char* const BONE_NAMES[NUMBER_OF_BONES] = { "Metacarpal", "Proximal", "Intermediate", "Distal" };
+
+  //----------------------------------------------------------------------------
+  void SetPoseMatrix(vtkMatrix4x4* matrix, const LEAP_QUATERNION& orientation, const LEAP_VECTOR& position)
+  {
+    const double quaternion[4] = { orientation.w, orientation.x, orientation.y, orientation.z };
+    double rotation[3][3];
+    vtkMath::QuaternionToMatrix3x3(quaternion, rotation);
+    const double translation[3] = { position.x, position.y, position.z };
+    for (int row = 0; row < 3; ++row)
+    {
+      for (int column = 0; column < 3; ++column)
+      {
+        matrix->SetElement(row, column, rotation[row][column]);
+      }
+      matrix->SetElement(row, 3, translation[row]);
+      matrix->SetElement(3, row, 0.0);
+    }
+    matrix->SetElement(3, 3, 1.0);
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Append the position (mm) and the orientation quaternion (w, x, y, z) of a joint, separated by spaces */
+  void AppendPose(std::string& packedJoints, const LEAP_QUATERNION& orientation, const LEAP_VECTOR& position)
+  {
+    char pose[128];
+    snprintf(pose, sizeof(pose), " %.2f %.2f %.2f %.4f %.4f %.4f %.4f", position.x, position.y, position.z,
+             orientation.w, orientation.x, orientation.y, orientation.z);
+    packedJoints += pose;
+  }
 }
 
 //-------------------------------------------------------------------------
@@ -60,6 +97,7 @@ vtkPlusLeapMotion::vtkPlusLeapMotion()
   , LeftCameraSource(nullptr)
   , RightCameraSource(nullptr)
   , InvertImage(false)
+  , JointMatrix(vtkMatrix4x4::New())
 {
   this->RequirePortNameInDeviceSetConfiguration = false;
   this->StartThreadForInternalUpdates = true; // polling based device
@@ -70,6 +108,7 @@ vtkPlusLeapMotion::vtkPlusLeapMotion()
 vtkPlusLeapMotion::~vtkPlusLeapMotion()
 {
   this->Mutex->Delete();
+  this->JointMatrix->Delete();
   if (this->Recording)
   {
     this->StopRecording();
@@ -85,6 +124,7 @@ void vtkPlusLeapMotion::PrintSelf(ostream& os, vtkIndent indent)
   os << "Leap HMD policy" << (this->LeapHMDPolicy ? "TRUE" : "FALSE") << std::endl;
   os << "Override pause/resume policy" << (this->RefusePauseResumePolicy ? "TRUE" : "FALSE") << std::endl;
   os << "Invert image:" << (this->InvertImage ? "TRUE" : "FALSE") << std::endl;
+  os << "Packed joints field name: " << this->PackedJointsFieldName << std::endl;
 }
 
 //----------------------------------------------------------------------------
@@ -95,6 +135,7 @@ PlusStatus vtkPlusLeapMotion::ReadConfiguration(vtkXMLDataElement* rootConfigEle
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(LeapHMDPolicy, deviceConfig);
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(RefusePauseResumePolicy, deviceConfig);
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(InvertImage, deviceConfig);
+  XML_READ_STRING_ATTRIBUTE_OPTIONAL(PackedJointsFieldName, deviceConfig);
 
   return PLUS_SUCCESS;
 }
@@ -107,6 +148,7 @@ PlusStatus vtkPlusLeapMotion::WriteConfiguration(vtkXMLDataElement* rootConfigEl
   XML_WRITE_BOOL_ATTRIBUTE(LeapHMDPolicy, deviceConfig);
   XML_WRITE_BOOL_ATTRIBUTE(RefusePauseResumePolicy, deviceConfig);
   XML_WRITE_BOOL_ATTRIBUTE(InvertImage, deviceConfig);
+  XML_WRITE_STRING_ATTRIBUTE_IF_NOT_EMPTY(PackedJointsFieldName, deviceConfig);
 
   return PLUS_SUCCESS;
 }
@@ -275,63 +317,53 @@ PlusStatus vtkPlusLeapMotion::InternalStopRecording()
   return PLUS_SUCCESS;
 }
 
-#define CHECK_DATA_SOURCE(name) if(this->GetDataSource(std::string(#name) + "To" + this->ToolReferenceFrameName, aSource) != PLUS_SUCCESS){ LOG_WARNING("Data source with ID \"" << #name << "\" doesn't exist. Joint will not be tracked.");}
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusLeapMotion::NotifyConfigured()
 {
-  vtkPlusDataSource* aSource(nullptr);
-
-  // Check for 19 data sources per hand
-  CHECK_DATA_SOURCE(LeftThumbProximal);
-  CHECK_DATA_SOURCE(LeftThumbIntermediate);
-  CHECK_DATA_SOURCE(LeftThumbDistal);
-
-  CHECK_DATA_SOURCE(LeftIndexMetacarpal);
-  CHECK_DATA_SOURCE(LeftIndexProximal);
-  CHECK_DATA_SOURCE(LeftIndexIntermediate);
-  CHECK_DATA_SOURCE(LeftIndexDistal);
-
-  CHECK_DATA_SOURCE(LeftMiddleMetacarpal);
-  CHECK_DATA_SOURCE(LeftMiddleProximal);
-  CHECK_DATA_SOURCE(LeftMiddleIntermediate);
-  CHECK_DATA_SOURCE(LeftMiddleDistal);
-
-  CHECK_DATA_SOURCE(LeftRingMetacarpal);
-  CHECK_DATA_SOURCE(LeftRingProximal);
-  CHECK_DATA_SOURCE(LeftRingIntermediate);
-  CHECK_DATA_SOURCE(LeftRingDistal);
-
-  CHECK_DATA_SOURCE(LeftPinkyMetacarpal);
-  CHECK_DATA_SOURCE(LeftPinkyProximal);
-  CHECK_DATA_SOURCE(LeftPinkyIntermediate);
-  CHECK_DATA_SOURCE(LeftPinkyDistal);
-
-  CHECK_DATA_SOURCE(RightThumbProximal);
-  CHECK_DATA_SOURCE(RightThumbIntermediate);
-  CHECK_DATA_SOURCE(RightThumbDistal);
-
-  CHECK_DATA_SOURCE(RightIndexMetacarpal);
-  CHECK_DATA_SOURCE(RightIndexProximal);
-  CHECK_DATA_SOURCE(RightIndexIntermediate);
-  CHECK_DATA_SOURCE(RightIndexDistal);
-
-  CHECK_DATA_SOURCE(RightMiddleMetacarpal);
-  CHECK_DATA_SOURCE(RightMiddleProximal);
-  CHECK_DATA_SOURCE(RightMiddleIntermediate);
-  CHECK_DATA_SOURCE(RightMiddleDistal);
-
-  CHECK_DATA_SOURCE(RightRingMetacarpal);
-  CHECK_DATA_SOURCE(RightRingProximal);
-  CHECK_DATA_SOURCE(RightRingIntermediate);
-  CHECK_DATA_SOURCE(RightRingDistal);
-
-  CHECK_DATA_SOURCE(RightPinkyMetacarpal);
-  CHECK_DATA_SOURCE(RightPinkyProximal);
-  CHECK_DATA_SOURCE(RightPinkyIntermediate);
-  CHECK_DATA_SOURCE(RightPinkyDistal);
+  // Resolve the data sources of the 19 bones and the palm of each hand once, so that no names are built for each frame
+  this->JointTools.clear();
+  const eLeapHandType handTypes[2] = { eLeapHandType_Left, eLeapHandType_Right };
+  for (int handIndex = 0; handIndex < 2; ++handIndex)
+  {
+    for (int fingerIndex = -1; fingerIndex < NUMBER_OF_FINGERS; ++fingerIndex)
+    {
+      for (int boneIndex = 0; boneIndex < NUMBER_OF_BONES; ++boneIndex)
+      {
+        if ((fingerIndex < 0 && boneIndex > 0) || (fingerIndex == Finger_Thumb && boneIndex == Bone_Metacarpal))
+        {
+          // The palm has a single pose, the thumb has no metacarpal bone
+          continue;
+        }
+        JointTool joint;
+        joint.Hand = handTypes[handIndex];
+        joint.FingerIndex = fingerIndex;
+        joint.BoneIndex = (fingerIndex < 0 ? -1 : boneIndex);
+        std::string jointName = std::string(HAND_NAMES[handIndex]) + (fingerIndex < 0 ? "Palm" : std::string(FINGER_NAMES[fingerIndex]) + BONE_NAMES[boneIndex]);
+        joint.SourceId = jointName + "To" + this->ToolReferenceFrameName;
+        vtkPlusDataSource* aSource(nullptr);
+        if (this->GetDataSource(joint.SourceId, aSource) != PLUS_SUCCESS)
+        {
+          LOG_WARNING("Data source with ID \"" << jointName << "\" doesn't exist. Joint will not be tracked.");
+          continue;
+        }
+        if (fingerIndex >= 0)
+        {
+          joint.LengthFieldName = joint.SourceId + "lengthMm";
+          joint.RadiusFieldName = joint.SourceId + "radiusMm";
+          joint.Fields[joint.LengthFieldName].first = FRAMEFIELD_FORCE_SERVER_SEND;
+          joint.Fields[joint.RadiusFieldName].first = FRAMEFIELD_FORCE_SERVER_SEND;
+        }
+        this->JointTools.push_back(joint);
+      }
+    }
+  }
 
-  CHECK_DATA_SOURCE(LeftPalm);
-  CHECK_DATA_SOURCE(RightPalm);
+  this->PackedJointsFields.clear();
+  if (!this->PackedJointsFieldName.empty() && !this->JointTools.empty())
+  {
+    this->PackedJointsFields[this->PackedJointsFieldName].first = FRAMEFIELD_FORCE_SERVER_SEND;
+    this->JointTools[0].Fields[this->PackedJointsFieldName].first = FRAMEFIELD_FORCE_SERVER_SEND;
+  }
 
   if (this->GetNumberOfTools() < 1)
   {
@@ -364,111 +396,77 @@ PlusStatus vtkPlusLeapMotion::NotifyConfigured()
   this->PollTimeoutMs = 1000.0 / this->AcquisitionRate;
   return PLUS_SUCCESS;
 }
-#undef CHECK_DATA_SOURCE
 
 //----------------------------------------------------------------------------
-PlusStatus vtkPlusLeapMotion::ToolTimeStampedUpdateBone(std::string boneName, eLeapHandType handIndex, Finger fingerIndex, Bone boneIndex)
+PlusStatus vtkPlusLeapMotion::UpdateJointTool(JointTool& joint, const LEAP_HAND* hand, double unfilteredTimestamp)
 {
-  vtkPlusDataSource* aSource(nullptr);
-  if (this->GetDataSource(boneName + "To" + this->ToolReferenceFrameName, aSource) == PLUS_SUCCESS)
+  const bool carriesPackedJoints = !this->PackedJointsFields.empty() && &joint == &this->JointTools[0];
+  if (hand == nullptr)
   {
-    vtkNew<vtkTransform> pose;
-    bool found(false);
-    for (uint32_t i = 0; i < this->LastTrackingEvent.nHands; ++i)
-    {
-      LEAP_HAND& hand = this->LastTrackingEvent.pHands[i];
-      if (hand.type != handIndex)
-      {
-        continue;
-      }
-      LEAP_BONE& bone = hand.digits[fingerIndex].bones[boneIndex];
-
-      vtkQuaternion<float> orientation;
-      orientation.Set(bone.rotation.w, bone.rotation.x, bone.rotation.y, bone.rotation.z);
-      float axis[3];
-      float angle = orientation.GetRotationAngleAndAxis(axis);
-      pose->Translate(bone.next_joint.x, bone.next_joint.y, bone.next_joint.z);
-      pose->RotateWXYZ(vtkMath::DegreesFromRadians(angle), axis);
-      float x = bone.next_joint.x - bone.prev_joint.x;
-      float y = bone.next_joint.y - bone.prev_joint.y;
-      float z = bone.next_joint.z - bone.prev_joint.z;
-      float mag = std::sqrtf(x * x + y * y + z * z);
-      igsioFieldMapType fields;
-      {
-        std::stringstream ss;
-        ss << mag;
-        fields[boneName + "To" + this->ToolReferenceFrameName + "lengthMm"].first = FRAMEFIELD_FORCE_SERVER_SEND;
-        fields[boneName + "To" + this->ToolReferenceFrameName + "lengthMm"].second = ss.str();
-      }
-
-      {
-        std::stringstream ss;
-        ss << bone.width;
-        fields[boneName + "To" + this->ToolReferenceFrameName + "radiusMm"].first = FRAMEFIELD_FORCE_SERVER_SEND;
-        fields[boneName + "To" + this->ToolReferenceFrameName + "radiusMm"].second = ss.str();
-      }
-
-      if (this->ToolTimeStampedUpdate(boneName + "To" + this->ToolReferenceFrameName, pose->GetMatrix(), TOOL_OK, this->FrameNumber, UNDEFINED_TIMESTAMP, &fields) != PLUS_SUCCESS)
-      {
-        LOG_ERROR("Unable to record " << boneName << " transform.");
-        return PLUS_FAIL;
-      }
-
-      return PLUS_SUCCESS;
-    }
-
-    if (!found)
-    {
-      vtkNew<vtkMatrix4x4> mat;
-      this->ToolTimeStampedUpdate(boneName + "To" + this->ToolReferenceFrameName, mat, TOOL_OUT_OF_VIEW, this->FrameNumber, UNDEFINED_TIMESTAMP);
-    }
+    this->JointMatrix->Identity();
+    return this->ToolTimeStampedUpdate(joint.SourceId, this->JointMatrix, TOOL_OUT_OF_VIEW, this->FrameNumber, unfilteredTimestamp,
+                                       carriesPackedJoints ? &this->PackedJointsFields : nullptr);
+  }
 
-    return PLUS_SUCCESS;
+  if (joint.FingerIndex < 0)
+  {
+    SetPoseMatrix(this->JointMatrix, hand->palm.orientation, hand->palm.position);
+  }
+  else
+  {
+    const LEAP_BONE& bone = hand->digits[joint.FingerIndex].bones[joint.BoneIndex];
+    SetPoseMatrix(this->JointMatrix, bone.rotation, bone.next_joint);
+
+    float x = bone.next_joint.x - bone.prev_joint.x;
+    float y = bone.next_joint.y - bone.prev_joint.y;
+    float z = bone.next_joint.z - bone.prev_joint.z;
+    char value[32];
+    snprintf(value, sizeof(value), "%g", std::sqrt(x * x + y * y + z * z));
+    joint.Fields[joint.LengthFieldName].second = value;
+    snprintf(value, sizeof(value), "%g", bone.width);
+    joint.Fields[joint.RadiusFieldName].second = value;
+  }
+  if (carriesPackedJoints)
+  {
+    joint.Fields[this->PackedJointsFieldName].second = this->PackedJointsFields[this->PackedJointsFieldName].second;
   }
 
-  return PLUS_FAIL;
+  if (this->ToolTimeStampedUpdate(joint.SourceId, this->JointMatrix, TOOL_OK, this->FrameNumber, unfilteredTimestamp, joint.Fields.empty() ? nullptr : &joint.Fields) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to record " << joint.SourceId << " transform.");
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
 }
 
 //----------------------------------------------------------------------------
-PlusStatus vtkPlusLeapMotion::ToolTimeStampedUpdatePalm(const std::string& name, eLeapHandType handType)
+void vtkPlusLeapMotion::UpdatePackedJoints(const LEAP_HAND* leftHand, const LEAP_HAND* rightHand)
 {
-  vtkPlusDataSource* aSource(nullptr);
-  if (this->GetDataSource(name + "To" + this->ToolReferenceFrameName, aSource) == PLUS_SUCCESS)
+  std::string& packedJoints = this->PackedJointsFields[this->PackedJointsFieldName].second;
+  packedJoints.clear();
+  const LEAP_HAND* hands[2] = { leftHand, rightHand };
+  for (int handIndex = 0; handIndex < 2; ++handIndex)
   {
-    vtkNew<vtkTransform> pose;
-    bool found(false);
-    for (uint32_t i = 0; i < this->LastTrackingEvent.nHands; ++i)
+    const LEAP_HAND* hand = hands[handIndex];
+    if (hand == nullptr)
     {
-      LEAP_HAND& hand = this->LastTrackingEvent.pHands[i];
-      if (hand.type != handType)
-      {
-        continue;
-      }
-      LEAP_PALM& palm = hand.palm;
-      vtkQuaternion<float> orientation;
-      orientation.Set(palm.orientation.w, palm.orientation.x, palm.orientation.y, palm.orientation.z);
-      pose->Translate(palm.position.x, palm.position.y, palm.position.z);
-      float axis[3];
-      float angle = orientation.GetRotationAngleAndAxis(axis);
-      pose->RotateWXYZ(angle, axis);
-      if (this->ToolTimeStampedUpdate(name + "To" + this->ToolReferenceFrameName, pose->GetMatrix(), TOOL_OK, this->FrameNumber, UNDEFINED_TIMESTAMP) != PLUS_SUCCESS)
-      {
-        LOG_ERROR("Unable to record " << name << " transform.");
-        return PLUS_FAIL;
-      }
-
-      return PLUS_SUCCESS;
+      continue;
     }
-    if (!found)
+    if (!packedJoints.empty())
     {
-      vtkNew<vtkMatrix4x4> mat;
-      this->ToolTimeStampedUpdate(name + "To" + this->ToolReferenceFrameName, mat, TOOL_OUT_OF_VIEW, this->FrameNumber, UNDEFINED_TIMESTAMP);
+      packedJoints += ";";
+    }
+    packedJoints += HAND_NAMES[handIndex];
+    AppendPose(packedJoints, hand->palm.orientation, hand->palm.position);
+    for (int fingerIndex = 0; fingerIndex < NUMBER_OF_FINGERS; ++fingerIndex)
+    {
+      for (int boneIndex = 0; boneIndex < NUMBER_OF_BONES; ++boneIndex)
+      {
+        const LEAP_BONE& bone = hand->digits[fingerIndex].bones[boneIndex];
+        AppendPose(packedJoints, bone.rotation, bone.next_joint);
+      }
     }
-
-    return PLUS_SUCCESS;
   }
-
-  return PLUS_FAIL;
 }
 
 //----------------------------------------------------------------------------
@@ -549,64 +547,44 @@ PlusStatus vtkPlusLeapMotion::OnPolicyEvent(const LEAP_POLICY_EVENT* policyEvent
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusLeapMotion::OnTrackingEvent(const LEAP_TRACKING_EVENT* trackingEvent)
 {
-  this->SetFrame(trackingEvent);
-
-  // Left
-  ToolTimeStampedUpdateBone("LeftThumbProximal", eLeapHandType_Left, Finger_Thumb, Bone_Proximal);
-  ToolTimeStampedUpdateBone("LeftThumbIntermediate", eLeapHandType_Left, Finger_Thumb, Bone_Intermediate);
-  ToolTimeStampedUpdateBone("LeftThumbDistal", eLeapHandType_Left, Finger_Thumb, Bone_Distal);
-
-  ToolTimeStampedUpdateBone("LeftIndexMetacarpal", eLeapHandType_Left, Finger_Index, Bone_Metacarpal);
-  ToolTimeStampedUpdateBone("LeftIndexProximal", eLeapHandType_Left, Finger_Index, Bone_Proximal);
-  ToolTimeStampedUpdateBone("LeftIndexIntermediate", eLeapHandType_Left, Finger_Index, Bone_Intermediate);
-  ToolTimeStampedUpdateBone("LeftIndexDistal", eLeapHandType_Left, Finger_Index, Bone_Distal);
-
-  ToolTimeStampedUpdateBone("LeftMiddleMetacarpal", eLeapHandType_Left, Finger_Middle, Bone_Metacarpal);
-  ToolTimeStampedUpdateBone("LeftMiddleProximal", eLeapHandType_Left, Finger_Middle, Bone_Proximal);
-  ToolTimeStampedUpdateBone("LeftMiddleIntermediate", eLeapHandType_Left, Finger_Middle, Bone_Intermediate);
-  ToolTimeStampedUpdateBone("LeftMiddleDistal", eLeapHandType_Left, Finger_Middle, Bone_Distal);
-
-  ToolTimeStampedUpdateBone("LeftRingMetacarpal", eLeapHandType_Left, Finger_Ring, Bone_Metacarpal);
-  ToolTimeStampedUpdateBone("LeftRingProximal", eLeapHandType_Left, Finger_Ring, Bone_Proximal);
-  ToolTimeStampedUpdateBone("LeftRingIntermediate", eLeapHandType_Left, Finger_Ring, Bone_Intermediate);
-  ToolTimeStampedUpdateBone("LeftRingDistal", eLeapHandType_Left, Finger_Ring, Bone_Distal);
-
-  ToolTimeStampedUpdateBone("LeftPinkyMetacarpal", eLeapHandType_Left, Finger_Pinky, Bone_Metacarpal);
-  ToolTimeStampedUpdateBone("LeftPinkyProximal", eLeapHandType_Left, Finger_Pinky, Bone_Proximal);
-  ToolTimeStampedUpdateBone("LeftPinkyIntermediate", eLeapHandType_Left, Finger_Pinky, Bone_Intermediate);
-  ToolTimeStampedUpdateBone("LeftPinkyDistal", eLeapHandType_Left, Finger_Pinky, Bone_Distal);
-
-  // Right
-  ToolTimeStampedUpdateBone("RightThumbProximal", eLeapHandType_Right, Finger_Thumb, Bone_Proximal);
-  ToolTimeStampedUpdateBone("RightThumbIntermediate", eLeapHandType_Right, Finger_Thumb, Bone_Intermediate);
-  ToolTimeStampedUpdateBone("RightThumbDistal", eLeapHandType_Right, Finger_Thumb, Bone_Distal);
-
-  ToolTimeStampedUpdateBone("RightIndexMetacarpal", eLeapHandType_Right, Finger_Index, Bone_Metacarpal);
-  ToolTimeStampedUpdateBone("RightIndexProximal", eLeapHandType_Right, Finger_Index, Bone_Proximal);
-  ToolTimeStampedUpdateBone("RightIndexIntermediate", eLeapHandType_Right, Finger_Index, Bone_Intermediate);
-  ToolTimeStampedUpdateBone("RightIndexDistal", eLeapHandType_Right, Finger_Index, Bone_Distal);
-
-  ToolTimeStampedUpdateBone("RightMiddleMetacarpal", eLeapHandType_Right, Finger_Middle, Bone_Metacarpal);
-  ToolTimeStampedUpdateBone("RightMiddleProximal", eLeapHandType_Right, Finger_Middle, Bone_Proximal);
-  ToolTimeStampedUpdateBone("RightMiddleIntermediate", eLeapHandType_Right, Finger_Middle, Bone_Intermediate);
-  ToolTimeStampedUpdateBone("RightMiddleDistal", eLeapHandType_Right, Finger_Middle, Bone_Distal);
-
-  ToolTimeStampedUpdateBone("RightRingMetacarpal", eLeapHandType_Right, Finger_Ring, Bone_Metacarpal);
-  ToolTimeStampedUpdateBone("RightRingProximal", eLeapHandType_Right, Finger_Ring, Bone_Proximal);
-  ToolTimeStampedUpdateBone("RightRingIntermediate", eLeapHandType_Right, Finger_Ring, Bone_Intermediate);
-  ToolTimeStampedUpdateBone("RightRingDistal", eLeapHandType_Right, Finger_Ring, Bone_Distal);
-
-  ToolTimeStampedUpdateBone("RightPinkyMetacarpal", eLeapHandType_Right, Finger_Pinky, Bone_Metacarpal);
-  ToolTimeStampedUpdateBone("RightPinkyProximal", eLeapHandType_Right, Finger_Pinky, Bone_Proximal);
-  ToolTimeStampedUpdateBone("RightPinkyIntermediate", eLeapHandType_Right, Finger_Pinky, Bone_Intermediate);
-  ToolTimeStampedUpdateBone("RightPinkyDistal", eLeapHandType_Right, Finger_Pinky, Bone_Distal);
-
-  ToolTimeStampedUpdatePalm("LeftPalm", eLeapHandType_Left);
-  ToolTimeStampedUpdatePalm("RightPalm", eLeapHandType_Right);
+  // All joints of the frame are recorded in one pass with the same timestamp
+  const double unfilteredTimestamp = vtkIGSIOAccurateTimer::GetSystemTime();
+  this->Mutex->Lock();
+  this->LastTrackingEvent = *trackingEvent;
+
+  const LEAP_HAND* leftHand(nullptr);
+  const LEAP_HAND* rightHand(nullptr);
+  for (uint32_t i = 0; i < this->LastTrackingEvent.nHands; ++i)
+  {
+    const LEAP_HAND& hand = this->LastTrackingEvent.pHands[i];
+    if (hand.type == eLeapHandType_Left)
+    {
+      leftHand = &hand;
+    }
+    else if (hand.type == eLeapHandType_Right)
+    {
+      rightHand = &hand;
+    }
+  }
+
+  if (!this->PackedJointsFields.empty())
+  {
+    this->UpdatePackedJoints(leftHand, rightHand);
+  }
+
+  PlusStatus status(PLUS_SUCCESS);
+  for (std::vector<JointTool>::iterator joint = this->JointTools.begin(); joint != this->JointTools.end(); ++joint)
+  {
+    if (this->UpdateJointTool(*joint, joint->Hand == eLeapHandType_Left ? leftHand : rightHand, unfilteredTimestamp) != PLUS_SUCCESS)
+    {
+      status = PLUS_FAIL;
+    }
+  }
+  this->Mutex->Unlock();
 
   this->FrameNumber++;
 
-  return PLUS_SUCCESS;
+  return status;
 }
 
 //----------------------------------------------------------------------------
@@ -22,6 +22,7 @@ See License.txt for details.
 
 class vtkPlusDataSource;
 class vtkIGSIORecursiveCriticalSection;
+class vtkMatrix4x4;
 
 class vtkPlusDataCollectionExport vtkPlusLeapMotion : public vtkPlusDevice
 {
@@ -53,6 +54,9 @@ public:
   vtkSetMacro(InvertImage, bool);
   vtkBooleanMacro(InvertImage, bool);
 
+  vtkGetStdStringMacro(PackedJointsFieldName);
+  vtkSetStdStringMacro(PackedJointsFieldName);
+
 protected:
   vtkPlusLeapMotion();
   ~vtkPlusLeapMotion();
@@ -79,8 +83,26 @@ protected:
     Bone_Intermediate,
     Bone_Distal         // Furthest from heart (aka, finger tip)
   };
-  PlusStatus ToolTimeStampedUpdateBone(std::string boneName, eLeapHandType handIndex, Finger fingerIndex, Bone boneIndex);
-  PlusStatus ToolTimeStampedUpdatePalm(const std::string& name, eLeapHandType hand);
+
+  /*! Data source of a joint (a bone or a palm), resolved when the device is configured */
+  struct JointTool
+  {
+    std::string SourceId;
+    eLeapHandType Hand;
+    /*! Finger and bone of the joint, -1 for the palm */
+    int FingerIndex;
+    int BoneIndex;
+    std::string LengthFieldName;
+    std::string RadiusFieldName;
+    /*! Reused for each frame, so that the field names are only allocated once */
+    igsioFieldMapType Fields;
+  };
+
+  /*! Add the pose of a joint of the current frame. hand is NULL if the hand of the joint is not seen. */
+  PlusStatus UpdateJointTool(JointTool& joint, const LEAP_HAND* hand, double unfilteredTimestamp);
+
+  /*! Write the palm and bone poses of all hands seen in the current frame into the packed joints field */
+  void UpdatePackedJoints(const LEAP_HAND* leftHand, const LEAP_HAND* rightHand);
 
   void SetFrame(const LEAP_TRACKING_EVENT* trackingEvent);
   LEAP_TRACKING_EVENT* GetFrame();
@@ -115,6 +137,11 @@ protected:
   bool                              ImageInitialized;
   bool                              InvertImage;
 
+  /*! If not empty, the poses of all joints of each frame are stored in a single field with this name */
+  std::string                       PackedJointsFieldName;
+  /*! Holds the packed joints field, it is added to the first joint tool */
+  igsioFieldMapType                 PackedJointsFields;
+
   LEAP_CONNECTION                   Connection;
   unsigned int                      PollTimeoutMs;
   LEAP_CONNECTION_MESSAGE           LastMessage;
@@ -126,6 +153,10 @@ protected:
 
   vtkIGSIORecursiveCriticalSection* Mutex;
 
+  /*! Joints that have a data source, in the order they are updated */
+  std::vector<JointTool>            JointTools;
+  vtkMatrix4x4*                     JointMatrix;
+
 private:
   vtkPlusLeapMotion(const vtkPlusLeapMotion&);
   void operator=(const vtkPlusLeapMotion&);
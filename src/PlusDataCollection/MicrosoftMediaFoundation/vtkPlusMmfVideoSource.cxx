@@ -15,6 +15,7 @@ Authors include: Adam Rankin
 // Local includes
 #include "PlusConfigure.h"
 #include "PixelCodec.h"
+#include "PlusTelemetry.h"
 #include "vtkPlusChannel.h"
 #include "vtkPlusDataSource.h"
 #include "vtkPlusMmfVideoSource.h"
@@ -646,13 +647,29 @@ PlusStatus vtkPlusMmfVideoSource::AddFrame(unsigned char* bufferData, DWORD buff
     return PLUS_FAIL;
   }
 
-  if (videoSource->GetImageType() == US_IMG_RGB_COLOR)
+  if (encoding == PixelCodec::PixelEncoding_MJPG)
   {
-    decodingStatus = PixelCodec::ConvertToBmp24(PixelCodec::ComponentOrder_RGB, encoding, frameSize[0], frameSize[1], bufferData, (unsigned char*)this->UncompressedVideoFrame.GetScalarPointer());
+    unsigned char* decodedPixels = (unsigned char*)this->UncompressedVideoFrame.GetScalarPointer();
+    if (videoSource->GetImageType() == US_IMG_RGB_COLOR)
+    {
+      decodingStatus = this->MjpegDecoder.DecodeToBmp24(PixelCodec::ComponentOrder_RGB, frameSize[0], frameSize[1], bufferData, bufferSize, decodedPixels, this->PixelConversionThreads);
+    }
+    else
+    {
+      decodingStatus = this->MjpegDecoder.DecodeToGray(frameSize[0], frameSize[1], bufferData, bufferSize, decodedPixels, this->PixelConversionThreads);
+    }
+    if (decodingStatus == PLUS_SUCCESS)
+    {
+      PlusTelemetry::Instance()->AddSample(PlusTelemetry::STAGE_DECODING, this->MjpegDecoder.GetLastDecodingTimeSec());
+    }
+  }
+  else if (videoSource->GetImageType() == US_IMG_RGB_COLOR)
+  {
+    decodingStatus = PixelCodec::ConvertToBmp24(PixelCodec::ComponentOrder_RGB, encoding, frameSize[0], frameSize[1], bufferData, (unsigned char*)this->UncompressedVideoFrame.GetScalarPointer(), this->PixelConversionThreads);
   }
   else
   {
-    decodingStatus = PixelCodec::ConvertToGray(encoding, frameSize[0], frameSize[1], bufferData, (unsigned char*)this->UncompressedVideoFrame.GetScalarPointer());
+    decodingStatus = PixelCodec::ConvertToGray(encoding, frameSize[0], frameSize[1], bufferData, (unsigned char*)this->UncompressedVideoFrame.GetScalarPointer(), this->PixelConversionThreads);
   }
 
   if (decodingStatus != PLUS_SUCCESS)
@@ -690,6 +707,13 @@ PlusStatus vtkPlusMmfVideoSource::AddFrame(unsigned char* bufferData, DWORD buff
       return PLUS_SUCCESS;
     }
   }
+  if (encoding == PixelCodec::PixelEncoding_MJPG && this->KeepSourceBitstream)
+  {
+    std::shared_ptr<StreamBufferItem::SourceBitstreamData> sourceBitstream = std::make_shared<StreamBufferItem::SourceBitstreamData>();
+    sourceBitstream->CodecFourCC = "MJPG";
+    sourceBitstream->Data.assign(bufferData, bufferData + bufferSize);
+    aSource->SetNextItemSourceBitstream(sourceBitstream);
+  }
   PlusStatus status = aSource->AddItem(&this->UncompressedVideoFrame, this->FrameIndex, currentTime);
 
   this->Modified();
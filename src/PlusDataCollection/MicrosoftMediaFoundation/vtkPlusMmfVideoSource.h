@@ -20,6 +20,7 @@ Authors include: Danielle Pace
 #include "vtkPlusDataCollectionExport.h"
 #include "vtkPlusDevice.h"
 #include "vtkIGSIORecursiveCriticalSection.h"
+#include "PlusMjpegDecoder.h"
 
 // VTK includes
 #include <vtkSmartPointer.h>
@@ -32,6 +33,8 @@ class MmfVideoSourceReader;
 
   Media foundation require Microsoft Windows SDK 7.1 or later. Download <a href="http://www.microsoft.com/en-us/download/details.aspx?id=8279">here</a>
 
+  MJPG frames are decoded by PlusMjpegDecoder, the decoding time is reported in the Decoding stage of PlusTelemetry.
+
   \sa vtkPlusDevice
   \ingroup PlusLibDataCollection
 */
@@ -100,6 +103,7 @@ protected:
 
   vtkSmartPointer<vtkIGSIORecursiveCriticalSection> Mutex;
   igsioVideoFrame UncompressedVideoFrame;
+  PlusMjpegDecoder MjpegDecoder;
   VideoFormat RequestedVideoFormat;
   VideoFormat ActiveVideoFormat;
 
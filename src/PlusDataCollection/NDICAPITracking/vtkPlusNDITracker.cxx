@@ -65,6 +65,9 @@ POSSIBILITY OF SUCH DAMAGES.
 #include <math.h>
 #include <stdarg.h>
 
+// STL includes
+#include <chrono>
+
 #if defined(HAVE_FUTURE)
   #include <future>
 #endif
@@ -91,6 +94,8 @@ vtkPlusNDITracker::vtkPlusNDITracker()
   , MeasurementVolumeNumber(0)
   , NetworkHostname("")
   , NetworkPort(8765)
+  , AsynchronousPolling(false)
+  , ReceiverThreadRunning(false)
   , CommandMutex(vtkIGSIORecursiveCriticalSection::New())
 {
   memset(this->CommandReply, 0, VTK_NDI_REPLY_LEN);
@@ -135,6 +140,7 @@ void vtkPlusNDITracker::PrintSelf(ostream& os, vtkIndent indent)
   os << indent << "LastFrameNumber: " << this->LastFrameNumber << std::endl;
   os << indent << "LeaveDeviceOpenAfterProbe: " << this->LeaveDeviceOpenAfterProbe << std::endl;
   os << indent << "CheckDSR: " << this->CheckDSR << std::endl;
+  os << indent << "AsynchronousPolling: " << this->AsynchronousPolling << std::endl;
   for (auto iter = this->NdiToolDescriptors.begin(); iter != this->NdiToolDescriptors.end(); ++iter)
   {
     os << indent << iter->first << ": " << std::endl;
@@ -453,12 +459,28 @@ PlusStatus vtkPlusNDITracker::InternalStartRecording()
 
   this->IsDeviceTracking = 1;
 
+  if (this->AsynchronousPolling)
+  {
+    for (NdiToolDescriptorsType::iterator toolDescriptorIt = this->NdiToolDescriptors.begin(); toolDescriptorIt != this->NdiToolDescriptors.end(); ++toolDescriptorIt)
+    {
+      toolDescriptorIt->second.LastFrameIndex = 0;
+    }
+    this->ReceiverThreadRunning = true;
+    this->ReceiverThread = std::thread(&vtkPlusNDITracker::ReceiverThreadFn, this);
+  }
+
   return PLUS_SUCCESS;
 }
 
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusNDITracker::InternalStopRecording()
 {
+  if (this->ReceiverThread.joinable())
+  {
+    this->ReceiverThreadRunning = false;
+    this->ReceiverThread.join();
+  }
+
   if (this->Device == 0)
   {
     return PLUS_FAIL;
@@ -478,6 +500,40 @@ PlusStatus vtkPlusNDITracker::InternalStopRecording()
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusNDITracker::InternalUpdate()
 {
+  bool newFrameReceived = false;
+  return this->UpdateTools(false, newFrameReceived);
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusNDITracker::ReceiverThreadFn()
+{
+  this->ApplyThreadScheduling();
+  while (this->ReceiverThreadRunning)
+  {
+    bool newFrameReceived = false;
+    PlusStatus status = PLUS_FAIL;
+    {
+      // Other commands (e.g., SetToolLED) must not be sent between the BX request and the parsing of its reply
+      igsioLockGuard<vtkIGSIORecursiveCriticalSection> lock(this->CommandMutex);
+      status = this->UpdateTools(true, newFrameReceived);
+    }
+    if (status != PLUS_SUCCESS)
+    {
+      // Give time to the device to recover from communication errors
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    else if (!newFrameReceived)
+    {
+      // The tracker has not acquired a new camera frame yet
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusNDITracker::UpdateTools(bool skipRepeatedFrames, bool& newFrameReceived)
+{
+  newFrameReceived = false;
   if (!this->IsDeviceTracking)
   {
     LOG_ERROR("called Update() when NDI was not tracking");
@@ -532,6 +588,12 @@ PlusStatus vtkPlusNDITracker::InternalUpdate()
     int ndiToolAbsent = ndiGetBXTransform(this->Device, portHandle, ndiTransform);
     int ndiPortStatus = ndiGetBXPortStatus(this->Device, portHandle);
     unsigned long ndiFrameIndex = ndiGetBXFrame(this->Device, portHandle);
+    if (skipRepeatedFrames && ndiFrameIndex != 0 && ndiFrameIndex == ndiToolDescriptorIt->second.LastFrameIndex)
+    {
+      // The reply contains the same camera frame as the previous one
+      continue;
+    }
+    ndiToolDescriptorIt->second.LastFrameIndex = ndiFrameIndex;
 
     // convert status flags from NDI to Plus format
     const unsigned long ndiPortStatusValidFlags = NDI_TOOL_IN_PORT | NDI_INITIALIZED | NDI_ENABLED;
@@ -572,6 +634,7 @@ PlusStatus vtkPlusNDITracker::InternalUpdate()
 
     // send the matrix and status to the tool's vtkPlusDataBuffer
     this->ToolTimeStampedUpdate(toolSourceId.c_str(), toolToTrackerTransform, toolFlags, toolFrameNumber, toolTimestamp);
+    newFrameReceived = true;
   }
 
   // Update tool connections if a wired tool is plugged in
@@ -1045,6 +1108,9 @@ PlusStatus vtkPlusNDITracker::ReadConfiguration(vtkXMLDataElement* rootConfigEle
   XML_READ_STRING_ATTRIBUTE_OPTIONAL(NetworkHostname, deviceConfig);
   XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, NetworkPort, deviceConfig);
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(CheckDSR, deviceConfig);
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(AsynchronousPolling, deviceConfig);
+  // The receiver thread polls the tracker, so the internal update thread is not needed
+  this->StartThreadForInternalUpdates = !this->AsynchronousPolling;
 
   XML_FIND_NESTED_ELEMENT_REQUIRED(dataSourcesElement, deviceConfig, "DataSources");
 
@@ -1090,6 +1156,7 @@ PlusStatus vtkPlusNDITracker::ReadConfiguration(vtkXMLDataElement* rootConfigEle
     NdiToolDescriptor toolDescriptor;
     toolDescriptor.PortEnabled = false;
     toolDescriptor.PortHandle = 0;
+    toolDescriptor.LastFrameIndex = 0;
     toolDescriptor.VirtualSROM = NULL;
     toolDescriptor.WiredPortNumber = wiredPortNumber;
 
@@ -1135,6 +1202,7 @@ PlusStatus vtkPlusNDITracker::WriteConfiguration(vtkXMLDataElement* rootConfig)
     trackerConfig->SetIntAttribute("MeasurementVolumeNumber", this->MeasurementVolumeNumber);
   }
   trackerConfig->SetAttribute("CheckDSR", this->CheckDSR ? "true" : "false");
+  XML_WRITE_BOOL_ATTRIBUTE(AsynchronousPolling, trackerConfig);
 
   return PLUS_SUCCESS;
 }
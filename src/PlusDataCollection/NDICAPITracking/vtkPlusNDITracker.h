@@ -46,6 +46,9 @@ POSSIBILITY OF SUCH DAMAGES.
 
 #include "vtkPlusDevice.h"
 
+#include <atomic>
+#include <thread>
+
 class vtkSocketCommunicator;
 struct ndicapi;
 
@@ -97,6 +100,11 @@ struct ndicapi;
   are marked as 'missing' then the number of characters that
   are sent will be reduced.
 
+  If AsynchronousPolling is enabled then a receiver thread sends the BX requests back-to-back
+  and adds each new camera frame to the tool buffers as soon as its reply is parsed, so the update
+  rate is only limited by the round-trip time and not by the AcquisitionRate of the device.
+  Replies that contain the same camera frame as the previous reply are not added to the buffers.
+
   \ingroup PlusLibDataCollection
 */
 class vtkPlusDataCollectionExport vtkPlusNDITracker : public vtkPlusDevice
@@ -107,6 +115,7 @@ class vtkPlusDataCollectionExport vtkPlusNDITracker : public vtkPlusDevice
     unsigned char*  VirtualSROM;      // nonzero for wireless tools
     bool            PortEnabled;      // true if the tool is successfully enabled in the tracker
     int             PortHandle;       // this number identifies the tool in the tracker
+    unsigned long   LastFrameIndex;   // camera frame index of the last reply, used for skipping repeated frames
   };
 
   typedef std::map<std::string, NdiToolDescriptor> NdiToolDescriptorsType;
@@ -191,6 +200,10 @@ public:
   vtkSetMacro(CheckDSR, bool);
   vtkGetMacro(CheckDSR, bool);
 
+  /*! If enabled then the tracker is polled continuously by a receiver thread instead of the internal update thread */
+  vtkSetMacro(AsynchronousPolling, bool);
+  vtkGetMacro(AsynchronousPolling, bool);
+
 protected:
   vtkPlusNDITracker();
   ~vtkPlusNDITracker();
@@ -217,6 +230,16 @@ protected:
   */
   PlusStatus InternalStopRecording();
 
+  /*!
+    Request the transforms of all tools with a BX command and add them to the tool buffers.
+    If skipRepeatedFrames is true then tools that report the same camera frame as in the previous reply are not updated.
+    newFrameReceived is set to true if at least one tool is updated.
+  */
+  PlusStatus UpdateTools(bool skipRepeatedFrames, bool& newFrameReceived);
+
+  /*! Poll the tracker until ReceiverThreadRunning is cleared, used if AsynchronousPolling is enabled */
+  void ReceiverThreadFn();
+
   /*! Cause the device to beep the specified number of times */
   PlusStatus Beep(int n);
 
@@ -299,6 +322,10 @@ protected:
   std::string                       NetworkHostname;
   int                               NetworkPort;
 
+  bool                              AsynchronousPolling;
+  std::thread                       ReceiverThread;
+  std::atomic<bool>                 ReceiverThreadRunning;
+
 private:
   vtkPlusNDITracker(const vtkPlusNDITracker&);
   void operator=(const vtkPlusNDITracker&);
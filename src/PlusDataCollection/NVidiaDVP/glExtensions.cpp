@@ -162,6 +162,15 @@ bool loadCopyImageExtension()
   return loadOK;
 }
 
+//---------------------------------------------------------------------------
+bool loadCopyBufferExtension()
+{
+  glCopyBufferSubData = ( PFNGLCOPYBUFFERSUBDATAPROC ) wglGetProcAddress( "glCopyBufferSubData" );
+
+  bool loadOK = ( glCopyBufferSubData != NULL );
+  return loadOK;
+}
+
 //---------------------------------------------------------------------------
 bool loadAffinityExtension()
 {
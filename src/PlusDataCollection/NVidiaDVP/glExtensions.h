@@ -57,6 +57,7 @@ extern bool loadCaptureVideoExtension();
 extern bool loadShaderObjectsExtension( void );
 extern bool loadCopyImageExtension();
 extern bool loadSyncExtension();
+extern bool loadCopyBufferExtension();
 
 // WGL_NV_Copy_image
 extern PFNWGLCOPYIMAGESUBDATANVPROC                       wglCopyImageSubDataNV;
@@ -110,6 +111,9 @@ extern PFNWGLSWAPINTERVALEXTPROC                          wglSwapIntervalEXT;
 //WGL_ARB_pixel_format
 extern PFNWGLCHOOSEPIXELFORMATARBPROC                     wglChoosePixelFormat;
 
+//GL_ARB_copy_buffer
+extern PFNGLCOPYBUFFERSUBDATAPROC                         glCopyBufferSubData;
+
 // GL_ARB_vertex_buffer_object
 extern PFNGLBINDBUFFERARBPROC                             glBindBuffer;
 extern PFNGLBUFFERDATAARBPROC                             glBufferData;
@@ -21,6 +21,152 @@ See License.txt for details.
 // NV-API device control API
 #include <nvapi.h>
 
+// STL includes
+#include <mutex>
+#include <vector>
+
+//----------------------------------------------------------------------------
+/// GPU buffer objects that the captured frames are copied into. The buffer objects are reused in a round-robin order.
+struct DVPGpuFrameRing
+{
+  DVPGpuFrameRing()
+    : HandleDC(NULL)
+    , CaptureGLRC(NULL)
+    , ReadbackGLRC(NULL)
+    , PitchInBytes(0)
+    , Height(0)
+    , NextSlot(0)
+    , Valid(false)
+  {
+  }
+
+  /// Protects all members, held while a slot is written or read back
+  std::mutex Mutex;
+
+  HDC HandleDC;
+  HGLRC CaptureGLRC;
+
+  /// Context that shares the buffer objects with the capture context, used for reading back frames from any thread
+  HGLRC ReadbackGLRC;
+
+  std::vector<GLuint> BufferObjects;
+
+  /// Incremented each time a slot is overwritten, a frame handle is valid while its generation matches
+  std::vector<uint64_t> Generations;
+
+  /// Signaled when the copy into the slot is completed
+  std::vector<GLsync> Fences;
+
+  unsigned int PitchInBytes;
+  unsigned int Height;
+  unsigned int NextSlot;
+
+  /// Set to false when the GL objects are deleted
+  bool Valid;
+};
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  class DVPGpuFrame : public PlusGpuFrame
+  {
+  public:
+    DVPGpuFrame(const std::shared_ptr<DVPGpuFrameRing>& ring, unsigned int slot, uint64_t generation)
+      : Ring(ring)
+      , Slot(slot)
+      , Generation(generation)
+      , BufferObject(ring->BufferObjects[slot])
+      , Context(ring->CaptureGLRC)
+      , PitchInBytes(ring->PitchInBytes)
+      , Height(ring->Height)
+    {
+    }
+
+    virtual HandleType GetHandleType() const { return HANDLE_OPENGL_BUFFER; }
+    virtual unsigned int GetHandle() const { return this->BufferObject; }
+    virtual void* GetContext() const { return this->Context; }
+    virtual unsigned int GetPitchInBytes() const { return this->PitchInBytes; }
+
+    //----------------------------------------------------------------------------
+    virtual bool IsValid() const
+    {
+      std::lock_guard<std::mutex> lock(this->Ring->Mutex);
+      return this->IsValidNoLock();
+    }
+
+    //----------------------------------------------------------------------------
+    virtual PlusStatus ReadBack(void* destination, unsigned int sizeInBytes)
+    {
+      if (destination == NULL || this->Height == 0)
+      {
+        return PLUS_FAIL;
+      }
+      unsigned int rowSizeInBytes = sizeInBytes / this->Height;
+      if (rowSizeInBytes > this->PitchInBytes)
+      {
+        LOG_ERROR("Unable to read back GPU frame: row size of the frame (" << rowSizeInBytes << " bytes) is larger than the pitch of the GPU buffer (" << this->PitchInBytes << " bytes)");
+        return PLUS_FAIL;
+      }
+
+      std::lock_guard<std::mutex> lock(this->Ring->Mutex);
+      if (!this->IsValidNoLock())
+      {
+        return PLUS_FAIL;
+      }
+
+      // The readback context is used so that the capture thread is not needed, the caller's context is restored afterwards
+      HDC previousDC = wglGetCurrentDC();
+      HGLRC previousGLRC = wglGetCurrentContext();
+      if (!wglMakeCurrent(this->Ring->HandleDC, this->Ring->ReadbackGLRC))
+      {
+        LOG_ERROR("Unable to read back GPU frame: failed to make the readback context current");
+        return PLUS_FAIL;
+      }
+
+      PlusStatus status = PLUS_SUCCESS;
+      if (glClientWaitSync(this->Ring->Fences[this->Slot], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED) == GL_WAIT_FAILED)
+      {
+        LOG_ERROR("Unable to read back GPU frame: waiting for the frame copy failed");
+        status = PLUS_FAIL;
+      }
+      else
+      {
+        glBindBuffer(GL_COPY_READ_BUFFER, this->BufferObject);
+        if (rowSizeInBytes == this->PitchInBytes)
+        {
+          glGetBufferSubData(GL_COPY_READ_BUFFER, 0, rowSizeInBytes * this->Height, destination);
+        }
+        else
+        {
+          unsigned char* destinationRow = static_cast<unsigned char*>(destination);
+          for (unsigned int row = 0; row < this->Height; ++row, destinationRow += rowSizeInBytes)
+          {
+            glGetBufferSubData(GL_COPY_READ_BUFFER, row * this->PitchInBytes, rowSizeInBytes, destinationRow);
+          }
+        }
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+      }
+
+      wglMakeCurrent(previousDC, previousGLRC);
+      return status;
+    }
+
+  protected:
+    bool IsValidNoLock() const
+    {
+      return this->Ring->Valid && this->Ring->Generations[this->Slot] == this->Generation;
+    }
+
+    std::shared_ptr<DVPGpuFrameRing> Ring;
+    unsigned int Slot;
+    uint64_t Generation;
+    GLuint BufferObject;
+    HGLRC Context;
+    unsigned int PitchInBytes;
+    unsigned int Height;
+  };
+}
+
 //----------------------------------------------------------------------------
 
 vtkStandardNewMacro(vtkPlusNvidiaDVPVideoSource);
@@ -29,6 +175,8 @@ vtkStandardNewMacro(vtkPlusNvidiaDVPVideoSource);
 vtkPlusNvidiaDVPVideoSource::vtkPlusNvidiaDVPVideoSource()
   : FrameNumber(0)
   , EnableGPUCPUCopy(false)
+  , GpuResidentFrames(false)
+  , GpuFrameCount(8)
   , VideoSize( { 0, 0, 1 })
 {
   // No callback function provided by the device, so the data capture thread will be used to poll the hardware and add new items to the buffer
@@ -70,6 +218,12 @@ PlusStatus vtkPlusNvidiaDVPVideoSource::InternalConnect()
 
   SetupGL();
 
+  if (GpuResidentFrames && SetupGpuFrameRing() != GL_TRUE)
+  {
+    LOG_ERROR("Unable to set up GPU frame buffers.");
+    return PLUS_FAIL;
+  }
+
   if (StartSDIPipeline() == E_FAIL)
   {
     return PLUS_FAIL;
@@ -100,6 +254,11 @@ PlusStatus vtkPlusNvidiaDVPVideoSource::InternalUpdate()
 {
   CaptureVideo();
 
+  if (GpuResidentFrames)
+  {
+    return AddGpuFrame();
+  }
+
   if (EnableGPUCPUCopy)
   {
     CopyGPUToCPU();
@@ -127,6 +286,13 @@ PlusStatus vtkPlusNvidiaDVPVideoSource::ReadConfiguration(vtkXMLDataElement* roo
   XML_FIND_DEVICE_ELEMENT_REQUIRED_FOR_READING(deviceConfig, rootConfigElement);
 
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(EnableGPUCPUCopy, deviceConfig);
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(GpuResidentFrames, deviceConfig);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, GpuFrameCount, deviceConfig);
+  if (GpuFrameCount < 2)
+  {
+    LOG_WARNING("GpuFrameCount must be at least 2, using 2 instead of " << GpuFrameCount);
+    GpuFrameCount = 2;
+  }
 
   int numGPUs;
   // Note, this function enumerates GPUs which are both CUDA & GLAffinity capable (i.e. newer Quadros)
@@ -797,6 +963,8 @@ PlusStatus vtkPlusNvidiaDVPVideoSource::WriteConfiguration(vtkXMLDataElement* ro
   XML_FIND_DEVICE_ELEMENT_REQUIRED_FOR_WRITING(deviceConfig, rootConfig);
 
   XML_WRITE_BOOL_ATTRIBUTE(EnableGPUCPUCopy, deviceConfig);
+  XML_WRITE_BOOL_ATTRIBUTE(GpuResidentFrames, deviceConfig);
+  deviceConfig->SetIntAttribute("GpuFrameCount", GpuFrameCount);
 
   return PLUS_SUCCESS;
 }
@@ -804,14 +972,15 @@ PlusStatus vtkPlusNvidiaDVPVideoSource::WriteConfiguration(vtkXMLDataElement* ro
 //-----------------------------------------------------------------------------
 PlusStatus vtkPlusNvidiaDVPVideoSource::NotifyConfigured()
 {
-  if (this->OutputChannels.size() != 1 && this->EnableGPUCPUCopy)
+  bool outputToBuffer = this->EnableGPUCPUCopy || this->GpuResidentFrames;
+  if (this->OutputChannels.size() != 1 && outputToBuffer)
   {
     LOG_ERROR("Incorrect configuration. GPU/CPU copy and OutputChannel configuration are incompatible.");
     this->SetCorrectlyConfigured(false);
     return PLUS_FAIL;
   }
 
-  if (this->EnableGPUCPUCopy && this->GetFirstVideoSource(OutputDataSource) != PLUS_SUCCESS)
+  if (outputToBuffer && this->GetFirstVideoSource(OutputDataSource) != PLUS_SUCCESS)
   {
     LOG_ERROR("Unable to find video source. Device needs a video buffer to put new frames into when copying frames from the GPU.");
     this->SetCorrectlyConfigured(false);
@@ -1022,6 +1191,10 @@ GLenum vtkPlusNvidiaDVPVideoSource::CaptureVideo()
 
     // Reinitialize OpenGL.
     SetupGL();
+    if (GpuResidentFrames)
+    {
+      SetupGpuFrameRing();
+    }
     StartSDIPipeline();
     numFails = 0;
     numTries = 0;
@@ -1045,6 +1218,7 @@ HRESULT vtkPlusNvidiaDVPVideoSource::CleanupSDIinGL()
 //-----------------------------------------------------------------------------
 GLboolean vtkPlusNvidiaDVPVideoSource::CleanupGL()
 {
+  CleanupGpuFrameRing();
   CleanupSDIinGL();
 
   // Delete OpenGL rendering context.
@@ -1076,4 +1250,129 @@ HRESULT vtkPlusNvidiaDVPVideoSource::CopyGPUToCPU()
   glGetBufferSubData(GL_VIDEO_BUFFER_NV, 0, NvSDIin.GetBufferObjectPitch(0) * VideoSize[1], CPUFrame);
 
   return S_OK;
-}
\ No newline at end of file
+}
+
+//-----------------------------------------------------------------------------
+GLboolean vtkPlusNvidiaDVPVideoSource::SetupGpuFrameRing()
+{
+  CleanupGpuFrameRing();
+
+  if (!loadCopyBufferExtension() || !loadSyncExtension())
+  {
+    LOG_ERROR("Could not load the OpenGL extensions that are required for GPU resident frames.");
+    return GL_FALSE;
+  }
+
+  std::shared_ptr<DVPGpuFrameRing> ring = std::make_shared<DVPGpuFrameRing>();
+  ring->HandleDC = HandleDC;
+  ring->CaptureGLRC = HandleGLRC;
+  ring->PitchInBytes = NvSDIin.GetBufferObjectPitch(0);
+  ring->Height = VideoSize[1];
+
+  // The readback context must not have any objects of its own when it is shared with the capture context
+  ring->ReadbackGLRC = wglCreateContext(HandleDC);
+  if (ring->ReadbackGLRC == NULL || !wglShareLists(HandleGLRC, ring->ReadbackGLRC))
+  {
+    LOG_ERROR("Unable to create shared OpenGL context for reading back GPU frames.");
+    if (ring->ReadbackGLRC != NULL)
+    {
+      wglDeleteContext(ring->ReadbackGLRC);
+    }
+    return GL_FALSE;
+  }
+
+  ring->BufferObjects.resize(GpuFrameCount, 0);
+  ring->Generations.resize(GpuFrameCount, 0);
+  ring->Fences.resize(GpuFrameCount, NULL);
+  glGenBuffers(GpuFrameCount, &ring->BufferObjects[0]);
+  for (int i = 0; i < GpuFrameCount; i++)
+  {
+    glBindBuffer(GL_COPY_WRITE_BUFFER, ring->BufferObjects[i]);
+    glBufferData(GL_COPY_WRITE_BUFFER, ring->PitchInBytes * ring->Height, NULL, GL_STREAM_COPY);
+  }
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  if (glGetError() != GL_NO_ERROR)
+  {
+    LOG_ERROR("Unable to allocate " << GpuFrameCount << " GPU frame buffers of " << ring->PitchInBytes * ring->Height << " bytes.");
+    glDeleteBuffers(GpuFrameCount, &ring->BufferObjects[0]);
+    wglDeleteContext(ring->ReadbackGLRC);
+    return GL_FALSE;
+  }
+
+  ring->Valid = true;
+  GpuFrameRing = ring;
+  return GL_TRUE;
+}
+
+//-----------------------------------------------------------------------------
+void vtkPlusNvidiaDVPVideoSource::CleanupGpuFrameRing()
+{
+  if (GpuFrameRing == nullptr)
+  {
+    return;
+  }
+
+  {
+    // Frame handles that are still in the buffer keep the ring, they become invalid
+    std::lock_guard<std::mutex> lock(GpuFrameRing->Mutex);
+    GpuFrameRing->Valid = false;
+    for (std::vector<GLsync>::iterator fence = GpuFrameRing->Fences.begin(); fence != GpuFrameRing->Fences.end(); ++fence)
+    {
+      if (*fence != NULL)
+      {
+        glDeleteSync(*fence);
+        *fence = NULL;
+      }
+    }
+    glDeleteBuffers(static_cast<GLsizei>(GpuFrameRing->BufferObjects.size()), &GpuFrameRing->BufferObjects[0]);
+    wglDeleteContext(GpuFrameRing->ReadbackGLRC);
+    GpuFrameRing->ReadbackGLRC = NULL;
+  }
+  GpuFrameRing = nullptr;
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusNvidiaDVPVideoSource::AddGpuFrame()
+{
+  if (GpuFrameRing == nullptr)
+  {
+    LOG_ERROR("Unable to add GPU frame, GPU frame buffers are not set up.");
+    return PLUS_FAIL;
+  }
+
+  PlusGpuFramePtr gpuFrame;
+  {
+    std::lock_guard<std::mutex> lock(GpuFrameRing->Mutex);
+    unsigned int slot = GpuFrameRing->NextSlot;
+    GpuFrameRing->NextSlot = (slot + 1) % GpuFrameRing->BufferObjects.size();
+
+    // Handles of the frame that was in this slot become invalid
+    GpuFrameRing->Generations[slot]++;
+    if (GpuFrameRing->Fences[slot] != NULL)
+    {
+      glDeleteSync(GpuFrameRing->Fences[slot]);
+    }
+
+    // GPU to GPU copy, so that the capture buffer can be reused for the next frame
+    glBindBuffer(GL_COPY_READ_BUFFER, VideoBufferObject[0]);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, GpuFrameRing->BufferObjects[slot]);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, GpuFrameRing->PitchInBytes * GpuFrameRing->Height);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    GpuFrameRing->Fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    // The fence has to be flushed, otherwise a wait in the readback context may never return
+    glFlush();
+
+    gpuFrame = std::make_shared<DVPGpuFrame>(GpuFrameRing, slot, GpuFrameRing->Generations[slot]);
+  }
+
+  if (OutputDataSource->AddGpuItem(gpuFrame, this->FrameNumber) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to add GPU frame from SDI capture.");
+    return PLUS_FAIL;
+  }
+  this->FrameNumber++;
+
+  return PLUS_SUCCESS;
+}
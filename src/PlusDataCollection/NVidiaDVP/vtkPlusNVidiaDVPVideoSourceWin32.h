@@ -14,7 +14,11 @@ See License.txt for details.
 #include "nvSDIin.h"
 #include "nvConfigure.h"
 
+// STL includes
+#include <memory>
+
 class CNvGpu;
+struct DVPGpuFrameRing;
 
 /*!
 \class vtkPlusNvidiaDVPVideoSource
@@ -42,10 +46,19 @@ public:
   /// Get the field that determines if the frames are copied from the GPU to the CPU to be used downstream
   vtkGetMacro(EnableGPUCPUCopy, bool);
 
+  /// Get the field that determines if the frames are kept in GPU memory and read back only when a CPU consumer requests them
+  vtkGetMacro(GpuResidentFrames, bool);
+
+  /// Get the number of GPU buffer objects that the captured frames are kept in
+  vtkGetMacro(GpuFrameCount, int);
+
 protected:
   /// Set the field that determines if the frames are copied from the GPU to the CPU to be used downstream
   vtkSetMacro(EnableGPUCPUCopy, bool);
 
+  vtkSetMacro(GpuResidentFrames, bool);
+  vtkSetMacro(GpuFrameCount, int);
+
   vtkPlusNvidiaDVPVideoSource();
   virtual ~vtkPlusNvidiaDVPVideoSource();
 
@@ -63,6 +76,13 @@ protected:
   HRESULT CopyGPUToCPU();
   void Shutdown();
 
+  /// Create the GPU buffer objects and the shared context that is used for reading back the frames
+  GLboolean SetupGpuFrameRing();
+  void CleanupGpuFrameRing();
+
+  /// Copy the captured frame into the next GPU buffer object and add its handle to the output buffer
+  PlusStatus AddGpuFrame();
+
 protected:
   HRESULT SetupSDIinGL();
   HRESULT SetupSDIinDevices();
@@ -98,6 +118,15 @@ protected:
   /// Enable copying of frame data from GPU to CPU for broadcasting
   bool EnableGPUCPUCopy;
 
+  /// Keep the frames in GPU memory and add only a handle to the buffer
+  bool GpuResidentFrames;
+
+  /// Number of GPU buffer objects that the frames are copied into (frames older than this cannot be read back)
+  int GpuFrameCount;
+
+  /// GPU buffer objects of the frames that were added to the buffer, shared with the frame handles
+  std::shared_ptr<DVPGpuFrameRing> GpuFrameRing;
+
   /// Data source for CPU output (if enabled)
   vtkPlusDataSource* OutputDataSource;
 
@@ -14,6 +14,9 @@ See License.txt for details.
 #include <vtkImageData.h>
 #include <vtkObjectFactory.h>
 
+// STL includes
+#include <algorithm>
+
 // OpenCV includes
 #if CV_MAJOR_VERSION > 3
   #include <opencv2/calib3d.hpp>
@@ -25,6 +28,15 @@ See License.txt for details.
 
 vtkStandardNewMacro(vtkPlusOpenCVCaptureVideoSource);
 
+//----------------------------------------------------------------------------
+
+namespace
+{
+  // Number of rows that are undistorted at once before their colors are converted. The strip remains in the cache,
+  // so the pixels are read from and written to memory only once.
+  const int UNDISTORT_STRIP_ROWS = 32;
+}
+
 //----------------------------------------------------------------------------
 vtkPlusOpenCVCaptureVideoSource::vtkPlusOpenCVCaptureVideoSource()
   : VideoURL("")
@@ -236,6 +248,9 @@ PlusStatus vtkPlusOpenCVCaptureVideoSource::InternalConnect()
   this->AcquisitionRate = cvRound(this->Capture->get(cv::CAP_PROP_FPS));
 
   this->Frame = std::make_shared<cv::Mat>(this->FrameSize[1], this->FrameSize[0], CV_8UC3);
+  this->UndistortMapXY = nullptr;
+  this->UndistortMapInterpolation = nullptr;
+  this->UndistortStrip = std::make_shared<cv::Mat>();
 
   if (this->CameraMatrix != nullptr && this->DistortionCoefficients != nullptr)
   {
@@ -268,6 +283,9 @@ PlusStatus vtkPlusOpenCVCaptureVideoSource::InternalDisconnect()
   this->Capture = nullptr; // automatically closes resources/connections
   this->Frame = nullptr;
   this->UndistortedFrame = nullptr;
+  this->UndistortMapXY = nullptr;
+  this->UndistortMapInterpolation = nullptr;
+  this->UndistortStrip = nullptr;
 
   return PLUS_SUCCESS;
 }
@@ -290,14 +308,6 @@ PlusStatus vtkPlusOpenCVCaptureVideoSource::InternalUpdate()
     return PLUS_FAIL;
   }
 
-  if (this->CameraMatrix != nullptr && this->DistortionCoefficients != nullptr)
-  {
-    cv::undistort(*this->Frame, *this->UndistortedFrame, *this->CameraMatrix, *this->DistortionCoefficients);
-  }
-
-  // BGR -> RGB color
-  cv::cvtColor(*this->UndistortedFrame, *this->UndistortedFrame, cv::COLOR_BGR2RGB);
-
   vtkPlusDataSource* aSource(nullptr);
   if (this->GetFirstActiveOutputVideoSource(aSource) == PLUS_FAIL || aSource == nullptr)
   {
@@ -311,11 +321,32 @@ PlusStatus vtkPlusOpenCVCaptureVideoSource::InternalUpdate()
     aSource->SetImageType(US_IMG_RGB_COLOR);
     aSource->SetPixelType(VTK_UNSIGNED_CHAR);
     aSource->SetNumberOfScalarComponents(3);
-    aSource->SetInputFrameSize(this->UndistortedFrame->cols, this->UndistortedFrame->rows, 1);
+    aSource->SetInputFrameSize(this->Frame->cols, this->Frame->rows, 1);
+  }
+
+  FrameSizeType frameSize = { static_cast<unsigned int>(this->Frame->cols), static_cast<unsigned int>(this->Frame->rows), 1 };
+
+  // Write the converted frame directly into the buffer if possible
+  igsioVideoFrame* bufferFrame = nullptr;
+  if (aSource->IsInPlaceWritingSupported() && aSource->AcquireWritableFrame(bufferFrame) == PLUS_SUCCESS)
+  {
+    if (bufferFrame->GetFrameSize() == frameSize && bufferFrame->GetFrameSizeInBytes() == this->Frame->total() * 3)
+    {
+      cv::Mat rgbFrame(this->Frame->rows, this->Frame->cols, CV_8UC3, bufferFrame->GetScalarPointer());
+      this->ConvertFrame(rgbFrame);
+      if (aSource->CommitWritableFrame(this->FrameNumber) != PLUS_SUCCESS)
+      {
+        return PLUS_FAIL;
+      }
+      this->FrameNumber++;
+      return PLUS_SUCCESS;
+    }
+    aSource->ReleaseWritableFrame();
   }
 
   // Add the frame to the stream buffer
-  FrameSizeType frameSize = { static_cast<unsigned int>(this->UndistortedFrame->cols), static_cast<unsigned int>(this->UndistortedFrame->rows), 1 };
+  this->UndistortedFrame->create(this->Frame->size(), CV_8UC3);
+  this->ConvertFrame(*this->UndistortedFrame);
   if (aSource->AddItem(this->UndistortedFrame->data, aSource->GetInputImageOrientation(), frameSize, VTK_UNSIGNED_CHAR, 3, US_IMG_RGB_COLOR, 0, this->FrameNumber) == PLUS_FAIL)
   {
     return PLUS_FAIL;
@@ -326,6 +357,35 @@ PlusStatus vtkPlusOpenCVCaptureVideoSource::InternalUpdate()
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+void vtkPlusOpenCVCaptureVideoSource::ConvertFrame(cv::Mat& rgbFrame)
+{
+  if (this->CameraMatrix == nullptr || this->DistortionCoefficients == nullptr)
+  {
+    // BGR -> RGB color
+    cv::cvtColor(*this->Frame, rgbFrame, cv::COLOR_BGR2RGB);
+    return;
+  }
+
+  // cv::undistort would compute the maps for each frame, they only change if the frame size changes
+  if (this->UndistortMapXY == nullptr || this->UndistortMapXY->size() != this->Frame->size())
+  {
+    this->UndistortMapXY = std::make_shared<cv::Mat>();
+    this->UndistortMapInterpolation = std::make_shared<cv::Mat>();
+    cv::initUndistortRectifyMap(*this->CameraMatrix, *this->DistortionCoefficients, cv::Mat(), *this->CameraMatrix,
+                                this->Frame->size(), CV_16SC2, *this->UndistortMapXY, *this->UndistortMapInterpolation);
+  }
+
+  for (int firstRow = 0; firstRow < this->Frame->rows; firstRow += UNDISTORT_STRIP_ROWS)
+  {
+    cv::Range rows(firstRow, std::min(firstRow + UNDISTORT_STRIP_ROWS, this->Frame->rows));
+    cv::remap(*this->Frame, *this->UndistortStrip, this->UndistortMapXY->rowRange(rows), this->UndistortMapInterpolation->rowRange(rows), cv::INTER_LINEAR, cv::BORDER_CONSTANT);
+    // BGR -> RGB color
+    cv::Mat rgbRows = rgbFrame.rowRange(rows);
+    cv::cvtColor(*this->UndistortStrip, rgbRows, cv::COLOR_BGR2RGB);
+  }
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusOpenCVCaptureVideoSource::NotifyConfigured()
 {
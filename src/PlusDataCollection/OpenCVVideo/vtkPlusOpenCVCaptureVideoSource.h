@@ -78,6 +78,12 @@ protected:
   virtual PlusStatus InternalConnect();
   virtual PlusStatus InternalDisconnect();
 
+  /*!
+    Undistort the captured frame (if CameraMatrix and DistortionCoefficients are defined) and convert it to RGB,
+    writing the result into rgbFrame (that may refer to a frame of the buffer)
+  */
+  void ConvertFrame(cv::Mat& rgbFrame);
+
 protected:
   std::string                       VideoURL;
   int                               DeviceIndex;
@@ -93,6 +99,12 @@ protected:
 
   std::shared_ptr<cv::Mat>          CameraMatrix;
   std::shared_ptr<cv::Mat>          DistortionCoefficients;
+
+  /*! Undistortion maps for the size of the captured frames, they are computed when the first frame is captured */
+  std::shared_ptr<cv::Mat>          UndistortMapXY;
+  std::shared_ptr<cv::Mat>          UndistortMapInterpolation;
+  /*! Undistorted rows that are converted to RGB in one step */
+  std::shared_ptr<cv::Mat>          UndistortStrip;
 };
 
 #endif // __vtkPlusOpenCVCaptureVideoSource_h
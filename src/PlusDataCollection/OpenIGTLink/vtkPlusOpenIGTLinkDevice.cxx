@@ -6,6 +6,7 @@ See License.txt for details.
 
 // Local includes
 #include "PlusConfigure.h"
+#include "PlusPacingTimer.h"
 #include "igtlPlusClientInfoMessage.h"
 #include "vtkPlusDataSource.h"
 #include "vtkPlusIgtlMessageFactory.h"
@@ -29,6 +30,11 @@ vtkPlusOpenIGTLinkDevice::vtkPlusOpenIGTLinkDevice()
   , ClientSocket(igtl::ClientSocket::New())
   , ReconnectOnReceiveTimeout(true)
   , UseReceivedTimestamps(true)
+  , SharedMemoryTransport(false)
+  , BinaryTrackedFrameFields(false)
+  , LowLatencyReceiveEnabled(false)
+  , ReceiveThreadId(-1)
+  , ReceiveThreadActive(false)
 {
   // No callback function provided by the device, so the data capture thread will be used to poll the hardware and add new items to the buffer
   this->StartThreadForInternalUpdates = true;
@@ -178,6 +184,8 @@ PlusStatus vtkPlusOpenIGTLinkDevice::SendRequestedMessageTypes()
 
   // Set message type
   clientInfo.IgtlMessageTypes.push_back(this->MessageType);
+  clientInfo.SharedMemoryTransportRequested = this->SharedMemoryTransport;
+  clientInfo.BinaryTrackedFrameFieldsRequested = this->BinaryTrackedFrameFields;
 
   // Set any requested image streams
   if (this->ImageMessageEmbeddedTransformName.IsValid())
@@ -256,9 +264,18 @@ PlusStatus vtkPlusOpenIGTLinkDevice::ReceiveMessageHeader(igtl::MessageHeader::P
   int numOfBytesReceived = 0;
   {
     igsioLockGuard<vtkIGSIORecursiveCriticalSection> socketGuard(this->SocketMutex);
-    RETRY_UNTIL_TRUE(
-      (numOfBytesReceived = this->ClientSocket->Receive(headerMsg->GetBufferPointer(), headerMsg->GetBufferSize())) != 0,
-      this->NumberOfRetryAttempts, this->DelayBetweenRetryAttemptsSec);
+    if (this->LowLatencyReceiveEnabled)
+    {
+      // The receive blocks until a message arrives (or the socket times out), the thread calls it again immediately,
+      // so a retry delay would only postpone messages that arrive during the delay
+      numOfBytesReceived = this->ClientSocket->Receive(headerMsg->GetBufferPointer(), headerMsg->GetBufferSize());
+    }
+    else
+    {
+      RETRY_UNTIL_TRUE(
+        (numOfBytesReceived = this->ClientSocket->Receive(headerMsg->GetBufferPointer(), headerMsg->GetBufferSize())) != 0,
+        this->NumberOfRetryAttempts, this->DelayBetweenRetryAttemptsSec);
+    }
   }
 
   if (numOfBytesReceived > 0)
@@ -313,6 +330,91 @@ PlusStatus vtkPlusOpenIGTLinkDevice::ReceiveMessageHeader(igtl::MessageHeader::P
   return socketError ? PLUS_FAIL : PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+igtl::MessageBase::Pointer vtkPlusOpenIGTLinkDevice::CreateReceiveMessage(const igtl::MessageHeader::Pointer& headerMsg)
+{
+  if (!this->LowLatencyReceiveEnabled || headerMsg.IsNull())
+  {
+    return this->MessageFactory->CreateReceiveMessage(headerMsg);
+  }
+
+  std::string messageKey = std::string(headerMsg->GetMessageType()) + "_" + headerMsg->GetDeviceName();
+  std::map<std::string, igtl::MessageBase::Pointer>::iterator messageIt = this->ReceiveMessages.find(messageKey);
+  if (messageIt != this->ReceiveMessages.end() && messageIt->second->GetHeaderVersion() == headerMsg->GetHeaderVersion())
+  {
+    return messageIt->second;
+  }
+
+  igtl::MessageBase::Pointer bodyMsg = this->MessageFactory->CreateReceiveMessage(headerMsg);
+  if (bodyMsg.IsNotNull())
+  {
+    this->ReceiveMessages[messageKey] = bodyMsg;
+  }
+  return bodyMsg;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusOpenIGTLinkDevice::InternalStartRecording()
+{
+  if (!this->LowLatencyReceiveEnabled || this->ReceiveThreadId >= 0)
+  {
+    return PLUS_SUCCESS;
+  }
+  this->ReceiveThreadActive = true;
+  this->ReceiveThreadId = this->Threader->SpawnThread((vtkThreadFunctionType)&vtkReceiveThread, this);
+  if (this->ReceiveThreadId < 0)
+  {
+    LOG_ERROR(this->GetDeviceId() << ": Failed to start receive thread");
+    this->ReceiveThreadActive = false;
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusOpenIGTLinkDevice::InternalStopRecording()
+{
+  if (this->ReceiveThreadId < 0)
+  {
+    return PLUS_SUCCESS;
+  }
+  this->ReceiveThreadActive = false;
+  // The thread exits when the pending receive completes or times out
+  this->Threader->TerminateThread(this->ReceiveThreadId);
+  this->ReceiveThreadId = -1;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void* vtkPlusOpenIGTLinkDevice::vtkReceiveThread(vtkMultiThreader::ThreadInfo* data)
+{
+  vtkPlusOpenIGTLinkDevice* self = (vtkPlusOpenIGTLinkDevice*)(data->UserData);
+  self->ApplyThreadScheduling();
+
+  while (self->ReceiveThreadActive)
+  {
+    if (!self->IsRecording())
+    {
+      // InternalStartRecording is called before the recording flag is set
+      PlusPacingTimer::Delay(0.001);
+      continue;
+    }
+    igsioLockGuard<vtkIGSIORecursiveCriticalSection> updateMutexGuardedLock(self->UpdateMutex);
+    if (!self->ReceiveThreadActive)
+    {
+      break;
+    }
+    if (self->InternalUpdate() != PLUS_SUCCESS && !self->GetConnected())
+    {
+      // Avoid spinning while the connection is down
+      vtkIGSIOAccurateTimer::Delay(self->DelayBetweenRetryAttemptsSec);
+    }
+    self->UpdateTime.Modified();
+  }
+
+  return NULL;
+}
+
 //-----------------------------------------------------------------------------
 PlusStatus vtkPlusOpenIGTLinkDevice::ReadConfiguration(vtkXMLDataElement* rootConfigElement)
 {
@@ -325,6 +427,11 @@ PlusStatus vtkPlusOpenIGTLinkDevice::ReadConfiguration(vtkXMLDataElement* rootCo
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(IgtlMessageCrcCheckEnabled, deviceConfig);
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(UseReceivedTimestamps, deviceConfig);
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(ReconnectOnReceiveTimeout, deviceConfig);
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(SharedMemoryTransport, deviceConfig);
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(BinaryTrackedFrameFields, deviceConfig);
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(LowLatencyReceiveEnabled, deviceConfig);
+  // The receive thread replaces the polling thread of the device
+  this->StartThreadForInternalUpdates = !this->LowLatencyReceiveEnabled;
   return PLUS_SUCCESS;
 }
 
@@ -340,6 +447,9 @@ PlusStatus vtkPlusOpenIGTLinkDevice::WriteConfiguration(vtkXMLDataElement* rootC
   deviceConfig->SetAttribute("IgtlMessageCrcCheckEnabled", this->IgtlMessageCrcCheckEnabled ? "true" : "false");
   deviceConfig->SetAttribute("UseReceivedTimestamps", this->UseReceivedTimestamps ? "true" : "false");
   deviceConfig->SetAttribute("ReconnectOnReceiveTimeout", this->ReconnectOnReceiveTimeout ? "true" : "false");
+  deviceConfig->SetAttribute("SharedMemoryTransport", this->SharedMemoryTransport ? "true" : "false");
+  deviceConfig->SetAttribute("BinaryTrackedFrameFields", this->BinaryTrackedFrameFields ? "true" : "false");
+  deviceConfig->SetAttribute("LowLatencyReceiveEnabled", this->LowLatencyReceiveEnabled ? "true" : "false");
   return PLUS_SUCCESS;
 }
 
@@ -15,6 +15,10 @@
 #include <igtlClientSocket.h>
 #include <igtlMessageBase.h>
 
+// STL includes
+#include <atomic>
+#include <map>
+
 class vtkPlusIgtlMessageFactory;
 
 /*!
@@ -90,10 +94,43 @@ public:
   /*! Get the ReconnectOnNoData flag */
   vtkGetMacro(ReconnectOnReceiveTimeout, bool);
 
+  /*! Request the server to pass images through shared memory, if the server runs on the same host */
+  vtkSetMacro(SharedMemoryTransport, bool);
+  vtkGetMacro(SharedMemoryTransport, bool);
+
+  /*! Request the server to send the fields and transforms of TRACKEDFRAME messages in the binary encoding instead of XML */
+  vtkSetMacro(BinaryTrackedFrameFields, bool);
+  vtkGetMacro(BinaryTrackedFrameFields, bool);
+
+  /*!
+    Receive messages in a dedicated thread that blocks on the socket and adds the data to the buffers as soon as
+    a message is complete (instead of polling at the acquisition rate), and reuse the message bodies.
+    Recommended when chaining Plus servers. Must be set before the device is connected.
+  */
+  vtkSetMacro(LowLatencyReceiveEnabled, bool);
+  vtkGetMacro(LowLatencyReceiveEnabled, bool);
+  vtkBooleanMacro(LowLatencyReceiveEnabled, bool);
+
 protected:
   vtkPlusOpenIGTLinkDevice();
   virtual ~vtkPlusOpenIGTLinkDevice();
 
+  /*! Start the receive thread if LowLatencyReceiveEnabled is set */
+  virtual PlusStatus InternalStartRecording();
+
+  /*! Stop the receive thread */
+  virtual PlusStatus InternalStopRecording();
+
+  /*! Receive thread, calls InternalUpdate as soon as the previous message is processed */
+  static void* vtkReceiveThread(vtkMultiThreader::ThreadInfo* data);
+
+  /*!
+    Create the body message for the received header.
+    If LowLatencyReceiveEnabled is set then the message created for the previous message with the same type and
+    device name is returned, so that its buffer is reused if the message size has not changed.
+  */
+  igtl::MessageBase::Pointer CreateReceiveMessage(const igtl::MessageHeader::Pointer& headerMsg);
+
   /*! Reconnect the client socket. Used when the connection is established or there is a socket error. */
   virtual PlusStatus ClientSocketReconnect();
 
@@ -166,6 +203,22 @@ protected:
   */
   bool UseReceivedTimestamps;
 
+  /*! Request the shared memory transport in the client info sent to the server */
+  bool SharedMemoryTransport;
+
+  /*! Request the binary encoding of TRACKEDFRAME fields in the client info sent to the server */
+  bool BinaryTrackedFrameFields;
+
+  /*! Receive messages in a dedicated thread as soon as they arrive */
+  bool LowLatencyReceiveEnabled;
+
+  /*! Receive thread id, -1 if it is not running */
+  int ReceiveThreadId;
+  std::atomic<bool> ReceiveThreadActive;
+
+  /*! Body messages that are reused for receiving, by message type and device name */
+  std::map<std::string, igtl::MessageBase::Pointer> ReceiveMessages;
+
 private:
   vtkPlusOpenIGTLinkDevice(const vtkPlusOpenIGTLinkDevice&);   // Not implemented.
   void operator=(const vtkPlusOpenIGTLinkDevice&);   // Not implemented.
@@ -130,7 +130,7 @@ PlusStatus vtkPlusOpenIGTLinkTracker::InternalUpdateTData()
     // We've received valid header data
     headerMsg->Unpack(this->IgtlMessageCrcCheckEnabled);
 
-    bodyMsg = this->MessageFactory->CreateReceiveMessage(headerMsg);
+    bodyMsg = this->CreateReceiveMessage(headerMsg);
     if (typeid(*bodyMsg) == typeid(igtl::TrackingDataMessage))
     {
       // received a TDATA message
@@ -305,7 +305,7 @@ PlusStatus vtkPlusOpenIGTLinkTracker::ProcessTransformMessageGeneral(bool& moreM
   std::string igtlTransformName;
   ToolStatus toolStatus(TOOL_UNKNOWN);
 
-  igtl::MessageBase::Pointer bodyMsg = this->MessageFactory->CreateReceiveMessage(headerMsg);
+  igtl::MessageBase::Pointer bodyMsg = this->CreateReceiveMessage(headerMsg);
   if (typeid(*bodyMsg) == typeid(igtl::TransformMessage))
   {
     if (vtkPlusIgtlMessageCommon::UnpackTransformMessage(bodyMsg, this->ClientSocket.GetPointer(), toolMatrix, toolStatus, igtlTransformName, unfilteredTimestampUtc, this->IgtlMessageCrcCheckEnabled) != PLUS_SUCCESS)
@@ -72,7 +72,7 @@ PlusStatus vtkPlusOpenIGTLinkVideoSource::InternalUpdate()
   double unfilteredTimestamp = vtkIGSIOAccurateTimer::GetSystemTime();
 
   igsioTrackedFrame trackedFrame;
-  igtl::MessageBase::Pointer bodyMsg = this->MessageFactory->CreateReceiveMessage(headerMsg);
+  igtl::MessageBase::Pointer bodyMsg = this->CreateReceiveMessage(headerMsg);
 
   if (typeid(*bodyMsg) == typeid(igtl::ImageMessage))
   {
@@ -82,6 +82,52 @@ PlusStatus vtkPlusOpenIGTLinkVideoSource::InternalUpdate()
       return PLUS_FAIL;
     }
   }
+  else if (typeid(*bodyMsg) == typeid(igtl::PlusSharedMemoryFrameMessage))
+  {
+    bool frameRead = false;
+    if (vtkPlusIgtlMessageCommon::UnpackSharedMemoryFrameMessage(bodyMsg, this->ClientSocket, this->SharedMemoryRing, trackedFrame, this->ImageMessageEmbeddedTransformName, frameRead, this->IgtlMessageCrcCheckEnabled) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Couldn't get image from shared memory of OpenIGTLink server!");
+      return PLUS_FAIL;
+    }
+    if (!frameRead)
+    {
+      // The frame was overwritten in the ring before the notification was processed
+      return PLUS_SUCCESS;
+    }
+  }
+  else if (typeid(*bodyMsg) == typeid(igtl::PlusDeltaImageMessage))
+  {
+    bool frameDecoded = false;
+    if (vtkPlusIgtlMessageCommon::UnpackDeltaImageMessage(bodyMsg, this->ClientSocket, trackedFrame, this->ImageMessageEmbeddedTransformName, this->DeltaImageDecoder, frameDecoded, this->IgtlMessageCrcCheckEnabled) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Couldn't get delta image from OpenIGTLink server!");
+      return PLUS_FAIL;
+    }
+    if (!frameDecoded)
+    {
+      // Waiting for a key frame
+      return PLUS_SUCCESS;
+    }
+    if (this->UseReceivedTimestamps)
+    {
+      // The received timestamp is in UTC and timestamps in the buffer are in system time, so conversion is needed
+      unfilteredTimestamp = vtkIGSIOAccurateTimer::GetSystemTimeFromUniversalTime(trackedFrame.GetTimestamp());
+    }
+  }
+  else if (typeid(*bodyMsg) == typeid(igtl::PlusSlabVolumeMessage))
+  {
+    if (vtkPlusIgtlMessageCommon::UnpackSlabVolumeMessage(bodyMsg, this->ClientSocket, trackedFrame, this->ImageMessageEmbeddedTransformName, this->IgtlMessageCrcCheckEnabled) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Couldn't get slab volume from OpenIGTLink server!");
+      return PLUS_FAIL;
+    }
+    if (this->UseReceivedTimestamps)
+    {
+      // The received timestamp is in UTC and timestamps in the buffer are in system time, so conversion is needed
+      unfilteredTimestamp = vtkIGSIOAccurateTimer::GetSystemTimeFromUniversalTime(trackedFrame.GetTimestamp());
+    }
+  }
   else if (typeid(*bodyMsg) == typeid(igtl::PlusTrackedFrameMessage))
   {
     if (vtkPlusIgtlMessageCommon::UnpackTrackedFrameMessage(bodyMsg, this->ClientSocket, trackedFrame, this->ImageMessageEmbeddedTransformName, this->IgtlMessageCrcCheckEnabled) != PLUS_SUCCESS)
@@ -97,6 +143,27 @@ PlusStatus vtkPlusOpenIGTLinkVideoSource::InternalUpdate()
       unfilteredTimestamp = vtkIGSIOAccurateTimer::GetSystemTimeFromUniversalTime(unfilteredTimestampUtc);
     }
   }
+  else if (typeid(*bodyMsg) == typeid(igtl::PlusTrackedFrameBatchMessage))
+  {
+    std::vector<igsioTrackedFrame> trackedFrames;
+    if (vtkPlusIgtlMessageCommon::UnpackTrackedFrameBatchMessage(bodyMsg, this->ClientSocket, trackedFrames, this->IgtlMessageCrcCheckEnabled) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Couldn't get tracked frame batch from OpenIGTLink server!");
+      return PLUS_FAIL;
+    }
+    PlusStatus status = PLUS_SUCCESS;
+    for (auto frameIt = trackedFrames.begin(); frameIt != trackedFrames.end(); ++frameIt)
+    {
+      // Without the received timestamps all the frames of the batch would get the same timestamp,
+      // so the received timestamps are always used. They are in UTC and need to be converted to system time.
+      double frameTimestamp = vtkIGSIOAccurateTimer::GetSystemTimeFromUniversalTime(frameIt->GetTimestamp());
+      if (this->AddReceivedFrame(*frameIt, frameTimestamp) != PLUS_SUCCESS)
+      {
+        status = PLUS_FAIL;
+      }
+    }
+    return status;
+  }
   else
   {
     // if the data type is unknown, skip reading.
@@ -105,6 +172,12 @@ PlusStatus vtkPlusOpenIGTLinkVideoSource::InternalUpdate()
     return PLUS_SUCCESS;
   }
 
+  return this->AddReceivedFrame(trackedFrame, unfilteredTimestamp);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusOpenIGTLinkVideoSource::AddReceivedFrame(igsioTrackedFrame& trackedFrame, double unfilteredTimestamp)
+{
   // No need to filter already filtered timestamped items received over OpenIGTLink
   // If the original timestamps are not used it's still safer not to use filtering, as filtering assumes uniform frame rate, which is not guaranteed
   double filteredTimestamp = unfilteredTimestamp;
@@ -48,6 +48,15 @@ protected:
   vtkPlusOpenIGTLinkVideoSource();
   virtual ~vtkPlusOpenIGTLinkVideoSource();
 
+  /*! Add a received frame to the video buffer. The unfiltered timestamp is in system time. */
+  PlusStatus AddReceivedFrame(igsioTrackedFrame& trackedFrame, double unfilteredTimestamp);
+
+  /*! Keeps the last frame of the DELTAIMAGE stream, the changed tiles of the received frames are applied to it */
+  PlusDeltaImageDecoder DeltaImageDecoder;
+
+  /*! Shared memory ring that the IMAGE messages of SHMFRAME notifications are read from */
+  PlusSharedMemoryFrameRing SharedMemoryRing;
+
 private:
   vtkPlusOpenIGTLinkVideoSource(const vtkPlusOpenIGTLinkVideoSource&);   // Not implemented.
   void operator=(const vtkPlusOpenIGTLinkVideoSource&);   // Not implemented.
@@ -9,6 +9,9 @@ See License.txt for details.
 // Local includes
 #include "PixelCodec.h"
 #include "PlusConfigure.h"
+#include "PlusTelemetry.h"
+#include "PlusWorkerPool.h"
+#include "vtkPlusChannel.h"
 #include "vtkPlusDataSource.h"
 #include "vtkPlusOpticalMarkerTracker.h"
 
@@ -21,9 +24,13 @@ See License.txt for details.
 #include <vtkObjectFactory.h>
 
 // OS includes
+#include <algorithm>
+#include <cmath>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <set>
+#include <sstream>
 
 // aruco includes
 #include <markerdetector.h>
@@ -34,6 +41,7 @@ See License.txt for details.
 // OpenCV includes
 #include <opencv2/highgui.hpp>
 #include <opencv2/calib3d.hpp>
+#include <opencv2/imgproc.hpp>
 
 //----------------------------------------------------------------------------
 
@@ -71,9 +79,58 @@ namespace
     std::string MarkerMapFile;
     std::string ToolSourceId;
     std::string ToolName;
-    aruco::MarkerPoseTracker MarkerPoseTracker;
     vtkSmartPointer<vtkMatrix4x4> transformMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
   };
+
+  /*! Pose of a tool in the camera coordinate system, as estimated from one camera image */
+  struct ToolObservation
+  {
+    bool Valid = false;
+    /*! Area of the marker in the image (in pixels), the camera with the largest view of the marker is used */
+    float MarkerAreaPixels = 0;
+    vtkSmartPointer<vtkMatrix4x4> MarkerToCamera = vtkSmartPointer<vtkMatrix4x4>::New();
+  };
+
+  /*! Detection state of one camera (input channel) */
+  class TrackedCamera
+  {
+  public:
+    TrackedCamera()
+      : InputChannel(nullptr)
+      , MarkerDetector(std::make_shared<aruco::MarkerDetector>())
+      , CameraParameters(std::make_shared<aruco::CameraParameters>())
+      , CameraToTracker(vtkSmartPointer<vtkMatrix4x4>::New())
+      , FramesSinceFullFrameDetection(0)
+      , LastProcessedInputDataTimestamp(0)
+      , DetectionLatency(std::make_shared<PlusLatencyHistogram>())
+    {
+    }
+
+    std::string                               InputChannelId;
+    vtkPlusChannel*                           InputChannel;
+    std::string                               CameraCalibrationFile;
+
+    std::shared_ptr<aruco::MarkerDetector>    MarkerDetector;
+    std::shared_ptr<aruco::CameraParameters>  CameraParameters;
+    /*! Pose of the camera in the tool reference frame of the tracker, identity if there is only one camera */
+    vtkSmartPointer<vtkMatrix4x4>             CameraToTracker;
+
+    int                                       FramesSinceFullFrameDetection;
+    double                                    LastProcessedInputDataTimestamp;
+    std::vector<aruco::Marker>                Markers;
+    /*! One pose tracker and observation for each tool (same order as vtkInternal::Tools) */
+    std::vector<aruco::MarkerPoseTracker>     MarkerPoseTrackers;
+    std::vector<ToolObservation>              ToolObservations;
+
+    /*! Duration of marker detection and pose estimation in each frame */
+    std::shared_ptr<PlusLatencyHistogram>     DetectionLatency;
+
+    /*! Buffers that are reused between frames */
+    igsioTrackedFrame                         TrackedFrame;
+    std::vector<aruco::Marker>                RoiMarkers;
+    cv::Mat                                   DownsampledImage;
+    cv::Mat                                   GrayImage;
+  };
 }
 //----------------------------------------------------------------------------
 class vtkPlusOpticalMarkerTracker::vtkInternal
@@ -83,28 +140,62 @@ public:
 
   vtkInternal(vtkPlusOpticalMarkerTracker* external)
     : External(external)
-    , MarkerDetector(std::make_shared<aruco::MarkerDetector>())
-    , CameraParameters(std::make_shared<aruco::CameraParameters>())
+    , TrackingMethod(TRACKING_OPTICAL)
+    , DetectionMode(DETECTION_FULL_FRAME)
+    , FullFrameDetectionInterval(10)
+    , RoiMarginFactor(0.5)
+    , DetectionScale(1.0)
   {
   }
 
   virtual ~vtkInternal()
   {
-    MarkerDetector = nullptr;
-    CameraParameters = nullptr;
   }
 
   PlusStatus BuildTransformMatrix(vtkSmartPointer<vtkMatrix4x4> transformMatrix, const cv::Mat& Rvec, const cv::Mat& Tvec);
 
+  /*! Load the calibration file and set up the marker detector of the camera */
+  PlusStatus InitializeCamera(TrackedCamera& camera);
+
+  /*!
+    Get the latest frame of the camera, detect the markers and estimate the tool poses in the camera coordinate system.
+    Called from the worker pool, only accesses the state of the given camera.
+  */
+  PlusStatus ProcessCamera(TrackedCamera& camera);
+
+  /*! Detect the markers in the image according to the detection mode, the result is stored in camera.Markers */
+  void DetectMarkers(TrackedCamera& camera, const cv::Mat& image);
+
+  /*! Detect markers in the whole image, downsampled by DetectionScale */
+  void DetectMarkersInFullFrame(TrackedCamera& camera, const cv::Mat& image);
+
+  /*!
+    Detect the markers that were found in the previous frame in a region around their previous position.
+    Returns false if any of these markers is not found.
+  */
+  bool DetectMarkersInRois(TrackedCamera& camera, const cv::Mat& image);
+
+  /*! Refine the marker corners on the full resolution image (after detection on a downsampled image) */
+  void RefineMarkerCorners(TrackedCamera& camera, const cv::Mat& image, std::vector<aruco::Marker>& markers);
+
   std::string               CameraCalibrationFile;
   TRACKING_METHOD           TrackingMethod;
   std::string               MarkerDictionary;
   std::vector<TrackedTool>  Tools;
 
-  /*! Pointer to main aruco objects */
-  std::shared_ptr<aruco::MarkerDetector>    MarkerDetector;
-  std::shared_ptr<aruco::CameraParameters>  CameraParameters;
-  std::vector<aruco::Marker>                Markers;
+  DETECTION_MODE            DetectionMode;
+  /*! In ROI tracking mode the whole frame is searched at least every FullFrameDetectionInterval frames */
+  int                       FullFrameDetectionInterval;
+  /*! Size of the margin around the marker in the search region, relative to the marker size in the image */
+  double                    RoiMarginFactor;
+  /*! Scaling factor of the image for full frame detection (e.g., 0.5 means detection in a half resolution image) */
+  double                    DetectionScale;
+
+  /*!
+    Cameras defined by Camera elements in the configuration. If there are no Camera elements then there is one
+    camera with empty InputChannelId, which uses the single input channel of the device.
+  */
+  std::vector<TrackedCamera> Cameras;
 };
 
 //----------------------------------------------------------------------------
@@ -136,9 +227,52 @@ PlusStatus vtkPlusOpticalMarkerTracker::ReadConfiguration(vtkXMLDataElement* roo
   // TODO: Improve error checking
   XML_FIND_DEVICE_ELEMENT_REQUIRED_FOR_READING(deviceConfig, rootConfigElement);
 
-  XML_READ_STRING_ATTRIBUTE_NONMEMBER_REQUIRED(CameraCalibrationFile, this->Internal->CameraCalibrationFile, deviceConfig);
+  XML_READ_STRING_ATTRIBUTE_NONMEMBER_OPTIONAL(CameraCalibrationFile, this->Internal->CameraCalibrationFile, deviceConfig);
   XML_READ_ENUM2_ATTRIBUTE_NONMEMBER_OPTIONAL(TrackingMethod, this->Internal->TrackingMethod, deviceConfig, "OPTICAL", TRACKING_OPTICAL, "OPTICAL_AND_DEPTH", TRACKING_OPTICAL_AND_DEPTH);
   XML_READ_STRING_ATTRIBUTE_NONMEMBER_REQUIRED(MarkerDictionary, this->Internal->MarkerDictionary, deviceConfig);
+  XML_READ_ENUM2_ATTRIBUTE_NONMEMBER_OPTIONAL(DetectionMode, this->Internal->DetectionMode, deviceConfig, "FULL_FRAME", DETECTION_FULL_FRAME, "ROI_TRACKING", DETECTION_ROI_TRACKING);
+  XML_READ_SCALAR_ATTRIBUTE_NONMEMBER_OPTIONAL(int, FullFrameDetectionInterval, this->Internal->FullFrameDetectionInterval, deviceConfig);
+  XML_READ_SCALAR_ATTRIBUTE_NONMEMBER_OPTIONAL(double, RoiMarginFactor, this->Internal->RoiMarginFactor, deviceConfig);
+  XML_READ_SCALAR_ATTRIBUTE_NONMEMBER_OPTIONAL(double, DetectionScale, this->Internal->DetectionScale, deviceConfig);
+  if (this->Internal->DetectionScale <= 0 || this->Internal->DetectionScale > 1)
+  {
+    LOG_WARNING("DetectionScale must be in the range (0, 1], using 1 instead of " << this->Internal->DetectionScale);
+    this->Internal->DetectionScale = 1.0;
+  }
+
+  this->Internal->Cameras.clear();
+  for (int nestedElementIndex = 0; nestedElementIndex < deviceConfig->GetNumberOfNestedElements(); nestedElementIndex++)
+  {
+    vtkXMLDataElement* cameraElement = deviceConfig->GetNestedElement(nestedElementIndex);
+    if (STRCASECMP(cameraElement->GetName(), "Camera") != 0)
+    {
+      continue;
+    }
+    TrackedCamera camera;
+    XML_READ_STRING_ATTRIBUTE_NONMEMBER_REQUIRED(InputChannelId, camera.InputChannelId, cameraElement);
+    camera.CameraCalibrationFile = this->Internal->CameraCalibrationFile;
+    XML_READ_STRING_ATTRIBUTE_NONMEMBER_OPTIONAL(CameraCalibrationFile, camera.CameraCalibrationFile, cameraElement);
+    double cameraToTracker[16] = { 0 };
+    if (cameraElement->GetVectorAttribute("CameraToTrackerTransform", 16, cameraToTracker))
+    {
+      camera.CameraToTracker->DeepCopy(cameraToTracker);
+    }
+    this->Internal->Cameras.push_back(camera);
+  }
+  if (this->Internal->Cameras.empty())
+  {
+    TrackedCamera camera;
+    camera.CameraCalibrationFile = this->Internal->CameraCalibrationFile;
+    this->Internal->Cameras.push_back(camera);
+  }
+  for (std::vector<TrackedCamera>::const_iterator cameraIt = begin(this->Internal->Cameras); cameraIt != end(this->Internal->Cameras); ++cameraIt)
+  {
+    if (cameraIt->CameraCalibrationFile.empty())
+    {
+      LOG_ERROR("CameraCalibrationFile is not defined for camera " << (cameraIt->InputChannelId.empty() ? "of the input channel" : cameraIt->InputChannelId) << ". Device ID: " << this->GetDeviceId());
+      return PLUS_FAIL;
+    }
+  }
 
   XML_FIND_NESTED_ELEMENT_REQUIRED(dataSourcesElement, deviceConfig, "DataSources");
   for (int nestedElementIndex = 0; nestedElementIndex < dataSourcesElement->GetNumberOfNestedElements(); nestedElementIndex++)
@@ -216,6 +350,43 @@ PlusStatus vtkPlusOpticalMarkerTracker::WriteConfiguration(vtkXMLDataElement* ro
       return PLUS_FAIL;
   }
 
+  deviceConfig->SetAttribute("DetectionMode", this->Internal->DetectionMode == DETECTION_ROI_TRACKING ? "ROI_TRACKING" : "FULL_FRAME");
+  deviceConfig->SetIntAttribute("FullFrameDetectionInterval", this->Internal->FullFrameDetectionInterval);
+  deviceConfig->SetDoubleAttribute("RoiMarginFactor", this->Internal->RoiMarginFactor);
+  deviceConfig->SetDoubleAttribute("DetectionScale", this->Internal->DetectionScale);
+
+  for (std::vector<TrackedCamera>::const_iterator cameraIt = begin(this->Internal->Cameras); cameraIt != end(this->Internal->Cameras); ++cameraIt)
+  {
+    if (cameraIt->InputChannelId.empty())
+    {
+      // single camera, defined by the device attributes
+      continue;
+    }
+    vtkXMLDataElement* cameraElement = NULL;
+    for (int nestedElementIndex = 0; nestedElementIndex < deviceConfig->GetNumberOfNestedElements(); nestedElementIndex++)
+    {
+      vtkXMLDataElement* nestedElement = deviceConfig->GetNestedElement(nestedElementIndex);
+      if (STRCASECMP(nestedElement->GetName(), "Camera") == 0 && nestedElement->GetAttribute("InputChannelId") != NULL
+          && cameraIt->InputChannelId == nestedElement->GetAttribute("InputChannelId"))
+      {
+        cameraElement = nestedElement;
+        break;
+      }
+    }
+    if (cameraElement == NULL)
+    {
+      vtkSmartPointer<vtkXMLDataElement> newCameraElement = vtkSmartPointer<vtkXMLDataElement>::New();
+      newCameraElement->SetName("Camera");
+      newCameraElement->SetAttribute("InputChannelId", cameraIt->InputChannelId.c_str());
+      deviceConfig->AddNestedElement(newCameraElement);
+      cameraElement = newCameraElement;
+    }
+    cameraElement->SetAttribute("CameraCalibrationFile", cameraIt->CameraCalibrationFile.c_str());
+    double cameraToTracker[16] = { 0 };
+    vtkMatrix4x4::DeepCopy(cameraToTracker, cameraIt->CameraToTracker);
+    cameraElement->SetVectorAttribute("CameraToTrackerTransform", 16, cameraToTracker);
+  }
+
   //TODO: Write data for custom attributes
 
   return PLUS_SUCCESS;
@@ -230,25 +401,39 @@ PlusStatus vtkPlusOpticalMarkerTracker::Probe()
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusOpticalMarkerTracker::InternalConnect()
 {
-  // get calibration file path && check file exists
-  std::string calibFilePath = vtkPlusConfig::GetInstance()->GetDeviceSetConfigurationPath(this->Internal->CameraCalibrationFile);
-  LOG_INFO("Use aruco camera calibration file located at: " << calibFilePath);
-  if (!vtksys::SystemTools::FileExists(calibFilePath.c_str(), true))
+  for (std::vector<TrackedCamera>::iterator cameraIt = begin(this->Internal->Cameras); cameraIt != end(this->Internal->Cameras); ++cameraIt)
   {
-    LOG_ERROR("Unable to find aruco camera calibration file at: " << calibFilePath);
-    return PLUS_FAIL;
+    cameraIt->InputChannel = nullptr;
+    if (cameraIt->InputChannelId.empty())
+    {
+      if (this->InputChannels.size() != 1)
+      {
+        LOG_ERROR("OpticalMarkerTracker device requires exactly 1 input stream (that contains video data) or a Camera element for each input stream. Check configuration.");
+        return PLUS_FAIL;
+      }
+      cameraIt->InputChannel = this->InputChannels[0];
+    }
+    else
+    {
+      for (ChannelContainerConstIterator it = begin(this->InputChannels); it != end(this->InputChannels); ++it)
+      {
+        if (cameraIt->InputChannelId == (*it)->GetChannelId())
+        {
+          cameraIt->InputChannel = *it;
+        }
+      }
+      if (cameraIt->InputChannel == nullptr)
+      {
+        LOG_ERROR(this->GetDeviceId() << ": camera channel " << cameraIt->InputChannelId << " is not an input channel of the device");
+        return PLUS_FAIL;
+      }
+    }
+    if (this->Internal->InitializeCamera(*cameraIt) != PLUS_SUCCESS)
+    {
+      return PLUS_FAIL;
+    }
   }
 
-  // TODO: Need error handling for this?
-  this->Internal->CameraParameters->readFromXMLFile(calibFilePath);
-  this->Internal->MarkerDetector->setDictionary(this->Internal->MarkerDictionary);
-  // threshold tuning numbers from aruco_test
-  aruco::MarkerDetector::Params params;
-  params._thresParam1 = 7;
-  params._thresParam2 = 7;
-  params._thresParam1_range = 2;
-  this->Internal->MarkerDetector->setParams(params);
-
   bool lowestRateKnown = false;
   double lowestRate = 30; // just a usual value (FPS)
   for (ChannelContainerConstIterator it = begin(this->InputChannels); it != end(this->InputChannels); ++it)
@@ -269,7 +454,6 @@ PlusStatus vtkPlusOpticalMarkerTracker::InternalConnect()
     LOG_WARNING("vtkPlusOpticalMarkerTracker acquisition rate is not known");
   }
 
-  this->LastProcessedInputDataTimestamp = 0;
   return PLUS_SUCCESS;
 }
 
@@ -288,6 +472,61 @@ PlusStatus vtkPlusOpticalMarkerTracker::InternalStartRecording()
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusOpticalMarkerTracker::InternalStopRecording()
 {
+  LOG_INFO(this->GetDeviceId() << " marker detection latency:" << std::endl << this->GetCameraDetectionStatistics());
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+int vtkPlusOpticalMarkerTracker::GetNumberOfCameras() const
+{
+  return static_cast<int>(this->Internal->Cameras.size());
+}
+
+//----------------------------------------------------------------------------
+std::string vtkPlusOpticalMarkerTracker::GetCameraDetectionStatistics() const
+{
+  std::ostringstream statistics;
+  for (std::vector<TrackedCamera>::const_iterator cameraIt = begin(this->Internal->Cameras); cameraIt != end(this->Internal->Cameras); ++cameraIt)
+  {
+    std::string cameraName = cameraIt->InputChannelId;
+    if (cameraName.empty() && cameraIt->InputChannel != nullptr)
+    {
+      cameraName = cameraIt->InputChannel->GetChannelId();
+    }
+    statistics << (cameraIt == begin(this->Internal->Cameras) ? "" : "\n") << cameraName << ": " << cameraIt->DetectionLatency->GetStatisticsString();
+  }
+  return statistics.str();
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusOpticalMarkerTracker::vtkInternal::InitializeCamera(TrackedCamera& camera)
+{
+  // get calibration file path && check file exists
+  std::string calibFilePath = vtkPlusConfig::GetInstance()->GetDeviceSetConfigurationPath(camera.CameraCalibrationFile);
+  LOG_INFO("Use aruco camera calibration file located at: " << calibFilePath);
+  if (!vtksys::SystemTools::FileExists(calibFilePath.c_str(), true))
+  {
+    LOG_ERROR("Unable to find aruco camera calibration file at: " << calibFilePath);
+    return PLUS_FAIL;
+  }
+
+  // TODO: Need error handling for this?
+  camera.CameraParameters->readFromXMLFile(calibFilePath);
+  camera.MarkerDetector->setDictionary(this->MarkerDictionary);
+  // threshold tuning numbers from aruco_test
+  aruco::MarkerDetector::Params params;
+  params._thresParam1 = 7;
+  params._thresParam2 = 7;
+  params._thresParam1_range = 2;
+  camera.MarkerDetector->setParams(params);
+
+  camera.Markers.clear();
+  camera.FramesSinceFullFrameDetection = 0;
+  camera.LastProcessedInputDataTimestamp = 0;
+  camera.MarkerPoseTrackers.assign(this->Tools.size(), aruco::MarkerPoseTracker());
+  camera.ToolObservations.clear();
+  camera.ToolObservations.resize(this->Tools.size());
+  camera.DetectionLatency->Reset();
   return PLUS_SUCCESS;
 }
 
@@ -318,45 +557,168 @@ PlusStatus vtkPlusOpticalMarkerTracker::vtkInternal::BuildTransformMatrix(vtkSma
 }
 
 //----------------------------------------------------------------------------
-PlusStatus vtkPlusOpticalMarkerTracker::InternalUpdate()
+void vtkPlusOpticalMarkerTracker::vtkInternal::DetectMarkers(TrackedCamera& camera, const cv::Mat& image)
 {
-  if (this->InputChannels.size() != 1)
+  if (this->DetectionMode == DETECTION_ROI_TRACKING
+      && !camera.Markers.empty()
+      && camera.FramesSinceFullFrameDetection < this->FullFrameDetectionInterval)
   {
-    LOG_ERROR("ImageProcessor device requires exactly 1 input stream (that contains video data). Check configuration.");
-    return PLUS_FAIL;
+    if (this->DetectMarkersInRois(camera, image))
+    {
+      camera.FramesSinceFullFrameDetection++;
+      return;
+    }
+    // a marker has been lost, search the whole frame
+  }
+  this->DetectMarkersInFullFrame(camera, image);
+  camera.FramesSinceFullFrameDetection = 0;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusOpticalMarkerTracker::vtkInternal::DetectMarkersInFullFrame(TrackedCamera& camera, const cv::Mat& image)
+{
+  if (this->DetectionScale >= 1.0)
+  {
+    camera.MarkerDetector->detect(image, camera.Markers);
+    return;
+  }
+
+  cv::resize(image, camera.DownsampledImage, cv::Size(), this->DetectionScale, this->DetectionScale, cv::INTER_AREA);
+  camera.MarkerDetector->detect(camera.DownsampledImage, camera.Markers);
+  const float inverseScale = static_cast<float>(1.0 / this->DetectionScale);
+  for (std::vector<aruco::Marker>::iterator markerIt = begin(camera.Markers); markerIt != end(camera.Markers); ++markerIt)
+  {
+    for (std::vector<cv::Point2f>::iterator cornerIt = markerIt->begin(); cornerIt != markerIt->end(); ++cornerIt)
+    {
+      *cornerIt *= inverseScale;
+    }
+  }
+  this->RefineMarkerCorners(camera, image, camera.Markers);
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusOpticalMarkerTracker::vtkInternal::DetectMarkersInRois(TrackedCamera& camera, const cv::Mat& image)
+{
+  const cv::Rect imageRect(0, 0, image.cols, image.rows);
+  std::vector<aruco::Marker> previousMarkers;
+  previousMarkers.swap(camera.Markers);
+  camera.Markers.clear();
+  for (std::vector<aruco::Marker>::const_iterator previousMarkerIt = begin(previousMarkers); previousMarkerIt != end(previousMarkers); ++previousMarkerIt)
+  {
+    // the marker may have been found already in the search region of another marker
+    bool alreadyFound = false;
+    for (std::vector<aruco::Marker>::const_iterator markerIt = begin(camera.Markers); markerIt != end(camera.Markers); ++markerIt)
+    {
+      alreadyFound |= (markerIt->id == previousMarkerIt->id);
+    }
+    if (alreadyFound)
+    {
+      continue;
+    }
+
+    // search region: bounding box of the previous position, extended by a margin proportional to the marker size
+    cv::Rect markerRect = cv::boundingRect(static_cast<const std::vector<cv::Point2f>&>(*previousMarkerIt));
+    const int margin = static_cast<int>(this->RoiMarginFactor * std::max(markerRect.width, markerRect.height));
+    cv::Rect roi = cv::Rect(markerRect.x - margin, markerRect.y - margin, markerRect.width + 2 * margin, markerRect.height + 2 * margin) & imageRect;
+    if (roi.area() == 0)
+    {
+      return false;
+    }
+
+    camera.MarkerDetector->detect(image(roi), camera.RoiMarkers);
+    bool markerFound = false;
+    for (std::vector<aruco::Marker>::iterator roiMarkerIt = begin(camera.RoiMarkers); roiMarkerIt != end(camera.RoiMarkers); ++roiMarkerIt)
+    {
+      bool duplicate = false;
+      for (std::vector<aruco::Marker>::const_iterator markerIt = begin(camera.Markers); markerIt != end(camera.Markers); ++markerIt)
+      {
+        duplicate |= (markerIt->id == roiMarkerIt->id);
+      }
+      if (duplicate)
+      {
+        continue;
+      }
+      // convert the corners to full image coordinates
+      for (std::vector<cv::Point2f>::iterator cornerIt = roiMarkerIt->begin(); cornerIt != roiMarkerIt->end(); ++cornerIt)
+      {
+        cornerIt->x += roi.x;
+        cornerIt->y += roi.y;
+      }
+      markerFound |= (roiMarkerIt->id == previousMarkerIt->id);
+      camera.Markers.push_back(*roiMarkerIt);
+    }
+    if (!markerFound)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusOpticalMarkerTracker::vtkInternal::RefineMarkerCorners(TrackedCamera& camera, const cv::Mat& image, std::vector<aruco::Marker>& markers)
+{
+  if (markers.empty())
+  {
+    return;
+  }
+  if (image.channels() == 3)
+  {
+    cv::cvtColor(image, camera.GrayImage, cv::COLOR_BGR2GRAY);
+  }
+  else
+  {
+    camera.GrayImage = image;
+  }
+  // the corners found on the downsampled image are accurate to about one downsampled pixel
+  const int windowHalfSize = std::max(2, static_cast<int>(std::ceil(1.0 / this->DetectionScale)));
+  for (std::vector<aruco::Marker>::iterator markerIt = begin(markers); markerIt != end(markers); ++markerIt)
+  {
+    cv::cornerSubPix(camera.GrayImage, static_cast<std::vector<cv::Point2f>&>(*markerIt), cv::Size(windowHalfSize, windowHalfSize), cv::Size(-1, -1),
+                     cv::TermCriteria(cv::TermCriteria::MAX_ITER | cv::TermCriteria::EPS, 12, 0.005));
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusOpticalMarkerTracker::vtkInternal::ProcessCamera(TrackedCamera& camera)
+{
+  for (std::vector<ToolObservation>::iterator observationIt = begin(camera.ToolObservations); observationIt != end(camera.ToolObservations); ++observationIt)
+  {
+    observationIt->Valid = false;
   }
 
   // Get image to tracker transform from the tracker (only request 1 frame, the latest)
-  if (!this->InputChannels[0]->GetVideoDataAvailable())
+  if (!camera.InputChannel->GetVideoDataAvailable())
   {
-    LOG_TRACE("Processed data is not generated, as no video data is available yet. Device ID: " << this->GetDeviceId());
+    LOG_TRACE("Processed data is not generated, as no video data is available yet. Channel ID: " << camera.InputChannel->GetChannelId());
     return PLUS_SUCCESS;
   }
 
   double oldestTrackingTimestamp(0);
-  if (this->InputChannels[0]->GetOldestTimestamp(oldestTrackingTimestamp) == PLUS_SUCCESS)
+  if (camera.InputChannel->GetOldestTimestamp(oldestTrackingTimestamp) == PLUS_SUCCESS)
   {
-    if (this->LastProcessedInputDataTimestamp > oldestTrackingTimestamp)
+    if (camera.LastProcessedInputDataTimestamp > oldestTrackingTimestamp)
     {
-      LOG_INFO("Processed image generation started. No tracking data was available between " << this->LastProcessedInputDataTimestamp << "-" << oldestTrackingTimestamp <<
+      LOG_INFO("Processed image generation started. No tracking data was available between " << camera.LastProcessedInputDataTimestamp << "-" << oldestTrackingTimestamp <<
                "sec, therefore no processed images were generated during this time period.");
-      this->LastProcessedInputDataTimestamp = oldestTrackingTimestamp;
+      camera.LastProcessedInputDataTimestamp = oldestTrackingTimestamp;
     }
   }
 
-  igsioTrackedFrame trackedFrame;
-  if (this->InputChannels[0]->GetTrackedFrame(trackedFrame) != PLUS_SUCCESS)
+  const double detectionStartTime = vtkIGSIOAccurateTimer::GetSystemTime();
+  if (camera.InputChannel->GetTrackedFrame(camera.TrackedFrame) != PLUS_SUCCESS)
   {
-    LOG_ERROR("Error while getting latest tracked frame. Last recorded timestamp: " << std::fixed << this->LastProcessedInputDataTimestamp << ". Device ID: " << this->GetDeviceId());
-    this->LastProcessedInputDataTimestamp = vtkIGSIOAccurateTimer::GetSystemTime(); // forget about the past, try to add frames that are acquired from now on
+    LOG_ERROR("Error while getting latest tracked frame. Last recorded timestamp: " << std::fixed << camera.LastProcessedInputDataTimestamp << ". Channel ID: " << camera.InputChannel->GetChannelId());
+    camera.LastProcessedInputDataTimestamp = vtkIGSIOAccurateTimer::GetSystemTime(); // forget about the past, try to add frames that are acquired from now on
     return PLUS_FAIL;
   }
+  camera.LastProcessedInputDataTimestamp = camera.TrackedFrame.GetTimestamp();
 
-  LOG_TRACE("Image to be processed: timestamp=" << trackedFrame.GetTimestamp());
+  LOG_TRACE("Image to be processed: timestamp=" << camera.TrackedFrame.GetTimestamp());
 
   // get dimensions & data
-  FrameSizeType dim = trackedFrame.GetFrameSize();
-  igsioVideoFrame* frame = trackedFrame.GetImageData();
+  FrameSizeType dim = camera.TrackedFrame.GetFrameSize();
+  igsioVideoFrame* frame = camera.TrackedFrame.GetImageData();
 
   // converting trackedFrame (vtkImageData) to cv::Mat
   cv::Mat image(dim[1], dim[0], CV_8UC3, cv::Scalar(0, 0, 255));
@@ -366,45 +728,97 @@ PlusStatus vtkPlusOpticalMarkerTracker::InternalUpdate()
   image.data = (unsigned char*)frame->GetScalarPointer();
 
   // detect markers in frame
-  this->Internal->MarkerDetector->detect(image, this->Internal->Markers);
+  this->DetectMarkers(camera, image);
 
-  // iterate through tools updating tracking
-  for (std::vector<TrackedTool>::iterator toolIt = begin(this->Internal->Tools); toolIt != end(this->Internal->Tools); ++toolIt)
+  // estimate the pose of the tools that are visible
+  for (std::vector<TrackedTool>::size_type toolIndex = 0; toolIndex < this->Tools.size(); ++toolIndex)
   {
-    bool toolInFrame = false;
-    const double unfilteredTimestamp = vtkIGSIOAccurateTimer::GetSystemTime();
-    for (std::vector<aruco::Marker>::iterator markerIt = begin(this->Internal->Markers); markerIt != end(this->Internal->Markers); ++markerIt)
+    const TrackedTool& tool = this->Tools[toolIndex];
+    for (std::vector<aruco::Marker>::iterator markerIt = begin(camera.Markers); markerIt != end(camera.Markers); ++markerIt)
     {
-      if (toolIt->MarkerId == markerIt->id)
+      if (tool.MarkerId != markerIt->id)
       {
-        //marker is in frame
-        toolInFrame = true;
-
-        if (toolIt->MarkerPoseTracker.estimatePose(*markerIt, *this->Internal->CameraParameters, toolIt->MarkerSizeMm / MM_PER_M, 4))
-        {
-          // pose successfully estimated, update transform
-          cv::Mat Rvec = toolIt->MarkerPoseTracker.getRvec();
-          cv::Mat Tvec = toolIt->MarkerPoseTracker.getTvec();
-          this->Internal->BuildTransformMatrix(toolIt->transformMatrix, Rvec, Tvec);
-          ToolTimeStampedUpdate(toolIt->ToolSourceId, toolIt->transformMatrix, TOOL_OK, this->FrameNumber, unfilteredTimestamp);
-        }
-        else
+        continue;
+      }
+      //marker is in frame
+      aruco::MarkerPoseTracker& poseTracker = camera.MarkerPoseTrackers[toolIndex];
+      if (poseTracker.estimatePose(*markerIt, *camera.CameraParameters, tool.MarkerSizeMm / MM_PER_M, 4))
+      {
+        // pose successfully estimated
+        ToolObservation& observation = camera.ToolObservations[toolIndex];
+        if (this->BuildTransformMatrix(observation.MarkerToCamera, poseTracker.getRvec(), poseTracker.getTvec()) == PLUS_SUCCESS)
         {
-          // pose estimation failed
-          // TODO: add frame num, marker id, etc. Make this error more helpful.  Is there a way to handle it?
-          LOG_ERROR("Pose estimation failed. Tool " << toolIt->ToolSourceId << " with marker " << toolIt->MarkerId << ".");
+          observation.MarkerAreaPixels = markerIt->getArea();
+          observation.Valid = true;
         }
-        break;
+      }
+      else
+      {
+        // pose estimation failed
+        // TODO: add frame num, marker id, etc. Make this error more helpful.  Is there a way to handle it?
+        LOG_ERROR("Pose estimation failed. Tool " << tool.ToolSourceId << " with marker " << tool.MarkerId << ".");
+      }
+      break;
+    }
+  }
+
+  camera.DetectionLatency->AddSample(vtkIGSIOAccurateTimer::GetSystemTime() - detectionStartTime);
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusOpticalMarkerTracker::InternalUpdate()
+{
+  std::vector<TrackedCamera>& cameras = this->Internal->Cameras;
+  if (cameras.empty() || cameras[0].InputChannel == nullptr)
+  {
+    LOG_ERROR("OpticalMarkerTracker device has no input stream (that contains video data). Check configuration.");
+    return PLUS_FAIL;
+  }
+
+  // detect the markers in the images of all cameras in parallel
+  std::vector<PlusStatus> cameraStatus(cameras.size(), PLUS_SUCCESS);
+  const int numberOfCameras = static_cast<int>(cameras.size());
+  PlusWorkerPool::GetInstance().ParallelFor(0, numberOfCameras, numberOfCameras, [this, &cameras, &cameraStatus](int firstCameraIndex, int lastCameraIndex)
+  {
+    for (int cameraIndex = firstCameraIndex; cameraIndex < lastCameraIndex; ++cameraIndex)
+    {
+      cameraStatus[cameraIndex] = this->Internal->ProcessCamera(cameras[cameraIndex]);
+    }
+  });
+
+  // fuse the poses: each tool is reported from the camera that sees its marker at the largest size in the image
+  const double unfilteredTimestamp = vtkIGSIOAccurateTimer::GetSystemTime();
+  for (std::vector<TrackedTool>::size_type toolIndex = 0; toolIndex < this->Internal->Tools.size(); ++toolIndex)
+  {
+    TrackedTool& tool = this->Internal->Tools[toolIndex];
+    const TrackedCamera* bestCamera = nullptr;
+    for (std::vector<TrackedCamera>::const_iterator cameraIt = begin(cameras); cameraIt != end(cameras); ++cameraIt)
+    {
+      const ToolObservation& observation = cameraIt->ToolObservations[toolIndex];
+      if (observation.Valid && (bestCamera == nullptr || observation.MarkerAreaPixels > bestCamera->ToolObservations[toolIndex].MarkerAreaPixels))
+      {
+        bestCamera = &(*cameraIt);
       }
     }
-    if (!toolInFrame)
+    if (bestCamera == nullptr)
     {
       // tool not in frame
-      ToolTimeStampedUpdate(toolIt->ToolSourceId, toolIt->transformMatrix, TOOL_OUT_OF_VIEW, this->FrameNumber, unfilteredTimestamp);
+      ToolTimeStampedUpdate(tool.ToolSourceId, tool.transformMatrix, TOOL_OUT_OF_VIEW, this->FrameNumber, unfilteredTimestamp);
+      continue;
     }
+    vtkMatrix4x4::Multiply4x4(bestCamera->CameraToTracker, bestCamera->ToolObservations[toolIndex].MarkerToCamera, tool.transformMatrix);
+    ToolTimeStampedUpdate(tool.ToolSourceId, tool.transformMatrix, TOOL_OK, this->FrameNumber, unfilteredTimestamp);
   }
 
   this->FrameNumber++;
 
+  for (std::vector<PlusStatus>::const_iterator statusIt = begin(cameraStatus); statusIt != end(cameraStatus); ++statusIt)
+  {
+    if (*statusIt != PLUS_SUCCESS)
+    {
+      return PLUS_FAIL;
+    }
+  }
   return PLUS_SUCCESS;
-}
\ No newline at end of file
+}
@@ -14,6 +14,9 @@ See License.txt for details.
 /*!
   \class vtkPlusOpticalMarkerTracker
   \brief Virtual device that tracks fiducial markers on the input channel in real time.
+
+  If multiple cameras are defined then the markers are detected in the images of all cameras in parallel
+  and each tool pose is reported from the camera that has the best view of its marker.
   \ingroup PlusLibDataCollection
 */
 class vtkPlusDataCollectionExport vtkPlusOpticalMarkerTracker : public vtkPlusDevice
@@ -26,6 +29,13 @@ public:
     TRACKING_OPTICAL_AND_DEPTH
   };
 
+  /*! Defines where the markers are searched for in each frame. */
+  enum DETECTION_MODE
+  {
+    DETECTION_FULL_FRAME, /*!< markers are detected in the whole frame */
+    DETECTION_ROI_TRACKING /*!< markers are searched around their last known position, the whole frame is searched periodically or if a marker is lost */
+  };
+
   static vtkPlusOpticalMarkerTracker* New();
   vtkTypeMacro(vtkPlusOpticalMarkerTracker, vtkPlusDevice);
   virtual void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
@@ -54,6 +64,12 @@ public:
   virtual bool IsTracker() const { return true; }
   virtual bool IsVirtual() const { return true; }
 
+  /*! Number of cameras (input channels) that the markers are detected in */
+  int GetNumberOfCameras() const;
+
+  /*! Marker detection latency statistics, one line for each camera */
+  std::string GetCameraDetectionStatistics() const;
+
 protected:
   vtkPlusOpticalMarkerTracker();
   ~vtkPlusOpticalMarkerTracker();
@@ -68,7 +84,6 @@ protected:
   vtkInternal* Internal;
 
   unsigned int FrameNumber;
-  double LastProcessedInputDataTimestamp;
 
 private:
   vtkPlusOpticalMarkerTracker(const vtkPlusOpticalMarkerTracker&);
@@ -18,11 +18,13 @@ See License.txt for details.
 #include "vtkXMLDataElement.h"
 #include "vtksys/SystemTools.hxx"
 
+#include <algorithm>
 #include <math.h>
 #include <sstream>
 #include <stdio.h>
 #include <conio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <Smart32Interface.h>
 
@@ -49,6 +51,10 @@ vtkPlusOptimetConoProbeMeasurer::vtkPlusOptimetConoProbeMeasurer()
   this->FineLaserPower = 0;
   this->ProbeDialogOpen = false;
   this->LaserPower = 0;
+  this->BatchedAcquisition = false;
+  this->DecimationFactor = 1;
+  this->MeasurementCounter = 0;
+  memset(&this->AccumulatedMeasurements, 0, sizeof(this->AccumulatedMeasurements));
 
   // Thread
   this->Thread = vtkMultiThreader::New();
@@ -112,6 +118,9 @@ PlusStatus vtkPlusOptimetConoProbeMeasurer::InternalConnect()
   this->MeasurementTool = NULL;
  GetToolByPortName("Measurement", this->MeasurementTool);
 
+  this->MeasurementCounter = 0;
+  memset(&this->AccumulatedMeasurements, 0, sizeof(this->AccumulatedMeasurements));
+
  LOG_DEBUG("Successfully connected to ConoProbe device");
  return PLUS_SUCCESS;
 }
@@ -134,6 +143,11 @@ PlusStatus vtkPlusOptimetConoProbeMeasurer::InternalUpdate()
 {     
   LOG_TRACE( "vtkPlusOptimetConoProbeMeasurer::InternalUpdate" ); 
   
+  if (this->MeasurementTool != NULL && this->BatchedAcquisition && !this->ProbeDialogOpen)
+  {
+    return this->AcquireMeasurementBatch();
+  }
+
   if (this->MeasurementTool != NULL)
   {
 	vtkSmartPointer<vtkTransform> measurementToMeasurerTransform = vtkSmartPointer<vtkTransform>::New();
@@ -196,6 +210,99 @@ PlusStatus vtkPlusOptimetConoProbeMeasurer::InternalUpdate()
   return PLUS_SUCCESS;
 }
 
+//-------------------------------------------------------------------------
+PlusStatus vtkPlusOptimetConoProbeMeasurer::AcquireMeasurementBatch()
+{
+  // The probe measures at the measurement frequency, all the measurements of an update period are read
+  const double measurementFrequency = std::max(static_cast<double>(this->Frequency), 1.0);
+  const int numberOfMeasurements = std::max(1, static_cast<int>(ceil(measurementFrequency / this->AcquisitionRate)));
+
+  this->MeasurementSamples.clear();
+  this->ParameterSamples.clear();
+  PlusStatus status = PLUS_SUCCESS;
+  for (int i = 0; i < numberOfMeasurements; ++i)
+  {
+    Measurement measurement;
+    try
+    {
+      measurement = this->ConoProbe->GetSingleMeasurement();
+    }
+    catch (const SmartException& e)
+    {
+      // The samples that are already read are still recorded
+      LOG_ERROR(e.ErrorString());
+      status = PLUS_FAIL;
+      break;
+    }
+    catch (const SmartExceptionBadResponse& e)
+    {
+      LOG_WARNING(e.MessageType());
+      this->MeasurementCounter++;
+      continue;
+    }
+    const double unfilteredTimestamp = vtkIGSIOAccurateTimer::GetSystemTime();
+
+    // The measurements are taken at a fixed frequency, so the measurement counter is the clock of the device
+    MeasurementSum& sum = this->AccumulatedMeasurements;
+    sum.Distance += measurement.Distance;
+    sum.Snr += measurement.Snr;
+    sum.Total += measurement.Total;
+    sum.UnfilteredTimestamp += unfilteredTimestamp;
+    sum.DeviceTimeSec += static_cast<double>(this->MeasurementCounter++) / measurementFrequency;
+    sum.NumberOfMeasurements++;
+    if (sum.NumberOfMeasurements >= this->DecimationFactor)
+    {
+      this->AddAveragedSample();
+    }
+  }
+
+  // Each buffer is locked only once for all the samples of the update
+  igsioTransformName name("Measurement", this->GetToolReferenceFrameName());
+  if (this->ToolTimeStampedUpdateBatch(name.GetTransformName(), this->MeasurementSamples) != PLUS_SUCCESS)
+  {
+    status = PLUS_FAIL;
+  }
+  igsioTransformName parameters("Parameters", this->GetToolReferenceFrameName());
+  if (this->ToolTimeStampedUpdateBatch(parameters.GetTransformName(), this->ParameterSamples) != PLUS_SUCCESS)
+  {
+    status = PLUS_FAIL;
+  }
+  return status;
+}
+
+//-------------------------------------------------------------------------
+void vtkPlusOptimetConoProbeMeasurer::AddAveragedSample()
+{
+  MeasurementSum& sum = this->AccumulatedMeasurements;
+  const double n = sum.NumberOfMeasurements;
+  const double d = sum.Distance / n;
+  const double snr = sum.Snr / n / 10;
+  const double total = sum.Total / n;
+  const double unfilteredTimestamp = sum.UnfilteredTimestamp / n;
+  const double filteredTimestamp = this->GetDeviceClockTimestamp(sum.DeviceTimeSec / n, unfilteredTimestamp);
+  memset(&sum, 0, sizeof(sum));
+
+  // Same transforms as in the single measurement mode, see InternalUpdate
+  vtkPlusBuffer::ToolSample measurementSample;
+  const double measurementToMeasurer[16] = { 1.0, 0.0, 0.0, this->LensOriginAlignment[0] * d + this->LensOriginAlignment[3],
+                                             0.0, 1.0, 0.0, this->LensOriginAlignment[1] * d + this->LensOriginAlignment[4],
+                                             0.0, 0.0, 1.0, this->LensOriginAlignment[2] * d + this->LensOriginAlignment[5],
+                                             0.0, 0.0, 0.0, 1.0 };
+  std::copy(measurementToMeasurer, measurementToMeasurer + 16, measurementSample.Matrix);
+  measurementSample.Status = TOOL_OK;
+  measurementSample.UnfilteredTimestamp = unfilteredTimestamp;
+  measurementSample.FilteredTimestamp = filteredTimestamp;
+  this->MeasurementSamples.push_back(measurementSample);
+
+  vtkPlusBuffer::ToolSample parameterSample = measurementSample;
+  const double parametersToMeasurer[16] = { d, snr, total, 0.0,
+                                            static_cast<double>(this->Frequency), static_cast<double>(this->LaserPower), 0.0, 0.0,
+                                            0.0, 0.0, 0.0, 0.0,
+                                            0.0, 0.0, 0.0, 0.0 };
+  std::copy(parametersToMeasurer, parametersToMeasurer + 16, parameterSample.Matrix);
+  this->ParameterSamples.push_back(parameterSample);
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusOptimetConoProbeMeasurer::ReadConfiguration(vtkXMLDataElement* rootConfigElement)
 {
@@ -246,6 +353,14 @@ PlusStatus vtkPlusOptimetConoProbeMeasurer::ReadConfiguration(vtkXMLDataElement*
     }
   }
 
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(BatchedAcquisition, deviceConfig);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, DecimationFactor, deviceConfig);
+  if (this->DecimationFactor < 1)
+  {
+    LOG_ERROR("DecimationFactor must be at least 1");
+    return PLUS_FAIL;
+  }
+
   return PLUS_SUCCESS;
 }
 
@@ -258,6 +373,8 @@ PlusStatus vtkPlusOptimetConoProbeMeasurer::WriteConfiguration(vtkXMLDataElement
   deviceConfig->SetIntAttribute("Frequency", static_cast<unsigned int>(this->Frequency));
   deviceConfig->SetIntAttribute("CoarseLaserPower", static_cast<unsigned int>(this->CoarseLaserPower));
   deviceConfig->SetIntAttribute("FineLaserPower", static_cast<unsigned int>(this->FineLaserPower));
+  XML_WRITE_BOOL_ATTRIBUTE(BatchedAcquisition, deviceConfig);
+  deviceConfig->SetIntAttribute("DecimationFactor", this->DecimationFactor);
 
   return PLUS_SUCCESS;
 }
@@ -64,6 +64,18 @@ public:
   vtkSetMacro(LaserPower, UINT16);
   vtkSetMacro(Frequency, UINT16);
 
+  /*!
+    If enabled then all the measurements that the probe makes at the measurement Frequency during an update period are read
+    in one update and added to the tool buffers at once, instead of one measurement per update.
+  */
+  vtkSetMacro(BatchedAcquisition, bool);
+  vtkGetMacro(BatchedAcquisition, bool);
+  vtkBooleanMacro(BatchedAcquisition, bool);
+
+  /*! In batched acquisition mode the average of this many consecutive measurements is recorded as one sample */
+  vtkSetMacro(DecimationFactor, int);
+  vtkGetMacro(DecimationFactor, int);
+
 protected:
 
   vtkPlusOptimetConoProbeMeasurer();
@@ -82,6 +94,12 @@ private:  // Functions.
   /*! Opens the Probe Dialog. */
   static void* ProbeDialogThread(void* ptr);
 
+  /*! Read the measurements of an update period and add them to the tool buffers, see BatchedAcquisition */
+  PlusStatus AcquireMeasurementBatch();
+
+  /*! Add the average of the accumulated measurements to the batch of samples and start a new average */
+  void AddAveragedSample();
+
 private:  // Variables.
 
   vtkPlusDataSource* MeasurementTool;	
@@ -115,6 +133,31 @@ private:  // Variables.
 
   /*! ... */
   bool ProbeDialogOpen;
+
+  /*! Read all measurements of an update period in one update. */
+  bool BatchedAcquisition;
+
+  /*! Number of measurements averaged into one sample in batched acquisition mode. */
+  int DecimationFactor;
+
+  /*! Number of measurements since connect, the probe measures at a fixed frequency so this is the clock of the device. */
+  unsigned long long MeasurementCounter;
+
+  /*! Sum of the measurements that are averaged into the next sample. */
+  struct MeasurementSum
+  {
+    double Distance;
+    double Snr;
+    double Total;
+    double UnfilteredTimestamp;
+    double DeviceTimeSec;
+    int NumberOfMeasurements;
+  };
+  MeasurementSum AccumulatedMeasurements;
+
+  /*! Samples of the current update in batched acquisition mode. */
+  std::vector<vtkPlusBuffer::ToolSample> MeasurementSamples;
+  std::vector<vtkPlusBuffer::ToolSample> ParameterSamples;
 };
 
 #endif
\ No newline at end of file
@@ -15,11 +15,16 @@ Authors include:
 
 // Plus includes
 #include "PlusConfigure.h"
+#include "PlusWorkerPool.h"
 #include "vtkObjectFactory.h"
 #include "vtkPlusPhilips3DProbeVideoSource.h"
 #include "vtkPlusDataSource.h"
 
+// VTK includes
+#include <vtkImageData.h>
+
 // STL includes
+#include <algorithm>
 #include <future>
 
 // Philips API includes
@@ -42,7 +47,6 @@ vtkPlusPhilips3DProbeVideoSource* vtkPlusPhilips3DProbeVideoSource::ActiveDevice
 
 namespace
 {
-  vtkImageData* streamedImageData = NULL;
   static double LastValidTimestamp(0);
   static double LastRetryTime(0);
 
@@ -59,63 +63,24 @@ bool vtkPlusPhilips3DProbeVideoSource::StreamCallback(_int64 id, SClient3DArray*
     return false;
   }
 
-  int dimensions[3] = {ed->width_padded, ed->height_padded, ed->depth_padded};
-
   /*
   * This is way smaller than what Qlab reports. Perhaps the streaming volume
   * is way smaller than the recorded one:
   *
   * 112 x 48 x 112
   */
-  if (streamedImageData == NULL)
+  int dimensions[3] = {ed->width_padded, ed->height_padded, ed->depth_padded};
+  if (dimensions[0] <= 0 || dimensions[1] <= 0 || dimensions[2] <= 0)
   {
-    // let the calibration matrix handle the spacing and orientation of the volume in 3-space
-    double spacing[3] = {1.0, 1.0, 1.0};
-    double origin[3] = {0.0, 0.0, 0.0};
-
-    streamedImageData = vtkImageData::New();
-    streamedImageData->SetSpacing(spacing);
-    streamedImageData->SetExtent(0, dimensions[0] - 1, 0, dimensions[1] - 1, 0, dimensions[2] - 1);
-    streamedImageData->SetOrigin(origin);
-#if VTK_MAJOR_VERSION > 5
-    streamedImageData->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
-#else
-    streamedImageData->SetScalarTypeToUnsignedChar();
-    streamedImageData->SetNumberOfScalarComponents(1);
-    streamedImageData->AllocateScalars();
-#endif
-
-    vtkPlusDataSource* videoSource(NULL);
-    vtkPlusPhilips3DProbeVideoSource::ActiveDevice->GetFirstVideoSource(videoSource);
-    if (dimensions[0] < 0 || dimensions[1] < 0 || dimensions[2] < 0)
-    {
-      LOG_ERROR("Negative dimensions received from Philips ultrasound device.");
-      return false;
-    }
-    videoSource->SetInputFrameSize(static_cast<unsigned int>(dimensions[0]), static_cast<unsigned int>(dimensions[1]), static_cast<unsigned int>(dimensions[2]));
-    videoSource->SetPixelType(VTK_UNSIGNED_CHAR);
-    videoSource->SetNumberOfScalarComponents(1);
+    LOG_ERROR("Invalid dimensions received from Philips ultrasound device: " << dimensions[0] << "x" << dimensions[1] << "x" << dimensions[2]);
+    return false;
   }
-  else
-  {
-    int streamedDimensions[3] = {0, 0, 0};
-    streamedImageData->GetDimensions(streamedDimensions);
 
-    if (dimensions[0] != streamedDimensions[0] || dimensions[1] != streamedDimensions[1] || dimensions[2] != streamedDimensions[2])
-    {
-      LOG_ERROR("Dimensions of new frame do not match dimensions of previous frames. Cannot add frame to buffer.");
-      return false;
-    }
+  if (vtkPlusPhilips3DProbeVideoSource::ActiveDevice->CallbackAddFrame(ed->pData, dimensions) != PLUS_SUCCESS)
+  {
+    return false;
   }
 
-  size_t size = dimensions[0] * dimensions[1] * dimensions[2];
-  unsigned char* src = ed->pData;
-  unsigned char* dst = (unsigned char*)streamedImageData->GetScalarPointer();
-
-  memcpy((void*)dst, (void*)src, size);
-
-  vtkPlusPhilips3DProbeVideoSource::ActiveDevice->CallbackAddFrame(streamedImageData);
-
   LastValidTimestamp = vtkIGSIOAccurateTimer::GetSystemTime();
 
   return true;
@@ -140,6 +105,13 @@ vtkPlusPhilips3DProbeVideoSource::vtkPlusPhilips3DProbeVideoSource()
   , Set4PtFIR(true)
   , LatAndElevSmoothingIndex(4)
 {
+  this->VolumeRegionOfInterestOrigin.fill(0);
+  this->VolumeRegionOfInterestSize.fill(0);
+  this->VolumeDownsamplingFactor.fill(1);
+  this->InputVolumeDimensions.fill(0);
+  this->InputVolumeRegionOrigin.fill(0);
+  this->OutputVolumeDimensions.fill(0);
+
   this->StartThreadForInternalUpdates = true;
   this->AcquisitionRate = 10;
 
@@ -205,11 +177,9 @@ PlusStatus vtkPlusPhilips3DProbeVideoSource::InternalDisconnect()
 
   this->Listener->Disconnect();
 
-  if (streamedImageData != NULL)
-  {
-    streamedImageData->Delete();
-    streamedImageData = NULL;
-  }
+  // The volume format is determined again from the first volume after reconnecting
+  this->InputVolumeDimensions.fill(0);
+  this->OutputVolume = NULL;
 
   return PLUS_SUCCESS;
 }
@@ -274,6 +244,18 @@ PlusStatus vtkPlusPhilips3DProbeVideoSource::ReadConfiguration(vtkXMLDataElement
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(Set4PtFIR, deviceConfig);
   XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, LatAndElevSmoothingIndex, deviceConfig);
 
+  XML_READ_STD_ARRAY_ATTRIBUTE_OPTIONAL(int, 3, VolumeRegionOfInterestOrigin, deviceConfig);
+  XML_READ_STD_ARRAY_ATTRIBUTE_OPTIONAL(int, 3, VolumeRegionOfInterestSize, deviceConfig);
+  XML_READ_STD_ARRAY_ATTRIBUTE_OPTIONAL(int, 3, VolumeDownsamplingFactor, deviceConfig);
+  for (int i = 0; i < 3; ++i)
+  {
+    if (this->VolumeRegionOfInterestOrigin[i] < 0 || this->VolumeRegionOfInterestSize[i] < 0 || this->VolumeDownsamplingFactor[i] < 1)
+    {
+      LOG_ERROR("Invalid volume region of interest or downsampling factor. Origin and size must not be negative, the downsampling factor must be at least 1.");
+      return PLUS_FAIL;
+    }
+  }
+
   return PLUS_SUCCESS;
 }
 
@@ -294,6 +276,9 @@ PlusStatus vtkPlusPhilips3DProbeVideoSource::WriteConfiguration(vtkXMLDataElemen
   XML_WRITE_BOOL_ATTRIBUTE(Isotropic, deviceConfig);
   XML_WRITE_BOOL_ATTRIBUTE(QuantizeDim, deviceConfig);
   XML_WRITE_BOOL_ATTRIBUTE(Set4PtFIR, deviceConfig);
+  deviceConfig->SetVectorAttribute("VolumeRegionOfInterestOrigin", 3, this->VolumeRegionOfInterestOrigin.data());
+  deviceConfig->SetVectorAttribute("VolumeRegionOfInterestSize", 3, this->VolumeRegionOfInterestSize.data());
+  deviceConfig->SetVectorAttribute("VolumeDownsamplingFactor", 3, this->VolumeDownsamplingFactor.data());
   return PLUS_SUCCESS;
 }
 
@@ -338,55 +323,156 @@ bool vtkPlusPhilips3DProbeVideoSource::IsTracker() const
 }
 
 //----------------------------------------------------------------------------
-void vtkPlusPhilips3DProbeVideoSource::CallbackAddFrame(vtkImageData* imageData)
+PlusStatus vtkPlusPhilips3DProbeVideoSource::UpdateOutputVolumeFormat(const int dimensions[3])
 {
   vtkPlusDataSource* videoSource(NULL);
   if (this->GetFirstVideoSource(videoSource) != PLUS_SUCCESS)
   {
     LOG_ERROR("Unable to find video source. Cannot add new frame.");
-    return;
+    return PLUS_FAIL;
   }
 
-  std::future<void> addTask = std::async(std::launch::async, [ = ]()
+  for (int i = 0; i < 3; ++i)
   {
-    if (videoSource->AddItem(imageData, videoSource->GetInputImageOrientation(), US_IMG_BRIGHTNESS, this->FrameNumber) != PLUS_SUCCESS)
+    // Fit the region of interest into the received volume
+    this->InputVolumeRegionOrigin[i] = std::min(this->VolumeRegionOfInterestOrigin[i], dimensions[i] - 1);
+    int regionSize = dimensions[i] - this->InputVolumeRegionOrigin[i];
+    if (this->VolumeRegionOfInterestSize[i] > 0)
     {
-      LOG_ERROR("Unable to add item to buffer.");
-      return;
+      regionSize = std::min(regionSize, this->VolumeRegionOfInterestSize[i]);
     }
-  });
-  std::future<uint8_t> maxPixelTask = std::async(std::launch::async, [ = ]()
+    this->OutputVolumeDimensions[i] = (regionSize + this->VolumeDownsamplingFactor[i] - 1) / this->VolumeDownsamplingFactor[i];
+    this->InputVolumeDimensions[i] = dimensions[i];
+  }
+  LOG_INFO("Philips iE33: received volume size is " << dimensions[0] << "x" << dimensions[1] << "x" << dimensions[2]
+           << ", output volume size is " << this->OutputVolumeDimensions[0] << "x" << this->OutputVolumeDimensions[1] << "x" << this->OutputVolumeDimensions[2]);
+
+  videoSource->SetPixelType(VTK_UNSIGNED_CHAR);
+  videoSource->SetNumberOfScalarComponents(1);
+  if (videoSource->SetInputFrameSize(this->OutputVolumeDimensions[0], this->OutputVolumeDimensions[1], this->OutputVolumeDimensions[2]) != PLUS_SUCCESS)
   {
-    int extent[6];
-    imageData->GetExtent(extent);
-    uint8_t* pixelPtr = (uint8_t*)imageData->GetScalarPointer();
-    auto numComponents = imageData->GetNumberOfScalarComponents();
+    return PLUS_FAIL;
+  }
+
+  // let the calibration matrix handle the spacing and orientation of the volume in 3-space
+  this->OutputVolume = vtkSmartPointer<vtkImageData>::New();
+  this->OutputVolume->SetSpacing(1.0, 1.0, 1.0);
+  this->OutputVolume->SetOrigin(0.0, 0.0, 0.0);
+  this->OutputVolume->SetExtent(0, this->OutputVolumeDimensions[0] - 1, 0, this->OutputVolumeDimensions[1] - 1, 0, this->OutputVolumeDimensions[2] - 1);
+  this->OutputVolume->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
 
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+unsigned int vtkPlusPhilips3DProbeVideoSource::CopyVolumeRegion(const unsigned char* volume, unsigned char* outputVolume)
+{
+  const std::array<int, 3> inputDimensions = this->InputVolumeDimensions;
+  const std::array<int, 3> regionOrigin = this->InputVolumeRegionOrigin;
+  const std::array<int, 3> step = this->VolumeDownsamplingFactor;
+  const std::array<int, 3> outputDimensions = this->OutputVolumeDimensions;
+  const size_t inputSliceSize = static_cast<size_t>(inputDimensions[0]) * inputDimensions[1];
+  const size_t outputSliceSize = static_cast<size_t>(outputDimensions[0]) * outputDimensions[1];
+
+  // Groups of output slices are copied concurrently, each task returns the maximum pixel value of its slices
+  auto copySlices = [ = ](int firstSlice, int lastSlice)
+  {
     uint8_t maxPixelValue(0);
-    for (int z = 0; z < extent[5] - extent[4]; ++z)
+    for (int z = firstSlice; z < lastSlice; ++z)
     {
-      for (int y = 0; y < extent[3] - extent[2]; ++y)
+      const unsigned char* inputSlice = volume + static_cast<size_t>(regionOrigin[2] + z * step[2]) * inputSliceSize;
+      unsigned char* outputRow = outputVolume + static_cast<size_t>(z) * outputSliceSize;
+      for (int y = 0; y < outputDimensions[1]; ++y)
       {
-        for (int x = 0; x < extent[1] - extent[0]; ++x)
+        const unsigned char* inputRow = inputSlice + static_cast<size_t>(regionOrigin[1] + y * step[1]) * inputDimensions[0] + regionOrigin[0];
+        if (step[0] == 1)
         {
-          if (*pixelPtr > maxPixelValue)
+          memcpy(outputRow, inputRow, outputDimensions[0]);
+        }
+        else
+        {
+          for (int x = 0; x < outputDimensions[0]; ++x)
           {
-            maxPixelValue = *pixelPtr;
+            outputRow[x] = inputRow[x * step[0]];
           }
-          pixelPtr += numComponents;
         }
+        maxPixelValue = std::max(maxPixelValue, *std::max_element(outputRow, outputRow + outputDimensions[0]));
+        outputRow += outputDimensions[0];
       }
     }
-
     return maxPixelValue;
-  });
+  };
 
-  addTask.wait();
-  unsigned int maxPixelValue = static_cast<unsigned int>(maxPixelTask.get());
+  PlusWorkerPool& workerPool = PlusWorkerPool::GetInstance();
+  const int numberOfTasks = std::max(1, std::min(outputDimensions[2], workerPool.GetNumberOfThreads() + 1));
+  const int slicesPerTask = (outputDimensions[2] + numberOfTasks - 1) / numberOfTasks;
+  std::vector<std::future<uint8_t> > tasks;
+  for (int firstSlice = slicesPerTask; firstSlice < outputDimensions[2]; firstSlice += slicesPerTask)
+  {
+    const int lastSlice = std::min(firstSlice + slicesPerTask, outputDimensions[2]);
+    tasks.push_back(workerPool.Submit([ = ]() { return copySlices(firstSlice, lastSlice); }));
+  }
+  // The calling thread copies the first group of slices
+  uint8_t maxPixelValue = copySlices(0, std::min(slicesPerTask, outputDimensions[2]));
+  for (std::vector<std::future<uint8_t> >::iterator it = tasks.begin(); it != tasks.end(); ++it)
+  {
+    workerPool.Wait(*it);
+    maxPixelValue = std::max(maxPixelValue, it->get());
+  }
+  return static_cast<unsigned int>(maxPixelValue);
+}
 
-  std::stringstream ss;
-  ss << maxPixelValue;
-  videoSource->ModifyBufferItemFrameField(videoSource->GetLatestItemUidInBuffer(), "MaximumPixelValue", ss.str());
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusPhilips3DProbeVideoSource::CallbackAddFrame(const unsigned char* volume, const int dimensions[3])
+{
+  vtkPlusDataSource* videoSource(NULL);
+  if (this->GetFirstVideoSource(videoSource) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to find video source. Cannot add new frame.");
+    return PLUS_FAIL;
+  }
 
+  if (this->InputVolumeDimensions[0] == 0)
+  {
+    if (this->UpdateOutputVolumeFormat(dimensions) != PLUS_SUCCESS)
+    {
+      return PLUS_FAIL;
+    }
+  }
+  else if (dimensions[0] != this->InputVolumeDimensions[0] || dimensions[1] != this->InputVolumeDimensions[1] || dimensions[2] != this->InputVolumeDimensions[2])
+  {
+    LOG_ERROR("Dimensions of new frame do not match dimensions of previous frames. Cannot add frame to buffer.");
+    return PLUS_FAIL;
+  }
+
+  igsioFieldMapType customFields;
+  customFields["MaximumPixelValue"].first = FRAMEFIELD_NONE;
+
+  // Write the volume directly into the preallocated buffer frame if the buffer does not need to clip or reorient it
+  const size_t outputVolumeSize = static_cast<size_t>(this->OutputVolumeDimensions[0]) * this->OutputVolumeDimensions[1] * this->OutputVolumeDimensions[2];
+  igsioVideoFrame* writableFrame = NULL;
+  if (videoSource->IsInPlaceWritingSupported() && videoSource->AcquireWritableFrame(writableFrame) == PLUS_SUCCESS)
+  {
+    if (static_cast<size_t>(writableFrame->GetFrameSizeInBytes()) == outputVolumeSize)
+    {
+      customFields["MaximumPixelValue"].second = igsioCommon::ToString<unsigned int>(this->CopyVolumeRegion(volume, static_cast<unsigned char*>(writableFrame->GetScalarPointer())));
+      if (videoSource->CommitWritableFrame(this->FrameNumber, UNDEFINED_TIMESTAMP, UNDEFINED_TIMESTAMP, &customFields) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Unable to add item to buffer.");
+        return PLUS_FAIL;
+      }
+      this->FrameNumber++;
+      return PLUS_SUCCESS;
+    }
+    videoSource->ReleaseWritableFrame();
+  }
+
+  customFields["MaximumPixelValue"].second = igsioCommon::ToString<unsigned int>(this->CopyVolumeRegion(volume, static_cast<unsigned char*>(this->OutputVolume->GetScalarPointer())));
+  if (videoSource->AddItem(this->OutputVolume, videoSource->GetInputImageOrientation(), US_IMG_BRIGHTNESS, this->FrameNumber, UNDEFINED_TIMESTAMP, UNDEFINED_TIMESTAMP, &customFields) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to add item to buffer.");
+    return PLUS_FAIL;
+  }
   this->FrameNumber++;
-}
\ No newline at end of file
+  return PLUS_SUCCESS;
+}
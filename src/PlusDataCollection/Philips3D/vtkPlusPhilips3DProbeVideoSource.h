@@ -12,11 +12,18 @@ See License.txt for details.
 #include "vtkPlusDevice.h"
 #include "StreamMgr.h"
 
+#include <array>
+
 class vtkPlusIEEListener;
 
 /*!
 \class vtkPlusPhilips3DProbeVideoSource
 \brief Class for providing VTK video input interface from Philips ie33 3D ultrasound probe
+
+Received volumes are written directly into the preallocated frames of the video source buffer when possible
+(see vtkPlusDataSource::AcquireWritableFrame). A region of interest can be cropped from the volume and it can be
+downsampled while it is copied, which reduces the memory bandwidth and the size of the buffers for high rate 4D imaging.
+
 \ingroup PlusLibDataCollection
 */
 class vtkPlusDataCollectionExport vtkPlusPhilips3DProbeVideoSource : public vtkPlusDevice
@@ -67,14 +74,35 @@ public:
   vtkSetMacro(LatAndElevSmoothingIndex, int);
   vtkGetMacro(LatAndElevSmoothingIndex, int);
 
+  /*! Origin of the region of interest in the received volume, in voxels */
+  void SetVolumeRegionOfInterestOrigin(const std::array<int, 3>& origin) { this->VolumeRegionOfInterestOrigin = origin; }
+  std::array<int, 3> GetVolumeRegionOfInterestOrigin() const { return this->VolumeRegionOfInterestOrigin; }
+
+  /*! Size of the region of interest in the received volume, in voxels. 0 means the whole volume along that axis. */
+  void SetVolumeRegionOfInterestSize(const std::array<int, 3>& size) { this->VolumeRegionOfInterestSize = size; }
+  std::array<int, 3> GetVolumeRegionOfInterestSize() const { return this->VolumeRegionOfInterestSize; }
+
+  /*! Only every N-th voxel of the region of interest is kept along each axis */
+  void SetVolumeDownsamplingFactor(const std::array<int, 3>& factor) { this->VolumeDownsamplingFactor = factor; }
+  std::array<int, 3> GetVolumeDownsamplingFactor() const { return this->VolumeDownsamplingFactor; }
+
 protected:
   /*! Constructor */
   vtkPlusPhilips3DProbeVideoSource();
   /*! Destructor */
   virtual ~vtkPlusPhilips3DProbeVideoSource();
 
-  /*! Callback function when a new frame is ready to be added */
-  void CallbackAddFrame(vtkImageData* imageData);
+  /*! Callback function when a new volume is received. Crops and downsamples the volume into the buffer. */
+  PlusStatus CallbackAddFrame(const unsigned char* volume, const int dimensions[3]);
+
+  /*! Compute the output volume size from the received volume size and set up the video source for it */
+  PlusStatus UpdateOutputVolumeFormat(const int dimensions[3]);
+
+  /*!
+    Copy the region of interest of the received volume into the output volume, concurrently for groups of slices.
+    Returns the maximum pixel value of the output volume.
+  */
+  unsigned int CopyVolumeRegion(const unsigned char* volume, unsigned char* outputVolume);
 
   /*! Connect to device */
   virtual PlusStatus InternalConnect();
@@ -120,6 +148,20 @@ protected:
   /*! Parameter to pass to the Philips stream manager */
   int LatAndElevSmoothingIndex;
 
+  std::array<int, 3> VolumeRegionOfInterestOrigin;
+  std::array<int, 3> VolumeRegionOfInterestSize;
+  std::array<int, 3> VolumeDownsamplingFactor;
+
+  /*! Size of the received volumes, all zero until the first volume is received */
+  std::array<int, 3> InputVolumeDimensions;
+  /*! Region of interest origin, fitted into the received volume */
+  std::array<int, 3> InputVolumeRegionOrigin;
+  /*! Size of the volumes that are added to the buffer */
+  std::array<int, 3> OutputVolumeDimensions;
+
+  /*! Output volume for adding to the buffer when in-place writing is not possible (e.g., because the data source reorients the frames) */
+  vtkSmartPointer<vtkImageData> OutputVolume;
+
 private:
   vtkPlusPhilips3DProbeVideoSource(const vtkPlusPhilips3DProbeVideoSource&);  // Not implemented.
   void operator=(const vtkPlusPhilips3DProbeVideoSource&);  // Not implemented.
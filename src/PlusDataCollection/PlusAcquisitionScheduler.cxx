@@ -0,0 +1,303 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "PlusProfiler.h"
+#include "PlusAcquisitionScheduler.h"
+#include "PlusPacingTimer.h"
+#include "vtkIGSIOAccurateTimer.h"
+
+// STL includes
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+
+const double PlusAcquisitionScheduler::PRECISE_DELAY_SEC = 0.002;
+
+//----------------------------------------------------------------------------
+PlusUpdateSchedule::PlusUpdateSchedule()
+  : PeriodSec(0.0)
+  , NextReleaseTimeSec(0.0)
+  , NumberOfRecordedUpdates(0)
+  , UpdateRate(0.0)
+  , Adaptive(false)
+  , NumberOfNewItems(0)
+  , LastItemTimeSec(0.0)
+  , NumberOfItemIntervals(0)
+  , ItemIntervalSec(0.0)
+{
+  std::fill(this->UpdateStartTimesSec, this->UpdateStartTimesSec + UPDATE_RATE_AVERAGING, 0.0);
+  this->ResetStatistics();
+}
+
+//----------------------------------------------------------------------------
+void PlusUpdateSchedule::Start(double periodSec, double startTimeSec)
+{
+  this->PeriodSec = periodSec;
+  this->NextReleaseTimeSec = startTimeSec;
+  this->NumberOfRecordedUpdates = 0;
+  this->UpdateRate = 0.0;
+  this->NumberOfNewItems = 0;
+  this->LastItemTimeSec = 0.0;
+  this->NumberOfItemIntervals = 0;
+  this->ItemIntervalSec = 0.0;
+}
+
+//----------------------------------------------------------------------------
+void PlusUpdateSchedule::RecordUpdate(double updateStartTimeSec, double updateEndTimeSec)
+{
+  // Rate over the last UPDATE_RATE_AVERAGING updates
+  const int historyIndex = static_cast<int>(this->NumberOfRecordedUpdates % UPDATE_RATE_AVERAGING);
+  const double elapsedTimeSec = updateStartTimeSec - this->UpdateStartTimesSec[historyIndex];
+  this->UpdateStartTimesSec[historyIndex] = updateStartTimeSec;
+  this->NumberOfRecordedUpdates++;
+  if (this->NumberOfRecordedUpdates > UPDATE_RATE_AVERAGING && elapsedTimeSec > 0)
+  {
+    this->UpdateRate = UPDATE_RATE_AVERAGING / elapsedTimeSec;
+  }
+
+  double deadlineSec = 0.0;
+  if (updateStartTimeSec < this->NextReleaseTimeSec)
+  {
+    // Started early (e.g., woken up by new input data), the period restarts
+    deadlineSec = updateStartTimeSec + this->PeriodSec;
+  }
+  else
+  {
+    this->JitterHistogram.AddSample(updateStartTimeSec - this->NextReleaseTimeSec);
+    deadlineSec = this->NextReleaseTimeSec + this->PeriodSec;
+  }
+
+  this->NumberOfUpdates.fetch_add(1, std::memory_order_relaxed);
+  if (updateEndTimeSec > deadlineSec)
+  {
+    this->NumberOfOverruns.fetch_add(1, std::memory_order_relaxed);
+    this->OverrunHistogram.AddSample(updateEndTimeSec - deadlineSec);
+    // Do not wait for the next period, but do not try to catch up with the missed ones either
+    this->NextReleaseTimeSec = updateEndTimeSec;
+  }
+  else
+  {
+    this->NextReleaseTimeSec = deadlineSec;
+  }
+
+  if (this->Adaptive)
+  {
+    this->ScheduleAdaptiveUpdate(updateStartTimeSec, updateEndTimeSec);
+  }
+  this->NumberOfNewItems = 0;
+}
+
+//----------------------------------------------------------------------------
+void PlusUpdateSchedule::ScheduleAdaptiveUpdate(double updateStartTimeSec, double updateEndTimeSec)
+{
+  if (this->NumberOfNewItems > 0)
+  {
+    if (this->LastItemTimeSec > 0)
+    {
+      // If several items are received by one update then the device is faster than expected
+      const double intervalSec = (updateStartTimeSec - this->LastItemTimeSec) / this->NumberOfNewItems;
+      if (this->NumberOfItemIntervals == 0)
+      {
+        this->ItemIntervalSec = intervalSec;
+        this->NumberOfItemIntervals++;
+      }
+      else if (intervalSec < 2.0 * this->ItemIntervalSec)
+      {
+        this->ItemIntervalSec += 0.2 * (intervalSec - this->ItemIntervalSec);
+        this->NumberOfItemIntervals++;
+      }
+      // Longer intervals are dropped items or a pause of the device, they are not used for learning the interval
+    }
+    this->LastItemTimeSec = updateStartTimeSec;
+  }
+
+  if (this->NumberOfItemIntervals < MINIMUM_ITEM_INTERVALS || this->LastItemTimeSec <= 0 || this->ItemIntervalSec < 2.0 * this->PeriodSec)
+  {
+    // The interval is not known yet, or the period is short enough (the updates would not be less frequent)
+    return;
+  }
+
+  const double retrySec = std::min(this->PeriodSec, 0.1 * this->ItemIntervalSec);
+  const double expectedItemTimeSec = this->LastItemTimeSec + this->ItemIntervalSec;
+  if (updateEndTimeSec < expectedItemTimeSec - retrySec)
+  {
+    this->NextReleaseTimeSec = expectedItemTimeSec - retrySec;
+  }
+  else if (updateEndTimeSec < this->LastItemTimeSec + FALLBACK_ITEM_INTERVALS * this->ItemIntervalSec)
+  {
+    // The item is late, poll again shortly
+    this->NextReleaseTimeSec = std::max(updateEndTimeSec, updateStartTimeSec + retrySec);
+  }
+  else
+  {
+    // The device stopped sending items or its rate changed, use the fixed period until the interval is learned again
+    this->LastItemTimeSec = 0.0;
+    this->NumberOfItemIntervals = 0;
+  }
+}
+
+//----------------------------------------------------------------------------
+double PlusUpdateSchedule::GetItemIntervalSec() const
+{
+  return (this->NumberOfItemIntervals < MINIMUM_ITEM_INTERVALS) ? 0.0 : this->ItemIntervalSec;
+}
+
+//----------------------------------------------------------------------------
+unsigned long long PlusUpdateSchedule::GetNumberOfUpdates() const
+{
+  return this->NumberOfUpdates.load(std::memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------------
+unsigned long long PlusUpdateSchedule::GetNumberOfOverruns() const
+{
+  return this->NumberOfOverruns.load(std::memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------------
+std::string PlusUpdateSchedule::GetStatisticsString() const
+{
+  std::ostringstream ss;
+  ss << std::fixed << std::setprecision(3)
+     << "PeriodMs=" << this->PeriodSec * 1000.0
+     << " Updates=" << this->GetNumberOfUpdates()
+     << " Overruns=" << this->GetNumberOfOverruns()
+     << " JitterP50Ms=" << this->JitterHistogram.GetPercentileSec(50) * 1000.0
+     << " JitterP99Ms=" << this->JitterHistogram.GetPercentileSec(99) * 1000.0
+     << " JitterMaxMs=" << this->JitterHistogram.GetMaximumSec() * 1000.0
+     << " OverrunMaxMs=" << this->OverrunHistogram.GetMaximumSec() * 1000.0;
+  if (this->Adaptive)
+  {
+    ss << " ItemIntervalMs=" << this->GetItemIntervalSec() * 1000.0;
+  }
+  return ss.str();
+}
+
+//----------------------------------------------------------------------------
+void PlusUpdateSchedule::ResetStatistics()
+{
+  this->NumberOfUpdates.store(0, std::memory_order_relaxed);
+  this->NumberOfOverruns.store(0, std::memory_order_relaxed);
+  this->JitterHistogram.Reset();
+  this->OverrunHistogram.Reset();
+}
+
+//----------------------------------------------------------------------------
+PlusAcquisitionScheduler& PlusAcquisitionScheduler::GetInstance()
+{
+  // Initialization of function-local statics is thread-safe
+  static PlusAcquisitionScheduler instance;
+  return instance;
+}
+
+//----------------------------------------------------------------------------
+PlusAcquisitionScheduler::PlusAcquisitionScheduler()
+  : RunningOwner(NULL)
+  , StopRequested(false)
+{
+}
+
+//----------------------------------------------------------------------------
+PlusAcquisitionScheduler::~PlusAcquisitionScheduler()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    this->StopRequested = true;
+  }
+  this->TasksChanged.notify_all();
+  if (this->Thread.joinable())
+  {
+    this->Thread.join();
+  }
+}
+
+//----------------------------------------------------------------------------
+void PlusAcquisitionScheduler::AddTask(const void* owner, PlusUpdateSchedule* schedule, const std::function<void()>& update)
+{
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    Task task = { owner, schedule, update };
+    this->Tasks.push_back(task);
+    if (!this->Thread.joinable())
+    {
+      this->Thread = std::thread(&PlusAcquisitionScheduler::ThreadFunction, this);
+    }
+  }
+  this->TasksChanged.notify_all();
+}
+
+//----------------------------------------------------------------------------
+void PlusAcquisitionScheduler::RemoveTask(const void* owner)
+{
+  {
+    std::unique_lock<std::mutex> lock(this->Mutex);
+    for (std::vector<Task>::iterator it = this->Tasks.begin(); it != this->Tasks.end(); ++it)
+    {
+      if (it->Owner == owner)
+      {
+        this->Tasks.erase(it);
+        break;
+      }
+    }
+    while (this->RunningOwner == owner)
+    {
+      this->UpdateCompleted.wait(lock);
+    }
+  }
+  this->TasksChanged.notify_all();
+}
+
+//----------------------------------------------------------------------------
+int PlusAcquisitionScheduler::GetNumberOfTasks()
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  return static_cast<int>(this->Tasks.size());
+}
+
+//----------------------------------------------------------------------------
+void PlusAcquisitionScheduler::ThreadFunction()
+{
+  PLUS_PROFILE_THREAD_NAME("Plus acquisition scheduler");
+  std::unique_lock<std::mutex> lock(this->Mutex);
+  while (!this->StopRequested)
+  {
+    if (this->Tasks.empty())
+    {
+      this->TasksChanged.wait(lock);
+      continue;
+    }
+
+    std::vector<Task>::iterator nextTask = this->Tasks.begin();
+    for (std::vector<Task>::iterator it = this->Tasks.begin(); it != this->Tasks.end(); ++it)
+    {
+      if (it->Schedule->GetNextReleaseTimeSec() < nextTask->Schedule->GetNextReleaseTimeSec())
+      {
+        nextTask = it;
+      }
+    }
+
+    double delaySec = nextTask->Schedule->GetNextReleaseTimeSec() - vtkIGSIOAccurateTimer::GetSystemTime();
+    if (delaySec > PRECISE_DELAY_SEC)
+    {
+      // The task list may change while waiting, so the next task is selected again after waking up
+      this->TasksChanged.wait_for(lock, std::chrono::duration<double>(delaySec - PRECISE_DELAY_SEC));
+      continue;
+    }
+
+    Task task = *nextTask;
+    this->RunningOwner = task.Owner;
+    lock.unlock();
+    PlusPacingTimer::Delay(delaySec);
+    double updateStartTime = vtkIGSIOAccurateTimer::GetSystemTime();
+    task.Update();
+    task.Schedule->RecordUpdate(updateStartTime, vtkIGSIOAccurateTimer::GetSystemTime());
+    lock.lock();
+    this->RunningOwner = NULL;
+    this->UpdateCompleted.notify_all();
+  }
+}
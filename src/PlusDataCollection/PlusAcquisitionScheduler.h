@@ -0,0 +1,187 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusAcquisitionScheduler_h
+#define __PlusAcquisitionScheduler_h
+
+#include "vtkPlusDataCollectionExport.h"
+#include "PlusTelemetry.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*!
+  \class PlusUpdateSchedule
+  \brief Release times and deadlines of the periodic updates of a device, with overrun and jitter statistics.
+
+  Update k is released at StartTime + k * Period and its deadline is the release time of the next update.
+  Release times do not drift when an update starts late. Statistics:
+  - Jitter: delay between the release time and the actual start of an update
+  - Overrun: time by which an update completed after its deadline. The next update is then released immediately
+    and the following ones are scheduled from there, so that a slow device is not made even slower by waiting
+    for the next period.
+
+  An update that starts before its release time (e.g., the thread was woken up by new input data) restarts the period.
+  RecordUpdate must be called by the thread that runs the updates, the statistics can be read from any thread.
+
+  Adaptive mode is for devices that produce data items at a lower rate than they are polled (e.g., thermal cameras).
+  The thread that runs the updates reports the number of new items of each update (see ReportNewItems), and the
+  interval between the items is learned from the start times of the updates that received them. Once the interval is
+  known, the next update is released a tenth of the interval (at most one period) before the next item is expected,
+  and repeated at the same spacing until the item arrives. The period is used as in the fixed mode while
+  the interval is learned or if it is shorter than two periods, and if no item is received for several intervals then
+  the schedule falls back to the period and learns the interval again.
+
+  \ingroup PlusLibDataCollection
+*/
+class vtkPlusDataCollectionExport PlusUpdateSchedule
+{
+public:
+  PlusUpdateSchedule();
+
+  /*! Schedule the first update at startTimeSec (system time, see vtkIGSIOAccurateTimer::GetSystemTime). Statistics are kept. */
+  void Start(double periodSec, double startTimeSec);
+
+  double GetPeriodSec() const { return this->PeriodSec; }
+
+  /*! System time when the next update is due */
+  double GetNextReleaseTimeSec() const { return this->NextReleaseTimeSec; }
+
+  /*! Record an update that started and completed at the specified system times and schedule the next update */
+  void RecordUpdate(double updateStartTimeSec, double updateEndTimeSec);
+
+  /*! Enable scheduling of the updates based on the learned interval between data items. Takes effect at the next update. */
+  void SetAdaptive(bool adaptive) { this->Adaptive = adaptive; }
+  bool GetAdaptive() const { return this->Adaptive; }
+
+  /*! Report the number of data items that the current update received, used by the next RecordUpdate call in adaptive mode */
+  void ReportNewItems(unsigned int numberOfItems) { this->NumberOfNewItems += numberOfItems; }
+
+  /*! Learned interval between data items in adaptive mode, 0 while the interval is learned */
+  double GetItemIntervalSec() const;
+
+  /*! Number of updates per second, averaged over the last few updates. 0 until enough updates are recorded. */
+  double GetUpdateRate() const { return this->UpdateRate; }
+
+  unsigned long long GetNumberOfUpdates() const;
+  unsigned long long GetNumberOfOverruns() const;
+  const PlusLatencyHistogram& GetJitterHistogram() const { return this->JitterHistogram; }
+  const PlusLatencyHistogram& GetOverrunHistogram() const { return this->OverrunHistogram; }
+
+  /*!
+    Summary in the form "PeriodMs=... Updates=... Overruns=... JitterP50Ms=... JitterP99Ms=... JitterMaxMs=... OverrunMaxMs=...",
+    followed by " ItemIntervalMs=..." in adaptive mode
+  */
+  std::string GetStatisticsString() const;
+
+  void ResetStatistics();
+
+protected:
+  static const int UPDATE_RATE_AVERAGING = 10;
+  /*! Number of item intervals that are measured before the updates are scheduled by the learned interval */
+  static const int MINIMUM_ITEM_INTERVALS = 4;
+  /*! If no item is received for this many intervals then the schedule falls back to the period */
+  static const int FALLBACK_ITEM_INTERVALS = 3;
+
+  /*! Update the learned item interval and release the next update just before the next item is expected */
+  void ScheduleAdaptiveUpdate(double updateStartTimeSec, double updateEndTimeSec);
+
+  double PeriodSec;
+  double NextReleaseTimeSec;
+
+  /*! Start times of the last updates, for computing the update rate */
+  double UpdateStartTimesSec[UPDATE_RATE_AVERAGING];
+  unsigned long long NumberOfRecordedUpdates;
+  double UpdateRate;
+
+  bool Adaptive;
+  unsigned int NumberOfNewItems;
+  /*! Start time of the last update that received an item, 0 if unknown */
+  double LastItemTimeSec;
+  int NumberOfItemIntervals;
+  /*! Average interval between items, only valid if at least MINIMUM_ITEM_INTERVALS intervals are measured */
+  double ItemIntervalSec;
+
+  std::atomic<unsigned long long> NumberOfUpdates;
+  std::atomic<unsigned long long> NumberOfOverruns;
+  PlusLatencyHistogram JitterHistogram;
+  PlusLatencyHistogram OverrunHistogram;
+
+private:
+  PlusUpdateSchedule(const PlusUpdateSchedule&);
+  void operator=(const PlusUpdateSchedule&);
+};
+
+/*!
+  \class PlusAcquisitionScheduler
+  \brief Process-wide thread that runs the periodic updates of multiple devices against their deadlines.
+
+  Devices with a low acquisition rate (e.g., trackers or serial devices polled a few times per second) spend most
+  of the time sleeping in their own update thread. Devices that enable UseSharedUpdateThread are updated instead by
+  this single thread: it sleeps until the earliest release time of all registered tasks, using a high-resolution
+  delay (see PlusPacingTimer) for the last few milliseconds, then runs that update and records it in the schedule
+  of the task.
+
+  Updates of different tasks do not run in parallel, therefore a slow update delays the other tasks (this is
+  visible as jitter in their schedules). Devices with a high acquisition rate or long updates should keep their
+  own thread. The thread is started when the first task is added and stopped when the application exits.
+
+  \ingroup PlusLibDataCollection
+*/
+class vtkPlusDataCollectionExport PlusAcquisitionScheduler
+{
+public:
+  static PlusAcquisitionScheduler& GetInstance();
+
+  /*!
+    Run update periodically at the release times of schedule (see PlusUpdateSchedule::Start). The owner identifies the task.
+    The schedule must remain valid until the task is removed.
+  */
+  void AddTask(const void* owner, PlusUpdateSchedule* schedule, const std::function<void()>& update);
+
+  /*! Remove the task of the owner. If its update is running then it waits until the update is completed. */
+  void RemoveTask(const void* owner);
+
+  int GetNumberOfTasks();
+
+protected:
+  PlusAcquisitionScheduler();
+  ~PlusAcquisitionScheduler();
+
+  void ThreadFunction();
+
+  struct Task
+  {
+    const void* Owner;
+    PlusUpdateSchedule* Schedule;
+    std::function<void()> Update;
+  };
+
+  /*! Remaining waits shorter than this are done by a high-resolution delay instead of waiting on the condition variable */
+  static const double PRECISE_DELAY_SEC;
+
+  std::mutex Mutex;
+  /*! Wakes up the thread when tasks are added or removed */
+  std::condition_variable TasksChanged;
+  /*! Signaled when an update is completed */
+  std::condition_variable UpdateCompleted;
+  std::vector<Task> Tasks;
+  /*! Owner of the update that is currently running, NULL if none */
+  const void* RunningOwner;
+  bool StopRequested;
+  std::thread Thread;
+
+private:
+  PlusAcquisitionScheduler(const PlusAcquisitionScheduler&);
+  void operator=(const PlusAcquisitionScheduler&);
+};
+
+#endif
@@ -0,0 +1,126 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "PlusBufferSnapshot.h"
+#include "vtkPlusBuffer.h"
+
+// STL includes
+#include <algorithm>
+
+namespace
+{
+  // Due to numerical inaccuracies timestamps that are slightly out of the range of the snapshot are still accepted,
+  // the same way as by vtkPlusTimestampedCircularBuffer
+  const double NEGLIGIBLE_TIME_DIFFERENCE_SEC = 1e-5;
+}
+
+//----------------------------------------------------------------------------
+PlusBufferSnapshot::PlusBufferSnapshot()
+{
+}
+
+//----------------------------------------------------------------------------
+PlusBufferSnapshot::PlusBufferSnapshot(vtkPlusBuffer* buffer)
+{
+  this->Capture(buffer);
+}
+
+//----------------------------------------------------------------------------
+PlusBufferSnapshot::~PlusBufferSnapshot()
+{
+  this->Release();
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusBufferSnapshot::Capture(vtkPlusBuffer* buffer)
+{
+  this->Release();
+  if (buffer == NULL)
+  {
+    LOG_ERROR("Failed to capture buffer snapshot - buffer is NULL");
+    return PLUS_FAIL;
+  }
+  this->Buffer = buffer;
+  this->Buffer->RegisterSnapshot(&this->Items);
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void PlusBufferSnapshot::Release()
+{
+  if (this->Buffer != NULL)
+  {
+    this->Buffer->UnregisterSnapshot(&this->Items);
+    this->Buffer = NULL;
+  }
+  this->Items.FirstUid = 1;
+  this->Items.LastUid = 0;
+  this->Items.FilteredTimestamps.clear();
+  this->Items.PreservedItems.clear();
+  this->Items.PreservedCompactPoseItems.clear();
+}
+
+//----------------------------------------------------------------------------
+ItemStatus PlusBufferSnapshot::GetTimeStamp(BufferItemUidType uid, double& timestamp) const
+{
+  if (uid < this->Items.FirstUid)
+  {
+    return ITEM_NOT_AVAILABLE_ANYMORE;
+  }
+  if (uid > this->Items.LastUid)
+  {
+    return ITEM_NOT_AVAILABLE_YET;
+  }
+  timestamp = this->Items.FilteredTimestamps[uid - this->Items.FirstUid];
+  return ITEM_OK;
+}
+
+//----------------------------------------------------------------------------
+ItemStatus PlusBufferSnapshot::GetItemUidFromTime(double time, BufferItemUidType& uid) const
+{
+  const std::vector<double>& timestamps = this->Items.FilteredTimestamps;
+  if (timestamps.empty())
+  {
+    return ITEM_NOT_AVAILABLE_YET;
+  }
+  if (timestamps.size() == 1)
+  {
+    // There is only one item, it's the closest one to any timestamp
+    uid = this->Items.FirstUid;
+    return ITEM_OK;
+  }
+  if (time < timestamps.front() - NEGLIGIBLE_TIME_DIFFERENCE_SEC)
+  {
+    return ITEM_NOT_AVAILABLE_ANYMORE;
+  }
+  if (time > timestamps.back() + NEGLIGIBLE_TIME_DIFFERENCE_SEC)
+  {
+    return ITEM_NOT_AVAILABLE_YET;
+  }
+
+  // Index of the first item that is not older than the requested time
+  size_t hi = std::lower_bound(timestamps.begin(), timestamps.end(), time) - timestamps.begin();
+  if (hi >= timestamps.size())
+  {
+    hi = timestamps.size() - 1;
+  }
+  size_t lo = (hi > 0) ? hi - 1 : 0;
+  size_t closest = (time - timestamps[lo] > timestamps[hi] - time) ? hi : lo;
+  uid = this->Items.FirstUid + closest;
+  return ITEM_OK;
+}
+
+//----------------------------------------------------------------------------
+ItemStatus PlusBufferSnapshot::GetStreamBufferItem(BufferItemUidType uid, StreamBufferItem* bufferItem)
+{
+  if (this->Buffer == NULL)
+  {
+    LOG_ERROR("Failed to get item from buffer snapshot - no buffer is captured");
+    return ITEM_UNKNOWN_ERROR;
+  }
+  return this->Buffer->GetSnapshotStreamBufferItem(&this->Items, uid, bufferItem);
+}
@@ -0,0 +1,72 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusBufferSnapshot_h
+#define __PlusBufferSnapshot_h
+
+#include "PlusConfigure.h"
+#include "vtkPlusDataCollectionExport.h"
+#include "vtkPlusTimestampedCircularBuffer.h"
+
+#include <vtkSmartPointer.h>
+
+class vtkPlusBuffer;
+
+/*!
+  \class PlusBufferSnapshot
+  \brief Consistent view of the items that are in a buffer at a given time.
+
+  The oldest and latest item UIDs and the item timestamps are captured at once, while the buffer is locked.
+  The items of the snapshot remain readable until the snapshot is released (or destroyed), even if the acquisition
+  thread overwrites them in the buffer meanwhile: the buffer copies an item of a registered snapshot before it overwrites
+  it (copy-on-overwrite). The copies are only made if a reader lags behind the acquisition, so holding a snapshot
+  costs nothing while the items are still in the buffer.
+
+  UID and timestamp queries are answered from the captured data without locking the buffer. Item reads lock the buffer
+  only for the time of copying the item, and may be called from multiple threads.
+
+  \ingroup PlusLibDataCollection
+*/
+class vtkPlusDataCollectionExport PlusBufferSnapshot
+{
+public:
+  PlusBufferSnapshot();
+  /*! Capture the current item range of the buffer */
+  explicit PlusBufferSnapshot(vtkPlusBuffer* buffer);
+  ~PlusBufferSnapshot();
+
+  /*! Capture the current item range of the buffer, a previously captured snapshot is released */
+  PlusStatus Capture(vtkPlusBuffer* buffer);
+
+  /*! Release the snapshot, its items are not preserved by the buffer anymore */
+  void Release();
+
+  /*! Returns true if a buffer has been captured and the snapshot is not released yet */
+  bool IsCaptured() const { return this->Buffer != NULL; }
+
+  int GetNumberOfItems() const { return static_cast<int>(this->Items.FilteredTimestamps.size()); }
+  BufferItemUidType GetOldestItemUid() const { return this->Items.FirstUid; }
+  BufferItemUidType GetLatestItemUid() const { return this->Items.LastUid; }
+
+  /*! Get the filtered timestamp (including the local time offset) of an item of the snapshot */
+  ItemStatus GetTimeStamp(BufferItemUidType uid, double& timestamp) const;
+
+  /*! Get the UID of the item that is closest to the specified time, same as vtkPlusBuffer::GetItemUidFromTime */
+  ItemStatus GetItemUidFromTime(double time, BufferItemUidType& uid) const;
+
+  /*! Get a copy of an item of the snapshot */
+  ItemStatus GetStreamBufferItem(BufferItemUidType uid, StreamBufferItem* bufferItem);
+
+protected:
+  vtkSmartPointer<vtkPlusBuffer> Buffer;
+  BufferSnapshotItems Items;
+
+private:
+  PlusBufferSnapshot(const PlusBufferSnapshot&);
+  void operator=(const PlusBufferSnapshot&);
+};
+
+#endif
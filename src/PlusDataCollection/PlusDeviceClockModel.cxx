@@ -0,0 +1,199 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "PlusDeviceClockModel.h"
+
+// STL includes
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+// Clock crystals are typically accurate to 10-100 ppm, larger values are caused by delay variations
+const double PlusDeviceClockModel::MAXIMUM_DRIFT_PPM = 500.0;
+const double PlusDeviceClockModel::MINIMUM_DRIFT_FIT_SPAN_SEC = 1.0;
+
+//----------------------------------------------------------------------------
+PlusDeviceClockModel::PlusDeviceClockModel()
+  : WindowSec(10.0)
+  , MinimumNumberOfSamples(10)
+  , MaximumDelaySec(0.5)
+  , ReferenceDeviceTimeSec(0.0)
+  , ReferenceSystemTimeSec(0.0)
+  , Slope(1.0)
+  , OffsetSec(0.0)
+{
+  this->ResetStatistics();
+}
+
+//----------------------------------------------------------------------------
+void PlusDeviceClockModel::Reset()
+{
+  this->Samples.clear();
+  this->Slope = 1.0;
+  this->OffsetSec = 0.0;
+  this->DriftPpm.store(0.0, std::memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------------
+void PlusDeviceClockModel::AddSample(double deviceTimeSec, double systemTimeSec)
+{
+  if (!this->Samples.empty())
+  {
+    bool clockReset = deviceTimeSec - this->ReferenceDeviceTimeSec <= this->Samples.back().DeviceTimeSec;
+    if (!clockReset && this->IsValid())
+    {
+      double delaySec = systemTimeSec - this->GetSystemTime(deviceTimeSec);
+      clockReset = std::fabs(delaySec) > this->MaximumDelaySec;
+    }
+    if (clockReset)
+    {
+      LOG_DEBUG("Device clock reset detected at device time " << std::fixed << deviceTimeSec << ", the clock model is restarted");
+      this->NumberOfClockResets.fetch_add(1, std::memory_order_relaxed);
+      this->Reset();
+    }
+  }
+  if (this->Samples.empty())
+  {
+    this->ReferenceDeviceTimeSec = deviceTimeSec;
+    this->ReferenceSystemTimeSec = systemTimeSec;
+  }
+
+  Sample sample = { deviceTimeSec - this->ReferenceDeviceTimeSec, systemTimeSec - this->ReferenceSystemTimeSec };
+  this->Samples.push_back(sample);
+  while (sample.DeviceTimeSec - this->Samples.front().DeviceTimeSec > this->WindowSec)
+  {
+    this->Samples.pop_front();
+  }
+  this->NumberOfSamples.fetch_add(1, std::memory_order_relaxed);
+
+  this->UpdateModel();
+  if (this->IsValid())
+  {
+    this->ArrivalDelayHistogram.AddSample(systemTimeSec - this->GetSystemTime(deviceTimeSec));
+  }
+}
+
+//----------------------------------------------------------------------------
+void PlusDeviceClockModel::UpdateModel()
+{
+  const double firstDeviceTimeSec = this->Samples.front().DeviceTimeSec;
+  const double deviceTimeSpanSec = this->Samples.back().DeviceTimeSec - firstDeviceTimeSec;
+  double slope = 1.0;
+  if (deviceTimeSpanSec >= MINIMUM_DRIFT_FIT_SPAN_SEC)
+  {
+    // Fitting all samples would be biased by the delays of the individual samples, so only the sample with the
+    // smallest delay in each segment of the window is used (like the clock filter of NTP)
+    Sample segmentMinimums[NUMBER_OF_DRIFT_FIT_SEGMENTS];
+    bool segmentUsed[NUMBER_OF_DRIFT_FIT_SEGMENTS] = { false };
+    for (std::deque<Sample>::const_iterator it = this->Samples.begin(); it != this->Samples.end(); ++it)
+    {
+      int segment = std::min(static_cast<int>((it->DeviceTimeSec - firstDeviceTimeSec) / deviceTimeSpanSec * NUMBER_OF_DRIFT_FIT_SEGMENTS), NUMBER_OF_DRIFT_FIT_SEGMENTS - 1);
+      if (!segmentUsed[segment]
+          || it->SystemTimeSec - it->DeviceTimeSec < segmentMinimums[segment].SystemTimeSec - segmentMinimums[segment].DeviceTimeSec)
+      {
+        segmentMinimums[segment] = *it;
+        segmentUsed[segment] = true;
+      }
+    }
+
+    int numberOfPoints = 0;
+    double meanDeviceTimeSec = 0.0;
+    double meanSystemTimeSec = 0.0;
+    for (int segment = 0; segment < NUMBER_OF_DRIFT_FIT_SEGMENTS; segment++)
+    {
+      if (segmentUsed[segment])
+      {
+        meanDeviceTimeSec += segmentMinimums[segment].DeviceTimeSec;
+        meanSystemTimeSec += segmentMinimums[segment].SystemTimeSec;
+        numberOfPoints++;
+      }
+    }
+    meanDeviceTimeSec /= numberOfPoints;
+    meanSystemTimeSec /= numberOfPoints;
+
+    double covariance = 0.0;
+    double variance = 0.0;
+    for (int segment = 0; segment < NUMBER_OF_DRIFT_FIT_SEGMENTS; segment++)
+    {
+      if (segmentUsed[segment])
+      {
+        const Sample& point = segmentMinimums[segment];
+        covariance += (point.DeviceTimeSec - meanDeviceTimeSec) * (point.SystemTimeSec - meanSystemTimeSec);
+        variance += (point.DeviceTimeSec - meanDeviceTimeSec) * (point.DeviceTimeSec - meanDeviceTimeSec);
+      }
+    }
+    if (variance > 0)
+    {
+      const double maximumDrift = MAXIMUM_DRIFT_PPM * 1e-6;
+      slope = std::min(std::max(covariance / variance, 1.0 - maximumDrift), 1.0 + maximumDrift);
+    }
+  }
+
+  // Lower envelope: the sample that arrived with the smallest delay
+  double offsetSec = this->Samples.front().SystemTimeSec - slope * this->Samples.front().DeviceTimeSec;
+  for (std::deque<Sample>::const_iterator it = this->Samples.begin(); it != this->Samples.end(); ++it)
+  {
+    offsetSec = std::min(offsetSec, it->SystemTimeSec - slope * it->DeviceTimeSec);
+  }
+
+  this->Slope = slope;
+  this->OffsetSec = offsetSec;
+  this->DriftPpm.store((slope - 1.0) * 1e6, std::memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------------
+bool PlusDeviceClockModel::IsValid() const
+{
+  return static_cast<int>(this->Samples.size()) >= this->MinimumNumberOfSamples;
+}
+
+//----------------------------------------------------------------------------
+double PlusDeviceClockModel::GetSystemTime(double deviceTimeSec) const
+{
+  return this->ReferenceSystemTimeSec + this->OffsetSec + this->Slope * (deviceTimeSec - this->ReferenceDeviceTimeSec);
+}
+
+//----------------------------------------------------------------------------
+double PlusDeviceClockModel::GetDriftPpm() const
+{
+  return this->DriftPpm.load(std::memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------------
+unsigned long long PlusDeviceClockModel::GetNumberOfSamples() const
+{
+  return this->NumberOfSamples.load(std::memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------------
+unsigned long long PlusDeviceClockModel::GetNumberOfClockResets() const
+{
+  return this->NumberOfClockResets.load(std::memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------------
+std::string PlusDeviceClockModel::GetStatisticsString() const
+{
+  std::ostringstream ss;
+  ss << std::fixed << std::setprecision(3)
+     << "Samples=" << this->GetNumberOfSamples()
+     << " Resets=" << this->GetNumberOfClockResets()
+     << " DriftPpm=" << this->GetDriftPpm()
+     << " ArrivalDelayP50Ms=" << this->ArrivalDelayHistogram.GetPercentileSec(50) * 1000.0
+     << " ArrivalDelayP99Ms=" << this->ArrivalDelayHistogram.GetPercentileSec(99) * 1000.0
+     << " ArrivalDelayMaxMs=" << this->ArrivalDelayHistogram.GetMaximumSec() * 1000.0;
+  return ss.str();
+}
+
+//----------------------------------------------------------------------------
+void PlusDeviceClockModel::ResetStatistics()
+{
+  this->NumberOfSamples.store(0, std::memory_order_relaxed);
+  this->NumberOfClockResets.store(0, std::memory_order_relaxed);
+  this->ArrivalDelayHistogram.Reset();
+}
@@ -0,0 +1,117 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusDeviceClockModel_h
+#define __PlusDeviceClockModel_h
+
+#include "vtkPlusDataCollectionExport.h"
+#include "PlusTelemetry.h"
+
+#include <atomic>
+#include <deque>
+#include <string>
+
+/*!
+  \class PlusDeviceClockModel
+  \brief Online mapping of the hardware clock of a device to the system time.
+
+  Devices that timestamp their data with their own clock (e.g., the exposure time of an optical tracker) provide
+  more accurate timestamps than the arrival time of the data, which includes a variable transfer and scheduling delay.
+  The model is fitted to (device time, arrival system time) pairs within a sliding window, similarly to the clock
+  servo of PTP/NTP:
+  - Drift: slope of the least squares line fitted to the samples with the smallest delay in each segment of the
+    window, limited to MAXIMUM_DRIFT_PPM. It is assumed to be zero until the samples span at least MINIMUM_DRIFT_FIT_SPAN_SEC.
+  - Offset: lower envelope of the arrival times (the sample with the smallest delay), because the delay is never negative.
+
+  So the mapped time is the arrival time the data would have had with the shortest observed delay, and the constant
+  part of the delay can still be compensated by LocalTimeOffsetSec. A device clock reset (time going backward or a
+  mapped time too far from the arrival time) restarts the model.
+
+  AddSample must be called by the acquisition thread of the device, the statistics can be read from any thread.
+
+  \ingroup PlusLibDataCollection
+*/
+class vtkPlusDataCollectionExport PlusDeviceClockModel
+{
+public:
+  PlusDeviceClockModel();
+
+  /*! Forget all samples, statistics are kept */
+  void Reset();
+
+  /*!
+    Add a sample: data timestamped by the device at deviceTimeSec arrived at systemTimeSec
+    (see vtkIGSIOAccurateTimer::GetSystemTime) and update the model.
+  */
+  void AddSample(double deviceTimeSec, double systemTimeSec);
+
+  /*! True if enough samples have been added for mapping device times */
+  bool IsValid() const;
+
+  /*! System time corresponding to a device time. Only meaningful if IsValid() is true. */
+  double GetSystemTime(double deviceTimeSec) const;
+
+  /*! Length of the sliding window, in device time. Default: 10 s. */
+  void SetWindowSec(double windowSec) { this->WindowSec = windowSec; }
+  double GetWindowSec() const { return this->WindowSec; }
+
+  /*! Number of samples required before the model is used. Default: 10. */
+  void SetMinimumNumberOfSamples(int numberOfSamples) { this->MinimumNumberOfSamples = numberOfSamples; }
+  int GetMinimumNumberOfSamples() const { return this->MinimumNumberOfSamples; }
+
+  /*! If an arrival time differs more than this from the mapped time then the device clock is assumed to be reset. Default: 0.5 s. */
+  void SetMaximumDelaySec(double maximumDelaySec) { this->MaximumDelaySec = maximumDelaySec; }
+  double GetMaximumDelaySec() const { return this->MaximumDelaySec; }
+
+  /*! Drift of the device clock relative to the system clock, in parts per million */
+  double GetDriftPpm() const;
+  unsigned long long GetNumberOfSamples() const;
+  unsigned long long GetNumberOfClockResets() const;
+  /*! Delay of the arrival times after the mapped times */
+  const PlusLatencyHistogram& GetArrivalDelayHistogram() const { return this->ArrivalDelayHistogram; }
+
+  /*! Summary in the form "Samples=... Resets=... DriftPpm=... ArrivalDelayP50Ms=... ArrivalDelayP99Ms=... ArrivalDelayMaxMs=..." */
+  std::string GetStatisticsString() const;
+
+  void ResetStatistics();
+
+  static const double MAXIMUM_DRIFT_PPM;
+  static const double MINIMUM_DRIFT_FIT_SPAN_SEC;
+
+protected:
+  struct Sample
+  {
+    /*! Times relative to the first sample after the last reset, for numerical precision */
+    double DeviceTimeSec;
+    double SystemTimeSec;
+  };
+
+  void UpdateModel();
+
+  static const int NUMBER_OF_DRIFT_FIT_SEGMENTS = 16;
+
+  double WindowSec;
+  int MinimumNumberOfSamples;
+  double MaximumDelaySec;
+
+  std::deque<Sample> Samples;
+  double ReferenceDeviceTimeSec;
+  double ReferenceSystemTimeSec;
+  /*! System time = ReferenceSystemTimeSec + OffsetSec + Slope * (device time - ReferenceDeviceTimeSec) */
+  double Slope;
+  double OffsetSec;
+
+  std::atomic<double> DriftPpm;
+  std::atomic<unsigned long long> NumberOfSamples;
+  std::atomic<unsigned long long> NumberOfClockResets;
+  PlusLatencyHistogram ArrivalDelayHistogram;
+
+private:
+  PlusDeviceClockModel(const PlusDeviceClockModel&);
+  void operator=(const PlusDeviceClockModel&);
+};
+
+#endif
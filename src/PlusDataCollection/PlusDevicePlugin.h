@@ -0,0 +1,43 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusDevicePlugin_h
+#define __PlusDevicePlugin_h
+
+/*!
+  \file PlusDevicePlugin.h
+  \brief Export of device factory functions from a device plugin module.
+
+  A device plugin module is a shared library named PlusDevicePlugin<DeviceType> (with the platform-specific prefix and
+  extension) that vtkPlusDeviceFactory loads when a device of that type is created for the first time.
+  The module must contain the device class and use this macro once for each device type that it provides:
+
+  \code
+  #include "PlusDevicePlugin.h"
+  #include "vtkPlusClarius.h"
+  PLUS_DEVICE_PLUGIN(Clarius, vtkPlusClarius)
+  \endcode
+
+  \ingroup PlusLibDataCollection
+*/
+
+#ifdef _WIN32
+  #define PLUS_DEVICE_PLUGIN_EXPORT __declspec(dllexport)
+#else
+  #define PLUS_DEVICE_PLUGIN_EXPORT __attribute__((visibility("default")))
+#endif
+
+#define PLUS_DEVICE_PLUGIN(deviceType, deviceClass) \
+  extern "C" PLUS_DEVICE_PLUGIN_EXPORT vtkPlusDevice* PlusDevicePluginNew_##deviceType() \
+  { \
+    return deviceClass::New(); \
+  } \
+  extern "C" PLUS_DEVICE_PLUGIN_EXPORT const char* PlusDevicePluginClassName_##deviceType() \
+  { \
+    return #deviceClass; \
+  }
+
+#endif
@@ -0,0 +1,199 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "PlusFrameBacklogPolicy.h"
+#include "vtkIGSIOTrackedFrameList.h"
+#include "vtkPlusChannel.h"
+
+// VTK includes
+#include <vtkXMLDataElement.h>
+
+// STL includes
+#include <algorithm>
+
+namespace
+{
+  const char* POLICY_PROCESS_ALL_STRING = "PROCESS_ALL";
+  const char* POLICY_LATEST_ONLY_STRING = "LATEST_ONLY";
+  const char* POLICY_EVERY_NTH_STRING = "EVERY_NTH";
+  const int DEFAULT_BACKLOG_QUEUE_SIZE = 10;
+  const int DEFAULT_BACKLOG_FRAME_INTERVAL = 2;
+}
+
+//----------------------------------------------------------------------------
+PlusFrameBacklogPolicy::PlusFrameBacklogPolicy()
+  : BacklogPolicy(POLICY_LATEST_ONLY)
+  , BacklogQueueSize(DEFAULT_BACKLOG_QUEUE_SIZE)
+  , BacklogFrameInterval(DEFAULT_BACKLOG_FRAME_INTERVAL)
+  , NumberOfSelectedFrames(0)
+  , NumberOfSkippedFrames(0)
+{
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusFrameBacklogPolicy::ReadConfiguration(vtkXMLDataElement* deviceConfig)
+{
+  XML_READ_ENUM3_ATTRIBUTE_OPTIONAL(BacklogPolicy, deviceConfig,
+                                    POLICY_PROCESS_ALL_STRING, POLICY_PROCESS_ALL,
+                                    POLICY_LATEST_ONLY_STRING, POLICY_LATEST_ONLY,
+                                    POLICY_EVERY_NTH_STRING, POLICY_EVERY_NTH);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, BacklogQueueSize, deviceConfig);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, BacklogFrameInterval, deviceConfig);
+
+  if (this->BacklogQueueSize < 1)
+  {
+    LOG_WARNING("BacklogQueueSize must be at least 1, got " << this->BacklogQueueSize << ". Using " << DEFAULT_BACKLOG_QUEUE_SIZE << ".");
+    this->BacklogQueueSize = DEFAULT_BACKLOG_QUEUE_SIZE;
+  }
+  if (this->BacklogFrameInterval < 1)
+  {
+    LOG_WARNING("BacklogFrameInterval must be at least 1, got " << this->BacklogFrameInterval << ". Using " << DEFAULT_BACKLOG_FRAME_INTERVAL << ".");
+    this->BacklogFrameInterval = DEFAULT_BACKLOG_FRAME_INTERVAL;
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusFrameBacklogPolicy::WriteConfiguration(vtkXMLDataElement* deviceConfig) const
+{
+  deviceConfig->SetAttribute("BacklogPolicy", GetBacklogPolicyAsString(this->BacklogPolicy));
+  if (this->BacklogPolicy == POLICY_LATEST_ONLY)
+  {
+    XML_REMOVE_ATTRIBUTE("BacklogQueueSize", deviceConfig);
+  }
+  else
+  {
+    deviceConfig->SetIntAttribute("BacklogQueueSize", this->BacklogQueueSize);
+  }
+  if (this->BacklogPolicy == POLICY_EVERY_NTH)
+  {
+    deviceConfig->SetIntAttribute("BacklogFrameInterval", this->BacklogFrameInterval);
+  }
+  else
+  {
+    XML_REMOVE_ATTRIBUTE("BacklogFrameInterval", deviceConfig);
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+const char* PlusFrameBacklogPolicy::GetBacklogPolicyAsString(BacklogPolicyType policy)
+{
+  switch (policy)
+  {
+    case POLICY_PROCESS_ALL:
+      return POLICY_PROCESS_ALL_STRING;
+    case POLICY_EVERY_NTH:
+      return POLICY_EVERY_NTH_STRING;
+    case POLICY_LATEST_ONLY:
+    default:
+      return POLICY_LATEST_ONLY_STRING;
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusFrameBacklogPolicy::GetFramesToProcess(vtkPlusChannel* channel, vtkIGSIOTrackedFrameList* frames, bool shareImageData)
+{
+  double mostRecentTimestamp(UNDEFINED_TIMESTAMP);
+  if (channel->GetMostRecentTimestamp(mostRecentTimestamp) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to get the most recent timestamp of channel " << channel->GetChannelId());
+    return PLUS_FAIL;
+  }
+
+  ChannelState& state = this->ChannelStates[channel];
+  if (state.LastTimestamp != UNDEFINED_TIMESTAMP && mostRecentTimestamp <= state.LastTimestamp)
+  {
+    // No new frame
+    return PLUS_SUCCESS;
+  }
+
+  // Number of frames acquired since the previous call
+  int numberOfNewFrames = 1;
+  if (state.LastTimestamp != UNDEFINED_TIMESTAMP)
+  {
+    double oldestTimestamp(UNDEFINED_TIMESTAMP);
+    if (channel->GetOldestTimestamp(oldestTimestamp) == PLUS_SUCCESS && state.LastTimestamp < oldestTimestamp)
+    {
+      // Some frames are already removed from the buffer, only the frames that are still in the buffer can be counted
+      LOG_DEBUG("Frames acquired between " << std::fixed << state.LastTimestamp << " and " << oldestTimestamp << " are not in the buffer of channel " << channel->GetChannelId() << " anymore");
+      numberOfNewFrames = channel->GetNumberOfFramesBetweenTimestamps(oldestTimestamp, mostRecentTimestamp) + 1;
+    }
+    else
+    {
+      numberOfNewFrames = channel->GetNumberOfFramesBetweenTimestamps(state.LastTimestamp, mostRecentTimestamp);
+    }
+    numberOfNewFrames = (std::max)(numberOfNewFrames, 1);
+  }
+
+  int maximumNumberOfFrames = 1;
+  switch (this->BacklogPolicy)
+  {
+    case POLICY_PROCESS_ALL:
+      maximumNumberOfFrames = this->BacklogQueueSize;
+      break;
+    case POLICY_EVERY_NTH:
+      maximumNumberOfFrames = this->BacklogQueueSize * this->BacklogFrameInterval;
+      break;
+    case POLICY_LATEST_ONLY:
+    default:
+      maximumNumberOfFrames = 1;
+      break;
+  }
+
+  // The most recent frames are returned if there are more new frames than the maximum
+  const int firstFrameIndex = frames->GetNumberOfTrackedFrames();
+  if (channel->GetTrackedFrameList(state.LastTimestamp, frames, maximumNumberOfFrames, shareImageData) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to get tracked frames from channel " << channel->GetChannelId());
+    return PLUS_FAIL;
+  }
+  int numberOfFrames = frames->GetNumberOfTrackedFrames() - firstFrameIndex;
+
+  if (this->BacklogPolicy == POLICY_EVERY_NTH)
+  {
+    // Frames that are not returned by GetTrackedFrameList are counted too, to keep the interval between the selected frames
+    const int numberOfOmittedFrames = (std::max)(numberOfNewFrames - numberOfFrames, 0);
+    state.NumberOfFramesSinceLastSelected = (state.NumberOfFramesSinceLastSelected + numberOfOmittedFrames) % this->BacklogFrameInterval;
+    for (int frameIndex = firstFrameIndex; frameIndex < static_cast<int>(frames->GetNumberOfTrackedFrames());)
+    {
+      if (state.NumberOfFramesSinceLastSelected == 0)
+      {
+        ++frameIndex;
+      }
+      else
+      {
+        frames->RemoveTrackedFrame(frameIndex);
+      }
+      state.NumberOfFramesSinceLastSelected = (state.NumberOfFramesSinceLastSelected + 1) % this->BacklogFrameInterval;
+    }
+    numberOfFrames = frames->GetNumberOfTrackedFrames() - firstFrameIndex;
+  }
+
+  const int numberOfSkippedFrames = (std::max)(numberOfNewFrames - numberOfFrames, 0);
+  if (numberOfSkippedFrames > 0)
+  {
+    LOG_TRACE(numberOfSkippedFrames << " frames of channel " << channel->GetChannelId() << " are skipped");
+  }
+  this->NumberOfSelectedFrames += numberOfFrames;
+  this->NumberOfSkippedFrames += numberOfSkippedFrames;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void PlusFrameBacklogPolicy::AddSkippedFrames(unsigned long long numberOfFrames)
+{
+  this->NumberOfSkippedFrames += numberOfFrames;
+}
+
+//----------------------------------------------------------------------------
+void PlusFrameBacklogPolicy::Reset()
+{
+  this->ChannelStates.clear();
+  this->NumberOfSelectedFrames = 0;
+  this->NumberOfSkippedFrames = 0;
+}
@@ -0,0 +1,102 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusFrameBacklogPolicy_h
+#define __PlusFrameBacklogPolicy_h
+
+#include "PlusConfigure.h"
+#include "vtkPlusDataCollectionExport.h"
+
+#include <atomic>
+#include <map>
+
+class vtkIGSIOTrackedFrameList;
+class vtkPlusChannel;
+class vtkXMLDataElement;
+
+/*!
+  \class PlusFrameBacklogPolicy
+  \brief Selects the input frames that a processing device processes when frames arrive faster than it can process them.
+
+  - PROCESS_ALL: all frames are processed in the order of acquisition. If more than BacklogQueueSize frames were acquired
+    since the previous update then only the most recent BacklogQueueSize frames are processed.
+  - LATEST_ONLY: only the most recent frame is processed.
+  - EVERY_NTH: every BacklogFrameInterval-th acquired frame is processed, at most BacklogQueueSize frames in an update.
+
+  Frames that are not processed are counted, so that the device can report how many frames went unprocessed.
+  The policy is read from the BacklogPolicy, BacklogQueueSize and BacklogFrameInterval attributes of the device element.
+
+  \ingroup PlusLibDataCollection
+*/
+class vtkPlusDataCollectionExport PlusFrameBacklogPolicy
+{
+public:
+  enum BacklogPolicyType
+  {
+    POLICY_PROCESS_ALL,
+    POLICY_LATEST_ONLY,
+    POLICY_EVERY_NTH
+  };
+
+  PlusFrameBacklogPolicy();
+
+  PlusStatus ReadConfiguration(vtkXMLDataElement* deviceConfig);
+  PlusStatus WriteConfiguration(vtkXMLDataElement* deviceConfig) const;
+
+  /*!
+    Append the frames of the channel that should be processed now to the frame list, in the order of acquisition.
+    Frames that are returned once are not returned again. No frames are appended if no new frame was acquired
+    since the previous call.
+    \param shareImageData If true then the image data of the frames is shared with the video buffer and must be treated as read-only
+  */
+  PlusStatus GetFramesToProcess(vtkPlusChannel* channel, vtkIGSIOTrackedFrameList* frames, bool shareImageData = true);
+
+  /*! Count frames that were selected for processing by GetFramesToProcess but the device could not process */
+  void AddSkippedFrames(unsigned long long numberOfFrames);
+
+  /*! Forget the frames returned so far and clear the counters */
+  void Reset();
+
+  void SetBacklogPolicy(BacklogPolicyType policy) { this->BacklogPolicy = policy; }
+  BacklogPolicyType GetBacklogPolicy() const { return this->BacklogPolicy; }
+  static const char* GetBacklogPolicyAsString(BacklogPolicyType policy);
+
+  void SetBacklogQueueSize(int queueSize) { this->BacklogQueueSize = queueSize; }
+  int GetBacklogQueueSize() const { return this->BacklogQueueSize; }
+
+  void SetBacklogFrameInterval(int frameInterval) { this->BacklogFrameInterval = frameInterval; }
+  int GetBacklogFrameInterval() const { return this->BacklogFrameInterval; }
+
+  /*! Number of frames returned by GetFramesToProcess */
+  unsigned long long GetNumberOfSelectedFrames() const { return this->NumberOfSelectedFrames; }
+  /*! Number of acquired frames that were not processed */
+  unsigned long long GetNumberOfSkippedFrames() const { return this->NumberOfSkippedFrames; }
+
+protected:
+  struct ChannelState
+  {
+    ChannelState() : LastTimestamp(UNDEFINED_TIMESTAMP), NumberOfFramesSinceLastSelected(0) {}
+    /*! Timestamp of the most recent frame that was returned */
+    double LastTimestamp;
+    /*! Used by the EVERY_NTH policy */
+    int NumberOfFramesSinceLastSelected;
+  };
+
+  BacklogPolicyType BacklogPolicy;
+  int BacklogQueueSize;
+  int BacklogFrameInterval;
+
+  std::map<vtkPlusChannel*, ChannelState> ChannelStates;
+
+  std::atomic<unsigned long long> NumberOfSelectedFrames;
+  std::atomic<unsigned long long> NumberOfSkippedFrames;
+
+private:
+  PlusFrameBacklogPolicy(const PlusFrameBacklogPolicy&);
+  void operator=(const PlusFrameBacklogPolicy&);
+};
+
+#endif
@@ -0,0 +1,53 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "PlusFrameFieldKeyTable.h"
+
+//----------------------------------------------------------------------------
+PlusFrameFieldKeyTable& PlusFrameFieldKeyTable::GetInstance()
+{
+  static PlusFrameFieldKeyTable instance;
+  return instance;
+}
+
+//----------------------------------------------------------------------------
+PlusFrameFieldKeyTable::KeyType PlusFrameFieldKeyTable::GetKey(const std::string& fieldName)
+{
+  PlusFrameFieldKeyTable& table = GetInstance();
+  std::lock_guard<std::mutex> lock(table.Mutex);
+  std::map<std::string, KeyType>::iterator keyIt = table.KeysByName.find(fieldName);
+  if (keyIt != table.KeysByName.end())
+  {
+    return keyIt->second;
+  }
+  const KeyType key = static_cast<KeyType>(table.Names.size());
+  table.Names.push_back(fieldName);
+  table.KeysByName[fieldName] = key;
+  return key;
+}
+
+//----------------------------------------------------------------------------
+bool PlusFrameFieldKeyTable::FindKey(const std::string& fieldName, KeyType& key)
+{
+  PlusFrameFieldKeyTable& table = GetInstance();
+  std::lock_guard<std::mutex> lock(table.Mutex);
+  std::map<std::string, KeyType>::iterator keyIt = table.KeysByName.find(fieldName);
+  if (keyIt == table.KeysByName.end())
+  {
+    return false;
+  }
+  key = keyIt->second;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+const std::string& PlusFrameFieldKeyTable::GetFieldName(KeyType key)
+{
+  PlusFrameFieldKeyTable& table = GetInstance();
+  std::lock_guard<std::mutex> lock(table.Mutex);
+  return table.Names[key];
+}
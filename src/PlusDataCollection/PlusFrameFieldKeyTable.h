@@ -0,0 +1,51 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusFrameFieldKeyTable_h
+#define __PlusFrameFieldKeyTable_h
+
+#include "PlusConfigure.h"
+#include "vtkPlusDataCollectionExport.h"
+
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+
+/*!
+  \class PlusFrameFieldKeyTable
+  \brief Interned frame field names, so that buffer items can refer to a field name by a small integer key
+
+  Each field name is stored only once, and keeps its key for the lifetime of the process.
+  Frame field names are taken from a small set of device-specific names, so the table does not grow during acquisition.
+  All methods are thread-safe.
+
+  \ingroup PlusLibDataCollection
+*/
+class vtkPlusDataCollectionExport PlusFrameFieldKeyTable
+{
+public:
+  typedef unsigned int KeyType;
+
+  /*! Get the key of a field name, the name is added to the table if it is not in the table yet */
+  static KeyType GetKey(const std::string& fieldName);
+
+  /*! Get the key of a field name without adding it to the table. Returns false if the name is not in the table. */
+  static bool FindKey(const std::string& fieldName, KeyType& key);
+
+  /*! Get the field name of a key. The returned reference remains valid for the lifetime of the process. */
+  static const std::string& GetFieldName(KeyType key);
+
+protected:
+  static PlusFrameFieldKeyTable& GetInstance();
+
+  std::mutex Mutex;
+  std::map<std::string, KeyType> KeysByName;
+  /*! Field names indexed by key. Elements of a deque are not moved when new elements are appended. */
+  std::deque<std::string> Names;
+};
+
+#endif
@@ -0,0 +1,63 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusGpuFrame_h
+#define __PlusGpuFrame_h
+
+#include "PlusConfigure.h"
+#include "vtkPlusDataCollectionExport.h"
+
+#include <memory>
+
+/*!
+  \class PlusGpuFrame
+  \brief Handle of a video frame that is stored in GPU memory by the device that captured it.
+
+  Devices that capture into GPU memory (e.g., SDI capture into an OpenGL buffer object) can add frames to the
+  buffer with a GPU frame handle instead of the pixel data. GPU-capable consumers (encoders, scan conversion,
+  reconstruction) can use the GPU object directly. The pixel data is read back to host memory only when a
+  CPU consumer requests the frame from the buffer.
+
+  The GPU object is reused by the device after a number of frames, after that IsValid() returns false
+  and the frame cannot be read back anymore.
+
+  \ingroup PlusLibDataCollection
+*/
+class vtkPlusDataCollectionExport PlusGpuFrame
+{
+public:
+  enum HandleType
+  {
+    HANDLE_OPENGL_BUFFER,  /*!< OpenGL buffer object, the rows of the image are GetPitchInBytes() apart */
+    HANDLE_OPENGL_TEXTURE  /*!< OpenGL 2D texture */
+  };
+
+  virtual ~PlusGpuFrame() {}
+
+  virtual HandleType GetHandleType() const = 0;
+
+  /*! Name of the OpenGL object */
+  virtual unsigned int GetHandle() const = 0;
+
+  /*! Native OpenGL context that the object belongs to (HGLRC on Windows), consumers have to share objects with it */
+  virtual void* GetContext() const = 0;
+
+  /*! Distance of the rows of the image in the GPU object, in bytes */
+  virtual unsigned int GetPitchInBytes() const = 0;
+
+  /*! Returns false if the GPU object has been reused for a newer frame */
+  virtual bool IsValid() const = 0;
+
+  /*!
+    Copy the pixel data into host memory. The rows of the image are written contiguously (without the pitch).
+    Can be called from any thread, it must not need the capture thread of the device to complete.
+  */
+  virtual PlusStatus ReadBack(void* destination, unsigned int sizeInBytes) = 0;
+};
+
+typedef std::shared_ptr<PlusGpuFrame> PlusGpuFramePtr;
+
+#endif
@@ -0,0 +1,304 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "PlusLockFreeTimestampIndex.h"
+
+// STL includes
+#include <thread>
+
+//----------------------------------------------------------------------------
+PlusLockFreeTimestampIndex::SlotArray::SlotArray(int size)
+  : Size(size)
+  , Timestamps(NULL)
+{
+  if (size > 0)
+  {
+    this->Timestamps = new std::atomic<double>[size];
+    for (int i = 0; i < size; ++i)
+    {
+      this->Timestamps[i].store(0.0, std::memory_order_relaxed);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusLockFreeTimestampIndex::PlusLockFreeTimestampIndex()
+  : Sequence(0)
+  , Slots(new SlotArray(0))
+  , LatestItemUid(0)
+  , LastFoundItemUid(0)
+  , NumberOfItems(0)
+  , LocalTimeOffsetSec(0.0)
+{
+}
+
+//----------------------------------------------------------------------------
+PlusLockFreeTimestampIndex::~PlusLockFreeTimestampIndex()
+{
+  this->RetiredSlots.push_back(this->Slots.load());
+  for (std::vector<SlotArray*>::iterator it = this->RetiredSlots.begin(); it != this->RetiredSlots.end(); ++it)
+  {
+    delete[](*it)->Timestamps;
+    delete *it;
+  }
+  this->RetiredSlots.clear();
+}
+
+//----------------------------------------------------------------------------
+void PlusLockFreeTimestampIndex::BeginWrite()
+{
+  unsigned long long sequence = this->Sequence.load(std::memory_order_relaxed);
+  this->Sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+}
+
+//----------------------------------------------------------------------------
+void PlusLockFreeTimestampIndex::EndWrite()
+{
+  unsigned long long sequence = this->Sequence.load(std::memory_order_relaxed);
+  this->Sequence.store(sequence + 1, std::memory_order_release);
+}
+
+//----------------------------------------------------------------------------
+void PlusLockFreeTimestampIndex::Reset(int size)
+{
+  this->BeginWrite();
+  SlotArray* oldSlots = this->Slots.load(std::memory_order_relaxed);
+  if (oldSlots->Size != size)
+  {
+    this->Slots.store(new SlotArray(size), std::memory_order_relaxed);
+    this->RetiredSlots.push_back(oldSlots);
+  }
+  this->LatestItemUid.store(0, std::memory_order_relaxed);
+  this->NumberOfItems.store(0, std::memory_order_relaxed);
+  this->EndWrite();
+}
+
+//----------------------------------------------------------------------------
+void PlusLockFreeTimestampIndex::PublishItem(BufferItemUidType uid, double filteredTimestamp, int numberOfItems)
+{
+  SlotArray* slots = this->Slots.load(std::memory_order_relaxed);
+  if (slots->Size < 1)
+  {
+    return;
+  }
+  this->BeginWrite();
+  slots->Timestamps[uid % slots->Size].store(filteredTimestamp, std::memory_order_relaxed);
+  this->LatestItemUid.store(uid, std::memory_order_relaxed);
+  this->NumberOfItems.store(std::min(numberOfItems, slots->Size), std::memory_order_relaxed);
+  this->EndWrite();
+}
+
+//----------------------------------------------------------------------------
+void PlusLockFreeTimestampIndex::SetNumberOfItems(int numberOfItems)
+{
+  this->BeginWrite();
+  this->NumberOfItems.store(numberOfItems, std::memory_order_relaxed);
+  this->EndWrite();
+}
+
+//----------------------------------------------------------------------------
+void PlusLockFreeTimestampIndex::SetLocalTimeOffsetSec(double offsetSec)
+{
+  this->LocalTimeOffsetSec.store(offsetSec, std::memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------------
+double PlusLockFreeTimestampIndex::GetSlotTimestamp(const SlotArray* slots, BufferItemUidType uid) const
+{
+  return slots->Timestamps[uid % slots->Size].load(std::memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------------
+void PlusLockFreeTimestampIndex::GetItemUidRange(BufferItemUidType& oldestUid, BufferItemUidType& latestUid, int& numberOfItems) const
+{
+  for (;;)
+  {
+    unsigned long long sequence = this->Sequence.load(std::memory_order_acquire);
+    if (sequence & 1)
+    {
+      // The writer may have been preempted in the middle of a modification, let it run
+      std::this_thread::yield();
+      continue;
+    }
+    latestUid = this->LatestItemUid.load(std::memory_order_relaxed);
+    numberOfItems = this->NumberOfItems.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (this->Sequence.load(std::memory_order_relaxed) == sequence)
+    {
+      // LatestItemUid - ( NumberOfItems - 1 ) is the oldest element in the buffer
+      oldestUid = latestUid - (numberOfItems - 1);
+      return;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+ItemStatus PlusLockFreeTimestampIndex::GetTimeStamp(BufferItemUidType uid, double& timestamp) const
+{
+  for (;;)
+  {
+    unsigned long long sequence = this->Sequence.load(std::memory_order_acquire);
+    if (sequence & 1)
+    {
+      std::this_thread::yield();
+      continue;
+    }
+    const SlotArray* slots = this->Slots.load(std::memory_order_acquire);
+    BufferItemUidType latestUid = this->LatestItemUid.load(std::memory_order_relaxed);
+    int numberOfItems = this->NumberOfItems.load(std::memory_order_relaxed);
+    ItemStatus status = ITEM_OK;
+    double localTimestamp = 0;
+    // Same classification as the locked path: in an empty buffer the oldest UID is LatestItemUid + 1.
+    // A snapshot that is torn by Reset may combine an empty slot array with the previous items, it is discarded below.
+    if (uid > latestUid)
+    {
+      status = ITEM_NOT_AVAILABLE_YET;
+    }
+    else if (slots->Size < 1 || numberOfItems < 1 || uid < latestUid - (numberOfItems - 1))
+    {
+      status = ITEM_NOT_AVAILABLE_ANYMORE;
+    }
+    else
+    {
+      localTimestamp = this->GetSlotTimestamp(slots, uid);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (this->Sequence.load(std::memory_order_relaxed) == sequence)
+    {
+      timestamp = (status == ITEM_OK) ? localTimestamp + this->LocalTimeOffsetSec.load(std::memory_order_relaxed) : 0;
+      return status;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+ItemStatus PlusLockFreeTimestampIndex::GetLatestTimeStamp(double& timestamp) const
+{
+  BufferItemUidType oldestUid(0);
+  BufferItemUidType latestUid(0);
+  int numberOfItems(0);
+  this->GetItemUidRange(oldestUid, latestUid, numberOfItems);
+  return this->GetTimeStamp(latestUid, timestamp);
+}
+
+//----------------------------------------------------------------------------
+ItemStatus PlusLockFreeTimestampIndex::GetOldestTimeStamp(double& timestamp) const
+{
+  // The oldest item may be removed from the buffer at any moment, therefore retry until the UID and timestamp are consistent
+  for (;;)
+  {
+    BufferItemUidType oldestUid(0);
+    BufferItemUidType latestUid(0);
+    int numberOfItems(0);
+    this->GetItemUidRange(oldestUid, latestUid, numberOfItems);
+    ItemStatus status = this->GetTimeStamp(oldestUid, timestamp);
+    if (status != ITEM_NOT_AVAILABLE_ANYMORE || numberOfItems < 1)
+    {
+      return status;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+ItemStatus PlusLockFreeTimestampIndex::GetItemUidFromTime(double time, double negligibleTimeDifferenceSec, BufferItemUidType& uid) const
+{
+  for (;;)
+  {
+    unsigned long long sequence = this->Sequence.load(std::memory_order_acquire);
+    if (sequence & 1)
+    {
+      std::this_thread::yield();
+      continue;
+    }
+    const SlotArray* slots = this->Slots.load(std::memory_order_acquire);
+    BufferItemUidType latestUid = this->LatestItemUid.load(std::memory_order_relaxed);
+    int numberOfItems = this->NumberOfItems.load(std::memory_order_relaxed);
+    double offsetSec = this->LocalTimeOffsetSec.load(std::memory_order_relaxed);
+
+    ItemStatus status = ITEM_OK;
+    BufferItemUidType foundUid = latestUid;
+    if (slots->Size < 1 || numberOfItems < 1)
+    {
+      // Same as the locked path
+      status = ITEM_NOT_AVAILABLE_ANYMORE;
+    }
+    else if (numberOfItems > 1)
+    {
+      BufferItemUidType lo = latestUid - (numberOfItems - 1);
+      BufferItemUidType hi = latestUid;
+      double tlo = this->GetSlotTimestamp(slots, lo) + offsetSec;
+      double thi = this->GetSlotTimestamp(slots, hi) + offsetSec;
+
+      // If the timestamp is slightly out of range then still accept it
+      // (due to errors in conversions there could be slight differences)
+      if (time < tlo - negligibleTimeDifferenceSec)
+      {
+        status = ITEM_NOT_AVAILABLE_ANYMORE;
+      }
+      else if (time > thi + negligibleTimeDifferenceSec)
+      {
+        status = ITEM_NOT_AVAILABLE_YET;
+      }
+      else
+      {
+        // Start from the last hit, as consecutive queries are usually close to each other
+        BufferItemUidType cursor = this->LastFoundItemUid.load(std::memory_order_relaxed);
+        if (cursor > lo && cursor < hi)
+        {
+          double tcursor = this->GetSlotTimestamp(slots, cursor) + offsetSec;
+          if (time < tcursor)
+          {
+            hi = cursor;
+            thi = tcursor;
+          }
+          else
+          {
+            lo = cursor;
+            tlo = tcursor;
+            if (hi - cursor > 1)
+            {
+              double tnext = this->GetSlotTimestamp(slots, cursor + 1) + offsetSec;
+              if (time < tnext)
+              {
+                hi = cursor + 1;
+                thi = tnext;
+              }
+            }
+          }
+        }
+        while (hi - lo > 1)
+        {
+          BufferItemUidType mid = lo + (hi - lo) / 2;
+          double tmid = this->GetSlotTimestamp(slots, mid) + offsetSec;
+          if (time < tmid)
+          {
+            hi = mid;
+            thi = tmid;
+          }
+          else
+          {
+            lo = mid;
+            tlo = tmid;
+          }
+        }
+        foundUid = (time - tlo > thi - time) ? hi : lo;
+      }
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (this->Sequence.load(std::memory_order_relaxed) == sequence)
+    {
+      if (status == ITEM_OK)
+      {
+        uid = foundUid;
+        this->LastFoundItemUid.store(foundUid, std::memory_order_relaxed);
+      }
+      return status;
+    }
+  }
+}
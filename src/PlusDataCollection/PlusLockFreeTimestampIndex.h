@@ -0,0 +1,96 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusLockFreeTimestampIndex_h
+#define __PlusLockFreeTimestampIndex_h
+
+#include "vtkPlusDataCollectionExport.h"
+#include "PlusStreamBufferItem.h"
+#include "vtkPlusTimestampedCircularBuffer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+/*!
+  \class PlusLockFreeTimestampIndex
+  \brief Sequence-locked ring of item UIDs and filtered timestamps for lock-free timestamp queries.
+
+  The index mirrors the UID and filtered timestamp of each item in a vtkPlusTimestampedCircularBuffer.
+  There is a single writer (the thread that adds items to the buffer, while holding the buffer lock) and
+  any number of readers that do not take any lock. Readers take a snapshot between two reads of an even
+  sequence number and retry if the writer modified the index in the meantime (seqlock).
+
+  Slot arrays that are replaced when the size changes are retired but not freed until the index is destroyed,
+  so a reader that is still traversing an old array never accesses freed memory.
+
+  \ingroup PlusLibDataCollection
+*/
+class vtkPlusDataCollectionExport PlusLockFreeTimestampIndex
+{
+public:
+  PlusLockFreeTimestampIndex();
+  ~PlusLockFreeTimestampIndex();
+
+  /*! Set the number of slots and forget all items. Writer only. */
+  void Reset(int size);
+
+  /*! Publish a new item as the latest item. numberOfItems is the number of valid items after adding the new one. Writer only. */
+  void PublishItem(BufferItemUidType uid, double filteredTimestamp, int numberOfItems);
+
+  /*! Set the number of valid items without adding a new one (e.g., when the oldest item is dropped). Writer only. */
+  void SetNumberOfItems(int numberOfItems);
+
+  /*! Set the time offset that is added to all timestamps (global = local + offset) */
+  void SetLocalTimeOffsetSec(double offsetSec);
+
+  /*! Get the latest and oldest item UID and the number of items from a consistent snapshot */
+  void GetItemUidRange(BufferItemUidType& oldestUid, BufferItemUidType& latestUid, int& numberOfItems) const;
+
+  /*! Get the filtered timestamp of an item in global time */
+  ItemStatus GetTimeStamp(BufferItemUidType uid, double& timestamp) const;
+
+  /*! Get the filtered timestamp of the latest or oldest item in global time */
+  ItemStatus GetLatestTimeStamp(double& timestamp) const;
+  ItemStatus GetOldestTimeStamp(double& timestamp) const;
+
+  /*! Given a timestamp, find the UID of the closest item. The semantics are the same as vtkPlusTimestampedCircularBuffer::GetItemUidFromTime. */
+  ItemStatus GetItemUidFromTime(double time, double negligibleTimeDifferenceSec, BufferItemUidType& uid) const;
+
+protected:
+  struct SlotArray
+  {
+    explicit SlotArray(int size);
+    int Size;
+    std::atomic<double>* Timestamps;
+  };
+
+  /*! Begin and end a modification of the index by the writer */
+  void BeginWrite();
+  void EndWrite();
+
+  /*! Read the timestamp of an item from the current slot array (caller validates the snapshot and checks that the array is not empty) */
+  double GetSlotTimestamp(const SlotArray* slots, BufferItemUidType uid) const;
+
+  /*! Odd while the writer is modifying the index */
+  mutable std::atomic<unsigned long long> Sequence;
+
+  std::atomic<SlotArray*> Slots;
+  std::atomic<BufferItemUidType> LatestItemUid;
+  /*! UID returned by the last successful GetItemUidFromTime call, used as a starting point for the next search */
+  mutable std::atomic<BufferItemUidType> LastFoundItemUid;
+  std::atomic<int> NumberOfItems;
+  std::atomic<double> LocalTimeOffsetSec;
+
+  /*! Slot arrays that have been replaced, kept alive until destruction (readers may still access them) */
+  std::vector<SlotArray*> RetiredSlots;
+
+private:
+  PlusLockFreeTimestampIndex(const PlusLockFreeTimestampIndex&);
+  void operator=(const PlusLockFreeTimestampIndex&);
+};
+
+#endif
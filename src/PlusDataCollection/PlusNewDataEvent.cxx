@@ -0,0 +1,44 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "PlusNewDataEvent.h"
+
+#include <chrono>
+
+//----------------------------------------------------------------------------
+PlusNewDataEvent::PlusNewDataEvent()
+  : Signaled(false)
+{
+}
+
+//----------------------------------------------------------------------------
+PlusNewDataEvent::~PlusNewDataEvent()
+{
+}
+
+//----------------------------------------------------------------------------
+void PlusNewDataEvent::Signal()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    this->Signaled = true;
+  }
+  this->Condition.notify_all();
+}
+
+//----------------------------------------------------------------------------
+bool PlusNewDataEvent::Wait(double timeoutSec)
+{
+  std::unique_lock<std::mutex> lock(this->Mutex);
+  if (timeoutSec > 0)
+  {
+    this->Condition.wait_for(lock, std::chrono::duration<double>(timeoutSec), [this] { return this->Signaled; });
+  }
+  bool signaled = this->Signaled;
+  this->Signaled = false;
+  return signaled;
+}
@@ -0,0 +1,50 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusNewDataEvent_h
+#define __PlusNewDataEvent_h
+
+#include "vtkPlusDataCollectionExport.h"
+
+#include <condition_variable>
+#include <mutex>
+
+/*!
+  \class PlusNewDataEvent
+  \brief Auto-reset event that is signaled by buffers when a new item is added.
+
+  A consumer (typically the data capture thread of a virtual device) registers the event in the buffers
+  of its input channels and waits on it instead of sleeping for a full acquisition period.
+  A signal that arrives while the consumer is not waiting is not lost: the next Wait call returns immediately.
+
+  \ingroup PlusLibDataCollection
+*/
+class vtkPlusDataCollectionExport PlusNewDataEvent
+{
+public:
+  PlusNewDataEvent();
+  ~PlusNewDataEvent();
+
+  /*! Signal that new data is available and wake up the waiting thread */
+  void Signal();
+
+  /*!
+    Wait until the event is signaled or the timeout expires, then reset the event.
+    \return true if the event was signaled, false if the timeout expired
+  */
+  bool Wait(double timeoutSec);
+
+protected:
+  std::mutex Mutex;
+  std::condition_variable Condition;
+  bool Signaled;
+
+private:
+  PlusNewDataEvent(const PlusNewDataEvent&);
+  void operator=(const PlusNewDataEvent&);
+};
+
+#endif
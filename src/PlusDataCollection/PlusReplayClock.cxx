@@ -0,0 +1,240 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "PlusNewDataEvent.h"
+#include "PlusReplayClock.h"
+
+#include <cfloat>
+
+//----------------------------------------------------------------------------
+PlusReplayClock& PlusReplayClock::GetInstance()
+{
+  // Initialization of function-local statics is thread-safe
+  static PlusReplayClock instance;
+  return instance;
+}
+
+//----------------------------------------------------------------------------
+PlusReplayClock::PlusReplayClock()
+  : Enabled(false)
+  , Generation(0)
+  , Paused(false)
+  , Time(0.0)
+{
+}
+
+//----------------------------------------------------------------------------
+void PlusReplayClock::AddProducer(const void* owner, std::shared_ptr<PlusNewDataEvent> wakeUpEvent)
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  Producer producer = { owner, wakeUpEvent, -DBL_MAX };
+  this->Producers.push_back(producer);
+  this->Enabled = true;
+}
+
+//----------------------------------------------------------------------------
+void PlusReplayClock::RemoveProducer(const void* owner)
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  for (std::vector<Producer>::iterator it = this->Producers.begin(); it != this->Producers.end(); ++it)
+  {
+    if (it->Owner == owner)
+    {
+      this->Producers.erase(it);
+      break;
+    }
+  }
+  this->Enabled = !this->Producers.empty();
+  // The remaining producers may have been waiting for the removed one
+  this->SignalProducers();
+}
+
+//----------------------------------------------------------------------------
+bool PlusReplayClock::RequestTurn(const void* owner, double nextFrameTimestamp)
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  const Producer* earliestProducer = NULL;
+  for (std::vector<Producer>::iterator it = this->Producers.begin(); it != this->Producers.end(); ++it)
+  {
+    if (it->Owner == owner)
+    {
+      it->NextFrameTimestamp = nextFrameTimestamp;
+    }
+    if (earliestProducer == NULL || it->NextFrameTimestamp < earliestProducer->NextFrameTimestamp)
+    {
+      earliestProducer = &(*it);
+    }
+  }
+  if (earliestProducer == NULL)
+  {
+    return false;
+  }
+  if (earliestProducer->Owner != owner)
+  {
+    // Another producer goes first, make sure that it does not wait for a timeout
+    if (earliestProducer->WakeUpEvent)
+    {
+      earliestProducer->WakeUpEvent->Signal();
+    }
+    return false;
+  }
+  return !this->Paused && this->IsSettledInternal();
+}
+
+//----------------------------------------------------------------------------
+void PlusReplayClock::CompleteTurn(const void* vtkNotUsed(owner), double frameTimestamp)
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  this->Time = frameTimestamp;
+  if (this->IsSettledInternal())
+  {
+    // No consumer has data to process, the next frame can be added right away
+    this->SignalProducers();
+  }
+}
+
+//----------------------------------------------------------------------------
+void PlusReplayClock::SetProducerFinished(const void* owner)
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  for (std::vector<Producer>::iterator it = this->Producers.begin(); it != this->Producers.end(); ++it)
+  {
+    if (it->Owner == owner && it->NextFrameTimestamp != DBL_MAX)
+    {
+      it->NextFrameTimestamp = DBL_MAX;
+      this->SignalProducers();
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+void PlusReplayClock::AddConsumer(const void* owner, std::shared_ptr<PlusNewDataEvent> newDataEvent)
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  Consumer consumer = { owner, newDataEvent, 0 };
+  this->Consumers.push_back(consumer);
+  // Make the consumer acknowledge the current generation as soon as possible
+  if (newDataEvent)
+  {
+    newDataEvent->Signal();
+  }
+}
+
+//----------------------------------------------------------------------------
+void PlusReplayClock::RemoveConsumer(const void* owner)
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  for (std::vector<Consumer>::iterator it = this->Consumers.begin(); it != this->Consumers.end(); ++it)
+  {
+    if (it->Owner == owner)
+    {
+      this->Consumers.erase(it);
+      break;
+    }
+  }
+  if (this->IsSettledInternal())
+  {
+    this->SignalProducers();
+  }
+}
+
+//----------------------------------------------------------------------------
+unsigned long long PlusReplayClock::GetGeneration()
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  return this->Generation;
+}
+
+//----------------------------------------------------------------------------
+void PlusReplayClock::AcknowledgeGeneration(const void* owner, unsigned long long generation)
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  for (std::vector<Consumer>::iterator it = this->Consumers.begin(); it != this->Consumers.end(); ++it)
+  {
+    if (it->Owner == owner)
+    {
+      it->AcknowledgedGeneration = generation;
+      if (generation == this->Generation && this->IsSettledInternal())
+      {
+        this->SignalProducers();
+      }
+      return;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+void PlusReplayClock::NotifyDataAdded()
+{
+  if (!this->IsEnabled())
+  {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  this->Generation++;
+  for (std::vector<Consumer>::iterator it = this->Consumers.begin(); it != this->Consumers.end(); ++it)
+  {
+    if (it->NewDataEvent)
+    {
+      it->NewDataEvent->Signal();
+    }
+  }
+  if (this->IsSettledInternal())
+  {
+    this->SignalProducers();
+  }
+}
+
+//----------------------------------------------------------------------------
+void PlusReplayClock::SetPaused(bool paused)
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  this->Paused = paused;
+  if (!paused)
+  {
+    this->SignalProducers();
+  }
+}
+
+//----------------------------------------------------------------------------
+double PlusReplayClock::GetTime()
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  return this->Time;
+}
+
+//----------------------------------------------------------------------------
+bool PlusReplayClock::IsSettled()
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  return this->IsSettledInternal();
+}
+
+//----------------------------------------------------------------------------
+bool PlusReplayClock::IsSettledInternal() const
+{
+  for (std::vector<Consumer>::const_iterator it = this->Consumers.begin(); it != this->Consumers.end(); ++it)
+  {
+    if (it->AcknowledgedGeneration != this->Generation)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void PlusReplayClock::SignalProducers()
+{
+  for (std::vector<Producer>::iterator it = this->Producers.begin(); it != this->Producers.end(); ++it)
+  {
+    if (it->WakeUpEvent)
+    {
+      it->WakeUpEvent->Signal();
+    }
+  }
+}
@@ -0,0 +1,124 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusReplayClock_h
+#define __PlusReplayClock_h
+
+#include "vtkPlusDataCollectionExport.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class PlusNewDataEvent;
+
+/*!
+  \class PlusReplayClock
+  \brief Process-wide simulated clock for replaying recorded data faster than real time, with deterministic delivery.
+
+  Producers (saved data sources with VirtualClockEnabled) do not replay frames at the pace of the system clock.
+  Instead, a producer may add its next frame only when every consumer has processed all the data added so far,
+  so the whole pipeline runs as fast as its slowest consumer and each consumer sees the frames one by one, in the
+  same order on every run. The simulated time is the timestamp of the last replayed frame.
+
+  Consumers are the devices that wait for new data in their input channels (see vtkPlusDevice::WaitForInputData).
+  Each time an item is added to any buffer the generation of the clock is incremented and the consumers are woken up.
+  A consumer acknowledges the generation that it read before its update, so the pipeline is settled when all
+  consumers have acknowledged the current generation: none of them can have unprocessed input then, not even
+  data that was produced by another consumer. Devices that poll their inputs without waiting for new data are not
+  tracked, they see the replayed frames at the rate at which they poll.
+
+  If there are multiple producers then the one with the earliest next frame timestamp goes first, ties are broken
+  by the order of registration.
+
+  The clock is enabled while at least one producer is registered, otherwise all calls return immediately.
+
+  \ingroup PlusLibDataCollection
+*/
+class vtkPlusDataCollectionExport PlusReplayClock
+{
+public:
+  static PlusReplayClock& GetInstance();
+
+  /*! True if at least one producer is registered */
+  bool IsEnabled() const { return this->Enabled.load(std::memory_order_relaxed); }
+
+  /*! Register a producer. The wake-up event is signaled when the producer may be able to add its next frame. */
+  void AddProducer(const void* owner, std::shared_ptr<PlusNewDataEvent> wakeUpEvent);
+  void RemoveProducer(const void* owner);
+
+  /*!
+    Returns true if the producer may add its next frame with the given timestamp now: the pipeline is settled,
+    delivery is not paused and no other producer has an earlier frame. The producer must call CompleteTurn after
+    adding the frame.
+  */
+  bool RequestTurn(const void* owner, double nextFrameTimestamp);
+
+  /*! Set the simulated time to the timestamp of the frame that the producer has added */
+  void CompleteTurn(const void* owner, double frameTimestamp);
+
+  /*! The producer has no more frames, the other producers do not wait for it anymore */
+  void SetProducerFinished(const void* owner);
+
+  /*! Register a consumer. The event is signaled each time new data is added to any buffer. */
+  void AddConsumer(const void* owner, std::shared_ptr<PlusNewDataEvent> newDataEvent);
+  void RemoveConsumer(const void* owner);
+
+  /*! Generation of the data in the buffers, read by consumers before an update */
+  unsigned long long GetGeneration();
+
+  /*! Called by consumers after an update with the generation that they read before the update */
+  void AcknowledgeGeneration(const void* owner, unsigned long long generation);
+
+  /*! Called by buffers when an item is added */
+  void NotifyDataAdded();
+
+  /*! Pause delivery, e.g., while the devices are started and not all consumers are registered yet */
+  void SetPaused(bool paused);
+
+  /*! Simulated time: timestamp of the last replayed frame (system time reference) */
+  double GetTime();
+
+  /*! True if all consumers have processed all the data added so far */
+  bool IsSettled();
+
+protected:
+  PlusReplayClock();
+
+  struct Producer
+  {
+    const void* Owner;
+    std::shared_ptr<PlusNewDataEvent> WakeUpEvent;
+    /*! Timestamp of the next frame, lowest value until the producer reports it, highest value when finished */
+    double NextFrameTimestamp;
+  };
+
+  struct Consumer
+  {
+    const void* Owner;
+    std::shared_ptr<PlusNewDataEvent> NewDataEvent;
+    unsigned long long AcknowledgedGeneration;
+  };
+
+  /*! The caller must hold the mutex */
+  bool IsSettledInternal() const;
+  void SignalProducers();
+
+  std::atomic<bool> Enabled;
+  std::mutex Mutex;
+  std::vector<Producer> Producers;
+  std::vector<Consumer> Consumers;
+  unsigned long long Generation;
+  bool Paused;
+  double Time;
+
+private:
+  PlusReplayClock(const PlusReplayClock&);
+  void operator=(const PlusReplayClock&);
+};
+
+#endif
@@ -7,11 +7,21 @@
 #include "PlusConfigure.h"
 #include "PlusSerialLine.h"
 
+// STL includes
+#include <algorithm>
+#include <chrono>
+
 //----------------------------------------------------------------------------
 SerialLine::SerialLine()
   : MaxReplyTime(1000)
   , SerialPortSpeed(9600)
   , CommHandle(INVALID_HANDLE_VALUE)
+  , AsynchronousMode(false)
+  , ReceiveThreadRunning(false)
+  , ReceiveBufferStart(0)
+  , ReceiveBufferCount(0)
+  , ReceiveBufferSize(65536)
+  , ReceiveBufferOverflowReported(false)
 {
 
 }
@@ -29,6 +39,14 @@ SerialLine::~SerialLine()
 void SerialLine::Close()
 {
 #ifdef _WIN32
+  if (this->ReceiveThread.joinable())
+  {
+    this->ReceiveThreadRunning = false;
+    // Abort the pending read of the receiver thread
+    CancelIoEx(CommHandle, NULL);
+    this->ReceiveThread.join();
+  }
+  this->ReceiveBufferCondition.notify_all();
   if (CommHandle != INVALID_HANDLE_VALUE)
   {
     CloseHandle(CommHandle);
@@ -51,7 +69,7 @@ bool SerialLine::Open()
                           GENERIC_READ | GENERIC_WRITE,
                           0,  // not allowed to share ports
                           0,  // child-processes don't inherit handle
-                          OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                          OPEN_EXISTING, this->AsynchronousMode ? FILE_FLAG_OVERLAPPED : FILE_ATTRIBUTE_NORMAL,
                           NULL); /* no template file */
   if (CommHandle == INVALID_HANDLE_VALUE)
   {
@@ -77,9 +95,19 @@ bool SerialLine::Open()
 
   COMMTIMEOUTS timeouts;
   GetCommTimeouts(CommHandle, &timeouts);
-  timeouts.ReadIntervalTimeout = 200;
-  timeouts.ReadTotalTimeoutConstant = MaxReplyTime;
-  timeouts.ReadTotalTimeoutMultiplier = 100;
+  if (this->AsynchronousMode)
+  {
+    // A read returns as soon as at least one byte is received (or after MaxReplyTime if nothing is received)
+    timeouts.ReadIntervalTimeout = MAXDWORD;
+    timeouts.ReadTotalTimeoutMultiplier = MAXDWORD;
+    timeouts.ReadTotalTimeoutConstant = MaxReplyTime;
+  }
+  else
+  {
+    timeouts.ReadIntervalTimeout = 200;
+    timeouts.ReadTotalTimeoutConstant = MaxReplyTime;
+    timeouts.ReadTotalTimeoutMultiplier = 100;
+  }
   timeouts.WriteTotalTimeoutConstant = MaxReplyTime;
   timeouts.WriteTotalTimeoutMultiplier = 100;
   if (!SetCommTimeouts(CommHandle, &timeouts))
@@ -88,6 +116,19 @@ bool SerialLine::Open()
     return false;
   }
 
+  if (this->AsynchronousMode)
+  {
+    {
+      std::lock_guard<std::mutex> lock(this->ReceiveBufferMutex);
+      this->ReceiveBuffer.assign((std::max)(this->ReceiveBufferSize, 1u), 0);
+      this->ReceiveBufferStart = 0;
+      this->ReceiveBufferCount = 0;
+      this->ReceiveBufferOverflowReported = false;
+    }
+    this->ReceiveThreadRunning = true;
+    this->ReceiveThread = std::thread(&SerialLine::ReceiveThreadFn, this);
+  }
+
   return true;
 #else
   LOG_ERROR("SerialLine::Open() is only implemented on Windows");
@@ -100,6 +141,28 @@ bool SerialLine::Open()
 int SerialLine::Write(const BYTE* data, int numberOfBytesToWrite)
 {
 #ifdef _WIN32
+  if (this->AsynchronousMode)
+  {
+    OVERLAPPED overlapped = { 0 };
+    overlapped.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    DWORD numberOfBytesWritten = 0;
+    if (WriteFile(CommHandle, data, numberOfBytesToWrite, &numberOfBytesWritten, &overlapped) == FALSE)
+    {
+      if (GetLastError() == ERROR_IO_PENDING)
+      {
+        // the write timeouts of the port are set, so waiting for the completion cannot block forever
+        GetOverlappedResult(CommHandle, &overlapped, &numberOfBytesWritten, TRUE);
+      }
+      else
+      {
+        DWORD errors = 0;
+        ClearCommError(CommHandle, &errors, NULL);
+      }
+    }
+    CloseHandle(overlapped.hEvent);
+    return numberOfBytesWritten;
+  }
+
   int numberOfBytesWrittenTotal = 0;
   while (numberOfBytesToWrite > 0)
   {
@@ -144,6 +207,32 @@ bool SerialLine::Write(const BYTE data)
 int SerialLine::Read(BYTE* data, int maxNumberOfBytesToRead)
 {
 #ifdef _WIN32
+  if (this->AsynchronousMode)
+  {
+    if (maxNumberOfBytesToRead <= 0)
+    {
+      return 0;
+    }
+    // Wait for the requested number of bytes, but maximum MaxReplyTime (same as the read timeout in synchronous mode)
+    std::unique_lock<std::mutex> lock(this->ReceiveBufferMutex);
+    this->ReceiveBufferCondition.wait_for(lock, std::chrono::milliseconds(this->MaxReplyTime), [this, maxNumberOfBytesToRead]
+    {
+      return this->ReceiveBufferCount >= static_cast<unsigned int>(maxNumberOfBytesToRead) || !this->ReceiveThreadRunning;
+    });
+    const unsigned int numberOfBytesRead = (std::min)(this->ReceiveBufferCount, static_cast<unsigned int>(maxNumberOfBytesToRead));
+    const unsigned int bufferSize = static_cast<unsigned int>(this->ReceiveBuffer.size());
+    for (unsigned int i = 0; i < numberOfBytesRead; ++i)
+    {
+      data[i] = this->ReceiveBuffer[(this->ReceiveBufferStart + i) % bufferSize];
+    }
+    if (numberOfBytesRead > 0)
+    {
+      this->ReceiveBufferStart = (this->ReceiveBufferStart + numberOfBytesRead) % bufferSize;
+      this->ReceiveBufferCount -= numberOfBytesRead;
+    }
+    return numberOfBytesRead;
+  }
+
   int numberOfBytesReadTotal = 0;
   while (maxNumberOfBytesToRead > 0)
   {
@@ -226,6 +315,11 @@ bool SerialLine::IsHandleAlive() const
 unsigned int SerialLine::GetNumberOfBytesAvailableForReading() const
 {
 #ifdef _WIN32
+  if (this->AsynchronousMode)
+  {
+    std::lock_guard<std::mutex> lock(this->ReceiveBufferMutex);
+    return this->ReceiveBufferCount;
+  }
   DWORD dwErrorFlags = 0;
   COMSTAT comStat;
   ClearCommError(CommHandle, &dwErrorFlags, &comStat);
@@ -315,3 +409,135 @@ PlusStatus SerialLine::GetCTS(bool & onOff)
   return PLUS_FAIL;
 #endif
 }
+
+//----------------------------------------------------------------------------
+bool SerialLine::WaitForData(int timeoutMs)
+{
+  if (this->AsynchronousMode)
+  {
+    std::unique_lock<std::mutex> lock(this->ReceiveBufferMutex);
+    return this->ReceiveBufferCondition.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this]
+    {
+      return this->ReceiveBufferCount > 0 || !this->ReceiveThreadRunning;
+    }) && this->ReceiveBufferCount > 0;
+  }
+
+  // Synchronous mode: the driver does not notify about incoming data, so check it periodically
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+  while (this->GetNumberOfBytesAvailableForReading() == 0)
+  {
+    if (std::chrono::steady_clock::now() >= deadline)
+    {
+      return false;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void SerialLine::SetDataReceivedCallback(DataReceivedCallbackType callback)
+{
+  this->DataReceivedCallback = callback;
+}
+
+//----------------------------------------------------------------------------
+void SerialLine::SetAsynchronousMode(bool enable)
+{
+  if (this->IsHandleAlive())
+  {
+    LOG_ERROR("SerialLine::SetAsynchronousMode() must be called before the serial port is opened");
+    return;
+  }
+  this->AsynchronousMode = enable;
+}
+
+//----------------------------------------------------------------------------
+bool SerialLine::GetAsynchronousMode() const
+{
+  return this->AsynchronousMode;
+}
+
+//----------------------------------------------------------------------------
+void SerialLine::SetReceiveBufferSize(unsigned int size)
+{
+  this->ReceiveBufferSize = size;
+}
+
+//----------------------------------------------------------------------------
+unsigned int SerialLine::GetReceiveBufferSize() const
+{
+  return this->ReceiveBufferSize;
+}
+
+//----------------------------------------------------------------------------
+void SerialLine::ReceiveThreadFn()
+{
+#ifdef _WIN32
+  OVERLAPPED overlapped = { 0 };
+  overlapped.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+  BYTE receivedData[4096];
+  while (this->ReceiveThreadRunning)
+  {
+    ResetEvent(overlapped.hEvent);
+    DWORD numberOfBytesRead = 0;
+    if (ReadFile(CommHandle, receivedData, sizeof(receivedData), &numberOfBytesRead, &overlapped) == FALSE)
+    {
+      if (GetLastError() != ERROR_IO_PENDING)
+      {
+        // system error: clear error and retry
+        DWORD errors = 0;
+        ClearCommError(CommHandle, &errors, NULL);
+        continue;
+      }
+      // Returns when a byte is received, the read timeout elapses or the read is cancelled by Close()
+      if (GetOverlappedResult(CommHandle, &overlapped, &numberOfBytesRead, TRUE) == FALSE)
+      {
+        if (GetLastError() != ERROR_OPERATION_ABORTED)
+        {
+          DWORD errors = 0;
+          ClearCommError(CommHandle, &errors, NULL);
+        }
+        continue;
+      }
+    }
+    if (numberOfBytesRead > 0)
+    {
+      this->AddReceivedData(receivedData, numberOfBytesRead);
+    }
+  }
+  CloseHandle(overlapped.hEvent);
+#endif
+}
+
+//----------------------------------------------------------------------------
+void SerialLine::AddReceivedData(const BYTE* data, unsigned int numberOfBytes)
+{
+  unsigned int numberOfBytesAvailable = 0;
+  {
+    std::lock_guard<std::mutex> lock(this->ReceiveBufferMutex);
+    const unsigned int bufferSize = static_cast<unsigned int>(this->ReceiveBuffer.size());
+    for (unsigned int i = 0; i < numberOfBytes; ++i)
+    {
+      if (this->ReceiveBufferCount == bufferSize)
+      {
+        // Buffer is full, drop the oldest byte
+        this->ReceiveBufferStart = (this->ReceiveBufferStart + 1) % bufferSize;
+        this->ReceiveBufferCount--;
+        if (!this->ReceiveBufferOverflowReported)
+        {
+          LOG_WARNING("Serial port " << this->PortName << " receive buffer is full (" << bufferSize << " bytes), the oldest received data is dropped. Data is not read fast enough or the receive buffer size has to be increased.");
+          this->ReceiveBufferOverflowReported = true;
+        }
+      }
+      this->ReceiveBuffer[(this->ReceiveBufferStart + this->ReceiveBufferCount) % bufferSize] = data[i];
+      this->ReceiveBufferCount++;
+    }
+    numberOfBytesAvailable = this->ReceiveBufferCount;
+  }
+  this->ReceiveBufferCondition.notify_all();
+  if (this->DataReceivedCallback)
+  {
+    this->DataReceivedCallback(numberOfBytesAvailable);
+  }
+}
@@ -14,7 +14,13 @@ See License.txt for details.
   #define INVALID_HANDLE_VALUE (-1)
 #endif
 
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 /*!
 \class SerialLine
@@ -23,6 +29,11 @@ See License.txt for details.
 The class currently only works on Windows. If serial communication is needed on other platforms then
 sample code can be found in src\Utilities\ndicapi\ndicapi_serial.* or at https://github.com/wjwwood/serial.
 
+In asynchronous mode the port is opened for overlapped I/O and a receiver thread copies the incoming data
+into an internal ring buffer as soon as it arrives. Read() then takes the data from the ring buffer,
+GetNumberOfBytesAvailableForReading() does not need a system call and WaitForData() blocks on an event instead of polling.
+A callback can be set that is called by the receiver thread when new data is received.
+
 \ingroup PlusLibDataCollection
 */
 
@@ -60,6 +71,29 @@ public:
   /*! Read a single byte from the serial port. Returns true if successful. */
   bool Read(BYTE& data);
 
+  /*!
+    Wait until data is available for reading, but maximum timeoutMs milliseconds.
+    Returns true if data is available. In asynchronous mode it does not use any CPU time while waiting.
+  */
+  bool WaitForData(int timeoutMs);
+
+  /*!
+    Callback that is called by the receiver thread in asynchronous mode when new data is received.
+    The parameter is the number of bytes available for reading.
+    The callback must return quickly and must not call Read(), as the receiver thread does not receive new data while the callback is running.
+    It must be set before Open() is called.
+  */
+  typedef std::function<void(unsigned int numberOfBytesAvailable)> DataReceivedCallbackType;
+  void SetDataReceivedCallback(DataReceivedCallbackType callback);
+
+  /*! Enable asynchronous (overlapped) I/O. It must be set before Open() is called. Default is false. */
+  void SetAsynchronousMode(bool enable);
+  bool GetAsynchronousMode() const;
+
+  /*! Size of the receive ring buffer that is used in asynchronous mode, in bytes. If the buffer is full then the oldest bytes are dropped. Default is 65536. */
+  void SetReceiveBufferSize(unsigned int size);
+  unsigned int GetReceiveBufferSize() const;
+
   /*! Set the serial port name e.g. COM1 */
   SetStdStringMacro(PortName);
   /*! Get the serial port name */
@@ -96,10 +130,30 @@ public:
   DWORD ClearError();
 
 private:
+  /*! Receive data into the ring buffer in asynchronous mode, until ReceiveThreadRunning is cleared */
+  void ReceiveThreadFn();
+
+  /*! Append data to the receive ring buffer and notify the waiting readers and the callback */
+  void AddReceivedData(const BYTE* data, unsigned int numberOfBytes);
+
   HANDLE      CommHandle;
   std::string PortName;
   DWORD       SerialPortSpeed;
   int         MaxReplyTime;
+
+  bool                      AsynchronousMode;
+  std::thread               ReceiveThread;
+  std::atomic<bool>         ReceiveThreadRunning;
+  DataReceivedCallbackType  DataReceivedCallback;
+
+  /*! Receive ring buffer, the first unread byte is at ReceiveBufferStart */
+  std::vector<BYTE>         ReceiveBuffer;
+  unsigned int              ReceiveBufferStart;
+  unsigned int              ReceiveBufferCount;
+  unsigned int              ReceiveBufferSize;
+  bool                      ReceiveBufferOverflowReported;
+  mutable std::mutex        ReceiveBufferMutex;
+  std::condition_variable   ReceiveBufferCondition;
 };
 
 #endif
\ No newline at end of file
@@ -6,7 +6,40 @@
 
 #include "PlusConfigure.h"
 #include "PlusStreamBufferItem.h"
+#include "vtkDataArray.h"
+#include "vtkImageData.h"
 #include "vtkMatrix4x4.h"
+#include "vtkPointData.h"
+
+// VTK includes
+#include <vtk_zlib.h>
+
+// STL includes
+#include <utility>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  vtkSmartPointer<vtkDataArray> CreateScalarsLike(vtkDataArray* scalars, vtkIdType numberOfTuples)
+  {
+    vtkSmartPointer<vtkDataArray> newScalars = vtkSmartPointer<vtkDataArray>::Take(vtkDataArray::CreateDataArray(scalars->GetDataType()));
+    newScalars->SetNumberOfComponents(scalars->GetNumberOfComponents());
+    newScalars->SetNumberOfTuples(numberOfTuples);
+    newScalars->SetName(scalars->GetName());
+    return newScalars;
+  }
+
+  //----------------------------------------------------------------------------
+  vtkDataArray* GetFrameScalars(igsioVideoFrame& frame)
+  {
+    vtkImageData* image = frame.GetImage();
+    if (frame.IsFrameEncoded() || image == NULL || image->GetPointData() == NULL)
+    {
+      return NULL;
+    }
+    return image->GetPointData()->GetScalars();
+  }
+}
 
 //----------------------------------------------------------------------------
 //            DataBufferItem
@@ -16,9 +49,11 @@ StreamBufferItem::StreamBufferItem()
   , UnfilteredTimeStamp(0)
   , Index(0)
   , Uid(0)
+  , NumberOfFrameFields(0)
   , ValidTransformData(false)
   , Matrix(vtkSmartPointer<vtkMatrix4x4>::New())
   , Status(TOOL_OK)
+  , HostFrameValid(true)
 {
 }
 
@@ -32,6 +67,8 @@ StreamBufferItem::StreamBufferItem(const StreamBufferItem& dataItem)
 {
   this->Matrix = vtkSmartPointer<vtkMatrix4x4>::New();
   this->Status = TOOL_OK;
+  this->NumberOfFrameFields = 0;
+  this->HostFrameValid = true;
   *this = dataItem;
 }
 
@@ -49,19 +86,86 @@ StreamBufferItem& StreamBufferItem::operator=(StreamBufferItem const& dataItem)
   this->UnfilteredTimeStamp = dataItem.UnfilteredTimeStamp;
   this->Index = dataItem.Index;
   this->Uid = dataItem.Uid;
-  this->FrameFields = dataItem.FrameFields;
+  this->CopyFrameFields(dataItem);
   this->Status = dataItem.Status;
   this->Matrix->DeepCopy(dataItem.Matrix);
   this->ValidTransformData = dataItem.ValidTransformData;
+  this->GpuFrame = dataItem.GpuFrame;
+  this->HostFrameValid = dataItem.HostFrameValid;
+  this->CompressedPixels = dataItem.CompressedPixels;
+  this->SourceBitstream = dataItem.SourceBitstream;
 
   return *this;
 }
 
 //----------------------------------------------------------------------------
-void StreamBufferItem::SetFrameField(std::string fieldName, std::string fieldValue, igsioFrameFieldFlags flags)
+void StreamBufferItem::SetFrameField(const std::string& fieldName, const std::string& fieldValue, igsioFrameFieldFlags flags)
+{
+  const PlusFrameFieldKeyTable::KeyType key = PlusFrameFieldKeyTable::GetKey(fieldName);
+  int fieldIndex = this->FindFrameField(key);
+  if (fieldIndex < 0)
+  {
+    fieldIndex = this->NumberOfFrameFields++;
+    if (fieldIndex >= static_cast<int>(this->FrameFields.size()))
+    {
+      this->FrameFields.resize(fieldIndex + 1);
+    }
+    this->FrameFields[fieldIndex].Key = key;
+  }
+  this->FrameFields[fieldIndex].Flags = flags;
+  // Assignment reuses the memory of the previous value
+  this->FrameFields[fieldIndex].Value = fieldValue;
+}
+
+//----------------------------------------------------------------------------
+void StreamBufferItem::SetFrameFields(const igsioFieldMapType& fields)
+{
+  this->ClearFrameFields();
+  for (igsioFieldMapType::const_iterator it = fields.begin(); it != fields.end(); ++it)
+  {
+    this->SetFrameField(it->first, it->second.second, it->second.first);
+  }
+}
+
+//----------------------------------------------------------------------------
+igsioFieldMapType StreamBufferItem::GetFrameFieldMap() const
+{
+  igsioFieldMapType fields;
+  for (unsigned int i = 0; i < this->NumberOfFrameFields; ++i)
+  {
+    const FrameField& field = this->FrameFields[i];
+    fields[PlusFrameFieldKeyTable::GetFieldName(field.Key)] = std::make_pair(field.Flags, field.Value);
+  }
+  return fields;
+}
+
+//----------------------------------------------------------------------------
+int StreamBufferItem::FindFrameField(PlusFrameFieldKeyTable::KeyType key) const
 {
-  this->FrameFields[fieldName].first = flags;
-  this->FrameFields[fieldName].second = fieldValue;
+  for (unsigned int i = 0; i < this->NumberOfFrameFields; ++i)
+  {
+    if (this->FrameFields[i].Key == key)
+    {
+      return i;
+    }
+  }
+  return -1;
+}
+
+//----------------------------------------------------------------------------
+void StreamBufferItem::CopyFrameFields(const StreamBufferItem& dataItem)
+{
+  if (this->FrameFields.size() < dataItem.NumberOfFrameFields)
+  {
+    this->FrameFields.resize(dataItem.NumberOfFrameFields);
+  }
+  for (unsigned int i = 0; i < dataItem.NumberOfFrameFields; ++i)
+  {
+    this->FrameFields[i].Key = dataItem.FrameFields[i].Key;
+    this->FrameFields[i].Flags = dataItem.FrameFields[i].Flags;
+    this->FrameFields[i].Value = dataItem.FrameFields[i].Value;
+  }
+  this->NumberOfFrameFields = dataItem.NumberOfFrameFields;
 }
 
 //----------------------------------------------------------------------------
@@ -73,11 +177,15 @@ std::string StreamBufferItem::GetFrameField(const std::string& fieldName) const
     return "";
   }
 
-  igsioFieldMapType::const_iterator fieldIterator;
-  fieldIterator = this->FrameFields.find(fieldName);
-  if (fieldIterator != this->FrameFields.end())
+  PlusFrameFieldKeyTable::KeyType key = 0;
+  if (!PlusFrameFieldKeyTable::FindKey(fieldName, key))
   {
-    return fieldIterator->second.second;
+    return "";
+  }
+  const int fieldIndex = this->FindFrameField(key);
+  if (fieldIndex >= 0)
+  {
+    return this->FrameFields[fieldIndex].Value;
   }
   return "";
 }
@@ -91,10 +199,13 @@ PlusStatus StreamBufferItem::DeleteFrameField(const char* fieldName)
     return PLUS_FAIL;
   }
 
-  igsioFieldMapType::iterator field = this->FrameFields.find(fieldName);
-  if (field != this->FrameFields.end())
+  PlusFrameFieldKeyTable::KeyType key = 0;
+  const int fieldIndex = PlusFrameFieldKeyTable::FindKey(fieldName, key) ? this->FindFrameField(key) : -1;
+  if (fieldIndex >= 0)
   {
-    this->FrameFields.erase(field);
+    // Move the last field into the place of the deleted one, the storage of the last field is kept for reuse
+    --this->NumberOfFrameFields;
+    std::swap(this->FrameFields[fieldIndex], this->FrameFields[this->NumberOfFrameFields]);
     return PLUS_SUCCESS;
   }
   LOG_DEBUG("Failed to delete frame field - could find field " << fieldName);
@@ -121,6 +232,208 @@ PlusStatus StreamBufferItem::DeepCopy(StreamBufferItem* dataItem)
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+PlusStatus StreamBufferItem::ShallowCopy(StreamBufferItem* dataItem)
+{
+  if (dataItem == NULL)
+  {
+    LOG_ERROR("Failed to shallow copy data buffer item - buffer item NULL!");
+    return PLUS_FAIL;
+  }
+
+  if (this == dataItem)
+  {
+    return PLUS_SUCCESS;
+  }
+
+  if (ShallowCopyFrame(dataItem->Frame, this->Frame) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to shallow copy data buffer item - frame cannot be shared!");
+    return PLUS_FAIL;
+  }
+  this->FilteredTimeStamp = dataItem->FilteredTimeStamp;
+  this->UnfilteredTimeStamp = dataItem->UnfilteredTimeStamp;
+  this->Index = dataItem->Index;
+  this->Uid = dataItem->Uid;
+  this->CopyFrameFields(*dataItem);
+  this->Status = dataItem->Status;
+  this->Matrix->DeepCopy(dataItem->Matrix);
+  this->ValidTransformData = dataItem->ValidTransformData;
+  this->GpuFrame = dataItem->GpuFrame;
+  this->HostFrameValid = dataItem->HostFrameValid;
+  this->CompressedPixels = dataItem->CompressedPixels;
+  this->SourceBitstream = dataItem->SourceBitstream;
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void StreamBufferItem::SetGpuFrame(const PlusGpuFramePtr& gpuFrame)
+{
+  this->GpuFrame = gpuFrame;
+  this->HostFrameValid = (gpuFrame == nullptr);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus StreamBufferItem::ReadBackGpuFrame()
+{
+  if (this->HostFrameValid)
+  {
+    return PLUS_SUCCESS;
+  }
+  if (this->GpuFrame == nullptr || !this->GpuFrame->IsValid() || this->Frame.GetImage() == NULL)
+  {
+    LOG_DEBUG("Failed to read back GPU frame of buffer item " << this->Uid << " - the GPU frame is not available anymore");
+    return PLUS_FAIL;
+  }
+  if (this->GpuFrame->ReadBack(this->Frame.GetScalarPointer(), this->Frame.GetFrameSizeInBytes()) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  this->HostFrameValid = true;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus StreamBufferItem::CompressPixelData(vtkDataArray* scalars, int compressionLevel, CompressedPixelDataPtr& compressedPixels)
+{
+  compressedPixels = nullptr;
+  if (scalars == NULL || scalars->GetNumberOfTuples() == 0)
+  {
+    LOG_ERROR("Failed to compress pixel data - there is no pixel data");
+    return PLUS_FAIL;
+  }
+
+  const uLong inputSize = static_cast<uLong>(scalars->GetNumberOfTuples() * scalars->GetNumberOfComponents() * scalars->GetDataTypeSize());
+  std::shared_ptr<CompressedPixelData> compressed = std::make_shared<CompressedPixelData>();
+  compressed->NumberOfTuples = scalars->GetNumberOfTuples();
+  uLongf compressedSize = compressBound(inputSize);
+  compressed->Data.resize(compressedSize);
+  if (compress2(&compressed->Data[0], &compressedSize, static_cast<const Bytef*>(scalars->GetVoidPointer(0)), inputSize, compressionLevel) != Z_OK)
+  {
+    LOG_ERROR("Failed to compress pixel data of " << inputSize << " bytes");
+    return PLUS_FAIL;
+  }
+  compressed->Data.resize(compressedSize);
+  compressed->Data.shrink_to_fit();
+  compressedPixels = compressed;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void StreamBufferItem::SetCompressedPixelData(const CompressedPixelDataPtr& compressedPixels)
+{
+  vtkDataArray* scalars = GetFrameScalars(this->Frame);
+  if (compressedPixels == nullptr || scalars == NULL)
+  {
+    return;
+  }
+  // Views that share the uncompressed pixel data keep it alive, the item only releases its own reference
+  this->Frame.GetImage()->GetPointData()->SetScalars(CreateScalarsLike(scalars, 0));
+  this->CompressedPixels = compressedPixels;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus StreamBufferItem::DecompressFrame()
+{
+  if (this->CompressedPixels == nullptr)
+  {
+    return PLUS_SUCCESS;
+  }
+  vtkDataArray* scalars = GetFrameScalars(this->Frame);
+  if (scalars == NULL)
+  {
+    LOG_ERROR("Failed to decompress frame of buffer item " << this->Uid << " - the frame has no pixel data");
+    return PLUS_FAIL;
+  }
+
+  vtkSmartPointer<vtkDataArray> decompressedScalars = CreateScalarsLike(scalars, this->CompressedPixels->NumberOfTuples);
+  const uLong expectedSize = static_cast<uLong>(decompressedScalars->GetNumberOfTuples() * decompressedScalars->GetNumberOfComponents() * decompressedScalars->GetDataTypeSize());
+  uLongf decompressedSize = expectedSize;
+  const std::vector<unsigned char>& data = this->CompressedPixels->Data;
+  if (uncompress(static_cast<Bytef*>(decompressedScalars->GetVoidPointer(0)), &decompressedSize, &data[0], static_cast<uLong>(data.size())) != Z_OK
+      || decompressedSize != expectedSize)
+  {
+    LOG_ERROR("Failed to decompress frame of buffer item " << this->Uid);
+    return PLUS_FAIL;
+  }
+  this->Frame.GetImage()->GetPointData()->SetScalars(decompressedScalars);
+  this->CompressedPixels = nullptr;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void StreamBufferItem::DiscardCompressedFrame()
+{
+  if (this->CompressedPixels == nullptr)
+  {
+    return;
+  }
+  vtkDataArray* scalars = GetFrameScalars(this->Frame);
+  if (scalars != NULL)
+  {
+    this->Frame.GetImage()->GetPointData()->SetScalars(CreateScalarsLike(scalars, this->CompressedPixels->NumberOfTuples));
+  }
+  this->CompressedPixels = nullptr;
+}
+
+//----------------------------------------------------------------------------
+void StreamBufferItem::GetMemoryUsage(unsigned long long& frameBytes, unsigned long long& fieldBytes)
+{
+  frameBytes = 0;
+  vtkDataArray* scalars = GetFrameScalars(this->Frame);
+  if (scalars != NULL)
+  {
+    frameBytes += static_cast<unsigned long long>(scalars->GetSize()) * scalars->GetDataTypeSize();
+  }
+  if (this->CompressedPixels != nullptr)
+  {
+    frameBytes += this->CompressedPixels->Data.capacity();
+  }
+  if (this->SourceBitstream != nullptr)
+  {
+    frameBytes += this->SourceBitstream->Data.capacity();
+  }
+
+  fieldBytes = this->FrameFields.capacity() * sizeof(FrameField);
+  for (std::vector<FrameField>::const_iterator it = this->FrameFields.begin(); it != this->FrameFields.end(); ++it)
+  {
+    fieldBytes += it->Value.capacity();
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusStatus StreamBufferItem::ShallowCopyFrame(igsioVideoFrame& sourceFrame, igsioVideoFrame& targetFrame)
+{
+  if (sourceFrame.IsFrameEncoded())
+  {
+    // Encoded frames are reference counted by the codec frame object already
+    targetFrame.SetEncodedFrame(sourceFrame.GetEncodedFrame());
+  }
+  else if (sourceFrame.GetImage() != NULL)
+  {
+    FrameSizeType frameSize = { 0, 0, 0 };
+    sourceFrame.GetFrameSize(frameSize);
+    unsigned int numberOfScalarComponents(1);
+    sourceFrame.GetNumberOfScalarComponents(numberOfScalarComponents);
+    if (targetFrame.GetImage() == NULL || targetFrame.IsFrameEncoded())
+    {
+      if (targetFrame.AllocateFrame(frameSize, sourceFrame.GetVTKScalarPixelType(), numberOfScalarComponents) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to allocate image for the shared frame");
+        return PLUS_FAIL;
+      }
+    }
+    // Shares the scalar array: the reference count of the array shows whether the frame is in use by a reader
+    targetFrame.GetImage()->ShallowCopy(sourceFrame.GetImage());
+  }
+
+  targetFrame.SetImageType(sourceFrame.GetImageType());
+  targetFrame.SetImageOrientation(sourceFrame.GetImageOrientation());
+
+  return PLUS_SUCCESS;
+}
+
 //----------------------------------------------------------------------------
 PlusStatus StreamBufferItem::SetMatrix(vtkMatrix4x4* matrix)
 {
@@ -151,6 +464,18 @@ PlusStatus StreamBufferItem::GetMatrix(vtkMatrix4x4* outputMatrix)
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+void StreamBufferItem::GetMatrixElements(double elements[16]) const
+{
+  vtkMatrix4x4::DeepCopy(elements, this->Matrix);
+}
+
+//----------------------------------------------------------------------------
+void StreamBufferItem::SetMatrixElements(const double elements[16])
+{
+  this->Matrix->DeepCopy(elements);
+}
+
 //----------------------------------------------------------------------------
 void StreamBufferItem::SetStatus(ToolStatus status)
 {
@@ -166,5 +491,5 @@ ToolStatus StreamBufferItem::GetStatus() const
 //----------------------------------------------------------------------------
 bool StreamBufferItem::HasValidFieldData() const
 {
-  return this->FrameFields.size() > 0;
+  return this->NumberOfFrameFields > 0;
 }
\ No newline at end of file
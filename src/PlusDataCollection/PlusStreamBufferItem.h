@@ -8,6 +8,8 @@ See License.txt for details.
 #define __StreamBufferItem_h
 
 #include "vtkPlusDataCollectionExport.h"
+#include "PlusFrameFieldKeyTable.h"
+#include "PlusGpuFrame.h"
 
 // IGSIO includes
 #include <igsioCommon.h>
@@ -15,8 +17,10 @@ See License.txt for details.
 // VTK includes
 #include <vtkSmartPointer.h>
 
+#include <memory>
 #include <vector>
 
+class vtkDataArray;
 class vtkMatrix4x4;
 class vtkPlusDevice;
 class vtkPlusChannel;
@@ -72,25 +76,43 @@ public:
   void SetUid(BufferItemUidType uid) { this->Uid = uid; };
 
   /*! Set frame field */
-  void SetFrameField(std::string fieldName, std::string fieldValue, igsioFrameFieldFlags flags = FRAMEFIELD_NONE);
+  void SetFrameField(const std::string& fieldName, const std::string& fieldValue, igsioFrameFieldFlags flags = FRAMEFIELD_NONE);
 
   /*! Get frame field value */
   std::string GetFrameField(const std::string& fieldName) const;
-  /*! Get frame field map */
-  igsioFieldMapType GetFrameFieldMap() {return this->FrameFields;}
+  /*! Get frame field map, created from the stored fields */
+  igsioFieldMapType GetFrameFieldMap() const;
+  /*! Replace all frame fields by the fields of the map */
+  void SetFrameFields(const igsioFieldMapType& fields);
   /*! Delete frame field */
   PlusStatus DeleteFrameField(const char* fieldName);
   PlusStatus DeleteFrameField(const std::string& fieldName);
+  /*! Delete all frame fields. The storage of the fields is kept for reuse. */
+  void ClearFrameFields() { this->NumberOfFrameFields = 0; }
 
   /*! Copy stream buffer item */
   PlusStatus DeepCopy(StreamBufferItem* dataItem);
 
+  /*!
+    Copy stream buffer item, sharing the pixel data of the frame with the source item instead of copying it.
+    The shared pixel data must be treated as read-only. The buffer detaches its own item from the shared
+    pixel data before it overwrites it, so the shared data remains valid after the source item is reused.
+  */
+  PlusStatus ShallowCopy(StreamBufferItem* dataItem);
+
+  /*! Make the target frame refer to the pixel data of the source frame, without copying the pixel data */
+  static PlusStatus ShallowCopyFrame(igsioVideoFrame& sourceFrame, igsioVideoFrame& targetFrame);
+
   igsioVideoFrame& GetFrame() { return this->Frame; };
 
   /*! Set tracker matrix */
   PlusStatus SetMatrix(vtkMatrix4x4* matrix);
   /*! Get tracker matrix */
   PlusStatus GetMatrix(vtkMatrix4x4* outputMatrix);
+  /*! Get tracker matrix elements in row-major order, without creating a matrix object */
+  void GetMatrixElements(double elements[16]) const;
+  /*! Set tracker matrix from elements in row-major order */
+  void SetMatrixElements(const double elements[16]);
 
   /*! Set tracker item status */
   void SetStatus(ToolStatus status);
@@ -105,6 +127,66 @@ public:
     return Frame.IsImageValid();
   }
 
+  /*!
+    Set the GPU-resident copy of the frame. The pixel data of the host frame is not valid until
+    ReadBackGpuFrame() is called. Setting nullptr marks the host frame as valid.
+  */
+  void SetGpuFrame(const PlusGpuFramePtr& gpuFrame);
+  const PlusGpuFramePtr& GetGpuFrame() const { return this->GpuFrame; }
+  /*! Returns false if the frame is only available in GPU memory and has not been read back yet */
+  bool IsHostFrameValid() const { return this->HostFrameValid; }
+  /*! Read the pixel data of the GPU frame into the host frame, if it has not been read yet */
+  PlusStatus ReadBackGpuFrame();
+
+  /*! zlib compressed pixel data of a frame. It is immutable, so it is shared between copies of the item. */
+  struct CompressedPixelData
+  {
+    std::vector<unsigned char> Data;
+    vtkIdType NumberOfTuples;
+  };
+  typedef std::shared_ptr<const CompressedPixelData> CompressedPixelDataPtr;
+
+  /*!
+    Compress the pixel data of a frame. It does not access the item, so it can be called without locking the buffer,
+    while the caller holds a reference to the pixel data.
+  */
+  static PlusStatus CompressPixelData(vtkDataArray* scalars, int compressionLevel, CompressedPixelDataPtr& compressedPixels);
+
+  /*!
+    Replace the pixel data of the frame by the compressed pixel data. The uncompressed pixel data is released,
+    the frame size and pixel type are kept. The pixel data is not valid until DecompressFrame() is called.
+  */
+  void SetCompressedPixelData(const CompressedPixelDataPtr& compressedPixels);
+  bool IsFrameCompressed() const { return this->CompressedPixels != nullptr; }
+  /*! Restore the pixel data of the frame from the compressed pixel data, if the frame is compressed */
+  PlusStatus DecompressFrame();
+  /*!
+    Drop the compressed pixel data and allocate uncompressed pixel data with undefined content.
+    Must be called before the frame is overwritten.
+  */
+  void DiscardCompressedFrame();
+
+  /*!
+    Compressed bitstream that the frame was decoded from (e.g., a JPEG image of an MJPEG stream). It allows recording
+    the frame in its original quality without encoding it again. It is immutable, so it is shared between copies of the item.
+  */
+  struct SourceBitstreamData
+  {
+    std::string CodecFourCC;
+    std::vector<unsigned char> Data;
+  };
+  typedef std::shared_ptr<const SourceBitstreamData> SourceBitstreamPtr;
+
+  void SetSourceBitstream(const SourceBitstreamPtr& sourceBitstream) { this->SourceBitstream = sourceBitstream; }
+  const SourceBitstreamPtr& GetSourceBitstream() const { return this->SourceBitstream; }
+
+  /*!
+    Approximate memory used by the item in bytes. Frame bytes include the allocated pixel data (or the compressed pixel data
+    if the frame is compressed) and the source bitstream. Field bytes include the storage of the custom frame fields that is
+    kept for reuse.
+  */
+  void GetMemoryUsage(unsigned long long& frameBytes, unsigned long long& fieldBytes);
+
 protected:
   double FilteredTimeStamp;
   double UnfilteredTimeStamp;
@@ -115,13 +197,40 @@ protected:
   /*! unique identifier assigned by the storage buffer, it is guaranteed to increase monotonously, by one for each frame that is added to the buffer*/
   BufferItemUidType Uid;
 
-  /*! Custom frame fields */
-  igsioFieldMapType FrameFields;
+  /*! Custom frame field, with the name stored in PlusFrameFieldKeyTable */
+  struct FrameField
+  {
+    PlusFrameFieldKeyTable::KeyType Key;
+    igsioFrameFieldFlags Flags;
+    std::string Value;
+  };
+
+  /*! Copy the custom frame fields of another item, reusing the storage of the fields of this item */
+  void CopyFrameFields(const StreamBufferItem& dataItem);
+
+  /*! Find a custom frame field among the first NumberOfFrameFields elements of FrameFields, returns -1 if not found */
+  int FindFrameField(PlusFrameFieldKeyTable::KeyType key) const;
+
+  /*!
+    Custom frame fields. Only the first NumberOfFrameFields elements are valid, the others are kept
+    so that the item can be reused without allocating memory for the same fields again.
+  */
+  std::vector<FrameField> FrameFields;
+  unsigned int NumberOfFrameFields;
 
   bool ValidTransformData;
   igsioVideoFrame Frame;
   vtkSmartPointer<vtkMatrix4x4> Matrix;
   ToolStatus Status;
+
+  /*! GPU-resident copy of the frame, if the device captured the frame into GPU memory */
+  PlusGpuFramePtr GpuFrame;
+  /*! False if the pixel data of Frame has not been read back from GpuFrame yet */
+  bool HostFrameValid;
+  /*! Compressed pixel data of Frame, if the frame is compressed (then the scalars of Frame are empty) */
+  CompressedPixelDataPtr CompressedPixels;
+  /*! Compressed bitstream that Frame was decoded from, if the device keeps it */
+  SourceBitstreamPtr SourceBitstream;
 };
 
 #endif
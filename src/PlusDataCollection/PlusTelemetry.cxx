@@ -0,0 +1,174 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "PlusTelemetry.h"
+#include "vtkIGSIOAccurateTimer.h"
+
+// STL includes
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+//----------------------------------------------------------------------------
+PlusLatencyHistogram::PlusLatencyHistogram()
+{
+  this->Reset();
+}
+
+//----------------------------------------------------------------------------
+void PlusLatencyHistogram::AddSample(double durationSec)
+{
+  unsigned long long durationUs = durationSec > 0 ? static_cast<unsigned long long>(durationSec * 1e6) : 0;
+
+  int bin = 0;
+  for (unsigned long long value = durationUs; value > 1 && bin < NUMBER_OF_BINS - 1; value >>= 1)
+  {
+    bin++;
+  }
+  this->Bins[bin].fetch_add(1, std::memory_order_relaxed);
+  this->NumberOfSamples.fetch_add(1, std::memory_order_relaxed);
+  this->SumUs.fetch_add(durationUs, std::memory_order_relaxed);
+
+  unsigned long long maximumUs = this->MaximumUs.load(std::memory_order_relaxed);
+  while (durationUs > maximumUs && !this->MaximumUs.compare_exchange_weak(maximumUs, durationUs, std::memory_order_relaxed))
+  {
+  }
+}
+
+//----------------------------------------------------------------------------
+void PlusLatencyHistogram::Reset()
+{
+  for (int i = 0; i < NUMBER_OF_BINS; ++i)
+  {
+    this->Bins[i].store(0, std::memory_order_relaxed);
+  }
+  this->NumberOfSamples.store(0, std::memory_order_relaxed);
+  this->SumUs.store(0, std::memory_order_relaxed);
+  this->MaximumUs.store(0, std::memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------------
+unsigned long long PlusLatencyHistogram::GetNumberOfSamples() const
+{
+  return this->NumberOfSamples.load(std::memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------------
+double PlusLatencyHistogram::GetMeanSec() const
+{
+  unsigned long long numberOfSamples = this->GetNumberOfSamples();
+  if (numberOfSamples == 0)
+  {
+    return 0.0;
+  }
+  return this->SumUs.load(std::memory_order_relaxed) * 1e-6 / numberOfSamples;
+}
+
+//----------------------------------------------------------------------------
+double PlusLatencyHistogram::GetMaximumSec() const
+{
+  return this->MaximumUs.load(std::memory_order_relaxed) * 1e-6;
+}
+
+//----------------------------------------------------------------------------
+double PlusLatencyHistogram::GetPercentileSec(double percentile) const
+{
+  unsigned long long binCounts[NUMBER_OF_BINS];
+  unsigned long long numberOfSamples = 0;
+  for (int i = 0; i < NUMBER_OF_BINS; ++i)
+  {
+    binCounts[i] = this->Bins[i].load(std::memory_order_relaxed);
+    numberOfSamples += binCounts[i];
+  }
+  if (numberOfSamples == 0)
+  {
+    return 0.0;
+  }
+
+  double requiredCount = numberOfSamples * percentile / 100.0;
+  unsigned long long count = 0;
+  for (int i = 0; i < NUMBER_OF_BINS; ++i)
+  {
+    count += binCounts[i];
+    if (count >= requiredCount)
+    {
+      // Upper limit of the bin, but never more than the largest sample
+      return std::min(static_cast<double>(2ULL << i) * 1e-6, this->GetMaximumSec());
+    }
+  }
+  return this->GetMaximumSec();
+}
+
+//----------------------------------------------------------------------------
+std::string PlusLatencyHistogram::GetStatisticsString() const
+{
+  std::ostringstream ss;
+  ss << std::fixed << std::setprecision(3)
+     << "Count=" << this->GetNumberOfSamples()
+     << " MeanMs=" << this->GetMeanSec() * 1000.0
+     << " P50Ms=" << this->GetPercentileSec(50) * 1000.0
+     << " P95Ms=" << this->GetPercentileSec(95) * 1000.0
+     << " P99Ms=" << this->GetPercentileSec(99) * 1000.0
+     << " MaxMs=" << this->GetMaximumSec() * 1000.0;
+  return ss.str();
+}
+
+//----------------------------------------------------------------------------
+PlusTelemetry* PlusTelemetry::Instance()
+{
+  // Initialization of function-local statics is thread-safe
+  static PlusTelemetry instance;
+  return &instance;
+}
+
+//----------------------------------------------------------------------------
+PlusTelemetry::PlusTelemetry()
+  : Enabled(true)
+{
+}
+
+//----------------------------------------------------------------------------
+void PlusTelemetry::AddSampleSince(Stage stage, double startSystemTimeSec)
+{
+  if (this->GetEnabled())
+  {
+    this->Histograms[stage].AddSample(vtkIGSIOAccurateTimer::GetSystemTime() - startSystemTimeSec);
+  }
+}
+
+//----------------------------------------------------------------------------
+void PlusTelemetry::Reset()
+{
+  for (int i = 0; i < NUMBER_OF_STAGES; ++i)
+  {
+    this->Histograms[i].Reset();
+  }
+}
+
+//----------------------------------------------------------------------------
+const char* PlusTelemetry::GetStageName(Stage stage)
+{
+  switch (stage)
+  {
+    case STAGE_DEVICE_UPDATE:
+      return "DeviceUpdate";
+    case STAGE_ACQUISITION_TO_BUFFER:
+      return "AcquisitionToBuffer";
+    case STAGE_BUFFER_TO_SERVER:
+      return "BufferToServer";
+    case STAGE_PACKING:
+      return "Packing";
+    case STAGE_QUEUE_TO_SOCKET:
+      return "QueueToSocket";
+    case STAGE_DECODING:
+      return "Decoding";
+    case STAGE_ENCODING:
+      return "Encoding";
+    default:
+      return "Unknown";
+  }
+}
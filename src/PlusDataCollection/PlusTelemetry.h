@@ -0,0 +1,121 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusTelemetry_h
+#define __PlusTelemetry_h
+
+#include "vtkPlusDataCollectionExport.h"
+
+#include <atomic>
+#include <string>
+
+/*!
+  \class PlusLatencyHistogram
+  \brief Lock-free histogram of durations with logarithmic (power of two microseconds) bins.
+
+  Samples can be added from any number of threads without locking. Statistics computed while samples
+  are being added are approximate, as the counters are not read in a single snapshot.
+
+  \ingroup PlusLibDataCollection
+*/
+class vtkPlusDataCollectionExport PlusLatencyHistogram
+{
+public:
+  /*! Bin i contains durations in [2^i, 2^(i+1)) microseconds, the first bin also contains durations below 1us */
+  static const int NUMBER_OF_BINS = 32;
+
+  PlusLatencyHistogram();
+
+  void AddSample(double durationSec);
+  void Reset();
+
+  unsigned long long GetNumberOfSamples() const;
+  double GetMeanSec() const;
+  double GetMaximumSec() const;
+  /*! Upper limit of the bin that contains the requested percentile (0-100) */
+  double GetPercentileSec(double percentile) const;
+
+  /*! Summary in the form "Count=... MeanMs=... P50Ms=... P95Ms=... P99Ms=... MaxMs=..." */
+  std::string GetStatisticsString() const;
+
+protected:
+  std::atomic<unsigned long long> Bins[NUMBER_OF_BINS];
+  std::atomic<unsigned long long> NumberOfSamples;
+  std::atomic<unsigned long long> SumUs;
+  std::atomic<unsigned long long> MaximumUs;
+
+private:
+  PlusLatencyHistogram(const PlusLatencyHistogram&);
+  void operator=(const PlusLatencyHistogram&);
+};
+
+/*!
+  \class PlusTelemetry
+  \brief Process-wide latency statistics of the data acquisition and broadcasting pipeline.
+
+  Each stage of the pipeline adds the time it took to a histogram:
+  - DeviceUpdate: duration of one InternalUpdate call of a device capture thread
+  - AcquisitionToBuffer: from the (unfiltered) acquisition timestamp to the insertion of the item into the buffer
+  - BufferToServer: from the frame timestamp to the retrieval of the frame by the OpenIGTLink server
+  - Packing: packing the OpenIGTLink messages of a frame for one client
+  - QueueToSocket: from queuing a message for a client to the completion of the socket send
+  - Decoding: decoding a compressed (e.g., MJPEG) frame received from a video device
+  - Encoding: encoding a frame of a compressed OpenIGTLink video stream (once per frame, shared by all clients of the stream)
+
+  \ingroup PlusLibDataCollection
+*/
+class vtkPlusDataCollectionExport PlusTelemetry
+{
+public:
+  enum Stage
+  {
+    STAGE_DEVICE_UPDATE,
+    STAGE_ACQUISITION_TO_BUFFER,
+    STAGE_BUFFER_TO_SERVER,
+    STAGE_PACKING,
+    STAGE_QUEUE_TO_SOCKET,
+    STAGE_DECODING,
+    STAGE_ENCODING,
+    NUMBER_OF_STAGES
+  };
+
+  static PlusTelemetry* Instance();
+
+  /*! Enable or disable collection of samples (enabled by default) */
+  void SetEnabled(bool enabled) { this->Enabled.store(enabled, std::memory_order_relaxed); }
+  bool GetEnabled() const { return this->Enabled.load(std::memory_order_relaxed); }
+
+  /*! Add a sample to a stage histogram. Does nothing if telemetry is disabled. */
+  void AddSample(Stage stage, double durationSec)
+  {
+    if (this->GetEnabled())
+    {
+      this->Histograms[stage].AddSample(durationSec);
+    }
+  }
+
+  /*! Add the time elapsed since startSystemTimeSec (system time, see vtkIGSIOAccurateTimer::GetSystemTime) to a stage histogram */
+  void AddSampleSince(Stage stage, double startSystemTimeSec);
+
+  const PlusLatencyHistogram& GetHistogram(Stage stage) const { return this->Histograms[stage]; }
+
+  /*! Clear the statistics of all stages */
+  void Reset();
+
+  static const char* GetStageName(Stage stage);
+
+protected:
+  PlusTelemetry();
+
+  std::atomic<bool> Enabled;
+  PlusLatencyHistogram Histograms[NUMBER_OF_STAGES];
+
+private:
+  PlusTelemetry(const PlusTelemetry&);
+  void operator=(const PlusTelemetry&);
+};
+
+#endif
@@ -0,0 +1,108 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "PlusToolPoseBatch.h"
+#include "igsioMath.h"
+
+// VTK includes
+#include <vtkMath.h>
+
+// STL includes
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+  // Same threshold as for the interpolation of a single buffer item
+  const double ANGLE_INTERPOLATION_WARNING_THRESHOLD_DEG = 10;
+
+  //----------------------------------------------------------------------------
+  /*! Angle of the rotation between two unit quaternions in degrees */
+  double GetQuaternionAngleDifferenceDeg(const double* quatA, const double* quatB)
+  {
+    const double dot = std::fabs(quatA[0] * quatB[0] + quatA[1] * quatB[1] + quatA[2] * quatB[2] + quatA[3] * quatB[3]);
+    return vtkMath::DegreesFromRadians(2.0 * std::acos((std::min)(dot, 1.0)));
+  }
+
+  //----------------------------------------------------------------------------
+  void AddPose(const double matrix[16], std::vector<double>& rotations, std::vector<double>& translations)
+  {
+    double rotation[3][3] =
+    {
+      { matrix[0], matrix[1], matrix[2] },
+      { matrix[4], matrix[5], matrix[6] },
+      { matrix[8], matrix[9], matrix[10] }
+    };
+    double quat[4] = { 0, 0, 0, 0 };
+    vtkMath::Matrix3x3ToQuaternion(rotation, quat);
+    rotations.insert(rotations.end(), quat, quat + 4);
+    translations.push_back(matrix[3]);
+    translations.push_back(matrix[7]);
+    translations.push_back(matrix[11]);
+  }
+}
+
+//----------------------------------------------------------------------------
+void PlusToolPoseBatch::Clear()
+{
+  this->RotationsA.clear();
+  this->RotationsB.clear();
+  this->TranslationsA.clear();
+  this->TranslationsB.clear();
+  this->InterpolatedMatrices.clear();
+}
+
+//----------------------------------------------------------------------------
+int PlusToolPoseBatch::AddPoses(const double matrixA[16], const double matrixB[16])
+{
+  const int index = this->GetNumberOfPoses();
+  AddPose(matrixA, this->RotationsA, this->TranslationsA);
+  AddPose(matrixB, this->RotationsB, this->TranslationsB);
+  return index;
+}
+
+//----------------------------------------------------------------------------
+int PlusToolPoseBatch::Interpolate(double itemBweight)
+{
+  const double itemAweight = 1.0 - itemBweight;
+  const int numberOfPoses = this->GetNumberOfPoses();
+  this->InterpolatedMatrices.resize(16 * numberOfPoses);
+
+  int numberOfInaccuratePoses = 0;
+  for (int i = 0; i < numberOfPoses; i++)
+  {
+    double* quatA = &this->RotationsA[4 * i];
+    double* quatB = &this->RotationsB[4 * i];
+    const double* xyzA = &this->TranslationsA[3 * i];
+    const double* xyzB = &this->TranslationsB[3 * i];
+
+    double interpolatedQuat[4] = { 0, 0, 0, 0 };
+    igsioMath::Slerp(interpolatedQuat, itemBweight, quatA, quatB);
+    double interpolatedRotation[3][3] = { { 0, 0, 0 }, { 0, 0, 0 }, { 0, 0, 0 } };
+    vtkMath::QuaternionToMatrix3x3(interpolatedQuat, interpolatedRotation);
+
+    double* matrix = &this->InterpolatedMatrices[16 * i];
+    for (int row = 0; row < 3; row++)
+    {
+      matrix[4 * row + 0] = interpolatedRotation[row][0];
+      matrix[4 * row + 1] = interpolatedRotation[row][1];
+      matrix[4 * row + 2] = interpolatedRotation[row][2];
+      matrix[4 * row + 3] = xyzA[row] * itemAweight + xyzB[row] * itemBweight;
+    }
+    matrix[12] = 0;
+    matrix[13] = 0;
+    matrix[14] = 0;
+    matrix[15] = 1;
+
+    if (GetQuaternionAngleDifferenceDeg(interpolatedQuat, quatA) > ANGLE_INTERPOLATION_WARNING_THRESHOLD_DEG
+        && GetQuaternionAngleDifferenceDeg(interpolatedQuat, quatB) > ANGLE_INTERPOLATION_WARNING_THRESHOLD_DEG)
+    {
+      numberOfInaccuratePoses++;
+    }
+  }
+  return numberOfInaccuratePoses;
+}
@@ -0,0 +1,61 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusToolPoseBatch_h
+#define __PlusToolPoseBatch_h
+
+#include "PlusConfigure.h"
+#include "vtkPlusDataCollectionExport.h"
+
+#include <vector>
+
+/*!
+  \class PlusToolPoseBatch
+  \brief Interpolates the poses of several tools at the same time point in one pass.
+
+  The poses before and after the interpolation time are stored as structure of arrays (rotation quaternions and
+  translations of all tools in contiguous arrays), so that all tools of a device are interpolated with the same weight
+  without creating matrix objects or copying buffer items. The rotation is interpolated with SLERP, the translation
+  linearly, the same way as vtkPlusBuffer interpolates a single item.
+
+  \ingroup PlusLibDataCollection
+*/
+class vtkPlusDataCollectionExport PlusToolPoseBatch
+{
+public:
+  /*! Remove all poses, the allocated memory is kept */
+  void Clear();
+
+  /*!
+    Add the poses of a tool at the two items around the interpolation time (matrix elements in row-major order).
+    Returns the index of the tool in the batch.
+  */
+  int AddPoses(const double matrixA[16], const double matrixB[16]);
+
+  int GetNumberOfPoses() const { return static_cast<int>(this->TranslationsA.size() / 3); }
+
+  /*!
+    Interpolate all poses. itemBweight is the weight of the second pose (0 = first pose, 1 = second pose).
+    Returns the number of poses whose interpolated orientation differs from both input orientations by more than
+    the warning threshold, which means that the interpolation may be inaccurate.
+  */
+  int Interpolate(double itemBweight);
+
+  /*! Interpolated matrix elements of a tool in row-major order, valid after Interpolate */
+  const double* GetInterpolatedMatrix(int index) const { return &this->InterpolatedMatrices[16 * index]; }
+
+protected:
+  /*! Rotation quaternions, 4 values per tool */
+  std::vector<double> RotationsA;
+  std::vector<double> RotationsB;
+  /*! Translations, 3 values per tool */
+  std::vector<double> TranslationsA;
+  std::vector<double> TranslationsB;
+  /*! Interpolated matrices, 16 values per tool */
+  std::vector<double> InterpolatedMatrices;
+};
+
+#endif
@@ -0,0 +1,95 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusTrackedFrameAssembly_h
+#define __PlusTrackedFrameAssembly_h
+
+#include "PlusConfigure.h"
+#include "PlusWorkerPool.h"
+
+// IGSIO includes
+#include <igsioTrackedFrame.h>
+#include <vtkIGSIOTrackedFrameList.h>
+
+#include <functional>
+#include <vector>
+
+/*!
+  \class PlusTrackedFrameAssembly
+  \brief Assembles many tracked frames from data buffers on the threads of the shared worker pool.
+
+  Used for bulk export of buffers (e.g., writing a whole buffer to a sequence file): the caller takes a snapshot of
+  the item UIDs and timestamps once (see vtkPlusBuffer::GetItemTimeStamps), then the frames are assembled in parallel.
+  Each buffer access only locks the buffer for the time of copying the requested item, so acquisition can continue
+  while the frames are assembled. The frames are added to the output list in the original order.
+
+  \ingroup PlusLibDataCollection
+*/
+class PlusTrackedFrameAssembly
+{
+public:
+  /*! Function that fills the frame of the given index, returns PLUS_FAIL if the frame cannot be assembled */
+  typedef std::function<PlusStatus(int frameIndex, igsioTrackedFrame& trackedFrame)> AssembleFrameFunction;
+
+  /*! Below this number of frames the frames are assembled on the calling thread, because starting the tasks would take longer */
+  static const int MIN_NUMBER_OF_FRAMES_FOR_PARALLEL_ASSEMBLY = 16;
+
+  /*!
+    Assemble numberOfFrames frames by calling assembleFrame for each index. The assembled frames are stored in frames
+    in the order of the indices, frames that could not be assembled are NULL. The caller owns the frames.
+  */
+  static void AssembleFrames(int numberOfFrames, const AssembleFrameFunction& assembleFrame, std::vector<igsioTrackedFrame*>& frames)
+  {
+    frames.assign(numberOfFrames, static_cast<igsioTrackedFrame*>(NULL));
+    auto assembleFrameRange = [&assembleFrame, &frames](int firstFrameIndex, int lastFrameIndex)
+    {
+      for (int frameIndex = firstFrameIndex; frameIndex < lastFrameIndex; ++frameIndex)
+      {
+        igsioTrackedFrame* trackedFrame = new igsioTrackedFrame;
+        if (assembleFrame(frameIndex, *trackedFrame) != PLUS_SUCCESS)
+        {
+          delete trackedFrame;
+          continue;
+        }
+        frames[frameIndex] = trackedFrame;
+      }
+    };
+
+    if (numberOfFrames < MIN_NUMBER_OF_FRAMES_FOR_PARALLEL_ASSEMBLY)
+    {
+      assembleFrameRange(0, numberOfFrames);
+      return;
+    }
+    PlusWorkerPool::GetInstance().ParallelFor(0, numberOfFrames, 0, assembleFrameRange);
+  }
+
+  /*!
+    Move the frames to the list in order, the list takes the ownership of the frames (see vtkIGSIOTrackedFrameList::TakeTrackedFrame).
+    NULL frames (that could not be assembled) are skipped and make the function return PLUS_FAIL.
+  */
+  static PlusStatus TakeFrames(std::vector<igsioTrackedFrame*>& frames, vtkIGSIOTrackedFrameList* trackedFrameList,
+                               vtkIGSIOTrackedFrameList::InvalidFrameAction action = vtkIGSIOTrackedFrameList::ADD_INVALID_FRAME_AND_REPORT_ERROR)
+  {
+    PlusStatus status = PLUS_SUCCESS;
+    for (std::vector<igsioTrackedFrame*>::iterator frame = frames.begin(); frame != frames.end(); ++frame)
+    {
+      if (*frame == NULL)
+      {
+        status = PLUS_FAIL;
+        continue;
+      }
+      if (trackedFrameList->TakeTrackedFrame(*frame, action) != PLUS_SUCCESS)
+      {
+        status = PLUS_FAIL;
+      }
+      *frame = NULL;
+    }
+    frames.clear();
+    return status;
+  }
+};
+
+#endif
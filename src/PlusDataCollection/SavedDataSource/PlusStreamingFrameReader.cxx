@@ -0,0 +1,247 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "PlusStreamingFrameReader.h"
+
+// STL includes
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+//----------------------------------------------------------------------------
+PlusStreamingFrameReader::PlusStreamingFrameReader()
+  : RequestedFrameIndex(0)
+  , ReadAheadRequested(false)
+  , StopRequested(false)
+  , NumberOfReadAheadFrames(0)
+  , LoopFirstFrameIndex(0)
+  , LoopLastFrameIndex(0)
+  , NumberOfCacheMisses(0)
+{
+}
+
+//----------------------------------------------------------------------------
+PlusStreamingFrameReader::~PlusStreamingFrameReader()
+{
+  this->Close();
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusStreamingFrameReader::Open(std::shared_ptr<const PlusSequenceFrameIndex> index, unsigned int numberOfReadAheadFrames)
+{
+  this->Close();
+
+  if (!index || index->GetNumberOfFrames() == 0)
+  {
+    LOG_ERROR("Cannot open sequence file for streaming, the frame index is empty");
+    return PLUS_FAIL;
+  }
+
+  this->DataFile.open(index->GetDataFilename().c_str(), std::ios::in | std::ios::binary);
+  if (!this->DataFile.is_open())
+  {
+    LOG_ERROR("Failed to open sequence data file: " << index->GetDataFilename());
+    return PLUS_FAIL;
+  }
+
+  this->Index = index;
+  this->NumberOfReadAheadFrames = numberOfReadAheadFrames;
+  this->LoopFirstFrameIndex = 0;
+  this->LoopLastFrameIndex = index->GetNumberOfFrames() - 1;
+  this->RequestedFrameIndex = 0;
+  this->ReadAheadRequested = (numberOfReadAheadFrames > 0);
+  this->StopRequested = false;
+  this->NumberOfCacheMisses = 0;
+  if (numberOfReadAheadFrames > 0)
+  {
+    this->ReadAheadThread = std::thread(&PlusStreamingFrameReader::ReadAheadThreadMain, this);
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void PlusStreamingFrameReader::Close()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->CacheMutex);
+    this->StopRequested = true;
+  }
+  this->CacheCondition.notify_all();
+  if (this->ReadAheadThread.joinable())
+  {
+    this->ReadAheadThread.join();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(this->CacheMutex);
+    this->Cache.clear();
+  }
+  {
+    std::lock_guard<std::mutex> lock(this->DataFileMutex);
+    if (this->DataFile.is_open())
+    {
+      this->DataFile.close();
+    }
+  }
+  this->Index.reset();
+}
+
+//----------------------------------------------------------------------------
+void PlusStreamingFrameReader::SetLoopRange(unsigned int firstFrameIndex, unsigned int lastFrameIndex)
+{
+  std::lock_guard<std::mutex> lock(this->CacheMutex);
+  this->LoopFirstFrameIndex = firstFrameIndex;
+  this->LoopLastFrameIndex = std::max(firstFrameIndex, lastFrameIndex);
+  this->RequestedFrameIndex = firstFrameIndex;
+  this->ReadAheadRequested = true;
+  this->Cache.clear();
+  this->CacheCondition.notify_all();
+}
+
+//----------------------------------------------------------------------------
+unsigned int PlusStreamingFrameReader::GetReplayDistance(unsigned int fromFrameIndex, unsigned int toFrameIndex) const
+{
+  if (fromFrameIndex >= this->LoopFirstFrameIndex && fromFrameIndex <= this->LoopLastFrameIndex
+      && toFrameIndex >= this->LoopFirstFrameIndex && toFrameIndex <= this->LoopLastFrameIndex)
+  {
+    unsigned int loopLength = this->LoopLastFrameIndex - this->LoopFirstFrameIndex + 1;
+    return (toFrameIndex + loopLength - fromFrameIndex) % loopLength;
+  }
+  return (toFrameIndex >= fromFrameIndex) ? toFrameIndex - fromFrameIndex : std::numeric_limits<unsigned int>::max();
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusStreamingFrameReader::ReadFrameData(unsigned int frameIndex, PixelBuffer& pixels)
+{
+  pixels = std::make_shared<std::vector<unsigned char> >();
+
+  std::lock_guard<std::mutex> lock(this->DataFileMutex);
+  if (this->Index->ReadFrameData(this->DataFile, frameIndex, *pixels) != PLUS_SUCCESS)
+  {
+    pixels.reset();
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusStreamingFrameReader::GetFrame(unsigned int frameIndex, igsioVideoFrame& frame)
+{
+  if (!this->Index || frameIndex >= this->Index->GetNumberOfFrames())
+  {
+    LOG_ERROR("Frame " << frameIndex << " is not available in the streamed sequence file");
+    return PLUS_FAIL;
+  }
+
+  PixelBuffer pixels;
+  {
+    std::lock_guard<std::mutex> lock(this->CacheMutex);
+    std::map<unsigned int, PixelBuffer>::iterator cachedFrame = this->Cache.find(frameIndex);
+    if (cachedFrame != this->Cache.end())
+    {
+      pixels = cachedFrame->second;
+    }
+    // Release the frames that are not going to be replayed soon
+    this->RequestedFrameIndex = frameIndex;
+    for (std::map<unsigned int, PixelBuffer>::iterator it = this->Cache.begin(); it != this->Cache.end();)
+    {
+      if (this->GetReplayDistance(frameIndex, it->first) > this->NumberOfReadAheadFrames)
+      {
+        this->Cache.erase(it++);
+      }
+      else
+      {
+        ++it;
+      }
+    }
+    this->ReadAheadRequested = true;
+  }
+  this->CacheCondition.notify_all();
+
+  if (!pixels)
+  {
+    this->NumberOfCacheMisses++;
+    if (this->ReadFrameData(frameIndex, pixels) != PLUS_SUCCESS)
+    {
+      return PLUS_FAIL;
+    }
+  }
+
+  if (frame.AllocateFrame(this->Index->GetFrameSize(), this->Index->GetPixelType(), this->Index->GetNumberOfScalarComponents()) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to allocate image for frame " << frameIndex);
+    return PLUS_FAIL;
+  }
+  if (pixels->size() != this->Index->GetFrameSizeInBytes())
+  {
+    LOG_ERROR("Unexpected size of frame " << frameIndex << ": " << pixels->size() << " bytes");
+    return PLUS_FAIL;
+  }
+  if (!pixels->empty())
+  {
+    memcpy(frame.GetScalarPointer(), &(*pixels)[0], pixels->size());
+  }
+  frame.SetImageOrientation(this->Index->GetImageOrientation());
+  frame.SetImageType(this->Index->GetImageType());
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void PlusStreamingFrameReader::ReadAheadThreadMain()
+{
+  for (;;)
+  {
+    unsigned int frameIndexToRead(0);
+    {
+      std::unique_lock<std::mutex> lock(this->CacheMutex);
+      this->CacheCondition.wait(lock, [this] { return this->StopRequested || this->ReadAheadRequested; });
+      if (this->StopRequested)
+      {
+        break;
+      }
+
+      // Find the next frame to be replayed that has not been read yet
+      bool found = false;
+      unsigned int frameIndex = this->RequestedFrameIndex;
+      for (unsigned int i = 0; i < this->NumberOfReadAheadFrames; ++i)
+      {
+        frameIndex = (frameIndex >= this->LoopLastFrameIndex) ? this->LoopFirstFrameIndex : frameIndex + 1;
+        if (frameIndex >= this->Index->GetNumberOfFrames())
+        {
+          break;
+        }
+        if (this->Cache.find(frameIndex) == this->Cache.end())
+        {
+          frameIndexToRead = frameIndex;
+          found = true;
+          break;
+        }
+      }
+      if (!found)
+      {
+        // All the frames are read ahead, wait for the next request
+        this->ReadAheadRequested = false;
+        continue;
+      }
+    }
+
+    PixelBuffer pixels;
+    PlusStatus status = this->ReadFrameData(frameIndexToRead, pixels);
+
+    std::lock_guard<std::mutex> lock(this->CacheMutex);
+    if (status != PLUS_SUCCESS)
+    {
+      // Do not retry until the next frame is requested
+      this->ReadAheadRequested = false;
+    }
+    else if (this->GetReplayDistance(this->RequestedFrameIndex, frameIndexToRead) <= this->NumberOfReadAheadFrames)
+    {
+      this->Cache[frameIndexToRead] = pixels;
+    }
+  }
+}
@@ -0,0 +1,89 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusStreamingFrameReader_h
+#define __PlusStreamingFrameReader_h
+
+#include "vtkPlusDataCollectionExport.h"
+#include "PlusSequenceFrameIndex.h"
+
+#include <igsioVideoFrame.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*!
+  \class PlusStreamingFrameReader
+  \brief Reads frames of an indexed sequence file on demand, with read-ahead
+
+  Only the frames that are about to be replayed are kept in memory: when a frame is requested, the following frames
+  (within the loop range) are read by a background thread, and frames that have already been replayed are released.
+
+  \ingroup PlusLibDataCollection
+*/
+class vtkPlusDataCollectionExport PlusStreamingFrameReader
+{
+public:
+  PlusStreamingFrameReader();
+  ~PlusStreamingFrameReader();
+
+  /*! Open the data file of the indexed sequence file and start the read-ahead thread */
+  PlusStatus Open(std::shared_ptr<const PlusSequenceFrameIndex> index, unsigned int numberOfReadAheadFrames);
+
+  /*! Stop the read-ahead thread and close the data file */
+  void Close();
+
+  /*! Frames between the first and last frame index (inclusive) are replayed in a loop, read-ahead wraps around after the last frame */
+  void SetLoopRange(unsigned int firstFrameIndex, unsigned int lastFrameIndex);
+
+  /*! Get the image of a frame. It is read from the file if it has not been read ahead. */
+  PlusStatus GetFrame(unsigned int frameIndex, igsioVideoFrame& frame);
+
+  /*! Number of requested frames that had not been read ahead */
+  unsigned long GetNumberOfCacheMisses() const { return this->NumberOfCacheMisses; }
+
+protected:
+  typedef std::shared_ptr<std::vector<unsigned char> > PixelBuffer;
+
+  /*! Read the pixel data of a frame from the data file */
+  PlusStatus ReadFrameData(unsigned int frameIndex, PixelBuffer& pixels);
+
+  /*! Number of frames from the first frame to the second one in replay order, taking the loop into account */
+  unsigned int GetReplayDistance(unsigned int fromFrameIndex, unsigned int toFrameIndex) const;
+
+  void ReadAheadThreadMain();
+
+  std::shared_ptr<const PlusSequenceFrameIndex> Index;
+
+  std::ifstream DataFile;
+  std::mutex DataFileMutex;
+
+  /*! Frames that have been read ahead, protected by CacheMutex */
+  std::map<unsigned int, PixelBuffer> Cache;
+  unsigned int RequestedFrameIndex;
+  bool ReadAheadRequested;
+  bool StopRequested;
+  unsigned int NumberOfReadAheadFrames;
+  unsigned int LoopFirstFrameIndex;
+  unsigned int LoopLastFrameIndex;
+  std::mutex CacheMutex;
+  std::condition_variable CacheCondition;
+
+  std::atomic<unsigned long> NumberOfCacheMisses;
+  std::thread ReadAheadThread;
+
+private:
+  PlusStreamingFrameReader(const PlusStreamingFrameReader&);
+  void operator=(const PlusStreamingFrameReader&);
+};
+
+#endif
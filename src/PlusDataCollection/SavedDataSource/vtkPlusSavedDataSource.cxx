@@ -5,6 +5,10 @@ See License.txt for details.
 =========================================================Plus=header=end*/
 
 #include "PlusConfigure.h"
+#include "PlusNewDataEvent.h"
+#include "PlusReplayClock.h"
+#include "PlusSequenceFrameIndex.h"
+#include "PlusStreamingFrameReader.h"
 #include "vtkImageData.h"
 #include "vtkMatrix4x4.h"
 #include "vtkIGSIOSequenceIO.h"
@@ -16,6 +20,9 @@ See License.txt for details.
 #include "vtkIGSIOTrackedFrameList.h"
 #include "vtksys/SystemTools.hxx"
 
+// STL includes
+#include <algorithm>
+
 vtkStandardNewMacro(vtkPlusSavedDataSource);
 
 //----------------------------------------------------------------------------
@@ -31,6 +38,10 @@ vtkPlusSavedDataSource::vtkPlusSavedDataSource()
   , LastAddedFrameUid(0)
   , LastAddedLoopIndex(0)
   , SimulatedStream(VIDEO_STREAM)
+  , StreamingEnabled(false)
+  , NumberOfReadAheadFrames(20)
+  , VirtualClockEnabled(false)
+  , StreamingFrameReader(new PlusStreamingFrameReader)
 {
   // No callback function provided by the device, so the data capture thread will be used to poll the hardware and add new items to the buffer
   this->StartThreadForInternalUpdates = true;
@@ -45,6 +56,8 @@ vtkPlusSavedDataSource::~vtkPlusSavedDataSource()
     this->Disconnect();
   }
   DeleteLocalBuffers();
+  delete this->StreamingFrameReader;
+  this->StreamingFrameReader = NULL;
 }
 
 //----------------------------------------------------------------------------
@@ -69,7 +82,11 @@ PlusStatus vtkPlusSavedDataSource::InternalUpdate()
   }
 
   PlusStatus status = PLUS_FAIL;
-  if (this->UseOriginalTimestamps)
+  if (this->VirtualClockEnabled)
+  {
+    status = InternalUpdateVirtualClock(frameToBeAddedUid, frameToBeAddedLoopIndex);
+  }
+  else if (this->UseOriginalTimestamps)
   {
     status = InternalUpdateOriginalTimestamp(frameToBeAddedUid, frameToBeAddedLoopIndex);
   }
@@ -108,7 +125,7 @@ PlusStatus vtkPlusSavedDataSource::InternalUpdateOriginalTimestamp(BufferItemUid
       currentLoopIndex = floor(elapsedTime / loopTime);
       currentFrameTime_Local = this->LoopStartTime_Local + elapsedTime - loopTime * currentLoopIndex;
       double latestTimestamp_Local = 0;
-      GetLocalBuffer()->GetLatestTimeStamp(latestTimestamp_Local);
+      GetLocalLatestTimeStamp(latestTimestamp_Local);
       if (currentFrameTime_Local > latestTimestamp_Local)
       {
         // hold the last frame after the end of the buffer
@@ -119,9 +136,9 @@ PlusStatus vtkPlusSavedDataSource::InternalUpdateOriginalTimestamp(BufferItemUid
 
     // Get the uid of the frame that has been most recently acquired
     BufferItemUidType closestFrameUid = 0;
-    GetLocalBuffer()->GetItemUidFromTime(currentFrameTime_Local, closestFrameUid);
+    GetLocalItemUidFromTime(currentFrameTime_Local, closestFrameUid);
     double closestFrameTime_Local = 0;
-    GetLocalBuffer()->GetTimeStamp(closestFrameUid, closestFrameTime_Local);
+    GetLocalTimeStamp(closestFrameUid, closestFrameTime_Local);
     if (closestFrameTime_Local > currentFrameTime_Local)
     {
       // the closest frame is newer than the current time, so don't use this item but the one before
@@ -156,7 +173,7 @@ PlusStatus vtkPlusSavedDataSource::InternalUpdateOriginalTimestamp(BufferItemUid
     this->FrameNumber++;
 
     StreamBufferItem dataBufferItemToBeAdded;
-    if (GetLocalBuffer()->GetStreamBufferItem(frameToBeAddedUid, &dataBufferItemToBeAdded) != ITEM_OK)
+    if (GetLocalStreamBufferItem(frameToBeAddedUid, &dataBufferItemToBeAdded) != ITEM_OK)
     {
       LOG_ERROR("vtkPlusSavedDataSource: Failed to retrieve item from the buffer, UID=" << frameToBeAddedUid);
       status = PLUS_FAIL;
@@ -169,84 +186,141 @@ PlusStatus vtkPlusSavedDataSource::InternalUpdateOriginalTimestamp(BufferItemUid
                                this->LoopStartTime_Local + this->GetOutputDataSource()->GetStartTime();
     double unfilteredTimestamp = filteredTimestamp; // we ignore unfiltered timestamps
 
-    switch (this->SimulatedStream)
+    if (this->AddItemWithOriginalTimestamp(dataBufferItemToBeAdded, unfilteredTimestamp, filteredTimestamp) != PLUS_SUCCESS)
     {
-      case VIDEO_STREAM:
+      status = PLUS_FAIL;
+    }
+
+    this->LastAddedFrameUid = frameToBeAddedUid;
+    this->LastAddedLoopIndex = frameToBeAddedLoopIndex;
+
+    frameToBeAddedUid++;
+    if (frameToBeAddedUid > this->LoopLastFrameUid)
+    {
+      frameToBeAddedLoopIndex++;
+      frameToBeAddedUid -= numberOfFramesInTheLoop;
+    }
+  }
+
+  this->Modified();
+  return status;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSavedDataSource::InternalUpdateVirtualClock(BufferItemUidType frameToBeAddedUid, int frameToBeAddedLoopIndex)
+{
+  PlusReplayClock& replayClock = PlusReplayClock::GetInstance();
+  if (!this->RepeatEnabled && frameToBeAddedLoopIndex > 0)
+  {
+    // all frames are replayed, the other producers do not have to wait for this one anymore
+    replayClock.SetProducerFinished(this);
+    return PLUS_SUCCESS;
+  }
+
+  // The original time differences are kept, independently of how fast the frames are replayed
+  double frameTime_Local = 0;
+  if (GetLocalTimeStamp(frameToBeAddedUid, frameTime_Local) != ITEM_OK)
+  {
+    LOG_ERROR("vtkPlusSavedDataSource: Failed to retrieve timestamp from the buffer, UID=" << frameToBeAddedUid);
+    return PLUS_FAIL;
+  }
+  double loopTime = this->LoopStopTime_Local - this->LoopStartTime_Local;
+  double filteredTimestamp = frameTime_Local + frameToBeAddedLoopIndex * loopTime - this->LoopStartTime_Local + this->GetOutputDataSource()->GetStartTime();
+
+  if (!replayClock.RequestTurn(this, filteredTimestamp))
+  {
+    // consumers are still processing the previous frames or another source replays an earlier frame first,
+    // the update thread is woken up when this source can continue
+    return PLUS_SUCCESS;
+  }
+
+  this->FrameNumber++;
+  StreamBufferItem dataBufferItemToBeAdded;
+  if (GetLocalStreamBufferItem(frameToBeAddedUid, &dataBufferItemToBeAdded) != ITEM_OK)
+  {
+    LOG_ERROR("vtkPlusSavedDataSource: Failed to retrieve item from the buffer, UID=" << frameToBeAddedUid);
+    return PLUS_FAIL;
+  }
+  PlusStatus status = this->AddItemWithOriginalTimestamp(dataBufferItemToBeAdded, filteredTimestamp, filteredTimestamp);
+
+  this->LastAddedFrameUid = frameToBeAddedUid;
+  this->LastAddedLoopIndex = frameToBeAddedLoopIndex;
+  replayClock.CompleteTurn(this, filteredTimestamp);
+
+  this->Modified();
+  return status;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSavedDataSource::AddItemWithOriginalTimestamp(StreamBufferItem& dataBufferItemToBeAdded, double unfilteredTimestamp, double filteredTimestamp)
+{
+  PlusStatus status(PLUS_SUCCESS);
+  switch (this->SimulatedStream)
+  {
+    case VIDEO_STREAM:
+      {
+        igsioFieldMapType fieldMap;
+        if (this->UseAllFrameFields)
         {
-          igsioFieldMapType fieldMap;
-          if (this->UseAllFrameFields)
-          {
-            fieldMap = dataBufferItemToBeAdded.GetFrameFieldMap();
-          }
-          if (this->AddVideoItemToVideoSources(this->GetVideoSources(), dataBufferItemToBeAdded.GetFrame(), this->FrameNumber, unfilteredTimestamp, filteredTimestamp, &fieldMap) != PLUS_SUCCESS)
-          {
-            status = PLUS_FAIL;
-          }
-          break;
+          fieldMap = dataBufferItemToBeAdded.GetFrameFieldMap();
         }
-      case TRACKER_STREAM:
+        if (this->AddVideoItemToVideoSources(this->GetVideoSources(), dataBufferItemToBeAdded.GetFrame(), this->FrameNumber, unfilteredTimestamp, filteredTimestamp, &fieldMap) != PLUS_SUCCESS)
         {
-          // retrieve timestamp from the first active tool and add all the tool matrices corresponding to that timestamp
-          double nextFrameTimestamp = dataBufferItemToBeAdded.GetFilteredTimestamp(0.0);
+          status = PLUS_FAIL;
+        }
+        break;
+      }
+    case TRACKER_STREAM:
+      {
+        // retrieve timestamp from the first active tool and add all the tool matrices corresponding to that timestamp
+        double nextFrameTimestamp = dataBufferItemToBeAdded.GetFilteredTimestamp(0.0);
 
-          for (DataSourceContainerConstIterator it = this->GetToolIteratorBegin(); it != this->GetToolIteratorEnd(); ++it)
+        for (DataSourceContainerConstIterator it = this->GetToolIteratorBegin(); it != this->GetToolIteratorEnd(); ++it)
+        {
+          vtkPlusDataSource* tool = it->second;
+          StreamBufferItem bufferItem;
+          ItemStatus itemStatus = this->LocalTrackerBuffers[tool->GetId()]->GetStreamBufferItemFromTime(nextFrameTimestamp, &bufferItem, vtkPlusBuffer::INTERPOLATED);
+          if (itemStatus != ITEM_OK)
           {
-            vtkPlusDataSource* tool = it->second;
-            StreamBufferItem bufferItem;
-            ItemStatus itemStatus = this->LocalTrackerBuffers[tool->GetId()]->GetStreamBufferItemFromTime(nextFrameTimestamp, &bufferItem, vtkPlusBuffer::INTERPOLATED);
-            if (itemStatus != ITEM_OK)
+            if (itemStatus == ITEM_NOT_AVAILABLE_YET)
             {
-              if (itemStatus == ITEM_NOT_AVAILABLE_YET)
-              {
-                LOG_ERROR("vtkPlusSavedDataSource: Unable to get next item from local buffer from time for tool " << tool->GetId() << " - frame not available yet!");
-              }
-              else if (itemStatus == ITEM_NOT_AVAILABLE_ANYMORE)
-              {
-                LOG_ERROR("vtkPlusSavedDataSource: Unable to get next item from local buffer from time for tool " << tool->GetId() << " - frame not available anymore!");
-              }
-              else
-              {
-                LOG_ERROR("vtkPlusSavedDataSource: Unable to get next item from local buffer from time for tool " << tool->GetId() << "!");
-              }
-              status = PLUS_FAIL;
-              continue;
+              LOG_ERROR("vtkPlusSavedDataSource: Unable to get next item from local buffer from time for tool " << tool->GetId() << " - frame not available yet!");
             }
-            // Get default transform
-            vtkSmartPointer<vtkMatrix4x4> toolTransMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
-            if (bufferItem.GetMatrix(toolTransMatrix) != PLUS_SUCCESS)
+            else if (itemStatus == ITEM_NOT_AVAILABLE_ANYMORE)
             {
-              LOG_ERROR("Failed to get toolTransMatrix for tool " << tool->GetId());
-              status = PLUS_FAIL;
-              continue;
+              LOG_ERROR("vtkPlusSavedDataSource: Unable to get next item from local buffer from time for tool " << tool->GetId() << " - frame not available anymore!");
             }
-            // Get flags
-            ToolStatus toolStatus = bufferItem.GetStatus();
-            // This device has no frame numbering, just auto increment tool frame number if new frame received
-            // send the transformation matrix and flags to the tool
-            if (this->ToolTimeStampedUpdateWithoutFiltering(tool->GetId(), toolTransMatrix, toolStatus, unfilteredTimestamp, filteredTimestamp) != PLUS_SUCCESS)
+            else
             {
-              status = PLUS_FAIL;
+              LOG_ERROR("vtkPlusSavedDataSource: Unable to get next item from local buffer from time for tool " << tool->GetId() << "!");
             }
+            status = PLUS_FAIL;
+            continue;
+          }
+          // Get default transform
+          vtkSmartPointer<vtkMatrix4x4> toolTransMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+          if (bufferItem.GetMatrix(toolTransMatrix) != PLUS_SUCCESS)
+          {
+            LOG_ERROR("Failed to get toolTransMatrix for tool " << tool->GetId());
+            status = PLUS_FAIL;
+            continue;
+          }
+          // Get flags
+          ToolStatus toolStatus = bufferItem.GetStatus();
+          // This device has no frame numbering, just auto increment tool frame number if new frame received
+          // send the transformation matrix and flags to the tool
+          if (this->ToolTimeStampedUpdateWithoutFiltering(tool->GetId(), toolTransMatrix, toolStatus, unfilteredTimestamp, filteredTimestamp) != PLUS_SUCCESS)
+          {
+            status = PLUS_FAIL;
           }
         }
-        break;
-      default:
-        LOG_ERROR("Unknown stream type: " << this->SimulatedStream);
-        return PLUS_FAIL;
-    }
-
-    this->LastAddedFrameUid = frameToBeAddedUid;
-    this->LastAddedLoopIndex = frameToBeAddedLoopIndex;
-
-    frameToBeAddedUid++;
-    if (frameToBeAddedUid > this->LoopLastFrameUid)
-    {
-      frameToBeAddedLoopIndex++;
-      frameToBeAddedUid -= numberOfFramesInTheLoop;
-    }
+      }
+      break;
+    default:
+      LOG_ERROR("Unknown stream type: " << this->SimulatedStream);
+      return PLUS_FAIL;
   }
 
-  this->Modified();
   return status;
 }
 
@@ -263,7 +337,7 @@ PlusStatus vtkPlusSavedDataSource::InternalUpdateCurrentTimestamp(BufferItemUidT
 
   this->FrameNumber++;
   StreamBufferItem dataBufferItemToBeAdded;
-  if (GetLocalBuffer()->GetStreamBufferItem(frameToBeAddedUid, &dataBufferItemToBeAdded) != ITEM_OK)
+  if (GetLocalStreamBufferItem(frameToBeAddedUid, &dataBufferItemToBeAdded) != ITEM_OK)
   {
     LOG_ERROR("vtkPlusSavedDataSource: Failed to retrieve item from the buffer, UID=" << frameToBeAddedUid);
     return PLUS_FAIL;
@@ -379,28 +453,57 @@ PlusStatus vtkPlusSavedDataSource::InternalConnect()
     return PLUS_FAIL;
   }
 
-  vtkSmartPointer<vtkIGSIOTrackedFrameList> savedDataBuffer = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
-
-  // Read sequence file into tracked frame list
-  vtkIGSIOSequenceIO::Read(foundAbsoluteImagePath, savedDataBuffer);
-
-  if (savedDataBuffer->GetNumberOfTrackedFrames() < 1)
+  this->StreamingFrameReader->Close();
+  this->StreamingFrameIndex.reset();
+  if (this->StreamingEnabled)
   {
-    LOG_ERROR("Failed to connect to saved dataset - there is no frame in the sequence metafile!");
-    return PLUS_FAIL;
+    if (this->SimulatedStream != VIDEO_STREAM)
+    {
+      LOG_WARNING("Streaming replay is only available for image data, the whole sequence file is loaded: " << foundAbsoluteImagePath);
+    }
+    else
+    {
+      std::shared_ptr<PlusSequenceFrameIndex> frameIndex = std::make_shared<PlusSequenceFrameIndex>();
+      if (frameIndex->Load(foundAbsoluteImagePath) == PLUS_SUCCESS && frameIndex->GetNumberOfFrames() > 0)
+      {
+        this->StreamingFrameIndex = frameIndex;
+      }
+      else
+      {
+        LOG_WARNING("Sequence file cannot be streamed (only uncompressed MetaImage and NRRD files and NRRD files compressed with a frame index are supported), the whole file is loaded: " << foundAbsoluteImagePath);
+      }
+    }
   }
 
   PlusStatus status = PLUS_FAIL;
-  switch (this->SimulatedStream)
+  if (this->StreamingFrameIndex)
   {
-    case VIDEO_STREAM:
-      status = InternalConnectVideo(savedDataBuffer);
-      break;
-    case TRACKER_STREAM:
-      status = InternalConnectTracker(savedDataBuffer);
-      break;
-    default:
-      LOG_ERROR("Unknown stream type: " << this->SimulatedStream);
+    status = InternalConnectStreaming();
+  }
+  else
+  {
+    vtkSmartPointer<vtkIGSIOTrackedFrameList> savedDataBuffer = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+
+    // Read sequence file into tracked frame list
+    vtkIGSIOSequenceIO::Read(foundAbsoluteImagePath, savedDataBuffer);
+
+    if (savedDataBuffer->GetNumberOfTrackedFrames() < 1)
+    {
+      LOG_ERROR("Failed to connect to saved dataset - there is no frame in the sequence metafile!");
+      return PLUS_FAIL;
+    }
+
+    switch (this->SimulatedStream)
+    {
+      case VIDEO_STREAM:
+        status = InternalConnectVideo(savedDataBuffer);
+        break;
+      case TRACKER_STREAM:
+        status = InternalConnectTracker(savedDataBuffer);
+        break;
+      default:
+        LOG_ERROR("Unknown stream type: " << this->SimulatedStream);
+    }
   }
 
   if (status != PLUS_SUCCESS)
@@ -408,28 +511,28 @@ PlusStatus vtkPlusSavedDataSource::InternalConnect()
     return PLUS_FAIL;
   }
 
-  if (GetLocalBuffer() == NULL)
+  if (!this->StreamingFrameIndex && GetLocalBuffer() == NULL)
   {
     LOG_ERROR("Local buffer is invalid");
     return PLUS_FAIL;
   }
 
   double oldestTimestamp_Local = 0;
-  GetLocalBuffer()->GetOldestTimeStamp(oldestTimestamp_Local);
+  GetLocalOldestTimeStamp(oldestTimestamp_Local);
   double latestTimestamp_Local = 0;
-  GetLocalBuffer()->GetLatestTimeStamp(latestTimestamp_Local);
+  GetLocalLatestTimeStamp(latestTimestamp_Local);
 
   // Set the default loop start time and length to match the video buffer start time and length
 
-  this->LoopFirstFrameUid = GetLocalBuffer()->GetOldestItemUidInBuffer();
-  this->LoopLastFrameUid = GetLocalBuffer()->GetLatestItemUidInBuffer();
+  this->LoopFirstFrameUid = GetLocalOldestItemUid();
+  this->LoopLastFrameUid = GetLocalLatestItemUid();
 
   this->LoopStartTime_Local = oldestTimestamp_Local;
 
   // When we reach the last frame we have to wait one frame period before
   // playing the first frame, so we have to add one frame period to the loop length (loopTime)
   double framePeriodSec = 0;
-  double frameRate = GetLocalBuffer()->GetFrameRate();
+  double frameRate = GetLocalFrameRate();
   if (frameRate != 0.0)
   {
     framePeriodSec = 1.0 / frameRate;
@@ -548,6 +651,67 @@ PlusStatus vtkPlusSavedDataSource::InternalConnectVideo(vtkIGSIOTrackedFrameList
   return result;
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSavedDataSource::InternalConnectStreaming()
+{
+  vtkPlusDataSource* outputDataSource = this->GetOutputDataSource();
+  if (outputDataSource == NULL)
+  {
+    return PLUS_FAIL;
+  }
+  if (outputDataSource->SetImageType(this->StreamingFrameIndex->GetImageType()) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to set video buffer image type");
+    return PLUS_FAIL;
+  }
+
+  // Frames are read from the file during replay, no local buffer is needed
+  DeleteLocalBuffers();
+  if (this->StreamingFrameReader->Open(this->StreamingFrameIndex, static_cast<unsigned int>(std::max(0, this->NumberOfReadAheadFrames))) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to open sequence file for streaming: " << this->StreamingFrameIndex->GetSequenceFilename());
+    return PLUS_FAIL;
+  }
+
+  PlusStatus result(PLUS_SUCCESS);
+  for (DataSourceContainerIterator it = this->VideoSources.begin(); it != this->VideoSources.end(); ++it)
+  {
+    vtkPlusDataSource* source(it->second);
+
+    if (source->SetInputImageOrientation(this->StreamingFrameIndex->GetImageOrientation()) != PLUS_SUCCESS)
+    {
+      LOG_ERROR(source->GetId() << ": Failed to set video image orientation");
+      result = PLUS_FAIL;
+      continue;
+    }
+
+    if (source->SetNumberOfScalarComponents(this->StreamingFrameIndex->GetNumberOfScalarComponents()) != PLUS_SUCCESS)
+    {
+      LOG_ERROR(source->GetId() << ": Failed to set number of scalar components");
+      result = PLUS_FAIL;
+      continue;
+    }
+
+    source->Clear();
+
+    if (source->SetInputFrameSize(this->StreamingFrameIndex->GetFrameSize()) != PLUS_SUCCESS)
+    {
+      LOG_ERROR(source->GetId() << ": Failed to set video frame size");
+      result = PLUS_FAIL;
+      continue;
+    }
+
+    if (source->SetPixelType(this->StreamingFrameIndex->GetPixelType()) != PLUS_SUCCESS)
+    {
+      LOG_ERROR(source->GetId() << ": Failed to set video pixel type");
+      result = PLUS_FAIL;
+      continue;
+    }
+  }
+
+  return result;
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusSavedDataSource::InternalConnectTracker(vtkIGSIOTrackedFrameList* savedDataBuffer)
 {
@@ -613,10 +777,34 @@ PlusStatus vtkPlusSavedDataSource::InternalConnectTracker(vtkIGSIOTrackedFrameLi
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusSavedDataSource::InternalDisconnect()
 {
+  this->StreamingFrameReader->Close();
+  this->StreamingFrameIndex.reset();
   DeleteLocalBuffers();
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSavedDataSource::InternalStartRecording()
+{
+  if (this->VirtualClockEnabled)
+  {
+    // The update thread waits on this event, it is signaled by the replay clock when the next frame can be added
+    this->InputDataEvent = std::make_shared<PlusNewDataEvent>();
+    PlusReplayClock::GetInstance().AddProducer(this, this->InputDataEvent);
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSavedDataSource::InternalStopRecording()
+{
+  if (this->VirtualClockEnabled)
+  {
+    PlusReplayClock::GetInstance().RemoveProducer(this);
+  }
+  return PLUS_SUCCESS;
+}
+
 //-----------------------------------------------------------------------------
 PlusStatus vtkPlusSavedDataSource::ReadConfiguration(vtkXMLDataElement* rootConfigElement)
 {
@@ -670,6 +858,9 @@ PlusStatus vtkPlusSavedDataSource::ReadConfiguration(vtkXMLDataElement* rootConf
 
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(RepeatEnabled, deviceConfig);
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(UseOriginalTimestamps, deviceConfig);
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(StreamingEnabled, deviceConfig);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, NumberOfReadAheadFrames, deviceConfig);
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(VirtualClockEnabled, deviceConfig);
 
   const char* useData = deviceConfig->GetAttribute("UseData");
   if (useData != NULL)
@@ -707,6 +898,9 @@ PlusStatus vtkPlusSavedDataSource::WriteConfiguration(vtkXMLDataElement* rootCon
   XML_WRITE_CSTRING_ATTRIBUTE_IF_NOT_NULL(SequenceFile, imageAcquisitionConfig);
   XML_WRITE_BOOL_ATTRIBUTE(RepeatEnabled, imageAcquisitionConfig);
   XML_WRITE_BOOL_ATTRIBUTE(UseOriginalTimestamps, imageAcquisitionConfig);
+  XML_WRITE_BOOL_ATTRIBUTE(StreamingEnabled, imageAcquisitionConfig);
+  imageAcquisitionConfig->SetIntAttribute("NumberOfReadAheadFrames", this->NumberOfReadAheadFrames);
+  XML_WRITE_BOOL_ATTRIBUTE(VirtualClockEnabled, imageAcquisitionConfig);
 
   if (this->UseAllFrameFields)
   {
@@ -776,6 +970,11 @@ void vtkPlusSavedDataSource::SetLoopTimeRange(double loopStartTime, double loopS
 
   this->LastAddedFrameUid = this->LoopFirstFrameUid - 1;
   this->LastAddedLoopIndex = 0;
+
+  if (this->StreamingFrameIndex)
+  {
+    this->StreamingFrameReader->SetLoopRange(this->LoopFirstFrameUid - 1, this->LoopLastFrameUid - 1);
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -792,9 +991,9 @@ BufferItemUidType vtkPlusSavedDataSource::GetClosestFrameUidWithinTimeRange(doub
   }
   // time_Local should be also within the local buffer time range
   double oldestTimestamp_Local = 0;
-  GetLocalBuffer()->GetOldestTimeStamp(oldestTimestamp_Local);
+  GetLocalOldestTimeStamp(oldestTimestamp_Local);
   double latestTimestamp_Local = 0;
-  GetLocalBuffer()->GetLatestTimeStamp(latestTimestamp_Local);
+  GetLocalLatestTimeStamp(latestTimestamp_Local);
 
   // if the asked time is outside of the loop range then return the closest element in the range
   if (time_Local < oldestTimestamp_Local)
@@ -808,9 +1007,9 @@ BufferItemUidType vtkPlusSavedDataSource::GetClosestFrameUidWithinTimeRange(doub
 
   // Get the uid of the frame that has been most recently acquired
   BufferItemUidType closestFrameUid = 0;
-  GetLocalBuffer()->GetItemUidFromTime(time_Local, closestFrameUid);
+  GetLocalItemUidFromTime(time_Local, closestFrameUid);
   double closestFrameTime_Local = 0;
-  GetLocalBuffer()->GetTimeStamp(closestFrameUid, closestFrameTime_Local);
+  GetLocalTimeStamp(closestFrameUid, closestFrameTime_Local);
 
   // The closest frame is at the boundary, but it may be just outside the range:
   // use the next/previous frame if the closest frame is on the wrong side of the boundary
@@ -885,6 +1084,140 @@ vtkPlusBuffer* vtkPlusSavedDataSource::GetLocalBuffer()
   return buff;
 }
 
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusSavedDataSource::GetLocalStreamBufferItem(BufferItemUidType uid, StreamBufferItem* bufferItem)
+{
+  if (!this->StreamingFrameIndex)
+  {
+    vtkPlusBuffer* localBuffer = GetLocalBuffer();
+    return (localBuffer != NULL) ? localBuffer->GetStreamBufferItem(uid, bufferItem) : ITEM_UNKNOWN_ERROR;
+  }
+
+  if (uid < this->GetLocalOldestItemUid())
+  {
+    return ITEM_NOT_AVAILABLE_ANYMORE;
+  }
+  if (uid > this->GetLocalLatestItemUid())
+  {
+    return ITEM_NOT_AVAILABLE_YET;
+  }
+  unsigned int frameIndex = static_cast<unsigned int>(uid - 1);
+  if (this->StreamingFrameReader->GetFrame(frameIndex, bufferItem->GetFrame()) != PLUS_SUCCESS)
+  {
+    return ITEM_UNKNOWN_ERROR;
+  }
+
+  const PlusSequenceFrameIndex::FrameEntry& frame = this->StreamingFrameIndex->GetFrame(frameIndex);
+  bufferItem->SetFilteredTimestamp(frame.Timestamp);
+  bufferItem->SetUnfilteredTimestamp(frame.Timestamp);
+  bufferItem->SetIndex(frameIndex);
+  bufferItem->SetUid(uid);
+  if (this->UseAllFrameFields)
+  {
+    for (PlusSequenceFrameIndex::FrameFieldList::const_iterator it = frame.Fields.begin(); it != frame.Fields.end(); ++it)
+    {
+      bufferItem->SetFrameField(it->first, it->second);
+    }
+  }
+  return ITEM_OK;
+}
+
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusSavedDataSource::GetLocalTimeStamp(BufferItemUidType uid, double& timestamp)
+{
+  if (!this->StreamingFrameIndex)
+  {
+    vtkPlusBuffer* localBuffer = GetLocalBuffer();
+    return (localBuffer != NULL) ? localBuffer->GetTimeStamp(uid, timestamp) : ITEM_UNKNOWN_ERROR;
+  }
+
+  if (uid < this->GetLocalOldestItemUid())
+  {
+    return ITEM_NOT_AVAILABLE_ANYMORE;
+  }
+  if (uid > this->GetLocalLatestItemUid())
+  {
+    return ITEM_NOT_AVAILABLE_YET;
+  }
+  timestamp = this->StreamingFrameIndex->GetFrame(static_cast<unsigned int>(uid - 1)).Timestamp;
+  return ITEM_OK;
+}
+
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusSavedDataSource::GetLocalOldestTimeStamp(double& timestamp)
+{
+  if (!this->StreamingFrameIndex)
+  {
+    vtkPlusBuffer* localBuffer = GetLocalBuffer();
+    return (localBuffer != NULL) ? localBuffer->GetOldestTimeStamp(timestamp) : ITEM_UNKNOWN_ERROR;
+  }
+  return this->GetLocalTimeStamp(this->GetLocalOldestItemUid(), timestamp);
+}
+
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusSavedDataSource::GetLocalLatestTimeStamp(double& timestamp)
+{
+  if (!this->StreamingFrameIndex)
+  {
+    vtkPlusBuffer* localBuffer = GetLocalBuffer();
+    return (localBuffer != NULL) ? localBuffer->GetLatestTimeStamp(timestamp) : ITEM_UNKNOWN_ERROR;
+  }
+  return this->GetLocalTimeStamp(this->GetLocalLatestItemUid(), timestamp);
+}
+
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusSavedDataSource::GetLocalItemUidFromTime(double time, BufferItemUidType& uid)
+{
+  if (!this->StreamingFrameIndex)
+  {
+    vtkPlusBuffer* localBuffer = GetLocalBuffer();
+    return (localBuffer != NULL) ? localBuffer->GetItemUidFromTime(time, uid) : ITEM_UNKNOWN_ERROR;
+  }
+
+  uid = this->StreamingFrameIndex->GetFrameIndexFromTime(time) + 1;
+  return ITEM_OK;
+}
+
+//----------------------------------------------------------------------------
+BufferItemUidType vtkPlusSavedDataSource::GetLocalOldestItemUid()
+{
+  if (!this->StreamingFrameIndex)
+  {
+    vtkPlusBuffer* localBuffer = GetLocalBuffer();
+    return (localBuffer != NULL) ? localBuffer->GetOldestItemUidInBuffer() : 0;
+  }
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+BufferItemUidType vtkPlusSavedDataSource::GetLocalLatestItemUid()
+{
+  if (!this->StreamingFrameIndex)
+  {
+    vtkPlusBuffer* localBuffer = GetLocalBuffer();
+    return (localBuffer != NULL) ? localBuffer->GetLatestItemUidInBuffer() : 0;
+  }
+  return this->StreamingFrameIndex->GetNumberOfFrames();
+}
+
+//----------------------------------------------------------------------------
+double vtkPlusSavedDataSource::GetLocalFrameRate()
+{
+  if (!this->StreamingFrameIndex)
+  {
+    vtkPlusBuffer* localBuffer = GetLocalBuffer();
+    return (localBuffer != NULL) ? localBuffer->GetFrameRate() : 0.0;
+  }
+
+  unsigned int numberOfFrames = this->StreamingFrameIndex->GetNumberOfFrames();
+  if (numberOfFrames < 2)
+  {
+    return 0.0;
+  }
+  double duration = this->StreamingFrameIndex->GetFrame(numberOfFrames - 1).Timestamp - this->StreamingFrameIndex->GetFrame(0).Timestamp;
+  return (duration > 0) ? (numberOfFrames - 1) / duration : 0.0;
+}
+
 //----------------------------------------------------------------------------
 vtkPlusDataSource* vtkPlusSavedDataSource::GetOutputDataSource()
 {
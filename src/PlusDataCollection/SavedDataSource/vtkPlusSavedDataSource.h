@@ -11,7 +11,11 @@ See License.txt for details.
 
 #include "vtkPlusDevice.h"
 
+#include <memory>
+
 class vtkPlusBuffer;
+class PlusSequenceFrameIndex;
+class PlusStreamingFrameReader;
 
 class vtkPlusDataCollectionExport vtkPlusSavedDataSource;
 
@@ -27,6 +31,16 @@ Attributes:
 \li UseOriginalTimestamps: if true then the original timestamps (recorded originally in the source file)
   will be replayed exactly, otherwise only the timestamp difference will be replayed exactly,
   starting from the current time (TRUE|FALSE)
+\li StreamingEnabled: if true then image frames are read from the file as they are replayed, instead of loading
+  the whole file into memory. Uncompressed MetaImage and NRRD files and compressed NRRD files written with a frame
+  index can be streamed, other files are loaded as usual. The frame index is cached in a sidecar file (.fidx) next to the sequence file. (TRUE|FALSE, default: FALSE)
+\li NumberOfReadAheadFrames: number of frames that are read in the background before they are replayed,
+  only used if StreamingEnabled is TRUE (default: 20)
+\li VirtualClockEnabled: if true then the frames are not replayed at the recorded frame rate but as fast as the
+  devices that process them can keep up: the next frame is added when all devices that wait for input data have
+  processed the previous one (see PlusReplayClock). The frames are delivered one by one in the same order on
+  every run, with the original time differences between their timestamps, so results are reproducible
+  independently of the speed of the computer. (TRUE|FALSE, default: FALSE)
 
 */
 class vtkPlusDataCollectionExport vtkPlusSavedDataSource : public vtkPlusDevice
@@ -73,6 +87,25 @@ public:
   /*! Read the timestamps from the file and use provide them in the output (instead of the current time) */
   vtkBooleanMacro( UseOriginalTimestamps, bool );
 
+  /*! Read image frames from the file as they are replayed, instead of loading the whole file into memory */
+  vtkGetMacro( StreamingEnabled, bool );
+  /*! Read image frames from the file as they are replayed, instead of loading the whole file into memory */
+  vtkSetMacro( StreamingEnabled, bool );
+  /*! Read image frames from the file as they are replayed, instead of loading the whole file into memory */
+  vtkBooleanMacro( StreamingEnabled, bool );
+
+  /*! Number of frames that are read ahead in the background when streaming is enabled */
+  vtkGetMacro( NumberOfReadAheadFrames, int );
+  /*! Number of frames that are read ahead in the background when streaming is enabled */
+  vtkSetMacro( NumberOfReadAheadFrames, int );
+
+  /*! Replay the frames as fast as the consumers process them, following a simulated clock (see PlusReplayClock) */
+  vtkGetMacro( VirtualClockEnabled, bool );
+  /*! Replay the frames as fast as the consumers process them, following a simulated clock (see PlusReplayClock) */
+  vtkSetMacro( VirtualClockEnabled, bool );
+  /*! Replay the frames as fast as the consumers process them, following a simulated clock (see PlusReplayClock) */
+  vtkBooleanMacro( VirtualClockEnabled, bool );
+
   /*! Get local video buffer */
   vtkGetObjectMacro( LocalVideoBuffer, vtkPlusBuffer );
 
@@ -101,9 +134,18 @@ protected:
   /*! Connect to device, in case the output is a tracker stream */
   virtual PlusStatus InternalConnectTracker( vtkIGSIOTrackedFrameList* savedDataBuffer );
 
+  /*! Connect to device, in case the output is a video stream that is read from the file during replay */
+  virtual PlusStatus InternalConnectStreaming();
+
   /*! Disconnect from device */
   virtual PlusStatus InternalDisconnect();
 
+  /*! Register the device in the replay clock if the virtual clock is enabled */
+  virtual PlusStatus InternalStartRecording();
+
+  /*! Unregister the device from the replay clock */
+  virtual PlusStatus InternalStopRecording();
+
   /*! The internal function which actually does the grab.  */
   PlusStatus InternalUpdate();
 
@@ -113,6 +155,12 @@ protected:
   /*! Internal update, called when the original timestamps are used */
   PlusStatus InternalUpdateOriginalTimestamp( BufferItemUidType frameToBeAddedUid, int frameToBeAddedLoopIndex );
 
+  /*! Internal update, called when the virtual clock is enabled. Adds at most one frame. */
+  PlusStatus InternalUpdateVirtualClock( BufferItemUidType frameToBeAddedUid, int frameToBeAddedLoopIndex );
+
+  /*! Add a frame (or the tool transforms at the time of the frame) to the output with the specified timestamps */
+  PlusStatus AddItemWithOriginalTimestamp( StreamBufferItem& dataBufferItemToBeAdded, double unfilteredTimestamp, double filteredTimestamp );
+
   BufferItemUidType GetClosestFrameUidWithinTimeRange( double time_Local, double startTime_Local, double stopTime_Local );
 
   /*! Get local tracker buffer */
@@ -129,6 +177,19 @@ protected:
 
   void DeleteLocalBuffers();
 
+  /*!
+    Access to the replayed frames. Items are retrieved from the local buffer, or from the
+    sequence file if streaming is enabled (in this case the UID of a frame is its index + 1).
+  */
+  ItemStatus GetLocalStreamBufferItem( BufferItemUidType uid, StreamBufferItem* bufferItem );
+  ItemStatus GetLocalTimeStamp( BufferItemUidType uid, double& timestamp );
+  ItemStatus GetLocalOldestTimeStamp( double& timestamp );
+  ItemStatus GetLocalLatestTimeStamp( double& timestamp );
+  ItemStatus GetLocalItemUidFromTime( double time, BufferItemUidType& uid );
+  BufferItemUidType GetLocalOldestItemUid();
+  BufferItemUidType GetLocalLatestItemUid();
+  double GetLocalFrameRate();
+
 protected:
   /*! Byte alignment of each row in the framebuffer */
   int FrameBufferRowAlignment;
@@ -181,6 +242,21 @@ protected:
 
   SimulatedStreamType SimulatedStream;
 
+  /*! Read image frames from the file as they are replayed, instead of loading the whole file into memory */
+  bool StreamingEnabled;
+
+  /*! Number of frames that are read ahead in the background when streaming is enabled */
+  int NumberOfReadAheadFrames;
+
+  /*! Frame index of the streamed sequence file, empty if the frames are replayed from the local buffers */
+  std::shared_ptr<PlusSequenceFrameIndex> StreamingFrameIndex;
+
+  /*! Reads the frames of the streamed sequence file */
+  PlusStreamingFrameReader* StreamingFrameReader;
+
+  /*! Replay the frames as fast as the consumers process them, following a simulated clock */
+  bool VirtualClockEnabled;
+
 private:
   static vtkPlusSavedDataSource* Instance;
   vtkPlusSavedDataSource( const vtkPlusSavedDataSource& ); // Not implemented.
@@ -0,0 +1,43 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusSharedMemoryVideoFrameHeader_h
+#define __PlusSharedMemoryVideoFrameHeader_h
+
+#include <igtl_types.h>
+
+/*!
+  \struct PlusSharedMemoryVideoFrameHeader
+  \brief Stored before the pixel data of each frame in the shared memory ring of vtkPlusSharedMemoryVideoWriter
+
+  The pixel data follows the header directly, rows are contiguous. Both processes run on the same host,
+  so the fields are stored in the native byte order.
+
+  \ingroup PlusLibDataCollection
+*/
+struct PlusSharedMemoryVideoFrameHeader
+{
+  enum
+  {
+    MAGIC = 0x504c5346, // "PLSF"
+    VERSION = 1
+  };
+
+  igtl_uint32 Magic;
+  igtl_uint32 Version;
+  igtl_uint64 FrameNumber;
+  /*! Timestamp of the frame in universal time, as the system time of the two processes is not the same */
+  double TimestampUniversal;
+  igtl_uint32 FrameSize[3];
+  igtl_int32 PixelType;
+  igtl_uint32 NumberOfScalarComponents;
+  igtl_int32 ImageType;
+  igtl_int32 ImageOrientation;
+  igtl_uint32 Reserved;
+  igtl_uint64 PixelDataSizeInBytes;
+};
+
+#endif
@@ -0,0 +1,271 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "PlusSharedMemoryVideoFrameHeader.h"
+#include "vtkPlusDataSource.h"
+#include "vtkPlusSharedMemoryVideoSource.h"
+
+// IGSIO includes
+#include <vtkIGSIOAccurateTimer.h>
+
+// VTK includes
+#include <vtkObjectFactory.h>
+
+namespace
+{
+  /*! Minimum time between two attempts to open the shared memory ring, while the writer is not running */
+  const double OPEN_RETRY_INTERVAL_SEC = 1.0;
+
+  /*! Maximum time to wait for the notification of the writer in one update */
+  const double FRAME_WAIT_TIMEOUT_SEC = 0.1;
+}
+
+//----------------------------------------------------------------------------
+
+vtkStandardNewMacro(vtkPlusSharedMemoryVideoSource);
+
+//----------------------------------------------------------------------------
+vtkPlusSharedMemoryVideoSource::vtkPlusSharedMemoryVideoSource()
+  : vtkPlusDevice()
+  , ReopenTimeoutSec(5.0)
+  , LastSequenceNumber(0)
+  , LastFrameSystemTime(0)
+  , NumberOfDroppedFrames(0)
+  , OutputSource(NULL)
+{
+  // The update waits for the notification of the writer, so the rate is set high to not add any delay
+  this->AcquisitionRate = 400;
+  this->StartThreadForInternalUpdates = true;
+}
+
+//----------------------------------------------------------------------------
+vtkPlusSharedMemoryVideoSource::~vtkPlusSharedMemoryVideoSource()
+{
+  if (this->Connected)
+  {
+    this->Disconnect();
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusSharedMemoryVideoSource::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "SharedMemoryName: " << this->SharedMemoryName << std::endl;
+  os << indent << "ReopenTimeoutSec: " << this->ReopenTimeoutSec << std::endl;
+  os << indent << "NumberOfDroppedFrames: " << this->NumberOfDroppedFrames << std::endl;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSharedMemoryVideoSource::ReadConfiguration(vtkXMLDataElement* rootConfigElement)
+{
+  XML_FIND_DEVICE_ELEMENT_REQUIRED_FOR_READING(deviceConfig, rootConfigElement);
+
+  XML_READ_STRING_ATTRIBUTE_REQUIRED(SharedMemoryName, deviceConfig);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, ReopenTimeoutSec, deviceConfig);
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSharedMemoryVideoSource::WriteConfiguration(vtkXMLDataElement* rootConfigElement)
+{
+  XML_FIND_DEVICE_ELEMENT_REQUIRED_FOR_WRITING(deviceConfig, rootConfigElement);
+
+  XML_WRITE_STRING_ATTRIBUTE_IF_NOT_EMPTY(SharedMemoryName, deviceConfig);
+  deviceConfig->SetDoubleAttribute("ReopenTimeoutSec", this->ReopenTimeoutSec);
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSharedMemoryVideoSource::NotifyConfigured()
+{
+  if (this->GetFirstVideoSource(this->OutputSource) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to find video source. SharedMemoryVideo device needs a video buffer to put the received frames into.");
+    this->SetCorrectlyConfigured(false);
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSharedMemoryVideoSource::InternalConnect()
+{
+  this->NumberOfDroppedFrames = 0;
+  // The writer may be started later, the ring is opened again in the updates
+  if (this->OpenSharedMemory() != PLUS_SUCCESS)
+  {
+    LOG_INFO("Shared memory ring " << this->SharedMemoryName << " is not available yet, waiting for the writer process");
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSharedMemoryVideoSource::InternalDisconnect()
+{
+  this->CloseSharedMemory();
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSharedMemoryVideoSource::OpenSharedMemory()
+{
+  this->LastFrameSystemTime = vtkIGSIOAccurateTimer::GetSystemTime();
+  if (this->FrameRing.Open(this->SharedMemoryName) != PLUS_SUCCESS
+      || this->FrameEvent.Open(this->SharedMemoryName) != PLUS_SUCCESS)
+  {
+    this->CloseSharedMemory();
+    return PLUS_FAIL;
+  }
+  // Frames that were written before the ring is opened are not read
+  this->LastSequenceNumber = this->FrameRing.GetLastSequenceNumber();
+  LOG_INFO("Shared memory ring " << this->SharedMemoryName << " is opened");
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusSharedMemoryVideoSource::CloseSharedMemory()
+{
+  this->FrameEvent.Close();
+  this->FrameRing.Close();
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSharedMemoryVideoSource::InternalUpdate()
+{
+  const double systemTime = vtkIGSIOAccurateTimer::GetSystemTime();
+  if (!this->FrameRing.IsOpen())
+  {
+    if (systemTime - this->LastFrameSystemTime < OPEN_RETRY_INTERVAL_SEC || this->OpenSharedMemory() != PLUS_SUCCESS)
+    {
+      return PLUS_SUCCESS;
+    }
+  }
+
+  // A missed notification only delays the frames until the timeout, the sequence numbers are checked in every update
+  this->FrameEvent.Wait(FRAME_WAIT_TIMEOUT_SEC);
+
+  const igtl_uint64 lastWrittenSequenceNumber = this->FrameRing.GetLastSequenceNumber();
+  if (lastWrittenSequenceNumber == this->LastSequenceNumber)
+  {
+    if (vtkIGSIOAccurateTimer::GetSystemTime() - this->LastFrameSystemTime > this->ReopenTimeoutSec)
+    {
+      // The writer may have been restarted with a new ring, which is only found by opening the name again
+      LOG_DEBUG("No frame is received from shared memory ring " << this->SharedMemoryName << " for " << this->ReopenTimeoutSec << " s, opening it again");
+      this->CloseSharedMemory();
+    }
+    return PLUS_SUCCESS;
+  }
+
+  igtl_uint64 firstSequenceNumber = this->LastSequenceNumber + 1;
+  const unsigned int numberOfSlots = this->FrameRing.GetNumberOfSlots();
+  if (lastWrittenSequenceNumber - this->LastSequenceNumber > numberOfSlots)
+  {
+    // The older frames are already overwritten by the writer
+    firstSequenceNumber = lastWrittenSequenceNumber - numberOfSlots + 1;
+    this->NumberOfDroppedFrames += static_cast<unsigned long>(firstSequenceNumber - this->LastSequenceNumber - 1);
+  }
+  for (igtl_uint64 sequenceNumber = firstSequenceNumber; sequenceNumber <= lastWrittenSequenceNumber; ++sequenceNumber)
+  {
+    if (this->ReadFrame(sequenceNumber) != PLUS_SUCCESS)
+    {
+      this->NumberOfDroppedFrames++;
+    }
+  }
+  if (firstSequenceNumber != this->LastSequenceNumber + 1)
+  {
+    static vtkIGSIOLogHelper helper(5.f, 5000, vtkPlusLogger::LOG_LEVEL_WARNING);
+    if (helper.ShouldWeLog(true))
+    {
+      LOG_WARNING("Frames are overwritten in shared memory ring " << this->SharedMemoryName << " before they could be read. Number of dropped frames: " << this->NumberOfDroppedFrames);
+    }
+  }
+  this->LastSequenceNumber = lastWrittenSequenceNumber;
+  this->LastFrameSystemTime = vtkIGSIOAccurateTimer::GetSystemTime();
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSharedMemoryVideoSource::ReadFrame(igtl_uint64 sequenceNumber)
+{
+  PlusSharedMemoryVideoFrameHeader header;
+  if (this->FrameRing.Read(sequenceNumber, 0, &header, sizeof(header)) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  if (header.Magic != PlusSharedMemoryVideoFrameHeader::MAGIC || header.Version != PlusSharedMemoryVideoFrameHeader::VERSION)
+  {
+    LOG_ERROR("Invalid frame in shared memory ring " << this->SharedMemoryName << ", the writer uses an unsupported format");
+    return PLUS_FAIL;
+  }
+  if (this->UpdateOutputFormat(header) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+
+  // Both processes are on the same host, so the universal time of the writer can be converted to the local system time
+  const double timestamp = header.TimestampUniversal + vtkIGSIOAccurateTimer::GetSystemTime() - vtkIGSIOAccurateTimer::GetUniversalTime();
+  const size_t pixelDataSizeInBytes = static_cast<size_t>(header.PixelDataSizeInBytes);
+
+  // The pixels are copied from the ring directly into the output buffer if possible
+  igsioVideoFrame* writableFrame = NULL;
+  if (this->OutputSource->IsInPlaceWritingSupported() && this->OutputSource->AcquireWritableFrame(writableFrame) == PLUS_SUCCESS)
+  {
+    if (static_cast<size_t>(writableFrame->GetFrameSizeInBytes()) == pixelDataSizeInBytes)
+    {
+      if (this->FrameRing.Read(sequenceNumber, sizeof(header), writableFrame->GetScalarPointer(), pixelDataSizeInBytes) != PLUS_SUCCESS)
+      {
+        this->OutputSource->ReleaseWritableFrame();
+        return PLUS_FAIL;
+      }
+      return this->OutputSource->CommitWritableFrame(static_cast<long>(header.FrameNumber), timestamp, timestamp);
+    }
+    this->OutputSource->ReleaseWritableFrame();
+  }
+
+  this->PixelBuffer.resize(pixelDataSizeInBytes);
+  if (pixelDataSizeInBytes == 0 || this->FrameRing.Read(sequenceNumber, sizeof(header), &this->PixelBuffer[0], pixelDataSizeInBytes) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  FrameSizeType frameSize = { header.FrameSize[0], header.FrameSize[1], header.FrameSize[2] };
+  return this->OutputSource->AddItem(&this->PixelBuffer[0], static_cast<US_IMAGE_ORIENTATION>(header.ImageOrientation), frameSize,
+                                     static_cast<igsioCommon::VTKScalarPixelType>(header.PixelType), header.NumberOfScalarComponents,
+                                     static_cast<US_IMAGE_TYPE>(header.ImageType), 0, static_cast<long>(header.FrameNumber), timestamp, timestamp);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSharedMemoryVideoSource::UpdateOutputFormat(const PlusSharedMemoryVideoFrameHeader& header)
+{
+  const FrameSizeType frameSize = { header.FrameSize[0], header.FrameSize[1], header.FrameSize[2] };
+  const FrameSizeType currentFrameSize = this->OutputSource->GetInputFrameSize();
+  if (currentFrameSize[0] == frameSize[0] && currentFrameSize[1] == frameSize[1] && currentFrameSize[2] == frameSize[2]
+      && this->OutputSource->GetPixelType() == header.PixelType
+      && this->OutputSource->GetNumberOfScalarComponents() == header.NumberOfScalarComponents
+      && this->OutputSource->GetImageType() == header.ImageType
+      && this->OutputSource->GetInputImageOrientation() == header.ImageOrientation)
+  {
+    return PLUS_SUCCESS;
+  }
+
+  LOG_INFO("Image format of shared memory ring " << this->SharedMemoryName << " is " << frameSize[0] << "x" << frameSize[1] << "x" << frameSize[2]
+           << ", " << header.NumberOfScalarComponents << " components");
+  if (this->OutputSource->SetInputImageOrientation(static_cast<US_IMAGE_ORIENTATION>(header.ImageOrientation)) != PLUS_SUCCESS
+      || this->OutputSource->SetImageType(static_cast<US_IMAGE_TYPE>(header.ImageType)) != PLUS_SUCCESS
+      || this->OutputSource->SetPixelType(static_cast<igsioCommon::VTKScalarPixelType>(header.PixelType)) != PLUS_SUCCESS
+      || this->OutputSource->SetNumberOfScalarComponents(header.NumberOfScalarComponents) != PLUS_SUCCESS
+      || this->OutputSource->SetInputFrameSize(frameSize) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to set the image format of the output source of shared memory ring " << this->SharedMemoryName);
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
@@ -0,0 +1,93 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __vtkPlusSharedMemoryVideoSource_h
+#define __vtkPlusSharedMemoryVideoSource_h
+
+#include "vtkPlusDataCollectionExport.h"
+
+#include "vtkPlusDevice.h"
+#include "PlusSharedMemoryEvent.h"
+#include "PlusSharedMemoryFrameRing.h"
+
+// STL includes
+#include <vector>
+
+class vtkPlusDataSource;
+struct PlusSharedMemoryVideoFrameHeader;
+
+/*!
+  \class vtkPlusSharedMemoryVideoSource
+  \brief Video source that reads the frames written by a vtkPlusSharedMemoryVideoWriter in another process on the same host
+
+  The device waits for the named event of the writer and copies each new frame from the shared memory ring directly
+  into the output buffer. If the writer is not running yet, or it is restarted, then the ring is opened again.
+
+  \ingroup PlusLibDataCollection
+*/
+class vtkPlusDataCollectionExport vtkPlusSharedMemoryVideoSource : public vtkPlusDevice
+{
+public:
+  static vtkPlusSharedMemoryVideoSource* New();
+  vtkTypeMacro(vtkPlusSharedMemoryVideoSource, vtkPlusDevice);
+  virtual void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  virtual bool IsTracker() const { return false; }
+
+  virtual PlusStatus ReadConfiguration(vtkXMLDataElement*);
+  virtual PlusStatus WriteConfiguration(vtkXMLDataElement*);
+
+  virtual PlusStatus NotifyConfigured();
+
+  virtual PlusStatus InternalUpdate();
+
+  /*! Name of the shared memory ring and its event, as configured in the writer */
+  vtkGetStdStringMacro(SharedMemoryName);
+  vtkSetStdStringMacro(SharedMemoryName);
+
+  /*! If no frame is received for this long then the ring is opened again, as the writer may have been restarted */
+  vtkGetMacro(ReopenTimeoutSec, double);
+  vtkSetMacro(ReopenTimeoutSec, double);
+
+protected:
+  vtkPlusSharedMemoryVideoSource();
+  virtual ~vtkPlusSharedMemoryVideoSource();
+
+  virtual PlusStatus InternalConnect();
+  virtual PlusStatus InternalDisconnect();
+
+  /*! Open the ring and the event of the writer */
+  PlusStatus OpenSharedMemory();
+  void CloseSharedMemory();
+
+  /*! Copy the frame with the given sequence number from the ring into the output buffer */
+  PlusStatus ReadFrame(igtl_uint64 sequenceNumber);
+
+  /*! Set the image format of the output source, if the writer sends frames in a different format */
+  PlusStatus UpdateOutputFormat(const PlusSharedMemoryVideoFrameHeader& header);
+
+  std::string SharedMemoryName;
+  double ReopenTimeoutSec;
+
+  PlusSharedMemoryFrameRing FrameRing;
+  PlusSharedMemoryEvent FrameEvent;
+
+  /*! Sequence number of the last frame that is read from the ring */
+  igtl_uint64 LastSequenceNumber;
+  double LastFrameSystemTime;
+  unsigned long NumberOfDroppedFrames;
+
+  /*! Used if the frames cannot be written directly into the output buffer */
+  std::vector<unsigned char> PixelBuffer;
+
+  vtkPlusDataSource* OutputSource;
+
+private:
+  vtkPlusSharedMemoryVideoSource(const vtkPlusSharedMemoryVideoSource&);  // Not implemented.
+  void operator=(const vtkPlusSharedMemoryVideoSource&);  // Not implemented.
+};
+
+#endif
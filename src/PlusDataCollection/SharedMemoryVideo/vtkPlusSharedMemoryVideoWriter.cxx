@@ -0,0 +1,216 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "PlusSharedMemoryVideoFrameHeader.h"
+#include "vtkPlusChannel.h"
+#include "vtkPlusSharedMemoryVideoWriter.h"
+
+// IGSIO includes
+#include <igsioTrackedFrame.h>
+#include <vtkIGSIOAccurateTimer.h>
+#include <vtkIGSIOTrackedFrameList.h>
+
+// VTK includes
+#include <vtkObjectFactory.h>
+
+//----------------------------------------------------------------------------
+
+vtkStandardNewMacro(vtkPlusSharedMemoryVideoWriter);
+
+//----------------------------------------------------------------------------
+vtkPlusSharedMemoryVideoWriter::vtkPlusSharedMemoryVideoWriter()
+  : vtkPlusDevice()
+  , RingSize(8)
+  , MaximumFrameSizeInBytes(0)
+  , LastInputTimestamp(UNDEFINED_TIMESTAMP)
+  , FrameNumber(0)
+  , FrameList(vtkIGSIOTrackedFrameList::New())
+{
+  this->AcquisitionRate = 400;
+  this->StartThreadForInternalUpdates = true;
+}
+
+//----------------------------------------------------------------------------
+vtkPlusSharedMemoryVideoWriter::~vtkPlusSharedMemoryVideoWriter()
+{
+  if (this->Connected)
+  {
+    this->Disconnect();
+  }
+  this->FrameList->Delete();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusSharedMemoryVideoWriter::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "SharedMemoryName: " << this->SharedMemoryName << std::endl;
+  os << indent << "RingSize: " << this->RingSize << std::endl;
+  os << indent << "MaximumFrameSizeInBytes: " << this->MaximumFrameSizeInBytes << std::endl;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSharedMemoryVideoWriter::ReadConfiguration(vtkXMLDataElement* rootConfigElement)
+{
+  XML_FIND_DEVICE_ELEMENT_REQUIRED_FOR_READING(deviceConfig, rootConfigElement);
+
+  XML_READ_STRING_ATTRIBUTE_REQUIRED(SharedMemoryName, deviceConfig);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, RingSize, deviceConfig);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, MaximumFrameSizeInBytes, deviceConfig);
+
+  if (this->RingSize < 2)
+  {
+    LOG_WARNING("RingSize must be at least 2, using 2 instead of " << this->RingSize);
+    this->RingSize = 2;
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSharedMemoryVideoWriter::WriteConfiguration(vtkXMLDataElement* rootConfigElement)
+{
+  XML_FIND_DEVICE_ELEMENT_REQUIRED_FOR_WRITING(deviceConfig, rootConfigElement);
+
+  XML_WRITE_STRING_ATTRIBUTE_IF_NOT_EMPTY(SharedMemoryName, deviceConfig);
+  deviceConfig->SetIntAttribute("RingSize", this->RingSize);
+  deviceConfig->SetIntAttribute("MaximumFrameSizeInBytes", this->MaximumFrameSizeInBytes);
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSharedMemoryVideoWriter::NotifyConfigured()
+{
+  if (this->InputChannels.size() != 1)
+  {
+    LOG_ERROR("SharedMemoryVideoWriter requires exactly 1 input channel");
+    this->SetCorrectlyConfigured(false);
+    return PLUS_FAIL;
+  }
+  if (!this->InputChannels[0]->HasVideoSource())
+  {
+    LOG_ERROR("Input channel of SharedMemoryVideoWriter does not have a video source. It is required.");
+    this->SetCorrectlyConfigured(false);
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSharedMemoryVideoWriter::InternalConnect()
+{
+  // The ring is created when the size of the first frame is known, but the event is needed by the reader first
+  if (this->FrameEvent.Create(this->SharedMemoryName) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  this->LastInputTimestamp = UNDEFINED_TIMESTAMP;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSharedMemoryVideoWriter::InternalDisconnect()
+{
+  this->FrameRing.Close();
+  this->FrameEvent.Close();
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSharedMemoryVideoWriter::InternalUpdate()
+{
+  if (!this->InputChannels[0]->GetVideoDataAvailable())
+  {
+    LOG_DYNAMIC("No input data available to SharedMemoryVideoWriter. Waiting until input data arrives.", this->GracePeriodLogLevel);
+    return PLUS_SUCCESS;
+  }
+
+  // The frames are only read, so their image data is shared with the input buffer
+  this->FrameList->Clear();
+  if (this->InputChannels[0]->GetTrackedFrameList(this->LastInputTimestamp, this->FrameList, 100, true) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+
+  bool framesWritten = false;
+  for (auto frame : *this->FrameList)
+  {
+    if (this->WriteFrame(frame) == PLUS_SUCCESS)
+    {
+      framesWritten = true;
+    }
+  }
+  this->FrameList->Clear();
+
+  // One notification is enough for all frames, the reader reads every frame up to the last sequence number
+  if (framesWritten)
+  {
+    this->FrameEvent.Signal();
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSharedMemoryVideoWriter::WriteFrame(igsioTrackedFrame* frame)
+{
+  igsioVideoFrame* videoFrame = frame->GetImageData();
+  if (videoFrame == NULL || !videoFrame->IsImageValid())
+  {
+    return PLUS_FAIL;
+  }
+  const size_t pixelDataSizeInBytes = static_cast<size_t>(videoFrame->GetFrameSizeInBytes());
+  unsigned int numberOfScalarComponents = 1;
+  if (videoFrame->GetNumberOfScalarComponents(numberOfScalarComponents) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to retrieve number of scalar components.");
+    return PLUS_FAIL;
+  }
+
+  if (!this->FrameRing.IsOpen())
+  {
+    size_t slotSizeInBytes = sizeof(PlusSharedMemoryVideoFrameHeader) + (this->MaximumFrameSizeInBytes > 0 ? static_cast<size_t>(this->MaximumFrameSizeInBytes) : pixelDataSizeInBytes);
+    if (this->FrameRing.Create(this->SharedMemoryName, this->RingSize, slotSizeInBytes) != PLUS_SUCCESS)
+    {
+      return PLUS_FAIL;
+    }
+    LOG_INFO("Shared memory ring " << this->SharedMemoryName << " is created with " << this->RingSize << " slots of " << slotSizeInBytes << " bytes");
+  }
+
+  FrameSizeType frameSize = videoFrame->GetFrameSize();
+  PlusSharedMemoryVideoFrameHeader header;
+  header.Magic = PlusSharedMemoryVideoFrameHeader::MAGIC;
+  header.Version = PlusSharedMemoryVideoFrameHeader::VERSION;
+  header.FrameNumber = this->FrameNumber;
+  header.TimestampUniversal = vtkIGSIOAccurateTimer::GetUniversalTimeFromSystemTime(frame->GetTimestamp());
+  header.FrameSize[0] = frameSize[0];
+  header.FrameSize[1] = frameSize[1];
+  header.FrameSize[2] = frameSize[2];
+  header.PixelType = videoFrame->GetVTKScalarPixelType();
+  header.NumberOfScalarComponents = numberOfScalarComponents;
+  header.ImageType = videoFrame->GetImageType();
+  header.ImageOrientation = videoFrame->GetImageOrientation();
+  header.Reserved = 0;
+  header.PixelDataSizeInBytes = pixelDataSizeInBytes;
+
+  igtl_uint64 sequenceNumber = 0;
+  if (this->FrameRing.Write(&header, sizeof(header), videoFrame->GetScalarPointer(), pixelDataSizeInBytes, sequenceNumber) != PLUS_SUCCESS)
+  {
+    static vtkIGSIOLogHelper helper(5.f, 5000);
+    if (helper.ShouldWeLog(true))
+    {
+      LOG_ERROR("Frame of " << pixelDataSizeInBytes << " bytes does not fit into shared memory ring " << this->SharedMemoryName
+                << " (" << this->FrameRing.GetSlotSizeInBytes() - sizeof(header) << " bytes). Set MaximumFrameSizeInBytes to the size of the largest frame.");
+    }
+    return PLUS_FAIL;
+  }
+  this->FrameNumber++;
+
+  return PLUS_SUCCESS;
+}
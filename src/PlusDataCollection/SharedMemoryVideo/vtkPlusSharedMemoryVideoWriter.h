@@ -0,0 +1,85 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __vtkPlusSharedMemoryVideoWriter_h
+#define __vtkPlusSharedMemoryVideoWriter_h
+
+#include "vtkPlusDataCollectionExport.h"
+
+#include "vtkPlusDevice.h"
+#include "PlusSharedMemoryEvent.h"
+#include "PlusSharedMemoryFrameRing.h"
+
+class vtkIGSIOTrackedFrameList;
+class vtkPlusDataSource;
+
+/*!
+  \class vtkPlusSharedMemoryVideoWriter
+  \brief Virtual device that writes the frames of its input channel into a named shared memory ring
+
+  Used in bridge processes that run a scanner SDK that cannot be loaded into the main process (e.g., 32-bit or COM
+  SDKs). The frames are read by a vtkPlusSharedMemoryVideoSource device in the main process on the same host.
+  Each frame is copied once into the ring and the reader is notified with a named event, there is no network
+  transfer and no message packing.
+
+  \ingroup PlusLibDataCollection
+*/
+class vtkPlusDataCollectionExport vtkPlusSharedMemoryVideoWriter : public vtkPlusDevice
+{
+public:
+  static vtkPlusSharedMemoryVideoWriter* New();
+  vtkTypeMacro(vtkPlusSharedMemoryVideoWriter, vtkPlusDevice);
+  virtual void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  virtual bool IsTracker() const { return false; }
+  virtual bool IsVirtual() const { return true; }
+
+  virtual PlusStatus ReadConfiguration(vtkXMLDataElement*);
+  virtual PlusStatus WriteConfiguration(vtkXMLDataElement*);
+
+  virtual PlusStatus NotifyConfigured();
+
+  virtual PlusStatus InternalUpdate();
+
+  /*! Name of the shared memory ring and its event, the reader has to use the same name */
+  vtkGetStdStringMacro(SharedMemoryName);
+  vtkSetStdStringMacro(SharedMemoryName);
+
+  /*! Number of frames in the ring. A frame that the reader does not read before this many newer frames are written is lost. */
+  vtkGetMacro(RingSize, int);
+  vtkSetMacro(RingSize, int);
+
+  /*! Size of a ring slot, if 0 then the size of the first frame is used. Larger frames are not written. */
+  vtkGetMacro(MaximumFrameSizeInBytes, int);
+  vtkSetMacro(MaximumFrameSizeInBytes, int);
+
+protected:
+  vtkPlusSharedMemoryVideoWriter();
+  virtual ~vtkPlusSharedMemoryVideoWriter();
+
+  virtual PlusStatus InternalConnect();
+  virtual PlusStatus InternalDisconnect();
+
+  /*! Copy a frame into the ring, the ring is created for the first frame */
+  PlusStatus WriteFrame(igsioTrackedFrame* frame);
+
+  std::string SharedMemoryName;
+  int RingSize;
+  int MaximumFrameSizeInBytes;
+
+  PlusSharedMemoryFrameRing FrameRing;
+  PlusSharedMemoryEvent FrameEvent;
+
+  double LastInputTimestamp;
+  igtl_uint64 FrameNumber;
+  vtkIGSIOTrackedFrameList* FrameList;
+
+private:
+  vtkPlusSharedMemoryVideoWriter(const vtkPlusSharedMemoryVideoWriter&);  // Not implemented.
+  void operator=(const vtkPlusSharedMemoryVideoWriter&);  // Not implemented.
+};
+
+#endif
@@ -17,6 +17,8 @@ Andras Lasso (Queen's University, Kingston, Ontario, Canada)
 
 // Local includes
 #include "PlusConfigure.h"
+#include "PlusPixelKernels.h"
+#include "PlusWorkerPool.h"
 #include "vtkPlusChannel.h"
 #include "vtkPlusDataSource.h"
 #include "vtkPlusSonixVideoSource.h"
@@ -86,6 +88,7 @@ vtkPlusSonixVideoSource::vtkPlusSonixVideoSource()
   , UlteriusConnected(false)
   , AutoClipEnabled(false)
   , ImageGeometryOutputEnabled(false)
+  , RfParallelUnpackingEnabled(true)
   , ImagingParameterChanged(false)
 {
   this->SetSonixIP("127.0.0.1");
@@ -390,12 +393,98 @@ PlusStatus vtkPlusSonixVideoSource::AddFrameToBuffer(void* dataPtr, int type, in
   // get the pointer to actual incoming data on to a local pointer
   unsigned char* deviceDataPtr = static_cast<unsigned char*>(dataPtr);
 
-  PlusStatus status = this->AddVideoItemToVideoSources(sources, deviceDataPtr, aSource->GetInputImageOrientation(), frameSize, pixelType, 1, imgType, numberOfBytesToSkip, this->FrameNumber, UNDEFINED_TIMESTAMP, UNDEFINED_TIMESTAMP, &customFields);
+  // RF frames are reordered line-parallel directly into the buffer, so that the callback returns quickly at high line densities
+  PlusStatus status = PLUS_SUCCESS;
+  std::vector<vtkPlusDataSource*> remainingSources;
+  for (std::vector<vtkPlusDataSource*>::iterator it = sources.begin(); it != sources.end(); ++it)
+  {
+    igsioVideoFrame::FlipInfoType flipInfo;
+    igsioVideoFrame* bufferFrame = NULL;
+    if (imgType != US_IMG_RF_I_LINE_Q_LINE || !this->IsRfFrameUnpackingSupported(*it, frameSize, flipInfo)
+        || (*it)->AcquireWritableFrameInOutputOrientation(bufferFrame) != PLUS_SUCCESS)
+    {
+      remainingSources.push_back(*it);
+      continue;
+    }
+    if (bufferFrame->GetFrameSizeInBytes() != frameSizeInBytes)
+    {
+      LOG_ERROR("Buffer frame size (" << bufferFrame->GetFrameSizeInBytes() << " bytes) doesn't match the RF frame size (" << frameSizeInBytes << " bytes)");
+      (*it)->ReleaseWritableFrame();
+      status = PLUS_FAIL;
+      continue;
+    }
+    UnpackRfFrame(deviceDataPtr + numberOfBytesToSkip, frameSize, flipInfo, static_cast<unsigned char*>(bufferFrame->GetScalarPointer()));
+    if ((*it)->CommitWritableFrame(this->FrameNumber, UNDEFINED_TIMESTAMP, UNDEFINED_TIMESTAMP, &customFields) != PLUS_SUCCESS)
+    {
+      status = PLUS_FAIL;
+    }
+  }
+
+  if (!remainingSources.empty()
+      && this->AddVideoItemToVideoSources(remainingSources, deviceDataPtr, aSource->GetInputImageOrientation(), frameSize, pixelType, 1, imgType, numberOfBytesToSkip, this->FrameNumber, UNDEFINED_TIMESTAMP, UNDEFINED_TIMESTAMP, &customFields) != PLUS_SUCCESS)
+  {
+    status = PLUS_FAIL;
+  }
   this->Modified();
 
   return status;
 }
 
+//----------------------------------------------------------------------------
+bool vtkPlusSonixVideoSource::IsRfFrameUnpackingSupported(vtkPlusDataSource* source, const FrameSizeType& frameSize, igsioVideoFrame::FlipInfoType& flipInfo)
+{
+  if (!this->RfParallelUnpackingEnabled || frameSize[2] != 1)
+  {
+    return false;
+  }
+  if (igsioCommon::IsClippingRequested(source->GetClipRectangleOrigin(), source->GetClipRectangleSize()))
+  {
+    return false;
+  }
+  if (igsioVideoFrame::GetFlipAxes(source->GetInputImageOrientation(), US_IMG_RF_I_LINE_Q_LINE, source->GetOutputImageOrientation(), flipInfo) != PLUS_SUCCESS)
+  {
+    return false;
+  }
+  // Transposition and interleaved I/Q samples in a row are left to the buffer
+  return !flipInfo.eFlip && !flipInfo.doubleColumn && flipInfo.tranpose == igsioVideoFrame::TRANSPOSE_NONE
+         && (!flipInfo.doubleRow || frameSize[1] % 2 == 0);
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusSonixVideoSource::UnpackRfFrame(const unsigned char* rfData, const FrameSizeType& frameSize, const igsioVideoFrame::FlipInfoType& flipInfo, unsigned char* output)
+{
+  // RF samples are 16-bit
+  typedef PlusPixelKernels::Pixel<2> SampleType;
+  const SampleType* inputSamples = reinterpret_cast<const SampleType*>(rfData);
+  SampleType* outputSamples = reinterpret_cast<SampleType*>(output);
+  const unsigned int samplesPerRow = frameSize[0];
+  const int rowsPerGroup = flipInfo.doubleRow ? 2 : 1;
+  const int numberOfGroups = static_cast<int>(frameSize[1]) / rowsPerGroup;
+  const bool flipRows = flipInfo.vFlip;
+  const bool flipSamples = flipInfo.hFlip;
+
+  PlusWorkerPool::GetInstance().ParallelFor(0, numberOfGroups, 0, [ = ](int firstGroup, int lastGroup)
+  {
+    for (int group = firstGroup; group < lastGroup; ++group)
+    {
+      const int inputGroup = flipRows ? numberOfGroups - 1 - group : group;
+      for (int rowInGroup = 0; rowInGroup < rowsPerGroup; ++rowInGroup)
+      {
+        const SampleType* inputRow = inputSamples + static_cast<size_t>(inputGroup * rowsPerGroup + rowInGroup) * samplesPerRow;
+        SampleType* outputRow = outputSamples + static_cast<size_t>(group * rowsPerGroup + rowInGroup) * samplesPerRow;
+        if (flipSamples)
+        {
+          PlusPixelKernels::ReverseRow(inputRow, outputRow, samplesPerRow);
+        }
+        else
+        {
+          PlusPixelKernels::CopyRow(inputRow, outputRow, samplesPerRow);
+        }
+      }
+    }
+  });
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusSonixVideoSource::InternalConnect()
 {
@@ -674,6 +763,7 @@ PlusStatus vtkPlusSonixVideoSource::ReadConfiguration(vtkXMLDataElement* rootCon
 
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(AutoClipEnabled, deviceConfig);
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(ImageGeometryOutputEnabled, deviceConfig);
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(RfParallelUnpackingEnabled, deviceConfig);
 
   if (Superclass::ReadConfiguration(rootConfigElement) != PLUS_SUCCESS)
   {
@@ -745,6 +835,7 @@ PlusStatus vtkPlusSonixVideoSource::WriteConfiguration(vtkXMLDataElement* rootCo
 
   XML_WRITE_BOOL_ATTRIBUTE(AutoClipEnabled, deviceConfig);
   XML_WRITE_BOOL_ATTRIBUTE(ImageGeometryOutputEnabled, deviceConfig);
+  XML_WRITE_BOOL_ATTRIBUTE(RfParallelUnpackingEnabled, deviceConfig);
 
   Superclass::WriteConfiguration(deviceConfig);
 
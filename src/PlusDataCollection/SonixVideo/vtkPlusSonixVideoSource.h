@@ -240,6 +240,13 @@ public:
   vtkSetMacro(ImageGeometryOutputEnabled, bool);
   vtkGetMacro(ImageGeometryOutputEnabled, bool);
 
+  /*!
+    Reorder RF frames to the buffer orientation with multiple threads, directly into the buffer.
+    Only used if no clipping is requested, otherwise the buffer reorients the frames.
+  */
+  vtkSetMacro(RfParallelUnpackingEnabled, bool);
+  vtkGetMacro(RfParallelUnpackingEnabled, bool);
+
 protected:
   /*! Connect to device */
   virtual PlusStatus InternalConnect();
@@ -282,6 +289,19 @@ protected:
   /*! For internal use only */
   PlusStatus AddFrameToBuffer(void* data, int type, int sz, bool cine, int frmnum);
 
+  /*!
+    Returns true if the RF frames of the source can be reordered into a writable frame of its buffer
+    by UnpackRfFrame. flipInfo is set to the reordering that is needed.
+  */
+  bool IsRfFrameUnpackingSupported(vtkPlusDataSource* source, const FrameSizeType& frameSize, igsioVideoFrame::FlipInfoType& flipInfo);
+
+  /*!
+    Copy an RF frame to the output while flipping it as specified by flipInfo.
+    The rows (I and Q lines of the same scan line are kept together if flipInfo.doubleRow is set) are distributed between
+    the threads of the worker pool.
+  */
+  static void UnpackRfFrame(const unsigned char* rfData, const FrameSizeType& frameSize, const igsioVideoFrame::FlipInfoType& flipInfo, unsigned char* output);
+
   PlusStatus SetParamValueDevice(char* paramId, int paramValue, int& validatedParamValue);
   PlusStatus SetParamValueDevice(char* paramId, Plus_uTGC& paramValue, Plus_uTGC& validatedParamValue);
   PlusStatus GetParamValueDevice(char* paramId, int& paramValue, int& validatedParamValue);
@@ -332,6 +352,7 @@ protected:
   bool UlteriusConnected;
   bool AutoClipEnabled;
   bool ImageGeometryOutputEnabled;
+  bool RfParallelUnpackingEnabled;
 
 private:
   static bool vtkPlusSonixVideoSourceNewFrameCallback(void* data, int type, int sz, bool cine, int frmnum);
@@ -6,6 +6,7 @@ See License.txt for details.
 
 // Local includes
 #include "PlusConfigure.h"
+#include "PlusWorkerPool.h"
 #include "vtkPlusSonixVolumeReader.h"
 
 // VTK includes
@@ -19,77 +20,125 @@ See License.txt for details.
 #include <vtkIGSIOTrackedFrameList.h>
 
 // STD includes
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 
+// Windows includes
+#include <windows.h>
+
 // Sonix includes
 #include <ulterius_def.h>
 #if PLUS_ULTRASONIX_SDK_MAJOR_VERSION == 1
   #include <utx_imaging_modes.h>
 #endif
 
+namespace
+{
+  /*! Number of frames that are converted by each thread of the worker pool in one batch */
+  const unsigned int FRAMES_PER_THREAD_IN_BATCH = 8;
+}
 
 vtkStandardNewMacro(vtkPlusSonixVolumeReader);
 
 //----------------------------------------------------------------------------
 vtkPlusSonixVolumeReader::vtkPlusSonixVolumeReader()
+  : FileHandle(INVALID_HANDLE_VALUE)
+  , FileMappingHandle(NULL)
+  , MappedData(NULL)
+  , MappedSizeInBytes(0)
+  , NumberOfFrames(0)
+  , PixelType(VTK_VOID)
+  , FrameSizeInBytes(0)
+  , FirstFrameOffset(0)
+  , FrameStrideInBytes(0)
 {
+  this->FrameSize[0] = this->FrameSize[1] = this->FrameSize[2] = 0;
 }
 
 
 //----------------------------------------------------------------------------
 vtkPlusSonixVolumeReader::~vtkPlusSonixVolumeReader()
 {
+  this->Close();
 }
 
 //----------------------------------------------------------------------------
 void vtkPlusSonixVolumeReader::PrintSelf(ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os, indent);
+  os << indent << "NumberOfFrames: " << this->NumberOfFrames << std::endl;
+  os << indent << "MappedSizeInBytes: " << this->MappedSizeInBytes << std::endl;
 }
 
 //----------------------------------------------------------------------------
-// static
-PlusStatus vtkPlusSonixVolumeReader::GenerateTrackedFrameFromSonixVolume(const char* volumeFileName, vtkIGSIOTrackedFrameList* trackedFrameList, double acquisitionFrameRate/* = 10*/)
+PlusStatus vtkPlusSonixVolumeReader::Open(const char* volumeFileName)
 {
+  this->Close();
+
   if (volumeFileName == NULL)
   {
-    LOG_ERROR("Failed to generate tracked frame from sonix volume - input file name is NULL!");
+    LOG_ERROR("Failed to open sonix volume - input file name is NULL!");
     return PLUS_FAIL;
   }
 
-  if (trackedFrameList == NULL)
+  // Frames are mostly read in order, the system can read ahead
+  this->FileHandle = CreateFileA(volumeFileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+  if (this->FileHandle == INVALID_HANDLE_VALUE)
   {
-    LOG_ERROR("Failed to generate tracked frame from sonix volume - output tracked frame list is NULL!");
+    LOG_ERROR("Error opening volume file: " << volumeFileName << " Error No.: " << GetLastError());
     return PLUS_FAIL;
   }
 
-  // read data file
-  FILE* fp;
-  errno_t err = fopen_s(&fp, volumeFileName, "rb");
-
-  if (err != 0)
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(this->FileHandle, &fileSize) || fileSize.QuadPart < static_cast<LONGLONG>(sizeof(uFileHeader)))
   {
-    LOG_ERROR("Error opening volume file: " << volumeFileName << " Error No.: " << err);
+    LOG_ERROR("Volume file is too short to contain a header: " << volumeFileName);
+    this->Close();
     return PLUS_FAIL;
   }
 
-  // Determine file size
-  fseek(fp, 0, SEEK_END);
-  long fileSizeInBytes = ftell(fp);
-  rewind(fp);
+  this->FileMappingHandle = CreateFileMappingA(this->FileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (this->FileMappingHandle == NULL)
+  {
+    LOG_ERROR("Unable to map volume file " << volumeFileName << ": error " << GetLastError());
+    this->Close();
+    return PLUS_FAIL;
+  }
+  this->MappedData = static_cast<const unsigned char*>(MapViewOfFile(this->FileMappingHandle, FILE_MAP_READ, 0, 0, 0));
+  if (this->MappedData == NULL)
+  {
+    LOG_ERROR("Unable to map volume file " << volumeFileName << ": error " << GetLastError());
+    this->Close();
+    return PLUS_FAIL;
+  }
+  this->MappedSizeInBytes = static_cast<unsigned long long>(fileSize.QuadPart);
 
   // Ultrasonix header
   uFileHeader hdr;
-
-  // read header
-  fread(&hdr, sizeof(hdr), 1, fp);
+  memcpy(&hdr, this->MappedData, sizeof(hdr));
 
   unsigned int dataType = static_cast<unsigned int>(hdr.type);
   unsigned int sampleSizeInBytes = static_cast<unsigned int>(hdr.ss / 8);
-  unsigned int numberOfFrames = static_cast<unsigned int>(hdr.frames);
-  unsigned int frameSizeInBytes = static_cast<unsigned int>(hdr.w * hdr.h * sampleSizeInBytes);
-  FrameSizeType frameSize = { static_cast<unsigned int>(hdr.w), static_cast<unsigned int>(hdr.h), 1};
+  this->NumberOfFrames = static_cast<unsigned int>(hdr.frames);
+  this->FrameSizeInBytes = static_cast<unsigned int>(hdr.w * hdr.h * sampleSizeInBytes);
+  this->FrameSize[0] = static_cast<unsigned int>(hdr.w);
+  this->FrameSize[1] = static_cast<unsigned int>(hdr.h);
+  this->FrameSize[2] = 1;
+
+  switch (dataType)
+  {
+    case udtBPost:
+      this->PixelType = VTK_UNSIGNED_CHAR;
+      break;
+    case udtRF:
+      this->PixelType = VTK_SHORT;
+      break;
+    default:
+      LOG_ERROR("Uknown pixel type for data type: " << dataType);
+      this->Close();
+      return PLUS_FAIL;
+  }
 
   // Custom frame fields
   std::ostringstream strDataType;
@@ -110,85 +159,161 @@ PlusStatus vtkPlusSonixVolumeReader::GenerateTrackedFrameFromSonixVolume(const c
   std::ostringstream strLineDensity;
   strLineDensity << hdr.ld;
 
-  unsigned int numberOfBytesToSkip = 0;
-  if ((fileSizeInBytes - sizeof(hdr)) > frameSizeInBytes * numberOfFrames)
+  this->FrameFields.push_back(std::make_pair(std::string("SonixDataType"), strDataType.str()));
+  this->FrameFields.push_back(std::make_pair(std::string("SonixTransmitFrequency"), strTransmitFrequency.str()));
+  this->FrameFields.push_back(std::make_pair(std::string("SonixSamplingFrequency"), strSamplingFrequency.str()));
+  this->FrameFields.push_back(std::make_pair(std::string("SonixDataRate"), strDataRate.str()));
+  this->FrameFields.push_back(std::make_pair(std::string("SonixLineDensity"), strLineDensity.str()));
+  this->FrameFields.push_back(std::make_pair(std::string("SonixProbeID"), strProbeID.str()));
+
+  const unsigned long long dataSizeInBytes = this->MappedSizeInBytes - sizeof(hdr);
+  const unsigned long long expectedDataSizeInBytes = static_cast<unsigned long long>(this->FrameSizeInBytes) * this->NumberOfFrames;
+  unsigned long long numberOfBytesToSkip = 0;
+  if (dataSizeInBytes > expectedDataSizeInBytes && this->NumberOfFrames > 0)
   {
-    numberOfBytesToSkip = (fileSizeInBytes - sizeof(hdr)) / numberOfFrames  - frameSizeInBytes;
+    numberOfBytesToSkip = dataSizeInBytes / this->NumberOfFrames - this->FrameSizeInBytes;
     LOG_DEBUG("Each frame has " << numberOfBytesToSkip << " bytes header before the actual data");
   }
-  else if ((fileSizeInBytes - sizeof(hdr)) < frameSizeInBytes * numberOfFrames)
+  else if (dataSizeInBytes < expectedDataSizeInBytes)
   {
-    LOG_ERROR("Expected data size for reading (" << frameSizeInBytes * numberOfFrames
-              << " bytes) is larger than actual data size (" << fileSizeInBytes - sizeof(hdr) << " bytes).");
+    LOG_ERROR("Expected data size for reading (" << expectedDataSizeInBytes
+              << " bytes) is larger than actual data size (" << dataSizeInBytes << " bytes).");
+    this->Close();
     return PLUS_FAIL;
   }
+  this->FirstFrameOffset = sizeof(hdr) + numberOfBytesToSkip;
+  this->FrameStrideInBytes = numberOfBytesToSkip + this->FrameSizeInBytes;
 
   // if vector data switch width and height, because the image
   // is not rasterized like a bitmap, but written rayline by rayline
   if ((dataType == udtBPre) || (dataType == udtRF) || (dataType == udtMPre) || (dataType == udtPWRF) || (dataType == udtColorRF))
   {
-    frameSize[0] = hdr.h; // number of data points recorded for one crystal (vectors)
-    frameSize[1] = hdr.w; // number of transducer crystals (samples)
-    frameSize[2] = 1; // only 1 slice
+    this->FrameSize[0] = hdr.h; // number of data points recorded for one crystal (vectors)
+    this->FrameSize[1] = hdr.w; // number of transducer crystals (samples)
+    this->FrameSize[2] = 1; // only 1 slice
   }
 
-  // Pointer to data from file
-  unsigned char* dataFromFile = new unsigned char[frameSizeInBytes];
+  return PLUS_SUCCESS;
+}
 
-  for (unsigned int i = 0; i < numberOfFrames; i++)
+//----------------------------------------------------------------------------
+void vtkPlusSonixVolumeReader::Close()
+{
+  if (this->MappedData != NULL)
+  {
+    UnmapViewOfFile(this->MappedData);
+    this->MappedData = NULL;
+  }
+  if (this->FileMappingHandle != NULL)
+  {
+    CloseHandle(this->FileMappingHandle);
+    this->FileMappingHandle = NULL;
+  }
+  if (this->FileHandle != INVALID_HANDLE_VALUE)
   {
-    // Skip header data
-    fread(dataFromFile, numberOfBytesToSkip, 1, fp);
+    CloseHandle(this->FileHandle);
+    this->FileHandle = INVALID_HANDLE_VALUE;
+  }
+  this->MappedSizeInBytes = 0;
+  this->NumberOfFrames = 0;
+  this->PixelType = VTK_VOID;
+  this->FrameSizeInBytes = 0;
+  this->FirstFrameOffset = 0;
+  this->FrameStrideInBytes = 0;
+  this->FrameFields.clear();
+}
 
-    // Read data from file
-    fread(dataFromFile, frameSizeInBytes, 1, fp);
+//----------------------------------------------------------------------------
+const unsigned char* vtkPlusSonixVolumeReader::GetFrameData(unsigned int frameIndex) const
+{
+  if (this->MappedData == NULL || frameIndex >= this->NumberOfFrames)
+  {
+    return NULL;
+  }
+  return this->MappedData + this->FirstFrameOffset + frameIndex * this->FrameStrideInBytes;
+}
 
-    igsioCommon::VTKScalarPixelType pixelType = VTK_VOID;
-    switch (dataType)
-    {
-      case udtBPost:
-        pixelType = VTK_UNSIGNED_CHAR;
-        break;
-      case udtRF:
-        pixelType = VTK_SHORT;
-        break;
-      default:
-        LOG_ERROR("Uknown pixel type for data type: " << dataType);
-        continue;
-    }
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSonixVolumeReader::GetTrackedFrame(unsigned int frameIndex, igsioTrackedFrame& trackedFrame, double acquisitionFrameRate/* = 10*/) const
+{
+  const unsigned char* frameData = this->GetFrameData(frameIndex);
+  if (frameData == NULL)
+  {
+    LOG_ERROR("Failed to get frame #" << frameIndex << " from sonix volume - the volume is not open or the frame index is invalid");
+    return PLUS_FAIL;
+  }
 
-    // If in the future sonix generates color images, we can change this to support that
-    unsigned int numberOfScalarComponents = 1;
+  // If in the future sonix generates color images, we can change this to support that
+  unsigned int numberOfScalarComponents = 1;
 
-    igsioVideoFrame videoFrame;
-    if (videoFrame.AllocateFrame(frameSize, pixelType, numberOfScalarComponents) != PLUS_SUCCESS)
-    {
-      LOG_ERROR("Failed to allocate image data for frame #" << i);
-      continue;
-    }
+  igsioVideoFrame* videoFrame = trackedFrame.GetImageData();
+  if (videoFrame->AllocateFrame(this->FrameSize, this->PixelType, numberOfScalarComponents) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to allocate image data for frame #" << frameIndex);
+    return PLUS_FAIL;
+  }
 
-    // Copy the frame data form file to vtkImageDataSet
-    memcpy(videoFrame.GetScalarPointer(), dataFromFile, frameSizeInBytes);
+  // Copy the frame data form the mapped file to vtkImageDataSet
+  memcpy(videoFrame->GetScalarPointer(), frameData, this->FrameSizeInBytes);
 
-    igsioTrackedFrame trackedFrame;
-    trackedFrame.SetImageData(videoFrame);
-    trackedFrame.SetTimestamp((1.0 * (i + 1)) / acquisitionFrameRate);       // Generate timestamp, but don't start from 0
+  trackedFrame.SetTimestamp((1.0 * (frameIndex + 1)) / acquisitionFrameRate);       // Generate timestamp, but don't start from 0
 
-    trackedFrame.SetFrameField("SonixDataType", strDataType.str());
-    trackedFrame.SetFrameField("SonixTransmitFrequency", strTransmitFrequency.str());
-    trackedFrame.SetFrameField("SonixSamplingFrequency", strSamplingFrequency.str());
-    trackedFrame.SetFrameField("SonixDataRate", strDataRate.str());
-    trackedFrame.SetFrameField("SonixLineDensity", strLineDensity.str());
-    trackedFrame.SetFrameField("SonixProbeID", strProbeID.str());
+  for (std::vector<std::pair<std::string, std::string> >::const_iterator field = this->FrameFields.begin(); field != this->FrameFields.end(); ++field)
+  {
+    trackedFrame.SetFrameField(field->first, field->second);
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+// static
+PlusStatus vtkPlusSonixVolumeReader::GenerateTrackedFrameFromSonixVolume(const char* volumeFileName, vtkIGSIOTrackedFrameList* trackedFrameList, double acquisitionFrameRate/* = 10*/)
+{
+  if (volumeFileName == NULL)
+  {
+    LOG_ERROR("Failed to generate tracked frame from sonix volume - input file name is NULL!");
+    return PLUS_FAIL;
+  }
 
+  if (trackedFrameList == NULL)
+  {
+    LOG_ERROR("Failed to generate tracked frame from sonix volume - output tracked frame list is NULL!");
+    return PLUS_FAIL;
+  }
 
-    trackedFrameList->AddTrackedFrame(&trackedFrame);
+  vtkSmartPointer<vtkPlusSonixVolumeReader> reader = vtkSmartPointer<vtkPlusSonixVolumeReader>::New();
+  if (reader->Open(volumeFileName) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
   }
 
-  fclose(fp);
-  delete [] dataFromFile;
+  // Frames of a batch are copied from the mapped file in parallel, then added to the list in order
+  PlusWorkerPool& workerPool = PlusWorkerPool::GetInstance();
+  const unsigned int numberOfFrames = reader->GetNumberOfFrames();
+  const unsigned int batchSize = static_cast<unsigned int>(workerPool.GetNumberOfThreads() + 1) * FRAMES_PER_THREAD_IN_BATCH;
+  for (unsigned int batchStart = 0; batchStart < numberOfFrames; batchStart += batchSize)
+  {
+    const unsigned int batchEnd = std::min(batchStart + batchSize, numberOfFrames);
+    std::vector<igsioTrackedFrame> frames(batchEnd - batchStart);
+    std::vector<int> frameSucceeded(frames.size(), 0);
+    workerPool.ParallelFor(batchStart, batchEnd, 0, [&](int first, int last)
+    {
+      for (int i = first; i < last; ++i)
+      {
+        frameSucceeded[i - batchStart] = (reader->GetTrackedFrame(i, frames[i - batchStart], acquisitionFrameRate) == PLUS_SUCCESS);
+      }
+    });
+    for (unsigned int i = 0; i < frames.size(); ++i)
+    {
+      if (!frameSucceeded[i])
+      {
+        continue;
+      }
+      trackedFrameList->AddTrackedFrame(&frames[i]);
+      // Release the image right away, the frame list has its own copy
+      frames[i] = igsioTrackedFrame();
+    }
+  }
 
   return PLUS_SUCCESS;
 }
-
-
@@ -12,11 +12,21 @@
 
 #include "vtkImageAlgorithm.h" 
 
-//class vtkIGSIOTrackedFrameList; 
+#include <string>
+#include <utility>
+#include <vector>
+
+class igsioTrackedFrame;
+class vtkIGSIOTrackedFrameList;
 
 /*!
   \class vtkPlusSonixVolumeReader 
   \brief Reads a volume from file to tracked frame list
+
+  The volume file is mapped into memory instead of being read into temporary buffers. After Open the frames can be
+  accessed as views into the mapped file (GetFrameData), so only the pages of the frames that are used are read from
+  the disk, which allows processing multi-GB RF archives frame by frame.
+
   \ingroup PlusLibDataCollection
 */ 
 class vtkPlusDataCollectionExport vtkPlusSonixVolumeReader: public vtkImageAlgorithm
@@ -26,14 +36,54 @@ public:
   vtkTypeMacro(vtkPlusSonixVolumeReader,vtkImageAlgorithm);
   virtual void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
 
-  /*! Read a volume from Ultrasonix format (.b8, .b32, .bpr, .rf) and convert it to tracked frame */
+  /*!
+    Read a volume from Ultrasonix format (.b8, .b32, .bpr, .rf) and convert it to tracked frame.
+    Frames are copied from the mapped file into tracked frames on the threads of the worker pool, a batch at a time.
+  */
   static PlusStatus GenerateTrackedFrameFromSonixVolume(const char* volumeFileName, vtkIGSIOTrackedFrameList* trackedFrameList, double acquisitionFrameRate = 10); 
 
+  /*! Map a volume file into memory and read its header. Fails if the pixel type of the volume is not supported. */
+  PlusStatus Open(const char* volumeFileName);
+
+  /*! Unmap the volume file, frame data pointers are invalid after this */
+  void Close();
+
+  bool IsOpen() const { return this->MappedData != NULL; }
+
+  unsigned int GetNumberOfFrames() const { return this->NumberOfFrames; }
+  const FrameSizeType& GetFrameSize() const { return this->FrameSize; }
+  igsioCommon::VTKScalarPixelType GetPixelType() const { return this->PixelType; }
+  unsigned int GetFrameSizeInBytes() const { return this->FrameSizeInBytes; }
+
+  /*! Pixel data of a frame, pointing into the mapped file. Valid until the file is closed. Returns NULL if the frame index is invalid. */
+  const unsigned char* GetFrameData(unsigned int frameIndex) const;
+
+  /*! Copy a frame into a tracked frame. The timestamp is generated from the frame rate, the fields of the volume header are added as frame fields. Thread-safe. */
+  PlusStatus GetTrackedFrame(unsigned int frameIndex, igsioTrackedFrame& trackedFrame, double acquisitionFrameRate = 10) const;
+
 protected:
   /*! Constructor */
   vtkPlusSonixVolumeReader();
   /*! Destructor */
   ~vtkPlusSonixVolumeReader();
+
+  /*! Handles of the file and the file mapping (HANDLE) */
+  void* FileHandle;
+  void* FileMappingHandle;
+  const unsigned char* MappedData;
+  unsigned long long MappedSizeInBytes;
+
+  unsigned int NumberOfFrames;
+  FrameSizeType FrameSize;
+  igsioCommon::VTKScalarPixelType PixelType;
+  unsigned int FrameSizeInBytes;
+  /*! Position of the pixel data of the first frame in the file */
+  unsigned long long FirstFrameOffset;
+  /*! Distance between the pixel data of consecutive frames (frames may have a header before their pixel data) */
+  unsigned long long FrameStrideInBytes;
+  /*! Fields of the volume header that are added to each frame */
+  std::vector<std::pair<std::string, std::string> > FrameFields;
+
 private:
   vtkPlusSonixVolumeReader(const vtkPlusSonixVolumeReader&);
   void operator=(const vtkPlusSonixVolumeReader&);
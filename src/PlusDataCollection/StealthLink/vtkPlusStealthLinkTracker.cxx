@@ -20,6 +20,7 @@ See License.txt for details.
 #include "vtkIGSIOTransformRepository.h"
 
 #include <iostream>
+#include <sstream>
 
 static const int MAX_DEVICE_ID_LENGTH = 15; //for OpenIGTLink message sending purposes, the image id will be created off of device id. It is better for it to be short
 
@@ -623,6 +624,41 @@ PlusStatus vtkPlusStealthLinkTracker::GetImageMetaData(igsioCommon::ImageMetaDat
   this->Internal->PairImageIdAndName.second = this->Internal->GetExamAndPatientInformationAsString(exam);
   return PLUS_SUCCESS;
 }
+//-------------------------------------------------------------------
+PlusStatus vtkPlusStealthLinkTracker::GetImageVersion(const std::string& requestedImageId, const std::string& imageReferencFrameName, std::string& imageVersion)
+{
+  imageVersion.clear();
+  if (STRCASECMP(imageReferencFrameName.c_str(), "Ras") != 0)
+  {
+    // The image transform depends on the transform repository, which is not versioned
+    return PLUS_FAIL;
+  }
+  if (!this->InternalShared->UpdateCurrentExam())
+  {
+    return PLUS_FAIL;
+  }
+  if (!this->InternalShared->UpdateCurrentRegistration(this->ImageTransferRequiresPatientRegistration))
+  {
+    return PLUS_FAIL;
+  }
+  MNavStealthLink::Exam exam;
+  MNavStealthLink::Registration registration;
+  this->InternalShared->GetCurrentExam(exam);
+  this->InternalShared->GetCurrentRegistration(registration);
+
+  std::ostringstream version;
+  version << requestedImageId << ";" << this->Internal->GetExamAndPatientInformationAsString(exam) << ";";
+  for (int row = 0; row < 4; row++)
+  {
+    for (int col = 0; col < 4; col++)
+    {
+      version << " " << registration.regExamMM_T_frame[row][col] << " " << exam.examMM_T_regExamMM[row][col];
+    }
+  }
+  imageVersion = version.str();
+  return PLUS_SUCCESS;
+}
+
 //-------------------------------------------------------------------
 PlusStatus vtkPlusStealthLinkTracker::GetImage(const std::string& requestedImageId, std::string& assignedImageId, const std::string& imageReferencFrameName, vtkImageData* imageData, vtkMatrix4x4* ijkToReferenceTransform)
 {
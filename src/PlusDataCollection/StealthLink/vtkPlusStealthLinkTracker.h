@@ -47,6 +47,12 @@ public:
   */
   virtual PlusStatus GetImage( const std::string& requestedImageId, std::string& assignedImageId, const std::string& imageReferenceFrameName, vtkImageData* imageData, vtkMatrix4x4* ijkToReferenceTransform );
 
+  /*!
+    The image version is made of the current exam, patient, and registration information, so that the exam
+    only has to be downloaded again if it is changed on the server
+  */
+  virtual PlusStatus GetImageVersion( const std::string& requestedImageId, const std::string& imageReferenceFrameName, std::string& imageVersion );
+
   /*! Get the dicom directory where the dicom images will be saved when acquired from the server */
   std::string GetDicomImagesOutputDirectory();
 
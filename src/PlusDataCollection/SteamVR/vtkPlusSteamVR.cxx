@@ -21,6 +21,8 @@ See License.txt for details.
 #include <vtkXMLDataElement.h>
 #include <vtkMath.h>
 #include <vtkSmartPointer.h>
+#include <algorithm>
+#include <chrono>
 #include <sstream>
 
 vtkStandardNewMacro(vtkPlusSteamVR);
@@ -28,6 +30,8 @@ vtkStandardNewMacro(vtkPlusSteamVR);
 void vtkPlusSteamVR::PrintSelf(ostream& os, vtkIndent indent)
 {
 	Superclass::PrintSelf(os, indent);
+	os << indent << "NativeRatePoseStreaming: " << (this->NativeRatePoseStreaming ? "true" : "false") << std::endl;
+	os << indent << "PosePredictionSec: " << this->PosePredictionSec << std::endl;
 }
 
 vtkPlusSteamVR::vtkPlusSteamVR()
@@ -35,9 +39,16 @@ vtkPlusSteamVR::vtkPlusSteamVR()
 {
 	this->FrameNumber = 0;
 	this->StartThreadForInternalUpdates = true;
+	this->PoseThreadActive = false;
 }
 
 vtkPlusSteamVR::~vtkPlusSteamVR() {
+	this->PoseThreadActive = false;
+	if (this->PoseThread.joinable())
+	{
+		this->PoseThread.join();
+	}
+
 	delete vr_context;
 	delete vr_chaperone;
 	delete overlay;
@@ -162,22 +173,11 @@ PlusStatus vtkPlusSteamVR::InternalUpdate() {
 				matrix->Element[1][3] = v[1] * 1000;
 				matrix->Element[2][3] = v[2] * 1000;
 
-				double unfilteredTimestamp = 0.0;
-
-				if(strcmp(tracked_device_type[nDevice].c_str(), "hmd") == 0 && HMD_registered)
-				{
-					unfilteredTimestamp = vtkIGSIOAccurateTimer::GetSystemTime();
-					this->ToolTimeStampedUpdate(this->HMD_DS->GetSourceId(), matrix, ToolStatus(TOOL_OK), this->FrameNumber, unfilteredTimestamp, NULL);
-				}
-				else if (strcmp(tracked_device_type[nDevice].c_str(), "controller") == 0 && controller_registered) 
-				{
-					unfilteredTimestamp = vtkIGSIOAccurateTimer::GetSystemTime();
-					this->ToolTimeStampedUpdate(this->Controller_DS->GetSourceId(), matrix, ToolStatus(TOOL_OK), this->FrameNumber, unfilteredTimestamp, NULL);
-				}
-				else if (strcmp(tracked_device_type[nDevice].c_str(), "generic tracker") == 0 && generic_tracker_registered)
+				vtkPlusDataSource* dataSource = this->GetDataSourceForTrackedDevice(nDevice);
+				if (dataSource != NULL)
 				{
-					unfilteredTimestamp = vtkIGSIOAccurateTimer::GetSystemTime();
-					this->ToolTimeStampedUpdate(this->GenericTracker_DS->GetSourceId(), matrix, ToolStatus(TOOL_OK), this->FrameNumber, unfilteredTimestamp, NULL);
+					double unfilteredTimestamp = vtkIGSIOAccurateTimer::GetSystemTime();
+					this->ToolTimeStampedUpdate(dataSource->GetSourceId(), matrix, ToolStatus(TOOL_OK), this->FrameNumber, unfilteredTimestamp, NULL);
 				}
 			}
 			
@@ -192,6 +192,127 @@ PlusStatus vtkPlusSteamVR::InternalUpdate() {
 	}
 }
 
+vtkPlusDataSource* vtkPlusSteamVR::GetDataSourceForTrackedDevice(uint32_t deviceIndex)
+{
+	const std::string& deviceType = tracked_device_type[deviceIndex];
+	if (deviceType == "hmd" && HMD_registered)
+	{
+		return this->HMD_DS;
+	}
+	else if (deviceType == "controller" && controller_registered)
+	{
+		return this->Controller_DS;
+	}
+	else if (deviceType == "generic tracker" && generic_tracker_registered)
+	{
+		return this->GenericTracker_DS;
+	}
+	return NULL;
+}
+
+void vtkPlusSteamVR::AddPoseSamples(const vr::TrackedDevicePose_t* poses, double timestamp)
+{
+	for (uint32_t nDevice = 0; nDevice < vr::k_unMaxTrackedDeviceCount; nDevice++)
+	{
+		if (!poses[nDevice].bDeviceIsConnected || !poses[nDevice].bPoseIsValid)
+		{
+			continue;
+		}
+		vtkPlusDataSource* dataSource = this->GetDataSourceForTrackedDevice(nDevice);
+		if (dataSource == NULL)
+		{
+			continue;
+		}
+
+		vtkPlusBuffer::ToolSample sample;
+		const vr::HmdMatrix34_t& pose = poses[nDevice].mDeviceToAbsoluteTracking;
+		for (int row = 0; row < 3; row++)
+		{
+			for (int column = 0; column < 3; column++)
+			{
+				sample.Matrix[4 * row + column] = pose.m[row][column];
+			}
+			// SteamVR positions are in meters
+			sample.Matrix[4 * row + 3] = pose.m[row][3] * 1000.0;
+		}
+		sample.Matrix[12] = 0.0;
+		sample.Matrix[13] = 0.0;
+		sample.Matrix[14] = 0.0;
+		sample.Matrix[15] = 1.0;
+		sample.Status = TOOL_OK;
+		// The timestamp is derived from the vsync time of the runtime, it does not need filtering
+		sample.UnfilteredTimestamp = timestamp;
+		sample.FilteredTimestamp = timestamp;
+		this->PoseSamples[dataSource->GetSourceId()].push_back(sample);
+	}
+}
+
+void vtkPlusSteamVR::RunPoseThread()
+{
+	// Missed display frames older than this are not recovered from the pose history of the runtime
+	const uint64_t maxNumberOfRecoveredFrames = 10;
+	// Time to wait after the expected vsync, so that the runtime has the new frame
+	const double vsyncWaitMarginSec = 0.0005;
+
+	float displayFrequencyHz = vr_context->GetFloatTrackedDeviceProperty(vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_DisplayFrequency_Float);
+	if (displayFrequencyHz <= 0)
+	{
+		LOG_WARNING("SteamVR display frequency is not available, assuming 90Hz");
+		displayFrequencyHz = 90.0f;
+	}
+	const double frameIntervalSec = 1.0 / displayFrequencyHz;
+
+	vr::TrackedDevicePose_t poses[vr::k_unMaxTrackedDeviceCount];
+	bool firstFrame = true;
+	uint64_t lastFrameCounter = 0;
+	while (this->PoseThreadActive)
+	{
+		float secondsSinceLastVsync = 0;
+		uint64_t frameCounter = 0;
+		if (!vr_context->GetTimeSinceLastVsync(&secondsSinceLastVsync, &frameCounter))
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			continue;
+		}
+		if (!firstFrame && frameCounter == lastFrameCounter)
+		{
+			// Sleep until the next vsync instead of polling
+			const double waitSec = std::max(frameIntervalSec - secondsSinceLastVsync, 0.0) + vsyncWaitMarginSec;
+			std::this_thread::sleep_for(std::chrono::duration<double>(waitSec));
+			continue;
+		}
+		const double now = vtkIGSIOAccurateTimer::GetSystemTime();
+
+		uint64_t numberOfFrames = firstFrame ? 1 : frameCounter - lastFrameCounter;
+		if (numberOfFrames > maxNumberOfRecoveredFrames + 1)
+		{
+			LOG_WARNING("SteamVR pose thread missed " << numberOfFrames - 1 << " display frames, only the last " << maxNumberOfRecoveredFrames << " are recovered");
+			numberOfFrames = maxNumberOfRecoveredFrames + 1;
+		}
+		// Oldest frame first, so that the timestamps are increasing. Poses of missed frames are queried in the past,
+		// the runtime interpolates them from its pose history.
+		for (uint64_t frame = numberOfFrames; frame-- > 0;)
+		{
+			const double secondsSinceVsync = secondsSinceLastVsync + frame * frameIntervalSec;
+			vr_context->GetDeviceToAbsoluteTrackingPose(vr::ETrackingUniverseOrigin::TrackingUniverseStanding, static_cast<float>(this->PosePredictionSec - secondsSinceVsync), poses, vr::k_unMaxTrackedDeviceCount);
+			this->AddPoseSamples(poses, now - secondsSinceVsync);
+		}
+
+		for (std::map<std::string, std::vector<vtkPlusBuffer::ToolSample> >::iterator it = this->PoseSamples.begin(); it != this->PoseSamples.end(); ++it)
+		{
+			if (!it->second.empty())
+			{
+				this->ToolTimeStampedUpdateBatch(it->first, it->second);
+				// keep the allocated memory for the next frame
+				it->second.clear();
+			}
+		}
+
+		firstFrame = false;
+		lastFrameCounter = frameCounter;
+	}
+}
+
 PlusStatus vtkPlusSteamVR::NotifyConfigured() {
 	if(HMD_DS != NULL)
 	{
@@ -211,6 +332,11 @@ PlusStatus vtkPlusSteamVR::NotifyConfigured() {
 PlusStatus vtkPlusSteamVR::ReadConfiguration(vtkXMLDataElement*  rootConfigElement ) {
 	  XML_FIND_DEVICE_ELEMENT_REQUIRED_FOR_READING(deviceConfig, rootConfigElement);
 
+	XML_READ_BOOL_ATTRIBUTE_OPTIONAL(NativeRatePoseStreaming, deviceConfig);
+	XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, PosePredictionSec, deviceConfig);
+	// Poses are either acquired by the pose thread or polled by the internal update thread
+	this->StartThreadForInternalUpdates = !this->NativeRatePoseStreaming;
+
 	XML_FIND_NESTED_ELEMENT_REQUIRED(dataSourcesElement, deviceConfig, "DataSources");
 	for (int nestedElementIndex = 0; nestedElementIndex < dataSourcesElement->GetNumberOfNestedElements(); nestedElementIndex++)
 	{
@@ -270,16 +396,33 @@ PlusStatus vtkPlusSteamVR::ReadConfiguration(vtkXMLDataElement*  rootConfigEleme
 }
 
 PlusStatus vtkPlusSteamVR::WriteConfiguration(vtkXMLDataElement* rootConfigElement) {
+	XML_FIND_DEVICE_ELEMENT_REQUIRED_FOR_WRITING(deviceConfig, rootConfigElement);
+	XML_WRITE_BOOL_ATTRIBUTE(NativeRatePoseStreaming, deviceConfig);
+	deviceConfig->SetDoubleAttribute("PosePredictionSec", this->PosePredictionSec);
 	return PLUS_SUCCESS;
 }
 
 PlusStatus vtkPlusSteamVR::InternalStartRecording() {
-	//Not implemented yet
+	if (!this->NativeRatePoseStreaming)
+	{
+		return PLUS_SUCCESS;
+	}
+	if (vr_context == NULL)
+	{
+		LOG_ERROR("Cannot start SteamVR pose streaming: SteamVR is not initialized");
+		return PLUS_FAIL;
+	}
+	this->PoseThreadActive = true;
+	this->PoseThread = std::thread(&vtkPlusSteamVR::RunPoseThread, this);
 	return PLUS_SUCCESS;
 }
 
 PlusStatus vtkPlusSteamVR::InternalStopRecording() {
-	//Not implemented yet
+	this->PoseThreadActive = false;
+	if (this->PoseThread.joinable())
+	{
+		this->PoseThread.join();
+	}
 	return PLUS_SUCCESS;
 }
 
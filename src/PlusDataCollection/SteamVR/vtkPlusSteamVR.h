@@ -15,8 +15,12 @@ See License.txt for details.
 #include "openvr.h"
 #include "vtkPlusSteamVRUtility.h"
 //#include "vtkPlusUtil.h"
+#include <atomic>
 #include <string>
 #include <list>
+#include <map>
+#include <thread>
+#include <vector>
 
 class vtkPlusDataCollectionExport vtkPlusSteamVR : public vtkPlusDevice {
 
@@ -50,6 +54,21 @@ public:
 
 	PlusStatus Probe();
 
+	/*!
+	  If enabled, poses are acquired by a separate thread once per display frame (vsync) of the runtime and every frame is
+	  recorded with the vsync time of the runtime, instead of polling the poses at the AcquisitionRate. Frames that the
+	  thread missed are recovered from the pose history of the runtime. Disabled by default.
+	*/
+	vtkSetMacro(NativeRatePoseStreaming, bool);
+	vtkGetMacro(NativeRatePoseStreaming, bool);
+
+	/*!
+	  Time in seconds that the recorded poses are predicted ahead of their timestamp by the runtime, for compensating the
+	  latency of downstream processing. 0 (default) records the measured poses.
+	*/
+	vtkSetMacro(PosePredictionSec, double);
+	vtkGetMacro(PosePredictionSec, double);
+
 protected:
 	vtkPlusSteamVR();
 	~vtkPlusSteamVR();
@@ -58,6 +77,24 @@ protected:
 	vtkPlusDataSource *GenericTracker_DS = NULL;
 	vtkPlusDataSource *Controller_DS = NULL;
 
+	/*! Data source of a tracked device, NULL if the device type is not registered */
+	vtkPlusDataSource* GetDataSourceForTrackedDevice(uint32_t deviceIndex);
+
+	/*! Pose acquisition thread for native rate pose streaming */
+	void RunPoseThread();
+
+	/*! Add the valid poses of all registered devices as samples with the given timestamp */
+	void AddPoseSamples(const vr::TrackedDevicePose_t* poses, double timestamp);
+
+	bool NativeRatePoseStreaming = false;
+	double PosePredictionSec = 0.0;
+
+	std::thread PoseThread;
+	std::atomic<bool> PoseThreadActive;
+
+	/*! Samples of the current batch for each data source, owned by the pose thread */
+	std::map<std::string, std::vector<vtkPlusBuffer::ToolSample> > PoseSamples;
+
 private:
 	vtkPlusSteamVR(const vtkPlusSteamVR&);
 	void operator=(const vtkPlusSteamVR&);
@@ -0,0 +1,258 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file AcquisitionSchedulerTest.cxx
+  \brief Checks the deadline tracking of PlusUpdateSchedule and the updates run by the shared update thread.
+
+  First updates with known start and end times are recorded and the release times, jitter and overruns are compared
+  to the expected values. The adaptive mode is checked by simulating a device that produces an item every 100 ms and is
+  polled with a 10 ms period. Then two tasks with different periods are run by PlusAcquisitionScheduler and the number
+  of their updates is checked (with a generous tolerance, as the test may run on a loaded machine).
+*/
+
+#include "PlusConfigure.h"
+#include "PlusAcquisitionScheduler.h"
+#include "vtkIGSIOAccurateTimer.h"
+
+// VTK includes
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+
+namespace
+{
+  const double TOLERANCE_SEC = 1e-9;
+  // Histograms store durations in whole microseconds
+  const double HISTOGRAM_TOLERANCE_SEC = 2e-6;
+
+  //----------------------------------------------------------------------------
+  int CheckValue(const char* name, double actual, double expected, double tolerance = TOLERANCE_SEC)
+  {
+    if (std::fabs(actual - expected) > tolerance)
+    {
+      LOG_ERROR(name << " is " << actual << " instead of " << expected);
+      return 1;
+    }
+    return 0;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestUpdateSchedule()
+  {
+    int numberOfErrors = 0;
+    PlusUpdateSchedule schedule;
+    schedule.Start(0.1, 10.0);
+    numberOfErrors += CheckValue("First release time", schedule.GetNextReleaseTimeSec(), 10.0);
+
+    // On time: the next update is released one period later
+    schedule.RecordUpdate(10.0, 10.02);
+    numberOfErrors += CheckValue("Release time after an update on time", schedule.GetNextReleaseTimeSec(), 10.1);
+
+    // Started late: release times do not drift
+    schedule.RecordUpdate(10.13, 10.15);
+    numberOfErrors += CheckValue("Release time after a late update", schedule.GetNextReleaseTimeSec(), 10.2);
+    numberOfErrors += CheckValue("Maximum jitter", schedule.GetJitterHistogram().GetMaximumSec(), 0.03, HISTOGRAM_TOLERANCE_SEC);
+
+    // Completed after the deadline: the next update is released immediately
+    schedule.RecordUpdate(10.2, 10.35);
+    numberOfErrors += CheckValue("Release time after an overrun", schedule.GetNextReleaseTimeSec(), 10.35);
+    numberOfErrors += CheckValue("Maximum overrun", schedule.GetOverrunHistogram().GetMaximumSec(), 0.05, HISTOGRAM_TOLERANCE_SEC);
+
+    // Started early (woken up by input data): the period restarts
+    schedule.RecordUpdate(10.3, 10.31);
+    numberOfErrors += CheckValue("Release time after an early update", schedule.GetNextReleaseTimeSec(), 10.4);
+
+    if (schedule.GetNumberOfUpdates() != 4 || schedule.GetNumberOfOverruns() != 1)
+    {
+      LOG_ERROR("Number of updates is " << schedule.GetNumberOfUpdates() << " instead of 4, number of overruns is "
+                << schedule.GetNumberOfOverruns() << " instead of 1");
+      numberOfErrors++;
+    }
+    // Early updates have no jitter sample
+    if (schedule.GetJitterHistogram().GetNumberOfSamples() != 3)
+    {
+      LOG_ERROR("Number of jitter samples is " << schedule.GetJitterHistogram().GetNumberOfSamples() << " instead of 3");
+      numberOfErrors++;
+    }
+
+    schedule.ResetStatistics();
+    if (schedule.GetNumberOfUpdates() != 0 || schedule.GetNumberOfOverruns() != 0 || schedule.GetJitterHistogram().GetNumberOfSamples() != 0)
+    {
+      LOG_ERROR("Statistics are not cleared by ResetStatistics");
+      numberOfErrors++;
+    }
+    return numberOfErrors;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestAdaptiveUpdateSchedule()
+  {
+    const double startTimeSec = 10.0;
+    const double periodSec = 0.01;
+    const double itemIntervalSec = 0.1;
+    const double updateDurationSec = 0.001;
+    // The device stops producing items after 2 seconds
+    const double itemsStopTimeSec = startTimeSec + 2.0;
+
+    PlusUpdateSchedule schedule;
+    schedule.SetAdaptive(true);
+    schedule.Start(periodSec, startTimeSec);
+
+    // Updates and maximum delay between the production and the reception of an item, in each second of the simulation
+    int numberOfUpdates[3] = { 0, 0, 0 };
+    double maximumItemDelaySec[3] = { 0.0, 0.0, 0.0 };
+    int numberOfReceivedItems = 0;
+    double timeSec = startTimeSec;
+    while (timeSec < startTimeSec + 3.0)
+    {
+      timeSec = std::max(timeSec, schedule.GetNextReleaseTimeSec());
+      const int second = std::min(2, static_cast<int>(timeSec - startTimeSec));
+      const int numberOfProducedItems = static_cast<int>(std::floor((std::min(timeSec, itemsStopTimeSec) - startTimeSec) / itemIntervalSec + 1e-9));
+      if (numberOfProducedItems > numberOfReceivedItems)
+      {
+        maximumItemDelaySec[second] = std::max(maximumItemDelaySec[second], timeSec - (startTimeSec + numberOfProducedItems * itemIntervalSec));
+        schedule.ReportNewItems(numberOfProducedItems - numberOfReceivedItems);
+        numberOfReceivedItems = numberOfProducedItems;
+      }
+      schedule.RecordUpdate(timeSec, timeSec + updateDurationSec);
+      timeSec += updateDurationSec;
+      numberOfUpdates[second]++;
+
+      if (second == 1 && std::fabs(schedule.GetItemIntervalSec() - itemIntervalSec) > updateDurationSec)
+      {
+        LOG_ERROR("Learned item interval is " << schedule.GetItemIntervalSec() << " instead of " << itemIntervalSec);
+        return 1;
+      }
+    }
+
+    int numberOfErrors = 0;
+    // Once the interval is learned, there are at most 2 updates per item: one just before the item and one retry
+    if (numberOfUpdates[1] > 2 * static_cast<int>(1.0 / itemIntervalSec) + 2)
+    {
+      LOG_ERROR("Number of updates in the adaptive mode is " << numberOfUpdates[1] << " in a second, expected at most " << 2 * static_cast<int>(1.0 / itemIntervalSec) + 2);
+      numberOfErrors++;
+    }
+    if (maximumItemDelaySec[1] > periodSec + updateDurationSec + TOLERANCE_SEC)
+    {
+      LOG_ERROR("Maximum item delay in the adaptive mode is " << maximumItemDelaySec[1] << " s, expected at most " << periodSec + updateDurationSec);
+      numberOfErrors++;
+    }
+    // Without items, the schedule falls back to the period
+    if (schedule.GetItemIntervalSec() != 0.0 || numberOfUpdates[2] < static_cast<int>(0.5 / periodSec))
+    {
+      LOG_ERROR("The schedule did not fall back to the period after the items stopped, item interval is " << schedule.GetItemIntervalSec()
+                << ", number of updates in the last second is " << numberOfUpdates[2]);
+      numberOfErrors++;
+    }
+    LOG_INFO("Adaptive schedule: " << schedule.GetStatisticsString() << " UpdatesPerSecond=" << numberOfUpdates[0] << "," << numberOfUpdates[1] << "," << numberOfUpdates[2]);
+    return numberOfErrors;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestSharedUpdateThread()
+  {
+    const double testDurationSec = 1.0;
+    const double fastPeriodSec = 0.02;
+    const double slowPeriodSec = 0.1;
+
+    std::atomic<int> fastCount(0);
+    std::atomic<int> slowCount(0);
+    PlusUpdateSchedule fastSchedule;
+    PlusUpdateSchedule slowSchedule;
+    double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+    fastSchedule.Start(fastPeriodSec, startTime);
+    slowSchedule.Start(slowPeriodSec, startTime);
+
+    PlusAcquisitionScheduler& scheduler = PlusAcquisitionScheduler::GetInstance();
+    scheduler.AddTask(&fastSchedule, &fastSchedule, [&fastCount]() { fastCount++; });
+    scheduler.AddTask(&slowSchedule, &slowSchedule, [&slowCount]() { slowCount++; });
+    vtkIGSIOAccurateTimer::Delay(testDurationSec);
+    scheduler.RemoveTask(&fastSchedule);
+    scheduler.RemoveTask(&slowSchedule);
+
+    int numberOfErrors = 0;
+    if (scheduler.GetNumberOfTasks() != 0)
+    {
+      LOG_ERROR("Number of tasks is " << scheduler.GetNumberOfTasks() << " after removing all tasks");
+      numberOfErrors++;
+    }
+
+    // Updates must not run after their task is removed
+    int fastCountAfterRemoval = fastCount;
+    int slowCountAfterRemoval = slowCount;
+    vtkIGSIOAccurateTimer::Delay(2 * slowPeriodSec);
+    if (fastCount != fastCountAfterRemoval || slowCount != slowCountAfterRemoval)
+    {
+      LOG_ERROR("Tasks were updated after they had been removed");
+      numberOfErrors++;
+    }
+
+    const int expectedFastCount = static_cast<int>(testDurationSec / fastPeriodSec);
+    const int expectedSlowCount = static_cast<int>(testDurationSec / slowPeriodSec);
+    if (fastCount < expectedFastCount / 2 || fastCount > expectedFastCount + 2
+        || slowCount < expectedSlowCount / 2 || slowCount > expectedSlowCount + 2)
+    {
+      LOG_ERROR("Number of updates is " << fastCount << " (expected " << expectedFastCount << ") and " << slowCount
+                << " (expected " << expectedSlowCount << ")");
+      numberOfErrors++;
+    }
+    if (fastSchedule.GetNumberOfUpdates() != static_cast<unsigned long long>(fastCount))
+    {
+      LOG_ERROR("Number of recorded updates is " << fastSchedule.GetNumberOfUpdates() << " instead of " << fastCount);
+      numberOfErrors++;
+    }
+    LOG_INFO("Fast task: " << fastSchedule.GetStatisticsString());
+    LOG_INFO("Slow task: " << slowSchedule.GetStatisticsString());
+    return numberOfErrors;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  int numberOfErrors = 0;
+  numberOfErrors += TestUpdateSchedule();
+  numberOfErrors += TestAdaptiveUpdateSchedule();
+  numberOfErrors += TestSharedUpdateThread();
+
+  if (numberOfErrors > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfErrors << " errors");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,189 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file BufferCompressionTest.cxx
+  \brief Checks that the pixel data of aged video items is compressed and that the items are restored unchanged.
+
+  Video frames are added to a buffer, then the items that are older than the compression age are compressed.
+  All items are read (as copies and as views) and compared to the frames that were originally added.
+  Then more frames are added than the buffer size with background compression enabled, so that compressed items are
+  overwritten by the acquisition, and all items are checked again.
+*/
+
+#include "PlusConfigure.h"
+#include "vtkPlusBuffer.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+  const double FRAME_RATE = 100.0;
+  const unsigned int FRAME_WIDTH = 64;
+  const unsigned int FRAME_HEIGHT = 48;
+
+  //----------------------------------------------------------------------------
+  double GetItemTimestamp(int frameNumber)
+  {
+    return 1.0 + frameNumber / FRAME_RATE;
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Smooth pattern that identifies the frame, so that it is compressible */
+  void FillFrame(int frameNumber, std::vector<unsigned char>& pixels)
+  {
+    pixels.resize(FRAME_WIDTH * FRAME_HEIGHT);
+    for (unsigned int y = 0; y < FRAME_HEIGHT; ++y)
+    {
+      for (unsigned int x = 0; x < FRAME_WIDTH; ++x)
+      {
+        pixels[y * FRAME_WIDTH + x] = static_cast<unsigned char>(frameNumber + x / 8 + y / 4);
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus AddFrames(vtkPlusBuffer* buffer, int firstFrameNumber, int numberOfFrames)
+  {
+    const FrameSizeType frameSize = { FRAME_WIDTH, FRAME_HEIGHT, 1 };
+    std::vector<unsigned char> pixels;
+    for (int frameNumber = firstFrameNumber; frameNumber < firstFrameNumber + numberOfFrames; ++frameNumber)
+    {
+      FillFrame(frameNumber, pixels);
+      double timestamp = GetItemTimestamp(frameNumber);
+      if (buffer->AddItem(&pixels[0], frameSize, static_cast<unsigned int>(pixels.size()), US_IMG_BRIGHTNESS, frameNumber, timestamp, timestamp) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to add frame " << frameNumber << " to the buffer");
+        return PLUS_FAIL;
+      }
+    }
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  int CheckFrame(StreamBufferItem& item, const char* accessName)
+  {
+    std::vector<unsigned char> expectedPixels;
+    FillFrame(static_cast<int>(item.GetIndex()), expectedPixels);
+    vtkImageData* image = item.GetFrame().GetImage();
+    if (image == NULL || item.GetFrame().GetFrameSizeInBytes() != expectedPixels.size()
+        || memcmp(image->GetScalarPointer(), &expectedPixels[0], expectedPixels.size()) != 0)
+    {
+      LOG_ERROR("Pixel data of frame " << item.GetIndex() << " differs from the original frame (" << accessName << ")");
+      return 1;
+    }
+    return 0;
+  }
+
+  //----------------------------------------------------------------------------
+  int CheckAllFrames(vtkPlusBuffer* buffer)
+  {
+    int numberOfErrors = 0;
+    for (BufferItemUidType uid = buffer->GetOldestItemUidInBuffer(); uid <= buffer->GetLatestItemUidInBuffer(); ++uid)
+    {
+      StreamBufferItem item;
+      if (buffer->GetStreamBufferItem(uid, &item) != ITEM_OK)
+      {
+        LOG_ERROR("Failed to get item " << uid << " from the buffer");
+        numberOfErrors++;
+        continue;
+      }
+      numberOfErrors += CheckFrame(item, "copy");
+
+      StreamBufferItem view;
+      if (buffer->GetStreamBufferItemView(uid, &view) != ITEM_OK)
+      {
+        LOG_ERROR("Failed to get view of item " << uid << " from the buffer");
+        numberOfErrors++;
+        continue;
+      }
+      numberOfErrors += CheckFrame(view, "view");
+    }
+    return numberOfErrors;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  const int bufferSize = 50;
+  vtkSmartPointer<vtkPlusBuffer> buffer = vtkSmartPointer<vtkPlusBuffer>::New();
+  buffer->SetBufferSize(bufferSize);
+  buffer->SetPixelType(VTK_UNSIGNED_CHAR);
+  buffer->SetNumberOfScalarComponents(1);
+  buffer->SetFrameSize(FRAME_WIDTH, FRAME_HEIGHT, 1);
+
+  int numberOfErrors = 0;
+
+  // Compression is disabled while the buffer is filled, so the number of compressed items is known
+  if (AddFrames(buffer, 0, bufferSize) != PLUS_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+  // The age is between two frame periods, to avoid rounding issues
+  const double compressionAgeSec = 0.205;
+  buffer->SetCompressItemsOlderThanSec(compressionAgeSec);
+  const int expectedNumberOfCompressedItems = bufferSize - 1 - static_cast<int>(compressionAgeSec * FRAME_RATE);
+  int numberOfCompressedItems = buffer->CompressAgedItems();
+  if (numberOfCompressedItems != expectedNumberOfCompressedItems)
+  {
+    LOG_ERROR("Number of compressed items is " << numberOfCompressedItems << " instead of " << expectedNumberOfCompressedItems);
+    numberOfErrors++;
+  }
+  if (buffer->CompressAgedItems() != 0)
+  {
+    LOG_ERROR("Items were compressed again");
+    numberOfErrors++;
+  }
+  numberOfErrors += CheckAllFrames(buffer);
+
+  // Compressed items are overwritten while aged items are compressed in the background
+  if (AddFrames(buffer, bufferSize, 2 * bufferSize + 1) != PLUS_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+  numberOfErrors += CheckAllFrames(buffer);
+
+  if (numberOfErrors > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfErrors << " errors");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,295 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file BufferSnapshotTest.cxx
+  \brief Checks that the items of a buffer snapshot remain readable and unchanged while the buffer wraps around.
+
+  A buffer is filled, a snapshot is captured, then more items are added than the buffer size, so that all items of the
+  snapshot are overwritten in the buffer. All items of the snapshot are then read and compared to the values that were
+  originally added. The test is run with and without compact pose storage, and also for a cleared buffer. The pixel data
+  of video frames, which is shared by the snapshot instead of copied, must not be changed by the frames that overwrite
+  the items of the snapshot in the buffer.
+*/
+
+#include "PlusConfigure.h"
+#include "PlusBufferSnapshot.h"
+#include "vtkMatrix4x4.h"
+#include "vtkPlusBuffer.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+  const double FRAME_RATE = 100.0;
+  const unsigned int FRAME_WIDTH = 16;
+  const unsigned int FRAME_HEIGHT = 12;
+
+  //----------------------------------------------------------------------------
+  double GetItemTimestamp(int frameNumber)
+  {
+    return 1.0 + frameNumber / FRAME_RATE;
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus AddItems(vtkPlusBuffer* buffer, int firstFrameNumber, int numberOfItems)
+  {
+    vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    for (int frameNumber = firstFrameNumber; frameNumber < firstFrameNumber + numberOfItems; ++frameNumber)
+    {
+      // The translation identifies the item
+      matrix->SetElement(0, 3, frameNumber);
+      double timestamp = GetItemTimestamp(frameNumber);
+      if (buffer->AddTimeStampedItem(matrix, TOOL_OK, frameNumber, timestamp, timestamp) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to add item " << frameNumber << " to the buffer");
+        return PLUS_FAIL;
+      }
+    }
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  int CheckSnapshotItems(PlusBufferSnapshot& snapshot, int firstFrameNumber, int numberOfItems)
+  {
+    int numberOfErrors = 0;
+    if (snapshot.GetNumberOfItems() != numberOfItems)
+    {
+      LOG_ERROR("Snapshot contains " << snapshot.GetNumberOfItems() << " items instead of " << numberOfItems);
+      return 1;
+    }
+    for (int i = 0; i < numberOfItems; ++i)
+    {
+      const int frameNumber = firstFrameNumber + i;
+      const BufferItemUidType uid = snapshot.GetOldestItemUid() + i;
+
+      StreamBufferItem item;
+      if (snapshot.GetStreamBufferItem(uid, &item) != ITEM_OK)
+      {
+        LOG_ERROR("Failed to get item " << uid << " from the snapshot");
+        numberOfErrors++;
+        continue;
+      }
+      double matrixElements[16] = { 0.0 };
+      item.GetMatrixElements(matrixElements);
+      if (item.GetIndex() != static_cast<unsigned long>(frameNumber) || matrixElements[3] != frameNumber)
+      {
+        LOG_ERROR("Snapshot item " << uid << " has frame number " << item.GetIndex() << " and translation " << matrixElements[3]
+                  << " instead of " << frameNumber);
+        numberOfErrors++;
+      }
+
+      // Look up the item by a time that is slightly off, but still within the snapshot range
+      const double lookupTime = GetItemTimestamp(frameNumber) + ((i < numberOfItems - 1) ? 0.2 : -0.2) / FRAME_RATE;
+      double timestamp = 0;
+      BufferItemUidType uidFromTime = 0;
+      if (snapshot.GetTimeStamp(uid, timestamp) != ITEM_OK || fabs(timestamp - GetItemTimestamp(frameNumber)) > 1e-6
+          || snapshot.GetItemUidFromTime(lookupTime, uidFromTime) != ITEM_OK || uidFromTime != uid)
+      {
+        LOG_ERROR("Invalid timestamp or timestamp lookup result for snapshot item " << uid);
+        numberOfErrors++;
+      }
+    }
+
+    StreamBufferItem item;
+    if (snapshot.GetStreamBufferItem(snapshot.GetLatestItemUid() + 1, &item) != ITEM_NOT_AVAILABLE_YET)
+    {
+      LOG_ERROR("Item after the snapshot range is reported as available");
+      numberOfErrors++;
+    }
+    return numberOfErrors;
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Pattern that identifies the frame */
+  void FillFrame(int frameNumber, unsigned char* pixels)
+  {
+    for (unsigned int i = 0; i < FRAME_WIDTH * FRAME_HEIGHT; ++i)
+    {
+      pixels[i] = static_cast<unsigned char>(frameNumber + i);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus AddFrames(vtkPlusBuffer* buffer, int firstFrameNumber, int numberOfItems)
+  {
+    const FrameSizeType frameSize = { FRAME_WIDTH, FRAME_HEIGHT, 1 };
+    std::vector<unsigned char> pixels(FRAME_WIDTH * FRAME_HEIGHT);
+    for (int frameNumber = firstFrameNumber; frameNumber < firstFrameNumber + numberOfItems; ++frameNumber)
+    {
+      FillFrame(frameNumber, &pixels[0]);
+      double timestamp = GetItemTimestamp(frameNumber);
+      if (buffer->AddItem(&pixels[0], frameSize, static_cast<unsigned int>(pixels.size()), US_IMG_BRIGHTNESS, frameNumber, timestamp, timestamp) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to add frame " << frameNumber << " to the buffer");
+        return PLUS_FAIL;
+      }
+    }
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestVideoSnapshot(int bufferSize)
+  {
+    vtkSmartPointer<vtkPlusBuffer> buffer = vtkSmartPointer<vtkPlusBuffer>::New();
+    buffer->SetBufferSize(bufferSize);
+    buffer->SetPixelType(VTK_UNSIGNED_CHAR);
+    buffer->SetNumberOfScalarComponents(1);
+    buffer->SetFrameSize(FRAME_WIDTH, FRAME_HEIGHT, 1);
+    if (AddFrames(buffer, 0, bufferSize) != PLUS_SUCCESS)
+    {
+      return 1;
+    }
+
+    PlusBufferSnapshot snapshot(buffer);
+
+    // Overwrite all items of the snapshot in the buffer, twice, so that the buffer items are written again after their
+    // pixel data has been handed over to the snapshot
+    if (AddFrames(buffer, bufferSize, 2 * bufferSize) != PLUS_SUCCESS)
+    {
+      return 1;
+    }
+
+    int numberOfErrors = 0;
+    std::vector<unsigned char> expectedPixels(FRAME_WIDTH * FRAME_HEIGHT);
+    for (int frameNumber = 0; frameNumber < bufferSize; ++frameNumber)
+    {
+      const BufferItemUidType uid = snapshot.GetOldestItemUid() + frameNumber;
+      StreamBufferItem item;
+      if (snapshot.GetStreamBufferItem(uid, &item) != ITEM_OK)
+      {
+        LOG_ERROR("Failed to get frame " << uid << " from the snapshot");
+        numberOfErrors++;
+        continue;
+      }
+      FillFrame(frameNumber, &expectedPixels[0]);
+      vtkImageData* image = item.GetFrame().GetImage();
+      if (item.GetIndex() != static_cast<unsigned long>(frameNumber) || image == NULL
+          || memcmp(image->GetScalarPointer(), &expectedPixels[0], expectedPixels.size()) != 0)
+      {
+        LOG_ERROR("Snapshot item " << uid << " (frame " << item.GetIndex() << ") differs from frame " << frameNumber);
+        numberOfErrors++;
+      }
+    }
+
+    if (numberOfErrors > 0)
+    {
+      LOG_ERROR("Video snapshot test failed (buffer size: " << bufferSize << ")");
+    }
+    return numberOfErrors;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestSnapshot(int bufferSize, bool compactPoseStorage, bool clearBuffer)
+  {
+    vtkSmartPointer<vtkPlusBuffer> buffer = vtkSmartPointer<vtkPlusBuffer>::New();
+    buffer->SetBufferSize(bufferSize);
+    if (compactPoseStorage && buffer->SetCompactPoseStorage(true) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to enable compact pose storage");
+      return 1;
+    }
+
+    // Fill the buffer more than once, so that the snapshot range starts in the middle of the buffer
+    const int firstFrameNumber = bufferSize / 2;
+    if (AddItems(buffer, 0, firstFrameNumber + bufferSize) != PLUS_SUCCESS)
+    {
+      return 1;
+    }
+
+    PlusBufferSnapshot snapshot(buffer);
+
+    // Overwrite all items of the snapshot in the buffer
+    if (clearBuffer)
+    {
+      buffer->Clear();
+    }
+    if (AddItems(buffer, firstFrameNumber + bufferSize, 2 * bufferSize + 1) != PLUS_SUCCESS)
+    {
+      return 1;
+    }
+
+    int numberOfErrors = CheckSnapshotItems(snapshot, firstFrameNumber, bufferSize);
+
+    // After release the buffer does not preserve the items anymore
+    snapshot.Release();
+    if (snapshot.IsCaptured() || snapshot.GetNumberOfItems() != 0)
+    {
+      LOG_ERROR("Released snapshot still contains items");
+      numberOfErrors++;
+    }
+
+    // A new snapshot contains the latest items
+    if (snapshot.Capture(buffer) != PLUS_SUCCESS || snapshot.GetLatestItemUid() != buffer->GetLatestItemUidInBuffer())
+    {
+      LOG_ERROR("Failed to capture the buffer again");
+      numberOfErrors++;
+    }
+
+    if (numberOfErrors > 0)
+    {
+      LOG_ERROR("Snapshot test failed (buffer size: " << bufferSize << ", compact pose storage: " << compactPoseStorage << ", cleared: " << clearBuffer << ")");
+    }
+    return numberOfErrors;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  int numberOfErrors = 0;
+  for (int compactPoseStorage = 0; compactPoseStorage < 2; ++compactPoseStorage)
+  {
+    for (int clearBuffer = 0; clearBuffer < 2; ++clearBuffer)
+    {
+      numberOfErrors += TestSnapshot(1, compactPoseStorage != 0, clearBuffer != 0);
+      numberOfErrors += TestSnapshot(50, compactPoseStorage != 0, clearBuffer != 0);
+    }
+  }
+  numberOfErrors += TestVideoSnapshot(1);
+  numberOfErrors += TestVideoSnapshot(5);
+
+  if (numberOfErrors > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfErrors << " errors");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,156 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file DeviceClockModelTest.cxx
+  \brief Checks that PlusDeviceClockModel recovers the drift and offset of a simulated device clock.
+
+  A device clock with a known drift and offset is sampled at a fixed rate and the arrival times are delayed by a
+  random transfer delay. The mapped times must be close to the true acquisition times plus the minimum delay,
+  much closer than the arrival times themselves. A reset of the device clock must restart the model.
+*/
+
+#include "PlusConfigure.h"
+#include "PlusDeviceClockModel.h"
+
+// VTK includes
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+
+namespace
+{
+  const double SAMPLING_PERIOD_SEC = 1.0 / 300.0;
+  const double DRIFT_PPM = 80.0;
+  const double DEVICE_CLOCK_START_SEC = 1234.5;
+  const double SYSTEM_TIME_START_SEC = 10.0;
+  const double MINIMUM_DELAY_SEC = 0.001;
+  const double MEAN_RANDOM_DELAY_SEC = 0.004;
+  // Mapped times must be within this of the true acquisition time plus the minimum delay
+  const double MAPPING_TOLERANCE_SEC = 0.0005;
+
+  //----------------------------------------------------------------------------
+  int TestDriftAndOffset(double& deviceTimeSec, double& systemTimeSec, PlusDeviceClockModel& model)
+  {
+    std::mt19937 randomGenerator(42);
+    std::exponential_distribution<double> randomDelay(1.0 / MEAN_RANDOM_DELAY_SEC);
+
+    int numberOfErrors = 0;
+    double maximumErrorSec = 0.0;
+    const int numberOfSamples = static_cast<int>(30.0 / SAMPLING_PERIOD_SEC);
+    for (int i = 0; i < numberOfSamples; i++)
+    {
+      systemTimeSec += SAMPLING_PERIOD_SEC;
+      deviceTimeSec += SAMPLING_PERIOD_SEC * (1.0 + DRIFT_PPM * 1e-6);
+      double arrivalTimeSec = systemTimeSec + MINIMUM_DELAY_SEC + randomDelay(randomGenerator);
+      model.AddSample(deviceTimeSec, arrivalTimeSec);
+      // Allow the model to converge during the first window
+      if (i * SAMPLING_PERIOD_SEC > model.GetWindowSec())
+      {
+        double errorSec = std::fabs(model.GetSystemTime(deviceTimeSec) - (systemTimeSec + MINIMUM_DELAY_SEC));
+        maximumErrorSec = std::max(maximumErrorSec, errorSec);
+      }
+    }
+
+    LOG_INFO("Clock model: " << model.GetStatisticsString() << ", maximum mapping error: " << maximumErrorSec * 1000.0 << " ms");
+    if (!model.IsValid())
+    {
+      LOG_ERROR("Clock model is not valid after " << numberOfSamples << " samples");
+      numberOfErrors++;
+    }
+    if (maximumErrorSec > MAPPING_TOLERANCE_SEC)
+    {
+      LOG_ERROR("Maximum mapping error is " << maximumErrorSec * 1000.0 << " ms, more than " << MAPPING_TOLERANCE_SEC * 1000.0 << " ms");
+      numberOfErrors++;
+    }
+    // The device clock runs faster, so system time advances slower than device time
+    double expectedDriftPpm = (1.0 / (1.0 + DRIFT_PPM * 1e-6) - 1.0) * 1e6;
+    if (std::fabs(model.GetDriftPpm() - expectedDriftPpm) > 20.0)
+    {
+      LOG_ERROR("Drift is " << model.GetDriftPpm() << " ppm instead of " << expectedDriftPpm << " ppm");
+      numberOfErrors++;
+    }
+    if (model.GetNumberOfClockResets() != 0)
+    {
+      LOG_ERROR("Unexpected device clock resets: " << model.GetNumberOfClockResets());
+      numberOfErrors++;
+    }
+    return numberOfErrors;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestClockReset(double systemTimeSec, PlusDeviceClockModel& model)
+  {
+    int numberOfErrors = 0;
+    // Device clock restarts from zero
+    double deviceTimeSec = 0.0;
+    for (int i = 0; i < model.GetMinimumNumberOfSamples(); i++)
+    {
+      systemTimeSec += SAMPLING_PERIOD_SEC;
+      deviceTimeSec += SAMPLING_PERIOD_SEC;
+      model.AddSample(deviceTimeSec, systemTimeSec + MINIMUM_DELAY_SEC);
+    }
+    if (model.GetNumberOfClockResets() != 1)
+    {
+      LOG_ERROR("Number of device clock resets is " << model.GetNumberOfClockResets() << " instead of 1");
+      numberOfErrors++;
+    }
+    if (!model.IsValid() || std::fabs(model.GetSystemTime(deviceTimeSec) - (systemTimeSec + MINIMUM_DELAY_SEC)) > 1e-6)
+    {
+      LOG_ERROR("Clock model is not restarted correctly after a device clock reset");
+      numberOfErrors++;
+    }
+    return numberOfErrors;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  int numberOfErrors = 0;
+  PlusDeviceClockModel model;
+  double deviceTimeSec = DEVICE_CLOCK_START_SEC;
+  double systemTimeSec = SYSTEM_TIME_START_SEC;
+  numberOfErrors += TestDriftAndOffset(deviceTimeSec, systemTimeSec, model);
+  numberOfErrors += TestClockReset(systemTimeSec, model);
+
+  if (numberOfErrors > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfErrors << " errors");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
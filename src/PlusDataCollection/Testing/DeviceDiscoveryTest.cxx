@@ -0,0 +1,120 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file DeviceDiscoveryTest.cxx
+  \brief Checks that device candidates are probed and the found devices are written into the configuration skeleton.
+
+  Simulated devices are probed, two of them sharing the same resource. All of them are expected to be found and
+  to appear in the device set configuration skeleton with unique device identifiers.
+*/
+
+#include "PlusConfigure.h"
+#include "vtkPlusDeviceDiscovery.h"
+
+// VTK includes
+#include <vtkXMLDataElement.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <cstdlib>
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  vtkSmartPointer<vtkPlusDeviceDiscovery> discovery = vtkSmartPointer<vtkPlusDeviceDiscovery>::New();
+  discovery->SetProbeTimeoutSec(10.0);
+  vtkPlusDeviceDiscovery::Candidate trackerCandidate("FakeTracker", "SharedResource");
+  trackerCandidate.Attributes["Mode"] = "Default";
+  discovery->AddCandidate(trackerCandidate);
+  discovery->AddCandidate(trackerCandidate);
+  discovery->AddCandidate(vtkPlusDeviceDiscovery::Candidate("NoiseVideo"));
+
+  if (discovery->Discover() != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Device discovery failed");
+    return EXIT_FAILURE;
+  }
+
+  int numberOfErrors = 0;
+  const std::vector<vtkPlusDeviceDiscovery::ProbeResult>& results = discovery->GetResults();
+  if (results.size() != 3)
+  {
+    LOG_ERROR("Number of probe results is " << results.size() << " instead of 3");
+    return EXIT_FAILURE;
+  }
+  for (int i = 0; i < 3; ++i)
+  {
+    if (results[i].Result != vtkPlusDeviceDiscovery::PROBE_FOUND || results[i].ProbedCandidate.DeviceType != discovery->GetCandidates()[i].DeviceType)
+    {
+      LOG_ERROR("Candidate " << i << " (" << discovery->GetCandidates()[i].DeviceType << ") is "
+                << vtkPlusDeviceDiscovery::GetProbeResultAsString(results[i].Result) << " instead of found");
+      numberOfErrors++;
+    }
+  }
+  if (!results[0].IsTracker || results[2].IsTracker)
+  {
+    LOG_ERROR("Device kinds are not detected correctly");
+    numberOfErrors++;
+  }
+
+  vtkSmartPointer<vtkXMLDataElement> configRootElement = vtkSmartPointer<vtkXMLDataElement>::New();
+  if (discovery->GetConfigurationSkeleton(configRootElement) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to create configuration skeleton");
+    return EXIT_FAILURE;
+  }
+  vtkXMLDataElement* dataCollectionElement = configRootElement->FindNestedElementWithName("DataCollection");
+  const char* expectedDeviceIds[] = { "FakeTracker", "FakeTracker2", "NoiseVideo" };
+  for (int i = 0; i < 3; ++i)
+  {
+    vtkXMLDataElement* deviceElement = (dataCollectionElement != NULL) ? dataCollectionElement->FindNestedElementWithNameAndId("Device", expectedDeviceIds[i]) : NULL;
+    if (deviceElement == NULL)
+    {
+      LOG_ERROR("Device " << expectedDeviceIds[i] << " is not found in the configuration skeleton");
+      numberOfErrors++;
+    }
+  }
+  vtkXMLDataElement* videoDeviceElement = (dataCollectionElement != NULL) ? dataCollectionElement->FindNestedElementWithNameAndId("Device", "NoiseVideo") : NULL;
+  if (videoDeviceElement != NULL && videoDeviceElement->FindNestedElementWithName("OutputChannels") == NULL)
+  {
+    LOG_ERROR("Output channel of the video device is missing from the configuration skeleton");
+    numberOfErrors++;
+  }
+
+  if (numberOfErrors > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfErrors << " errors");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
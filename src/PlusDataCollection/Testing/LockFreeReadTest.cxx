@@ -0,0 +1,210 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file LockFreeReadTest.cxx
+  \brief Checks that lock-free UID and timestamp queries return consistent results while the buffer is written.
+
+  A writer thread adds items to a small buffer so that it wraps around many times, while reader threads query the
+  latest UID, the timestamp of that UID and the UID of that timestamp without locking the buffer. The timestamp of each
+  item is determined by its UID, so a UID that is returned with the timestamp of another item (a torn read) is detected.
+  The statuses that are returned for an empty buffer are also compared to the locked queries.
+*/
+
+#include "PlusConfigure.h"
+#include "vtkMatrix4x4.h"
+#include "vtkPlusBuffer.h"
+
+// VTK includes
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace
+{
+  const double FRAME_RATE = 1000.0;
+  const int BUFFER_SIZE = 8;
+  const int NUMBER_OF_READERS = 3;
+
+  //----------------------------------------------------------------------------
+  double GetItemTimestamp(BufferItemUidType firstUid, BufferItemUidType uid)
+  {
+    return 1.0 + (uid - firstUid) / FRAME_RATE;
+  }
+
+  //----------------------------------------------------------------------------
+  struct ReaderResult
+  {
+    ReaderResult() : NumberOfConsistentReads(0), NumberOfTornReads(0) {}
+    long NumberOfConsistentReads;
+    long NumberOfTornReads;
+  };
+
+  //----------------------------------------------------------------------------
+  void ReadItems(vtkPlusBuffer* buffer, BufferItemUidType firstUid, const std::atomic<bool>* writerFinished, ReaderResult* result)
+  {
+    while (!writerFinished->load())
+    {
+      const BufferItemUidType uid = buffer->GetLatestItemUidInBuffer();
+      double timestamp = 0;
+      if (buffer->GetTimeStamp(uid, timestamp) != ITEM_OK)
+      {
+        // The item has already been overwritten
+        continue;
+      }
+      if (fabs(timestamp - GetItemTimestamp(firstUid, uid)) > 1e-9)
+      {
+        result->NumberOfTornReads++;
+        continue;
+      }
+      BufferItemUidType uidFromTime = 0;
+      ItemStatus status = buffer->GetItemUidFromTime(timestamp, uidFromTime);
+      if (status == ITEM_OK && uidFromTime != uid)
+      {
+        result->NumberOfTornReads++;
+        continue;
+      }
+      if (status != ITEM_OK && status != ITEM_NOT_AVAILABLE_ANYMORE)
+      {
+        result->NumberOfTornReads++;
+        continue;
+      }
+      result->NumberOfConsistentReads++;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Returns the number of queries whose status on an empty buffer differs between the lock-free and the locked implementation */
+  int CompareEmptyBufferStatuses()
+  {
+    ItemStatus statuses[2][4];
+    for (int lockFree = 0; lockFree < 2; ++lockFree)
+    {
+      vtkSmartPointer<vtkPlusBuffer> buffer = vtkSmartPointer<vtkPlusBuffer>::New();
+      buffer->SetBufferSize(BUFFER_SIZE);
+      buffer->SetLockFreeReadEnabled(lockFree != 0);
+      double timestamp = 0;
+      BufferItemUidType uid = 0;
+      statuses[lockFree][0] = buffer->GetLatestTimeStamp(timestamp);
+      statuses[lockFree][1] = buffer->GetOldestTimeStamp(timestamp);
+      statuses[lockFree][2] = buffer->GetTimeStamp(buffer->GetLatestItemUidInBuffer(), timestamp);
+      statuses[lockFree][3] = buffer->GetItemUidFromTime(1.0, uid);
+    }
+    const char* queryNames[4] = { "GetLatestTimeStamp", "GetOldestTimeStamp", "GetTimeStamp", "GetItemUidFromTime" };
+    int numberOfErrors = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+      if (statuses[0][i] != statuses[1][i])
+      {
+        LOG_ERROR(queryNames[i] << " on an empty buffer returns " << statuses[1][i] << " with lock-free read, but " << statuses[0][i] << " with locking");
+        numberOfErrors++;
+      }
+    }
+    return numberOfErrors;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int numberOfItems(200000);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--number-of-items", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfItems, "Number of items that the writer adds (Default: 200000).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  int numberOfErrors = CompareEmptyBufferStatuses();
+
+  vtkSmartPointer<vtkPlusBuffer> buffer = vtkSmartPointer<vtkPlusBuffer>::New();
+  buffer->SetBufferSize(BUFFER_SIZE);
+  buffer->SetLockFreeReadEnabled(true);
+
+  // The first item is added before the readers start, so that the UID of the first item is known
+  vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  if (buffer->AddTimeStampedItem(matrix, TOOL_OK, 0, 1.0, 1.0) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to add the first item to the buffer");
+    return EXIT_FAILURE;
+  }
+  const BufferItemUidType firstUid = buffer->GetLatestItemUidInBuffer();
+
+  std::atomic<bool> writerFinished(false);
+  std::vector<ReaderResult> results(NUMBER_OF_READERS);
+  std::vector<std::thread> readers;
+  for (int i = 0; i < NUMBER_OF_READERS; ++i)
+  {
+    readers.push_back(std::thread(ReadItems, buffer.GetPointer(), firstUid, &writerFinished, &results[i]));
+  }
+
+  int numberOfFailedWrites = 0;
+  for (int frameNumber = 1; frameNumber < numberOfItems; ++frameNumber)
+  {
+    const double timestamp = GetItemTimestamp(firstUid, firstUid + frameNumber);
+    if (buffer->AddTimeStampedItem(matrix, TOOL_OK, frameNumber, timestamp, timestamp) != PLUS_SUCCESS)
+    {
+      numberOfFailedWrites++;
+    }
+  }
+  writerFinished = true;
+  for (std::vector<std::thread>::iterator reader = readers.begin(); reader != readers.end(); ++reader)
+  {
+    reader->join();
+  }
+
+  if (numberOfFailedWrites > 0)
+  {
+    LOG_ERROR("Failed to add " << numberOfFailedWrites << " items to the buffer");
+    numberOfErrors++;
+  }
+  long numberOfConsistentReads = 0;
+  for (int i = 0; i < NUMBER_OF_READERS; ++i)
+  {
+    if (results[i].NumberOfTornReads > 0)
+    {
+      LOG_ERROR("Reader " << i << " got " << results[i].NumberOfTornReads << " inconsistent UID and timestamp pairs");
+      numberOfErrors++;
+    }
+    numberOfConsistentReads += results[i].NumberOfConsistentReads;
+  }
+  if (numberOfConsistentReads == 0)
+  {
+    LOG_ERROR("The readers could not read any item while the buffer was written");
+    numberOfErrors++;
+  }
+
+  if (numberOfErrors > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfErrors << " errors");
+    return EXIT_FAILURE;
+  }
+  LOG_INFO("Lock-free read test completed successfully, " << numberOfConsistentReads << " consistent reads");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,232 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file ReplayClockTest.cxx
+  \brief Checks the flow control of PlusReplayClock.
+
+  First the turns of two producers and the acknowledgements of a consumer are checked step by step. Then a producer
+  and a slow consumer run in their own threads, as a saved data source and a virtual device do, and the consumer
+  must see every frame exactly once and in order, while the frames are produced faster than in real time.
+*/
+
+#include "PlusConfigure.h"
+#include "PlusNewDataEvent.h"
+#include "PlusReplayClock.h"
+#include "vtkIGSIOAccurateTimer.h"
+
+// VTK includes
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  int CheckTrue(const char* description, bool value)
+  {
+    if (!value)
+    {
+      LOG_ERROR("Check failed: " << description);
+      return 1;
+    }
+    return 0;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestTurns()
+  {
+    int numberOfErrors = 0;
+    PlusReplayClock& clock = PlusReplayClock::GetInstance();
+    int producerA = 0;
+    int producerB = 0;
+    int consumer = 0;
+    std::shared_ptr<PlusNewDataEvent> eventA = std::make_shared<PlusNewDataEvent>();
+    std::shared_ptr<PlusNewDataEvent> eventB = std::make_shared<PlusNewDataEvent>();
+    std::shared_ptr<PlusNewDataEvent> consumerEvent = std::make_shared<PlusNewDataEvent>();
+
+    unsigned long long generation = clock.GetGeneration();
+    clock.NotifyDataAdded();
+    numberOfErrors += CheckTrue("Data added while no producer is registered does not change the generation", clock.GetGeneration() == generation);
+
+    clock.AddProducer(&producerA, eventA);
+    clock.AddProducer(&producerB, eventB);
+    clock.AddConsumer(&consumer, consumerEvent);
+    numberOfErrors += CheckTrue("Clock is enabled by a producer", clock.IsEnabled());
+    numberOfErrors += CheckTrue("New consumer is woken up", consumerEvent->Wait(0));
+    clock.AcknowledgeGeneration(&consumer, clock.GetGeneration());
+
+    // Producer B has not reported its next frame yet, it goes first
+    numberOfErrors += CheckTrue("No turn before all producers report their next frame", !clock.RequestTurn(&producerA, 1.0));
+    numberOfErrors += CheckTrue("Waiting producer is woken up", eventB->Wait(0));
+    numberOfErrors += CheckTrue("No turn if another producer has an earlier frame", !clock.RequestTurn(&producerB, 2.0));
+    numberOfErrors += CheckTrue("Turn of the earliest frame", clock.RequestTurn(&producerA, 1.0));
+
+    // Producer A adds its frame
+    clock.NotifyDataAdded();
+    clock.CompleteTurn(&producerA, 1.0);
+    numberOfErrors += CheckTrue("Simulated time is the timestamp of the last frame", clock.GetTime() == 1.0);
+    numberOfErrors += CheckTrue("Consumer is woken up by new data", consumerEvent->Wait(0));
+    numberOfErrors += CheckTrue("Not settled until the consumer processes the data", !clock.IsSettled());
+    numberOfErrors += CheckTrue("No turn if another producer has an earlier frame", !clock.RequestTurn(&producerA, 4.0));
+    numberOfErrors += CheckTrue("No turn while the consumer processes the data", !clock.RequestTurn(&producerB, 2.0));
+
+    // The consumer processes the data in an update that started before more data was added
+    generation = clock.GetGeneration();
+    clock.NotifyDataAdded();
+    clock.AcknowledgeGeneration(&consumer, generation);
+    numberOfErrors += CheckTrue("Not settled if data was added during the update of the consumer", !clock.IsSettled());
+    clock.AcknowledgeGeneration(&consumer, clock.GetGeneration());
+    numberOfErrors += CheckTrue("Settled after the consumer processed all data", clock.IsSettled());
+    eventA->Wait(0);
+    eventB->Wait(0);
+
+    clock.SetPaused(true);
+    numberOfErrors += CheckTrue("No turn while paused", !clock.RequestTurn(&producerB, 2.0));
+    clock.SetPaused(false);
+    numberOfErrors += CheckTrue("Producers are woken up when resumed", eventB->Wait(0));
+    numberOfErrors += CheckTrue("Turn of the next earliest frame", clock.RequestTurn(&producerB, 2.0));
+    clock.CompleteTurn(&producerB, 2.0);
+
+    // Producer A waits for producer B until B is finished
+    numberOfErrors += CheckTrue("No turn if another producer has an earlier frame", !clock.RequestTurn(&producerA, 4.0));
+    clock.RequestTurn(&producerB, 3.0);
+    clock.SetProducerFinished(&producerB);
+    numberOfErrors += CheckTrue("Turn after the other producer finished", clock.RequestTurn(&producerA, 4.0));
+
+    clock.RemoveConsumer(&consumer);
+    clock.RemoveProducer(&producerA);
+    clock.RemoveProducer(&producerB);
+    numberOfErrors += CheckTrue("Clock is disabled when all producers are removed", !clock.IsEnabled());
+    return numberOfErrors;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestPipeline(int numberOfFrames)
+  {
+    // Frames are 1 second apart in the recording, processing one takes 1 ms
+    const double framePeriodSec = 1.0;
+    const double processingTimeSec = 0.001;
+    const double waitTimeoutSec = 0.1;
+
+    PlusReplayClock& clock = PlusReplayClock::GetInstance();
+    int producer = 0;
+    int consumer = 0;
+    std::shared_ptr<PlusNewDataEvent> producerEvent = std::make_shared<PlusNewDataEvent>();
+    std::shared_ptr<PlusNewDataEvent> consumerEvent = std::make_shared<PlusNewDataEvent>();
+    std::atomic<int> latestFrame(-1);
+    std::atomic<bool> stopRequested(false);
+    std::atomic<int> numberOfErrors(0);
+
+    clock.AddProducer(&producer, producerEvent);
+    clock.AddConsumer(&consumer, consumerEvent);
+    const double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+
+    std::thread consumerThread([&]()
+    {
+      int lastSeenFrame = -1;
+      while (!stopRequested)
+      {
+        consumerEvent->Wait(waitTimeoutSec);
+        unsigned long long generation = clock.GetGeneration();
+        int frame = latestFrame;
+        if (frame != lastSeenFrame)
+        {
+          if (frame != lastSeenFrame + 1)
+          {
+            LOG_ERROR("Consumer received frame " << frame << " after frame " << lastSeenFrame);
+            numberOfErrors++;
+          }
+          lastSeenFrame = frame;
+          vtkIGSIOAccurateTimer::Delay(processingTimeSec);
+        }
+        clock.AcknowledgeGeneration(&consumer, generation);
+      }
+    });
+
+    int nextFrame = 0;
+    while (nextFrame < numberOfFrames)
+    {
+      if (!clock.RequestTurn(&producer, nextFrame * framePeriodSec))
+      {
+        producerEvent->Wait(waitTimeoutSec);
+        continue;
+      }
+      latestFrame = nextFrame;
+      clock.NotifyDataAdded();
+      clock.CompleteTurn(&producer, nextFrame * framePeriodSec);
+      nextFrame++;
+    }
+    // Wait for the last frame to be processed
+    while (!clock.IsSettled())
+    {
+      producerEvent->Wait(waitTimeoutSec);
+    }
+    const double replayTimeSec = vtkIGSIOAccurateTimer::GetSystemTime() - startTime;
+
+    stopRequested = true;
+    consumerEvent->Signal();
+    consumerThread.join();
+    clock.RemoveConsumer(&consumer);
+    clock.RemoveProducer(&producer);
+
+    const double recordingTimeSec = numberOfFrames * framePeriodSec;
+    LOG_INFO("Replayed " << numberOfFrames << " frames of a " << recordingTimeSec << " s recording in " << replayTimeSec << " s");
+    if (replayTimeSec > recordingTimeSec / 10)
+    {
+      LOG_ERROR("Replay took " << replayTimeSec << " s, it is not faster than real time");
+      numberOfErrors++;
+    }
+    return numberOfErrors;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int numberOfFrames(200);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--frames", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfFrames, "Number of frames replayed through the pipeline (default: 200)");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  int numberOfErrors = 0;
+  numberOfErrors += TestTurns();
+  numberOfErrors += TestPipeline(numberOfFrames);
+
+  if (numberOfErrors > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfErrors << " errors");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
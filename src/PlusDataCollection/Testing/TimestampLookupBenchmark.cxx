@@ -0,0 +1,172 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file TimestampLookupBenchmark.cxx
+  \brief Measures the cost of looking up buffer items by timestamp as a function of the buffer size.
+
+  Tracker buffers are filled with items at a constant rate, then queried with sequential timestamps
+  (as when each tool buffer is queried at the timestamp of subsequent video frames) and with random timestamps.
+  All lookup results are verified, so the program can be run as a regression test.
+*/
+
+#include "PlusConfigure.h"
+#include "vtkIGSIOAccurateTimer.h"
+#include "vtkMatrix4x4.h"
+#include "vtkPlusBuffer.h"
+
+// VTK includes
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  PlusStatus FillBuffer(vtkPlusBuffer* buffer, int bufferSize, double frameRate)
+  {
+    vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    for (int i = 0; i < bufferSize; ++i)
+    {
+      double timestamp = 1.0 + i / frameRate;
+      if (buffer->AddTimeStampedItem(matrix, TOOL_OK, i, timestamp, timestamp) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to add item " << i << " to the buffer");
+        return PLUS_FAIL;
+      }
+    }
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  // Returns the average lookup time in microseconds, or a negative value if a lookup returned an incorrect result
+  double MeasureLookup(vtkPlusBuffer* buffer, int bufferSize, double frameRate, int numberOfLookups, bool sequential)
+  {
+    BufferItemUidType oldestUid = buffer->GetOldestItemUidInBuffer();
+    double oldestTimestamp = 1.0;
+    // Query times are offset by a quarter period from the item timestamps, so that the closest item is unambiguous
+    const double jitterSec = 0.25 / frameRate;
+
+    int numberOfErrors = 0;
+    double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+    for (int i = 0; i < numberOfLookups; ++i)
+    {
+      int expectedItem = 0;
+      if (sequential)
+      {
+        // Video frame rate is typically a fraction of the tracker rate: advance by a few items per query
+        expectedItem = (i * 7) % bufferSize;
+      }
+      else
+      {
+        expectedItem = rand() % bufferSize;
+      }
+      double time = oldestTimestamp + expectedItem / frameRate + ((i % 2) ? jitterSec : -jitterSec);
+
+      BufferItemUidType uid = 0;
+      ItemStatus status = buffer->GetItemUidFromTime(time, uid);
+      if (status != ITEM_OK && !(expectedItem == 0 && status == ITEM_NOT_AVAILABLE_ANYMORE)
+          && !(expectedItem == bufferSize - 1 && status == ITEM_NOT_AVAILABLE_YET))
+      {
+        numberOfErrors++;
+      }
+      else if (status == ITEM_OK && uid != oldestUid + expectedItem)
+      {
+        numberOfErrors++;
+      }
+    }
+    double elapsedTimeSec = vtkIGSIOAccurateTimer::GetSystemTime() - startTime;
+
+    if (numberOfErrors > 0)
+    {
+      LOG_ERROR("Incorrect lookup results: " << numberOfErrors << " out of " << numberOfLookups << " (buffer size: " << bufferSize << ")");
+      return -1.0;
+    }
+    return elapsedTimeSec * 1e6 / numberOfLookups;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int maxBufferSize(5000);
+  int numberOfLookups(100000);
+  double frameRate(300.0);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--max-buffer-size", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &maxBufferSize, "Largest buffer size to measure (Default: 5000).");
+  args.AddArgument("--number-of-lookups", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfLookups, "Number of lookups for each measurement (Default: 100000).");
+  args.AddArgument("--frame-rate", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &frameRate, "Rate of the items in the buffer, in Hz (Default: 300).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (maxBufferSize < 2 || numberOfLookups < 1 || frameRate <= 0)
+  {
+    LOG_ERROR("Invalid arguments: buffer size must be at least 2, number of lookups and frame rate must be positive");
+    return EXIT_FAILURE;
+  }
+
+  srand(0);
+  int numberOfErrors(0);
+
+  std::cout << "BufferSize  BufferType    Sequential[us]  Random[us]" << std::endl;
+  for (int bufferSize = 10; bufferSize <= maxBufferSize; bufferSize *= 2)
+  {
+    for (int lockFree = 0; lockFree < 2; ++lockFree)
+    {
+      vtkSmartPointer<vtkPlusBuffer> buffer = vtkSmartPointer<vtkPlusBuffer>::New();
+      buffer->SetBufferSize(bufferSize);
+      buffer->SetLockFreeReadEnabled(lockFree != 0);
+      if (FillBuffer(buffer, bufferSize, frameRate) != PLUS_SUCCESS)
+      {
+        numberOfErrors++;
+        continue;
+      }
+
+      double sequentialLookupUs = MeasureLookup(buffer, bufferSize, frameRate, numberOfLookups, true);
+      double randomLookupUs = MeasureLookup(buffer, bufferSize, frameRate, numberOfLookups, false);
+      if (sequentialLookupUs < 0 || randomLookupUs < 0)
+      {
+        numberOfErrors++;
+        continue;
+      }
+
+      std::cout << std::setw(10) << bufferSize << "  " << std::setw(12) << std::left << (lockFree ? "LockFreeRead" : "Locked") << std::right
+                << std::fixed << std::setprecision(4) << std::setw(16) << sequentialLookupUs << std::setw(12) << randomLookupUs << std::endl;
+    }
+  }
+
+  if (numberOfErrors > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfErrors << " errors");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,198 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file WritableFrameTest.cxx
+  \brief Checks that a frame that is being filled in place is protected from other writers until it is committed.
+
+  A full video buffer is filled, then a frame is acquired for in-place writing. Adding another frame while the writable
+  frame is not committed must fail without modifying the buffer. The writable frame is then committed and all items of
+  the buffer are compared to the frames that were written. Adding frames must work again after the commit and after
+  releasing a writable frame.
+*/
+
+#include "PlusConfigure.h"
+#include "vtkPlusBuffer.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+  const double FRAME_RATE = 100.0;
+  const unsigned int FRAME_WIDTH = 16;
+  const unsigned int FRAME_HEIGHT = 12;
+  const int BUFFER_SIZE = 3;
+
+  //----------------------------------------------------------------------------
+  double GetItemTimestamp(int frameNumber)
+  {
+    return 1.0 + frameNumber / FRAME_RATE;
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Pattern that identifies the frame */
+  void FillFrame(int frameNumber, unsigned char* pixels)
+  {
+    for (unsigned int i = 0; i < FRAME_WIDTH * FRAME_HEIGHT; ++i)
+    {
+      pixels[i] = static_cast<unsigned char>(frameNumber + i);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus AddFrame(vtkPlusBuffer* buffer, int frameNumber)
+  {
+    const FrameSizeType frameSize = { FRAME_WIDTH, FRAME_HEIGHT, 1 };
+    std::vector<unsigned char> pixels(FRAME_WIDTH * FRAME_HEIGHT);
+    FillFrame(frameNumber, &pixels[0]);
+    double timestamp = GetItemTimestamp(frameNumber);
+    return buffer->AddItem(&pixels[0], frameSize, static_cast<unsigned int>(pixels.size()), US_IMG_BRIGHTNESS, frameNumber, timestamp, timestamp);
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Compares the items of the buffer to the frames with the expected frame numbers, from the oldest to the latest */
+  int CheckFrames(vtkPlusBuffer* buffer, const std::vector<int>& expectedFrameNumbers, const char* caseName)
+  {
+    if (buffer->GetNumberOfItems() != static_cast<int>(expectedFrameNumbers.size()))
+    {
+      LOG_ERROR(caseName << ": buffer contains " << buffer->GetNumberOfItems() << " items instead of " << expectedFrameNumbers.size());
+      return 1;
+    }
+    int numberOfErrors = 0;
+    std::vector<unsigned char> expectedPixels(FRAME_WIDTH * FRAME_HEIGHT);
+    BufferItemUidType uid = buffer->GetOldestItemUidInBuffer();
+    for (std::vector<int>::const_iterator frameNumber = expectedFrameNumbers.begin(); frameNumber != expectedFrameNumbers.end(); ++frameNumber, ++uid)
+    {
+      StreamBufferItem item;
+      if (buffer->GetStreamBufferItem(uid, &item) != ITEM_OK)
+      {
+        LOG_ERROR(caseName << ": failed to get item " << uid << " from the buffer");
+        numberOfErrors++;
+        continue;
+      }
+      FillFrame(*frameNumber, &expectedPixels[0]);
+      vtkImageData* image = item.GetFrame().GetImage();
+      if (item.GetIndex() != static_cast<unsigned long>(*frameNumber) || image == NULL
+          || memcmp(image->GetScalarPointer(), &expectedPixels[0], expectedPixels.size()) != 0)
+      {
+        LOG_ERROR(caseName << ": item " << uid << " (frame " << item.GetIndex() << ") differs from frame " << *frameNumber);
+        numberOfErrors++;
+      }
+    }
+    return numberOfErrors;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  vtkSmartPointer<vtkPlusBuffer> buffer = vtkSmartPointer<vtkPlusBuffer>::New();
+  buffer->SetBufferSize(BUFFER_SIZE);
+  buffer->SetPixelType(VTK_UNSIGNED_CHAR);
+  buffer->SetNumberOfScalarComponents(1);
+  buffer->SetFrameSize(FRAME_WIDTH, FRAME_HEIGHT, 1);
+
+  int numberOfErrors = 0;
+
+  // Fill the buffer, so that the writable frame replaces the oldest item
+  for (int frameNumber = 0; frameNumber < BUFFER_SIZE; ++frameNumber)
+  {
+    if (AddFrame(buffer, frameNumber) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to add frame " << frameNumber << " to the buffer");
+      return EXIT_FAILURE;
+    }
+  }
+
+  igsioVideoFrame* frame = NULL;
+  if (buffer->AcquireWritableFrame(frame) != PLUS_SUCCESS || frame == NULL || frame->GetFrameSizeInBytes() != FRAME_WIDTH * FRAME_HEIGHT)
+  {
+    LOG_ERROR("Failed to acquire a writable frame");
+    return EXIT_FAILURE;
+  }
+  const int writableFrameNumber = 10;
+  FillFrame(writableFrameNumber, static_cast<unsigned char*>(frame->GetScalarPointer()));
+
+  // Another writer must not overwrite the reserved item. The rejected frame is reported as an error, which is expected here.
+  const BufferItemUidType latestUidBeforeAdd = buffer->GetLatestItemUidInBuffer();
+  if (AddFrame(buffer, BUFFER_SIZE) == PLUS_SUCCESS)
+  {
+    LOG_ERROR("A frame is added while another frame is reserved for writing");
+    numberOfErrors++;
+  }
+  if (buffer->GetLatestItemUidInBuffer() != latestUidBeforeAdd)
+  {
+    LOG_ERROR("The rejected frame changed the latest item of the buffer");
+    numberOfErrors++;
+  }
+  std::vector<int> expectedFrameNumbers;
+  expectedFrameNumbers.push_back(1);
+  expectedFrameNumbers.push_back(2);
+  numberOfErrors += CheckFrames(buffer, expectedFrameNumbers, "Reserved");
+
+  if (buffer->CommitWritableFrame(writableFrameNumber, GetItemTimestamp(writableFrameNumber), GetItemTimestamp(writableFrameNumber)) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to commit the writable frame");
+    return EXIT_FAILURE;
+  }
+  expectedFrameNumbers.push_back(writableFrameNumber);
+  numberOfErrors += CheckFrames(buffer, expectedFrameNumbers, "Committed");
+
+  // Adding frames works again after the commit and after releasing a writable frame
+  if (buffer->AcquireWritableFrame(frame) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to acquire a writable frame after the commit");
+    return EXIT_FAILURE;
+  }
+  buffer->ReleaseWritableFrame();
+  if (AddFrame(buffer, writableFrameNumber + 1) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to add a frame after releasing the writable frame");
+    numberOfErrors++;
+  }
+  expectedFrameNumbers.erase(expectedFrameNumbers.begin());
+  expectedFrameNumbers.push_back(writableFrameNumber + 1);
+  numberOfErrors += CheckFrames(buffer, expectedFrameNumbers, "Released");
+
+  if (numberOfErrors > 0)
+  {
+    LOG_ERROR("Number of failures: " << numberOfErrors);
+    return EXIT_FAILURE;
+  }
+  LOG_INFO("Writable frame test passed");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,232 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkDataCollectorReloadTest.cxx
+  \brief Checks that vtkPlusDataCollector::ReloadConfiguration only recreates the changed devices and their downstream devices.
+
+  Two simulated trackers are running, the output of the second one is used by a virtual mixer. Reloading the unchanged
+  configuration must keep all device instances and buffers. Changing the second tracker must recreate exactly that tracker
+  and the mixer, connected and recording, while the first tracker keeps running with the same buffer.
+*/
+
+#include "PlusConfigure.h"
+#include "vtkPlusBuffer.h"
+#include "vtkPlusDataCollector.h"
+#include "vtkPlusDataSource.h"
+#include "vtkPlusDevice.h"
+
+// VTK includes
+#include <vtkXMLDataElement.h>
+#include <vtkXMLUtilities.h>
+#include <vtksys/CommandLineArguments.hxx>
+#include <vtksys/SystemTools.hxx>
+
+// STL includes
+#include <algorithm>
+#include <cstdlib>
+
+namespace
+{
+  const char* DEVICE_SET_CONFIGURATION =
+    "<PlusConfiguration version=\"2.1\">"
+    "  <DataCollection StartupDelaySec=\"0.1\">"
+    "    <Device Id=\"TrackerA\" Type=\"FakeTracker\" AcquisitionRate=\"50\" Mode=\"ToolState\" ToolReferenceFrame=\"TrackerA\">"
+    "      <DataSources><DataSource Type=\"Tool\" Id=\"Test\" PortName=\"0\" /></DataSources>"
+    "      <OutputChannels><OutputChannel Id=\"TrackerAStream\"><DataSource Id=\"Test\" /></OutputChannel></OutputChannels>"
+    "    </Device>"
+    "    <Device Id=\"TrackerB\" Type=\"FakeTracker\" AcquisitionRate=\"50\" Mode=\"ToolState\" ToolReferenceFrame=\"TrackerB\">"
+    "      <DataSources><DataSource Type=\"Tool\" Id=\"Test\" PortName=\"0\" /></DataSources>"
+    "      <OutputChannels><OutputChannel Id=\"TrackerBStream\"><DataSource Id=\"Test\" /></OutputChannel></OutputChannels>"
+    "    </Device>"
+    "    <Device Id=\"MixerB\" Type=\"VirtualMixer\">"
+    "      <InputChannels><InputChannel Id=\"TrackerBStream\" /></InputChannels>"
+    "      <OutputChannels><OutputChannel Id=\"MixedStream\" /></OutputChannels>"
+    "    </Device>"
+    "  </DataCollection>"
+    "</PlusConfiguration>";
+
+  //----------------------------------------------------------------------------
+  vtkPlusBuffer* GetToolBuffer(vtkPlusDevice* device, const std::string& toolSourceId)
+  {
+    vtkPlusDataSource* tool = NULL;
+    if (device == NULL || device->GetTool(toolSourceId, tool) != PLUS_SUCCESS || tool == NULL)
+    {
+      return NULL;
+    }
+    return tool->GetBuffer();
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Returns the number of devices that are not connected or not recording */
+  int CheckDevicesRunning(vtkPlusDataCollector* dataCollector)
+  {
+    int numberOfErrors = 0;
+    DeviceCollection devices;
+    dataCollector->GetDevices(devices);
+    for (DeviceCollectionIterator it = devices.begin(); it != devices.end(); ++it)
+    {
+      if (!(*it)->GetConnected() || !(*it)->IsRecording())
+      {
+        LOG_ERROR("Device " << (*it)->GetDeviceId() << " is not connected and recording after reloading the configuration");
+        numberOfErrors++;
+      }
+    }
+    return numberOfErrors;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  vtkSmartPointer<vtkXMLDataElement> configRootElement = vtkSmartPointer<vtkXMLDataElement>::Take(vtkXMLUtilities::ReadElementFromString(DEVICE_SET_CONFIGURATION));
+  if (configRootElement == NULL)
+  {
+    LOG_ERROR("Unable to parse the device set configuration");
+    return EXIT_FAILURE;
+  }
+  vtkPlusConfig::GetInstance()->SetDeviceSetConfigurationData(configRootElement);
+
+  vtkSmartPointer<vtkPlusDataCollector> dataCollector = vtkSmartPointer<vtkPlusDataCollector>::New();
+  if (dataCollector->ReadConfiguration(configRootElement) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to configure the data collector");
+    return EXIT_FAILURE;
+  }
+  if (dataCollector->Connect() != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to connect to data collector!");
+    return EXIT_FAILURE;
+  }
+  if (dataCollector->Start() != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to start data collection");
+    return EXIT_FAILURE;
+  }
+  vtksys::SystemTools::Delay(500);
+
+  vtkPlusDevice* trackerA = NULL;
+  vtkPlusDevice* trackerB = NULL;
+  vtkPlusDevice* mixerB = NULL;
+  if (dataCollector->GetDevice(trackerA, "TrackerA") != PLUS_SUCCESS
+      || dataCollector->GetDevice(trackerB, "TrackerB") != PLUS_SUCCESS
+      || dataCollector->GetDevice(mixerB, "MixerB") != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to find the configured devices");
+    return EXIT_FAILURE;
+  }
+  vtkPlusBuffer* bufferA = GetToolBuffer(trackerA, "TestToTrackerA");
+  vtkPlusBuffer* bufferB = GetToolBuffer(trackerB, "TestToTrackerB");
+  if (bufferA == NULL || bufferB == NULL || bufferA->GetNumberOfItems() < 1)
+  {
+    LOG_ERROR("The trackers do not record into their tool buffers");
+    return EXIT_FAILURE;
+  }
+  const int numberOfItemsA = bufferA->GetNumberOfItems();
+
+  int numberOfErrors = 0;
+
+  // Reloading the unchanged configuration keeps every device and buffer
+  std::vector<std::string> recreatedDeviceIds;
+  vtkSmartPointer<vtkXMLDataElement> unchangedConfig = vtkSmartPointer<vtkXMLDataElement>::New();
+  unchangedConfig->DeepCopy(configRootElement);
+  if (dataCollector->ReloadConfiguration(unchangedConfig, &recreatedDeviceIds) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to reload the unchanged configuration");
+    return EXIT_FAILURE;
+  }
+  if (!recreatedDeviceIds.empty())
+  {
+    LOG_ERROR(recreatedDeviceIds.size() << " devices are recreated when reloading the unchanged configuration, expected none");
+    numberOfErrors++;
+  }
+  vtkPlusDevice* device = NULL;
+  if (dataCollector->GetDevice(device, "TrackerA") != PLUS_SUCCESS || device != trackerA
+      || dataCollector->GetDevice(device, "TrackerB") != PLUS_SUCCESS || device != trackerB
+      || dataCollector->GetDevice(device, "MixerB") != PLUS_SUCCESS || device != mixerB)
+  {
+    LOG_ERROR("Device instances are replaced when reloading the unchanged configuration");
+    return EXIT_FAILURE;
+  }
+  if (GetToolBuffer(trackerA, "TestToTrackerA") != bufferA || GetToolBuffer(trackerB, "TestToTrackerB") != bufferB)
+  {
+    LOG_ERROR("Tool buffers are replaced when reloading the unchanged configuration");
+    numberOfErrors++;
+  }
+  numberOfErrors += CheckDevicesRunning(dataCollector);
+
+  // Changing the second tracker recreates it and the mixer that uses its output, the first tracker keeps running
+  vtkSmartPointer<vtkXMLDataElement> changedConfig = vtkSmartPointer<vtkXMLDataElement>::New();
+  changedConfig->DeepCopy(configRootElement);
+  vtkXMLDataElement* trackerBElement = changedConfig->FindNestedElementWithName("DataCollection")->FindNestedElementWithNameAndAttribute("Device", "Id", "TrackerB");
+  trackerBElement->SetAttribute("AcquisitionRate", "25");
+  if (dataCollector->ReloadConfiguration(changedConfig, &recreatedDeviceIds) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to reload the changed configuration");
+    return EXIT_FAILURE;
+  }
+  std::sort(recreatedDeviceIds.begin(), recreatedDeviceIds.end());
+  if (recreatedDeviceIds.size() != 2 || recreatedDeviceIds[0] != "MixerB" || recreatedDeviceIds[1] != "TrackerB")
+  {
+    LOG_ERROR(recreatedDeviceIds.size() << " devices are recreated when changing TrackerB, expected TrackerB and MixerB");
+    numberOfErrors++;
+  }
+  if (dataCollector->GetDevice(device, "TrackerA") != PLUS_SUCCESS || device != trackerA)
+  {
+    LOG_ERROR("TrackerA is replaced although its configuration did not change");
+    return EXIT_FAILURE;
+  }
+  if (GetToolBuffer(trackerA, "TestToTrackerA") != bufferA || bufferA->GetNumberOfItems() < numberOfItemsA)
+  {
+    LOG_ERROR("The buffer of TrackerA is not kept when reloading the configuration");
+    numberOfErrors++;
+  }
+  if (dataCollector->GetDevice(device, "TrackerB") != PLUS_SUCCESS || device->GetAcquisitionRate() != 25.0)
+  {
+    LOG_ERROR("TrackerB does not use the changed configuration");
+    numberOfErrors++;
+  }
+  numberOfErrors += CheckDevicesRunning(dataCollector);
+
+  if (dataCollector->Stop() != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to stop data collection!");
+    numberOfErrors++;
+  }
+  dataCollector->Disconnect();
+
+  if (numberOfErrors > 0)
+  {
+    LOG_ERROR("Number of failures: " << numberOfErrors);
+    return EXIT_FAILURE;
+  }
+  LOG_INFO("Data collector configuration reload test passed");
+  return EXIT_SUCCESS;
+}
@@ -23,6 +23,7 @@
 #include "vtkIGSIOTrackedFrameList.h"
 
 // STD includes
+#include <cstring>
 #include <iostream>
 #include <stdlib.h>
 
@@ -123,6 +124,22 @@ int main ( int argc, char* argv[] )
     exit( EXIT_FAILURE );
   }
 
+  // The frame data in the mapped file must be the same as the converted frame
+  vtkSmartPointer<vtkPlusSonixVolumeReader> mappedVolume = vtkSmartPointer<vtkPlusSonixVolumeReader>::New();
+  if ( mappedVolume->Open( inputFileName.c_str() ) != PLUS_SUCCESS )
+  {
+    LOG_ERROR( "Failed to map sonix volume: " << inputFileName );
+    exit( EXIT_FAILURE );
+  }
+  const unsigned char* mappedFrameData = mappedVolume->GetFrameData( inputFrameNumberUint );
+  if ( mappedVolume->GetNumberOfFrames() != sonixVolumeData->GetNumberOfTrackedFrames() || mappedFrameData == NULL
+       || memcmp( mappedFrameData, videoFrame->GetScalarPointer(), mappedVolume->GetFrameSizeInBytes() ) != 0 )
+  {
+    LOG_ERROR( "Frame " << inputFrameNumberUint << " in the mapped sonix volume does not match the converted frame" );
+    exit( EXIT_FAILURE );
+  }
+  mappedVolume->Close();
+
   vtkSmartPointer<vtkImageExtractComponents> imageExtractorInput =  vtkSmartPointer<vtkImageExtractComponents>::New();
   imageExtractorInput->SetInputData( videoFrame->GetImage() );
   imageExtractorInput->SetComponents( 0, 0, 0 ); // we are using only the 0th component
@@ -0,0 +1,114 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file DiscoverDevices.cxx
+  \brief Find connected devices by probing supported device types in parallel and write a device set configuration skeleton.
+*/
+
+#include "PlusConfigure.h"
+#include "vtkPlusDeviceDiscovery.h"
+
+// VTK includes
+#include <vtkXMLDataElement.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <iomanip>
+
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+  double probeTimeoutSec = 5.0;
+  int maxSerialPort = 20;
+  std::vector<std::string> deviceTypes;
+  std::string outputConfigFileName;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+  args.AddArgument("--probe-timeout-sec", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &probeTimeoutSec, "Maximum time of probing a single device (default: 5)");
+  args.AddArgument("--max-serial-port", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &maxSerialPort, "Serial ports 1..N are probed for serial trackers (default: 20, 0 means serial ports are not probed)");
+  args.AddArgument("--device-types", vtksys::CommandLineArguments::MULTI_ARGUMENT, &deviceTypes, "Probe only the listed device types (default: all device types that can be detected). Device types that need a serial port are probed on all ports.");
+  args.AddArgument("--output-config-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &outputConfigFileName, "Write the found devices into this device set configuration file");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments." << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  vtkSmartPointer<vtkPlusDeviceDiscovery> discovery = vtkSmartPointer<vtkPlusDeviceDiscovery>::New();
+  discovery->SetProbeTimeoutSec(probeTimeoutSec);
+  discovery->AddDefaultCandidates(maxSerialPort);
+  if (!deviceTypes.empty())
+  {
+    // Keep only the requested device types, device types that are not detected by default are probed without a resource
+    std::vector<vtkPlusDeviceDiscovery::Candidate> defaultCandidates = discovery->GetCandidates();
+    discovery->ClearCandidates();
+    for (std::vector<std::string>::iterator typeIt = deviceTypes.begin(); typeIt != deviceTypes.end(); ++typeIt)
+    {
+      bool defaultCandidateFound = false;
+      for (std::vector<vtkPlusDeviceDiscovery::Candidate>::iterator candidateIt = defaultCandidates.begin(); candidateIt != defaultCandidates.end(); ++candidateIt)
+      {
+        if (candidateIt->DeviceType == *typeIt)
+        {
+          discovery->AddCandidate(*candidateIt);
+          defaultCandidateFound = true;
+        }
+      }
+      if (!defaultCandidateFound)
+      {
+        discovery->AddCandidate(vtkPlusDeviceDiscovery::Candidate(*typeIt));
+      }
+    }
+  }
+  if (discovery->GetNumberOfCandidates() == 0)
+  {
+    LOG_ERROR("There are no device types to probe");
+    exit(EXIT_FAILURE);
+  }
+
+  discovery->Discover();
+
+  const std::vector<vtkPlusDeviceDiscovery::ProbeResult>& results = discovery->GetResults();
+  std::cout << std::left << std::setw(28) << "Device type" << std::setw(16) << "Resource" << std::setw(12) << "Result" << "Time [s]" << std::endl;
+  for (std::vector<vtkPlusDeviceDiscovery::ProbeResult>::const_iterator it = results.begin(); it != results.end(); ++it)
+  {
+    if (it->Result == vtkPlusDeviceDiscovery::PROBE_NOT_FOUND && verboseLevel < vtkPlusLogger::LOG_LEVEL_DEBUG)
+    {
+      // Most candidates are not present, only list them if requested
+      continue;
+    }
+    std::cout << std::left << std::setw(28) << it->ProbedCandidate.DeviceType << std::setw(16) << it->ProbedCandidate.Resource
+              << std::setw(12) << vtkPlusDeviceDiscovery::GetProbeResultAsString(it->Result) << std::fixed << std::setprecision(2) << it->ElapsedTimeSec << std::endl;
+  }
+
+  if (!outputConfigFileName.empty())
+  {
+    vtkSmartPointer<vtkXMLDataElement> configRootElement = vtkSmartPointer<vtkXMLDataElement>::New();
+    if (discovery->GetConfigurationSkeleton(configRootElement) != PLUS_SUCCESS
+        || igsioCommon::XML::PrintXML(outputConfigFileName, configRootElement) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to write device set configuration file: " << outputConfigFileName);
+      exit(EXIT_FAILURE);
+    }
+    LOG_INFO("Device set configuration is written to " << outputConfigFileName);
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -5,11 +5,13 @@ See License.txt for details.
 =========================================================Plus=header=end*/
 
 #include "PlusConfigure.h"
+#include "PlusSequenceFrameCache.h"
+#include "PlusSequenceStreamReader.h"
 #include "igsioTrackedFrame.h"
-#include "vtkActorCollection.h"
+#include "vtkCamera.h"
 #include "vtkCallbackCommand.h"
-#include "vtkCollectionIterator.h"
 #include "vtkCommand.h"
+#include "vtkExtractVOI.h"
 #include "vtkImageActor.h"
 #include "vtkImageData.h"
 #include "vtkImageImport.h"
@@ -19,10 +21,8 @@ See License.txt for details.
 #include "vtkMatrix4x4.h"
 #include "vtkProp.h"
 #include "vtkRenderWindow.h"
-#include "vtkRenderWindow.h"
 #include "vtkRenderWindowInteractor.h"
 #include "vtkRenderer.h"
-#include "vtkRenderer.h"
 #include "vtkIGSIOSequenceIO.h"
 #include "vtkSmartPointer.h"
 #include "vtkTextActor.h"
@@ -33,7 +33,145 @@ See License.txt for details.
 #include "vtkIGSIOTransformRepository.h"
 #include "vtkXMLUtilities.h"
 #include "vtksys/CommandLineArguments.hxx"
+
+// STL includes
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <iomanip>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+///////////////////////////////////////////////////////////////////
+
+/*!
+  Creates downsampled images of evenly distributed frames of a sequence file in a background thread.
+  The thread reads the file with its own reader, so it does not interfere with reading the displayed frames.
+*/
+class ThumbnailGenerator
+{
+public:
+  struct Thumbnail
+  {
+    unsigned int Slot;
+    vtkSmartPointer<vtkImageData> Image;
+  };
+
+  ThumbnailGenerator()
+    : StopRequested(false)
+  {
+  }
+
+  ~ThumbnailGenerator()
+  {
+    this->Stop();
+  }
+
+  void Start(const std::string& sequenceFilename, unsigned int numberOfFrames, unsigned int numberOfThumbnails, int maximumWidthPixels)
+  {
+    this->Stop();
+    this->FrameIndices.clear();
+    if (numberOfFrames == 0 || numberOfThumbnails == 0)
+    {
+      return;
+    }
+    numberOfThumbnails = std::min(numberOfThumbnails, numberOfFrames);
+    for (unsigned int slot = 0; slot < numberOfThumbnails; ++slot)
+    {
+      this->FrameIndices.push_back(numberOfThumbnails > 1 ? static_cast<unsigned int>((static_cast<unsigned long long>(slot) * (numberOfFrames - 1)) / (numberOfThumbnails - 1)) : 0);
+    }
+    this->StopRequested = false;
+    this->Thread = std::thread(&ThumbnailGenerator::Run, this, sequenceFilename, maximumWidthPixels);
+  }
+
+  void Stop()
+  {
+    this->StopRequested = true;
+    if (this->Thread.joinable())
+    {
+      this->Thread.join();
+    }
+  }
+
+  /*! Index of the frame that is shown in each thumbnail slot */
+  const std::vector<unsigned int>& GetFrameIndices() const { return this->FrameIndices; }
+
+  /*! Move the thumbnails that have been generated since the last call to the output list */
+  void GetNewThumbnails(std::vector<Thumbnail>& thumbnails)
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    thumbnails.swap(this->NewThumbnails);
+    this->NewThumbnails.clear();
+  }
+
+protected:
+  void Run(std::string sequenceFilename, int maximumWidthPixels)
+  {
+    PlusSequenceStreamReader reader;
+    if (reader.Open(sequenceFilename) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to open " << sequenceFilename << " for generating thumbnails");
+      return;
+    }
+    for (unsigned int slot = 0; slot < this->FrameIndices.size() && !this->StopRequested; ++slot)
+    {
+      igsioTrackedFrame frame;
+      if (reader.ReadFrame(this->FrameIndices[slot], frame) != PLUS_SUCCESS || frame.GetImageData()->GetImage() == NULL)
+      {
+        continue;
+      }
+      vtkImageData* image = frame.GetImageData()->GetImage();
+      int* dimensions = image->GetDimensions();
+      int sampleRate = std::max(1, static_cast<int>(std::ceil(static_cast<double>(dimensions[0]) / maximumWidthPixels)));
+
+      // Only the first slice of volumetric frames is shown
+      vtkSmartPointer<vtkExtractVOI> subsampler = vtkSmartPointer<vtkExtractVOI>::New();
+      subsampler->SetInputData(image);
+      subsampler->SetVOI(0, dimensions[0] - 1, 0, dimensions[1] - 1, 0, 0);
+      subsampler->SetSampleRate(sampleRate, sampleRate, 1);
+      subsampler->Update();
+
+      Thumbnail thumbnail;
+      thumbnail.Slot = slot;
+      thumbnail.Image = vtkSmartPointer<vtkImageData>::New();
+      thumbnail.Image->DeepCopy(subsampler->GetOutput());
+      thumbnail.Image->SetOrigin(0, 0, 0);
+      thumbnail.Image->SetSpacing(1, 1, 1);
+
+      std::lock_guard<std::mutex> lock(this->Mutex);
+      this->NewThumbnails.push_back(thumbnail);
+    }
+  }
+
+  std::vector<unsigned int> FrameIndices;
+  std::thread Thread;
+  std::atomic<bool> StopRequested;
+  std::mutex Mutex;
+  std::vector<Thumbnail> NewThumbnails;
+};
+
+//----------------------------------------------------------------------------
+PlusStatus GetImageToReferenceTransform(igsioTrackedFrame* frame, vtkIGSIOTransformRepository* transformRepository,
+                                        const igsioTransformName& imageToReferenceTransformName, vtkMatrix4x4* imageToReferenceTransformMatrix)
+{
+  imageToReferenceTransformMatrix->Identity();
+  if (transformRepository->SetTransforms(*frame) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to set repository transforms from tracked frame!");
+    return PLUS_FAIL;
+  }
+  if (!imageToReferenceTransformName.IsValid())
+  {
+    return PLUS_SUCCESS;
+  }
+  if (transformRepository->GetTransform(imageToReferenceTransformName, imageToReferenceTransformMatrix) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to get transform from repository: " << imageToReferenceTransformName.GetTransformName());
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
 
 ///////////////////////////////////////////////////////////////////
 
@@ -45,94 +183,195 @@ public:
   void Initialize(vtkRenderWindow* renderWindow,
                   vtkRenderWindowInteractor* renderWindowInteractor,
                   vtkTextActor* textActor,
-                  vtkCollection* imageActors,
-                  std::vector<vtkTransform*>* imageTransforms)
+                  vtkImageActor* imageActor,
+                  PlusSequenceFrameCache* frameCache,
+                  vtkIGSIOTransformRepository* transformRepository,
+                  const igsioTransformName& imageToReferenceTransformName,
+                  vtkRenderer* thumbnailRenderer,
+                  ThumbnailGenerator* thumbnailGenerator,
+                  int thumbnailWidthPixels)
   {
     this->RenderWindow = renderWindow;
     this->RenderWindowInteractor = renderWindowInteractor;
     this->TextActor = textActor;
-    this->ImageActors = imageActors;
-    this->ImageTransforms = imageTransforms;
+    this->ImageActor = imageActor;
+    this->FrameCache = frameCache;
+    this->TransformRepository = transformRepository;
+    this->ImageToReferenceTransformName = imageToReferenceTransformName;
+    this->ThumbnailRenderer = thumbnailRenderer;
+    this->Thumbnails = thumbnailGenerator;
+    this->ThumbnailPitch = thumbnailWidthPixels * 1.1;
+  }
+
+  /*! Decode a frame (or get it from the cache) and show it */
+  void ShowFrame(int frameNum)
+  {
+    int numberOfFrames = static_cast<int>(this->FrameCache->GetNumberOfFrames());
+    if (numberOfFrames == 0)
+    {
+      return;
+    }
+    this->FrameNum = (frameNum % numberOfFrames + numberOfFrames) % numberOfFrames;
+
+    std::shared_ptr<igsioTrackedFrame> frame = this->FrameCache->GetFrame(this->FrameNum);
+    if (!frame)
+    {
+      LOG_ERROR("Failed to read frame " << this->FrameNum);
+      return;
+    }
+    // The actor keeps a reference to the image, so the image remains valid when the frame is released from the cache
+    this->ImageActor->SetInputData(frame->GetImageData()->GetImage());
+
+    vtkSmartPointer<vtkMatrix4x4> imageToReferenceTransformMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    GetImageToReferenceTransform(frame.get(), this->TransformRepository, this->ImageToReferenceTransformName, imageToReferenceTransformMatrix);
+    vtkSmartPointer<vtkTransform> imageToReferenceTransform = vtkSmartPointer<vtkTransform>::New();
+    imageToReferenceTransform->SetMatrix(imageToReferenceTransformMatrix);
+    this->ImageActor->SetUserTransform(imageToReferenceTransform);
+
+    double* position = imageToReferenceTransform->GetPosition();
+    std::ostringstream ss;
+    ss.precision(2);
+    ss << "Frame " << this->FrameNum << " / " << numberOfFrames - 1 << std::fixed << "  (" << frame->GetTimestamp() << " s)"
+       << "\nImage position: " << position[0] << "  " << position[1] << "  " << position[2] << std::ends;
+    this->TextActor->SetInput(ss.str().c_str());
   }
 
   virtual void Execute(vtkObject* caller, unsigned long callerEvent, void*)
   {
+    int frameJump = std::max(1, static_cast<int>(this->FrameCache->GetNumberOfFrames()) / 20);
     if (callerEvent == vtkCommand::CharEvent)
     {
       char keycode = this->RenderWindowInteractor->GetKeyCode();
       switch (keycode)
       {
         case '+':
-        {
-          if (++this->FrameNum >= this->ImageActors->GetNumberOfItems())
-          {
-            this->FrameNum = 0;
-          }
-
-          if (this->CurrentActor != NULL)
-          {
-            this->CurrentActor->VisibilityOff();
-            static_cast<vtkImageActor*>(this->ImageActors->GetItemAsObject(0))->VisibilityOn();
-          }
-
-          this->CurrentActor = static_cast<vtkImageActor*>(this->ImageActors->GetItemAsObject(this->FrameNum));
-          this->CurrentActor->VisibilityOn();
-        }
-        break;
+          this->ShowFrame(this->FrameNum + 1);
+          break;
         case '-':
-        {
-          if (--this->FrameNum < 0)
-          {
-            this->FrameNum = this->ImageActors->GetNumberOfItems() - 1;
-          }
-
-          if (this->CurrentActor != NULL)
-          {
-            this->CurrentActor->VisibilityOff();
-            static_cast<vtkImageActor*>(this->ImageActors->GetItemAsObject(0))->VisibilityOn();
-          }
-
-          this->CurrentActor = static_cast<vtkImageActor*>(this->ImageActors->GetItemAsObject(this->FrameNum));
-          this->CurrentActor->VisibilityOn();
-        }
-        break;
+          this->ShowFrame(this->FrameNum - 1);
+          break;
       }
     }
-
-    double* position = (*this->ImageTransforms)[this->FrameNum]->GetPosition();
-    std::ostringstream ss;
-    ss.precision(2);
-    ss << "Frame " << this->FrameNum << "\nImage position: " << std::fixed << position[0] << "  " << position[1] << "  " << position[2] << std::ends;
-    this->TextActor->SetInput(ss.str().c_str());
+    else if (callerEvent == vtkCommand::KeyPressEvent)
+    {
+      std::string keySym = this->RenderWindowInteractor->GetKeySym() ? this->RenderWindowInteractor->GetKeySym() : "";
+      if (keySym == "Next")
+      {
+        this->ShowFrame(std::min(this->FrameNum + frameJump, static_cast<int>(this->FrameCache->GetNumberOfFrames()) - 1));
+      }
+      else if (keySym == "Prior")
+      {
+        this->ShowFrame(std::max(this->FrameNum - frameJump, 0));
+      }
+      else if (keySym == "Home")
+      {
+        this->ShowFrame(0);
+      }
+      else if (keySym == "End")
+      {
+        this->ShowFrame(static_cast<int>(this->FrameCache->GetNumberOfFrames()) - 1);
+      }
+    }
+    else if (callerEvent == vtkCommand::LeftButtonPressEvent)
+    {
+      // Clicking on a thumbnail jumps to its frame, clicks elsewhere are processed by the interactor style
+      int* eventPosition = this->RenderWindowInteractor->GetEventPosition();
+      if (this->ThumbnailRenderer == NULL
+          || this->RenderWindowInteractor->FindPokedRenderer(eventPosition[0], eventPosition[1]) != this->ThumbnailRenderer)
+      {
+        return;
+      }
+      this->SetAbortFlag(1);
+      this->ThumbnailRenderer->SetDisplayPoint(eventPosition[0], eventPosition[1], 0);
+      this->ThumbnailRenderer->DisplayToWorld();
+      double* worldPoint = this->ThumbnailRenderer->GetWorldPoint();
+      double worldX = (worldPoint[3] != 0.0 ? worldPoint[0] / worldPoint[3] : worldPoint[0]);
+      const std::vector<unsigned int>& thumbnailFrameIndices = this->Thumbnails->GetFrameIndices();
+      int slot = static_cast<int>(std::floor(worldX / this->ThumbnailPitch));
+      if (slot < 0 || slot >= static_cast<int>(thumbnailFrameIndices.size()))
+      {
+        return;
+      }
+      this->ShowFrame(thumbnailFrameIndices[slot]);
+    }
+    else if (callerEvent == vtkCommand::TimerEvent)
+    {
+      this->AddNewThumbnails();
+      // Update the timer so it will trigger again
+      this->RenderWindowInteractor->CreateTimer(VTKI_TIMER_UPDATE);
+    }
 
     this->RenderWindow->Render();
-    // Update the timer so it will trigger again
-    this->RenderWindowInteractor->CreateTimer(VTKI_TIMER_UPDATE);
   }
 
 protected:
   vtkMyCallback()
   {
     this->FrameNum = 0;
-    this->CurrentActor = NULL;
     this->RenderWindow = NULL;
     this->RenderWindowInteractor = NULL;
     this->TextActor = NULL;
-    this->ImageActors = NULL;
-    this->ImageTransforms = NULL;
+    this->ImageActor = NULL;
+    this->FrameCache = NULL;
+    this->TransformRepository = NULL;
+    this->ThumbnailRenderer = NULL;
+    this->Thumbnails = NULL;
+    this->ThumbnailPitch = 1.0;
+    this->ThumbnailCameraInitialized = false;
   }
 
   virtual ~vtkMyCallback()
   {
   }
 
+  /*! Add the thumbnails that the background thread has generated to the thumbnail strip */
+  void AddNewThumbnails()
+  {
+    if (this->ThumbnailRenderer == NULL)
+    {
+      return;
+    }
+    std::vector<ThumbnailGenerator::Thumbnail> newThumbnails;
+    this->Thumbnails->GetNewThumbnails(newThumbnails);
+    for (std::vector<ThumbnailGenerator::Thumbnail>::iterator thumbnail = newThumbnails.begin(); thumbnail != newThumbnails.end(); ++thumbnail)
+    {
+      vtkSmartPointer<vtkImageActor> thumbnailActor = vtkSmartPointer<vtkImageActor>::New();
+      thumbnailActor->SetInputData(thumbnail->Image);
+      thumbnailActor->SetPosition(thumbnail->Slot * this->ThumbnailPitch, 0, 0);
+      this->ThumbnailRenderer->AddActor(thumbnailActor);
+
+      if (!this->ThumbnailCameraInitialized)
+      {
+        // Fit the whole strip into the viewport, so that the view does not change while the thumbnails are added
+        int* thumbnailDimensions = thumbnail->Image->GetDimensions();
+        double stripWidth = this->Thumbnails->GetFrameIndices().size() * this->ThumbnailPitch;
+        double stripHeight = thumbnailDimensions[1];
+        double aspect[2] = { 1.0, 1.0 };
+        this->ThumbnailRenderer->GetAspect(aspect);
+        vtkCamera* camera = this->ThumbnailRenderer->GetActiveCamera();
+        camera->ParallelProjectionOn();
+        camera->SetFocalPoint(stripWidth / 2, stripHeight / 2, 0);
+        camera->SetPosition(stripWidth / 2, stripHeight / 2, std::max(stripWidth, stripHeight));
+        camera->SetViewUp(0, 1, 0);
+        camera->SetParallelScale(std::max(stripHeight, stripWidth * aspect[1] / aspect[0]) / 2 * 1.05);
+        this->ThumbnailRenderer->ResetCameraClippingRange();
+        this->ThumbnailCameraInitialized = true;
+      }
+    }
+  }
+
   int FrameNum;
-  vtkImageActor* CurrentActor;
   vtkRenderWindow* RenderWindow;
   vtkRenderWindowInteractor* RenderWindowInteractor;
   vtkTextActor* TextActor;
-  vtkCollection* ImageActors;
-  std::vector<vtkTransform*>* ImageTransforms;
+  vtkImageActor* ImageActor;
+  PlusSequenceFrameCache* FrameCache;
+  vtkIGSIOTransformRepository* TransformRepository;
+  igsioTransformName ImageToReferenceTransformName;
+  vtkRenderer* ThumbnailRenderer;
+  ThumbnailGenerator* Thumbnails;
+  double ThumbnailPitch;
+  bool ThumbnailCameraInitialized;
 };
 
 int main(int argc, char** argv)
@@ -142,6 +381,9 @@ int main(int argc, char** argv)
   std::string inputConfigFileName;
   std::string outputModelFilename;
   std::string imageToReferenceTransformNameStr;
+  int frameCacheSize = 50;
+  int numberOfThumbnails = 20;
+  int thumbnailWidth = 128;
   bool renderingOff(false);
 
   int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
@@ -152,6 +394,9 @@ int main(int argc, char** argv)
   args.AddArgument("--image-to-reference-transform", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &imageToReferenceTransformNameStr, "Transform name used for displaying the slices");
   args.AddArgument("--source-seq-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputSequenceFilename, "Tracked ultrasound recorded by Plus (e.g., by the TrackedUltrasoundCapturing application) in a sequence file (.mha/.nrrd)");
   args.AddArgument("--config-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputConfigFileName, "Config file containing coordinate system definitions");
+  args.AddArgument("--frame-cache-size", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &frameCacheSize, "Number of decoded frames that are kept in memory (default: 50). Frames are read from the file when they are displayed.");
+  args.AddArgument("--thumbnail-count", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfThumbnails, "Number of thumbnails in the strip below the view, 0 hides the strip (default: 20). Click on a thumbnail to jump to its frame.");
+  args.AddArgument("--thumbnail-width", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &thumbnailWidth, "Maximum width of a thumbnail in pixels (default: 128).");
   args.AddArgument("--rendering-off", vtksys::CommandLineArguments::NO_ARGUMENT, &renderingOff, "Run in test mode, without rendering.");
   args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
   args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
@@ -179,29 +424,18 @@ int main(int argc, char** argv)
 
   ///////////////
 
-  vtkSmartPointer<vtkRenderWindow> renWin = vtkSmartPointer<vtkRenderWindow>::New();
-
-  vtkSmartPointer<vtkRenderer> renderer = vtkSmartPointer<vtkRenderer>::New();
-  renWin->AddRenderer(renderer);
-
-  // Create image actor collection
-  vtkSmartPointer<vtkCollection> imageActors = vtkSmartPointer<vtkCollection>::New();
-
-  //Create the inter actor that handles the event loop
-  vtkSmartPointer<vtkRenderWindowInteractor> renderWindowInteractor = vtkSmartPointer<vtkRenderWindowInteractor>::New();
-  renderWindowInteractor->SetRenderWindow(renWin);
-
-  // Read input tracked ultrasound data.
-  LOG_DEBUG("Reading input... ");
-  vtkSmartPointer< vtkIGSIOTrackedFrameList > trackedFrameList = vtkSmartPointer< vtkIGSIOTrackedFrameList >::New();
-  // Orientation is XX so that the orientation of the trackedFrameList will match the orientation defined in the file
-  if (vtkIGSIOSequenceIO::Read(inputSequenceFilename, trackedFrameList) != PLUS_SUCCESS)
+  // Open input tracked ultrasound data. Frames are decoded when they are displayed.
+  LOG_DEBUG("Opening input... ");
+  PlusSequenceFrameCache frameCache;
+  frameCache.SetMaximumNumberOfFrames(static_cast<unsigned int>(std::max(frameCacheSize, 1)));
+  if (frameCache.Open(inputSequenceFilename) != PLUS_SUCCESS)
   {
     LOG_ERROR("Unable to load input sequences file.");
     return EXIT_FAILURE;
   }
-  LOG_DEBUG("Reading input done.");
-  LOG_DEBUG("Number of frames: " << trackedFrameList->GetNumberOfTrackedFrames());
+  int numberOfFrames = frameCache.GetNumberOfFrames();
+  LOG_DEBUG("Opening input done.");
+  LOG_DEBUG("Number of frames: " << numberOfFrames);
 
   // Read calibration matrices from the config file
   vtkSmartPointer<vtkIGSIOTransformRepository> transformRepository = vtkSmartPointer<vtkIGSIOTransformRepository>::New();
@@ -225,10 +459,6 @@ int main(int argc, char** argv)
     LOG_INFO("Configuration file is not specified. Only those transforms are available that are defined in the sequence metafile");
   }
 
-  LOG_INFO("Adding frames to actors...");
-
-  std::vector<vtkTransform*> imageTransforms;
-
   igsioTransformName imageToReferenceTransformName;
   if (!imageToReferenceTransformNameStr.empty())
   {
@@ -240,61 +470,55 @@ int main(int argc, char** argv)
     }
   }
 
-  int numberOfFrames = trackedFrameList->GetNumberOfTrackedFrames();
-  for (int frameIndex = 0; frameIndex < numberOfFrames; frameIndex++)
+  if (renderingOff)
   {
-    vtkPlusLogger::PrintProgressbar((100.0 * frameIndex) / numberOfFrames);
-    igsioTrackedFrame* frame = trackedFrameList->GetTrackedFrame(frameIndex);
-
-    // Update transform repository
-    if (transformRepository->SetTransforms(*frame) != PLUS_SUCCESS)
+    // Decode all frames once to verify that they can be displayed
+    LOG_INFO("Reading frames...");
+    vtkSmartPointer<vtkMatrix4x4> imageToReferenceTransformMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    for (int frameIndex = 0; frameIndex < numberOfFrames; frameIndex++)
     {
-      LOG_ERROR("Failed to set repository transforms from tracked frame!");
-      continue;
-    }
-
-    vtkSmartPointer<vtkImageData> frameImageData = vtkSmartPointer<vtkImageData>::New();
-    frameImageData->DeepCopy(frame->GetImageData()->GetImage());
-
-    vtkSmartPointer<vtkImageActor> imageActor = vtkSmartPointer<vtkImageActor>::New();
-    imageActor->SetInputData(frameImageData);
-
-    vtkSmartPointer< vtkTransform > imageToReferenceTransform = vtkSmartPointer< vtkTransform >::New();
-    if (imageToReferenceTransformName.IsValid())
-    {
-      vtkSmartPointer<vtkMatrix4x4> imageToReferenceTransformMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
-      if (transformRepository->GetTransform(imageToReferenceTransformName, imageToReferenceTransformMatrix) != PLUS_SUCCESS)
+      vtkPlusLogger::PrintProgressbar((100.0 * frameIndex) / numberOfFrames);
+      std::shared_ptr<igsioTrackedFrame> frame = frameCache.GetFrame(frameIndex);
+      if (!frame)
       {
-        std::string strTransformName;
-        imageToReferenceTransformName.GetTransformName(strTransformName);
-        LOG_ERROR("Failed to get transform from repository: " << strTransformName);
+        LOG_ERROR("Failed to read frame " << frameIndex);
         continue;
       }
-      imageToReferenceTransform->SetMatrix(imageToReferenceTransformMatrix);
+      GetImageToReferenceTransform(frame.get(), transformRepository, imageToReferenceTransformName, imageToReferenceTransformMatrix);
     }
-
-    imageActor->SetUserTransform(imageToReferenceTransform);
-    imageActor->VisibilityOff();
-    imageTransforms.push_back(imageToReferenceTransform);
-    imageActors->AddItem(imageActor);
-  }
-
-  vtkPlusLogger::PrintProgressbar(100);
-  std::cout << std::endl;
-
-  for (int i = 0; i < imageActors->GetNumberOfItems(); i++)
-  {
-    vtkImageActor* imgActor = static_cast<vtkImageActor*>(imageActors->GetItemAsObject(i));
-    imgActor->SetVisibility(i == 0); // hide all frames but the first one
-    renderer->AddActor(imgActor);
-  }
-
-  if (renderingOff)
-  {
+    vtkPlusLogger::PrintProgressbar(100);
+    std::cout << std::endl;
     LOG_INFO("No need for rendering...");
   }
   else
   {
+    vtkSmartPointer<vtkRenderWindow> renWin = vtkSmartPointer<vtkRenderWindow>::New();
+
+    vtkSmartPointer<vtkRenderer> renderer = vtkSmartPointer<vtkRenderer>::New();
+    renWin->AddRenderer(renderer);
+
+    //Create the inter actor that handles the event loop
+    vtkSmartPointer<vtkRenderWindowInteractor> renderWindowInteractor = vtkSmartPointer<vtkRenderWindowInteractor>::New();
+    renderWindowInteractor->SetRenderWindow(renWin);
+
+    // Thumbnail strip below the 3D view
+    ThumbnailGenerator thumbnailGenerator;
+    vtkSmartPointer<vtkRenderer> thumbnailRenderer;
+    if (numberOfThumbnails > 0 && numberOfFrames > 0)
+    {
+      const double thumbnailStripHeight = 0.15;
+      renderer->SetViewport(0, thumbnailStripHeight, 1, 1);
+      thumbnailRenderer = vtkSmartPointer<vtkRenderer>::New();
+      thumbnailRenderer->SetViewport(0, 0, 1, thumbnailStripHeight);
+      thumbnailRenderer->SetBackground(0.05, 0.1, 0.2);
+      thumbnailRenderer->InteractiveOff();
+      renWin->AddRenderer(thumbnailRenderer);
+      thumbnailGenerator.Start(inputSequenceFilename, numberOfFrames, numberOfThumbnails, std::max(thumbnailWidth, 1));
+    }
+
+    vtkSmartPointer<vtkImageActor> imageActor = vtkSmartPointer<vtkImageActor>::New();
+    renderer->AddActor(imageActor);
+
     // Create a text actor for image position information
     vtkSmartPointer<vtkTextActor> textActor = vtkSmartPointer<vtkTextActor>::New();
     vtkSmartPointer<vtkTextProperty> textprop = textActor->GetTextProperty();
@@ -311,18 +535,27 @@ int main(int argc, char** argv)
 
     renderer->SetBackground(0.1, 0.2, 0.4);
     renWin->SetSize(800, 600);
-    renWin->Render();
 
     //establish timer event and create timer
     vtkSmartPointer<vtkMyCallback> call = vtkSmartPointer<vtkMyCallback>::New();
-    call->Initialize(renWin, renderWindowInteractor, textActor, imageActors, &imageTransforms);
+    call->Initialize(renWin, renderWindowInteractor, textActor, imageActor, &frameCache, transformRepository, imageToReferenceTransformName,
+                     thumbnailRenderer, &thumbnailGenerator, std::max(thumbnailWidth, 1));
+    call->ShowFrame(0);
+    renderer->ResetCamera();
+    renWin->Render();
+
     renderWindowInteractor->AddObserver(vtkCommand::TimerEvent, call);
     renderWindowInteractor->AddObserver(vtkCommand::CharEvent, call);
+    renderWindowInteractor->AddObserver(vtkCommand::KeyPressEvent, call);
+    // Higher priority than the interactor style, so that clicks on the thumbnails do not rotate the view
+    renderWindowInteractor->AddObserver(vtkCommand::LeftButtonPressEvent, call, 1.0);
     renderWindowInteractor->CreateTimer(VTKI_TIMER_FIRST);    //VTKI_TIMER_FIRST = 0
 
     //iren must be initialized so that it can handle events
     renderWindowInteractor->Initialize();
     renderWindowInteractor->Start();
+
+    thumbnailGenerator.Stop();
   }
 
   std::cout << "MetaImageSequenceViewer completed successfully!" << std::endl;
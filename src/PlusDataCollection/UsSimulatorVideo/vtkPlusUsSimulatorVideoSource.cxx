@@ -5,6 +5,7 @@
 =========================================================Plus=header=end*/
 
 #include "PlusConfigure.h"
+#include "PlusWorkerPool.h"
 #include "vtkImageData.h"
 #include "vtkObjectFactory.h"
 #include "vtkIGSIOTrackedFrameList.h"
@@ -31,6 +32,7 @@ vtkPlusUsSimulatorVideoSource::vtkPlusUsSimulatorVideoSource()
   // Create transform repository
   vtkSmartPointer<vtkIGSIOTransformRepository> transformRepository = vtkSmartPointer<vtkIGSIOTransformRepository>::New();
   this->GetUsSimulator()->SetTransformRepository(transformRepository);
+  this->UsSimulators.push_back(usSimulator);
 
   this->RequireImageOrientationInConfiguration = true;
 
@@ -46,6 +48,7 @@ vtkPlusUsSimulatorVideoSource::~vtkPlusUsSimulatorVideoSource()
     this->Disconnect();
   }
 
+  this->UsSimulators.clear();
   this->SetUsSimulator(NULL);
 }
 
@@ -55,6 +58,23 @@ void vtkPlusUsSimulatorVideoSource::PrintSelf(ostream& os, vtkIndent indent)
   this->Superclass::PrintSelf(os, indent);
 }
 
+//----------------------------------------------------------------------------
+int vtkPlusUsSimulatorVideoSource::GetNumberOfUsSimulators() const
+{
+  return static_cast<int>(this->UsSimulators.size());
+}
+
+//----------------------------------------------------------------------------
+vtkPlusUsSimulatorAlgo* vtkPlusUsSimulatorVideoSource::GetUsSimulator(int simulatorIndex)
+{
+  if (simulatorIndex < 0 || simulatorIndex >= static_cast<int>(this->UsSimulators.size()))
+  {
+    LOG_ERROR("Invalid US simulator index: " << simulatorIndex << ". Number of simulators: " << this->UsSimulators.size());
+    return NULL;
+  }
+  return this->UsSimulators[simulatorIndex];
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusUsSimulatorVideoSource::InternalUpdate()
 {
@@ -127,26 +147,43 @@ PlusStatus vtkPlusUsSimulatorVideoSource::InternalUpdate()
   // For simplicity, we increase it always by 1.
   this->FrameNumber++;
 
-  if (this->UsSimulator->GetTransformRepository()->SetTransforms(*trackedFrame) != PLUS_SUCCESS)
+  for (std::vector< vtkSmartPointer<vtkPlusUsSimulatorAlgo> >::iterator simulatorIt = this->UsSimulators.begin(); simulatorIt != this->UsSimulators.end(); ++simulatorIt)
   {
-    LOG_ERROR("Failed to set repository transforms from tracked frame!");
-    return PLUS_FAIL;
+    if ((*simulatorIt)->GetTransformRepository()->SetTransforms(*trackedFrame) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to set repository transforms from tracked frame!");
+      return PLUS_FAIL;
+    }
+    (*simulatorIt)->Modified(); // Signal that the transforms have changed so we need to recompute
   }
 
-  // Get the simulated US image
-  this->UsSimulator->Modified(); // Signal that the transforms have changed so we need to recompute
-  this->UsSimulator->Update();
+  // Get the simulated US images, the probes are simulated in parallel
+  int numberOfSimulators = static_cast<int>(this->UsSimulators.size());
+  PlusWorkerPool::GetInstance().ParallelFor(0, numberOfSimulators, numberOfSimulators, [this](int firstSimulatorIndex, int lastSimulatorIndex)
+  {
+    for (int simulatorIndex = firstSimulatorIndex; simulatorIndex < lastSimulatorIndex; simulatorIndex++)
+    {
+      this->UsSimulators[simulatorIndex]->Update();
+    }
+  });
 
-  vtkPlusDataSource* aSource(NULL);
-  if (outputChannel->GetVideoSource(aSource) != PLUS_SUCCESS)
+  PlusStatus status = PLUS_SUCCESS;
+  for (int simulatorIndex = 0; simulatorIndex < numberOfSimulators; simulatorIndex++)
   {
-    LOG_ERROR("Unable to retrieve the video source in the USSimulator device.");
-    return PLUS_FAIL;
-  }
+    vtkPlusDataSource* aSource(NULL);
+    if (this->OutputChannels[simulatorIndex]->GetVideoSource(aSource) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Unable to retrieve the video source in the USSimulator device.");
+      return PLUS_FAIL;
+    }
 
-  LOG_DEBUG("Simulated frame " << this->FrameNumber << " generated.");
-  PlusStatus status = aSource->AddItem(
-                        this->UsSimulator->GetOutput(), aSource->GetInputImageOrientation(), US_IMG_BRIGHTNESS, this->FrameNumber, latestTrackerTimestamp, latestTrackerTimestamp);
+    LOG_DEBUG("Simulated frame " << this->FrameNumber << " generated.");
+    if (aSource->AddItem(this->UsSimulators[simulatorIndex]->GetOutput(), aSource->GetInputImageOrientation(), US_IMG_BRIGHTNESS,
+                         this->FrameNumber, latestTrackerTimestamp, latestTrackerTimestamp) != PLUS_SUCCESS)
+    {
+      status = PLUS_FAIL;
+    }
+  }
 
   this->Modified();
   return status;
@@ -157,30 +194,32 @@ PlusStatus vtkPlusUsSimulatorVideoSource::InternalConnect()
 {
   LOG_TRACE("vtkPlusUsSimulatorVideoSource::InternalConnect");
 
-  if (this->OutputChannels.empty())
+  if (this->OutputChannels.size() < this->UsSimulators.size())
   {
-    LOG_ERROR("No output channels defined");
+    LOG_ERROR("Not enough output channels defined, " << this->UsSimulators.size() << " probes are simulated");
     return PLUS_FAIL;
   }
-  vtkPlusChannel* outputChannel = this->OutputChannels[0];
 
-  vtkPlusDataSource* aSource(NULL);
-  if (outputChannel->GetVideoSource(aSource) != PLUS_SUCCESS)
+  for (unsigned int simulatorIndex = 0; simulatorIndex < this->UsSimulators.size(); simulatorIndex++)
   {
-    LOG_ERROR("Unable to retrieve the video source in the USSimulator device.");
-    return PLUS_FAIL;
-  }
+    vtkPlusDataSource* aSource(NULL);
+    if (this->OutputChannels[simulatorIndex]->GetVideoSource(aSource) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Unable to retrieve the video source in the USSimulator device.");
+      return PLUS_FAIL;
+    }
 
-  // Set to default MF output image orientation
-  aSource->SetOutputImageOrientation(US_IMG_ORIENT_MF);
-  aSource->Clear();
-  FrameSizeType frameSize = {0, 0, 1};
-  if (this->UsSimulator->GetFrameSize(frameSize) != PLUS_SUCCESS)
-  {
-    LOG_ERROR("Failed to initialize buffer, frame size is unknown");
-    return PLUS_FAIL;
+    // Set to default MF output image orientation
+    aSource->SetOutputImageOrientation(US_IMG_ORIENT_MF);
+    aSource->Clear();
+    FrameSizeType frameSize = {0, 0, 1};
+    if (this->UsSimulators[simulatorIndex]->GetFrameSize(frameSize) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to initialize buffer, frame size is unknown");
+      return PLUS_FAIL;
+    }
+    aSource->SetInputFrameSize(frameSize);
   }
-  aSource->SetInputFrameSize(frameSize);
 
   this->LastProcessedTrackingDataTimestamp = 0;
 
@@ -215,20 +254,58 @@ PlusStatus vtkPlusUsSimulatorVideoSource::ReadConfiguration(vtkXMLDataElement* r
     return PLUS_FAIL;
   }
 
+  // Additional vtkPlusUsSimulatorAlgo elements define the simulators of additional probes
+  this->UsSimulators.resize(1);
+  bool firstSimulatorElement = true;
+  for (int i = 0; i < deviceConfig->GetNumberOfNestedElements(); ++i)
+  {
+    vtkXMLDataElement* simulatorElement = deviceConfig->GetNestedElement(i);
+    if (STRCASECMP(simulatorElement->GetName(), "vtkPlusUsSimulatorAlgo") != 0)
+    {
+      continue;
+    }
+    if (firstSimulatorElement)
+    {
+      // already read by UsSimulator
+      firstSimulatorElement = false;
+      continue;
+    }
+
+    // The simulator reads the first vtkPlusUsSimulatorAlgo element, so give it a device element that only contains a copy of this one
+    vtkSmartPointer<vtkXMLDataElement> simulatorElementCopy = vtkSmartPointer<vtkXMLDataElement>::New();
+    simulatorElementCopy->DeepCopy(simulatorElement);
+    vtkSmartPointer<vtkXMLDataElement> probeDeviceConfig = vtkSmartPointer<vtkXMLDataElement>::New();
+    probeDeviceConfig->SetName(deviceConfig->GetName());
+    probeDeviceConfig->AddNestedElement(simulatorElementCopy);
+
+    vtkSmartPointer<vtkPlusUsSimulatorAlgo> usSimulator = vtkSmartPointer<vtkPlusUsSimulatorAlgo>::New();
+    vtkSmartPointer<vtkIGSIOTransformRepository> transformRepository = vtkSmartPointer<vtkIGSIOTransformRepository>::New();
+    usSimulator->SetTransformRepository(transformRepository);
+    if (usSimulator->ReadConfiguration(probeDeviceConfig) != PLUS_SUCCESS
+        || transformRepository->ReadConfiguration(rootConfigElement) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to read configuration of US simulator " << this->UsSimulators.size() << "!");
+      return PLUS_FAIL;
+    }
+    this->UsSimulators.push_back(usSimulator);
+  }
+
   return PLUS_SUCCESS;
 }
 
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusUsSimulatorVideoSource::NotifyConfigured()
 {
-  if (this->OutputChannels.size() > 1)
+  if (this->OutputChannels.size() > this->UsSimulators.size())
   {
-    LOG_WARNING("vtkPlusUsSimulatorVideoSource is expecting one output channel and there are " << this->OutputChannels.size() << " channels. First output channel will be used.");
+    LOG_WARNING("vtkPlusUsSimulatorVideoSource is expecting " << this->UsSimulators.size() << " output channels (one for each simulated probe) and there are "
+                << this->OutputChannels.size() << " channels. First " << this->UsSimulators.size() << " output channels will be used.");
   }
 
-  if (this->OutputChannels.empty())
+  if (this->OutputChannels.size() < this->UsSimulators.size())
   {
-    LOG_ERROR("No output channels defined for vtkPlusUsSimulatorVideoSource. Cannot proceed.");
+    LOG_ERROR("Not enough output channels defined for vtkPlusUsSimulatorVideoSource: " << this->UsSimulators.size() << " probes are simulated and there are "
+              << this->OutputChannels.size() << " channels. Cannot proceed.");
     this->SetCorrectlyConfigured(false);
     return PLUS_FAIL;
   }
@@ -242,36 +319,48 @@ PlusStatus vtkPlusUsSimulatorVideoSource::InternalApplyImagingParameterChange()
   if ( this->ImagingParameters->IsSet(vtkPlusUsImagingParameters::KEY_DEPTH)
        && this->ImagingParameters->IsPending(vtkPlusUsImagingParameters::KEY_DEPTH) )
   {
-    vtkPlusUsScanConvert* scanConverter = this->UsSimulator->GetRfProcessor()->GetScanConverter();
-    vtkPlusUsScanConvertLinear* linearScanConverter = vtkPlusUsScanConvertLinear::SafeDownCast(scanConverter);
-    vtkPlusUsScanConvertCurvilinear* curvilinearScanConverter = vtkPlusUsScanConvertCurvilinear::SafeDownCast(scanConverter);
-    if (linearScanConverter)
-    {
-      linearScanConverter->SetImagingDepthMm(this->ImagingParameters->GetDepthMm());
-    }
-    else if (curvilinearScanConverter)
+    for (std::vector< vtkSmartPointer<vtkPlusUsSimulatorAlgo> >::iterator simulatorIt = this->UsSimulators.begin(); simulatorIt != this->UsSimulators.end(); ++simulatorIt)
     {
-      curvilinearScanConverter->SetRadiusStopMm(
-        curvilinearScanConverter->GetRadiusStartMm() + this->ImagingParameters->GetDepthMm() );
+      vtkPlusUsScanConvert* scanConverter = (*simulatorIt)->GetRfProcessor()->GetScanConverter();
+      vtkPlusUsScanConvertLinear* linearScanConverter = vtkPlusUsScanConvertLinear::SafeDownCast(scanConverter);
+      vtkPlusUsScanConvertCurvilinear* curvilinearScanConverter = vtkPlusUsScanConvertCurvilinear::SafeDownCast(scanConverter);
+      if (linearScanConverter)
+      {
+        linearScanConverter->SetImagingDepthMm(this->ImagingParameters->GetDepthMm());
+      }
+      else if (curvilinearScanConverter)
+      {
+        curvilinearScanConverter->SetRadiusStopMm(
+          curvilinearScanConverter->GetRadiusStartMm() + this->ImagingParameters->GetDepthMm() );
+      }
     }
     this->ImagingParameters->SetPending(vtkPlusUsImagingParameters::KEY_DEPTH, false);
   }
   if ( this->ImagingParameters->IsSet(vtkPlusUsImagingParameters::KEY_FREQUENCY)
        && this->ImagingParameters->IsPending(vtkPlusUsImagingParameters::KEY_FREQUENCY) )
   {
-    this->UsSimulator->SetFrequencyMhz(this->ImagingParameters->GetFrequencyMhz());
+    for (std::vector< vtkSmartPointer<vtkPlusUsSimulatorAlgo> >::iterator simulatorIt = this->UsSimulators.begin(); simulatorIt != this->UsSimulators.end(); ++simulatorIt)
+    {
+      (*simulatorIt)->SetFrequencyMhz(this->ImagingParameters->GetFrequencyMhz());
+    }
     this->ImagingParameters->SetPending(vtkPlusUsImagingParameters::KEY_FREQUENCY, false);
   }
   if ( this->ImagingParameters->IsSet(vtkPlusUsImagingParameters::KEY_INTENSITY)
        && this->ImagingParameters->IsPending(vtkPlusUsImagingParameters::KEY_INTENSITY) )
   {
-    this->UsSimulator->SetIncomingIntensityMwPerCm2(this->ImagingParameters->GetIntensity());
+    for (std::vector< vtkSmartPointer<vtkPlusUsSimulatorAlgo> >::iterator simulatorIt = this->UsSimulators.begin(); simulatorIt != this->UsSimulators.end(); ++simulatorIt)
+    {
+      (*simulatorIt)->SetIncomingIntensityMwPerCm2(this->ImagingParameters->GetIntensity());
+    }
     this->ImagingParameters->SetPending(vtkPlusUsImagingParameters::KEY_INTENSITY, false);
   }
   if ( this->ImagingParameters->IsSet(vtkPlusUsImagingParameters::KEY_CONTRAST)
        && this->ImagingParameters->IsPending(vtkPlusUsImagingParameters::KEY_CONTRAST) )
   {
-    this->UsSimulator->SetBrightnessConversionGamma(this->ImagingParameters->GetContrast());
+    for (std::vector< vtkSmartPointer<vtkPlusUsSimulatorAlgo> >::iterator simulatorIt = this->UsSimulators.begin(); simulatorIt != this->UsSimulators.end(); ++simulatorIt)
+    {
+      (*simulatorIt)->SetBrightnessConversionGamma(this->ImagingParameters->GetContrast());
+    }
     this->ImagingParameters->SetPending(vtkPlusUsImagingParameters::KEY_CONTRAST, false);
   }
 
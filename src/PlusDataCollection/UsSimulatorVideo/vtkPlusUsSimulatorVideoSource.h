@@ -12,6 +12,8 @@
 #include "vtkPlusUsDevice.h"
 #include "vtkPlusUsSimulatorAlgo.h"
 
+#include <vector>
+
 class vtkPlusDataBuffer;
 
 class vtkPlusDataCollectionExport vtkPlusUsSimulatorVideoSource;
@@ -19,6 +21,10 @@ class vtkPlusDataCollectionExport vtkPlusUsSimulatorVideoSource;
 /*!
   \class vtkPlusUsSimulatorVideoSource
   \brief Class for providing VTK video input interface from simulated ultrasound
+
+  Multiple probes can be simulated by one device: the i-th vtkPlusUsSimulatorAlgo element of the device configuration
+  defines the simulator of the i-th output channel. Images of all the probes are simulated in parallel.
+
   \ingroup PlusLibDataCollection
 */
 class vtkPlusDataCollectionExport vtkPlusUsSimulatorVideoSource : public vtkPlusUsDevice
@@ -31,9 +37,15 @@ public:
   /*! Read configuration from xml data */
   virtual PlusStatus ReadConfiguration(vtkXMLDataElement* config);
 
-  /*! Get ultrasound simulator */
+  /*! Get ultrasound simulator (of the first output channel) */
   vtkGetObjectMacro(UsSimulator, vtkPlusUsSimulatorAlgo);
 
+  /*! Get the number of simulated probes */
+  int GetNumberOfUsSimulators() const;
+
+  /*! Get the ultrasound simulator of the probe of the simulatorIndex-th output channel */
+  vtkPlusUsSimulatorAlgo* GetUsSimulator(int simulatorIndex);
+
   /*! Verify the device is correctly configured */
   virtual PlusStatus NotifyConfigured();
 
@@ -65,6 +77,9 @@ protected:
   /*! Ultrasound simulator */
   vtkPlusUsSimulatorAlgo* UsSimulator;
 
+  /*! Simulators of all the probes, in the order of the output channels. The first one is UsSimulator. Each has its own transform repository. */
+  std::vector< vtkSmartPointer<vtkPlusUsSimulatorAlgo> > UsSimulators;
+
   /* Timestamp of the last tracking item that has been processed already */
   double LastProcessedTrackingDataTimestamp;
 
@@ -9,10 +9,13 @@
 #include "vtkPlusV4L2VideoSource.h"
 #include "vtkPlusChannel.h"
 #include "vtkPlusDataSource.h"
+#include "PlusTelemetry.h"
 
 // VTK includes
 #include <vtkImageData.h>
 #include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkUnsignedCharArray.h>
 
 // OS includes
 #include <fcntl.h>
@@ -49,6 +52,7 @@ namespace
 vtkPlusV4L2VideoSource::vtkPlusV4L2VideoSource()
   : DeviceName("")
   , IOMethod(IO_METHOD_READ)
+  , NumberOfBuffers(4)
   , FileDescriptor(-1)
   , FrameBuffers(nullptr)
   , BufferCount(0)
@@ -76,6 +80,7 @@ void vtkPlusV4L2VideoSource::PrintSelf(ostream& os, vtkIndent indent)
 
   os << indent << "DeviceName: " << this->DeviceName << std::endl;
   os << indent << "IOMethod: " << this->IOMethodToString(this->IOMethod) << std::endl;
+  os << indent << "NumberOfBuffers: " << this->NumberOfBuffers << std::endl;
   os << indent << "BufferCount: " << this->BufferCount << std::endl;
 
   if (this->FileDescriptor != -1)
@@ -114,6 +119,13 @@ PlusStatus vtkPlusV4L2VideoSource::ReadConfiguration(vtkXMLDataElement* rootConf
     LOG_WARNING("Unknown method: " << ioMethod << ". Defaulting to " << vtkPlusV4L2VideoSource::IOMethodToString(this->IOMethod));
   }
 
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, NumberOfBuffers, deviceConfig);
+  if (this->NumberOfBuffers < 2)
+  {
+    LOG_WARNING("NumberOfBuffers must be at least 2. Using 2 buffers.");
+    this->NumberOfBuffers = 2;
+  }
+
   int frameSize[2];
   XML_READ_VECTOR_ATTRIBUTE_NONMEMBER_OPTIONAL(int, 2, FrameSize, frameSize, deviceConfig);
   if (deviceConfig->GetAttribute("FrameSize") != nullptr)
@@ -154,6 +166,7 @@ PlusStatus vtkPlusV4L2VideoSource::WriteConfiguration(vtkXMLDataElement* rootCon
   XML_WRITE_STRING_ATTRIBUTE_IF_NOT_EMPTY(DeviceName, deviceConfig);
 
   deviceConfig->SetAttribute("IOMethod", vtkPlusV4L2VideoSource::IOMethodToString(this->IOMethod).c_str());
+  deviceConfig->SetIntAttribute("NumberOfBuffers", this->NumberOfBuffers);
 
   int frameSize[2] = { static_cast<int>(this->DeviceFormat->fmt.pix.width), static_cast<int>(this->DeviceFormat->fmt.pix.height) };
   deviceConfig->SetVectorAttribute("FrameSize", 2, frameSize);
@@ -197,7 +210,7 @@ PlusStatus vtkPlusV4L2VideoSource::InitMmap()
 
   CLEAR(req);
 
-  req.count = 4;
+  req.count = this->NumberOfBuffers;
   req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
   req.memory = V4L2_MEMORY_MMAP;
 
@@ -262,7 +275,7 @@ PlusStatus vtkPlusV4L2VideoSource::InitUserp(unsigned int bufferSize)
 
   CLEAR(req);
 
-  req.count = 4;
+  req.count = this->NumberOfBuffers;
   req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
   req.memory = V4L2_MEMORY_USERPTR;
 
@@ -279,7 +292,13 @@ PlusStatus vtkPlusV4L2VideoSource::InitUserp(unsigned int bufferSize)
     return PLUS_FAIL;
   }
 
-  this->FrameBuffers = (FrameBuffer*) calloc(4, sizeof(FrameBuffer));
+  if (req.count < 2)
+  {
+    LOG_ERROR("Insufficient buffer memory on " << this->DeviceName);
+    return PLUS_FAIL;
+  }
+
+  this->FrameBuffers = (FrameBuffer*) calloc(req.count, sizeof(FrameBuffer));
 
   if (!this->FrameBuffers)
   {
@@ -287,16 +306,25 @@ PlusStatus vtkPlusV4L2VideoSource::InitUserp(unsigned int bufferSize)
     return PLUS_FAIL;
   }
 
-  for (this->BufferCount = 0; this->BufferCount < 4; ++this->BufferCount)
-  {
-    this->FrameBuffers[this->BufferCount].length = bufferSize;
-    this->FrameBuffers[this->BufferCount].start = malloc(bufferSize);
+  // If the frame is stored without padding then the capture buffers are allocated with the same layout as the pixel arrays
+  // of the Plus buffer frames, so that they can be swapped instead of copied
+  unsigned int numberOfPixels = this->ImageSize[0] * this->ImageSize[1] * this->ImageSize[2];
+  bool samePixelLayout = (numberOfPixels * this->NumberOfScalarComponents == bufferSize);
 
-    if (!this->FrameBuffers[this->BufferCount].start)
+  this->UserPtrArrays.clear();
+  for (this->BufferCount = 0; this->BufferCount < req.count; ++this->BufferCount)
+  {
+    vtkSmartPointer<vtkUnsignedCharArray> pixels = vtkSmartPointer<vtkUnsignedCharArray>::New();
+    pixels->SetNumberOfComponents(samePixelLayout ? this->NumberOfScalarComponents : 1);
+    if (!pixels->SetNumberOfTuples(samePixelLayout ? numberOfPixels : bufferSize))
     {
       LOG_ERROR("Out of memory");
       return PLUS_FAIL;
     }
+    this->UserPtrArrays.push_back(pixels);
+
+    this->FrameBuffers[this->BufferCount].length = bufferSize;
+    this->FrameBuffers[this->BufferCount].start = pixels->GetVoidPointer(0);
   }
 
   return PLUS_SUCCESS;
@@ -440,7 +468,15 @@ PlusStatus vtkPlusV4L2VideoSource::InternalConnect()
   this->ImageSize[1] = this->DeviceFormat->fmt.pix.height;
   this->ImageSize[2] = 1;
   this->DataSource->SetPixelType(VTK_UNSIGNED_CHAR);
-  this->NumberOfScalarComponents = this->DeviceFormat->fmt.pix.sizeimage / this->DeviceFormat->fmt.pix.width / this->DeviceFormat->fmt.pix.height;
+  if (this->IsMjpegFormat())
+  {
+    // Frames are decoded before they are added to the buffer
+    this->NumberOfScalarComponents = (this->DataSource->GetImageType() == US_IMG_RGB_COLOR ? 3 : 1);
+  }
+  else
+  {
+    this->NumberOfScalarComponents = this->DeviceFormat->fmt.pix.sizeimage / this->DeviceFormat->fmt.pix.width / this->DeviceFormat->fmt.pix.height;
+  }
   this->DataSource->SetNumberOfScalarComponents(this->NumberOfScalarComponents);
 
   this->FrameFields["pixelformat"] = vtkPlusV4L2VideoSource::PixelFormatToString(this->DeviceFormat->fmt.pix.pixelformat);
@@ -491,10 +527,7 @@ PlusStatus vtkPlusV4L2VideoSource::InternalDisconnect()
     }
     case IO_METHOD_USERPTR:
     {
-      for (unsigned int i = 0; i < this->BufferCount; ++i)
-      {
-        free(this->FrameBuffers[i].start);
-      }
+      this->UserPtrArrays.clear();
       break;
     }
   }
@@ -541,6 +574,16 @@ PlusStatus vtkPlusV4L2VideoSource::InternalUpdate()
     return PLUS_FAIL;
   }
 
+  bool isMjpegFormat = this->IsMjpegFormat();
+  if (this->IOMethod == IO_METHOD_READ && !isMjpegFormat && this->DataSource->IsInPlaceWritingSupported())
+  {
+    return this->ReadFrameInPlace();
+  }
+  if (this->IOMethod == IO_METHOD_USERPTR && !isMjpegFormat && this->DataSource->IsInPlaceWritingSupported())
+  {
+    return this->ReadFrameUserPtrInPlace();
+  }
+
   unsigned int currentBufferIndex;
   unsigned int bytesUsed;
   if (this->ReadFrame(currentBufferIndex, bytesUsed) != PLUS_SUCCESS)
@@ -548,6 +591,11 @@ PlusStatus vtkPlusV4L2VideoSource::InternalUpdate()
     return PLUS_FAIL;
   }
 
+  if (isMjpegFormat)
+  {
+    return this->AddMjpegFrame(static_cast<const unsigned char*>(this->FrameBuffers[currentBufferIndex].start), bytesUsed);
+  }
+
   if (this->DataSource->AddItem(this->FrameBuffers[currentBufferIndex].start, this->ImageSize, bytesUsed, US_IMG_BRIGHTNESS, this->FrameNumber, UNDEFINED_TIMESTAMP, UNDEFINED_TIMESTAMP, &this->FrameFields) != PLUS_SUCCESS)
   {
     LOG_ERROR("vtkPlusV4L2VideoSource::Unable to add item to the buffer.");
@@ -609,6 +657,218 @@ PlusStatus vtkPlusV4L2VideoSource::ReadFrameFileDescriptor(unsigned int& current
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusV4L2VideoSource::ReadFrameInPlace()
+{
+  igsioVideoFrame* frame = NULL;
+  if (this->DataSource->AcquireWritableFrame(frame) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("vtkPlusV4L2VideoSource::Unable to get writable frame from the buffer.");
+    return PLUS_FAIL;
+  }
+
+  if (frame->GetFrameSizeInBytes() < this->FrameBuffers[0].length)
+  {
+    LOG_ERROR("Buffer frame size (" << frame->GetFrameSizeInBytes() << " bytes) is smaller than the device frame size (" << this->FrameBuffers[0].length << " bytes).");
+    this->DataSource->ReleaseWritableFrame();
+    return PLUS_FAIL;
+  }
+
+  if (-1 == read(this->FileDescriptor, frame->GetScalarPointer(), this->FrameBuffers[0].length))
+  {
+    this->DataSource->ReleaseWritableFrame();
+    if (errno != EAGAIN)
+    {
+      LOG_ERROR("Read" << ": " << strerror(errno));
+    }
+    return PLUS_FAIL;
+  }
+
+  this->FrameFields["FrameSizeInBytes"] = igsioCommon::ToString<unsigned int>(this->FrameBuffers[0].length);
+  if (this->DataSource->CommitWritableFrame(this->FrameNumber, UNDEFINED_TIMESTAMP, UNDEFINED_TIMESTAMP, &this->FrameFields) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("vtkPlusV4L2VideoSource::Unable to add item to the buffer.");
+    return PLUS_FAIL;
+  }
+
+  this->FrameNumber++;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusV4L2VideoSource::ReadFrameUserPtrInPlace()
+{
+  v4l2_buffer buf;
+  CLEAR(buf);
+
+  buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  buf.memory = V4L2_MEMORY_USERPTR;
+
+  if (-1 == xioctl(this->FileDescriptor, VIDIOC_DQBUF, &buf))
+  {
+    if (errno != EAGAIN)
+    {
+      LOG_ERROR("VIDIOC_DQBUF" << ": " << strerror(errno));
+    }
+    return PLUS_FAIL;
+  }
+
+  unsigned int bufferIndex = buf.index;
+  if (bufferIndex >= this->BufferCount)
+  {
+    LOG_ERROR("Invalid buffer index returned by VIDIOC_DQBUF: " << bufferIndex);
+    return PLUS_FAIL;
+  }
+  this->FrameFields["FrameSizeInBytes"] = igsioCommon::ToString<unsigned int>(buf.bytesused);
+
+  igsioVideoFrame* frame = NULL;
+  if (this->DataSource->AcquireWritableFrame(frame) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("vtkPlusV4L2VideoSource::Unable to get writable frame from the buffer.");
+    this->QueueUserPtrBuffer(bufferIndex);
+    return PLUS_FAIL;
+  }
+
+  vtkDataArray* capturedPixels = this->UserPtrArrays[bufferIndex];
+  vtkDataArray* framePixels = frame->GetImage()->GetPointData()->GetScalars();
+  if (framePixels != NULL
+      && framePixels->GetDataType() == capturedPixels->GetDataType()
+      && framePixels->GetNumberOfComponents() == capturedPixels->GetNumberOfComponents()
+      && framePixels->GetNumberOfTuples() == capturedPixels->GetNumberOfTuples())
+  {
+    // Hand off the captured pixels to the frame and capture the next frame into the pixel array released by the frame
+    vtkSmartPointer<vtkDataArray> releasedPixels = framePixels;
+    frame->GetImage()->GetPointData()->SetScalars(capturedPixels);
+    this->UserPtrArrays[bufferIndex] = releasedPixels;
+    this->FrameBuffers[bufferIndex].start = releasedPixels->GetVoidPointer(0);
+  }
+  else if (frame->GetFrameSizeInBytes() >= buf.bytesused)
+  {
+    // Pixel layout of the frame is different (e.g., padded device format), fall back to copying the data
+    memcpy(frame->GetScalarPointer(), this->FrameBuffers[bufferIndex].start, buf.bytesused);
+  }
+  else
+  {
+    LOG_ERROR("Buffer frame size (" << frame->GetFrameSizeInBytes() << " bytes) is smaller than the device frame size (" << buf.bytesused << " bytes).");
+    this->DataSource->ReleaseWritableFrame();
+    this->QueueUserPtrBuffer(bufferIndex);
+    return PLUS_FAIL;
+  }
+
+  if (this->QueueUserPtrBuffer(bufferIndex) != PLUS_SUCCESS)
+  {
+    this->DataSource->ReleaseWritableFrame();
+    return PLUS_FAIL;
+  }
+
+  if (this->DataSource->CommitWritableFrame(this->FrameNumber, UNDEFINED_TIMESTAMP, UNDEFINED_TIMESTAMP, &this->FrameFields) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("vtkPlusV4L2VideoSource::Unable to add item to the buffer.");
+    return PLUS_FAIL;
+  }
+
+  this->FrameNumber++;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusV4L2VideoSource::QueueUserPtrBuffer(unsigned int bufferIndex)
+{
+  struct v4l2_buffer buf;
+  CLEAR(buf);
+  buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  buf.memory = V4L2_MEMORY_USERPTR;
+  buf.index = bufferIndex;
+  buf.m.userptr = (unsigned long) this->FrameBuffers[bufferIndex].start;
+  buf.length = this->FrameBuffers[bufferIndex].length;
+
+  if (-1 == xioctl(this->FileDescriptor, VIDIOC_QBUF, &buf))
+  {
+    LOG_ERROR("VIDIOC_QBUF" << ": " << strerror(errno));
+    return PLUS_FAIL;
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusV4L2VideoSource::IsMjpegFormat() const
+{
+  return this->DeviceFormat->fmt.pix.pixelformat == V4L2_PIX_FMT_MJPEG || this->DeviceFormat->fmt.pix.pixelformat == V4L2_PIX_FMT_JPEG;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusV4L2VideoSource::AddMjpegFrame(const unsigned char* data, unsigned int dataSize)
+{
+  const unsigned int decodedFrameSize = this->ImageSize[0] * this->ImageSize[1] * this->NumberOfScalarComponents;
+
+  // Decode directly into the buffer of the data source if possible
+  igsioVideoFrame* frame = NULL;
+  unsigned char* output = NULL;
+  if (this->DataSource->IsInPlaceWritingSupported() && this->DataSource->AcquireWritableFrame(frame) == PLUS_SUCCESS)
+  {
+    if (frame->GetFrameSizeInBytes() < decodedFrameSize)
+    {
+      LOG_ERROR("Buffer frame size (" << frame->GetFrameSizeInBytes() << " bytes) is smaller than the decoded frame size (" << decodedFrameSize << " bytes).");
+      this->DataSource->ReleaseWritableFrame();
+      return PLUS_FAIL;
+    }
+    output = static_cast<unsigned char*>(frame->GetScalarPointer());
+  }
+  else
+  {
+    frame = NULL;
+    this->DecodedFrame.resize(decodedFrameSize);
+    output = &this->DecodedFrame[0];
+  }
+
+  PlusStatus decodingStatus = PLUS_FAIL;
+  if (this->NumberOfScalarComponents == 3)
+  {
+    decodingStatus = this->MjpegDecoder.DecodeToBmp24(PixelCodec::ComponentOrder_RGB, this->ImageSize[0], this->ImageSize[1], data, dataSize, output, this->PixelConversionThreads);
+  }
+  else
+  {
+    decodingStatus = this->MjpegDecoder.DecodeToGray(this->ImageSize[0], this->ImageSize[1], data, dataSize, output, this->PixelConversionThreads);
+  }
+  if (decodingStatus != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Error while decoding the grabbed MJPEG frame");
+    if (frame != NULL)
+    {
+      this->DataSource->ReleaseWritableFrame();
+    }
+    return PLUS_FAIL;
+  }
+  PlusTelemetry::Instance()->AddSample(PlusTelemetry::STAGE_DECODING, this->MjpegDecoder.GetLastDecodingTimeSec());
+
+  this->FrameFields["FrameSizeInBytes"] = igsioCommon::ToString<unsigned int>(decodedFrameSize);
+  if (this->KeepSourceBitstream)
+  {
+    std::shared_ptr<StreamBufferItem::SourceBitstreamData> sourceBitstream = std::make_shared<StreamBufferItem::SourceBitstreamData>();
+    sourceBitstream->CodecFourCC = "MJPG";
+    sourceBitstream->Data.assign(data, data + dataSize);
+    this->DataSource->SetNextItemSourceBitstream(sourceBitstream);
+  }
+  PlusStatus status = PLUS_FAIL;
+  if (frame != NULL)
+  {
+    status = this->DataSource->CommitWritableFrame(this->FrameNumber, UNDEFINED_TIMESTAMP, UNDEFINED_TIMESTAMP, &this->FrameFields);
+  }
+  else
+  {
+    status = this->DataSource->AddItem(output, this->ImageSize, decodedFrameSize, this->DataSource->GetImageType(), this->FrameNumber, UNDEFINED_TIMESTAMP, UNDEFINED_TIMESTAMP, &this->FrameFields);
+  }
+  if (status != PLUS_SUCCESS)
+  {
+    LOG_ERROR("vtkPlusV4L2VideoSource::Unable to add item to the buffer.");
+    return PLUS_FAIL;
+  }
+
+  this->FrameNumber++;
+  return PLUS_SUCCESS;
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusV4L2VideoSource::ReadFrameMemoryMap(unsigned int& currentBufferIndex, unsigned int& bytesUsed)
 {
@@ -779,17 +1039,8 @@ PlusStatus vtkPlusV4L2VideoSource::InternalStartRecording()
     {
       for (unsigned int i = 0; i < this->BufferCount; ++i)
       {
-        struct v4l2_buffer buf;
-        CLEAR(buf);
-        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        buf.memory = V4L2_MEMORY_USERPTR;
-        buf.index = i;
-        buf.m.userptr = (unsigned long) this->FrameBuffers[i].start;
-        buf.length = this->FrameBuffers[i].length;
-
-        if (-1 == xioctl(this->FileDescriptor, VIDIOC_QBUF, &buf))
+        if (this->QueueUserPtrBuffer(i) != PLUS_SUCCESS)
         {
-          LOG_ERROR("VIDIOC_QBUF" << ": " << strerror(errno));
           return PLUS_FAIL;
         }
       }
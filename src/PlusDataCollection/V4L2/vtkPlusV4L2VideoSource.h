@@ -9,16 +9,26 @@
 
 #include "vtkPlusDataCollectionExport.h"
 #include "vtkPlusDevice.h"
+#include "PlusMjpegDecoder.h"
 
 // V4L2 includes
 #include <linux/videodev2.h>
 
+class vtkDataArray;
 class vtkPlusDataSource;
 
 /*!
  \class vtkPlusV4L2VideoSource
  \brief Class for interfacing an V4L2 device and recording frames into a Plus buffer
 
+ With user pointer i/o the capture buffers are pixel arrays that can be handed off to the Plus buffer:
+ when a filled capture buffer is dequeued its pixel array is swapped with the pixel array of the next
+ frame of the Plus buffer, and the pixel array that was released by the Plus buffer is queued for capture.
+ This avoids copying the image data if no clipping or reorientation of the frames is needed.
+
+ Frames of devices that deliver MJPEG (V4L2_PIX_FMT_MJPEG) are decoded to RGB24 (if the image type of the
+ video data source is RGB_COLOR) or to grayscale. The decoding time is reported in the Decoding stage of PlusTelemetry.
+
  Requires the PLUS_USE_V4L2 option in CMake.
 
  \ingroup PlusLibDataCollection
@@ -63,6 +73,10 @@ public:
   vtkSetStdStringMacro(DeviceName);
   vtkGetStdStringMacro(DeviceName);
 
+  /*! Number of capture buffers that are requested from the driver for memory mapped and user pointer i/o (queue depth) */
+  vtkSetMacro(NumberOfBuffers, int);
+  vtkGetMacro(NumberOfBuffers, int);
+
 protected:
   vtkPlusV4L2VideoSource();
   ~vtkPlusV4L2VideoSource();
@@ -73,6 +87,24 @@ protected:
   PlusStatus ReadFrameMemoryMap(unsigned int& currentBufferIndex, unsigned int& bytesUsed);
   PlusStatus ReadFrameUserPtr(unsigned int& currentBufferIndex, unsigned int& bytesUsed);
 
+  /*! Read the frame directly into the buffer of the data source (read i/o only), avoiding a copy of the image data */
+  PlusStatus ReadFrameInPlace();
+
+  /*!
+    Dequeue a filled user pointer buffer and hand off its pixel array to the buffer of the data source, avoiding a copy of the image data.
+    The pixel array that is released by the data source is queued for capture instead.
+  */
+  PlusStatus ReadFrameUserPtrInPlace();
+
+  /*! Queue the user pointer buffer of the given index for capture */
+  PlusStatus QueueUserPtrBuffer(unsigned int bufferIndex);
+
+  /*! Returns true if the frames delivered by the device are MJPEG compressed */
+  bool IsMjpegFormat() const;
+
+  /*! Decode an MJPEG compressed frame and add it to the buffer of the data source */
+  PlusStatus AddMjpegFrame(const unsigned char* data, unsigned int dataSize);
+
   PlusStatus InitRead(unsigned int bufferSize);
   PlusStatus InitMmap();
   PlusStatus InitUserp(unsigned int bufferSize);
@@ -97,6 +129,7 @@ protected:
   // Configuration variables
   std::string                         DeviceName;
   V4L2_IO_METHOD                      IOMethod;
+  int                                 NumberOfBuffers;
   // If not nullptr, override these settings in InternalConnect
   std::shared_ptr<unsigned int>       FormatWidth;
   std::shared_ptr<unsigned int>       FormatHeight;
@@ -108,6 +141,11 @@ protected:
   FrameBuffer*                        FrameBuffers;
   unsigned int                        BufferCount;
   vtkPlusDataSource*                  DataSource;
+  // Pixel arrays that back the user pointer buffers (FrameBuffers[i].start points to the data of UserPtrArrays[i])
+  std::vector<vtkSmartPointer<vtkDataArray>> UserPtrArrays;
+  PlusMjpegDecoder                    MjpegDecoder;
+  // Decoded frame, if it cannot be decoded directly into the buffer of the data source
+  std::vector<unsigned char>          DecodedFrame;
   igsioTrackedFrame::FieldMapType      FrameFields;
   std::shared_ptr<struct v4l2_format> DeviceFormat;
 
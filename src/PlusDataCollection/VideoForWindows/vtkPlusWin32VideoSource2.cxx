@@ -543,7 +543,7 @@ PlusStatus vtkPlusWin32VideoSource2::AddFrameToBuffer(void* lpVideoHeader)
     return PLUS_FAIL;
   }
 
-  if (PixelCodec::ConvertToGray(inputCompression, outputFrameSize[0], outputFrameSize[1], inputPixelsPtr, (unsigned char*)this->UncompressedVideoFrame.GetScalarPointer()) != PLUS_SUCCESS)
+  if (PixelCodec::ConvertToGray(inputCompression, outputFrameSize[0], outputFrameSize[1], inputPixelsPtr, (unsigned char*)this->UncompressedVideoFrame.GetScalarPointer(), this->PixelConversionThreads) != PLUS_SUCCESS)
   {
     LOG_ERROR("Error while decoding the grabbed image");
     return PLUS_FAIL;
@@ -5,16 +5,28 @@ See License.txt for details.
 =========================================================Plus=header=end*/
 
 #include "PlusConfigure.h"
+#include "PlusBufferSnapshot.h"
+#include "PlusProfiler.h"
+#include "PlusTrackedFrameAssembly.h"
+#include "PlusUnbufferedSequenceWriter.h"
+#include "PlusWorkerPool.h"
 #include "igsioTrackedFrame.h"
 #include "vtkIGSIOMetaImageSequenceIO.h"
 #include "vtkObjectFactory.h"
 #include "vtkPlusChannel.h"
 #include "vtkPlusDataSource.h"
+#include "vtkPlusSequenceIO.h"
 #include "vtkIGSIOSequenceIO.h"
 #include "vtkIGSIOTrackedFrameList.h"
 #include "vtkPlusVirtualCapture.h"
 #include "vtksys/SystemTools.hxx"
 
+// STL includes
+#include <algorithm>
+#include <cctype>
+#include <iomanip>
+#include <sstream>
+
 #ifdef PLUS_USE_VTKVIDEOIO_MKV
 //  #include "vtkPlusMkvSequenceIO.h"
 #endif
@@ -30,12 +42,37 @@ namespace
   static const double WARNING_RECORDING_LAG_SEC = 1.0; // if the recording lags more than this then a warning message will be displayed
   static const double MAX_ALLOWED_RECORDING_LAG_SEC = 3.0; // if the recording lags more than this then it'll skip frames to catch up
   static const unsigned int DISABLE_FRAME_BUFFER = std::numeric_limits<unsigned int>::max();
+  static const int RETROACTIVE_CAPTURE_BATCH_SIZE = 32; // number of frames that are assembled and written at once by a retroactive capture
+  static const double RETROACTIVE_CAPTURE_REPORT_PERIOD_SEC = 1.0; // the progress of a retroactive capture is logged at this period
+  static const int DEFAULT_WRITE_QUEUE_DEPTH = 4; // number of blocks queued for writing without buffering
+
+  //----------------------------------------------------------------------------
+  unsigned long long GetTrackedFrameSizeInBytes(igsioTrackedFrame* frame)
+  {
+    if (frame == NULL || frame->GetImageData() == NULL || !frame->GetImageData()->IsImageValid())
+    {
+      return 0;
+    }
+    return static_cast<unsigned long long>(frame->GetImageData()->GetFrameSizeInBytes());
+  }
+
+  //----------------------------------------------------------------------------
+  /*! The bitstream file is next to the sequence file, with the codec as extension */
+  std::string GetSourceBitstreamFilename(const std::string& sequenceFilename, const std::string& codecFourCC)
+  {
+    std::string extension = codecFourCC;
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    std::string path = vtksys::SystemTools::GetFilenamePath(sequenceFilename);
+    std::string filenameRoot = igsioCommon::GetSequenceFilenameWithoutExtension(vtksys::SystemTools::GetFilenameName(sequenceFilename));
+    return (path.empty() ? std::string() : path + "/") + filenameRoot + "." + extension;
+  }
 }
 
 //----------------------------------------------------------------------------
 vtkPlusVirtualCapture::vtkPlusVirtualCapture()
   : vtkPlusDevice()
   , RecordedFrames(vtkIGSIOTrackedFrameList::New())
+  , WritingFrames(vtkIGSIOTrackedFrameList::New())
   , LastAlreadyRecordedFrameTimestamp(UNDEFINED_TIMESTAMP)
   , NextFrameToBeRecordedTimestamp(0.0)
   , RequestedFrameRate(15.0)
@@ -47,11 +84,34 @@ vtkPlusVirtualCapture::vtkPlusVirtualCapture()
   , BaseFilename("TrackedImageSequence.nrrd")
   , Writer(NULL)
   , EnableFileCompression(false)
+  , NumberOfCompressionThreads(1)
+  , CompressionLevel(-1)
+  , CompressFileOnClose(false)
+  , EnableFrameIndex(false)
+  , EnablePassThroughRecording(false)
+  , SourceBitstreamFileSize(0)
+  , EnableUnbufferedWrite(false)
+  , WriteQueueDepth(DEFAULT_WRITE_QUEUE_DEPTH)
+  , PreallocatedFileSizeMB(0)
+  , RecordImageData(true)
+  , AssembledFrames(vtkSmartPointer<vtkIGSIOTrackedFrameList>::New())
+  , NextSampledFrameTimestamp(UNDEFINED_TIMESTAMP)
   , IsHeaderPrepared(false)
   , TotalFramesRecorded(0)
   , EnableCapturingOnStart(false)
   , EnableCapturing(false)
   , FrameBufferSize(DISABLE_FRAME_BUFFER)
+  , MaxNumberOfQueuedFrames(0)
+  , WriterThreadId(-1)
+  , WriterThreadActive(false)
+  , WritePending(false)
+  , BackgroundWriteFailed(false)
+  , RecordedFramesBytes(0)
+  , WritingFramesBytes(0)
+  , NumberOfDroppedFrames(0)
+  , RetroactiveCaptureNumberOfFrames(0)
+  , RetroactiveCaptureFramesWritten(0)
+  , RetroactiveCaptureThroughputMBps(0.0)
   , IsData3D(false)
   , WriterAccessMutex(vtkSmartPointer<vtkIGSIORecursiveCriticalSection>::New())
   , GracePeriodLogLevel(vtkPlusLogger::LOG_LEVEL_DEBUG)
@@ -60,6 +120,8 @@ vtkPlusVirtualCapture::vtkPlusVirtualCapture()
   this->AcquisitionRate = 30.0;
   this->MissingInputGracePeriodSec = 2.0;
   this->RecordedFrames->SetValidationRequirements(REQUIRE_UNIQUE_TIMESTAMP);
+  this->WritingFrames->SetValidationRequirements(REQUIRE_UNIQUE_TIMESTAMP);
+  this->AssembledFrames->SetValidationRequirements(REQUIRE_UNIQUE_TIMESTAMP);
 
   // The data capture thread will be used to regularly read the frames and write to disk
   this->StartThreadForInternalUpdates = true;
@@ -68,17 +130,27 @@ vtkPlusVirtualCapture::vtkPlusVirtualCapture()
 //----------------------------------------------------------------------------
 vtkPlusVirtualCapture::~vtkPlusVirtualCapture()
 {
-  if (IsHeaderPrepared)
+  this->WaitForRetroactiveCapture();
+
+  if (this->HasUnsavedData())
   {
     this->CloseFile();
   }
 
+  this->StopWriterThread();
+
   if (RecordedFrames != NULL)
   {
     this->RecordedFrames->Delete();
     this->RecordedFrames = NULL;
   }
 
+  if (WritingFrames != NULL)
+  {
+    this->WritingFrames->Delete();
+    this->WritingFrames = NULL;
+  }
+
   if (Writer != NULL)
   {
     this->Writer->Delete();
@@ -103,12 +175,61 @@ PlusStatus vtkPlusVirtualCapture::ReadConfiguration(vtkXMLDataElement* rootConfi
     deviceConfig->SetAttribute("Type", "VirtualCapture");
   }
 
-  XML_READ_STRING_ATTRIBUTE_OPTIONAL(BaseFilename, deviceConfig);
-  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(EnableFileCompression, deviceConfig);
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(EnableCapturingOnStart, deviceConfig);
-  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, RequestedFrameRate, deviceConfig);
-  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, FrameBufferSize, deviceConfig);
-  XML_READ_STRING_ATTRIBUTE_OPTIONAL(EncodingFourCC, deviceConfig);
+  if (this->ReadRecordingConfiguration(deviceConfig) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+
+  this->SecondaryRecordings.clear();
+  for (int nestedElementIndex = 0; nestedElementIndex < deviceConfig->GetNumberOfNestedElements(); nestedElementIndex++)
+  {
+    vtkXMLDataElement* recordingElement = deviceConfig->GetNestedElement(nestedElementIndex);
+    if (recordingElement == NULL || STRCASECMP(recordingElement->GetName(), "SecondaryRecording") != 0)
+    {
+      continue;
+    }
+    std::ostringstream recordingName;
+    if (recordingElement->GetAttribute("Id") != NULL)
+    {
+      recordingName << recordingElement->GetAttribute("Id");
+    }
+    else
+    {
+      recordingName << this->SecondaryRecordings.size() + 1;
+    }
+    vtkSmartPointer<vtkPlusVirtualCapture> recording = vtkSmartPointer<vtkPlusVirtualCapture>::New();
+    recording->SetDeviceId(this->GetDeviceId() + "_" + recordingName.str());
+    // By default the file name is derived from the file name of the device, so that the recordings are not saved to the same file
+    recording->SetBaseFilename(igsioCommon::GetSequenceFilenameWithoutExtension(this->BaseFilename) + "_" + recordingName.str() + igsioCommon::GetSequenceFilenameExtension(this->BaseFilename));
+    if (recording->ReadRecordingConfiguration(recordingElement) != PLUS_SUCCESS)
+    {
+      LOG_ERROR(this->GetDeviceId() << ": Failed to read the configuration of secondary recording " << recordingName.str());
+      return PLUS_FAIL;
+    }
+    this->SecondaryRecordings.push_back(recording);
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualCapture::ReadRecordingConfiguration(vtkXMLDataElement* recordingElement)
+{
+  XML_READ_STRING_ATTRIBUTE_OPTIONAL(BaseFilename, recordingElement);
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(EnableFileCompression, recordingElement);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, RequestedFrameRate, recordingElement);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, FrameBufferSize, recordingElement);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, MaxNumberOfQueuedFrames, recordingElement);
+  XML_READ_STRING_ATTRIBUTE_OPTIONAL(EncodingFourCC, recordingElement);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, NumberOfCompressionThreads, recordingElement);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, CompressionLevel, recordingElement);
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(EnableFrameIndex, recordingElement);
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(EnablePassThroughRecording, recordingElement);
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(EnableUnbufferedWrite, recordingElement);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, WriteQueueDepth, recordingElement);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, PreallocatedFileSizeMB, recordingElement);
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(RecordImageData, recordingElement);
 
   return PLUS_SUCCESS;
 }
@@ -118,22 +239,81 @@ PlusStatus vtkPlusVirtualCapture::WriteConfiguration(vtkXMLDataElement* rootConf
 {
   XML_FIND_DEVICE_ELEMENT_REQUIRED_FOR_WRITING(deviceElement, rootConfig);
   deviceElement->SetAttribute("EnableCapturing", this->EnableCapturing ? "TRUE" : "FALSE");
-  deviceElement->SetAttribute("EnableFileCompression", this->EnableFileCompression ? "TRUE" : "FALSE");
   deviceElement->SetAttribute("EnableCaptureOnStart", this->EnableCapturingOnStart ? "TRUE" : "FALSE");
-  deviceElement->SetDoubleAttribute("RequestedFrameRate", this->GetRequestedFrameRate());
+  this->WriteRecordingConfiguration(deviceElement);
+
+  // Secondary recordings are written to their elements in the order they were read
+  std::vector<vtkSmartPointer<vtkPlusVirtualCapture> >::iterator recordingIt = this->SecondaryRecordings.begin();
+  for (int nestedElementIndex = 0; nestedElementIndex < deviceElement->GetNumberOfNestedElements() && recordingIt != this->SecondaryRecordings.end(); nestedElementIndex++)
+  {
+    vtkXMLDataElement* recordingElement = deviceElement->GetNestedElement(nestedElementIndex);
+    if (recordingElement != NULL && STRCASECMP(recordingElement->GetName(), "SecondaryRecording") == 0)
+    {
+      (*recordingIt)->WriteRecordingConfiguration(recordingElement);
+      ++recordingIt;
+    }
+  }
 
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+void vtkPlusVirtualCapture::WriteRecordingConfiguration(vtkXMLDataElement* recordingElement)
+{
+  recordingElement->SetAttribute("EnableFileCompression", this->EnableFileCompression ? "TRUE" : "FALSE");
+  recordingElement->SetDoubleAttribute("RequestedFrameRate", this->GetRequestedFrameRate());
+  if (this->MaxNumberOfQueuedFrames > 0)
+  {
+    recordingElement->SetIntAttribute("MaxNumberOfQueuedFrames", this->MaxNumberOfQueuedFrames);
+  }
+  if (this->NumberOfCompressionThreads != 1)
+  {
+    recordingElement->SetIntAttribute("NumberOfCompressionThreads", this->NumberOfCompressionThreads);
+    recordingElement->SetIntAttribute("CompressionLevel", this->CompressionLevel);
+  }
+  if (this->EnableFrameIndex)
+  {
+    recordingElement->SetAttribute("EnableFrameIndex", "TRUE");
+  }
+  if (this->EnablePassThroughRecording)
+  {
+    recordingElement->SetAttribute("EnablePassThroughRecording", "TRUE");
+  }
+  if (this->EnableUnbufferedWrite)
+  {
+    recordingElement->SetAttribute("EnableUnbufferedWrite", "TRUE");
+    recordingElement->SetIntAttribute("WriteQueueDepth", this->WriteQueueDepth);
+    recordingElement->SetIntAttribute("PreallocatedFileSizeMB", this->PreallocatedFileSizeMB);
+  }
+  if (!this->RecordImageData)
+  {
+    recordingElement->SetAttribute("RecordImageData", "FALSE");
+  }
+}
+
 
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusVirtualCapture::InternalConnect()
 {
+  if (this->StartWriterThread() != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+
   if (OpenFile() != PLUS_SUCCESS)
   {
     return PLUS_FAIL;
   }
 
+  for (std::vector<vtkSmartPointer<vtkPlusVirtualCapture> >::iterator recordingIt = this->SecondaryRecordings.begin(); recordingIt != this->SecondaryRecordings.end(); ++recordingIt)
+  {
+    if ((*recordingIt)->StartWriterThread() != PLUS_SUCCESS || (*recordingIt)->OpenFile() != PLUS_SUCCESS)
+    {
+      LOG_ERROR(this->GetDeviceId() << ": Failed to start secondary recording " << (*recordingIt)->GetDeviceId());
+      return PLUS_FAIL;
+    }
+  }
+
   if (this->GetEnableCapturingOnStart())
   {
     this->SetEnableCapturing(true);
@@ -149,32 +329,103 @@ PlusStatus vtkPlusVirtualCapture::InternalDisconnect()
 {
   this->EnableCapturing = false;
 
-  // If outstanding frames to be written, deal with them
-  if (this->RecordedFrames->GetNumberOfTrackedFrames() != 0 && this->IsHeaderPrepared)
+  // Outstanding frames are written when the file is closed
+  PlusStatus status = this->CloseFile();
+  this->StopWriterThread();
+  for (std::vector<vtkSmartPointer<vtkPlusVirtualCapture> >::iterator recordingIt = this->SecondaryRecordings.begin(); recordingIt != this->SecondaryRecordings.end(); ++recordingIt)
+  {
+    (*recordingIt)->SetEnableCapturing(false);
+    (*recordingIt)->StopWriterThread();
+  }
+  if (this->WaitForRetroactiveCapture() != PLUS_SUCCESS)
+  {
+    status = PLUS_FAIL;
+  }
+  return status;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualCapture::StartWriterThread()
+{
+  std::lock_guard<std::mutex> lock(this->WriteRequestMutex);
+  if (this->WriterThreadActive)
+  {
+    return PLUS_SUCCESS;
+  }
+  this->WriterThreadActive = true;
+  this->WriterThreadId = this->Threader->SpawnThread((vtkThreadFunctionType)&vtkWriterThread, this);
+  if (this->WriterThreadId < 0)
   {
-    if (this->Writer->AppendImagesToHeader() != PLUS_SUCCESS)
+    LOG_ERROR(this->GetDeviceId() << ": Failed to start writer thread");
+    this->WriterThreadActive = false;
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusVirtualCapture::StopWriterThread()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->WriteRequestMutex);
+    if (!this->WriterThreadActive)
     {
-      LOG_ERROR("Unable to append image data to header.");
-      this->Disconnect();
-      return PLUS_FAIL;
+      return;
+    }
+    this->WriterThreadActive = false;
+  }
+  this->WriteRequestCondition.notify_all();
+  // The thread writes the pending batch (if any) before it exits
+  this->Threader->TerminateThread(this->WriterThreadId);
+  this->WriterThreadId = -1;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusVirtualCapture::WaitForBackgroundWrite()
+{
+  std::unique_lock<std::mutex> lock(this->WriteRequestMutex);
+  this->WriteRequestCondition.wait(lock, [this] { return !this->WritePending; });
+}
+
+//----------------------------------------------------------------------------
+void* vtkPlusVirtualCapture::vtkWriterThread(vtkMultiThreader::ThreadInfo* data)
+{
+  vtkPlusVirtualCapture* self = (vtkPlusVirtualCapture*)(data->UserData);
+
+  for (;;)
+  {
+    {
+      std::unique_lock<std::mutex> lock(self->WriteRequestMutex);
+      self->WriteRequestCondition.wait(lock, [self] { return self->WritePending || !self->WriterThreadActive; });
+      if (!self->WritePending)
+      {
+        // Stop requested and nothing left to write
+        break;
+      }
     }
-    if (this->Writer->WriteImages() != PLUS_SUCCESS)
+
+    // The capture thread does not access the writer while a write is pending, so it is not locked here
+    if (self->WriteFramesToFile() != PLUS_SUCCESS)
     {
-      LOG_ERROR("Unable to append images. Stopping recording at timestamp: " << this->LastAlreadyRecordedFrameTimestamp);
-      this->Disconnect();
-      return PLUS_FAIL;
+      // The recording is stopped from the capture thread, on the next WriteFrames call
+      self->BackgroundWriteFailed = true;
     }
 
-    this->ClearRecordedFrames();
+    {
+      std::lock_guard<std::mutex> lock(self->WriteRequestMutex);
+      self->WritePending = false;
+    }
+    self->WriteRequestCondition.notify_all();
   }
-  PlusStatus status = this->CloseFile();
-  return status;
+
+  return NULL;
 }
 
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusVirtualCapture::OpenFile(const char* aFilename)
 {
   igsioLockGuard<vtkIGSIORecursiveCriticalSection> writerLock(this->WriterAccessMutex);
+  this->WaitForBackgroundWrite();
 
   if (aFilename == NULL || strlen(aFilename) == 0)
   {
@@ -211,11 +462,34 @@ PlusStatus vtkPlusVirtualCapture::OpenFile(const char* aFilename)
     LOG_ERROR("Could not create writer for file: " << aFilename);
     return PLUS_FAIL;
   }
-  this->Writer->SetUseCompression(this->EnableFileCompression);
-  this->Writer->SetTrackedFrameList(this->RecordedFrames);
+  // With multi-threaded compression the frames are written uncompressed and the file is compressed when it is closed
+  // Compressed files can only be indexed if they are compressed when the file is closed
+  this->CompressFileOnClose = this->EnableFileCompression && (this->NumberOfCompressionThreads != 1 || this->EnableFrameIndex) && vtkPlusSequenceIO::CanCompressInParallel(aFilename);
+  this->Writer->SetUseCompression(this->EnableFileCompression && !this->CompressFileOnClose);
+  this->Writer->SetTrackedFrameList(this->WritingFrames);
   // Need to set the filename before finalizing header, because the pixel data file name depends on the file extension
   this->Writer->SetFileName(vtkPlusConfig::GetInstance()->GetOutputPath(aFilename));
 
+  // The unbuffered writer is opened when the first frames are written, as it needs to know whether they contain image data
+  this->UnbufferedWriter.reset();
+  if (this->EnableUnbufferedWrite)
+  {
+    if (this->EnableFileCompression)
+    {
+      LOG_WARNING(this->GetDeviceId() << ": Unbuffered writing is not supported for compressed files. " << aFilename << " is written with buffering.");
+    }
+    else if (PlusUnbufferedSequenceWriter::GetHeaderFilename(aFilename).empty())
+    {
+      LOG_WARNING(this->GetDeviceId() << ": Unbuffered writing is only supported for MetaImage and NRRD files. " << aFilename << " is written with buffering.");
+    }
+    else
+    {
+      this->UnbufferedWriter.reset(new PlusUnbufferedSequenceWriter);
+      this->UnbufferedWriter->SetQueueDepth(this->WriteQueueDepth);
+      this->UnbufferedWriter->SetPreallocatedSizeBytes(static_cast<unsigned long long>(std::max(this->PreallocatedFileSizeMB, 0)) * 1024 * 1024);
+    }
+  }
+
   return PLUS_SUCCESS;
 }
 
@@ -224,11 +498,28 @@ PlusStatus vtkPlusVirtualCapture::CloseFile(const char* aFilename /* = NULL */,
 {
   // Fix the header to write the correct number of frames
   igsioLockGuard<vtkIGSIORecursiveCriticalSection> writerLock(this->WriterAccessMutex);
+  this->WaitForBackgroundWrite();
 
-  if (!this->IsHeaderPrepared)
+  // Secondary recordings are saved with their own generated file names
+  PlusStatus secondaryRecordingStatus = PLUS_SUCCESS;
+  for (std::vector<vtkSmartPointer<vtkPlusVirtualCapture> >::iterator recordingIt = this->SecondaryRecordings.begin(); recordingIt != this->SecondaryRecordings.end(); ++recordingIt)
+  {
+    std::string recordingFilename;
+    if ((*recordingIt)->CloseFile(NULL, &recordingFilename) != PLUS_SUCCESS)
+    {
+      LOG_ERROR(this->GetDeviceId() << ": Failed to save secondary recording " << (*recordingIt)->GetDeviceId());
+      secondaryRecordingStatus = PLUS_FAIL;
+    }
+    else if (!recordingFilename.empty())
+    {
+      LOG_INFO(this->GetDeviceId() << ": Secondary recording " << (*recordingIt)->GetDeviceId() << " saved to " << recordingFilename);
+    }
+  }
+
+  if (!this->IsHeaderPrepared && this->RecordedFrames->GetNumberOfTrackedFrames() == 0)
   {
     // nothing has been prepared, so nothing to finalize
-    return PLUS_SUCCESS;
+    return secondaryRecordingStatus;
   }
 
   if (aFilename != NULL && strlen(aFilename) != 0)
@@ -236,6 +527,11 @@ PlusStatus vtkPlusVirtualCapture::CloseFile(const char* aFilename /* = NULL */,
     // Need to set the filename before finalizing header, because the pixel data file name depends on the file extension
     this->Writer->SetFileName(vtkPlusConfig::GetInstance()->GetOutputPath(aFilename));
     this->CurrentFilename = aFilename;
+    if (this->UnbufferedWriter && this->UnbufferedWriter->IsOpen() && this->UnbufferedWriter->SetFilename(aFilename) == PLUS_SUCCESS)
+    {
+      // The data file is renamed when the file is closed
+      this->CurrentFilename = PlusUnbufferedSequenceWriter::GetHeaderFilename(aFilename);
+    }
   }
 
   // Do we have any outstanding unwritten data?
@@ -243,18 +539,62 @@ PlusStatus vtkPlusVirtualCapture::CloseFile(const char* aFilename /* = NULL */,
   {
     this->WriteFrames(true);
   }
+  if (!this->IsHeaderPrepared)
+  {
+    // frames could not be written
+    return PLUS_FAIL;
+  }
 
-  this->Writer->UpdateDimensionsCustomStrings(this->TotalFramesRecorded, this->GetIsData3D());
-  this->Writer->UpdateFieldInImageHeader(this->Writer->GetDimensionSizeString());
-  this->Writer->UpdateFieldInImageHeader(this->Writer->GetDimensionKindsString());
-  this->Writer->FinalizeHeader();
+  std::string writtenFilename;
+  PlusStatus writerStatus = PLUS_SUCCESS;
+  if (this->UnbufferedWriter)
+  {
+    // The header is written when the file is closed
+    writerStatus = this->UnbufferedWriter->Close();
+    writtenFilename = this->UnbufferedWriter->GetFilename();
+    LOG_INFO(this->GetDeviceId() << ": Recording written to " << writtenFilename << " (" << this->UnbufferedWriter->GetStatisticsString() << ")");
+  }
+  else
+  {
+    this->Writer->UpdateDimensionsCustomStrings(this->TotalFramesRecorded, this->GetIsData3D());
+    this->Writer->UpdateFieldInImageHeader(this->Writer->GetDimensionSizeString());
+    this->Writer->UpdateFieldInImageHeader(this->Writer->GetDimensionKindsString());
+    this->Writer->FinalizeHeader();
+    this->Writer->Close();
+    writtenFilename = this->Writer->GetFileName();
+  }
 
   if (resultFilename != NULL)
   {
-    (*resultFilename) = this->Writer->GetFileName();
+    (*resultFilename) = writtenFilename;
   }
 
-  this->Writer->Close();
+  PlusStatus bitstreamStatus = this->CloseSourceBitstreamFile(writtenFilename);
+
+  PlusStatus compressionStatus = PLUS_SUCCESS;
+  if (this->CompressFileOnClose)
+  {
+    if (!vtkPlusSequenceIO::CanCompressInParallel(writtenFilename))
+    {
+      LOG_WARNING(this->GetDeviceId() << ": Multi-threaded compression is not supported for " << writtenFilename << ". The file is saved uncompressed.");
+    }
+    else if (vtkPlusSequenceIO::CompressFile(writtenFilename, this->NumberOfCompressionThreads, this->CompressionLevel, this->EnableFrameIndex) != PLUS_SUCCESS)
+    {
+      LOG_ERROR(this->GetDeviceId() << ": Failed to compress " << writtenFilename << ". The file is saved uncompressed.");
+      compressionStatus = PLUS_FAIL;
+    }
+  }
+  else if (this->EnableFrameIndex)
+  {
+    if (this->EnableFileCompression)
+    {
+      LOG_WARNING(this->GetDeviceId() << ": Frame index is not written for " << writtenFilename << ", only uncompressed files and compressed nrrd files can be indexed.");
+    }
+    else if (vtkPlusSequenceIO::WriteFrameIndex(writtenFilename) != PLUS_SUCCESS)
+    {
+      LOG_WARNING(this->GetDeviceId() << ": Frame index is not written for " << writtenFilename);
+    }
+  }
 
   std::string fullPath = vtkPlusConfig::GetInstance()->GetOutputPath(this->CurrentFilename);
   std::string path = vtksys::SystemTools::GetFilenamePath(fullPath);
@@ -264,14 +604,15 @@ PlusStatus vtkPlusVirtualCapture::CloseFile(const char* aFilename /* = NULL */,
 
   this->IsHeaderPrepared = false;
   this->TotalFramesRecorded = 0;
-  this->RecordedFrames->Clear();
+  this->NumberOfDroppedFrames = 0;
+  this->ClearRecordedFrames();
 
   if (this->OpenFile() != PLUS_SUCCESS)
   {
     return PLUS_FAIL;
   }
 
-  return PLUS_SUCCESS;
+  return (writerStatus == PLUS_SUCCESS && compressionStatus == PLUS_SUCCESS && bitstreamStatus == PLUS_SUCCESS && secondaryRecordingStatus == PLUS_SUCCESS) ? PLUS_SUCCESS : PLUS_FAIL;
 }
 
 //----------------------------------------------------------------------------
@@ -337,47 +678,50 @@ PlusStatus vtkPlusVirtualCapture::InternalUpdate()
     return PLUS_SUCCESS;
   }
 
-  int nbFramesBefore = this->RecordedFrames->GetNumberOfTrackedFrames();
-  if (this->GetInputTrackedFrameListSampled(this->LastAlreadyRecordedFrameTimestamp, this->NextFrameToBeRecordedTimestamp, this->RecordedFrames, requestedFramePeriodSec, maxProcessingTimeSec) != PLUS_SUCCESS)
+  // Frames are assembled once, at the highest frame rate of all recordings
+  double assemblyFramePeriodSec = requestedFramePeriodSec;
+  for (std::vector<vtkSmartPointer<vtkPlusVirtualCapture> >::iterator recordingIt = this->SecondaryRecordings.begin(); recordingIt != this->SecondaryRecordings.end(); ++recordingIt)
   {
-    LOG_ERROR("Error while getting tracked frame list from data collector during capturing. Last recorded timestamp: " << std::fixed << this->NextFrameToBeRecordedTimestamp);
+    if ((*recordingIt)->GetRequestedFrameRate() > 0)
+    {
+      assemblyFramePeriodSec = std::min(assemblyFramePeriodSec, 1.0 / (*recordingIt)->GetRequestedFrameRate());
+    }
+  }
+  // Frames are assembled directly into the recorded frames if this device records all of them as they are
+  vtkIGSIOTrackedFrameList* assembledFrames = this->RecordedFrames;
+  if (assemblyFramePeriodSec < requestedFramePeriodSec || !this->RecordImageData)
+  {
+    this->AssembledFrames->Clear();
+    assembledFrames = this->AssembledFrames;
   }
-  int nbFramesAfter = this->RecordedFrames->GetNumberOfTrackedFrames();
 
-  // Compute the average frame rate from the ratio of recently acquired frames
-  int frame1Index = this->RecordedFrames->GetNumberOfTrackedFrames() - 1; // index of the latest frame
-  int frame2Index = frame1Index - this->RequestedFrameRate * 5.0 - 1; // index of an earlier acquired frame (go back by approximately 5 seconds + one frame)
-  if (frame2Index < this->FirstFrameIndexInThisSegment)
+  int nbFramesBefore = this->RecordedFrames->GetNumberOfTrackedFrames();
+  int nbAssembledFramesBefore = assembledFrames->GetNumberOfTrackedFrames();
+  if (this->GetInputTrackedFrameListSampled(this->LastAlreadyRecordedFrameTimestamp, this->NextFrameToBeRecordedTimestamp, assembledFrames, assemblyFramePeriodSec, maxProcessingTimeSec) != PLUS_SUCCESS)
   {
-    // make sure we stay in the current recording segment
-    frame2Index = this->FirstFrameIndexInThisSegment;
+    LOG_ERROR("Error while getting tracked frame list from data collector during capturing. Last recorded timestamp: " << std::fixed << this->NextFrameToBeRecordedTimestamp);
   }
-  if (frame1Index > frame2Index)
+  int nbAssembledFramesAfter = assembledFrames->GetNumberOfTrackedFrames();
+
+  for (std::vector<vtkSmartPointer<vtkPlusVirtualCapture> >::iterator recordingIt = this->SecondaryRecordings.begin(); recordingIt != this->SecondaryRecordings.end(); ++recordingIt)
   {
-    igsioTrackedFrame* frame1 = this->RecordedFrames->GetTrackedFrame(frame1Index);
-    igsioTrackedFrame* frame2 = this->RecordedFrames->GetTrackedFrame(frame2Index);
-    if (frame1 != NULL && frame2 != NULL)
+    if ((*recordingIt)->AddSampledFrames(assembledFrames, nbAssembledFramesBefore, nbAssembledFramesAfter, assemblyFramePeriodSec) != PLUS_SUCCESS)
     {
-      double frameTimeDiff = frame1->GetTimestamp() - frame2->GetTimestamp();
-      if (frameTimeDiff > 0)
-      {
-        this->ActualFrameRate = (frame1Index - frame2Index) / frameTimeDiff;
-      }
-      else
-      {
-        this->ActualFrameRate = 0;
-      }
+      LOG_ERROR(this->GetDeviceId() << ": Secondary recording " << (*recordingIt)->GetDeviceId() << " failed, it is stopped.");
+      (*recordingIt)->SetEnableCapturing(false);
     }
   }
+  if (assembledFrames != this->RecordedFrames)
+  {
+    this->SampleFrames(assembledFrames, nbAssembledFramesBefore, nbAssembledFramesAfter, assemblyFramePeriodSec);
+    this->AssembledFrames->Clear();
+  }
 
-  if (this->WriteFrames() != PLUS_SUCCESS)
+  if (this->RecordNewFrames(nbFramesBefore, this->RecordedFrames->GetNumberOfTrackedFrames()) != PLUS_SUCCESS)
   {
-    LOG_ERROR(this->GetDeviceId() << ": Unable to write " << nbFramesAfter - nbFramesBefore << " frames.");
     return PLUS_FAIL;
   }
 
-  this->TotalFramesRecorded += nbFramesAfter - nbFramesBefore;
-
   if (this->TotalFramesRecorded == 0)
   {
     // We haven't received any data so far
@@ -418,6 +762,123 @@ PlusStatus vtkPlusVirtualCapture::InternalUpdate()
   return PLUS_SUCCESS;
 }
 
+//-----------------------------------------------------------------------------
+void vtkPlusVirtualCapture::SampleFrames(vtkIGSIOTrackedFrameList* frames, int firstFrameIndex, int lastFrameIndex, double inputFramePeriodSec)
+{
+  double framePeriodSec = (this->RequestedFrameRate > 0 ? 1.0 / this->RequestedFrameRate : 0.1);
+  // The input frames are sampled at a different period, take the frame that is the closest to the requested time
+  double toleranceSec = 0.5 * inputFramePeriodSec;
+  for (int frameIndex = firstFrameIndex; frameIndex < lastFrameIndex; ++frameIndex)
+  {
+    igsioTrackedFrame* frame = frames->GetTrackedFrame(frameIndex);
+    double timestamp = frame->GetTimestamp();
+    if (this->NextSampledFrameTimestamp != UNDEFINED_TIMESTAMP && timestamp < this->NextSampledFrameTimestamp - toleranceSec)
+    {
+      continue;
+    }
+    // Start a new sampling period if there is a gap in the input frames
+    if (this->NextSampledFrameTimestamp == UNDEFINED_TIMESTAMP || timestamp - this->NextSampledFrameTimestamp > framePeriodSec)
+    {
+      this->NextSampledFrameTimestamp = timestamp;
+    }
+    this->NextSampledFrameTimestamp += framePeriodSec;
+
+    PlusStatus status = PLUS_SUCCESS;
+    if (this->RecordImageData)
+    {
+      status = this->RecordedFrames->AddTrackedFrame(frame, vtkIGSIOTrackedFrameList::SKIP_INVALID_FRAME);
+    }
+    else
+    {
+      igsioTrackedFrame* trackingFrame = new igsioTrackedFrame;
+      trackingFrame->SetTimestamp(timestamp);
+      const igsioFieldMapType& frameFields = frame->GetFrameFields();
+      for (igsioFieldMapType::const_iterator fieldIt = frameFields.begin(); fieldIt != frameFields.end(); ++fieldIt)
+      {
+        trackingFrame->SetFrameField(fieldIt->first, fieldIt->second.second, fieldIt->second.first);
+      }
+      status = this->RecordedFrames->TakeTrackedFrame(trackingFrame, vtkIGSIOTrackedFrameList::SKIP_INVALID_FRAME);
+    }
+    if (status != PLUS_SUCCESS)
+    {
+      LOG_WARNING(this->GetDeviceId() << ": Frame could not be added because validation failed");
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualCapture::AddSampledFrames(vtkIGSIOTrackedFrameList* frames, int firstFrameIndex, int lastFrameIndex, double inputFramePeriodSec)
+{
+  igsioLockGuard<vtkIGSIORecursiveCriticalSection> writerLock(this->WriterAccessMutex);
+  if (!this->EnableCapturing)
+  {
+    return PLUS_SUCCESS;
+  }
+
+  int nbFramesBefore = this->RecordedFrames->GetNumberOfTrackedFrames();
+  this->SampleFrames(frames, firstFrameIndex, lastFrameIndex, inputFramePeriodSec);
+  return this->RecordNewFrames(nbFramesBefore, this->RecordedFrames->GetNumberOfTrackedFrames());
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualCapture::RecordNewFrames(int nbFramesBefore, int nbFramesAfter)
+{
+  // If the writer thread cannot keep up then limit the number of frames that are waiting in memory
+  if (this->MaxNumberOfQueuedFrames > 0 && nbFramesAfter > this->MaxNumberOfQueuedFrames && nbFramesAfter > nbFramesBefore)
+  {
+    int firstDroppedFrameIndex = std::max(nbFramesBefore, this->MaxNumberOfQueuedFrames);
+    this->RecordedFrames->RemoveTrackedFrameRange(firstDroppedFrameIndex, nbFramesAfter - 1);
+    this->NumberOfDroppedFrames += nbFramesAfter - firstDroppedFrameIndex;
+    LOG_WARNING(this->GetDeviceId() << ": Writing to disk cannot keep up with the acquisition. Dropped " << nbFramesAfter - firstDroppedFrameIndex
+                << " frames (" << this->NumberOfDroppedFrames << " in total since the file was opened).");
+    nbFramesAfter = firstDroppedFrameIndex;
+  }
+  if (this->EnablePassThroughRecording && nbFramesAfter > nbFramesBefore)
+  {
+    this->RecordSourceBitstreams(nbFramesBefore, nbFramesAfter);
+  }
+  for (int frameIndex = nbFramesBefore; frameIndex < nbFramesAfter; ++frameIndex)
+  {
+    this->RecordedFramesBytes += GetTrackedFrameSizeInBytes(this->RecordedFrames->GetTrackedFrame(frameIndex));
+  }
+
+  // Compute the average frame rate from the ratio of recently acquired frames
+  int frame1Index = this->RecordedFrames->GetNumberOfTrackedFrames() - 1; // index of the latest frame
+  int frame2Index = frame1Index - this->RequestedFrameRate * 5.0 - 1; // index of an earlier acquired frame (go back by approximately 5 seconds + one frame)
+  if (frame2Index < this->FirstFrameIndexInThisSegment)
+  {
+    // make sure we stay in the current recording segment
+    frame2Index = this->FirstFrameIndexInThisSegment;
+  }
+  if (frame1Index > frame2Index)
+  {
+    igsioTrackedFrame* frame1 = this->RecordedFrames->GetTrackedFrame(frame1Index);
+    igsioTrackedFrame* frame2 = this->RecordedFrames->GetTrackedFrame(frame2Index);
+    if (frame1 != NULL && frame2 != NULL)
+    {
+      double frameTimeDiff = frame1->GetTimestamp() - frame2->GetTimestamp();
+      if (frameTimeDiff > 0)
+      {
+        this->ActualFrameRate = (frame1Index - frame2Index) / frameTimeDiff;
+      }
+      else
+      {
+        this->ActualFrameRate = 0;
+      }
+    }
+  }
+
+  if (this->WriteFrames() != PLUS_SUCCESS)
+  {
+    LOG_ERROR(this->GetDeviceId() << ": Unable to write " << nbFramesAfter - nbFramesBefore << " frames.");
+    return PLUS_FAIL;
+  }
+
+  this->TotalFramesRecorded += nbFramesAfter - nbFramesBefore;
+
+  return PLUS_SUCCESS;
+}
+
 //-----------------------------------------------------------------------------
 PlusStatus vtkPlusVirtualCapture::NotifyConfigured()
 {
@@ -450,13 +911,369 @@ PlusStatus vtkPlusVirtualCapture::NotifyConfigured()
 //-----------------------------------------------------------------------------
 bool vtkPlusVirtualCapture::HasUnsavedData() const
 {
-  return this->IsHeaderPrepared;
+  if (this->IsHeaderPrepared || this->RecordedFrames->GetNumberOfTrackedFrames() != 0)
+  {
+    return true;
+  }
+  for (std::vector<vtkSmartPointer<vtkPlusVirtualCapture> >::const_iterator recordingIt = this->SecondaryRecordings.begin(); recordingIt != this->SecondaryRecordings.end(); ++recordingIt)
+  {
+    if ((*recordingIt)->HasUnsavedData())
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+//-----------------------------------------------------------------------------
+long vtkPlusVirtualCapture::GetNumberOfDroppedFrames() const
+{
+  return this->NumberOfDroppedFrames;
+}
+
+//-----------------------------------------------------------------------------
+unsigned long long vtkPlusVirtualCapture::GetNumberOfQueuedBytes() const
+{
+  return this->RecordedFramesBytes + this->WritingFramesBytes;
+}
+
+//-----------------------------------------------------------------------------
+unsigned long long vtkPlusVirtualCapture::GetInternalMemoryUsageInBytes()
+{
+  unsigned long long usedBytes = this->GetNumberOfQueuedBytes();
+  for (std::vector<vtkSmartPointer<vtkPlusVirtualCapture> >::iterator it = this->SecondaryRecordings.begin(); it != this->SecondaryRecordings.end(); ++it)
+  {
+    usedBytes += (*it)->GetInternalMemoryUsageInBytes();
+  }
+  return usedBytes;
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualCapture::StartRetroactiveCapture(double durationSec, const std::string& filename /* = "" */)
+{
+  if (durationSec <= 0)
+  {
+    LOG_ERROR(this->GetDeviceId() << ": Invalid retroactive capture duration: " << durationSec << " sec");
+    return PLUS_FAIL;
+  }
+  if (this->OutputChannels.empty())
+  {
+    LOG_ERROR("No output channels defined");
+    return PLUS_FAIL;
+  }
+  if (this->IsRetroactiveCaptureActive())
+  {
+    LOG_ERROR(this->GetDeviceId() << ": Cannot start retroactive capture, the previous one is still in progress.");
+    return PLUS_FAIL;
+  }
+  // The result of the previous capture has been reported already
+  this->WaitForRetroactiveCapture();
+
+  // The items of the video source define the frames, otherwise the items of the first tool
+  vtkPlusChannel* inputChannel = this->OutputChannels[0];
+  vtkPlusDataSource* source = NULL;
+  const bool hasVideo = (inputChannel->GetVideoSource(source) == PLUS_SUCCESS);
+  if (!hasVideo && inputChannel->ToolCount() > 0)
+  {
+    source = inputChannel->GetToolsStartIterator()->second;
+  }
+  if (source == NULL)
+  {
+    LOG_ERROR(this->GetDeviceId() << ": Cannot start retroactive capture, the input channel has no video or tool source.");
+    return PLUS_FAIL;
+  }
+
+  std::shared_ptr<PlusBufferSnapshot> snapshot = std::make_shared<PlusBufferSnapshot>();
+  if (source->CaptureSnapshot(*snapshot) != PLUS_SUCCESS || snapshot->GetNumberOfItems() < 1)
+  {
+    LOG_ERROR(this->GetDeviceId() << ": Cannot start retroactive capture, no data is available in the buffer of " << source->GetId());
+    return PLUS_FAIL;
+  }
+
+  // Find the first item of the requested time window
+  double latestTimestamp(0);
+  snapshot->GetTimeStamp(snapshot->GetLatestItemUid(), latestTimestamp);
+  BufferItemUidType firstItemUid = snapshot->GetOldestItemUid();
+  double itemTimestamp(0);
+  while (firstItemUid < snapshot->GetLatestItemUid() && snapshot->GetTimeStamp(firstItemUid, itemTimestamp) == ITEM_OK && itemTimestamp < latestTimestamp - durationSec)
+  {
+    ++firstItemUid;
+  }
+  snapshot->GetTimeStamp(firstItemUid, itemTimestamp);
+  if (firstItemUid == snapshot->GetOldestItemUid() && latestTimestamp - itemTimestamp < durationSec)
+  {
+    LOG_INFO(this->GetDeviceId() << ": Only the last " << latestTimestamp - itemTimestamp << " sec of the requested " << durationSec << " sec are available in the buffer.");
+  }
+
+  std::string retroactiveFilename = filename;
+  if (retroactiveFilename.empty())
+  {
+    std::string ext = igsioCommon::GetSequenceFilenameExtension(this->BaseFilename);
+    if (ext.empty())
+    {
+      ext = ".nrrd";
+    }
+    retroactiveFilename = igsioCommon::GetSequenceFilenameWithoutExtension(this->BaseFilename) + "_Retroactive_" + vtksys::SystemTools::GetCurrentDateTime("%Y%m%d_%H%M%S") + ext;
+  }
+  this->RetroactiveCaptureFilename = vtkPlusConfig::GetInstance()->GetOutputPath(retroactiveFilename);
+  this->RetroactiveCaptureNumberOfFrames = static_cast<int>(snapshot->GetLatestItemUid() + 1 - firstItemUid);
+  this->RetroactiveCaptureFramesWritten = 0;
+  this->RetroactiveCaptureThroughputMBps = 0.0;
+
+  LOG_INFO(this->GetDeviceId() << ": Retroactive capture of " << this->RetroactiveCaptureNumberOfFrames.load() << " frames to " << this->RetroactiveCaptureFilename << " started.");
+  const std::string outputFilename = this->RetroactiveCaptureFilename;
+  this->RetroactiveCaptureResult = PlusWorkerPool::GetInstance().Submit([this, snapshot, firstItemUid, hasVideo, outputFilename]()
+  {
+    return this->WriteRetroactiveCapture(snapshot, firstItemUid, hasVideo, outputFilename);
+  });
+  return PLUS_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+bool vtkPlusVirtualCapture::IsRetroactiveCaptureActive() const
+{
+  return this->RetroactiveCaptureResult.valid()
+         && this->RetroactiveCaptureResult.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualCapture::WaitForRetroactiveCapture()
+{
+  if (!this->RetroactiveCaptureResult.valid())
+  {
+    return PLUS_SUCCESS;
+  }
+  PlusWorkerPool::GetInstance().Wait(this->RetroactiveCaptureResult);
+  return this->RetroactiveCaptureResult.get();
+}
+
+//-----------------------------------------------------------------------------
+std::string vtkPlusVirtualCapture::GetRetroactiveCaptureFilename() const
+{
+  return this->RetroactiveCaptureFilename;
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualCapture::WriteRetroactiveCapture(std::shared_ptr<PlusBufferSnapshot> snapshot, BufferItemUidType firstItemUid, bool hasVideo, std::string filename)
+{
+  vtkPlusChannel* inputChannel = this->OutputChannels[0];
+  const int numberOfFrames = static_cast<int>(snapshot->GetLatestItemUid() + 1 - firstItemUid);
+
+  vtkSmartPointer<vtkIGSIOSequenceIOBase> writer = vtkSmartPointer<vtkIGSIOSequenceIOBase>::Take(vtkIGSIOSequenceIO::CreateSequenceHandlerForFile(filename));
+  if (writer == NULL)
+  {
+    LOG_ERROR("Could not create writer for file: " << filename);
+    return PLUS_FAIL;
+  }
+  vtkSmartPointer<vtkIGSIOTrackedFrameList> frames = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+  frames->SetValidationRequirements(REQUIRE_UNIQUE_TIMESTAMP);
+  // Metaimage files cannot be written compressed (see OpenFile)
+  writer->SetUseCompression(this->EnableFileCompression && !vtkIGSIOMetaImageSequenceIO::CanWriteFile(filename));
+  writer->SetTrackedFrameList(frames);
+  writer->SetFileName(filename);
+
+  const double startTimeSec = vtkIGSIOAccurateTimer::GetSystemTime();
+  double lastReportTimeSec = startTimeSec;
+  unsigned long long bytesWritten(0);
+  int framesWritten(0);
+  bool headerPrepared(false);
+  bool isData3D(false);
+  PlusStatus status = PLUS_SUCCESS;
+  for (int batchStart = 0; batchStart < numberOfFrames; batchStart += RETROACTIVE_CAPTURE_BATCH_SIZE)
+  {
+    const int batchSize = std::min(RETROACTIVE_CAPTURE_BATCH_SIZE, numberOfFrames - batchStart);
+    std::vector<igsioTrackedFrame*> trackedFrames;
+    PlusTrackedFrameAssembly::AssembleFrames(batchSize, [&](int frameIndex, igsioTrackedFrame & trackedFrame)
+    {
+      const BufferItemUidType itemUid = firstItemUid + batchStart + frameIndex;
+      double itemTimestamp(0);
+      if (snapshot->GetTimeStamp(itemUid, itemTimestamp) != ITEM_OK)
+      {
+        return PLUS_FAIL;
+      }
+      // Tool transforms and fields are interpolated from the live buffers, missing ones are reported by the channel
+      inputChannel->GetTrackedFrame(itemTimestamp, trackedFrame, false);
+      if (hasVideo)
+      {
+        StreamBufferItem videoItem;
+        if (snapshot->GetStreamBufferItem(itemUid, &videoItem) != ITEM_OK)
+        {
+          LOG_ERROR("Couldn't get video buffer item by frame UID: " << itemUid);
+          return PLUS_FAIL;
+        }
+        trackedFrame.SetImageData(videoItem.GetFrame());
+        const igsioFieldMapType& fieldMap = videoItem.GetFrameFieldMap();
+        for (igsioFieldMapType::const_iterator fieldIterator = fieldMap.begin(); fieldIterator != fieldMap.end(); ++fieldIterator)
+        {
+          trackedFrame.SetFrameField(fieldIterator->first, fieldIterator->second.second, fieldIterator->second.first);
+        }
+      }
+      trackedFrame.SetTimestamp(itemTimestamp);
+      return PLUS_SUCCESS;
+    }, trackedFrames);
+    if (PlusTrackedFrameAssembly::TakeFrames(trackedFrames, frames, vtkIGSIOTrackedFrameList::SKIP_INVALID_FRAME) != PLUS_SUCCESS)
+    {
+      LOG_WARNING(this->GetDeviceId() << ": Some frames could not be added to the retroactive capture.");
+    }
+    if (frames->GetNumberOfTrackedFrames() == 0)
+    {
+      continue;
+    }
+
+    if (!headerPrepared)
+    {
+      isData3D = frames->GetTrackedFrame(0)->GetFrameSize()[2] > 1;
+      if (writer->PrepareHeader() != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Unable to prepare header");
+        return PLUS_FAIL;
+      }
+      headerPrepared = true;
+    }
+    for (unsigned int frameIndex = 0; frameIndex < frames->GetNumberOfTrackedFrames(); ++frameIndex)
+    {
+      bytesWritten += GetTrackedFrameSizeInBytes(frames->GetTrackedFrame(frameIndex));
+    }
+    if (writer->AppendImagesToHeader() != PLUS_SUCCESS || writer->WriteImages() != PLUS_SUCCESS)
+    {
+      LOG_ERROR(this->GetDeviceId() << ": Unable to write the retroactive capture to " << filename);
+      status = PLUS_FAIL;
+      break;
+    }
+    framesWritten += frames->GetNumberOfTrackedFrames();
+    frames->Clear();
+
+    this->RetroactiveCaptureFramesWritten = batchStart + batchSize;
+    const double currentTimeSec = vtkIGSIOAccurateTimer::GetSystemTime();
+    if (currentTimeSec > startTimeSec)
+    {
+      this->RetroactiveCaptureThroughputMBps = bytesWritten / (1024.0 * 1024.0) / (currentTimeSec - startTimeSec);
+    }
+    if (currentTimeSec - lastReportTimeSec >= RETROACTIVE_CAPTURE_REPORT_PERIOD_SEC)
+    {
+      LOG_INFO(this->GetDeviceId() << ": Retroactive capture: " << this->RetroactiveCaptureFramesWritten.load() << " of " << numberOfFrames
+               << " frames written (" << std::fixed << std::setprecision(1) << this->RetroactiveCaptureThroughputMBps.load() << " MB/s)");
+      lastReportTimeSec = currentTimeSec;
+    }
+  }
+
+  if (!headerPrepared)
+  {
+    LOG_ERROR(this->GetDeviceId() << ": No frames could be written to the retroactive capture.");
+    return PLUS_FAIL;
+  }
+  if (status != PLUS_SUCCESS)
+  {
+    writer->Discard();
+    return PLUS_FAIL;
+  }
+
+  writer->UpdateDimensionsCustomStrings(framesWritten, isData3D);
+  writer->UpdateFieldInImageHeader(writer->GetDimensionSizeString());
+  writer->UpdateFieldInImageHeader(writer->GetDimensionKindsString());
+  writer->FinalizeHeader();
+  writer->Close();
+
+  LOG_INFO(this->GetDeviceId() << ": Retroactive capture of " << framesWritten << " frames written to " << filename
+           << " (" << std::fixed << std::setprecision(1) << this->RetroactiveCaptureThroughputMBps.load() << " MB/s)");
+  return PLUS_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualCapture::RecordSourceBitstreams(int firstFrameIndex, int lastFrameIndex)
+{
+  vtkPlusDataSource* videoSource = NULL;
+  if (this->OutputChannels.empty() || this->OutputChannels[0]->GetVideoSource(videoSource) != PLUS_SUCCESS)
+  {
+    // There is no bitstream without video
+    return PLUS_SUCCESS;
+  }
+
+  for (int frameIndex = firstFrameIndex; frameIndex < lastFrameIndex; ++frameIndex)
+  {
+    igsioTrackedFrame* trackedFrame = this->RecordedFrames->GetTrackedFrame(frameIndex);
+    BufferItemUidType itemUid(0);
+    StreamBufferItem::SourceBitstreamPtr sourceBitstream;
+    if (trackedFrame == NULL
+        || videoSource->GetItemUidFromTime(trackedFrame->GetTimestamp(), itemUid) != ITEM_OK
+        || videoSource->GetSourceBitstream(itemUid, sourceBitstream) != ITEM_OK
+        || sourceBitstream == nullptr || sourceBitstream->Data.empty())
+    {
+      // Only the decoded frame is recorded
+      continue;
+    }
+
+    if (!this->SourceBitstreamFile.is_open())
+    {
+      this->SourceBitstreamCodecFourCC = sourceBitstream->CodecFourCC;
+      std::string sequenceFilename = this->UnbufferedWriter ? this->UnbufferedWriter->GetFilename() : std::string(this->Writer->GetFileName());
+      this->SourceBitstreamFilename = GetSourceBitstreamFilename(sequenceFilename, this->SourceBitstreamCodecFourCC);
+      this->SourceBitstreamFile.open(this->SourceBitstreamFilename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+      if (!this->SourceBitstreamFile.is_open())
+      {
+        LOG_ERROR(this->GetDeviceId() << ": Failed to open source bitstream file " << this->SourceBitstreamFilename);
+        return PLUS_FAIL;
+      }
+      this->SourceBitstreamFileSize = 0;
+    }
+    else if (sourceBitstream->CodecFourCC != this->SourceBitstreamCodecFourCC)
+    {
+      LOG_WARNING(this->GetDeviceId() << ": Source bitstream codec changed from " << this->SourceBitstreamCodecFourCC << " to " << sourceBitstream->CodecFourCC
+                  << ", the bitstream of the frame is not recorded.");
+      continue;
+    }
+
+    const std::vector<unsigned char>& data = sourceBitstream->Data;
+    this->SourceBitstreamFile.write(reinterpret_cast<const char*>(&data[0]), data.size());
+    if (!this->SourceBitstreamFile)
+    {
+      LOG_ERROR(this->GetDeviceId() << ": Failed to write source bitstream file " << this->SourceBitstreamFilename);
+      return PLUS_FAIL;
+    }
+    trackedFrame->SetFrameField("SourceBitstreamOffset", igsioCommon::ToString<unsigned long long>(this->SourceBitstreamFileSize));
+    trackedFrame->SetFrameField("SourceBitstreamSize", igsioCommon::ToString<size_t>(data.size()));
+    this->SourceBitstreamFileSize += data.size();
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualCapture::CloseSourceBitstreamFile(const std::string& sequenceFilename)
+{
+  if (!this->SourceBitstreamFile.is_open())
+  {
+    return PLUS_SUCCESS;
+  }
+  this->SourceBitstreamFile.close();
+
+  PlusStatus status = PLUS_SUCCESS;
+  if (sequenceFilename.empty())
+  {
+    vtksys::SystemTools::RemoveFile(this->SourceBitstreamFilename);
+  }
+  else
+  {
+    // The sequence file may have been renamed when it was closed
+    std::string filename = GetSourceBitstreamFilename(sequenceFilename, this->SourceBitstreamCodecFourCC);
+    if (filename != this->SourceBitstreamFilename && !vtksys::SystemTools::RenameFile(this->SourceBitstreamFilename, filename))
+    {
+      LOG_ERROR(this->GetDeviceId() << ": Failed to rename source bitstream file " << this->SourceBitstreamFilename << " to " << filename);
+      status = PLUS_FAIL;
+    }
+  }
+
+  this->SourceBitstreamFilename.clear();
+  this->SourceBitstreamCodecFourCC.clear();
+  this->SourceBitstreamFileSize = 0;
+  return status;
 }
 
 //-----------------------------------------------------------------------------
 PlusStatus vtkPlusVirtualCapture::ClearRecordedFrames()
 {
   this->RecordedFrames->Clear();
+  this->RecordedFramesBytes = 0;
 
   return PLUS_SUCCESS;
 }
@@ -472,7 +1289,9 @@ void vtkPlusVirtualCapture::SetEnableFileCompression(bool aFileCompression)
 {
   if (this->Writer != NULL)
   {
-    this->Writer->SetUseCompression(aFileCompression);
+    this->WaitForBackgroundWrite();
+    this->CompressFileOnClose = aFileCompression && (this->NumberOfCompressionThreads != 1 || this->EnableFrameIndex) && vtkPlusSequenceIO::CanCompressInParallel(this->CurrentFilename);
+    this->Writer->SetUseCompression(aFileCompression && !this->CompressFileOnClose);
   }
 
   this->EnableFileCompression = aFileCompression;
@@ -489,9 +1308,15 @@ void vtkPlusVirtualCapture::SetEnableCapturing(bool aValue)
     this->TimeWaited = 0.0;
     this->LastAlreadyRecordedFrameTimestamp = UNDEFINED_TIMESTAMP;
     this->NextFrameToBeRecordedTimestamp = 0.0;
+    this->NextSampledFrameTimestamp = UNDEFINED_TIMESTAMP;
     this->FirstFrameIndexInThisSegment = this->RecordedFrames->GetNumberOfTrackedFrames();
     this->RecordingStartTime = vtkIGSIOAccurateTimer::GetSystemTime(); // reset the starting time for the grace period
   }
+
+  for (std::vector<vtkSmartPointer<vtkPlusVirtualCapture> >::iterator recordingIt = this->SecondaryRecordings.begin(); recordingIt != this->SecondaryRecordings.end(); ++recordingIt)
+  {
+    (*recordingIt)->SetEnableCapturing(aValue);
+  }
 }
 
 //-----------------------------------------------------------------------------
@@ -501,16 +1326,27 @@ PlusStatus vtkPlusVirtualCapture::Reset()
     igsioLockGuard<vtkIGSIORecursiveCriticalSection> writerLock(this->WriterAccessMutex);
 
     this->SetEnableCapturing(false);
+    this->WaitForBackgroundWrite();
 
     if (this->IsHeaderPrepared)
     {
-      this->Writer->Discard();
+      if (this->UnbufferedWriter)
+      {
+        this->UnbufferedWriter->Discard();
+      }
+      else
+      {
+        this->Writer->Discard();
+      }
     }
+    this->CloseSourceBitstreamFile("");
 
     this->ClearRecordedFrames();
     this->Writer->GetTrackedFrameList()->Clear();
+    this->WritingFramesBytes = 0;
     this->IsHeaderPrepared = false;
     this->TotalFramesRecorded = 0;
+    this->NumberOfDroppedFrames = 0;
   }
 
   if (this->OpenFile() != PLUS_SUCCESS)
@@ -519,6 +1355,14 @@ PlusStatus vtkPlusVirtualCapture::Reset()
     return PLUS_FAIL;
   }
 
+  for (std::vector<vtkSmartPointer<vtkPlusVirtualCapture> >::iterator recordingIt = this->SecondaryRecordings.begin(); recordingIt != this->SecondaryRecordings.end(); ++recordingIt)
+  {
+    if ((*recordingIt)->Reset() != PLUS_SUCCESS)
+    {
+      return PLUS_FAIL;
+    }
+  }
+
   this->LastUpdateTime = vtkIGSIOAccurateTimer::GetSystemTime();
 
   return PLUS_SUCCESS;
@@ -583,6 +1427,7 @@ PlusStatus vtkPlusVirtualCapture::TakeSnapshot()
     LOG_WARNING(this->GetDeviceId() << ": Frame could not be added because validation failed");
     return PLUS_FAIL;
   }
+  this->RecordedFramesBytes += GetTrackedFrameSizeInBytes(&trackedFrame);
 
   if (this->WriteFrames() != PLUS_SUCCESS)
   {
@@ -598,15 +1443,18 @@ PlusStatus vtkPlusVirtualCapture::TakeSnapshot()
 //-----------------------------------------------------------------------------
 PlusStatus vtkPlusVirtualCapture::WriteFrames(bool force)
 {
-  if (!this->IsHeaderPrepared && this->RecordedFrames->GetNumberOfTrackedFrames() != 0)
+  PLUS_PROFILE_ZONE("vtkPlusVirtualCapture::WriteFrames");
+  if (force)
   {
-    if (this->Writer->PrepareHeader() != PLUS_SUCCESS)
-    {
-      LOG_ERROR("Unable to prepare header");
-      this->StopRecording();
-      return PLUS_FAIL;
-    }
-    this->IsHeaderPrepared = true;
+    this->WaitForBackgroundWrite();
+  }
+
+  if (this->BackgroundWriteFailed)
+  {
+    this->BackgroundWriteFailed = false;
+    LOG_ERROR("Unable to write images in the background. Stopping recording at timestamp: " << LastAlreadyRecordedFrameTimestamp);
+    this->StopRecording();
+    return PLUS_FAIL;
   }
 
   if (this->RecordedFrames->GetNumberOfTrackedFrames() == 0)
@@ -616,28 +1464,110 @@ PlusStatus vtkPlusVirtualCapture::WriteFrames(bool force)
 
   this->SetIsData3D(this->RecordedFrames->GetTrackedFrame(0)->GetFrameSize()[2] > 1);
 
-  if (force || !this->IsFrameBuffered() ||
-      (this->IsFrameBuffered() && this->RecordedFrames->GetNumberOfTrackedFrames() > this->GetFrameBufferSize()))
+  if (!force && this->IsFrameBuffered() && this->RecordedFrames->GetNumberOfTrackedFrames() <= this->GetFrameBufferSize())
   {
-    if (this->Writer->AppendImagesToHeader() != PLUS_SUCCESS)
+    return PLUS_SUCCESS;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(this->WriteRequestMutex);
+    if (this->WritePending)
     {
-      LOG_ERROR("Unable to append image data to header.");
-      this->StopRecording();
-      return PLUS_FAIL;
+      // The writer thread is still busy with the previous batch, keep collecting frames until it is done
+      return PLUS_SUCCESS;
     }
-    if (this->Writer->WriteImages() != PLUS_SUCCESS)
+  }
+
+  // Hand over the recorded frames to the writer and continue recording into the (empty) list of already written frames
+  std::swap(this->RecordedFrames, this->WritingFrames);
+  this->Writer->SetTrackedFrameList(this->WritingFrames);
+  this->WritingFramesBytes = this->RecordedFramesBytes.load();
+  this->RecordedFramesBytes = 0;
+  this->FirstFrameIndexInThisSegment = 0;
+
+  if (!this->IsHeaderPrepared)
+  {
+    if (this->UnbufferedWriter && GetTrackedFrameSizeInBytes(this->WritingFrames->GetTrackedFrame(0)) == 0)
     {
-      LOG_ERROR("Unable to append images. Stopping recording at timestamp: " << LastAlreadyRecordedFrameTimestamp);
+      // The size of the images must be known when the data file is created
+      LOG_INFO(this->GetDeviceId() << ": The recorded frames contain no image data, " << this->CurrentFilename << " is written with buffering.");
+      this->UnbufferedWriter.reset();
+    }
+    PlusStatus headerStatus = PLUS_SUCCESS;
+    if (this->UnbufferedWriter)
+    {
+      headerStatus = this->UnbufferedWriter->Open(vtkPlusConfig::GetInstance()->GetOutputPath(this->CurrentFilename));
+      this->CurrentFilename = PlusUnbufferedSequenceWriter::GetHeaderFilename(this->CurrentFilename);
+    }
+    else
+    {
+      headerStatus = this->Writer->PrepareHeader();
+    }
+    if (headerStatus != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Unable to prepare header");
+      this->WritingFrames->Clear();
+      this->WritingFramesBytes = 0;
       this->StopRecording();
       return PLUS_FAIL;
     }
+    this->IsHeaderPrepared = true;
+  }
 
-    this->ClearRecordedFrames();
+  bool handedOverToWriterThread = false;
+  {
+    std::lock_guard<std::mutex> lock(this->WriteRequestMutex);
+    if (!force && this->WriterThreadActive)
+    {
+      this->WritePending = true;
+      handedOverToWriterThread = true;
+    }
+  }
+  if (handedOverToWriterThread)
+  {
+    this->WriteRequestCondition.notify_all();
+    return PLUS_SUCCESS;
+  }
+
+  // Write immediately
+  if (this->WriteFramesToFile() != PLUS_SUCCESS)
+  {
+    this->StopRecording();
+    return PLUS_FAIL;
   }
 
   return PLUS_SUCCESS;
 }
 
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualCapture::WriteFramesToFile()
+{
+  PlusStatus status = PLUS_SUCCESS;
+  if (this->UnbufferedWriter)
+  {
+    if (this->UnbufferedWriter->WriteFrames(this->WritingFrames) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Unable to append images. Stopping recording at timestamp: " << LastAlreadyRecordedFrameTimestamp);
+      status = PLUS_FAIL;
+    }
+  }
+  else if (this->Writer->AppendImagesToHeader() != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to append image data to header.");
+    status = PLUS_FAIL;
+  }
+  else if (this->Writer->WriteImages() != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to append images. Stopping recording at timestamp: " << LastAlreadyRecordedFrameTimestamp);
+    status = PLUS_FAIL;
+  }
+
+  this->WritingFrames->Clear();
+  this->WritingFramesBytes = 0;
+
+  return status;
+}
+
 //-----------------------------------------------------------------------------
 int vtkPlusVirtualCapture::OutputChannelCount() const
 {
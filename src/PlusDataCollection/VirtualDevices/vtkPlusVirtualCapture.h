@@ -10,13 +10,35 @@ See License.txt for details.
 #include "vtkPlusDataCollectionExport.h"
 #include "vtkPlusDevice.h"
 #include "vtkIGSIOSequenceIOBase.h"
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 //class vtkIGSIOTrackedFrameList;
+class PlusBufferSnapshot;
+class PlusUnbufferedSequenceWriter;
 
 /*!
 \class vtkPlusVirtualCapture
-\brief
+\brief Records the frames of its input channel to a sequence file
+
+Frames are collected in the capture thread. Writing to disk is done by a dedicated writer thread: when a batch
+of frames is ready to be written, the list of recorded frames is swapped with the list of the writer, so the capture
+thread can keep collecting frames while the previous batch is written.
+
+The data that is already in the buffers of the input channel can be written to a separate file as well
+(see StartRetroactiveCapture), for example to save the last 30 seconds after something interesting happened.
+
+The same frames can be recorded to several files with different settings (e.g., full rate raw images, decimated
+compressed images, and tracking data only) by adding SecondaryRecording child elements to the device configuration.
+The frames are assembled from the buffers of the input channel only once per update, at the highest requested
+frame rate, and each recording takes a copy of the frames at its own RequestedFrameRate. Secondary recordings are
+started, stopped, and reset together with the device, their files are named from their own BaseFilename.
 
 \ingroup PlusLibDataCollection
 */
@@ -76,9 +98,54 @@ public:
   vtkGetMacro(EnableFileCompression, bool);
   void SetEnableFileCompression(bool aFileCompression);
 
+  /*!
+    Number of threads that compress the image data when the file is closed. 1 means the writer compresses the frames
+    in a single thread while they are recorded. Only nrrd files can be compressed by multiple threads.
+  */
+  vtkSetMacro(NumberOfCompressionThreads, int);
+  vtkGetMacro(NumberOfCompressionThreads, int);
+
+  /*! zlib compression level used by multi-threaded compression, from 1 (fastest) to 9 (smallest). -1 selects the default. */
+  vtkSetMacro(CompressionLevel, int);
+  vtkGetMacro(CompressionLevel, int);
+
+  /*! Write a frame index file next to the recorded file when it is closed, which allows reading any frame without reading the whole file */
+  vtkSetMacro(EnableFrameIndex, bool);
+  vtkGetMacro(EnableFrameIndex, bool);
+
   vtkGetStdStringMacro(EncodingFourCC);
   vtkSetStdStringMacro(EncodingFourCC)
 
+  /*!
+    Record the compressed bitstream that the video frames were decoded from (see vtkPlusDevice::KeepSourceBitstream)
+    as it is, without encoding the frames again. The bitstream is written next to the sequence file, to a file that
+    has the codec as extension (e.g., TrackedImageSequence_20170101_120000.mjpg). The SourceBitstreamOffset and
+    SourceBitstreamSize frame fields of the recorded frames locate the bitstream of each frame in that file.
+  */
+  vtkSetMacro(EnablePassThroughRecording, bool);
+  vtkGetMacro(EnablePassThroughRecording, bool);
+
+  /*!
+    Write the image data in large aligned blocks that bypass the file cache of the operating system (see
+    PlusUnbufferedSequenceWriter), for recording high data rates without stalling the acquisition. Only uncompressed
+    MetaImage and NRRD files can be written this way. The header is written to a separate file: .mha files are saved
+    as .mhd and .nrrd files as .nhdr, the image data is saved in a .raw file next to the header.
+  */
+  vtkSetMacro(EnableUnbufferedWrite, bool);
+  vtkGetMacro(EnableUnbufferedWrite, bool);
+
+  /*! Number of image data blocks that can be queued for writing without buffering */
+  vtkSetMacro(WriteQueueDepth, int);
+  vtkGetMacro(WriteQueueDepth, int);
+
+  /*! Disk space reserved for the image data when writing without buffering, in megabytes. 0 means no preallocation. */
+  vtkSetMacro(PreallocatedFileSizeMB, int);
+  vtkGetMacro(PreallocatedFileSizeMB, int);
+
+  /*! If disabled then only the timestamps, transforms, and fields of the frames are recorded, without image data */
+  vtkSetMacro(RecordImageData, bool);
+  vtkGetMacro(RecordImageData, bool);
+
   vtkSetMacro(EnableCapturingOnStart, bool);
   vtkGetMacro(EnableCapturingOnStart, bool);
 
@@ -87,6 +154,49 @@ public:
   vtkSetMacro(FrameBufferSize, unsigned int);
   vtkGetMacro(FrameBufferSize, unsigned int);
 
+  /*!
+    Maximum number of frames that are kept in memory while the writer thread is busy.
+    Frames acquired above this limit are dropped. 0 means there is no limit.
+  */
+  vtkSetMacro(MaxNumberOfQueuedFrames, int);
+  vtkGetMacro(MaxNumberOfQueuedFrames, int);
+
+  /*! Number of frames dropped since the file was opened, because the writer could not keep up with the acquisition */
+  long GetNumberOfDroppedFrames() const;
+
+  /*! Size of the image data of the frames that are recorded but not yet written to disk */
+  unsigned long long GetNumberOfQueuedBytes() const;
+
+  /*! Queued bytes of this device and of its secondary recordings */
+  virtual unsigned long long GetInternalMemoryUsageInBytes();
+
+  /*! Recordings that are written from the frames of this device with their own settings (see SecondaryRecording elements) */
+  int GetNumberOfSecondaryRecordings() const { return static_cast<int>(this->SecondaryRecordings.size()); }
+  vtkPlusVirtualCapture* GetSecondaryRecording(int index) { return this->SecondaryRecordings[index]; }
+
+  /*!
+    Write the data of the last durationSec seconds that is already in the buffers of the input channel to a new
+    sequence file, in the background. The recording of the device (if any) is not affected.
+    The video buffer is captured in a snapshot, so the frames of the window remain available while they are written,
+    even if the acquisition overwrites them in the buffer meanwhile. If filename is empty then the file name is
+    generated from BaseFilename. Only one retroactive capture can be in progress at a time.
+  */
+  PlusStatus StartRetroactiveCapture(double durationSec, const std::string& filename = "");
+
+  /*! Returns true while a retroactive capture is being written */
+  bool IsRetroactiveCaptureActive() const;
+
+  /*! Wait until the retroactive capture in progress is completed, returns its result (PLUS_SUCCESS if there was none) */
+  PlusStatus WaitForRetroactiveCapture();
+
+  /*! Progress of the last retroactive capture */
+  int GetNumberOfRetroactiveCaptureFrames() const { return this->RetroactiveCaptureNumberOfFrames; }
+  int GetNumberOfRetroactiveCaptureFramesWritten() const { return this->RetroactiveCaptureFramesWritten; }
+  /*! Average rate of writing the image data of the last retroactive capture, in megabytes per second */
+  double GetRetroactiveCaptureThroughputMBps() const { return this->RetroactiveCaptureThroughputMBps; }
+  /*! Full path of the file that the last retroactive capture is written to */
+  std::string GetRetroactiveCaptureFilename() const;
+
   virtual vtkPlusDataCollector* GetDataCollector() { return this->DataCollector; }
 
   virtual bool IsTracker() const { return false; }
@@ -108,16 +218,59 @@ protected:
 
   virtual bool IsFrameBuffered() const;
 
+  /*! Read and write the settings of a recording, from the device element or from a SecondaryRecording element */
+  PlusStatus ReadRecordingConfiguration(vtkXMLDataElement* recordingElement);
+  void WriteRecordingConfiguration(vtkXMLDataElement* recordingElement);
+
+  /*!
+    Add the frames in the [firstFrameIndex, lastFrameIndex) range of frames to the recorded frames at RequestedFrameRate.
+    inputFramePeriodSec is the sampling period of the frames, it determines the tolerance of the frame selection.
+  */
+  void SampleFrames(vtkIGSIOTrackedFrameList* frames, int firstFrameIndex, int lastFrameIndex, double inputFramePeriodSec);
+
+  /*! Record the sampled frames if capturing is enabled, used for feeding secondary recordings */
+  PlusStatus AddSampledFrames(vtkIGSIOTrackedFrameList* frames, int firstFrameIndex, int lastFrameIndex, double inputFramePeriodSec);
+
+  /*! Account for the frames that have been added to RecordedFrames in the [nbFramesBefore, nbFramesAfter) range and write them */
+  PlusStatus RecordNewFrames(int nbFramesBefore, int nbFramesAfter);
+
   /*!
     Copy frames to memory buffer or disk.
     If force flag is true then data is written to disk immediately.
   */
   virtual PlusStatus WriteFrames(bool force = false);
 
+  /*! Write the frames that have been handed over to the writer (WritingFrames) to disk */
+  PlusStatus WriteFramesToFile();
+
+  /*! Start and stop the thread that writes the frames to disk in the background */
+  PlusStatus StartWriterThread();
+  void StopWriterThread();
+
+  /*! Wait until the writer thread has written all the frames that have been handed over to it */
+  void WaitForBackgroundWrite();
+
+  static void* vtkWriterThread(vtkMultiThreader::ThreadInfo* data);
+
+  /*! Assemble the frames of the snapshot window and write them to the file, runs on the shared worker pool */
+  PlusStatus WriteRetroactiveCapture(std::shared_ptr<PlusBufferSnapshot> snapshot, BufferItemUidType firstItemUid, bool hasVideo, std::string filename);
+
+  /*! Write the source bitstream of the recorded frames in the specified index range to the bitstream file and add the frame fields that locate it */
+  PlusStatus RecordSourceBitstreams(int firstFrameIndex, int lastFrameIndex);
+
+  /*!
+    Close the bitstream file. It is renamed to match the sequence file if the sequence file name is specified,
+    otherwise it is deleted.
+  */
+  PlusStatus CloseSourceBitstreamFile(const std::string& sequenceFilename);
+
 protected:
   /*! Recorded tracked frame list */
   vtkIGSIOTrackedFrameList* RecordedFrames;
 
+  /*! Frames that are being written to disk. This is the tracked frame list of the writer, it is swapped with RecordedFrames when a batch is ready. */
+  vtkIGSIOTrackedFrameList* WritingFrames;
+
   /*! Timestamp of last recorded frame (only frames that have more recent timestamp will be added) */
   double LastAlreadyRecordedFrameTimestamp;
 
@@ -156,6 +309,43 @@ protected:
   /*! When closing the file, re-read the data from file, and write it compressed */
   bool EnableFileCompression;
 
+  /*! Multi-threaded compression settings */
+  int NumberOfCompressionThreads;
+  int CompressionLevel;
+
+  /*! The writer writes uncompressed data, which is compressed by multiple threads when the file is closed */
+  bool CompressFileOnClose;
+
+  /*! Write a frame index file next to the recorded file when it is closed */
+  bool EnableFrameIndex;
+
+  /*! Record the source bitstream of the video frames next to the sequence file */
+  bool EnablePassThroughRecording;
+  /*! Bitstream file of the current recording, it is opened when the first frame with a source bitstream is recorded */
+  std::ofstream SourceBitstreamFile;
+  std::string SourceBitstreamFilename;
+  std::string SourceBitstreamCodecFourCC;
+  unsigned long long SourceBitstreamFileSize;
+
+  /*! Settings of writing without buffering */
+  bool EnableUnbufferedWrite;
+  int WriteQueueDepth;
+  int PreallocatedFileSizeMB;
+  /*! Writer of the current recording if it is written without buffering, it is used instead of Writer */
+  std::unique_ptr<PlusUnbufferedSequenceWriter> UnbufferedWriter;
+
+  /*! Record the image data of the frames, if disabled then only the tracking data and fields are recorded */
+  bool RecordImageData;
+
+  /*! Recordings that receive the frames assembled by this device */
+  std::vector<vtkSmartPointer<vtkPlusVirtualCapture> > SecondaryRecordings;
+
+  /*! Frames assembled for sampling by this device and its secondary recordings, if they cannot be assembled directly into RecordedFrames */
+  vtkSmartPointer<vtkIGSIOTrackedFrameList> AssembledFrames;
+
+  /*! Timestamp of the next frame to be taken by SampleFrames */
+  double NextSampledFrameTimestamp;
+
   /*! FourCC code represending the codec to use when writing the file*/
   std::string EncodingFourCC;
 
@@ -173,6 +363,28 @@ protected:
 
   unsigned int FrameBufferSize;
 
+  int MaxNumberOfQueuedFrames;
+
+  /*! Writer thread state, WritePending is set while the writer thread is writing WritingFrames */
+  int WriterThreadId;
+  bool WriterThreadActive;
+  bool WritePending;
+  std::mutex WriteRequestMutex;
+  std::condition_variable WriteRequestCondition;
+  std::atomic<bool> BackgroundWriteFailed;
+
+  /*! Back-pressure statistics */
+  std::atomic<unsigned long long> RecordedFramesBytes;
+  std::atomic<unsigned long long> WritingFramesBytes;
+  std::atomic<long> NumberOfDroppedFrames;
+
+  /*! Retroactive capture state, the result is available when the background task completes */
+  std::future<PlusStatus> RetroactiveCaptureResult;
+  std::string RetroactiveCaptureFilename;
+  std::atomic<int> RetroactiveCaptureNumberOfFrames;
+  std::atomic<int> RetroactiveCaptureFramesWritten;
+  std::atomic<double> RetroactiveCaptureThroughputMBps;
+
   bool IsData3D;
 
   /*! Mutex instance simultaneous access of writer (writer may be accessed from command processing thread and also the internal update thread) */
@@ -6,6 +6,7 @@ See License.txt for details.
 
 // Local includes
 #include "PlusConfigure.h"
+#include "PlusPixelKernels.h"
 #include "vtkPlusChannel.h"
 #include "vtkPlusDataSource.h"
 #include "vtkPlusVirtualDeinterlacer.h"
@@ -18,8 +19,39 @@ See License.txt for details.
 #include <vtkImageData.h>
 #include <vtkObjectFactory.h>
 
+// STL includes
+#include <cstring>
+#include <utility>
+
 namespace
 {
+  //----------------------------------------------------------------------------
+  /*! Copy the even columns of an image to one image and the odd columns to the other, instantiated for the pixel size */
+  struct DeinterleaveColumnsFunctor
+  {
+    const unsigned char* InputPtr;
+    int Width;
+    int Height;
+    unsigned char* EvenPtr;
+    unsigned char* OddPtr;
+
+    template<class PixelType>
+    void Run() const
+    {
+      const PixelType* inputRow = reinterpret_cast<const PixelType*>(InputPtr);
+      PixelType* evenRow = reinterpret_cast<PixelType*>(EvenPtr);
+      PixelType* oddRow = reinterpret_cast<PixelType*>(OddPtr);
+      const int outputWidth = (Width + 1) / 2;
+      for (int row = 0; row < Height; row++)
+      {
+        PlusPixelKernels::DeinterleaveRow(inputRow, Width, evenRow, oddRow);
+        inputRow += Width;
+        evenRow += outputWidth;
+        oddRow += outputWidth;
+      }
+    }
+  };
+
   //----------------------------------------------------------------------------
   std::string ModeToString(vtkPlusVirtualDeinterlacer::StereoMode mode)
   {
@@ -66,6 +98,7 @@ vtkPlusVirtualDeinterlacer::vtkPlusVirtualDeinterlacer()
   , LeftImage(nullptr)
   , RightImage(nullptr)
   , SwitchInterlaceOrdering(false)
+  , EnableInPlaceWriting(true)
 {
   this->AcquisitionRate = 400; // Super fast!
   this->StartThreadForInternalUpdates = true;
@@ -109,6 +142,7 @@ PlusStatus vtkPlusVirtualDeinterlacer::ReadConfiguration(vtkXMLDataElement* root
   this->Mode = mode;
 
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(SwitchInterlaceOrdering, deviceConfig);
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(EnableInPlaceWriting, deviceConfig);
 
   return PLUS_SUCCESS;
 }
@@ -121,6 +155,7 @@ PlusStatus vtkPlusVirtualDeinterlacer::WriteConfiguration(vtkXMLDataElement* roo
   deviceConfig->SetAttribute("StereoMode", ModeToString(this->Mode).c_str());
 
   XML_WRITE_BOOL_ATTRIBUTE(SwitchInterlaceOrdering, deviceConfig);
+  XML_WRITE_BOOL_ATTRIBUTE(EnableInPlaceWriting, deviceConfig);
 
   return PLUS_SUCCESS;
 }
@@ -170,76 +205,130 @@ PlusStatus vtkPlusVirtualDeinterlacer::InternalUpdate()
     this->Initialized = true;
   }
 
+  // The input frames are only read, so their image data is shared with the input buffer
   this->FrameList->Clear();
-  if (this->InputChannels[0]->GetTrackedFrameList(this->LastInputTimestamp, this->FrameList, 100) != PLUS_SUCCESS)
+  if (this->InputChannels[0]->GetTrackedFrameList(this->LastInputTimestamp, this->FrameList, 100, true) != PLUS_SUCCESS)
   {
     return PLUS_FAIL;
   }
 
   for (auto frame : *this->FrameList)
   {
-    if (this->Mode == Stereo_HorizontalInterlace)
+    if (this->SplitFrameInPlace(frame) == PLUS_SUCCESS)
     {
-      this->SplitFrameHorizontal(frame);
-    }
-    else if (this->Mode == Stereo_VerticalInterlace)
-    {
-      this->SplitFrameVertical(frame);
+      this->FrameNumber++;
+      continue;
     }
 
+    this->SplitFrame(frame, static_cast<unsigned char*>(this->LeftImage->GetScalarPointer()), static_cast<unsigned char*>(this->RightImage->GetScalarPointer()));
     this->LeftSource->AddItem(this->LeftImage, this->LeftSource->GetInputImageOrientation(), this->LeftSource->GetImageType(), this->FrameNumber);
     this->RightSource->AddItem(this->RightImage, this->RightSource->GetInputImageOrientation(), this->RightSource->GetImageType(), this->FrameNumber);
     this->FrameNumber++;
   }
+  this->FrameList->Clear();
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualDeinterlacer::SplitFrameInPlace(igsioTrackedFrame* frame)
+{
+  if (!this->EnableInPlaceWriting)
+  {
+    return PLUS_FAIL;
+  }
+
+  const vtkIdType outputFrameSizeInBytes = this->LeftImage->GetNumberOfPoints() * this->LeftImage->GetNumberOfScalarComponents() * this->LeftImage->GetScalarSize();
+  igsioVideoFrame* leftFrame = NULL;
+  if (this->LeftSource->AcquireWritableFrame(leftFrame) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  igsioVideoFrame* rightFrame = NULL;
+  if (this->RightSource->AcquireWritableFrame(rightFrame) != PLUS_SUCCESS)
+  {
+    this->LeftSource->ReleaseWritableFrame();
+    return PLUS_FAIL;
+  }
+  if (leftFrame->GetFrameSizeInBytes() < outputFrameSizeInBytes || rightFrame->GetFrameSizeInBytes() < outputFrameSizeInBytes)
+  {
+    LOG_DEBUG("Output buffer frames are smaller than the deinterlaced images, in-place writing is not possible");
+    this->LeftSource->ReleaseWritableFrame();
+    this->RightSource->ReleaseWritableFrame();
+    return PLUS_FAIL;
+  }
 
+  this->SplitFrame(frame, static_cast<unsigned char*>(leftFrame->GetScalarPointer()), static_cast<unsigned char*>(rightFrame->GetScalarPointer()));
+
+  // A failed commit releases the frame in the buffer, the frame is not added again by the caller
+  if (this->LeftSource->CommitWritableFrame(this->FrameNumber) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to add deinterlaced left image to the buffer");
+  }
+  if (this->RightSource->CommitWritableFrame(this->FrameNumber) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to add deinterlaced right image to the buffer");
+  }
   return PLUS_SUCCESS;
 }
 
 //----------------------------------------------------------------------------
-void vtkPlusVirtualDeinterlacer::SplitFrameHorizontal(igsioTrackedFrame* frame)
+void vtkPlusVirtualDeinterlacer::SplitFrame(igsioTrackedFrame* frame, unsigned char* leftPtr, unsigned char* rightPtr)
+{
+  if (this->SwitchInterlaceOrdering)
+  {
+    std::swap(leftPtr, rightPtr);
+  }
+  if (this->Mode == Stereo_HorizontalInterlace)
+  {
+    this->SplitFrameHorizontal(frame, leftPtr, rightPtr);
+  }
+  else if (this->Mode == Stereo_VerticalInterlace)
+  {
+    this->SplitFrameVertical(frame, leftPtr, rightPtr);
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusVirtualDeinterlacer::SplitFrameHorizontal(igsioTrackedFrame* frame, unsigned char* evenPtr, unsigned char* oddPtr)
 {
   vtkImageData* inputImage = frame->GetImageData()->GetImage();
-  vtkIdType* inputIncrements = inputImage->GetIncrements();
-  unsigned char* inputPtr = (unsigned char*)inputImage->GetScalarPointer();
-  unsigned char* leftPtr = (unsigned char*)this->LeftImage->GetScalarPointer();
-  unsigned char* rightPtr = (unsigned char*)this->RightImage->GetScalarPointer();
-  vtkIdType* outputIncrements = this->LeftImage->GetIncrements();
-
-  // for each input row
-  for (vtkIdType row = 0; row < inputImage->GetDimensions()[1]; row++)
+  const unsigned char* inputPtr = static_cast<const unsigned char*>(inputImage->GetScalarPointer());
+  const int* dimensions = inputImage->GetDimensions();
+  // Input and output rows have the same length
+  const size_t rowSizeInBytes = static_cast<size_t>(dimensions[0]) * inputImage->GetNumberOfScalarComponents() * inputImage->GetScalarSize();
+
+  // Even rows go to one image, odd rows to the other
+  for (int row = 0; row < dimensions[1]; row++)
   {
-    // %2 = 0 left, %2 = 1 right
-    bool left(false);
     if (row % 2 == 0)
     {
-      left = true;
-    }
-    if (this->SwitchInterlaceOrdering)
-    {
-      left = !left;
-    }
-
-    // finished with this row,
-    // increment output image pointer for this row's image
-    if (left)
-    {
-      // Copy row to left image, increment left image pointer
-      memcpy(leftPtr, inputPtr, inputIncrements[1]);
-      leftPtr += outputIncrements[1];
+      memcpy(evenPtr, inputPtr, rowSizeInBytes);
+      evenPtr += rowSizeInBytes;
     }
     else
     {
-      memcpy(rightPtr, inputPtr, inputIncrements[1]);
-      rightPtr += outputIncrements[1];
+      memcpy(oddPtr, inputPtr, rowSizeInBytes);
+      oddPtr += rowSizeInBytes;
     }
-    inputPtr += inputIncrements[1];
+    inputPtr += rowSizeInBytes;
   }
 }
 
 //----------------------------------------------------------------------------
-void vtkPlusVirtualDeinterlacer::SplitFrameVertical(igsioTrackedFrame* frame)
+void vtkPlusVirtualDeinterlacer::SplitFrameVertical(igsioTrackedFrame* frame, unsigned char* evenPtr, unsigned char* oddPtr)
 {
+  vtkImageData* inputImage = frame->GetImageData()->GetImage();
+  const unsigned char* inputPtr = static_cast<const unsigned char*>(inputImage->GetScalarPointer());
+  const int* dimensions = inputImage->GetDimensions();
+  const int bytesPerPixel = inputImage->GetNumberOfScalarComponents() * inputImage->GetScalarSize();
 
+  // Even columns go to one image, odd columns to the other
+  DeinterleaveColumnsFunctor functor = { inputPtr, dimensions[0], dimensions[1], evenPtr, oddPtr };
+  if (PlusPixelKernels::DispatchPixelSize(bytesPerPixel, functor) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unsupported pixel size for deinterlacing: " << bytesPerPixel << " bytes");
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -57,9 +57,20 @@ public:
   vtkGetMacro(SwitchInterlaceOrdering, bool);
   vtkSetMacro(SwitchInterlaceOrdering, bool);
 
+  /*!
+    If enabled then the deinterlaced images are written directly into the output buffers, without intermediate images.
+    It is only possible if the output sources need no clipping or reorientation, otherwise the intermediate images are used.
+  */
+  vtkGetMacro(EnableInPlaceWriting, bool);
+  vtkSetMacro(EnableInPlaceWriting, bool);
+
 protected:
-  void SplitFrameHorizontal(igsioTrackedFrame* frame);
-  void SplitFrameVertical(igsioTrackedFrame* frame);
+  /*! Write the deinterlaced images of a frame directly into writable frames of the output buffers */
+  PlusStatus SplitFrameInPlace(igsioTrackedFrame* frame);
+  /*! Write the deinterlaced images of a frame to the given left and right image memory */
+  void SplitFrame(igsioTrackedFrame* frame, unsigned char* leftPtr, unsigned char* rightPtr);
+  void SplitFrameHorizontal(igsioTrackedFrame* frame, unsigned char* evenPtr, unsigned char* oddPtr);
+  void SplitFrameVertical(igsioTrackedFrame* frame, unsigned char* evenPtr, unsigned char* oddPtr);
 
 protected:
   vtkPlusVirtualDeinterlacer();
@@ -68,6 +79,7 @@ protected:
   StereoMode                                Mode;
   bool                                      Initialized;
   bool                                      SwitchInterlaceOrdering;
+  bool                                      EnableInPlaceWriting;
   double                                    LastInputTimestamp;
   vtkPlusDataSource*                        InputSource;
   vtkPlusDataSource*                        LeftSource;
@@ -201,6 +201,11 @@ PlusStatus vtkPlusVirtualMixer::NotifyConfigured()
     }
   }
 
+  // The tools of the input channels do not change after configuration, so the buffer lookups of the tools
+  // that are recorded by the same device are joined once here instead of in each GetTrackedFrame call
+  outputChannel->UpdateToolJoinPlan();
+  LOG_DEBUG("Mixer " << this->GetDeviceId() << " joins " << outputChannel->ToolCount() << " tools of " << this->InputChannels.size() << " input channels in " << outputChannel->GetNumberOfToolJoinGroups() << " buffer lookups");
+
   return PLUS_SUCCESS;
 }
 
@@ -0,0 +1,413 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "PlusAreaAverageResize.h"
+#include "vtkPlusChannel.h"
+#include "vtkPlusDataSource.h"
+#include "vtkPlusVirtualResampler.h"
+
+// IGSIO includes
+#include <igsioTrackedFrame.h>
+#include <igsioVideoFrame.h>
+#include <vtkIGSIOTrackedFrameList.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkObjectFactory.h>
+
+// STL includes
+#include <algorithm>
+#include <cstring>
+
+//----------------------------------------------------------------------------
+
+vtkStandardNewMacro(vtkPlusVirtualResampler);
+
+//----------------------------------------------------------------------------
+vtkPlusVirtualResampler::ResampledOutput::ResampledOutput()
+  : Source(nullptr)
+  , Scale(1.0)
+  , MaxRateHz(0.0)
+  , NextFrameTimestamp(0.0)
+  , Due(false)
+  , InPlace(false)
+  , Pixels(nullptr)
+{
+  this->FrameSize.fill(0);
+}
+
+//----------------------------------------------------------------------------
+vtkPlusVirtualResampler::vtkPlusVirtualResampler()
+  : vtkPlusDevice()
+  , EnableInPlaceWriting(true)
+  , LastInputTimestamp(UNDEFINED_TIMESTAMP)
+  , InputSource(nullptr)
+  , FrameList(vtkIGSIOTrackedFrameList::New())
+  , Initialized(false)
+  , InputPixelType(VTK_UNSIGNED_CHAR)
+  , InputNumberOfScalarComponents(1)
+{
+  this->InputFrameSize.fill(0);
+  this->AcquisitionRate = 400; // Process the input frames as soon as they arrive
+  this->StartThreadForInternalUpdates = true;
+}
+
+//----------------------------------------------------------------------------
+vtkPlusVirtualResampler::~vtkPlusVirtualResampler()
+{
+  this->FrameList->Delete();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusVirtualResampler::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "EnableInPlaceWriting: " << (this->EnableInPlaceWriting ? "TRUE" : "FALSE") << std::endl;
+  for (std::vector<ResampledOutput>::const_iterator it = this->Outputs.begin(); it != this->Outputs.end(); ++it)
+  {
+    os << indent << "Output " << it->SourceId << ": Scale=" << it->Scale << " MaxRateHz=" << it->MaxRateHz << std::endl;
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualResampler::ReadConfiguration(vtkXMLDataElement* rootConfigElement)
+{
+  XML_FIND_DEVICE_ELEMENT_REQUIRED_FOR_READING(deviceConfig, rootConfigElement);
+
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(EnableInPlaceWriting, deviceConfig);
+
+  this->Outputs.clear();
+  XML_FIND_NESTED_ELEMENT_REQUIRED(dataSourcesElement, deviceConfig, "DataSources");
+  for (int nestedElementIndex = 0; nestedElementIndex < dataSourcesElement->GetNumberOfNestedElements(); nestedElementIndex++)
+  {
+    vtkXMLDataElement* dataElement = dataSourcesElement->GetNestedElement(nestedElementIndex);
+    if (STRCASECMP(dataElement->GetName(), "DataSource") != 0
+        || dataElement->GetAttribute("Type") == NULL || STRCASECMP(dataElement->GetAttribute("Type"), "Video") != 0)
+    {
+      continue;
+    }
+
+    ResampledOutput output;
+    XML_READ_STRING_ATTRIBUTE_NONMEMBER_REQUIRED(Id, output.SourceId, dataElement);
+    XML_READ_SCALAR_ATTRIBUTE_NONMEMBER_OPTIONAL(double, Scale, output.Scale, dataElement);
+    if (output.Scale <= 0.0 || output.Scale > 1.0)
+    {
+      LOG_ERROR("Invalid Scale of resampler output " << output.SourceId << ": " << output.Scale << ". Only downscaling is supported, the value must be in the range (0, 1].");
+      return PLUS_FAIL;
+    }
+    XML_READ_SCALAR_ATTRIBUTE_NONMEMBER_OPTIONAL(double, MaxRateHz, output.MaxRateHz, dataElement);
+    this->Outputs.push_back(output);
+  }
+
+  // Larger outputs are computed first, so that smaller ones can be computed from them
+  std::stable_sort(this->Outputs.begin(), this->Outputs.end(),
+                   [](const ResampledOutput & a, const ResampledOutput & b) { return a.Scale > b.Scale; });
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualResampler::WriteConfiguration(vtkXMLDataElement* rootConfigElement)
+{
+  XML_FIND_DEVICE_ELEMENT_REQUIRED_FOR_WRITING(deviceConfig, rootConfigElement);
+
+  XML_WRITE_BOOL_ATTRIBUTE(EnableInPlaceWriting, deviceConfig);
+
+  XML_FIND_NESTED_ELEMENT_REQUIRED(dataSourcesElement, deviceConfig, "DataSources");
+  for (std::vector<ResampledOutput>::const_iterator it = this->Outputs.begin(); it != this->Outputs.end(); ++it)
+  {
+    vtkXMLDataElement* dataElement = dataSourcesElement->FindNestedElementWithNameAndAttribute("DataSource", "Id", it->SourceId.c_str());
+    if (dataElement == NULL)
+    {
+      continue;
+    }
+    dataElement->SetDoubleAttribute("Scale", it->Scale);
+    if (it->MaxRateHz > 0)
+    {
+      dataElement->SetDoubleAttribute("MaxRateHz", it->MaxRateHz);
+    }
+    else
+    {
+      XML_REMOVE_ATTRIBUTE("MaxRateHz", dataElement);
+    }
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualResampler::InternalUpdate()
+{
+  if (!this->InputChannels[0]->GetVideoDataAvailable())
+  {
+    return PLUS_SUCCESS;
+  }
+
+  // The input frames are only read, so their image data is shared with the input buffer
+  this->FrameList->Clear();
+  if (this->InputChannels[0]->GetTrackedFrameList(this->LastInputTimestamp, this->FrameList, 100, true) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+
+  PlusStatus status = PLUS_SUCCESS;
+  for (auto frame : *this->FrameList)
+  {
+    if (this->ResampleFrame(frame) != PLUS_SUCCESS)
+    {
+      status = PLUS_FAIL;
+    }
+  }
+  this->FrameList->Clear();
+
+  return status;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualResampler::InitializeOutputs(igsioVideoFrame* inputFrame)
+{
+  this->InputFrameSize = inputFrame->GetFrameSize();
+  this->InputPixelType = inputFrame->GetVTKScalarPixelType();
+  if (inputFrame->GetNumberOfScalarComponents(this->InputNumberOfScalarComponents) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to retrieve the number of scalar components of the input frames of " << this->GetDeviceId());
+    return PLUS_FAIL;
+  }
+
+  const std::array<int, 2> inputSize = { static_cast<int>(this->InputFrameSize[0]), static_cast<int>(this->InputFrameSize[1]) };
+  for (std::vector<ResampledOutput>::iterator output = this->Outputs.begin(); output != this->Outputs.end(); ++output)
+  {
+    std::array<int, 2> outputSize = PlusAreaAverageResize::GetOutputSize(inputSize, output->Scale);
+    output->FrameSize[0] = static_cast<unsigned int>(outputSize[0]);
+    output->FrameSize[1] = static_cast<unsigned int>(outputSize[1]);
+    output->FrameSize[2] = this->InputFrameSize[2];
+
+    // The input frames are in the orientation of the input buffer
+    output->Source->SetInputImageOrientation(this->InputSource->GetOutputImageOrientation());
+    output->Source->SetInputFrameSize(output->FrameSize);
+    output->Source->SetPixelType(this->InputPixelType);
+    output->Source->SetNumberOfScalarComponents(this->InputNumberOfScalarComponents);
+    output->Source->SetImageType(this->InputSource->GetImageType());
+
+    output->Image = vtkSmartPointer<vtkImageData>::New();
+    output->Image->SetDimensions(output->FrameSize[0], output->FrameSize[1], output->FrameSize[2]);
+    output->Image->AllocateScalars(this->InputPixelType, this->InputNumberOfScalarComponents);
+
+    LOG_DEBUG("Resampler output " << output->SourceId << ": " << output->FrameSize[0] << "x" << output->FrameSize[1] << "x" << output->FrameSize[2]);
+  }
+
+  this->Initialized = true;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusVirtualResampler::IsOutputDue(ResampledOutput& output, double timestamp)
+{
+  if (output.MaxRateHz <= 0)
+  {
+    return true;
+  }
+  const double period = 1.0 / output.MaxRateHz;
+  // Tolerate jitter of the input timestamps, so that e.g., every second frame of a 30 fps stream is kept at 15 fps
+  if (timestamp < output.NextFrameTimestamp - 0.25 * period)
+  {
+    return false;
+  }
+  output.NextFrameTimestamp += period;
+  if (output.NextFrameTimestamp <= timestamp)
+  {
+    // First frame or the input paused, restart the schedule from this frame
+    output.NextFrameTimestamp = timestamp + period;
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualResampler::ResampleFrame(igsioTrackedFrame* frame)
+{
+  igsioVideoFrame* inputFrame = frame->GetImageData();
+  if (!inputFrame->IsImageValid())
+  {
+    return PLUS_SUCCESS;
+  }
+
+  unsigned int numberOfScalarComponents = 1;
+  inputFrame->GetNumberOfScalarComponents(numberOfScalarComponents);
+  if (!this->Initialized || inputFrame->GetFrameSize() != this->InputFrameSize || inputFrame->GetVTKScalarPixelType() != this->InputPixelType
+      || numberOfScalarComponents != this->InputNumberOfScalarComponents)
+  {
+    if (this->InitializeOutputs(inputFrame) != PLUS_SUCCESS)
+    {
+      return PLUS_FAIL;
+    }
+  }
+
+  // Get the memory of the due outputs, from the output buffers when possible
+  const double timestamp = frame->GetTimestamp();
+  bool anyOutputDue = false;
+  for (std::vector<ResampledOutput>::iterator output = this->Outputs.begin(); output != this->Outputs.end(); ++output)
+  {
+    output->Due = this->IsOutputDue(*output, timestamp);
+    output->InPlace = false;
+    output->Pixels = nullptr;
+    if (!output->Due)
+    {
+      continue;
+    }
+    anyOutputDue = true;
+    igsioVideoFrame* writableFrame = nullptr;
+    if (this->EnableInPlaceWriting && output->Source->AcquireWritableFrame(writableFrame) == PLUS_SUCCESS)
+    {
+      const vtkIdType outputFrameSizeInBytes = output->Image->GetNumberOfPoints() * output->Image->GetNumberOfScalarComponents() * output->Image->GetScalarSize();
+      if (writableFrame->GetFrameSizeInBytes() >= outputFrameSizeInBytes)
+      {
+        output->InPlace = true;
+        output->Pixels = static_cast<unsigned char*>(writableFrame->GetScalarPointer());
+      }
+      else
+      {
+        LOG_DEBUG("Output buffer frames of " << output->SourceId << " are smaller than the resampled images, in-place writing is not possible");
+        output->Source->ReleaseWritableFrame();
+      }
+    }
+    if (!output->InPlace)
+    {
+      output->Pixels = static_cast<unsigned char*>(output->Image->GetScalarPointer());
+    }
+  }
+  if (!anyOutputDue)
+  {
+    return PLUS_SUCCESS;
+  }
+
+  // Compute each output from the smallest already computed image that it is an integer fraction of
+  const unsigned char* inputPixels = static_cast<const unsigned char*>(inputFrame->GetScalarPointer());
+  PlusStatus status = PLUS_SUCCESS;
+  for (std::vector<ResampledOutput>::iterator output = this->Outputs.begin(); output != this->Outputs.end(); ++output)
+  {
+    if (!output->Due)
+    {
+      continue;
+    }
+    const unsigned char* sourcePixels = inputPixels;
+    FrameSizeType sourceSize = this->InputFrameSize;
+    for (std::vector<ResampledOutput>::const_iterator computed = this->Outputs.begin(); computed != output; ++computed)
+    {
+      // The outputs are sorted by decreasing size, so the last matching output is the smallest one
+      if (computed->Due && computed->FrameSize[0] % output->FrameSize[0] == 0 && computed->FrameSize[1] % output->FrameSize[1] == 0)
+      {
+        sourcePixels = computed->Pixels;
+        sourceSize = computed->FrameSize;
+      }
+    }
+
+    if (sourceSize == output->FrameSize)
+    {
+      const size_t frameSizeInBytes = static_cast<size_t>(output->Image->GetNumberOfPoints()) * output->Image->GetNumberOfScalarComponents() * output->Image->GetScalarSize();
+      memcpy(output->Pixels, sourcePixels, frameSizeInBytes);
+    }
+    else
+    {
+      const std::array<int, 2> cropOrigin = { 0, 0 };
+      const std::array<int, 2> cropSize = { static_cast<int>(sourceSize[0]), static_cast<int>(sourceSize[1]) };
+      const std::array<int, 2> outputSize = { static_cast<int>(output->FrameSize[0]), static_cast<int>(output->FrameSize[1]) };
+      if (PlusAreaAverageResize::Resize(sourcePixels, sourceSize, this->InputPixelType, this->InputNumberOfScalarComponents,
+                                        cropOrigin, cropSize, outputSize, output->Pixels) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to resample frame for output " << output->SourceId);
+        if (output->InPlace)
+        {
+          output->Source->ReleaseWritableFrame();
+        }
+        output->Due = false;
+        status = PLUS_FAIL;
+      }
+    }
+  }
+
+  // Smaller outputs may be computed from the larger ones, so the frames are only added when all outputs are computed
+  for (std::vector<ResampledOutput>::iterator output = this->Outputs.begin(); output != this->Outputs.end(); ++output)
+  {
+    if (!output->Due)
+    {
+      continue;
+    }
+    if (output->InPlace)
+    {
+      // A failed commit releases the frame in the buffer
+      if (output->Source->CommitWritableFrame(this->FrameNumber, timestamp, timestamp) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to add resampled image to the buffer of " << output->SourceId);
+        status = PLUS_FAIL;
+      }
+    }
+    else if (output->Source->AddItem(output->Image, output->Source->GetInputImageOrientation(), output->Source->GetImageType(),
+                                     this->FrameNumber, timestamp, timestamp) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to add resampled image to the buffer of " << output->SourceId);
+      status = PLUS_FAIL;
+    }
+  }
+  this->FrameNumber++;
+
+  return status;
+}
+
+//----------------------------------------------------------------------------
+double vtkPlusVirtualResampler::GetAcquisitionRate() const
+{
+  // Determine frame rate from the video input
+  if (this->InputSource == nullptr)
+  {
+    return -1.;
+  }
+  return this->InputSource->GetDevice()->GetAcquisitionRate();
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualResampler::NotifyConfigured()
+{
+  if (this->InputChannels.size() != 1)
+  {
+    LOG_ERROR("Resampler requires exactly 1 input channel");
+    return PLUS_FAIL;
+  }
+  this->InputChannels[0]->GetVideoSource(this->InputSource);
+  if (this->InputSource == nullptr)
+  {
+    LOG_ERROR("Input channel does not have a video source. It is required.");
+    return PLUS_FAIL;
+  }
+
+  if (this->Outputs.empty())
+  {
+    LOG_ERROR("Resampler requires at least 1 video source.");
+    return PLUS_FAIL;
+  }
+  for (std::vector<ResampledOutput>::iterator output = this->Outputs.begin(); output != this->Outputs.end(); ++output)
+  {
+    DataSourceContainerIterator sourceIt = this->VideoSources.find(output->SourceId);
+    if (sourceIt == this->VideoSources.end())
+    {
+      LOG_ERROR("No video source with ID \"" << output->SourceId << "\" found.");
+      return PLUS_FAIL;
+    }
+    output->Source = sourceIt->second;
+  }
+
+  for (ChannelContainerIterator it = this->OutputChannels.begin(); it != this->OutputChannels.end(); ++it)
+  {
+    if (!(*it)->HasVideoSource())
+    {
+      LOG_ERROR("All output channels require a video source.");
+      return PLUS_FAIL;
+    }
+  }
+
+  return PLUS_SUCCESS;
+}
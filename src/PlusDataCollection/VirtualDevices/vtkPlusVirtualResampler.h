@@ -0,0 +1,122 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __vtkPlusVirtualResampler_h
+#define __vtkPlusVirtualResampler_h
+
+#include "vtkPlusDataCollectionExport.h"
+
+#include "vtkPlusDevice.h"
+
+// VTK includes
+#include <vtkSmartPointer.h>
+
+// STL includes
+#include <array>
+#include <string>
+#include <vector>
+
+class igsioVideoFrame;
+class vtkIGSIOTrackedFrameList;
+class vtkImageData;
+class vtkPlusDataSource;
+
+/*!
+\class vtkPlusVirtualResampler
+\brief Produces downscaled and frame-rate decimated copies of a video stream
+
+Each video source of the device is an output with its own scale and maximum frame rate. All outputs are computed
+in one pass over each input frame: the outputs are computed from the largest to the smallest, and an output is
+computed from an already computed smaller output instead of the input frame when its size is an integer fraction of
+that output (area averaging in two steps gives the same result then). Outputs of the same size share the computation.
+The images are written directly into the output buffers when possible.
+
+\ingroup PlusLibDataCollection
+*/
+class vtkPlusDataCollectionExport vtkPlusVirtualResampler : public vtkPlusDevice
+{
+public:
+  static vtkPlusVirtualResampler* New();
+  vtkTypeMacro(vtkPlusVirtualResampler, vtkPlusDevice);
+  virtual void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  /*! Answer if device is a tracker */
+  virtual bool IsTracker() const { return false; }
+
+  virtual bool IsVirtual() const { return true; }
+
+  virtual PlusStatus ReadConfiguration(vtkXMLDataElement*);
+  virtual PlusStatus WriteConfiguration(vtkXMLDataElement*);
+
+  virtual PlusStatus NotifyConfigured();
+
+  virtual PlusStatus InternalUpdate();
+
+  virtual double GetAcquisitionRate() const;
+
+  /*!
+    If enabled then the resampled images are written directly into the output buffers, without intermediate images.
+    It is only possible for output sources that need no clipping or reorientation, otherwise intermediate images are used.
+  */
+  vtkGetMacro(EnableInPlaceWriting, bool);
+  vtkSetMacro(EnableInPlaceWriting, bool);
+
+protected:
+  vtkPlusVirtualResampler();
+  virtual ~vtkPlusVirtualResampler();
+
+  /*! Settings and per-frame state of an output video source */
+  struct ResampledOutput
+  {
+    ResampledOutput();
+
+    std::string SourceId;
+    vtkPlusDataSource* Source;
+    /*! Size of the output relative to the input frame, in the range (0, 1] */
+    double Scale;
+    /*! If positive then at most this many frames per second are added to the output */
+    double MaxRateHz;
+
+    FrameSizeType FrameSize;
+    double NextFrameTimestamp;
+    /*! Image that the output is computed into if it cannot be written into the buffer directly */
+    vtkSmartPointer<vtkImageData> Image;
+
+    /*! State of the current input frame */
+    bool Due;
+    bool InPlace;
+    unsigned char* Pixels;
+  };
+
+  /*! Set the format of the output sources and images for input frames of the given format */
+  PlusStatus InitializeOutputs(igsioVideoFrame* inputFrame);
+
+  /*! Returns true if the output is due for the input frame of the given timestamp, updates the decimation state */
+  bool IsOutputDue(ResampledOutput& output, double timestamp);
+
+  /*! Compute all due outputs of an input frame and add them to the output buffers */
+  PlusStatus ResampleFrame(igsioTrackedFrame* frame);
+
+  bool                                      EnableInPlaceWriting;
+  double                                    LastInputTimestamp;
+  vtkPlusDataSource*                        InputSource;
+  vtkIGSIOTrackedFrameList*                 FrameList;
+
+  /*! Outputs in the order of decreasing size */
+  std::vector<ResampledOutput>              Outputs;
+
+  /*! Format of the input frames that the outputs are initialized for */
+  bool                                      Initialized;
+  FrameSizeType                             InputFrameSize;
+  igsioCommon::VTKScalarPixelType           InputPixelType;
+  unsigned int                              InputNumberOfScalarComponents;
+
+private:
+  vtkPlusVirtualResampler(const vtkPlusVirtualResampler&);  // Not implemented.
+  void operator=(const vtkPlusVirtualResampler&);  // Not implemented.
+};
+
+#endif
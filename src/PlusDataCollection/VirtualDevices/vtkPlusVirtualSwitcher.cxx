@@ -44,18 +44,19 @@ void vtkPlusVirtualSwitcher::PrintSelf(ostream& os, vtkIndent indent)
   }
 
   os << indent << "Active input channel: \n";
-  if( this->CurrentActiveInputChannel != NULL )
+  vtkPlusChannel* activeChannel = this->CurrentActiveInputChannel.load();
+  if( activeChannel != NULL )
   {
-    this->CurrentActiveInputChannel->PrintSelf(os, indent);
+    activeChannel->PrintSelf(os, indent);
   }
 }
 
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusVirtualSwitcher::GetChannel(vtkPlusChannel* &aChannel) const
 {
-  if( this->CurrentActiveInputChannel != NULL )
+  aChannel = this->CurrentActiveInputChannel.load();
+  if( aChannel != NULL )
   {
-    aChannel = this->CurrentActiveInputChannel;
     return PLUS_SUCCESS;
   }
 
@@ -70,44 +71,49 @@ PlusStatus vtkPlusVirtualSwitcher::InternalUpdate()
   //    correctly detect this situation and wait a few frames before switching
       // if timestamp not changed within 'FRAME_COUNT_BEFORE_INACTIVE' frames, then do new stream check
 
+  vtkPlusChannel* activeChannel = this->CurrentActiveInputChannel.load();
+  if( activeChannel == NULL )
+  {
+    // No input has been active yet
+    this->SelectActiveChannel();
+    return PLUS_SUCCESS;
+  }
+
   double latestCurrentTimestamp(0);
-  if( this->CurrentActiveInputChannel != NULL )
+  if( activeChannel->GetLatestTimestamp(latestCurrentTimestamp) != PLUS_SUCCESS )
   {
-    if( this->CurrentActiveInputChannel->GetLatestTimestamp(latestCurrentTimestamp) != PLUS_SUCCESS )
-    {
-      LOG_ERROR("Unable to retrieve timestamp from active stream.");
-      return PLUS_FAIL;
-    }
-    if( this->LastRecordedTimestampMap[this->CurrentActiveInputChannel] == 0 )
-    {
-      this->LastRecordedTimestampMap[this->CurrentActiveInputChannel] = latestCurrentTimestamp;
-      return PLUS_SUCCESS;
-    }
+    LOG_ERROR("Unable to retrieve timestamp from active stream.");
+    return PLUS_FAIL;
+  }
+  if( this->LastRecordedTimestampMap[activeChannel] == 0 )
+  {
+    this->LastRecordedTimestampMap[activeChannel] = latestCurrentTimestamp;
+    return PLUS_SUCCESS;
+  }
 
-    if( latestCurrentTimestamp > this->LastRecordedTimestampMap[this->CurrentActiveInputChannel] )
+  if( latestCurrentTimestamp > this->LastRecordedTimestampMap[activeChannel] )
+  {
+    // Device is still active
+    this->LastRecordedTimestampMap[activeChannel] = latestCurrentTimestamp;
+    this->FramesWhileInactive = 0;
+    return PLUS_SUCCESS;
+  }
+  else
+  {
+    if( FramesWhileInactive >= FRAME_COUNT_BEFORE_INACTIVE )
     {
-      // Device is still active
-      return PLUS_SUCCESS;
+      this->FramesWhileInactive = 0;
+      // Device is no longer active
+      if( this->SelectActiveChannel() == PLUS_FAIL )
+      {
+        // No active devices, don't copy anything!
+        return PLUS_SUCCESS;
+      }
     }
     else
     {
-      if( FramesWhileInactive >= FRAME_COUNT_BEFORE_INACTIVE )
-      {
-        this->FramesWhileInactive = 0;
-        // Device is no longer active
-        if( this->SelectActiveChannel() == PLUS_FAIL )
-        {
-          // No active devices, don't copy anything!
-          return PLUS_SUCCESS;
-        }
-      }
-      else
-      {
-        FramesWhileInactive++;
-      }
+      FramesWhileInactive++;
     }
-
-    this->CopyInputChannelToOutputChannel();
   }
 
   return PLUS_SUCCESS;
@@ -139,7 +145,6 @@ PlusStatus vtkPlusVirtualSwitcher::SelectActiveChannel()
   {
     // For now, just choose the first... maybe in the future make it more elegant
     this->SetCurrentActiveInputChannel(ActiveChannels[0]);
-    this->CopyInputChannelToOutputChannel();
 
     // We will also now need to output the correct transform associated with the new stream
     // Is there any way to make this generic?
@@ -154,6 +159,20 @@ PlusStatus vtkPlusVirtualSwitcher::SelectActiveChannel()
   return PLUS_FAIL;
 }
 
+//----------------------------------------------------------------------------
+void vtkPlusVirtualSwitcher::SetCurrentActiveInputChannel(vtkPlusChannel* aChannel)
+{
+  if( this->CurrentActiveInputChannel.load() == aChannel )
+  {
+    return;
+  }
+  // The output channel is switched first, so it never forwards to a channel that is not the active one any more after GetChannel returned it
+  this->OutputChannel->SetForwardedChannel(aChannel);
+  this->CurrentActiveInputChannel.store(aChannel);
+  LOG_DEBUG("Active input channel of " << this->GetDeviceId() << ": " << (aChannel != NULL ? aChannel->GetChannelId() : "none"));
+  this->Modified();
+}
+
 //----------------------------------------------------------------------------
 double vtkPlusVirtualSwitcher::GetAcquisitionRate() const
 {
@@ -196,16 +215,3 @@ PlusStatus vtkPlusVirtualSwitcher::NotifyConfigured()
 
   return PLUS_SUCCESS;
 }
-
-//----------------------------------------------------------------------------
-PlusStatus vtkPlusVirtualSwitcher::CopyInputChannelToOutputChannel()
-{
-  // Only destroy if things have to change
-  if( this->CurrentActiveInputChannel != NULL )
-  {
-    // no need to do a deep copy, iterators are used to access data anyways
-    this->OutputChannel->ShallowCopy(*this->CurrentActiveInputChannel);
-  }
-
-  return PLUS_SUCCESS;
-}
\ No newline at end of file
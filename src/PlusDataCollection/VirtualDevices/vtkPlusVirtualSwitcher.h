@@ -12,9 +12,14 @@ See License.txt for details.
 #include "vtkPlusDevice.h"
 #include "vtkPlusChannel.h"
 
+#include <atomic>
+
 /*!
 \class vtkPlusVirtualSwitcher
-\brief 
+\brief Virtual device that outputs the data of the input channel that is currently active
+
+The output channel forwards all data queries to the active input channel (see vtkPlusChannel::SetForwardedChannel),
+so switching between input channels does not copy or clear any buffer and readers of the output channel are never blocked.
 
 \ingroup PlusLibDataCollection
 */
@@ -47,17 +52,16 @@ protected:
 
   PlusStatus SelectActiveChannel();
 
-  PlusStatus CopyInputChannelToOutputChannel();
-
   vtkPlusVirtualSwitcher();
   virtual ~vtkPlusVirtualSwitcher();
 
-  vtkGetObjectMacro(CurrentActiveInputChannel, vtkPlusChannel);
-  vtkSetObjectMacro(CurrentActiveInputChannel, vtkPlusChannel);
+  vtkPlusChannel* GetCurrentActiveInputChannel() const { return this->CurrentActiveInputChannel.load(); }
+  /*! Make the output channel forward the data of this input channel. The input channels are owned by their devices, so no reference is kept. */
+  void SetCurrentActiveInputChannel(vtkPlusChannel* aChannel);
 
   vtkSetObjectMacro(OutputChannel, vtkPlusChannel);
 
-  vtkPlusChannel*                    CurrentActiveInputChannel;
+  std::atomic<vtkPlusChannel*>       CurrentActiveInputChannel;
   std::map<vtkPlusChannel*, double>  LastRecordedTimestampMap;
   vtkPlusChannel*                    OutputChannel;
 
@@ -0,0 +1,390 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "vtkPlusChannel.h"
+#include "vtkPlusDataCollector.h"
+#include "vtkPlusTemporalCalibrationAlgo.h"
+#include "vtkPlusVirtualTemporalCalibrator.h"
+
+// IGSIO includes
+#include <vtkIGSIOAccurateTimer.h>
+#include <vtkIGSIOTrackedFrameList.h>
+
+// VTK includes
+#include <vtkObjectFactory.h>
+#include <vtkXMLDataElement.h>
+
+// STL includes
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+  const double DEFAULT_WINDOW_SIZE_SEC = 15.0;
+  const double DEFAULT_CALIBRATION_INTERVAL_SEC = 60.0;
+  const double DEFAULT_MAXIMUM_COMPUTATION_TIME_FRACTION = 0.1;
+  const double DEFAULT_MINIMUM_APPLIED_LAG_SEC = 0.002;
+}
+
+//----------------------------------------------------------------------------
+
+vtkStandardNewMacro(vtkPlusVirtualTemporalCalibrator);
+
+//----------------------------------------------------------------------------
+vtkPlusVirtualTemporalCalibrator::vtkPlusVirtualTemporalCalibrator()
+  : vtkPlusDevice()
+  , WindowSizeSec(DEFAULT_WINDOW_SIZE_SEC)
+  , CalibrationIntervalSec(DEFAULT_CALIBRATION_INTERVAL_SEC)
+  , MaximumComputationTimeFraction(DEFAULT_MAXIMUM_COMPUTATION_TIME_FRACTION)
+  , NumberOfThreads(1)
+  , EnableOffsetApplication(false)
+  , MaximumCalibrationError(-1.0)
+  , MinimumAppliedLagSec(DEFAULT_MINIMUM_APPLIED_LAG_SEC)
+  , FixedChannel(nullptr)
+  , MovingChannel(nullptr)
+  , FixedWindow(vtkIGSIOTrackedFrameList::New())
+  , MovingWindow(vtkIGSIOTrackedFrameList::New())
+  , LastFixedFrameTimestamp(UNDEFINED_TIMESTAMP)
+  , LastMovingFrameTimestamp(UNDEFINED_TIMESTAMP)
+  , LastComputationStartTime(0.0)
+  , NextComputationTime(0.0)
+  , LastMovingLagSec(0.0)
+  , LastCalibrationError(0.0)
+  , LastComputationTimeSec(0.0)
+  , NumberOfCalibrations(0)
+  , NumberOfFailedCalibrations(0)
+{
+  // New frames are added to the windows at this rate, the time offset is computed much less frequently
+  this->AcquisitionRate = 10;
+  this->StartThreadForInternalUpdates = true;
+}
+
+//----------------------------------------------------------------------------
+vtkPlusVirtualTemporalCalibrator::~vtkPlusVirtualTemporalCalibrator()
+{
+  this->FixedWindow->Delete();
+  this->MovingWindow->Delete();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusVirtualTemporalCalibrator::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "FixedChannelId: " << this->FixedChannelId << std::endl;
+  os << indent << "MovingChannelId: " << this->MovingChannelId << std::endl;
+  os << indent << "WindowSizeSec: " << this->WindowSizeSec << std::endl;
+  os << indent << "CalibrationIntervalSec: " << this->CalibrationIntervalSec << std::endl;
+  os << indent << "LastMovingLagSec: " << this->LastMovingLagSec.load() << std::endl;
+  os << indent << "NumberOfCalibrations: " << this->NumberOfCalibrations.load() << std::endl;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualTemporalCalibrator::ReadConfiguration(vtkXMLDataElement* rootConfigElement)
+{
+  XML_FIND_DEVICE_ELEMENT_REQUIRED_FOR_READING(deviceConfig, rootConfigElement);
+
+  XML_READ_STRING_ATTRIBUTE_REQUIRED(FixedChannelId, deviceConfig);
+  XML_READ_STRING_ATTRIBUTE_REQUIRED(MovingChannelId, deviceConfig);
+  XML_READ_STRING_ATTRIBUTE_OPTIONAL(FixedProbeToReferenceTransformName, deviceConfig);
+  XML_READ_STRING_ATTRIBUTE_OPTIONAL(MovingProbeToReferenceTransformName, deviceConfig);
+  XML_READ_STRING_ATTRIBUTE_OPTIONAL(MovingDeviceId, deviceConfig);
+
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, WindowSizeSec, deviceConfig);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, CalibrationIntervalSec, deviceConfig);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, MaximumComputationTimeFraction, deviceConfig);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, NumberOfThreads, deviceConfig);
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(EnableOffsetApplication, deviceConfig);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, MaximumCalibrationError, deviceConfig);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, MinimumAppliedLagSec, deviceConfig);
+
+  if (this->WindowSizeSec <= 0)
+  {
+    LOG_WARNING("WindowSizeSec must be positive, got " << this->WindowSizeSec << ". Using " << DEFAULT_WINDOW_SIZE_SEC << ".");
+    this->WindowSizeSec = DEFAULT_WINDOW_SIZE_SEC;
+  }
+  if (this->MaximumComputationTimeFraction <= 0 || this->MaximumComputationTimeFraction > 1)
+  {
+    LOG_WARNING("MaximumComputationTimeFraction must be in (0, 1], got " << this->MaximumComputationTimeFraction << ". Using " << DEFAULT_MAXIMUM_COMPUTATION_TIME_FRACTION << ".");
+    this->MaximumComputationTimeFraction = DEFAULT_MAXIMUM_COMPUTATION_TIME_FRACTION;
+  }
+
+  // The algorithm reads its parameters from the nested vtkPlusTemporalCalibrationAlgo element
+  this->AlgorithmConfig = vtkSmartPointer<vtkXMLDataElement>::New();
+  this->AlgorithmConfig->DeepCopy(deviceConfig);
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualTemporalCalibrator::WriteConfiguration(vtkXMLDataElement* rootConfigElement)
+{
+  XML_FIND_DEVICE_ELEMENT_REQUIRED_FOR_WRITING(deviceConfig, rootConfigElement);
+
+  deviceConfig->SetAttribute("FixedChannelId", this->FixedChannelId.c_str());
+  deviceConfig->SetAttribute("MovingChannelId", this->MovingChannelId.c_str());
+  XML_WRITE_STRING_ATTRIBUTE_IF_NOT_EMPTY(FixedProbeToReferenceTransformName, deviceConfig);
+  XML_WRITE_STRING_ATTRIBUTE_IF_NOT_EMPTY(MovingProbeToReferenceTransformName, deviceConfig);
+  XML_WRITE_STRING_ATTRIBUTE_IF_NOT_EMPTY(MovingDeviceId, deviceConfig);
+
+  deviceConfig->SetDoubleAttribute("WindowSizeSec", this->WindowSizeSec);
+  deviceConfig->SetDoubleAttribute("CalibrationIntervalSec", this->CalibrationIntervalSec);
+  deviceConfig->SetDoubleAttribute("MaximumComputationTimeFraction", this->MaximumComputationTimeFraction);
+  deviceConfig->SetIntAttribute("NumberOfThreads", this->NumberOfThreads);
+  XML_WRITE_BOOL_ATTRIBUTE(EnableOffsetApplication, deviceConfig);
+  deviceConfig->SetDoubleAttribute("MaximumCalibrationError", this->MaximumCalibrationError);
+  deviceConfig->SetDoubleAttribute("MinimumAppliedLagSec", this->MinimumAppliedLagSec);
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualTemporalCalibrator::NotifyConfigured()
+{
+  this->FixedChannel = nullptr;
+  this->MovingChannel = nullptr;
+  for (ChannelContainerIterator it = this->InputChannels.begin(); it != this->InputChannels.end(); ++it)
+  {
+    if (this->FixedChannelId == (*it)->GetChannelId())
+    {
+      this->FixedChannel = *it;
+    }
+    if (this->MovingChannelId == (*it)->GetChannelId())
+    {
+      this->MovingChannel = *it;
+    }
+  }
+  if (this->FixedChannel == nullptr)
+  {
+    LOG_ERROR(this->GetDeviceId() << ": fixed channel " << this->FixedChannelId << " is not an input channel of the device");
+    return PLUS_FAIL;
+  }
+  if (this->MovingChannel == nullptr)
+  {
+    LOG_ERROR(this->GetDeviceId() << ": moving channel " << this->MovingChannelId << " is not an input channel of the device");
+    return PLUS_FAIL;
+  }
+  if (this->FixedChannel == this->MovingChannel)
+  {
+    LOG_ERROR(this->GetDeviceId() << ": the fixed and the moving channel must be different");
+    return PLUS_FAIL;
+  }
+
+  if (!this->OutputChannels.empty())
+  {
+    LOG_WARNING(this->GetDeviceId() << ": vtkPlusVirtualTemporalCalibrator is expecting no output channel(s) and there are " << this->OutputChannels.size() << " channels. Output channel information will be dropped.");
+    this->OutputChannels.clear();
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualTemporalCalibrator::InternalConnect()
+{
+  this->ClearWindows();
+  this->LastComputationStartTime = 0.0;
+  // The first computation is done when the windows are full
+  this->NextComputationTime = vtkIGSIOAccurateTimer::GetSystemTime() + this->WindowSizeSec;
+  this->NumberOfCalibrations = 0;
+  this->NumberOfFailedCalibrations = 0;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualTemporalCalibrator::InternalDisconnect()
+{
+  this->ClearWindows();
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusVirtualTemporalCalibrator::ClearWindows()
+{
+  this->FixedWindow->Clear();
+  this->MovingWindow->Clear();
+  this->LastFixedFrameTimestamp = UNDEFINED_TIMESTAMP;
+  this->LastMovingFrameTimestamp = UNDEFINED_TIMESTAMP;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualTemporalCalibrator::InternalUpdate()
+{
+  PlusStatus status = PLUS_SUCCESS;
+  if (this->UpdateWindow(this->FixedChannel, this->FixedWindow, this->LastFixedFrameTimestamp) != PLUS_SUCCESS)
+  {
+    status = PLUS_FAIL;
+  }
+  if (this->UpdateWindow(this->MovingChannel, this->MovingWindow, this->LastMovingFrameTimestamp) != PLUS_SUCCESS)
+  {
+    status = PLUS_FAIL;
+  }
+
+  if (vtkIGSIOAccurateTimer::GetSystemTime() < this->NextComputationTime)
+  {
+    return status;
+  }
+
+  const double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+  if (this->ComputeTimeOffset() == PLUS_SUCCESS)
+  {
+    ++this->NumberOfCalibrations;
+  }
+  else
+  {
+    ++this->NumberOfFailedCalibrations;
+  }
+  const double computationTimeSec = vtkIGSIOAccurateTimer::GetSystemTime() - startTime;
+  this->LastComputationTimeSec = computationTimeSec;
+  this->LastComputationStartTime = startTime;
+
+  // Keep the computations within the allowed fraction of the time
+  double nextComputationDelaySec = std::max(this->CalibrationIntervalSec, computationTimeSec / this->MaximumComputationTimeFraction);
+  if (nextComputationDelaySec > this->CalibrationIntervalSec)
+  {
+    LOG_DEBUG(this->GetDeviceId() << ": time offset computation took " << computationTimeSec << " sec, next computation is delayed to " << nextComputationDelaySec << " sec after this one");
+  }
+  // The next computation may have been delayed already, until the windows are filled again after applying the offset
+  this->NextComputationTime = std::max(this->NextComputationTime, startTime + nextComputationDelaySec);
+
+  return status;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualTemporalCalibrator::UpdateWindow(vtkPlusChannel* channel, vtkIGSIOTrackedFrameList* window, double& lastFrameTimestamp)
+{
+  double oldestTimestamp(UNDEFINED_TIMESTAMP);
+  if (channel->GetOldestTimestamp(oldestTimestamp) != PLUS_SUCCESS)
+  {
+    // No data yet
+    return PLUS_SUCCESS;
+  }
+  if (lastFrameTimestamp != UNDEFINED_TIMESTAMP && lastFrameTimestamp < oldestTimestamp)
+  {
+    // Frames were removed from the buffer before they could be added to the window (e.g., while the time offset was computed)
+    LOG_DEBUG(this->GetDeviceId() << ": frames of channel " << channel->GetChannelId() << " between " << std::fixed << lastFrameTimestamp << " and " << oldestTimestamp << " are not in the buffer anymore");
+    lastFrameTimestamp = oldestTimestamp;
+  }
+
+  if (channel->GetTrackedFrameList(lastFrameTimestamp, window, -1, true) != PLUS_SUCCESS)
+  {
+    LOG_ERROR(this->GetDeviceId() << ": failed to get tracked frames from channel " << channel->GetChannelId());
+    return PLUS_FAIL;
+  }
+
+  // Remove the frames that are older than the window
+  const double windowStartTimestamp = lastFrameTimestamp - this->WindowSizeSec;
+  int numberOfOldFrames = 0;
+  while (numberOfOldFrames < static_cast<int>(window->GetNumberOfTrackedFrames())
+         && window->GetTrackedFrame(numberOfOldFrames)->GetTimestamp() < windowStartTimestamp)
+  {
+    ++numberOfOldFrames;
+  }
+  if (numberOfOldFrames > 0)
+  {
+    window->RemoveTrackedFrameRange(0, numberOfOldFrames - 1);
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualTemporalCalibrator::ComputeTimeOffset()
+{
+  if (this->FixedWindow->GetNumberOfTrackedFrames() == 0 || this->MovingWindow->GetNumberOfTrackedFrames() == 0)
+  {
+    LOG_DEBUG(this->GetDeviceId() << ": no frames to compute the time offset from");
+    return PLUS_FAIL;
+  }
+
+  vtkSmartPointer<vtkPlusTemporalCalibrationAlgo> temporalCalibrationAlgo = vtkSmartPointer<vtkPlusTemporalCalibrationAlgo>::New();
+  if (this->AlgorithmConfig != nullptr)
+  {
+    temporalCalibrationAlgo->ReadConfiguration(this->AlgorithmConfig);
+  }
+  temporalCalibrationAlgo->SetNumberOfThreads(this->NumberOfThreads);
+
+  if (this->FixedProbeToReferenceTransformName.empty())
+  {
+    temporalCalibrationAlgo->SetFixedFrames(this->FixedWindow, vtkPlusTemporalCalibrationAlgo::FRAME_TYPE_VIDEO);
+  }
+  else
+  {
+    temporalCalibrationAlgo->SetFixedFrames(this->FixedWindow, vtkPlusTemporalCalibrationAlgo::FRAME_TYPE_TRACKER);
+    temporalCalibrationAlgo->SetFixedProbeToReferenceTransformName(this->FixedProbeToReferenceTransformName);
+  }
+  if (this->MovingProbeToReferenceTransformName.empty())
+  {
+    temporalCalibrationAlgo->SetMovingFrames(this->MovingWindow, vtkPlusTemporalCalibrationAlgo::FRAME_TYPE_VIDEO);
+  }
+  else
+  {
+    temporalCalibrationAlgo->SetMovingFrames(this->MovingWindow, vtkPlusTemporalCalibrationAlgo::FRAME_TYPE_TRACKER);
+    temporalCalibrationAlgo->SetMovingProbeToReferenceTransformName(this->MovingProbeToReferenceTransformName);
+  }
+
+  vtkPlusTemporalCalibrationAlgo::TEMPORAL_CALIBRATION_ERROR error = vtkPlusTemporalCalibrationAlgo::TEMPORAL_CALIBRATION_ERROR_NONE;
+  if (temporalCalibrationAlgo->Update(error) != PLUS_SUCCESS)
+  {
+    // Typically there is not enough motion in the window
+    LOG_DEBUG(this->GetDeviceId() << ": time offset computation failed (error code: " << error << ")");
+    return PLUS_FAIL;
+  }
+
+  double movingLagSec = 0.0;
+  double calibrationError = 0.0;
+  temporalCalibrationAlgo->GetMovingLagSec(movingLagSec);
+  temporalCalibrationAlgo->GetCalibrationError(calibrationError);
+  this->LastMovingLagSec = movingLagSec;
+  this->LastCalibrationError = calibrationError;
+  LOG_INFO(this->GetDeviceId() << ": channel " << this->MovingChannelId << " lags channel " << this->FixedChannelId << " by " << movingLagSec << " sec (calibration error: " << calibrationError << ")");
+
+  if (!this->EnableOffsetApplication)
+  {
+    return PLUS_SUCCESS;
+  }
+  if (this->MaximumCalibrationError >= 0 && calibrationError > this->MaximumCalibrationError)
+  {
+    LOG_INFO(this->GetDeviceId() << ": time offset is not applied, the calibration error is larger than the maximum " << this->MaximumCalibrationError);
+    return PLUS_SUCCESS;
+  }
+  if (std::abs(movingLagSec) < this->MinimumAppliedLagSec)
+  {
+    return PLUS_SUCCESS;
+  }
+  return this->ApplyMovingLag(movingLagSec);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualTemporalCalibrator::ApplyMovingLag(double movingLagSec)
+{
+  vtkPlusDevice* movingDevice = this->MovingChannel->GetOwnerDevice();
+  if (!this->MovingDeviceId.empty())
+  {
+    if (this->GetDataCollector() == nullptr || this->GetDataCollector()->GetDevice(movingDevice, this->MovingDeviceId) != PLUS_SUCCESS)
+    {
+      LOG_ERROR(this->GetDeviceId() << ": unable to apply the time offset, device " << this->MovingDeviceId << " is not found");
+      return PLUS_FAIL;
+    }
+  }
+  if (movingDevice == nullptr)
+  {
+    LOG_ERROR(this->GetDeviceId() << ": unable to apply the time offset, the moving channel has no owner device");
+    return PLUS_FAIL;
+  }
+
+  // The moving data is acquired movingLagSec earlier than its timestamps show (global = local + offset)
+  const double localTimeOffsetSec = movingDevice->GetLocalTimeOffsetSec() - movingLagSec;
+  LOG_INFO(this->GetDeviceId() << ": LocalTimeOffsetSec of device " << movingDevice->GetDeviceId() << " is changed from " << movingDevice->GetLocalTimeOffsetSec() << " to " << localTimeOffsetSec << " sec");
+  movingDevice->SetLocalTimeOffsetSec(localTimeOffsetSec);
+
+  // The frames in the window have timestamps with the previous offset
+  this->ClearWindows();
+  this->NextComputationTime = std::max(this->NextComputationTime, vtkIGSIOAccurateTimer::GetSystemTime() + this->WindowSizeSec);
+
+  return PLUS_SUCCESS;
+}
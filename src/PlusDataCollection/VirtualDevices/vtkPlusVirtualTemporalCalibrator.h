@@ -0,0 +1,168 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __vtkPlusVirtualTemporalCalibrator_h
+#define __vtkPlusVirtualTemporalCalibrator_h
+
+#include "vtkPlusDataCollectionExport.h"
+
+#include "vtkPlusDevice.h"
+
+// STL includes
+#include <atomic>
+
+class vtkIGSIOTrackedFrameList;
+class vtkPlusChannel;
+class vtkXMLDataElement;
+
+/*!
+\class vtkPlusVirtualTemporalCalibrator
+\brief Measures the time offset between two input channels continuously, during acquisition
+
+The most recent frames of the fixed and the moving input channel are kept in a sliding window. New frames are added
+to the window in each update, old frames are removed, so each frame is retrieved from the channels only once.
+Periodically the time offset is computed from the window by vtkPlusTemporalCalibrationAlgo and optionally applied
+to the LocalTimeOffsetSec of the device of the moving channel.
+
+The computation runs on the internal update thread of this device. Its cost is bounded by the window size, the
+number of threads, and the fraction of time that the computation may take.
+
+\ingroup PlusLibDataCollection
+*/
+class vtkPlusDataCollectionExport vtkPlusVirtualTemporalCalibrator : public vtkPlusDevice
+{
+public:
+  static vtkPlusVirtualTemporalCalibrator* New();
+  vtkTypeMacro(vtkPlusVirtualTemporalCalibrator, vtkPlusDevice);
+  virtual void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  virtual bool IsTracker() const { return false; }
+  virtual bool IsVirtual() const { return true; }
+
+  virtual PlusStatus ReadConfiguration(vtkXMLDataElement*);
+  virtual PlusStatus WriteConfiguration(vtkXMLDataElement*);
+
+  virtual PlusStatus NotifyConfigured();
+
+  vtkGetStdStringMacro(FixedChannelId);
+  vtkSetStdStringMacro(FixedChannelId);
+  vtkGetStdStringMacro(MovingChannelId);
+  vtkSetStdStringMacro(MovingChannelId);
+  vtkGetStdStringMacro(FixedProbeToReferenceTransformName);
+  vtkSetStdStringMacro(FixedProbeToReferenceTransformName);
+  vtkGetStdStringMacro(MovingProbeToReferenceTransformName);
+  vtkSetStdStringMacro(MovingProbeToReferenceTransformName);
+  vtkGetStdStringMacro(MovingDeviceId);
+  vtkSetStdStringMacro(MovingDeviceId);
+
+  /*! Length of the sliding window that the time offset is computed from */
+  vtkGetMacro(WindowSizeSec, double);
+  vtkSetMacro(WindowSizeSec, double);
+
+  /*! Time between the starts of two time offset computations */
+  vtkGetMacro(CalibrationIntervalSec, double);
+  vtkSetMacro(CalibrationIntervalSec, double);
+
+  /*!
+    Maximum fraction of the time that the time offset computations may take. If a computation takes longer than
+    this fraction of CalibrationIntervalSec then the next computation is delayed accordingly.
+  */
+  vtkGetMacro(MaximumComputationTimeFraction, double);
+  vtkSetMacro(MaximumComputationTimeFraction, double);
+
+  /*! Number of threads that compute the time offset (0 = all threads of the shared worker pool) */
+  vtkGetMacro(NumberOfThreads, int);
+  vtkSetMacro(NumberOfThreads, int);
+
+  /*! If enabled then the computed time offset is added to the LocalTimeOffsetSec of the moving device */
+  vtkGetMacro(EnableOffsetApplication, bool);
+  vtkSetMacro(EnableOffsetApplication, bool);
+  vtkBooleanMacro(EnableOffsetApplication, bool);
+
+  /*! The computed time offset is only applied if the calibration error is not larger than this. Negative value means no limit. */
+  vtkGetMacro(MaximumCalibrationError, double);
+  vtkSetMacro(MaximumCalibrationError, double);
+
+  /*! The computed time offset is only applied if its magnitude is at least this large, to avoid changing the offset because of noise */
+  vtkGetMacro(MinimumAppliedLagSec, double);
+  vtkSetMacro(MinimumAppliedLagSec, double);
+
+  /*! Time [s] by which the moving channel lagged the fixed channel at the last successful computation */
+  double GetLastMovingLagSec() const { return this->LastMovingLagSec; }
+  /*! Calibration error of the last successful computation */
+  double GetLastCalibrationError() const { return this->LastCalibrationError; }
+  /*! Duration of the last computation */
+  double GetLastComputationTimeSec() const { return this->LastComputationTimeSec; }
+  /*! Number of successful and failed computations since connect */
+  unsigned long GetNumberOfCalibrations() const { return this->NumberOfCalibrations; }
+  unsigned long GetNumberOfFailedCalibrations() const { return this->NumberOfFailedCalibrations; }
+
+protected:
+  virtual PlusStatus InternalConnect();
+  virtual PlusStatus InternalDisconnect();
+  virtual PlusStatus InternalUpdate();
+
+  /*! Append the frames of the channel that were acquired since the previous call to the window and remove the frames that are out of the window */
+  PlusStatus UpdateWindow(vtkPlusChannel* channel, vtkIGSIOTrackedFrameList* window, double& lastFrameTimestamp);
+
+  /*! Compute the time offset from the frames in the windows, and apply it if enabled */
+  PlusStatus ComputeTimeOffset();
+
+  /*! Add the lag to the local time offset of the moving device and restart filling the windows */
+  PlusStatus ApplyMovingLag(double movingLagSec);
+
+  /*! Remove all frames from the windows */
+  void ClearWindows();
+
+protected:
+  vtkPlusVirtualTemporalCalibrator();
+  virtual ~vtkPlusVirtualTemporalCalibrator();
+
+  std::string                     FixedChannelId;
+  std::string                     MovingChannelId;
+  /*! If specified then the fixed channel contains tracking data, otherwise video data is used */
+  std::string                     FixedProbeToReferenceTransformName;
+  /*! If specified then the moving channel contains tracking data, otherwise video data is used */
+  std::string                     MovingProbeToReferenceTransformName;
+  /*! Device whose LocalTimeOffsetSec is updated. If not specified then the owner device of the moving channel. */
+  std::string                     MovingDeviceId;
+
+  double                          WindowSizeSec;
+  double                          CalibrationIntervalSec;
+  double                          MaximumComputationTimeFraction;
+  int                             NumberOfThreads;
+  bool                            EnableOffsetApplication;
+  double                          MaximumCalibrationError;
+  double                          MinimumAppliedLagSec;
+
+  /*! Copy of the vtkPlusTemporalCalibrationAlgo configuration element, the algorithm is configured from it for each computation */
+  vtkSmartPointer<vtkXMLDataElement> AlgorithmConfig;
+
+  vtkPlusChannel*                 FixedChannel;
+  vtkPlusChannel*                 MovingChannel;
+
+  /*! Sliding windows of the most recent frames, with image data shared with the video buffers */
+  vtkIGSIOTrackedFrameList*       FixedWindow;
+  vtkIGSIOTrackedFrameList*       MovingWindow;
+  double                          LastFixedFrameTimestamp;
+  double                          LastMovingFrameTimestamp;
+
+  /*! System time of the start of the previous computation and the earliest start of the next one */
+  double                          LastComputationStartTime;
+  double                          NextComputationTime;
+
+  std::atomic<double>             LastMovingLagSec;
+  std::atomic<double>             LastCalibrationError;
+  std::atomic<double>             LastComputationTimeSec;
+  std::atomic<unsigned long>      NumberOfCalibrations;
+  std::atomic<unsigned long>      NumberOfFailedCalibrations;
+
+private:
+  vtkPlusVirtualTemporalCalibrator(const vtkPlusVirtualTemporalCalibrator&);  // Not implemented.
+  void operator=(const vtkPlusVirtualTemporalCalibrator&);  // Not implemented.
+};
+
+#endif
@@ -13,6 +13,10 @@ See License.txt for details.
 #include "vtkPlusDataSource.h"
 #include "vtkIGSIOTrackedFrameList.h"
 #include "vtkPlusVirtualTextRecognizer.h"
+#include "PlusFrameBacklogPolicy.h"
+#include "PlusPixelKernels.h"
+#include "PlusWorkerPool.h"
+#include "vtkIGSIOAccurateTimer.h"
 
 // Tesseract includes
 #include <tesseract/baseapi.h>
@@ -22,6 +26,11 @@ See License.txt for details.
 // Configuration includes
 #include "tesseractDataDir.h"
 
+// STL includes
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
 //----------------------------------------------------------------------------
 
 vtkStandardNewMacro(vtkPlusVirtualTextRecognizer);
@@ -39,6 +48,7 @@ namespace
   static const int PARAMETER_DEPTH_BITS = 8;
   static const char* DEFAULT_LANGUAGE = "eng";
   static const int TEXT_RECOGNIZER_MISSING_INPUT_DEFAULT = 1;
+  static const int MAXIMUM_CROP_UPSCALE_FACTOR = 4;
 }
 
 //----------------------------------------------------------------------------
@@ -47,6 +57,14 @@ vtkPlusVirtualTextRecognizer::vtkPlusVirtualTextRecognizer()
   , Language()
   , TrackedFrames(vtkIGSIOTrackedFrameList::New())
   , OutputChannel(NULL)
+  , EnableChangeDetection(true)
+  , ChangeDetectionThreshold(0.0)
+  , EnableParallelRecognition(true)
+  , NumberOfRecognitionEngines(0)
+  , CropUpscaleFactor(1)
+  , CropBinarizationThreshold(-1)
+  , NumberOfRecognitions(0)
+  , NumberOfUnchangedRegions(0)
 {
   // The data capture thread will be used to regularly check the input devices and generate and update the output
   this->StartThreadForInternalUpdates = true;
@@ -61,6 +79,10 @@ void vtkPlusVirtualTextRecognizer::ClearConfiguration()
     for (FieldListIterator fieldIt = it->second.begin(); fieldIt != it->second.end(); ++fieldIt)
     {
       TextFieldParameter* parameter = *fieldIt;
+      if (parameter->ReceivedFrame != NULL)
+      {
+        pixDestroy(&parameter->ReceivedFrame);
+      }
       delete parameter;
     }
     it->second.clear();
@@ -71,6 +93,8 @@ void vtkPlusVirtualTextRecognizer::ClearConfiguration()
 //----------------------------------------------------------------------------
 vtkPlusVirtualTextRecognizer::~vtkPlusVirtualTextRecognizer()
 {
+  this->ClearConfiguration();
+  this->DeleteRecognitionEngines();
   TrackedFrames->Delete();
   TrackedFrames = NULL;
 }
@@ -92,42 +116,116 @@ vtkPlusVirtualTextRecognizer::ChannelFieldListMap& vtkPlusVirtualTextRecognizer:
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusVirtualTextRecognizer::InternalUpdate()
 {
-  std::map<double, int> queriedFramesIndexes;
-  std::vector<igsioTrackedFrame*> queriedFrames;
-
   if (!this->HasGracePeriodExpired())
   {
     return PLUS_SUCCESS;
   }
 
+  // The frames of all channels are collected first, so that the fields of all channels can be recognized at the same time.
+  // The image data is shared with the video buffers.
+  this->TrackedFrames->Clear();
+  std::vector<TextFieldParameter*> fields;
+  std::vector<unsigned int> fieldFirstFrames;
+  std::vector<unsigned int> fieldNumberOfFrames;
+  unsigned int maximumNumberOfFrames = 0;
   for (ChannelFieldListMapIterator it = this->RecognitionFields.begin(); it != this->RecognitionFields.end(); ++it)
   {
+    if (!it->first->GetVideoDataAvailable())
+    {
+      LOG_WARNING("Processed data is not generated, as no video data is available yet. Device ID: " << this->GetDeviceId());
+      continue;
+    }
+
+    const unsigned int firstFrame = this->TrackedFrames->GetNumberOfTrackedFrames();
+    if (this->BacklogPolicy.GetFramesToProcess(it->first, this->TrackedFrames) != PLUS_SUCCESS)
+    {
+      LOG_INFO("Failed to get tracked frame list from data collector.");
+      while (this->TrackedFrames->GetNumberOfTrackedFrames() > firstFrame)
+      {
+        this->TrackedFrames->RemoveTrackedFrame(this->TrackedFrames->GetNumberOfTrackedFrames() - 1);
+      }
+      continue;
+    }
+    const unsigned int numberOfFrames = this->TrackedFrames->GetNumberOfTrackedFrames() - firstFrame;
+    maximumNumberOfFrames = std::max(maximumNumberOfFrames, numberOfFrames);
     for (FieldListIterator fieldIt = it->second.begin(); fieldIt != it->second.end(); ++fieldIt)
     {
-      TextFieldParameter* parameter = *fieldIt;
-      igsioTrackedFrame frame;
+      fields.push_back(*fieldIt);
+      fieldFirstFrames.push_back(firstFrame);
+      fieldNumberOfFrames.push_back(numberOfFrames);
+    }
+  }
 
-      // Attempt to find the frame already retrieved
-      PlusStatus result = FindOrQueryFrame(frame, queriedFramesIndexes, parameter, queriedFrames);
+  if (maximumNumberOfFrames == 0)
+  {
+    this->TrackedFrames->Clear();
+    // Keep sending the latest values
+    this->AddRecognizedFields();
+    return PLUS_SUCCESS;
+  }
 
-      if (result != PLUS_SUCCESS || frame.GetImageData()->GetImage() == NULL)
+  // A field is recognized in its frames in order, as the change detection compares each frame to the previous one.
+  // Each task uses one engine for all of its fields, there are not more tasks than engines.
+  const int numberOfFields = static_cast<int>(fields.size());
+  std::vector<unsigned long> numberOfRecognitions(numberOfFields, 0);
+  auto recognizeFields = [this, &fields, &fieldFirstFrames, &fieldNumberOfFrames, &numberOfRecognitions](int firstField, int lastField)
+  {
+    tesseract::TessBaseAPI* engine = this->AcquireRecognitionEngine();
+    for (int fieldIndex = firstField; fieldIndex < lastField; ++fieldIndex)
+    {
+      TextFieldParameter* parameter = fields[fieldIndex];
+      parameter->FrameValues.clear();
+      for (unsigned int frameIndex = 0; frameIndex < fieldNumberOfFrames[fieldIndex]; ++frameIndex)
       {
-        continue;
+        igsioTrackedFrame& frame = *this->TrackedFrames->GetTrackedFrame(fieldFirstFrames[fieldIndex] + frameIndex);
+        // Text is only recognized if the region of the field has changed
+        if (frame.GetImageData()->GetImage() != NULL && this->vtkImageDataToPix(frame, parameter))
+        {
+          this->RecognizeField(parameter, engine);
+          numberOfRecognitions[fieldIndex]++;
+        }
+        parameter->FrameValues.push_back(parameter->LatestParameterValue);
       }
+    }
+    this->ReleaseRecognitionEngine(engine);
+  };
+  const int numberOfTasks = this->EnableParallelRecognition ? std::min(numberOfFields, static_cast<int>(this->RecognitionEngines.size())) : 1;
+  if (numberOfTasks > 1)
+  {
+    PlusWorkerPool::GetInstance().ParallelFor(0, numberOfFields, numberOfTasks, recognizeFields);
+  }
+  else
+  {
+    recognizeFields(0, numberOfFields);
+  }
+  this->TrackedFrames->Clear();
 
-      // We have a frame, let's parse it
-      vtkImageDataToPix(frame, parameter);
-
-      this->TesseractAPI->SetImage(parameter->ReceivedFrame);
-      char* text_out = this->TesseractAPI->GetUTF8Text();
-      std::string textStr(text_out);
-      parameter->LatestParameterValue = igsioCommon::Trim(textStr);
-      delete [] text_out;
+  for (int fieldIndex = 0; fieldIndex < numberOfFields; ++fieldIndex)
+  {
+    this->NumberOfRecognitions += numberOfRecognitions[fieldIndex];
+    this->NumberOfUnchangedRegions += fieldNumberOfFrames[fieldIndex] - numberOfRecognitions[fieldIndex];
+  }
 
-      frame.SetFrameField(parameter->ParameterName, parameter->LatestParameterValue);
+  // Each processed frame is sent, so that no recognized value is lost when more than one frame is processed.
+  // The i-th frames of all channels are sent together.
+  for (unsigned int frameIndex = 0; frameIndex < maximumNumberOfFrames; ++frameIndex)
+  {
+    for (int fieldIndex = 0; fieldIndex < numberOfFields; ++fieldIndex)
+    {
+      if (frameIndex < fields[fieldIndex]->FrameValues.size())
+      {
+        fields[fieldIndex]->LatestParameterValue = fields[fieldIndex]->FrameValues[frameIndex];
+      }
     }
+    this->AddRecognizedFields();
   }
 
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusVirtualTextRecognizer::AddRecognizedFields()
+{
   // Build the field map to send to the data sources
   igsioFieldMapType fieldMap;
   for (ChannelFieldListMapIterator it = this->RecognitionFields.begin(); it != this->RecognitionFields.end(); ++it)
@@ -144,12 +242,63 @@ PlusStatus vtkPlusVirtualTextRecognizer::InternalUpdate()
     it->second->AddItem(fieldMap, this->FrameNumber);
   }
   this->FrameNumber++;
+}
 
-  return PLUS_SUCCESS;
+//----------------------------------------------------------------------------
+void vtkPlusVirtualTextRecognizer::RecognizeField(TextFieldParameter* parameter, tesseract::TessBaseAPI* engine)
+{
+  const double startTimeSec = vtkIGSIOAccurateTimer::GetSystemTime();
+  engine->SetImage(parameter->ReceivedFrame);
+  char* text_out = engine->GetUTF8Text();
+  std::string textStr(text_out);
+  parameter->LatestParameterValue = igsioCommon::Trim(textStr);
+  delete [] text_out;
+
+  const double recognitionTimeSec = vtkIGSIOAccurateTimer::GetSystemTime() - startTimeSec;
+  parameter->NumberOfRecognitions++;
+  parameter->LastRecognitionTimeSec = recognitionTimeSec;
+  parameter->TotalRecognitionTimeSec += recognitionTimeSec;
+  parameter->MaximumRecognitionTimeSec = std::max(parameter->MaximumRecognitionTimeSec, recognitionTimeSec);
+  LOG_TRACE("Field " << parameter->ParameterName << " recognized in " << recognitionTimeSec * 1000.0 << " ms: " << parameter->LatestParameterValue);
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusVirtualTextRecognizer::HasScreenRegionChanged(TextFieldParameter* parameter)
+{
+  int dimensions[3] = { 0, 0, 0 };
+  parameter->ScreenRegion->GetDimensions(dimensions);
+  const size_t regionSize = static_cast<size_t>(dimensions[0]) * dimensions[1] * dimensions[2]
+                            * parameter->ScreenRegion->GetNumberOfScalarComponents() * parameter->ScreenRegion->GetScalarSize();
+  const unsigned char* region = static_cast<const unsigned char*>(parameter->ScreenRegion->GetScalarPointer());
+
+  bool changed = true;
+  if (this->EnableChangeDetection && parameter->PreviousScreenRegion.size() == regionSize)
+  {
+    if (this->ChangeDetectionThreshold <= 0)
+    {
+      changed = (memcmp(region, &parameter->PreviousScreenRegion[0], regionSize) != 0);
+    }
+    else
+    {
+      // Mean absolute difference of the pixel values
+      unsigned long long sumOfDifferences = 0;
+      for (size_t i = 0; i < regionSize; ++i)
+      {
+        sumOfDifferences += static_cast<unsigned int>(std::abs(static_cast<int>(region[i]) - static_cast<int>(parameter->PreviousScreenRegion[i])));
+      }
+      changed = (sumOfDifferences > this->ChangeDetectionThreshold * regionSize);
+    }
+  }
+  if (changed && this->EnableChangeDetection)
+  {
+    // The region is compared to the region that was last recognized, so slow changes are detected too
+    parameter->PreviousScreenRegion.assign(region, region + regionSize);
+  }
+  return changed;
 }
 
 //----------------------------------------------------------------------------
-void vtkPlusVirtualTextRecognizer::vtkImageDataToPix(igsioTrackedFrame& frame, TextFieldParameter* parameter)
+bool vtkPlusVirtualTextRecognizer::vtkImageDataToPix(igsioTrackedFrame& frame, TextFieldParameter* parameter)
 {
   igsioVideoFrame::GetOrientedClippedImage(frame.GetImageData()->GetImage(),
       igsioVideoFrame::FlipInfoType(),
@@ -158,75 +307,109 @@ void vtkPlusVirtualTextRecognizer::vtkImageDataToPix(igsioTrackedFrame& frame, T
       parameter->Origin,
       parameter->Size);
 
-  unsigned int* data = pixGetData(parameter->ReceivedFrame);
-  int wpl = pixGetWpl(parameter->ReceivedFrame);
-  int bpl = ((8 * parameter->Size[0]) + 7) / 8;
-  unsigned int* line;
-  unsigned char val8;
-
-  int extents[6];
-  parameter->ScreenRegion->GetExtent(extents);
-  int ySize = extents[3] - extents[2];
+  if (!this->HasScreenRegionChanged(parameter))
+  {
+    return false;
+  }
 
-  int coords[3] = {0, 0, 0};
-  for (int y = 0; y < ySize; y++)
+  int dimensions[3] = { 0, 0, 0 };
+  parameter->ScreenRegion->GetDimensions(dimensions);
+  const unsigned int width = static_cast<unsigned int>(std::min(dimensions[0], parameter->Size[0]));
+  const unsigned int height = static_cast<unsigned int>(std::min(dimensions[1], parameter->Size[1]));
+  const unsigned int factor = static_cast<unsigned int>(parameter->UpscaleFactor);
+  const unsigned char* region = static_cast<const unsigned char*>(parameter->ScreenRegion->GetScalarPointer());
+
+  l_uint32* data = pixGetData(parameter->ReceivedFrame);
+  const int wpl = pixGetWpl(parameter->ReceivedFrame);
+  parameter->PreprocessedRows.resize(width * (factor + 1));
+  for (unsigned int y = 0; y < height; y++)
   {
-    coords[1] = ySize - y - 1 + extents[2];
-    line = data + y * wpl;
-    for (int x = 0; x < bpl; x++)
+    // VTK images are stored from the bottom row up, leptonica images from the top row down
+    const unsigned char* row = region + static_cast<size_t>(height - 1 - y) * dimensions[0];
+    if (this->CropBinarizationThreshold >= 0)
+    {
+      PlusPixelKernels::ThresholdRow(row, &parameter->PreprocessedRows[0], width, static_cast<unsigned char>(this->CropBinarizationThreshold));
+      row = &parameter->PreprocessedRows[0];
+    }
+    if (factor > 1)
     {
-      coords[0] = x + extents[0];
-      val8 = (*(unsigned char*)parameter->ScreenRegion->GetScalarPointer(coords));
-      SET_DATA_BYTE(line, x, val8);
+      PlusPixelKernels::UpscaleRow(row, &parameter->PreprocessedRows[width], width, factor);
+      row = &parameter->PreprocessedRows[width];
+    }
+    for (unsigned int i = 0; i < factor; i++)
+    {
+      memcpy(data + (y * factor + i) * wpl, row, width * factor);
     }
   }
+  // The rows are copied in image order, but leptonica stores the pixels of each 32-bit word in host byte order
+  pixEndianByteSwap(parameter->ReceivedFrame);
+  return true;
 }
 
 //----------------------------------------------------------------------------
-PlusStatus vtkPlusVirtualTextRecognizer::FindOrQueryFrame(igsioTrackedFrame& frame, std::map<double, int>& QueriedFramesIndexes, TextFieldParameter* parameter, std::vector<igsioTrackedFrame*>& QueriedFrames)
+PlusStatus vtkPlusVirtualTextRecognizer::CreateRecognitionEngines(unsigned int numberOfEngines)
 {
-  double mostRecent(-1);
-
-  if (!parameter->SourceChannel->GetVideoDataAvailable())
+  if (!this->RecognitionEngines.empty()
+      && (this->RecognitionEnginesLanguage != this->Language || this->RecognitionEnginesTessdataDirectory != this->TessdataDirectory))
   {
-    LOG_WARNING("Processed data is not generated, as no video data is available yet. Device ID: " << this->GetDeviceId());
-    return PLUS_FAIL;
+    LOG_DEBUG("Language data of the text recognizer has changed, OCR engines are initialized again");
+    this->DeleteRecognitionEngines();
   }
+  this->RecognitionEnginesLanguage = this->Language;
+  this->RecognitionEnginesTessdataDirectory = this->TessdataDirectory;
 
-  if (parameter->SourceChannel->GetMostRecentTimestamp(mostRecent) != PLUS_SUCCESS)
+  while (this->RecognitionEngines.size() > numberOfEngines)
   {
-    LOG_ERROR("Unable to retrieve most recent timestamp for parameter " << parameter->ParameterName);
-    return PLUS_FAIL;
+    delete this->RecognitionEngines.back();
+    this->RecognitionEngines.pop_back();
   }
-
-  // Search the retrieved frames to see is this timestamp has already been pulled
-  std::map<double, int>::iterator frameIt = QueriedFramesIndexes.find(mostRecent);
-
-  // If it hasn't, go get the latest
-  if (frameIt == QueriedFramesIndexes.end())
+  while (this->RecognitionEngines.size() < numberOfEngines)
   {
-    this->TrackedFrames->Clear();
-    double aTimestamp(UNDEFINED_TIMESTAMP);
-    if (parameter->SourceChannel->GetTrackedFrameList(aTimestamp, this->TrackedFrames, 1) != PLUS_SUCCESS)
+    tesseract::TessBaseAPI* engine = new tesseract::TessBaseAPI();
+    if (engine->Init(NULL, this->Language.c_str(), tesseract::OEM_TESSERACT_CUBE_COMBINED) != 0)
     {
-      LOG_INFO("Failed to get tracked frame list from data collector.");
+      LOG_ERROR("Unable to init tesseract library. Cannot perform text recognition.");
+      delete engine;
+      this->FreeRecognitionEngines = this->RecognitionEngines;
       return PLUS_FAIL;
     }
-    double timestamp = TrackedFrames->GetTrackedFrame(0)->GetTimestamp();
-
-    // Copy the frame so it isn't lost when the tracked frame list is cleared
-    frame = (*TrackedFrames->GetTrackedFrame(0));
-
-    // Record the index of this timestamp
-    QueriedFramesIndexes[timestamp] = QueriedFrames.size();
-    QueriedFrames.push_back(&frame);
+    engine->SetPageSegMode(tesseract::PSM_SINGLE_LINE);
+    this->RecognitionEngines.push_back(engine);
   }
-  else
+  this->FreeRecognitionEngines = this->RecognitionEngines;
+  LOG_DEBUG("Text recognizer " << this->GetDeviceId() << " uses " << this->RecognitionEngines.size() << " OCR engines");
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusVirtualTextRecognizer::DeleteRecognitionEngines()
+{
+  for (std::vector<tesseract::TessBaseAPI*>::iterator it = this->RecognitionEngines.begin(); it != this->RecognitionEngines.end(); ++it)
   {
-    frame = (*QueriedFrames[frameIt->second]);
+    delete *it;
   }
+  this->RecognitionEngines.clear();
+  this->FreeRecognitionEngines.clear();
+}
 
-  return PLUS_SUCCESS;
+//----------------------------------------------------------------------------
+tesseract::TessBaseAPI* vtkPlusVirtualTextRecognizer::AcquireRecognitionEngine()
+{
+  std::unique_lock<std::mutex> lock(this->RecognitionEnginesMutex);
+  this->RecognitionEngineReleased.wait(lock, [this]() { return !this->FreeRecognitionEngines.empty(); });
+  tesseract::TessBaseAPI* engine = this->FreeRecognitionEngines.back();
+  this->FreeRecognitionEngines.pop_back();
+  return engine;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusVirtualTextRecognizer::ReleaseRecognitionEngine(tesseract::TessBaseAPI* engine)
+{
+  {
+    std::lock_guard<std::mutex> lock(this->RecognitionEnginesMutex);
+    this->FreeRecognitionEngines.push_back(engine);
+  }
+  this->RecognitionEngineReleased.notify_one();
 }
 
 //----------------------------------------------------------------------------
@@ -240,18 +423,49 @@ PlusStatus vtkPlusVirtualTextRecognizer::InternalConnect()
     }
   }
   LOG_DEBUG("Using tessdata directory: " << this->TessdataDirectory);
+  this->BacklogPolicy.Reset();
 
   std::stringstream ss;
   ss << "TESSDATA_PREFIX=" << this->TessdataDirectory;
   vtksys::SystemTools::PutEnv(ss.str());
 
-  this->TesseractAPI = new tesseract::TessBaseAPI();
-  if (this->TesseractAPI->Init(NULL, Language.c_str(), tesseract::OEM_TESSERACT_CUBE_COMBINED) != 0)
+  const int upscaleFactor = std::min(std::max(this->CropUpscaleFactor, 1), MAXIMUM_CROP_UPSCALE_FACTOR);
+  unsigned int numberOfFields = 0;
+  for (ChannelFieldListMapIterator it = this->RecognitionFields.begin(); it != this->RecognitionFields.end(); ++it)
   {
-    LOG_ERROR("Unable to init tesseract library. Cannot perform text recognition.");
-    return PLUS_FAIL;
+    for (FieldListIterator fieldIt = it->second.begin(); fieldIt != it->second.end(); ++fieldIt)
+    {
+      TextFieldParameter* parameter = *fieldIt;
+      parameter->PreviousScreenRegion.clear();
+      parameter->NumberOfRecognitions = 0;
+      parameter->LastRecognitionTimeSec = 0.0;
+      parameter->TotalRecognitionTimeSec = 0.0;
+      parameter->MaximumRecognitionTimeSec = 0.0;
+      if (parameter->ReceivedFrame != NULL)
+      {
+        pixDestroy(&parameter->ReceivedFrame);
+      }
+      parameter->UpscaleFactor = upscaleFactor;
+      parameter->ReceivedFrame = pixCreate(parameter->Size[0] * upscaleFactor, parameter->Size[1] * upscaleFactor, PARAMETER_DEPTH_BITS);
+      numberOfFields++;
+    }
+  }
+
+  // Initialized engines are kept from the previous connection, more engines than fields would never be used
+  if (numberOfFields > 0)
+  {
+    unsigned int numberOfEngines = 1;
+    if (this->EnableParallelRecognition)
+    {
+      numberOfEngines = (this->NumberOfRecognitionEngines > 0) ? this->NumberOfRecognitionEngines : PlusWorkerPool::GetInstance().GetNumberOfThreads() + 1;
+    }
+    if (this->CreateRecognitionEngines(std::min(numberOfEngines, numberOfFields)) != PLUS_SUCCESS)
+    {
+      return PLUS_FAIL;
+    }
   }
-  this->TesseractAPI->SetPageSegMode(tesseract::PSM_SINGLE_LINE);
+  this->NumberOfRecognitions = 0;
+  this->NumberOfUnchangedRegions = 0;
 
   return PLUS_SUCCESS;
 }
@@ -259,8 +473,26 @@ PlusStatus vtkPlusVirtualTextRecognizer::InternalConnect()
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusVirtualTextRecognizer::InternalDisconnect()
 {
-  delete this->TesseractAPI;
-  this->TesseractAPI = NULL;
+  LOG_INFO("Text recognizer " << this->GetDeviceId() << " recognized " << this->NumberOfRecognitions << " field regions, " << this->NumberOfUnchangedRegions << " unchanged regions were not recognized again");
+  for (ChannelFieldListMapIterator it = this->RecognitionFields.begin(); it != this->RecognitionFields.end(); ++it)
+  {
+    for (FieldListIterator fieldIt = it->second.begin(); fieldIt != it->second.end(); ++fieldIt)
+    {
+      TextFieldParameter* parameter = *fieldIt;
+      if (parameter->NumberOfRecognitions > 0)
+      {
+        LOG_INFO("Text recognizer " << this->GetDeviceId() << " field " << parameter->ParameterName << " recognition time: average "
+                 << parameter->TotalRecognitionTimeSec / parameter->NumberOfRecognitions * 1000.0 << " ms, maximum "
+                 << parameter->MaximumRecognitionTimeSec * 1000.0 << " ms, last " << parameter->LastRecognitionTimeSec * 1000.0 << " ms");
+      }
+    }
+  }
+
+  if (this->BacklogPolicy.GetNumberOfSkippedFrames() > 0)
+  {
+    LOG_INFO("Text recognizer " << this->GetDeviceId() << " skipped " << this->BacklogPolicy.GetNumberOfSkippedFrames() << " input frames ("
+             << PlusFrameBacklogPolicy::GetBacklogPolicyAsString(this->BacklogPolicy.GetBacklogPolicy()) << " backlog policy)");
+  }
 
   ClearConfiguration();
 
@@ -290,6 +522,28 @@ PlusStatus vtkPlusVirtualTextRecognizer::ReadConfiguration(vtkXMLDataElement* ro
   this->SetLanguage(DEFAULT_LANGUAGE);
   XML_READ_CSTRING_ATTRIBUTE_OPTIONAL(Language, deviceConfig);
   XML_READ_STRING_ATTRIBUTE_OPTIONAL(TessdataDirectory, deviceConfig);
+  this->BacklogPolicy.ReadConfiguration(deviceConfig);
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(EnableChangeDetection, deviceConfig);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, ChangeDetectionThreshold, deviceConfig);
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(EnableParallelRecognition, deviceConfig);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, NumberOfRecognitionEngines, deviceConfig);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, CropUpscaleFactor, deviceConfig);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, CropBinarizationThreshold, deviceConfig);
+  if (this->NumberOfRecognitionEngines < 0)
+  {
+    LOG_ERROR("NumberOfRecognitionEngines must not be negative");
+    return PLUS_FAIL;
+  }
+  if (this->CropUpscaleFactor < 1 || this->CropUpscaleFactor > MAXIMUM_CROP_UPSCALE_FACTOR)
+  {
+    LOG_ERROR("CropUpscaleFactor must be between 1 and " << MAXIMUM_CROP_UPSCALE_FACTOR);
+    return PLUS_FAIL;
+  }
+  if (this->CropBinarizationThreshold < -1 || this->CropBinarizationThreshold > 255)
+  {
+    LOG_ERROR("CropBinarizationThreshold must be between 0 and 255, or -1 to disable binarization");
+    return PLUS_FAIL;
+  }
 
   XML_FIND_NESTED_ELEMENT_OPTIONAL(screenFields, deviceConfig, PARAMETER_LIST_TAG_NAME);
  
@@ -333,7 +587,6 @@ PlusStatus vtkPlusVirtualTextRecognizer::ReadConfiguration(vtkXMLDataElement* ro
     parameter->Origin[1] = origin[1];
     parameter->Size[0] = size[0];
     parameter->Size[1] = size[1];
-    parameter->ReceivedFrame = pixCreate(parameter->Size[0], parameter->Size[1], PARAMETER_DEPTH_BITS);
     parameter->ScreenRegion = vtkSmartPointer<vtkImageData>::New();
     parameter->ScreenRegion->SetExtent(0, size[0] - 1, 0, size[1] - 1, 0, 0);
     parameter->ScreenRegion->AllocateScalars(VTK_UNSIGNED_CHAR, 1); // Black and white images for now
@@ -353,6 +606,13 @@ PlusStatus vtkPlusVirtualTextRecognizer::WriteConfiguration(vtkXMLDataElement* r
   {
     XML_WRITE_STRING_ATTRIBUTE_IF_NOT_EMPTY(Language, deviceConfig);
   }
+  this->BacklogPolicy.WriteConfiguration(deviceConfig);
+  XML_WRITE_BOOL_ATTRIBUTE(EnableChangeDetection, deviceConfig);
+  deviceConfig->SetDoubleAttribute("ChangeDetectionThreshold", this->ChangeDetectionThreshold);
+  XML_WRITE_BOOL_ATTRIBUTE(EnableParallelRecognition, deviceConfig);
+  deviceConfig->SetIntAttribute("NumberOfRecognitionEngines", this->NumberOfRecognitionEngines);
+  deviceConfig->SetIntAttribute("CropUpscaleFactor", this->CropUpscaleFactor);
+  deviceConfig->SetIntAttribute("CropBinarizationThreshold", this->CropBinarizationThreshold);
 
   XML_FIND_NESTED_ELEMENT_CREATE_IF_MISSING(screenFields, deviceConfig, PARAMETER_LIST_TAG_NAME);
 
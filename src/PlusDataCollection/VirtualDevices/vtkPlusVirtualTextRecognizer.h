@@ -11,6 +11,10 @@ See License.txt for details.
 #include "vtkPlusDataCollectionExport.h"
 #include "vtkPlusChannel.h"
 #include "vtkPlusDevice.h"
+#include "PlusFrameBacklogPolicy.h"
+
+#include <condition_variable>
+#include <mutex>
 
 namespace tesseract
 {
@@ -21,7 +25,11 @@ typedef struct Pix PIX;
 
 /*!
 \class vtkPlusVirtualTextRecognizer
-\brief
+\brief Recognizes text in regions of the frames of the input channels and sends it as fields of the output channel
+
+Initialization of an OCR engine takes much longer than recognizing a field, therefore the engines are kept in a pool
+that persists until the device is deleted; it is only initialized again if the language or the tessdata directory changes.
+The fields of all input channels are recognized in parallel, each task takes an engine from the pool for its fields.
 
 \ingroup PlusLibDataCollection
 */
@@ -41,6 +49,12 @@ public:
       this->Size[0] = 0;
       this->Size[1] = 0;
       this->Size[2] = 1;
+      this->ReceivedFrame = NULL;
+      this->NumberOfRecognitions = 0;
+      this->LastRecognitionTimeSec = 0.0;
+      this->TotalRecognitionTimeSec = 0.0;
+      this->MaximumRecognitionTimeSec = 0.0;
+      this->UpscaleFactor = 1;
     }
 
   public:
@@ -53,6 +67,19 @@ public:
     std::array<int, 3> Origin;
     /// This is only 3d for simplicity in passing to clipping function, OCR is 2d only
     std::array<int, 3> Size;
+    /// Pixels of the region when the text was last recognized, used for detecting changes
+    std::vector<unsigned char> PreviousScreenRegion;
+    /// Binarized and upscaled rows of the region, reused between frames
+    std::vector<unsigned char> PreprocessedRows;
+    /// Value of the field in each frame of the current update
+    std::vector<std::string> FrameValues;
+    /// Recognition time statistics since connect
+    unsigned long NumberOfRecognitions;
+    double LastRecognitionTimeSec;
+    double TotalRecognitionTimeSec;
+    double MaximumRecognitionTimeSec;
+    /// Each pixel of the region is repeated this many times in ReceivedFrame
+    int UpscaleFactor;
   };
 
 public:
@@ -93,6 +120,43 @@ public:
   vtkSetStdStringMacro(TessdataDirectory);
   vtkGetStdStringMacro(TessdataDirectory);
 
+  /*! If enabled then the text of a field is only recognized again if its region of the image has changed */
+  vtkSetMacro(EnableChangeDetection, bool);
+  vtkGetMacro(EnableChangeDetection, bool);
+  vtkBooleanMacro(EnableChangeDetection, bool);
+
+  /*! Regions with a mean absolute pixel difference not larger than this are considered unchanged. 0 means any difference is a change. */
+  vtkSetMacro(ChangeDetectionThreshold, double);
+  vtkGetMacro(ChangeDetectionThreshold, double);
+
+  /*! If enabled then the fields of all input channels are recognized in parallel on the shared worker pool */
+  vtkSetMacro(EnableParallelRecognition, bool);
+  vtkGetMacro(EnableParallelRecognition, bool);
+  vtkBooleanMacro(EnableParallelRecognition, bool);
+
+  /*!
+    Number of OCR engines in the pool, which is the maximum number of fields recognized at the same time.
+    0 means one engine for each field, but not more than the number of worker threads. Takes effect at the next connect.
+  */
+  vtkSetMacro(NumberOfRecognitionEngines, int);
+  vtkGetMacro(NumberOfRecognitionEngines, int);
+
+  /*! Each pixel of the field regions is repeated this many times horizontally and vertically before recognition, small text is recognized more reliably when it is upscaled. Takes effect at the next connect. */
+  vtkSetMacro(CropUpscaleFactor, int);
+  vtkGetMacro(CropUpscaleFactor, int);
+
+  /*! Pixels of the field regions above this value are set to white, others to black before recognition. -1 means that the regions are not binarized. */
+  vtkSetMacro(CropBinarizationThreshold, int);
+  vtkGetMacro(CropBinarizationThreshold, int);
+
+  /*! Number of times the text of a field region was recognized since connect */
+  vtkGetMacro(NumberOfRecognitions, unsigned long);
+  /*! Number of times the text of a field region was not recognized because the region has not changed */
+  vtkGetMacro(NumberOfUnchangedRegions, unsigned long);
+
+  /*! Selects the input frames to recognize when frames are acquired faster than they can be recognized */
+  PlusFrameBacklogPolicy& GetBacklogPolicy() { return this->BacklogPolicy; }
+
 #ifdef PLUS_TEST_TextRecognizer
   ChannelFieldListMap& GetRecognitionFields();
 #endif
@@ -103,21 +167,35 @@ protected:
   /// Remove any configuration data
   void ClearConfiguration();
 
-  /// Convert a vtkImage data to leptonica pix format
-  void vtkImageDataToPix(igsioTrackedFrame& frame, TextFieldParameter* parameter);
+  /// Convert the region of a field to leptonica pix format, binarize and upscale it. Returns false (and skips the conversion) if the region has not changed.
+  bool vtkImageDataToPix(igsioTrackedFrame& frame, TextFieldParameter* parameter);
+
+  /// Compare the clipped region of a field to the region at the previous recognition
+  bool HasScreenRegionChanged(TextFieldParameter* parameter);
+
+  /// Recognize the text in the pix image of a field
+  void RecognizeField(TextFieldParameter* parameter, tesseract::TessBaseAPI* engine);
+
+  /// Make sure that the pool contains the requested number of initialized OCR engines
+  PlusStatus CreateRecognitionEngines(unsigned int numberOfEngines);
+
+  /// Delete all OCR engines of the pool
+  void DeleteRecognitionEngines();
 
-  /// If a frame has been queried for this input channel, reuse it instead of getting a new one
-  PlusStatus FindOrQueryFrame(igsioTrackedFrame& frame, std::map<double, int>& queriedFramesIndexes, TextFieldParameter* parameter,
-                              std::vector<igsioTrackedFrame*>& queriedFrames);
+  /// Take an OCR engine from the pool, wait if all engines are in use
+  tesseract::TessBaseAPI* AcquireRecognitionEngine();
+
+  /// Return an OCR engine to the pool
+  void ReleaseRecognitionEngine(tesseract::TessBaseAPI* engine);
+
+  /// Send the latest recognized values of all fields to the output channel
+  void AddRecognizedFields();
 
   /// Language used for detection
   std::string                 Language;
 
   std::string                 TessdataDirectory;
 
-  /// Main entry point for the tesseract API
-  tesseract::TessBaseAPI*     TesseractAPI;
-
   vtkIGSIOTrackedFrameList*    TrackedFrames;
 
   /// Map of channels to fields so that we only have to grab an image once from the each source channel
@@ -126,6 +204,27 @@ protected:
   /// Optional output channel to store recognized fields for broadcasting
   vtkPlusChannel*             OutputChannel;
 
+  /// Selects the frames of each input channel that are recognized
+  PlusFrameBacklogPolicy      BacklogPolicy;
+
+  bool                        EnableChangeDetection;
+  double                      ChangeDetectionThreshold;
+  bool                        EnableParallelRecognition;
+  int                         NumberOfRecognitionEngines;
+  int                         CropUpscaleFactor;
+  int                         CropBinarizationThreshold;
+  unsigned long               NumberOfRecognitions;
+  unsigned long               NumberOfUnchangedRegions;
+
+  /// OCR engines, an engine cannot be used by multiple threads at the same time
+  std::vector<tesseract::TessBaseAPI*> RecognitionEngines;
+  std::vector<tesseract::TessBaseAPI*> FreeRecognitionEngines;
+  std::mutex                  RecognitionEnginesMutex;
+  std::condition_variable     RecognitionEngineReleased;
+  /// Language and tessdata directory that the engines are initialized with
+  std::string                 RecognitionEnginesLanguage;
+  std::string                 RecognitionEnginesTessdataDirectory;
+
 protected:
   vtkPlusVirtualTextRecognizer();
   virtual ~vtkPlusVirtualTextRecognizer();
@@ -6,6 +6,8 @@ See License.txt for details.
 
 #include "PlusConfigure.h"
 #include "igsioTrackedFrame.h"
+#include "vtkImageData.h"
+#include "vtkMatrix4x4.h"
 #include "vtkObjectFactory.h"
 #include "vtkPlusChannel.h"
 #include "vtkPlusDataSource.h"
@@ -16,11 +18,92 @@ See License.txt for details.
 #include "vtkPlusVolumeReconstructor.h"
 #include "vtksys/SystemTools.hxx"
 
+// STL includes
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+
 //----------------------------------------------------------------------------
 
 vtkStandardNewMacro(vtkPlusVirtualVolumeReconstructor);
 
 static const int MAX_ALLOWED_RECONSTRUCTION_LAG_SEC = 3.0; // if the reconstruction lags more than this then it'll skip frames to catch up
+static const size_t MAX_NUMBER_OF_RECORDED_VOLUME_CHANGES = 1000; // older changes are forgotten, clients that have an older volume get the full volume
+static const size_t MAX_NUMBER_OF_CHANGED_EXTENTS = 32; // if there are more changed extents then they are merged into one
+static const double RECONSTRUCTION_RATE_UPDATE_PERIOD_SEC = 1.0; // input and insertion frame rates are computed over this period
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  bool ExtentsOverlap(const vtkPlusVirtualVolumeReconstructor::ExtentType& a, const vtkPlusVirtualVolumeReconstructor::ExtentType& b)
+  {
+    for (int axis = 0; axis < 3; ++axis)
+    {
+      // Touching extents are merged, too
+      if (a[2 * axis] > b[2 * axis + 1] + 1 || b[2 * axis] > a[2 * axis + 1] + 1)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  void MergeExtent(vtkPlusVirtualVolumeReconstructor::ExtentType& extent, const vtkPlusVirtualVolumeReconstructor::ExtentType& otherExtent)
+  {
+    for (int axis = 0; axis < 3; ++axis)
+    {
+      extent[2 * axis] = std::min(extent[2 * axis], otherExtent[2 * axis]);
+      extent[2 * axis + 1] = std::max(extent[2 * axis + 1], otherExtent[2 * axis + 1]);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Add an extent to the list of disjoint extents, merging it with all the extents that it overlaps */
+  void AddExtent(std::vector<vtkPlusVirtualVolumeReconstructor::ExtentType>& extents, vtkPlusVirtualVolumeReconstructor::ExtentType extent)
+  {
+    bool merged = true;
+    while (merged)
+    {
+      merged = false;
+      for (std::vector<vtkPlusVirtualVolumeReconstructor::ExtentType>::iterator it = extents.begin(); it != extents.end(); ++it)
+      {
+        if (ExtentsOverlap(*it, extent))
+        {
+          MergeExtent(extent, *it);
+          extents.erase(it);
+          merged = true;
+          break;
+        }
+      }
+    }
+    extents.push_back(extent);
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Copy a part of the volume into a new image, with the origin set so that the voxel positions are kept */
+  vtkSmartPointer<vtkImageData> ExtractSubVolume(vtkImageData* volume, const vtkPlusVirtualVolumeReconstructor::ExtentType& extent)
+  {
+    const double* origin = volume->GetOrigin();
+    const double* spacing = volume->GetSpacing();
+    vtkSmartPointer<vtkImageData> subVolume = vtkSmartPointer<vtkImageData>::New();
+    subVolume->SetSpacing(spacing[0], spacing[1], spacing[2]);
+    subVolume->SetOrigin(origin[0] + extent[0] * spacing[0], origin[1] + extent[2] * spacing[1], origin[2] + extent[4] * spacing[2]);
+    subVolume->SetExtent(0, extent[1] - extent[0], 0, extent[3] - extent[2], 0, extent[5] - extent[4]);
+    subVolume->AllocateScalars(volume->GetScalarType(), volume->GetNumberOfScalarComponents());
+
+    const size_t rowSizeInBytes = static_cast<size_t>(extent[1] - extent[0] + 1) * volume->GetScalarSize() * volume->GetNumberOfScalarComponents();
+    for (int k = extent[4]; k <= extent[5]; ++k)
+    {
+      for (int j = extent[2]; j <= extent[3]; ++j)
+      {
+        memcpy(subVolume->GetScalarPointer(0, j - extent[2], k - extent[4]), volume->GetScalarPointer(extent[0], j, k), rowSizeInBytes);
+      }
+    }
+    return subVolume;
+  }
+}
 
 //----------------------------------------------------------------------------
 vtkPlusVirtualVolumeReconstructor::vtkPlusVirtualVolumeReconstructor()
@@ -33,6 +116,16 @@ vtkPlusVirtualVolumeReconstructor::vtkPlusVirtualVolumeReconstructor()
   , m_LastUpdateTime(0.0)
   , TotalFramesRecorded(0)
   , EnableReconstruction(false)
+  , VolumeSequenceNumber(0)
+  , FirstKnownSequenceNumber(0)
+  , ChangedExtentMargin(1)
+  , FrameQueueSize(64)
+  , NumberOfFramesBeingInserted(0)
+  , ReconstructionThreadActive(false)
+  , LastRateUpdateReceivedFrames(0)
+  , LastRateUpdateInsertedFrames(0)
+  , LastRateUpdateDroppedFrames(0)
+  , LastRateUpdateTime(0.0)
   , VolumeReconstructorAccessMutex(vtkSmartPointer<vtkIGSIORecursiveCriticalSection>::New())
 {
   // The data capture thread will be used to regularly read the frames and write to disk
@@ -40,11 +133,21 @@ vtkPlusVirtualVolumeReconstructor::vtkPlusVirtualVolumeReconstructor()
 
   this->VolumeReconstructor = vtkSmartPointer<vtkPlusVolumeReconstructor>::New();
   this->TransformRepository = vtkSmartPointer<vtkIGSIOTransformRepository>::New();
+  this->FrameTransformRepository = vtkSmartPointer<vtkIGSIOTransformRepository>::New();
+
+  this->Statistics.ReceivedFrames = 0;
+  this->Statistics.InsertedFrames = 0;
+  this->Statistics.DroppedFrames = 0;
+  this->Statistics.QueuedFrames = 0;
+  this->Statistics.InputFrameRate = 0.0;
+  this->Statistics.InsertionFrameRate = 0.0;
+  this->Statistics.LatencySec = 0.0;
 }
 
 //----------------------------------------------------------------------------
 vtkPlusVirtualVolumeReconstructor::~vtkPlusVirtualVolumeReconstructor()
 {
+  this->StopReconstructionThread();
 }
 
 //----------------------------------------------------------------------------
@@ -61,6 +164,13 @@ PlusStatus vtkPlusVirtualVolumeReconstructor::ReadConfiguration(vtkXMLDataElemen
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(EnableReconstruction, deviceConfig);
   XML_READ_CSTRING_ATTRIBUTE_OPTIONAL(OutputVolFilename, deviceConfig);
   XML_READ_CSTRING_ATTRIBUTE_OPTIONAL(OutputVolDeviceName, deviceConfig);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, ChangedExtentMargin, deviceConfig);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, FrameQueueSize, deviceConfig);
+  if (this->FrameQueueSize < 1)
+  {
+    LOG_WARNING("FrameQueueSize must be positive, using 1 instead of " << this->FrameQueueSize);
+    this->FrameQueueSize = 1;
+  }
 
   igsioLockGuard<vtkIGSIORecursiveCriticalSection> writerLock(this->VolumeReconstructorAccessMutex);
   this->VolumeReconstructor->ReadConfiguration(deviceConfig);
@@ -77,6 +187,8 @@ PlusStatus vtkPlusVirtualVolumeReconstructor::WriteConfiguration(vtkXMLDataEleme
 
   deviceElement->SetAttribute("OutputVolFilename", this->OutputVolFilename.c_str());
   deviceElement->SetAttribute("OutputVolDeviceName", this->OutputVolDeviceName.c_str());
+  deviceElement->SetIntAttribute("ChangedExtentMargin", this->ChangedExtentMargin);
+  deviceElement->SetIntAttribute("FrameQueueSize", this->FrameQueueSize);
 
   igsioLockGuard<vtkIGSIORecursiveCriticalSection> writerLock(this->VolumeReconstructorAccessMutex);
   this->VolumeReconstructor->WriteConfiguration(deviceElement);
@@ -109,6 +221,8 @@ PlusStatus vtkPlusVirtualVolumeReconstructor::InternalConnect()
 
   m_LastUpdateTime = vtkIGSIOAccurateTimer::GetSystemTime();
 
+  this->StartReconstructionThread();
+
   return PLUS_SUCCESS;
 }
 
@@ -116,6 +230,7 @@ PlusStatus vtkPlusVirtualVolumeReconstructor::InternalConnect()
 PlusStatus vtkPlusVirtualVolumeReconstructor::InternalDisconnect()
 {
   SetEnableReconstruction(false);
+  this->StopReconstructionThread();
   return PLUS_SUCCESS;
 }
 
@@ -148,7 +263,7 @@ PlusStatus vtkPlusVirtualVolumeReconstructor::InternalUpdate()
 
   m_TimeWaited = 0.0;
 
-  double maxProcessingTimeSec = GetSamplingPeriodSec() * 2.0; // put a hard limit on the max processing time to make sure the application remains responsive during reconstruction
+  double maxProcessingTimeSec = GetSamplingPeriodSec() * 2.0; // put a hard limit on the time of getting the frames to make sure the application remains responsive
   double requestedFramePeriodSec = 0.1;
   double requestedFrameRate = this->RequestedFrameRate;
   if (requestedFrameRate <= 0)
@@ -165,13 +280,6 @@ PlusStatus vtkPlusVirtualVolumeReconstructor::InternalUpdate()
     LOG_WARNING("RequestedFrameRate is invalid, use default: " << 1 / requestedFramePeriodSec);
   }
 
-  igsioLockGuard<vtkIGSIORecursiveCriticalSection> writerLock(this->VolumeReconstructorAccessMutex);
-  if (!this->EnableReconstruction)
-  {
-    // While this thread was waiting for the unlock, capturing was disabled, so cancel the update now
-    return PLUS_SUCCESS;
-  }
-
   if (this->OutputChannels.empty())
   {
     LOG_ERROR("No output channels defined");
@@ -179,6 +287,8 @@ PlusStatus vtkPlusVirtualVolumeReconstructor::InternalUpdate()
   }
   vtkPlusChannel* outputChannel = this->OutputChannels[0];
 
+  // Frames are only received here, they are inserted into the volume by the reconstruction thread,
+  // so a slow insertion does not delay the sampling of the input
   vtkSmartPointer<vtkIGSIOTrackedFrameList> recordedFrames = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
   if (outputChannel->GetTrackedFrameListSampled(m_LastAlreadyRecordedFrameTimestamp, m_NextFrameToBeRecordedTimestamp, recordedFrames, requestedFramePeriodSec, maxProcessingTimeSec) != PLUS_SUCCESS)
   {
@@ -186,31 +296,184 @@ PlusStatus vtkPlusVirtualVolumeReconstructor::InternalUpdate()
   }
   int nbFramesRecorded = recordedFrames->GetNumberOfTrackedFrames();
 
-  if (this->AddFrames(recordedFrames) != PLUS_SUCCESS)
+  long numberOfSkippedFrames = 0;
+  double recordingLagSec = vtkIGSIOAccurateTimer::GetSystemTime() - m_NextFrameToBeRecordedTimestamp;
+  if (recordingLagSec > MAX_ALLOWED_RECONSTRUCTION_LAG_SEC)
   {
-    LOG_ERROR(this->GetDeviceId() << ": Unable to add " << nbFramesRecorded << " frames for volume reconstruction");
-    return PLUS_FAIL;
+    // Getting the frames cannot keep up with the acquisition, the skipped frames are counted as dropped
+    numberOfSkippedFrames = static_cast<long>(recordingLagSec / requestedFramePeriodSec);
+    LOG_ERROR("Volume reconstruction cannot keep up with the acquisition. Skip " << recordingLagSec << " seconds of the data stream to catch up.");
+    m_NextFrameToBeRecordedTimestamp = vtkIGSIOAccurateTimer::GetSystemTime();
   }
 
+  {
+    std::lock_guard<std::mutex> queueLock(this->FrameQueueMutex);
+    if (!this->EnableReconstruction)
+    {
+      // Reconstruction was disabled while the frames were retrieved, do not add them
+      return PLUS_SUCCESS;
+    }
+    for (int frameIndex = 0; frameIndex < nbFramesRecorded; ++frameIndex)
+    {
+      if (static_cast<int>(this->FrameQueue.size()) >= this->FrameQueueSize)
+      {
+        // Insertion cannot keep up, drop the oldest frame to keep the latency of the live volume bounded
+        this->FrameQueue.pop_front();
+        this->Statistics.DroppedFrames++;
+      }
+      QueuedFrame queuedFrame;
+      queuedFrame.FrameList = recordedFrames;
+      queuedFrame.FrameIndex = frameIndex;
+      this->FrameQueue.push_back(queuedFrame);
+    }
+    this->Statistics.ReceivedFrames += nbFramesRecorded;
+    this->Statistics.DroppedFrames += numberOfSkippedFrames;
+  }
+  this->FrameQueueCondition.notify_all();
+
   this->TotalFramesRecorded += nbFramesRecorded;
 
-  // Check whether the reconstruction needed more time than the sampling interval
-  double recordingTimeSec = vtkIGSIOAccurateTimer::GetSystemTime() - startTimeSec;
-  if (recordingTimeSec > GetSamplingPeriodSec())
+  this->UpdateReconstructionStatistics();
+
+  m_LastUpdateTime = vtkIGSIOAccurateTimer::GetSystemTime();
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusVirtualVolumeReconstructor::StartReconstructionThread()
+{
+  std::lock_guard<std::mutex> queueLock(this->FrameQueueMutex);
+  if (this->ReconstructionThreadActive)
   {
-    LOG_WARNING("Volume reconstruction of the acquired " << nbFramesRecorded << " frames takes too long time (" << recordingTimeSec << "sec instead of the allocated " << GetSamplingPeriodSec() << "sec). This can cause slow-down of the application and non-uniform sampling. Reduce the image acquisition rate, output size, or image clip rectangle size to resolve the problem.");
+    return;
   }
-  double recordingLagSec = vtkIGSIOAccurateTimer::GetSystemTime() - m_NextFrameToBeRecordedTimestamp;
+  this->ReconstructionThreadActive = true;
+  this->ReconstructionThread = std::thread(&vtkPlusVirtualVolumeReconstructor::RunReconstructionThread, this);
+}
 
-  if (recordingLagSec > MAX_ALLOWED_RECONSTRUCTION_LAG_SEC)
+//----------------------------------------------------------------------------
+void vtkPlusVirtualVolumeReconstructor::StopReconstructionThread()
+{
   {
-    LOG_ERROR("Volume reconstruction cannot keep up with the acquisition. Skip " << recordingLagSec << " seconds of the data stream to catch up.");
-    m_NextFrameToBeRecordedTimestamp = vtkIGSIOAccurateTimer::GetSystemTime();
+    std::lock_guard<std::mutex> queueLock(this->FrameQueueMutex);
+    this->ReconstructionThreadActive = false;
+  }
+  this->FrameQueueCondition.notify_all();
+  if (this->ReconstructionThread.joinable())
+  {
+    this->ReconstructionThread.join();
   }
+}
 
-  m_LastUpdateTime = vtkIGSIOAccurateTimer::GetSystemTime();
+//----------------------------------------------------------------------------
+void vtkPlusVirtualVolumeReconstructor::RunReconstructionThread()
+{
+  std::unique_lock<std::mutex> queueLock(this->FrameQueueMutex);
+  while (true)
+  {
+    this->FrameQueueCondition.wait(queueLock, [this]() { return !this->ReconstructionThreadActive || !this->FrameQueue.empty(); });
+    if (this->FrameQueue.empty())
+    {
+      // Stopped and all frames are inserted
+      break;
+    }
 
-  return PLUS_SUCCESS;
+    // Take all the queued frames, new frames can be queued while these are inserted
+    std::vector<QueuedFrame> batch(this->FrameQueue.begin(), this->FrameQueue.end());
+    this->FrameQueue.clear();
+    this->NumberOfFramesBeingInserted = static_cast<int>(batch.size());
+    queueLock.unlock();
+
+    std::vector<igsioTrackedFrame*> frames;
+    for (std::vector<QueuedFrame>::iterator queuedFrame = batch.begin(); queuedFrame != batch.end(); ++queuedFrame)
+    {
+      frames.push_back(queuedFrame->FrameList->GetTrackedFrame(queuedFrame->FrameIndex));
+    }
+    if (this->AddFrames(frames) != PLUS_SUCCESS)
+    {
+      LOG_ERROR(this->GetDeviceId() << ": Unable to add " << frames.size() << " frames for volume reconstruction");
+    }
+    const double latencySec = vtkIGSIOAccurateTimer::GetSystemTime() - frames.back()->GetTimestamp();
+    batch.clear();
+
+    queueLock.lock();
+    this->NumberOfFramesBeingInserted = 0;
+    this->Statistics.InsertedFrames += frames.size();
+    this->Statistics.LatencySec = latencySec;
+    this->FrameQueueCondition.notify_all();
+  }
+  this->NumberOfFramesBeingInserted = 0;
+  this->FrameQueueCondition.notify_all();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusVirtualVolumeReconstructor::WaitForQueuedFrames()
+{
+  std::unique_lock<std::mutex> queueLock(this->FrameQueueMutex);
+  this->FrameQueueCondition.wait(queueLock, [this]()
+  {
+    return !this->ReconstructionThreadActive || (this->FrameQueue.empty() && this->NumberOfFramesBeingInserted == 0);
+  });
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusVirtualVolumeReconstructor::UpdateReconstructionStatistics()
+{
+  std::lock_guard<std::mutex> queueLock(this->FrameQueueMutex);
+  const double now = vtkIGSIOAccurateTimer::GetSystemTime();
+  if (this->LastRateUpdateTime == 0.0)
+  {
+    this->LastRateUpdateTime = now;
+    return;
+  }
+  const double elapsedTimeSec = now - this->LastRateUpdateTime;
+  if (elapsedTimeSec < RECONSTRUCTION_RATE_UPDATE_PERIOD_SEC)
+  {
+    return;
+  }
+  this->Statistics.InputFrameRate = (this->Statistics.ReceivedFrames - this->LastRateUpdateReceivedFrames) / elapsedTimeSec;
+  this->Statistics.InsertionFrameRate = (this->Statistics.InsertedFrames - this->LastRateUpdateInsertedFrames) / elapsedTimeSec;
+  const long numberOfNewlyDroppedFrames = this->Statistics.DroppedFrames - this->LastRateUpdateDroppedFrames;
+  if (numberOfNewlyDroppedFrames > 0)
+  {
+    LOG_WARNING(this->GetDeviceId() << ": volume reconstruction cannot keep up with the acquisition (receiving " << std::fixed << std::setprecision(1) << this->Statistics.InputFrameRate
+                << " frames/sec, inserting " << this->Statistics.InsertionFrameRate << " frames/sec), " << numberOfNewlyDroppedFrames << " frames were dropped in the last "
+                << elapsedTimeSec << " sec. Reduce the image acquisition rate, output size, or image clip rectangle size to resolve the problem.");
+  }
+  this->LastRateUpdateReceivedFrames = this->Statistics.ReceivedFrames;
+  this->LastRateUpdateInsertedFrames = this->Statistics.InsertedFrames;
+  this->LastRateUpdateDroppedFrames = this->Statistics.DroppedFrames;
+  this->LastRateUpdateTime = now;
+}
+
+//----------------------------------------------------------------------------
+vtkPlusVirtualVolumeReconstructor::ReconstructionStatistics vtkPlusVirtualVolumeReconstructor::GetReconstructionStatistics()
+{
+  std::lock_guard<std::mutex> queueLock(this->FrameQueueMutex);
+  ReconstructionStatistics statistics = this->Statistics;
+  statistics.QueuedFrames = static_cast<int>(this->FrameQueue.size()) + this->NumberOfFramesBeingInserted;
+  return statistics;
+}
+
+//----------------------------------------------------------------------------
+unsigned long long vtkPlusVirtualVolumeReconstructor::GetInternalMemoryUsageInBytes()
+{
+  unsigned long long usedBytes = 0;
+  {
+    igsioLockGuard<vtkIGSIORecursiveCriticalSection> writerLock(this->VolumeReconstructorAccessMutex);
+    usedBytes += this->VolumeReconstructor->GetMemoryUsageInBytes();
+  }
+  std::lock_guard<std::mutex> queueLock(this->FrameQueueMutex);
+  for (std::deque<QueuedFrame>::iterator it = this->FrameQueue.begin(); it != this->FrameQueue.end(); ++it)
+  {
+    igsioTrackedFrame* frame = it->FrameList->GetTrackedFrame(it->FrameIndex);
+    if (frame != NULL && frame->GetImageData() != NULL && frame->GetImageData()->IsImageValid())
+    {
+      usedBytes += static_cast<unsigned long long>(frame->GetImageData()->GetFrameSizeInBytes());
+    }
+  }
+  return usedBytes;
 }
 
 
@@ -255,12 +518,18 @@ void vtkPlusVirtualVolumeReconstructor::SetEnableReconstruction(bool aValue)
     m_TimeWaited = 0.0;
     m_LastAlreadyRecordedFrameTimestamp = UNDEFINED_TIMESTAMP;
     m_NextFrameToBeRecordedTimestamp = 0.0;
+    std::lock_guard<std::mutex> queueLock(this->FrameQueueMutex);
     this->EnableReconstruction = true;
   }
   else
   {
     // stopping/suspending...
-    this->EnableReconstruction = aValue;
+    {
+      std::lock_guard<std::mutex> queueLock(this->FrameQueueMutex);
+      this->EnableReconstruction = aValue;
+    }
+    // Frames that were received before the reconstruction was disabled are still inserted, so the volume is complete when this returns
+    this->WaitForQueuedFrames();
   }
 }
 
@@ -269,6 +538,19 @@ PlusStatus vtkPlusVirtualVolumeReconstructor::Reset()
 {
   igsioLockGuard<vtkIGSIORecursiveCriticalSection> writerLock(this->VolumeReconstructorAccessMutex);
   this->VolumeReconstructor->Reset();
+  this->AddVolumeChange(NULL);
+
+  std::lock_guard<std::mutex> queueLock(this->FrameQueueMutex);
+  this->Statistics.ReceivedFrames = 0;
+  this->Statistics.InsertedFrames = 0;
+  this->Statistics.DroppedFrames = 0;
+  this->Statistics.InputFrameRate = 0.0;
+  this->Statistics.InsertionFrameRate = 0.0;
+  this->Statistics.LatencySec = 0.0;
+  this->LastRateUpdateReceivedFrames = 0;
+  this->LastRateUpdateInsertedFrames = 0;
+  this->LastRateUpdateDroppedFrames = 0;
+  this->LastRateUpdateTime = 0.0;
   return PLUS_SUCCESS;
 }
 
@@ -343,6 +625,94 @@ PlusStatus vtkPlusVirtualVolumeReconstructor::GetReconstructedVolumeFromFile(con
   return PLUS_SUCCESS;
 }
 
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualVolumeReconstructor::ReconstructVolumeFromFile(const std::string& inputSeqFilename, vtkIGSIOTransformRepository* sharedTransformRepository, vtkImageData* reconstructedVolume,
+    std::string& errorMessage, const ReconstructionProgressCallback& progressCallback)
+{
+  errorMessage.clear();
+
+  if (inputSeqFilename.empty())
+  {
+    errorMessage = "Volume reconstruction failed, InputSeqFilename has not been defined";
+    LOG_INFO(errorMessage);
+    return PLUS_FAIL;
+  }
+  if (sharedTransformRepository == NULL)
+  {
+    errorMessage = "Volume reconstruction failed, transform repository is invalid";
+    LOG_INFO(errorMessage);
+    return PLUS_FAIL;
+  }
+
+  // Read image sequence
+  vtkSmartPointer<vtkIGSIOTrackedFrameList> trackedFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+  std::string inputImageSeqFileFullPath = vtkPlusConfig::GetInstance()->GetOutputPath(inputSeqFilename);
+  if (vtkPlusSequenceIO::Read(inputImageSeqFileFullPath, trackedFrameList) != PLUS_SUCCESS)
+  {
+    errorMessage = "Volume reconstruction failed, unable to open input file specified in InputSeqFilename: " + inputImageSeqFileFullPath;
+    LOG_INFO(errorMessage);
+    return PLUS_FAIL;
+  }
+
+  // Set up a reconstructor with the settings of the device, the device is only locked while the settings are copied
+  vtkSmartPointer<vtkPlusVolumeReconstructor> volumeReconstructor = vtkSmartPointer<vtkPlusVolumeReconstructor>::New();
+  {
+    igsioLockGuard<vtkIGSIORecursiveCriticalSection> writerLock(this->VolumeReconstructorAccessMutex);
+    vtkSmartPointer<vtkXMLDataElement> reconstructorConfig = vtkSmartPointer<vtkXMLDataElement>::New();
+    reconstructorConfig->SetName("Device");
+    if (this->VolumeReconstructor->WriteConfiguration(reconstructorConfig) != PLUS_SUCCESS
+        || volumeReconstructor->ReadConfiguration(reconstructorConfig) != PLUS_SUCCESS)
+    {
+      errorMessage = "Volume reconstruction failed, unable to copy the volume reconstructor settings of device " + this->GetDeviceId();
+      LOG_INFO(errorMessage);
+      return PLUS_FAIL;
+    }
+  }
+  vtkSmartPointer<vtkIGSIOTransformRepository> transformRepository = vtkSmartPointer<vtkIGSIOTransformRepository>::New();
+  transformRepository->DeepCopy(sharedTransformRepository, false);
+
+  // Determine volume extents automatically
+  std::string errorDetail;
+  if (volumeReconstructor->SetOutputExtentFromFrameList(trackedFrameList, transformRepository, errorDetail) != PLUS_SUCCESS)
+  {
+    errorMessage = "Volume reconstruction failed, could not set up output volume - " + errorDetail;
+    LOG_INFO(errorMessage);
+    return PLUS_FAIL;
+  }
+
+  // Paste slices
+  const int numberOfFrames = trackedFrameList->GetNumberOfTrackedFrames();
+  for (int frameIndex = 0; frameIndex < numberOfFrames; frameIndex += volumeReconstructor->GetSkipInterval())
+  {
+    igsioTrackedFrame* frame = trackedFrameList->GetTrackedFrame(frameIndex);
+    if (transformRepository->SetTransforms(*frame) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to update transform repository with frame #" << frameIndex);
+      continue;
+    }
+    if (volumeReconstructor->AddTrackedFrame(frame, transformRepository) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to add tracked frame to volume with frame #" << frameIndex);
+      continue;
+    }
+    if (progressCallback && !progressCallback(static_cast<double>(frameIndex + 1) / numberOfFrames, volumeReconstructor))
+    {
+      errorMessage = "Volume reconstruction cancelled";
+      LOG_INFO(errorMessage);
+      return PLUS_FAIL;
+    }
+  }
+
+  // Get output
+  if (volumeReconstructor->ExtractGrayLevels(reconstructedVolume) != PLUS_SUCCESS)
+  {
+    errorMessage = "Volume reconstruction failed, unable to extract the reconstructed volume";
+    LOG_INFO(errorMessage);
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
+
 //-----------------------------------------------------------------------------
 PlusStatus vtkPlusVirtualVolumeReconstructor::GetReconstructedVolume(vtkImageData* reconstructedVolume, std::string& outErrorMessage, bool applyHoleFilling/*=true*/)
 {
@@ -370,17 +740,33 @@ PlusStatus vtkPlusVirtualVolumeReconstructor::GetReconstructedVolume(vtkImageDat
 
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusVirtualVolumeReconstructor::AddFrames(vtkIGSIOTrackedFrameList* trackedFrameList)
+{
+  std::vector<igsioTrackedFrame*> frames;
+  for (unsigned int frameIndex = 0; frameIndex < trackedFrameList->GetNumberOfTrackedFrames(); ++frameIndex)
+  {
+    frames.push_back(trackedFrameList->GetTrackedFrame(frameIndex));
+  }
+  PlusStatus status = this->AddFrames(frames);
+  trackedFrameList->Clear();
+  return status;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualVolumeReconstructor::AddFrames(const std::vector<igsioTrackedFrame*>& frames)
 {
   igsioLockGuard<vtkIGSIORecursiveCriticalSection> writerLock(this->VolumeReconstructorAccessMutex);
 
   PlusStatus status = PLUS_SUCCESS;
-  const int numberOfFrames = trackedFrameList->GetNumberOfTrackedFrames();
+  const int numberOfFrames = static_cast<int>(frames.size());
   int numberOfFramesAddedToVolume = 0;
+  double changedBounds[6] = { VTK_DOUBLE_MAX, VTK_DOUBLE_MIN, VTK_DOUBLE_MAX, VTK_DOUBLE_MIN, VTK_DOUBLE_MAX, VTK_DOUBLE_MIN };
+  bool changedBoundsKnown = true;
   for (int frameIndex = 0; frameIndex < numberOfFrames; frameIndex += this->VolumeReconstructor->GetSkipInterval())
   {
     LOG_TRACE("Adding frame to volume reconstructor: " << frameIndex);
-    igsioTrackedFrame* frame = trackedFrameList->GetTrackedFrame(frameIndex);
-    if (this->TransformRepository->SetTransforms(*frame) != PLUS_SUCCESS)
+    igsioTrackedFrame* frame = frames[frameIndex];
+    vtkIGSIOTransformRepository* frameTransformRepository = this->GetTransformRepositoryForFrame(frame);
+    if (frameTransformRepository == NULL)
     {
       LOG_ERROR("Failed to update transform repository with frame #" << frameIndex);
       status = PLUS_FAIL;
@@ -388,7 +774,7 @@ PlusStatus vtkPlusVirtualVolumeReconstructor::AddFrames(vtkIGSIOTrackedFrameList
     }
     // Insert slice for reconstruction
     bool insertedIntoVolume = false;
-    if (this->VolumeReconstructor->AddTrackedFrame(frame, this->TransformRepository, &insertedIntoVolume) != PLUS_SUCCESS)
+    if (this->VolumeReconstructor->AddTrackedFrame(frame, frameTransformRepository, &insertedIntoVolume) != PLUS_SUCCESS)
     {
       LOG_ERROR("Failed to add tracked frame to volume with frame #" << frameIndex);
       status = PLUS_FAIL;
@@ -397,15 +783,59 @@ PlusStatus vtkPlusVirtualVolumeReconstructor::AddFrames(vtkIGSIOTrackedFrameList
     if (insertedIntoVolume)
     {
       numberOfFramesAddedToVolume++;
+      if (changedBoundsKnown && this->ExtendBoundsWithFrame(frame, frameTransformRepository, changedBounds) != PLUS_SUCCESS)
+      {
+        changedBoundsKnown = false;
+      }
     }
   }
-  trackedFrameList->Clear();
+
+  if (numberOfFramesAddedToVolume > 0)
+  {
+    this->AddVolumeChange(changedBoundsKnown ? changedBounds : NULL);
+  }
 
   LOG_DEBUG("Number of frames added to the volume: " << numberOfFramesAddedToVolume << " out of " << numberOfFrames);
 
   return status;
 }
 
+//----------------------------------------------------------------------------
+vtkIGSIOTransformRepository* vtkPlusVirtualVolumeReconstructor::GetTransformRepositoryForFrame(igsioTrackedFrame* frame)
+{
+  igsioTransformName imageToReferenceTransformName(this->VolumeReconstructor->GetImageCoordinateFrame(), this->VolumeReconstructor->GetReferenceCoordinateFrame());
+
+  bool planEvaluated = this->ImageToReferencePlan.IsCompiled()
+                       && this->ImageToReferencePlan.GetRequestedTransforms()[0] == imageToReferenceTransformName
+                       && this->ImageToReferencePlan.Evaluate(*frame) == PLUS_SUCCESS;
+  if (!planEvaluated)
+  {
+    // The frame contains different transforms than the frame that the plan was compiled for
+    std::vector<igsioTransformName> requestedTransforms(1, imageToReferenceTransformName);
+    planEvaluated = this->ImageToReferencePlan.Compile(this->TransformRepository, *frame, requestedTransforms) == PLUS_SUCCESS
+                    && this->ImageToReferencePlan.Evaluate(*frame) == PLUS_SUCCESS;
+  }
+
+  if (!planEvaluated)
+  {
+    this->ImageToReferencePlan.Clear();
+    if (this->TransformRepository->SetTransforms(*frame) != PLUS_SUCCESS)
+    {
+      return NULL;
+    }
+    return this->TransformRepository;
+  }
+
+  vtkSmartPointer<vtkMatrix4x4> imageToReferenceMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  bool isValid = false;
+  if (this->ImageToReferencePlan.GetTransform(0, imageToReferenceMatrix, &isValid) != PLUS_SUCCESS
+      || this->FrameTransformRepository->SetTransform(imageToReferenceTransformName, imageToReferenceMatrix, isValid ? TOOL_OK : TOOL_INVALID) != PLUS_SUCCESS)
+  {
+    return NULL;
+  }
+  return this->FrameTransformRepository;
+}
+
 //-----------------------------------------------------------------------------
 double vtkPlusVirtualVolumeReconstructor::GetSamplingPeriodSec()
 {
@@ -431,7 +861,10 @@ PlusStatus vtkPlusVirtualVolumeReconstructor::UpdateTransformRepository(vtkIGSIO
   }
   // Create a copy of the transform repository to allow using it for volume reconstruction while being also used in other threads
   // TODO: protect transform repository with a mutex
+  igsioLockGuard<vtkIGSIORecursiveCriticalSection> writerLock(this->VolumeReconstructorAccessMutex);
   this->TransformRepository->DeepCopy(sharedTransformRepository, false);
+  // Constant transforms of the plan are taken from the repository
+  this->ImageToReferencePlan.Clear();
   return PLUS_SUCCESS;
 }
 
@@ -452,3 +885,149 @@ void vtkPlusVirtualVolumeReconstructor::SetOutputExtent(int* extent)
 {
   this->VolumeReconstructor->SetOutputExtent(extent);
 }
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualVolumeReconstructor::ExtendBoundsWithFrame(igsioTrackedFrame* frame, vtkIGSIOTransformRepository* transformRepository, double* bounds)
+{
+  igsioTransformName imageToReferenceTransformName(this->VolumeReconstructor->GetImageCoordinateFrame(), this->VolumeReconstructor->GetReferenceCoordinateFrame());
+  vtkSmartPointer<vtkMatrix4x4> imageToReferenceMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  bool isValid = false;
+  if (transformRepository->GetTransform(imageToReferenceTransformName, imageToReferenceMatrix, &isValid) != PLUS_SUCCESS || !isValid)
+  {
+    LOG_ERROR("Failed to get image to reference transform, the changed region of the volume is not known");
+    return PLUS_FAIL;
+  }
+
+  // The whole frame is included, even if it is clipped, as the clipped region is always inside the frame
+  FrameSizeType frameSize = frame->GetFrameSize();
+  for (int corner = 0; corner < 8; ++corner)
+  {
+    double cornerImage[4] =
+    {
+      (corner & 1) ? frameSize[0] - 1.0 : 0.0,
+      (corner & 2) ? frameSize[1] - 1.0 : 0.0,
+      (corner & 4) ? std::max(frameSize[2], 1u) - 1.0 : 0.0,
+      1.0
+    };
+    double cornerReference[4] = { 0.0, 0.0, 0.0, 1.0 };
+    imageToReferenceMatrix->MultiplyPoint(cornerImage, cornerReference);
+    for (int axis = 0; axis < 3; ++axis)
+    {
+      bounds[2 * axis] = std::min(bounds[2 * axis], cornerReference[axis]);
+      bounds[2 * axis + 1] = std::max(bounds[2 * axis + 1], cornerReference[axis]);
+    }
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusVirtualVolumeReconstructor::AddVolumeChange(const double* bounds)
+{
+  igsioLockGuard<vtkIGSIORecursiveCriticalSection> writerLock(this->VolumeReconstructorAccessMutex);
+  this->VolumeSequenceNumber++;
+  if (bounds == NULL)
+  {
+    // Changes up to now are not known
+    this->VolumeChanges.clear();
+    this->FirstKnownSequenceNumber = this->VolumeSequenceNumber;
+    return;
+  }
+
+  VolumeChange change;
+  change.SequenceNumber = this->VolumeSequenceNumber;
+  std::copy(bounds, bounds + 6, change.Bounds);
+  this->VolumeChanges.push_back(change);
+  if (this->VolumeChanges.size() > MAX_NUMBER_OF_RECORDED_VOLUME_CHANGES)
+  {
+    // Clients that have older volume content than this change will get the full volume
+    this->FirstKnownSequenceNumber = this->VolumeChanges.front().SequenceNumber;
+    this->VolumeChanges.pop_front();
+  }
+}
+
+//----------------------------------------------------------------------------
+unsigned long vtkPlusVirtualVolumeReconstructor::GetVolumeSequenceNumber()
+{
+  igsioLockGuard<vtkIGSIORecursiveCriticalSection> writerLock(this->VolumeReconstructorAccessMutex);
+  return this->VolumeSequenceNumber;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusVirtualVolumeReconstructor::GetChangedExtents(unsigned long sinceSequenceNumber, vtkImageData* volume, std::vector<ExtentType>& changedExtents)
+{
+  changedExtents.clear();
+  igsioLockGuard<vtkIGSIORecursiveCriticalSection> writerLock(this->VolumeReconstructorAccessMutex);
+  if (sinceSequenceNumber < this->FirstKnownSequenceNumber || sinceSequenceNumber > this->VolumeSequenceNumber)
+  {
+    return false;
+  }
+
+  const int* volumeExtent = volume->GetExtent();
+  const double* origin = volume->GetOrigin();
+  const double* spacing = volume->GetSpacing();
+  for (std::deque<VolumeChange>::const_iterator change = this->VolumeChanges.begin(); change != this->VolumeChanges.end(); ++change)
+  {
+    if (change->SequenceNumber <= sinceSequenceNumber)
+    {
+      continue;
+    }
+    ExtentType extent;
+    bool isEmpty = false;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+      double start = (change->Bounds[2 * axis] - origin[axis]) / spacing[axis];
+      double stop = (change->Bounds[2 * axis + 1] - origin[axis]) / spacing[axis];
+      if (start > stop)
+      {
+        std::swap(start, stop);
+      }
+      extent[2 * axis] = std::max(volumeExtent[2 * axis], static_cast<int>(std::floor(start)) - this->ChangedExtentMargin);
+      extent[2 * axis + 1] = std::min(volumeExtent[2 * axis + 1], static_cast<int>(std::ceil(stop)) + this->ChangedExtentMargin);
+      isEmpty = isEmpty || extent[2 * axis] > extent[2 * axis + 1];
+    }
+    if (!isEmpty)
+    {
+      AddExtent(changedExtents, extent);
+    }
+  }
+
+  if (changedExtents.size() > MAX_NUMBER_OF_CHANGED_EXTENTS)
+  {
+    // Sending many small sub-volumes is slower than sending their bounding box
+    ExtentType boundingExtent = changedExtents[0];
+    for (std::vector<ExtentType>::iterator extent = changedExtents.begin() + 1; extent != changedExtents.end(); ++extent)
+    {
+      MergeExtent(boundingExtent, *extent);
+    }
+    changedExtents.assign(1, boundingExtent);
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualVolumeReconstructor::GetReconstructedVolumeUpdate(unsigned long sinceSequenceNumber, std::vector<vtkSmartPointer<vtkImageData> >& changedVolumes,
+    unsigned long& currentSequenceNumber, bool& fullVolume, std::string& outErrorMessage, bool applyHoleFilling/*=true*/)
+{
+  changedVolumes.clear();
+  igsioLockGuard<vtkIGSIORecursiveCriticalSection> writerLock(this->VolumeReconstructorAccessMutex);
+
+  vtkSmartPointer<vtkImageData> volume = vtkSmartPointer<vtkImageData>::New();
+  if (this->GetReconstructedVolume(volume, outErrorMessage, applyHoleFilling) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  currentSequenceNumber = this->VolumeSequenceNumber;
+
+  std::vector<ExtentType> changedExtents;
+  fullVolume = !this->GetChangedExtents(sinceSequenceNumber, volume, changedExtents);
+  if (fullVolume)
+  {
+    changedVolumes.push_back(volume);
+    return PLUS_SUCCESS;
+  }
+  for (std::vector<ExtentType>::iterator extent = changedExtents.begin(); extent != changedExtents.end(); ++extent)
+  {
+    changedVolumes.push_back(ExtractSubVolume(volume, *extent));
+  }
+  return PLUS_SUCCESS;
+}
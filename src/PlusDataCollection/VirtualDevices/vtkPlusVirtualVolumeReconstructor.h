@@ -10,7 +10,16 @@ See License.txt for details.
 #include "vtkPlusDataCollectionExport.h"
 
 #include "vtkPlusDevice.h"
+#include "PlusTransformPlan.h"
+
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 class vtkPlusVolumeReconstructor;
 
@@ -32,6 +41,23 @@ public:
   */
   virtual PlusStatus GetReconstructedVolumeFromFile(const std::string& inputSeqFilename, vtkImageData* reconstructedVolume, std::string& errorMessage);
 
+  /*!
+    Called after each frame is inserted by ReconstructVolumeFromFile, with the ratio of the processed frames (0..1)
+    and the reconstructor that holds the partially reconstructed volume. Returning false cancels the reconstruction.
+  */
+  typedef std::function<bool(double progress, vtkPlusVolumeReconstructor* reconstructor)> ReconstructionProgressCallback;
+
+  /*!
+    Reconstruct a volume from a sequence file, using a separate reconstructor that has the same settings as the reconstructor of this device.
+    Unlike GetReconstructedVolumeFromFile, the live reconstruction volume is not changed and the device is not locked during the reconstruction,
+    so multiple reconstructions can run concurrently.
+    This method is safe to be called from any thread.
+    \param sharedTransformRepository Transforms that are not in the frames are taken from a copy of this repository
+    \param progressCallback Optional, called after each inserted frame
+  */
+  PlusStatus ReconstructVolumeFromFile(const std::string& inputSeqFilename, vtkIGSIOTransformRepository* sharedTransformRepository, vtkImageData* reconstructedVolume,
+                                       std::string& errorMessage, const ReconstructionProgressCallback& progressCallback = ReconstructionProgressCallback());
+
   /*!
     This method is safe to be called from any thread.
     \param applyHoleFilling If true (default) then hole filling will be applied (if enabled and fully specified), otherwise hole filling will be skipped
@@ -81,6 +107,77 @@ public:
 
   vtkGetMacro(TotalFramesRecorded, long int);
 
+  /*! Voxel extent (iStart, iStop, jStart, jStop, kStart, kStop) */
+  typedef std::array<int, 6> ExtentType;
+
+  /*!
+    Sequence number of the current content of the volume. It is incremented each time frames are inserted into the volume
+    and when the volume is cleared.
+    This method is safe to be called from any thread.
+  */
+  unsigned long GetVolumeSequenceNumber();
+
+  /*!
+    Get the parts of the reconstructed volume that have changed since the volume had the specified sequence number.
+    The origin of each returned sub-volume is set so that it can be pasted into a copy of the full volume.
+    If the changes are not known (the volume has been cleared since then or the changes are too old) then the full volume is returned.
+    This method is safe to be called from any thread.
+    \param sinceSequenceNumber Sequence number of the volume content that the client already has
+    \param changedVolumes Changed parts of the volume
+    \param currentSequenceNumber Sequence number of the volume content after applying the changes
+    \param fullVolume Set to true if changedVolumes contains the full volume
+    \param applyHoleFilling If true (default) then hole filling will be applied (if enabled and fully specified)
+  */
+  PlusStatus GetReconstructedVolumeUpdate(unsigned long sinceSequenceNumber, std::vector<vtkSmartPointer<vtkImageData> >& changedVolumes,
+                                          unsigned long& currentSequenceNumber, bool& fullVolume, std::string& outErrorMessage, bool applyHoleFilling = true);
+
+  /*!
+    Get the extents of the volume that have changed since the volume had the specified sequence number, in the voxel coordinates of the given volume.
+    Overlapping extents are merged. Returns false if the changes are not known.
+    This method is safe to be called from any thread.
+  */
+  bool GetChangedExtents(unsigned long sinceSequenceNumber, vtkImageData* volume, std::vector<ExtentType>& changedExtents);
+
+  /*! Number of voxels added to each side of the changed extents, to include the voxels that are modified by interpolation and hole filling */
+  vtkSetMacro(ChangedExtentMargin, int);
+  vtkGetMacro(ChangedExtentMargin, int);
+
+  /*!
+    Maximum number of acquired frames that wait for insertion into the live volume. If insertion cannot keep up with
+    the acquisition then the oldest queued frames are dropped, which keeps the latency of the live volume bounded.
+  */
+  vtkSetMacro(FrameQueueSize, int);
+  vtkGetMacro(FrameQueueSize, int);
+
+  /*! Counters of the live reconstruction since the volume was last cleared */
+  struct ReconstructionStatistics
+  {
+    /*! Number of frames that were taken from the input channel */
+    long ReceivedFrames;
+    /*! Number of frames that were passed to the reconstructor */
+    long InsertedFrames;
+    /*! Number of frames that were not inserted because the reconstruction could not keep up with the acquisition */
+    long DroppedFrames;
+    /*! Number of frames waiting for insertion */
+    int QueuedFrames;
+    /*! Rate of the received frames in the last second (frames per second) */
+    double InputFrameRate;
+    /*! Rate of the inserted frames in the last second (frames per second) */
+    double InsertionFrameRate;
+    /*! Time between the acquisition and the insertion of the last inserted frame */
+    double LatencySec;
+  };
+
+  /*!
+    Get the counters of the live reconstruction. The volume contains all the received frames if no frames were dropped
+    and no frames are queued.
+    This method is safe to be called from any thread.
+  */
+  ReconstructionStatistics GetReconstructionStatistics();
+
+  /*! Memory used by the reconstructed volume, the accumulation buffer and the image data of the queued frames */
+  virtual unsigned long long GetInternalMemoryUsageInBytes();
+
 protected:
 
   /*! Read main configuration from xml data */
@@ -114,6 +211,35 @@ protected:
   virtual PlusStatus InternalDisconnect();
 
   PlusStatus AddFrames(vtkIGSIOTrackedFrameList* trackedFrameList);
+  PlusStatus AddFrames(const std::vector<igsioTrackedFrame*>& frames);
+
+  /*! Start the thread that inserts the queued frames into the volume */
+  void StartReconstructionThread();
+
+  /*! Insert the frames that are still in the queue then stop the reconstruction thread */
+  void StopReconstructionThread();
+
+  /*! Body of the reconstruction thread: takes the queued frames and inserts them into the volume, until it is stopped */
+  void RunReconstructionThread();
+
+  /*! Block until all the queued frames are inserted into the volume */
+  void WaitForQueuedFrames();
+
+  /*! Update the input and insertion frame rates and report if frames had to be dropped */
+  void UpdateReconstructionStatistics();
+
+  /*!
+    Get a transform repository that contains the image to reference transform of the frame.
+    The transform is computed by the compiled transform plan, which is compiled again if the frame contains different transforms.
+    If the plan cannot be used then all the transforms of the frame are set in the transform repository. Returns NULL on failure.
+  */
+  vtkIGSIOTransformRepository* GetTransformRepositoryForFrame(igsioTrackedFrame* frame);
+
+  /*! Extend the bounds (xMin, xMax, yMin, yMax, zMin, zMax) with the bounding box of the frame in the Reference coordinate system */
+  PlusStatus ExtendBoundsWithFrame(igsioTrackedFrame* frame, vtkIGSIOTransformRepository* transformRepository, double* bounds);
+
+  /*! Record that the volume has been changed in the bounds (or at unknown locations, if bounds is NULL) */
+  void AddVolumeChange(const double* bounds);
 
   /*! Get the sampling period length (in seconds). Frames are copied from the devices to the data collection buffer once in every sampling period. */
   double GetSamplingPeriodSec();
@@ -147,11 +273,54 @@ protected:
   vtkSmartPointer<vtkPlusVolumeReconstructor> VolumeReconstructor;
   vtkSmartPointer<vtkIGSIOTransformRepository> TransformRepository;
 
+  /*! Computes the image to reference transform of the frames, compiled from TransformRepository */
+  PlusTransformPlan ImageToReferencePlan;
+  /*! Contains only the image to reference transform of the current frame, computed by ImageToReferencePlan */
+  vtkSmartPointer<vtkIGSIOTransformRepository> FrameTransformRepository;
+
   bool EnableReconstruction;
 
+  /*! Region of the volume that has been modified by one AddFrames call */
+  struct VolumeChange
+  {
+    unsigned long SequenceNumber;
+    /*! Bounding box of the inserted frames in the Reference coordinate system */
+    double Bounds[6];
+  };
+  /*! Recent changes of the volume, oldest first */
+  std::deque<VolumeChange> VolumeChanges;
+  unsigned long VolumeSequenceNumber;
+  /*! Changes are known since the volume had this sequence number */
+  unsigned long FirstKnownSequenceNumber;
+  int ChangedExtentMargin;
+
   std::string OutputVolFilename;
   std::string OutputVolDeviceName;
 
+  /*! Frame that waits for insertion into the volume. Frames are not copied, the queued frames share the frame list that they were received in. */
+  struct QueuedFrame
+  {
+    vtkSmartPointer<vtkIGSIOTrackedFrameList> FrameList;
+    int FrameIndex;
+  };
+  /*! Frames that are received by InternalUpdate (producer) and inserted by the reconstruction thread (consumer), oldest first */
+  std::deque<QueuedFrame> FrameQueue;
+  int FrameQueueSize;
+  /*! Number of frames that the reconstruction thread has taken from the queue and not inserted yet */
+  int NumberOfFramesBeingInserted;
+  std::thread ReconstructionThread;
+  bool ReconstructionThreadActive;
+  /*! Guards the queue, the reconstruction thread state and the statistics */
+  std::mutex FrameQueueMutex;
+  /*! Signalled when frames are queued, when frames are inserted, and when the reconstruction thread is stopped */
+  std::condition_variable FrameQueueCondition;
+  ReconstructionStatistics Statistics;
+  /*! Counters at the last frame rate update */
+  long LastRateUpdateReceivedFrames;
+  long LastRateUpdateInsertedFrames;
+  long LastRateUpdateDroppedFrames;
+  double LastRateUpdateTime;
+
   /*! Mutex instance simultaneous access of writer (writer may be accessed from command processing thread and also the internal update thread) */
   vtkSmartPointer<vtkIGSIORecursiveCriticalSection> VolumeReconstructorAccessMutex;
 
@@ -6,6 +6,13 @@ See License.txt for details.
 
 // Local includes
 #include "PlusConfigure.h"
+#include "PlusBufferSnapshot.h"
+#include "PlusOrientedClipCopy.h"
+#include "PlusProfiler.h"
+#include "PlusReplayClock.h"
+#include "PlusTelemetry.h"
+#include "PlusTrackedFrameAssembly.h"
+#include "PlusWorkerPool.h"
 #include "igsioMath.h"
 #include "igsioTrackedFrame.h"
 #include "vtkPlusBuffer.h"
@@ -14,22 +21,32 @@ See License.txt for details.
 #include "vtkIGSIOTrackedFrameList.h"
 
 // VTK includes
+#include <vtkDataArray.h>
 #include <vtkDoubleArray.h>
 #include <vtkImageData.h>
 #include <vtkIntArray.h>
 #include <vtkMath.h>
 #include <vtkMatrix4x4.h>
 #include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
 #include <vtkUnsignedLongLongArray.h>
 
 // vtkAddon includes
 #include <vtkStreamingVolumeCodec.h>
 
+// STL includes
+#include <algorithm>
+#include <cmath>
+
 static const double NEGLIGIBLE_TIME_DIFFERENCE = 0.00001; // in seconds, used for comparing between exact timestamps
 static const double ANGLE_INTERPOLATION_WARNING_THRESHOLD_DEG = 10; // if the interpolated orientation differs from both the interpolated orientation by more than this threshold then display a warning
+static const int AGED_ITEM_COMPRESSION_LEVEL = 1; // fastest zlib compression level, aged items are compressed during acquisition
 
 vtkStandardNewMacro(vtkPlusBuffer);
 
+const int vtkPlusBuffer::MINIMUM_DURATION_BASED_BUFFER_SIZE = 10;
+
 #define LOCAL_LOG_ERROR(msg) \
 { \
   std::ostringstream msgStream; \
@@ -84,6 +101,11 @@ vtkPlusBuffer::vtkPlusBuffer()
   , StreamBuffer(vtkPlusTimestampedCircularBuffer::New())
   , MaxAllowedTimeDifference(0.5)
   , DescriptiveName(NULL)
+  , CompactPoseFieldsDropped(false)
+  , BufferDurationSec(0.0)
+  , CompressItemsOlderThanSec(0.0)
+  , LastCompressionCheckedUid(0)
+  , AgedItemCompressionScheduled(false)
 {
   this->FrameSize[0] = 0;
   this->FrameSize[1] = 0;
@@ -126,9 +148,15 @@ PlusStatus vtkPlusBuffer::AllocateMemoryForFrames()
 {
   igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
   PlusStatus result = PLUS_SUCCESS;
+  if (this->StreamBuffer->GetCompactPoseStorage())
+  {
+    // No frames are stored
+    return result;
+  }
 
   for (int i = 0; i < this->StreamBuffer->GetBufferSize(); ++i)
   {
+    this->StreamBuffer->GetBufferItemPointerFromBufferIndex(i)->DiscardCompressedFrame();
     if (!this->StreamBuffer->GetBufferItemPointerFromBufferIndex(i)->GetFrame().IsFrameEncoded())
     {
       if (this->StreamBuffer->GetBufferItemPointerFromBufferIndex(i)->GetFrame().AllocateFrame(this->GetFrameSize(), this->GetPixelType(), this->GetNumberOfScalarComponents()) != PLUS_SUCCESS)
@@ -186,6 +214,58 @@ PlusStatus vtkPlusBuffer::SetBufferSize(int bufsize)
   return result;
 }
 
+//----------------------------------------------------------------------------
+void vtkPlusBuffer::SetBufferDurationSec(double durationSec)
+{
+  if (durationSec < 0)
+  {
+    LOCAL_LOG_ERROR("Invalid buffer duration requested: " << durationSec << " sec. Time-based buffer sizing is disabled.");
+    durationSec = 0.0;
+  }
+  this->BufferDurationSec = durationSec;
+}
+
+//----------------------------------------------------------------------------
+double vtkPlusBuffer::GetBufferDurationSec() const
+{
+  return this->BufferDurationSec;
+}
+
+//----------------------------------------------------------------------------
+int vtkPlusBuffer::GetBufferSizeForDuration()
+{
+  if (this->BufferDurationSec <= 0)
+  {
+    return this->GetBufferSize();
+  }
+  double frameRate = this->GetFrameRate();
+  if (frameRate <= 0)
+  {
+    // not enough items yet for measuring the frame rate
+    return this->GetBufferSize();
+  }
+  int bufferSize = static_cast<int>(std::ceil(this->BufferDurationSec * frameRate));
+  return std::max(bufferSize, MINIMUM_DURATION_BASED_BUFFER_SIZE);
+}
+
+//----------------------------------------------------------------------------
+unsigned long long vtkPlusBuffer::GetItemSizeInBytes()
+{
+  if (this->GetCompactPoseStorage())
+  {
+    return sizeof(CompactPoseItem);
+  }
+  FrameSizeType frameSize = this->GetFrameSize();
+  unsigned long long frameSizeInBytes = static_cast<unsigned long long>(frameSize[0]) * frameSize[1] * frameSize[2] * this->GetNumberOfBytesPerPixel();
+  return sizeof(StreamBufferItem) + frameSizeInBytes;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusBuffer::GetMemoryUsage(BufferMemoryUsage& usage)
+{
+  this->StreamBuffer->GetMemoryUsage(usage);
+}
+
 //----------------------------------------------------------------------------
 bool vtkPlusBuffer::CheckFrameFormat(const FrameSizeType& frameSizeInPx, igsioCommon::VTKScalarPixelType pixelType, US_IMAGE_TYPE imgType, int numberOfScalarComponents)
 {
@@ -232,6 +312,7 @@ PlusStatus vtkPlusBuffer::AddItem(vtkImageData* frame,
                                   double filteredTimestamp/*=UNDEFINED_TIMESTAMP*/,
                                   const igsioFieldMapType* customFields /*=NULL*/)
 {
+  PLUS_PROFILE_ZONE("vtkPlusBuffer::AddItem");
   if (frame == NULL)
   {
     LOCAL_LOG_ERROR("vtkPlusBuffer: Unable to add NULL frame to video buffer!");
@@ -270,6 +351,7 @@ PlusStatus vtkPlusBuffer::AddItem(const igsioVideoFrame* frame,
                                   double filteredTimestamp/*=UNDEFINED_TIMESTAMP*/,
                                   const igsioFieldMapType* customFields /*=NULL*/)
 {
+  PLUS_PROFILE_ZONE("vtkPlusBuffer::AddItem");
   if (frame == NULL)
   {
     LOCAL_LOG_ERROR("vtkPlusBuffer: Unable to add NULL frame to video buffer!");
@@ -321,6 +403,7 @@ PlusStatus vtkPlusBuffer::AddItem(const igsioFieldMapType& fields,
                                   double unfilteredTimestamp/*=UNDEFINED_TIMESTAMP*/,
                                   double filteredTimestamp/*=UNDEFINED_TIMESTAMP*/)
 {
+  PLUS_PROFILE_ZONE("vtkPlusBuffer::AddItem");
   if (fields.empty())
   {
     return PLUS_SUCCESS;
@@ -353,6 +436,11 @@ PlusStatus vtkPlusBuffer::AddItem(const igsioFieldMapType& fields,
   BufferItemUidType itemUid;
 
   igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  if (this->StreamBuffer->GetCompactPoseStorage())
+  {
+    LOCAL_LOG_ERROR("vtkPlusBuffer: Unable to add frames or fields to a tracker buffer with compact pose storage!");
+    return PLUS_FAIL;
+  }
   if (this->StreamBuffer->PrepareForNewItem(filteredTimestamp, itemUid, bufferIndex) != PLUS_SUCCESS)
   {
     // Just a debug message, because we want to avoid unnecessary warning messages if the timestamp is the same as last one
@@ -373,13 +461,11 @@ PlusStatus vtkPlusBuffer::AddItem(const igsioFieldMapType& fields,
   newObjectInBuffer->SetIndex(frameNumber);
   newObjectInBuffer->SetUid(itemUid);
 
-  // Add custom fields
-  for (igsioFieldMapType::const_iterator it = fields.begin(); it != fields.end(); ++it)
-  {
-    newObjectInBuffer->SetFrameField(it->first, it->second.second, it->second.first);
-    std::string name(it->first);
-  }
+  // Add custom fields, the fields of the overwritten item are removed
+  newObjectInBuffer->SetFrameFields(fields);
 
+  PlusTelemetry::Instance()->AddSampleSince(PlusTelemetry::STAGE_ACQUISITION_TO_BUFFER, unfilteredTimestamp);
+  this->SignalNewDataEvents();
   return PLUS_SUCCESS;
 }
 
@@ -399,6 +485,11 @@ PlusStatus vtkPlusBuffer::AddItem(void* imageDataPtr,
                                   const igsioFieldMapType* customFields /*= NULL */,
                                   vtkStreamingVolumeFrame* encodedFrame /*=NULL*/)
 {
+  PLUS_PROFILE_ZONE("vtkPlusBuffer::AddItem");
+  // The source bitstream belongs to this frame only, even if the frame is not added
+  StreamBufferItem::SourceBitstreamPtr sourceBitstream;
+  sourceBitstream.swap(this->PendingSourceBitstream);
+
   if (unfilteredTimestamp == UNDEFINED_TIMESTAMP)
   {
     unfilteredTimestamp = vtkIGSIOAccurateTimer::GetSystemTime();
@@ -464,6 +555,11 @@ PlusStatus vtkPlusBuffer::AddItem(void* imageDataPtr,
   int bufferIndex(0);
   BufferItemUidType itemUid;
   igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  if (this->StreamBuffer->GetCompactPoseStorage())
+  {
+    LOCAL_LOG_ERROR("vtkPlusBuffer: Unable to add frames or fields to a tracker buffer with compact pose storage!");
+    return PLUS_FAIL;
+  }
   if (this->StreamBuffer->PrepareForNewItem(filteredTimestamp, itemUid, bufferIndex) != PLUS_SUCCESS)
   {
     // Just a debug message, because we want to avoid unnecessary warning messages if the timestamp is the same as last one
@@ -478,6 +574,9 @@ PlusStatus vtkPlusBuffer::AddItem(void* imageDataPtr,
     LOCAL_LOG_ERROR("vtkPlusBuffer: Failed to get pointer to video buffer object from the video buffer for the new frame!");
     return PLUS_FAIL;
   }
+  newObjectInBuffer->SetGpuFrame(nullptr);
+  newObjectInBuffer->DiscardCompressedFrame();
+  newObjectInBuffer->SetSourceBitstream(sourceBitstream);
 
   FrameSizeType receivedFrameSize = { 0, 0, 0 };
   newObjectInBuffer->GetFrame().GetFrameSize(receivedFrameSize);
@@ -497,10 +596,34 @@ PlusStatus vtkPlusBuffer::AddItem(void* imageDataPtr,
   // Skip the numberOfBytesToSkip bytes, e.g. header size
   if (imageDataPtr != NULL)
   {
+    this->DetachSharedFrameData(newObjectInBuffer->GetFrame());
     unsigned char* byteImageDataPtr = reinterpret_cast<unsigned char*>(imageDataPtr);
     byteImageDataPtr += numberOfBytesToSkip;
 
-    if (igsioVideoFrame::GetOrientedClippedImage(byteImageDataPtr, flipInfo, imageType, pixelType, numberOfScalarComponents, inputFrameSizeInPx, newObjectInBuffer->GetFrame(), clipRectangleOrigin, clipRectangleSize) != PLUS_SUCCESS)
+    // B-mode and color frames are clipped, flipped and copied in one pass directly into the buffer item,
+    // other image types (e.g., RF data with interleaved lines) and transposition with flips are left to igsio
+    std::array<int, 3> copyOrigin = { 0, 0, 0 };
+    std::array<int, 3> copySize = { static_cast<int>(inputFrameSizeInPx[0]), static_cast<int>(inputFrameSizeInPx[1]), static_cast<int>(inputFrameSizeInPx[2]) };
+    if (igsioCommon::IsClippingRequested(clipRectangleOrigin, clipRectangleSize))
+    {
+      copyOrigin = clipRectangleOrigin;
+      copySize = clipRectangleSize;
+    }
+    const bool transpose = (flipInfo.tranpose == igsioVideoFrame::TRANSPOSE_IJKtoKIJ);
+    vtkImageData* bufferImage = newObjectInBuffer->GetFrame().GetImage();
+    if ((imageType == US_IMG_BRIGHTNESS || imageType == US_IMG_RGB_COLOR) && bufferImage != NULL
+        && PlusOrientedClipCopy::IsSupported(inputFrameSizeInPx, copyOrigin, copySize, flipInfo.hFlip, flipInfo.vFlip, flipInfo.eFlip, transpose))
+    {
+      unsigned int bytesPerPixel = igsioVideoFrame::GetNumberOfBytesPerScalar(pixelType) * numberOfScalarComponents;
+      if (PlusOrientedClipCopy::Copy(byteImageDataPtr, inputFrameSizeInPx, bytesPerPixel, copyOrigin, copySize,
+                                     flipInfo.hFlip, flipInfo.vFlip, flipInfo.eFlip, transpose,
+                                     static_cast<unsigned char*>(bufferImage->GetScalarPointer())) != PLUS_SUCCESS)
+      {
+        LOCAL_LOG_ERROR("Failed to convert input US image to the requested orientation!");
+        return PLUS_FAIL;
+      }
+    }
+    else if (igsioVideoFrame::GetOrientedClippedImage(byteImageDataPtr, flipInfo, imageType, pixelType, numberOfScalarComponents, inputFrameSizeInPx, newObjectInBuffer->GetFrame(), clipRectangleOrigin, clipRectangleSize) != PLUS_SUCCESS)
     {
       LOCAL_LOG_ERROR("Failed to convert input US image to the requested orientation!");
       return PLUS_FAIL;
@@ -517,7 +640,8 @@ PlusStatus vtkPlusBuffer::AddItem(void* imageDataPtr,
   newObjectInBuffer->SetUid(itemUid);
   newObjectInBuffer->GetFrame().SetImageType(imageType);
 
-  // Add custom fields
+  // Add custom fields, the fields of the overwritten item are removed
+  newObjectInBuffer->ClearFrameFields();
   if (customFields != NULL)
   {
     for (igsioFieldMapType::const_iterator it = customFields->begin(); it != customFields->end(); ++it)
@@ -531,12 +655,20 @@ PlusStatus vtkPlusBuffer::AddItem(void* imageDataPtr,
     }
   }
 
+  PlusTelemetry::Instance()->AddSampleSince(PlusTelemetry::STAGE_ACQUISITION_TO_BUFFER, unfilteredTimestamp);
+  this->SignalNewDataEvents();
+  this->ScheduleAgedItemCompression();
   return PLUS_SUCCESS;
 }
 
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusBuffer::AddItem(void* imageDataPtr, const FrameSizeType& frameSize, unsigned int inputFrameSizeInBytes, US_IMAGE_TYPE imageType, long frameNumber, double unfilteredTimestamp /*= UNDEFINED_TIMESTAMP*/, double filteredTimestamp /*= UNDEFINED_TIMESTAMP*/, const igsioFieldMapType* customFields /*= NULL*/)
 {
+  PLUS_PROFILE_ZONE("vtkPlusBuffer::AddItem");
+  // The source bitstream belongs to this frame only, even if the frame is not added
+  StreamBufferItem::SourceBitstreamPtr sourceBitstream;
+  sourceBitstream.swap(this->PendingSourceBitstream);
+
   if (unfilteredTimestamp == UNDEFINED_TIMESTAMP)
   {
     unfilteredTimestamp = vtkIGSIOAccurateTimer::GetSystemTime();
@@ -577,6 +709,11 @@ PlusStatus vtkPlusBuffer::AddItem(void* imageDataPtr, const FrameSizeType& frame
   int bufferIndex(0);
   BufferItemUidType itemUid;
   igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  if (this->StreamBuffer->GetCompactPoseStorage())
+  {
+    LOCAL_LOG_ERROR("vtkPlusBuffer: Unable to add frames or fields to a tracker buffer with compact pose storage!");
+    return PLUS_FAIL;
+  }
   if (this->StreamBuffer->PrepareForNewItem(filteredTimestamp, itemUid, bufferIndex) != PLUS_SUCCESS)
   {
     // Just a debug message, because we want to avoid unnecessary warning messages if the timestamp is the same as last one
@@ -591,6 +728,8 @@ PlusStatus vtkPlusBuffer::AddItem(void* imageDataPtr, const FrameSizeType& frame
     LOCAL_LOG_ERROR("vtkPlusBuffer: Failed to get pointer to video buffer object from the video buffer for the new frame!");
     return PLUS_FAIL;
   }
+  newObjectInBuffer->DiscardCompressedFrame();
+  newObjectInBuffer->SetSourceBitstream(sourceBitstream);
 
   unsigned int bufferFrameSizeBytes = newObjectInBuffer->GetFrame().GetFrameSizeInBytes();
   if (bufferFrameSizeBytes < inputFrameSizeInBytes)
@@ -604,9 +743,12 @@ PlusStatus vtkPlusBuffer::AddItem(void* imageDataPtr, const FrameSizeType& frame
   newObjectInBuffer->SetIndex(frameNumber);
   newObjectInBuffer->SetUid(itemUid);
   newObjectInBuffer->GetFrame().SetImageType(imageType);
+  newObjectInBuffer->SetGpuFrame(nullptr);
+  this->DetachSharedFrameData(newObjectInBuffer->GetFrame());
   memcpy(newObjectInBuffer->GetFrame().GetImage()->GetScalarPointer(), imageDataPtr, inputFrameSizeInBytes);
 
-  // Add custom fields
+  // Add custom fields, the fields of the overwritten item are removed
+  newObjectInBuffer->ClearFrameFields();
   if (customFields != NULL)
   {
     for (igsioFieldMapType::const_iterator it = customFields->begin(); it != customFields->end(); ++it)
@@ -622,9 +764,232 @@ PlusStatus vtkPlusBuffer::AddItem(void* imageDataPtr, const FrameSizeType& frame
 
   newObjectInBuffer->SetFrameField("FrameSizeInBytes", igsioCommon::ToString<unsigned int>(inputFrameSizeInBytes));
 
+  PlusTelemetry::Instance()->AddSampleSince(PlusTelemetry::STAGE_ACQUISITION_TO_BUFFER, unfilteredTimestamp);
+  this->SignalNewDataEvents();
+  this->ScheduleAgedItemCompression();
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusBuffer::AcquireWritableFrame(igsioVideoFrame*& frame)
+{
+  frame = NULL;
+
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  if (this->StreamBuffer->GetCompactPoseStorage())
+  {
+    LOCAL_LOG_ERROR("vtkPlusBuffer: Unable to write frames into a tracker buffer with compact pose storage!");
+    return PLUS_FAIL;
+  }
+  int bufferIndex(-1);
+  if (this->StreamBuffer->ReserveNextItem(bufferIndex) != PLUS_SUCCESS)
+  {
+    LOCAL_LOG_ERROR("vtkPlusBuffer: Failed to reserve a writable frame in the video buffer!");
+    return PLUS_FAIL;
+  }
+
+  StreamBufferItem* reservedObjectInBuffer = this->StreamBuffer->GetBufferItemPointerFromBufferIndex(bufferIndex);
+  if (reservedObjectInBuffer == NULL)
+  {
+    LOCAL_LOG_ERROR("vtkPlusBuffer: Failed to get pointer to video buffer object from the video buffer for the writable frame!");
+    this->StreamBuffer->ReleaseReservedItem();
+    return PLUS_FAIL;
+  }
+
+  reservedObjectInBuffer->DiscardCompressedFrame();
+  igsioVideoFrame& reservedFrame = reservedObjectInBuffer->GetFrame();
+  FrameSizeType reservedFrameSize = { 0, 0, 0 };
+  reservedFrame.GetFrameSize(reservedFrameSize);
+  if (reservedFrame.IsFrameEncoded() || reservedFrame.GetImage() == NULL
+      || reservedFrameSize[0] != this->GetFrameSize()[0]
+      || reservedFrameSize[1] != this->GetFrameSize()[1]
+      || reservedFrameSize[2] != this->GetFrameSize()[2])
+  {
+    // The frame may have been replaced by an encoded frame or the buffer format may have changed since allocation
+    if (reservedFrame.AllocateFrame(this->GetFrameSize(), this->GetPixelType(), this->GetNumberOfScalarComponents()) != PLUS_SUCCESS)
+    {
+      LOCAL_LOG_ERROR("vtkPlusBuffer: Failed to allocate memory for the writable frame!");
+      this->StreamBuffer->ReleaseReservedItem();
+      return PLUS_FAIL;
+    }
+    reservedFrame.SetImageOrientation(this->ImageOrientation);
+  }
+  reservedFrame.SetImageType(this->ImageType);
+  this->DetachSharedFrameData(reservedFrame);
+
+  reservedObjectInBuffer->SetValidTransformData(false);
+  reservedObjectInBuffer->SetGpuFrame(nullptr);
+  frame = &reservedFrame;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusBuffer::CommitWritableFrame(long frameNumber,
+    double unfilteredTimestamp /*= UNDEFINED_TIMESTAMP*/,
+    double filteredTimestamp /*= UNDEFINED_TIMESTAMP*/,
+    const igsioFieldMapType* customFields /*= NULL*/)
+{
+  return this->CommitReservedFrame(frameNumber, unfilteredTimestamp, filteredTimestamp, customFields, nullptr);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusBuffer::AddGpuItem(const PlusGpuFramePtr& gpuFrame,
+                                     long frameNumber,
+                                     double unfilteredTimestamp /*= UNDEFINED_TIMESTAMP*/,
+                                     double filteredTimestamp /*= UNDEFINED_TIMESTAMP*/,
+                                     const igsioFieldMapType* customFields /*= NULL*/)
+{
+  if (gpuFrame == nullptr)
+  {
+    LOCAL_LOG_ERROR("vtkPlusBuffer: Unable to add NULL GPU frame to the buffer!");
+    return PLUS_FAIL;
+  }
+
+  // The host frame of the slot is allocated, but it is filled only when a reader requests it
+  igsioVideoFrame* frame = NULL;
+  if (this->AcquireWritableFrame(frame) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  return this->CommitReservedFrame(frameNumber, unfilteredTimestamp, filteredTimestamp, customFields, gpuFrame);
+}
+
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusBuffer::GetGpuFrame(BufferItemUidType uid, PlusGpuFramePtr& gpuFrame)
+{
+  gpuFrame = nullptr;
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  if (this->StreamBuffer->GetCompactPoseStorage())
+  {
+    return ITEM_OK;
+  }
+  StreamBufferItem* dataItem = NULL;
+  ItemStatus itemStatus = this->StreamBuffer->GetBufferItemPointerFromUid(uid, dataItem);
+  if (itemStatus != ITEM_OK)
+  {
+    return itemStatus;
+  }
+  gpuFrame = dataItem->GetGpuFrame();
+  return ITEM_OK;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusBuffer::SetNextItemSourceBitstream(const StreamBufferItem::SourceBitstreamPtr& sourceBitstream)
+{
+  this->PendingSourceBitstream = sourceBitstream;
+}
+
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusBuffer::GetSourceBitstream(BufferItemUidType uid, StreamBufferItem::SourceBitstreamPtr& sourceBitstream)
+{
+  sourceBitstream = nullptr;
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  if (this->StreamBuffer->GetCompactPoseStorage())
+  {
+    return ITEM_OK;
+  }
+  StreamBufferItem* dataItem = NULL;
+  ItemStatus itemStatus = this->StreamBuffer->GetBufferItemPointerFromUid(uid, dataItem);
+  if (itemStatus != ITEM_OK)
+  {
+    return itemStatus;
+  }
+  sourceBitstream = dataItem->GetSourceBitstream();
+  return ITEM_OK;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusBuffer::CommitReservedFrame(long frameNumber, double unfilteredTimestamp, double filteredTimestamp, const igsioFieldMapType* customFields, const PlusGpuFramePtr& gpuFrame)
+{
+  // The source bitstream belongs to this frame only, even if the frame is not added
+  StreamBufferItem::SourceBitstreamPtr sourceBitstream;
+  sourceBitstream.swap(this->PendingSourceBitstream);
+
+  if (!this->StreamBuffer->HasReservedItem())
+  {
+    LOCAL_LOG_ERROR("vtkPlusBuffer: Unable to commit writable frame - no frame has been acquired!");
+    return PLUS_FAIL;
+  }
+
+  if (unfilteredTimestamp == UNDEFINED_TIMESTAMP)
+  {
+    unfilteredTimestamp = vtkIGSIOAccurateTimer::GetSystemTime();
+  }
+
+  if (filteredTimestamp == UNDEFINED_TIMESTAMP)
+  {
+    bool filteredTimestampProbablyValid = true;
+    if (this->StreamBuffer->CreateFilteredTimeStampForItem(frameNumber, unfilteredTimestamp, filteredTimestamp, filteredTimestampProbablyValid) != PLUS_SUCCESS)
+    {
+      LOCAL_LOG_WARNING("Failed to create filtered timestamp for video buffer item with item index: " << frameNumber);
+      this->StreamBuffer->ReleaseReservedItem();
+      return PLUS_FAIL;
+    }
+    if (!filteredTimestampProbablyValid)
+    {
+      LOG_INFO("Filtered timestamp is probably invalid for video buffer item with item index=" << frameNumber << ", time=" <<
+               unfilteredTimestamp << ". The item may have been tagged with an inaccurate timestamp, therefore it will not be recorded.");
+      this->StreamBuffer->ReleaseReservedItem();
+      return PLUS_SUCCESS;
+    }
+  }
+  else
+  {
+    this->StreamBuffer->AddToTimeStampReport(frameNumber, unfilteredTimestamp, filteredTimestamp);
+  }
+
+  int bufferIndex(0);
+  BufferItemUidType itemUid;
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  if (this->StreamBuffer->CommitReservedItem(filteredTimestamp, itemUid, bufferIndex) != PLUS_SUCCESS)
+  {
+    // Just a debug message, because we want to avoid unnecessary warning messages if the timestamp is the same as last one
+    LOCAL_LOG_DEBUG("vtkPlusBuffer: Failed to commit writable frame to video buffer!");
+    return PLUS_FAIL;
+  }
+
+  StreamBufferItem* newObjectInBuffer = this->StreamBuffer->GetBufferItemPointerFromBufferIndex(bufferIndex);
+  if (newObjectInBuffer == NULL)
+  {
+    LOCAL_LOG_ERROR("vtkPlusBuffer: Failed to get pointer to video buffer object from the video buffer for the new frame!");
+    return PLUS_FAIL;
+  }
+
+  newObjectInBuffer->SetFilteredTimestamp(filteredTimestamp);
+  newObjectInBuffer->SetUnfilteredTimestamp(unfilteredTimestamp);
+  newObjectInBuffer->SetIndex(frameNumber);
+  newObjectInBuffer->SetUid(itemUid);
+  newObjectInBuffer->SetGpuFrame(gpuFrame);
+  newObjectInBuffer->SetSourceBitstream(sourceBitstream);
+
+  // Add custom fields, the fields of the overwritten item are removed
+  newObjectInBuffer->ClearFrameFields();
+  if (customFields != NULL)
+  {
+    for (igsioFieldMapType::const_iterator it = customFields->begin(); it != customFields->end(); ++it)
+    {
+      newObjectInBuffer->SetFrameField(it->first, it->second.second, it->second.first);
+      std::string name(it->first);
+      if (name.find("Transform") != std::string::npos)
+      {
+        newObjectInBuffer->SetValidTransformData(true);
+      }
+    }
+  }
+
+  PlusTelemetry::Instance()->AddSampleSince(PlusTelemetry::STAGE_ACQUISITION_TO_BUFFER, unfilteredTimestamp);
+  this->SignalNewDataEvents();
+  this->ScheduleAgedItemCompression();
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+void vtkPlusBuffer::ReleaseWritableFrame()
+{
+  this->PendingSourceBitstream = nullptr;
+  this->StreamBuffer->ReleaseReservedItem();
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusBuffer::AddTimeStampedItem(vtkMatrix4x4* matrix, ToolStatus status, unsigned long frameNumber, double unfilteredTimestamp, double filteredTimestamp/*=UNDEFINED_TIMESTAMP*/, const igsioFieldMapType* customFields /*= NULL*/)
 {
@@ -656,10 +1021,91 @@ PlusStatus vtkPlusBuffer::AddTimeStampedItem(vtkMatrix4x4* matrix, ToolStatus st
     this->StreamBuffer->AddToTimeStampReport(frameNumber, unfilteredTimestamp, filteredTimestamp);
   }
 
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  PlusStatus itemStatus = this->WriteTimeStampedItem(matrix, status, frameNumber, unfilteredTimestamp, filteredTimestamp, customFields);
+  if (itemStatus == PLUS_SUCCESS)
+  {
+    this->SignalNewDataEvents();
+  }
+  return itemStatus;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusBuffer::AddTimeStampedItems(const std::vector<ToolSample>& samples, unsigned long firstFrameNumber)
+{
+  if (samples.empty())
+  {
+    return PLUS_SUCCESS;
+  }
+
+  // Compute the timestamps before locking the buffer, same as for a single item
+  std::vector<double> unfilteredTimestamps(samples.size());
+  std::vector<double> filteredTimestamps(samples.size());
+  std::vector<bool> recordSample(samples.size(), true);
+  PlusStatus status = PLUS_SUCCESS;
+  for (size_t i = 0; i < samples.size(); ++i)
+  {
+    const unsigned long frameNumber = firstFrameNumber + static_cast<unsigned long>(i);
+    double unfilteredTimestamp = samples[i].UnfilteredTimestamp;
+    double filteredTimestamp = samples[i].FilteredTimestamp;
+    if (unfilteredTimestamp == UNDEFINED_TIMESTAMP)
+    {
+      unfilteredTimestamp = vtkIGSIOAccurateTimer::GetSystemTime();
+    }
+    if (filteredTimestamp == UNDEFINED_TIMESTAMP)
+    {
+      bool filteredTimestampProbablyValid = true;
+      if (this->StreamBuffer->CreateFilteredTimeStampForItem(frameNumber, unfilteredTimestamp, filteredTimestamp, filteredTimestampProbablyValid) != PLUS_SUCCESS)
+      {
+        LOCAL_LOG_DEBUG("Failed to create filtered timestamp for tracker buffer item with item index: " << frameNumber);
+        recordSample[i] = false;
+        status = PLUS_FAIL;
+      }
+      else if (!filteredTimestampProbablyValid)
+      {
+        LOG_INFO("Filtered timestamp is probably invalid for tracker buffer item with item index=" << frameNumber << ", time=" << unfilteredTimestamp << ". The item may have been tagged with an inaccurate timestamp, therefore it will not be recorded.");
+        recordSample[i] = false;
+      }
+    }
+    else
+    {
+      this->StreamBuffer->AddToTimeStampReport(frameNumber, unfilteredTimestamp, filteredTimestamp);
+    }
+    unfilteredTimestamps[i] = unfilteredTimestamp;
+    filteredTimestamps[i] = filteredTimestamp;
+  }
+
+  // Add all the samples with one buffer lock and notify the readers only once
+  vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  bool itemAdded = false;
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  for (size_t i = 0; i < samples.size(); ++i)
+  {
+    if (!recordSample[i])
+    {
+      continue;
+    }
+    matrix->DeepCopy(samples[i].Matrix);
+    if (this->WriteTimeStampedItem(matrix, samples[i].Status, firstFrameNumber + static_cast<unsigned long>(i), unfilteredTimestamps[i], filteredTimestamps[i], NULL) != PLUS_SUCCESS)
+    {
+      status = PLUS_FAIL;
+      continue;
+    }
+    itemAdded = true;
+  }
+  if (itemAdded)
+  {
+    this->SignalNewDataEvents();
+  }
+  return status;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusBuffer::WriteTimeStampedItem(vtkMatrix4x4* matrix, ToolStatus status, unsigned long frameNumber, double unfilteredTimestamp, double filteredTimestamp, const igsioFieldMapType* customFields)
+{
   int bufferIndex(0);
   BufferItemUidType itemUid;
 
-  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
   if (this->StreamBuffer->PrepareForNewItem(filteredTimestamp, itemUid, bufferIndex) != PLUS_SUCCESS)
   {
     // Just a debug message, because we want to avoid unnecessary warning messages if the timestamp is the same as last one
@@ -667,6 +1113,36 @@ PlusStatus vtkPlusBuffer::AddTimeStampedItem(vtkMatrix4x4* matrix, ToolStatus st
     return PLUS_FAIL;
   }
 
+  if (this->StreamBuffer->GetCompactPoseStorage())
+  {
+    CompactPoseItem* newCompactItem = this->StreamBuffer->GetCompactPoseItemPointerFromBufferIndex(bufferIndex);
+    if (newCompactItem == NULL)
+    {
+      LOCAL_LOG_ERROR("vtkPlusBuffer: Failed to get pointer to compact pose item from the tracker buffer for the new frame!");
+      return PLUS_FAIL;
+    }
+    for (int row = 0; row < 3; ++row)
+    {
+      for (int column = 0; column < 4; ++column)
+      {
+        newCompactItem->Matrix[row * 4 + column] = matrix->GetElement(row, column);
+      }
+    }
+    newCompactItem->Status = status;
+    newCompactItem->FilteredTimestamp = filteredTimestamp;
+    newCompactItem->UnfilteredTimestamp = unfilteredTimestamp;
+    newCompactItem->Index = frameNumber;
+    newCompactItem->ValidTransformData = false;
+    if (customFields != NULL && !customFields->empty() && !this->CompactPoseFieldsDropped)
+    {
+      LOCAL_LOG_WARNING("Custom frame fields are not stored in the tracker buffer, because it uses compact pose storage");
+      this->CompactPoseFieldsDropped = true;
+    }
+
+    PlusTelemetry::Instance()->AddSampleSince(PlusTelemetry::STAGE_ACQUISITION_TO_BUFFER, unfilteredTimestamp);
+    return PLUS_SUCCESS;
+  }
+
   // get the pointer to the correct location in the tracker buffer, where this data needs to be copied
   StreamBufferItem* newObjectInBuffer = this->StreamBuffer->GetBufferItemPointerFromBufferIndex(bufferIndex);
   if (newObjectInBuffer == NULL)
@@ -682,7 +1158,8 @@ PlusStatus vtkPlusBuffer::AddTimeStampedItem(vtkMatrix4x4* matrix, ToolStatus st
   newObjectInBuffer->SetIndex(frameNumber);
   newObjectInBuffer->SetUid(itemUid);
 
-  // Add custom fields
+  // Add custom fields, the fields of the overwritten item are removed
+  newObjectInBuffer->ClearFrameFields();
   if (customFields != NULL)
   {
     for (igsioFieldMapType::const_iterator it = customFields->begin(); it != customFields->end(); ++it)
@@ -696,6 +1173,7 @@ PlusStatus vtkPlusBuffer::AddTimeStampedItem(vtkMatrix4x4* matrix, ToolStatus st
     }
   }
 
+  PlusTelemetry::Instance()->AddSampleSince(PlusTelemetry::STAGE_ACQUISITION_TO_BUFFER, unfilteredTimestamp);
   return itemStatus;
 }
 
@@ -718,9 +1196,15 @@ ItemStatus vtkPlusBuffer::GetTimeStamp(BufferItemUidType uid, double& timestamp)
 }
 
 //----------------------------------------------------------------------------
-ItemStatus vtkPlusBuffer::GetIndex(BufferItemUidType uid, unsigned long& index)
+void vtkPlusBuffer::GetItemTimeStamps(BufferItemUidType firstUid, BufferItemUidType lastUid, std::vector<BufferItemUidType>& uids, std::vector<double>& timestamps)
 {
-  return this->StreamBuffer->GetIndex(uid, index);
+  this->StreamBuffer->GetItemTimeStamps(firstUid, lastUid, uids, timestamps);
+}
+
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusBuffer::GetIndex(BufferItemUidType uid, unsigned long& index)
+{
+  return this->StreamBuffer->GetIndex(uid, index);
 }
 
 
@@ -771,6 +1255,19 @@ ItemStatus vtkPlusBuffer::GetStreamBufferItem(BufferItemUidType uid, StreamBuffe
 
   igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
 
+  if (this->StreamBuffer->GetCompactPoseStorage())
+  {
+    CompactPoseItem* compactItem = NULL;
+    ItemStatus itemStatus = this->StreamBuffer->GetCompactPoseItemPointerFromUid(uid, compactItem);
+    if (itemStatus != ITEM_OK)
+    {
+      LOCAL_LOG_WARNING("Failed to retrieve data item");
+      return itemStatus;
+    }
+    CopyCompactPoseItem(*compactItem, uid, bufferItem);
+    return ITEM_OK;
+  }
+
   StreamBufferItem* dataItem = NULL;
   ItemStatus itemStatus = this->StreamBuffer->GetBufferItemPointerFromUid(uid, dataItem);
   if (itemStatus != ITEM_OK)
@@ -779,21 +1276,181 @@ ItemStatus vtkPlusBuffer::GetStreamBufferItem(BufferItemUidType uid, StreamBuffe
     return itemStatus;
   }
 
+  // Frames that were captured into GPU memory are read back when they are first requested
+  if (dataItem->ReadBackGpuFrame() != PLUS_SUCCESS)
+  {
+    LOCAL_LOG_WARNING("Failed to read back GPU frame of data item");
+    return ITEM_NOT_AVAILABLE_ANYMORE;
+  }
+
   if (bufferItem->DeepCopy(dataItem) != PLUS_SUCCESS)
   {
     LOCAL_LOG_WARNING("Failed to copy data item");
     return ITEM_UNKNOWN_ERROR;
   }
 
+  // Aged items stay compressed in the buffer, only the copy is decompressed
+  if (bufferItem->DecompressFrame() != PLUS_SUCCESS)
+  {
+    LOCAL_LOG_WARNING("Failed to decompress data item");
+    return ITEM_UNKNOWN_ERROR;
+  }
+
   return ITEM_OK;
 }
 
+//----------------------------------------------------------------------------
+void vtkPlusBuffer::RegisterSnapshot(BufferSnapshotItems* snapshotItems)
+{
+  this->StreamBuffer->RegisterSnapshot(snapshotItems);
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusBuffer::UnregisterSnapshot(BufferSnapshotItems* snapshotItems)
+{
+  this->StreamBuffer->UnregisterSnapshot(snapshotItems);
+}
+
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusBuffer::GetSnapshotStreamBufferItem(BufferSnapshotItems* snapshotItems, BufferItemUidType uid, StreamBufferItem* bufferItem)
+{
+  if (snapshotItems == NULL || bufferItem == NULL)
+  {
+    LOCAL_LOG_ERROR("Unable to copy snapshot item - snapshot or output data buffer item is NULL!");
+    return ITEM_UNKNOWN_ERROR;
+  }
+
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+
+  if (this->StreamBuffer->GetCompactPoseStorage())
+  {
+    CompactPoseItem* compactItem = NULL;
+    ItemStatus itemStatus = this->StreamBuffer->GetSnapshotCompactPoseItemPointerFromUid(snapshotItems, uid, compactItem);
+    if (itemStatus != ITEM_OK)
+    {
+      return itemStatus;
+    }
+    CopyCompactPoseItem(*compactItem, uid, bufferItem);
+    return ITEM_OK;
+  }
+
+  StreamBufferItem* dataItem = NULL;
+  ItemStatus itemStatus = this->StreamBuffer->GetSnapshotItemPointerFromUid(snapshotItems, uid, dataItem);
+  if (itemStatus != ITEM_OK)
+  {
+    return itemStatus;
+  }
+  if (dataItem->ReadBackGpuFrame() != PLUS_SUCCESS)
+  {
+    LOCAL_LOG_WARNING("Failed to read back GPU frame of snapshot item");
+    return ITEM_NOT_AVAILABLE_ANYMORE;
+  }
+  if (bufferItem->DeepCopy(dataItem) != PLUS_SUCCESS)
+  {
+    LOCAL_LOG_WARNING("Failed to copy snapshot item");
+    return ITEM_UNKNOWN_ERROR;
+  }
+  if (bufferItem->DecompressFrame() != PLUS_SUCCESS)
+  {
+    LOCAL_LOG_WARNING("Failed to decompress snapshot item");
+    return ITEM_UNKNOWN_ERROR;
+  }
+  return ITEM_OK;
+}
+
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusBuffer::GetStreamBufferItemView(BufferItemUidType uid, StreamBufferItem* bufferItem)
+{
+  if (bufferItem == NULL)
+  {
+    LOCAL_LOG_ERROR("Unable to share data buffer item with a NULL data buffer item!");
+    return ITEM_UNKNOWN_ERROR;
+  }
+
+  if (this->StreamBuffer->GetCompactPoseStorage())
+  {
+    // There is no pixel data to share
+    return this->GetStreamBufferItem(uid, bufferItem);
+  }
+
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+
+  StreamBufferItem* dataItem = NULL;
+  ItemStatus itemStatus = this->StreamBuffer->GetBufferItemPointerFromUid(uid, dataItem);
+  if (itemStatus != ITEM_OK)
+  {
+    LOCAL_LOG_WARNING("Failed to retrieve data item");
+    return itemStatus;
+  }
+
+  if (dataItem->ReadBackGpuFrame() != PLUS_SUCCESS)
+  {
+    LOCAL_LOG_WARNING("Failed to read back GPU frame of data item");
+    return ITEM_NOT_AVAILABLE_ANYMORE;
+  }
+
+  if (bufferItem->ShallowCopy(dataItem) != PLUS_SUCCESS)
+  {
+    LOCAL_LOG_WARNING("Failed to share data item");
+    return ITEM_UNKNOWN_ERROR;
+  }
+
+  // The pixel data of a compressed item cannot be shared, the view gets its own decompressed copy
+  if (bufferItem->DecompressFrame() != PLUS_SUCCESS)
+  {
+    LOCAL_LOG_WARNING("Failed to decompress data item");
+    return ITEM_UNKNOWN_ERROR;
+  }
+
+  return ITEM_OK;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusBuffer::CopyCompactPoseItem(const CompactPoseItem& compactItem, BufferItemUidType uid, StreamBufferItem* bufferItem)
+{
+  double matrixElements[16] = { 0.0 };
+  std::copy(compactItem.Matrix, compactItem.Matrix + 12, matrixElements);
+  matrixElements[15] = 1.0;
+  bufferItem->SetMatrixElements(matrixElements);
+  bufferItem->SetStatus(compactItem.Status);
+  bufferItem->SetFilteredTimestamp(compactItem.FilteredTimestamp);
+  bufferItem->SetUnfilteredTimestamp(compactItem.UnfilteredTimestamp);
+  bufferItem->SetIndex(compactItem.Index);
+  bufferItem->SetUid(uid);
+  bufferItem->SetValidTransformData(compactItem.ValidTransformData);
+  bufferItem->ClearFrameFields();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusBuffer::DetachSharedFrameData(igsioVideoFrame& frame)
+{
+  vtkImageData* image = frame.GetImage();
+  if (frame.IsFrameEncoded() || image == NULL || image->GetPointData() == NULL)
+  {
+    return;
+  }
+
+  vtkDataArray* scalars = image->GetPointData()->GetScalars();
+  if (scalars == NULL || scalars->GetReferenceCount() <= 1)
+  {
+    // Not shared with any view, the pixel data can be overwritten in place
+    return;
+  }
+
+  vtkSmartPointer<vtkDataArray> detachedScalars = vtkSmartPointer<vtkDataArray>::Take(vtkDataArray::CreateDataArray(scalars->GetDataType()));
+  detachedScalars->SetNumberOfComponents(scalars->GetNumberOfComponents());
+  detachedScalars->SetNumberOfTuples(scalars->GetNumberOfTuples());
+  detachedScalars->SetName(scalars->GetName());
+  image->GetPointData()->SetScalars(detachedScalars);
+}
+
 //----------------------------------------------------------------------------
 void vtkPlusBuffer::DeepCopy(vtkPlusBuffer* buffer)
 {
   LOG_TRACE("vtkPlusBuffer::DeepCopy");
 
   this->StreamBuffer->DeepCopy(buffer->StreamBuffer);
+  this->LastCompressionCheckedUid = 0;
   if (buffer->GetFrameSize()[0] != -1 && buffer->GetFrameSize()[1] != -1 && buffer->GetFrameSize()[2] != -1)
   {
     this->SetFrameSize(buffer->GetFrameSize());
@@ -808,7 +1465,10 @@ void vtkPlusBuffer::DeepCopy(vtkPlusBuffer* buffer)
 //----------------------------------------------------------------------------
 void vtkPlusBuffer::Clear()
 {
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
   this->StreamBuffer->Clear();
+  // UIDs start again from the beginning
+  this->LastCompressionCheckedUid = 0;
 }
 
 //----------------------------------------------------------------------------
@@ -885,6 +1545,11 @@ PlusStatus vtkPlusBuffer::SetImageOrientation(US_IMAGE_ORIENTATION imgOrientatio
     return PLUS_FAIL;
   }
   this->ImageOrientation = imgOrientation;
+  if (this->StreamBuffer->GetCompactPoseStorage())
+  {
+    // No frames are stored
+    return PLUS_SUCCESS;
+  }
   for (int frameNumber = 0; frameNumber < this->StreamBuffer->GetBufferSize(); frameNumber++)
   {
     this->StreamBuffer->GetBufferItemPointerFromBufferIndex(frameNumber)->GetFrame().SetImageOrientation(imgOrientation);
@@ -1078,57 +1743,59 @@ PlusStatus vtkPlusBuffer::WriteToSequenceFile(const char* filename, bool useComp
 
   vtkSmartPointer<vtkIGSIOTrackedFrameList> trackedFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
 
-  PlusStatus status = PLUS_SUCCESS;
-
-  for (BufferItemUidType frameUid = this->GetOldestItemUidInBuffer(); frameUid <= this->GetLatestItemUidInBuffer(); ++frameUid)
+  // Snapshot the buffer, then copy the items and assemble the frames in parallel.
+  // Items that are overwritten by the acquisition meanwhile are preserved by the snapshot.
+  PlusBufferSnapshot snapshot(this);
+  const double localTimeOffsetSec = this->GetLocalTimeOffsetSec();
+  std::vector<igsioTrackedFrame*> trackedFrames;
+  PlusTrackedFrameAssembly::AssembleFrames(snapshot.GetNumberOfItems(), [this, &snapshot, localTimeOffsetSec](int frameIndex, igsioTrackedFrame & trackedFrame)
   {
     StreamBufferItem bufferItem;
-    if (this->GetStreamBufferItem(frameUid, &bufferItem) != ITEM_OK)
+    BufferItemUidType frameUid = snapshot.GetOldestItemUid() + frameIndex;
+    if (snapshot.GetStreamBufferItem(frameUid, &bufferItem) != ITEM_OK)
     {
       LOCAL_LOG_ERROR("Unable to get frame from buffer with UID: " << frameUid);
-      status = PLUS_FAIL;
-      continue;
+      return PLUS_FAIL;
     }
 
-    igsioTrackedFrame* trackedFrame = new igsioTrackedFrame;
-
     // Add image data
-    trackedFrame->SetImageData(bufferItem.GetFrame());
+    trackedFrame.SetImageData(bufferItem.GetFrame());
 
     // Add tracking data
     vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
     bufferItem.GetMatrix(matrix);
-    trackedFrame->SetFrameTransform(igsioTransformName("Tool", "Tracker"), matrix);
-    trackedFrame->SetFrameTransformStatus(igsioTransformName("Tool", "Tracker"), bufferItem.GetStatus());
+    trackedFrame.SetFrameTransform(igsioTransformName("Tool", "Tracker"), matrix);
+    trackedFrame.SetFrameTransformStatus(igsioTransformName("Tool", "Tracker"), bufferItem.GetStatus());
 
     // Add filtered timestamp
-    double filteredTimestamp = bufferItem.GetFilteredTimestamp(this->GetLocalTimeOffsetSec());
+    double filteredTimestamp = bufferItem.GetFilteredTimestamp(localTimeOffsetSec);
     std::ostringstream timestampFieldValue;
     timestampFieldValue << std::fixed << filteredTimestamp;
-    trackedFrame->SetFrameField("Timestamp", timestampFieldValue.str());
+    trackedFrame.SetFrameField("Timestamp", timestampFieldValue.str());
 
     // Add unfiltered timestamp
-    double unfilteredTimestamp = bufferItem.GetUnfilteredTimestamp(this->GetLocalTimeOffsetSec());
+    double unfilteredTimestamp = bufferItem.GetUnfilteredTimestamp(localTimeOffsetSec);
     std::ostringstream unfilteredtimestampFieldValue;
     unfilteredtimestampFieldValue << std::fixed << unfilteredTimestamp;
-    trackedFrame->SetFrameField("UnfilteredTimestamp", unfilteredtimestampFieldValue.str());
+    trackedFrame.SetFrameField("UnfilteredTimestamp", unfilteredtimestampFieldValue.str());
 
     // Add frame number
     unsigned long frameNumber = bufferItem.GetIndex();
     std::ostringstream frameNumberFieldValue;
     frameNumberFieldValue << std::fixed << frameNumber;
-    trackedFrame->SetFrameField("FrameNumber", frameNumberFieldValue.str());
+    trackedFrame.SetFrameField("FrameNumber", frameNumberFieldValue.str());
 
     // Add custom fields
     const igsioFieldMapType& customFields = bufferItem.GetFrameFieldMap();
     for (igsioFieldMapType::const_iterator cf = customFields.begin(); cf != customFields.end(); ++cf)
     {
-      trackedFrame->SetFrameField(cf->first, cf->second.second, cf->second.first);
+      trackedFrame.SetFrameField(cf->first, cf->second.second, cf->second.first);
     }
+    return PLUS_SUCCESS;
+  }, trackedFrames);
 
-    // Add tracked frame to the list
-    trackedFrameList->TakeTrackedFrame(trackedFrame);
-  }
+  // Add tracked frames to the list
+  PlusStatus status = PlusTrackedFrameAssembly::TakeFrames(trackedFrames, trackedFrameList);
 
   // Save tracked frames to metafile
   if (vtkPlusSequenceIO::Write(filename, trackedFrameList, trackedFrameList->GetImageOrientation(), useCompression) != PLUS_SUCCESS)
@@ -1152,6 +1819,200 @@ bool vtkPlusBuffer::GetTimeStampReporting()
   return this->StreamBuffer->GetTimeStampReporting();
 }
 
+//-----------------------------------------------------------------------------
+void vtkPlusBuffer::SetTimeStampReportMaximumNumberOfRows(unsigned int maximumNumberOfRows)
+{
+  this->StreamBuffer->SetTimeStampReportMaximumNumberOfRows(maximumNumberOfRows);
+}
+
+//-----------------------------------------------------------------------------
+unsigned int vtkPlusBuffer::GetTimeStampReportMaximumNumberOfRows()
+{
+  return this->StreamBuffer->GetTimeStampReportMaximumNumberOfRows();
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusBuffer::SetTimeStampReportFilename(const std::string& filename)
+{
+  return this->StreamBuffer->SetTimeStampReportFilename(filename);
+}
+
+//-----------------------------------------------------------------------------
+std::string vtkPlusBuffer::GetTimeStampReportFilename()
+{
+  return this->StreamBuffer->GetTimeStampReportFilename();
+}
+
+//-----------------------------------------------------------------------------
+TimeStampReportStatistics vtkPlusBuffer::GetTimeStampReportStatistics()
+{
+  return this->StreamBuffer->GetTimeStampReportStatistics();
+}
+
+//-----------------------------------------------------------------------------
+void vtkPlusBuffer::AddNewDataEvent(std::shared_ptr<PlusNewDataEvent> newDataEvent)
+{
+  if (newDataEvent == nullptr)
+  {
+    return;
+  }
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  if (std::find(this->NewDataEvents.begin(), this->NewDataEvents.end(), newDataEvent) == this->NewDataEvents.end())
+  {
+    this->NewDataEvents.push_back(newDataEvent);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkPlusBuffer::RemoveNewDataEvent(std::shared_ptr<PlusNewDataEvent> newDataEvent)
+{
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  this->NewDataEvents.erase(std::remove(this->NewDataEvents.begin(), this->NewDataEvents.end(), newDataEvent), this->NewDataEvents.end());
+}
+
+//-----------------------------------------------------------------------------
+void vtkPlusBuffer::SignalNewDataEvents()
+{
+  // the caller must have locked the buffer
+  PlusReplayClock::GetInstance().NotifyDataAdded();
+  for (std::vector<std::shared_ptr<PlusNewDataEvent> >::iterator it = this->NewDataEvents.begin(); it != this->NewDataEvents.end(); ++it)
+  {
+    (*it)->Signal();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkPlusBuffer::ScheduleAgedItemCompression()
+{
+  if (this->CompressItemsOlderThanSec <= 0 || this->AgedItemCompressionScheduled.exchange(true))
+  {
+    return;
+  }
+  // The task keeps the buffer alive until it completes
+  vtkSmartPointer<vtkPlusBuffer> buffer = this;
+  PlusWorkerPool::GetInstance().Submit([buffer]()
+  {
+    buffer->CompressAgedItems();
+    buffer->AgedItemCompressionScheduled = false;
+  });
+}
+
+//-----------------------------------------------------------------------------
+int vtkPlusBuffer::CompressAgedItems()
+{
+  if (this->CompressItemsOlderThanSec <= 0)
+  {
+    return 0;
+  }
+
+  struct AgedItem
+  {
+    BufferItemUidType Uid;
+    vtkSmartPointer<vtkDataArray> Scalars;
+    StreamBufferItem::CompressedPixelDataPtr CompressedPixels;
+  };
+  std::vector<AgedItem> agedItems;
+
+  {
+    igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+    if (this->StreamBuffer->GetCompactPoseStorage() || this->StreamBuffer->GetNumberOfItems() < 1)
+    {
+      return 0;
+    }
+    double latestTimestamp(0);
+    if (this->StreamBuffer->GetLatestTimeStamp(latestTimestamp) != ITEM_OK)
+    {
+      return 0;
+    }
+    const BufferItemUidType latestUid = this->StreamBuffer->GetLatestItemUidInBuffer();
+    if (this->LastCompressionCheckedUid > latestUid)
+    {
+      this->LastCompressionCheckedUid = 0;
+    }
+    for (BufferItemUidType uid = std::max(this->StreamBuffer->GetOldestItemUidInBuffer(), this->LastCompressionCheckedUid + 1); uid <= latestUid; ++uid)
+    {
+      double timestamp(0);
+      if (this->StreamBuffer->GetTimeStamp(uid, timestamp) != ITEM_OK || timestamp > latestTimestamp - this->CompressItemsOlderThanSec)
+      {
+        break;
+      }
+      this->LastCompressionCheckedUid = uid;
+
+      StreamBufferItem* dataItem = NULL;
+      if (this->StreamBuffer->GetBufferItemPointerFromUid(uid, dataItem) != ITEM_OK
+          || dataItem->IsFrameCompressed() || !dataItem->IsHostFrameValid() || dataItem->GetFrame().IsFrameEncoded()
+          || dataItem->GetFrame().GetImage() == NULL)
+      {
+        continue;
+      }
+      vtkDataArray* scalars = dataItem->GetFrame().GetImage()->GetPointData()->GetScalars();
+      if (scalars == NULL || scalars->GetNumberOfTuples() == 0)
+      {
+        continue;
+      }
+      // The reference makes the acquisition detach the pixel data if it overwrites the item meanwhile (see DetachSharedFrameData)
+      AgedItem agedItem;
+      agedItem.Uid = uid;
+      agedItem.Scalars = scalars;
+      agedItems.push_back(agedItem);
+    }
+  }
+
+  // Compress without locking the buffer, so that the acquisition is not blocked
+  for (std::vector<AgedItem>::iterator agedItem = agedItems.begin(); agedItem != agedItems.end(); ++agedItem)
+  {
+    const unsigned long long uncompressedSize = static_cast<unsigned long long>(agedItem->Scalars->GetNumberOfTuples()) * agedItem->Scalars->GetNumberOfComponents() * agedItem->Scalars->GetDataTypeSize();
+    if (StreamBufferItem::CompressPixelData(agedItem->Scalars, AGED_ITEM_COMPRESSION_LEVEL, agedItem->CompressedPixels) != PLUS_SUCCESS
+        || agedItem->CompressedPixels->Data.size() >= uncompressedSize)
+    {
+      // Incompressible pixel data is kept as is
+      agedItem->CompressedPixels = nullptr;
+    }
+  }
+
+  int numberOfCompressedItems(0);
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  for (std::vector<AgedItem>::iterator agedItem = agedItems.begin(); agedItem != agedItems.end(); ++agedItem)
+  {
+    StreamBufferItem* dataItem = NULL;
+    if (agedItem->CompressedPixels == nullptr
+        || this->StreamBuffer->GetBufferItemPointerFromUid(agedItem->Uid, dataItem) != ITEM_OK
+        || dataItem->IsFrameCompressed() || !dataItem->IsHostFrameValid() || dataItem->GetFrame().GetImage() == NULL
+        || dataItem->GetFrame().GetImage()->GetPointData()->GetScalars() != agedItem->Scalars)
+    {
+      // The item has been overwritten or modified since it was selected
+      continue;
+    }
+    dataItem->SetCompressedPixelData(agedItem->CompressedPixels);
+    numberOfCompressedItems++;
+  }
+  return numberOfCompressedItems;
+}
+
+//-----------------------------------------------------------------------------
+void vtkPlusBuffer::SetLockFreeReadEnabled(bool enable)
+{
+  this->StreamBuffer->SetLockFreeReadEnabled(enable);
+}
+
+//-----------------------------------------------------------------------------
+bool vtkPlusBuffer::GetLockFreeReadEnabled()
+{
+  return this->StreamBuffer->GetLockFreeReadEnabled();
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusBuffer::SetCompactPoseStorage(bool enable)
+{
+  return this->StreamBuffer->SetCompactPoseStorage(enable);
+}
+
+//-----------------------------------------------------------------------------
+bool vtkPlusBuffer::GetCompactPoseStorage()
+{
+  return this->StreamBuffer->GetCompactPoseStorage();
+}
+
 //----------------------------------------------------------------------------
 // Returns the two buffer items that are closest previous and next buffer items relative to the specified time.
 // itemA is the closest item
@@ -1184,7 +2045,15 @@ PlusStatus vtkPlusBuffer::GetPrevNextBufferItemFromTime(double time, StreamBuffe
     }
     return PLUS_FAIL;
   }
-  status = this->GetStreamBufferItem(itemAuid, &itemA);
+  return this->GetPrevNextBufferItemFromClosestUid(time, itemAuid, itemA, itemB);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusBuffer::GetPrevNextBufferItemFromClosestUid(double time, BufferItemUidType itemAuid, StreamBufferItem& itemA, StreamBufferItem& itemB)
+{
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+
+  ItemStatus status = this->GetStreamBufferItem(itemAuid, &itemA);
   if (status != ITEM_OK)
   {
     LOCAL_LOG_ERROR("vtkPlusBuffer: Failed to get data buffer item with Uid: " << itemAuid);
@@ -1288,9 +2157,58 @@ ItemStatus vtkPlusBuffer::GetStreamBufferItemFromTime(double time, StreamBufferI
   }
 }
 
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusBuffer::GetTransformSample(BufferItemUidType uid, TransformSample& sample, igsioFieldMapType* frameFields/*=NULL*/)
+{
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+
+  if (this->StreamBuffer->GetCompactPoseStorage())
+  {
+    CompactPoseItem* compactItem = NULL;
+    ItemStatus itemStatus = this->StreamBuffer->GetCompactPoseItemPointerFromUid(uid, compactItem);
+    if (itemStatus != ITEM_OK)
+    {
+      return itemStatus;
+    }
+    std::copy(compactItem->Matrix, compactItem->Matrix + 12, sample.Matrix);
+    sample.Matrix[12] = 0.0;
+    sample.Matrix[13] = 0.0;
+    sample.Matrix[14] = 0.0;
+    sample.Matrix[15] = 1.0;
+    sample.Status = compactItem->Status;
+    sample.FilteredTimestamp = compactItem->FilteredTimestamp;
+    if (frameFields != NULL)
+    {
+      frameFields->clear();
+    }
+    return ITEM_OK;
+  }
+
+  StreamBufferItem* dataItem = NULL;
+  ItemStatus itemStatus = this->StreamBuffer->GetBufferItemPointerFromUid(uid, dataItem);
+  if (itemStatus != ITEM_OK)
+  {
+    return itemStatus;
+  }
+
+  dataItem->GetMatrixElements(sample.Matrix);
+  sample.Status = dataItem->GetStatus();
+  sample.FilteredTimestamp = dataItem->GetFilteredTimestamp(0.0);   // 0.0 because timestamps in the buffer are in local time
+  if (frameFields != NULL)
+  {
+    *frameFields = dataItem->GetFrameFieldMap();
+  }
+  return ITEM_OK;
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusBuffer::ModifyBufferItemFrameField(BufferItemUidType uid, const std::string& key, const std::string& value)
 {
+  if (this->StreamBuffer->GetCompactPoseStorage())
+  {
+    LOCAL_LOG_ERROR("Failed to modify frame field " << key << " - custom frame fields are not stored with compact pose storage");
+    return PLUS_FAIL;
+  }
   StreamBufferItem* item;
   auto itemStatus = this->StreamBuffer->GetBufferItemPointerFromUid(uid, item);
   if (itemStatus == ITEM_OK)
@@ -1361,15 +2279,39 @@ ItemStatus vtkPlusBuffer::GetStreamBufferItemFromClosestTime(double time, Stream
 // position is interpolated with linear interpolation.
 // The flags correspond to the closest element.
 ItemStatus vtkPlusBuffer::GetInterpolatedStreamBufferItemFromTime(double time, StreamBufferItem* bufferItem)
+{
+  BufferItemUidType closestItemUid(0);
+  ItemStatus status = this->StreamBuffer->GetItemUidFromTime(time, closestItemUid);
+  if (status != ITEM_OK)
+  {
+    switch (status)
+    {
+      case ITEM_NOT_AVAILABLE_YET:
+        LOCAL_LOG_WARNING("vtkPlusBuffer: Cannot get any item from the buffer for time: " << std::fixed << time << ". Item is not available yet.");
+        break;
+      case ITEM_NOT_AVAILABLE_ANYMORE:
+        LOCAL_LOG_WARNING("vtkPlusBuffer: Cannot get any item from the buffer for time: " << std::fixed << time << ". Item is not available anymore.");
+        break;
+      default:
+        break;
+    }
+    LOCAL_LOG_ERROR("vtkPlusBuffer: Failed to get data buffer timestamp (time: " << std::fixed << time << ")");
+    return status;
+  }
+  return this->GetInterpolatedStreamBufferItemFromClosestUid(time, closestItemUid, bufferItem);
+}
+
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusBuffer::GetInterpolatedStreamBufferItemFromClosestUid(double time, BufferItemUidType closestItemUid, StreamBufferItem* bufferItem)
 {
   StreamBufferItem itemA;
   StreamBufferItem itemB;
 
-  if (GetPrevNextBufferItemFromTime(time, itemA, itemB) != PLUS_SUCCESS)
+  if (GetPrevNextBufferItemFromClosestUid(time, closestItemUid, itemA, itemB) != PLUS_SUCCESS)
   {
     // cannot get two neighbors, so cannot do interpolation
     // it may be normal (e.g., when tracker out of view), so don't return with an error
-    ItemStatus status = GetStreamBufferItemFromClosestTime(time, bufferItem);
+    ItemStatus status = this->GetStreamBufferItem(closestItemUid, bufferItem);
     // Update the timestamp to match the requested time
     bufferItem->SetFilteredTimestamp(time);
     bufferItem->SetUnfilteredTimestamp(time);
@@ -18,6 +18,7 @@ See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
 #include "igsioCommon.h"
 #include "PlusConfigure.h"
 #include "vtkPlusDataCollectionExport.h"
+#include "PlusNewDataEvent.h"
 #include "PlusStreamBufferItem.h"
 #include "vtkPlusTimestampedCircularBuffer.h"
 
@@ -26,6 +27,11 @@ See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
 // VTK includes
 #include <vtkObject.h>
 
+// STL includes
+#include <atomic>
+#include <memory>
+#include <vector>
+
 class vtkPlusDevice;
 enum ToolStatus;
 
@@ -49,6 +55,17 @@ public:
     CLOSEST_TIME /*!< returns the closest item  */
   };
 
+  /*! Tracker item to be added to the buffer, see AddTimeStampedItems */
+  struct ToolSample
+  {
+    /*! Matrix elements in row-major order */
+    double Matrix[16];
+    ToolStatus Status;
+    double UnfilteredTimestamp;
+    /*! If undefined then the filtered timestamp is computed from the unfiltered timestamp */
+    double FilteredTimestamp;
+  };
+
   static vtkPlusBuffer* New();
   vtkTypeMacro(vtkPlusBuffer, vtkObject);
   virtual void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
@@ -61,6 +78,30 @@ public:
   /*! Get the size of the buffer */
   virtual int GetBufferSize();
 
+  /*!
+    Time span of data that the buffer should hold, in seconds. If it is set (positive) then
+    GetBufferSizeForDuration computes the buffer size from the measured frame rate and vtkPlusDataCollector
+    resizes the buffer periodically (see vtkPlusDataCollector::UpdateBufferSizes). 0 disables time-based sizing.
+  */
+  void SetBufferDurationSec(double durationSec);
+  /*! Get the time span of data that the buffer should hold, in seconds (0 if time-based sizing is disabled) */
+  double GetBufferDurationSec() const;
+
+  /*!
+    Number of items that hold BufferDurationSec seconds of data at the measured frame rate, at least MINIMUM_DURATION_BASED_BUFFER_SIZE.
+    Returns the current buffer size if time-based sizing is disabled or the frame rate cannot be measured yet.
+  */
+  int GetBufferSizeForDuration();
+
+  /*! Approximate memory used by one buffer item in bytes, including the pre-allocated video frame */
+  unsigned long long GetItemSizeInBytes();
+
+  /*! Memory currently used by the items and the timestamp report of the buffer (see vtkPlusTimestampedCircularBuffer::GetMemoryUsage) */
+  void GetMemoryUsage(BufferMemoryUsage& usage);
+
+  /*! Minimum number of items of a buffer that is sized by BufferDurationSec */
+  static const int MINIMUM_DURATION_BASED_BUFFER_SIZE;
+
   /*!
     Add a frame plus a timestamp to the buffer with frame index.
     If the timestamp is  less than or equal to the previous timestamp,
@@ -144,6 +185,51 @@ public:
                              double unfilteredTimestamp = UNDEFINED_TIMESTAMP,
                              double filteredTimestamp = UNDEFINED_TIMESTAMP);
 
+  /*!
+    Reserve the next frame of the buffer so that a device can fill the image data in place, without an intermediate copy.
+    The returned frame is allocated with the frame size, pixel type, number of components and orientation of the buffer,
+    therefore the image data must be written already clipped and in the buffer's orientation.
+    The frame is not accessible by readers until CommitWritableFrame is called.
+    If the frame cannot be filled then ReleaseWritableFrame must be called.
+  */
+  virtual PlusStatus AcquireWritableFrame(igsioVideoFrame*& frame);
+
+  /*!
+    Add the frame that was previously acquired by AcquireWritableFrame to the buffer with frame index and timestamp.
+    If the timestamp is less than or equal to the previous timestamp then the frame is not added to the buffer.
+  */
+  virtual PlusStatus CommitWritableFrame(long frameNumber,
+                                         double unfilteredTimestamp = UNDEFINED_TIMESTAMP,
+                                         double filteredTimestamp = UNDEFINED_TIMESTAMP,
+                                         const igsioFieldMapType* customFields = NULL);
+
+  /*! Release the frame that was previously acquired by AcquireWritableFrame without adding it to the buffer */
+  virtual void ReleaseWritableFrame();
+
+  /*!
+    Add a frame that is stored in GPU memory. The pixel data is read back into the buffer only when the item
+    is requested by GetStreamBufferItem or GetStreamBufferItemView (or any method that uses them).
+    The frame must have the size, pixel type and orientation of the buffer.
+  */
+  virtual PlusStatus AddGpuItem(const PlusGpuFramePtr& gpuFrame,
+                                long frameNumber,
+                                double unfilteredTimestamp = UNDEFINED_TIMESTAMP,
+                                double filteredTimestamp = UNDEFINED_TIMESTAMP,
+                                const igsioFieldMapType* customFields = NULL);
+
+  /*! Get the GPU frame of an item without reading it back to host memory. gpuFrame is nullptr if the item has no GPU frame. */
+  virtual ItemStatus GetGpuFrame(BufferItemUidType uid, PlusGpuFramePtr& gpuFrame);
+
+  /*!
+    Set the compressed bitstream that the next video frame is decoded from. It is stored in the item of the next frame
+    that is added by AddItem or CommitWritableFrame (or dropped if that frame is not added).
+    Must be called by the thread that adds the frames, right before the frame is added.
+  */
+  virtual void SetNextItemSourceBitstream(const StreamBufferItem::SourceBitstreamPtr& sourceBitstream);
+
+  /*! Get the source bitstream of an item without copying the frame. sourceBitstream is nullptr if the item has no source bitstream. */
+  virtual ItemStatus GetSourceBitstream(BufferItemUidType uid, StreamBufferItem::SourceBitstreamPtr& sourceBitstream);
+
   /*!
     Add a matrix plus status to the list, with an exactly known timestamp value (e.g., provided by a high-precision hardware timer).
     If the timestamp is less than or equal to the previous timestamp, then nothing  will be done.
@@ -151,8 +237,29 @@ public:
   */
   PlusStatus AddTimeStampedItem(vtkMatrix4x4* matrix, ToolStatus status, unsigned long frameNumber, double unfilteredTimestamp, double filteredTimestamp = UNDEFINED_TIMESTAMP, const igsioFieldMapType* customFields = NULL);
 
+  /*!
+    Add several matrix plus status samples to the list, in the order of the vector. The samples get consecutive frame numbers starting from firstFrameNumber.
+    Same as calling AddTimeStampedItem for each sample, but the buffer is locked and the new data events are signaled only once.
+    Samples that cannot be added (e.g., their timestamp is not newer than the previous one) are skipped.
+  */
+  PlusStatus AddTimeStampedItems(const std::vector<ToolSample>& samples, unsigned long firstFrameNumber);
+
   /*! Get a frame with the specified frame uid from the buffer */
   virtual ItemStatus GetStreamBufferItem(BufferItemUidType uid, StreamBufferItem* bufferItem);
+  /*!
+    Get a frame with the specified frame uid from the buffer without copying the pixel data.
+    The returned item shares the pixel data with the buffer and must be treated as read-only.
+    The buffer allocates new pixel data for a slot before it overwrites a frame that is still referenced by a view.
+  */
+  virtual ItemStatus GetStreamBufferItemView(BufferItemUidType uid, StreamBufferItem* bufferItem);
+  /*!
+    Register a snapshot of the current item range. The items of the range remain readable by GetSnapshotStreamBufferItem
+    until the snapshot is unregistered, even if they are overwritten in the buffer meanwhile. Use PlusBufferSnapshot instead of calling these directly.
+  */
+  virtual void RegisterSnapshot(BufferSnapshotItems* snapshotItems);
+  virtual void UnregisterSnapshot(BufferSnapshotItems* snapshotItems);
+  /*! Get a copy of an item of a registered snapshot */
+  virtual ItemStatus GetSnapshotStreamBufferItem(BufferSnapshotItems* snapshotItems, BufferItemUidType uid, StreamBufferItem* bufferItem);
   /*! Get the most recent frame from the buffer */
   virtual ItemStatus GetLatestStreamBufferItem(StreamBufferItem* bufferItem)
   {
@@ -165,6 +272,27 @@ public:
   };
   /*! Get a frame that was acquired at the specified time from buffer */
   virtual ItemStatus GetStreamBufferItemFromTime(double time, StreamBufferItem* bufferItem, DataItemTemporalInterpolationType interpolation);
+  /*!
+    Get an item interpolated at the specified time, same as GetStreamBufferItemFromTime with INTERPOLATED, but the closest item
+    to the requested time is already known. Used when several buffers store items of the same acquisition times, so that the
+    closest item is only searched in one of them.
+  */
+  virtual ItemStatus GetInterpolatedStreamBufferItemFromClosestUid(double time, BufferItemUidType closestItemUid, StreamBufferItem* bufferItem);
+
+  /*! Transform of a buffer item, see GetTransformSample */
+  struct TransformSample
+  {
+    /*! Matrix elements in row-major order */
+    double Matrix[16];
+    ToolStatus Status;
+    /*! Filtered timestamp in local time */
+    double FilteredTimestamp;
+  };
+  /*!
+    Read the transform of an item without copying the whole item.
+    If frameFields is not NULL then the custom frame fields of the item are copied into it.
+  */
+  virtual ItemStatus GetTransformSample(BufferItemUidType uid, TransformSample& sample, igsioFieldMapType* frameFields = NULL);
   virtual PlusStatus ModifyBufferItemFrameField(BufferItemUidType uid, const std::string& key, const std::string& value);
 
   /*! Get latest timestamp in the buffer */
@@ -176,6 +304,12 @@ public:
   /*! Get buffer item timestamp */
   virtual ItemStatus GetTimeStamp(BufferItemUidType uid, double& timestamp);
 
+  /*!
+    Get the UIDs and timestamps of the items from firstUid to lastUid that are in the buffer, with the buffer locked only once
+    (see vtkPlusTimestampedCircularBuffer::GetItemTimeStamps)
+  */
+  virtual void GetItemTimeStamps(BufferItemUidType firstUid, BufferItemUidType lastUid, std::vector<BufferItemUidType>& uids, std::vector<double>& timestamps);
+
   /*! Returns true if the latest item contains valid video data */
   virtual bool GetLatestItemHasValidVideoData();
 
@@ -271,6 +405,51 @@ public:
   /*! If TimeStampReporting is enabled then all filtered and unfiltered timestamp values will be saved in a table for diagnostic purposes. */
   bool GetTimeStampReporting();
 
+  /*! Limit the number of rows of the timestamp report table (see vtkPlusTimestampedCircularBuffer::SetTimeStampReportMaximumNumberOfRows) */
+  void SetTimeStampReportMaximumNumberOfRows(unsigned int maximumNumberOfRows);
+  unsigned int GetTimeStampReportMaximumNumberOfRows();
+
+  /*! Write all timestamp report items to a CSV file (see vtkPlusTimestampedCircularBuffer::SetTimeStampReportFilename) */
+  PlusStatus SetTimeStampReportFilename(const std::string& filename);
+  std::string GetTimeStampReportFilename();
+
+  /*! Get the rolling frame period and jitter statistics of the timestamp report */
+  TimeStampReportStatistics GetTimeStampReportStatistics();
+
+  /*! If enabled then item UID and timestamp queries do not lock the buffer (see vtkPlusTimestampedCircularBuffer::SetLockFreeReadEnabled) */
+  void SetLockFreeReadEnabled(bool enable);
+  /*! If enabled then item UID and timestamp queries do not lock the buffer (see vtkPlusTimestampedCircularBuffer::SetLockFreeReadEnabled) */
+  bool GetLockFreeReadEnabled();
+
+  /*!
+    If enabled then tracking items are stored in a contiguous array of compact pose items instead of StreamBufferItem
+    objects (see vtkPlusTimestampedCircularBuffer::SetCompactPoseStorage). Items are converted to StreamBufferItem
+    only when they are retrieved. Video frames and custom frame fields cannot be stored in the buffer then.
+    Can only be changed while the buffer is empty.
+  */
+  PlusStatus SetCompactPoseStorage(bool enable);
+  bool GetCompactPoseStorage();
+
+  /*!
+    If positive then the pixel data of video items that are older than this time (relative to the latest item) is
+    compressed in the background, on the shared worker pool, to reduce the memory usage of long buffers.
+    Compressed items are decompressed when they are retrieved. 0 disables the compression (default).
+  */
+  vtkSetMacro(CompressItemsOlderThanSec, double);
+  vtkGetMacro(CompressItemsOlderThanSec, double);
+
+  /*!
+    Compress the video items that are older than CompressItemsOlderThanSec on the calling thread. Each item is checked
+    only once. The buffer is only locked while the items are selected and while the compressed data is stored.
+    Returns the number of compressed items.
+  */
+  int CompressAgedItems();
+
+  /*! Register an event that is signaled each time a new item is added to the buffer */
+  void AddNewDataEvent(std::shared_ptr<PlusNewDataEvent> newDataEvent);
+  /*! Unregister an event that was registered with AddNewDataEvent */
+  void RemoveNewDataEvent(std::shared_ptr<PlusNewDataEvent> newDataEvent);
+
   /*! Set the frame size in pixel  */
   PlusStatus SetFrameSize(unsigned int x, unsigned int y, unsigned int z, bool allocateFrames = true);
   /*! Set the frame size in pixel  */
@@ -330,8 +509,31 @@ protected:
   */
   virtual bool CheckFrameFormat(const FrameSizeType& frameSizeInPx, igsioCommon::VTKScalarPixelType pixelType, US_IMAGE_TYPE imgType, int numberOfScalarComponents);
 
+  /*!
+    Replaces the pixel data of a buffer frame with a newly allocated array if the current pixel data
+    is still shared with a view obtained by GetStreamBufferItemView. Must be called before writing into a buffer frame.
+  */
+  void DetachSharedFrameData(igsioVideoFrame& frame);
+
+  /*! Commit the reserved item, optionally with a GPU frame. The caller must not hold the buffer lock. */
+  PlusStatus CommitReservedFrame(long frameNumber, double unfilteredTimestamp, double filteredTimestamp, const igsioFieldMapType* customFields, const PlusGpuFramePtr& gpuFrame);
+
+  /*! Write a tracker item into the next slot of the buffer. The caller must have locked the buffer and computed the filtered timestamp. */
+  PlusStatus WriteTimeStampedItem(vtkMatrix4x4* matrix, ToolStatus status, unsigned long frameNumber, double unfilteredTimestamp, double filteredTimestamp, const igsioFieldMapType* customFields);
+
+  /*! Signal all registered new data events. The caller must have locked the buffer. */
+  void SignalNewDataEvents();
+
+  /*! Start compressing the aged video items on the shared worker pool, unless compression is disabled or already in progress */
+  void ScheduleAgedItemCompression();
+
+  /*! Fill a buffer item from a compact pose item. The video frame of the buffer item is not changed. */
+  static void CopyCompactPoseItem(const CompactPoseItem& compactItem, BufferItemUidType uid, StreamBufferItem* bufferItem);
+
   /*! Returns the two buffer items that are closest previous and next buffer items relative to the specified time. itemA is the closest item */
   PlusStatus GetPrevNextBufferItemFromTime(double time, StreamBufferItem& itemA, StreamBufferItem& itemB);
+  /*! Same as GetPrevNextBufferItemFromTime, with the UID of itemA (the closest item) already known */
+  PlusStatus GetPrevNextBufferItemFromClosestUid(double time, BufferItemUidType itemAuid, StreamBufferItem& itemA, StreamBufferItem& itemB);
 
   /*!
   Interpolate the matrix for the given timestamp from the two nearest transforms in the buffer.
@@ -371,6 +573,25 @@ protected:
 
   char* DescriptiveName;
 
+  /*! True if custom fields were not stored because of compact pose storage, to report it only once */
+  bool CompactPoseFieldsDropped;
+
+  /*! Time span of data that the buffer should hold in seconds, 0 if the buffer size is fixed */
+  double BufferDurationSec;
+
+  /*! Events that are signaled when a new item is added, protected by the buffer lock */
+  std::vector<std::shared_ptr<PlusNewDataEvent> > NewDataEvents;
+
+  /*! Age of video items in seconds after which their pixel data is compressed, 0 if items are not compressed */
+  double CompressItemsOlderThanSec;
+  /*! UID of the latest item that has been checked for compression, protected by the buffer lock */
+  BufferItemUidType LastCompressionCheckedUid;
+  /*! True while a background compression task is scheduled or running */
+  std::atomic<bool> AgedItemCompressionScheduled;
+
+  /*! Source bitstream of the next video frame, only accessed by the thread that adds the frames */
+  StreamBufferItem::SourceBitstreamPtr PendingSourceBitstream;
+
 private:
   vtkPlusBuffer(const vtkPlusBuffer&);
   void operator=(const vtkPlusBuffer&);
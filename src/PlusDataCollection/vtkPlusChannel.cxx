@@ -6,13 +6,18 @@ See License.txt for details.
 
 // Local includes
 #include "PlusConfigure.h"
+#include "PlusProfiler.h"
+#include "PlusToolPoseBatch.h"
+#include "PlusTrackedFrameAssembly.h"
 #ifdef PLUS_RENDERING_ENABLED
 #include "PlusPlotter.h"
+#include "PlusWorkerPool.h"
 #endif
 #include "vtkPlusBuffer.h"
 #include "vtkPlusChannel.h"
 #include "vtkPlusDataSource.h"
 #include "vtkPlusHTMLGenerator.h"
+#include "vtkIGSIOAccurateTimer.h"
 #include "vtkIGSIOTrackedFrameList.h"
 
 // VTK includes
@@ -21,6 +26,12 @@ See License.txt for details.
 #include <vtkObjectFactory.h>
 #include <vtkTable.h>
 
+// STL includes
+#include <algorithm>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
 //----------------------------------------------------------------------------
 
 vtkStandardNewMacro(vtkPlusChannel);
@@ -31,6 +42,12 @@ vtkStandardNewMacro(vtkPlusChannel);
 // This time should be long enough to comfortably retrieve a frame from the buffer.
 static const double SAMPLING_SKIPPING_MARGIN_SEC = 0.1;
 
+// Timestamps that differ less than this are considered to be the same acquisition time
+static const double NEGLIGIBLE_TIME_DIFFERENCE_SEC = 0.00001;
+
+// Default minimum time between two reports of failed tracked frame lookups
+static const double DEFAULT_FRAME_MISS_REPORT_INTERVAL_SEC = 5.0;
+
 //----------------------------------------------------------------------------
 vtkPlusChannel::vtkPlusChannel(void)
   : VideoSource(NULL)
@@ -39,7 +56,12 @@ vtkPlusChannel::vtkPlusChannel(void)
   , RfProcessor(NULL)
   , BlankImage(vtkImageData::New())
   , SaveRfProcessingParameters(false)
+  , ForwardedChannel(NULL)
+  , FrameMissReportIntervalSec(DEFAULT_FRAME_MISS_REPORT_INTERVAL_SEC)
+  , LastFrameMissReportTime(-std::numeric_limits<double>::max())
 {
+  this->ResetFrameMissCounters();
+
   // Default size for brightness frame
   this->BrightnessFrameSize[0] = 640;
   this->BrightnessFrameSize[1] = 480;
@@ -128,6 +150,9 @@ PlusStatus vtkPlusChannel::ReadConfiguration(vtkXMLDataElement* aChannelElement,
     }
   }
 
+  this->ToolJoinPlan.clear();
+  this->UpdateToolFieldNames();
+
   if (aChannelElement->GetAttribute("VideoDataSourceId") != NULL && this->OwnerDevice->GetVideoSource(aChannelElement->GetAttribute("VideoDataSourceId"), aSource) == PLUS_SUCCESS)
   {
     this->VideoSource = aSource;
@@ -138,6 +163,8 @@ PlusStatus vtkPlusChannel::ReadConfiguration(vtkXMLDataElement* aChannelElement,
     return PLUS_FAIL;
   }
 
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, FrameMissReportIntervalSec, aChannelElement);
+
   vtkXMLDataElement* rfElement = aChannelElement->FindNestedElementWithName(vtkPlusRfProcessor::GetRfProcessorTagName());
   if (rfElement != NULL)
   {
@@ -294,6 +321,8 @@ PlusStatus vtkPlusChannel::AddTool(vtkPlusDataSource* aTool)
 
   this->Tools[aTool->GetId()] = aTool;
   this->Tools[aTool->GetId()]->Register(this);
+  this->ToolJoinPlan.clear();
+  this->UpdateToolFieldNames();
 
   if (this->TimestampMasterTool == NULL)
   {
@@ -319,6 +348,8 @@ PlusStatus vtkPlusChannel::RemoveTool(const std::string& toolSourceId)
     if (it->second->GetId() == toolSourceId)
     {
       this->Tools.erase(it);
+      this->ToolJoinPlan.clear();
+      this->UpdateToolFieldNames();
       if (this->TimestampMasterTool == it->second)
       {
         // the master tool has been deleted
@@ -335,10 +366,76 @@ PlusStatus vtkPlusChannel::RemoveTool(const std::string& toolSourceId)
 PlusStatus vtkPlusChannel::RemoveTools()
 {
   this->Tools.clear();
+  this->ToolJoinPlan.clear();
+  this->UpdateToolFieldNames();
 
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+void vtkPlusChannel::UpdateToolJoinPlan()
+{
+  this->ToolJoinPlan.clear();
+  for (DataSourceContainerConstIterator it = this->Tools.begin(); it != this->Tools.end(); ++it)
+  {
+    vtkPlusDataSource* aTool = it->second;
+
+    // Tools of the same device with the same time offset are recorded at the same times
+    std::vector<ToolJoinGroup>::iterator group = this->ToolJoinPlan.begin();
+    for (; group != this->ToolJoinPlan.end(); ++group)
+    {
+      vtkPlusDataSource* firstTool = group->Tools[0];
+      if (firstTool->GetDevice() != NULL && firstTool->GetDevice() == aTool->GetDevice()
+          && firstTool->GetLocalTimeOffsetSec() == aTool->GetLocalTimeOffsetSec())
+      {
+        break;
+      }
+    }
+    if (group == this->ToolJoinPlan.end())
+    {
+      group = this->ToolJoinPlan.insert(this->ToolJoinPlan.end(), ToolJoinGroup());
+    }
+    group->Tools.push_back(aTool);
+    group->FieldNames.push_back(CreateToolFieldNames(aTool));
+  }
+  LOG_DEBUG("Tool join plan of channel " << (this->ChannelId ? this->ChannelId : "(unknown)") << ": " << this->Tools.size() << " tools in " << this->ToolJoinPlan.size() << " groups");
+}
+
+//----------------------------------------------------------------------------
+vtkPlusChannel::ToolFieldNames vtkPlusChannel::CreateToolFieldNames(vtkPlusDataSource* aTool)
+{
+  ToolFieldNames names;
+  names.Tool = aTool;
+  names.TransformName = igsioTransformName(aTool->GetId());
+  if (names.TransformName.IsValid())
+  {
+    names.TransformFieldName = names.TransformName.GetTransformName() + "Transform";
+    names.TransformStatusFieldName = names.TransformFieldName + "Status";
+  }
+  return names;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusChannel::UpdateToolFieldNames()
+{
+  this->ToolFieldNameList.clear();
+  for (DataSourceContainerConstIterator it = this->Tools.begin(); it != this->Tools.end(); ++it)
+  {
+    this->ToolFieldNameList.push_back(CreateToolFieldNames(it->second));
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusChannel::GetToolStatusSnapshot(std::vector<ToolStatusSnapshot>& snapshot) const
+{
+  snapshot.resize(this->ToolFieldNameList.size());
+  for (std::size_t i = 0; i < this->ToolFieldNameList.size(); ++i)
+  {
+    snapshot[i].TransformName = this->ToolFieldNameList[i].TransformName;
+    snapshot[i].Status = this->ToolFieldNameList[i].Tool->GetLatestToolStatus(&snapshot[i].Timestamp);
+  }
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusChannel::AddFieldDataSource(vtkPlusDataSource* aSource)
 {
@@ -435,6 +532,11 @@ PlusStatus vtkPlusChannel::Clear()
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusChannel::GetLatestTimestamp(double& aTimestamp) const
 {
+  vtkPlusChannel* forwardedChannel = this->ForwardedChannel.load();
+  if (forwardedChannel != NULL)
+  {
+    return forwardedChannel->GetLatestTimestamp(aTimestamp);
+  }
   aTimestamp = 0;
 
   if (this->HasVideoSource())
@@ -526,9 +628,38 @@ void vtkPlusChannel::SetVideoSource(vtkPlusDataSource* aSource)
   this->VideoSource = aSource;
 }
 
+//----------------------------------------------------------------------------
+void vtkPlusChannel::SetForwardedChannel(vtkPlusChannel* aChannel)
+{
+  if (aChannel == this)
+  {
+    LOG_ERROR("A channel cannot forward its data queries to itself: " << (this->ChannelId ? this->ChannelId : "(unknown)"));
+    return;
+  }
+  this->ForwardedChannel.store(aChannel);
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusChannel::GetTrackedFrame(double timestamp, igsioTrackedFrame& aTrackedFrame, bool enableImageData/*=true*/)
 {
+  return this->GetTrackedFrameInternal(timestamp, aTrackedFrame, enableImageData, false);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusChannel::GetTrackedFrameView(double timestamp, igsioTrackedFrame& aTrackedFrame, bool enableImageData/*=true*/)
+{
+  return this->GetTrackedFrameInternal(timestamp, aTrackedFrame, enableImageData, true);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusChannel::GetTrackedFrameInternal(double timestamp, igsioTrackedFrame& aTrackedFrame, bool enableImageData, bool shareImageData)
+{
+  PLUS_PROFILE_ZONE("vtkPlusChannel::GetTrackedFrame");
+  vtkPlusChannel* forwardedChannel = this->ForwardedChannel.load();
+  if (forwardedChannel != NULL)
+  {
+    return forwardedChannel->GetTrackedFrameInternal(timestamp, aTrackedFrame, enableImageData, shareImageData);
+  }
   int numberOfErrors(0);
   double synchronizedTimestamp(0);
 
@@ -537,41 +668,64 @@ PlusStatus vtkPlusChannel::GetTrackedFrame(double timestamp, igsioTrackedFrame&
   {
     if (this->VideoSource->GetNumberOfItems() < 1)
     {
-      LOG_ERROR("Couldn't get tracked frame from video source, frames are not available yet");
+      if (this->CountFrameMiss(FRAME_MISS_VIDEO_NOT_AVAILABLE_YET))
+      {
+        LOG_ERROR("Couldn't get tracked frame from video source, frames are not available yet");
+      }
       return PLUS_FAIL;
     }
     BufferItemUidType frameUID = 0;
     ItemStatus status = this->VideoSource->GetItemUidFromTime(timestamp, frameUID);
     if (status != ITEM_OK)
     {
-      if (status == ITEM_NOT_AVAILABLE_ANYMORE)
-      {
-        LOG_ERROR("Couldn't get frame UID from time (" << std::fixed << timestamp <<
-                  ") - item not available anymore!");
-      }
-      else if (status == ITEM_NOT_AVAILABLE_YET)
-      {
-        LOG_ERROR("Couldn't get frame UID from time (" << std::fixed << timestamp <<
-                  ") - item not available yet!");
-      }
-      else
+      if (this->CountFrameMiss(GetFrameMissReason(status, true)))
       {
-        LOG_ERROR("Couldn't get frame UID from time (" << std::fixed << timestamp << ")!");
+        if (status == ITEM_NOT_AVAILABLE_ANYMORE)
+        {
+          LOG_ERROR("Couldn't get frame UID from time (" << std::fixed << timestamp <<
+                    ") - item not available anymore!");
+        }
+        else if (status == ITEM_NOT_AVAILABLE_YET)
+        {
+          LOG_ERROR("Couldn't get frame UID from time (" << std::fixed << timestamp <<
+                    ") - item not available yet!");
+        }
+        else
+        {
+          LOG_ERROR("Couldn't get frame UID from time (" << std::fixed << timestamp << ")!");
+        }
       }
 
       return PLUS_FAIL;
     }
 
+    // The item shares the pixel data with the buffer, so that the frame is copied at most once
     StreamBufferItem CurrentStreamBufferItem;
-    if (this->VideoSource->GetStreamBufferItem(frameUID, &CurrentStreamBufferItem) != ITEM_OK)
+    if (this->VideoSource->GetStreamBufferItemView(frameUID, &CurrentStreamBufferItem) != ITEM_OK)
     {
-      LOG_ERROR("Couldn't get video buffer item by frame UID: " << frameUID);
+      if (this->CountFrameMiss(FRAME_MISS_VIDEO_ITEM))
+      {
+        LOG_ERROR("Couldn't get video buffer item by frame UID: " << frameUID);
+      }
       return PLUS_FAIL;
     }
 
-    // Copy frame
-    igsioVideoFrame frame = CurrentStreamBufferItem.GetFrame();
-    aTrackedFrame.SetImageData(frame);
+    if (shareImageData)
+    {
+      if (StreamBufferItem::ShallowCopyFrame(CurrentStreamBufferItem.GetFrame(), *aTrackedFrame.GetImageData()) != PLUS_SUCCESS)
+      {
+        if (this->CountFrameMiss(FRAME_MISS_VIDEO_ITEM))
+        {
+          LOG_ERROR("Couldn't share video buffer item image data for frame UID: " << frameUID);
+        }
+        return PLUS_FAIL;
+      }
+    }
+    else
+    {
+      // Copy frame
+      aTrackedFrame.SetImageData(CurrentStreamBufferItem.GetFrame());
+    }
 
     // Copy all custom fields
     igsioFieldMapType fieldMap = CurrentStreamBufferItem.GetFrameFieldMap();
@@ -591,119 +745,314 @@ PlusStatus vtkPlusChannel::GetTrackedFrame(double timestamp, igsioTrackedFrame&
   // Add main tool timestamp
   aTrackedFrame.SetTimestamp(synchronizedTimestamp);
 
-  for (DataSourceContainerConstIterator it = this->GetToolsStartIterator(); it != this->GetToolsEndIterator(); ++it)
+  numberOfErrors += this->AddToolTransforms(synchronizedTimestamp, aTrackedFrame);
+
+  for (DataSourceContainerConstIterator it = this->GetFieldDataSourcesStartIterator(); it != this->GetFieldDataSourcesEndIterator(); ++it)
   {
-    vtkPlusDataSource* aTool = it->second;
-    igsioTransformName toolTransformName(aTool->GetId());
-    if (!toolTransformName.IsValid())
-    {
-      LOG_ERROR("Tool transform name is invalid!");
-      numberOfErrors++;
-      continue;
-    }
+    vtkPlusDataSource* aSource = it->second;
 
     StreamBufferItem bufferItem;
-    ItemStatus result = aTool->GetStreamBufferItemFromTime(synchronizedTimestamp, &bufferItem, vtkPlusBuffer::INTERPOLATED);
+    ItemStatus result = aSource->GetStreamBufferItemFromTime(synchronizedTimestamp, &bufferItem, vtkPlusBuffer::CLOSEST_TIME);
     if (result != ITEM_OK)
     {
+      numberOfErrors++;
+      if (!this->CountFrameMiss(GetFrameMissReason(result, false)))
+      {
+        continue;
+      }
+
       double latestTimestamp(0);
-      if (aTool->GetLatestTimeStamp(latestTimestamp) != ITEM_OK)
+      if (aSource->GetLatestTimeStamp(latestTimestamp) != ITEM_OK)
       {
         LOG_ERROR("Failed to get latest timestamp!");
-        numberOfErrors++;
       }
 
       double oldestTimestamp(0);
-      if (aTool->GetOldestTimeStamp(oldestTimestamp) != ITEM_OK)
+      if (aSource->GetOldestTimeStamp(oldestTimestamp) != ITEM_OK)
       {
         LOG_ERROR("Failed to get oldest timestamp!");
-        numberOfErrors++;
       }
 
-      LOG_ERROR(aTool->GetId() << ": Failed to get tracker item from buffer by time: " << std::fixed << synchronizedTimestamp << " (Latest timestamp: " << latestTimestamp << "   Oldest timestamp: " << oldestTimestamp << ").");
-      numberOfErrors++;
+      LOG_ERROR(aSource->GetId() << ": Failed to get tracker item from buffer by time: " << std::fixed << synchronizedTimestamp << " (Latest timestamp: " << latestTimestamp << "   Oldest timestamp: " << oldestTimestamp << ").");
       continue;
     }
 
-    vtkSmartPointer<vtkMatrix4x4> dMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
-    if (bufferItem.GetMatrix(dMatrix) != PLUS_SUCCESS)
+    // Copy all custom fields
+    igsioFieldMapType fieldMap = bufferItem.GetFrameFieldMap();
+    for (igsioFieldMapType::const_iterator fieldIterator = fieldMap.begin(); fieldIterator != fieldMap.end(); fieldIterator++)
     {
-      LOG_ERROR("Failed to get matrix from buffer item for tool " << aTool->GetId());
-      numberOfErrors++;
-      continue;
+      aTrackedFrame.SetFrameField(fieldIterator->first, fieldIterator->second.second, fieldIterator->second.first);
+    }
+
+    synchronizedTimestamp = bufferItem.GetTimestamp(aSource->GetLocalTimeOffsetSec());
+  }
+
+  // Copy frame timestamp
+  aTrackedFrame.SetTimestamp(synchronizedTimestamp);
+
+  return (numberOfErrors == 0 ? PLUS_SUCCESS : PLUS_FAIL);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusChannel::GetToolTransformsAtTime(double timestamp, igsioTrackedFrame& trackedFrame)
+{
+  vtkPlusChannel* forwardedChannel = this->ForwardedChannel.load();
+  if (forwardedChannel != NULL)
+  {
+    return forwardedChannel->GetToolTransformsAtTime(timestamp, trackedFrame);
+  }
+  double synchronizedTimestamp = timestamp;
+  return (this->AddToolTransforms(synchronizedTimestamp, trackedFrame) == 0 ? PLUS_SUCCESS : PLUS_FAIL);
+}
+
+//----------------------------------------------------------------------------
+int vtkPlusChannel::AddToolTransforms(double& synchronizedTimestamp, igsioTrackedFrame& aTrackedFrame)
+{
+  int numberOfErrors(0);
+  std::ostringstream fieldValue;
+
+  if (this->ToolJoinPlan.empty())
+  {
+    for (std::vector<ToolFieldNames>::const_iterator names = this->ToolFieldNameList.begin(); names != this->ToolFieldNameList.end(); ++names)
+    {
+      StreamBufferItem bufferItem;
+      ItemStatus result = ITEM_UNKNOWN_ERROR;
+      if (names->TransformName.IsValid())
+      {
+        result = names->Tool->GetStreamBufferItemFromTime(synchronizedTimestamp, &bufferItem, vtkPlusBuffer::INTERPOLATED);
+      }
+      numberOfErrors += this->SetToolTransformFromBufferItem(*names, result, bufferItem, synchronizedTimestamp, fieldValue, aTrackedFrame);
     }
+    return numberOfErrors;
+  }
+
+  PlusToolPoseBatch poseBatch;
+  for (std::vector<ToolJoinGroup>::const_iterator group = this->ToolJoinPlan.begin(); group != this->ToolJoinPlan.end(); ++group)
+  {
+    numberOfErrors += this->AddToolGroupTransforms(*group, synchronizedTimestamp, poseBatch, fieldValue, aTrackedFrame);
+  }
+  return numberOfErrors;
+}
+
+//----------------------------------------------------------------------------
+int vtkPlusChannel::AddToolGroupTransforms(const ToolJoinGroup& group, double& synchronizedTimestamp, PlusToolPoseBatch& poseBatch, std::ostringstream& fieldValue, igsioTrackedFrame& aTrackedFrame)
+{
+  // Same cases as in vtkPlusBuffer::GetInterpolatedStreamBufferItemFromTime
+  enum SampleType
+  {
+    SAMPLE_CLOSEST,                   // the closest item is at the requested time
+    SAMPLE_CLOSEST_AT_REQUESTED_TIME, // the two items around the requested time have the same timestamp
+    SAMPLE_INTERPOLATED,              // interpolated between the two items around the requested time
+    SAMPLE_MISSING                    // the closest item, interpolation is not possible
+  };
+
+  int numberOfErrors(0);
+  const double requestedTimestamp = synchronizedTimestamp;
+  vtkPlusDataSource* firstTool = group.Tools[0];
+  const double localTimeOffsetSec = firstTool->GetLocalTimeOffsetSec();
 
-    if (aTrackedFrame.SetFrameTransform(toolTransformName, dMatrix) != PLUS_SUCCESS)
+  // The items around the requested time and the interpolation weight are determined once for the whole group, in the buffer of the first tool
+  BufferItemUidType itemAuid(0);
+  BufferItemUidType itemBuid(0);
+  double itemAtime(0);
+  double itemBtime(0);
+  double itemBweight(0);
+  const bool groupItemsFound = firstTool->GetItemUidFromTime(requestedTimestamp, itemAuid) == ITEM_OK
+                               && firstTool->GetTimeStamp(itemAuid, itemAtime) == ITEM_OK;
+  SampleType groupSampleType = SAMPLE_MISSING;
+  if (groupItemsFound)
+  {
+    const double maxAllowedTimeDifference = firstTool->GetMaxAllowedTimeDifference();
+    if (fabs(itemAtime - requestedTimestamp) < NEGLIGIBLE_TIME_DIFFERENCE_SEC)
     {
-      LOG_ERROR("Failed to set transform for tool " << aTool->GetId());
-      numberOfErrors++;
-      continue;
+      groupSampleType = SAMPLE_CLOSEST;
+    }
+    else if (fabs(itemAtime - requestedTimestamp) <= maxAllowedTimeDifference)
+    {
+      itemBuid = (requestedTimestamp < itemAtime) ? itemAuid - 1 : itemAuid + 1;
+      if (firstTool->GetTimeStamp(itemBuid, itemBtime) == ITEM_OK && fabs(itemBtime - requestedTimestamp) <= maxAllowedTimeDifference)
+      {
+        if (fabs(itemAtime - itemBtime) < NEGLIGIBLE_TIME_DIFFERENCE_SEC)
+        {
+          groupSampleType = SAMPLE_CLOSEST_AT_REQUESTED_TIME;
+        }
+        else
+        {
+          groupSampleType = SAMPLE_INTERPOLATED;
+          itemBweight = 1.0 - fabs(itemBtime - requestedTimestamp) / fabs(itemAtime - itemBtime);
+        }
+      }
     }
+  }
 
-    if (aTrackedFrame.SetFrameTransformStatus(toolTransformName, bufferItem.GetStatus()) != PLUS_SUCCESS)
+  // Tools that are interpolated together after all the other tools of the group are processed
+  poseBatch.Clear();
+  std::vector<size_t> batchToolIndices;
+
+  for (size_t toolIndex = 0; toolIndex < group.Tools.size(); ++toolIndex)
+  {
+    vtkPlusDataSource* aTool = group.Tools[toolIndex];
+    const ToolFieldNames& toolFieldNames = group.FieldNames[toolIndex];
+    if (!toolFieldNames.TransformName.IsValid())
     {
-      LOG_ERROR("Failed to set transform status for tool " << aTool->GetId());
+      LOG_ERROR("Tool transform name is invalid!");
       numberOfErrors++;
       continue;
     }
 
-    // Copy all custom fields
-    igsioFieldMapType fieldMap = bufferItem.GetFrameFieldMap();
-    igsioFieldMapType::iterator fieldIterator;
-    for (igsioFieldMapType::const_iterator fieldIterator = fieldMap.begin(); fieldIterator != fieldMap.end(); fieldIterator++)
+    // The items of the first tool are used if the tool has items with the same UIDs and timestamps
+    vtkPlusBuffer::TransformSample sampleA;
+    vtkPlusBuffer::TransformSample sampleB;
+    igsioFieldMapType frameFields;
+    SampleType sampleType = groupSampleType;
+    bool inSync = groupItemsFound && aTool->GetTransformSample(itemAuid, sampleA, &frameFields) == ITEM_OK
+                  && fabs(sampleA.FilteredTimestamp + localTimeOffsetSec - itemAtime) < NEGLIGIBLE_TIME_DIFFERENCE_SEC;
+    if (inSync && sampleA.Status != TOOL_OK)
     {
-      aTrackedFrame.SetFrameField(fieldIterator->first, fieldIterator->second.second, fieldIterator->second.first);
+      sampleType = SAMPLE_MISSING;
+    }
+    if (inSync && (sampleType == SAMPLE_CLOSEST_AT_REQUESTED_TIME || sampleType == SAMPLE_INTERPOLATED))
+    {
+      inSync = aTool->GetTransformSample(itemBuid, sampleB) == ITEM_OK
+               && fabs(sampleB.FilteredTimestamp + localTimeOffsetSec - itemBtime) < NEGLIGIBLE_TIME_DIFFERENCE_SEC;
+      if (inSync && sampleB.Status != TOOL_OK)
+      {
+        sampleType = SAMPLE_MISSING;
+      }
+    }
+    if (!inSync)
+    {
+      // The buffer of this tool is not in sync with the first tool of the group
+      StreamBufferItem bufferItem;
+      ItemStatus result = aTool->GetStreamBufferItemFromTime(requestedTimestamp, &bufferItem, vtkPlusBuffer::INTERPOLATED);
+      numberOfErrors += this->SetToolTransformFromBufferItem(toolFieldNames, result, bufferItem, synchronizedTimestamp, fieldValue, aTrackedFrame);
+      continue;
     }
 
-    synchronizedTimestamp = bufferItem.GetTimestamp(aTool->GetLocalTimeOffsetSec());
+    switch (sampleType)
+    {
+      case SAMPLE_CLOSEST:
+        numberOfErrors += this->SetToolTransform(toolFieldNames, sampleA.Matrix, sampleA.Status, &frameFields, fieldValue, aTrackedFrame);
+        synchronizedTimestamp = sampleA.FilteredTimestamp + localTimeOffsetSec;
+        break;
+      case SAMPLE_CLOSEST_AT_REQUESTED_TIME:
+        numberOfErrors += this->SetToolTransform(toolFieldNames, sampleA.Matrix, sampleA.Status, &frameFields, fieldValue, aTrackedFrame);
+        synchronizedTimestamp = requestedTimestamp + localTimeOffsetSec;
+        break;
+      case SAMPLE_INTERPOLATED:
+        // The transform is set after the whole group is interpolated
+        poseBatch.AddPoses(sampleA.Matrix, sampleB.Matrix);
+        batchToolIndices.push_back(toolIndex);
+        for (igsioFieldMapType::const_iterator fieldIterator = frameFields.begin(); fieldIterator != frameFields.end(); fieldIterator++)
+        {
+          aTrackedFrame.SetFrameField(fieldIterator->first, fieldIterator->second.second, fieldIterator->second.first);
+        }
+        synchronizedTimestamp = requestedTimestamp;
+        break;
+      case SAMPLE_MISSING:
+      default:
+        numberOfErrors += this->SetToolTransform(toolFieldNames, sampleA.Matrix, TOOL_MISSING, &frameFields, fieldValue, aTrackedFrame);
+        synchronizedTimestamp = requestedTimestamp + localTimeOffsetSec;
+        break;
+    }
   }
 
-  for (DataSourceContainerConstIterator it = this->GetFieldDataSourcesStartIterator(); it != this->GetFieldDataSourcesEndIterator(); ++it)
+  if (poseBatch.GetNumberOfPoses() > 0)
   {
-    vtkPlusDataSource* aSource = it->second;
-
-    StreamBufferItem bufferItem;
-    ItemStatus result = aSource->GetStreamBufferItemFromTime(synchronizedTimestamp, &bufferItem, vtkPlusBuffer::CLOSEST_TIME);
-    if (result != ITEM_OK)
+    if (poseBatch.Interpolate(itemBweight) > 0)
     {
-      double latestTimestamp(0);
-      if (aSource->GetLatestTimeStamp(latestTimestamp) != ITEM_OK)
+      static vtkIGSIOLogHelper helper(5.f, 5000, vtkPlusLogger::LOG_LEVEL_WARNING);
+      if (helper.ShouldWeLog(true))
       {
-        LOG_ERROR("Failed to get latest timestamp!");
-        numberOfErrors++;
+        LOG_WARNING("Angle difference between interpolated orientations of the tools of device " << (firstTool->GetDevice() ? firstTool->GetDevice()->GetDeviceId() : "(unknown)")
+                    << " is large, interpolation may be inaccurate. Consider moving the tools slower.");
       }
+    }
+    for (size_t batchIndex = 0; batchIndex < batchToolIndices.size(); ++batchIndex)
+    {
+      const size_t toolIndex = batchToolIndices[batchIndex];
+      numberOfErrors += this->SetToolTransform(group.FieldNames[toolIndex], poseBatch.GetInterpolatedMatrix(static_cast<int>(batchIndex)), TOOL_OK, NULL, fieldValue, aTrackedFrame);
+    }
+  }
 
-      double oldestTimestamp(0);
-      if (aSource->GetOldestTimeStamp(oldestTimestamp) != ITEM_OK)
-      {
-        LOG_ERROR("Failed to get oldest timestamp!");
-        numberOfErrors++;
-      }
+  return numberOfErrors;
+}
 
-      LOG_ERROR(aSource->GetId() << ": Failed to get tracker item from buffer by time: " << std::fixed << synchronizedTimestamp << " (Latest timestamp: " << latestTimestamp << "   Oldest timestamp: " << oldestTimestamp << ").");
-      numberOfErrors++;
-      continue;
+//----------------------------------------------------------------------------
+int vtkPlusChannel::SetToolTransformFromBufferItem(const ToolFieldNames& toolFieldNames, ItemStatus itemStatus, StreamBufferItem& bufferItem, double& synchronizedTimestamp, std::ostringstream& fieldValue, igsioTrackedFrame& aTrackedFrame)
+{
+  vtkPlusDataSource* aTool = toolFieldNames.Tool;
+  if (!toolFieldNames.TransformName.IsValid())
+  {
+    LOG_ERROR("Tool transform name is invalid!");
+    return 1;
+  }
+
+  if (itemStatus != ITEM_OK)
+  {
+    if (!this->CountFrameMiss(GetFrameMissReason(itemStatus, false)))
+    {
+      return 1;
     }
 
-    // Copy all custom fields
-    igsioFieldMapType fieldMap = bufferItem.GetFrameFieldMap();
-    for (igsioFieldMapType::const_iterator fieldIterator = fieldMap.begin(); fieldIterator != fieldMap.end(); fieldIterator++)
+    double latestTimestamp(0);
+    if (aTool->GetLatestTimeStamp(latestTimestamp) != ITEM_OK)
     {
-      aTrackedFrame.SetFrameField(fieldIterator->first, fieldIterator->second.second, fieldIterator->second.first);
+      LOG_ERROR("Failed to get latest timestamp!");
     }
 
-    synchronizedTimestamp = bufferItem.GetTimestamp(aSource->GetLocalTimeOffsetSec());
+    double oldestTimestamp(0);
+    if (aTool->GetOldestTimeStamp(oldestTimestamp) != ITEM_OK)
+    {
+      LOG_ERROR("Failed to get oldest timestamp!");
+    }
+
+    LOG_ERROR(aTool->GetId() << ": Failed to get tracker item from buffer by time: " << std::fixed << synchronizedTimestamp << " (Latest timestamp: " << latestTimestamp << "   Oldest timestamp: " << oldestTimestamp << ").");
+    return 1;
   }
 
-  // Copy frame timestamp
-  aTrackedFrame.SetTimestamp(synchronizedTimestamp);
+  double matrixElements[16];
+  bufferItem.GetMatrixElements(matrixElements);
+  igsioFieldMapType frameFields = bufferItem.GetFrameFieldMap();
+  const int numberOfErrors = this->SetToolTransform(toolFieldNames, matrixElements, bufferItem.GetStatus(), &frameFields, fieldValue, aTrackedFrame);
+  if (numberOfErrors == 0)
+  {
+    synchronizedTimestamp = bufferItem.GetTimestamp(aTool->GetLocalTimeOffsetSec());
+  }
+  return numberOfErrors;
+}
 
-  return (numberOfErrors == 0 ? PLUS_SUCCESS : PLUS_FAIL);
+//----------------------------------------------------------------------------
+int vtkPlusChannel::SetToolTransform(const ToolFieldNames& toolFieldNames, const double matrixElements[16], ToolStatus toolStatus, const igsioFieldMapType* frameFields, std::ostringstream& fieldValue, igsioTrackedFrame& aTrackedFrame)
+{
+  fieldValue.str("");
+  fieldValue.clear();
+  for (int i = 0; i < 16; ++i)
+  {
+    fieldValue << matrixElements[i] << " ";
+  }
+  aTrackedFrame.SetFrameField(toolFieldNames.TransformFieldName, fieldValue.str());
+  aTrackedFrame.SetFrameField(toolFieldNames.TransformStatusFieldName, igsioCommon::ConvertToolStatusToString(toolStatus));
+
+  // Copy all custom fields
+  if (frameFields != NULL)
+  {
+    for (igsioFieldMapType::const_iterator fieldIterator = frameFields->begin(); fieldIterator != frameFields->end(); fieldIterator++)
+    {
+      aTrackedFrame.SetFrameField(fieldIterator->first, fieldIterator->second.second, fieldIterator->second.first);
+    }
+  }
+  return 0;
 }
 
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusChannel::GetTrackedFrame(igsioTrackedFrame& trackedFrame)
 {
+  vtkPlusChannel* forwardedChannel = this->ForwardedChannel.load();
+  if (forwardedChannel != NULL)
+  {
+    return forwardedChannel->GetTrackedFrame(trackedFrame);
+  }
   double mostRecentFrameTimestamp(0);
   RETURN_WITH_FAIL_IF(this->GetMostRecentTimestamp(mostRecentFrameTimestamp) != PLUS_SUCCESS,
                       "Failed to get most recent timestamp from the buffer!");
@@ -712,8 +1061,28 @@ PlusStatus vtkPlusChannel::GetTrackedFrame(igsioTrackedFrame& trackedFrame)
 }
 
 //----------------------------------------------------------------------------
-PlusStatus vtkPlusChannel::GetTrackedFrameList(double& aTimestampOfLastFrameAlreadyGot, vtkIGSIOTrackedFrameList* aTrackedFrameList, int aMaxNumberOfFramesToAdd)
+PlusStatus vtkPlusChannel::GetTrackedFrameView(igsioTrackedFrame& trackedFrame)
 {
+  vtkPlusChannel* forwardedChannel = this->ForwardedChannel.load();
+  if (forwardedChannel != NULL)
+  {
+    return forwardedChannel->GetTrackedFrameView(trackedFrame);
+  }
+  double mostRecentFrameTimestamp(0);
+  RETURN_WITH_FAIL_IF(this->GetMostRecentTimestamp(mostRecentFrameTimestamp) != PLUS_SUCCESS,
+                      "Failed to get most recent timestamp from the buffer!");
+
+  return this->GetTrackedFrameView(mostRecentFrameTimestamp, trackedFrame);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusChannel::GetTrackedFrameList(double& aTimestampOfLastFrameAlreadyGot, vtkIGSIOTrackedFrameList* aTrackedFrameList, int aMaxNumberOfFramesToAdd, bool shareImageData/*=false*/)
+{
+  vtkPlusChannel* forwardedChannel = this->ForwardedChannel.load();
+  if (forwardedChannel != NULL)
+  {
+    return forwardedChannel->GetTrackedFrameList(aTimestampOfLastFrameAlreadyGot, aTrackedFrameList, aMaxNumberOfFramesToAdd, shareImageData);
+  }
   LOG_TRACE("vtkPlusDevice::GetTrackedFrameList(" << aTimestampOfLastFrameAlreadyGot << ", " << aMaxNumberOfFramesToAdd << ")");
 
   if (aTrackedFrameList == NULL)
@@ -941,107 +1310,84 @@ PlusStatus vtkPlusChannel::GetTrackedFrameList(double& aTimestampOfLastFrameAlre
     timestampFrom = mostRecentTimestamp;
   }
 
-  for (int i = 0; i < numberOfFramesToAdd; ++i)
+  // Collect the timestamps of the frames to add from the buffer that determines the frame rate, taking its lock only once
+  std::vector<double> frameTimestamps;
+  vtkPlusDataSource* timestampSource = NULL;
+  if (this->GetVideoDataAvailable())
   {
-    // Only add this frame if it has not been already added
-    if (timestampFrom > aTimestampOfLastFrameAlreadyGot || aTimestampOfLastFrameAlreadyGot == UNDEFINED_TIMESTAMP)
+    timestampSource = this->VideoSource;
+  }
+  else if (this->GetTrackingEnabled())
+  {
+    if (this->GetTimestampMasterTool(timestampSource) != PLUS_SUCCESS)
     {
-      // Get tracked frame from buffer
-      igsioTrackedFrame* trackedFrame = new igsioTrackedFrame;
-
-      if (this->GetTrackedFrame(timestampFrom, *trackedFrame) != PLUS_SUCCESS)
-      {
-        delete trackedFrame;
-        LOG_ERROR("Unable to get tracked frame by time: " << std::fixed << timestampFrom);
-        return PLUS_FAIL;
-      }
-
-      // Add tracked frame to the list
-      aTimestampOfLastFrameAlreadyGot = trackedFrame->GetTimestamp();
-      if (aTrackedFrameList->TakeTrackedFrame(trackedFrame, vtkIGSIOTrackedFrameList::SKIP_INVALID_FRAME) != PLUS_SUCCESS)
-      {
-        LOG_ERROR("Unable to add tracked frame to the list!");
-        return PLUS_FAIL;
-      }
+      LOG_ERROR("Failed to get tracked frame list - there is no active tool!");
+      return PLUS_FAIL;
     }
+  }
+  else if (this->GetFieldDataAvailable())
+  {
+    timestampSource = this->FieldDataSources.begin()->second;
+  }
 
-    // Get next timestamp
-    if (this->GetVideoDataAvailable() && i < numberOfFramesToAdd - 1)
+  if (timestampSource != NULL && numberOfFramesToAdd > 0)
+  {
+    BufferItemUidType uidFrom(0);
+    if (timestampSource->GetItemUidFromTime(timestampFrom, uidFrom) != ITEM_OK)
     {
-      BufferItemUidType videoUid(0);
-      if (this->VideoSource->GetItemUidFromTime(timestampFrom, videoUid) != ITEM_OK)
-      {
-        LOG_ERROR("Failed to get video buffer item UID from time: " << std::fixed << timestampFrom);
-        return PLUS_FAIL;
-      }
-
-      if (videoUid >= this->VideoSource->GetLatestItemUidInBuffer())
-      {
-        LOG_WARNING("Requested video uid (" << videoUid + 1 << ") is not in the buffer yet!");
-        break;
-      }
-
-      // Get the timestamp of the next item in the buffer
-      if (this->VideoSource->GetTimeStamp(++videoUid, timestampFrom) != ITEM_OK)
-      {
-        LOG_ERROR("Unable to get timestamp from video buffer by UID: " << videoUid);
-        return PLUS_FAIL;
-      }
+      LOG_ERROR("Failed to get buffer item UID from time: " << std::fixed << timestampFrom);
+      return PLUS_FAIL;
     }
-    else if (this->GetTrackingEnabled() && i < numberOfFramesToAdd - 1)
+    std::vector<BufferItemUidType> frameUids;
+    timestampSource->GetItemTimeStamps(uidFrom, uidFrom + numberOfFramesToAdd - 1, frameUids, frameTimestamps);
+    if (frameTimestamps.size() < static_cast<size_t>(numberOfFramesToAdd))
     {
-      vtkPlusDataSource* masterTool = NULL;
-      if (this->GetTimestampMasterTool(masterTool) != PLUS_SUCCESS)
-      {
-        LOG_ERROR("Failed to get tracked frame list - there is no active tool!");
-        return PLUS_FAIL;
-      }
+      LOG_WARNING("Requested uid (" << uidFrom + frameTimestamps.size() << ") is not in the buffer yet!");
+    }
+  }
+  else if (numberOfFramesToAdd > 0)
+  {
+    frameTimestamps.push_back(timestampFrom);
+  }
 
-      BufferItemUidType trackerUid(0);
-      if (masterTool->GetItemUidFromTime(timestampFrom, trackerUid) != ITEM_OK)
-      {
-        LOG_ERROR("Failed to get tracker buffer item UID from time: " << std::fixed << timestampFrom);
-        return PLUS_FAIL;
-      }
+  // Only add frames that have not been already added
+  if (aTimestampOfLastFrameAlreadyGot != UNDEFINED_TIMESTAMP)
+  {
+    frameTimestamps.erase(std::remove_if(frameTimestamps.begin(), frameTimestamps.end(),
+                                         [aTimestampOfLastFrameAlreadyGot](double timestamp) { return timestamp <= aTimestampOfLastFrameAlreadyGot; }),
+                          frameTimestamps.end());
+  }
 
-      if (trackerUid >= masterTool->GetLatestItemUidInBuffer())
-      {
-        LOG_ERROR("Requested tracker uid (" << trackerUid + 1 << ") is not in the buffer yet!");
-        break;
-      }
+  // Get the tracked frames from the buffers in parallel
+  std::vector<igsioTrackedFrame*> trackedFrames;
+  PlusTrackedFrameAssembly::AssembleFrames(static_cast<int>(frameTimestamps.size()), [this, &frameTimestamps, shareImageData](int frameIndex, igsioTrackedFrame & trackedFrame)
+  {
+    return this->GetTrackedFrameInternal(frameTimestamps[frameIndex], trackedFrame, true, shareImageData);
+  }, trackedFrames);
 
-      // Get the timestamp of the next item in the buffer
-      if (masterTool->GetTimeStamp(++trackerUid, timestampFrom) != ITEM_OK)
-      {
-        LOG_WARNING("Unable to get timestamp from tracker buffer by UID: " << trackerUid);
-        return PLUS_FAIL;
-      }
+  // Add the tracked frames to the list in the order of acquisition
+  for (size_t frameIndex = 0; frameIndex < trackedFrames.size(); ++frameIndex)
+  {
+    igsioTrackedFrame* trackedFrame = trackedFrames[frameIndex];
+    if (trackedFrame == NULL)
+    {
+      LOG_ERROR("Unable to get tracked frame by time: " << std::fixed << frameTimestamps[frameIndex]);
+      status = PLUS_FAIL;
+      break;
     }
-    else if (this->GetFieldDataAvailable() && i < numberOfFramesToAdd - 1)
+    trackedFrames[frameIndex] = NULL;
+    aTimestampOfLastFrameAlreadyGot = trackedFrame->GetTimestamp();
+    if (aTrackedFrameList->TakeTrackedFrame(trackedFrame, vtkIGSIOTrackedFrameList::SKIP_INVALID_FRAME) != PLUS_SUCCESS)
     {
-      vtkPlusDataSource* firstFieldDataSource = this->FieldDataSources.begin()->second;
-
-      BufferItemUidType fieldUid(0);
-      if (firstFieldDataSource->GetItemUidFromTime(timestampFrom, fieldUid) != ITEM_OK)
-      {
-        LOG_ERROR("Failed to get tracker buffer item UID from time: " << std::fixed << timestampFrom);
-        return PLUS_FAIL;
-      }
-
-      if (fieldUid >= firstFieldDataSource->GetLatestItemUidInBuffer())
-      {
-        LOG_ERROR("Requested tracker uid (" << fieldUid + 1 << ") is not in the buffer yet!");
-        break;
-      }
-
-      // Get the timestamp of the next item in the buffer
-      if (firstFieldDataSource->GetTimeStamp(++fieldUid, timestampFrom) != ITEM_OK)
-      {
-        LOG_WARNING("Unable to get timestamp from field data buffer by UID: " << fieldUid);
-        return PLUS_FAIL;
-      }
+      LOG_ERROR("Unable to add tracked frame to the list!");
+      status = PLUS_FAIL;
+      break;
     }
   }
+  for (std::vector<igsioTrackedFrame*>::iterator frame = trackedFrames.begin(); frame != trackedFrames.end(); ++frame)
+  {
+    delete *frame;
+  }
 
   return status;
 }
@@ -1049,6 +1395,11 @@ PlusStatus vtkPlusChannel::GetTrackedFrameList(double& aTimestampOfLastFrameAlre
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusChannel::GetTrackedFrameListSampled(double& aTimestampOfLastFrameAlreadyGot, double& aTimestampOfNextFrameToBeAdded, vtkIGSIOTrackedFrameList* aTrackedFrameList, double aSamplingPeriodSec, double maxTimeLimitSec/*=-1*/)
 {
+  vtkPlusChannel* forwardedChannel = this->ForwardedChannel.load();
+  if (forwardedChannel != NULL)
+  {
+    return forwardedChannel->GetTrackedFrameListSampled(aTimestampOfLastFrameAlreadyGot, aTimestampOfNextFrameToBeAdded, aTrackedFrameList, aSamplingPeriodSec, maxTimeLimitSec);
+  }
   LOG_TRACE("vtkPlusDataCollector::GetTrackedFrameListSampled: aTimestampOfLastFrameAlreadyGot=" << aTimestampOfLastFrameAlreadyGot << ", aTimestampOfNextFrameToBeAdded=" << aTimestampOfNextFrameToBeAdded << ", aSamplingPeriodSec=" << aSamplingPeriodSec);
 
   if (aTrackedFrameList == NULL)
@@ -1127,6 +1478,11 @@ PlusStatus vtkPlusChannel::GetTrackedFrameListSampled(double& aTimestampOfLastFr
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusChannel::GetOldestTimestamp(double& ts)
 {
+  vtkPlusChannel* forwardedChannel = this->ForwardedChannel.load();
+  if (forwardedChannel != NULL)
+  {
+    return forwardedChannel->GetOldestTimestamp(ts);
+  }
   //LOG_TRACE("vtkPlusChannel::GetOldestTimestamp");
   ts = 0;
 
@@ -1262,6 +1618,11 @@ PlusStatus vtkPlusChannel::GetOldestTimestamp(double& ts)
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusChannel::GetMostRecentTimestamp(double& ts)
 {
+  vtkPlusChannel* forwardedChannel = this->ForwardedChannel.load();
+  if (forwardedChannel != NULL)
+  {
+    return forwardedChannel->GetMostRecentTimestamp(ts);
+  }
   ts = 0;
 
   double latestVideoTimestamp(0);
@@ -1488,6 +1849,11 @@ PlusStatus vtkPlusChannel::GetMostRecentTimestamp(double& ts)
 //----------------------------------------------------------------------------
 bool vtkPlusChannel::GetTrackingDataAvailable()
 {
+  vtkPlusChannel* forwardedChannel = this->ForwardedChannel.load();
+  if (forwardedChannel != NULL)
+  {
+    return forwardedChannel->GetTrackingDataAvailable();
+  }
   vtkPlusDataSource* aSource = NULL;
   if (this->HasVideoSource() && this->GetVideoSource(aSource) == PLUS_SUCCESS)
   {
@@ -1513,6 +1879,11 @@ bool vtkPlusChannel::GetTrackingDataAvailable()
 //----------------------------------------------------------------------------
 bool vtkPlusChannel::GetVideoDataAvailable()
 {
+  vtkPlusChannel* forwardedChannel = this->ForwardedChannel.load();
+  if (forwardedChannel != NULL)
+  {
+    return forwardedChannel->GetVideoDataAvailable();
+  }
   vtkPlusDataSource* aSource = NULL;
   if (this->GetVideoSource(aSource) != PLUS_SUCCESS)
   {
@@ -1524,6 +1895,11 @@ bool vtkPlusChannel::GetVideoDataAvailable()
 //----------------------------------------------------------------------------
 bool vtkPlusChannel::GetFieldDataAvailable()
 {
+  vtkPlusChannel* forwardedChannel = this->ForwardedChannel.load();
+  if (forwardedChannel != NULL)
+  {
+    return forwardedChannel->GetFieldDataAvailable();
+  }
   vtkPlusDataSource* aSource = NULL;
   if (this->HasVideoSource() && this->GetVideoSource(aSource) == PLUS_SUCCESS)
   {
@@ -1549,18 +1925,33 @@ bool vtkPlusChannel::GetFieldDataAvailable()
 //----------------------------------------------------------------------------
 bool vtkPlusChannel::GetTrackingEnabled() const
 {
+  vtkPlusChannel* forwardedChannel = this->ForwardedChannel.load();
+  if (forwardedChannel != NULL)
+  {
+    return forwardedChannel->GetTrackingEnabled();
+  }
   return this->ToolCount() > 0;
 }
 
 //----------------------------------------------------------------------------
 bool vtkPlusChannel::GetVideoEnabled() const
 {
+  vtkPlusChannel* forwardedChannel = this->ForwardedChannel.load();
+  if (forwardedChannel != NULL)
+  {
+    return forwardedChannel->GetVideoEnabled();
+  }
   return this->HasVideoSource();
 }
 
 //----------------------------------------------------------------------------
 bool vtkPlusChannel::GetFieldDataEnabled() const
 {
+  vtkPlusChannel* forwardedChannel = this->ForwardedChannel.load();
+  if (forwardedChannel != NULL)
+  {
+    return forwardedChannel->GetFieldDataEnabled();
+  }
   return this->FieldCount() > 0;
 }
 
@@ -1591,6 +1982,11 @@ PlusStatus vtkPlusChannel::GetTimestampMasterTool(vtkPlusDataSource*& aTool)
 //----------------------------------------------------------------------------
 int vtkPlusChannel::GetNumberOfFramesBetweenTimestamps(double aTimestampFrom, double aTimestampTo)
 {
+  vtkPlusChannel* forwardedChannel = this->ForwardedChannel.load();
+  if (forwardedChannel != NULL)
+  {
+    return forwardedChannel->GetNumberOfFramesBetweenTimestamps(aTimestampFrom, aTimestampTo);
+  }
   int numberOfFrames = 0;
 
   if (this->GetVideoDataAvailable())
@@ -1657,6 +2053,11 @@ int vtkPlusChannel::GetNumberOfFramesBetweenTimestamps(double aTimestampFrom, do
 //----------------------------------------------------------------------------
 double vtkPlusChannel::GetClosestTrackedFrameTimestampByTime(double time)
 {
+  vtkPlusChannel* forwardedChannel = this->ForwardedChannel.load();
+  if (forwardedChannel != NULL)
+  {
+    return forwardedChannel->GetClosestTrackedFrameTimestampByTime(time);
+  }
   if (this->GetVideoDataAvailable())
   {
     BufferItemUidType uid = 0;
@@ -1716,6 +2117,11 @@ double vtkPlusChannel::GetClosestTrackedFrameTimestampByTime(double time)
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusChannel::GetBrightnessFrameSize(FrameSizeType& aDim)
 {
+  vtkPlusChannel* forwardedChannel = this->ForwardedChannel.load();
+  if (forwardedChannel != NULL)
+  {
+    return forwardedChannel->GetBrightnessFrameSize(aDim);
+  }
   aDim = this->BrightnessFrameSize;
 
   return PLUS_SUCCESS;
@@ -1724,6 +2130,11 @@ PlusStatus vtkPlusChannel::GetBrightnessFrameSize(FrameSizeType& aDim)
 //----------------------------------------------------------------------------
 vtkImageData* vtkPlusChannel::GetBrightnessOutput()
 {
+  vtkPlusChannel* forwardedChannel = this->ForwardedChannel.load();
+  if (forwardedChannel != NULL)
+  {
+    return forwardedChannel->GetBrightnessOutput();
+  }
   vtkImageData* resultImage = this->BlankImage;
   if (!this->HasVideoSource())
   {
@@ -1802,6 +2213,41 @@ PlusStatus vtkPlusChannel::SetCustomAttribute(const std::string& attributeId, co
   return PLUS_SUCCESS;
 }
 
+#ifdef PLUS_RENDERING_ENABLED
+namespace
+{
+  //-----------------------------------------------------------------------------
+  std::string GetTimeStampReportStatisticsAsString(const TimeStampReportStatistics& statistics)
+  {
+    std::ostringstream text;
+    text << std::fixed << std::setprecision(2);
+    text << "Number of items: " << statistics.GetNumberOfItems()
+         << "<br/>Frame period (ms): mean " << statistics.GetFramePeriodMeanSec() * 1000.0
+         << ", stdev " << statistics.GetFramePeriodStdevSec() * 1000.0
+         << ", min " << statistics.GetFramePeriodMinSec() * 1000.0
+         << ", max " << statistics.GetFramePeriodMaxSec() * 1000.0
+         << "<br/>Timestamp jitter (|unfiltered - filtered|) histogram:";
+    double binLowerLimitSec = 0.0;
+    for (int bin = 0; bin < TimeStampReportStatistics::NUMBER_OF_JITTER_HISTOGRAM_BINS; ++bin)
+    {
+      double binUpperLimitSec = TimeStampReportStatistics::GetJitterHistogramBinUpperLimitSec(bin);
+      text << (bin == 0 ? " " : ", ") << binLowerLimitSec * 1000.0;
+      if (bin < TimeStampReportStatistics::NUMBER_OF_JITTER_HISTOGRAM_BINS - 1)
+      {
+        text << "-" << binUpperLimitSec * 1000.0 << " ms: ";
+      }
+      else
+      {
+        text << "- ms: ";
+      }
+      text << statistics.GetJitterHistogramCount(bin);
+      binLowerLimitSec = binUpperLimitSec;
+    }
+    return text.str();
+  }
+}
+#endif
+
 //-----------------------------------------------------------------------------
 PlusStatus vtkPlusChannel::GenerateDataAcquisitionReport(vtkPlusHTMLGenerator* htmlReport)
 {
@@ -1821,6 +2267,9 @@ PlusStatus vtkPlusChannel::GenerateDataAcquisitionReport(vtkPlusHTMLGenerator* h
 
   int imageSize[2] = {800, 400};
 
+  // Charts are rendered by worker threads from decimated copies of the tables, while the next sections are added
+  std::vector<std::future<PlusStatus> > chartResults;
+
   // Video data
   vtkPlusDataSource* videoSource = NULL;
   if (this->GetVideoSource(videoSource) == PLUS_SUCCESS && videoSource != NULL)
@@ -1835,8 +2284,9 @@ PlusStatus vtkPlusChannel::GenerateDataAcquisitionReport(vtkPlusHTMLGenerator* h
     PlusPlotter::WriteTableToFile(*timestampReportTable, reportFile.c_str());
 
     htmlReport->AddText("Video data", vtkPlusHTMLGenerator::H2);
+    htmlReport->AddParagraph(GetTimeStampReportStatisticsAsString(videoSource->GetTimeStampReportStatistics()).c_str());
     std::string imageFilePath = htmlReport->AddImageAutoFilename(std::string(deviceAndChannelName + "VideoBufferTimestamps.png").c_str(), "Video Data Acquisition Analysis");
-    PlusPlotter::WriteLineChartToFile("Frame index", "Timestamp (s)", *timestampReportTable, 0, 1, 2, imageSize, imageFilePath.c_str());
+    chartResults.push_back(PlusPlotter::WriteLineChartToFileAsync("Frame index", "Timestamp (s)", *timestampReportTable, 0, 1, 2, imageSize, imageFilePath.c_str()));
 
     htmlReport->AddHorizontalLine();
   }
@@ -1854,8 +2304,9 @@ PlusStatus vtkPlusChannel::GenerateDataAcquisitionReport(vtkPlusHTMLGenerator* h
 
     reportText =  std::string("Tracking data - ") + tool->GetId();
     htmlReport->AddText(reportText.c_str(), vtkPlusHTMLGenerator::H2);
+    htmlReport->AddParagraph(GetTimeStampReportStatisticsAsString(tool->GetTimeStampReportStatistics()).c_str());
     std::string imageFilePath = htmlReport->AddImageAutoFilename(std::string(deviceAndChannelName + "-" + tool->GetId() + "-TrackerBufferTimestamps.png").c_str(), reportText.c_str());
-    PlusPlotter::WriteLineChartToFile("Frame index", "Timestamp (s)", *timestampReportTable, 0, 1, 2, imageSize, imageFilePath.c_str());
+    chartResults.push_back(PlusPlotter::WriteLineChartToFileAsync("Frame index", "Timestamp (s)", *timestampReportTable, 0, 1, 2, imageSize, imageFilePath.c_str()));
 
     std::string reportFile = vtkPlusConfig::GetInstance()->GetOutputPath(vtkPlusConfig::GetInstance()->GetApplicationStartTimestamp() + "-" + deviceAndChannelName + "-" + tool->GetId() + "TrackerBufferTimestamps.txt");
     PlusPlotter::WriteTableToFile(*timestampReportTable, reportFile.c_str());
@@ -1876,8 +2327,9 @@ PlusStatus vtkPlusChannel::GenerateDataAcquisitionReport(vtkPlusHTMLGenerator* h
 
     reportText =  std::string("Field data - ") + aSource->GetId();
     htmlReport->AddText(reportText.c_str(), vtkPlusHTMLGenerator::H2);
+    htmlReport->AddParagraph(GetTimeStampReportStatisticsAsString(aSource->GetTimeStampReportStatistics()).c_str());
     std::string imageFilePath = htmlReport->AddImageAutoFilename(std::string(deviceAndChannelName + "-" + aSource->GetId() + "-FieldDataBufferTimestamps.png").c_str(), reportText.c_str());
-    PlusPlotter::WriteLineChartToFile("Frame index", "Timestamp (s)", *timestampReportTable, 0, 1, 2, imageSize, imageFilePath.c_str());
+    chartResults.push_back(PlusPlotter::WriteLineChartToFileAsync("Frame index", "Timestamp (s)", *timestampReportTable, 0, 1, 2, imageSize, imageFilePath.c_str()));
 
     std::string reportFile = vtkPlusConfig::GetInstance()->GetOutputPath(vtkPlusConfig::GetInstance()->GetApplicationStartTimestamp() + "-" + deviceAndChannelName + "-" + aSource->GetId() + "FieldDataBufferTimestamps.txt");
     PlusPlotter::WriteTableToFile(*timestampReportTable, reportFile.c_str());
@@ -1885,7 +2337,17 @@ PlusStatus vtkPlusChannel::GenerateDataAcquisitionReport(vtkPlusHTMLGenerator* h
     htmlReport->AddHorizontalLine();
   }
 
-  return PLUS_SUCCESS;
+  PlusStatus status = PLUS_SUCCESS;
+  for (std::vector<std::future<PlusStatus> >::iterator chartResult = chartResults.begin(); chartResult != chartResults.end(); ++chartResult)
+  {
+    PlusWorkerPool::GetInstance().Wait(*chartResult);
+    if (chartResult->get() != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to write data acquisition report chart");
+      status = PLUS_FAIL;
+    }
+  }
+  return status;
 #else
   LOG_WARNING("Cannot generate report when VTK_RENDERING_BACKEND is None!");
   return PLUS_FAIL;
@@ -1920,4 +2382,114 @@ bool vtkPlusChannel::IsVideoSource3D() const
   {
     return false;
   }
-}
\ No newline at end of file
+}
+//----------------------------------------------------------------------------
+unsigned long long vtkPlusChannel::GetNumberOfFrameMisses(FrameMissReason reason) const
+{
+  if (reason < 0 || reason >= NUMBER_OF_FRAME_MISS_REASONS)
+  {
+    return 0;
+  }
+  return this->FrameMisses[reason].load(std::memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------------
+std::string vtkPlusChannel::GetFrameMissStatisticsString() const
+{
+  std::ostringstream ss;
+  for (int reason = 0; reason < NUMBER_OF_FRAME_MISS_REASONS; ++reason)
+  {
+    ss << (reason == 0 ? "" : " ") << GetFrameMissReasonName(static_cast<FrameMissReason>(reason))
+       << "=" << this->GetNumberOfFrameMisses(static_cast<FrameMissReason>(reason));
+  }
+  return ss.str();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusChannel::ResetFrameMissCounters()
+{
+  for (int reason = 0; reason < NUMBER_OF_FRAME_MISS_REASONS; ++reason)
+  {
+    this->FrameMisses[reason].store(0, std::memory_order_relaxed);
+    this->ReportedFrameMisses[reason] = 0;
+  }
+}
+
+//----------------------------------------------------------------------------
+const char* vtkPlusChannel::GetFrameMissReasonName(FrameMissReason reason)
+{
+  switch (reason)
+  {
+    case FRAME_MISS_VIDEO_NOT_AVAILABLE_YET:
+      return "VideoNotAvailableYet";
+    case FRAME_MISS_VIDEO_NOT_AVAILABLE_ANYMORE:
+      return "VideoNotAvailableAnymore";
+    case FRAME_MISS_VIDEO_ITEM:
+      return "VideoItemError";
+    case FRAME_MISS_TOOL_NOT_AVAILABLE_YET:
+      return "ToolNotAvailableYet";
+    case FRAME_MISS_TOOL_NOT_AVAILABLE_ANYMORE:
+      return "ToolNotAvailableAnymore";
+    case FRAME_MISS_TOOL_OTHER:
+      return "ToolItemError";
+    default:
+      return "Unknown";
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkPlusChannel::FrameMissReason vtkPlusChannel::GetFrameMissReason(ItemStatus status, bool video)
+{
+  switch (status)
+  {
+    case ITEM_NOT_AVAILABLE_YET:
+      return video ? FRAME_MISS_VIDEO_NOT_AVAILABLE_YET : FRAME_MISS_TOOL_NOT_AVAILABLE_YET;
+    case ITEM_NOT_AVAILABLE_ANYMORE:
+      return video ? FRAME_MISS_VIDEO_NOT_AVAILABLE_ANYMORE : FRAME_MISS_TOOL_NOT_AVAILABLE_ANYMORE;
+    default:
+      return video ? FRAME_MISS_VIDEO_ITEM : FRAME_MISS_TOOL_OTHER;
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusChannel::CountFrameMiss(FrameMissReason reason)
+{
+  this->FrameMisses[reason].fetch_add(1, std::memory_order_relaxed);
+
+  const double now = vtkIGSIOAccurateTimer::GetSystemTime();
+  double lastReportTime = this->LastFrameMissReportTime.load(std::memory_order_relaxed);
+  if (now - lastReportTime < this->FrameMissReportIntervalSec)
+  {
+    return false;
+  }
+  if (!this->LastFrameMissReportTime.compare_exchange_strong(lastReportTime, now))
+  {
+    // Another thread is reporting
+    return false;
+  }
+
+  // The current miss is logged in detail by the caller, all the others since the previous report are summarized
+  std::ostringstream summary;
+  unsigned long long numberOfUnreportedMisses = 0;
+  for (int i = 0; i < NUMBER_OF_FRAME_MISS_REASONS; ++i)
+  {
+    const unsigned long long numberOfMisses = this->FrameMisses[i].load(std::memory_order_relaxed);
+    unsigned long long numberOfNewMisses = numberOfMisses - this->ReportedFrameMisses[i];
+    this->ReportedFrameMisses[i] = numberOfMisses;
+    if (i == reason && numberOfNewMisses > 0)
+    {
+      numberOfNewMisses--;
+    }
+    if (numberOfNewMisses > 0)
+    {
+      summary << " " << GetFrameMissReasonName(static_cast<FrameMissReason>(i)) << "=" << numberOfNewMisses;
+      numberOfUnreportedMisses += numberOfNewMisses;
+    }
+  }
+  if (numberOfUnreportedMisses > 0 && lastReportTime > -std::numeric_limits<double>::max())
+  {
+    LOG_WARNING("Channel " << (this->ChannelId ? this->ChannelId : "(unknown)") << ": " << numberOfUnreportedMisses
+                << " failed tracked frame lookups were not logged in the last " << std::fixed << std::setprecision(1) << now - lastReportTime << " sec:" << summary.str());
+  }
+  return true;
+}
@@ -14,7 +14,14 @@
 #include "vtkDataObject.h"
 #include "vtkPlusRfProcessor.h"
 
+#include <atomic>
+#include <sstream>
+#include <string>
+#include <vector>
+
 //class igsioTrackedFrame; 
+class PlusToolPoseBatch;
+class vtkMatrix4x4;
 class vtkPlusHTMLGenerator;
 class vtkPlusDataSource;
 class vtkPlusDevice;
@@ -38,6 +45,18 @@ public:
   typedef CustomAttributeMap::iterator CustomAttributeMapIterator;
   typedef CustomAttributeMap::const_iterator CustomAttributeMapConstIterator;
 
+  /*! Reasons of failed tracked frame lookups, counted separately for each channel */
+  enum FrameMissReason
+  {
+    FRAME_MISS_VIDEO_NOT_AVAILABLE_YET,     /*!< the requested video frame is not acquired yet (or no frames at all) */
+    FRAME_MISS_VIDEO_NOT_AVAILABLE_ANYMORE, /*!< the requested video frame is already overwritten in the buffer */
+    FRAME_MISS_VIDEO_ITEM,                  /*!< other failure while getting the video frame from the buffer */
+    FRAME_MISS_TOOL_NOT_AVAILABLE_YET,      /*!< the requested tool transform is not acquired yet */
+    FRAME_MISS_TOOL_NOT_AVAILABLE_ANYMORE,  /*!< the requested tool transform is already overwritten in the buffer */
+    FRAME_MISS_TOOL_OTHER,                  /*!< other failure while getting a tool transform or field data item */
+    NUMBER_OF_FRAME_MISS_REASONS
+  };
+
 public:
   static vtkPlusChannel* New();
   vtkTypeMacro(vtkPlusChannel, vtkObject);
@@ -53,12 +72,26 @@ public:
 
   inline PlusStatus GetVideoSource(vtkPlusDataSource*& aVideoSource) const
   {
-    aVideoSource = this->VideoSource;
+    vtkPlusChannel* forwardedChannel = this->ForwardedChannel.load();
+    aVideoSource = (forwardedChannel != NULL) ? forwardedChannel->VideoSource : this->VideoSource;
     return aVideoSource != NULL ? PLUS_SUCCESS : PLUS_FAIL;
   }
 
   void SetVideoSource(vtkPlusDataSource* aSource);
-  inline bool HasVideoSource() const { return this->VideoSource != NULL; };
+  inline bool HasVideoSource() const
+  {
+    vtkPlusChannel* forwardedChannel = this->ForwardedChannel.load();
+    return ((forwardedChannel != NULL) ? forwardedChannel->VideoSource : this->VideoSource) != NULL;
+  };
+
+  /*!
+    Forward the data queries of this channel (video source, tracked frames, timestamps, data availability) to another
+    channel, without copying or clearing any buffer. NULL means that the own data sources are used.
+    The forwarded channel can be changed at any time, it is an atomic pointer update and readers are never blocked.
+    The tool and field data source containers (and their iterators) are not forwarded.
+  */
+  void SetForwardedChannel(vtkPlusChannel* aChannel);
+  vtkPlusChannel* GetForwardedChannel() const { return this->ForwardedChannel.load(); }
   bool IsVideoSource3D() const;
 
   int ToolCount() const { return this->Tools.size(); }
@@ -67,6 +100,32 @@ public:
   PlusStatus GetTool(vtkPlusDataSource*& aTool, const std::string& toolSourceId);
   PlusStatus GetToolByPortName(vtkPlusDataSource*& aTool, const std::string& portName);
   PlusStatus RemoveTools();
+
+  /*!
+    Group the tools by the device that acquires them, so that GetTrackedFrame searches the item closest to the requested
+    time only once per device instead of once per tool. Tools of a device are recorded at the same times, so the item
+    found in the buffer of the first tool of a group is used for all the others; a tool whose buffer is not in sync
+    with its group is looked up on its own. The plan is discarded when tools are added or removed.
+  */
+  void UpdateToolJoinPlan();
+
+  /*! Transform name and most recent status of a tool, see GetToolStatusSnapshot */
+  struct ToolStatusSnapshot
+  {
+    igsioTransformName TransformName;
+    ToolStatus Status;
+    /*! Unfiltered timestamp of the most recent item of the tool, UNDEFINED_TIMESTAMP if no item has been added yet */
+    double Timestamp;
+  };
+  /*!
+    Get the most recent status of each tool, in the order of the tools of the channel.
+    The statuses are published by the device threads, so the buffers are not locked and no tracked frame is assembled.
+    Must be called from the thread that configures the channel (the tools must not be added or removed meanwhile).
+  */
+  void GetToolStatusSnapshot(std::vector<ToolStatusSnapshot>& snapshot) const;
+  /*! Number of tool groups in the join plan, 0 if there is no plan */
+  int GetNumberOfToolJoinGroups() const { return static_cast<int>(this->ToolJoinPlan.size()); }
+
   inline DataSourceContainerIterator GetToolsStartIterator() { return this->Tools.begin(); };
   inline DataSourceContainerIterator GetToolsEndIterator() { return this->Tools.end(); };
   inline DataSourceContainerConstIterator GetToolsStartConstIterator() const { return this->Tools.begin(); };
@@ -112,6 +171,26 @@ public:
   virtual PlusStatus GetTrackedFrame(double timestamp, igsioTrackedFrame& trackedFrame, bool enableImageData = true);
   virtual PlusStatus GetTrackedFrame(igsioTrackedFrame& trackedFrame);
 
+  /*!
+    Set the transforms of all tools in the tracked frame, interpolated at the specified timestamp.
+    If the channel has a tool join plan (see UpdateToolJoinPlan) then the tools of each device are interpolated
+    together, in one pass, with the interpolation weight computed once for the device.
+  */
+  virtual PlusStatus GetToolTransformsAtTime(double timestamp, igsioTrackedFrame& trackedFrame);
+
+  /*!
+    Get tracked frame at a specific timestamp, same as GetTrackedFrame, but the image data
+    of the tracked frame is shared with the video buffer instead of being copied.
+    The image data of the returned tracked frame must be treated as read-only.
+    It remains valid after the buffer slot is reused, as the buffer allocates new memory
+    for a slot before overwriting image data that is still referenced.
+    \param timestamp Timestamp of the requested tracked frame
+    \param trackedFrame Target tracked frame
+    \param enableImageData Enable returning of image data. Tracking data will be interpolated at the timestamp of the image data.
+  */
+  virtual PlusStatus GetTrackedFrameView(double timestamp, igsioTrackedFrame& trackedFrame, bool enableImageData = true);
+  virtual PlusStatus GetTrackedFrameView(igsioTrackedFrame& trackedFrame);
+
   /*!
     Get the tracked frame list from devices since time specified
     \param aTimestampOfLastFrameAlreadyGot Used for preventing returning the same frame multiple times. In: the timestamp of the timestamp that has been already returned in previous GetTrackedFrameListSampled calls. If no frames have got yet then set it to UNDEFINED_TIMESTAMP. Out: the timestamp of the most recent frame that is returned.
@@ -130,8 +209,9 @@ public:
       Out: the timestamp of the most recent frame that is returned.
     \param aTrackedFrameList Tracked frame list used to get the newly acquired frames into. The new frames are appended to the tracked frame.
     \param aMaxNumberOfFramesToAdd Maximum this number of frames will be added (can be used for limiting the time spent in this method)
+    \param shareImageData If true then the image data of the returned frames is shared with the video buffer (see GetTrackedFrameView) and must be treated as read-only
   */
-  PlusStatus GetTrackedFrameList(double& aTimestampOfLastFrameAlreadyGot, vtkIGSIOTrackedFrameList* aTrackedFrameList, int aMaxNumberOfFramesToAdd);
+  PlusStatus GetTrackedFrameList(double& aTimestampOfLastFrameAlreadyGot, vtkIGSIOTrackedFrameList* aTrackedFrameList, int aMaxNumberOfFramesToAdd, bool shareImageData = false);
 
   /*! Get the closest tracked frame timestamp to the specified time */
   virtual double GetClosestTrackedFrameTimestampByTime(double time);
@@ -167,13 +247,76 @@ public:
   /*!
     Add generated html report from data acquisition to the existing html report.
     htmlReport and plotter arguments has to be defined by the caller function
+    The charts are rendered in parallel from decimated tables. If the report is in streaming mode
+    (see vtkPlusHTMLGenerator::StartStreamingAutoFilename) then each section is written to the report file when it is added.
   */
   virtual PlusStatus GenerateDataAcquisitionReport(vtkPlusHTMLGenerator* htmlReport);
 
-protected:
-  /*! Get number of tracked frames between two given timestamps (inclusive) */
+  /*! Get number of tracked frames between two given timestamps (the difference of their item indexes in the buffer) */
   virtual int GetNumberOfFramesBetweenTimestamps(double aTimestampFrom, double aTimestampTo);
 
+  /*!
+    Minimum time between two error reports of failed tracked frame lookups.
+    The first failure in an interval is logged in detail, the others are only counted and reported in a summary
+    together with the next logged failure. 0 means that all failures are logged.
+  */
+  vtkSetMacro(FrameMissReportIntervalSec, double);
+  vtkGetMacro(FrameMissReportIntervalSec, double);
+
+  /*! Number of failed tracked frame lookups with the specified reason since the creation of the channel (or the last reset) */
+  unsigned long long GetNumberOfFrameMisses(FrameMissReason reason) const;
+  /*! Summary of the failed lookups in the form "VideoNotAvailableYet=... VideoNotAvailableAnymore=... ..." */
+  std::string GetFrameMissStatisticsString() const;
+  void ResetFrameMissCounters();
+
+  static const char* GetFrameMissReasonName(FrameMissReason reason);
+
+protected:
+  /*! Common implementation of GetTrackedFrame and GetTrackedFrameView. If shareImageData is true then the image data is not copied from the buffer. */
+  PlusStatus GetTrackedFrameInternal(double timestamp, igsioTrackedFrame& trackedFrame, bool enableImageData, bool shareImageData);
+
+  /*! Transform name and frame field names of a tool, created when the tools of the channel change so that the names are not formatted for each frame */
+  struct ToolFieldNames
+  {
+    vtkPlusDataSource* Tool;
+    igsioTransformName TransformName;
+    std::string TransformFieldName;
+    std::string TransformStatusFieldName;
+  };
+  static ToolFieldNames CreateToolFieldNames(vtkPlusDataSource* aTool);
+  /*! Update ToolFieldNameList, must be called when the tools of the channel change */
+  void UpdateToolFieldNames();
+
+  /*! Tools of the join plan that are recorded by the same device, the closest item is searched in the buffer of the first tool */
+  struct ToolJoinGroup
+  {
+    std::vector<vtkPlusDataSource*> Tools;
+    std::vector<ToolFieldNames> FieldNames;
+  };
+
+  /*!
+    Set the transforms of all tools in the tracked frame, interpolated at synchronizedTimestamp.
+    synchronizedTimestamp is updated to the timestamp of the last tool item. Returns the number of errors.
+  */
+  int AddToolTransforms(double& synchronizedTimestamp, igsioTrackedFrame& trackedFrame);
+  /*! Interpolate the transforms of a tool group of the join plan in one pass. Returns the number of errors. */
+  int AddToolGroupTransforms(const ToolJoinGroup& group, double& synchronizedTimestamp, PlusToolPoseBatch& poseBatch, std::ostringstream& fieldValue, igsioTrackedFrame& trackedFrame);
+  /*! Set the transform of a tool in the tracked frame from a buffer item. Returns the number of errors. */
+  int SetToolTransformFromBufferItem(const ToolFieldNames& toolFieldNames, ItemStatus itemStatus, StreamBufferItem& bufferItem, double& synchronizedTimestamp, std::ostringstream& fieldValue, igsioTrackedFrame& trackedFrame);
+  /*!
+    Set the transform, status and custom fields of a tool in the tracked frame. The fields are set directly by their interned names,
+    in the same format as igsioTrackedFrame::SetFrameTransform. fieldValue is used as temporary storage. Returns the number of errors.
+  */
+  int SetToolTransform(const ToolFieldNames& toolFieldNames, const double matrixElements[16], ToolStatus toolStatus, const igsioFieldMapType* frameFields, std::ostringstream& fieldValue, igsioTrackedFrame& trackedFrame);
+
+  /*!
+    Count a failed lookup. Returns true if the failure should be logged in detail by the caller, in this case
+    the failures that were counted since the previous report are logged in a summary.
+  */
+  bool CountFrameMiss(FrameMissReason reason);
+  /*! Reason of a failed tool or video lookup based on the status returned by the buffer */
+  static FrameMissReason GetFrameMissReason(ItemStatus status, bool video);
+
 protected:
   DataSourceContainer       FieldDataSources;
   DataSourceContainer       Tools;
@@ -199,6 +342,22 @@ protected:
 
   CustomAttributeMap CustomAttributes;
 
+  /*! See UpdateToolJoinPlan */
+  std::vector<ToolJoinGroup> ToolJoinPlan;
+
+  /*! Field names of all the tools, in the order of Tools, see UpdateToolFieldNames */
+  std::vector<ToolFieldNames> ToolFieldNameList;
+
+  /*! Channel that the data queries are forwarded to, see SetForwardedChannel */
+  std::atomic<vtkPlusChannel*> ForwardedChannel;
+
+  /*! Failed tracked frame lookups, see CountFrameMiss */
+  double FrameMissReportIntervalSec;
+  std::atomic<unsigned long long> FrameMisses[NUMBER_OF_FRAME_MISS_REASONS];
+  /*! Counters at the time of the last report, only modified by the thread that reports */
+  unsigned long long ReportedFrameMisses[NUMBER_OF_FRAME_MISS_REASONS];
+  std::atomic<double> LastFrameMissReportTime;
+
   vtkPlusChannel(void);
   virtual ~vtkPlusChannel(void);
 
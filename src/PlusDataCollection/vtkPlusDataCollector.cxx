@@ -6,6 +6,9 @@ See License.txt for details.
 
 // Local includes
 #include "PlusConfigure.h"
+#include "PlusBufferSnapshot.h"
+#include "PlusReplayClock.h"
+#include "PlusTrackedFrameAssembly.h"
 #include "vtkPlusBuffer.h"
 #include "vtkPlusChannel.h"
 #include "vtkPlusDataCollector.h"
@@ -25,6 +28,12 @@ See License.txt for details.
 #endif
 
 // STD includes
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <iomanip>
+#include <map>
 #include <set>
 
 // VTK includes
@@ -36,11 +45,24 @@ See License.txt for details.
 
 vtkStandardNewMacro(vtkPlusDataCollector);
 
+namespace
+{
+  // Time between buffer size updates, long enough for the frame rate measurement to be meaningful
+  const double BUFFER_SIZING_INTERVAL_SEC = 1.0;
+  // Buffers are only resized if the size changes by more than this fraction, to avoid reallocating frames continuously
+  const double BUFFER_RESIZE_THRESHOLD = 0.1;
+}
+
 //----------------------------------------------------------------------------
 vtkPlusDataCollector::vtkPlusDataCollector()
   : vtkObject()
   , StartupDelaySec(0.0)
+  , ParallelConnectEnabled(false)
+  , BufferMemoryBudgetMB(0.0)
+  , BufferMemoryBudgetExceeded(false)
+  , BufferSizingActive(false)
   , DeviceFactory(vtkSmartPointer<vtkPlusDeviceFactory>::New())
+  , DeviceConfigurationVersion(0)
   , Connected(false)
   , Started(false)
 {
@@ -85,7 +107,7 @@ PlusStatus vtkPlusDataCollector::ReadConfiguration(vtkXMLDataElement* aConfig)
   if (this->Devices.size() > 0)
   {
     // ReadConfiguration is being called for the n-th time
-    LOG_ERROR("Repeated calls of vtkPlusDataCollector::ReadConfiguration are not permitted. Delete the data collector and re-create to connect to a different config file.");
+    LOG_ERROR("Repeated calls of vtkPlusDataCollector::ReadConfiguration are not permitted. Use ReloadConfiguration to apply a modified configuration, or delete the data collector and re-create to connect to a different config file.");
     return PLUS_FAIL;
   }
 
@@ -97,13 +119,10 @@ PlusStatus vtkPlusDataCollector::ReadConfiguration(vtkXMLDataElement* aConfig)
     return PLUS_FAIL;
   }
 
-  // Read StartupDelaySec
-  double startupDelaySec(0.0);
-  if (dataCollectionElement->GetScalarAttribute("StartupDelaySec", startupDelaySec))
-  {
-    this->SetStartupDelaySec(startupDelaySec);
-    LOG_DEBUG("StartupDelaySec: " << std::fixed << startupDelaySec);
-  }
+  // Replies computed from a partially created device list are not reused
+  this->DeviceConfigurationVersion++;
+
+  this->ReadDataCollectionParameters(dataCollectionElement);
 
   std::set<std::string> existingDeviceIds;
 
@@ -137,6 +156,7 @@ PlusStatus vtkPlusDataCollector::ReadConfiguration(vtkXMLDataElement* aConfig)
       continue;
     }
     device->SetDataCollector(this);
+    this->StoreDeviceConfiguration(deviceElement);
     if (device->ReadConfiguration(aConfig) != PLUS_SUCCESS)
     {
       LOG_ERROR("Failed to read parameters of device: " << deviceElement->GetAttribute("Id") << " (type: " << deviceElement->GetAttribute("Type") << ")");
@@ -186,55 +206,275 @@ PlusStatus vtkPlusDataCollector::ReadConfiguration(vtkXMLDataElement* aConfig)
       // not a valid Device element
       continue;
     }
-    vtkPlusDevice* thisDevice = NULL;
-    if (this->GetDevice(thisDevice, deviceElement->GetAttribute("Id")) != PLUS_SUCCESS)
+    if (this->ConnectInputChannels(deviceElement) != PLUS_SUCCESS)
     {
-      LOG_ERROR("Device " << deviceElement->GetAttribute("Id") << " does not exist.");
       return PLUS_FAIL;
     }
-    vtkXMLDataElement* inputChannelsElement = deviceElement->FindNestedElementWithName("InputChannels");
-    if (inputChannelsElement == NULL)
+  }
+
+  for (DeviceCollectionIterator it = this->Devices.begin(); it != this->Devices.end(); ++it)
+  {
+    if ((*it)->NotifyConfigured() != PLUS_SUCCESS)
     {
-      // no input channels, nothing to connect
-      continue;
+      LOG_ERROR("Device: " << (*it)->GetDeviceId() << " reports incorrect configuration. Please verify configuration.");
+      return PLUS_FAIL;
     }
-    for (int i = 0; i < inputChannelsElement->GetNumberOfNestedElements(); ++i)
+  }
+
+  this->DeviceConfigurationVersion++;
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusDataCollector::ReadDataCollectionParameters(vtkXMLDataElement* dataCollectionElement)
+{
+  // Read StartupDelaySec
+  double startupDelaySec(0.0);
+  if (dataCollectionElement->GetScalarAttribute("StartupDelaySec", startupDelaySec))
+  {
+    this->SetStartupDelaySec(startupDelaySec);
+    LOG_DEBUG("StartupDelaySec: " << std::fixed << startupDelaySec);
+  }
+
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(ParallelConnectEnabled, dataCollectionElement);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, BufferMemoryBudgetMB, dataCollectionElement);
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusDataCollector::StoreDeviceConfiguration(vtkXMLDataElement* deviceElement)
+{
+  vtkSmartPointer<vtkXMLDataElement> deviceConfiguration = vtkSmartPointer<vtkXMLDataElement>::New();
+  deviceConfiguration->DeepCopy(deviceElement);
+  this->DeviceConfigurations[deviceElement->GetAttribute("Id")] = deviceConfiguration;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDataCollector::ConnectInputChannels(vtkXMLDataElement* deviceElement)
+{
+  vtkPlusDevice* thisDevice = NULL;
+  if (this->GetDevice(thisDevice, deviceElement->GetAttribute("Id")) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Device " << deviceElement->GetAttribute("Id") << " does not exist.");
+    return PLUS_FAIL;
+  }
+  vtkXMLDataElement* inputChannelsElement = deviceElement->FindNestedElementWithName("InputChannels");
+  if (inputChannelsElement == NULL)
+  {
+    // no input channels, nothing to connect
+    return PLUS_SUCCESS;
+  }
+  for (int i = 0; i < inputChannelsElement->GetNumberOfNestedElements(); ++i)
+  {
+    vtkXMLDataElement* inputChannelElement = inputChannelsElement->GetNestedElement(i);
+    if (STRCASECMP(inputChannelElement->GetName(), "InputChannel") == 0)
     {
-      vtkXMLDataElement* inputChannelElement = inputChannelsElement->GetNestedElement(i);
-      if (STRCASECMP(inputChannelElement->GetName(), "InputChannel") == 0)
+      // We have an input channel, lets find it
+      const char* inputChannelId = inputChannelElement->GetAttribute("Id");
+      if (inputChannelId == NULL)
       {
-        // We have an input channel, lets find it
-        const char* inputChannelId = inputChannelElement->GetAttribute("Id");
-        if (inputChannelId == NULL)
-        {
-          LOG_ERROR("Device " << deviceElement->GetAttribute("Id") << " has an input channel without Id attribute.");
-          return PLUS_FAIL;
-        }
-        vtkPlusChannel* aChannel = NULL;
-        for (DeviceCollectionIterator it = Devices.begin(); it != Devices.end(); ++it)
-        {
-          vtkPlusDevice* device = (*it);
-          if (device->GetOutputChannelByName(aChannel, inputChannelId) == PLUS_SUCCESS)
-          {
-            // Found it!
-            break;
-          }
-        }
-        if (aChannel == NULL)
-        {
-          LOG_ERROR("Device " << deviceElement->GetAttribute("Id") << " is specified to use channel " << inputChannelId << " as input, but an output channel by this Id does not exist");
-          return PLUS_FAIL;
-        }
-        if (thisDevice->AddInputChannel(aChannel) != PLUS_SUCCESS)
+        LOG_ERROR("Device " << deviceElement->GetAttribute("Id") << " has an input channel without Id attribute.");
+        return PLUS_FAIL;
+      }
+      vtkPlusChannel* aChannel = NULL;
+      for (DeviceCollectionIterator it = Devices.begin(); it != Devices.end(); ++it)
+      {
+        vtkPlusDevice* device = (*it);
+        if (device->GetOutputChannelByName(aChannel, inputChannelId) == PLUS_SUCCESS)
         {
-          LOG_ERROR("Failed to add input channel " << inputChannelId << " to device " << deviceElement->GetAttribute("Id"));
-          return PLUS_FAIL;
+          // Found it!
+          break;
         }
       }
+      if (aChannel == NULL)
+      {
+        LOG_ERROR("Device " << deviceElement->GetAttribute("Id") << " is specified to use channel " << inputChannelId << " as input, but an output channel by this Id does not exist");
+        return PLUS_FAIL;
+      }
+      if (thisDevice->AddInputChannel(aChannel) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to add input channel " << inputChannelId << " to device " << deviceElement->GetAttribute("Id"));
+        return PLUS_FAIL;
+      }
+    }
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDataCollector::ReloadConfiguration(vtkXMLDataElement* aConfig, std::vector<std::string>* recreatedDeviceIds/*=NULL*/)
+{
+  LOG_TRACE("vtkPlusDataCollector::ReloadConfiguration()");
+
+  if (recreatedDeviceIds != NULL)
+  {
+    recreatedDeviceIds->clear();
+  }
+  if (this->Devices.empty())
+  {
+    // Nothing is running yet, this is a normal configuration
+    return this->ReadConfiguration(aConfig);
+  }
+
+  vtkXMLDataElement* dataCollectionElement = (aConfig == NULL ? NULL : aConfig->FindNestedElementWithName("DataCollection"));
+  if (dataCollectionElement == NULL)
+  {
+    LOG_ERROR("Unable to find data collection element in XML tree!");
+    return PLUS_FAIL;
+  }
+
+  // The buffer sizing thread iterates the devices, it is restarted when the devices are in place again
+  this->StopBufferSizing();
+  this->DeviceConfigurationVersion++;
+
+  // Device elements of the new configuration, in configuration order
+  std::vector<vtkXMLDataElement*> deviceElements;
+  std::map<std::string, vtkXMLDataElement*> deviceElementsById;
+  for (int i = 0; i < dataCollectionElement->GetNumberOfNestedElements(); ++i)
+  {
+    vtkXMLDataElement* deviceElement = dataCollectionElement->GetNestedElement(i);
+    if (deviceElement == NULL || STRCASECMP(deviceElement->GetName(), "Device") != 0)
+    {
+      continue;
+    }
+    const char* deviceId = deviceElement->GetAttribute("Id");
+    if (deviceId == NULL)
+    {
+      LOG_ERROR("Device of type " << (deviceElement->GetAttribute("Type") == NULL ? "UNDEFINED" : deviceElement->GetAttribute("Type")) << " has no Id attribute");
+      return PLUS_FAIL;
+    }
+    if (!deviceElementsById.insert(std::make_pair(std::string(deviceId), deviceElement)).second)
+    {
+      LOG_ERROR("Multiple devices exist with the same Id: \'" << deviceId << "\'");
+      return PLUS_FAIL;
     }
+    deviceElements.push_back(deviceElement);
   }
 
+  // Running devices are replaced if their element changed or was removed
+  std::set<vtkPlusDevice*> replacedDevices;
   for (DeviceCollectionIterator it = this->Devices.begin(); it != this->Devices.end(); ++it)
+  {
+    std::map<std::string, vtkXMLDataElement*>::iterator newElementIt = deviceElementsById.find((*it)->GetDeviceId());
+    std::map<std::string, vtkSmartPointer<vtkXMLDataElement> >::iterator oldElementIt = this->DeviceConfigurations.find((*it)->GetDeviceId());
+    if (newElementIt == deviceElementsById.end() || oldElementIt == this->DeviceConfigurations.end())
+    {
+      replacedDevices.insert(*it);
+      continue;
+    }
+    std::ostringstream newXml;
+    igsioCommon::XML::PrintXML(newXml, vtkIndent(0), newElementIt->second);
+    std::ostringstream oldXml;
+    igsioCommon::XML::PrintXML(oldXml, vtkIndent(0), oldElementIt->second);
+    if (newXml.str() != oldXml.str())
+    {
+      replacedDevices.insert(*it);
+    }
+  }
+
+  // Devices that use the output of a replaced device are replaced as well, as their input channels would become invalid
+  std::vector<vtkPlusDevice*> keptDevices;
+  for (DeviceCollectionIterator it = this->Devices.begin(); it != this->Devices.end(); ++it)
+  {
+    std::vector<vtkPlusDevice*> inputDevices;
+    (*it)->GetInputDevicesRecursive(inputDevices);
+    for (std::vector<vtkPlusDevice*>::iterator inputIt = inputDevices.begin(); inputIt != inputDevices.end(); ++inputIt)
+    {
+      if (replacedDevices.count(*inputIt) > 0)
+      {
+        replacedDevices.insert(*it);
+        break;
+      }
+    }
+    if (replacedDevices.count(*it) == 0)
+    {
+      keptDevices.push_back(*it);
+    }
+  }
+
+  // Disconnect the replaced devices, devices that use the output of other devices first
+  std::vector<std::pair<size_t, vtkPlusDevice*> > devicesToDisconnect;
+  for (std::set<vtkPlusDevice*>::iterator it = replacedDevices.begin(); it != replacedDevices.end(); ++it)
+  {
+    std::vector<vtkPlusDevice*> inputDevices;
+    (*it)->GetInputDevicesRecursive(inputDevices);
+    devicesToDisconnect.push_back(std::make_pair(inputDevices.size(), *it));
+  }
+  std::sort(devicesToDisconnect.begin(), devicesToDisconnect.end(), [](const std::pair<size_t, vtkPlusDevice*>& a, const std::pair<size_t, vtkPlusDevice*>& b)
+  {
+    return a.first > b.first;
+  });
+  for (std::vector<std::pair<size_t, vtkPlusDevice*> >::iterator it = devicesToDisconnect.begin(); it != devicesToDisconnect.end(); ++it)
+  {
+    vtkPlusDevice* device = it->second;
+    LOG_INFO("Device " << device->GetDeviceId() << " configuration changed, reconnecting");
+    if (device->Disconnect() != PLUS_SUCCESS)
+    {
+      LOG_WARNING("Unable to disconnect device: " << device->GetDeviceId() << ".");
+    }
+    this->DeviceConfigurations.erase(device->GetDeviceId());
+  }
+  for (std::vector<std::pair<size_t, vtkPlusDevice*> >::iterator it = devicesToDisconnect.begin(); it != devicesToDisconnect.end(); ++it)
+  {
+    it->second->Delete();
+  }
+  this->Devices = keptDevices;
+
+  this->ReadDataCollectionParameters(dataCollectionElement);
+
+  // Create the new and changed devices
+  std::vector<vtkXMLDataElement*> createdDeviceElements;
+  DeviceCollection createdDevices;
+  for (std::vector<vtkXMLDataElement*>::iterator elementIt = deviceElements.begin(); elementIt != deviceElements.end(); ++elementIt)
+  {
+    vtkXMLDataElement* deviceElement = *elementIt;
+    vtkPlusDevice* device = NULL;
+    if (this->GetDevice(device, deviceElement->GetAttribute("Id")) == PLUS_SUCCESS)
+    {
+      // Kept device
+      continue;
+    }
+    if (this->DeviceFactory->CreateInstance(deviceElement->GetAttribute("Type"), device, deviceElement->GetAttribute("Id")) == PLUS_FAIL)
+    {
+      LOG_ERROR("Unable to create device: " << deviceElement->GetAttribute("Type"));
+      return PLUS_FAIL;
+    }
+    device->SetDataCollector(this);
+    this->StoreDeviceConfiguration(deviceElement);
+    this->Devices.push_back(device);
+    if (device->ReadConfiguration(aConfig) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to read parameters of device: " << deviceElement->GetAttribute("Id") << " (type: " << deviceElement->GetAttribute("Type") << ")");
+      return PLUS_FAIL;
+    }
+    createdDeviceElements.push_back(deviceElement);
+    createdDevices.push_back(device);
+    if (recreatedDeviceIds != NULL)
+    {
+      recreatedDeviceIds->push_back(device->GetDeviceId());
+    }
+  }
+
+  // Keep the configuration order of the devices
+  DeviceCollection orderedDevices;
+  for (std::vector<vtkXMLDataElement*>::iterator elementIt = deviceElements.begin(); elementIt != deviceElements.end(); ++elementIt)
+  {
+    vtkPlusDevice* device = NULL;
+    if (this->GetDevice(device, (*elementIt)->GetAttribute("Id")) == PLUS_SUCCESS)
+    {
+      orderedDevices.push_back(device);
+    }
+  }
+  this->Devices = orderedDevices;
+
+  for (std::vector<vtkXMLDataElement*>::iterator elementIt = createdDeviceElements.begin(); elementIt != createdDeviceElements.end(); ++elementIt)
+  {
+    if (this->ConnectInputChannels(*elementIt) != PLUS_SUCCESS)
+    {
+      return PLUS_FAIL;
+    }
+  }
+  for (DeviceCollectionIterator it = createdDevices.begin(); it != createdDevices.end(); ++it)
   {
     if ((*it)->NotifyConfigured() != PLUS_SUCCESS)
     {
@@ -243,7 +483,47 @@ PlusStatus vtkPlusDataCollector::ReadConfiguration(vtkXMLDataElement* aConfig)
     }
   }
 
-  return PLUS_SUCCESS;
+  LOG_INFO("Configuration reloaded: " << createdDevices.size() << " devices recreated, " << keptDevices.size() << " devices kept running");
+
+  // Bring the new devices to the state of the data collector
+  PlusStatus status = PLUS_SUCCESS;
+  if (this->Connected)
+  {
+    status = this->ProcessDevices(createdDevices, "connect", [](vtkPlusDevice * device)
+    {
+      PlusStatus deviceStatus = device->Connect();
+      if (deviceStatus != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Unable to connect device: " << device->GetDeviceId() << ".");
+      }
+      return deviceStatus;
+    });
+    if (this->SetLoopTimes() != PLUS_SUCCESS)
+    {
+      LOG_WARNING("Failed to set loop times!");
+    }
+  }
+  if (this->Started && status == PLUS_SUCCESS)
+  {
+    const double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+    status = this->ProcessDevices(createdDevices, "start", [startTime](vtkPlusDevice * device)
+    {
+      PlusStatus deviceStatus = device->StartRecording();
+      if (deviceStatus != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to start data acquisition for device " << device->GetDeviceId() << ".");
+      }
+      device->SetStartTime(startTime);
+      return deviceStatus;
+    });
+  }
+  if (this->Started)
+  {
+    this->StartBufferSizing();
+  }
+  this->DeviceConfigurationVersion++;
+
+  return status;
 }
 
 //----------------------------------------------------------------------------
@@ -281,6 +561,22 @@ PlusStatus vtkPlusDataCollector::WriteConfiguration(vtkXMLDataElement* aConfig)
   }
 
   dataCollectionConfig->SetDoubleAttribute("StartupDelaySec", GetStartupDelaySec());
+  if (this->ParallelConnectEnabled)
+  {
+    dataCollectionConfig->SetAttribute("ParallelConnectEnabled", "TRUE");
+  }
+  else
+  {
+    dataCollectionConfig->RemoveAttribute("ParallelConnectEnabled");
+  }
+  if (this->BufferMemoryBudgetMB > 0)
+  {
+    dataCollectionConfig->SetDoubleAttribute("BufferMemoryBudgetMB", this->BufferMemoryBudgetMB);
+  }
+  else
+  {
+    dataCollectionConfig->RemoveAttribute("BufferMemoryBudgetMB");
+  }
 
   PlusStatus status = PLUS_SUCCESS;
 
@@ -322,24 +618,30 @@ PlusStatus vtkPlusDataCollector::Start()
 
   const double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
 
-  for (DeviceCollectionIterator it = Devices.begin(); it != Devices.end(); ++ it)
-  {
-    vtkPlusDevice* device = *it;
+  // Replayed data is not delivered until all consumers are started
+  PlusReplayClock::GetInstance().SetPaused(true);
 
-    if (device->StartRecording() != PLUS_SUCCESS)
+  status = this->ProcessDevices(this->Devices, "start", [startTime](vtkPlusDevice * device)
+  {
+    PlusStatus deviceStatus = device->StartRecording();
+    if (deviceStatus != PLUS_SUCCESS)
     {
       LOG_ERROR("Failed to start data acquisition for device " << device->GetDeviceId() << ".");
-      status = PLUS_FAIL;
     }
     device->SetStartTime(startTime);
-  }
+    return deviceStatus;
+  });
 
   LOG_DEBUG("vtkPlusDataCollector::Start -- wait " << std::fixed << this->StartupDelaySec << " sec for buffer init...");
 
   vtkIGSIOAccurateTimer::DelayWithEventProcessing(this->StartupDelaySec);
 
+  PlusReplayClock::GetInstance().SetPaused(false);
+
   this->Started = true;
 
+  this->StartBufferSizing();
+
   return status;
 }
 
@@ -348,29 +650,217 @@ PlusStatus vtkPlusDataCollector::Stop()
 {
   LOG_TRACE("vtkPlusDataCollector::Stop()");
 
+  this->StopBufferSizing();
+
   this->Started = false;
 
   return PLUS_SUCCESS;
 }
 
 //----------------------------------------------------------------------------
-PlusStatus vtkPlusDataCollector::Connect()
+void vtkPlusDataCollector::GetAllBuffers(std::vector<vtkPlusBuffer*>& buffers, std::vector<std::string>* owners /*= NULL*/) const
 {
-  LOG_TRACE("vtkPlusDataCollector::Connect()");
+  buffers.clear();
+  if (owners != NULL)
+  {
+    owners->clear();
+  }
+  std::set<vtkPlusBuffer*> addedBuffers;
+  for (DeviceCollectionConstIterator deviceIt = this->Devices.begin(); deviceIt != this->Devices.end(); ++deviceIt)
+  {
+    vtkPlusDevice* device = *deviceIt;
+    std::vector<std::pair<DataSourceContainerConstIterator, DataSourceContainerConstIterator> > sourceRanges;
+    sourceRanges.push_back(std::make_pair(device->GetVideoSourceIteratorBegin(), device->GetVideoSourceIteratorEnd()));
+    sourceRanges.push_back(std::make_pair(device->GetToolIteratorBegin(), device->GetToolIteratorEnd()));
+    sourceRanges.push_back(std::make_pair(device->GetFieldDataSourcessIteratorBegin(), device->GetFieldDataSourcessIteratorEnd()));
+    for (auto rangeIt = sourceRanges.begin(); rangeIt != sourceRanges.end(); ++rangeIt)
+    {
+      for (DataSourceContainerConstIterator sourceIt = rangeIt->first; sourceIt != rangeIt->second; ++sourceIt)
+      {
+        vtkPlusBuffer* buffer = sourceIt->second->GetBuffer();
+        if (buffer != NULL && addedBuffers.insert(buffer).second)
+        {
+          buffers.push_back(buffer);
+          if (owners != NULL)
+          {
+            owners->push_back(device->GetDeviceId() + "/" + sourceIt->second->GetSourceId());
+          }
+        }
+      }
+    }
+  }
+}
 
-  PlusStatus status = PLUS_SUCCESS;
+//----------------------------------------------------------------------------
+unsigned long long vtkPlusDataCollector::GetMemoryUsage(std::vector<BufferMemoryReport>& bufferReports, std::map<std::string, unsigned long long>& deviceInternalBytes) const
+{
+  unsigned long long totalBytes = 0;
 
-  for (DeviceCollectionIterator it = Devices.begin(); it != Devices.end(); ++ it)
+  std::vector<vtkPlusBuffer*> buffers;
+  std::vector<std::string> owners;
+  this->GetAllBuffers(buffers, &owners);
+  bufferReports.clear();
+  for (unsigned int i = 0; i < buffers.size(); ++i)
   {
-    vtkPlusDevice* device = *it;
+    BufferMemoryReport report;
+    report.Owner = owners[i];
+    report.BufferSize = buffers[i]->GetBufferSize();
+    report.NumberOfItems = buffers[i]->GetNumberOfItems();
+    buffers[i]->GetMemoryUsage(report.Usage);
+    totalBytes += report.Usage.GetTotalBytes();
+    bufferReports.push_back(report);
+  }
+
+  deviceInternalBytes.clear();
+  for (DeviceCollectionConstIterator deviceIt = this->Devices.begin(); deviceIt != this->Devices.end(); ++deviceIt)
+  {
+    unsigned long long usedBytes = (*deviceIt)->GetInternalMemoryUsageInBytes();
+    deviceInternalBytes[(*deviceIt)->GetDeviceId()] = usedBytes;
+    totalBytes += usedBytes;
+  }
+
+  return totalBytes;
+}
 
-    if (device->Connect() != PLUS_SUCCESS)
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDataCollector::UpdateBufferSizes()
+{
+  std::vector<vtkPlusBuffer*> buffers;
+  this->GetAllBuffers(buffers);
+
+  // Memory of the buffers with fixed size and the requested memory of the buffers sized by time
+  unsigned long long fixedSizeBytes = 0;
+  unsigned long long requestedDurationBasedBytes = 0;
+  std::vector<std::pair<vtkPlusBuffer*, int> > requestedSizes;
+  for (std::vector<vtkPlusBuffer*>::iterator it = buffers.begin(); it != buffers.end(); ++it)
+  {
+    vtkPlusBuffer* buffer = *it;
+    unsigned long long itemSizeBytes = buffer->GetItemSizeInBytes();
+    if (buffer->GetBufferDurationSec() > 0)
     {
-      LOG_ERROR("Unable to connect device: " << device->GetDeviceId() << ".");
+      int requestedSize = buffer->GetBufferSizeForDuration();
+      requestedSizes.push_back(std::make_pair(buffer, requestedSize));
+      requestedDurationBasedBytes += itemSizeBytes * requestedSize;
+    }
+    else
+    {
+      fixedSizeBytes += itemSizeBytes * buffer->GetBufferSize();
+    }
+  }
+
+  // Scale down the buffers sized by time if the total exceeds the budget
+  double scale = 1.0;
+  const unsigned long long budgetBytes = static_cast<unsigned long long>(this->BufferMemoryBudgetMB * 1024.0 * 1024.0);
+  bool budgetExceeded = (budgetBytes > 0 && fixedSizeBytes + requestedDurationBasedBytes > budgetBytes);
+  if (budgetExceeded && requestedDurationBasedBytes > 0)
+  {
+    unsigned long long availableBytes = (budgetBytes > fixedSizeBytes ? budgetBytes - fixedSizeBytes : 0);
+    scale = static_cast<double>(availableBytes) / requestedDurationBasedBytes;
+  }
+  if (budgetExceeded != this->BufferMemoryBudgetExceeded)
+  {
+    if (budgetExceeded)
+    {
+      LOG_WARNING("Buffers would use " << (fixedSizeBytes + requestedDurationBasedBytes) / (1024 * 1024) << " MB, which exceeds the memory budget of "
+                  << this->BufferMemoryBudgetMB << " MB (fixed size buffers: " << fixedSizeBytes / (1024 * 1024) << " MB). Buffers sized by time are reduced to "
+                  << std::fixed << std::setprecision(0) << scale * 100.0 << "% of their requested duration.");
+    }
+    else
+    {
+      LOG_INFO("Buffers fit in the memory budget of " << this->BufferMemoryBudgetMB << " MB again");
+    }
+    this->BufferMemoryBudgetExceeded = budgetExceeded;
+  }
+
+  PlusStatus status = PLUS_SUCCESS;
+  for (std::vector<std::pair<vtkPlusBuffer*, int> >::iterator it = requestedSizes.begin(); it != requestedSizes.end(); ++it)
+  {
+    vtkPlusBuffer* buffer = it->first;
+    int newSize = std::max(static_cast<int>(it->second * scale), vtkPlusBuffer::MINIMUM_DURATION_BASED_BUFFER_SIZE);
+    int currentSize = buffer->GetBufferSize();
+    bool mustShrink = (budgetExceeded && newSize < currentSize);
+    if (!mustShrink && std::abs(newSize - currentSize) <= currentSize * BUFFER_RESIZE_THRESHOLD)
+    {
+      continue;
+    }
+    LOG_DEBUG("Resize buffer " << (buffer->GetDescriptiveName() ? buffer->GetDescriptiveName() : "") << " from " << currentSize << " to " << newSize
+              << " items (" << buffer->GetBufferDurationSec() << " sec requested)");
+    if (buffer->SetBufferSize(newSize) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to resize buffer " << (buffer->GetDescriptiveName() ? buffer->GetDescriptiveName() : "") << " to " << newSize << " items");
       status = PLUS_FAIL;
     }
   }
 
+  return status;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusDataCollector::StartBufferSizing()
+{
+  this->StopBufferSizing();
+  this->UpdateBufferSizes();
+
+  std::vector<vtkPlusBuffer*> buffers;
+  this->GetAllBuffers(buffers);
+  bool durationBasedBufferFound = false;
+  for (std::vector<vtkPlusBuffer*>::iterator it = buffers.begin(); it != buffers.end(); ++it)
+  {
+    if ((*it)->GetBufferDurationSec() > 0)
+    {
+      durationBasedBufferFound = true;
+      break;
+    }
+  }
+  if (!durationBasedBufferFound)
+  {
+    // all buffers have fixed size, nothing to update
+    return;
+  }
+
+  this->BufferSizingActive = true;
+  this->BufferSizingThread = std::thread([this]()
+  {
+    std::unique_lock<std::mutex> lock(this->BufferSizingMutex);
+    while (!this->BufferSizingCondition.wait_for(lock, std::chrono::duration<double>(BUFFER_SIZING_INTERVAL_SEC), [this]() { return !this->BufferSizingActive; }))
+    {
+      lock.unlock();
+      this->UpdateBufferSizes();
+      lock.lock();
+    }
+  });
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusDataCollector::StopBufferSizing()
+{
+  if (!this->BufferSizingThread.joinable())
+  {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(this->BufferSizingMutex);
+    this->BufferSizingActive = false;
+  }
+  this->BufferSizingCondition.notify_all();
+  this->BufferSizingThread.join();
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDataCollector::Connect()
+{
+  LOG_TRACE("vtkPlusDataCollector::Connect()");
+
+  PlusStatus status = this->ProcessDevices(this->Devices, "connect", [](vtkPlusDevice * device)
+  {
+    PlusStatus deviceStatus = device->Connect();
+    if (deviceStatus != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Unable to connect device: " << device->GetDeviceId() << ".");
+    }
+    return deviceStatus;
+  });
+
   if (status != PLUS_SUCCESS)
   {
     this->Disconnect();
@@ -387,6 +877,84 @@ PlusStatus vtkPlusDataCollector::Connect()
   return status;
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDataCollector::ProcessDevices(const DeviceCollection& devices, const std::string& operationName, const std::function<PlusStatus(vtkPlusDevice*)>& operation)
+{
+  PlusStatus status = PLUS_SUCCESS;
+
+  if (!this->ParallelConnectEnabled)
+  {
+    for (DeviceCollectionConstIterator it = devices.begin(); it != devices.end(); ++it)
+    {
+      const double deviceStartTime = vtkIGSIOAccurateTimer::GetSystemTime();
+      if (operation(*it) != PLUS_SUCCESS)
+      {
+        status = PLUS_FAIL;
+      }
+      LOG_INFO("Device " << (*it)->GetDeviceId() << ": " << operationName << " took " << std::fixed << std::setprecision(2) << vtkIGSIOAccurateTimer::GetSystemTime() - deviceStartTime << " sec");
+    }
+    return status;
+  }
+
+  // Process the devices in waves: all devices whose input devices are already processed are processed concurrently
+  const double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+  std::vector<vtkPlusDevice*> pendingDevices(devices.begin(), devices.end());
+  while (!pendingDevices.empty())
+  {
+    std::set<vtkPlusDevice*> pendingDeviceSet(pendingDevices.begin(), pendingDevices.end());
+    std::vector<vtkPlusDevice*> readyDevices;
+    std::vector<vtkPlusDevice*> waitingDevices;
+    for (std::vector<vtkPlusDevice*>::iterator it = pendingDevices.begin(); it != pendingDevices.end(); ++it)
+    {
+      std::vector<vtkPlusDevice*> inputDevices;
+      (*it)->GetInputDevicesRecursive(inputDevices);
+      bool inputDevicesPending = false;
+      for (std::vector<vtkPlusDevice*>::iterator inputIt = inputDevices.begin(); inputIt != inputDevices.end(); ++inputIt)
+      {
+        if (*inputIt != *it && pendingDeviceSet.count(*inputIt) > 0)
+        {
+          inputDevicesPending = true;
+          break;
+        }
+      }
+      (inputDevicesPending ? waitingDevices : readyDevices).push_back(*it);
+    }
+    if (readyDevices.empty())
+    {
+      LOG_ERROR("Unable to " << operationName << " devices: circular input channel dependency between the remaining " << waitingDevices.size() << " devices");
+      return PLUS_FAIL;
+    }
+
+    std::map<vtkPlusDevice*, std::future<PlusStatus> > results;
+    std::map<vtkPlusDevice*, double> durationsSec;
+    for (std::vector<vtkPlusDevice*>::iterator it = readyDevices.begin(); it != readyDevices.end(); ++it)
+    {
+      vtkPlusDevice* device = *it;
+      double& durationSec = durationsSec[device];
+      results[device] = std::async(std::launch::async, [&operation, device, &durationSec]()
+      {
+        const double deviceStartTime = vtkIGSIOAccurateTimer::GetSystemTime();
+        PlusStatus deviceStatus = operation(device);
+        durationSec = vtkIGSIOAccurateTimer::GetSystemTime() - deviceStartTime;
+        return deviceStatus;
+      });
+    }
+    for (std::vector<vtkPlusDevice*>::iterator it = readyDevices.begin(); it != readyDevices.end(); ++it)
+    {
+      if (results[*it].get() != PLUS_SUCCESS)
+      {
+        status = PLUS_FAIL;
+      }
+      LOG_INFO("Device " << (*it)->GetDeviceId() << ": " << operationName << " took " << std::fixed << std::setprecision(2) << durationsSec[*it] << " sec");
+    }
+
+    pendingDevices = waitingDevices;
+  }
+  LOG_INFO("All devices: " << operationName << " took " << std::fixed << std::setprecision(2) << vtkIGSIOAccurateTimer::GetSystemTime() - startTime << " sec");
+
+  return status;
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusDataCollector::Disconnect()
 {
@@ -513,6 +1081,23 @@ DeviceCollectionConstIterator vtkPlusDataCollector::GetDeviceConstIteratorEnd()
   return this->Devices.end();
 }
 
+//----------------------------------------------------------------------------
+namespace
+{
+  /*! Get the UIDs and timestamps of all items of the source acquired after timestampFrom and update timestampFrom to the latest one */
+  void GetItemTimeStampsAfter(vtkPlusDataSource* source, double& timestampFrom, std::vector<BufferItemUidType>& uids, std::vector<double>& timestamps)
+  {
+    source->GetItemTimeStamps(source->GetOldestItemUidInBuffer(), source->GetLatestItemUidInBuffer(), uids, timestamps);
+    std::vector<double>::iterator firstNewTimestamp = std::upper_bound(timestamps.begin(), timestamps.end(), timestampFrom);
+    uids.erase(uids.begin(), uids.begin() + (firstNewTimestamp - timestamps.begin()));
+    timestamps.erase(timestamps.begin(), firstNewTimestamp);
+    if (!timestamps.empty())
+    {
+      timestampFrom = timestamps.back();
+    }
+  }
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusDataCollector::GetTrackingData(vtkPlusChannel* aRequestedChannel, double& aTimestampFrom, vtkIGSIOTrackedFrameList* aTrackedFrameList)
 {
@@ -545,36 +1130,27 @@ PlusStatus vtkPlusDataCollector::GetTrackingData(vtkPlusChannel* aRequestedChann
     return PLUS_SUCCESS;
   }
 
-  PlusStatus status = PLUS_SUCCESS;
-  BufferItemUidType oldestItemUid = firstActiveTool->GetOldestItemUidInBuffer();
-  BufferItemUidType latestItemUid = firstActiveTool->GetLatestItemUidInBuffer();
-  for (BufferItemUidType itemUid = oldestItemUid; itemUid <= latestItemUid; ++itemUid)
+  // Collect the items acquired after the requested start time, then get the tracking data at their timestamps in parallel
+  std::vector<BufferItemUidType> itemUids;
+  std::vector<double> itemTimestamps;
+  GetItemTimeStampsAfter(firstActiveTool, aTimestampFrom, itemUids, itemTimestamps);
+
+  std::vector<igsioTrackedFrame*> trackedFrames;
+  PlusTrackedFrameAssembly::AssembleFrames(static_cast<int>(itemTimestamps.size()), [aRequestedChannel, &itemTimestamps](int frameIndex, igsioTrackedFrame & trackedFrame)
   {
-    double itemTimestamp = 0;
-    if (firstActiveTool->GetTimeStamp(itemUid, itemTimestamp) != ITEM_OK)
-    {
-      // probably the buffer item is not available anymore
-      continue;
-    }
-    if (itemTimestamp <= aTimestampFrom)
+    if (aRequestedChannel->GetTrackedFrame(itemTimestamps[frameIndex], trackedFrame, false /* get tracking data only */) != PLUS_SUCCESS)
     {
-      // this item has been acquired before the requested start time
-      continue;
-    }
-    aTimestampFrom = itemTimestamp;
-    // Get tracked frame from buffer
-    igsioTrackedFrame* trackedFrame = new igsioTrackedFrame;
-    if (aRequestedChannel->GetTrackedFrame(itemTimestamp, *trackedFrame, false /* get tracking data only */) != PLUS_SUCCESS)
-    {
-      LOG_ERROR("Unable to get tracking data by time: " << std::fixed << itemTimestamp);
-      status = PLUS_FAIL;
-    }
-    // Add tracked frame to the list
-    if (aTrackedFrameList->TakeTrackedFrame(trackedFrame, vtkIGSIOTrackedFrameList::SKIP_INVALID_FRAME) != PLUS_SUCCESS)
-    {
-      LOG_ERROR("Unable to add tracking data to the list!");
-      status = PLUS_FAIL;
+      LOG_ERROR("Unable to get tracking data by time: " << std::fixed << itemTimestamps[frameIndex]);
+      return PLUS_FAIL;
     }
+    return PLUS_SUCCESS;
+  }, trackedFrames);
+
+  // Add tracked frames to the list
+  PlusStatus status = PlusTrackedFrameAssembly::TakeFrames(trackedFrames, aTrackedFrameList, vtkIGSIOTrackedFrameList::SKIP_INVALID_FRAME);
+  if (status != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to add tracking data to the list!");
   }
 
   return status;
@@ -599,50 +1175,56 @@ PlusStatus vtkPlusDataCollector::GetVideoData(vtkPlusChannel* aRequestedChannel,
     return PLUS_SUCCESS;
   }
 
-  PlusStatus status = PLUS_SUCCESS;
-  BufferItemUidType oldestItemUid = aSource->GetOldestItemUidInBuffer();
-  BufferItemUidType latestItemUid = aSource->GetLatestItemUidInBuffer();
-  for (BufferItemUidType itemUid = oldestItemUid; itemUid <= latestItemUid; ++itemUid)
+  // Snapshot the buffer, so that the frames acquired after the requested start time remain readable while they are copied in parallel
+  PlusBufferSnapshot snapshot;
+  if (aSource->CaptureSnapshot(snapshot) != PLUS_SUCCESS)
   {
-    double itemTimestamp = 0;
-    if (aSource->GetTimeStamp(itemUid, itemTimestamp) != ITEM_OK)
-    {
-      // probably the buffer item is not available anymore
-      continue;
-    }
-    if (itemTimestamp <= aTimestampFrom)
-    {
-      // this item has been acquired before the requested start time
-      continue;
-    }
-    aTimestampFrom = itemTimestamp;
-    // Get tracked frame from buffer
-    igsioTrackedFrame* trackedFrame = new igsioTrackedFrame;
+    LOG_ERROR("Unable to get video data - failed to capture the video buffer");
+    return PLUS_FAIL;
+  }
+  BufferItemUidType firstItemUid = snapshot.GetOldestItemUid();
+  double itemTimestamp = 0;
+  while (snapshot.GetTimeStamp(firstItemUid, itemTimestamp) == ITEM_OK && itemTimestamp <= aTimestampFrom)
+  {
+    // this item has been acquired before the requested start time
+    ++firstItemUid;
+  }
+  const int numberOfItems = static_cast<int>(snapshot.GetLatestItemUid() + 1 - firstItemUid);
+  if (numberOfItems > 0)
+  {
+    snapshot.GetTimeStamp(snapshot.GetLatestItemUid(), aTimestampFrom);
+  }
+
+  std::vector<igsioTrackedFrame*> trackedFrames;
+  PlusTrackedFrameAssembly::AssembleFrames(numberOfItems, [&snapshot, firstItemUid](int frameIndex, igsioTrackedFrame & trackedFrame)
+  {
+    BufferItemUidType itemUid = firstItemUid + frameIndex;
     StreamBufferItem currentStreamBufferItem;
-    if (aSource->GetStreamBufferItem(itemUid, &currentStreamBufferItem) != ITEM_OK)
+    double itemTimestamp = 0;
+    if (snapshot.GetStreamBufferItem(itemUid, &currentStreamBufferItem) != ITEM_OK || snapshot.GetTimeStamp(itemUid, itemTimestamp) != ITEM_OK)
     {
       LOG_ERROR("Couldn't get video buffer item by frame UID: " << itemUid);
-      delete trackedFrame;
       return PLUS_FAIL;
     }
 
     // Copy frame
-    trackedFrame->SetImageData(currentStreamBufferItem.GetFrame());
-    trackedFrame->SetTimestamp(itemTimestamp);
+    trackedFrame.SetImageData(currentStreamBufferItem.GetFrame());
+    trackedFrame.SetTimestamp(itemTimestamp);
 
     // Copy all custom fields
-    igsioFieldMapType fieldMap = currentStreamBufferItem.GetFrameFieldMap();
+    const igsioFieldMapType& fieldMap = currentStreamBufferItem.GetFrameFieldMap();
     for (igsioFieldMapType::const_iterator fieldIterator = fieldMap.begin(); fieldIterator != fieldMap.end(); fieldIterator++)
     {
-      trackedFrame->SetFrameField(fieldIterator->first, fieldIterator->second.second, fieldIterator->second.first);
+      trackedFrame.SetFrameField(fieldIterator->first, fieldIterator->second.second, fieldIterator->second.first);
     }
+    return PLUS_SUCCESS;
+  }, trackedFrames);
 
-    // Add tracked frame to the list
-    if (aTrackedFrameList->TakeTrackedFrame(trackedFrame, vtkIGSIOTrackedFrameList::SKIP_INVALID_FRAME) != PLUS_SUCCESS)
-    {
-      LOG_ERROR("Unable to add video data to the list!");
-      status = PLUS_FAIL;
-    }
+  // Add tracked frames to the list
+  PlusStatus status = PlusTrackedFrameAssembly::TakeFrames(trackedFrames, aTrackedFrameList, vtkIGSIOTrackedFrameList::SKIP_INVALID_FRAME);
+  if (status != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to add video data to the list!");
   }
 
   return status;
@@ -729,6 +1311,7 @@ PlusStatus vtkPlusDataCollector::AddDevice(vtkPlusDevice* aDevice)
 
   aDevice->SetDataCollector(this);
   Devices.push_back(aDevice);
+  this->DeviceConfigurationVersion++;
   return PLUS_SUCCESS;
 }
 
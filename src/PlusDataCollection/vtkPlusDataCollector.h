@@ -15,6 +15,14 @@ See License.txt for details.
 // VTK includes
 #include <vtkObject.h>
 
+// STL includes
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+
 //class igsioTrackedFrame; 
 class vtkPlusChannel;
 class vtkPlusDeviceFactory;
@@ -41,6 +49,18 @@ public:
   */
   PlusStatus ReadConfiguration(vtkXMLDataElement* aConfig);
   PlusStatus ReadConfiguration(const std::string& fileName);
+
+  /*!
+    Apply a modified configuration to a data collector that has already been configured (and possibly connected and started).
+    Only devices whose Device element changed, new devices, and devices that receive input channels from these are recreated,
+    and they are brought into the connected/started state of the data collector. Unchanged devices keep their hardware
+    connection and buffers. Devices that are no longer in the configuration are disconnected and removed.
+    Objects that hold pointers to channels or devices of recreated devices (e.g., an OpenIGTLink server broadcasting
+    one of their channels) must be restarted by the caller.
+    If it fails then the data collector should be deleted and recreated from the configuration.
+    \param recreatedDeviceIds If not NULL then it is set to the ids of the devices that have been recreated
+  */
+  PlusStatus ReloadConfiguration(vtkXMLDataElement* aConfig, std::vector<std::string>* recreatedDeviceIds = NULL);
   /*!
   Write main configuration to xml data
   */
@@ -91,6 +111,13 @@ public:
   */
   PlusStatus AddDevice(vtkPlusDevice* aDevice);
 
+  /*!
+    Counter that is incremented whenever devices are added, removed or reconfigured.
+    Replies that are computed from the list of devices or channels are valid as long as the version does not change.
+    Can be called from any thread.
+  */
+  unsigned long GetDeviceConfigurationVersion() const { return this->DeviceConfigurationVersion; }
+
   /*!
     Return the requested device
     \param aDevice the device pointer to fill
@@ -154,17 +181,102 @@ public:
   /*! Get startup delay in sec to give some time to the buffers for proper initialization */
   vtkGetMacro(StartupDelaySec, double);
 
+  /*!
+    If enabled then Connect and Start process the devices concurrently, each on its own thread.
+    A device is only processed after all devices that it receives input channels from (see vtkPlusDevice::GetInputDevicesRecursive).
+    Disabled by default, as some device SDKs must be initialized on the thread that uses them.
+  */
+  vtkSetMacro(ParallelConnectEnabled, bool);
+  vtkGetMacro(ParallelConnectEnabled, bool);
+  vtkBooleanMacro(ParallelConnectEnabled, bool);
+
+  /*!
+    Maximum memory in MB that all data source buffers may use together, 0 for no limit.
+    Only buffers that are sized by time (see vtkPlusBuffer::SetBufferDurationSec) are shrunk to fit the budget,
+    proportionally to their requested size. Buffers with a fixed size are counted but not changed.
+  */
+  vtkSetMacro(BufferMemoryBudgetMB, double);
+  vtkGetMacro(BufferMemoryBudgetMB, double);
+
+  /*!
+    Resize the buffers that are sized by time to hold their requested duration at the measured frame rate,
+    within the BufferMemoryBudgetMB memory budget. Buffers that are shared between devices are sized once.
+    Called periodically while the data collector is started.
+  */
+  PlusStatus UpdateBufferSizes();
+
+  /*! Memory used by a buffer. Owner is the DeviceId/SourceId of the first data source that uses the buffer. */
+  struct BufferMemoryReport
+  {
+    std::string Owner;
+    int BufferSize;
+    int NumberOfItems;
+    BufferMemoryUsage Usage;
+  };
+
+  /*!
+    Get the memory used by the buffers of all data sources, each buffer only once, and by each device in addition to its
+    buffers (see vtkPlusDevice::GetInternalMemoryUsageInBytes), keyed by device id. Returns the total in bytes.
+    All buffer items are visited, so it is meant for diagnostics and not for calling at the acquisition rate.
+  */
+  unsigned long long GetMemoryUsage(std::vector<BufferMemoryReport>& bufferReports, std::map<std::string, unsigned long long>& deviceInternalBytes) const;
+
 protected:
   vtkPlusDataCollector();
   virtual ~vtkPlusDataCollector();
 
+  /*!
+    Call the operation for each device, concurrently if ParallelConnectEnabled is set, and log the time it took for each device.
+    Processing continues with the other devices if the operation fails for a device.
+    \param operationName Name of the operation in the log messages (e.g., "connect")
+  */
+  PlusStatus ProcessDevices(const DeviceCollection& devices, const std::string& operationName, const std::function<PlusStatus(vtkPlusDevice*)>& operation);
+
+  /*! Read the attributes of the DataCollection element */
+  void ReadDataCollectionParameters(vtkXMLDataElement* dataCollectionElement);
+
+  /*! Keep a copy of the Device element, used for detecting changed devices in ReloadConfiguration */
+  void StoreDeviceConfiguration(vtkXMLDataElement* deviceElement);
+
+  /*! Add the input channels listed in the Device element to the device */
+  PlusStatus ConnectInputChannels(vtkXMLDataElement* deviceElement);
+
+  /*!
+    Get the buffers of all data sources of all devices, each buffer only once.
+    If owners is not NULL then it receives the DeviceId/SourceId of the first data source of each buffer.
+  */
+  void GetAllBuffers(std::vector<vtkPlusBuffer*>& buffers, std::vector<std::string>* owners = NULL) const;
+
+  /*! Size the buffers and start the thread that keeps them sized (only if there is a buffer that is sized by time) */
+  void StartBufferSizing();
+  /*! Stop the thread started by StartBufferSizing */
+  void StopBufferSizing();
+
   /*! The timestamp filtering methods require some time to initialize. Synchronization will ignore data that are acquired during startup delay. */
   double StartupDelaySec;
 
+  bool ParallelConnectEnabled;
+
+  double BufferMemoryBudgetMB;
+  /*! True while the memory budget is exceeded, to report the warning only when the state changes */
+  bool BufferMemoryBudgetExceeded;
+
+  /*! Thread that calls UpdateBufferSizes periodically */
+  std::thread BufferSizingThread;
+  std::mutex BufferSizingMutex;
+  std::condition_variable BufferSizingCondition;
+  bool BufferSizingActive;
+
+  /*! Device elements of the configuration the devices were created from, by device id */
+  std::map<std::string, vtkSmartPointer<vtkXMLDataElement> > DeviceConfigurations;
+
   vtkSmartPointer<vtkPlusDeviceFactory> DeviceFactory;
 
   DeviceCollection Devices;
 
+  /*! Incremented before and after each change of Devices, see GetDeviceConfigurationVersion */
+  std::atomic<unsigned long> DeviceConfigurationVersion;
+
   bool Connected;
   bool Started;
 
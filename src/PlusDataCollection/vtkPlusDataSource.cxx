@@ -6,6 +6,7 @@ See License.txt for details.
 
 // Local includes
 #include "PlusConfigure.h"
+#include "PlusBufferSnapshot.h"
 #include "vtkPlusBuffer.h"
 #include "vtkPlusDataSource.h"
 
@@ -33,6 +34,8 @@ vtkPlusDataSource::vtkPlusDataSource()
   , Id("")
   , ReferenceCoordinateFrameName("")
   , Buffer(vtkPlusBuffer::New())
+  , LatestToolStatus(TOOL_INVALID)
+  , LatestToolStatusTimestamp(UNDEFINED_TIMESTAMP)
 {
   this->ClipRectangleOrigin[0] = igsioCommon::NO_CLIP;
   this->ClipRectangleOrigin[1] = igsioCommon::NO_CLIP;
@@ -391,6 +394,57 @@ PlusStatus vtkPlusDataSource::ReadConfiguration(vtkXMLDataElement* sourceElement
     LOG_DEBUG("Buffer size is not defined in source element \"" << this->GetId() << "\". Using default buffer size: " << this->GetBuffer()->GetBufferSize());
   }
 
+  // If a duration is defined then BufferSize is only the initial size, until the frame rate can be measured
+  double bufferDurationSec = 0.0;
+  if (sourceElement->GetScalarAttribute("BufferDurationSec", bufferDurationSec))
+  {
+    this->GetBuffer()->SetBufferDurationSec(bufferDurationSec);
+  }
+
+  const char* bufferType = sourceElement->GetAttribute("BufferType");
+  if (bufferType != NULL)
+  {
+    if (STRCASECMP(bufferType, "Locked") == 0)
+    {
+      this->GetBuffer()->SetLockFreeReadEnabled(false);
+    }
+    else if (STRCASECMP(bufferType, "LockFreeRead") == 0)
+    {
+      this->GetBuffer()->SetLockFreeReadEnabled(true);
+    }
+    else
+    {
+      LOG_ERROR("Unknown BufferType \"" << bufferType << "\" in source element \"" << this->GetId() << "\". Valid values: Locked, LockFreeRead.");
+      return PLUS_FAIL;
+    }
+  }
+
+  const char* poseStorage = sourceElement->GetAttribute("PoseStorage");
+  if (poseStorage != NULL)
+  {
+    if (this->GetType() != DATA_SOURCE_TYPE_TOOL)
+    {
+      LOG_WARNING("PoseStorage is only applicable to tool sources, it is ignored in source element \"" << this->GetId() << "\".");
+    }
+    else if (STRCASECMP(poseStorage, "Full") == 0)
+    {
+      this->GetBuffer()->SetCompactPoseStorage(false);
+    }
+    else if (STRCASECMP(poseStorage, "Compact") == 0)
+    {
+      if (this->GetBuffer()->SetCompactPoseStorage(true) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to enable compact pose storage in source element \"" << this->GetId() << "\".");
+        return PLUS_FAIL;
+      }
+    }
+    else
+    {
+      LOG_ERROR("Unknown PoseStorage \"" << poseStorage << "\" in source element \"" << this->GetId() << "\". Valid values: Full, Compact.");
+      return PLUS_FAIL;
+    }
+  }
+
   int averagedItemsForFiltering = 0;
   if (sourceElement->GetScalarAttribute("AveragedItemsForFiltering", averagedItemsForFiltering))
   {
@@ -401,6 +455,52 @@ PlusStatus vtkPlusDataSource::ReadConfiguration(vtkXMLDataElement* sourceElement
     LOG_DEBUG("AveragedItemsForFiltering is not defined in source element \"" << this->GetId() << "\". Using default value: " << this->GetBuffer()->GetAveragedItemsForFiltering());
   }
 
+  bool timeStampReporting = false;
+  if (sourceElement->GetAttribute("TimeStampReporting") != NULL)
+  {
+    timeStampReporting = STRCASECMP(sourceElement->GetAttribute("TimeStampReporting"), "TRUE") == 0;
+    this->GetBuffer()->SetTimeStampReporting(timeStampReporting);
+  }
+
+  int timeStampReportMaximumNumberOfRows = 0;
+  if (sourceElement->GetScalarAttribute("TimeStampReportMaximumNumberOfRows", timeStampReportMaximumNumberOfRows))
+  {
+    if (timeStampReportMaximumNumberOfRows < 0)
+    {
+      LOG_ERROR("TimeStampReportMaximumNumberOfRows must not be negative in source element \"" << this->GetId() << "\".");
+      return PLUS_FAIL;
+    }
+    this->GetBuffer()->SetTimeStampReportMaximumNumberOfRows(static_cast<unsigned int>(timeStampReportMaximumNumberOfRows));
+  }
+
+  double compressItemsOlderThanSec = 0.0;
+  if (sourceElement->GetScalarAttribute("CompressItemsOlderThanSec", compressItemsOlderThanSec))
+  {
+    if (compressItemsOlderThanSec < 0)
+    {
+      LOG_ERROR("CompressItemsOlderThanSec must not be negative in source element \"" << this->GetId() << "\".");
+      return PLUS_FAIL;
+    }
+    if (this->GetType() != DATA_SOURCE_TYPE_VIDEO && compressItemsOlderThanSec > 0)
+    {
+      LOG_WARNING("CompressItemsOlderThanSec is only applicable to video sources, it is ignored in source element \"" << this->GetId() << "\".");
+    }
+    else
+    {
+      this->GetBuffer()->SetCompressItemsOlderThanSec(compressItemsOlderThanSec);
+    }
+  }
+
+  const char* timeStampReportFile = sourceElement->GetAttribute("TimeStampReportFile");
+  if (timeStampReportFile != NULL && timeStampReporting)
+  {
+    if (this->GetBuffer()->SetTimeStampReportFilename(vtkPlusConfig::GetInstance()->GetOutputPath(timeStampReportFile)) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to open timestamp report file in source element \"" << this->GetId() << "\".");
+      return PLUS_FAIL;
+    }
+  }
+
   std::string descName;
   if (!aDescriptiveNameForBuffer.empty())
   {
@@ -456,12 +556,52 @@ PlusStatus vtkPlusDataSource::WriteConfiguration(vtkXMLDataElement* aSourceEleme
 
   XML_WRITE_STRING_ATTRIBUTE_IF_NOT_EMPTY(PortName, aSourceElement);
   aSourceElement->SetIntAttribute("BufferSize", this->GetBuffer()->GetBufferSize());
+  if (this->GetBuffer()->GetBufferDurationSec() > 0)
+  {
+    aSourceElement->SetDoubleAttribute("BufferDurationSec", this->GetBuffer()->GetBufferDurationSec());
+  }
+  else
+  {
+    aSourceElement->RemoveAttribute("BufferDurationSec");
+  }
+
+  if (this->GetBuffer()->GetLockFreeReadEnabled())
+  {
+    aSourceElement->SetAttribute("BufferType", "LockFreeRead");
+  }
+  else if (aSourceElement->GetAttribute("BufferType") != NULL)
+  {
+    aSourceElement->SetAttribute("BufferType", "Locked");
+  }
+
+  if (this->GetBuffer()->GetCompactPoseStorage())
+  {
+    aSourceElement->SetAttribute("PoseStorage", "Compact");
+  }
+  else if (aSourceElement->GetAttribute("PoseStorage") != NULL)
+  {
+    aSourceElement->SetAttribute("PoseStorage", "Full");
+  }
 
   if (aSourceElement->GetAttribute("AveragedItemsForFiltering") != NULL)
   {
     aSourceElement->SetIntAttribute("AveragedItemsForFiltering", this->GetBuffer()->GetAveragedItemsForFiltering());
   }
 
+  if (aSourceElement->GetAttribute("TimeStampReportMaximumNumberOfRows") != NULL)
+  {
+    aSourceElement->SetIntAttribute("TimeStampReportMaximumNumberOfRows", static_cast<int>(this->GetBuffer()->GetTimeStampReportMaximumNumberOfRows()));
+  }
+
+  if (this->GetBuffer()->GetCompressItemsOlderThanSec() > 0)
+  {
+    aSourceElement->SetDoubleAttribute("CompressItemsOlderThanSec", this->GetBuffer()->GetCompressItemsOlderThanSec());
+  }
+  else if (aSourceElement->GetAttribute("CompressItemsOlderThanSec") != NULL)
+  {
+    aSourceElement->RemoveAttribute("CompressItemsOlderThanSec");
+  }
+
   // Write custom properties
   if (this->CustomProperties.size() > 0)
   {
@@ -579,6 +719,87 @@ PlusStatus vtkPlusDataSource::AddItem(void* imageDataPtr, const FrameSizeType& f
   return this->GetBuffer()->AddItem(imageDataPtr, frameSize, frameSizeInBytes, imageType, frameNumber, unfilteredTimestamp, filteredTimestamp, customFields);
 }
 
+//----------------------------------------------------------------------------
+bool vtkPlusDataSource::IsInPlaceWritingSupported()
+{
+  if (igsioCommon::IsClippingRequested(this->ClipRectangleOrigin, this->ClipRectangleSize))
+  {
+    return false;
+  }
+
+  igsioVideoFrame::FlipInfoType flipInfo;
+  if (igsioVideoFrame::GetFlipAxes(this->InputImageOrientation, this->GetBuffer()->GetImageType(), this->GetBuffer()->GetImageOrientation(), flipInfo) != PLUS_SUCCESS)
+  {
+    return false;
+  }
+  return !flipInfo.hFlip && !flipInfo.vFlip && !flipInfo.eFlip && flipInfo.tranpose == igsioVideoFrame::TRANSPOSE_NONE;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDataSource::AcquireWritableFrame(igsioVideoFrame*& frame)
+{
+  frame = NULL;
+  if (!this->IsInPlaceWritingSupported())
+  {
+    LOG_DEBUG("In-place writing is not supported for source " << this->GetId() << ", because clipping or reorientation of the frames is needed");
+    return PLUS_FAIL;
+  }
+  return this->GetBuffer()->AcquireWritableFrame(frame);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDataSource::AcquireWritableFrameInOutputOrientation(igsioVideoFrame*& frame)
+{
+  frame = NULL;
+  if (igsioCommon::IsClippingRequested(this->ClipRectangleOrigin, this->ClipRectangleSize))
+  {
+    LOG_DEBUG("In-place writing is not supported for source " << this->GetId() << ", because clipping of the frames is needed");
+    return PLUS_FAIL;
+  }
+  return this->GetBuffer()->AcquireWritableFrame(frame);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDataSource::CommitWritableFrame(long frameNumber, double unfilteredTimestamp /*= UNDEFINED_TIMESTAMP*/, double filteredTimestamp /*= UNDEFINED_TIMESTAMP*/, const igsioFieldMapType* customFields /*= NULL*/)
+{
+  return this->GetBuffer()->CommitWritableFrame(frameNumber, unfilteredTimestamp, filteredTimestamp, customFields);
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusDataSource::ReleaseWritableFrame()
+{
+  this->GetBuffer()->ReleaseWritableFrame();
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDataSource::AddGpuItem(const PlusGpuFramePtr& gpuFrame, long frameNumber, double unfilteredTimestamp /*= UNDEFINED_TIMESTAMP*/, double filteredTimestamp /*= UNDEFINED_TIMESTAMP*/, const igsioFieldMapType* customFields /*= NULL*/)
+{
+  if (!this->IsInPlaceWritingSupported())
+  {
+    LOG_ERROR("GPU frames cannot be added to source " << this->GetId() << ", because clipping or reorientation of the frames is needed");
+    return PLUS_FAIL;
+  }
+  return this->GetBuffer()->AddGpuItem(gpuFrame, frameNumber, unfilteredTimestamp, filteredTimestamp, customFields);
+}
+
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusDataSource::GetGpuFrame(BufferItemUidType uid, PlusGpuFramePtr& gpuFrame)
+{
+  return this->GetBuffer()->GetGpuFrame(uid, gpuFrame);
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusDataSource::SetNextItemSourceBitstream(const StreamBufferItem::SourceBitstreamPtr& sourceBitstream)
+{
+  this->GetBuffer()->SetNextItemSourceBitstream(sourceBitstream);
+}
+
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusDataSource::GetSourceBitstream(BufferItemUidType uid, StreamBufferItem::SourceBitstreamPtr& sourceBitstream)
+{
+  return this->GetBuffer()->GetSourceBitstream(uid, sourceBitstream);
+}
+
 //-----------------------------------------------------------------------------
 US_IMAGE_TYPE vtkPlusDataSource::GetImageType()
 {
@@ -813,6 +1034,12 @@ ItemStatus vtkPlusDataSource::GetStreamBufferItem(BufferItemUidType uid, StreamB
   return this->GetBuffer()->GetStreamBufferItem(uid, bufferItem);
 }
 
+//-----------------------------------------------------------------------------
+ItemStatus vtkPlusDataSource::GetStreamBufferItemView(BufferItemUidType uid, StreamBufferItem* bufferItem)
+{
+  return this->GetBuffer()->GetStreamBufferItemView(uid, bufferItem);
+}
+
 //-----------------------------------------------------------------------------
 ItemStatus vtkPlusDataSource::GetLatestStreamBufferItem(StreamBufferItem* bufferItem)
 {
@@ -831,6 +1058,24 @@ ItemStatus vtkPlusDataSource::GetStreamBufferItemFromTime(double time, StreamBuf
   return this->GetBuffer()->GetStreamBufferItemFromTime(time, bufferItem, interpolation);
 }
 
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusDataSource::GetInterpolatedStreamBufferItemFromClosestUid(double time, BufferItemUidType closestItemUid, StreamBufferItem* bufferItem)
+{
+  return this->GetBuffer()->GetInterpolatedStreamBufferItemFromClosestUid(time, closestItemUid, bufferItem);
+}
+
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusDataSource::GetTransformSample(BufferItemUidType uid, vtkPlusBuffer::TransformSample& sample, igsioFieldMapType* frameFields/*=NULL*/)
+{
+  return this->GetBuffer()->GetTransformSample(uid, sample, frameFields);
+}
+
+//----------------------------------------------------------------------------
+double vtkPlusDataSource::GetMaxAllowedTimeDifference()
+{
+  return this->GetBuffer()->GetMaxAllowedTimeDifference();
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusDataSource::ModifyBufferItemFrameField(BufferItemUidType uid, const std::string& key, const std::string& value)
 {
@@ -855,6 +1100,18 @@ int vtkPlusDataSource::GetBufferSize()
   return this->GetBuffer()->GetBufferSize();
 }
 
+//-----------------------------------------------------------------------------
+void vtkPlusDataSource::SetBufferDurationSec(double durationSec)
+{
+  this->GetBuffer()->SetBufferDurationSec(durationSec);
+}
+
+//-----------------------------------------------------------------------------
+double vtkPlusDataSource::GetBufferDurationSec()
+{
+  return this->GetBuffer()->GetBufferDurationSec();
+}
+
 //-----------------------------------------------------------------------------
 ItemStatus vtkPlusDataSource::GetLatestTimeStamp(double& latestTimestamp)
 {
@@ -873,6 +1130,18 @@ ItemStatus vtkPlusDataSource::GetTimeStamp(BufferItemUidType uid, double& timest
   return this->GetBuffer()->GetTimeStamp(uid, timestamp);
 }
 
+//-----------------------------------------------------------------------------
+void vtkPlusDataSource::GetItemTimeStamps(BufferItemUidType firstUid, BufferItemUidType lastUid, std::vector<BufferItemUidType>& uids, std::vector<double>& timestamps)
+{
+  this->GetBuffer()->GetItemTimeStamps(firstUid, lastUid, uids, timestamps);
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusDataSource::CaptureSnapshot(PlusBufferSnapshot& snapshot)
+{
+  return snapshot.Capture(this->GetBuffer());
+}
+
 //-----------------------------------------------------------------------------
 void vtkPlusDataSource::SetLocalTimeOffsetSec(double offsetSec)
 {
@@ -903,6 +1172,12 @@ bool vtkPlusDataSource::GetTimeStampReporting()
   return this->GetBuffer()->GetTimeStampReporting();
 }
 
+//-----------------------------------------------------------------------------
+TimeStampReportStatistics vtkPlusDataSource::GetTimeStampReportStatistics()
+{
+  return this->GetBuffer()->GetTimeStampReportStatistics();
+}
+
 //-----------------------------------------------------------------------------
 PlusStatus vtkPlusDataSource::WriteToSequenceFile(const char* filename, bool useCompression /*= false */)
 {
@@ -920,7 +1195,39 @@ PlusStatus vtkPlusDataSource::DeepCopyBufferTo(vtkPlusBuffer& bufferToFill)
 //-----------------------------------------------------------------------------
 PlusStatus vtkPlusDataSource::AddTimeStampedItem(vtkMatrix4x4* matrix, ToolStatus status, unsigned long frameNumber, double unfilteredTimestamp, double filteredTimestamp/*=UNDEFINED_TIMESTAMP*/, const igsioFieldMapType* customFields /*= NULL*/)
 {
-  return this->GetBuffer()->AddTimeStampedItem(matrix, status, frameNumber, unfilteredTimestamp, filteredTimestamp, customFields);
+  if (this->GetBuffer()->AddTimeStampedItem(matrix, status, frameNumber, unfilteredTimestamp, filteredTimestamp, customFields) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  this->LatestToolStatusTimestamp.store(unfilteredTimestamp, std::memory_order_relaxed);
+  this->LatestToolStatus.store(status, std::memory_order_release);
+  return PLUS_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusDataSource::AddTimeStampedItems(const std::vector<vtkPlusBuffer::ToolSample>& samples, unsigned long firstFrameNumber)
+{
+  if (this->GetBuffer()->AddTimeStampedItems(samples, firstFrameNumber) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  if (!samples.empty())
+  {
+    this->LatestToolStatusTimestamp.store(samples.back().UnfilteredTimestamp, std::memory_order_relaxed);
+    this->LatestToolStatus.store(samples.back().Status, std::memory_order_release);
+  }
+  return PLUS_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+ToolStatus vtkPlusDataSource::GetLatestToolStatus(double* timestamp /*= NULL*/) const
+{
+  ToolStatus status = static_cast<ToolStatus>(this->LatestToolStatus.load(std::memory_order_acquire));
+  if (timestamp != NULL)
+  {
+    *timestamp = this->LatestToolStatusTimestamp.load(std::memory_order_relaxed);
+  }
+  return status;
 }
 
 //-----------------------------------------------------------------------------
@@ -22,6 +22,9 @@
 // VTK includes
 #include <vtkObject.h>
 
+// STL includes
+#include <atomic>
+
 /*!
 \class vtkPlusDataSource
 \brief Interface to a 3D positioning tool, video source, or generalized data stream
@@ -29,6 +32,7 @@
 \ingroup PlusLibDataCollection
 */
 
+class PlusBufferSnapshot;
 class vtkPlusBuffer;
 
 enum DataSourceType
@@ -134,12 +138,20 @@ public:
 
   /*! Get a frame with the specified frame uid from the buffer */
   virtual ItemStatus GetStreamBufferItem(BufferItemUidType uid, StreamBufferItem* bufferItem);
+  /*! Get a frame with the specified frame uid from the buffer, sharing the (read-only) pixel data with the buffer */
+  virtual ItemStatus GetStreamBufferItemView(BufferItemUidType uid, StreamBufferItem* bufferItem);
   /*! Get the most recent frame from the buffer */
   virtual ItemStatus GetLatestStreamBufferItem(StreamBufferItem* bufferItem);
   /*! Get the oldest frame from buffer */
   virtual ItemStatus GetOldestStreamBufferItem(StreamBufferItem* bufferItem);
   /*! Get a frame that was acquired at the specified time from buffer */
   virtual ItemStatus GetStreamBufferItemFromTime(double time, StreamBufferItem* bufferItem, vtkPlusBuffer::DataItemTemporalInterpolationType interpolation);
+  /*! Get an item interpolated at the specified time, when the UID of the closest item is already known */
+  virtual ItemStatus GetInterpolatedStreamBufferItemFromClosestUid(double time, BufferItemUidType closestItemUid, StreamBufferItem* bufferItem);
+  /*! Read the transform of an item without copying the whole item */
+  virtual ItemStatus GetTransformSample(BufferItemUidType uid, vtkPlusBuffer::TransformSample& sample, igsioFieldMapType* frameFields = NULL);
+  /*! Maximum time difference between the requested time and the items that are used for interpolation */
+  virtual double GetMaxAllowedTimeDifference();
   /*! Update a field in the specified stream buffer item */
   virtual PlusStatus ModifyBufferItemFrameField(BufferItemUidType uid, const std::string& key, const std::string& value);
 
@@ -160,6 +172,9 @@ public:
   /*! If TimeStampReporting is enabled then all filtered and unfiltered timestamp values will be saved in a table for diagnostic purposes. */
   bool GetTimeStampReporting();
 
+  /*! Get the rolling frame period and jitter statistics of the timestamp report */
+  TimeStampReportStatistics GetTimeStampReportStatistics();
+
   /*!
     Set the size of the buffer, i.e. the maximum number of
     video frames that it will hold.  The default is 30.
@@ -168,6 +183,11 @@ public:
   /*! Get the size of the buffer */
   virtual int GetBufferSize();
 
+  /*! Set the time span of data that the buffer should hold in seconds, 0 for a fixed buffer size (see vtkPlusBuffer::SetBufferDurationSec) */
+  void SetBufferDurationSec(double durationSec);
+  /*! Get the time span of data that the buffer should hold in seconds (see vtkPlusBuffer::SetBufferDurationSec) */
+  double GetBufferDurationSec();
+
   /*! Get latest timestamp in the buffer */
   virtual ItemStatus GetLatestTimeStamp(double& latestTimestamp);
 
@@ -177,6 +197,12 @@ public:
   /*! Get video buffer item timestamp */
   virtual ItemStatus GetTimeStamp(BufferItemUidType uid, double& timestamp);
 
+  /*! Get the UIDs and timestamps of the items from firstUid to lastUid that are in the buffer, with the buffer locked only once */
+  virtual void GetItemTimeStamps(BufferItemUidType firstUid, BufferItemUidType lastUid, std::vector<BufferItemUidType>& uids, std::vector<double>& timestamps);
+
+  /*! Capture the current item range of the buffer, the items remain readable from the snapshot until it is released */
+  virtual PlusStatus CaptureSnapshot(PlusBufferSnapshot& snapshot);
+
   /*! Set the local time offset in seconds (global = local + offset) */
   virtual void SetLocalTimeOffsetSec(double offsetSec);
   /*! Get the local time offset in seconds (global = local + offset) */
@@ -253,6 +279,44 @@ public:
   */
   virtual PlusStatus AddItem(const igsioFieldMapType& customFields, long frameNumber, double unfilteredTimestamp = UNDEFINED_TIMESTAMP, double filteredTimestamp = UNDEFINED_TIMESTAMP);
 
+  /*!
+    Get a writable frame of the buffer that the device can fill in place, avoiding a copy of the image data.
+    It is only available if no clipping is requested and the input image orientation matches the buffer orientation,
+    otherwise it fails and the device should fall back to AddItem(...).
+    The frame has to be committed by CommitWritableFrame or released by ReleaseWritableFrame.
+  */
+  virtual PlusStatus AcquireWritableFrame(igsioVideoFrame*& frame);
+
+  /*!
+    Get a writable frame of the buffer for a device that writes the frame in the buffer orientation (see GetOutputImageOrientation)
+    itself. It is only available if no clipping is requested. See AcquireWritableFrame(igsioVideoFrame*&).
+  */
+  virtual PlusStatus AcquireWritableFrameInOutputOrientation(igsioVideoFrame*& frame);
+
+  /*! Add the frame that was previously acquired by AcquireWritableFrame to the buffer */
+  virtual PlusStatus CommitWritableFrame(long frameNumber, double unfilteredTimestamp = UNDEFINED_TIMESTAMP, double filteredTimestamp = UNDEFINED_TIMESTAMP, const igsioFieldMapType* customFields = NULL);
+
+  /*! Release the frame that was previously acquired by AcquireWritableFrame without adding it to the buffer */
+  virtual void ReleaseWritableFrame();
+
+  /*!
+    Add a frame that is stored in GPU memory, see vtkPlusBuffer::AddGpuItem.
+    Only available if in-place writing is supported (no clipping and no reorientation is needed).
+  */
+  virtual PlusStatus AddGpuItem(const PlusGpuFramePtr& gpuFrame, long frameNumber, double unfilteredTimestamp = UNDEFINED_TIMESTAMP, double filteredTimestamp = UNDEFINED_TIMESTAMP, const igsioFieldMapType* customFields = NULL);
+
+  /*! Get the GPU frame of a buffer item without reading it back to host memory, see vtkPlusBuffer::GetGpuFrame */
+  virtual ItemStatus GetGpuFrame(BufferItemUidType uid, PlusGpuFramePtr& gpuFrame);
+
+  /*! Set the compressed bitstream that the next video frame is decoded from, see vtkPlusBuffer::SetNextItemSourceBitstream */
+  virtual void SetNextItemSourceBitstream(const StreamBufferItem::SourceBitstreamPtr& sourceBitstream);
+
+  /*! Get the source bitstream of a buffer item, see vtkPlusBuffer::GetSourceBitstream */
+  virtual ItemStatus GetSourceBitstream(BufferItemUidType uid, StreamBufferItem::SourceBitstreamPtr& sourceBitstream);
+
+  /*! Returns true if frames can be written directly into the buffer (no clipping and no reorientation is needed) */
+  virtual bool IsInPlaceWritingSupported();
+
   /*!
   Add a matrix plus status to the list, with an exactly known timestamp value (e.g., provided by a high-precision hardware timer).
   If the timestamp is less than or equal to the previous timestamp, then nothing  will be done.
@@ -260,6 +324,16 @@ public:
   */
   PlusStatus AddTimeStampedItem(vtkMatrix4x4* matrix, ToolStatus status, unsigned long frameNumber, double unfilteredTimestamp, double filteredTimestamp = UNDEFINED_TIMESTAMP, const igsioFieldMapType* customFields = NULL);
 
+  /*! Add several matrix plus status samples to the list with one buffer lock, see vtkPlusBuffer::AddTimeStampedItems */
+  PlusStatus AddTimeStampedItems(const std::vector<vtkPlusBuffer::ToolSample>& samples, unsigned long firstFrameNumber);
+
+  /*!
+    Status of the most recent matrix that was added to the buffer. It is published by the thread that adds the items and can be
+    read from any thread without locking the buffer, e.g., by widgets that display the tool states.
+    If timestamp is not NULL then the unfiltered timestamp of the item is returned in it (UNDEFINED_TIMESTAMP if no item has been added yet).
+  */
+  ToolStatus GetLatestToolStatus(double* timestamp = NULL) const;
+
   /*! Get the device which owns this source. */
   // TODO : consider a re-design of this idea
   void SetDevice(vtkPlusDevice* _arg) { this->Device = _arg; }
@@ -388,6 +462,10 @@ protected:
 
   FrameSizeType InputFrameSize;
 
+  /*! Published by AddTimeStampedItem(s), see GetLatestToolStatus */
+  std::atomic<int> LatestToolStatus;
+  std::atomic<double> LatestToolStatusTimestamp;
+
 private:
   vtkPlusDataSource(const vtkPlusDataSource&);
   void operator=(const vtkPlusDataSource&);
@@ -6,6 +6,11 @@ See License.txt for details.
 
 // Local includes
 #include "PlusConfigure.h"
+#include "PlusPacingTimer.h"
+#include "PlusProfiler.h"
+#include "PlusReplayClock.h"
+#include "PlusTelemetry.h"
+#include "PlusTrackedFrameAssembly.h"
 #include "vtkPlusBuffer.h"
 #include "vtkPlusChannel.h"
 #include "vtkPlusDataSource.h"
@@ -26,6 +31,7 @@ See License.txt for details.
 #include <vtksys/SystemTools.hxx>
 
 // STD includes
+#include <atomic>
 #include <set>
 
 // System includes
@@ -113,7 +119,6 @@ See License.txt for details.
 vtkStandardNewMacro(vtkPlusDevice);
 
 const int vtkPlusDevice::VIRTUAL_DEVICE_FRAME_RATE = 50;
-static const int FRAME_RATE_AVERAGING = 10;
 const std::string vtkPlusDevice::BMODE_PORT_NAME = "B";
 const std::string vtkPlusDevice::RFMODE_PORT_NAME = "Rf";
 const std::string vtkPlusDevice::PARAMETERS_XML_ELEMENT_TAG = "Parameters";
@@ -141,6 +146,13 @@ vtkPlusDevice::vtkPlusDevice()
   , StartThreadForInternalUpdates(false)
   , LocalTimeOffsetSec(0.0)
   , MissingInputGracePeriodSec(0.0)
+  , WaitForInputData(false)
+  , UseSharedUpdateThread(false)
+  , AdaptiveAcquisitionRate(false)
+  , UseDeviceClock(false)
+  , PixelConversionThreads(1)
+  , KeepSourceBitstream(false)
+  , ThreadPriority(PlusThreadScheduling::PRIORITY_NORMAL)
   , RequireImageOrientationInConfiguration(false)
   , RequirePortNameInDeviceSetConfiguration(false)
 {
@@ -607,6 +619,14 @@ void vtkPlusDevice::DeepCopy(const vtkPlusDevice& device)
   this->CorrectlyConfigured = device.GetCorrectlyConfigured();
   this->LocalTimeOffsetSec = device.GetLocalTimeOffsetSec();
   this->MissingInputGracePeriodSec = device.GetMissingInputGracePeriodSec();
+  this->WaitForInputData = device.GetWaitForInputData();
+  this->UseSharedUpdateThread = device.GetUseSharedUpdateThread();
+  this->AdaptiveAcquisitionRate = device.GetAdaptiveAcquisitionRate();
+  this->UseDeviceClock = device.GetUseDeviceClock();
+  this->PixelConversionThreads = device.GetPixelConversionThreads();
+  this->KeepSourceBitstream = device.GetKeepSourceBitstream();
+  this->ThreadPriority = device.GetThreadPriority();
+  this->CpuAffinity = device.GetCpuAffinity();
   this->RequireImageOrientationInConfiguration = device.RequireImageOrientationInConfiguration;
   this->RequirePortNameInDeviceSetConfiguration = device.RequirePortNameInDeviceSetConfiguration;
   this->Parameters = device.Parameters;
@@ -665,6 +685,33 @@ double vtkPlusDevice::GetInternalUpdateRate() const
   return this->InternalUpdateRate;
 }
 
+//-----------------------------------------------------------------------------
+double vtkPlusDevice::GetAchievedDataRate()
+{
+  DataSourceContainerConstIterator begin = this->GetToolIteratorBegin();
+  DataSourceContainerConstIterator end = this->GetToolIteratorEnd();
+  if (begin == end)
+  {
+    begin = this->GetVideoSourceIteratorBegin();
+    end = this->GetVideoSourceIteratorEnd();
+  }
+  double achievedRate = 0.0;
+  for (DataSourceContainerConstIterator it = begin; it != end; ++it)
+  {
+    double frameRate = it->second->GetFrameRate();
+    if (frameRate <= 0)
+    {
+      // not enough items yet for measuring the frame rate
+      return 0.0;
+    }
+    if (achievedRate == 0.0 || frameRate < achievedRate)
+    {
+      achievedRate = frameRate;
+    }
+  }
+  return achievedRate;
+}
+
 //-----------------------------------------------------------------------------
 PlusStatus vtkPlusDevice::SetAcquisitionRate(double aRate)
 {
@@ -734,15 +781,17 @@ PlusStatus vtkPlusDevice::WriteToolsToSequenceFile(const std::string& filename,
 
   vtkSmartPointer<vtkIGSIOTrackedFrameList> trackedFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
 
-  PlusStatus status = PLUS_SUCCESS;
-
   // Get the first source
   vtkPlusDataSource* firstActiveTool = this->Tools.begin()->second;
+  const double localTimeOffsetSec = firstActiveTool->GetLocalTimeOffsetSec();
+  const BufferItemUidType oldestUid = firstActiveTool->GetOldestItemUidInBuffer();
 
-  for (int i = 0 ; i < numberOfItems; i++)
+  // Assemble the frames in parallel, items that are not in the buffer anymore are skipped
+  std::atomic<bool> toolMatrixFailed(false);
+  std::vector<igsioTrackedFrame*> trackedFrames;
+  PlusTrackedFrameAssembly::AssembleFrames(numberOfItems, [this, firstActiveTool, localTimeOffsetSec, oldestUid, &toolMatrixFailed](int frameIndex, igsioTrackedFrame & trackedFrame)
   {
     // Create fake image
-    igsioTrackedFrame trackedFrame;
     igsioVideoFrame videoFrame;
     FrameSizeType frameSize = {1, 1, 1};
     // Don't waste space, create a greyscale image
@@ -750,15 +799,15 @@ PlusStatus vtkPlusDevice::WriteToolsToSequenceFile(const std::string& filename,
     trackedFrame.SetImageData(videoFrame);
 
     StreamBufferItem bufferItem;
-    BufferItemUidType uid = firstActiveTool->GetOldestItemUidInBuffer() + i;
+    BufferItemUidType uid = oldestUid + frameIndex;
 
     if (firstActiveTool->GetStreamBufferItem(uid, &bufferItem) != ITEM_OK)
     {
       LOCAL_LOG_ERROR("Failed to get tracker buffer item with UID: " << uid);
-      continue;
+      return PLUS_FAIL;
     }
 
-    const double frameTimestamp = bufferItem.GetFilteredTimestamp(firstActiveTool->GetLocalTimeOffsetSec());
+    const double frameTimestamp = bufferItem.GetFilteredTimestamp(localTimeOffsetSec);
 
     // Add main source timestamp
     std::ostringstream timestampFieldValue;
@@ -767,7 +816,7 @@ PlusStatus vtkPlusDevice::WriteToolsToSequenceFile(const std::string& filename,
 
     // Add main source unfiltered timestamp
     std::ostringstream unfilteredtimestampFieldValue;
-    unfilteredtimestampFieldValue << std::fixed << bufferItem.GetUnfilteredTimestamp(firstActiveTool->GetLocalTimeOffsetSec());
+    unfilteredtimestampFieldValue << std::fixed << bufferItem.GetUnfilteredTimestamp(localTimeOffsetSec);
     trackedFrame.SetFrameField("UnfilteredTimestamp", unfilteredtimestampFieldValue.str());
 
     // Add main source frameNumber
@@ -789,6 +838,7 @@ PlusStatus vtkPlusDevice::WriteToolsToSequenceFile(const std::string& filename,
       if (toolBufferItem.GetMatrix(toolMatrix) != PLUS_SUCCESS)
       {
         LOCAL_LOG_ERROR("Failed to get toolMatrix");
+        toolMatrixFailed = true;
         return PLUS_FAIL;
       }
 
@@ -798,12 +848,21 @@ PlusStatus vtkPlusDevice::WriteToolsToSequenceFile(const std::string& filename,
       // Add source status
       trackedFrame.SetFrameTransformStatus(toolToTrackerTransform, toolBufferItem.GetStatus());
     }
+    return PLUS_SUCCESS;
+  }, trackedFrames);
 
-    // Add tracked frame to the list
-    // This is a debugging/test function, so the additional copying in AddTrackedFrame compared to TakeTrackedFrame is not relevant.
-    trackedFrameList->AddTrackedFrame(&trackedFrame);
+  if (toolMatrixFailed)
+  {
+    for (std::vector<igsioTrackedFrame*>::iterator frame = trackedFrames.begin(); frame != trackedFrames.end(); ++frame)
+    {
+      delete *frame;
+    }
+    return PLUS_FAIL;
   }
 
+  // Add tracked frames to the list, skipped items are not an error
+  PlusTrackedFrameAssembly::TakeFrames(trackedFrames, trackedFrameList);
+
   // Save tracked frames to metafile
   if (vtkPlusSequenceIO::Write(filename, trackedFrameList, trackedFrameList->GetImageOrientation(), useCompression) != PLUS_SUCCESS)
   {
@@ -811,7 +870,7 @@ PlusStatus vtkPlusDevice::WriteToolsToSequenceFile(const std::string& filename,
     return PLUS_FAIL;
   }
 
-  return status;
+  return PLUS_SUCCESS;
 }
 
 //----------------------------------------------------------------------------
@@ -964,6 +1023,26 @@ PlusStatus vtkPlusDevice::ReadConfiguration(vtkXMLDataElement* rootXMLElement)
     deviceXMLElement->GetScalarAttribute("MissingInputGracePeriodSec", this->MissingInputGracePeriodSec);
   }
 
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(WaitForInputData, deviceXMLElement);
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(UseSharedUpdateThread, deviceXMLElement);
+  if (this->UseSharedUpdateThread && this->WaitForInputData)
+  {
+    LOCAL_LOG_WARNING("UseSharedUpdateThread is ignored, because WaitForInputData requires a dedicated update thread");
+  }
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(AdaptiveAcquisitionRate, deviceXMLElement);
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(UseDeviceClock, deviceXMLElement);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, PixelConversionThreads, deviceXMLElement);
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(KeepSourceBitstream, deviceXMLElement);
+  XML_READ_ENUM3_ATTRIBUTE_OPTIONAL(ThreadPriority, deviceXMLElement,
+                                    "NORMAL", PlusThreadScheduling::PRIORITY_NORMAL,
+                                    "HIGH", PlusThreadScheduling::PRIORITY_HIGH,
+                                    "REALTIME", PlusThreadScheduling::PRIORITY_REALTIME);
+  const char* cpuAffinity = deviceXMLElement->GetAttribute("CpuAffinity");
+  if (cpuAffinity != NULL && PlusThreadScheduling::GetCpuIndicesFromString(cpuAffinity, this->CpuAffinity) != PLUS_SUCCESS)
+  {
+    LOCAL_LOG_WARNING("Invalid CpuAffinity attribute: '" << cpuAffinity << "', the threads of the device will not be bound to processor cores");
+  }
+
   vtkXMLDataElement* dataSourcesElement = deviceXMLElement->FindNestedElementWithName("DataSources");
   if (dataSourcesElement != NULL)
   {
@@ -1149,6 +1228,39 @@ PlusStatus vtkPlusDevice::WriteConfiguration(vtkXMLDataElement* config)
     return PLUS_FAIL;
   }
 
+  if (this->WaitForInputData)
+  {
+    deviceDataElement->SetAttribute("WaitForInputData", "TRUE");
+  }
+  if (this->UseSharedUpdateThread)
+  {
+    deviceDataElement->SetAttribute("UseSharedUpdateThread", "TRUE");
+  }
+  if (this->AdaptiveAcquisitionRate)
+  {
+    deviceDataElement->SetAttribute("AdaptiveAcquisitionRate", "TRUE");
+  }
+  if (this->UseDeviceClock)
+  {
+    deviceDataElement->SetAttribute("UseDeviceClock", "TRUE");
+  }
+  if (this->PixelConversionThreads != 1)
+  {
+    deviceDataElement->SetIntAttribute("PixelConversionThreads", this->PixelConversionThreads);
+  }
+  if (this->KeepSourceBitstream)
+  {
+    deviceDataElement->SetAttribute("KeepSourceBitstream", "TRUE");
+  }
+  if (this->ThreadPriority != PlusThreadScheduling::PRIORITY_NORMAL)
+  {
+    deviceDataElement->SetAttribute("ThreadPriority", PlusThreadScheduling::GetThreadPriorityAsString(this->ThreadPriority));
+  }
+  if (!this->CpuAffinity.empty())
+  {
+    deviceDataElement->SetAttribute("CpuAffinity", PlusThreadScheduling::GetCpuIndicesAsString(this->CpuAffinity).c_str());
+  }
+
   vtkXMLDataElement* dataSourcesElement = deviceDataElement->FindNestedElementWithName("DataSources");
   if (dataSourcesElement != NULL)
   {
@@ -1296,13 +1408,33 @@ PlusStatus vtkPlusDevice::StartRecording()
   }
 
   this->RecordingStartTime = vtkIGSIOAccurateTimer::GetSystemTime();
+  this->DeviceClockModel.Reset();
   this->Recording = 1;
 
   if (this->StartThreadForInternalUpdates)
   {
-    this->ThreadId =
-      this->Threader->SpawnThread((vtkThreadFunctionType)\
-                                  &vtkDataCaptureThread, this);
+    if (this->WaitForInputData && !this->InputChannels.empty())
+    {
+      this->InputDataEvent = std::make_shared<PlusNewDataEvent>();
+      this->RegisterInputDataEvent(true);
+      PlusReplayClock::GetInstance().AddConsumer(this, this->InputDataEvent);
+    }
+    this->LatestItemUids.clear();
+    this->UpdateSchedule.SetAdaptive(this->AdaptiveAcquisitionRate);
+    this->UpdateSchedule.Start(1.0 / this->GetAcquisitionRate(), vtkIGSIOAccurateTimer::GetSystemTime());
+    if (this->UseSharedUpdateThread && !this->InputDataEvent)
+    {
+      PlusAcquisitionScheduler::GetInstance().AddTask(this, &this->UpdateSchedule, [this]()
+      {
+        this->ExecuteInternalUpdate();
+      });
+    }
+    else
+    {
+      this->ThreadId =
+        this->Threader->SpawnThread((vtkThreadFunctionType)\
+                                    &vtkDataCaptureThread, this);
+    }
   }
 
   this->Modified();
@@ -1329,12 +1461,28 @@ PlusStatus vtkPlusDevice::StopRecording()
   if (this->GetStartThreadForInternalUpdates())
   {
     LOCAL_LOG_DEBUG("Wait for internal update thread to terminate");
+    if (this->InputDataEvent)
+    {
+      // Wake up the thread if it is waiting for input data
+      this->InputDataEvent->Signal();
+    }
+    if (this->UseSharedUpdateThread)
+    {
+      // Waits for the completion of an update that is in progress
+      PlusAcquisitionScheduler::GetInstance().RemoveTask(this);
+    }
     // Let's give a chance to the thread to stop before we kill the connection
     while (this->ThreadAlive)
     {
       vtkIGSIOAccurateTimer::Delay(0.1);
     }
     this->ThreadId = -1;
+    if (this->InputDataEvent)
+    {
+      PlusReplayClock::GetInstance().RemoveConsumer(this);
+      this->RegisterInputDataEvent(false);
+      this->InputDataEvent.reset();
+    }
     LOCAL_LOG_DEBUG("Internal update thread terminated");
   }
 
@@ -1355,47 +1503,70 @@ void* vtkPlusDevice::vtkDataCaptureThread(vtkMultiThreader::ThreadInfo* data)
 {
   vtkPlusDevice* self = (vtkPlusDevice*)(data->UserData);
 
-  double rate = self->GetAcquisitionRate();
-  double currtime[FRAME_RATE_AVERAGING] = {0};
-  unsigned long updatecount = 0;
   self->ThreadAlive = true;
+  self->ApplyThreadScheduling();
+  PLUS_PROFILE_THREAD_NAME(self->GetDeviceId().c_str());
 
   while (self->IsRecording() && self->GetCorrectlyConfigured())
   {
-    double newtime = vtkIGSIOAccurateTimer::GetSystemTime();
-    // get current tracking rate over last few updates
-    double difftime = newtime - currtime[updatecount % FRAME_RATE_AVERAGING];
-    currtime[updatecount % FRAME_RATE_AVERAGING] = newtime;
-    if (updatecount > FRAME_RATE_AVERAGING && difftime != 0)
-    {
-      self->InternalUpdateRate = (FRAME_RATE_AVERAGING / difftime);
-    }
-
+    double delay = self->UpdateSchedule.GetNextReleaseTimeSec() - vtkIGSIOAccurateTimer::GetSystemTime();
+    if (delay > 0)
     {
-      // Lock before update
-      igsioLockGuard<vtkIGSIORecursiveCriticalSection> updateMutexGuardedLock(self->UpdateMutex);
-      if (!self->Recording)
+      if (self->InputDataEvent)
       {
-        // recording has been stopped
-        break;
+        // Returns early if an input buffer received new data (including data added during the last update)
+        self->InputDataEvent->Wait(delay);
+      }
+      else
+      {
+        PlusPacingTimer::Delay(delay);
       }
-      self->InternalUpdate();
-      self->UpdateTime.Modified();
     }
 
-    double delay = (newtime + 1.0 / rate - vtkIGSIOAccurateTimer::GetSystemTime());
-    if (delay > 0)
+    double updateStartTime = vtkIGSIOAccurateTimer::GetSystemTime();
+    if (!self->ExecuteInternalUpdate())
     {
-      vtkIGSIOAccurateTimer::Delay(delay);
+      // recording has been stopped
+      break;
     }
-
-    updatecount++;
+    self->UpdateSchedule.RecordUpdate(updateStartTime, vtkIGSIOAccurateTimer::GetSystemTime());
   }
 
   self->ThreadAlive = false;
   return NULL;
 }
 
+//----------------------------------------------------------------------------
+bool vtkPlusDevice::ExecuteInternalUpdate()
+{
+  PLUS_PROFILE_ZONE("vtkPlusDevice::ExecuteInternalUpdate");
+  PLUS_PROFILE_ZONE_TEXT(this->GetDeviceId().c_str(), this->GetDeviceId().size());
+  // Lock before update
+  igsioLockGuard<vtkIGSIORecursiveCriticalSection> updateMutexGuardedLock(this->UpdateMutex);
+  if (!this->Recording || !this->CorrectlyConfigured)
+  {
+    return false;
+  }
+  // During a virtual clock replay the consumers report which data they have processed, see PlusReplayClock
+  PlusReplayClock& replayClock = PlusReplayClock::GetInstance();
+  const bool replayConsumer = this->InputDataEvent && replayClock.IsEnabled();
+  const unsigned long long replayGeneration = replayConsumer ? replayClock.GetGeneration() : 0;
+  double updateStartTime = vtkIGSIOAccurateTimer::GetSystemTime();
+  this->InternalUpdate();
+  PlusTelemetry::Instance()->AddSampleSince(PlusTelemetry::STAGE_DEVICE_UPDATE, updateStartTime);
+  if (this->AdaptiveAcquisitionRate)
+  {
+    this->UpdateSchedule.ReportNewItems(this->GetNumberOfNewItems());
+  }
+  if (replayConsumer)
+  {
+    replayClock.AcknowledgeGeneration(this, replayGeneration);
+  }
+  this->UpdateTime.Modified();
+  this->InternalUpdateRate = this->UpdateSchedule.GetUpdateRate();
+  return true;
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusDevice::InternalConnect()
 {
@@ -1643,6 +1814,53 @@ PlusStatus vtkPlusDevice::ToolTimeStampedUpdateWithoutFiltering(const std::strin
   return bufferStatus;
 }
 
+//----------------------------------------------------------------------------
+double vtkPlusDevice::GetDeviceClockTimestamp(double deviceTimeSec, double unfilteredTimestamp)
+{
+  if (!this->UseDeviceClock)
+  {
+    return UNDEFINED_TIMESTAMP;
+  }
+  this->DeviceClockModel.AddSample(deviceTimeSec, unfilteredTimestamp);
+  if (!this->DeviceClockModel.IsValid())
+  {
+    return UNDEFINED_TIMESTAMP;
+  }
+  return this->DeviceClockModel.GetSystemTime(deviceTimeSec);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDevice::ToolTimeStampedUpdateBatch(const std::string& aToolSourceId, const std::vector<vtkPlusBuffer::ToolSample>& samples)
+{
+  if (aToolSourceId.empty())
+  {
+    LOCAL_LOG_ERROR("Failed to update tool - tool source ID is empty!");
+    return PLUS_FAIL;
+  }
+  if (samples.empty())
+  {
+    return PLUS_SUCCESS;
+  }
+
+  vtkPlusDataSource* tool = NULL;
+  if (this->GetTool(aToolSourceId, tool) != PLUS_SUCCESS)
+  {
+    if (this->ReportedUnknownTools.find(aToolSourceId) == this->ReportedUnknownTools.end())
+    {
+      // We have not reported yet that this tool is unknown
+      LOCAL_LOG_ERROR("Failed to update tool - unable to find tool: " << aToolSourceId);
+      this->ReportedUnknownTools.insert(std::string(aToolSourceId));
+    }
+    return PLUS_FAIL;
+  }
+
+  unsigned long firstFrameNumber = tool->GetFrameNumber() + 1;
+  PlusStatus bufferStatus = tool->AddTimeStampedItems(samples, firstFrameNumber);
+  tool->SetFrameNumber(firstFrameNumber + static_cast<unsigned long>(samples.size()) - 1);
+
+  return bufferStatus;
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusDevice::AddVideoItemToVideoSources(const std::vector<vtkPlusDataSource*>& videoSources, const igsioVideoFrame& frame, long frameNumber, double unfilteredTimestamp/*=UNDEFINED_TIMESTAMP*/, double filteredTimestamp/*=UNDEFINED_TIMESTAMP*/, const igsioFieldMapType* customFields /*= NULL*/)
 {
@@ -2390,6 +2608,154 @@ double vtkPlusDevice::GetMissingInputGracePeriodSec() const
   return this->MissingInputGracePeriodSec;
 }
 
+//----------------------------------------------------------------------------
+bool vtkPlusDevice::GetWaitForInputData() const
+{
+  return this->WaitForInputData;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusDevice::GetUseSharedUpdateThread() const
+{
+  return this->UseSharedUpdateThread;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusDevice::GetAdaptiveAcquisitionRate() const
+{
+  return this->AdaptiveAcquisitionRate;
+}
+
+//----------------------------------------------------------------------------
+unsigned int vtkPlusDevice::GetNumberOfNewItems()
+{
+  // All data sources of a device usually receive the same items (e.g., the tools of a tracker), so they are not summed
+  unsigned int numberOfNewItems = 0;
+  size_t sourceIndex = 0;
+  const DataSourceContainer* containers[3] = { &this->Tools, &this->VideoSources, &this->Fields };
+  for (int containerIndex = 0; containerIndex < 3; ++containerIndex)
+  {
+    for (DataSourceContainerConstIterator it = containers[containerIndex]->begin(); it != containers[containerIndex]->end(); ++it, ++sourceIndex)
+    {
+      BufferItemUidType latestItemUid = it->second->GetLatestItemUidInBuffer();
+      if (sourceIndex >= this->LatestItemUids.size())
+      {
+        // First update since recording started
+        this->LatestItemUids.push_back(latestItemUid);
+        continue;
+      }
+      if (latestItemUid > this->LatestItemUids[sourceIndex] + numberOfNewItems)
+      {
+        numberOfNewItems = static_cast<unsigned int>(latestItemUid - this->LatestItemUids[sourceIndex]);
+      }
+      this->LatestItemUids[sourceIndex] = latestItemUid;
+    }
+  }
+  return numberOfNewItems;
+}
+
+//----------------------------------------------------------------------------
+PlusUpdateSchedule& vtkPlusDevice::GetUpdateSchedule()
+{
+  return this->UpdateSchedule;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusDevice::GetUseDeviceClock() const
+{
+  return this->UseDeviceClock;
+}
+
+//----------------------------------------------------------------------------
+PlusDeviceClockModel& vtkPlusDevice::GetDeviceClockModel()
+{
+  return this->DeviceClockModel;
+}
+
+//----------------------------------------------------------------------------
+unsigned long long vtkPlusDevice::GetInternalMemoryUsageInBytes()
+{
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int vtkPlusDevice::GetPixelConversionThreads() const
+{
+  return this->PixelConversionThreads;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusDevice::GetKeepSourceBitstream() const
+{
+  return this->KeepSourceBitstream;
+}
+
+//----------------------------------------------------------------------------
+PlusThreadScheduling::ThreadPriority vtkPlusDevice::GetThreadPriority() const
+{
+  return this->ThreadPriority;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusDevice::SetCpuAffinity(const std::vector<int>& cpuAffinity)
+{
+  this->CpuAffinity = cpuAffinity;
+}
+
+//----------------------------------------------------------------------------
+const std::vector<int>& vtkPlusDevice::GetCpuAffinity() const
+{
+  return this->CpuAffinity;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusDevice::ApplyThreadScheduling()
+{
+  // Failures are logged as warnings, acquisition continues with the default scheduling
+  PlusThreadScheduling::SetCurrentThreadPriority(this->ThreadPriority);
+  PlusThreadScheduling::SetCurrentThreadAffinity(this->CpuAffinity);
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusDevice::RegisterInputDataEvent(bool enable)
+{
+  std::vector<vtkPlusDataSource*> sources;
+  for (ChannelContainerIterator it = this->InputChannels.begin(); it != this->InputChannels.end(); ++it)
+  {
+    vtkPlusChannel* channel = *it;
+    vtkPlusDataSource* videoSource(NULL);
+    if (channel->HasVideoSource() && channel->GetVideoSource(videoSource) == PLUS_SUCCESS)
+    {
+      sources.push_back(videoSource);
+    }
+    for (DataSourceContainerIterator toolIt = channel->GetToolsStartIterator(); toolIt != channel->GetToolsEndIterator(); ++toolIt)
+    {
+      sources.push_back(toolIt->second);
+    }
+    for (DataSourceContainerIterator fieldIt = channel->GetFieldDataSourcesStartIterator(); fieldIt != channel->GetFieldDataSourcesEndIterator(); ++fieldIt)
+    {
+      sources.push_back(fieldIt->second);
+    }
+  }
+
+  for (std::vector<vtkPlusDataSource*>::iterator it = sources.begin(); it != sources.end(); ++it)
+  {
+    vtkPlusBuffer* buffer = (*it)->GetBuffer();
+    if (buffer == NULL)
+    {
+      continue;
+    }
+    if (enable)
+    {
+      buffer->AddNewDataEvent(this->InputDataEvent);
+    }
+    else
+    {
+      buffer->RemoveNewDataEvent(this->InputDataEvent);
+    }
+  }
+}
+
 //------------------------------------------------------------------------------
 PlusStatus vtkPlusDevice::CreateDefaultOutputChannel(const char* channelId /*=NULL*/, bool addSource/*=true*/)
 {
@@ -2470,6 +2836,14 @@ PlusStatus vtkPlusDevice::GetImage(const std::string& requestedImageId, std::str
   return PLUS_FAIL;
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDevice::GetImageVersion(const std::string& requestedImageId, const std::string& imageReferencFrameName, std::string& imageVersion)
+{
+  // Image versions are not tracked by default
+  imageVersion.clear();
+  return PLUS_FAIL;
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusDevice::SendText(const std::string& textToSend, std::string* textReceived/*=NULL*/)
 {
@@ -10,7 +10,12 @@ See License.txt for details.
 // Local includes
 #include "igsioCommon.h"
 #include "PlusConfigure.h"
+#include "PlusAcquisitionScheduler.h"
+#include "PlusDeviceClockModel.h"
+#include "PlusNewDataEvent.h"
 #include "PlusStreamBufferItem.h"
+#include "PlusThreadScheduling.h"
+#include "vtkPlusBuffer.h"
 #include "vtkPlusChannel.h"
 #include "vtkPlusDataCollectionExport.h"
 
@@ -19,10 +24,12 @@ See License.txt for details.
 #include <vtkMultiThreader.h>
 #include <vtkStdString.h>
 
+#include <memory>
 #include <set>
 
 // STL includes
 #include <string>
+#include <vector>
 
 class vtkPlusBuffer;
 class vtkPlusDataCollector;
@@ -162,6 +169,14 @@ public:
   /*! Get the internal update rate for this tracking system.  This is the number of buffer entry items sent by the device per second (per tool). */
   double GetInternalUpdateRate() const;
 
+  /*!
+    Measured rate of the data produced by the device (items per second): the lowest frame rate of its tools, or of its
+    video sources if it has no tools. 0 until enough items are acquired. Unlike GetInternalUpdateRate, it also covers
+    devices that acquire data in their own threads, and compared to GetAcquisitionRate it shows whether the device
+    achieves the requested rate. Computed from the buffer contents, it should not be called in every update.
+  */
+  double GetAchievedDataRate();
+
   /*! Get the data source object for the specified Id name, checks both video and tools */
   PlusStatus GetDataSource(const char* aSourceId, vtkPlusDataSource*& aSource);
   PlusStatus GetDataSource(const std::string& aSourceId, vtkPlusDataSource*& aSource);
@@ -417,6 +432,73 @@ public:
   vtkSetMacro(MissingInputGracePeriodSec, double);
   double GetMissingInputGracePeriodSec() const;
 
+  /*!
+    If enabled, the internal update thread wakes up as soon as new data is added to any of the input channels
+    instead of polling at a fixed interval. AcquisitionRate still defines the maximum time between updates.
+  */
+  vtkSetMacro(WaitForInputData, bool);
+  bool GetWaitForInputData() const;
+
+  /*!
+    If enabled, the internal updates are run by the shared update thread of the application (see PlusAcquisitionScheduler)
+    instead of a dedicated thread of the device. Intended for devices with a low AcquisitionRate and short updates.
+    Not used if WaitForInputData is enabled. ThreadPriority and CpuAffinity do not apply to the shared thread.
+  */
+  vtkSetMacro(UseSharedUpdateThread, bool);
+  bool GetUseSharedUpdateThread() const;
+
+  /*! Deadline statistics (jitter and overruns) of the internal updates */
+  PlusUpdateSchedule& GetUpdateSchedule();
+
+  /*!
+    If enabled, the internal updates are scheduled from the learned interval between the data items that the device
+    produces, instead of at a fixed interval: the next update runs just before the next item is expected (see the adaptive
+    mode of PlusUpdateSchedule). AcquisitionRate is used while the interval is learned, if the device stops producing
+    items, and as the maximum rate of the updates that wait for a late item. Intended for polled devices that produce items
+    at a low or unknown rate (e.g., thermal cameras), so that polling for items that do not exist yet costs almost nothing.
+  */
+  vtkSetMacro(AdaptiveAcquisitionRate, bool);
+  bool GetAdaptiveAcquisitionRate() const;
+
+  /*!
+    If enabled, the filtered timestamps are computed from the hardware timestamps of the device, mapped to the system time
+    by DeviceClockModel, instead of being filtered over AveragedItemsForFiltering items. Only used by devices that provide
+    hardware timestamps. The buffer filtering is used until the model has enough samples.
+  */
+  vtkSetMacro(UseDeviceClock, bool);
+  bool GetUseDeviceClock() const;
+
+  /*! Mapping of the hardware clock of the device to the system time, see UseDeviceClock */
+  PlusDeviceClockModel& GetDeviceClockModel();
+
+  /*!
+    Approximate memory in bytes that the device uses in addition to the buffers of its data sources, such as queued frames
+    or reconstructed volumes. Devices that keep large data outside of the buffers override it, the default is 0.
+  */
+  virtual unsigned long long GetInternalMemoryUsageInBytes();
+
+  /*!
+    Number of threads that convert the pixel encoding of the captured frames (see PixelCodec), 0 means all threads of the shared worker pool (see PlusWorkerPool).
+    Only used by devices that convert the pixel encoding of the frames.
+  */
+  vtkSetMacro(PixelConversionThreads, int);
+  int GetPixelConversionThreads() const;
+
+  /*!
+    If enabled, devices that decode a compressed video stream (e.g., MJPEG cameras) keep the compressed bitstream
+    of each frame in the buffer next to the decoded frame, so that it can be recorded without encoding it again.
+  */
+  vtkSetMacro(KeepSourceBitstream, bool);
+  bool GetKeepSourceBitstream() const;
+
+  /*! Scheduling priority of the threads of the device that acquire data (ThreadPriority attribute: NORMAL, HIGH, REALTIME) */
+  vtkSetMacro(ThreadPriority, PlusThreadScheduling::ThreadPriority);
+  PlusThreadScheduling::ThreadPriority GetThreadPriority() const;
+
+  /*! Processor cores that the threads of the device that acquire data are bound to (CpuAffinity attribute, e.g., "2 3"). Not bound if empty. */
+  void SetCpuAffinity(const std::vector<int>& cpuAffinity);
+  const std::vector<int>& GetCpuAffinity() const;
+
   /*!
     Creates a default output channel for the device with the name channelId or "OutputChannel".
     \param addSource If true then for imaging devices a default 'Video' source is added to the output.
@@ -436,6 +518,13 @@ public:
   */
   virtual PlusStatus GetImage(const std::string& requestedImageId, std::string& assignedImageId, const std::string& imageReferencFrameName, vtkImageData* imageData, vtkMatrix4x4* ijkToReferenceTransform);
 
+  /*!
+    Return a string that identifies the current content of the image that GetImage would return, without retrieving the image.
+    The version must change whenever the image or its transform changes. Repeated image requests are answered from a cache
+    while the version does not change. Returns PLUS_FAIL if the device cannot tell the version (then the image is always retrieved).
+  */
+  virtual PlusStatus GetImageVersion(const std::string& requestedImageId, const std::string& imageReferencFrameName, std::string& imageVersion);
+
   /*!
     Send text message to the device. If a non-NULL pointer is passed as textReceived
     then the device waits for a response and returns it in textReceived.
@@ -445,6 +534,12 @@ public:
 protected:
   static void* vtkDataCaptureThread(vtkMultiThreader::ThreadInfo* data);
 
+  /*!
+    Run one InternalUpdate with the update mutex locked.
+    Returns false without updating if recording is stopped or the device is not correctly configured.
+  */
+  bool ExecuteInternalUpdate();
+
   /*! Should be overridden to connect to the hardware */
   virtual PlusStatus InternalConnect();
 
@@ -491,6 +586,20 @@ protected:
   */
   virtual PlusStatus ToolTimeStampedUpdateWithoutFiltering(const std::string& aToolSourceId, vtkMatrix4x4* matrix, ToolStatus status, double unfilteredtimestamp, double filteredtimestamp, const igsioFieldMapType* customFields = NULL);
 
+  /*!
+  Add several samples of a tool at once, for high-rate sensors that receive multiple samples per update.
+  The buffer of the tool is locked only once for all the samples. The samples are added in the order of the vector.
+  This function is for devices has no frame numbering, the tool frame number is incremented for each sample.
+  */
+  virtual PlusStatus ToolTimeStampedUpdateBatch(const std::string& aToolSourceId, const std::vector<vtkPlusBuffer::ToolSample>& samples);
+
+  /*!
+  Add a sample to DeviceClockModel: an item timestamped by the device at deviceTimeSec was received at unfilteredTimestamp.
+  Returns the filtered timestamp of the item if UseDeviceClock is enabled and the model is valid,
+  otherwise UNDEFINED_TIMESTAMP (the filtered timestamp is then computed by the buffer).
+  */
+  double GetDeviceClockTimestamp(double deviceTimeSec, double unfilteredTimestamp);
+
   /*!
   Helper function used during configuration to locate the correct XML element for a device
   */
@@ -595,6 +704,44 @@ protected:
   /*! Adjust the device reporting behaviour depending on whether or not a grace period has expired */
   double RecordingStartTime;
 
+  /*! If true then the internal update thread is woken up by new data in the input channels */
+  bool WaitForInputData;
+  /*! Number of threads used for converting the pixel encoding of captured frames */
+  int PixelConversionThreads;
+  /*! If true then decoding devices keep the compressed bitstream of the frames in the buffer */
+  bool KeepSourceBitstream;
+  /*! Event that is signaled by the input channel buffers when new data is added */
+  std::shared_ptr<PlusNewDataEvent> InputDataEvent;
+  /*! If true then the internal updates are run by the shared update thread */
+  bool UseSharedUpdateThread;
+  /*! Release times and deadline statistics of the internal updates, the period is defined by AcquisitionRate */
+  PlusUpdateSchedule UpdateSchedule;
+  /*! If true then the internal updates are scheduled from the learned interval between data items */
+  bool AdaptiveAcquisitionRate;
+  /*! Latest item UID of each data source after the last internal update, for counting the new items of an update */
+  std::vector<BufferItemUidType> LatestItemUids;
+  /*! If true then the filtered timestamps are computed from the hardware timestamps of the device */
+  bool UseDeviceClock;
+  /*! Maps the hardware timestamps of the device to the system time */
+  PlusDeviceClockModel DeviceClockModel;
+
+  /*! Register (or unregister) InputDataEvent in the buffers of all input channel data sources */
+  void RegisterInputDataEvent(bool enable);
+
+  /*! Number of items added to the data source with the most new items since the last call, used by AdaptiveAcquisitionRate */
+  unsigned int GetNumberOfNewItems();
+
+  /*!
+    Apply ThreadPriority and CpuAffinity to the calling thread.
+    Called by the internal update thread, devices that start their own acquisition threads should call it at the beginning of those threads.
+  */
+  void ApplyThreadScheduling();
+
+  /*! Scheduling priority of the acquisition threads */
+  PlusThreadScheduling::ThreadPriority ThreadPriority;
+  /*! Processor cores of the acquisition threads */
+  std::vector<int> CpuAffinity;
+
   /*!
     The list contains the IDs of the tools that have been already reported to be unknown.
     This list is used to only report an unknown tool once (after the connection has been established), not at each
@@ -0,0 +1,406 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "vtkPlusDevice.h"
+#include "vtkPlusDeviceDiscovery.h"
+#include "vtkPlusDeviceFactory.h"
+
+// IGSIO includes
+#include <vtkIGSIOAccurateTimer.h>
+
+// VTK includes
+#include <vtkObjectFactory.h>
+#include <vtkXMLDataElement.h>
+
+// STL includes
+#include <chrono>
+#include <future>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+vtkStandardNewMacro(vtkPlusDeviceDiscovery);
+
+namespace
+{
+  const char* PROBED_DEVICE_ID = "ProbedDevice";
+
+  /*! Device types that are detected on a serial port */
+  const char* SERIAL_PORT_DEVICE_TYPES[] =
+  {
+    "NDITracker",
+    "ChRobotics",
+    "Microchip",
+    "BrachyTracker",
+    NULL
+  };
+
+  /*! Device types that are detected by their SDK without additional information */
+  const char* SDK_DEVICE_TYPES[] =
+  {
+    "SteamVR",
+    "MicronTracker",
+    "Ascension3DG",
+    "3dConnexion",
+    "AtracsysTracker",
+    "CertusTracker",
+    "PhidgetSpatial",
+    "LeapMotion",
+    "IntuitiveDaVinci",
+    "USDigitalEncodersTracker",
+    "MmfVideo",
+    "V4L2Video",
+    "DeckLinkVideo",
+    "Epiphan",
+    "IntersonVideo",
+    "TelemedVideo",
+    "SpinnakerVideo",
+    "ThorLabsVideo",
+    "CapistranoVideo",
+    "WinProbeVideo",
+    NULL
+  };
+
+  struct ProbeOutcome
+  {
+    ProbeOutcome() : Result(vtkPlusDeviceDiscovery::PROBE_FAILED), IsTracker(false) {}
+    vtkPlusDeviceDiscovery::ProbeResultType Result;
+    bool IsTracker;
+  };
+
+  //----------------------------------------------------------------------------
+  void AddDeviceElement(vtkXMLDataElement* dataCollectionElement, const vtkPlusDeviceDiscovery::Candidate& candidate, const std::string& deviceId)
+  {
+    vtkSmartPointer<vtkXMLDataElement> deviceElement = vtkSmartPointer<vtkXMLDataElement>::New();
+    deviceElement->SetName("Device");
+    deviceElement->SetAttribute("Id", deviceId.c_str());
+    deviceElement->SetAttribute("Type", candidate.DeviceType.c_str());
+    for (std::map<std::string, std::string>::const_iterator it = candidate.Attributes.begin(); it != candidate.Attributes.end(); ++it)
+    {
+      deviceElement->SetAttribute(it->first.c_str(), it->second.c_str());
+    }
+    dataCollectionElement->AddNestedElement(deviceElement);
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Create, configure and probe a device. Runs on its own thread, so that it can be abandoned if it does not complete in time. */
+  void RunProbe(vtkPlusDeviceDiscovery::Candidate candidate, std::shared_ptr<std::promise<ProbeOutcome> > outcomePromise)
+  {
+    ProbeOutcome outcome;
+
+    // Each probe has its own factory, as plugin loading modifies the factory
+    vtkSmartPointer<vtkPlusDeviceFactory> factory = vtkSmartPointer<vtkPlusDeviceFactory>::New();
+    vtkPlusDevice* device = NULL;
+    if (factory->CreateInstance(candidate.DeviceType.c_str(), device, PROBED_DEVICE_ID) == PLUS_SUCCESS)
+    {
+      vtkSmartPointer<vtkXMLDataElement> configRootElement = vtkSmartPointer<vtkXMLDataElement>::New();
+      configRootElement->SetName("PlusConfiguration");
+      vtkSmartPointer<vtkXMLDataElement> dataCollectionElement = vtkSmartPointer<vtkXMLDataElement>::New();
+      dataCollectionElement->SetName("DataCollection");
+      configRootElement->AddNestedElement(dataCollectionElement);
+      vtkPlusDeviceDiscovery::Candidate probedCandidate = candidate;
+      // Avoid the warning about the undefined reference frame of trackers
+      probedCandidate.Attributes["ToolReferenceFrame"] = "Tracker";
+      AddDeviceElement(dataCollectionElement, probedCandidate, PROBED_DEVICE_ID);
+
+      if (device->ReadConfiguration(configRootElement) == PLUS_SUCCESS)
+      {
+        outcome.IsTracker = device->IsTracker();
+        outcome.Result = (device->Probe() == PLUS_SUCCESS) ? vtkPlusDeviceDiscovery::PROBE_FOUND : vtkPlusDeviceDiscovery::PROBE_NOT_FOUND;
+      }
+      device->Delete();
+    }
+
+    outcomePromise->set_value(outcome);
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkPlusDeviceDiscovery::Candidate::Candidate(const std::string& deviceType, const std::string& resource)
+  : DeviceType(deviceType)
+  , Resource(resource)
+{
+}
+
+//----------------------------------------------------------------------------
+vtkPlusDeviceDiscovery::vtkPlusDeviceDiscovery()
+  : ProbeTimeoutSec(5.0)
+{
+}
+
+//----------------------------------------------------------------------------
+vtkPlusDeviceDiscovery::~vtkPlusDeviceDiscovery()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusDeviceDiscovery::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "ProbeTimeoutSec: " << this->ProbeTimeoutSec << std::endl;
+  os << indent << "NumberOfCandidates: " << this->Candidates.size() << std::endl;
+  for (std::vector<ProbeResult>::const_iterator it = this->Results.begin(); it != this->Results.end(); ++it)
+  {
+    os << indent.GetNextIndent() << it->ProbedCandidate.DeviceType;
+    if (!it->ProbedCandidate.Resource.empty())
+    {
+      os << " (" << it->ProbedCandidate.Resource << ")";
+    }
+    os << ": " << GetProbeResultAsString(it->Result) << std::endl;
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusDeviceDiscovery::AddCandidate(const Candidate& candidate)
+{
+  this->Candidates.push_back(candidate);
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusDeviceDiscovery::ClearCandidates()
+{
+  this->Candidates.clear();
+}
+
+//----------------------------------------------------------------------------
+int vtkPlusDeviceDiscovery::GetNumberOfCandidates() const
+{
+  return static_cast<int>(this->Candidates.size());
+}
+
+//----------------------------------------------------------------------------
+const std::vector<vtkPlusDeviceDiscovery::Candidate>& vtkPlusDeviceDiscovery::GetCandidates() const
+{
+  return this->Candidates;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusDeviceDiscovery::AddDefaultCandidates(int maxSerialPort)
+{
+  vtkSmartPointer<vtkPlusDeviceFactory> factory = vtkSmartPointer<vtkPlusDeviceFactory>::New();
+  std::string className;
+
+  for (int port = 1; port <= maxSerialPort; ++port)
+  {
+    std::ostringstream portStr;
+    portStr << port;
+    for (int i = 0; SERIAL_PORT_DEVICE_TYPES[i] != NULL; ++i)
+    {
+      if (factory->GetDeviceClassName(SERIAL_PORT_DEVICE_TYPES[i], className) != PLUS_SUCCESS)
+      {
+        continue;
+      }
+      Candidate candidate(SERIAL_PORT_DEVICE_TYPES[i], "SerialPort" + portStr.str());
+      candidate.Attributes["SerialPort"] = portStr.str();
+      this->AddCandidate(candidate);
+    }
+  }
+
+  for (int i = 0; SDK_DEVICE_TYPES[i] != NULL; ++i)
+  {
+    if (factory->GetDeviceClassName(SDK_DEVICE_TYPES[i], className) == PLUS_SUCCESS)
+    {
+      this->AddCandidate(Candidate(SDK_DEVICE_TYPES[i]));
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDeviceDiscovery::Discover()
+{
+  this->Results.clear();
+  this->Results.resize(this->Candidates.size());
+
+  // Candidates that share a resource are probed by the same thread, in the order they were added
+  std::vector<std::vector<int> > candidateGroups;
+  std::map<std::string, int> resourceGroups;
+  for (int i = 0; i < static_cast<int>(this->Candidates.size()); ++i)
+  {
+    const std::string& resource = this->Candidates[i].Resource;
+    if (resource.empty())
+    {
+      candidateGroups.push_back(std::vector<int>(1, i));
+      continue;
+    }
+    std::map<std::string, int>::iterator groupIt = resourceGroups.find(resource);
+    if (groupIt == resourceGroups.end())
+    {
+      resourceGroups[resource] = static_cast<int>(candidateGroups.size());
+      candidateGroups.push_back(std::vector<int>(1, i));
+    }
+    else
+    {
+      candidateGroups[groupIt->second].push_back(i);
+    }
+  }
+
+  LOG_INFO("Probing " << this->Candidates.size() << " device candidates on " << candidateGroups.size() << " threads");
+  const double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+
+  std::vector<std::thread> groupThreads;
+  for (std::vector<std::vector<int> >::iterator groupIt = candidateGroups.begin(); groupIt != candidateGroups.end(); ++groupIt)
+  {
+    groupThreads.push_back(std::thread(&vtkPlusDeviceDiscovery::ProbeCandidates, std::cref(this->Candidates), std::cref(*groupIt),
+                                       this->ProbeTimeoutSec, std::ref(this->Results)));
+  }
+  for (std::vector<std::thread>::iterator threadIt = groupThreads.begin(); threadIt != groupThreads.end(); ++threadIt)
+  {
+    threadIt->join();
+  }
+
+  int numberOfFoundDevices = 0;
+  for (std::vector<ProbeResult>::iterator it = this->Results.begin(); it != this->Results.end(); ++it)
+  {
+    if (it->Result == PROBE_FOUND)
+    {
+      numberOfFoundDevices++;
+    }
+  }
+  LOG_INFO("Found " << numberOfFoundDevices << " devices in " << vtkIGSIOAccurateTimer::GetSystemTime() - startTime << " sec");
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusDeviceDiscovery::ProbeCandidates(const std::vector<Candidate>& candidates, const std::vector<int>& candidateIndices, double probeTimeoutSec, std::vector<ProbeResult>& results)
+{
+  bool resourceBlocked = false;
+  for (std::vector<int>::const_iterator indexIt = candidateIndices.begin(); indexIt != candidateIndices.end(); ++indexIt)
+  {
+    const Candidate& candidate = candidates[*indexIt];
+    ProbeResult& result = results[*indexIt];
+    result.ProbedCandidate = candidate;
+    if (resourceBlocked)
+    {
+      result.Result = PROBE_SKIPPED;
+      continue;
+    }
+
+    std::shared_ptr<std::promise<ProbeOutcome> > outcomePromise = std::make_shared<std::promise<ProbeOutcome> >();
+    std::future<ProbeOutcome> outcomeFuture = outcomePromise->get_future();
+    const double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+    std::thread(&RunProbe, candidate, outcomePromise).detach();
+
+    if (outcomeFuture.wait_for(std::chrono::duration<double>(probeTimeoutSec)) != std::future_status::ready)
+    {
+      // The probe thread completes in the background, the resource is not available until then
+      result.Result = PROBE_TIMED_OUT;
+      resourceBlocked = true;
+      LOG_WARNING("Probing of " << candidate.DeviceType << (candidate.Resource.empty() ? std::string() : " on " + candidate.Resource)
+                  << " did not complete in " << probeTimeoutSec << " sec");
+    }
+    else
+    {
+      ProbeOutcome outcome = outcomeFuture.get();
+      result.Result = outcome.Result;
+      result.IsTracker = outcome.IsTracker;
+    }
+    result.ElapsedTimeSec = vtkIGSIOAccurateTimer::GetSystemTime() - startTime;
+    LOG_DEBUG("Probing of " << candidate.DeviceType << (candidate.Resource.empty() ? std::string() : " on " + candidate.Resource)
+              << ": " << GetProbeResultAsString(result.Result) << " (" << result.ElapsedTimeSec << " sec)");
+  }
+}
+
+//----------------------------------------------------------------------------
+const std::vector<vtkPlusDeviceDiscovery::ProbeResult>& vtkPlusDeviceDiscovery::GetResults() const
+{
+  return this->Results;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDeviceDiscovery::GetConfigurationSkeleton(vtkXMLDataElement* configRootElement) const
+{
+  if (configRootElement == NULL)
+  {
+    LOG_ERROR("Failed to create device set configuration skeleton - root element is NULL");
+    return PLUS_FAIL;
+  }
+
+  configRootElement->RemoveAllNestedElements();
+  configRootElement->SetName("PlusConfiguration");
+  configRootElement->SetAttribute("version", "2.1");
+
+  vtkSmartPointer<vtkXMLDataElement> dataCollectionElement = vtkSmartPointer<vtkXMLDataElement>::New();
+  dataCollectionElement->SetName("DataCollection");
+  dataCollectionElement->SetAttribute("StartupDelaySec", "1.0");
+  configRootElement->AddNestedElement(dataCollectionElement);
+
+  vtkSmartPointer<vtkXMLDataElement> deviceSetElement = vtkSmartPointer<vtkXMLDataElement>::New();
+  deviceSetElement->SetName("DeviceSet");
+  deviceSetElement->SetAttribute("Name", "Discovered devices");
+  deviceSetElement->SetAttribute("Description", "Devices found by probing. Tools of trackers must be added manually.");
+  dataCollectionElement->AddNestedElement(deviceSetElement);
+
+  std::map<std::string, int> numberOfDevicesOfType;
+  for (std::vector<ProbeResult>::const_iterator it = this->Results.begin(); it != this->Results.end(); ++it)
+  {
+    if (it->Result != PROBE_FOUND)
+    {
+      continue;
+    }
+    Candidate deviceCandidate = it->ProbedCandidate;
+    std::ostringstream deviceId;
+    deviceId << deviceCandidate.DeviceType;
+    int deviceIndex = ++numberOfDevicesOfType[deviceCandidate.DeviceType];
+    if (deviceIndex > 1)
+    {
+      deviceId << deviceIndex;
+    }
+
+    if (it->IsTracker)
+    {
+      deviceCandidate.Attributes["ToolReferenceFrame"] = "Tracker";
+      AddDeviceElement(dataCollectionElement, deviceCandidate, deviceId.str());
+      continue;
+    }
+
+    AddDeviceElement(dataCollectionElement, deviceCandidate, deviceId.str());
+    vtkXMLDataElement* deviceElement = dataCollectionElement->GetNestedElement(dataCollectionElement->GetNumberOfNestedElements() - 1);
+
+    vtkSmartPointer<vtkXMLDataElement> dataSourcesElement = vtkSmartPointer<vtkXMLDataElement>::New();
+    dataSourcesElement->SetName("DataSources");
+    vtkSmartPointer<vtkXMLDataElement> dataSourceElement = vtkSmartPointer<vtkXMLDataElement>::New();
+    dataSourceElement->SetName("DataSource");
+    dataSourceElement->SetAttribute("Type", "Video");
+    dataSourceElement->SetAttribute("Id", "Video");
+    dataSourceElement->SetAttribute("PortUsImageOrientation", "MF");
+    dataSourcesElement->AddNestedElement(dataSourceElement);
+    deviceElement->AddNestedElement(dataSourcesElement);
+
+    vtkSmartPointer<vtkXMLDataElement> outputChannelsElement = vtkSmartPointer<vtkXMLDataElement>::New();
+    outputChannelsElement->SetName("OutputChannels");
+    vtkSmartPointer<vtkXMLDataElement> outputChannelElement = vtkSmartPointer<vtkXMLDataElement>::New();
+    outputChannelElement->SetName("OutputChannel");
+    outputChannelElement->SetAttribute("Id", (deviceId.str() + "VideoStream").c_str());
+    vtkSmartPointer<vtkXMLDataElement> channelDataSourceElement = vtkSmartPointer<vtkXMLDataElement>::New();
+    channelDataSourceElement->SetName("DataSource");
+    channelDataSourceElement->SetAttribute("Id", "Video");
+    outputChannelElement->AddNestedElement(channelDataSourceElement);
+    outputChannelsElement->AddNestedElement(outputChannelElement);
+    deviceElement->AddNestedElement(outputChannelsElement);
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+const char* vtkPlusDeviceDiscovery::GetProbeResultAsString(ProbeResultType result)
+{
+  switch (result)
+  {
+    case PROBE_FOUND:
+      return "found";
+    case PROBE_NOT_FOUND:
+      return "not found";
+    case PROBE_TIMED_OUT:
+      return "timed out";
+    case PROBE_SKIPPED:
+      return "skipped";
+    case PROBE_FAILED:
+      return "failed";
+  }
+  return "unknown";
+}
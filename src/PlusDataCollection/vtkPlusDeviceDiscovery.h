@@ -0,0 +1,117 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __vtkPlusDeviceDiscovery_h
+#define __vtkPlusDeviceDiscovery_h
+
+#include "PlusConfigure.h"
+#include "vtkPlusDataCollectionExport.h"
+
+// VTK includes
+#include <vtkObject.h>
+
+// STL includes
+#include <map>
+#include <string>
+#include <vector>
+
+class vtkXMLDataElement;
+
+/*!
+  \class vtkPlusDeviceDiscovery
+  \brief Finds connected devices by probing candidate device types in parallel
+
+  Each candidate is a device type with the device element attributes that are needed to probe it (e.g., SerialPort).
+  For each candidate a device is created by vtkPlusDeviceFactory, configured from the candidate attributes, and its
+  Probe method is called. Candidates that use different resources (e.g., serial ports) are probed in parallel, while
+  candidates of the same resource are probed one after the other, so that they do not interfere with each other.
+
+  Each probe runs on its own thread and it is abandoned if it does not complete within ProbeTimeoutSec. As a probe
+  that timed out may still hold its resource, the remaining candidates of that resource are skipped. Probe threads are
+  not run by the process-wide worker pool, as most probes are blocked waiting for a device response.
+
+  The found devices are written into a device set configuration skeleton that can be edited and used directly.
+
+  \ingroup PlusLibDataCollection
+*/
+class vtkPlusDataCollectionExport vtkPlusDeviceDiscovery : public vtkObject
+{
+public:
+  enum ProbeResultType
+  {
+    PROBE_FOUND,
+    PROBE_NOT_FOUND,
+    PROBE_TIMED_OUT,
+    PROBE_SKIPPED,
+    PROBE_FAILED
+  };
+
+  struct Candidate
+  {
+    Candidate() {}
+    Candidate(const std::string& deviceType, const std::string& resource = std::string());
+    std::string DeviceType;
+    /*! Probes of candidates with the same non-empty resource are not run in parallel */
+    std::string Resource;
+    /*! Device element attributes (in addition to Id and Type) */
+    std::map<std::string, std::string> Attributes;
+  };
+
+  struct ProbeResult
+  {
+    ProbeResult() : Result(PROBE_FAILED), ElapsedTimeSec(0.0), IsTracker(false) {}
+    Candidate ProbedCandidate;
+    ProbeResultType Result;
+    double ElapsedTimeSec;
+    bool IsTracker;
+  };
+
+  static vtkPlusDeviceDiscovery* New();
+  vtkTypeMacro(vtkPlusDeviceDiscovery, vtkObject);
+  virtual void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  void AddCandidate(const Candidate& candidate);
+  void ClearCandidates();
+  int GetNumberOfCandidates() const;
+  const std::vector<Candidate>& GetCandidates() const;
+
+  /*!
+    Add the device types that can be detected without additional information (hardware that is found by the SDK
+    and trackers on serial ports 1..maxSerialPort). Device types that are not supported by this build are ignored.
+  */
+  void AddDefaultCandidates(int maxSerialPort = 20);
+
+  /*! Probe all candidates and store the results. Returns when all probes are completed or timed out. */
+  PlusStatus Discover();
+
+  const std::vector<ProbeResult>& GetResults() const;
+
+  /*! Write the found devices into a device set configuration (PlusConfiguration element) */
+  PlusStatus GetConfigurationSkeleton(vtkXMLDataElement* configRootElement) const;
+
+  static const char* GetProbeResultAsString(ProbeResultType result);
+
+  /*! Maximum time a single probe may take */
+  vtkSetMacro(ProbeTimeoutSec, double);
+  vtkGetMacro(ProbeTimeoutSec, double);
+
+protected:
+  vtkPlusDeviceDiscovery();
+  virtual ~vtkPlusDeviceDiscovery();
+
+  /*! Probe the candidates of one resource in order and store their results at the same indices */
+  static void ProbeCandidates(const std::vector<Candidate>& candidates, const std::vector<int>& candidateIndices, double probeTimeoutSec, std::vector<ProbeResult>& results);
+
+  std::vector<Candidate> Candidates;
+  std::vector<ProbeResult> Results;
+  double ProbeTimeoutSec;
+
+private:
+  vtkPlusDeviceDiscovery(const vtkPlusDeviceDiscovery&);
+  void operator=(const vtkPlusDeviceDiscovery&);
+};
+
+#endif
@@ -11,6 +11,11 @@ See License.txt for details.
 
 // VTK includes
 #include <vtkObjectFactory.h>
+#include <vtksys/DynamicLoader.hxx>
+#include <vtksys/SystemTools.hxx>
+
+// STL includes
+#include <mutex>
 
 //----------------------------------------------------------------------------
 // Virtual devices
@@ -19,6 +24,8 @@ See License.txt for details.
 #include "vtkPlusVirtualCapture.h"
 #include "vtkPlusVirtualVolumeReconstructor.h"
 #include "vtkPlusVirtualDeinterlacer.h"
+#include "vtkPlusVirtualTemporalCalibrator.h"
+#include "vtkPlusVirtualResampler.h"
 #include "vtkPlusImageProcessorVideoSource.h"
 #include "vtkPlusGenericSerialDevice.h"
 #ifdef PLUS_USE_TextRecognizer
@@ -153,6 +160,8 @@ See License.txt for details.
 
 #ifdef PLUS_USE_OpenIGTLink
   #include "vtkPlusOpenIGTLinkVideoSource.h"
+  #include "vtkPlusSharedMemoryVideoSource.h"
+  #include "vtkPlusSharedMemoryVideoWriter.h"
 #endif
 
 #ifdef PLUS_USE_EPIPHAN
@@ -283,6 +292,8 @@ vtkPlusDeviceFactory::vtkPlusDeviceFactory()
   RegisterDevice("NoiseVideo", "vtkPlusDevice", (PointerToDevice)&vtkPlusDevice::New);
 #ifdef PLUS_USE_OpenIGTLink
   RegisterDevice("OpenIGTLinkVideo", "vtkPlusOpenIGTLinkVideoSource", (PointerToDevice)&vtkPlusOpenIGTLinkVideoSource::New);
+  RegisterDevice("SharedMemoryVideo", "vtkPlusSharedMemoryVideoSource", (PointerToDevice)&vtkPlusSharedMemoryVideoSource::New);
+  RegisterDevice("SharedMemoryVideoWriter", "vtkPlusSharedMemoryVideoWriter", (PointerToDevice)&vtkPlusSharedMemoryVideoWriter::New);
 #endif
 #ifdef PLUS_USE_OPTIMET_CONOPROBE
   RegisterDevice("OptimetConoProbe", "vtkPlusOptimetConoProbeMeasurer", (PointerToDevice)&vtkPlusOptimetConoProbeMeasurer::New);
@@ -400,6 +411,8 @@ vtkPlusDeviceFactory::vtkPlusDeviceFactory()
   RegisterDevice("VirtualBufferedCapture", "vtkPlusVirtualCapture", (PointerToDevice)&vtkPlusVirtualCapture::New); // for backward compatibility
   RegisterDevice("VirtualVolumeReconstructor", "vtkPlusVirtualVolumeReconstructor", (PointerToDevice)&vtkPlusVirtualVolumeReconstructor::New);
   RegisterDevice("VirtualDeinterlacer", "vtkPlusVirtualDeinterlacer", (PointerToDevice)&vtkPlusVirtualDeinterlacer::New);
+  RegisterDevice("VirtualTemporalCalibrator", "vtkPlusVirtualTemporalCalibrator", (PointerToDevice)&vtkPlusVirtualTemporalCalibrator::New);
+  RegisterDevice("VirtualResampler", "vtkPlusVirtualResampler", (PointerToDevice)&vtkPlusVirtualResampler::New);
 }
 
 //----------------------------------------------------------------------------
@@ -446,25 +459,24 @@ PlusStatus vtkPlusDeviceFactory::CreateInstance(const char* aDeviceType, vtkPlus
     return PLUS_FAIL;
   }
 
-  if (DeviceTypes.find(aDeviceType) == DeviceTypes.end())
+  if (DeviceTypes.find(aDeviceType) == DeviceTypes.end() && this->LoadDevicePlugin(aDeviceType) != PLUS_SUCCESS)
   {
+    // Only the names are needed, devices are not instantiated to avoid initializing their SDKs
     std::string listOfSupportedDevices;
     std::map<std::string, PointerToDevice>::iterator it;
     for (it = DeviceTypes.begin(); it != DeviceTypes.end(); ++it)
     {
       if (it->second != NULL)
       {
-        vtkPlusDevice* device = (*it->second)();
         if (!listOfSupportedDevices.empty())
         {
           listOfSupportedDevices.append(", ");
         }
         listOfSupportedDevices.append(it->first);
-        device->Delete();
-        device = NULL;
       }
     }
-    LOG_ERROR("Unknown device type: " << aDeviceType << ". Supported devices: " << listOfSupportedDevices);
+    LOG_ERROR("Unknown device type: " << aDeviceType << ". Supported devices: " << listOfSupportedDevices
+              << ". No device plugin module (" << GetDevicePluginFileName(aDeviceType) << ") is found either.");
     return PLUS_FAIL;
   }
 
@@ -521,3 +533,90 @@ void vtkPlusDeviceFactory::RegisterDevice(const std::string& deviceTypeName, con
   vtkPlusDeviceFactory::DeviceTypes[deviceTypeName] = constructionMethod;
   vtkPlusDeviceFactory::DeviceTypeClassNames[deviceTypeName] = deviceClassName;
 }
+
+//----------------------------------------------------------------------------
+std::string vtkPlusDeviceFactory::GetDevicePluginFileName(const std::string& deviceTypeName)
+{
+  return std::string(vtksys::DynamicLoader::LibPrefix()) + "PlusDevicePlugin" + deviceTypeName + vtksys::DynamicLoader::LibExtension();
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDeviceFactory::LoadDevicePlugin(const std::string& deviceTypeName)
+{
+  if (this->DeviceTypes.find(deviceTypeName) != this->DeviceTypes.end())
+  {
+    return PLUS_SUCCESS;
+  }
+
+  // Plugin modules are shared by all factory instances and they are never unloaded, as devices that were created
+  // from them may outlive the factory
+  static std::mutex pluginLibrariesMutex;
+  static std::map<std::string, vtksys::DynamicLoader::LibraryHandle> pluginLibraries;
+  std::lock_guard<std::mutex> lock(pluginLibrariesMutex);
+
+  vtksys::DynamicLoader::LibraryHandle library = NULL;
+  std::map<std::string, vtksys::DynamicLoader::LibraryHandle>::iterator loadedLibraryIt = pluginLibraries.find(deviceTypeName);
+  if (loadedLibraryIt != pluginLibraries.end())
+  {
+    library = loadedLibraryIt->second;
+  }
+  else
+  {
+    const std::string pluginFileName = GetDevicePluginFileName(deviceTypeName);
+    std::vector<std::string> searchDirectories;
+    std::string pluginPath;
+    if (vtksys::SystemTools::GetEnv("PLUS_DEVICE_PLUGIN_PATH", pluginPath))
+    {
+#ifdef _WIN32
+      const char pathSeparator = ';';
+#else
+      const char pathSeparator = ':';
+#endif
+      searchDirectories = vtksys::SystemTools::SplitString(pluginPath, pathSeparator);
+    }
+    for (std::vector<std::string>::iterator dirIt = searchDirectories.begin(); dirIt != searchDirectories.end() && library == NULL; ++dirIt)
+    {
+      if (dirIt->empty())
+      {
+        continue;
+      }
+      std::string pluginFilePath = *dirIt + "/" + pluginFileName;
+      if (vtksys::SystemTools::FileExists(pluginFilePath, true))
+      {
+        library = vtksys::DynamicLoader::OpenLibrary(pluginFilePath);
+        if (library == NULL)
+        {
+          LOG_ERROR("Failed to load device plugin module " << pluginFilePath << ": " << vtksys::DynamicLoader::LastError());
+          return PLUS_FAIL;
+        }
+      }
+    }
+    if (library == NULL)
+    {
+      // Let the system find the module in the default library search path
+      library = vtksys::DynamicLoader::OpenLibrary(pluginFileName);
+      if (library == NULL)
+      {
+        LOG_DEBUG("Device plugin module " << pluginFileName << " is not found: " << vtksys::DynamicLoader::LastError());
+        return PLUS_FAIL;
+      }
+    }
+    pluginLibraries[deviceTypeName] = library;
+    LOG_INFO("Loaded device plugin module " << pluginFileName);
+  }
+
+  typedef const char* (*PointerToClassName)();
+  const std::string newSymbolName = "PlusDevicePluginNew_" + deviceTypeName;
+  const std::string classNameSymbolName = "PlusDevicePluginClassName_" + deviceTypeName;
+  PointerToDevice constructionMethod = reinterpret_cast<PointerToDevice>(vtksys::DynamicLoader::GetSymbolAddress(library, newSymbolName));
+  PointerToClassName classNameMethod = reinterpret_cast<PointerToClassName>(vtksys::DynamicLoader::GetSymbolAddress(library, classNameSymbolName));
+  if (constructionMethod == NULL || classNameMethod == NULL)
+  {
+    LOG_ERROR("Device plugin module " << GetDevicePluginFileName(deviceTypeName) << " does not provide device type " << deviceTypeName
+              << " (" << newSymbolName << " or " << classNameSymbolName << " function is missing)");
+    return PLUS_FAIL;
+  }
+
+  this->RegisterDevice(deviceTypeName, (*classNameMethod)(), constructionMethod);
+  return PLUS_SUCCESS;
+}
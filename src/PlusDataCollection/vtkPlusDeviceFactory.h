@@ -22,6 +22,13 @@ class vtkPlusDevice;
 
   This class is a factory class of supported trackers and video sources to localize the object creation code.
 
+  Device types that are not compiled into the library are loaded on demand from device plugin modules: when
+  CreateInstance is called with an unknown device type, the factory looks for a shared library named
+  PlusDevicePlugin<DeviceType> (e.g., libPlusDevicePluginClarius.so or PlusDevicePluginClarius.dll) in the directories
+  listed in the PLUS_DEVICE_PLUGIN_PATH environment variable and then in the default library search path.
+  The plugin module must export its factory functions using the PLUS_DEVICE_PLUGIN macro (see PlusDevicePlugin.h).
+  Plugin modules are only loaded when a device of that type is created, and they remain loaded until the process exits.
+
   \ingroup PlusLibigsioCommon
 */
 class vtkPlusDataCollectionExport vtkPlusDeviceFactory : public vtkObject
@@ -50,6 +57,15 @@ public:
   /*! Registration function to add new devices to the factory */
   void RegisterDevice(const std::string& deviceTypeName, const std::string& deviceClassName, PointerToDevice constructionMethod);
 
+  /*!
+    Load the plugin module of a device type and register the device it provides.
+    Succeeds without loading anything if the device type is already registered.
+  */
+  PlusStatus LoadDevicePlugin(const std::string& deviceTypeName);
+
+  /*! Get the file name of the plugin module that provides the specified device type */
+  static std::string GetDevicePluginFileName(const std::string& deviceTypeName);
+
 protected:
   vtkPlusDeviceFactory(void);
   virtual ~vtkPlusDeviceFactory(void);
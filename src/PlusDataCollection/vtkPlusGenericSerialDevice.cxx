@@ -60,6 +60,7 @@ vtkPlusGenericSerialDevice::vtkPlusGenericSerialDevice()
   , RTS(false)
   , MaximumReplyDelaySec(0.100)
   , MaximumReplyDurationSec(0.300)
+  , AsynchronousIo(false)
   , Mutex(vtkSmartPointer<vtkIGSIORecursiveCriticalSection>::New())
   , FrameNumber(0)
   , FieldDataSource(nullptr)
@@ -123,6 +124,8 @@ PlusStatus vtkPlusGenericSerialDevice::InternalConnect()
 
   this->Serial->SetMaxReplyTime(50);   // msec
 
+  this->Serial->SetAsynchronousMode(this->AsynchronousIo);
+
   if (!this->Serial->Open())
   {
     LOG_ERROR("Cannot open serial port " << strComPort.str());
@@ -293,20 +296,8 @@ PlusStatus vtkPlusGenericSerialDevice::SendText(const std::string& textToSend, s
 //-------------------------------------------------------------------------
 bool vtkPlusGenericSerialDevice::WaitForResponse()
 {
-  const int waitPeriodSec = 0.010;
-
-  double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
-  while (this->Serial->GetNumberOfBytesAvailableForReading() == 0)
-  {
-    if (vtkIGSIOAccurateTimer::GetSystemTime() - startTime > this->MaximumReplyDelaySec)
-    {
-      // waiting time expired
-      return false;
-    }
-    vtksys::SystemTools::Delay(waitPeriodSec * 1000);
-  }
-  // data available for reading
-  return true;
+  // In asynchronous mode the serial line signals the arrival of data, otherwise it checks the port periodically
+  return this->Serial->WaitForData(static_cast<int>(this->MaximumReplyDelaySec * 1000));
 }
 
 //-------------------------------------------------------------------------
@@ -384,6 +375,7 @@ PlusStatus vtkPlusGenericSerialDevice::ReadConfiguration(vtkXMLDataElement* root
   XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, MaximumReplyDelaySec, deviceConfig);
   XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, MaximumReplyDurationSec, deviceConfig);
   XML_READ_CSTRING_ATTRIBUTE_OPTIONAL(LineEnding, deviceConfig);
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(AsynchronousIo, deviceConfig);
   return PLUS_SUCCESS;
 }
 
@@ -396,6 +388,7 @@ PlusStatus vtkPlusGenericSerialDevice::WriteConfiguration(vtkXMLDataElement* roo
   deviceConfig->SetDoubleAttribute("MaximumReplyDelaySec", this->MaximumReplyDelaySec);
   deviceConfig->SetDoubleAttribute("MaximumReplyDurationSec", this->MaximumReplyDurationSec);
   deviceConfig->SetAttribute("LineEnding", this->LineEnding.c_str());
+  XML_WRITE_BOOL_ATTRIBUTE(AsynchronousIo, deviceConfig);
   return PLUS_SUCCESS;
 }
 
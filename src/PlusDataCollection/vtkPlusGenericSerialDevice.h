@@ -56,6 +56,10 @@ public:
   vtkSetMacro(MaximumReplyDelaySec, double);
   vtkSetMacro(MaximumReplyDurationSec, double);
 
+  /*! If enabled then the serial port receives data in the background (asynchronous I/O) and waiting for replies does not use CPU time */
+  vtkSetMacro(AsynchronousIo, bool);
+  vtkGetMacro(AsynchronousIo, bool);
+
   /*! Line ending in hex encoded form, separated by spaces (e.g., "13 10") */
   void SetLineEnding(const char* lineEndingHex);
   vtkGetMacro(LineEnding, std::string);
@@ -147,6 +151,9 @@ protected:
   /*! Maximum time to wait for the device to finish replying */
   double MaximumReplyDurationSec;
 
+  /*! Use asynchronous (overlapped) I/O for the serial line */
+  bool AsynchronousIo;
+
   long FrameNumber;
   vtkPlusDataSource* FieldDataSource;
 
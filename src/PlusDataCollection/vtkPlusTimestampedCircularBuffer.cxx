@@ -6,25 +6,74 @@ See License.txt for details.
 
 #include "PlusConfigure.h"
 #include "vtkPlusTimestampedCircularBuffer.h"
+#include "PlusLockFreeTimestampIndex.h"
 
 #include "vtkDoubleArray.h"
 #include "vtkIGSIORecursiveCriticalSection.h"
 #include "vtkTable.h"
 #include "vtkVariantArray.h"
 
+// STL includes
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
 vtkStandardNewMacro(vtkPlusTimestampedCircularBuffer);
 
+namespace
+{
+  //----------------------------------------------------------------------------
+  /*! Resize a container of buffer items, new items are inserted and oldest items are removed at the write pointer */
+  template<typename ContainerType>
+  void ResizeItemContainer(ContainerType& container, int newBufferSize, int& writePointer)
+  {
+    const int oldBufferSize = static_cast<int>(container.size());
+    if (oldBufferSize == 0)
+    {
+      container.resize(newBufferSize);
+      writePointer = 0;
+    }
+    // if the new buffer is bigger than the old buffer
+    else if (oldBufferSize < newBufferSize)
+    {
+      container.insert(container.begin() + writePointer, newBufferSize - oldBufferSize, typename ContainerType::value_type());
+    }
+    // if the new buffer is smaller than the old buffer
+    else if (oldBufferSize > newBufferSize)
+    {
+      // delete the oldest buffer objects
+      for (int i = 0; i < oldBufferSize - newBufferSize; ++i)
+      {
+        container.erase(container.begin() + writePointer);
+        if (writePointer >= static_cast<int>(container.size()))
+        {
+          writePointer = 0;
+        }
+      }
+    }
+  }
+}
+
 //----------------------------------------------------------------------------
 vtkPlusTimestampedCircularBuffer::vtkPlusTimestampedCircularBuffer()
   : Mutex(vtkIGSIORecursiveCriticalSection::New())
   , NumberOfItems(0)
   , WritePointer(0)
+  , ReservedBufferIndex(-1)
   , CurrentTimeStamp(0.0)
   , LocalTimeOffsetSec(0.0)
+  , LockFreeReadEnabled(false)
+  , LockFreeIndex(new PlusLockFreeTimestampIndex)
   , LatestItemUid(0)
+  , LastFoundItemUid(0)
+  , CompactPoseStorage(false)
   , AveragedItemsForFiltering(20)
   , MaxAllowedFilteringTimeDifference(0.5)
   , TimeStampReportTable(NULL)
+  , TimeStampReportMaximumNumberOfRows(0)
+  , TimeStampReportDecimationFactor(1)
+  , TimeStampReportItemsSinceLastRow(0)
+  , TimeStampReportLastUnfilteredTimestamp(UNDEFINED_TIMESTAMP)
   , TimeStampReporting(false)
   , TimeStampLogging(false)
   , StartTime(0)
@@ -35,12 +84,20 @@ vtkPlusTimestampedCircularBuffer::vtkPlusTimestampedCircularBuffer()
   this->FilterContainerTimestampVector.set_size(0);
   this->FilterContainersOldestIndex = 0;
   this->FilterContainersNumberOfValidElements = 0;
+  this->FilterItemsSinceSumsRecomputed = 0;
+  this->FilterReferenceIndex = 0;
+  this->FilterReferenceTimestamp = 0;
+  this->FilterSumX = 0;
+  this->FilterSumY = 0;
+  this->FilterSumXX = 0;
+  this->FilterSumXY = 0;
 }
 
 //----------------------------------------------------------------------------
 vtkPlusTimestampedCircularBuffer::~vtkPlusTimestampedCircularBuffer()
 {
   this->BufferItemContainer.clear();
+  this->CompactPoseItemContainer.clear();
 
   this->NumberOfItems = 0;
   if (this->Mutex != NULL)
@@ -54,7 +111,13 @@ vtkPlusTimestampedCircularBuffer::~vtkPlusTimestampedCircularBuffer()
     this->TimeStampReportTable->Delete();
     this->TimeStampReportTable = NULL;
   }
+  if (this->TimeStampReportFile.is_open())
+  {
+    this->TimeStampReportFile.close();
+  }
 
+  delete this->LockFreeIndex;
+  this->LockFreeIndex = NULL;
 }
 
 //----------------------------------------------------------------------------
@@ -67,6 +130,147 @@ void vtkPlusTimestampedCircularBuffer::PrintSelf(ostream& os, vtkIndent indent)
   os << indent << "CurrentTimeStamp: " << this->CurrentTimeStamp << "\n";
   os << indent << "Local time offset: " << this->LocalTimeOffsetSec << "\n";
   os << indent << "Latest Item Uid: " << this->LatestItemUid << "\n";
+  os << indent << "LockFreeReadEnabled: " << (this->LockFreeReadEnabled ? "true" : "false") << "\n";
+  os << indent << "CompactPoseStorage: " << (this->CompactPoseStorage ? "true" : "false") << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusTimestampedCircularBuffer::SetLockFreeReadEnabled(bool enabled)
+{
+  igsioLockGuard< vtkPlusTimestampedCircularBuffer > bufferGuardedLock(this);
+  if (this->LockFreeReadEnabled == enabled)
+  {
+    return;
+  }
+  if (enabled)
+  {
+    // Readers only switch to the index after it reflects the current content
+    this->RebuildLockFreeIndex();
+  }
+  this->LockFreeReadEnabled = enabled;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusTimestampedCircularBuffer::SetCompactPoseStorage(bool enabled)
+{
+  igsioLockGuard< vtkPlusTimestampedCircularBuffer > bufferGuardedLock(this);
+  if (this->CompactPoseStorage == enabled)
+  {
+    return PLUS_SUCCESS;
+  }
+  if (this->NumberOfItems > 0 || this->ReservedBufferIndex >= 0)
+  {
+    LOG_ERROR("Failed to change compact pose storage - the buffer is not empty");
+    return PLUS_FAIL;
+  }
+
+  const int bufferSize = this->GetBufferSize();
+  this->CompactPoseStorage = enabled;
+  if (enabled)
+  {
+    this->BufferItemContainer.clear();
+    ResizeItemContainer(this->CompactPoseItemContainer, bufferSize, this->WritePointer);
+  }
+  else
+  {
+    this->CompactPoseItemContainer.clear();
+    ResizeItemContainer(this->BufferItemContainer, bufferSize, this->WritePointer);
+  }
+  this->WritePointer = 0;
+  this->Modified();
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusTimestampedCircularBuffer::RebuildLockFreeIndex()
+{
+  // the caller must have locked the buffer
+  this->LockFreeIndex->Reset(this->GetBufferSize());
+  this->LockFreeIndex->SetLocalTimeOffsetSec(this->LocalTimeOffsetSec);
+  for (int i = 0; i < this->NumberOfItems; ++i)
+  {
+    BufferItemUidType uid = this->LatestItemUid - (this->NumberOfItems - 1) + i;
+    this->LockFreeIndex->PublishItem(uid, this->GetFilteredTimestampFromUidNoLock(uid) - this->LocalTimeOffsetSec, i + 1);
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusTimestampedCircularBuffer::SetLocalTimeOffsetSec(double offsetSec)
+{
+  igsioLockGuard< vtkPlusTimestampedCircularBuffer > bufferGuardedLock(this);
+  if (this->LocalTimeOffsetSec == offsetSec)
+  {
+    return;
+  }
+  this->LocalTimeOffsetSec = offsetSec;
+  this->LockFreeIndex->SetLocalTimeOffsetSec(offsetSec);
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+BufferItemUidType vtkPlusTimestampedCircularBuffer::GetLatestItemUidInBuffer()
+{
+  if (this->LockFreeReadEnabled)
+  {
+    BufferItemUidType oldestUid(0);
+    BufferItemUidType latestUid(0);
+    int numberOfItems(0);
+    this->LockFreeIndex->GetItemUidRange(oldestUid, latestUid, numberOfItems);
+    return latestUid;
+  }
+
+  this->Lock();
+  BufferItemUidType latestUid = this->LatestItemUid;
+  this->Unlock();
+  return latestUid;
+}
+
+//----------------------------------------------------------------------------
+BufferItemUidType vtkPlusTimestampedCircularBuffer::GetOldestItemUidInBuffer()
+{
+  if (this->LockFreeReadEnabled)
+  {
+    BufferItemUidType oldestUid(0);
+    BufferItemUidType latestUid(0);
+    int numberOfItems(0);
+    this->LockFreeIndex->GetItemUidRange(oldestUid, latestUid, numberOfItems);
+    return oldestUid;
+  }
+
+  this->Lock();
+  // LatestItemUid - ( NumberOfItems - 1 ) is the oldest element in the buffer
+  BufferItemUidType oldestUid = this->LatestItemUid - (this->NumberOfItems - 1);
+  this->Unlock();
+  return oldestUid;
+}
+
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusTimestampedCircularBuffer::GetLatestTimeStamp(double& timestamp)
+{
+  if (this->LockFreeReadEnabled)
+  {
+    return this->LockFreeIndex->GetLatestTimeStamp(timestamp);
+  }
+  return this->GetTimeStamp(this->GetLatestItemUidInBuffer(), timestamp);
+}
+
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusTimestampedCircularBuffer::GetOldestTimeStamp(double& timestamp)
+{
+  if (this->LockFreeReadEnabled)
+  {
+    return this->LockFreeIndex->GetOldestTimeStamp(timestamp);
+  }
+
+  // The oldest item may be removed from the buffer at any moment
+  // therefore we need to retrieve its UID and timestamp within a single lock
+  this->Lock();
+  // LatestItemUid - ( NumberOfItems - 1 ) is the oldest element in the buffer
+  BufferItemUidType oldestUid = (this->LatestItemUid - (this->NumberOfItems - 1));
+  ItemStatus status = this->GetTimeStamp(oldestUid, timestamp);
+  this->Unlock();
+  return status;
 }
 
 //----------------------------------------------------------------------------
@@ -74,12 +278,26 @@ PlusStatus vtkPlusTimestampedCircularBuffer::PrepareForNewItem(const double time
 {
   igsioLockGuard< vtkPlusTimestampedCircularBuffer > bufferGuardedLock(this);
 
+  if (this->ReservedBufferIndex >= 0)
+  {
+    // The item at the write pointer is being filled in place, it must not be overwritten by another item
+    LOG_ERROR("Failed to add buffer item - an item (buffer index: " << this->ReservedBufferIndex << ") is reserved for writing. Commit or release it first.");
+    return PLUS_FAIL;
+  }
+
   if (timestamp <= this->CurrentTimeStamp)
   {
     LOG_DEBUG("Need to skip newly added frame - new timestamp (" << std::fixed << timestamp << ") is not newer than the last one (" << this->CurrentTimeStamp << ")!");
     return PLUS_FAIL;
   }
 
+  if (this->NumberOfItems > 0 && this->NumberOfItems >= this->GetBufferSize())
+  {
+    // The oldest item is going to be overwritten
+    BufferItemUidType oldestUid = this->LatestItemUid - (this->NumberOfItems - 1);
+    this->PreserveItemsForSnapshotsNoLock(oldestUid, oldestUid);
+  }
+
   // Increase frame unique ID
   newFrameUid = ++this->LatestItemUid;
   bufferIndex = this->WritePointer;
@@ -96,9 +314,92 @@ PlusStatus vtkPlusTimestampedCircularBuffer::PrepareForNewItem(const double time
     this->WritePointer = 0;
   }
 
+  if (this->LockFreeReadEnabled)
+  {
+    // Content of the item is filled by the caller while it still holds the buffer lock,
+    // which readers of the content have to acquire anyway
+    this->LockFreeIndex->PublishItem(newFrameUid, timestamp, this->NumberOfItems);
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusTimestampedCircularBuffer::ReserveNextItem(int& bufferIndex)
+{
+  igsioLockGuard< vtkPlusTimestampedCircularBuffer > bufferGuardedLock(this);
+
+  bufferIndex = -1;
+  if (this->GetBufferSize() < 1)
+  {
+    LOG_ERROR("Failed to reserve buffer item - buffer size is 0");
+    return PLUS_FAIL;
+  }
+  if (this->ReservedBufferIndex >= 0)
+  {
+    LOG_ERROR("Failed to reserve buffer item - another item (buffer index: " << this->ReservedBufferIndex << ") is already reserved");
+    return PLUS_FAIL;
+  }
+
+  // The item at the write pointer is the oldest item if the buffer is full.
+  // Remove it from the valid items now, so that readers do not access it while it is being overwritten.
+  if (this->NumberOfItems >= this->GetBufferSize())
+  {
+    BufferItemUidType oldestUid = this->LatestItemUid - (this->NumberOfItems - 1);
+    this->PreserveItemsForSnapshotsNoLock(oldestUid, oldestUid);
+    this->NumberOfItems = this->GetBufferSize() - 1;
+    if (this->LockFreeReadEnabled)
+    {
+      this->LockFreeIndex->SetNumberOfItems(this->NumberOfItems);
+    }
+  }
+
+  this->ReservedBufferIndex = this->WritePointer;
+  bufferIndex = this->ReservedBufferIndex;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusTimestampedCircularBuffer::CommitReservedItem(const double timestamp, BufferItemUidType& newFrameUid, int& bufferIndex)
+{
+  igsioLockGuard< vtkPlusTimestampedCircularBuffer > bufferGuardedLock(this);
+
+  if (this->ReservedBufferIndex < 0)
+  {
+    LOG_ERROR("Failed to commit buffer item - no item is reserved");
+    return PLUS_FAIL;
+  }
+  int reservedBufferIndex = this->ReservedBufferIndex;
+  this->ReservedBufferIndex = -1;
+
+  if (this->PrepareForNewItem(timestamp, newFrameUid, bufferIndex) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  if (bufferIndex != reservedBufferIndex)
+  {
+    LOG_ERROR("Failed to commit buffer item - reserved buffer index (" << reservedBufferIndex << ") does not match the write pointer (" << bufferIndex << ")");
+    return PLUS_FAIL;
+  }
+
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+void vtkPlusTimestampedCircularBuffer::ReleaseReservedItem()
+{
+  igsioLockGuard< vtkPlusTimestampedCircularBuffer > bufferGuardedLock(this);
+  // The oldest item that was dropped at reservation time is not restored, as its content may have been partially overwritten
+  this->ReservedBufferIndex = -1;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusTimestampedCircularBuffer::HasReservedItem()
+{
+  igsioLockGuard< vtkPlusTimestampedCircularBuffer > bufferGuardedLock(this);
+  return this->ReservedBufferIndex >= 0;
+}
+
 //----------------------------------------------------------------------------
 // Sets the buffer size, and copies the maximum number of the most current old
 // frames and timestamps
@@ -117,42 +418,27 @@ PlusStatus vtkPlusTimestampedCircularBuffer::SetBufferSize(int newBufferSize)
     return PLUS_SUCCESS;
   }
 
+  if (this->ReservedBufferIndex >= 0)
+  {
+    LOG_WARNING("Buffer size is changed while an item is reserved for writing. The reservation is released.");
+    this->ReservedBufferIndex = -1;
+  }
+
+  // Items may be dropped or moved by the resize
+  this->PreserveAllItemsForSnapshotsNoLock();
+
   if (this->GetBufferSize() == 0)
   {
-    for (int i = 0; i < newBufferSize; i++)
-    {
-      StreamBufferItem emptyBufferItem;
-      this->BufferItemContainer.push_back(emptyBufferItem);
-    }
-    this->WritePointer = 0;
     this->NumberOfItems = 0;
     this->CurrentTimeStamp = 0.0;
   }
-  // if the new buffer is bigger than the old buffer
-  else if (this->GetBufferSize() < newBufferSize)
+  if (this->CompactPoseStorage)
   {
-    std::deque<StreamBufferItem>::iterator it = this->BufferItemContainer.begin() + this->WritePointer;
-    const int numberOfNewBufferObjects = newBufferSize - this->GetBufferSize();
-    for (int i = 0; i < numberOfNewBufferObjects; ++i)
-    {
-      StreamBufferItem emptyBufferItem;
-      it = this->BufferItemContainer.insert(it, emptyBufferItem);
-    }
+    ResizeItemContainer(this->CompactPoseItemContainer, newBufferSize, this->WritePointer);
   }
-  // if the new buffer is smaller than the old buffer
-  else if (this->GetBufferSize() > newBufferSize)
+  else
   {
-    // delete the oldest buffer objects
-    int oldBufferSize = this->GetBufferSize();
-    for (int i = 0; i < oldBufferSize - newBufferSize; ++i)
-    {
-      std::deque<StreamBufferItem>::iterator it = this->BufferItemContainer.begin() + this->WritePointer;
-      this->BufferItemContainer.erase(it);
-      if (this->WritePointer >= this->GetBufferSize())
-      {
-        this->WritePointer = 0;
-      }
-    }
+    ResizeItemContainer(this->BufferItemContainer, newBufferSize, this->WritePointer);
   }
 
   // update the number of items
@@ -161,6 +447,11 @@ PlusStatus vtkPlusTimestampedCircularBuffer::SetBufferSize(int newBufferSize)
     this->NumberOfItems = this->GetBufferSize();
   }
 
+  if (this->LockFreeReadEnabled)
+  {
+    this->RebuildLockFreeIndex();
+  }
+
   this->Modified();
 
   return PLUS_SUCCESS;
@@ -170,6 +461,12 @@ PlusStatus vtkPlusTimestampedCircularBuffer::SetBufferSize(int newBufferSize)
 ItemStatus vtkPlusTimestampedCircularBuffer::GetBufferItemPointerFromUid(const BufferItemUidType uid, StreamBufferItem*& itemPtr)
 {
   // the caller must have locked the buffer
+  if (this->CompactPoseStorage)
+  {
+    LOG_ERROR("Failed to get buffer item - the buffer uses compact pose storage (Uid: " << uid << ")");
+    itemPtr = NULL;
+    return ITEM_UNKNOWN_ERROR;
+  }
   BufferItemUidType oldestUid = this->LatestItemUid - (this->NumberOfItems - 1);
   if (uid < oldestUid)
   {
@@ -183,13 +480,44 @@ ItemStatus vtkPlusTimestampedCircularBuffer::GetBufferItemPointerFromUid(const B
     itemPtr = NULL;
     return ITEM_NOT_AVAILABLE_YET;
   }
+  itemPtr = &this->BufferItemContainer[this->GetBufferIndexFromUidNoLock(uid)];
+  return ITEM_OK;
+}
+
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusTimestampedCircularBuffer::GetCompactPoseItemPointerFromUid(const BufferItemUidType uid, CompactPoseItem*& itemPtr)
+{
+  // the caller must have locked the buffer
+  itemPtr = NULL;
+  if (!this->CompactPoseStorage)
+  {
+    LOG_ERROR("Failed to get compact pose item - compact pose storage is not enabled (Uid: " << uid << ")");
+    return ITEM_UNKNOWN_ERROR;
+  }
+  if (uid < this->LatestItemUid - (this->NumberOfItems - 1))
+  {
+    LOG_WARNING("Buffer item is not in the buffer (Uid: " << uid << ")!");
+    return ITEM_NOT_AVAILABLE_ANYMORE;
+  }
+  else if (uid > this->LatestItemUid)
+  {
+    LOG_WARNING("Buffer item is not in the buffer (Uid: " << uid << ")!");
+    return ITEM_NOT_AVAILABLE_YET;
+  }
+  itemPtr = &this->CompactPoseItemContainer[this->GetBufferIndexFromUidNoLock(uid)];
+  return ITEM_OK;
+}
+
+//----------------------------------------------------------------------------
+int vtkPlusTimestampedCircularBuffer::GetBufferIndexFromUidNoLock(const BufferItemUidType uid)
+{
+  // the caller must have locked the buffer and checked that the uid is in the buffer
   int bufferIndex = (this->WritePointer - 1) - (this->LatestItemUid - uid);
   if (bufferIndex < 0)
   {
-    bufferIndex += this->BufferItemContainer.size();
+    bufferIndex += this->GetBufferSize();
   }
-  itemPtr = &this->BufferItemContainer[bufferIndex];
-  return ITEM_OK;
+  return bufferIndex;
 }
 
 //----------------------------------------------------------------------------
@@ -203,13 +531,47 @@ StreamBufferItem* vtkPlusTimestampedCircularBuffer::GetBufferItemPointerFromBuff
     LOG_ERROR("Failed to get buffer item with buffer index - index is out of range (bufferIndex: " << bufferIndex << ").");
     return NULL;
   }
+  if (this->CompactPoseStorage)
+  {
+    LOG_ERROR("Failed to get buffer item with buffer index - the buffer uses compact pose storage (bufferIndex: " << bufferIndex << ").");
+    return NULL;
+  }
   return &this->BufferItemContainer[bufferIndex];
 }
 
+//----------------------------------------------------------------------------
+CompactPoseItem* vtkPlusTimestampedCircularBuffer::GetCompactPoseItemPointerFromBufferIndex(const int bufferIndex)
+{
+  // the caller must have locked the buffer
+  if (!this->CompactPoseStorage)
+  {
+    LOG_ERROR("Failed to get compact pose item with buffer index - compact pose storage is not enabled (bufferIndex: " << bufferIndex << ").");
+    return NULL;
+  }
+  if (bufferIndex >= this->GetBufferSize() || bufferIndex < 0)
+  {
+    LOG_ERROR("Failed to get compact pose item with buffer index - index is out of range (bufferIndex: " << bufferIndex << ").");
+    return NULL;
+  }
+  return &this->CompactPoseItemContainer[bufferIndex];
+}
+
 //----------------------------------------------------------------------------
 ItemStatus vtkPlusTimestampedCircularBuffer::GetFilteredTimeStamp(const BufferItemUidType uid, double& filteredTimestamp)
 {
+  if (this->LockFreeReadEnabled)
+  {
+    return this->LockFreeIndex->GetTimeStamp(uid, filteredTimestamp);
+  }
+
   igsioLockGuard< vtkPlusTimestampedCircularBuffer > bufferGuardedLock(this);
+  if (this->CompactPoseStorage)
+  {
+    CompactPoseItem* compactItemPtr = NULL;
+    ItemStatus status = this->GetCompactPoseItemPointerFromUid(uid, compactItemPtr);
+    filteredTimestamp = (status == ITEM_OK) ? compactItemPtr->FilteredTimestamp + this->LocalTimeOffsetSec : 0;
+    return status;
+  }
   StreamBufferItem* itemPtr = NULL;
   ItemStatus status = GetBufferItemPointerFromUid(uid, itemPtr);
   if (status != ITEM_OK)
@@ -225,6 +587,13 @@ ItemStatus vtkPlusTimestampedCircularBuffer::GetFilteredTimeStamp(const BufferIt
 ItemStatus vtkPlusTimestampedCircularBuffer::GetUnfilteredTimeStamp(const BufferItemUidType uid, double& unfilteredTimestamp)
 {
   igsioLockGuard< vtkPlusTimestampedCircularBuffer > bufferGuardedLock(this);
+  if (this->CompactPoseStorage)
+  {
+    CompactPoseItem* compactItemPtr = NULL;
+    ItemStatus status = this->GetCompactPoseItemPointerFromUid(uid, compactItemPtr);
+    unfilteredTimestamp = (status == ITEM_OK) ? compactItemPtr->UnfilteredTimestamp + this->LocalTimeOffsetSec : 0;
+    return status;
+  }
   StreamBufferItem* itemPtr = NULL;
   ItemStatus status = GetBufferItemPointerFromUid(uid, itemPtr);
   if (status != ITEM_OK)
@@ -237,10 +606,160 @@ ItemStatus vtkPlusTimestampedCircularBuffer::GetUnfilteredTimeStamp(const Buffer
 }
 
 //----------------------------------------------------------------------------
-bool vtkPlusTimestampedCircularBuffer::GetLatestItemHasValidVideoData()
+void vtkPlusTimestampedCircularBuffer::GetItemTimeStamps(BufferItemUidType firstUid, BufferItemUidType lastUid, std::vector<BufferItemUidType>& uids, std::vector<double>& filteredTimestamps)
 {
+  uids.clear();
+  filteredTimestamps.clear();
+
   igsioLockGuard< vtkPlusTimestampedCircularBuffer > bufferGuardedLock(this);
   if (this->NumberOfItems < 1)
+  {
+    return;
+  }
+  // LatestItemUid - ( NumberOfItems - 1 ) is the oldest element in the buffer
+  firstUid = std::max(firstUid, this->LatestItemUid - (this->NumberOfItems - 1));
+  lastUid = std::min(lastUid, this->LatestItemUid);
+  if (firstUid > lastUid)
+  {
+    return;
+  }
+
+  uids.reserve(lastUid - firstUid + 1);
+  filteredTimestamps.reserve(lastUid - firstUid + 1);
+  for (BufferItemUidType uid = firstUid; uid <= lastUid; ++uid)
+  {
+    uids.push_back(uid);
+    filteredTimestamps.push_back(this->GetFilteredTimestampFromUidNoLock(uid));
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusTimestampedCircularBuffer::RegisterSnapshot(BufferSnapshotItems* snapshotItems)
+{
+  if (snapshotItems == NULL)
+  {
+    LOG_ERROR("Failed to register buffer snapshot - snapshot is NULL");
+    return;
+  }
+
+  igsioLockGuard< vtkPlusTimestampedCircularBuffer > bufferGuardedLock(this);
+  snapshotItems->PreservedItems.clear();
+  snapshotItems->PreservedCompactPoseItems.clear();
+  snapshotItems->FilteredTimestamps.clear();
+  // LatestItemUid - ( NumberOfItems - 1 ) is the oldest element in the buffer
+  snapshotItems->FirstUid = this->LatestItemUid + 1 - this->NumberOfItems;
+  snapshotItems->LastUid = this->LatestItemUid;
+  snapshotItems->FilteredTimestamps.reserve(this->NumberOfItems);
+  for (BufferItemUidType uid = snapshotItems->FirstUid; uid <= snapshotItems->LastUid; ++uid)
+  {
+    snapshotItems->FilteredTimestamps.push_back(this->GetFilteredTimestampFromUidNoLock(uid));
+  }
+
+  if (std::find(this->Snapshots.begin(), this->Snapshots.end(), snapshotItems) == this->Snapshots.end())
+  {
+    this->Snapshots.push_back(snapshotItems);
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusTimestampedCircularBuffer::UnregisterSnapshot(BufferSnapshotItems* snapshotItems)
+{
+  igsioLockGuard< vtkPlusTimestampedCircularBuffer > bufferGuardedLock(this);
+  this->Snapshots.erase(std::remove(this->Snapshots.begin(), this->Snapshots.end(), snapshotItems), this->Snapshots.end());
+}
+
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusTimestampedCircularBuffer::GetSnapshotItemPointerFromUid(BufferSnapshotItems* snapshotItems, const BufferItemUidType uid, StreamBufferItem*& itemPtr)
+{
+  // the caller must have locked the buffer
+  itemPtr = NULL;
+  if (uid < snapshotItems->FirstUid)
+  {
+    return ITEM_NOT_AVAILABLE_ANYMORE;
+  }
+  if (uid > snapshotItems->LastUid)
+  {
+    return ITEM_NOT_AVAILABLE_YET;
+  }
+  std::map<BufferItemUidType, StreamBufferItem>::iterator preservedItem = snapshotItems->PreservedItems.find(uid);
+  if (preservedItem != snapshotItems->PreservedItems.end())
+  {
+    itemPtr = &preservedItem->second;
+    return ITEM_OK;
+  }
+  // Items of the snapshot that have not been preserved are still in the buffer
+  return this->GetBufferItemPointerFromUid(uid, itemPtr);
+}
+
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusTimestampedCircularBuffer::GetSnapshotCompactPoseItemPointerFromUid(BufferSnapshotItems* snapshotItems, const BufferItemUidType uid, CompactPoseItem*& itemPtr)
+{
+  // the caller must have locked the buffer
+  itemPtr = NULL;
+  if (uid < snapshotItems->FirstUid)
+  {
+    return ITEM_NOT_AVAILABLE_ANYMORE;
+  }
+  if (uid > snapshotItems->LastUid)
+  {
+    return ITEM_NOT_AVAILABLE_YET;
+  }
+  std::map<BufferItemUidType, CompactPoseItem>::iterator preservedItem = snapshotItems->PreservedCompactPoseItems.find(uid);
+  if (preservedItem != snapshotItems->PreservedCompactPoseItems.end())
+  {
+    itemPtr = &preservedItem->second;
+    return ITEM_OK;
+  }
+  return this->GetCompactPoseItemPointerFromUid(uid, itemPtr);
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusTimestampedCircularBuffer::PreserveItemsForSnapshotsNoLock(BufferItemUidType firstUid, BufferItemUidType lastUid)
+{
+  for (std::vector<BufferSnapshotItems*>::iterator snapshot = this->Snapshots.begin(); snapshot != this->Snapshots.end(); ++snapshot)
+  {
+    const BufferItemUidType fromUid = std::max(firstUid, (*snapshot)->FirstUid);
+    const BufferItemUidType toUid = std::min(lastUid, (*snapshot)->LastUid);
+    if (fromUid > toUid)
+    {
+      continue;
+    }
+    for (BufferItemUidType uid = fromUid; uid <= toUid; ++uid)
+    {
+      const int bufferIndex = this->GetBufferIndexFromUidNoLock(uid);
+      if (this->CompactPoseStorage)
+      {
+        (*snapshot)->PreservedCompactPoseItems.insert(std::make_pair(uid, this->CompactPoseItemContainer[bufferIndex]));
+      }
+      else if ((*snapshot)->PreservedItems.find(uid) == (*snapshot)->PreservedItems.end())
+      {
+        // The preserved item refers to the pixel data of the buffer item instead of copying it. The writer of the
+        // buffer item swaps new pixel data into the item before overwriting it (see vtkPlusBuffer::DetachSharedFrameData).
+        StreamBufferItem& preservedItem = (*snapshot)->PreservedItems[uid];
+        if (preservedItem.ShallowCopy(&this->BufferItemContainer[bufferIndex]) != PLUS_SUCCESS)
+        {
+          preservedItem = this->BufferItemContainer[bufferIndex];
+        }
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusTimestampedCircularBuffer::PreserveAllItemsForSnapshotsNoLock()
+{
+  if (this->Snapshots.empty() || this->NumberOfItems < 1)
+  {
+    return;
+  }
+  this->PreserveItemsForSnapshotsNoLock(this->LatestItemUid + 1 - this->NumberOfItems, this->LatestItemUid);
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusTimestampedCircularBuffer::GetLatestItemHasValidVideoData()
+{
+  igsioLockGuard< vtkPlusTimestampedCircularBuffer > bufferGuardedLock(this);
+  if (this->NumberOfItems < 1 || this->CompactPoseStorage)
   {
     return false;
   }
@@ -256,7 +775,11 @@ bool vtkPlusTimestampedCircularBuffer::GetLatestItemHasValidTransformData()
   {
     return false;
   }
-  int latestItemBufferIndex = (this->WritePointer > 0) ? (this->WritePointer - 1) : (this->BufferItemContainer.size() - 1);
+  int latestItemBufferIndex = (this->WritePointer > 0) ? (this->WritePointer - 1) : (this->GetBufferSize() - 1);
+  if (this->CompactPoseStorage)
+  {
+    return this->CompactPoseItemContainer[latestItemBufferIndex].ValidTransformData;
+  }
   return this->BufferItemContainer[latestItemBufferIndex].HasValidTransformData();
 }
 
@@ -264,7 +787,7 @@ bool vtkPlusTimestampedCircularBuffer::GetLatestItemHasValidTransformData()
 bool vtkPlusTimestampedCircularBuffer::GetLatestItemHasValidFieldData()
 {
   igsioLockGuard< vtkPlusTimestampedCircularBuffer > bufferGuardedLock(this);
-  if (this->NumberOfItems < 1)
+  if (this->NumberOfItems < 1 || this->CompactPoseStorage)
   {
     return false;
   }
@@ -276,6 +799,13 @@ bool vtkPlusTimestampedCircularBuffer::GetLatestItemHasValidFieldData()
 ItemStatus vtkPlusTimestampedCircularBuffer::GetIndex(const BufferItemUidType uid, unsigned long& index)
 {
   igsioLockGuard< vtkPlusTimestampedCircularBuffer > bufferGuardedLock(this);
+  if (this->CompactPoseStorage)
+  {
+    CompactPoseItem* compactItemPtr = NULL;
+    ItemStatus status = this->GetCompactPoseItemPointerFromUid(uid, compactItemPtr);
+    index = (status == ITEM_OK) ? compactItemPtr->Index : 0;
+    return status;
+  }
   StreamBufferItem* itemPtr = NULL;
   ItemStatus status = GetBufferItemPointerFromUid(uid, itemPtr);
   if (status != ITEM_OK)
@@ -301,11 +831,7 @@ ItemStatus vtkPlusTimestampedCircularBuffer::GetBufferIndexFromTime(const double
     return itemStatus;
   }
 
-  bufferIndex = (this->WritePointer - 1) - (this->LatestItemUid - itemUid);
-  if (bufferIndex < 0)
-  {
-    bufferIndex += this->BufferItemContainer.size();
-  }
+  bufferIndex = this->GetBufferIndexFromUidNoLock(itemUid);
   return ITEM_OK;
 }
 
@@ -314,8 +840,18 @@ ItemStatus vtkPlusTimestampedCircularBuffer::GetBufferIndexFromTime(const double
 // that best matches the given timestamp
 ItemStatus vtkPlusTimestampedCircularBuffer::GetItemUidFromTime(const double time, BufferItemUidType& uid)
 {
+  if (this->LockFreeReadEnabled)
+  {
+    return this->LockFreeIndex->GetItemUidFromTime(time, this->NegligibleTimeDifferenceSec, uid);
+  }
+
   igsioLockGuard< vtkPlusTimestampedCircularBuffer > bufferGuardedLock(this);
 
+  if (this->NumberOfItems < 1)
+  {
+    // All items have been removed, as for the UID queries (the oldest UID is LatestItemUid + 1)
+    return ITEM_NOT_AVAILABLE_ANYMORE;
+  }
   if (this->NumberOfItems == 1)
   {
     // There is only one item, it's the closest one to any timestamp
@@ -326,22 +862,9 @@ ItemStatus vtkPlusTimestampedCircularBuffer::GetItemUidFromTime(const double tim
   BufferItemUidType lo = this->LatestItemUid - (this->NumberOfItems - 1);   // oldest item UID
   BufferItemUidType hi = this->LatestItemUid; // latest item UID
 
-  // minimum time
-  // This method is called often, therefore instead of calling this->GetTimeStamp(lo, tlo) we perform low-level operations to get the timestamp
-  int loBufferIndex = (this->WritePointer - 1) - (this->LatestItemUid - lo);
-  if (loBufferIndex < 0)
-  {
-    loBufferIndex += this->BufferItemContainer.size();
-  }
-  double tlo = this->BufferItemContainer[loBufferIndex].GetFilteredTimestamp(this->LocalTimeOffsetSec);
-
-  // This method is called often, therefore instead of calling this->GetTimeStamp(hi, thi) we perform low-level operations to get the timestamp
-  int hiBufferIndex = (this->WritePointer - 1) - (this->LatestItemUid - hi);
-  if (hiBufferIndex < 0)
-  {
-    hiBufferIndex += this->BufferItemContainer.size();
-  }
-  double thi = this->BufferItemContainer[hiBufferIndex].GetFilteredTimestamp(this->LocalTimeOffsetSec);
+  // This method is called often, therefore instead of calling this->GetTimeStamp() we perform low-level operations to get the timestamp
+  double tlo = this->GetFilteredTimestampFromUidNoLock(lo);
+  double thi = this->GetFilteredTimestampFromUidNoLock(hi);
 
   // If the timestamp is slightly out of range then still accept it
   // (due to errors in conversions there could be slight differences)
@@ -354,31 +877,45 @@ ItemStatus vtkPlusTimestampedCircularBuffer::GetItemUidFromTime(const double tim
     return ITEM_NOT_AVAILABLE_YET;
   }
 
-  for (;;)
+  // Consecutive queries are usually close to each other (e.g., each tool buffer is queried at the timestamp
+  // of subsequent video frames), therefore first try to narrow down the search range around the last hit
+  const BufferItemUidType cursorWindowSize = 2;
+  BufferItemUidType cursor = this->LastFoundItemUid;
+  if (cursor > lo && cursor < hi)
   {
-    if (hi - lo <= 1)
+    double tcursor = this->GetFilteredTimestampFromUidNoLock(cursor);
+    if (time < tcursor)
     {
-      if (time - tlo > thi - time)
+      hi = cursor;
+      thi = tcursor;
+      BufferItemUidType windowStart = (cursor - lo > cursorWindowSize) ? cursor - cursorWindowSize : lo;
+      double twindowStart = this->GetFilteredTimestampFromUidNoLock(windowStart);
+      if (time >= twindowStart)
       {
-        uid = hi;
-        return ITEM_OK;
+        lo = windowStart;
+        tlo = twindowStart;
       }
-      else
+    }
+    else
+    {
+      lo = cursor;
+      tlo = tcursor;
+      BufferItemUidType windowEnd = (hi - cursor > cursorWindowSize) ? cursor + cursorWindowSize : hi;
+      double twindowEnd = this->GetFilteredTimestampFromUidNoLock(windowEnd);
+      if (time < twindowEnd)
       {
-        uid = lo;
-        return ITEM_OK;
+        hi = windowEnd;
+        thi = twindowEnd;
       }
     }
+  }
 
-    int mid = (lo + hi) / 2;
+  while (hi - lo > 1)
+  {
+    BufferItemUidType mid = lo + (hi - lo) / 2;
 
     // This is a hot loop, therefore instead of calling this->GetTimeStamp(mid, tmid) we perform low-level operations to get the timestamp
-    int midBufferIndex = (this->WritePointer - 1) - (this->LatestItemUid - mid);
-    if (midBufferIndex < 0)
-    {
-      midBufferIndex += this->BufferItemContainer.size();
-    }
-    double tmid = this->BufferItemContainer[midBufferIndex].GetFilteredTimestamp(this->LocalTimeOffsetSec);
+    double tmid = this->GetFilteredTimestampFromUidNoLock(mid);
 
     if (time < tmid)
     {
@@ -392,6 +929,21 @@ ItemStatus vtkPlusTimestampedCircularBuffer::GetItemUidFromTime(const double tim
     }
   }
 
+  uid = (time - tlo > thi - time) ? hi : lo;
+  this->LastFoundItemUid = uid;
+  return ITEM_OK;
+}
+
+//----------------------------------------------------------------------------
+double vtkPlusTimestampedCircularBuffer::GetFilteredTimestampFromUidNoLock(const BufferItemUidType uid)
+{
+  // the caller must have locked the buffer and checked that the uid is in the buffer
+  const int bufferIndex = this->GetBufferIndexFromUidNoLock(uid);
+  if (this->CompactPoseStorage)
+  {
+    return this->CompactPoseItemContainer[bufferIndex].FilteredTimestamp + this->LocalTimeOffsetSec;
+  }
+  return this->BufferItemContainer[bufferIndex].GetFilteredTimestamp(this->LocalTimeOffsetSec);
 }
 
 //----------------------------------------------------------------------------
@@ -399,6 +951,7 @@ void vtkPlusTimestampedCircularBuffer::DeepCopy(vtkPlusTimestampedCircularBuffer
 {
   buffer->Lock();
   this->Lock();
+  this->PreserveAllItemsForSnapshotsNoLock();
   this->WritePointer = buffer->WritePointer;
   this->NumberOfItems = buffer->NumberOfItems;
   this->CurrentTimeStamp = buffer->CurrentTimeStamp;
@@ -410,8 +963,21 @@ void vtkPlusTimestampedCircularBuffer::DeepCopy(vtkPlusTimestampedCircularBuffer
   this->FilterContainersOldestIndex = buffer->FilterContainersOldestIndex;
   this->FilterContainerTimestampVector = buffer->FilterContainerTimestampVector;
   this->FilterContainerIndexVector = buffer->FilterContainerIndexVector;
+  this->FilterItemsSinceSumsRecomputed = buffer->FilterItemsSinceSumsRecomputed;
+  this->FilterReferenceIndex = buffer->FilterReferenceIndex;
+  this->FilterReferenceTimestamp = buffer->FilterReferenceTimestamp;
+  this->FilterSumX = buffer->FilterSumX;
+  this->FilterSumY = buffer->FilterSumY;
+  this->FilterSumXX = buffer->FilterSumXX;
+  this->FilterSumXY = buffer->FilterSumXY;
 
   this->BufferItemContainer = buffer->BufferItemContainer;
+  this->CompactPoseStorage = buffer->CompactPoseStorage;
+  this->CompactPoseItemContainer = buffer->CompactPoseItemContainer;
+  if (this->LockFreeReadEnabled)
+  {
+    this->RebuildLockFreeIndex();
+  }
   this->Unlock();
   buffer->Unlock();
 }
@@ -420,10 +986,16 @@ void vtkPlusTimestampedCircularBuffer::DeepCopy(vtkPlusTimestampedCircularBuffer
 void vtkPlusTimestampedCircularBuffer::Clear()
 {
   this->Lock();
+  this->PreserveAllItemsForSnapshotsNoLock();
   this->WritePointer = 0;
+  this->ReservedBufferIndex = -1;
   this->NumberOfItems = 0;
   this->CurrentTimeStamp = 0;
   this->LatestItemUid = 0;
+  if (this->LockFreeReadEnabled)
+  {
+    this->RebuildLockFreeIndex();
+  }
   this->Unlock();
 }
 
@@ -542,8 +1114,37 @@ PlusStatus vtkPlusTimestampedCircularBuffer::CreateFilteredTimeStampForItem(unsi
   }
 
   // We store the last AveragedItemsForFiltering unfiltered timestamp and item indexes, because these are used for computing the filtered timestamp.
+  // The sums that are needed for the line fitting are updated incrementally, so that the cost does not depend on the number of averaged items.
   if (this->AveragedItemsForFiltering > 1)
   {
+    if (this->FilterContainersNumberOfValidElements == 0)
+    {
+      // Sums are computed relative to a reference item to avoid losing precision with large item indexes and timestamps
+      this->FilterReferenceIndex = itemIndex;
+      this->FilterReferenceTimestamp = inUnfilteredTimestamp;
+      this->FilterSumX = 0;
+      this->FilterSumY = 0;
+      this->FilterSumXX = 0;
+      this->FilterSumXY = 0;
+      this->FilterItemsSinceSumsRecomputed = 0;
+    }
+    else if (this->FilterContainersNumberOfValidElements >= this->AveragedItemsForFiltering)
+    {
+      // Remove the oldest item, which is overwritten now
+      double oldestX = this->FilterContainerIndexVector(this->FilterContainersOldestIndex) - this->FilterReferenceIndex;
+      double oldestY = this->FilterContainerTimestampVector(this->FilterContainersOldestIndex) - this->FilterReferenceTimestamp;
+      this->FilterSumX -= oldestX;
+      this->FilterSumY -= oldestY;
+      this->FilterSumXX -= oldestX * oldestX;
+      this->FilterSumXY -= oldestX * oldestY;
+    }
+    double newX = static_cast<double>(itemIndex) - this->FilterReferenceIndex;
+    double newY = inUnfilteredTimestamp - this->FilterReferenceTimestamp;
+    this->FilterSumX += newX;
+    this->FilterSumY += newY;
+    this->FilterSumXX += newX * newX;
+    this->FilterSumXY += newX * newY;
+
     this->FilterContainerIndexVector(this->FilterContainersOldestIndex) = itemIndex;
     this->FilterContainerTimestampVector[this->FilterContainersOldestIndex] = inUnfilteredTimestamp;
     this->FilterContainersNumberOfValidElements++;
@@ -558,6 +1159,13 @@ PlusStatus vtkPlusTimestampedCircularBuffer::CreateFilteredTimeStampForItem(unsi
     {
       this->FilterContainersOldestIndex = 0;
     }
+
+    // Recompute the sums once in every AveragedItemsForFiltering items (amortized constant cost),
+    // to move the reference item along with the item indexes and to discard accumulated rounding errors
+    if (++this->FilterItemsSinceSumsRecomputed >= this->AveragedItemsForFiltering)
+    {
+      this->RecomputeFilterSums();
+    }
   }
 
   // If we don't have enough unfiltered timestamps or we don't want to use afiltering then just use the unfiltered timestamps
@@ -588,23 +1196,21 @@ PlusStatus vtkPlusTimestampedCircularBuffer::CreateFilteredTimeStampForItem(unsi
   // Ordinary least squares estimation:
   //   y(i) = a * x(i) + b;
   //   a = sum( (x(i)-xMean) * (y(i)-yMean) ) / sum( (x(i)-xMean) * (x(i)-xMean) )
+  //     = ( sum(x(i)*y(i)) - sum(x(i))*yMean ) / ( sum(x(i)*x(i)) - sum(x(i))*xMean )
   //   b = yMean - a*xMean
   //
+  // x and y are relative to the reference item (FilterReferenceIndex, FilterReferenceTimestamp).
+  //
 
-  double xMean = this->FilterContainerIndexVector.mean();
-  double yMean = this->FilterContainerTimestampVector.mean();
-  double covarianceXY = 0;
-  double varianceX = 0;
-  for (int i = this->FilterContainerTimestampVector.size() - 1; i >= 0; i--)
-  {
-    double xiMinusXmean = (this->FilterContainerIndexVector(i) - xMean);
-    covarianceXY += xiMinusXmean * (this->FilterContainerTimestampVector(i) - yMean);
-    varianceX += xiMinusXmean * xiMinusXmean;
-  }
+  const double numberOfItems = this->FilterContainersNumberOfValidElements;
+  double xMean = this->FilterSumX / numberOfItems;
+  double yMean = this->FilterSumY / numberOfItems;
+  double covarianceXY = this->FilterSumXY - this->FilterSumX * yMean;
+  double varianceX = this->FilterSumXX - this->FilterSumX * xMean;
   double a = covarianceXY / varianceX;
   double b = yMean - a * xMean;
 
-  outFilteredTimestamp = a * itemIndex + b;
+  outFilteredTimestamp = a * (static_cast<double>(itemIndex) - this->FilterReferenceIndex) + b + this->FilterReferenceTimestamp;
 
   if (this->TimeStampLogging)
   {
@@ -628,6 +1234,35 @@ PlusStatus vtkPlusTimestampedCircularBuffer::CreateFilteredTimeStampForItem(unsi
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+void vtkPlusTimestampedCircularBuffer::RecomputeFilterSums()
+{
+  // the caller must have locked the buffer
+  this->FilterItemsSinceSumsRecomputed = 0;
+  this->FilterSumX = 0;
+  this->FilterSumY = 0;
+  this->FilterSumXX = 0;
+  this->FilterSumXY = 0;
+  if (this->FilterContainersNumberOfValidElements == 0)
+  {
+    return;
+  }
+
+  // The most recent item becomes the reference
+  unsigned int latestIndex = (this->FilterContainersOldestIndex > 0) ? this->FilterContainersOldestIndex - 1 : this->FilterContainersNumberOfValidElements - 1;
+  this->FilterReferenceIndex = this->FilterContainerIndexVector(latestIndex);
+  this->FilterReferenceTimestamp = this->FilterContainerTimestampVector(latestIndex);
+  for (unsigned int i = 0; i < this->FilterContainersNumberOfValidElements; ++i)
+  {
+    double x = this->FilterContainerIndexVector(i) - this->FilterReferenceIndex;
+    double y = this->FilterContainerTimestampVector(i) - this->FilterReferenceTimestamp;
+    this->FilterSumX += x;
+    this->FilterSumY += y;
+    this->FilterSumXX += x * x;
+    this->FilterSumXY += x * y;
+  }
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusTimestampedCircularBuffer::GetTimeStampReportTable(vtkTable* timeStampReportTable)
 {
@@ -650,6 +1285,114 @@ PlusStatus vtkPlusTimestampedCircularBuffer::GetTimeStampReportTable(vtkTable* t
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+void vtkPlusTimestampedCircularBuffer::SetTimeStampReportMaximumNumberOfRows(unsigned int maximumNumberOfRows)
+{
+  igsioLockGuard< vtkPlusTimestampedCircularBuffer > bufferGuardedLock(this);
+  this->TimeStampReportMaximumNumberOfRows = maximumNumberOfRows;
+}
+
+//----------------------------------------------------------------------------
+unsigned int vtkPlusTimestampedCircularBuffer::GetTimeStampReportMaximumNumberOfRows()
+{
+  igsioLockGuard< vtkPlusTimestampedCircularBuffer > bufferGuardedLock(this);
+  return this->TimeStampReportMaximumNumberOfRows;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusTimestampedCircularBuffer::SetTimeStampReportFilename(const std::string& filename)
+{
+  igsioLockGuard< vtkPlusTimestampedCircularBuffer > bufferGuardedLock(this);
+  if (this->TimeStampReportFile.is_open())
+  {
+    this->TimeStampReportFile.close();
+  }
+  this->TimeStampReportFilename = filename;
+  if (filename.empty())
+  {
+    return PLUS_SUCCESS;
+  }
+  this->TimeStampReportFile.open(filename.c_str(), std::ios::out | std::ios::trunc);
+  if (!this->TimeStampReportFile.is_open())
+  {
+    LOG_ERROR("Failed to open timestamp report file for writing: " << filename);
+    this->TimeStampReportFilename.clear();
+    return PLUS_FAIL;
+  }
+  this->TimeStampReportFile << "FrameNumber,UnfilteredTimestamp,FilteredTimestamp" << std::endl;
+  this->TimeStampReportFile << std::fixed << std::setprecision(6);
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkPlusTimestampedCircularBuffer::GetTimeStampReportFilename()
+{
+  igsioLockGuard< vtkPlusTimestampedCircularBuffer > bufferGuardedLock(this);
+  return this->TimeStampReportFilename;
+}
+
+//----------------------------------------------------------------------------
+TimeStampReportStatistics vtkPlusTimestampedCircularBuffer::GetTimeStampReportStatistics()
+{
+  igsioLockGuard< vtkPlusTimestampedCircularBuffer > bufferGuardedLock(this);
+  return this->TimeStampReportStats;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusTimestampedCircularBuffer::ClearTimeStampReport()
+{
+  igsioLockGuard< vtkPlusTimestampedCircularBuffer > bufferGuardedLock(this);
+  if (this->TimeStampReportTable != NULL)
+  {
+    this->TimeStampReportTable->Delete();
+    this->TimeStampReportTable = NULL;
+  }
+  this->TimeStampReportDecimationFactor = 1;
+  this->TimeStampReportItemsSinceLastRow = 0;
+  this->TimeStampReportStats.Clear();
+  this->TimeStampReportLastUnfilteredTimestamp = UNDEFINED_TIMESTAMP;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusTimestampedCircularBuffer::GetMemoryUsage(BufferMemoryUsage& usage)
+{
+  igsioLockGuard< vtkPlusTimestampedCircularBuffer > bufferGuardedLock(this);
+  usage = BufferMemoryUsage();
+
+  std::vector<StreamBufferItem*> items;
+  for (std::deque<StreamBufferItem>::iterator it = this->BufferItemContainer.begin(); it != this->BufferItemContainer.end(); ++it)
+  {
+    items.push_back(&(*it));
+  }
+  usage.ItemBytes += this->CompactPoseItemContainer.capacity() * sizeof(CompactPoseItem);
+  for (std::vector<BufferSnapshotItems*>::iterator snapshotIt = this->Snapshots.begin(); snapshotIt != this->Snapshots.end(); ++snapshotIt)
+  {
+    BufferSnapshotItems* snapshot = *snapshotIt;
+    for (std::map<BufferItemUidType, StreamBufferItem>::iterator it = snapshot->PreservedItems.begin(); it != snapshot->PreservedItems.end(); ++it)
+    {
+      items.push_back(&(it->second));
+    }
+    usage.ItemBytes += snapshot->PreservedCompactPoseItems.size() * sizeof(CompactPoseItem);
+    usage.ItemBytes += snapshot->FilteredTimestamps.capacity() * sizeof(double);
+  }
+
+  usage.ItemBytes += items.size() * sizeof(StreamBufferItem);
+  for (std::vector<StreamBufferItem*>::iterator it = items.begin(); it != items.end(); ++it)
+  {
+    unsigned long long frameBytes = 0;
+    unsigned long long fieldBytes = 0;
+    (*it)->GetMemoryUsage(frameBytes, fieldBytes);
+    usage.FrameBytes += frameBytes;
+    usage.FieldBytes += fieldBytes;
+  }
+
+  if (this->TimeStampReportTable != NULL)
+  {
+    // vtkTable reports the allocated memory in kibibytes
+    usage.TimeStampReportBytes = static_cast<unsigned long long>(this->TimeStampReportTable->GetActualMemorySize()) * 1024;
+  }
+}
+
 //----------------------------------------------------------------------------
 void vtkPlusTimestampedCircularBuffer::AddToTimeStampReport(unsigned long itemIndex, double unfilteredTimestamp, double filteredTimestamp)
 {
@@ -659,6 +1402,24 @@ void vtkPlusTimestampedCircularBuffer::AddToTimeStampReport(unsigned long itemIn
     return;
   }
 
+  igsioLockGuard< vtkPlusTimestampedCircularBuffer > bufferGuardedLock(this);
+
+  bool framePeriodValid = (this->TimeStampReportLastUnfilteredTimestamp != UNDEFINED_TIMESTAMP);
+  this->TimeStampReportStats.AddItem(unfilteredTimestamp - this->TimeStampReportLastUnfilteredTimestamp, framePeriodValid, unfilteredTimestamp - filteredTimestamp);
+  this->TimeStampReportLastUnfilteredTimestamp = unfilteredTimestamp;
+
+  if (this->TimeStampReportFile.is_open())
+  {
+    this->TimeStampReportFile << itemIndex << "," << unfilteredTimestamp - this->StartTime << "," << filteredTimestamp - this->StartTime << "\n";
+  }
+
+  // Only every TimeStampReportDecimationFactor-th item is added to the table
+  if (++this->TimeStampReportItemsSinceLastRow < this->TimeStampReportDecimationFactor)
+  {
+    return;
+  }
+  this->TimeStampReportItemsSinceLastRow = 0;
+
   if (this->TimeStampReportTable == NULL)
   {
     this->TimeStampReportTable = vtkTable::New();
@@ -679,13 +1440,94 @@ void vtkPlusTimestampedCircularBuffer::AddToTimeStampReport(unsigned long itemIn
     this->TimeStampReportTable->AddColumn(colFilteredTimestamp);
   }
 
+  if (this->TimeStampReportMaximumNumberOfRows > 0
+      && this->TimeStampReportTable->GetNumberOfRows() >= static_cast<vtkIdType>(this->TimeStampReportMaximumNumberOfRows))
+  {
+    // Keep every second row and halve the rate of adding new rows
+    vtkIdType numberOfRows = this->TimeStampReportTable->GetNumberOfRows();
+    vtkIdType numberOfKeptRows = (numberOfRows + 1) / 2;
+    for (vtkIdType c = 0; c < this->TimeStampReportTable->GetNumberOfColumns(); ++c)
+    {
+      vtkDoubleArray* column = vtkDoubleArray::SafeDownCast(this->TimeStampReportTable->GetColumn(c));
+      for (vtkIdType r = 0; r < numberOfKeptRows; ++r)
+      {
+        column->SetValue(r, column->GetValue(2 * r));
+      }
+      column->SetNumberOfTuples(numberOfKeptRows);
+    }
+    this->TimeStampReportDecimationFactor *= 2;
+  }
+
   // create a new row for the timestamp report table
-  vtkSmartPointer<vtkVariantArray> timeStampReportTableRow = vtkSmartPointer<vtkVariantArray>::New();
+  vtkDoubleArray::SafeDownCast(this->TimeStampReportTable->GetColumn(0))->InsertNextValue(itemIndex);
+  vtkDoubleArray::SafeDownCast(this->TimeStampReportTable->GetColumn(1))->InsertNextValue(unfilteredTimestamp - this->StartTime);
+  vtkDoubleArray::SafeDownCast(this->TimeStampReportTable->GetColumn(2))->InsertNextValue(filteredTimestamp - this->StartTime);
+}
 
-  timeStampReportTableRow->InsertNextValue(itemIndex);
-  timeStampReportTableRow->InsertNextValue(unfilteredTimestamp - this->StartTime);
-  timeStampReportTableRow->InsertNextValue(filteredTimestamp - this->StartTime);
+//----------------------------------------------------------------------------
+TimeStampReportStatistics::TimeStampReportStatistics()
+{
+  this->Clear();
+}
+
+//----------------------------------------------------------------------------
+void TimeStampReportStatistics::Clear()
+{
+  this->NumberOfItems = 0;
+  this->NumberOfFramePeriods = 0;
+  this->FramePeriodMeanSec = 0.0;
+  this->FramePeriodSumSquaredDiffSec = 0.0;
+  this->FramePeriodMinSec = 0.0;
+  this->FramePeriodMaxSec = 0.0;
+  std::fill(this->JitterHistogram, this->JitterHistogram + NUMBER_OF_JITTER_HISTOGRAM_BINS, 0);
+}
+
+//----------------------------------------------------------------------------
+void TimeStampReportStatistics::AddItem(double framePeriodSec, bool framePeriodValid, double jitterSec)
+{
+  ++this->NumberOfItems;
+
+  double absJitterSec = fabs(jitterSec);
+  int binIndex = 0;
+  while (binIndex < NUMBER_OF_JITTER_HISTOGRAM_BINS - 1 && absJitterSec > GetJitterHistogramBinUpperLimitSec(binIndex))
+  {
+    ++binIndex;
+  }
+  ++this->JitterHistogram[binIndex];
+
+  if (!framePeriodValid)
+  {
+    return;
+  }
+  ++this->NumberOfFramePeriods;
+  if (this->NumberOfFramePeriods == 1)
+  {
+    this->FramePeriodMinSec = framePeriodSec;
+    this->FramePeriodMaxSec = framePeriodSec;
+  }
+  else
+  {
+    this->FramePeriodMinSec = std::min(this->FramePeriodMinSec, framePeriodSec);
+    this->FramePeriodMaxSec = std::max(this->FramePeriodMaxSec, framePeriodSec);
+  }
+  double diffFromOldMean = framePeriodSec - this->FramePeriodMeanSec;
+  this->FramePeriodMeanSec += diffFromOldMean / this->NumberOfFramePeriods;
+  this->FramePeriodSumSquaredDiffSec += diffFromOldMean * (framePeriodSec - this->FramePeriodMeanSec);
+}
 
-  this->TimeStampReportTable->InsertNextRow(timeStampReportTableRow);
+//----------------------------------------------------------------------------
+double TimeStampReportStatistics::GetFramePeriodStdevSec() const
+{
+  if (this->NumberOfFramePeriods < 2)
+  {
+    return 0.0;
+  }
+  return sqrt(this->FramePeriodSumSquaredDiffSec / (this->NumberOfFramePeriods - 1));
+}
 
+//----------------------------------------------------------------------------
+double TimeStampReportStatistics::GetJitterHistogramBinUpperLimitSec(int binIndex)
+{
+  static const double binUpperLimitsSec[NUMBER_OF_JITTER_HISTOGRAM_BINS] = { 0.0005, 0.001, 0.002, 0.005, 0.01, 0.02, 0.05, DBL_MAX };
+  return binUpperLimitsSec[binIndex];
 }
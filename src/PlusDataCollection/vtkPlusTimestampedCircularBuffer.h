@@ -8,15 +8,22 @@
 #define __vtkPlusTimestampedCircularBuffer_h
 
 #include "PlusConfigure.h"
+#include "PlusProfiler.h"
 #include "PlusStreamBufferItem.h"
 #include "vtkObject.h"
+#include <atomic>
 #include <deque>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
 
 #include "vnl/vnl_matrix.h"
 #include "vnl/vnl_vector.h"
 
 #include <float.h> // for DBL_MAX
 
+class PlusLockFreeTimestampIndex;
 class vtkIGSIORecursiveCriticalSection;
 class vtkTable;
 
@@ -27,6 +34,98 @@ class vtkTable;
 
 enum ItemStatus { ITEM_OK, ITEM_NOT_AVAILABLE_YET, ITEM_NOT_AVAILABLE_ANYMORE, ITEM_UNKNOWN_ERROR };
 
+/*!
+  Tracking-only buffer item, stored by value in a contiguous array if compact pose storage is enabled.
+  Timestamps are local (the local time offset is not included).
+*/
+struct CompactPoseItem
+{
+  double FilteredTimestamp;
+  double UnfilteredTimestamp;
+  unsigned long Index;
+  ToolStatus Status;
+  bool ValidTransformData;
+  /*! First three rows of the homogeneous transformation matrix, in row-major order */
+  double Matrix[12];
+};
+
+/*!
+  Item range of a buffer snapshot (see PlusBufferSnapshot). The range and the timestamps are captured when the snapshot
+  is registered in the buffer. Items of the range that are overwritten or removed from the buffer while the snapshot is
+  registered are copied into the preserved item maps first (copy-on-overwrite), so they remain readable.
+  The preserved items are accessed only while the buffer is locked.
+*/
+struct BufferSnapshotItems
+{
+  BufferSnapshotItems() : FirstUid(1), LastUid(0) {}
+
+  /*! UID of the oldest item in the snapshot */
+  BufferItemUidType FirstUid;
+  /*! UID of the latest item in the snapshot, less than FirstUid if the snapshot is empty */
+  BufferItemUidType LastUid;
+  /*! Filtered timestamps (including the local time offset) of the items from FirstUid to LastUid */
+  std::vector<double> FilteredTimestamps;
+  std::map<BufferItemUidType, StreamBufferItem> PreservedItems;
+  std::map<BufferItemUidType, CompactPoseItem> PreservedCompactPoseItems;
+};
+
+/*!
+  Rolling statistics of the items that are added to the timestamp report of a buffer.
+  The statistics are updated for every item, also for the ones that are not stored in the decimated report table.
+*/
+class TimeStampReportStatistics
+{
+public:
+  enum { NUMBER_OF_JITTER_HISTOGRAM_BINS = 8 };
+
+  TimeStampReportStatistics();
+  void Clear();
+
+  /*! Add the frame period (difference between consecutive unfiltered timestamps) and jitter (unfiltered - filtered timestamp) of an item */
+  void AddItem(double framePeriodSec, bool framePeriodValid, double jitterSec);
+
+  unsigned long GetNumberOfItems() const { return this->NumberOfItems; }
+  unsigned long GetNumberOfFramePeriods() const { return this->NumberOfFramePeriods; }
+  double GetFramePeriodMeanSec() const { return this->FramePeriodMeanSec; }
+  double GetFramePeriodStdevSec() const;
+  double GetFramePeriodMinSec() const { return this->FramePeriodMinSec; }
+  double GetFramePeriodMaxSec() const { return this->FramePeriodMaxSec; }
+
+  /*! Number of items with absolute jitter in the specified bin */
+  unsigned long GetJitterHistogramCount(int binIndex) const { return this->JitterHistogram[binIndex]; }
+
+  /*! Upper limit of the absolute jitter in a histogram bin. The last bin contains all larger values. */
+  static double GetJitterHistogramBinUpperLimitSec(int binIndex);
+
+protected:
+  unsigned long NumberOfItems;
+  unsigned long NumberOfFramePeriods;
+  double FramePeriodMeanSec;
+  /*! Sum of squared differences from the mean, updated incrementally (Welford's method) */
+  double FramePeriodSumSquaredDiffSec;
+  double FramePeriodMinSec;
+  double FramePeriodMaxSec;
+  unsigned long JitterHistogram[NUMBER_OF_JITTER_HISTOGRAM_BINS];
+};
+
+/*!
+  Approximate memory used by a buffer, in bytes (see vtkPlusTimestampedCircularBuffer::GetMemoryUsage).
+  Items preserved for snapshots are included.
+*/
+struct BufferMemoryUsage
+{
+  BufferMemoryUsage() : ItemBytes(0), FrameBytes(0), FieldBytes(0), TimeStampReportBytes(0) {}
+  unsigned long long GetTotalBytes() const { return this->ItemBytes + this->FrameBytes + this->FieldBytes + this->TimeStampReportBytes; }
+
+  /*! Item objects, without the pixel data and the custom frame fields */
+  unsigned long long ItemBytes;
+  /*! Pixel data of the frames (see StreamBufferItem::GetMemoryUsage) */
+  unsigned long long FrameBytes;
+  /*! Custom frame fields */
+  unsigned long long FieldBytes;
+  /*! Timestamp report table */
+  unsigned long long TimeStampReportBytes;
+};
 
 /*!
   \class vtkPlusTimestampedCircularBuffer
@@ -45,7 +144,7 @@ public:
    video frames that it will hold.  The default is 30.
   */
   virtual PlusStatus SetBufferSize( int n );
-  virtual inline int GetBufferSize() { return this->BufferItemContainer.size(); };
+  virtual inline int GetBufferSize() { return this->CompactPoseStorage ? this->CompactPoseItemContainer.size() : this->BufferItemContainer.size(); };
 
   /*!
     Get the number of items in the list (this is not the same as
@@ -62,46 +161,46 @@ public:
   virtual ItemStatus GetItemUidFromTime( const double time, BufferItemUidType& uid );
 
   /*! Get the most recent frame UID that is already in the buffer */
-  virtual BufferItemUidType GetLatestItemUidInBuffer()
-  {
-    this->Lock();
-    BufferItemUidType latestUid = this->LatestItemUid;
-    this->Unlock();
-    return latestUid;
-  }
+  virtual BufferItemUidType GetLatestItemUidInBuffer();
 
   /*! Get the oldest frame UID in the buffer  */
-  virtual BufferItemUidType GetOldestItemUidInBuffer()
-  {
-    this->Lock();
-    // LatestItemUid - ( NumberOfItems - 1 ) is the oldest element in the buffer
-    BufferItemUidType oldestUid = this->LatestItemUid - ( this->NumberOfItems - 1 );
-    this->Unlock();
-    return oldestUid;
-  }
+  virtual BufferItemUidType GetOldestItemUidInBuffer();
 
   /*! Get timestamp by frame UID associated with the buffer item  */
-  virtual ItemStatus GetLatestTimeStamp( double& timestamp )
-  {
-    return this->GetTimeStamp( this->GetLatestItemUidInBuffer(), timestamp );
-  }
+  virtual ItemStatus GetLatestTimeStamp( double& timestamp );
 
-  virtual ItemStatus GetOldestTimeStamp( double& timestamp )
-  {
-    // The oldest item may be removed from the buffer at any moment
-    // therefore we need to retrieve its UID and timestamp within a single lock
-    this->Lock();
-    // LatestItemUid - ( NumberOfItems - 1 ) is the oldest element in the buffer
-    BufferItemUidType oldestUid = ( this->LatestItemUid - ( this->NumberOfItems - 1 ) );
-    ItemStatus status = this->GetTimeStamp( oldestUid, timestamp );
-    this->Unlock();
-    return status;
-  }
+  virtual ItemStatus GetOldestTimeStamp( double& timestamp );
 
   virtual ItemStatus GetTimeStamp( const BufferItemUidType uid, double& timestamp ) { return this->GetFilteredTimeStamp( uid, timestamp ); }
   virtual ItemStatus GetFilteredTimeStamp( const BufferItemUidType uid, double& filteredTimestamp );
   virtual ItemStatus GetUnfilteredTimeStamp( const BufferItemUidType uid, double& unfilteredTimestamp );
 
+  /*!
+    Get the UIDs and filtered timestamps of the items from firstUid to lastUid that are in the buffer, with the buffer
+    locked only once. Allows processing a long range of items afterwards (e.g., on multiple threads) without
+    querying the buffer index item by item.
+  */
+  virtual void GetItemTimeStamps( BufferItemUidType firstUid, BufferItemUidType lastUid, std::vector<BufferItemUidType>& uids, std::vector<double>& filteredTimestamps );
+
+  /*!
+    Register a snapshot: the current item range and timestamps are stored in snapshotItems and the items of the range
+    are kept readable (see GetSnapshotItemPointerFromUid) until UnregisterSnapshot is called. The caller owns snapshotItems.
+  */
+  virtual void RegisterSnapshot( BufferSnapshotItems* snapshotItems );
+  virtual void UnregisterSnapshot( BufferSnapshotItems* snapshotItems );
+
+  /*!
+    Get an item of a registered snapshot, from the buffer or from the copy that was preserved when it was overwritten.
+    INTERNAL USE ONLY! Need to lock buffer until we use the item
+  */
+  virtual ItemStatus GetSnapshotItemPointerFromUid( BufferSnapshotItems* snapshotItems, const BufferItemUidType uid, StreamBufferItem*& itemPtr );
+
+  /*!
+    Get a compact pose item of a registered snapshot, only if compact pose storage is enabled
+    INTERNAL USE ONLY! Need to lock buffer until we use the item
+  */
+  virtual ItemStatus GetSnapshotCompactPoseItemPointerFromUid( BufferSnapshotItems* snapshotItems, const BufferItemUidType uid, CompactPoseItem*& itemPtr );
+
   virtual bool GetLatestItemHasValidVideoData();
   virtual bool GetLatestItemHasValidTransformData();
   virtual bool GetLatestItemHasValidFieldData();
@@ -123,7 +222,7 @@ public:
   virtual void DeepCopy( vtkPlusTimestampedCircularBuffer* buffer );
 
   /*!  Set the local time offset in seconds (global = local + offset) */
-  vtkSetMacro( LocalTimeOffsetSec, double );
+  virtual void SetLocalTimeOffsetSec( double offsetSec );
   /*!  Get the local time offset in seconds (global = local + offset) */
   vtkGetMacro( LocalTimeOffsetSec, double );
 
@@ -141,12 +240,38 @@ public:
   /*! Clear buffer (set the buffer pointer to the first element) */
   virtual void Clear();
 
+  /*!
+    If enabled then item UID and timestamp queries (GetLatestItemUidInBuffer, GetOldestItemUidInBuffer, GetLatestTimeStamp,
+    GetOldestTimeStamp, GetTimeStamp, GetItemUidFromTime) are served from a sequence-locked index without taking
+    the buffer lock, so that polling readers do not contend with the thread that adds items.
+    Access to the item contents is still protected by the buffer lock.
+    Should be set before the buffer is used by multiple threads.
+  */
+  virtual void SetLockFreeReadEnabled( bool enabled );
+  virtual bool GetLockFreeReadEnabled() const { return this->LockFreeReadEnabled; }
+  vtkBooleanMacro( LockFreeReadEnabled, bool );
+
+  /*!
+    If enabled then the items are stored as CompactPoseItem values in a contiguous array instead of StreamBufferItem objects.
+    Only tracking data (timestamps, frame index, tool status, transformation matrix) can be stored then,
+    items have to be accessed by GetCompactPoseItemPointerFromUid and GetCompactPoseItemPointerFromBufferIndex.
+    Can only be changed while the buffer is empty.
+  */
+  virtual PlusStatus SetCompactPoseStorage( bool enabled );
+  vtkGetMacro( CompactPoseStorage, bool );
+
   /*!
     Lock the buffer: this should be done before changing or accessing
     the data in the buffer if the buffer is being used from multiple
     threads.
+    The profiler zone covers the time spent waiting for the lock, which shows contention between the acquisition
+    and the consumer threads.
   */
-  inline void Lock() { this->Mutex->Lock(); };
+  inline void Lock()
+  {
+    PLUS_PROFILE_ZONE("vtkPlusTimestampedCircularBuffer::Lock");
+    this->Mutex->Lock();
+  };
   /*!
     Unlock the buffer: this should be done before changing or accessing
     the data in the buffer if the buffer is being used from multiple
@@ -166,8 +291,44 @@ public:
   */
   virtual ItemStatus GetBufferItemPointerFromUid( const BufferItemUidType uid, StreamBufferItem*& itemPtr );
 
+  /*!
+    Get compact pose item by buffer index, only if compact pose storage is enabled
+    INTERNAL USE ONLY! Need to lock buffer until we use the buffer index
+  */
+  virtual CompactPoseItem* GetCompactPoseItemPointerFromBufferIndex( const int bufferIndex );
+
+  /*!
+    Get compact pose item by UID, only if compact pose storage is enabled
+    INTERNAL USE ONLY! Need to lock buffer until we use the item
+  */
+  virtual ItemStatus GetCompactPoseItemPointerFromUid( const BufferItemUidType uid, CompactPoseItem*& itemPtr );
+
+  /*!
+    Advance the write pointer for a new item.
+    Fails if the timestamp is not newer than the latest one or if an item is reserved by ReserveNextItem.
+  */
   virtual PlusStatus PrepareForNewItem( const double timestamp, BufferItemUidType& newFrameUid, int& bufferIndex );
 
+  /*!
+    Reserve the next writable buffer item for in-place filling.
+    The reserved item is not accessible by readers until CommitReservedItem is called.
+    If the buffer is full then the oldest item is dropped immediately, as it is going to be overwritten.
+    Only one item can be reserved at a time.
+  */
+  virtual PlusStatus ReserveNextItem( int& bufferIndex );
+
+  /*!
+    Make the reserved buffer item available for readers, with the specified timestamp.
+    If the timestamp is not newer than the latest one then the reservation is released and the call fails.
+  */
+  virtual PlusStatus CommitReservedItem( const double timestamp, BufferItemUidType& newFrameUid, int& bufferIndex );
+
+  /*! Release the reserved buffer item without adding it to the buffer */
+  virtual void ReleaseReservedItem();
+
+  /*! Returns true if an item is currently reserved for in-place filling */
+  virtual bool HasReservedItem();
+
   /*!
     Create filtered and unfiltered timestamp for accurate timing of the buffer item.
     The timing may be inaccurate because the timestamp is attached to the item when Plus receives it
@@ -191,6 +352,30 @@ public:
   vtkGetMacro( TimeStampReporting, bool );
   vtkBooleanMacro( TimeStampReporting, bool );
 
+  /*!
+    Maximum number of rows of the timestamp report table, 0 means no limit.
+    When the table is full then every second row is removed and only every second of the following items is added,
+    so the table covers the whole acquisition with decreasing resolution while its size remains bounded.
+  */
+  void SetTimeStampReportMaximumNumberOfRows( unsigned int maximumNumberOfRows );
+  unsigned int GetTimeStampReportMaximumNumberOfRows();
+
+  /*!
+    If a file name is set then each item of the timestamp report is also appended to this CSV file, without decimation.
+    The file is overwritten when the file name is set. Empty file name closes the file.
+  */
+  PlusStatus SetTimeStampReportFilename( const std::string& filename );
+  std::string GetTimeStampReportFilename();
+
+  /*! Get the rolling frame period and jitter statistics of all items added to the timestamp report */
+  TimeStampReportStatistics GetTimeStampReportStatistics();
+
+  /*! Remove all rows and statistics from the timestamp report */
+  void ClearTimeStampReport();
+
+  /*! Get the memory used by the items and the timestamp report. All items are visited while the buffer is locked. */
+  void GetMemoryUsage(BufferMemoryUsage& usage);
+
   /*! If TimeStampLogging is enabled then the timestamps and frame indexes that are used for filtering will be logged at TRACE level for diagnostic purposes. */
   vtkSetMacro( TimeStampLogging, bool );
   vtkGetMacro( TimeStampLogging, bool );
@@ -210,6 +395,28 @@ protected:
   vtkPlusTimestampedCircularBuffer();
   ~vtkPlusTimestampedCircularBuffer();
 
+  /*! Fill the lock-free index from the current buffer content. The caller must have locked the buffer. */
+  void RebuildLockFreeIndex();
+
+  /*! Get filtered timestamp of an item that is known to be in the buffer. The caller must have locked the buffer. */
+  double GetFilteredTimestampFromUidNoLock(const BufferItemUidType uid);
+
+  /*! Recompute the timestamp filtering sums from the stored item indexes and timestamps. The caller must have locked the buffer. */
+  void RecomputeFilterSums();
+
+  /*! Get buffer index of an item that is known to be in the buffer. The caller must have locked the buffer. */
+  int GetBufferIndexFromUidNoLock(const BufferItemUidType uid);
+
+  /*!
+    Copy the items from firstUid to lastUid (that must be in the buffer) to the registered snapshots that contain them,
+    before they are overwritten or removed. The pixel data of the frames is shared with the buffer items, not copied.
+    The caller must have locked the buffer.
+  */
+  void PreserveItemsForSnapshotsNoLock(BufferItemUidType firstUid, BufferItemUidType lastUid);
+
+  /*! Preserve all items of the buffer for the registered snapshots. The caller must have locked the buffer. */
+  void PreserveAllItemsForSnapshotsNoLock();
+
 protected:
   vtkIGSIORecursiveCriticalSection* Mutex;
 
@@ -218,19 +425,39 @@ protected:
   /*! Next image will be written here */
   int WritePointer;
 
+  /*! Buffer index of the item that is reserved for in-place filling (-1 if there is no reserved item) */
+  int ReservedBufferIndex;
+
   double CurrentTimeStamp;
 
   /*! Time offset of the buffer in seconds */
   double LocalTimeOffsetSec;
 
+  /*! If true then UID and timestamp queries are served from LockFreeIndex. Read without the buffer lock by the queries. */
+  std::atomic<bool> LockFreeReadEnabled;
+
+  /*! Sequence-locked copy of the item UIDs and timestamps, kept up-to-date only if LockFreeReadEnabled is true */
+  PlusLockFreeTimestampIndex* LockFreeIndex;
+
   /*!
     This will be the UID of the next item that will be added.
     The UID is monotonously increasing for each new frame.
   */
   BufferItemUidType LatestItemUid;
 
+  /*! UID of the item that was returned by the last GetItemUidFromTime call, used as a starting point for the next search */
+  BufferItemUidType LastFoundItemUid;
+
   std::deque<StreamBufferItem> BufferItemContainer;
 
+  /*! If true then the items are stored in CompactPoseItemContainer and BufferItemContainer is empty */
+  bool CompactPoseStorage;
+
+  std::vector<CompactPoseItem> CompactPoseItemContainer;
+
+  /*! Registered snapshots, their items are preserved before they are overwritten */
+  std::vector<BufferSnapshotItems*> Snapshots;
+
   /*! Matrix used for storing the last number of AveragedItemsForFiltering frame index */
   vnl_vector<double> FilterContainerIndexVector;
 
@@ -243,6 +470,19 @@ protected:
   /*! Number of valid elements in the frame index and timestamp containers (maximum can be equal to AveragedItemsForFiltering) */
   unsigned int FilterContainersNumberOfValidElements;
 
+  /*! Number of items added since the filtering sums were last recomputed from the containers */
+  unsigned int FilterItemsSinceSumsRecomputed;
+
+  /*! Frame index and timestamp that the filtering sums are relative to */
+  double FilterReferenceIndex;
+  double FilterReferenceTimestamp;
+
+  /*! Running sums of the frame indexes (x) and timestamps (y) in the containers, for incremental line fitting */
+  double FilterSumX;
+  double FilterSumY;
+  double FilterSumXX;
+  double FilterSumXY;
+
   /*! Number of averaged items used for filtering - read from config files */
   unsigned int AveragedItemsForFiltering;
 
@@ -259,6 +499,22 @@ protected:
   /*! Table used for storing timestamp filtering results */
   vtkTable* TimeStampReportTable;
 
+  /*! Maximum number of rows in TimeStampReportTable (0 = unlimited) */
+  unsigned int TimeStampReportMaximumNumberOfRows;
+
+  /*! Only every TimeStampReportDecimationFactor-th item is added to TimeStampReportTable */
+  unsigned int TimeStampReportDecimationFactor;
+
+  /*! Number of items that have been added to the report since the last row was added to the table */
+  unsigned int TimeStampReportItemsSinceLastRow;
+
+  /*! CSV file that all timestamp report items are written to (if TimeStampReportFilename is not empty) */
+  std::string TimeStampReportFilename;
+  std::ofstream TimeStampReportFile;
+
+  TimeStampReportStatistics TimeStampReportStats;
+  double TimeStampReportLastUnfilteredTimestamp;
+
   /*!
     If TimeStampReporting is enabled then all filtered and unfiltered timestamp values will be saved in
     a table. As the table is continuously growing it should be enabled only temporarily, for diagnostic purposes.
@@ -9,6 +9,9 @@ See License.txt for details.
 #include "vtkPlusUsImagingParameters.h"
 #include "vtkPlusDataSource.h"
 
+// VTK includes
+#include <vtkSmartPointer.h>
+
 #ifdef PLUS_USE_tesseract
   #include "vtkPlusVirtualTextRecognizer.h"
 #endif
@@ -107,6 +110,42 @@ PlusStatus vtkPlusUsDevice::SetNewImagingParameters(const vtkPlusUsImagingParame
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusUsDevice::ApplyImagingParameterChanges(const vtkPlusUsImagingParameters& changes)
+{
+  vtkSmartPointer<vtkPlusUsImagingParameters> previousImagingParameters = vtkSmartPointer<vtkPlusUsImagingParameters>::New();
+  previousImagingParameters->DeepCopy(*this->ImagingParameters);
+
+  this->ImagingParameters->CopySetParameters(changes);
+  std::vector<std::string> pendingParameterNames;
+  this->ImagingParameters->GetPendingParameterNames(pendingParameterNames);
+  if (pendingParameterNames.empty())
+  {
+    // All requested values are already in use
+    return PLUS_SUCCESS;
+  }
+
+  // Devices apply all pending parameters in one call, so the device is reconfigured only once for the whole change set
+  if (this->InternalApplyImagingParameterChange() == PLUS_FAIL)
+  {
+    LOG_ERROR("Failed to change imaging parameters in the device, restoring previous imaging parameters");
+    this->ImagingParameters->DeepCopy(*previousImagingParameters);
+    if (this->InternalApplyImagingParameterChange() == PLUS_FAIL)
+    {
+      LOG_ERROR("Failed to restore previous imaging parameters in the device");
+    }
+    return PLUS_FAIL;
+  }
+
+  // Not all devices clear the pending flags, which would make the next change apply these parameters again
+  for (std::vector<std::string>::iterator it = pendingParameterNames.begin(); it != pendingParameterNames.end(); ++it)
+  {
+    this->ImagingParameters->SetPending(*it, false);
+  }
+
+  return PLUS_SUCCESS;
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusUsDevice::AddVideoItemToVideoSource(vtkPlusDataSource& videoSource, const igsioVideoFrame& frame, long frameNumber, double unfilteredTimestamp /*= UNDEFINED_TIMESTAMP*/, double filteredTimestamp /*= UNDEFINED_TIMESTAMP*/, const igsioFieldMapType* customFields /*= NULL*/)
 {
@@ -45,6 +45,14 @@ public:
   */
   virtual PlusStatus SetNewImagingParameters(const vtkPlusUsImagingParameters& newImagingParameters);
 
+  /*!
+    Apply several imaging parameter changes with a single device configuration update.
+    Only the parameters that are set in the changes are modified. If the device fails to apply the changes
+    then the previous imaging parameters are restored and applied to the device.
+    /param changes class containing the ultrasound imaging parameters to change
+  */
+  virtual PlusStatus ApplyImagingParameterChanges(const vtkPlusUsImagingParameters& changes);
+
   /*! This function can be called to add a video item to a specific video data source */
   virtual PlusStatus AddVideoItemToVideoSource(vtkPlusDataSource& videoSource, const igsioVideoFrame& frame, long frameNumber, double unfilteredTimestamp = UNDEFINED_TIMESTAMP,
       double filteredTimestamp = UNDEFINED_TIMESTAMP, const igsioFieldMapType* customFields = NULL);
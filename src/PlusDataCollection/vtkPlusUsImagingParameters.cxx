@@ -121,6 +121,10 @@ PlusStatus vtkPlusUsImagingParameters::SetTimeGainCompensation(const std::vector
   std::stringstream result;
   std::copy(tgc.begin(), tgc.end(), std::ostream_iterator<double>(result, " "));
 
+  if (this->Parameters[KEY_TGC].Value != result.str() || !this->Parameters[KEY_TGC].Set)
+  {
+    this->Modified();
+  }
   if (this->Parameters[KEY_TGC].Value != result.str())
   {
     // If the value changed, then mark it pending
@@ -346,6 +350,10 @@ PlusStatus vtkPlusUsImagingParameters::SetImageSize(const FrameSizeType& imageSi
   std::stringstream result;
   std::copy(imageSize.begin(), imageSize.end(), std::ostream_iterator<double>(result, " "));
 
+  if (this->Parameters[KEY_IMAGESIZE].Value != result.str() || !this->Parameters[KEY_IMAGESIZE].Set)
+  {
+    this->Modified();
+  }
   if (this->Parameters[KEY_IMAGESIZE].Value != result.str())
   {
     // If the value changed, then mark it pending
@@ -447,6 +455,10 @@ PlusStatus vtkPlusUsImagingParameters::ReadConfiguration(vtkXMLDataElement* devi
       continue;
     }
 
+    if (this->Parameters[name].Value != value || !this->Parameters[name].Set)
+    {
+      this->Modified();
+    }
     if (this->Parameters[name].Value != value)
     {
       // If the value changed, then mark it pending
@@ -549,6 +561,10 @@ PlusStatus vtkPlusUsImagingParameters::DeepCopy(const vtkPlusUsImagingParameters
 {
   for (ParameterMapConstIterator it = otherParameters.Parameters.begin(); it != otherParameters.Parameters.end(); ++it)
   {
+    if (this->Parameters[it->first].Value != it->second.Value || this->Parameters[it->first].Set != it->second.Set)
+    {
+      this->Modified();
+    }
     if (this->Parameters[it->first].Value != it->second.Value)
     {
       // If the value changed, then mark it pending
@@ -560,3 +576,40 @@ PlusStatus vtkPlusUsImagingParameters::DeepCopy(const vtkPlusUsImagingParameters
 
   return PLUS_SUCCESS;
 }
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusUsImagingParameters::CopySetParameters(const vtkPlusUsImagingParameters& otherParameters)
+{
+  for (ParameterMapConstIterator it = otherParameters.Parameters.begin(); it != otherParameters.Parameters.end(); ++it)
+  {
+    if (!it->second.Set)
+    {
+      continue;
+    }
+    if (this->Parameters[it->first].Value != it->second.Value || !this->Parameters[it->first].Set)
+    {
+      this->Modified();
+    }
+    if (this->Parameters[it->first].Value != it->second.Value)
+    {
+      this->Parameters[it->first].Pending = true;
+    }
+    this->Parameters[it->first].Value = it->second.Value;
+    this->Parameters[it->first].Set = true;
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+void vtkPlusUsImagingParameters::GetPendingParameterNames(std::vector<std::string>& parameterNames) const
+{
+  parameterNames.clear();
+  for (ParameterMapConstIterator it = this->Parameters.begin(); it != this->Parameters.end(); ++it)
+  {
+    if (it->second.Set && it->second.Pending)
+    {
+      parameterNames.push_back(it->first);
+    }
+  }
+}
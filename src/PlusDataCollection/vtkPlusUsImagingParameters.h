@@ -19,6 +19,8 @@ Ultrasound video devices should contain a member variable of this class that is
 This class exists mainly for two reasons:
 * Provide a standard interface for accessing ultrasound parameters
 * Enable standardized API for operating on ultrasound parameters
+The modification time (GetMTime) changes when a parameter value is changed or set for the first time, so that
+cached replies of parameter queries can be invalidated.
 \ingroup PlusLibDataCollection
 
 Currently contains the following items
@@ -102,6 +104,15 @@ public:
   */
   virtual PlusStatus DeepCopy(const vtkPlusUsImagingParameters& otherParameters);
 
+  /*!
+  Copy only the parameters that are set in another imaging parameters, the other parameters are not changed.
+  Changed values are marked pending.
+  */
+  virtual PlusStatus CopySetParameters(const vtkPlusUsImagingParameters& otherParameters);
+
+  /*! Get the names of the parameters that are set and pending */
+  void GetPendingParameterNames(std::vector<std::string>& parameterNames) const;
+
   /*!
   Request a stored value by key name
   \param paramName the key value to retrieve
@@ -136,6 +147,11 @@ public:
   {
     std::stringstream ss;
     ss << aValue;
+    if (this->Parameters[paramName].Value != ss.str() || !this->Parameters[paramName].Set)
+    {
+      // Allows detecting the change by the modification time
+      this->Modified();
+    }
     if (this->Parameters[paramName].Value != ss.str())
     {
       this->Parameters[paramName].Pending = true;
@@ -0,0 +1,700 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+\file PlusImageProcessingBenchmark.cxx
+\brief Measures the processing time of the image processing algorithms on synthetic frames.
+
+Each benchmark is run with each requested number of threads. As in Google Benchmark, the number of iterations is
+increased until a run takes at least the minimum time, then the run is repeated and the mean, median and standard
+deviation of the run times are reported. The synthetic frames are generated from a fixed seed, so the results of
+different builds can be compared. With --metrics-file, the throughput of each benchmark is written to a performance
+metrics file, which can be compared to a baseline by ComparePerformanceMetrics.
+
+The number of threads applies to the VTK threaded filters. The size of the shared worker pool that is used by some
+algorithms is set separately, because it cannot be changed after the pool is created.
+*/
+
+#include "PlusConfigure.h"
+#include "PlusPerformanceMetrics.h"
+#include "vtkPlusBoneEnhancer.h"
+#include "vtkPlusRfToBrightnessConvert.h"
+#include "vtkPlusTransverseProcessEnhancer.h"
+#include "vtkPlusUsScanConvertCurvilinear.h"
+#include "vtkPlusUsScanConvertLinear.h"
+#ifdef PLUS_USE_INTEL_MKL
+  #include "vtkPlusForoughiBoneSurfaceProbability.h"
+#endif
+
+// VTK includes
+#include <vtkImageCast.h>
+#include <vtkImageData.h>
+#include <vtkMath.h>
+#include <vtkMultiThreader.h>
+#include <vtkSmartPointer.h>
+#include <vtkXMLDataElement.h>
+#include <vtksys/CommandLineArguments.hxx>
+#include <vtksys/RegularExpression.hxx>
+
+// IGSIO includes
+#include <igsioTrackedFrame.h>
+#include <igsioVideoFrame.h>
+#include <vtkIGSIOAccurateTimer.h>
+
+// STL includes
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  struct BenchmarkOptions
+  {
+    int NumberOfScanLines;
+    int NumberOfSamplesPerScanLine;
+    int OutputImageSizePixel[2];
+  };
+
+  //----------------------------------------------------------------------------
+  /*! Small linear congruential generator, so that the synthetic frames are the same on all platforms */
+  class RandomGenerator
+  {
+  public:
+    RandomGenerator() : State(12345) {}
+    /*! Uniform random number in [0, 1) */
+    double Next()
+    {
+      this->State = this->State * 1664525u + 1013904223u;
+      return (this->State >> 8) / 16777216.0;
+    }
+  private:
+    unsigned int State;
+  };
+
+  //----------------------------------------------------------------------------
+  /*!
+    Brightness scan lines with speckle, a bright reflector (bone surface) across the image and an acoustic shadow below it.
+    Each row of the image is a scan line.
+  */
+  vtkSmartPointer<vtkImageData> CreateLinesImage(const BenchmarkOptions& options)
+  {
+    vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
+    image->SetExtent(0, options.NumberOfSamplesPerScanLine - 1, 0, options.NumberOfScanLines - 1, 0, 0);
+    image->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+    RandomGenerator random;
+    unsigned char* pixel = static_cast<unsigned char*>(image->GetScalarPointer());
+    for (int line = 0; line < options.NumberOfScanLines; ++line)
+    {
+      const int boneDepth = static_cast<int>(options.NumberOfSamplesPerScanLine * (0.5 + 0.1 * sin(line * 6.0 / options.NumberOfScanLines)));
+      for (int sample = 0; sample < options.NumberOfSamplesPerScanLine; ++sample, ++pixel)
+      {
+        double value = 20.0 + 100.0 * random.Next();
+        if (abs(sample - boneDepth) < 3)
+        {
+          value = 220.0 + 30.0 * random.Next();
+        }
+        else if (sample > boneDepth)
+        {
+          value *= 0.2;
+        }
+        *pixel = static_cast<unsigned char>(std::min(value, 255.0));
+      }
+    }
+    return image;
+  }
+
+  //----------------------------------------------------------------------------
+  /*! RF scan lines: a carrier modulated by the brightness of CreateLinesImage, with noise */
+  vtkSmartPointer<vtkImageData> CreateRfImage(const BenchmarkOptions& options)
+  {
+    vtkSmartPointer<vtkImageData> linesImage = CreateLinesImage(options);
+    vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
+    image->SetExtent(linesImage->GetExtent());
+    image->AllocateScalars(VTK_SHORT, 1);
+    RandomGenerator random;
+    const unsigned char* brightness = static_cast<const unsigned char*>(linesImage->GetScalarPointer());
+    short* pixel = static_cast<short*>(image->GetScalarPointer());
+    const double samplesPerCarrierPeriod = 4.3;
+    for (int line = 0; line < options.NumberOfScanLines; ++line)
+    {
+      for (int sample = 0; sample < options.NumberOfSamplesPerScanLine; ++sample, ++pixel, ++brightness)
+      {
+        double amplitude = (*brightness) * 100.0;
+        double value = amplitude * sin(2 * vtkMath::Pi() * sample / samplesPerCarrierPeriod) + 500.0 * (random.Next() - 0.5);
+        *pixel = static_cast<short>(std::max(-32768.0, std::min(value, 32767.0)));
+      }
+    }
+    return image;
+  }
+
+  //----------------------------------------------------------------------------
+  vtkSmartPointer<vtkXMLDataElement> CreateCurvilinearScanConversionElement(const BenchmarkOptions& options, const char* interpolationKernel)
+  {
+    vtkSmartPointer<vtkXMLDataElement> scanConversionElement = vtkSmartPointer<vtkXMLDataElement>::New();
+    scanConversionElement->SetName("ScanConversion");
+    scanConversionElement->SetAttribute("TransducerGeometry", "CURVILINEAR");
+    scanConversionElement->SetDoubleAttribute("RadiusStartMm", 50.0);
+    scanConversionElement->SetDoubleAttribute("RadiusStopMm", 120.0);
+    scanConversionElement->SetDoubleAttribute("ThetaStartDeg", -36.0);
+    scanConversionElement->SetDoubleAttribute("ThetaStopDeg", 36.0);
+    // Spacing is chosen so that the fan fills the output image
+    double spacing[2] = { 145.0 / options.OutputImageSizePixel[0], 80.0 / options.OutputImageSizePixel[1] };
+    scanConversionElement->SetVectorAttribute("OutputImageSpacingMmPerPixel", 2, spacing);
+    scanConversionElement->SetVectorAttribute("OutputImageSizePixel", 2, options.OutputImageSizePixel);
+    scanConversionElement->SetAttribute("InterpolationKernel", interpolationKernel);
+    return scanConversionElement;
+  }
+
+  //----------------------------------------------------------------------------
+  vtkSmartPointer<vtkXMLDataElement> CreateLinearScanConversionElement(const BenchmarkOptions& options)
+  {
+    vtkSmartPointer<vtkXMLDataElement> scanConversionElement = vtkSmartPointer<vtkXMLDataElement>::New();
+    scanConversionElement->SetName("ScanConversion");
+    scanConversionElement->SetAttribute("TransducerGeometry", "LINEAR");
+    scanConversionElement->SetDoubleAttribute("ImagingDepthMm", 50.0);
+    scanConversionElement->SetDoubleAttribute("TransducerWidthMm", 38.0);
+    double spacing[2] = { 38.0 / options.OutputImageSizePixel[0], 50.0 / options.OutputImageSizePixel[1] };
+    scanConversionElement->SetVectorAttribute("OutputImageSpacingMmPerPixel", 2, spacing);
+    scanConversionElement->SetVectorAttribute("OutputImageSizePixel", 2, options.OutputImageSizePixel);
+    return scanConversionElement;
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Fan image of a curvilinear probe, as the input of the bone enhancers */
+  PlusStatus CreateFanImage(const BenchmarkOptions& options, vtkImageData* fanImage)
+  {
+    vtkSmartPointer<vtkPlusUsScanConvertCurvilinear> scanConverter = vtkSmartPointer<vtkPlusUsScanConvertCurvilinear>::New();
+    if (scanConverter->ReadConfiguration(CreateCurvilinearScanConversionElement(options, "FLOATING_POINT")) != PLUS_SUCCESS)
+    {
+      return PLUS_FAIL;
+    }
+    scanConverter->SetInputData(CreateLinesImage(options));
+    scanConverter->Update();
+    fanImage->DeepCopy(scanConverter->GetOutput());
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  class ImageProcessingBenchmark
+  {
+  public:
+    virtual ~ImageProcessingBenchmark() {}
+
+    virtual std::string GetName() const = 0;
+
+    /*! Create the algorithm and its input. Called before the runs of each thread count. */
+    virtual PlusStatus SetUp(const BenchmarkOptions& options, int numberOfThreads) = 0;
+
+    /*! Process one frame */
+    virtual PlusStatus RunIteration() = 0;
+
+    /*! Number of input pixels of a frame, for reporting the throughput */
+    virtual double GetNumberOfPixelsPerIteration() const = 0;
+  };
+
+  //----------------------------------------------------------------------------
+  class ScanConvertCurvilinearBenchmark : public ImageProcessingBenchmark
+  {
+  public:
+    ScanConvertCurvilinearBenchmark(const char* interpolationKernel) : InterpolationKernel(interpolationKernel) {}
+
+    std::string GetName() const { return std::string("ScanConvertCurvilinear/") + this->InterpolationKernel; }
+
+    PlusStatus SetUp(const BenchmarkOptions& options, int numberOfThreads)
+    {
+      this->ScanConverter = vtkSmartPointer<vtkPlusUsScanConvertCurvilinear>::New();
+      if (this->ScanConverter->ReadConfiguration(CreateCurvilinearScanConversionElement(options, this->InterpolationKernel)) != PLUS_SUCCESS)
+      {
+        return PLUS_FAIL;
+      }
+      this->ScanConverter->SetNumberOfThreads(numberOfThreads);
+      this->InputImage = CreateLinesImage(options);
+      this->ScanConverter->SetInputData(this->InputImage);
+      return PLUS_SUCCESS;
+    }
+
+    PlusStatus RunIteration()
+    {
+      this->ScanConverter->Modified();
+      this->ScanConverter->Update();
+      return PLUS_SUCCESS;
+    }
+
+    double GetNumberOfPixelsPerIteration() const { return this->InputImage->GetNumberOfPoints(); }
+
+  protected:
+    const char* InterpolationKernel;
+    vtkSmartPointer<vtkPlusUsScanConvertCurvilinear> ScanConverter;
+    vtkSmartPointer<vtkImageData> InputImage;
+  };
+
+  //----------------------------------------------------------------------------
+  /*! Scan converts and accumulates several frames in one pass, as in spatial compounding */
+  class ScanConvertCurvilinearAccumulateBenchmark : public ImageProcessingBenchmark
+  {
+  public:
+    std::string GetName() const { return "ScanConvertCurvilinear/Accumulate"; }
+
+    PlusStatus SetUp(const BenchmarkOptions& options, int vtkNotUsed(numberOfThreads))
+    {
+      const int numberOfFrames = 4;
+      this->ScanConverter = vtkSmartPointer<vtkPlusUsScanConvertCurvilinear>::New();
+      if (this->ScanConverter->ReadConfiguration(CreateCurvilinearScanConversionElement(options, "FLOATING_POINT")) != PLUS_SUCCESS)
+      {
+        return PLUS_FAIL;
+      }
+      this->InputImages.clear();
+      this->InputFrames.clear();
+      this->FrameWeights.clear();
+      for (int frameIndex = 0; frameIndex < numberOfFrames; ++frameIndex)
+      {
+        // Separate copies, so that the frames are read from memory as in a real compounding
+        vtkSmartPointer<vtkImageData> inputImage = vtkSmartPointer<vtkImageData>::New();
+        inputImage->DeepCopy(CreateLinesImage(options));
+        this->InputImages.push_back(inputImage);
+        this->InputFrames.push_back(inputImage);
+        this->FrameWeights.push_back(1.0 / numberOfFrames);
+      }
+      this->OutputImage = vtkSmartPointer<vtkImageData>::New();
+
+      // A single frame with unit weight must give the same image as the scan conversion filter
+      this->ScanConverter->SetInputData(this->InputImages[0]);
+      this->ScanConverter->Update();
+      std::vector<vtkImageData*> singleFrame(1, this->InputFrames[0]);
+      if (this->ScanConverter->AccumulateFrames(singleFrame, std::vector<double>(1, 1.0), this->OutputImage) != PLUS_SUCCESS)
+      {
+        return PLUS_FAIL;
+      }
+      vtkImageData* expectedImage = this->ScanConverter->GetOutput();
+      if (this->OutputImage->GetNumberOfPoints() != expectedImage->GetNumberOfPoints()
+          || memcmp(this->OutputImage->GetScalarPointer(), expectedImage->GetScalarPointer(), expectedImage->GetNumberOfPoints() * expectedImage->GetScalarSize()) != 0)
+      {
+        LOG_ERROR("Accumulated single frame differs from the scan converted frame");
+        return PLUS_FAIL;
+      }
+      return PLUS_SUCCESS;
+    }
+
+    PlusStatus RunIteration()
+    {
+      return this->ScanConverter->AccumulateFrames(this->InputFrames, this->FrameWeights, this->OutputImage);
+    }
+
+    double GetNumberOfPixelsPerIteration() const { return this->InputImages.size() * this->InputImages[0]->GetNumberOfPoints(); }
+
+  protected:
+    vtkSmartPointer<vtkPlusUsScanConvertCurvilinear> ScanConverter;
+    std::vector<vtkSmartPointer<vtkImageData> > InputImages;
+    std::vector<vtkImageData*> InputFrames;
+    std::vector<double> FrameWeights;
+    vtkSmartPointer<vtkImageData> OutputImage;
+  };
+
+  //----------------------------------------------------------------------------
+  class ScanConvertLinearBenchmark : public ImageProcessingBenchmark
+  {
+  public:
+    std::string GetName() const { return "ScanConvertLinear"; }
+
+    PlusStatus SetUp(const BenchmarkOptions& options, int numberOfThreads)
+    {
+      this->ScanConverter = vtkSmartPointer<vtkPlusUsScanConvertLinear>::New();
+      if (this->ScanConverter->ReadConfiguration(CreateLinearScanConversionElement(options)) != PLUS_SUCCESS)
+      {
+        return PLUS_FAIL;
+      }
+      this->ScanConverter->SetNumberOfThreads(numberOfThreads);
+      this->InputImage = CreateLinesImage(options);
+      this->ScanConverter->SetInputData(this->InputImage);
+      return PLUS_SUCCESS;
+    }
+
+    PlusStatus RunIteration()
+    {
+      this->ScanConverter->Modified();
+      this->ScanConverter->Update();
+      return PLUS_SUCCESS;
+    }
+
+    double GetNumberOfPixelsPerIteration() const { return this->InputImage->GetNumberOfPoints(); }
+
+  protected:
+    vtkSmartPointer<vtkPlusUsScanConvertLinear> ScanConverter;
+    vtkSmartPointer<vtkImageData> InputImage;
+  };
+
+  //----------------------------------------------------------------------------
+  class RfToBrightnessConvertBenchmark : public ImageProcessingBenchmark
+  {
+  public:
+    std::string GetName() const { return "RfToBrightnessConvert"; }
+
+    PlusStatus SetUp(const BenchmarkOptions& options, int numberOfThreads)
+    {
+      this->Converter = vtkSmartPointer<vtkPlusRfToBrightnessConvert>::New();
+      this->Converter->SetImageType(US_IMG_RF_REAL);
+      this->Converter->SetNumberOfThreads(numberOfThreads);
+      this->InputImage = CreateRfImage(options);
+      this->Converter->SetInputData(this->InputImage);
+      return PLUS_SUCCESS;
+    }
+
+    PlusStatus RunIteration()
+    {
+      this->Converter->Modified();
+      this->Converter->Update();
+      return PLUS_SUCCESS;
+    }
+
+    double GetNumberOfPixelsPerIteration() const { return this->InputImage->GetNumberOfPoints(); }
+
+  protected:
+    vtkSmartPointer<vtkPlusRfToBrightnessConvert> Converter;
+    vtkSmartPointer<vtkImageData> InputImage;
+  };
+
+  //----------------------------------------------------------------------------
+  /*! Runs vtkPlusBoneEnhancer or one of its subclasses on a fan image */
+  template<class EnhancerType>
+  class BoneEnhancerBenchmark : public ImageProcessingBenchmark
+  {
+  public:
+    BoneEnhancerBenchmark(const std::string& name, bool useFusedEdgeDetection, bool useGpu = false)
+      : Name(name), UseFusedEdgeDetection(useFusedEdgeDetection), UseGpu(useGpu) {}
+
+    std::string GetName() const { return this->Name; }
+
+    PlusStatus SetUp(const BenchmarkOptions& options, int numberOfThreads)
+    {
+      vtkSmartPointer<vtkXMLDataElement> processorElement = vtkSmartPointer<vtkXMLDataElement>::New();
+      processorElement->SetName(vtkPlusTrackedFrameProcessor::GetTagName());
+      processorElement->SetIntAttribute("NumberOfScanLines", options.NumberOfScanLines);
+      processorElement->SetIntAttribute("NumberOfSamplesPerScanLine", options.NumberOfSamplesPerScanLine);
+      processorElement->AddNestedElement(CreateCurvilinearScanConversionElement(options, "FLOATING_POINT"));
+
+      this->Enhancer = vtkSmartPointer<EnhancerType>::New();
+      if (this->Enhancer->ReadConfiguration(processorElement) != PLUS_SUCCESS)
+      {
+        return PLUS_FAIL;
+      }
+      this->Enhancer->SetUseFusedEdgeDetection(this->UseFusedEdgeDetection);
+      this->Enhancer->SetUseGpu(this->UseGpu);
+
+      vtkSmartPointer<vtkImageData> fanImage = vtkSmartPointer<vtkImageData>::New();
+      if (CreateFanImage(options, fanImage) != PLUS_SUCCESS)
+      {
+        return PLUS_FAIL;
+      }
+      this->NumberOfPixels = fanImage->GetNumberOfPoints();
+      igsioVideoFrame videoFrame;
+      videoFrame.DeepCopyFrom(fanImage);
+      this->InputFrame.SetImageData(videoFrame);
+      return PLUS_SUCCESS;
+    }
+
+    PlusStatus RunIteration()
+    {
+      return this->Enhancer->ProcessFrame(&this->InputFrame, &this->OutputFrame);
+    }
+
+    double GetNumberOfPixelsPerIteration() const { return this->NumberOfPixels; }
+
+  protected:
+    std::string Name;
+    bool UseFusedEdgeDetection;
+    bool UseGpu;
+    vtkSmartPointer<EnhancerType> Enhancer;
+    igsioTrackedFrame InputFrame;
+    igsioTrackedFrame OutputFrame;
+    double NumberOfPixels;
+  };
+
+#ifdef PLUS_USE_INTEL_MKL
+  //----------------------------------------------------------------------------
+  class ForoughiBoneSurfaceProbabilityBenchmark : public ImageProcessingBenchmark
+  {
+  public:
+    ForoughiBoneSurfaceProbabilityBenchmark(bool useSeparableConvolution) : UseSeparableConvolution(useSeparableConvolution) {}
+
+    std::string GetName() const { return this->UseSeparableConvolution ? "ForoughiBoneSurfaceProbability/Separable" : "ForoughiBoneSurfaceProbability"; }
+
+    PlusStatus SetUp(const BenchmarkOptions& options, int numberOfThreads)
+    {
+      vtkSmartPointer<vtkImageData> fanImage = vtkSmartPointer<vtkImageData>::New();
+      if (CreateFanImage(options, fanImage) != PLUS_SUCCESS)
+      {
+        return PLUS_FAIL;
+      }
+      vtkSmartPointer<vtkImageCast> castToDouble = vtkSmartPointer<vtkImageCast>::New();
+      castToDouble->SetOutputScalarTypeToDouble();
+      castToDouble->SetInputData(fanImage);
+      castToDouble->Update();
+      this->InputImage = vtkSmartPointer<vtkImageData>::New();
+      this->InputImage->DeepCopy(castToDouble->GetOutput());
+
+      this->Filter = vtkSmartPointer<vtkPlusForoughiBoneSurfaceProbability>::New();
+      this->Filter->SetUseSeparableConvolution(this->UseSeparableConvolution);
+      this->Filter->SetNumberOfThreads(numberOfThreads);
+      this->Filter->SetInputData(this->InputImage);
+      return PLUS_SUCCESS;
+    }
+
+    PlusStatus RunIteration()
+    {
+      this->Filter->Modified();
+      this->Filter->Update();
+      return PLUS_SUCCESS;
+    }
+
+    double GetNumberOfPixelsPerIteration() const { return this->InputImage->GetNumberOfPoints(); }
+
+  protected:
+    bool UseSeparableConvolution;
+    vtkSmartPointer<vtkPlusForoughiBoneSurfaceProbability> Filter;
+    vtkSmartPointer<vtkImageData> InputImage;
+  };
+#endif
+
+  //----------------------------------------------------------------------------
+  /*! Run the given number of iterations, returns the elapsed time in seconds or a negative value on failure */
+  double RunIterations(ImageProcessingBenchmark& benchmark, int numberOfIterations)
+  {
+    const double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+    for (int i = 0; i < numberOfIterations; ++i)
+    {
+      if (benchmark.RunIteration() != PLUS_SUCCESS)
+      {
+        return -1.0;
+      }
+    }
+    return vtkIGSIOAccurateTimer::GetSystemTime() - startTime;
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus RunBenchmark(ImageProcessingBenchmark& benchmark, const BenchmarkOptions& options, int numberOfThreads, double minTimeSec, int repetitions, PlusPerformanceMetrics& metrics)
+  {
+    vtkMultiThreader::SetGlobalMaximumNumberOfThreads(numberOfThreads);
+    if (benchmark.SetUp(options, numberOfThreads) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to set up benchmark " << benchmark.GetName());
+      return PLUS_FAIL;
+    }
+
+    // The first iteration allocates the output and computes the lookup tables, it is not measured
+    if (benchmark.RunIteration() != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Benchmark " << benchmark.GetName() << " failed");
+      return PLUS_FAIL;
+    }
+
+    // Increase the number of iterations until a run takes at least the minimum time
+    int numberOfIterations = 1;
+    double runTimeSec = 0.0;
+    const int maxNumberOfIterations = 1000000;
+    while (true)
+    {
+      runTimeSec = RunIterations(benchmark, numberOfIterations);
+      if (runTimeSec < 0)
+      {
+        LOG_ERROR("Benchmark " << benchmark.GetName() << " failed");
+        return PLUS_FAIL;
+      }
+      if (runTimeSec >= minTimeSec || numberOfIterations >= maxNumberOfIterations)
+      {
+        break;
+      }
+      // Predict the required number of iterations with some margin, but do not grow too fast if the first runs were too short to measure
+      double multiplier = (runTimeSec > 0 ? 1.4 * minTimeSec / runTimeSec : 10.0);
+      numberOfIterations = std::min(maxNumberOfIterations, static_cast<int>(numberOfIterations * std::max(1.1, std::min(multiplier, 10.0))) + 1);
+    }
+
+    std::vector<double> iterationTimesSec(1, runTimeSec / numberOfIterations);
+    for (int i = 1; i < repetitions; ++i)
+    {
+      runTimeSec = RunIterations(benchmark, numberOfIterations);
+      if (runTimeSec < 0)
+      {
+        LOG_ERROR("Benchmark " << benchmark.GetName() << " failed");
+        return PLUS_FAIL;
+      }
+      iterationTimesSec.push_back(runTimeSec / numberOfIterations);
+    }
+
+    double mean = 0.0;
+    for (std::vector<double>::iterator it = iterationTimesSec.begin(); it != iterationTimesSec.end(); ++it)
+    {
+      mean += *it;
+    }
+    mean /= iterationTimesSec.size();
+    double variance = 0.0;
+    for (std::vector<double>::iterator it = iterationTimesSec.begin(); it != iterationTimesSec.end(); ++it)
+    {
+      variance += (*it - mean) * (*it - mean);
+    }
+    double stdev = (iterationTimesSec.size() > 1 ? sqrt(variance / (iterationTimesSec.size() - 1)) : 0.0);
+    std::sort(iterationTimesSec.begin(), iterationTimesSec.end());
+    double median = iterationTimesSec[iterationTimesSec.size() / 2];
+    if (iterationTimesSec.size() % 2 == 0)
+    {
+      median = (median + iterationTimesSec[iterationTimesSec.size() / 2 - 1]) / 2.0;
+    }
+
+    std::ostringstream name;
+    name << benchmark.GetName() << "/threads:" << numberOfThreads;
+    std::cout << std::left << std::setw(48) << name.str() << std::right << std::fixed << std::setprecision(3)
+              << std::setw(12) << mean * 1000.0
+              << std::setw(12) << median * 1000.0
+              << std::setw(12) << stdev * 1000.0
+              << std::setw(12) << numberOfIterations
+              << std::setprecision(1) << std::setw(12) << benchmark.GetNumberOfPixelsPerIteration() / median / 1e6
+              << std::endl;
+    if (median > 0)
+    {
+      metrics.SetMetric(name.str() + "/FramesPerSec", 1.0 / median, PlusPerformanceMetrics::THROUGHPUT);
+    }
+    return PLUS_SUCCESS;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp = false;
+  std::vector<int> frameSize;
+  std::vector<int> outputImageSize;
+  std::vector<int> threadCounts;
+  int workerThreads = 0;
+  double minTimeSec = 0.5;
+  int repetitions = 3;
+  std::string benchmarkFilter;
+  std::string metricsFileName;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help");
+  args.AddArgument("--frame-size", vtksys::CommandLineArguments::MULTI_ARGUMENT, &frameSize, "Number of scan lines and number of samples per scan line of the synthetic frames (default: 128 1024)");
+  args.AddArgument("--output-image-size", vtksys::CommandLineArguments::MULTI_ARGUMENT, &outputImageSize, "Size of the scan converted images, in pixels (default: 820 616)");
+  args.AddArgument("--threads", vtksys::CommandLineArguments::MULTI_ARGUMENT, &threadCounts, "Each benchmark is run with each of these numbers of threads (default: 1 and the number of processor cores)");
+  args.AddArgument("--worker-threads", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &workerThreads, "Number of threads of the shared worker pool, 0 means the number of processor cores (default: 0)");
+  args.AddArgument("--min-time-sec", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &minTimeSec, "Minimum duration of a run, the number of iterations is increased until it is reached (default: 0.5)");
+  args.AddArgument("--repetitions", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &repetitions, "Number of runs of each benchmark (default: 3)");
+  args.AddArgument("--benchmark-filter", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &benchmarkFilter, "Only the benchmarks with names that match this regular expression are run");
+  args.AddArgument("--metrics-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &metricsFileName, "Write the number of frames processed per second by each benchmark to this performance metrics file (.json)");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  BenchmarkOptions options;
+  options.NumberOfScanLines = 128;
+  options.NumberOfSamplesPerScanLine = 1024;
+  options.OutputImageSizePixel[0] = 820;
+  options.OutputImageSizePixel[1] = 616;
+  if (!frameSize.empty())
+  {
+    if (frameSize.size() != 2 || frameSize[0] <= 0 || frameSize[1] <= 0)
+    {
+      LOG_ERROR("--frame-size requires two positive values");
+      exit(EXIT_FAILURE);
+    }
+    options.NumberOfScanLines = frameSize[0];
+    options.NumberOfSamplesPerScanLine = frameSize[1];
+  }
+  if (!outputImageSize.empty())
+  {
+    if (outputImageSize.size() != 2 || outputImageSize[0] <= 0 || outputImageSize[1] <= 0)
+    {
+      LOG_ERROR("--output-image-size requires two positive values");
+      exit(EXIT_FAILURE);
+    }
+    options.OutputImageSizePixel[0] = outputImageSize[0];
+    options.OutputImageSizePixel[1] = outputImageSize[1];
+  }
+  if (threadCounts.empty())
+  {
+    threadCounts.push_back(1);
+    int numberOfCores = vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+    if (numberOfCores > 1)
+    {
+      threadCounts.push_back(numberOfCores);
+    }
+  }
+  if (repetitions < 1)
+  {
+    repetitions = 1;
+  }
+  vtksys::RegularExpression filterExpression(benchmarkFilter.empty() ? "." : benchmarkFilter.c_str());
+
+  // The worker pool is created when it is first used, with the size set in the configuration
+  vtkPlusConfig::GetInstance()->SetWorkerThreads(workerThreads);
+
+  std::vector<std::shared_ptr<ImageProcessingBenchmark> > benchmarks;
+  benchmarks.push_back(std::make_shared<ScanConvertCurvilinearBenchmark>("FLOATING_POINT"));
+  benchmarks.push_back(std::make_shared<ScanConvertCurvilinearBenchmark>("FIXED_POINT"));
+  benchmarks.push_back(std::make_shared<ScanConvertCurvilinearAccumulateBenchmark>());
+  benchmarks.push_back(std::make_shared<ScanConvertLinearBenchmark>());
+  benchmarks.push_back(std::make_shared<RfToBrightnessConvertBenchmark>());
+  benchmarks.push_back(std::make_shared<BoneEnhancerBenchmark<vtkPlusBoneEnhancer> >("BoneEnhancer", false));
+  benchmarks.push_back(std::make_shared<BoneEnhancerBenchmark<vtkPlusBoneEnhancer> >("BoneEnhancer/FusedEdgeDetection", true));
+  benchmarks.push_back(std::make_shared<BoneEnhancerBenchmark<vtkPlusTransverseProcessEnhancer> >("TransverseProcessEnhancer", false));
+#ifdef PLUS_USE_OpenCV
+  benchmarks.push_back(std::make_shared<BoneEnhancerBenchmark<vtkPlusBoneEnhancer> >("BoneEnhancer/Gpu", false, true));
+  benchmarks.push_back(std::make_shared<BoneEnhancerBenchmark<vtkPlusTransverseProcessEnhancer> >("TransverseProcessEnhancer/Gpu", false, true));
+#endif
+#ifdef PLUS_USE_INTEL_MKL
+  benchmarks.push_back(std::make_shared<ForoughiBoneSurfaceProbabilityBenchmark>(false));
+  benchmarks.push_back(std::make_shared<ForoughiBoneSurfaceProbabilityBenchmark>(true));
+#endif
+
+  std::cout << "Frame size: " << options.NumberOfScanLines << " scan lines x " << options.NumberOfSamplesPerScanLine << " samples"
+            << ", output image size: " << options.OutputImageSizePixel[0] << "x" << options.OutputImageSizePixel[1] << " pixels" << std::endl;
+  std::cout << std::left << std::setw(48) << "Benchmark" << std::right
+            << std::setw(12) << "Mean [ms]" << std::setw(12) << "Median [ms]" << std::setw(12) << "Stdev [ms]"
+            << std::setw(12) << "Iterations" << std::setw(12) << "Mpixel/s" << std::endl;
+
+  PlusPerformanceMetrics metrics;
+  int numberOfFailures = 0;
+  for (std::vector<std::shared_ptr<ImageProcessingBenchmark> >::iterator benchmark = benchmarks.begin(); benchmark != benchmarks.end(); ++benchmark)
+  {
+    if (!filterExpression.find((*benchmark)->GetName()))
+    {
+      continue;
+    }
+    for (std::vector<int>::iterator numberOfThreads = threadCounts.begin(); numberOfThreads != threadCounts.end(); ++numberOfThreads)
+    {
+      if (RunBenchmark(**benchmark, options, std::max(1, *numberOfThreads), minTimeSec, repetitions, metrics) != PLUS_SUCCESS)
+      {
+        numberOfFailures++;
+      }
+    }
+  }
+  vtkMultiThreader::SetGlobalMaximumNumberOfThreads(0);
+
+  if (!metricsFileName.empty() && metrics.WriteToFile(metricsFileName) != PLUS_SUCCESS)
+  {
+    numberOfFailures++;
+  }
+
+  return (numberOfFailures == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
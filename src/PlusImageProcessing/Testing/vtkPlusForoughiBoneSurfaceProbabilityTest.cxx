@@ -0,0 +1,144 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+\file vtkPlusForoughiBoneSurfaceProbabilityTest.cxx
+Checks that the multi-threaded bone surface probability computation with separable convolution gives the same
+result as the reference implementation with two-dimensional convolution.
+*/
+
+#include "PlusConfigure.h"
+#include "vtkPlusForoughiBoneSurfaceProbability.h"
+#include <vtkPlusSequenceIO.h>
+
+// VTK includes
+#include <vtkImageCast.h>
+#include <vtkImageData.h>
+#include <vtkSmartPointer.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+// IGSIO includes
+#include <igsioTrackedFrame.h>
+#include <igsioVideoFrame.h>
+#include <vtkIGSIOAccurateTimer.h>
+#include <vtkIGSIOTrackedFrameList.h>
+
+// STL includes
+#include <algorithm>
+#include <cmath>
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp = false;
+  std::string inputFileName;
+  int numberOfFrames = 5;
+  double maxDifferentPixelPercent = 0.1;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help");
+  args.AddArgument("--input-seq-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputFileName, "The filename for the input ultrasound sequence to process.");
+  args.AddArgument("--frames", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfFrames, "Number of frames of the sequence to process (default: 5)");
+  args.AddArgument("--max-different-pixel-percent", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &maxDifferentPixelPercent, "Maximum percentage of the pixels that may differ by more than one intensity level from the reference (default: 0.1)");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (inputFileName.empty())
+  {
+    LOG_ERROR("--input-seq-file required");
+    exit(EXIT_FAILURE);
+  }
+
+  vtkSmartPointer<vtkIGSIOTrackedFrameList> trackedFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+  if (vtkPlusSequenceIO::Read(inputFileName, trackedFrameList) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to read sequence file: " << inputFileName);
+    exit(EXIT_FAILURE);
+  }
+
+  vtkSmartPointer<vtkImageCast> castToDouble = vtkSmartPointer<vtkImageCast>::New();
+  castToDouble->SetOutputScalarTypeToDouble();
+
+  vtkSmartPointer<vtkPlusForoughiBoneSurfaceProbability> referenceFilter = vtkSmartPointer<vtkPlusForoughiBoneSurfaceProbability>::New();
+  referenceFilter->SetInputConnection(castToDouble->GetOutputPort());
+  referenceFilter->UseSeparableConvolutionOff();
+  referenceFilter->SetNumberOfThreads(1);
+
+  vtkSmartPointer<vtkPlusForoughiBoneSurfaceProbability> filter = vtkSmartPointer<vtkPlusForoughiBoneSurfaceProbability>::New();
+  filter->SetInputConnection(castToDouble->GetOutputPort());
+
+  bool success = true;
+  double referenceTimeSec = 0.0;
+  double timeSec = 0.0;
+  numberOfFrames = std::min(numberOfFrames, static_cast<int>(trackedFrameList->GetNumberOfTrackedFrames()));
+  for (int frameIndex = 0; frameIndex < numberOfFrames; frameIndex++)
+  {
+    castToDouble->SetInputData(trackedFrameList->GetTrackedFrame(frameIndex)->GetImageData()->GetImage());
+    castToDouble->Update();
+
+    double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+    referenceFilter->Modified();
+    referenceFilter->Update();
+    referenceTimeSec += vtkIGSIOAccurateTimer::GetSystemTime() - startTime;
+
+    startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+    filter->Modified();
+    filter->Update();
+    timeSec += vtkIGSIOAccurateTimer::GetSystemTime() - startTime;
+
+    vtkImageData* referenceOutput = referenceFilter->GetOutput();
+    vtkImageData* output = filter->GetOutput();
+    const double* referencePixels = static_cast<const double*>(referenceOutput->GetScalarPointer());
+    const double* pixels = static_cast<const double*>(output->GetScalarPointer());
+    const vtkIdType numberOfPixels = referenceOutput->GetNumberOfPoints();
+
+    // Pixels at the threshold may be included or excluded depending on rounding, which changes their value completely
+    double maxDifference = 0.0;
+    vtkIdType numberOfDifferentPixels = 0;
+    for (vtkIdType i = 0; i < numberOfPixels; i++)
+    {
+      const double difference = fabs(pixels[i] - referencePixels[i]);
+      maxDifference = std::max(maxDifference, difference);
+      if (difference > 1.0)
+      {
+        numberOfDifferentPixels++;
+      }
+    }
+    const double differentPixelPercent = 100.0 * numberOfDifferentPixels / std::max<vtkIdType>(numberOfPixels, 1);
+    LOG_INFO("Frame " << frameIndex << ": maximum difference " << maxDifference << ", " << differentPixelPercent << "% of the pixels differ by more than 1");
+    if (differentPixelPercent > maxDifferentPixelPercent)
+    {
+      LOG_ERROR("Bone surface probability of frame " << frameIndex << " differs from the reference in " << differentPixelPercent << "% of the pixels");
+      success = false;
+    }
+  }
+
+  if (numberOfFrames > 0)
+  {
+    LOG_INFO("Average processing time of a frame: " << 1000.0 * timeSec / numberOfFrames << "ms (reference: " << 1000.0 * referenceTimeSec / numberOfFrames << "ms)");
+  }
+
+  if (!success)
+  {
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -8,6 +8,7 @@ See License.txt for details.
 #include "PlusConfigure.h"
 #include "igsioCommon.h"
 #include "PlusMath.h"
+#include "PlusWorkerPool.h"
 #include "igsioTrackedFrame.h"
 #include "igsioVideoFrame.h"
 #include "vtkPlusSequenceIO.h"
@@ -22,6 +23,9 @@ See License.txt for details.
 #include <vtkXMLUtilities.h>
 #include <vtksys/CommandLineArguments.hxx>
 
+// STL includes
+#include <atomic>
+
 namespace
 {
   const float DRAWING_COLOR = 255;
@@ -139,20 +143,29 @@ int main(int argc, char** argv)
   int rfImageExtent[6] = {0, numOfSamplesPerScanline - 1, 0, numOfScanlines - 1, 0, 0};
   scanConverter->SetInputImageExtent(rfImageExtent);
 
-  igsioCommon::PixelLineList lines;
-  for (int scanLine = 0; scanLine < rfImageExtent[3] - rfImageExtent[2] + 1; scanLine++)
+  // The sample positions are computed once, then drawn on the frames in parallel
+  vtkPlusUsScanConvert::ScanLineSamplingTable samplingTable;
+  if (scanConverter->ComputeScanLineSamplingTable(samplingTable) != PLUS_SUCCESS)
   {
-    double start[4] = { 0 };
-    double end[4] = { 0 };
-    scanConverter->GetScanLineEndPoints(scanLine, start, end);
-    igsioCommon::PixelPoint startPoint = { static_cast<int>(std::round(start[0])), static_cast<int>(std::round(start[1])), static_cast<int>(std::round(start[2])) };
-    igsioCommon::PixelPoint endPoint = { static_cast<int>(std::round(end[0])), static_cast<int>(std::round(end[1])), static_cast<int>(std::round(end[2])) };
-    lines.push_back(igsioCommon::PixelLine(startPoint, endPoint));
+    LOG_ERROR("Unable to compute the scanline sample positions");
+    return EXIT_FAILURE;
   }
-
-  if (!lines.empty())
+  std::atomic<bool> failed(false);
+  PlusWorkerPool::GetInstance().ParallelFor(0, trackedFrameList->GetNumberOfTrackedFrames(), 0, [&](int firstFrame, int lastFrame)
   {
-    igsioCommon::DrawScanLines(rfImageExtent, 255, lines, trackedFrameList);
+    for (int frameIndex = firstFrame; frameIndex < lastFrame; frameIndex++)
+    {
+      vtkImageData* image = trackedFrameList->GetTrackedFrame(frameIndex)->GetImageData()->GetImage();
+      if (vtkPlusUsScanConvert::DrawScanLineSamples(samplingTable, DRAWING_COLOR, image) != PLUS_SUCCESS)
+      {
+        failed = true;
+      }
+    }
+  });
+  if (failed)
+  {
+    LOG_ERROR("Unable to draw the scanlines on the images");
+    return EXIT_FAILURE;
   }
 
   // Write the new TrackedFrameList to metafile
@@ -5,6 +5,8 @@ See License.txt for details.
 =========================================================Plus=header=end*/ 
 
 #include "PlusConfigure.h"
+#include "PlusSequencePrefetchReader.h"
+#include "PlusWorkerPool.h"
 #include "igsioVideoFrame.h"
 #include "igsioTrackedFrame.h"
 #include "vtkPlusForoughiBoneSurfaceProbability.h"
@@ -18,6 +20,47 @@ See License.txt for details.
 #include "vtkXMLUtilities.h"
 #include "vtksys/CommandLineArguments.hxx"
 
+// STL includes
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+namespace
+{
+  /*! Filters that replace an image with its bone surface probability. A pipeline can only be updated by one thread at a time. */
+  class BoneSurfacePipeline
+  {
+  public:
+    BoneSurfacePipeline()
+    {
+      this->CastToDouble = vtkSmartPointer<vtkImageCast>::New();
+      this->CastToDouble->SetOutputScalarTypeToDouble();
+
+      this->BoneSurfaceFilter = vtkSmartPointer<vtkPlusForoughiBoneSurfaceProbability>::New();
+      this->BoneSurfaceFilter->SetInputConnection(this->CastToDouble->GetOutputPort());
+
+      this->CastToUnsignedChar = vtkSmartPointer<vtkImageCast>::New();
+      this->CastToUnsignedChar->SetOutputScalarTypeToUnsignedChar();
+      this->CastToUnsignedChar->SetInputConnection(this->BoneSurfaceFilter->GetOutputPort());
+    }
+
+    /*! Replace the image of the frame with the processed output */
+    void ProcessFrame(igsioTrackedFrame& frame)
+    {
+      this->CastToDouble->SetInputData(frame.GetImageData()->GetImage());
+      this->CastToUnsignedChar->Update();
+      frame.GetImageData()->DeepCopyFrom(this->CastToUnsignedChar->GetOutput());
+      // Release the input image
+      this->CastToDouble->SetInputData(NULL);
+    }
+
+  protected:
+    vtkSmartPointer<vtkImageCast> CastToDouble;
+    vtkSmartPointer<vtkPlusForoughiBoneSurfaceProbability> BoneSurfaceFilter;
+    vtkSmartPointer<vtkImageCast> CastToUnsignedChar;
+  };
+}
+
 //----------------------------------------------------------------------------
 int main(int argc, char** argv)
 {
@@ -26,6 +69,7 @@ int main(int argc, char** argv)
   std::string inputImgSeqFileName;
   std::string outputImgSeqFileName;
   std::string inputConfigFileName;
+  int numberOfThreads = 0;
   int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
 
   vtksys::CommandLineArguments args;
@@ -33,6 +77,7 @@ int main(int argc, char** argv)
 
   args.AddArgument("--source-seq-file",vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputImgSeqFileName, "The ultrasound sequence to draw the scanlines on.");
   args.AddArgument("--output-seq-file",vtksys::CommandLineArguments::EQUAL_ARGUMENT, &outputImgSeqFileName, "The output ultrasound sequence with scanlines overlaid on the images.");
+  args.AddArgument("--threads", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfThreads, "Number of frames processed in parallel, each thread uses its own filter pipeline (default: 0 = all threads of the worker pool).");
   args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
   args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
 
@@ -59,37 +104,57 @@ int main(int argc, char** argv)
     exit(EXIT_FAILURE);
   }
 
-  // Read the image sequence
-  vtkSmartPointer<vtkIGSIOTrackedFrameList> trackedFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
-  if( vtkIGSIOSequenceIO::Read(inputImgSeqFileName, trackedFrameList) != PLUS_SUCCESS )
+  if (numberOfThreads < 1)
+  {
+    numberOfThreads = PlusWorkerPool::GetInstance().GetNumberOfThreads() + 1;
+  }
+
+  // Open the image sequence, the next frames are read in the background while frames are processed
+  PlusSequencePrefetchReader reader;
+  reader.SetMaximumNumberOfPrefetchedFrames(std::max<unsigned int>(reader.GetMaximumNumberOfPrefetchedFrames(), 2 * numberOfThreads));
+  if( reader.Open(inputImgSeqFileName) != PLUS_SUCCESS )
   {
     LOG_ERROR("Unable to read sequence file: " << inputImgSeqFileName);
     exit(EXIT_FAILURE);
   }
+  vtkSmartPointer<vtkIGSIOTrackedFrameList> trackedFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+  reader.CopyCustomFields(trackedFrameList);
 
-  vtkSmartPointer<vtkImageCast> castToDouble = vtkSmartPointer<vtkImageCast>::New();
-  castToDouble->SetOutputScalarTypeToDouble();
-
-  vtkSmartPointer<vtkPlusForoughiBoneSurfaceProbability> boneSurfaceFilter = vtkSmartPointer<vtkPlusForoughiBoneSurfaceProbability>::New();
-  boneSurfaceFilter->SetInputConnection(castToDouble->GetOutputPort());
-  
-  vtkSmartPointer<vtkImageCast> castToUnsignedChar = vtkSmartPointer<vtkImageCast>::New();
-  castToUnsignedChar->SetOutputScalarTypeToUnsignedChar();
-  castToUnsignedChar->SetInputConnection(boneSurfaceFilter->GetOutputPort());
-
-  int numberOfFrames = trackedFrameList->GetNumberOfTrackedFrames();
-  LOG_INFO("Processing "<<numberOfFrames<<" frames...");
-  for (int frameIndex = 0; frameIndex < numberOfFrames; frameIndex++)
+  int numberOfFrames = reader.GetNumberOfFrames();
+  std::vector<BoneSurfacePipeline> pipelines(std::max(1, std::min(numberOfThreads, numberOfFrames)));
+  LOG_INFO("Processing "<<numberOfFrames<<" frames in "<<pipelines.size()<<" thread(s)...");
+  std::vector<std::shared_ptr<igsioTrackedFrame> > frames;
+  int frameIndex = 0;
+  while (frameIndex < numberOfFrames)
   {
-    TrackedFrame* frame = trackedFrameList->GetTrackedFrame(frameIndex);
-    vtkImageData* imageData = frame->GetImageData()->GetImage();
-
-    castToDouble->SetInputData(imageData);
-    castToUnsignedChar->Update();
+    // Frames are read in order, then each pipeline processes one of them in parallel
+    frames.clear();
+    for (; frameIndex < numberOfFrames && frames.size() < pipelines.size(); frameIndex++)
+    {
+      std::shared_ptr<igsioTrackedFrame> frame = reader.ReadNextFrame();
+      if (frame == NULL)
+      {
+        LOG_ERROR("Unable to read frame " << frameIndex << " of sequence file: " << inputImgSeqFileName);
+        exit(EXIT_FAILURE);
+      }
+      frames.push_back(frame);
+    }
+    const int numberOfFramesToProcess = static_cast<int>(frames.size());
+    PlusWorkerPool::GetInstance().ParallelFor(0, numberOfFramesToProcess, numberOfFramesToProcess, [&](int firstFrame, int lastFrame)
+    {
+      for (int i = firstFrame; i < lastFrame; i++)
+      {
+        pipelines[i].ProcessFrame(*frames[i]);
+      }
+    });
 
-    // Write back the processed output to the input trackedframelist
-    frame->GetImageData()->DeepCopyFrom(castToUnsignedChar->GetOutput());
+    // Add the processed frames to the output trackedframelist, in order
+    for (std::vector<std::shared_ptr<igsioTrackedFrame> >::iterator frame = frames.begin(); frame != frames.end(); ++frame)
+    {
+      trackedFrameList->AddTrackedFrame(frame->get());
+    }
   }
+  reader.Close();
 
   // Write the new TrackedFrameList to metafile
   LOG_INFO("Writing new sequence to file...");
@@ -1,4 +1,5 @@
 #include "PlusConfigure.h"
+#include "PlusWorkerPool.h"
 #include "igsioTrackedFrame.h"
 #include "vtkImageCast.h"
 #include "vtkImageData.h"
@@ -13,6 +14,9 @@
 
 #include "string"
 
+#include <algorithm>
+#include <vector>
+
 int main(int argc, char **argv)
 {
   bool printHelp = false;
@@ -22,6 +26,7 @@ int main(int argc, char **argv)
   std::string outputFileName;
   std::string configFileName;
   bool saveIntermediateResults = false;
+  int numberOfThreads = 0;
   int verboseLevel=vtkPlusLogger::LOG_LEVEL_UNDEFINED;
 
   args.Initialize(argc, argv);
@@ -30,6 +35,7 @@ int main(int argc, char **argv)
   args.AddArgument("--config-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &configFileName, "The filename for input config file.");
   args.AddArgument("--output-seq-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &outputFileName, "The filename to write the processed sequence to.");
   args.AddArgument("--save-intermediate-images", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &saveIntermediateResults, "If intermediate images should be saved to output files");
+  args.AddArgument("--threads", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfThreads, "Number of frames processed in parallel, each thread uses its own copy of the processor (default: 0 = all threads of the worker pool).");
   args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
 
   if (!args.Parse())
@@ -117,11 +123,38 @@ int main(int argc, char **argv)
   // Bone filter.
   
   vtkSmartPointer<vtkPlusTransverseProcessEnhancer> boneFilter = vtkSmartPointer<vtkPlusTransverseProcessEnhancer>::New();
-  
-  boneFilter->SetInputFrames(trackedFrameList);
-  boneFilter->ReadConfiguration(processorElement);
+  if (boneFilter->ReadConfiguration(processorElement) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to read the configuration of the processor");
+    return EXIT_FAILURE;
+  }
+
+  // Frames are independent, each thread processes a range of frames with its own copy of the processor
+  if (numberOfThreads < 1)
+  {
+    numberOfThreads = PlusWorkerPool::GetInstance().GetNumberOfThreads() + 1;
+  }
+  if (numberOfThreads > 1 && (saveIntermediateResults || boneFilter->GetSaveIntermediateResults()))
+  {
+    // The intermediate images of all frames are collected by one processor
+    LOG_INFO("Intermediate results are saved, frames are processed by one thread");
+    numberOfThreads = 1;
+  }
+  std::vector<vtkSmartPointer<vtkPlusTrackedFrameProcessor> > processors(1, boneFilter.GetPointer());
+  for (int i = 1; i < std::min(numberOfThreads, numberOfFrames); ++i)
+  {
+    vtkSmartPointer<vtkPlusTransverseProcessEnhancer> processor = vtkSmartPointer<vtkPlusTransverseProcessEnhancer>::New();
+    if (processor->ReadConfiguration(processorElement) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to read the configuration of the processor");
+      return EXIT_FAILURE;
+    }
+    processors.push_back(processor.GetPointer());
+  }
+  LOG_INFO("Processing frames in " << processors.size() << " thread(s)");
 
-  PlusStatus filterStatus = boneFilter->Update();
+  vtkSmartPointer<vtkIGSIOTrackedFrameList> outputFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+  PlusStatus filterStatus = vtkPlusTrackedFrameProcessor::ProcessTrackedFrameList(processors, trackedFrameList, outputFrameList);
   if (filterStatus != PlusStatus::PLUS_SUCCESS)
   {
     LOG_ERROR("Failed processing frames");
@@ -158,7 +191,7 @@ int main(int argc, char **argv)
     boneFilter->SaveAllIntermediateResultsToFile();
   }
 
-  if (vtkPlusSequenceIO::Write(outputFileName.c_str(), boneFilter->GetOutputFrames())== PLUS_FAIL)
+  if (vtkPlusSequenceIO::Write(outputFileName.c_str(), outputFrameList)== PLUS_FAIL)
   {
     LOG_ERROR("Could not save output sequence to the file: " << outputFileName);
     return EXIT_FAILURE;
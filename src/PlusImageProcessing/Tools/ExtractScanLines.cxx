@@ -13,39 +13,6 @@
 #include "vtksys/CommandLineArguments.hxx"
 
 
-void extractScanLines(vtkPlusUsScanConvert* scanConverter, vtkImageData* inputImageData, vtkImageData* outputImageData)
-{
-  int* linesImageExtent = scanConverter->GetInputImageExtent();
-  int lineLengthPx = linesImageExtent[1] - linesImageExtent[0] + 1;
-  int numScanLines = linesImageExtent[3] - linesImageExtent[2] + 1;
-
-  float inputPixelValue = 0.0;
-
-  int* inputExtent = inputImageData->GetExtent();
-  for (int scanLine = 0; scanLine < numScanLines; scanLine ++ )
-  {
-    double start[4] = {0};
-    double end[4] = {0};
-    scanConverter->GetScanLineEndPoints(scanLine, start, end);
-
-    double directionVectorX = static_cast<double>(end[0]-start[0])/(lineLengthPx-1);
-    double directionVectorY = static_cast<double>(end[1]-start[1])/(lineLengthPx-1);
-    for (int pointIndex=0; pointIndex<lineLengthPx; ++pointIndex)
-    {
-      int pixelCoordX = start[0] + directionVectorX * pointIndex;
-      int pixelCoordY = start[1] + directionVectorY * pointIndex;
-      if ( pixelCoordX<inputExtent[0] ||  pixelCoordX>inputExtent[1] || pixelCoordY<inputExtent[2] ||  pixelCoordY>inputExtent[3] )
-      {
-        outputImageData->SetScalarComponentFromFloat(pointIndex, scanLine, 0, 0, 0);
-        continue; // outside of the specified extent
-      }
-      inputPixelValue = inputImageData->GetScalarComponentAsFloat(pixelCoordX, pixelCoordY, 0, 0);
-      outputImageData->SetScalarComponentFromFloat(pointIndex, scanLine, 0, 0, inputPixelValue);
-    }
-  }
-}
-
-
 int main(int argc, char** argv)
 {
   bool printHelp = false;
@@ -157,32 +124,18 @@ int main(int argc, char** argv)
 
   vtkSmartPointer<vtkIGSIOTrackedFrameList> inputFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
   vtkPlusSequenceIO::Read(inputFileName.c_str(), inputFrameList);
-  int numberOfFrames = inputFrameList->GetNumberOfTrackedFrames();
 
-  // Create lines image (this is the image which holds scan lines in rows).
+  // Lines image extent (the lines image holds scan lines in rows).
 
   int linesImageExtent[6]= {0, numberOfSamplesPerScanLine-1, 0, numberOfScanLines-1, 0, 0};
   scanConverter->SetInputImageExtent(linesImageExtent);
 
-  vtkSmartPointer<vtkImageData> linesImage = vtkSmartPointer<vtkImageData>::New();
-  linesImage->SetExtent(linesImageExtent);
-  linesImage->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
-
-  // Create frame lists for lines images and output images.
+  // Extract scan lines from all frames. The sampling positions are computed once and the frames are processed in parallel.
   vtkSmartPointer<vtkIGSIOTrackedFrameList> linesFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
-  vtkSmartPointer<vtkIGSIOTrackedFrameList> outputFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
-
-  // Iterate thought every frame.
-  for (int frameIndex = 0; frameIndex < numberOfFrames; frameIndex ++ )
+  if (scanConverter->ExtractScanLinesTrackedFrameList(inputFrameList, linesFrameList) != PLUS_SUCCESS)
   {
-    igsioTrackedFrame* inputFrame = inputFrameList->GetTrackedFrame(frameIndex);
-
-    linesFrameList->AddTrackedFrame(inputFrame);
-    igsioTrackedFrame* linesFrame = linesFrameList->GetTrackedFrame(linesFrameList->GetNumberOfTrackedFrames()-1);
-    linesFrame->GetImageData()->DeepCopyFrom(linesImage);  // Would there be a more efficient way to create this tracked frame?
-
-    // Extract scan lines from image.
-    extractScanLines(scanConverter, inputFrame->GetImageData()->GetImage(), linesFrame->GetImageData()->GetImage() );
+    LOG_ERROR("Failed to extract scan lines from " << inputFileName);
+    return EXIT_FAILURE;
   }
 
   std::cout << "Writing output to file. Setting log level to 1, regardless of user specified verbose level." << std::endl;
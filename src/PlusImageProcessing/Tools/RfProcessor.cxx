@@ -8,6 +8,7 @@ See License.txt for details.
 #include "igsioTrackedFrame.h"
 #include "vtkImageData.h" 
 #include "vtkPlusRfProcessor.h"
+#include "vtkPlusRfToBrightnessConvert.h"
 #include "vtkPlusSequenceIO.h"
 #include "vtkSmartPointer.h"
 #include "vtkIGSIOTrackedFrameList.h"
@@ -15,6 +16,7 @@ See License.txt for details.
 #include "vtkXMLUtilities.h"
 #include "vtksys/CommandLineArguments.hxx"
 #include "vtksys/SystemTools.hxx"
+#include <algorithm>
 #include <iomanip>
 #include <iostream>
 
@@ -140,6 +142,8 @@ int main(int argc, char **argv)
     }
 
     // Process the frames
+    double totalBrightnessConversionTimeSec = 0.0;
+    double maximumBrightnessConversionTimeSec = 0.0;
     for (unsigned int j = 0; j < frameList->GetNumberOfTrackedFrames(); j++)
     {
       igsioTrackedFrame* rfFrame = frameList->GetTrackedFrame(j);
@@ -169,6 +173,23 @@ int main(int argc, char **argv)
         LOG_ERROR("Unknown operation: "<<operation);
         exit(EXIT_FAILURE);
       }
+
+      double brightnessConversionTimeSec = rfProcessor->GetRfToBrightnessConverter()->GetLastProcessingTimeSec();
+      totalBrightnessConversionTimeSec += brightnessConversionTimeSec;
+      maximumBrightnessConversionTimeSec = std::max(maximumBrightnessConversionTimeSec, brightnessConversionTimeSec);
+    }
+
+    // Compare the conversion time to the acquisition frame period to see if the conversion could keep up with live acquisition
+    unsigned int numberOfFrames = frameList->GetNumberOfTrackedFrames();
+    if (numberOfFrames > 0)
+    {
+      LOG_INFO("RF to brightness conversion time per frame: average " << totalBrightnessConversionTimeSec * 1000.0 / numberOfFrames
+               << "ms, maximum " << maximumBrightnessConversionTimeSec * 1000.0 << "ms");
+    }
+    if (numberOfFrames > 1)
+    {
+      double framePeriodSec = (frameList->GetTrackedFrame(numberOfFrames - 1)->GetTimestamp() - frameList->GetTrackedFrame(0)->GetTimestamp()) / (numberOfFrames - 1);
+      LOG_INFO("Average acquisition frame period: " << framePeriodSec * 1000.0 << "ms");
     }
 
     std::ostringstream ss;
@@ -7,6 +7,64 @@
 #include "vtkPlusUsScanConvertCurvilinear.h"
 #include "vtkPlusUsScanConvertLinear.h"
 #include "vtkPlusSequenceIO.h"
+#include "vtkIGSIOAccurateTimer.h"
+#include "vtkImageData.h"
+
+#include <algorithm>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  /*! Scan convert the input image with both interpolation kernels and print the average conversion time and the largest difference */
+  void BenchmarkInterpolationKernels(vtkPlusUsScanConvertCurvilinear* scanConverter, vtkImageData* inputImage, int numberOfRepetitions)
+  {
+    vtkPlusUsScanConvertCurvilinear::InterpolationKernelType originalKernel = scanConverter->GetInterpolationKernel();
+    scanConverter->SetInputData(inputImage);
+
+    vtkPlusUsScanConvertCurvilinear::InterpolationKernelType kernels[2] =
+    {
+      vtkPlusUsScanConvertCurvilinear::INTERPOLATION_KERNEL_FLOATING_POINT,
+      vtkPlusUsScanConvertCurvilinear::INTERPOLATION_KERNEL_FIXED_POINT
+    };
+    const char* kernelNames[2] = { "floating point", "fixed point" };
+    vtkSmartPointer<vtkImageData> outputImages[2];
+    for (int kernelIndex = 0; kernelIndex < 2; kernelIndex++)
+    {
+      scanConverter->SetInterpolationKernel(kernels[kernelIndex]);
+      // The first conversion computes the interpolation table, it is not included in the conversion time
+      scanConverter->Update();
+      double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+      for (int i = 0; i < numberOfRepetitions; i++)
+      {
+        scanConverter->Modified();
+        scanConverter->Update();
+      }
+      double conversionTimeMs = (vtkIGSIOAccurateTimer::GetSystemTime() - startTime) * 1000.0 / numberOfRepetitions;
+      LOG_INFO("Scan conversion time with " << kernelNames[kernelIndex] << " kernel: " << conversionTimeMs << "ms");
+      outputImages[kernelIndex] = vtkSmartPointer<vtkImageData>::New();
+      outputImages[kernelIndex]->DeepCopy(scanConverter->GetOutput());
+    }
+
+    if (inputImage->GetScalarType() != VTK_UNSIGNED_CHAR)
+    {
+      LOG_INFO("The fixed point kernel only supports 8-bit images, the floating point kernel was used for both measurements");
+    }
+    else
+    {
+      const unsigned char* floatingPointPixels = static_cast<unsigned char*>(outputImages[0]->GetScalarPointer());
+      const unsigned char* fixedPointPixels = static_cast<unsigned char*>(outputImages[1]->GetScalarPointer());
+      vtkIdType numberOfPixels = outputImages[0]->GetNumberOfPoints() * outputImages[0]->GetNumberOfScalarComponents();
+      int maximumDifference = 0;
+      for (vtkIdType i = 0; i < numberOfPixels; i++)
+      {
+        maximumDifference = std::max(maximumDifference, abs(floatingPointPixels[i] - fixedPointPixels[i]));
+      }
+      LOG_INFO("Largest pixel value difference between the kernels: " << maximumDifference);
+    }
+
+    scanConverter->SetInterpolationKernel(originalKernel);
+  }
+}
 
 int main(int argc, char **argv)
 {
@@ -17,12 +75,16 @@ int main(int argc, char **argv)
   std::string outputFileName;
   std::string configFileName;
   int verboseLevel=vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+  int benchmarkRepetitions=0;
+  int numberOfThreads=0;
 
   args.Initialize(argc, argv);
   args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help");
   args.AddArgument("--input-seq-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputFileName, "The filename for the input ultrasound sequence to process.");
   args.AddArgument("--config-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &configFileName, "The filename for input config file.");
   args.AddArgument("--output-seq-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &outputFileName, "The filename to write the processed sequence to.");
+  args.AddArgument("--benchmark-repetitions", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &benchmarkRepetitions, "Measure the conversion time of the first frame with the floating point and fixed point interpolation kernels of curvilinear scan conversion, averaged over this many repetitions (default: 0 = no measurement).");
+  args.AddArgument("--threads", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfThreads, "Number of frames scan converted in parallel (default: 0 = all threads of the worker pool).");
   args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
 
   if (!args.Parse())
@@ -104,25 +166,34 @@ int main(int argc, char **argv)
   vtkSmartPointer<vtkIGSIOTrackedFrameList> inputFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
   vtkPlusSequenceIO::Read(inputFileName.c_str(), inputFrameList);
   int numberOfFrames = inputFrameList->GetNumberOfTrackedFrames();
+
+  if (benchmarkRepetitions > 0)
+  {
+    vtkPlusUsScanConvertCurvilinear* curvilinearScanConverter = vtkPlusUsScanConvertCurvilinear::SafeDownCast(scanConverter);
+    if (curvilinearScanConverter == NULL)
+    {
+      LOG_WARNING("Interpolation kernel benchmark is only available for curvilinear scan conversion");
+    }
+    else if (numberOfFrames < 1)
+    {
+      LOG_WARNING("Interpolation kernel benchmark is skipped, because the input sequence is empty");
+    }
+    else
+    {
+      BenchmarkInterpolationKernels(curvilinearScanConverter, inputFrameList->GetTrackedFrame(0)->GetImageData()->GetImage(), benchmarkRepetitions);
+    }
+  }
   
   // Create output frame list.
 
   vtkSmartPointer<vtkIGSIOTrackedFrameList> outputFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
 
-  // Iterate thought every frame.
+  // Scan convert all frames.
 
-  for (int frameIndex = 0; frameIndex < numberOfFrames; frameIndex ++ )
+  if (scanConverter->ScanConvertTrackedFrameList(inputFrameList, outputFrameList, numberOfThreads) != PLUS_SUCCESS)
   {
-    igsioTrackedFrame* inputFrame = inputFrameList->GetTrackedFrame(frameIndex);
-    
-    scanConverter->SetInputData( inputFrame->GetImageData()->GetImage() );
-    scanConverter->Update();
-    
-    // Allocate and store output image.
-
-    outputFrameList->AddTrackedFrame(inputFrame);
-    igsioTrackedFrame* outputFrame = outputFrameList->GetTrackedFrame(outputFrameList->GetNumberOfTrackedFrames()-1);
-    outputFrame->GetImageData()->DeepCopyFrom(scanConverter->GetOutput());
+    LOG_ERROR("Failed to scan convert the input sequence");
+    return EXIT_FAILURE;
   }
 
   std::cout << "Writing output to file. Setting log level to error only, regardless of user specified verbose level." << std::endl;
@@ -6,7 +6,9 @@ See License.txt for details.
 
 // Local includes
 #include "PlusConfigure.h"
+#include "PlusProfiler.h"
 #include "PlusMath.h"
+#include "PlusWorkerPool.h"
 #include "vtkPlusBoneEnhancer.h"
 #include "vtkPlusUsScanConvertCurvilinear.h"
 #include "vtkPlusUsScanConvertLinear.h"
@@ -19,14 +21,204 @@ See License.txt for details.
 #include <vtkImageSobel2D.h>
 #include <vtkImageThreshold.h>
 #include <vtkObjectFactory.h>
+#include <vtkPointData.h>
 #include "vtkImageAlgorithm.h"
 
 #include <igsioTrackedFrame.h>
 #include <igsioVideoFrame.h>
 #include <vtkIGSIOTrackedFrameList.h>
 
+#ifdef PLUS_USE_OpenCV
+// OpenCV includes
+#include <opencv2/core.hpp>
+#include <opencv2/core/ocl.hpp>
+#include <opencv2/imgproc.hpp>
+#endif
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+  /*! Number of scan lines that are filtered together by the fused filter, so that the rows stay in the cache between the steps */
+  const int FUSED_FILTER_BLOCK_SIZE = 16;
+
+  /*! Number of samples at the start of the scan lines (fat too close to the transducer) that are ignored by the standard deviation threshold */
+  const int THRESHOLD_FAT_LAYER_PX = 20;
+
+  //----------------------------------------------------------------------------
+  /*! Threshold of a scan line for ThresholdViaStdDeviation, from the statistics of the samples after the fat layer */
+  float ComputeScanLineThreshold(int max, int pixelSum, int squearSum, int numberOfPixels)
+  {
+    float pixelAverage = pixelSum / numberOfPixels;
+
+    //determine the standard deviation of the row
+    float meanDiffSum = squearSum + numberOfPixels * pixelAverage * pixelAverage + (-2 * pixelAverage * pixelSum);
+    float meanDiffAverage = meanDiffSum / numberOfPixels;
+    return max - 3 * pow(meanDiffAverage, 0.5f);
+  }
+
+  /*! Gaussian kernel along one axis, truncated and renormalized where it hits the image boundary (as in vtkImageGaussianSmooth) */
+  struct GaussianKernel
+  {
+    int Radius;
+    std::vector<double> Weights;
+    /*! Inverse of the sum of the weights that are inside the image, for each position along the axis */
+    std::vector<double> InverseSums;
+
+    void Compute(double standardDeviation, double radiusFactor, int size)
+    {
+      this->Radius = static_cast<int>(standardDeviation * radiusFactor);
+      this->Weights.resize(2 * this->Radius + 1);
+      for (int i = -this->Radius; i <= this->Radius; ++i)
+      {
+        this->Weights[i + this->Radius] = (standardDeviation > 0.0) ? exp(-0.5 * i * i / (standardDeviation * standardDeviation)) : 1.0;
+      }
+      this->InverseSums.resize(size);
+      for (int position = 0; position < size; ++position)
+      {
+        double sum = 0.0;
+        for (int k = this->GetFirstOffset(position); k <= this->GetLastOffset(position, size); ++k)
+        {
+          sum += this->Weights[k + this->Radius];
+        }
+        this->InverseSums[position] = 1.0 / sum;
+      }
+    }
+
+    int GetFirstOffset(int position) const { return std::max(-this->Radius, -position); }
+    int GetLastOffset(int position, int size) const { return std::min(this->Radius, size - 1 - position); }
+  };
+
+  //----------------------------------------------------------------------------
+  /*!
+    Smooth the rows [firstRow, lastRow) of the image into output. The kernel is applied across the scan lines first,
+    then along the scan lines, and the result of each pass is truncated to unsigned char as in vtkImageGaussianSmooth.
+  */
+  void SmoothRows(const unsigned char* input, int width, int height, int firstRow, int lastRow,
+                  const GaussianKernel& kernelX, const GaussianKernel& kernelY,
+                  std::vector<double>& accumulator, std::vector<unsigned char>& verticalRow, unsigned char* output)
+  {
+    accumulator.resize(width);
+    verticalRow.resize(width);
+    for (int y = firstRow; y < lastRow; ++y)
+    {
+      std::fill(accumulator.begin(), accumulator.end(), 0.0);
+      for (int k = kernelY.GetFirstOffset(y); k <= kernelY.GetLastOffset(y, height); ++k)
+      {
+        const double weight = kernelY.Weights[k + kernelY.Radius] * kernelY.InverseSums[y];
+        const unsigned char* inputRow = input + static_cast<size_t>(y + k) * width;
+        for (int x = 0; x < width; ++x)
+        {
+          accumulator[x] += weight * inputRow[x];
+        }
+      }
+      for (int x = 0; x < width; ++x)
+      {
+        verticalRow[x] = static_cast<unsigned char>(accumulator[x]);
+      }
+
+      unsigned char* outputRow = output + static_cast<size_t>(y - firstRow) * width;
+      for (int x = 0; x < width; ++x)
+      {
+        const int lastOffset = kernelX.GetLastOffset(x, width);
+        const double* weights = &kernelX.Weights[kernelX.Radius];
+        const unsigned char* inputPixel = &verticalRow[x];
+        double sum = 0.0;
+        for (int k = kernelX.GetFirstOffset(x); k <= lastOffset; ++k)
+        {
+          sum += weights[k] * inputPixel[k];
+        }
+        outputRow[x] = static_cast<unsigned char>(sum * kernelX.InverseSums[x]);
+      }
+    }
+  }
+
+#ifdef PLUS_USE_OpenCV
+  /*!
+    OpenCV converts floating point values to integers by rounding. Subtracting this offset before the conversion truncates
+    non-negative values, as the casts in the VTK filters do, except for values that are less than 0.001 below an integer.
+  */
+  const double TRUNCATION_OFFSET = 0.499;
+
+  //----------------------------------------------------------------------------
+  /*! OpenCV matrix header for the pixels of a single component unsigned char image, rows are along the second axis */
+  cv::Mat GetImageMat(vtkImageData* image)
+  {
+    int dims[3] = { 0, 0, 0 };
+    image->GetDimensions(dims);
+    return cv::Mat(dims[1], dims[0], CV_8UC1, image->GetScalarPointer());
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Truncate the gradient towards zero and wrap it to unsigned char (CV_32S output), as the casts in VectorImageToUchar */
+  void GradientToUchar(const cv::UMat& gradient, cv::UMat& magnitude, cv::UMat& positivePart, cv::UMat& negativePart, cv::UMat& output)
+  {
+    cv::max(gradient, 0.0, magnitude);
+    magnitude.convertTo(positivePart, CV_32S, 1.0, -TRUNCATION_OFFSET);
+    cv::subtract(cv::Scalar::all(0.0), gradient, magnitude);
+    cv::max(magnitude, 0.0, magnitude);
+    magnitude.convertTo(negativePart, CV_32S, 1.0, -TRUNCATION_OFFSET);
+    cv::subtract(positivePart, negativePart, output);
+    // The lowest byte of the two's complement value, as static_cast<unsigned char>
+    cv::bitwise_and(output, cv::Scalar::all(255), output);
+  }
+#endif
+}
+
+//----------------------------------------------------------------------------
+class vtkPlusBoneEnhancer::vtkInternal
+{
+public:
+  vtkInternal()
+    : GpuLinesImageMTime(0)
+  {
+#ifdef PLUS_USE_OpenCV
+    std::fill(this->SamplingInputExtent, this->SamplingInputExtent + 6, 0);
+    std::fill(this->SamplingLinesExtent, this->SamplingLinesExtent + 6, 0);
+    std::fill(this->SmoothingParameters, this->SmoothingParameters + 6, 0.0);
+#endif
+  }
+
+  /*! Modification time of the work image when the lines image on the GPU was copied into it, 0 if there is no valid lines image on the GPU */
+  vtkMTimeType GpuLinesImageMTime;
+
+#ifdef PLUS_USE_OpenCV
+  /*! Extents of the input image and the lines image that the sampling maps are computed for */
+  int SamplingInputExtent[6];
+  int SamplingLinesExtent[6];
+  /*! Input image pixel of each lines image pixel, -1 for the samples outside of the input image */
+  cv::UMat SamplingMapX;
+  cv::UMat SamplingMapY;
+
+  /*! Lines image size, standard deviations and radius factors that the smoothing kernels are computed for */
+  double SmoothingParameters[6];
+  cv::Mat SmoothingKernelX;
+  cv::Mat SmoothingKernelY;
+  cv::Mat IdentityKernel;
+  /*! Inverse of the sum of the kernel weights inside the image for each pixel, to renormalize at the boundary as vtkImageGaussianSmooth */
+  cv::UMat SmoothingNormalizationX;
+  cv::UMat SmoothingNormalizationY;
+
+  cv::UMat InputImage;
+  cv::UMat LinesImage;
+  cv::UMat SquaredImage;
+  cv::UMat Thresholds;
+  cv::UMat Mask;
+  cv::UMat OutsideMask;
+  cv::UMat FloatImage;
+  cv::UMat SmoothedImage;
+  cv::UMat GradientX;
+  cv::UMat GradientY;
+  cv::UMat PositivePart;
+  cv::UMat NegativePart;
+  cv::UMat EdgeX;
+  cv::UMat EdgeY;
+  cv::UMat Edges;
+#endif
+};
 
 //----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkPlusBoneEnhancer);
@@ -57,10 +249,16 @@ vtkPlusBoneEnhancer::vtkPlusBoneEnhancer()
 
   LinesImage(NULL),
   ProcessedLinesImage(NULL),
+  WorkImage(NULL),
+  FanImage(NULL),
   FirstFrame(true),
 
-  SaveIntermediateResults(false)
+  SaveIntermediateResults(false),
+  UseFusedEdgeDetection(false),
+  UseGpu(false),
+  MaximumNumberOfIntermediateFrames(100)
 {
+  this->Internal = new vtkInternal;
 
   this->GaussianSmooth = vtkSmartPointer<vtkImageGaussianSmooth>::New();    // Used to smooth the image
   this->EdgeDetector = vtkSmartPointer<vtkImageSobel2D>::New();             // Used to outline edges of the image
@@ -104,6 +302,9 @@ vtkPlusBoneEnhancer::vtkPlusBoneEnhancer()
   this->LinesImage->SetExtent(0, 0, 0, 0, 0, 0);
   this->ProcessedLinesImage->SetExtent(0, 0, 0, 0, 0, 0);
 
+  this->WorkImage = vtkSmartPointer<vtkImageData>::New();
+  this->FanImage = vtkSmartPointer<vtkImageData>::New();
+
   this->IntermediateImageMap.clear();
 }
 
@@ -112,7 +313,11 @@ vtkPlusBoneEnhancer::~vtkPlusBoneEnhancer()
 {
   // Make sure contained smart pointers are deleted
   this->IntermediateImageMap.clear();
+  this->IntermediateFilterOutputs.clear();
   this->IntermediatePostfixes.clear();
+
+  delete this->Internal;
+  this->Internal = NULL;
 }
 
 //----------------------------------------------------------------------------
@@ -172,6 +377,24 @@ PlusStatus vtkPlusBoneEnhancer::ReadConfiguration(vtkSmartPointer<vtkXMLDataElem
   vtkXMLDataElement* imageProcessingOperations = processingElement->FindNestedElementWithName("ImageProcessingOperations");
   if (imageProcessingOperations != NULL)
   {
+    XML_READ_BOOL_ATTRIBUTE_OPTIONAL(UseFusedEdgeDetection, imageProcessingOperations);
+    XML_READ_BOOL_ATTRIBUTE_OPTIONAL(UseGpu, imageProcessingOperations);
+#ifdef PLUS_USE_OpenCV
+    if (this->UseGpu)
+    {
+      cv::ocl::setUseOpenCL(true);
+      if (!cv::ocl::useOpenCL())
+      {
+        LOG_INFO("OpenCL is not available, the GPU image processing operations are computed by OpenCV on the CPU");
+      }
+    }
+#else
+    if (this->UseGpu)
+    {
+      LOG_WARNING("UseGpu requires Plus to be built with PLUS_USE_OpenCV. The image processing operations are computed on the CPU.");
+      this->UseGpu = false;
+    }
+#endif
 
     // Read SaveIntermediateResults tag
     vtkSmartPointer<vtkXMLDataElement> saveIntermediateResultsBool = imageProcessingOperations->FindNestedElementWithName("SaveIntermediateResults");
@@ -182,6 +405,7 @@ PlusStatus vtkPlusBoneEnhancer::ReadConfiguration(vtkSmartPointer<vtkXMLDataElem
     else
     {
       XML_READ_BOOL_ATTRIBUTE_OPTIONAL(SaveIntermediateResults, saveIntermediateResultsBool);
+      XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, MaximumNumberOfIntermediateFrames, saveIntermediateResultsBool);
     }
     
     // Read tags related to the Gaussian filter
@@ -266,9 +490,12 @@ PlusStatus vtkPlusBoneEnhancer::WriteConfiguration(vtkSmartPointer<vtkXMLDataEle
 
   //Write the parameters for filters to the output config file
   XML_FIND_NESTED_ELEMENT_CREATE_IF_MISSING(imageProcessingOperations, processingElement, "ImageProcessingOperations");
+  XML_WRITE_BOOL_ATTRIBUTE(UseFusedEdgeDetection, imageProcessingOperations);
+  XML_WRITE_BOOL_ATTRIBUTE(UseGpu, imageProcessingOperations);
 
   XML_FIND_NESTED_ELEMENT_CREATE_IF_MISSING(saveIntermediateResultsBool, imageProcessingOperations, "SaveIntermediateResults");
   XML_WRITE_BOOL_ATTRIBUTE(SaveIntermediateResults, saveIntermediateResultsBool)
+  saveIntermediateResultsBool->SetIntAttribute("MaximumNumberOfIntermediateFrames", this->MaximumNumberOfIntermediateFrames);
 
   XML_FIND_NESTED_ELEMENT_CREATE_IF_MISSING(gaussianParameters, imageProcessingOperations, "GaussianSmoothing");
   gaussianParameters->SetDoubleAttribute("GaussianStdDev", this->GaussianStdDev);
@@ -303,6 +530,14 @@ PlusStatus vtkPlusBoneEnhancer::ProcessImageExtents()
   this->LinesImage->SetExtent(linesImageExtent);
   this->LinesImage->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
 
+  // Images that are reused in every frame, so that no allocation is needed while processing
+  this->ConversionImage->SetExtent(linesImageExtent);
+  this->ConversionImage->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+  this->ProcessedLinesImage->SetExtent(linesImageExtent);
+  this->ProcessedLinesImage->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+  this->WorkImage->SetExtent(linesImageExtent);
+  this->WorkImage->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+
   //Set up variables related to image extents
   int dims[3] = { 0, 0, 0 };
   this->LinesImage->GetDimensions(dims);
@@ -374,8 +609,12 @@ void vtkPlusBoneEnhancer::VectorImageToUchar(vtkSmartPointer<vtkImageData> input
 
   int dims[3] = { 0, 0, 0 };
   this->LinesImage->GetDimensions(dims);
-  this->ConversionImage->SetExtent(this->LinesImage->GetExtent());
-  this->ConversionImage->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+  int* linesExtent = this->LinesImage->GetExtent();
+  if (!std::equal(linesExtent, linesExtent + 6, this->ConversionImage->GetExtent()) || this->ConversionImage->GetPointData()->GetScalars() == NULL)
+  {
+    this->ConversionImage->SetExtent(linesExtent);
+    this->ConversionImage->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+  }
   for (int y = dims[1] - 1; y >= 0; --y)
   {
     // Initialize variables for a new scan line.
@@ -401,15 +640,59 @@ void vtkPlusBoneEnhancer::MarkShadowOutline(vtkSmartPointer<vtkImageData> inputI
 {
   int dims[3] = { 0, 0, 0 };
   inputImage->GetDimensions(dims);
+  if (dims[0] < 1 || dims[1] < 1)
+  {
+    return;
+  }
 
-  int keepInfoCounter;
-  bool foundBone;
-  unsigned char* vOutput;
+  // Scan lines are independent of each other when the outline is marked, they are processed in parallel.
+  // The x coordinate of the first bone pixel of each scan line is recorded for grouping the outline into bone areas.
+  this->FirstBonePixelPositions.resize(dims[1]);
+  unsigned char* pixels = static_cast<unsigned char*>(inputImage->GetScalarPointer());
+  const int boneOutlineDepthPx = this->BoneOutlineDepthPx;
+  const int keepInfoCounterStart = this->BoneOutlineDepthPx + this->BonePushBackPx;
+  PlusWorkerPool::GetInstance().ParallelFor(0, dims[1], 0, [&](int firstRow, int lastRow)
+  {
+    for (int y = firstRow; y < lastRow; ++y)
+    {
+      unsigned char* row = pixels + static_cast<size_t>(y) * dims[0];
 
-  int lastVistedValue = 0;
+      //When an image is detected, keep up to this many pixles after it
+      int keepInfoCounter = keepInfoCounterStart;
+      int firstBonePixelPosition = -1;
+
+      for (int x = dims[0] - 1; x >= 0; --x)
+      {
+        unsigned char* vOutput = row + x;
+
+        //If an image is detected
+        if (*vOutput != 0)
+        {
+          if (keepInfoCounter == 0 || keepInfoCounter > boneOutlineDepthPx)
+          {
+            *vOutput = 0;
+          }
+          if (firstBonePixelPosition < 0)
+          {
+            //found the first bone
+            firstBonePixelPosition = x;
+          }
+        }
+        if (firstBonePixelPosition >= 0 && keepInfoCounter != 0)
+        {
+          if (keepInfoCounter <= boneOutlineDepthPx && *vOutput == 0)
+          {
+            *vOutput = 255;
+          }
+          keepInfoCounter--;
+        }
+      }
+      this->FirstBonePixelPositions[y] = firstBonePixelPosition;
+    }
+  });
 
   //Setup variables for recording bone areas
-  std::map<std::string, int> currentBoneArea;
+  int lastVistedValue = 0;
   int boneAreaStart = dims[1] - 1;  //The y coordinate of where the bone outline starts
   int boneDepthSum = 0;             //The sum of the x coordinates of each pixel in the bone outline
   int boneMaxDepth = dims[0] - 1;   //The x coordinate of the right-most pixel in the bone outline
@@ -418,92 +701,38 @@ void vtkPlusBoneEnhancer::MarkShadowOutline(vtkSmartPointer<vtkImageData> inputI
 
   for (int y = dims[1] - 1; y >= 0; --y)
   {
-
-    //When an image is detected, keep up to this many pixles after it
-    keepInfoCounter = this->BoneOutlineDepthPx + this->BonePushBackPx;
-    foundBone = false;
-
-    for (int x = dims[0] - 1; x >= 0; --x)
+    const int x = this->FirstBonePixelPositions[y];
+    if (x >= 0)
     {
-      vOutput = static_cast<unsigned char*>(inputImage->GetScalarPointer(x, y, 0));
-
-      //If an image is detected
-      if (*vOutput != 0)
+      //the two bone pixels are far enough appart, save them as being parts of different bone areas
+      if (std::abs(x - lastVistedValue) >= boneAreaDifferenceSlope && y != dims[1] - 1)
       {
-        if (keepInfoCounter == 0 || keepInfoCounter > this->BoneOutlineDepthPx)
+        //check if the preveous area had any bone
+        if (boneDepthSum != 0)
         {
-          *vOutput = 0;
-        }
-
-        if (keepInfoCounter == this->BoneOutlineDepthPx + this->BonePushBackPx)
-        {
-          if (foundBone == false)
-          {
-            //found the first bone
-            foundBone = true;
-
-            //the two bone pixels are far enough appart, save them as being parts of different bone areas
-            if (std::abs(x - lastVistedValue) >= boneAreaDifferenceSlope  && y != dims[1] - 1)
-            {
-              //check if the preveous area had any bone
-              if (boneDepthSum != 0)
-              {
-                //Save info related to where the bone area
-                currentBoneArea["depth"] = boneDepthSum / (boneAreaStart - y);                  // Store the outline's average x-coordinate
-                currentBoneArea["xMax"] = boneMaxDepth;                                         // Store the outline's maximum x-coordinate (Used for efficiency)
-                currentBoneArea["xMin"] = std::max(boneMinDepth - this->BoneOutlineDepthPx, 0); // Store the outline's minimum x-coordinate (Used for efficiency)
-                currentBoneArea["yMax"] = boneAreaStart;                                        // Store the outline's maximum y-coordinate
-                currentBoneArea["yMin"] = y + 1;                                                // Store the outline's minimum y-coordinate
-                this->BoneAreasInfo.push_back(currentBoneArea);
-                currentBoneArea.clear();
-              }
-              boneAreaStart = y;
-              boneDepthSum = 0;
-              boneMaxDepth = x;
-              boneMinDepth = x;
-            }
-            else
-            {
-              if (x > boneMaxDepth)
-              {
-                boneMaxDepth = x;
-              }
-              if (x < boneMinDepth)
-              {
-                boneMinDepth = x;
-              }
-            }
-            boneDepthSum += x;
-            lastVistedValue = x;
-
-          }
+          this->AddBoneArea(boneDepthSum, boneAreaStart, y, boneMinDepth, boneMaxDepth);
         }
+        boneAreaStart = y;
+        boneDepthSum = 0;
+        boneMaxDepth = x;
+        boneMinDepth = x;
       }
-      if (foundBone == true && keepInfoCounter != 0)
+      else
       {
-        if (keepInfoCounter <= this->BoneOutlineDepthPx && *vOutput == 0)
-        {
-          *vOutput = 255;
-        }
-        keepInfoCounter--;
+        boneMaxDepth = std::max(boneMaxDepth, x);
+        boneMinDepth = std::min(boneMinDepth, x);
       }
+      boneDepthSum += x;
+      lastVistedValue = x;
     }
-
-    //if no bones were found on this row, but there was a bone before this, save it
-    if (foundBone == false)
+    else
     {
+      //if no bones were found on this row, but there was a bone before this, save it
       lastVistedValue = 0;
       if (boneDepthSum != 0)
       {
-        //Save info related to where the bone area
-        currentBoneArea["depth"] = boneDepthSum / (boneAreaStart - y);                  // Store the outline's average x-coordinate
-        currentBoneArea["xMax"] = boneMaxDepth;                                         // Store the outline's maximum x-coordinate (Used for efficiency)
-        currentBoneArea["xMin"] = std::max(boneMinDepth - this->BoneOutlineDepthPx, 0); // Store the outline's minimum x-coordinate (Used for efficiency)
-        currentBoneArea["yMax"] = boneAreaStart;                                        // Store the outline's maximum y-coordinate
-        currentBoneArea["yMin"] = y + 1;                                                // Store the outline's minimum y-coordinate
-        this->BoneAreasInfo.push_back(currentBoneArea);
+        this->AddBoneArea(boneDepthSum, boneAreaStart, y, boneMinDepth, boneMaxDepth);
         boneDepthSum = 0;
-        currentBoneArea.clear();
       }
       boneMaxDepth = dims[0] - 1;
       boneMinDepth = 0;
@@ -515,80 +744,102 @@ void vtkPlusBoneEnhancer::MarkShadowOutline(vtkSmartPointer<vtkImageData> inputI
   //save the last bone that goes off-screen
   if (boneDepthSum != 0)
   {
-    //Save info related to where the bone area
-    currentBoneArea["depth"] = boneDepthSum / (boneAreaStart + 1);                  // Store the outline's average x-coordinate
-    currentBoneArea["xMax"] = boneMaxDepth;                                         // Store the outline's maximum x-coordinate (Used for efficiency)
-    currentBoneArea["xMin"] = std::max(boneMinDepth - this->BoneOutlineDepthPx, 0); // Store the outline's minimum x-coordinate (Used for efficiency)
-    currentBoneArea["yMax"] = boneAreaStart;                                        // Store the outline's maximum y-coordinate
-    currentBoneArea["yMin"] = 0;                                                    // Store the outline's minimum y-coordinate
-    this->BoneAreasInfo.push_back(currentBoneArea);
-    currentBoneArea.clear();
+    this->AddBoneArea(boneDepthSum, boneAreaStart, -1, boneMinDepth, boneMaxDepth);
   }
 }
 
 //----------------------------------------------------------------------------
-//a way of threasholding based on the standard deviation of a row
-void vtkPlusBoneEnhancer::ThresholdViaStdDeviation(vtkSmartPointer<vtkImageData> inputImage)
+void vtkPlusBoneEnhancer::AddBoneArea(int boneDepthSum, int boneAreaStart, int boneAreaEnd, int boneMinDepth, int boneMaxDepth)
 {
-  int fatLayerToCut = 20; //The area of fat too close to the transducer should not be considered
-
-  float vInput = 0;
-  unsigned char* vOutput = 0;
+  BoneArea area;
+  area.Depth = boneDepthSum / (boneAreaStart - boneAreaEnd);
+  area.XMax = boneMaxDepth;
+  area.XMin = std::max(boneMinDepth - this->BoneOutlineDepthPx, 0);
+  area.YMax = boneAreaStart;
+  area.YMin = boneAreaEnd + 1;
+  this->BoneAreasInfo.push_back(area);
+}
 
+//----------------------------------------------------------------------------
+void vtkPlusBoneEnhancer::ClearBoneArea(vtkImageData* inputImage, const BoneArea& area)
+{
   int dims[3] = { 0, 0, 0 };
   inputImage->GetDimensions(dims);
+  unsigned char* pixels = static_cast<unsigned char*>(inputImage->GetScalarPointer());
 
-  int max;
-
-  //values used to calculate the standard deviation
-  int pixelSum;
-  int squearSum;
-  float pixelAverage;
-  float meanDiffSum;
-  float meanDiffAverage;
-  float thresholdValue;
-
-  for (int y = dims[1] - 1; y >= 0; --y)
+  for (int y = std::min(area.YMax, dims[1] - 1); y >= std::max(area.YMin, 0); --y)
   {
-    max = 0;
+    unsigned char* row = pixels + static_cast<size_t>(y) * dims[0];
 
-    pixelSum = 0;
-    squearSum = 0;
-    pixelAverage = 0;
-
-    //determine the average, sum, and max of the row
-    for (int x = dims[0] - 1; x >= fatLayerToCut; --x)
+    //search through the area where the pixels are known to be
+    for (int x = std::min(area.XMax - this->BonePushBackPx, dims[0] - 1); x >= area.XMin - this->BonePushBackPx && x >= 0; --x)
     {
-      vInput = inputImage->GetScalarComponentAsFloat(x, y, 0, 0);
-      pixelSum += vInput;
-      squearSum += vInput * vInput;
-
-      if (vInput > max)
+      if (row[x] != 0)
       {
-        max = vInput;
+        //remove all pixels in the outline
+        row[x] = 0;
+        for (int removeBonex = std::max(0, x - (this->BoneOutlineDepthPx - 1)); removeBonex < x; ++removeBonex)
+        {
+          row[removeBonex] = 0;
+        }
+        break;
       }
     }
-    pixelAverage = pixelSum / (dims[0] - fatLayerToCut);
+  }
+}
 
-    //determine the standard deviation of the row
-    meanDiffSum = squearSum + (dims[0] - fatLayerToCut) * pixelAverage * pixelAverage + (-2 * pixelAverage * pixelSum);
-    meanDiffAverage = meanDiffSum / (dims[0] - fatLayerToCut);
-    thresholdValue = max - 3 * pow(meanDiffAverage, 0.5f);
+//----------------------------------------------------------------------------
+//a way of threasholding based on the standard deviation of a row
+void vtkPlusBoneEnhancer::ThresholdViaStdDeviation(vtkSmartPointer<vtkImageData> inputImage)
+{
+  const int fatLayerToCut = THRESHOLD_FAT_LAYER_PX; //The area of fat too close to the transducer should not be considered
 
+  int dims[3] = { 0, 0, 0 };
+  inputImage->GetDimensions(dims);
+  if (dims[0] < 1 || dims[1] < 1)
+  {
+    return;
+  }
+  unsigned char* pixels = static_cast<unsigned char*>(inputImage->GetScalarPointer());
 
-    //if a pixel's value is too low, remove it
-    if (pixelSum != 0)
+  // The threshold of each scan line depends only on the scan line itself
+  PlusWorkerPool::GetInstance().ParallelFor(0, dims[1], 0, [&](int firstRow, int lastRow)
+  {
+    for (int y = firstRow; y < lastRow; ++y)
     {
-      for (int x = dims[0] - 1; x >= 0; --x)
+      unsigned char* row = pixels + static_cast<size_t>(y) * dims[0];
+
+      //values used to calculate the standard deviation
+      int max = 0;
+      int pixelSum = 0;
+      int squearSum = 0;
+
+      //determine the average, sum, and max of the row
+      for (int x = dims[0] - 1; x >= fatLayerToCut; --x)
       {
-        vOutput = static_cast<unsigned char*>(inputImage->GetScalarPointer(x, y, 0));
-        if (*vOutput < thresholdValue && *vOutput != 0)
+        const int vInput = row[x];
+        pixelSum += vInput;
+        squearSum += vInput * vInput;
+        if (vInput > max)
         {
-          *vOutput = 0;
+          max = vInput;
+        }
+      }
+      float thresholdValue = ComputeScanLineThreshold(max, pixelSum, squearSum, dims[0] - fatLayerToCut);
+
+      //if a pixel's value is too low, remove it
+      if (pixelSum != 0)
+      {
+        for (int x = dims[0] - 1; x >= 0; --x)
+        {
+          if (row[x] < thresholdValue && row[x] != 0)
+          {
+            row[x] = 0;
+          }
         }
       }
     }
-  }
+  });
 }
 
 //----------------------------------------------------------------------------
@@ -625,6 +876,7 @@ void vtkPlusBoneEnhancer::ImageConjunction(vtkSmartPointer<vtkImageData> InputIm
 // Processes a given frame and marks potential bone areas.
 PlusStatus vtkPlusBoneEnhancer::ProcessFrame(igsioTrackedFrame* inputFrame, igsioTrackedFrame* outputFrame)
 {
+  PLUS_PROFILE_ZONE("vtkPlusBoneEnhancer::ProcessFrame");
   //Process the input into a linear image
   vtkSmartPointer<vtkImageData> intermediateImage = this->UnprocessedFrameToLinearImage(inputFrame);
   //Remove noise and mark all possible bones
@@ -638,13 +890,362 @@ void vtkPlusBoneEnhancer::LinearToFanImage(vtkSmartPointer<vtkImageData> inputIm
 {
 
   //Setup so that the image can be converted into a fan-image
-  this->ProcessedLinesImage->DeepCopy(inputImage);
+  CopyImage(inputImage, this->ProcessedLinesImage);
   igsioVideoFrame* outputImage = outputFrame->GetImageData();
   this->ScanConverter->SetInputData(this->ProcessedLinesImage);
-  this->ScanConverter->SetOutput(inputImage);
+  this->ScanConverter->SetOutput(this->FanImage);
   this->ScanConverter->Update();
 
-  outputImage->DeepCopyFrom(inputImage);
+  outputImage->DeepCopyFrom(this->FanImage);
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusBoneEnhancer::CopyImage(vtkImageData* source, vtkImageData* destination)
+{
+  if (source == destination)
+  {
+    return;
+  }
+  vtkDataArray* sourceScalars = source->GetPointData()->GetScalars();
+  if (sourceScalars == NULL)
+  {
+    destination->DeepCopy(source);
+    return;
+  }
+
+  int* extent = source->GetExtent();
+  if (!std::equal(extent, extent + 6, destination->GetExtent())
+      || destination->GetPointData()->GetScalars() == NULL
+      || destination->GetScalarType() != source->GetScalarType()
+      || destination->GetNumberOfScalarComponents() != source->GetNumberOfScalarComponents())
+  {
+    destination->SetExtent(extent);
+    destination->AllocateScalars(source->GetScalarType(), source->GetNumberOfScalarComponents());
+  }
+  destination->SetSpacing(source->GetSpacing());
+  destination->SetOrigin(source->GetOrigin());
+  memcpy(destination->GetScalarPointer(), source->GetScalarPointer(),
+         static_cast<size_t>(sourceScalars->GetNumberOfTuples()) * sourceScalars->GetNumberOfComponents() * sourceScalars->GetDataTypeSize());
+  destination->Modified();
+}
+
+//----------------------------------------------------------------------------
+// Smooths, detects edges and binarizes the lines image in one pass over blocks of scan lines.
+// Gives the same result as the GaussianSmooth, EdgeDetector, VectorImageToUchar and ImageBinarizer steps.
+PlusStatus vtkPlusBoneEnhancer::FusedEdgeDetection(vtkImageData* inputImage, vtkImageData* outputImage)
+{
+  if (inputImage->GetScalarType() != VTK_UNSIGNED_CHAR || inputImage->GetNumberOfScalarComponents() != 1)
+  {
+    LOG_ERROR("Fused edge detection requires a single component unsigned char image");
+    return PLUS_FAIL;
+  }
+
+  int* extent = inputImage->GetExtent();
+  if (!std::equal(extent, extent + 6, outputImage->GetExtent()) || outputImage->GetPointData()->GetScalars() == NULL)
+  {
+    outputImage->SetExtent(extent);
+    outputImage->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+  }
+
+  int dims[3] = { 0, 0, 0 };
+  inputImage->GetDimensions(dims);
+  const int width = dims[0];
+  const int height = dims[1];
+  if (width < 1 || height < 1)
+  {
+    return PLUS_SUCCESS;
+  }
+
+  GaussianKernel kernelX;
+  GaussianKernel kernelY;
+  kernelX.Compute(this->GaussianSmooth->GetStandardDeviations()[0], this->GaussianSmooth->GetRadiusFactors()[0], width);
+  kernelY.Compute(this->GaussianSmooth->GetStandardDeviations()[1], this->GaussianSmooth->GetRadiusFactors()[1], height);
+
+  // Sobel weights of vtkImageSobel2D
+  double* spacing = inputImage->GetSpacing();
+  const double sobelScaleX = 0.125 / spacing[0];
+  const double sobelScaleY = 0.125 / spacing[1];
+
+  const double lowerThreshold = this->ImageBinarizer->GetLowerThreshold();
+  const double upperThreshold = this->ImageBinarizer->GetUpperThreshold();
+  const bool replaceIn = this->ImageBinarizer->GetReplaceIn() != 0;
+  const bool replaceOut = this->ImageBinarizer->GetReplaceOut() != 0;
+  const unsigned char inValue = static_cast<unsigned char>(this->ImageBinarizer->GetInValue());
+  const unsigned char outValue = static_cast<unsigned char>(this->ImageBinarizer->GetOutValue());
+
+  const unsigned char* inputPixels = static_cast<const unsigned char*>(inputImage->GetScalarPointer());
+  unsigned char* outputPixels = static_cast<unsigned char*>(outputImage->GetScalarPointer());
+
+  const int numberOfBlocks = (height + FUSED_FILTER_BLOCK_SIZE - 1) / FUSED_FILTER_BLOCK_SIZE;
+  PlusWorkerPool::GetInstance().ParallelFor(0, numberOfBlocks, 0, [&](int firstBlock, int lastBlock)
+  {
+    std::vector<double> accumulator;
+    std::vector<unsigned char> verticalRow;
+    std::vector<unsigned char> smoothedRows(static_cast<size_t>(FUSED_FILTER_BLOCK_SIZE + 2) * width);
+    for (int block = firstBlock; block < lastBlock; ++block)
+    {
+      const int firstRow = block * FUSED_FILTER_BLOCK_SIZE;
+      const int lastRow = std::min(firstRow + FUSED_FILTER_BLOCK_SIZE, height);
+
+      // The edge detector needs the smoothed neighbor scan lines of the block as well
+      const int firstSmoothedRow = std::max(firstRow - 1, 0);
+      const int lastSmoothedRow = std::min(lastRow + 1, height);
+      SmoothRows(inputPixels, width, height, firstSmoothedRow, lastSmoothedRow, kernelX, kernelY, accumulator, verticalRow, &smoothedRows[0]);
+
+      for (int y = firstRow; y < lastRow; ++y)
+      {
+        const unsigned char* previousRow = &smoothedRows[static_cast<size_t>(std::max(y - 1, 0) - firstSmoothedRow) * width];
+        const unsigned char* currentRow = &smoothedRows[static_cast<size_t>(y - firstSmoothedRow) * width];
+        const unsigned char* nextRow = &smoothedRows[static_cast<size_t>(std::min(y + 1, height - 1) - firstSmoothedRow) * width];
+        unsigned char* outputRow = outputPixels + static_cast<size_t>(y) * width;
+        for (int x = 0; x < width; ++x)
+        {
+          const int left = std::max(x - 1, 0);
+          const int right = std::min(x + 1, width - 1);
+          double gradientX = 2.0 * (currentRow[right] - currentRow[left]);
+          gradientX += static_cast<double>(previousRow[right] + nextRow[right]);
+          gradientX -= static_cast<double>(previousRow[left] + nextRow[left]);
+          double gradientY = 2.0 * (nextRow[x] - previousRow[x]);
+          gradientY += static_cast<double>(nextRow[left] + nextRow[right]);
+          gradientY -= static_cast<double>(previousRow[left] + previousRow[right]);
+
+          // Same conversion of the gradient components as in VectorImageToUchar
+          const unsigned char edge0 = static_cast<unsigned char>(static_cast<int>(static_cast<float>(gradientX * sobelScaleX)));
+          const unsigned char edge1 = static_cast<unsigned char>(static_cast<int>(static_cast<float>(gradientY * sobelScaleY)));
+          const unsigned char edge = static_cast<unsigned char>((edge0 + edge1) / 2);
+
+          if (edge >= lowerThreshold && edge <= upperThreshold)
+          {
+            outputRow[x] = replaceIn ? inValue : edge;
+          }
+          else
+          {
+            outputRow[x] = replaceOut ? outValue : edge;
+          }
+        }
+      }
+    }
+  });
+
+  outputImage->Modified();
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+// Uploads the input image and samples it along the scan lines on the GPU. The lines image stays on the GPU for GpuEdgeDetection.
+PlusStatus vtkPlusBoneEnhancer::GpuFillLinesImage(vtkImageData* inputImageData)
+{
+#ifdef PLUS_USE_OpenCV
+  if (inputImageData->GetScalarType() != VTK_UNSIGNED_CHAR || inputImageData->GetNumberOfScalarComponents() != 1)
+  {
+    LOG_ERROR("GPU scan line extraction requires a single component unsigned char image");
+    return PLUS_FAIL;
+  }
+
+  try
+  {
+    int* inputExtent = inputImageData->GetExtent();
+    int* linesExtent = this->ScanConverter->GetInputImageExtent();
+    if (this->Internal->SamplingMapX.empty()
+        || !std::equal(inputExtent, inputExtent + 6, this->Internal->SamplingInputExtent)
+        || !std::equal(linesExtent, linesExtent + 6, this->Internal->SamplingLinesExtent))
+    {
+      // Same sample positions as FillLinesImage, converted to a lookup map that is uploaded once
+      vtkPlusUsScanConvert::ScanLineSamplingTable table;
+      if (this->ScanConverter->ComputeScanLineSamplingTable(table) != PLUS_SUCCESS)
+      {
+        return PLUS_FAIL;
+      }
+      const int lineLengthPx = table.LinesImageExtent[1] - table.LinesImageExtent[0] + 1;
+      const int numScanLines = table.LinesImageExtent[3] - table.LinesImageExtent[2] + 1;
+      cv::Mat mapX(numScanLines, lineLengthPx, CV_32FC1);
+      cv::Mat mapY(numScanLines, lineLengthPx, CV_32FC1);
+      float* mapXPixel = mapX.ptr<float>();
+      float* mapYPixel = mapY.ptr<float>();
+      for (std::vector<int>::const_iterator pixelCoordinates = table.PixelCoordinates.begin(); pixelCoordinates != table.PixelCoordinates.end(); pixelCoordinates += 2)
+      {
+        const int x = pixelCoordinates[0];
+        const int y = pixelCoordinates[1];
+        const bool inside = (x >= inputExtent[0] && x <= inputExtent[1] && y >= inputExtent[2] && y <= inputExtent[3]);
+        *(mapXPixel++) = inside ? static_cast<float>(x - inputExtent[0]) : -1.0f;
+        *(mapYPixel++) = inside ? static_cast<float>(y - inputExtent[2]) : -1.0f;
+      }
+      mapX.copyTo(this->Internal->SamplingMapX);
+      mapY.copyTo(this->Internal->SamplingMapY);
+      std::copy(inputExtent, inputExtent + 6, this->Internal->SamplingInputExtent);
+      std::copy(linesExtent, linesExtent + 6, this->Internal->SamplingLinesExtent);
+    }
+
+    GetImageMat(inputImageData).copyTo(this->Internal->InputImage);
+    cv::remap(this->Internal->InputImage, this->Internal->LinesImage, this->Internal->SamplingMapX, this->Internal->SamplingMapY,
+              cv::INTER_NEAREST, cv::BORDER_CONSTANT, cv::Scalar::all(0));
+
+    // The lines image is needed on the CPU as well, e.g. to be compared with the processed image
+    this->Internal->LinesImage.copyTo(GetImageMat(this->LinesImage));
+    this->LinesImage->Modified();
+  }
+  catch (const cv::Exception& e)
+  {
+    LOG_ERROR("GPU scan line extraction failed: " << e.what());
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+#else
+  LOG_ERROR("GPU scan line extraction requires Plus to be built with PLUS_USE_OpenCV");
+  return PLUS_FAIL;
+#endif
+}
+
+//----------------------------------------------------------------------------
+// Same steps as ThresholdViaStdDeviation and FusedEdgeDetection, computed on the GPU. Only the binary image is downloaded.
+PlusStatus vtkPlusBoneEnhancer::GpuEdgeDetection(vtkImageData* inputImage, vtkImageData* outputImage)
+{
+#ifdef PLUS_USE_OpenCV
+  if (inputImage->GetScalarType() != VTK_UNSIGNED_CHAR || inputImage->GetNumberOfScalarComponents() != 1)
+  {
+    LOG_ERROR("GPU edge detection requires a single component unsigned char image");
+    return PLUS_FAIL;
+  }
+
+  int* extent = inputImage->GetExtent();
+  if (!std::equal(extent, extent + 6, outputImage->GetExtent()) || outputImage->GetPointData()->GetScalars() == NULL)
+  {
+    outputImage->SetExtent(extent);
+    outputImage->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+  }
+
+  int dims[3] = { 0, 0, 0 };
+  inputImage->GetDimensions(dims);
+  const int width = dims[0];
+  const int height = dims[1];
+  if (width < 1 || height < 1)
+  {
+    return PLUS_SUCCESS;
+  }
+
+  vtkInternal* internal = this->Internal;
+  try
+  {
+    // Upload the lines image, unless it is still on the GPU from GpuFillLinesImage
+    if (inputImage != this->WorkImage.GetPointer() || internal->GpuLinesImageMTime != this->WorkImage->GetMTime())
+    {
+      GetImageMat(inputImage).copyTo(internal->LinesImage);
+    }
+    // The lines image on the GPU is modified by the threshold
+    internal->GpuLinesImageMTime = 0;
+
+    // Threshold via standard deviation: the statistics of each scan line are computed on the GPU,
+    // only these are downloaded to compute the thresholds exactly as ThresholdViaStdDeviation
+    if (width > THRESHOLD_FAT_LAYER_PX)
+    {
+      cv::UMat samples = internal->LinesImage.colRange(THRESHOLD_FAT_LAYER_PX, width);
+      cv::UMat pixelSums;
+      cv::UMat squareSums;
+      cv::UMat maxima;
+      cv::reduce(samples, pixelSums, 1, cv::REDUCE_SUM, CV_32S);
+      samples.convertTo(internal->SquaredImage, CV_32S);
+      cv::multiply(internal->SquaredImage, internal->SquaredImage, internal->SquaredImage);
+      cv::reduce(internal->SquaredImage, squareSums, 1, cv::REDUCE_SUM, CV_32S);
+      cv::reduce(samples, maxima, 1, cv::REDUCE_MAX);
+
+      cv::Mat pixelSumsCpu = pixelSums.getMat(cv::ACCESS_READ);
+      cv::Mat squareSumsCpu = squareSums.getMat(cv::ACCESS_READ);
+      cv::Mat maximaCpu = maxima.getMat(cv::ACCESS_READ);
+      cv::Mat thresholds(height, 1, CV_8UC1);
+      for (int y = 0; y < height; ++y)
+      {
+        const int pixelSum = pixelSumsCpu.at<int>(y);
+        const float thresholdValue = ComputeScanLineThreshold(maximaCpu.at<unsigned char>(y), pixelSum, squareSumsCpu.at<int>(y), width - THRESHOLD_FAT_LAYER_PX);
+        // Pixels are removed if they are less than the threshold, so the threshold is rounded up. Scan lines without signal are not thresholded.
+        thresholds.at<unsigned char>(y) = (pixelSum != 0 && thresholdValue > 0) ? static_cast<unsigned char>(std::min(255.0f, std::ceil(thresholdValue))) : 0;
+      }
+      // Views of the downloaded statistics must be released before the GPU buffers are used again
+      pixelSumsCpu.release();
+      squareSumsCpu.release();
+      maximaCpu.release();
+
+      cv::repeat(thresholds.getUMat(cv::ACCESS_READ), 1, width, internal->Thresholds);
+      cv::compare(internal->LinesImage, internal->Thresholds, internal->Mask, cv::CMP_LT);
+      internal->LinesImage.setTo(cv::Scalar::all(0), internal->Mask);
+    }
+    if (this->SaveIntermediateResults)
+    {
+      internal->LinesImage.copyTo(GetImageMat(inputImage));
+      inputImage->Modified();
+    }
+
+    // Smoothing kernels, computed when the image size or the smoothing parameters change
+    const double smoothingParameters[6] =
+    {
+      static_cast<double>(width), static_cast<double>(height),
+      this->GaussianSmooth->GetStandardDeviations()[0], this->GaussianSmooth->GetStandardDeviations()[1],
+      this->GaussianSmooth->GetRadiusFactors()[0], this->GaussianSmooth->GetRadiusFactors()[1]
+    };
+    if (internal->SmoothingKernelX.empty() || !std::equal(smoothingParameters, smoothingParameters + 6, internal->SmoothingParameters))
+    {
+      GaussianKernel kernelX;
+      GaussianKernel kernelY;
+      kernelX.Compute(smoothingParameters[2], smoothingParameters[4], width);
+      kernelY.Compute(smoothingParameters[3], smoothingParameters[5], height);
+      cv::Mat(kernelX.Weights, true).convertTo(internal->SmoothingKernelX, CV_32F);
+      cv::Mat(kernelY.Weights, true).convertTo(internal->SmoothingKernelY, CV_32F);
+      internal->IdentityKernel = cv::Mat::ones(1, 1, CV_32F);
+      cv::Mat normalizationX;
+      cv::Mat normalizationY;
+      cv::Mat(kernelX.InverseSums, true).reshape(1, 1).convertTo(normalizationX, CV_32F);
+      cv::Mat(kernelY.InverseSums, true).convertTo(normalizationY, CV_32F);
+      cv::repeat(normalizationX.getUMat(cv::ACCESS_READ), height, 1, internal->SmoothingNormalizationX);
+      cv::repeat(normalizationY.getUMat(cv::ACCESS_READ), 1, width, internal->SmoothingNormalizationY);
+      std::copy(smoothingParameters, smoothingParameters + 6, internal->SmoothingParameters);
+    }
+
+    // Gaussian smoothing across the scan lines then along the scan lines, truncated to unsigned char after each pass.
+    // Pixels outside of the image are 0, so the renormalization gives the truncated kernel of vtkImageGaussianSmooth.
+    cv::sepFilter2D(internal->LinesImage, internal->FloatImage, CV_32F, internal->IdentityKernel, internal->SmoothingKernelY,
+                    cv::Point(-1, -1), 0, cv::BORDER_CONSTANT);
+    cv::multiply(internal->FloatImage, internal->SmoothingNormalizationY, internal->FloatImage);
+    internal->FloatImage.convertTo(internal->SmoothedImage, CV_8U, 1.0, -TRUNCATION_OFFSET);
+    cv::sepFilter2D(internal->SmoothedImage, internal->FloatImage, CV_32F, internal->SmoothingKernelX, internal->IdentityKernel,
+                    cv::Point(-1, -1), 0, cv::BORDER_CONSTANT);
+    cv::multiply(internal->FloatImage, internal->SmoothingNormalizationX, internal->FloatImage);
+    internal->FloatImage.convertTo(internal->SmoothedImage, CV_8U, 1.0, -TRUNCATION_OFFSET);
+
+    // Sobel weights of vtkImageSobel2D, the image boundary is clamped
+    double* spacing = inputImage->GetSpacing();
+    cv::Sobel(internal->SmoothedImage, internal->GradientX, CV_32F, 1, 0, 3, 0.125 / spacing[0], 0, cv::BORDER_REPLICATE);
+    cv::Sobel(internal->SmoothedImage, internal->GradientY, CV_32F, 0, 1, 3, 0.125 / spacing[1], 0, cv::BORDER_REPLICATE);
+    GradientToUchar(internal->GradientX, internal->FloatImage, internal->PositivePart, internal->NegativePart, internal->EdgeX);
+    GradientToUchar(internal->GradientY, internal->FloatImage, internal->PositivePart, internal->NegativePart, internal->EdgeY);
+    // (edge0 + edge1) / 2 with integer division, the sum is even or odd so the offset does not change the rounding
+    cv::add(internal->EdgeX, internal->EdgeY, internal->EdgeX);
+    internal->EdgeX.convertTo(internal->Edges, CV_8U, 0.5, -0.25);
+
+    // Binarization with the settings of ImageBinarizer
+    cv::inRange(internal->Edges, cv::Scalar::all(std::ceil(this->ImageBinarizer->GetLowerThreshold())),
+                cv::Scalar::all(std::floor(this->ImageBinarizer->GetUpperThreshold())), internal->Mask);
+    cv::bitwise_not(internal->Mask, internal->OutsideMask);
+    if (this->ImageBinarizer->GetReplaceIn())
+    {
+      internal->Edges.setTo(cv::Scalar::all(this->ImageBinarizer->GetInValue()), internal->Mask);
+    }
+    if (this->ImageBinarizer->GetReplaceOut())
+    {
+      internal->Edges.setTo(cv::Scalar::all(this->ImageBinarizer->GetOutValue()), internal->OutsideMask);
+    }
+
+    internal->Edges.copyTo(GetImageMat(outputImage));
+  }
+  catch (const cv::Exception& e)
+  {
+    LOG_ERROR("GPU edge detection failed: " << e.what());
+    return PLUS_FAIL;
+  }
+  outputImage->Modified();
+  return PLUS_SUCCESS;
+#else
+  LOG_ERROR("GPU edge detection requires Plus to be built with PLUS_USE_OpenCV");
+  return PLUS_FAIL;
+#endif
 }
 
 //----------------------------------------------------------------------------
@@ -660,8 +1261,6 @@ vtkSmartPointer<vtkImageData> vtkPlusBoneEnhancer::UnprocessedFrameToLinearImage
   this->BoneAreasInfo.clear();
 
   igsioVideoFrame* inputImage = inputFrame->GetImageData();
-  //an image used to transport output between filters
-  vtkSmartPointer<vtkImageData> intermediateImage = vtkSmartPointer<vtkImageData>::New();
 
   //Convert the image to a readable non-fan image
   this->ScanConverter->SetInputData(inputImage->GetImage());
@@ -670,14 +1269,21 @@ vtkSmartPointer<vtkImageData> vtkPlusBoneEnhancer::UnprocessedFrameToLinearImage
   {
     this->AddIntermediateFromFilter("_01Lines_1PreFillLines", this->ScanConverter);
   }
-  this->FillLinesImage(inputImage->GetImage());
+  const bool linesImageOnGpu = this->UseGpu && this->GpuFillLinesImage(inputImage->GetImage()) == PLUS_SUCCESS;
+  if (!linesImageOnGpu)
+  {
+    this->FillLinesImage(inputImage->GetImage());
+  }
   if (this->SaveIntermediateResults)
   {
     this->AddIntermediateImage("_01Lines_2FilterEnd", this->LinesImage);
   }
-  intermediateImage->DeepCopy(this->LinesImage);
+  // The work image transports the output between the filters, it is allocated once for the lines image geometry
+  CopyImage(this->LinesImage, this->WorkImage);
+  // RemoveNoise uses the lines image on the GPU if the work image is not modified before
+  this->Internal->GpuLinesImageMTime = linesImageOnGpu ? this->WorkImage->GetMTime() : 0;
 
-  return intermediateImage;
+  return this->WorkImage;
 }
 
 //----------------------------------------------------------------------------
@@ -685,39 +1291,64 @@ vtkSmartPointer<vtkImageData> vtkPlusBoneEnhancer::UnprocessedFrameToLinearImage
 // bone areas using a white outline.
 void vtkPlusBoneEnhancer::RemoveNoise(vtkSmartPointer<vtkImageData> inputImage)
 {
+  // Thresholding, smoothing, edge detection and binarization on the GPU, the CPU implementation is used if it fails
+  const bool edgesOnGpu = this->UseGpu && this->GpuEdgeDetection(inputImage, this->ConversionImage) == PLUS_SUCCESS;
 
   //Threashold the image based on the standard deviation of a pixel's columns
-  this->ThresholdViaStdDeviation(inputImage);
+  if (!edgesOnGpu)
+  {
+    this->ThresholdViaStdDeviation(inputImage);
+  }
   if (this->SaveIntermediateResults)
   {
     this->AddIntermediateImage("_02Threshold_1FilterEnd", inputImage);
   }
 
-  //Use gaussian smoothing
-  this->GaussianSmooth->SetInputData(inputImage);
-  if (this->SaveIntermediateResults)
+  if (edgesOnGpu)
   {
-    this->AddIntermediateFromFilter("_03Gaussian_1FilterEnd", this->GaussianSmooth);
+    if (this->SaveIntermediateResults)
+    {
+      this->AddIntermediateImage("_05BinaryImageForMorphology_1FilterEnd", this->ConversionImage);
+    }
+    this->IslandRemover->SetInputData(this->ConversionImage);
   }
-
-  //Edge detection
-  this->EdgeDetector->SetInputConnection(this->GaussianSmooth->GetOutputPort());
-  this->EdgeDetector->Update();
-  this->VectorImageToUchar(this->EdgeDetector->GetOutput());
-  if (this->SaveIntermediateResults)
+  else if (this->UseFusedEdgeDetection && this->FusedEdgeDetection(inputImage, this->ConversionImage) == PLUS_SUCCESS)
   {
-    this->AddIntermediateImage("_04EdgeDetector_1FilterEnd", this->ConversionImage);
+    // Smoothing, edge detection and binarization are done in one pass, only the binary image is available
+    if (this->SaveIntermediateResults)
+    {
+      this->AddIntermediateImage("_05BinaryImageForMorphology_1FilterEnd", this->ConversionImage);
+    }
+    this->IslandRemover->SetInputData(this->ConversionImage);
   }
-
-  // Since we perform morphological operations, we must binarize the image
-  this->ImageBinarizer->SetInputData(this->ConversionImage);
-  if (this->SaveIntermediateResults)
+  else
   {
-    this->AddIntermediateFromFilter("_05BinaryImageForMorphology_1FilterEnd", this->ImageBinarizer);
+    //Use gaussian smoothing
+    this->GaussianSmooth->SetInputData(inputImage);
+    if (this->SaveIntermediateResults)
+    {
+      this->AddIntermediateFromFilter("_03Gaussian_1FilterEnd", this->GaussianSmooth);
+    }
+
+    //Edge detection
+    this->EdgeDetector->SetInputConnection(this->GaussianSmooth->GetOutputPort());
+    this->EdgeDetector->Update();
+    this->VectorImageToUchar(this->EdgeDetector->GetOutput());
+    if (this->SaveIntermediateResults)
+    {
+      this->AddIntermediateImage("_04EdgeDetector_1FilterEnd", this->ConversionImage);
+    }
+
+    // Since we perform morphological operations, we must binarize the image
+    this->ImageBinarizer->SetInputData(this->ConversionImage);
+    if (this->SaveIntermediateResults)
+    {
+      this->AddIntermediateFromFilter("_05BinaryImageForMorphology_1FilterEnd", this->ImageBinarizer);
+    }
+    this->IslandRemover->SetInputConnection(this->ImageBinarizer->GetOutputPort());
   }
 
   //Remove small clusters of pixels
-  this->IslandRemover->SetInputConnection(this->ImageBinarizer->GetOutputPort());
   this->IslandRemover->Update();
   if (this->SaveIntermediateResults)
   {
@@ -736,7 +1367,7 @@ void vtkPlusBoneEnhancer::RemoveNoise(vtkSmartPointer<vtkImageData> inputImage)
   this->ImageDialator->SetKernelSize(this->DilationKernelSize[0], this->DilationKernelSize[1], 1);
   this->ImageDialator->SetInputConnection(this->ImageEroder->GetOutputPort());
   this->ImageDialator->Update();
-  this->BinaryImageForMorphology->DeepCopy(this->ImageDialator->GetOutput());
+  CopyImage(this->ImageDialator->GetOutput(), this->BinaryImageForMorphology);
   if (this->SaveIntermediateResults)
   {
     this->AddIntermediateImage("_08Dilation_1FilterEnd", this->BinaryImageForMorphology);
@@ -755,7 +1386,7 @@ void vtkPlusBoneEnhancer::RemoveNoise(vtkSmartPointer<vtkImageData> inputImage)
     this->SaveAllIntermediateResultsToFile();
   }
   
-  inputImage->DeepCopy(this->BinaryImageForMorphology);
+  CopyImage(this->BinaryImageForMorphology, inputImage);
 }
 
 
@@ -822,12 +1453,23 @@ void vtkPlusBoneEnhancer::AddIntermediateImage(char* fileNamePostfix, vtkSmartPo
     this->IntermediatePostfixes.push_back(fileNamePostfix);
   }
 
+  // Keep only the most recent frames, so that the memory use does not grow while processing
+  vtkIGSIOTrackedFrameList* intermediateFrames = this->IntermediateImageMap[fileNamePostfix];
+  if (this->MaximumNumberOfIntermediateFrames > 0)
+  {
+    int numberOfFramesToRemove = intermediateFrames->GetNumberOfTrackedFrames() - this->MaximumNumberOfIntermediateFrames + 1;
+    if (numberOfFramesToRemove > 0)
+    {
+      intermediateFrames->RemoveTrackedFrameRange(0, numberOfFramesToRemove - 1);
+    }
+  }
+
   //Add the current frame to its vtkIGSIOTrackedFrameList
   igsioVideoFrame linesVideoFrame;
   linesVideoFrame.DeepCopyFrom(image);
   igsioTrackedFrame linesTrackedFrame;
   linesTrackedFrame.SetImageData(linesVideoFrame);
-  this->IntermediateImageMap[fileNamePostfix]->AddTrackedFrame(&linesTrackedFrame);
+  intermediateFrames->AddTrackedFrame(&linesTrackedFrame);
 }
 
 //----------------------------------------------------------------------------
@@ -839,10 +1481,15 @@ void vtkPlusBoneEnhancer::AddIntermediateFromFilter(char* fileNamePostfix, vtkIm
     LOG_WARNING("The empty string was given as an intermediate image file postfix.");
   }
 
-  vtkSmartPointer<vtkImageData> tempOutputImage = vtkSmartPointer<vtkImageData>::New();
-  imageFilter->SetOutput(tempOutputImage);
+  // The output image of the filter is created in the first frame and reused in the following frames
+  vtkSmartPointer<vtkImageData>& filterOutputImage = this->IntermediateFilterOutputs[fileNamePostfix];
+  if (filterOutputImage == NULL)
+  {
+    filterOutputImage = vtkSmartPointer<vtkImageData>::New();
+  }
+  imageFilter->SetOutput(filterOutputImage);
   imageFilter->Update();
-  this->AddIntermediateImage(fileNamePostfix, tempOutputImage);
+  this->AddIntermediateImage(fileNamePostfix, filterOutputImage);
 }
 
 //----------------------------------------------------------------------------
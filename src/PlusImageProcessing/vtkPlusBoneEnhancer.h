@@ -52,7 +52,31 @@ public:
   vtkSetMacro(IntermediateImageFileName, std::string);
   vtkSetMacro(SaveIntermediateResults, bool);
   vtkGetMacro(SaveIntermediateResults, bool);
-  
+
+  /*! Maximum number of frames that are kept for each intermediate image, older frames are dropped. 0 means no limit. */
+  vtkSetMacro(MaximumNumberOfIntermediateFrames, int);
+  vtkGetMacro(MaximumNumberOfIntermediateFrames, int);
+
+  /*!
+    If enabled then smoothing, edge detection and binarization are computed in a single pass over blocks of scan lines
+    instead of running the GaussianSmooth, EdgeDetector and ImageBinarizer filters one after the other.
+    The filter chain remains the reference implementation.
+  */
+  vtkSetMacro(UseFusedEdgeDetection, bool);
+  vtkGetMacro(UseFusedEdgeDetection, bool);
+  vtkBooleanMacro(UseFusedEdgeDetection, bool);
+
+  /*!
+    If enabled then the scan lines are extracted, thresholded, smoothed, edge detected and binarized on the GPU (OpenCL through
+    the transparent API of OpenCV). The input frame is uploaded once and the lines image stays on the GPU between these steps,
+    only the lines image and the binary image are downloaded for the steps that run on the CPU (island removal, morphology,
+    shadow outline and scan conversion). OpenCV rounds where the VTK filters truncate, so edge values may differ by one gray level.
+    Requires PLUS_USE_OpenCV, if OpenCL is not available then OpenCV computes the same operations on the CPU.
+  */
+  vtkSetMacro(UseGpu, bool);
+  vtkGetMacro(UseGpu, bool);
+  vtkBooleanMacro(UseGpu, bool);
+
   /*! Get and Set methods for variables related to the scanner used */
   vtkSetMacro(NumberOfScanLines, int);
   vtkGetMacro(NumberOfScanLines, int);
@@ -92,6 +116,7 @@ public:
   vtkImageData* GetProcessedLinesImage() { return (this->ProcessedLinesImage); }
 
   void RemoveNoise(vtkSmartPointer<vtkImageData> inputImage);
+  /*! Fill the lines image from the input frame. The returned image is owned by the enhancer and reused for every frame. */
   vtkSmartPointer<vtkImageData> UnprocessedFrameToLinearImage(igsioTrackedFrame* inputFrame);
   void LinearToFanImage(vtkSmartPointer<vtkImageData> inputImage, igsioTrackedFrame* outputFrame);
 
@@ -110,6 +135,18 @@ protected:
   void FillLinesImage(vtkSmartPointer<vtkImageData> inputImageData);
   void VectorImageToUchar(vtkSmartPointer<vtkImageData> inputImage);
 
+  /*! Smoothing, edge detection and binarization of a lines image in one pass, see UseFusedEdgeDetection */
+  PlusStatus FusedEdgeDetection(vtkImageData* inputImage, vtkImageData* outputImage);
+
+  /*! Extract the scan lines of the input image into LinesImage on the GPU, see UseGpu */
+  PlusStatus GpuFillLinesImage(vtkImageData* inputImageData);
+
+  /*!
+    Thresholding, smoothing, edge detection and binarization of a lines image on the GPU, see UseGpu.
+    The thresholded image is only copied back into the input image if intermediate results are saved.
+  */
+  PlusStatus GpuEdgeDetection(vtkImageData* inputImage, vtkImageData* outputImage);
+
   void ImageConjunction(vtkSmartPointer<vtkImageData> inputImage, vtkSmartPointer<vtkImageData> maskImage);
 
   void AddIntermediateImage(char* fileNamePostfix, vtkSmartPointer<vtkImageData> image);
@@ -117,6 +154,28 @@ protected:
 
   virtual PlusStatus ProcessImageExtents();
 
+  /*!
+    Copy the pixels of an image into another image. The destination scalars are only reallocated
+    if their extent, type or number of components differs from the source.
+  */
+  static void CopyImage(vtkImageData* source, vtkImageData* destination);
+
+  /*! Bone outline found by MarkShadowOutline, coordinates are pixel positions in the lines image */
+  struct BoneArea
+  {
+    int Depth;  /*!< average x coordinate of the outline */
+    int XMax;   /*!< maximum x coordinate of the outline */
+    int XMin;   /*!< minimum x coordinate of the outline, reduced by the outline depth */
+    int YMax;   /*!< first scan line of the outline */
+    int YMin;   /*!< last scan line of the outline */
+  };
+
+  /*! Add the bone area of the outline found in the scan lines (boneAreaEnd, boneAreaStart] */
+  void AddBoneArea(int boneDepthSum, int boneAreaStart, int boneAreaEnd, int boneMinDepth, int boneMaxDepth);
+
+  /*! Remove the outline of a bone area from an image marked by MarkShadowOutline */
+  void ClearBoneArea(vtkImageData* inputImage, const BoneArea& area);
+
 protected:
   vtkSmartPointer<vtkPlusUsScanConvert>     ScanConverter;
   vtkSmartPointer<vtkImageGaussianSmooth>   GaussianSmooth; // Trying to incorporate existing GaussianSmooth vtkThreadedAlgorithm class
@@ -151,20 +210,35 @@ protected:
   int BonePushBackPx;
 
   bool SaveIntermediateResults;
+  bool UseFusedEdgeDetection;
+  bool UseGpu;
   std::string IntermediateImageFileName;
   std::vector<char*> IntermediatePostfixes;
 
   /*! Image after some of the processing operations have been applied */
   std::map<char*, vtkSmartPointer<vtkIGSIOTrackedFrameList> > IntermediateImageMap;
+  /*! Output images of the filters that are saved as intermediate images, reused for every frame */
+  std::map<char*, vtkSmartPointer<vtkImageData> > IntermediateFilterOutputs;
+  int MaximumNumberOfIntermediateFrames;
 
   /*! Image for pixels (uchar) along scan lines only */
   vtkSmartPointer<vtkImageData> LinesImage;
   /*! Pixels (float) store probability of belonging to shadow */
   vtkSmartPointer<vtkImageData> ProcessedLinesImage;
-
-  std::vector<std::map<std::string, int> > BoneAreasInfo;
+  /*! Lines image that the processing steps are applied to, returned by UnprocessedFrameToLinearImage */
+  vtkSmartPointer<vtkImageData> WorkImage;
+  /*! Scan converted processed lines image */
+  vtkSmartPointer<vtkImageData> FanImage;
+
+  std::vector<BoneArea> BoneAreasInfo;
+  /*! Position of the first bone pixel in each scan line (-1 if there is none), reused for every frame */
+  std::vector<int> FirstBonePixelPositions;
   bool FirstFrame;
 
+  /*! Images and lookup tables of the GPU implementation */
+  class vtkInternal;
+  vtkInternal* Internal;
+
 private:
   vtkPlusBoneEnhancer(const vtkPlusBoneEnhancer&);  // Not implemented.
   void operator=(const vtkPlusBoneEnhancer&);  // Not implemented.
@@ -5,6 +5,7 @@ See License.txt for details.
 =========================================================Plus=header=end*/
 
 #include "PlusConfigure.h"
+#include "PlusWorkerPool.h"
 
 #include "vtkPlusForoughiBoneSurfaceProbability.h"
 
@@ -18,7 +19,10 @@ See License.txt for details.
 #include <vtkTimerLog.h>
 
 // STD includes
+#include <algorithm>
 #include <cassert>
+#include <mutex>
+#include <vector>
 
 // Other includes
 #include "mkl.h"
@@ -44,8 +48,12 @@ vtkPlusForoughiBoneSurfaceProbability::vtkPlusForoughiBoneSurfaceProbability()
   this->ShadowVSIntensity = 5;
   this->SmoothingSigma = 5.0;
   this->TransducerMargin = 60;
+  this->UseSeparableConvolution = true;
+  this->NumberOfThreads = 0;
 
   this->KernelUpdateRequested = true;
+  this->KernelSmoothingSigma = 0.0;
+  this->KernelShadowSigma = 0.0;
 
   this->GaussianKernelSize = 0;
   this->FrameSize[0] = 0;
@@ -61,6 +69,8 @@ vtkPlusForoughiBoneSurfaceProbability::vtkPlusForoughiBoneSurfaceProbability()
   this->MklShadowModel = NULL;
   this->MklGaussianKernel = NULL;
   this->MklLaplacianKernel = NULL;
+  this->MklGaussianKernel1D = NULL;
+  this->MklShadowModelSum = NULL;
 }
 
 //----------------------------------------------------------------------------
@@ -91,6 +101,10 @@ void vtkPlusForoughiBoneSurfaceProbability::SimpleExecute(vtkImageData* input, v
     this->FrameSize[2] = 1;
     this->KernelUpdateRequested = true;
   }
+  if (this->SmoothingSigma != this->KernelSmoothingSigma || this->ShadowSigma != this->KernelShadowSigma)
+  {
+    this->KernelUpdateRequested = true;
+  }
   if (this->KernelUpdateRequested)
   {
     UpdateKernels();
@@ -112,6 +126,15 @@ void vtkPlusForoughiBoneSurfaceProbability::SimpleExecute(vtkImageData* input, v
     double* inputSlicePtr = static_cast<double*>(input->GetScalarPointer(0, 0, sliceIdx));
     double* outputSlicePtr = static_cast<double*>(output->GetScalarPointer(0, 0, sliceIdx));
 
+    if (this->UseSeparableConvolution)
+    {
+      timer->StartTimer();
+      ComputeBoneSurfaceProbability(inputSlicePtr, outputSlicePtr);
+      timer->StopTimer();
+      LOG_TRACE("Bone surface probability computation time: " << timer->GetElapsedTime());
+      continue;
+    }
+
     // If slice has not all zero pixels...
     //if (GetMaxPixelValue(inputSlicePtr, sliceSize) > 0) // this is expensive and always true (except error cases)
     {
@@ -208,6 +231,88 @@ void vtkPlusForoughiBoneSurfaceProbability::SimpleExecute(vtkImageData* input, v
   }
 }
 
+//----------------------------------------------------------------------------
+// Same computation as the reference implementation in SimpleExecute, but each step is split into rows that are
+// processed in parallel, and the column sums of the shadow values are accumulated row by row
+void vtkPlusForoughiBoneSurfaceProbability::ComputeBoneSurfaceProbability(const double* inputBuffer, double* outputBuffer)
+{
+  const int nx = static_cast<int>(this->FrameSize[0]);
+  const int ny = static_cast<int>(this->FrameSize[1]);
+  const int sliceSize = nx * ny;
+
+  // Convolve with Gaussian kernel and normalize result between zero and one
+  SeparableConv2(inputBuffer, this->MklGaussianKernel1D, this->MklGaussianBufferTemp, this->MklGaussianBuffer, nx, ny, this->GaussianKernelSize);
+  Normalize(this->MklGaussianBuffer, sliceSize, false);
+
+  // Convolve blurred image with Laplacian kernel
+  Laplacian(this->MklGaussianBuffer, this->MklLaplacianOfGaussianBuffer, nx, ny);
+
+  // Reflection number and shadow value
+  PlusWorkerPool::GetInstance().ParallelFor(0, ny, this->NumberOfThreads, [this, nx, ny](int firstRow, int lastRow)
+  {
+    std::vector<double> shadowSums(nx);
+    for (int y = firstRow; y < lastRow; ++y)
+    {
+      // Weighted sums of the blurred pixels below the row, the same summation order as the reference implementation
+      bool shadowSumsComputed = false;
+      for (int x = 0; x < nx; ++x)
+      {
+        const int pixelIdx = x + y * nx;
+
+        // Only include pixels with intensity value larger than a specified threshold
+        if (this->MklGaussianBuffer[pixelIdx] >= this->BoneThreshold && pixelIdx > this->TransducerMargin * nx)
+        {
+          // Set outermost border pixels to zero and exclude negative pixels
+          if ((x == nx - 1 || x == 0 || y == ny - 1 || y == 0) || this->MklLaplacianOfGaussianBuffer[pixelIdx] <= 0)
+          {
+            this->MklLaplacianOfGaussianBuffer[pixelIdx] = 0.0;
+          }
+          else
+          {
+            this->MklLaplacianOfGaussianBuffer[pixelIdx] = this->MklLaplacianOfGaussianBuffer[pixelIdx] / 0.005;
+          }
+
+          // Calculate reflection number
+          this->MklReflectionNumberBuffer[pixelIdx] = pow(this->MklGaussianBuffer[pixelIdx], this->BlurredVSBLoG) + this->MklLaplacianOfGaussianBuffer[pixelIdx];
+
+          // Calculate shadow value
+          if (!shadowSumsComputed)
+          {
+            std::fill(shadowSums.begin(), shadowSums.end(), 0.0);
+            for (int i = y; i < ny; ++i)
+            {
+              const double weight = this->MklShadowModel[i - y];
+              const double* blurredRow = this->MklGaussianBuffer + i * nx;
+              for (int column = 0; column < nx; ++column)
+              {
+                shadowSums[column] += weight * blurredRow[column];
+              }
+            }
+            shadowSumsComputed = true;
+          }
+          this->MklShadowValueBuffer[pixelIdx] = shadowSums[x] / this->MklShadowModelSum[y];
+        }
+        else
+        {
+          this->MklReflectionNumberBuffer[pixelIdx] = 0.0;
+          this->MklShadowValueBuffer[pixelIdx] = 0.0;
+        }
+      }
+    }
+  });
+
+  // Normalize both reflection numbers and shadow values
+  Normalize(this->MklReflectionNumberBuffer, sliceSize, false);
+  Normalize(this->MklShadowValueBuffer, sliceSize, true);
+
+  // Calculate BSP
+  vdPowx(sliceSize, this->MklShadowValueBuffer, this->ShadowVSIntensity, this->MklShadowValueBuffer);
+  vdMul(sliceSize, this->MklShadowValueBuffer, this->MklReflectionNumberBuffer, outputBuffer);
+
+  // Normalize BSP
+  Normalize(outputBuffer, sliceSize, false, 255);
+}
+
 //-----------------------------------------------------------------------------
 void vtkPlusForoughiBoneSurfaceProbability::UpdateKernels()
 {
@@ -225,6 +330,10 @@ void vtkPlusForoughiBoneSurfaceProbability::UpdateKernels()
   this->MklShadowModel = (double*)mkl_malloc(this->FrameSize[1] * sizeof(double), 64);
   this->MklGaussianKernel = (double*)mkl_malloc(GaussianKernelSize * GaussianKernelSize * sizeof(double), 64);
   this->MklLaplacianKernel = (double*)mkl_malloc(3 * 3 * sizeof(double), 64);
+  this->MklGaussianKernel1D = (double*)mkl_malloc(GaussianKernelSize * sizeof(double), 64);
+  this->MklShadowModelSum = (double*)mkl_malloc(this->FrameSize[1] * sizeof(double), 64);
+  this->KernelSmoothingSigma = this->SmoothingSigma;
+  this->KernelShadowSigma = this->ShadowSigma;
 
   // Calculate shadow model
   for (int i = 0; i < this->FrameSize[1]; ++i)
@@ -238,6 +347,15 @@ void vtkPlusForoughiBoneSurfaceProbability::UpdateKernels()
       this->MklShadowModel[i] = 0.0;
     }
   }
+  for (int y = 0; y < this->FrameSize[1]; ++y)
+  {
+    double sumG = 0;
+    for (int i = y; i < this->FrameSize[1]; ++i)
+    {
+      sumG += this->MklShadowModel[i - y];
+    }
+    this->MklShadowModelSum[y] = sumG;
+  }
 
   // Calculate Gaussian kernel
   int idx = 0;
@@ -250,6 +368,10 @@ void vtkPlusForoughiBoneSurfaceProbability::UpdateKernels()
       ++idx;
     }
   }
+  for (int i = -intervall; i <= intervall; ++i)
+  {
+    this->MklGaussianKernel1D[i + intervall] = exp(-(i * i) / (2 * this->SmoothingSigma * this->SmoothingSigma));
+  }
 
   // Calculate Laplacian kernel
   this->MklLaplacianKernel[0] = 0;
@@ -276,6 +398,8 @@ void vtkPlusForoughiBoneSurfaceProbability::DeleteKernels()
   MKL_FREE_IF_NULL(this->MklShadowModel);
   MKL_FREE_IF_NULL(this->MklGaussianKernel);
   MKL_FREE_IF_NULL(this->MklLaplacianKernel);
+  MKL_FREE_IF_NULL(this->MklGaussianKernel1D);
+  MKL_FREE_IF_NULL(this->MklShadowModelSum);
 }
 
 //-----------------------------------------------------------------------------
@@ -299,6 +423,91 @@ void vtkPlusForoughiBoneSurfaceProbability::Conv2(const double* inputBuffer, con
   LOG_INFO("Resizematrix: " << timer->GetElapsedTime());
 }
 
+//-----------------------------------------------------------------------------
+// Convolution with the outer product of a one-dimensional kernel by itself. The image is padded with zeros and the
+// result has the size of the input, as the output of Conv2.
+void vtkPlusForoughiBoneSurfaceProbability::SeparableConv2(const double* inputBuffer, const double* kernelBuffer, double* tempBuffer, double* outputBuffer, int nx, int ny, int kernelSize)
+{
+  const int radius = (kernelSize - 1) / 2;
+  PlusWorkerPool& workerPool = PlusWorkerPool::GetInstance();
+
+  // Convolve the rows
+  workerPool.ParallelFor(0, ny, this->NumberOfThreads, [ = ](int firstRow, int lastRow)
+  {
+    for (int y = firstRow; y < lastRow; ++y)
+    {
+      const double* inputRow = inputBuffer + y * nx;
+      double* tempRow = tempBuffer + y * nx;
+      for (int x = 0; x < nx; ++x)
+      {
+        const int firstOffset = std::max(-radius, -x);
+        const int lastOffset = std::min(radius, nx - 1 - x);
+        double sum = 0.0;
+        for (int k = firstOffset; k <= lastOffset; ++k)
+        {
+          sum += kernelBuffer[k + radius] * inputRow[x + k];
+        }
+        tempRow[x] = sum;
+      }
+    }
+  });
+
+  // Convolve the columns, the rows are accumulated so that the memory is accessed sequentially
+  workerPool.ParallelFor(0, ny, this->NumberOfThreads, [ = ](int firstRow, int lastRow)
+  {
+    for (int y = firstRow; y < lastRow; ++y)
+    {
+      double* outputRow = outputBuffer + y * nx;
+      std::fill(outputRow, outputRow + nx, 0.0);
+      const int firstOffset = std::max(-radius, -y);
+      const int lastOffset = std::min(radius, ny - 1 - y);
+      for (int k = firstOffset; k <= lastOffset; ++k)
+      {
+        const double weight = kernelBuffer[k + radius];
+        const double* tempRow = tempBuffer + (y + k) * nx;
+        for (int x = 0; x < nx; ++x)
+        {
+          outputRow[x] += weight * tempRow[x];
+        }
+      }
+    }
+  });
+}
+
+//-----------------------------------------------------------------------------
+// Convolution with the Laplacian kernel of UpdateKernels. The image is padded with zeros, as in Conv2.
+void vtkPlusForoughiBoneSurfaceProbability::Laplacian(const double* inputBuffer, double* outputBuffer, int nx, int ny)
+{
+  PlusWorkerPool::GetInstance().ParallelFor(0, ny, this->NumberOfThreads, [ = ](int firstRow, int lastRow)
+  {
+    for (int y = firstRow; y < lastRow; ++y)
+    {
+      const double* row = inputBuffer + y * nx;
+      for (int x = 0; x < nx; ++x)
+      {
+        double value = 4 * row[x];
+        if (x > 0)
+        {
+          value -= row[x - 1];
+        }
+        if (x < nx - 1)
+        {
+          value -= row[x + 1];
+        }
+        if (y > 0)
+        {
+          value -= row[x - nx];
+        }
+        if (y < ny - 1)
+        {
+          value -= row[x + nx];
+        }
+        outputBuffer[x + y * nx] = value;
+      }
+    }
+  });
+}
+
 //-----------------------------------------------------------------------------
 void vtkPlusForoughiBoneSurfaceProbability::ResizeMatrix(const double* inputBuffer, double* outputBuffer, int xClipping, int yClipping, int xInputSize, int yInputSize)
 {
@@ -325,13 +534,20 @@ void vtkPlusForoughiBoneSurfaceProbability::ResizeMatrix(const double* inputBuff
 double vtkPlusForoughiBoneSurfaceProbability::GetMaxPixelValue(const double* buffer, int size)
 {
   double maxPixelValue = 0;
-  for (int i = 0; i < size; ++i)
+  std::mutex maxPixelValueMutex;
+  PlusWorkerPool::GetInstance().ParallelFor(0, size, this->NumberOfThreads, [&](int first, int last)
   {
-    if (buffer[i] > maxPixelValue)
+    double partMaxPixelValue = 0;
+    for (int i = first; i < last; ++i)
     {
-      maxPixelValue = buffer[i];
+      if (buffer[i] > partMaxPixelValue)
+      {
+        partMaxPixelValue = buffer[i];
+      }
     }
-  }
+    std::lock_guard<std::mutex> lock(maxPixelValueMutex);
+    maxPixelValue = std::max(maxPixelValue, partMaxPixelValue);
+  });
   return maxPixelValue;
 }
 
@@ -340,17 +556,20 @@ void vtkPlusForoughiBoneSurfaceProbability::Normalize(double* buffer, int size,
 {
   double maxPixelValue = GetMaxPixelValue(buffer, size) / maxValue;
 
-  if (!doInverse)
+  PlusWorkerPool::GetInstance().ParallelFor(0, size, this->NumberOfThreads, [ = ](int first, int last)
   {
-    for (int i = 0; i < size; ++i)
+    if (!doInverse)
     {
-      buffer[i] =  buffer[i] / maxPixelValue;
+      for (int i = first; i < last; ++i)
+      {
+        buffer[i] =  buffer[i] / maxPixelValue;
+      }
+      return;
     }
-    return;
-  }
 
-  for (int i = 0; i < size; ++i)
-  {
-    buffer[i] = maxValue - buffer[i] / maxPixelValue;
-  }
+    for (int i = first; i < last; ++i)
+    {
+      buffer[i] = maxValue - buffer[i] / maxPixelValue;
+    }
+  });
 }
\ No newline at end of file
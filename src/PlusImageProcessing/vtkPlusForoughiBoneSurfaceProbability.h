@@ -20,6 +20,9 @@ Implemented (with some modifications) by Mikael Brudfors, March 2014.
 
 The *Intel MKL* code uses double data at this moment, therefore input and output must be double scalar type image.
 
+By default the Gaussian blurring is computed by separable convolution and the rows of the image are processed in
+parallel by the shared worker pool (see UseSeparableConvolution).
+
 The module uses *OpenMP* and *Intel MKL*. A free trial of *Intel MKL* can be downloaded from here:
 
 [https://software.intel.com/en-us/intel-mkl/try-buy](https://software.intel.com/en-us/intel-mkl/try-buy)
@@ -62,6 +65,19 @@ public:
   vtkSetMacro(TransducerMargin, int);
   vtkGetMacro(TransducerMargin, int);
 
+  /*!
+    If enabled (default) then the Gaussian blurring is computed as two one-dimensional convolutions and the image rows
+    are processed in parallel by the shared worker pool. If disabled then the original implementation with a two-dimensional
+    Intel MKL convolution is used, which is kept as reference.
+  */
+  vtkSetMacro(UseSeparableConvolution, bool);
+  vtkGetMacro(UseSeparableConvolution, bool);
+  vtkBooleanMacro(UseSeparableConvolution, bool);
+
+  /*! Number of parallel tasks that the image rows are split into. 0 means one task for each worker thread and one for the calling thread. */
+  vtkSetMacro(NumberOfThreads, int);
+  vtkGetMacro(NumberOfThreads, int);
+
 protected:
   vtkPlusForoughiBoneSurfaceProbability();
   virtual ~vtkPlusForoughiBoneSurfaceProbability();
@@ -69,6 +85,11 @@ protected:
   void UpdateKernels();
   void DeleteKernels();
 
+  /*! Compute the bone surface probability of a slice with separable convolution, processing the rows in parallel */
+  void ComputeBoneSurfaceProbability(const double* inputBuffer, double* outputBuffer);
+  void SeparableConv2(const double* inputBuffer, const double* kernelBuffer, double* tempBuffer, double* outputBuffer, int nx, int ny, int kernelSize);
+  void Laplacian(const double* inputBuffer, double* outputBuffer, int nx, int ny);
+
   void Foroughi2007(double* inputBuffer, double* outputBuffer, double smoothingSigma, int transducerMargin, double shadowSigma, double boneThreshold, int blurredVSBLoG, int shadowVSIntensity, int nx, int ny, int nz);
   void Conv2(const double* inputBuffer, const double* kernelBuffer, double* tempBuffer, double* outputBuffer, int nx, int ny, int kx, int ky);
   void ResizeMatrix(const double* inputBuffer, double* outputBuffer, int xClipping, int yClipping, int xInputSize, int yInputSize);
@@ -83,8 +104,13 @@ protected:
   int ShadowVSIntensity;
   double SmoothingSigma;
   int TransducerMargin;
+  bool UseSeparableConvolution;
+  int NumberOfThreads;
 
   bool KernelUpdateRequested;
+  /*! Parameters that the current kernels are computed for */
+  double KernelSmoothingSigma;
+  double KernelShadowSigma;
 
   int GaussianKernelSize;
   FrameSizeType FrameSize;
@@ -98,6 +124,10 @@ protected:
   double* MklShadowModel;
   double* MklGaussianKernel;
   double* MklLaplacianKernel;
+  /*! One-dimensional Gaussian kernel, the two-dimensional kernel is its outer product */
+  double* MklGaussianKernel1D;
+  /*! Sum of the shadow model weights below each row of the image */
+  double* MklShadowModelSum;
 
 private:
   vtkPlusForoughiBoneSurfaceProbability(const vtkPlusForoughiBoneSurfaceProbability&);  // Not implemented.
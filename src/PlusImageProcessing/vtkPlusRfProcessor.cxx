@@ -5,6 +5,7 @@ See License.txt for details.
 =========================================================Plus=header=end*/ 
 
 #include "PlusConfigure.h"
+#include "PlusProfiler.h"
 #include "PlusMath.h"
 #include "vtkPlusRfProcessor.h"
 #include "vtkObjectFactory.h"
@@ -43,6 +44,7 @@ void vtkPlusRfProcessor::PrintSelf(ostream& os, vtkIndent indent)
 //-----------------------------------------------------------------------------
 PlusStatus vtkPlusRfProcessor::SetRfFrame(vtkImageData* rfFrame, US_IMAGE_TYPE imageType)
 {
+  PLUS_PROFILE_ZONE("vtkPlusRfProcessor::SetRfFrame");
   this->RfToBrightnessConverter->SetInputData(rfFrame);
   this->RfToBrightnessConverter->SetImageType(imageType);
   return PLUS_SUCCESS;
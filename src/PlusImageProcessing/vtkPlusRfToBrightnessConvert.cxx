@@ -5,29 +5,62 @@ See License.txt for details.
 =========================================================Plus=header=end*/
 
 #include "PlusConfigure.h"
+#include "PlusProfiler.h"
 
 #include "vtkPlusRfToBrightnessConvert.h"
 
+// IGSIO includes
+#include "vtkIGSIOAccurateTimer.h"
+
 #include "vtkImageData.h"
 #include "vtkInformation.h"
 #include "vtkInformationVector.h"
+#include "vtkMultiThreader.h"
 #include "vtkObjectFactory.h"
 #include "vtkStreamingDemandDrivenPipeline.h"
 #include "vtkMath.h"
 
+#include <algorithm>
 #include <math.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define PLUS_RFTOBRIGHTNESS_SSE2
+  #include <emmintrin.h>
+#endif
 
 vtkStandardNewMacro(vtkPlusRfToBrightnessConvert);
 
 const double MIN_BRIGHTNESS_VALUE = 0.0;
 const double MAX_BRIGHTNESS_VALUE = 255.0;
 
+// Number of samples whose squared amplitudes are computed at once, before the brightness values are looked up
+const int BRIGHTNESS_CHUNK_SIZE = 256;
+// Squared amplitudes are indexed in the lookup table by the exponent and the first mantissa bits of their float value
+const int BRIGHTNESS_LOOKUP_TABLE_MANTISSA_BITS = 7;
+const int BRIGHTNESS_LOOKUP_TABLE_SHIFT = 23 - BRIGHTNESS_LOOKUP_TABLE_MANTISSA_BITS;
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  // Dynamic range compression of a squared amplitude, the reference for the lookup tables
+  unsigned char ComputeBrightnessFromSquaredAmplitude(double squaredAmplitude, double brightnessScale)
+  {
+    double brightnessValue = sqrt(sqrt(sqrt(squaredAmplitude))) * brightnessScale;
+    if (brightnessValue > MAX_BRIGHTNESS_VALUE) { brightnessValue = MAX_BRIGHTNESS_VALUE; }
+    if (brightnessValue < MIN_BRIGHTNESS_VALUE) { brightnessValue = MIN_BRIGHTNESS_VALUE; }
+    return static_cast<unsigned char>(brightnessValue);
+  }
+}
+
 //----------------------------------------------------------------------------
 vtkPlusRfToBrightnessConvert::vtkPlusRfToBrightnessConvert()
 {
   this->ImageType = US_IMG_TYPE_XX;
   this->BrightnessScale = 10.0;
   this->NumberOfHilbertFilterCoeffs = 64;
+  this->BrightnessLookupTableScale = 0.0;
+  this->LastProcessingTimeSec = 0.0;
 }
 
 //----------------------------------------------------------------------------
@@ -98,9 +131,41 @@ int vtkPlusRfToBrightnessConvert::RequestInformation(vtkInformation*,
   // Output is B-mode image, the pixel type is always unsigned 8-bit integer
   vtkDataObject::SetPointDataActiveScalarInfo(outInfo, VTK_UNSIGNED_CHAR, -1);
 
+  // The tables are read by all threads, so they are computed before the threads are started
+  ComputeHilbertTransformCoeffs();
+  ComputeBrightnessLookupTables();
+
   return 1;
 }
 
+//----------------------------------------------------------------------------
+int vtkPlusRfToBrightnessConvert::RequestData(vtkInformation* request, vtkInformationVector** inputVector, vtkInformationVector* outputVector)
+{
+  double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+  int result = this->Superclass::RequestData(request, inputVector, outputVector);
+  this->LastProcessingTimeSec = vtkIGSIOAccurateTimer::GetSystemTime() - startTime;
+  LOG_TRACE("RF to brightness conversion time: " << this->LastProcessingTimeSec * 1000.0 << "ms");
+  return result;
+}
+
+//----------------------------------------------------------------------------
+int vtkPlusRfToBrightnessConvert::SplitExtent(int splitExt[6], int startExt[6], int num, int total)
+{
+  std::copy(startExt, startExt + 6, splitExt);
+  int numberOfLines = startExt[3] - startExt[2] + 1;
+  int numberOfPieces = std::min(total, numberOfLines);
+  if (numberOfPieces <= 1)
+  {
+    return 1;
+  }
+  if (num < numberOfPieces)
+  {
+    splitExt[2] = startExt[2] + numberOfLines * num / numberOfPieces;
+    splitExt[3] = startExt[2] + numberOfLines * (num + 1) / numberOfPieces - 1;
+  }
+  return numberOfPieces;
+}
+
 //----------------------------------------------------------------------------
 void vtkPlusRfToBrightnessConvert::ThreadedRequestData(
   vtkInformation* vtkNotUsed(request),
@@ -110,6 +175,7 @@ void vtkPlusRfToBrightnessConvert::ThreadedRequestData(
   vtkImageData** outData,
   int outExt[6], int id)
 {
+  PLUS_PROFILE_ZONE("vtkPlusRfToBrightnessConvert::ThreadedRequestData");
   if (outData[0]->GetScalarType() != VTK_UNSIGNED_CHAR)
   {
     vtkErrorMacro("Expecting VTK_UNSIGNED_CHAR output pixel type");
@@ -241,6 +307,7 @@ void vtkPlusRfToBrightnessConvert::ThreadedLineByLineHilbertTransform(int inExt[
   }
 
   ScalarType* hilbertTransformBuffer = new ScalarType[numberOfRfSamplesInScanline + 1];
+  std::vector<double> hilbertTransformInputBuffer(numberOfRfSamplesInScanline + 1);
   for (int idx2 = outExt[4]; idx2 <= outExt[5]; ++idx2)
   {
     for (int idx1 = outExt[2]; !this->AbortExecute && idx1 <= outExt[3]; ++idx1)
@@ -273,7 +340,7 @@ void vtkPlusRfToBrightnessConvert::ThreadedLineByLineHilbertTransform(int inExt[
           {
             // e.g., Ultrasonix
             // RF data: IIIII..., IIIII...
-            ComputeHilbertTransform(hilbertTransformBuffer, inPtr, numberOfRfSamplesInScanline);
+            ComputeHilbertTransform(hilbertTransformBuffer, inPtr, numberOfRfSamplesInScanline, &hilbertTransformInputBuffer[0]);
             ComputeAmplitudeILineQLine(outPtr, inPtr, hilbertTransformBuffer, numberOfRfSamplesInScanline);
             inPtr += numberOfRfSamplesInScanline + inInc1;
             outPtr += numberOfBmodeSamplesInScanline + outInc1;
@@ -306,6 +373,9 @@ void vtkPlusRfToBrightnessConvert::ThreadedLineByLineHilbertTransform(int inExt[
 void vtkPlusRfToBrightnessConvert::PrintSelf(ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os, indent);
+  os << indent << "BrightnessScale: " << this->BrightnessScale << "\n";
+  os << indent << "NumberOfHilbertFilterCoeffs: " << this->NumberOfHilbertFilterCoeffs << "\n";
+  os << indent << "LastProcessingTimeSec: " << this->LastProcessingTimeSec << "\n";
 }
 
 //-----------------------------------------------------------------------------
@@ -315,6 +385,7 @@ PlusStatus vtkPlusRfToBrightnessConvert::ReadConfiguration(vtkXMLDataElement* rf
   XML_VERIFY_ELEMENT(rfToBrightnessElement, "RfToBrightnessConversion");
   XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, NumberOfHilbertFilterCoeffs, rfToBrightnessElement);
   XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, BrightnessScale, rfToBrightnessElement);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, NumberOfThreads, rfToBrightnessElement);
   return PLUS_SUCCESS;
 }
 
@@ -327,6 +398,14 @@ PlusStatus vtkPlusRfToBrightnessConvert::WriteConfiguration(vtkXMLDataElement* r
 
   rfToBrightnessElement->SetDoubleAttribute("NumberOfHilbertFilterCoeffs", this->NumberOfHilbertFilterCoeffs);
   rfToBrightnessElement->SetDoubleAttribute("BrightnessScale", this->BrightnessScale);
+  if (this->GetNumberOfThreads() != vtkMultiThreader::GetGlobalDefaultNumberOfThreads())
+  {
+    rfToBrightnessElement->SetIntAttribute("NumberOfThreads", this->GetNumberOfThreads());
+  }
+  else
+  {
+    XML_REMOVE_ATTRIBUTE("NumberOfThreads", rfToBrightnessElement);
+  }
 
   return PLUS_SUCCESS;
 }
@@ -367,8 +446,167 @@ void vtkPlusRfToBrightnessConvert::ComputeHilbertTransformCoeffs()
   }
 }
 
+//-----------------------------------------------------------------------------
+void vtkPlusRfToBrightnessConvert::ComputeBrightnessLookupTables()
+{
+  if (!this->BrightnessThresholds.empty() && this->BrightnessLookupTableScale == this->BrightnessScale)
+  {
+    // already computed for the current brightness scale
+    return;
+  }
+  this->BrightnessLookupTableScale = this->BrightnessScale;
+
+  // The compression function is monotonic, so the threshold of each brightness value can be found by binary search.
+  // Squared amplitudes are 32-bit unsigned integers, 2^32 means that the brightness value is never reached.
+  const unsigned long long numberOfSquaredAmplitudes = 1ULL << 32;
+  this->BrightnessThresholds.resize(256);
+  this->BrightnessThresholds[0] = 0;
+  for (int brightness = 1; brightness < 256; brightness++)
+  {
+    unsigned long long low = this->BrightnessThresholds[brightness - 1];
+    unsigned long long high = numberOfSquaredAmplitudes;
+    while (low < high)
+    {
+      unsigned long long middle = low + (high - low) / 2;
+      if (ComputeBrightnessFromSquaredAmplitude(static_cast<double>(middle), this->BrightnessScale) >= brightness)
+      {
+        high = middle;
+      }
+      else
+      {
+        low = middle + 1;
+      }
+    }
+    this->BrightnessThresholds[brightness] = low;
+  }
+
+  // Brightness at the lower bound of each float range, only used as a starting point for the search in the thresholds
+  const int numberOfBuckets = 1 << (32 - BRIGHTNESS_LOOKUP_TABLE_SHIFT);
+  this->BrightnessLookupTable.resize(numberOfBuckets);
+  for (int bucket = 0; bucket < numberOfBuckets; bucket++)
+  {
+    unsigned int bits = static_cast<unsigned int>(bucket) << BRIGHTNESS_LOOKUP_TABLE_SHIFT;
+    float lowerBound = 0;
+    memcpy(&lowerBound, &bits, sizeof(lowerBound));
+    double squaredAmplitude = (lowerBound >= 0 ? std::min(static_cast<double>(lowerBound), static_cast<double>(numberOfSquaredAmplitudes - 1)) : 0.0);
+    if (squaredAmplitude != squaredAmplitude)
+    {
+      // NaN
+      squaredAmplitude = 0.0;
+    }
+    this->BrightnessLookupTable[bucket] = ComputeBrightnessFromSquaredAmplitude(floor(squaredAmplitude), this->BrightnessScale);
+  }
+}
+
+//-----------------------------------------------------------------------------
+unsigned char vtkPlusRfToBrightnessConvert::GetBrightnessFromSquaredAmplitude(unsigned int squaredAmplitude) const
+{
+  float squaredAmplitudeFloat = static_cast<float>(squaredAmplitude);
+  unsigned int bits = 0;
+  memcpy(&bits, &squaredAmplitudeFloat, sizeof(bits));
+  int brightness = this->BrightnessLookupTable[bits >> BRIGHTNESS_LOOKUP_TABLE_SHIFT];
+  // The float value may be rounded up to the next range, so the search in the thresholds may go in both directions
+  const unsigned long long* thresholds = &this->BrightnessThresholds[0];
+  while (brightness < 255 && squaredAmplitude >= thresholds[brightness + 1])
+  {
+    brightness++;
+  }
+  while (brightness > 0 && squaredAmplitude < thresholds[brightness])
+  {
+    brightness--;
+  }
+  return static_cast<unsigned char>(brightness);
+}
+
+//-----------------------------------------------------------------------------
 template<typename ScalarType>
-PlusStatus vtkPlusRfToBrightnessConvert::ComputeHilbertTransform(ScalarType* hilbertTransformOutput, ScalarType* input, int npt)
+void vtkPlusRfToBrightnessConvert::ComputeBrightness(unsigned char* brightness, const ScalarType* inputSignal, const ScalarType* phaseShiftedSignal, int count)
+{
+  for (int i = 0; i < count; i++)
+  {
+    double xt = inputSignal[i];
+    double xht = phaseShiftedSignal[i];
+    brightness[i] = ComputeBrightnessFromSquaredAmplitude(xt * xt + xht * xht, this->BrightnessScale);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkPlusRfToBrightnessConvert::ComputeBrightness(unsigned char* brightness, const short* inputSignal, const short* phaseShiftedSignal, int count)
+{
+  // Squared amplitudes of 16-bit samples are exact 32-bit unsigned integers, so the lookup tables give the same result as the compression function
+  unsigned int squaredAmplitudes[BRIGHTNESS_CHUNK_SIZE];
+  for (int chunkStart = 0; chunkStart < count; chunkStart += BRIGHTNESS_CHUNK_SIZE)
+  {
+    const int chunkSize = std::min(BRIGHTNESS_CHUNK_SIZE, count - chunkStart);
+    const short* xt = inputSignal + chunkStart;
+    const short* xht = phaseShiftedSignal + chunkStart;
+    int i = 0;
+#ifdef PLUS_RFTOBRIGHTNESS_SSE2
+    for (; i + 8 <= chunkSize; i += 8)
+    {
+      __m128i xtValues = _mm_loadu_si128(reinterpret_cast<const __m128i*>(xt + i));
+      __m128i xhtValues = _mm_loadu_si128(reinterpret_cast<const __m128i*>(xht + i));
+      // Interleave I and Q, then xt*xt+xht*xht of each sample is the sum of a pair of products
+      __m128i iq0 = _mm_unpacklo_epi16(xtValues, xhtValues);
+      __m128i iq1 = _mm_unpackhi_epi16(xtValues, xhtValues);
+      // The only overflow is 2*(-32768)^2=2^31, which is correct as an unsigned integer
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(squaredAmplitudes + i), _mm_madd_epi16(iq0, iq0));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(squaredAmplitudes + i + 4), _mm_madd_epi16(iq1, iq1));
+    }
+#endif
+    for (; i < chunkSize; i++)
+    {
+      squaredAmplitudes[i] = static_cast<unsigned int>(xt[i] * xt[i]) + static_cast<unsigned int>(xht[i] * xht[i]);
+    }
+    for (i = 0; i < chunkSize; i++)
+    {
+      brightness[chunkStart + i] = GetBrightnessFromSquaredAmplitude(squaredAmplitudes[i]);
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+template<typename ScalarType>
+void vtkPlusRfToBrightnessConvert::ComputeBrightnessIq(unsigned char* brightness, const ScalarType* iqSignal, int count)
+{
+  for (int i = 0; i < count; i++)
+  {
+    double xt = iqSignal[2 * i];
+    double xht = iqSignal[2 * i + 1];
+    brightness[i] = ComputeBrightnessFromSquaredAmplitude(xt * xt + xht * xht, this->BrightnessScale);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkPlusRfToBrightnessConvert::ComputeBrightnessIq(unsigned char* brightness, const short* iqSignal, int count)
+{
+  unsigned int squaredAmplitudes[BRIGHTNESS_CHUNK_SIZE];
+  for (int chunkStart = 0; chunkStart < count; chunkStart += BRIGHTNESS_CHUNK_SIZE)
+  {
+    const int chunkSize = std::min(BRIGHTNESS_CHUNK_SIZE, count - chunkStart);
+    const short* iq = iqSignal + 2 * chunkStart;
+    int i = 0;
+#ifdef PLUS_RFTOBRIGHTNESS_SSE2
+    for (; i + 4 <= chunkSize; i += 4)
+    {
+      __m128i iqValues = _mm_loadu_si128(reinterpret_cast<const __m128i*>(iq + 2 * i));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(squaredAmplitudes + i), _mm_madd_epi16(iqValues, iqValues));
+    }
+#endif
+    for (; i < chunkSize; i++)
+    {
+      squaredAmplitudes[i] = static_cast<unsigned int>(iq[2 * i] * iq[2 * i]) + static_cast<unsigned int>(iq[2 * i + 1] * iq[2 * i + 1]);
+    }
+    for (i = 0; i < chunkSize; i++)
+    {
+      brightness[chunkStart + i] = GetBrightnessFromSquaredAmplitude(squaredAmplitudes[i]);
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+template<typename ScalarType>
+PlusStatus vtkPlusRfToBrightnessConvert::ComputeHilbertTransform(ScalarType* hilbertTransformOutput, ScalarType* input, int npt, double* inputBuffer)
 {
   ComputeHilbertTransformCoeffs(); // update the transform coefficients if needed
 
@@ -378,13 +616,44 @@ PlusStatus vtkPlusRfToBrightnessConvert::ComputeHilbertTransform(ScalarType* hil
     return PLUS_FAIL;
   }
 
+  // Convert the samples once, each of them is used by NumberOfHilbertFilterCoeffs outputs
+  for (int i = 0; i <= npt; i++)
+  {
+    inputBuffer[i] = input[i];
+  }
+
   // Compute Hilbert transform by convolution
-  for (int l = 1; l <= npt - this->NumberOfHilbertFilterCoeffs + 1; l++)
+  const int numberOfCoeffs = this->NumberOfHilbertFilterCoeffs;
+  const double* coeffs = &this->HilbertTransformCoeffs[0];
+  const int lastOutputIndex = npt - numberOfCoeffs + 1;
+  int l = 1;
+#ifdef PLUS_RFTOBRIGHTNESS_SSE2
+  // 4 outputs at once, each of them is summed in the same order as in the scalar loop, so the results are the same
+  for (; l + 3 <= lastOutputIndex; l += 4)
+  {
+    __m128d yt01 = _mm_setzero_pd();
+    __m128d yt23 = _mm_setzero_pd();
+    for (int i = 1; i <= numberOfCoeffs; i++)
+    {
+      __m128d coeff = _mm_set1_pd(coeffs[numberOfCoeffs + 1 - i]);
+      yt01 = _mm_add_pd(yt01, _mm_mul_pd(_mm_loadu_pd(inputBuffer + l + i - 1), coeff));
+      yt23 = _mm_add_pd(yt23, _mm_mul_pd(_mm_loadu_pd(inputBuffer + l + i + 1), coeff));
+    }
+    double yt[4];
+    _mm_storeu_pd(yt, yt01);
+    _mm_storeu_pd(yt + 2, yt23);
+    hilbertTransformOutput[l] = yt[0];
+    hilbertTransformOutput[l + 1] = yt[1];
+    hilbertTransformOutput[l + 2] = yt[2];
+    hilbertTransformOutput[l + 3] = yt[3];
+  }
+#endif
+  for (; l <= lastOutputIndex; l++)
   {
     double yt = 0.0;
-    for (int i = 1; i <= this->NumberOfHilbertFilterCoeffs; i++)
+    for (int i = 1; i <= numberOfCoeffs; i++)
     {
-      yt += input[l + i - 1] * this->HilbertTransformCoeffs[this->NumberOfHilbertFilterCoeffs + 1 - i];
+      yt += inputBuffer[l + i - 1] * coeffs[numberOfCoeffs + 1 - i];
     }
     hilbertTransformOutput[l] = yt;
   }
@@ -416,24 +685,21 @@ void vtkPlusRfToBrightnessConvert::ComputeAmplitudeILineQLine(unsigned char* amp
   {
     ampl[i] = 0;
   }
-  for (int i = this->NumberOfHilbertFilterCoeffs / 2 + 1; i <= npt - this->NumberOfHilbertFilterCoeffs / 2; i++)
+  int firstSample = this->NumberOfHilbertFilterCoeffs / 2 + 1;
+  int lastSample = npt - this->NumberOfHilbertFilterCoeffs / 2;
+  if (lastSample >= firstSample)
   {
-    double xt = inputSignal[i];
-    double xht = inputSignalHilbertTransformed[i];
-    double brightnessValue = sqrt(sqrt(sqrt(xt * xt + xht * xht))) * this->BrightnessScale;
-    if (brightnessValue > MAX_BRIGHTNESS_VALUE) { brightnessValue = MAX_BRIGHTNESS_VALUE; }
-    if (brightnessValue < MIN_BRIGHTNESS_VALUE) { brightnessValue = MIN_BRIGHTNESS_VALUE; }
-    ampl[i] = brightnessValue;
-    /*
-    If needed, the phase could be computed as follows:
-    phase[i] = atan2(xht ,xt);
-    omega[i] = phase[i]-phase[i-1];
-    if (omega[i]<0)
-    {
-      omega[i]+=2*pi;
-    }
-    */
+    ComputeBrightness(ampl + firstSample, inputSignal + firstSample, inputSignalHilbertTransformed + firstSample, lastSample - firstSample + 1);
   }
+  /*
+  If needed, the phase could be computed as follows:
+  phase[i] = atan2(xht ,xt);
+  omega[i] = phase[i]-phase[i-1];
+  if (omega[i]<0)
+  {
+    omega[i]+=2*pi;
+  }
+  */
   for (int i = npt - this->NumberOfHilbertFilterCoeffs / 2 + 1; i < npt; i++)
   {
     ampl[i] = 0;
@@ -443,16 +709,6 @@ void vtkPlusRfToBrightnessConvert::ComputeAmplitudeILineQLine(unsigned char* amp
 template<typename ScalarType>
 void vtkPlusRfToBrightnessConvert::ComputeAmplitudeIqLine(unsigned char* ampl, ScalarType* inputSignal, const int npt)
 {
-  int inputIndex = 0;
-  int outputIndex = 0;
   int numberOfIqPairs = floor(double(npt) / 2);
-  for (int i = 0; i < numberOfIqPairs; i++)
-  {
-    double xt = inputSignal[inputIndex++];
-    double xht = inputSignal[inputIndex++];
-    double outputValue = sqrt(sqrt(sqrt(xt * xt + xht * xht))) * this->BrightnessScale;
-    if (outputValue > MAX_BRIGHTNESS_VALUE) { outputValue = MAX_BRIGHTNESS_VALUE; }
-    if (outputValue < MIN_BRIGHTNESS_VALUE) { outputValue = MIN_BRIGHTNESS_VALUE; }
-    ampl[outputIndex++] = outputValue;
-  }
+  ComputeBrightnessIq(ampl, inputSignal, numberOfIqPairs);
 }
@@ -31,6 +31,10 @@ range (16 bits).
 The input image type must be VTK_SHORT (signed 16-bit) and the output image type
 is always VTK_UNSIGNED_CHAR (unsigned 8-bit).
 
+For VTK_SHORT input the squared amplitudes are computed with SIMD instructions and the dynamic range compression is
+looked up in tables that are computed when BrightnessScale changes; the output is the same as computing the compression
+function for each sample. The scan lines are split between NumberOfThreads threads.
+
 \ingroup PlusLibImageProcessingAlgo
 */ 
 class vtkPlusImageProcessingExport vtkPlusRfToBrightnessConvert : public vtkThreadedImageAlgorithm
@@ -56,6 +60,12 @@ public:
   vtkSetMacro(BrightnessScale, double);
   vtkGetMacro(BrightnessScale, double);
 
+  /*! Time of the last conversion of a frame, in seconds. Can be compared to the frame period to see if the conversion keeps up with the acquisition. */
+  vtkGetMacro(LastProcessingTimeSec, double);
+
+  /*! Measures the conversion time */
+  virtual int RequestData(vtkInformation* request, vtkInformationVector** inputVector, vtkInformationVector* outputVector) VTK_OVERRIDE;
+
 protected:
   vtkPlusRfToBrightnessConvert();
   ~vtkPlusRfToBrightnessConvert();
@@ -70,6 +80,15 @@ protected:
                             vtkImageData ***inData, vtkImageData **outData,
                             int outExt[6], int id);
 
+  /*! Split the output extent between threads by scan lines (rows), so that each thread processes complete lines */
+  virtual int SplitExtent(int splitExt[6], int startExt[6], int num, int total) VTK_OVERRIDE;
+
+  /*! Compute the tables of the dynamic range compression for the current BrightnessScale, if they have not been computed yet */
+  void ComputeBrightnessLookupTables();
+
+  /*! Dynamic range compression of the squared amplitude of a sample, using the lookup tables */
+  unsigned char GetBrightnessFromSquaredAmplitude(unsigned int squaredAmplitude) const;
+
   /*! Compute the Hilbert transform coefficients. Used by the ComputeHilbertTransform method. */
   virtual void ComputeHilbertTransformCoeffs();
 
@@ -79,7 +98,7 @@ protected:
 
   /*! Compute the Hilbert transform (90 deg phase shift) of a signal */
   template<typename ScalarType>
-  PlusStatus ComputeHilbertTransform(ScalarType *hilbertTransformOutput, ScalarType *input, int npt);
+  PlusStatus ComputeHilbertTransform(ScalarType *hilbertTransformOutput, ScalarType *input, int npt, double *inputBuffer);
   
   /*! Compute amplitude from the original and Hilbert transformed RF data. npt is the number of samples in the input signal */
   template<typename ScalarType>
@@ -89,6 +108,16 @@ protected:
   template<typename ScalarType>
   void ComputeAmplitudeIqLine(unsigned char *ampl, ScalarType *inputSignal, const int npt);
 
+  /*! Compute brightness values from the signal and the phase shifted signal (I and Q) of count samples */
+  template<typename ScalarType>
+  void ComputeBrightness(unsigned char* brightness, const ScalarType* inputSignal, const ScalarType* phaseShiftedSignal, int count);
+  void ComputeBrightness(unsigned char* brightness, const short* inputSignal, const short* phaseShiftedSignal, int count);
+
+  /*! Compute brightness values from count IQ pairs */
+  template<typename ScalarType>
+  void ComputeBrightnessIq(unsigned char* brightness, const ScalarType* iqSignal, int count);
+  void ComputeBrightnessIq(unsigned char* brightness, const short* iqSignal, int count);
+
   /*! Scaling of the brightness output. Higher value means brighter image. */
   double BrightnessScale;
 
@@ -101,6 +130,22 @@ protected:
   /*! Image type (RF_IQ_LINE, RF_I_LINE_Q_LINE, ...) */
   US_IMAGE_TYPE ImageType;
 
+  /*!
+    Smallest squared amplitude for each brightness value, computed from the BrightnessScale.
+    A sample gets the largest brightness value whose threshold is not larger than its squared amplitude.
+  */
+  std::vector<unsigned long long> BrightnessThresholds;
+  /*!
+    Approximate brightness value of squared amplitudes, indexed by the exponent and first mantissa bits of the squared amplitude
+    as a float. The exact value is found from the BrightnessThresholds, in at most a few steps.
+  */
+  std::vector<unsigned char> BrightnessLookupTable;
+  /*! BrightnessScale that the lookup tables are computed for */
+  double BrightnessLookupTableScale;
+
+  /*! Time of the last conversion of a frame, in seconds */
+  double LastProcessingTimeSec;
+
 private:
   vtkPlusRfToBrightnessConvert(const vtkPlusRfToBrightnessConvert&);  // Not implemented.
   void operator=(const vtkPlusRfToBrightnessConvert&);  // Not implemented.
@@ -5,12 +5,17 @@ See License.txt for details.
 =========================================================Plus=header=end*/
 
 #include "PlusConfigure.h"
+#include "PlusProfiler.h"
 #include "PlusMath.h"
+#include "PlusWorkerPool.h"
 #include "vtkPlusTrackedFrameProcessor.h"
 #include "vtkIGSIOTrackedFrameList.h"
 #include "vtkIGSIOTransformRepository.h"
 #include "igsioCommon.h"
 
+#include <algorithm>
+#include <atomic>
+
 //----------------------------------------------------------------------------
 vtkCxxSetObjectMacro( vtkPlusTrackedFrameProcessor, InputFrames, vtkIGSIOTrackedFrameList );
 vtkCxxSetObjectMacro( vtkPlusTrackedFrameProcessor, TransformRepository, vtkIGSIOTransformRepository );
@@ -57,6 +62,7 @@ PlusStatus vtkPlusTrackedFrameProcessor::WriteConfiguration( vtkXMLDataElement*
 //-----------------------------------------------------------------------------
 PlusStatus vtkPlusTrackedFrameProcessor::Update()
 {
+  PLUS_PROFILE_ZONE("vtkPlusTrackedFrameProcessor::Update");
   this->OutputFrames->Clear();
   if ( this->InputFrames == NULL || this->InputFrames->GetNumberOfTrackedFrames() == 0 )
   {
@@ -90,4 +96,61 @@ PlusStatus vtkPlusTrackedFrameProcessor::Update()
   }
 
   return status;
-}
\ No newline at end of file
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusTrackedFrameProcessor::ProcessTrackedFrameList(const std::vector<vtkSmartPointer<vtkPlusTrackedFrameProcessor> >& processors,
+    vtkIGSIOTrackedFrameList* inputFrames, vtkIGSIOTrackedFrameList* outputFrames)
+{
+  PLUS_PROFILE_ZONE("vtkPlusTrackedFrameProcessor::ProcessTrackedFrameList");
+  if (processors.empty() || inputFrames == NULL || outputFrames == NULL)
+  {
+    LOG_ERROR("vtkPlusTrackedFrameProcessor::ProcessTrackedFrameList failed: processors, input and output frame lists must be specified");
+    return PLUS_FAIL;
+  }
+  const int numberOfFrames = inputFrames->GetNumberOfTrackedFrames();
+  if (numberOfFrames < 1)
+  {
+    return PLUS_SUCCESS;
+  }
+  const int numberOfTasks = std::min(static_cast<int>(processors.size()), numberOfFrames);
+
+  // Each task processes a contiguous range of frames with its own processor
+  std::vector<igsioTrackedFrame*> processedFrames(numberOfFrames, NULL);
+  std::atomic<bool> failed(false);
+  PlusWorkerPool::GetInstance().ParallelFor(0, numberOfTasks, numberOfTasks, [&](int firstTask, int lastTask)
+  {
+    for (int taskIndex = firstTask; taskIndex < lastTask; taskIndex++)
+    {
+      vtkPlusTrackedFrameProcessor* processor = processors[taskIndex];
+      const int firstFrame = static_cast<int>(static_cast<long long>(numberOfFrames) * taskIndex / numberOfTasks);
+      const int lastFrame = static_cast<int>(static_cast<long long>(numberOfFrames) * (taskIndex + 1) / numberOfTasks);
+      for (int frameIndex = firstFrame; frameIndex < lastFrame; frameIndex++)
+      {
+        igsioTrackedFrame* inputFrame = inputFrames->GetTrackedFrame(frameIndex);
+        if (processor->TransformRepository && processor->TransformRepository->SetTransforms(*inputFrame) != PLUS_SUCCESS)
+        {
+          LOG_ERROR("Failed to set repository transforms from tracked frame " << frameIndex);
+          failed = true;
+          continue;
+        }
+        igsioTrackedFrame* outputFrame = new igsioTrackedFrame(*inputFrame);
+        if (processor->ProcessFrame(inputFrame, outputFrame) != PLUS_SUCCESS)
+        {
+          failed = true;
+        }
+        processedFrames[frameIndex] = outputFrame;
+      }
+    }
+  });
+
+  for (std::vector<igsioTrackedFrame*>::iterator frame = processedFrames.begin(); frame != processedFrames.end(); ++frame)
+  {
+    if (*frame != NULL)
+    {
+      // The frame list takes the ownership of the frame
+      outputFrames->TakeTrackedFrame(*frame);
+    }
+  }
+  return failed ? PLUS_FAIL : PLUS_SUCCESS;
+}
@@ -9,6 +9,10 @@
 
 #include "vtkPlusImageProcessingExport.h"
 
+#include <vtkSmartPointer.h>
+
+#include <vector>
+
 //class igsioTrackedFrame; 
 //class vtkIGSIOTrackedFrameList;
 //class vtkIGSIOTransformRepository;
@@ -39,6 +43,17 @@ public:
      are not processed one by one.
    */
   virtual PlusStatus Update();
+
+  /*!
+    Process all frames of a tracked frame list in parallel, for offline processing of recorded sequences.
+    The frames are split into contiguous ranges, each range is processed by one of the processors on the shared worker pool.
+    The processors must be configured the same way and must not share any state (e.g., transform repository), as they run at
+    the same time. The output frames are copies of the input frames with the processed data, they are appended to the output
+    list in the order of the input frames. Frames that the transform repository of their processor
+    cannot be updated with are left out, as in Update.
+  */
+  static PlusStatus ProcessTrackedFrameList(const std::vector<vtkSmartPointer<vtkPlusTrackedFrameProcessor> >& processors,
+      vtkIGSIOTrackedFrameList* inputFrames, vtkIGSIOTrackedFrameList* outputFrames);
  
   /*! Get the processed output data. Perform processing if needed. */
   vtkGetObjectMacro(OutputFrames, vtkIGSIOTrackedFrameList);
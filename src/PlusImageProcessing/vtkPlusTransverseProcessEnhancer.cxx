@@ -6,7 +6,9 @@ See License.txt for details.
 
 // Local includes
 #include "PlusConfigure.h"
+#include "PlusProfiler.h"
 #include "PlusMath.h"
+#include "PlusWorkerPool.h"
 #include "igsioTrackedFrame.h"
 #include "igsioVideoFrame.h"
 #include "vtkIGSIOTrackedFrameList.h"
@@ -24,6 +26,7 @@ See License.txt for details.
 #include <vtkImageThreshold.h>
 #include <vtkObjectFactory.h>
 
+#include <algorithm>
 #include <cmath>
 
 //----------------------------------------------------------------------------
@@ -32,6 +35,7 @@ vtkStandardNewMacro(vtkPlusTransverseProcessEnhancer);
 //----------------------------------------------------------------------------
 vtkPlusTransverseProcessEnhancer::vtkPlusTransverseProcessEnhancer() : vtkPlusBoneEnhancer()
 {
+  this->OriginalLinesImage = vtkSmartPointer<vtkImageData>::New();
 }
 
 //----------------------------------------------------------------------------
@@ -46,220 +50,178 @@ void vtkPlusTransverseProcessEnhancer::PrintSelf(ostream& os, vtkIndent indent)
 }
 
 //----------------------------------------------------------------------------
-// Takes a vtkSmartPointer<vtkImageData> with clearly defined possible bone segments as an
-// argument and modifies it so the bone areas that are too close to the camera's edge are removed.
-void vtkPlusTransverseProcessEnhancer::RemoveOffCameraBones(vtkSmartPointer<vtkImageData> inputImage)
+// Takes a lines image with clearly defined possible bone segments, and the original lines image before the noise removal.
+// Sorts out the bone areas that are too close to the camera's edge, and the ones that have a higher amount of bone potential
+// in the areas next to it than there is within the areas themselves.
+PlusStatus vtkPlusTransverseProcessEnhancer::FilterBoneAreas(vtkImageData* originalImage, vtkImageData* inputImage)
 {
+  this->OffCameraBoneAreas.clear();
+  this->WeakShadowBoneAreas.clear();
+
   int dims[3] = { 0, 0, 0 };
   inputImage->GetDimensions(dims);
 
-  unsigned char* vOutput = 0;
-
-  int distanceVerticalBuffer = 10;    // For a bone to be valid, it must be this distance from the transducer
-  int distanceHorizontalBuffer = 20;  // For a bone to be valid, it must be this distance from the horizontal sides of the frame
-  int boneMinSize = 10;               // Minimum bone size a bone must have to be valid
-  std::vector<std::map<std::string, int> > boneAreas = this->BoneAreasInfo;
-
-  int boneHalfLen;
-  bool clearArea;
-  bool foundBone;
-
-  this->BoneAreasInfo.clear();
-
-  for (int areaIndex = boneAreas.size() - 1; areaIndex >= 0; --areaIndex)
+  int originalDims[3] = { 0, 0, 0 };
+  originalImage->GetDimensions(originalDims);
+  if (originalImage->GetScalarType() != VTK_UNSIGNED_CHAR || originalImage->GetNumberOfScalarComponents() != 1
+      || originalDims[0] != dims[0] || originalDims[1] != dims[1])
   {
-    std::map<std::string, int> currentArea = boneAreas.at(areaIndex);
-
-    clearArea = false;
-    boneHalfLen = ((currentArea["yMax"] - currentArea["yMin"]) + 1) / 2;
+    LOG_ERROR("Bone areas can only be checked in a single component unsigned char original image of the same size as the processed image");
+    return PLUS_FAIL;
+  }
 
-    //check if the bone is to close too the scan's edge
-    if (currentArea["yMax"] + distanceVerticalBuffer >= dims[1] - 1 || currentArea["yMin"] - distanceVerticalBuffer <= 0)
-    {
-      clearArea = true;
-    }
-    //check if given the size, the bone is too close to the scan's edge
-    else if (boneHalfLen + currentArea["yMax"] >= dims[1] - 1 || (currentArea["yMin"] - 1) - boneHalfLen <= 0)
-    {
-      clearArea = true;
-    }
-    //check if the bone is too close/far from the transducer 
-    else if (currentArea["depth"] < distanceHorizontalBuffer || currentArea["depth"] > dims[0] - distanceHorizontalBuffer)
-    {
-      clearArea = true;
-    }
-    //check if the bone is to small
-    else if (currentArea["yMax"] - currentArea["yMin"] <= boneMinSize)
+  bool shadowRowSumsComputed = false;
+  size_t numberOfKeptAreas = 0;
+  for (size_t areaIndex = 0; areaIndex < this->BoneAreasInfo.size(); ++areaIndex)
+  {
+    const BoneArea& area = this->BoneAreasInfo[areaIndex];
+    if (this->IsOffCameraBoneArea(area, dims))
     {
-      clearArea = true;
+      this->OffCameraBoneAreas.push_back(area);
+      continue;
     }
 
-    //If it does not meet the criteria, remove the bones in this area
-    if (clearArea == true)
+    // The original image is only summed if there are bone areas to check
+    if (!shadowRowSumsComputed)
     {
-      //search through the area where the pixels are known to be
-      for (int y = currentArea["yMax"]; y >= currentArea["yMin"]; --y)
-      {
-        int x = currentArea["xMax"] - this->BonePushBackPx;
-        foundBone = false;
-        while (x >= currentArea["xMin"] - this->BonePushBackPx && x >= 0 && foundBone == false)
-        {
-          vOutput = static_cast<unsigned char*>(inputImage->GetScalarPointer(x, y, 0));
-          if (*vOutput != 0)
-          {
-            //remove all pixels in the outline
-            *vOutput = 0;
-            for (int removeBonex = std::max(0, x - (this->BoneOutlineDepthPx - 1)); removeBonex < x; ++removeBonex)
-            {
-              vOutput = static_cast<unsigned char*>(inputImage->GetScalarPointer(removeBonex, y, 0));
-              *vOutput = 0;
-            }
-
-            foundBone = true;
-          }
-          x--;
-        }
-      }
+      this->ComputeShadowRowSums(originalImage);
+      shadowRowSumsComputed = true;
     }
-    else
+    if (this->IsWeakShadowBoneArea(area, dims))
     {
-      this->BoneAreasInfo.push_back(currentArea);
+      this->WeakShadowBoneAreas.push_back(area);
+      continue;
     }
+
+    this->BoneAreasInfo[numberOfKeptAreas++] = area;
   }
+  this->BoneAreasInfo.resize(numberOfKeptAreas);
+
+  return PLUS_SUCCESS;
 }
 
 //----------------------------------------------------------------------------
-// Takes an unmodified vtkSmartPointer<vtkImageData> of an ultrasound as its first argument, and a more
-// enhanced version of said image, with clearly defined possible bone segments as the second argument.
-// This function modifies the second argument so as to remove any bone segments that have a higher
-// amount of bone potential in the areas next to it than there is within the areas themselves.
-void vtkPlusTransverseProcessEnhancer::CompareShadowAreas(vtkSmartPointer<vtkImageData> originalImage, vtkSmartPointer<vtkImageData> inputImage)
+bool vtkPlusTransverseProcessEnhancer::IsOffCameraBoneArea(const BoneArea& area, const int dims[3]) const
 {
-  int dims[3] = { 0, 0, 0 };
-  inputImage->GetDimensions(dims);
-
-  float vInput = 0;
-  unsigned char* vOutput = 0;
+  const int distanceVerticalBuffer = 10;    // For a bone to be valid, it must be this distance from the transducer
+  const int distanceHorizontalBuffer = 20;  // For a bone to be valid, it must be this distance from the horizontal sides of the frame
+  const int boneMinSize = 10;               // Minimum bone size a bone must have to be valid
 
-  //Variables used for measuring the size and intensity sum for bone, above, and below areas
-  int boneLen;
-  int boneHalfLen;
-  float boneArea;
-  float aboveSum;
-  float areaSum;
-  float belowSum;
-
-  float aboveAvgShadow; //Shadow intensity of the above area
-  float areaAvgShadow;  //Shadow intensity of the area
-  float belowAvgShadow; //Shadow intensity of the below area
-
-  std::map<std::string, int> currentArea;
-  std::vector<std::map<std::string, int> > boneAreas = this->BoneAreasInfo;
-
-  bool foundBone;
-  this->BoneAreasInfo.clear();
+  const int boneHalfLen = ((area.YMax - area.YMin) + 1) / 2;
 
-  for (int areaIndex = boneAreas.size() - 1; areaIndex >= 0; --areaIndex)
+  //check if the bone is to close too the scan's edge
+  if (area.YMax + distanceVerticalBuffer >= dims[1] - 1 || area.YMin - distanceVerticalBuffer <= 0)
   {
-    currentArea = boneAreas.at(areaIndex);
-
-    aboveSum = 0;
-    areaSum = 0;
-    belowSum = 0;
+    return true;
+  }
+  //check if given the size, the bone is too close to the scan's edge
+  if (boneHalfLen + area.YMax >= dims[1] - 1 || (area.YMin - 1) - boneHalfLen <= 0)
+  {
+    return true;
+  }
+  //check if the bone is too close/far from the transducer
+  if (area.Depth < distanceHorizontalBuffer || area.Depth > dims[0] - distanceHorizontalBuffer)
+  {
+    return true;
+  }
+  //check if the bone is to small
+  if (area.YMax - area.YMin <= boneMinSize)
+  {
+    return true;
+  }
+  return false;
+}
 
-    boneLen = (currentArea["yMax"] - currentArea["yMin"]) + 1;
-    boneHalfLen = boneLen / 2;
-    boneArea = boneLen * currentArea["depth"];
+//----------------------------------------------------------------------------
+bool vtkPlusTransverseProcessEnhancer::IsWeakShadowBoneArea(const BoneArea& area, const int dims[3]) const
+{
+  const int boneLen = (area.YMax - area.YMin) + 1;
+  const int boneHalfLen = boneLen / 2;
+  const float boneArea = boneLen * area.Depth;
+
+  //gather sum of shadow areas from above the area, from the area, and from below the area
+  const float aboveSum = this->GetShadowSum(area.YMax + 1, area.YMax + boneHalfLen, area.Depth, dims);
+  const float areaSum = this->GetShadowSum(area.YMin, area.YMax, area.Depth, dims);
+  const float belowSum = this->GetShadowSum(area.YMin - boneHalfLen, area.YMin - 1, area.Depth, dims);
+
+  //Calculate average shadow intensity
+  const float aboveAvgShadow = aboveSum / (boneArea / 2);
+  const float areaAvgShadow = areaSum / boneArea;
+  const float belowAvgShadow = belowSum / (boneArea / 2);
+
+  //If there is a higher amount of bones around it, remove the area
+  return (aboveAvgShadow - areaAvgShadow <= areaAvgShadow / 2 || belowAvgShadow - areaAvgShadow <= areaAvgShadow / 2);
+}
 
-    //gather sum of shadow areas from above the area
-    for (int y = currentArea["yMax"] + boneHalfLen; y > currentArea["yMax"]; --y)
-    {
-      for (int x = dims[0] - 1; x >= currentArea["depth"]; --x)
-      {
-        vInput = (originalImage->GetScalarComponentAsFloat(x, y, 0, 0));
-        aboveSum += vInput;
-      }
-    }
-    //gather sum of shadow areas from the area
-    for (int y = currentArea["yMax"]; y >= currentArea["yMin"]; --y)
-    {
-      for (int x = dims[0] - 1; x >= currentArea["depth"]; --x)
-      {
-        vInput = (originalImage->GetScalarComponentAsFloat(x, y, 0, 0));
-        areaSum += vInput;
-      }
-    }
-    //gather sum of shadow areas from below the area
-    for (int y = currentArea["yMin"] - boneHalfLen; y < currentArea["yMin"]; ++y)
-    {
-      for (int x = dims[0] - 1; x >= currentArea["depth"]; --x)
-      {
-        vInput = (originalImage->GetScalarComponentAsFloat(x, y, 0, 0));
-        belowSum += vInput;
-      }
-    }
+//----------------------------------------------------------------------------
+unsigned long long vtkPlusTransverseProcessEnhancer::GetShadowSum(int firstRow, int lastRow, int depth, const int dims[3]) const
+{
+  const size_t rowSumsStride = static_cast<size_t>(dims[0]) + 1;
+  const size_t startPosition = static_cast<size_t>(std::min(std::max(depth, 0), dims[0]));
+  unsigned long long sum = 0;
+  for (int y = std::max(firstRow, 0); y <= std::min(lastRow, dims[1] - 1); ++y)
+  {
+    sum += this->ShadowRowSums[static_cast<size_t>(y) * rowSumsStride + startPosition];
+  }
+  return sum;
+}
 
-    //Calculate average shadow intensity
-    aboveAvgShadow = aboveSum / (boneArea / 2);
-    areaAvgShadow = areaSum / boneArea;
-    belowAvgShadow = belowSum / (boneArea / 2);
+//----------------------------------------------------------------------------
+void vtkPlusTransverseProcessEnhancer::ComputeShadowRowSums(vtkImageData* originalImage)
+{
+  int dims[3] = { 0, 0, 0 };
+  originalImage->GetDimensions(dims);
+  const size_t rowSumsStride = static_cast<size_t>(dims[0]) + 1;
+  this->ShadowRowSums.resize(rowSumsStride * dims[1]);
 
-    //If there is a higher amount of bones around it, remove the area
-    if (aboveAvgShadow - areaAvgShadow <= areaAvgShadow / 2 || belowAvgShadow - areaAvgShadow <= areaAvgShadow / 2)
+  const unsigned char* pixels = static_cast<const unsigned char*>(originalImage->GetScalarPointer());
+  PlusWorkerPool::GetInstance().ParallelFor(0, dims[1], 0, [&](int firstRow, int lastRow)
+  {
+    for (int y = firstRow; y < lastRow; ++y)
     {
-
-      for (int y = currentArea["yMax"]; y >= currentArea["yMin"]; --y)
+      const unsigned char* row = pixels + static_cast<size_t>(y) * dims[0];
+      unsigned int* rowSums = &this->ShadowRowSums[static_cast<size_t>(y) * rowSumsStride];
+      rowSums[dims[0]] = 0;
+      for (int x = dims[0] - 1; x >= 0; --x)
       {
-        //search through the area where the pixels are known to be
-        int x = currentArea["xMax"] - this->BonePushBackPx;
-        foundBone = false;
-        while (x >= currentArea["xMin"] - this->BonePushBackPx && x >= 0 && foundBone == false)
-        {
-          vOutput = static_cast<unsigned char*>(inputImage->GetScalarPointer(x, y, 0));
-          if (*vOutput != 0)
-          {
-            //remove all pixels in the outline
-            *vOutput = 0;
-
-            for (int removeBonex = std::max(0, x - (this->BoneOutlineDepthPx - 1)); removeBonex < x; ++removeBonex)
-            {
-              vOutput = static_cast<unsigned char*>(inputImage->GetScalarPointer(removeBonex, y, 0));
-              *vOutput = 0;
-            }
-            foundBone = true;
-          }
-          x--;
-        }
+        rowSums[x] = rowSums[x + 1] + row[x];
       }
     }
-    else
-    {
-      this->BoneAreasInfo.push_back(currentArea);
-    }
-  }
+  });
 }
 
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusTransverseProcessEnhancer::ProcessFrame(igsioTrackedFrame* inputFrame, igsioTrackedFrame* outputFrame)
 {
+  PLUS_PROFILE_ZONE("vtkPlusTransverseProcessEnhancer::ProcessFrame");
 
   this->BoneAreasInfo.clear();
 
   vtkSmartPointer<vtkImageData> intermediateImage = vtkPlusBoneEnhancer::UnprocessedFrameToLinearImage(inputFrame);
-  intermediateImage->DeepCopy(this->LinesImage);
 
   //Save this image so that it can be used for comparison with the output image
-  vtkSmartPointer<vtkImageData> originalImage = vtkSmartPointer<vtkImageData>::New();
-  originalImage->DeepCopy(intermediateImage);
+  CopyImage(intermediateImage, this->OriginalLinesImage);
 
   vtkPlusBoneEnhancer::RemoveNoise(intermediateImage);
 
-  this->RemoveOffCameraBones(intermediateImage);
+  if (this->FilterBoneAreas(this->OriginalLinesImage, intermediateImage) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+
+  //Remove the bones that do not meet the criteria
+  for (std::vector<BoneArea>::const_iterator area = this->OffCameraBoneAreas.begin(); area != this->OffCameraBoneAreas.end(); ++area)
+  {
+    this->ClearBoneArea(intermediateImage, *area);
+  }
   if (this->SaveIntermediateResults)
   {
     this->AddIntermediateImage("_09PostFilters_2PostRemoveOffCamera", intermediateImage);
   }
-  this->CompareShadowAreas(originalImage, intermediateImage);
+  for (std::vector<BoneArea>::const_iterator area = this->WeakShadowBoneAreas.begin(); area != this->WeakShadowBoneAreas.end(); ++area)
+  {
+    this->ClearBoneArea(intermediateImage, *area);
+  }
   if (this->SaveIntermediateResults)
   {
     this->AddIntermediateImage("_09PostFilters_3PostCompareShadowAreas", intermediateImage);
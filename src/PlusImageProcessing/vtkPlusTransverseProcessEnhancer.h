@@ -15,6 +15,8 @@ See License.txt for details.
 #include <vtkSmartPointer.h>
 #include <vtkSetGet.h>
 
+#include <vector>
+
 class vtkImageData;
 
 /*!
@@ -34,14 +36,39 @@ public:
   /*! Process input frame to localize transverse process bone surfaces */
   PlusStatus ProcessFrame(igsioTrackedFrame* inputFrame, igsioTrackedFrame* outputFrame);
 
-  void RemoveOffCameraBones(vtkSmartPointer<vtkImageData> inputImage);
-
-  void CompareShadowAreas(vtkSmartPointer<vtkImageData> originalImage, vtkSmartPointer<vtkImageData> inputImage);
+  /*!
+    Check all bone areas found by MarkShadowOutline in one pass. Areas that are too close to the edges of the image
+    or too small are collected in OffCameraBoneAreas, areas that have more shadow around them in the original image
+    than within themselves are collected in WeakShadowBoneAreas. The remaining areas are kept in BoneAreasInfo.
+    The image is not modified, the removed areas can be cleared by ClearBoneArea.
+  */
+  PlusStatus FilterBoneAreas(vtkImageData* originalImage, vtkImageData* inputImage);
 
 protected:
   vtkPlusTransverseProcessEnhancer();
   virtual ~vtkPlusTransverseProcessEnhancer();
 
+  /*! True if the bone area is too close to the edges of the image or too small to be a valid bone */
+  bool IsOffCameraBoneArea(const BoneArea& area, const int dims[3]) const;
+  /*! True if there is more shadow next to the bone area than behind it, ShadowRowSums must be up to date */
+  bool IsWeakShadowBoneArea(const BoneArea& area, const int dims[3]) const;
+  /*! Sum of the shadow behind the given depth in the scan lines [firstRow, lastRow] */
+  unsigned long long GetShadowSum(int firstRow, int lastRow, int depth, const int dims[3]) const;
+  /*! Fill ShadowRowSums from the original lines image */
+  void ComputeShadowRowSums(vtkImageData* originalImage);
+
+  /*! Lines image before removing the noise, reused for every frame */
+  vtkSmartPointer<vtkImageData> OriginalLinesImage;
+
+  /*! Buffers of FilterBoneAreas, reused for every frame */
+  std::vector<BoneArea> OffCameraBoneAreas;
+  std::vector<BoneArea> WeakShadowBoneAreas;
+  /*!
+    Sum of the pixels of the original lines image from each x position to the end of the scan line,
+    (NumberOfSamples + 1) values per scan line, so that the shadow behind a bone is summed in constant time per scan line
+  */
+  std::vector<unsigned int> ShadowRowSums;
+
 private:
   vtkPlusTransverseProcessEnhancer(const vtkPlusTransverseProcessEnhancer&);  // Not implemented.
   void operator=(const vtkPlusTransverseProcessEnhancer&);  // Not implemented.
@@ -7,9 +7,18 @@ See License.txt for details.
 #include "PlusConfigure.h"
 
 #include "vtkPlusUsScanConvert.h"
+#include "PlusWorkerPool.h"
 
+// IGSIO includes
+#include "igsioTrackedFrame.h"
+#include "vtkIGSIOTrackedFrameList.h"
+
+#include "vtkImageData.h"
 #include "vtkObjectFactory.h"
+#include "vtkSmartPointer.h"
 
+#include <algorithm>
+#include <atomic>
 
 //----------------------------------------------------------------------------
 vtkPlusUsScanConvert::vtkPlusUsScanConvert()
@@ -128,6 +137,303 @@ PlusStatus vtkPlusUsScanConvert::WriteConfiguration(vtkXMLDataElement* scanConve
   return PLUS_SUCCESS;
 }
 
+//-----------------------------------------------------------------------------
+void vtkPlusUsScanConvert::DeepCopy(vtkPlusUsScanConvert* source)
+{
+  this->SetTransducerName(source->TransducerName);
+  std::copy(source->OutputImageExtent, source->OutputImageExtent + 6, this->OutputImageExtent);
+  std::copy(source->OutputImageSpacing, source->OutputImageSpacing + 3, this->OutputImageSpacing);
+  this->TransducerCenterPixelSpecified = source->TransducerCenterPixelSpecified;
+  this->TransducerCenterPixel[0] = source->TransducerCenterPixel[0];
+  this->TransducerCenterPixel[1] = source->TransducerCenterPixel[1];
+  this->Modified();
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusUsScanConvert::ScanConvertTrackedFrameList(vtkIGSIOTrackedFrameList* inputFrames, vtkIGSIOTrackedFrameList* outputFrames, int numberOfThreads)
+{
+  if (inputFrames == NULL || outputFrames == NULL)
+  {
+    LOG_ERROR("vtkPlusUsScanConvert::ScanConvertTrackedFrameList failed: input and output frame lists must be specified");
+    return PLUS_FAIL;
+  }
+  const int numberOfFrames = inputFrames->GetNumberOfTrackedFrames();
+  if (numberOfFrames < 1)
+  {
+    return PLUS_SUCCESS;
+  }
+
+  PlusWorkerPool& workerPool = PlusWorkerPool::GetInstance();
+  if (numberOfThreads < 1)
+  {
+    numberOfThreads = workerPool.GetNumberOfThreads() + 1;
+  }
+  const int numberOfTasks = std::min(numberOfThreads, numberOfFrames);
+
+  // Each task converts a contiguous range of frames with its own copy of the scan converter,
+  // as a pipeline cannot be updated from multiple threads at once
+  std::vector<vtkSmartPointer<vtkPlusUsScanConvert> > scanConverters(numberOfTasks);
+  for (int i = 0; i < numberOfTasks; i++)
+  {
+    scanConverters[i] = vtkSmartPointer<vtkPlusUsScanConvert>::Take(this->NewInstance());
+    scanConverters[i]->DeepCopy(this);
+    if (numberOfTasks > 1)
+    {
+      // Frames are already processed in parallel
+      scanConverters[i]->SetNumberOfThreads(1);
+    }
+  }
+
+  std::vector<igsioTrackedFrame*> convertedFrames(numberOfFrames, NULL);
+  std::atomic<bool> failed(false);
+  workerPool.ParallelFor(0, numberOfTasks, numberOfTasks, [&](int firstTask, int lastTask)
+  {
+    for (int taskIndex = firstTask; taskIndex < lastTask; taskIndex++)
+    {
+      vtkPlusUsScanConvert* scanConverter = scanConverters[taskIndex];
+      const int firstFrame = static_cast<int>(static_cast<long long>(numberOfFrames) * taskIndex / numberOfTasks);
+      const int lastFrame = static_cast<int>(static_cast<long long>(numberOfFrames) * (taskIndex + 1) / numberOfTasks);
+      for (int frameIndex = firstFrame; frameIndex < lastFrame && !failed; frameIndex++)
+      {
+        igsioTrackedFrame* inputFrame = inputFrames->GetTrackedFrame(frameIndex);
+        scanConverter->SetInputData(inputFrame->GetImageData()->GetImage());
+        scanConverter->Update();
+        vtkImageData* outputImage = scanConverter->GetOutput();
+        if (outputImage == NULL)
+        {
+          LOG_ERROR("Failed to scan convert frame " << frameIndex);
+          failed = true;
+          break;
+        }
+        igsioTrackedFrame* outputFrame = new igsioTrackedFrame(*inputFrame);
+        if (outputFrame->GetImageData()->DeepCopyFrom(outputImage) != PLUS_SUCCESS)
+        {
+          LOG_ERROR("Failed to store scan converted image of frame " << frameIndex);
+          delete outputFrame;
+          failed = true;
+          break;
+        }
+        convertedFrames[frameIndex] = outputFrame;
+      }
+      // Release the last input image
+      scanConverter->SetInputData(NULL);
+    }
+  });
+
+  if (failed)
+  {
+    for (std::vector<igsioTrackedFrame*>::iterator frame = convertedFrames.begin(); frame != convertedFrames.end(); ++frame)
+    {
+      delete *frame;
+    }
+    return PLUS_FAIL;
+  }
+  for (std::vector<igsioTrackedFrame*>::iterator frame = convertedFrames.begin(); frame != convertedFrames.end(); ++frame)
+  {
+    // The frame list takes the ownership of the frame
+    outputFrames->TakeTrackedFrame(*frame);
+  }
+  return PLUS_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusUsScanConvert::ComputeScanLineSamplingTable(ScanLineSamplingTable& table)
+{
+  const int numberOfSamples = this->InputImageExtent[1] - this->InputImageExtent[0] + 1;
+  const int numberOfScanLines = this->InputImageExtent[3] - this->InputImageExtent[2] + 1;
+  if (numberOfSamples < 1 || numberOfScanLines < 1)
+  {
+    LOG_ERROR("vtkPlusUsScanConvert::ComputeScanLineSamplingTable failed: input image extent is not set");
+    return PLUS_FAIL;
+  }
+
+  std::copy(this->InputImageExtent, this->InputImageExtent + 6, table.LinesImageExtent);
+  table.PixelCoordinates.resize(2 * numberOfSamples * numberOfScanLines);
+  int* pixelCoordinates = &table.PixelCoordinates[0];
+  for (int scanLine = 0; scanLine < numberOfScanLines; scanLine++)
+  {
+    double start[4] = {0};
+    double end[4] = {0};
+    if (this->GetScanLineEndPoints(scanLine, start, end) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("vtkPlusUsScanConvert::ComputeScanLineSamplingTable failed: cannot get the end points of scan line " << scanLine);
+      return PLUS_FAIL;
+    }
+    double directionVectorX = 0;
+    double directionVectorY = 0;
+    if (numberOfSamples > 1)
+    {
+      directionVectorX = (end[0] - start[0]) / (numberOfSamples - 1);
+      directionVectorY = (end[1] - start[1]) / (numberOfSamples - 1);
+    }
+    for (int sample = 0; sample < numberOfSamples; sample++)
+    {
+      *(pixelCoordinates++) = static_cast<int>(start[0] + directionVectorX * sample);
+      *(pixelCoordinates++) = static_cast<int>(start[1] + directionVectorY * sample);
+    }
+  }
+  return PLUS_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+template <class T>
+void vtkPlusUsScanConvertExtractScanLines(const vtkPlusUsScanConvert::ScanLineSamplingTable& table, vtkImageData* scanConvertedImage, T* linesPixel)
+{
+  const T* scanConvertedPixels = static_cast<const T*>(scanConvertedImage->GetScalarPointer());
+  const int* extent = scanConvertedImage->GetExtent();
+  vtkIdType incX = 0, incY = 0, incZ = 0;
+  scanConvertedImage->GetIncrements(incX, incY, incZ);
+  const int* pixelCoordinates = table.PixelCoordinates.empty() ? NULL : &table.PixelCoordinates[0];
+  const size_t numberOfSamples = table.PixelCoordinates.size() / 2;
+  for (size_t sampleIndex = 0; sampleIndex < numberOfSamples; sampleIndex++, pixelCoordinates += 2, linesPixel++)
+  {
+    const int x = pixelCoordinates[0];
+    const int y = pixelCoordinates[1];
+    if (x < extent[0] || x > extent[1] || y < extent[2] || y > extent[3])
+    {
+      // outside of the scan converted image
+      *linesPixel = 0;
+      continue;
+    }
+    *linesPixel = scanConvertedPixels[(x - extent[0]) * incX + (y - extent[2]) * incY];
+  }
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusUsScanConvert::ExtractScanLines(const ScanLineSamplingTable& table, vtkImageData* scanConvertedImage, vtkImageData* linesImage)
+{
+  if (scanConvertedImage == NULL || linesImage == NULL)
+  {
+    LOG_ERROR("vtkPlusUsScanConvert::ExtractScanLines failed: input and output images must be specified");
+    return PLUS_FAIL;
+  }
+  linesImage->SetExtent(const_cast<int*>(table.LinesImageExtent));
+  linesImage->AllocateScalars(scanConvertedImage->GetScalarType(), 1);
+  if (static_cast<size_t>(linesImage->GetNumberOfPoints()) * 2 != table.PixelCoordinates.size())
+  {
+    LOG_ERROR("vtkPlusUsScanConvert::ExtractScanLines failed: the sampling table is not computed");
+    return PLUS_FAIL;
+  }
+
+  switch (scanConvertedImage->GetScalarType())
+  {
+    vtkTemplateMacro(vtkPlusUsScanConvertExtractScanLines(table, scanConvertedImage, static_cast<VTK_TT*>(linesImage->GetScalarPointer())));
+  default:
+    LOG_ERROR("vtkPlusUsScanConvert::ExtractScanLines failed: unknown scalar type " << scanConvertedImage->GetScalarType());
+    return PLUS_FAIL;
+  }
+  linesImage->Modified();
+  return PLUS_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+template <class T>
+void vtkPlusUsScanConvertDrawScanLineSamples(const vtkPlusUsScanConvert::ScanLineSamplingTable& table, T value, vtkImageData* image)
+{
+  T* pixels = static_cast<T*>(image->GetScalarPointer());
+  const int* extent = image->GetExtent();
+  vtkIdType incX = 0, incY = 0, incZ = 0;
+  image->GetIncrements(incX, incY, incZ);
+  for (std::vector<int>::const_iterator pixelCoordinates = table.PixelCoordinates.begin(); pixelCoordinates != table.PixelCoordinates.end(); pixelCoordinates += 2)
+  {
+    const int x = pixelCoordinates[0];
+    const int y = pixelCoordinates[1];
+    if (x >= extent[0] && x <= extent[1] && y >= extent[2] && y <= extent[3])
+    {
+      pixels[(x - extent[0]) * incX + (y - extent[2]) * incY] = value;
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusUsScanConvert::DrawScanLineSamples(const ScanLineSamplingTable& table, double value, vtkImageData* image)
+{
+  if (image == NULL || image->GetScalarPointer() == NULL)
+  {
+    LOG_ERROR("vtkPlusUsScanConvert::DrawScanLineSamples failed: image is not allocated");
+    return PLUS_FAIL;
+  }
+  switch (image->GetScalarType())
+  {
+    vtkTemplateMacro(vtkPlusUsScanConvertDrawScanLineSamples(table, static_cast<VTK_TT>(value), image));
+  default:
+    LOG_ERROR("vtkPlusUsScanConvert::DrawScanLineSamples failed: unknown scalar type " << image->GetScalarType());
+    return PLUS_FAIL;
+  }
+  image->Modified();
+  return PLUS_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusUsScanConvert::ExtractScanLinesTrackedFrameList(vtkIGSIOTrackedFrameList* inputFrames, vtkIGSIOTrackedFrameList* outputFrames, int numberOfThreads)
+{
+  if (inputFrames == NULL || outputFrames == NULL)
+  {
+    LOG_ERROR("vtkPlusUsScanConvert::ExtractScanLinesTrackedFrameList failed: input and output frame lists must be specified");
+    return PLUS_FAIL;
+  }
+  const int numberOfFrames = inputFrames->GetNumberOfTrackedFrames();
+  if (numberOfFrames < 1)
+  {
+    return PLUS_SUCCESS;
+  }
+
+  ScanLineSamplingTable table;
+  if (this->ComputeScanLineSamplingTable(table) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+
+  PlusWorkerPool& workerPool = PlusWorkerPool::GetInstance();
+  if (numberOfThreads < 1)
+  {
+    numberOfThreads = workerPool.GetNumberOfThreads() + 1;
+  }
+  const int numberOfTasks = std::min(numberOfThreads, numberOfFrames);
+
+  std::vector<igsioTrackedFrame*> linesFrames(numberOfFrames, NULL);
+  std::atomic<bool> failed(false);
+  workerPool.ParallelFor(0, numberOfFrames, numberOfTasks, [&](int firstFrame, int lastFrame)
+  {
+    // The lines image is reused for all frames of the task
+    vtkSmartPointer<vtkImageData> linesImage = vtkSmartPointer<vtkImageData>::New();
+    for (int frameIndex = firstFrame; frameIndex < lastFrame && !failed; frameIndex++)
+    {
+      igsioTrackedFrame* inputFrame = inputFrames->GetTrackedFrame(frameIndex);
+      if (ExtractScanLines(table, inputFrame->GetImageData()->GetImage(), linesImage) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to extract scan lines from frame " << frameIndex);
+        failed = true;
+        break;
+      }
+      igsioTrackedFrame* linesFrame = new igsioTrackedFrame(*inputFrame);
+      if (linesFrame->GetImageData()->DeepCopyFrom(linesImage) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to store scan line image of frame " << frameIndex);
+        delete linesFrame;
+        failed = true;
+        break;
+      }
+      linesFrames[frameIndex] = linesFrame;
+    }
+  });
+
+  if (failed)
+  {
+    for (std::vector<igsioTrackedFrame*>::iterator frame = linesFrames.begin(); frame != linesFrames.end(); ++frame)
+    {
+      delete *frame;
+    }
+    return PLUS_FAIL;
+  }
+  for (std::vector<igsioTrackedFrame*>::iterator frame = linesFrames.begin(); frame != linesFrames.end(); ++frame)
+  {
+    // The frame list takes the ownership of the frame
+    outputFrames->TakeTrackedFrame(*frame);
+  }
+  return PLUS_SUCCESS;
+}
+
 //-----------------------------------------------------------------------------
 FrameSizeType vtkPlusUsScanConvert::GetOutputImageSizePixel()
 {
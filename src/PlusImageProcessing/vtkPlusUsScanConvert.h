@@ -10,6 +10,10 @@ See License.txt for details.
 #include "vtkPlusImageProcessingExport.h"
 #include "vtkThreadedImageAlgorithm.h"
 
+#include <vector>
+
+class vtkIGSIOTrackedFrameList;
+
 /*!
 \class vtkPlusUsScanConvert
 \brief This is a base class for defining a common scan conversion algorithm interface for all kinds of probes
@@ -39,6 +43,56 @@ public:
   /*! Write configuration to xml data. The scanConversionElement is typically in DataCollction/ImageAcquisition/RfProcessing. */
   virtual PlusStatus WriteConfiguration(vtkXMLDataElement* scanConversionElement);
 
+  /*! Copy the scan conversion parameters (and the interpolation tables computed from them) from another scan converter of the same type */
+  virtual void DeepCopy(vtkPlusUsScanConvert* source);
+
+  /*!
+    Scan convert all frames of a tracked frame list, for offline processing of recorded scan lines.
+    The output frames are copies of the input frames with the scan converted images, in the same order.
+    The frames are split between copies of this scan converter that run in parallel on the shared worker pool,
+    each of them keeps its output image allocated for all its frames. The input connection of this scan converter is not changed.
+    \param inputFrames Frames that contain the scan line images
+    \param outputFrames The scan converted frames are appended to this list
+    \param numberOfThreads Number of frames processed in parallel, 0 means all threads of the worker pool
+  */
+  PlusStatus ScanConvertTrackedFrameList(vtkIGSIOTrackedFrameList* inputFrames, vtkIGSIOTrackedFrameList* outputFrames, int numberOfThreads = 0);
+
+  /*!
+    Output image pixels that the scan line samples are taken from, for the inverse of scan conversion.
+    The samples are evenly distributed between the scan line end points, their coordinates are truncated to integer
+    pixel coordinates. The table is computed once and reused for all frames.
+  */
+  struct ScanLineSamplingTable
+  {
+    /*! Extent of the scan line image: samples of a scan line along the first axis, scan lines along the second axis */
+    int LinesImageExtent[6];
+    /*! Output image pixel coordinates (x, y) of each sample, in the order of the scan line image pixels */
+    std::vector<int> PixelCoordinates;
+  };
+
+  /*! Compute the sampling table of the scan lines. Setting of the input image or at least the input image extent is required before calling this method. */
+  PlusStatus ComputeScanLineSamplingTable(ScanLineSamplingTable& table);
+
+  /*!
+    Extract the scan lines from a scan converted image, using a sampling table.
+    The lines image is allocated with the lines image extent of the table and one component of the scalar type of the
+    scan converted image (its first component is sampled). Samples that are outside the scan converted image are set to 0.
+  */
+  static PlusStatus ExtractScanLines(const ScanLineSamplingTable& table, vtkImageData* scanConvertedImage, vtkImageData* linesImage);
+
+  /*! Set the first component of the image pixels of all samples of the table to the given value */
+  static PlusStatus DrawScanLineSamples(const ScanLineSamplingTable& table, double value, vtkImageData* image);
+
+  /*!
+    Extract the scan lines from all frames of a tracked frame list, for converting recorded scan converted images back
+    into scan line images. The sampling table is computed once and the frames are processed in parallel on the shared worker pool.
+    The output frames are copies of the input frames with the scan line images, in the same order.
+    \param inputFrames Frames that contain the scan converted images
+    \param outputFrames The frames with the scan line images are appended to this list
+    \param numberOfThreads Number of frames processed in parallel, 0 means all threads of the worker pool
+  */
+  PlusStatus ExtractScanLinesTrackedFrameList(vtkIGSIOTrackedFrameList* inputFrames, vtkIGSIOTrackedFrameList* outputFrames, int numberOfThreads = 0);
+
   vtkGetVector6Macro(OutputImageExtent, int);
   vtkGetVector6Macro(InputImageExtent, int);
   vtkSetVector6Macro(InputImageExtent, int);
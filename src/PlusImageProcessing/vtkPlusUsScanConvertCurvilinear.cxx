@@ -13,9 +13,11 @@ non-commercial terms in your toolbox and distribute it."
 */
 
 #include "PlusConfigure.h"
+#include "PlusProfiler.h"
 #include "igsioCommon.h"
 
 #include "vtkPlusUsScanConvertCurvilinear.h"
+#include "PlusWorkerPool.h"
 
 #include "vtkXMLDataElement.h"
 
@@ -32,6 +34,14 @@ non-commercial terms in your toolbox and distribute it."
 #include <string.h>
 #include <ctype.h>
 
+#include <algorithm>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define PLUS_SCANCONVERT_SSE2
+  #include <emmintrin.h>
+#endif
+
 vtkStandardNewMacro( vtkPlusUsScanConvertCurvilinear );
 
 //----------------------------------------------------------------------------
@@ -43,6 +53,7 @@ vtkPlusUsScanConvertCurvilinear::vtkPlusUsScanConvertCurvilinear()
   this->ThetaStartDeg = -30.0;
   this->ThetaStopDeg = 30.0;
   this->OutputIntensityScaling = 1.0;
+  this->InterpolationKernel = INTERPOLATION_KERNEL_FLOATING_POINT;
 
   // Values that are used for computing the InterpolatedPointArray
   this->InterpInputImageExtent[0] = 0;
@@ -140,6 +151,7 @@ void vtkPlusUsScanConvertCurvilinear::ComputeInterpolatedPointArray(
   // Compute the interpolated point array now
 
   this->InterpolatedPointArray.clear();
+  this->FixedPointTable = FixedPointInterpolationTable();
 
   int numberOfSamples = inputImageExtent[1] - inputImageExtent[0] + 1;
   int numberOfLines = inputImageExtent[3] - inputImageExtent[2] + 1;
@@ -201,6 +213,55 @@ void vtkPlusUsScanConvertCurvilinear::ComputeInterpolatedPointArray(
 
 }
 
+//----------------------------------------------------------------------------
+void vtkPlusUsScanConvertCurvilinear::ComputeFixedPointInterpolationTable( double intensityScaling )
+{
+  this->FixedPointTable = FixedPointInterpolationTable();
+
+  const double weightScale = 1 << FIXED_POINT_WEIGHT_BITS;
+  // Weights are multiplied with 8-bit pixels and summed in pairs in 32-bit integers, so each of them must fit into a signed 16-bit integer
+  if ( intensityScaling < 0 || intensityScaling * weightScale > 32767 )
+  {
+    LOG_DEBUG( "Fixed-point interpolation table is not computed, because the intensity scaling " << intensityScaling << " is out of the supported range" );
+    return;
+  }
+
+  const size_t numberOfPoints = this->InterpolatedPointArray.size();
+  this->FixedPointTable.InputPixelIndices.resize( numberOfPoints );
+  this->FixedPointTable.OutputPixelIndices.resize( numberOfPoints );
+  this->FixedPointTable.Weights.resize( 4 * numberOfPoints );
+  const int weightSum = static_cast<int>( floor( intensityScaling * weightScale + 0.5 ) );
+  for ( size_t pointIndex = 0; pointIndex < numberOfPoints; pointIndex++ )
+  {
+    const InterpolatedPoint& ip = this->InterpolatedPointArray[pointIndex];
+    this->FixedPointTable.InputPixelIndices[pointIndex] = ip.inputPixelIndex;
+    this->FixedPointTable.OutputPixelIndices[pointIndex] = ip.outputPixelIndex;
+
+    // Round the weights so that their sum is exact (a uniform input region remains uniform):
+    // round down all of them, then round up the ones with the largest fractions.
+    int weights[4] = {0};
+    double fractions[4] = {0};
+    int remainder = weightSum;
+    for ( int i = 0; i < 4; i++ )
+    {
+      const double scaledWeight = ip.weightCoefficients[i] * weightScale;
+      weights[i] = static_cast<int>( floor( scaledWeight ) );
+      fractions[i] = scaledWeight - weights[i];
+      remainder -= weights[i];
+    }
+    for ( ; remainder > 0; remainder-- )
+    {
+      int largestFractionIndex = static_cast<int>( std::max_element( fractions, fractions + 4 ) - fractions );
+      weights[largestFractionIndex]++;
+      fractions[largestFractionIndex] = -1;
+    }
+    for ( int i = 0; i < 4; i++ )
+    {
+      this->FixedPointTable.Weights[4 * pointIndex + i] = static_cast<short>( weights[i] );
+    }
+  }
+}
+
 //----------------------------------------------------------------------------
 // Computes any global image information associated with regions.
 int vtkPlusUsScanConvertCurvilinear::RequestInformation ( vtkInformation* vtkNotUsed( request ), vtkInformationVector** inputVector, vtkInformationVector* outputVector )
@@ -224,6 +285,11 @@ int vtkPlusUsScanConvertCurvilinear::RequestInformation ( vtkInformation* vtkNot
   // Create the interpolation table. It is recomputed only if the scan conversion parameters change.
   ComputeInterpolatedPointArray( inExtent, this->RadiusStartMm, this->RadiusStopMm, this->ThetaStartDeg, this->ThetaStopDeg,
                                  this->OutputImageExtent, this->OutputImageSpacing, this->TransducerCenterPixel, this->OutputIntensityScaling );
+  if ( this->InterpolationKernel == INTERPOLATION_KERNEL_FIXED_POINT
+       && this->FixedPointTable.InputPixelIndices.size() != this->InterpolatedPointArray.size() )
+  {
+    ComputeFixedPointInterpolationTable( this->OutputIntensityScaling );
+  }
 
   return 1;
 }
@@ -307,6 +373,65 @@ void vtkPlusUsScanConvertExecute( vtkPlusUsScanConvertCurvilinear* self,
   }
 }
 
+//----------------------------------------------------------------------------
+// Same interpolation as vtkPlusUsScanConvertExecute, for 8-bit pixels with fixed-point weights.
+// With SSE2 the 2x2 input pixel neighborhoods of 4 output pixels are gathered into a vector register and
+// multiplied with the weights at once.
+void vtkPlusUsScanConvertExecuteFixedPoint( const vtkPlusUsScanConvertCurvilinear::FixedPointInterpolationTable& table,
+    const unsigned char* inPtr, unsigned char* outPtr, int numberOfSamples, int interpolationTableExt[6] )
+{
+  const int* inputPixelIndices = &table.InputPixelIndices[0];
+  const int* outputPixelIndices = &table.OutputPixelIndices[0];
+  const short* weights = &table.Weights[0];
+  const int rounding = 1 << ( vtkPlusUsScanConvertCurvilinear::FIXED_POINT_WEIGHT_BITS - 1 );
+
+  int pointIndex = interpolationTableExt[0];
+  const int afterLastPoint = interpolationTableExt[1] + 1;
+#ifdef PLUS_SCANCONVERT_SSE2
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i roundingVector = _mm_set1_epi32( rounding );
+  for ( ; pointIndex + 4 <= afterLastPoint; pointIndex += 4 )
+  {
+    // Each 32-bit element: the 4 input pixels of one output pixel, in the order of the weights
+    int neighborhoods[4];
+    for ( int i = 0; i < 4; i++ )
+    {
+      const unsigned char* inputPixel = inPtr + inputPixelIndices[pointIndex + i];
+      neighborhoods[i] = inputPixel[0] | ( inputPixel[1] << 8 ) | ( inputPixel[numberOfSamples] << 16 ) | ( inputPixel[numberOfSamples + 1] << 24 );
+    }
+    const __m128i pixels = _mm_loadu_si128( reinterpret_cast<const __m128i*>( neighborhoods ) );
+    const __m128i weights01 = _mm_loadu_si128( reinterpret_cast<const __m128i*>( weights + 4 * pointIndex ) );
+    const __m128i weights23 = _mm_loadu_si128( reinterpret_cast<const __m128i*>( weights + 4 * pointIndex + 8 ) );
+
+    // Pairwise sums of the products: (w0p0+w1p1, w2p2+w3p3) for each output pixel
+    const __m128i products01 = _mm_madd_epi16( _mm_unpacklo_epi8( pixels, zero ), weights01 );
+    const __m128i products23 = _mm_madd_epi16( _mm_unpackhi_epi8( pixels, zero ), weights23 );
+    // Transpose, so that the first and second halves of the sums of the 4 output pixels are in separate registers
+    const __m128i interleaved0 = _mm_unpacklo_epi32( products01, products23 );
+    const __m128i interleaved1 = _mm_unpackhi_epi32( products01, products23 );
+    const __m128i sums = _mm_add_epi32( _mm_unpacklo_epi32( interleaved0, interleaved1 ), _mm_unpackhi_epi32( interleaved0, interleaved1 ) );
+
+    const __m128i results = _mm_srai_epi32( _mm_add_epi32( sums, roundingVector ), vtkPlusUsScanConvertCurvilinear::FIXED_POINT_WEIGHT_BITS );
+    const __m128i results16 = _mm_packs_epi32( results, zero );
+    const int results8 = _mm_cvtsi128_si32( _mm_packus_epi16( results16, zero ) );
+    for ( int i = 0; i < 4; i++ )
+    {
+      outPtr[outputPixelIndices[pointIndex + i]] = static_cast<unsigned char>( results8 >> ( 8 * i ) );
+    }
+  }
+#endif
+  for ( ; pointIndex < afterLastPoint; pointIndex++ )
+  {
+    const unsigned char* inputPixel = inPtr + inputPixelIndices[pointIndex];
+    const short* pointWeights = weights + 4 * pointIndex;
+    const int sum = pointWeights[0] * inputPixel[0] // (+0, +0)
+                    + pointWeights[1] * inputPixel[1] // (+1, +0)
+                    + pointWeights[2] * inputPixel[numberOfSamples] // (+0, +1)
+                    + pointWeights[3] * inputPixel[numberOfSamples + 1]; // (+1, +1)
+    outPtr[outputPixelIndices[pointIndex]] = static_cast<unsigned char>( std::min( ( sum + rounding ) >> vtkPlusUsScanConvertCurvilinear::FIXED_POINT_WEIGHT_BITS, 255 ) );
+  }
+}
+
 //----------------------------------------------------------------------------
 void vtkPlusUsScanConvertCurvilinear::ThreadedRequestData(
   vtkInformation* vtkNotUsed( request ),
@@ -316,6 +441,7 @@ void vtkPlusUsScanConvertCurvilinear::ThreadedRequestData(
   vtkImageData** outData,
   int outExt[6], int id )
 {
+  PLUS_PROFILE_ZONE("vtkPlusUsScanConvertCurvilinear::ThreadedRequestData");
 
   void* inPtr = inData[0][0]->GetScalarPointer();
   void* outPtr = outData[0]->GetScalarPointer();
@@ -330,6 +456,17 @@ void vtkPlusUsScanConvertCurvilinear::ThreadedRequestData(
     return;
   }
 
+  if ( this->InterpolationKernel == INTERPOLATION_KERNEL_FIXED_POINT
+       && inData[0][0]->GetScalarType() == VTK_UNSIGNED_CHAR
+       && inData[0][0]->GetNumberOfScalarComponents() == 1
+       && !this->FixedPointTable.InputPixelIndices.empty() )
+  {
+    int numberOfSamples = inData[0][0]->GetExtent()[1] - inData[0][0]->GetExtent()[0] + 1;
+    vtkPlusUsScanConvertExecuteFixedPoint( this->FixedPointTable, static_cast<unsigned char*>( inPtr ),
+                                           static_cast<unsigned char*>( outPtr ), numberOfSamples, outExt );
+    return;
+  }
+
   switch ( inData[0][0]->GetScalarType() )
   {
     vtkTemplateMacro(
@@ -343,6 +480,117 @@ void vtkPlusUsScanConvertCurvilinear::ThreadedRequestData(
   }
 }
 
+//----------------------------------------------------------------------------
+// Accumulates the weighted interpolated pixels of all frames for the interpolated points [firstPoint, afterLastPoint).
+// The points are processed in tiles, so that the partial sums of a tile stay in the cache while the frames are read.
+// With a single frame of weight 1 the result is the same as vtkPlusUsScanConvertExecute.
+template <class T>
+void vtkPlusUsScanConvertAccumulateTiles( const std::vector<vtkPlusUsScanConvertCurvilinear::InterpolatedPoint>& points,
+    const std::vector<const T*>& frames, const std::vector<double>& frameWeights, T* outPtr, int numberOfSamples,
+    int firstPoint, int afterLastPoint )
+{
+  const double minValue = static_cast<double>( std::numeric_limits<T>::lowest() );
+  const double maxValue = static_cast<double>( std::numeric_limits<T>::max() );
+  const int maxTileSize = vtkPlusUsScanConvertCurvilinear::ACCUMULATION_TILE_SIZE;
+  double sums[vtkPlusUsScanConvertCurvilinear::ACCUMULATION_TILE_SIZE];
+  for ( int tileStart = firstPoint; tileStart < afterLastPoint; tileStart += maxTileSize )
+  {
+    const int tileSize = std::min( maxTileSize, afterLastPoint - tileStart );
+    const vtkPlusUsScanConvertCurvilinear::InterpolatedPoint* tilePoints = &points[tileStart];
+    std::fill( sums, sums + tileSize, 0.0 );
+    for ( size_t frameIndex = 0; frameIndex < frames.size(); frameIndex++ )
+    {
+      const T* envelope_data = frames[frameIndex];
+      const double frameWeight = frameWeights[frameIndex];
+      for ( int i = 0; i < tileSize; i++ )
+      {
+        const vtkPlusUsScanConvertCurvilinear::InterpolatedPoint& ip = tilePoints[i];
+        const T* env_pointer = envelope_data + ip.inputPixelIndex;
+        sums[i] += frameWeight * (
+                     ip.weightCoefficients[0] * env_pointer[0] // (+0, +0)
+                     + ip.weightCoefficients[1] * env_pointer[1] // (+1, +0)
+                     + ip.weightCoefficients[2] * env_pointer[numberOfSamples] // (+0, +1)
+                     + ip.weightCoefficients[3] * env_pointer[numberOfSamples + 1] ); // (+1, +1)
+      }
+    }
+    for ( int i = 0; i < tileSize; i++ )
+    {
+      const double value = sums[i] + 0.5; // for rounding
+      outPtr[tilePoints[i].outputPixelIndex] = static_cast<T>( std::max( minValue, std::min( value, maxValue ) ) );
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+template <class T>
+void vtkPlusUsScanConvertAccumulate( const std::vector<vtkPlusUsScanConvertCurvilinear::InterpolatedPoint>& points,
+                                     const std::vector<vtkImageData*>& inputFrames, const std::vector<double>& frameWeights,
+                                     T* outPtr, int numberOfSamples )
+{
+  std::vector<const T*> frames;
+  for ( std::vector<vtkImageData*>::const_iterator inputFrame = inputFrames.begin(); inputFrame != inputFrames.end(); ++inputFrame )
+  {
+    frames.push_back( static_cast<const T*>( ( *inputFrame )->GetScalarPointer() ) );
+  }
+  const int numberOfPoints = static_cast<int>( points.size() );
+  const int tileSize = vtkPlusUsScanConvertCurvilinear::ACCUMULATION_TILE_SIZE;
+  const int numberOfTiles = ( numberOfPoints + tileSize - 1 ) / tileSize;
+  // Whole tiles are assigned to the tasks, so each output pixel is written by one thread only
+  PlusWorkerPool::GetInstance().ParallelFor( 0, numberOfTiles, 0, [&]( int firstTile, int lastTile )
+  {
+    vtkPlusUsScanConvertAccumulateTiles( points, frames, frameWeights, outPtr, numberOfSamples,
+                                         firstTile * tileSize, std::min( lastTile * tileSize, numberOfPoints ) );
+  } );
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusUsScanConvertCurvilinear::AccumulateFrames( const std::vector<vtkImageData*>& inputFrames, const std::vector<double>& frameWeights, vtkImageData* outputImage )
+{
+  if ( inputFrames.empty() || inputFrames.size() != frameWeights.size() || outputImage == NULL )
+  {
+    LOG_ERROR( "vtkPlusUsScanConvertCurvilinear::AccumulateFrames failed: " << inputFrames.size() << " frames and "
+               << frameWeights.size() << " weights are specified (output image " << ( outputImage ? "is" : "is not" ) << " specified)" );
+    return PLUS_FAIL;
+  }
+
+  int inputExtent[6] = {0, -1, 0, -1, 0, -1};
+  inputFrames[0]->GetExtent( inputExtent );
+  const int scalarType = inputFrames[0]->GetScalarType();
+  for ( size_t frameIndex = 0; frameIndex < inputFrames.size(); frameIndex++ )
+  {
+    vtkImageData* inputFrame = inputFrames[frameIndex];
+    if ( inputFrame == NULL || inputFrame->GetScalarType() != scalarType || inputFrame->GetNumberOfScalarComponents() != 1
+         || !std::equal( inputExtent, inputExtent + 6, inputFrame->GetExtent() ) )
+    {
+      LOG_ERROR( "vtkPlusUsScanConvertCurvilinear::AccumulateFrames failed: frame " << frameIndex
+                 << " is missing or its extent, scalar type or number of components differs from the first frame" );
+      return PLUS_FAIL;
+    }
+  }
+
+  ComputeInterpolatedPointArray( inputExtent, this->RadiusStartMm, this->RadiusStopMm, this->ThetaStartDeg, this->ThetaStopDeg,
+                                 this->OutputImageExtent, this->OutputImageSpacing, this->TransducerCenterPixel, this->OutputIntensityScaling );
+
+  // Pixels outside the fan are not set by the interpolation
+  outputImage->SetExtent( this->OutputImageExtent );
+  outputImage->AllocateScalars( scalarType, 1 );
+  memset( outputImage->GetScalarPointer(), 0, outputImage->GetNumberOfPoints() * outputImage->GetScalarSize() );
+
+  const int numberOfSamples = inputExtent[1] - inputExtent[0] + 1;
+  void* outPtr = outputImage->GetScalarPointer();
+  switch ( scalarType )
+  {
+    vtkTemplateMacro(
+      vtkPlusUsScanConvertAccumulate( this->InterpolatedPointArray, inputFrames, frameWeights,
+                                      static_cast<VTK_TT*>( outPtr ), numberOfSamples ) );
+  default:
+    LOG_ERROR( "vtkPlusUsScanConvertCurvilinear::AccumulateFrames failed: unknown scalar type " << scalarType );
+    return PLUS_FAIL;
+  }
+  outputImage->Modified();
+  return PLUS_SUCCESS;
+}
+
 //----------------------------------------------------------------------------
 void vtkPlusUsScanConvertCurvilinear::PrintSelf( ostream& os, vtkIndent indent )
 {
@@ -355,6 +603,7 @@ void vtkPlusUsScanConvertCurvilinear::PrintSelf( ostream& os, vtkIndent indent )
   os << indent << "ThetaStopDeg: " << this->ThetaStopDeg << "\n";
   os << indent << "OutputIntensityScaling: " << this->OutputIntensityScaling << "\n";
   os << indent << "InterpolatedPointArraySize: " << this->InterpolatedPointArray.size() << "\n";
+  os << indent << "InterpolationKernel: " << ( this->InterpolationKernel == INTERPOLATION_KERNEL_FIXED_POINT ? "FIXED_POINT" : "FLOATING_POINT" ) << "\n";
 
 }
 
@@ -447,6 +696,9 @@ PlusStatus vtkPlusUsScanConvertCurvilinear::ReadConfiguration( vtkXMLDataElement
   XML_READ_SCALAR_ATTRIBUTE_OPTIONAL( double, ThetaStartDeg, scanConversionElement );
   XML_READ_SCALAR_ATTRIBUTE_OPTIONAL( double, ThetaStopDeg, scanConversionElement );
 
+  XML_READ_ENUM2_ATTRIBUTE_OPTIONAL( InterpolationKernel, scanConversionElement,
+                                     "FLOATING_POINT", INTERPOLATION_KERNEL_FLOATING_POINT, "FIXED_POINT", INTERPOLATION_KERNEL_FIXED_POINT );
+
   return PLUS_SUCCESS;
 }
 
@@ -465,9 +717,57 @@ PlusStatus vtkPlusUsScanConvertCurvilinear::WriteConfiguration( vtkXMLDataElemen
   scanConversionElement->SetDoubleAttribute( "ThetaStartDeg", this->ThetaStartDeg );
   scanConversionElement->SetDoubleAttribute( "ThetaStopDeg", this->ThetaStopDeg );
 
+  if ( this->InterpolationKernel == INTERPOLATION_KERNEL_FIXED_POINT )
+  {
+    scanConversionElement->SetAttribute( "InterpolationKernel", "FIXED_POINT" );
+  }
+  else
+  {
+    XML_REMOVE_ATTRIBUTE( "InterpolationKernel", scanConversionElement );
+  }
+
   return PLUS_SUCCESS;
 }
 
+//-----------------------------------------------------------------------------
+void vtkPlusUsScanConvertCurvilinear::DeepCopy( vtkPlusUsScanConvert* source )
+{
+  this->Superclass::DeepCopy( source );
+  vtkPlusUsScanConvertCurvilinear* curvilinearSource = vtkPlusUsScanConvertCurvilinear::SafeDownCast( source );
+  if ( curvilinearSource == NULL )
+  {
+    LOG_ERROR( "vtkPlusUsScanConvertCurvilinear::DeepCopy failed: source is not a curvilinear scan converter" );
+    return;
+  }
+  this->OutputImageStartDepthMm = curvilinearSource->OutputImageStartDepthMm;
+  this->RadiusStartMm = curvilinearSource->RadiusStartMm;
+  this->RadiusStopMm = curvilinearSource->RadiusStopMm;
+  this->ThetaStartDeg = curvilinearSource->ThetaStartDeg;
+  this->ThetaStopDeg = curvilinearSource->ThetaStopDeg;
+  this->OutputIntensityScaling = curvilinearSource->OutputIntensityScaling;
+  this->InterpolationKernel = curvilinearSource->InterpolationKernel;
+
+  // Copying the interpolation tables is faster than recomputing them
+  this->InterpolatedPointArray = curvilinearSource->InterpolatedPointArray;
+  this->FixedPointTable = curvilinearSource->FixedPointTable;
+  for ( int i = 0; i < 6; i++ )
+  {
+    this->InterpInputImageExtent[i] = curvilinearSource->InterpInputImageExtent[i];
+    this->InterpOutputImageExtent[i] = curvilinearSource->InterpOutputImageExtent[i];
+  }
+  for ( int i = 0; i < 3; i++ )
+  {
+    this->InterpOutputImageSpacing[i] = curvilinearSource->InterpOutputImageSpacing[i];
+  }
+  this->InterpRadiusStartMm = curvilinearSource->InterpRadiusStartMm;
+  this->InterpRadiusStopMm = curvilinearSource->InterpRadiusStopMm;
+  this->InterpThetaStartDeg = curvilinearSource->InterpThetaStartDeg;
+  this->InterpThetaStopDeg = curvilinearSource->InterpThetaStopDeg;
+  this->InterpTransducerCenterPixel[0] = curvilinearSource->InterpTransducerCenterPixel[0];
+  this->InterpTransducerCenterPixel[1] = curvilinearSource->InterpTransducerCenterPixel[1];
+  this->InterpIntensityScaling = curvilinearSource->InterpIntensityScaling;
+}
+
 //-----------------------------------------------------------------------------
 PlusStatus vtkPlusUsScanConvertCurvilinear::GetScanLineEndPoints( int scanLineIndex, double scanlineStartPoint_OutputImage[4], double scanlineEndPoint_OutputImage[4] )
 {
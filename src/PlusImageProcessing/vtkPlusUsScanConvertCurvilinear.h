@@ -33,9 +33,25 @@ public:
   /*! Write configuration to xml data. The scanConversionElement is typically in DataCollction/ImageAcquisition/RfProcessing. */
   virtual PlusStatus WriteConfiguration(vtkXMLDataElement* scanConversionElement);
 
+  /*! Copy the scan conversion parameters and the interpolation tables from another curvilinear scan converter */
+  virtual void DeepCopy(vtkPlusUsScanConvert* source);
+
   /*! Get the scan converted image */
   virtual vtkImageData* GetOutput();
 
+  /*!
+    Scan convert several frames of the same geometry and accumulate them into one image (e.g., for spatial compounding).
+    Each output pixel is the sum of the interpolated pixels of all frames, multiplied by the frame weights.
+    The interpolated points are processed in tiles of ACCUMULATION_TILE_SIZE points: the partial sums of a tile stay in the
+    cache while all frames are read, so each output pixel is written once, instead of once per frame.
+    The frames must have the same extent and scalar type, with one component. Weights are applied in floating point.
+    \param inputFrames Scan line images
+    \param frameWeights Weight of each frame (e.g., 1/number of frames for averaging)
+    \param outputImage Allocated with the output image extent and the scalar type of the frames
+  */
+  PlusStatus AccumulateFrames(const std::vector<vtkImageData*>& inputFrames, const std::vector<double>& frameWeights, vtkImageData* outputImage);
+  static const int ACCUMULATION_TILE_SIZE = 1024;
+
   struct InterpolatedPoint
   {
     /*! Weighting coefficients that used to construct the output pixel from 4 input pixels */
@@ -52,6 +68,44 @@ public:
     return this->InterpolatedPointArray;
   };
 
+  /*!
+    Same interpolation as InterpolatedPointArray, with the weights in fixed-point format.
+    The fields are stored in separate arrays, so that the kernel reads only what it needs and the weights of
+    consecutive points can be loaded into vector registers at once.
+  */
+  struct FixedPointInterpolationTable
+  {
+    /*! Position of the first input pixel of each point, as in InterpolatedPoint::inputPixelIndex */
+    std::vector<int> InputPixelIndices;
+    /*! Position of the output pixel of each point */
+    std::vector<int> OutputPixelIndices;
+    /*! 4 weights of each point, in the order of InterpolatedPoint::weightCoefficients, scaled by 2^FIXED_POINT_WEIGHT_BITS */
+    std::vector<short> Weights;
+  };
+  static const int FIXED_POINT_WEIGHT_BITS = 14;
+
+  /*! Retrieve the fixed-point interpolation table (used internally by the thread function). Empty if the weights do not fit into the fixed-point format. */
+  const FixedPointInterpolationTable& GetFixedPointInterpolationTable()
+  {
+    return this->FixedPointTable;
+  };
+
+  enum InterpolationKernelType
+  {
+    /*! Weights are applied in double precision */
+    INTERPOLATION_KERNEL_FLOATING_POINT,
+    /*!
+      Weights are applied in 16-bit fixed-point format, using SIMD instructions where available.
+      Faster, but output pixels may differ by 1 from the floating point kernel. Only used for 8-bit
+      images, other images are converted by the floating point kernel.
+    */
+    INTERPOLATION_KERNEL_FIXED_POINT
+  };
+
+  /*! Set the interpolation kernel. Default is INTERPOLATION_KERNEL_FLOATING_POINT. */
+  vtkSetMacro(InterpolationKernel, InterpolationKernelType);
+  vtkGetMacro(InterpolationKernel, InterpolationKernelType);
+
   /*! Initialize the parameters used in reconstruction. These are for the cases when video source can obtain them from the hardware */
   vtkSetMacro(RadiusStartMm, double);
   vtkGetMacro(RadiusStartMm, double);
@@ -112,6 +166,11 @@ protected:
   /*! Each element of this array defines the computation of a pixel in the output (scan converted) image.  */
   std::vector<InterpolatedPoint> InterpolatedPointArray;
 
+  /*! InterpolatedPointArray with fixed-point weights, used by INTERPOLATION_KERNEL_FIXED_POINT */
+  FixedPointInterpolationTable FixedPointTable;
+
+  InterpolationKernelType InterpolationKernel;
+
   int InterpInputImageExtent[6];
   double InterpRadiusStartMm;
   double InterpRadiusStopMm;
@@ -131,6 +190,9 @@ protected:
     int* outputImageExtent, double* outputImageSpacing, double* transducerCenterPixel, double intensityScaling
   );
 
+  /*! Computes the FixedPointTable from the InterpolatedPointArray */
+  void ComputeFixedPointInterpolationTable(double intensityScaling);
+
 private:
   vtkPlusUsScanConvertCurvilinear(const vtkPlusUsScanConvertCurvilinear&);  // Not implemented.
   void operator=(const vtkPlusUsScanConvertCurvilinear&);  // Not implemented.
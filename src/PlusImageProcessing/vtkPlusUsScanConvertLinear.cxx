@@ -5,31 +5,81 @@ See License.txt for details.
 =========================================================Plus=header=end*/ 
 
 #include "PlusConfigure.h"
+#include "PlusProfiler.h"
 
 #include "vtkPlusUsScanConvertLinear.h"
+#include "PlusWorkerPool.h"
 
 #include "vtkObjectFactory.h"
 #include "vtkXMLDataElement.h"
 #include "vtkImageReslice.h"
 #include "vtkImageData.h"
+#include "vtkPointData.h"
 #include "vtkAlgorithmOutput.h"
+#include "vtkSmartPointer.h"
+
+#include <algorithm>
+#include <map>
+#include <mutex>
 
 vtkStandardNewMacro(vtkPlusUsScanConvertLinear);
 
+namespace
+{
+  typedef std::map<std::vector<double>, std::weak_ptr<const std::vector<int> > > LookupTableCacheType;
+
+  // Lookup tables of all converters, the entries are removed when no converter uses them anymore
+  LookupTableCacheType& GetLookupTableCache()
+  {
+    static LookupTableCacheType cache;
+    return cache;
+  }
+
+  std::mutex& GetLookupTableCacheMutex()
+  {
+    static std::mutex cacheMutex;
+    return cacheMutex;
+  }
+
+  //-----------------------------------------------------------------------------
+  template <class T>
+  void GatherSamples(const T* inputPixels, T* outputPixels, int numberOfComponents, const int* lookupTable, int firstPixel, int lastPixel)
+  {
+    for (int pixelIndex=firstPixel; pixelIndex<lastPixel; pixelIndex++)
+    {
+      T* outputPixel=outputPixels+pixelIndex*numberOfComponents;
+      const int samplePixel=lookupTable[pixelIndex];
+      if (samplePixel<0)
+      {
+        for (int component=0; component<numberOfComponents; component++)
+        {
+          outputPixel[component]=0;
+        }
+        continue;
+      }
+      const T* inputPixel=inputPixels+samplePixel*numberOfComponents;
+      for (int component=0; component<numberOfComponents; component++)
+      {
+        outputPixel[component]=inputPixel[component];
+      }
+    }
+  }
+}
+
 //----------------------------------------------------------------------------
 vtkPlusUsScanConvertLinear::vtkPlusUsScanConvertLinear()
 {
   this->ImagingDepthMm=50.0;
   this->TransducerWidthMm=38.0;
 
-  this->ImageReslice=vtkImageReslice::New();  
+  this->OutputImage=vtkImageData::New();
 }
 
 //----------------------------------------------------------------------------
 vtkPlusUsScanConvertLinear::~vtkPlusUsScanConvertLinear()
 {
-  this->ImageReslice->Delete();
-  this->ImageReslice=NULL;  
+  this->OutputImage->Delete();
+  this->OutputImage=NULL;
 }
 
 void vtkPlusUsScanConvertLinear::PrintSelf(ostream& os, vtkIndent indent)
@@ -42,26 +92,27 @@ void vtkPlusUsScanConvertLinear::PrintSelf(ostream& os, vtkIndent indent)
 //-----------------------------------------------------------------------------
 void vtkPlusUsScanConvertLinear::SetInputConnection(vtkAlgorithmOutput* input)
 {
-  this->ImageReslice->SetInputConnection(input);
+  this->Superclass::SetInputConnection(input);
 }
 
 //-----------------------------------------------------------------------------
 void vtkPlusUsScanConvertLinear::SetInputData(vtkDataObject *input)
 {
-  this->ImageReslice->SetInputData(input);
+  this->Superclass::SetInputData(input);
 }
 
 //-----------------------------------------------------------------------------
 void vtkPlusUsScanConvertLinear::Update()
 {
-  this->ImageReslice->SetOutputExtent(this->OutputImageExtent);
-  // In Plus the convention is that the image coordinate system has always unit spacing and zero origin
-  this->ImageReslice->SetOutputSpacing(1.0, 1.0, 1.0);
-
-  // The direction cosines give the x, y, and z axes for the output volume.
+  PLUS_PROFILE_ZONE("vtkPlusUsScanConvertLinear::Update");
   // Updating whole extent is needed when the requested extent is smaller than the producer's whole extent
-  this->ImageReslice->GetInputConnection(0,0)->GetProducer()->UpdateWholeExtent();
-  vtkImageData* inputImage=this->ImageReslice->GetImageDataInput(0);  
+  if (this->GetNumberOfInputConnections(0)<1)
+  {
+    LOG_ERROR("vtkPlusUsScanConvertLinear::Update failed: no input image is specified");
+    return;
+  }
+  this->GetInputConnection(0,0)->GetProducer()->UpdateWholeExtent();
+  vtkImageData* inputImage=this->GetImageDataInput(0);
   if (inputImage==NULL)
   {
     LOG_ERROR("vtkPlusUsScanConvertLinear::Update failed: no input image is specified");
@@ -80,9 +131,6 @@ void vtkPlusUsScanConvertLinear::Update()
   double inputDepthSpacing=this->ImagingDepthMm/static_cast<double>(scanLineLengthPixels);
   double yVec[3]={this->OutputImageSpacing[1]/inputDepthSpacing, 0, 0};
 
-  double zVec[3]={0,0,1.0};
-  this->ImageReslice->SetResliceAxesDirectionCosines(xVec, yVec, zVec);
-
   // Default transducer center is horizontally centered, with 0 offset along y axis
   double halfImageWidthPixel=numberOfScanLines/2*inputWidthSpacing/this->OutputImageSpacing[0];
   double transducerCenterPixel[2] = { halfImageWidthPixel, 0};
@@ -92,15 +140,127 @@ void vtkPlusUsScanConvertLinear::Update()
     transducerCenterPixel[1]=this->TransducerCenterPixel[1];
   }
 
-  this->ImageReslice->SetOutputOrigin(-this->TransducerCenterPixel[0]+halfImageWidthPixel,-this->TransducerCenterPixel[1],0);
+  double outputOrigin[3]={-this->TransducerCenterPixel[0]+halfImageWidthPixel,-this->TransducerCenterPixel[1],0};
+
+  // The lookup table only has to be recomputed when the geometry changes
+  std::vector<double> geometry(this->InputImageExtent, this->InputImageExtent+6);
+  geometry.insert(geometry.end(), inputImage->GetSpacing(), inputImage->GetSpacing()+3);
+  geometry.insert(geometry.end(), inputImage->GetOrigin(), inputImage->GetOrigin()+3);
+  geometry.insert(geometry.end(), this->OutputImageExtent, this->OutputImageExtent+6);
+  geometry.insert(geometry.end(), xVec, xVec+3);
+  geometry.insert(geometry.end(), yVec, yVec+3);
+  geometry.insert(geometry.end(), outputOrigin, outputOrigin+3);
+  if (!this->LookupTable || geometry!=this->LookupTableGeometry)
+  {
+    this->LookupTable=GetLookupTable(inputImage, geometry);
+    this->LookupTableGeometry=geometry;
+  }
+
+  // In Plus the convention is that the image coordinate system has always unit spacing
+  int* outputExtent=this->OutputImageExtent;
+  int* currentOutputExtent=this->OutputImage->GetExtent();
+  if (!std::equal(outputExtent, outputExtent+6, currentOutputExtent)
+    || this->OutputImage->GetScalarType()!=inputImage->GetScalarType()
+    || this->OutputImage->GetNumberOfScalarComponents()!=inputImage->GetNumberOfScalarComponents()
+    || this->OutputImage->GetPointData()->GetScalars()==NULL)
+  {
+    this->OutputImage->SetExtent(outputExtent);
+    this->OutputImage->AllocateScalars(inputImage->GetScalarType(), inputImage->GetNumberOfScalarComponents());
+  }
+  this->OutputImage->SetSpacing(1.0, 1.0, 1.0);
+  this->OutputImage->SetOrigin(outputOrigin);
+
+  // Copy the input sample of each output pixel, rows are processed in parallel
+  const int outputWidthPixel=outputExtent[1]-outputExtent[0]+1;
+  const int outputHeightPixel=(outputExtent[3]-outputExtent[2]+1)*(outputExtent[5]-outputExtent[4]+1);
+  const int numberOfComponents=inputImage->GetNumberOfScalarComponents();
+  if (this->LookupTable->empty())
+  {
+    LOG_ERROR("vtkPlusUsScanConvertLinear::Update failed: output image extent is empty");
+    return;
+  }
+  const int* lookupTable=&(*this->LookupTable)[0];
+  void* inputPixels=inputImage->GetScalarPointer();
+  void* outputPixels=this->OutputImage->GetScalarPointer();
+  switch (inputImage->GetScalarType())
+  {
+    vtkTemplateMacro(
+      PlusWorkerPool::GetInstance().ParallelFor(0, outputHeightPixel, 0, [=](int firstRow, int lastRow)
+      {
+        GatherSamples(static_cast<const VTK_TT*>(inputPixels), static_cast<VTK_TT*>(outputPixels), numberOfComponents, lookupTable, firstRow*outputWidthPixel, lastRow*outputWidthPixel);
+      })
+    );
+  default:
+    LOG_ERROR("vtkPlusUsScanConvertLinear::Update failed: unknown input scalar type "<<inputImage->GetScalarType());
+    return;
+  }
+  this->OutputImage->Modified();
+}
+
+//-----------------------------------------------------------------------------
+std::shared_ptr<const vtkPlusUsScanConvertLinear::LookupTableType> vtkPlusUsScanConvertLinear::GetLookupTable(vtkImageData* inputImage, const std::vector<double>& geometry)
+{
+  std::lock_guard<std::mutex> lock(GetLookupTableCacheMutex());
+  LookupTableCacheType& cache=GetLookupTableCache();
+  std::shared_ptr<const LookupTableType> lookupTable=cache[geometry].lock();
+  if (lookupTable)
+  {
+    return lookupTable;
+  }
+
+  // Reslice an image that contains the index of each input pixel, with the same parameters as the frames would be resliced.
+  // The resliced image contains the index of the input pixel that is copied to each output pixel.
+  vtkSmartPointer<vtkImageData> indexImage=vtkSmartPointer<vtkImageData>::New();
+  indexImage->SetExtent(inputImage->GetExtent());
+  indexImage->SetSpacing(inputImage->GetSpacing());
+  indexImage->SetOrigin(inputImage->GetOrigin());
+  indexImage->AllocateScalars(VTK_INT, 1);
+  int* indexPixels=static_cast<int*>(indexImage->GetScalarPointer());
+  const vtkIdType numberOfInputPixels=indexImage->GetNumberOfPoints();
+  for (vtkIdType i=0; i<numberOfInputPixels; i++)
+  {
+    indexPixels[i]=static_cast<int>(i);
+  }
+
+  const double* outputExtent=&geometry[12];
+  const double* xVec=&geometry[18];
+  const double* yVec=&geometry[21];
+  const double* outputOrigin=&geometry[24];
+  double zVec[3]={0,0,1.0};
+  vtkSmartPointer<vtkImageReslice> imageReslice=vtkSmartPointer<vtkImageReslice>::New();
+  imageReslice->SetInputData(indexImage);
+  imageReslice->SetOutputExtent(outputExtent[0], outputExtent[1], outputExtent[2], outputExtent[3], outputExtent[4], outputExtent[5]);
+  imageReslice->SetOutputSpacing(1.0, 1.0, 1.0);
+  // The direction cosines give the x, y, and z axes for the output volume.
+  imageReslice->SetResliceAxesDirectionCosines(xVec, yVec, zVec);
+  imageReslice->SetOutputOrigin(outputOrigin[0], outputOrigin[1], outputOrigin[2]);
+  imageReslice->SetBackgroundLevel(-1);
+  imageReslice->Update();
 
-  this->ImageReslice->Update();
+  vtkImageData* resliceOutput=imageReslice->GetOutput();
+  const int* resliceOutputPixels=static_cast<int*>(resliceOutput->GetScalarPointer());
+  lookupTable=std::make_shared<const LookupTableType>(resliceOutputPixels, resliceOutputPixels+resliceOutput->GetNumberOfPoints());
+
+  // Remove the tables that are not used anymore
+  for (LookupTableCacheType::iterator it=cache.begin(); it!=cache.end();)
+  {
+    if (it->second.expired())
+    {
+      cache.erase(it++);
+    }
+    else
+    {
+      ++it;
+    }
+  }
+  cache[geometry]=lookupTable;
+  return lookupTable;
 }
 
 //-----------------------------------------------------------------------------
 vtkImageData* vtkPlusUsScanConvertLinear::GetOutput()
 {
-  return this->ImageReslice->GetOutput();
+  return this->OutputImage;
 }
 
 //-----------------------------------------------------------------------------
@@ -135,6 +295,23 @@ PlusStatus vtkPlusUsScanConvertLinear::WriteConfiguration(vtkXMLDataElement* sca
   return PLUS_SUCCESS;
 }
 
+//-----------------------------------------------------------------------------
+void vtkPlusUsScanConvertLinear::DeepCopy(vtkPlusUsScanConvert* source)
+{
+  this->Superclass::DeepCopy(source);
+  vtkPlusUsScanConvertLinear* linearSource=vtkPlusUsScanConvertLinear::SafeDownCast(source);
+  if (linearSource==NULL)
+  {
+    LOG_ERROR("vtkPlusUsScanConvertLinear::DeepCopy failed: source is not a linear scan converter");
+    return;
+  }
+  this->ImagingDepthMm=linearSource->ImagingDepthMm;
+  this->TransducerWidthMm=linearSource->TransducerWidthMm;
+  // The lookup table is shared, it is not modified after it is computed
+  this->LookupTable=linearSource->LookupTable;
+  this->LookupTableGeometry=linearSource->LookupTableGeometry;
+}
+
 //-----------------------------------------------------------------------------
 PlusStatus vtkPlusUsScanConvertLinear::GetScanLineEndPoints(int scanLineIndex, double scanlineStartPoint_OutputImage[4],double scanlineEndPoint_OutputImage[4])
 {
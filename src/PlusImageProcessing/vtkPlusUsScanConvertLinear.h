@@ -10,13 +10,20 @@ See License.txt for details.
 #include "vtkPlusImageProcessingExport.h"
 #include "vtkPlusUsScanConvert.h"
 
+#include <memory>
+#include <vector>
+
 class vtkAlgorithmOutput;
-class vtkImageReslice;
 class vtkImageData;
 
 /*!
 \class vtkPlusUsScanConvertLinear
-\brief This class performs scan conversion from scan lines for curvilinear probes
+\brief This class performs scan conversion from scan lines for linear probes
+
+The output image is resampled from the scan lines by nearest neighbor interpolation. The input sample of each output
+pixel is computed once for each geometry (input and output image size, spacing, imaging depth, transducer width and
+position) and stored in a lookup table, so the conversion of a frame is just a copy of the samples. Lookup tables are
+shared between the converters that use the same geometry.
 \ingroup PlusLibImageProcessingAlgo
 */ 
 class vtkPlusImageProcessingExport vtkPlusUsScanConvertLinear : public vtkPlusUsScanConvert
@@ -47,6 +54,9 @@ public:
   /*! Write configuration to xml data. The scanConversionElement is typically in DataCollction/ImageAcquisition/RfProcessing. */
   virtual PlusStatus WriteConfiguration(vtkXMLDataElement* scanConversionElement);   
 
+  /*! Copy the scan conversion parameters from another linear scan converter */
+  virtual void DeepCopy(vtkPlusUsScanConvert* source);
+
   vtkSetMacro(ImagingDepthMm,double);
   vtkGetMacro(ImagingDepthMm,double);
   vtkSetMacro(TransducerWidthMm,double);
@@ -72,8 +82,22 @@ protected:
   /*! Image width covered by the transducer (distance between the first and last RF scanlines), in mm */
   double TransducerWidthMm;
 
-  /*! Reslice class that performs the necessary resampling */
-  vtkImageReslice* ImageReslice;
+  /*!
+    Index of the input sample of each output pixel, -1 if the output pixel is outside the scanned area.
+    Computed by vtkImageReslice, so the result is the same as resampling each frame with vtkImageReslice.
+  */
+  typedef std::vector<int> LookupTableType;
+
+  /*! Get the lookup table of the current geometry from the cache of all converters, or compute it if it is not there */
+  static std::shared_ptr<const LookupTableType> GetLookupTable(vtkImageData* inputImage, const std::vector<double>& geometry);
+
+  /*! Lookup table of the current geometry */
+  std::shared_ptr<const LookupTableType> LookupTable;
+  /*! Geometry parameters that LookupTable is computed for */
+  std::vector<double> LookupTableGeometry;
+
+  /*! Scan converted image */
+  vtkImageData* OutputImage;
 
 private:
   vtkPlusUsScanConvertLinear(const vtkPlusUsScanConvertLinear&);  // Not implemented.
@@ -0,0 +1,277 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "PlusDeltaImageCodec.h"
+#include "igsioVideoFrame.h"
+
+// VTK includes
+#include <vtkImageData.h>
+
+// STL includes
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+  const int DEFAULT_TILE_SIZE = 16;
+  const int DEFAULT_KEY_FRAME_INTERVAL = 100;
+
+  //----------------------------------------------------------------------------
+  /*! Number of tile columns and tile rows. Slices of volumes are stacked vertically. */
+  void GetNumberOfTiles(const igtl_uint16 frameSize[3], int tileSize, int& numberOfTileColumns, int& numberOfTileRows)
+  {
+    const int numberOfRows = frameSize[1] * frameSize[2];
+    numberOfTileColumns = (frameSize[0] + tileSize - 1) / tileSize;
+    numberOfTileRows = (numberOfRows + tileSize - 1) / tileSize;
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusDeltaImageEncoder::PlusDeltaImageEncoder()
+  : TileSize(DEFAULT_TILE_SIZE)
+  , KeyFrameInterval(DEFAULT_KEY_FRAME_INTERVAL)
+  , KeyFrameRequested(true)
+  , FramesSinceKeyFrame(0)
+  , FrameIndex(0)
+  , ScalarType(0)
+  , NumberOfComponents(0)
+{
+  this->FrameSize[0] = this->FrameSize[1] = this->FrameSize[2] = 0;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusDeltaImageEncoder::EncodeFrame(igsioVideoFrame& frame, igtl::PlusDeltaImageMessage* message)
+{
+  if (message == NULL)
+  {
+    LOG_ERROR("Failed to encode DELTAIMAGE message - message is NULL");
+    return PLUS_FAIL;
+  }
+  if (!frame.IsImageValid())
+  {
+    LOG_ERROR("Failed to encode DELTAIMAGE message - invalid frame");
+    return PLUS_FAIL;
+  }
+  if (this->TileSize < 1 || this->TileSize > std::numeric_limits<igtl_uint16>::max())
+  {
+    LOG_ERROR("Failed to encode DELTAIMAGE message - invalid tile size: " << this->TileSize);
+    return PLUS_FAIL;
+  }
+
+  FrameSizeType frameSize = frame.GetFrameSize();
+  if (frameSize[0] > static_cast<unsigned int>(std::numeric_limits<igtl_uint16>::max()) ||
+      frameSize[1] > static_cast<unsigned int>(std::numeric_limits<igtl_uint16>::max()) ||
+      frameSize[2] > static_cast<unsigned int>(std::numeric_limits<igtl_uint16>::max()))
+  {
+    LOG_ERROR("Frame size element is too large to be sent over OpenIGTLink. Cannot encode DELTAIMAGE message.");
+    return PLUS_FAIL;
+  }
+  unsigned int numberOfScalarComponents(1);
+  if (frame.GetNumberOfScalarComponents(numberOfScalarComponents) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to retrieve number of scalar components.");
+    return PLUS_FAIL;
+  }
+
+  igtl::PlusDeltaImageMessage::DeltaImageHeader& header = message->GetDeltaImageHeader();
+  header.m_ScalarType = PlusCommon::GetIGTLScalarPixelTypeFromVTK(frame.GetVTKScalarPixelType());
+  header.m_NumberOfComponents = numberOfScalarComponents;
+  header.m_ImageType = frame.GetImageType();
+  header.m_FrameSize[0] = frameSize[0];
+  header.m_FrameSize[1] = frameSize[1];
+  header.m_FrameSize[2] = frameSize[2];
+  header.m_ImageOrientation = (igtl_uint16)frame.GetImageOrientation();
+  header.m_TileSize = this->TileSize;
+
+  const unsigned char* pixels = static_cast<const unsigned char*>(frame.GetScalarPointer());
+  const size_t frameSizeInBytes = frame.GetFrameSizeInBytes();
+
+  bool keyFrame = this->KeyFrameRequested
+                  || this->FramesSinceKeyFrame + 1 >= this->KeyFrameInterval
+                  || header.m_ScalarType != this->ScalarType
+                  || header.m_NumberOfComponents != this->NumberOfComponents
+                  || header.m_FrameSize[0] != this->FrameSize[0]
+                  || header.m_FrameSize[1] != this->FrameSize[1]
+                  || header.m_FrameSize[2] != this->FrameSize[2]
+                  || this->ReferenceFrame.size() != frameSizeInBytes;
+
+  std::vector<unsigned char>& tileBitmap = message->GetTileBitmap();
+  std::vector<unsigned char>& payload = message->GetPayload();
+  tileBitmap.clear();
+  payload.clear();
+
+  igtl_uint32 referenceFrameIndex = this->FrameIndex;
+  ++this->FrameIndex;
+  header.m_FrameIndex = this->FrameIndex;
+
+  if (keyFrame)
+  {
+    header.m_ReferenceFrameIndex = this->FrameIndex;
+    payload.assign(pixels, pixels + frameSizeInBytes);
+    this->ReferenceFrame.assign(pixels, pixels + frameSizeInBytes);
+    this->ScalarType = header.m_ScalarType;
+    this->NumberOfComponents = header.m_NumberOfComponents;
+    std::copy(header.m_FrameSize, header.m_FrameSize + 3, this->FrameSize);
+    this->FramesSinceKeyFrame = 0;
+    this->KeyFrameRequested = false;
+    return PLUS_SUCCESS;
+  }
+
+  header.m_ReferenceFrameIndex = referenceFrameIndex;
+  ++this->FramesSinceKeyFrame;
+
+  int numberOfTileColumns = 0;
+  int numberOfTileRows = 0;
+  GetNumberOfTiles(header.m_FrameSize, this->TileSize, numberOfTileColumns, numberOfTileRows);
+  tileBitmap.assign((numberOfTileColumns * numberOfTileRows + 7) / 8, 0);
+
+  const int numberOfRows = header.m_FrameSize[1] * header.m_FrameSize[2];
+  const size_t rowSizeInBytes = frameSizeInBytes / numberOfRows;
+  const size_t pixelSizeInBytes = rowSizeInBytes / header.m_FrameSize[0];
+  for (int tileRow = 0; tileRow < numberOfTileRows; ++tileRow)
+  {
+    const int firstRow = tileRow * this->TileSize;
+    const int lastRow = std::min(firstRow + this->TileSize, numberOfRows);
+    for (int tileColumn = 0; tileColumn < numberOfTileColumns; ++tileColumn)
+    {
+      const size_t tileOffsetInBytes = tileColumn * this->TileSize * pixelSizeInBytes;
+      const size_t tileRowSizeInBytes = std::min(this->TileSize * pixelSizeInBytes, rowSizeInBytes - tileOffsetInBytes);
+
+      bool changed = false;
+      for (int row = firstRow; row < lastRow && !changed; ++row)
+      {
+        const size_t offset = row * rowSizeInBytes + tileOffsetInBytes;
+        changed = memcmp(pixels + offset, &this->ReferenceFrame[offset], tileRowSizeInBytes) != 0;
+      }
+      if (!changed)
+      {
+        continue;
+      }
+
+      const int tileIndex = tileRow * numberOfTileColumns + tileColumn;
+      tileBitmap[tileIndex / 8] |= (1 << (tileIndex % 8));
+      for (int row = firstRow; row < lastRow; ++row)
+      {
+        const size_t offset = row * rowSizeInBytes + tileOffsetInBytes;
+        payload.insert(payload.end(), pixels + offset, pixels + offset + tileRowSizeInBytes);
+        memcpy(&this->ReferenceFrame[offset], pixels + offset, tileRowSizeInBytes);
+      }
+    }
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusDeltaImageDecoder::PlusDeltaImageDecoder()
+  : ReferenceFrameValid(false)
+  , ReferenceFrameIndex(0)
+  , ScalarType(0)
+  , NumberOfComponents(0)
+{
+  this->FrameSize[0] = this->FrameSize[1] = this->FrameSize[2] = 0;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusDeltaImageDecoder::DecodeFrame(igtl::PlusDeltaImageMessage* message, igsioVideoFrame& frame, bool& frameDecoded)
+{
+  frameDecoded = false;
+  if (message == NULL)
+  {
+    LOG_ERROR("Failed to decode DELTAIMAGE message - message is NULL");
+    return PLUS_FAIL;
+  }
+
+  igtl::PlusDeltaImageMessage::DeltaImageHeader& header = message->GetDeltaImageHeader();
+  const std::vector<unsigned char>& tileBitmap = message->GetTileBitmap();
+  const std::vector<unsigned char>& payload = message->GetPayload();
+
+  if (header.IsKeyFrame())
+  {
+    this->ScalarType = header.m_ScalarType;
+    this->NumberOfComponents = header.m_NumberOfComponents;
+    std::copy(header.m_FrameSize, header.m_FrameSize + 3, this->FrameSize);
+    this->ReferenceFrame = payload;
+  }
+  else
+  {
+    if (!this->ReferenceFrameValid || header.m_ReferenceFrameIndex != this->ReferenceFrameIndex
+        || header.m_ScalarType != this->ScalarType || header.m_NumberOfComponents != this->NumberOfComponents
+        || !std::equal(header.m_FrameSize, header.m_FrameSize + 3, this->FrameSize))
+    {
+      // The reference frame was not received, wait for the next key frame
+      LOG_DEBUG("DELTAIMAGE frame " << header.m_FrameIndex << " refers to frame " << header.m_ReferenceFrameIndex << " that has not been decoded. Waiting for the next key frame.");
+      this->ReferenceFrameValid = false;
+      return PLUS_SUCCESS;
+    }
+
+    int numberOfTileColumns = 0;
+    int numberOfTileRows = 0;
+    GetNumberOfTiles(header.m_FrameSize, header.m_TileSize, numberOfTileColumns, numberOfTileRows);
+    const int numberOfRows = header.m_FrameSize[1] * header.m_FrameSize[2];
+    if (header.m_TileSize == 0 || numberOfRows == 0 || header.m_FrameSize[0] == 0
+        || tileBitmap.size() != static_cast<size_t>((numberOfTileColumns * numberOfTileRows + 7) / 8))
+    {
+      LOG_ERROR("Failed to decode DELTAIMAGE message - invalid tile bitmap");
+      this->ReferenceFrameValid = false;
+      return PLUS_FAIL;
+    }
+
+    const size_t rowSizeInBytes = this->ReferenceFrame.size() / numberOfRows;
+    const size_t pixelSizeInBytes = rowSizeInBytes / header.m_FrameSize[0];
+    size_t payloadOffset = 0;
+    for (int tileRow = 0; tileRow < numberOfTileRows; ++tileRow)
+    {
+      const int firstRow = tileRow * header.m_TileSize;
+      const int lastRow = std::min(firstRow + header.m_TileSize, numberOfRows);
+      for (int tileColumn = 0; tileColumn < numberOfTileColumns; ++tileColumn)
+      {
+        const int tileIndex = tileRow * numberOfTileColumns + tileColumn;
+        if ((tileBitmap[tileIndex / 8] & (1 << (tileIndex % 8))) == 0)
+        {
+          continue;
+        }
+        const size_t tileOffsetInBytes = tileColumn * header.m_TileSize * pixelSizeInBytes;
+        const size_t tileRowSizeInBytes = std::min(header.m_TileSize * pixelSizeInBytes, rowSizeInBytes - tileOffsetInBytes);
+        if (payloadOffset + (lastRow - firstRow) * tileRowSizeInBytes > payload.size())
+        {
+          LOG_ERROR("Failed to decode DELTAIMAGE message - payload is shorter than the changed tiles");
+          this->ReferenceFrameValid = false;
+          return PLUS_FAIL;
+        }
+        for (int row = firstRow; row < lastRow; ++row)
+        {
+          memcpy(&this->ReferenceFrame[row * rowSizeInBytes + tileOffsetInBytes], &payload[payloadOffset], tileRowSizeInBytes);
+          payloadOffset += tileRowSizeInBytes;
+        }
+      }
+    }
+  }
+
+  FrameSizeType frameSize = { this->FrameSize[0], this->FrameSize[1], this->FrameSize[2] };
+  if (frame.AllocateFrame(frameSize, PlusCommon::GetVTKScalarPixelTypeFromIGTL(this->ScalarType), this->NumberOfComponents) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to allocate memory for frame received in DELTAIMAGE message");
+    this->ReferenceFrameValid = false;
+    return PLUS_FAIL;
+  }
+  if (this->ReferenceFrame.empty() || frame.GetFrameSizeInBytes() != this->ReferenceFrame.size())
+  {
+    LOG_ERROR("Failed to decode DELTAIMAGE message - image data size (" << this->ReferenceFrame.size() << " bytes) does not match the frame size (" << frame.GetFrameSizeInBytes() << " bytes)");
+    this->ReferenceFrameValid = false;
+    return PLUS_FAIL;
+  }
+  memcpy(frame.GetScalarPointer(), &this->ReferenceFrame[0], this->ReferenceFrame.size());
+  frame.SetImageType((US_IMAGE_TYPE)header.m_ImageType);
+  frame.SetImageOrientation((US_IMAGE_ORIENTATION)header.m_ImageOrientation);
+  frame.GetImage()->Modified();
+
+  this->ReferenceFrameValid = true;
+  this->ReferenceFrameIndex = header.m_FrameIndex;
+  frameDecoded = true;
+  return PLUS_SUCCESS;
+}
@@ -0,0 +1,96 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusDeltaImageCodec_h
+#define __PlusDeltaImageCodec_h
+
+#include "PlusConfigure.h"
+#include "vtkPlusOpenIGTLinkExport.h"
+#include "igtlPlusDeltaImageMessage.h"
+
+class igsioVideoFrame;
+
+/*!
+  \class PlusDeltaImageEncoder
+  \brief Lossless encoder of image frames into DELTAIMAGE messages, sending only the tiles that changed since the previous frame
+
+  Ultrasound frames often have large regions that do not change between frames (e.g., the black area around
+  the fan and static overlays), so these regions are only sent in key frames. Key frames are sent periodically
+  (see KeyFrameInterval), when requested, and when the frame size or pixel type changes, so that clients that
+  missed a frame can resume decoding.
+
+  \ingroup PlusLibOpenIGTLink
+*/
+class vtkPlusOpenIGTLinkExport PlusDeltaImageEncoder
+{
+public:
+  PlusDeltaImageEncoder();
+
+  /*! Width and height of the tiles that are compared with the reference frame, in pixels */
+  void SetTileSize(int tileSize) { this->TileSize = tileSize; }
+  int GetTileSize() const { return this->TileSize; }
+
+  /*! Maximum number of frames between key frames */
+  void SetKeyFrameInterval(int interval) { this->KeyFrameInterval = interval; }
+  int GetKeyFrameInterval() const { return this->KeyFrameInterval; }
+
+  /*! Encode the next frame as a key frame */
+  void RequestKeyFrame() { this->KeyFrameRequested = true; }
+
+  /*!
+    Set the image properties, tile bitmap and payload of the message from the frame and make the frame the reference for the next frame.
+    The message is not packed.
+  */
+  PlusStatus EncodeFrame(igsioVideoFrame& frame, igtl::PlusDeltaImageMessage* message);
+
+protected:
+  int TileSize;
+  int KeyFrameInterval;
+  bool KeyFrameRequested;
+  int FramesSinceKeyFrame;
+  igtl_uint32 FrameIndex;
+
+  /*! Properties of the reference frame, a key frame is sent if they change */
+  igtl_uint16 ScalarType;
+  igtl_uint16 NumberOfComponents;
+  igtl_uint16 FrameSize[3];
+  std::vector<unsigned char> ReferenceFrame;
+};
+
+/*!
+  \class PlusDeltaImageDecoder
+  \brief Decoder of DELTAIMAGE messages created by PlusDeltaImageEncoder
+
+  Keeps the last decoded frame as reference. Frames that refer to a frame that has not been decoded
+  (e.g., because a message was dropped) are discarded until the next key frame is received.
+
+  \ingroup PlusLibOpenIGTLink
+*/
+class vtkPlusOpenIGTLinkExport PlusDeltaImageDecoder
+{
+public:
+  PlusDeltaImageDecoder();
+
+  /*!
+    Decode the message into the frame.
+    \param frameDecoded Set to false if the message could not be decoded because the reference frame is not available
+    \return PLUS_FAIL if the message is invalid
+  */
+  PlusStatus DecodeFrame(igtl::PlusDeltaImageMessage* message, igsioVideoFrame& frame, bool& frameDecoded);
+
+  /*! Discard the reference frame, decoding resumes with the next key frame */
+  void Reset() { this->ReferenceFrameValid = false; }
+
+protected:
+  bool ReferenceFrameValid;
+  igtl_uint32 ReferenceFrameIndex;
+  igtl_uint16 ScalarType;
+  igtl_uint16 NumberOfComponents;
+  igtl_uint16 FrameSize[3];
+  std::vector<unsigned char> ReferenceFrame;
+};
+
+#endif
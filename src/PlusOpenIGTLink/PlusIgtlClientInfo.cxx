@@ -10,9 +10,22 @@ See License.txt for details.
 // IGTL includes
 #include <igtl_header.h>
 
+// STL includes
+#include <algorithm>
+
+namespace
+{
+  // Fraction of the minimum period between two messages that is enforced, to tolerate jitter of the frame timestamps
+  const double MESSAGE_RATE_PERIOD_TOLERANCE = 0.9;
+}
+
 //----------------------------------------------------------------------------
 PlusIgtlClientInfo::PlusIgtlClientInfo()
-  : ClientHeaderVersion(IGTL_HEADER_VERSION_1)
+  : SharedMemoryTransportRequested(false)
+  , BinaryTrackedFrameFieldsRequested(false)
+  , TrackedFrameBatchSize(10)
+  , TrackedFrameBatchMaxDurationSec(0.5)
+  , ClientHeaderVersion(IGTL_HEADER_VERSION_1)
   , TDATAResolution(0)
   , TDATARequested(false)
   , LastTDATASentTimeStamp(-1)
@@ -54,6 +67,10 @@ PlusStatus PlusIgtlClientInfo::SetClientInfoFromXmlData(vtkXMLDataElement* xmlda
   XML_READ_SCALAR_ATTRIBUTE_NONMEMBER_OPTIONAL(int, ClientHeaderVersion, clientInfo.ClientHeaderVersion, xmldata);
   XML_READ_BOOL_ATTRIBUTE_NONMEMBER_OPTIONAL(TDATARequested, clientInfo.TDATARequested, xmldata);
   XML_READ_SCALAR_ATTRIBUTE_NONMEMBER_OPTIONAL(int, TDATAResolution, clientInfo.TDATAResolution, xmldata);
+  XML_READ_BOOL_ATTRIBUTE_NONMEMBER_OPTIONAL(SharedMemoryTransport, clientInfo.SharedMemoryTransportRequested, xmldata);
+  XML_READ_BOOL_ATTRIBUTE_NONMEMBER_OPTIONAL(BinaryTrackedFrameFields, clientInfo.BinaryTrackedFrameFieldsRequested, xmldata);
+  XML_READ_SCALAR_ATTRIBUTE_NONMEMBER_OPTIONAL(int, TrackedFrameBatchSize, clientInfo.TrackedFrameBatchSize, xmldata);
+  XML_READ_SCALAR_ATTRIBUTE_NONMEMBER_OPTIONAL(double, TrackedFrameBatchMaxDurationSec, clientInfo.TrackedFrameBatchMaxDurationSec, xmldata);
   if (xmldata->GetAttribute("Resolution") != NULL)
   {
     int resolution;
@@ -80,6 +97,21 @@ PlusStatus PlusIgtlClientInfo::SetClientInfoFromXmlData(vtkXMLDataElement* xmlda
       std::string type;
       XML_READ_STRING_ATTRIBUTE_NONMEMBER_REQUIRED(Type, type, typeElem);
       clientInfo.IgtlMessageTypes.push_back(type);
+
+      double maxRateHz(0.0);
+      XML_READ_SCALAR_ATTRIBUTE_NONMEMBER_OPTIONAL(double, MaxRateHz, maxRateHz, typeElem);
+      if (maxRateHz > 0)
+      {
+        if (type == "VIDEO" || type == "DELTAIMAGE")
+        {
+          // Skipping frames for one client would break decoding of the frames that refer to the skipped ones
+          LOG_WARNING("MaxRateHz is ignored for " << type << " messages. Set MaxRateHz in the Encoding element of the video stream instead.");
+        }
+        else
+        {
+          clientInfo.MessageTypeMaxRatesHz[type] = maxRateHz;
+        }
+      }
     }
   }
 
@@ -144,6 +176,31 @@ PlusStatus PlusIgtlClientInfo::SetClientInfoFromXmlData(vtkXMLDataElement* xmlda
       ImageStream stream;
       stream.EmbeddedTransformToFrame = embeddedTransformToFrame;
       stream.Name = name;
+      XML_READ_SCALAR_ATTRIBUTE_NONMEMBER_OPTIONAL(double, MaxRateHz, stream.MaxRateHz, imageElem);
+      XML_READ_SCALAR_ATTRIBUTE_NONMEMBER_OPTIONAL(int, SlabThickness, stream.SlabThickness, imageElem);
+      XML_READ_SCALAR_ATTRIBUTE_NONMEMBER_OPTIONAL(int, CompressionLevel, stream.CompressionLevel, imageElem);
+      XML_READ_BOOL_ATTRIBUTE_NONMEMBER_OPTIONAL(ByteShuffle, stream.ByteShuffle, imageElem);
+      if (stream.SlabThickness < 1)
+      {
+        LOG_WARNING("Invalid SlabThickness of image stream " << name << ": " << stream.SlabThickness << ". Using 1 instead.");
+        stream.SlabThickness = 1;
+      }
+      int crop[4] = { 0, 0, 0, 0 };
+      XML_READ_VECTOR_ATTRIBUTE_NONMEMBER_OPTIONAL(int, 4, Crop, crop, imageElem);
+      if (crop[0] < 0 || crop[1] < 0 || crop[2] < 0 || crop[3] < 0)
+      {
+        LOG_WARNING("Invalid Crop of image stream " << name << ": " << crop[0] << " " << crop[1] << " " << crop[2] << " " << crop[3] << ". The full frame will be sent.");
+      }
+      else
+      {
+        std::copy(std::begin(crop), std::end(crop), stream.Crop.begin());
+      }
+      XML_READ_SCALAR_ATTRIBUTE_NONMEMBER_OPTIONAL(double, Scale, stream.Scale, imageElem);
+      if (stream.Scale <= 0.0 || stream.Scale > 1.0)
+      {
+        LOG_WARNING("Invalid Scale of image stream " << name << ": " << stream.Scale << ". Only downscaling is supported, the value must be in the range (0, 1]. Using 1 instead.");
+        stream.Scale = 1.0;
+      }
       stream.FrameConverter = vtkSmartPointer<vtkIGSIOFrameConverter>::New();
       stream.FrameConverter->EnableCacheOn();
 
@@ -182,8 +239,6 @@ PlusStatus PlusIgtlClientInfo::SetClientInfoFromXmlData(vtkXMLDataElement* xmlda
       VideoStream stream;
       stream.EmbeddedTransformToFrame = embeddedTransformToFrame;
       stream.Name = name;
-      stream.FrameConverter = vtkSmartPointer<vtkIGSIOFrameConverter>::New();
-      stream.FrameConverter->EnableCacheOn();
 
       XML_FIND_NESTED_ELEMENT_OPTIONAL(encodingElem, videoElem, "Encoding");
       if (encodingElem)
@@ -192,10 +247,13 @@ PlusStatus PlusIgtlClientInfo::SetClientInfoFromXmlData(vtkXMLDataElement* xmlda
         XML_READ_STRING_ATTRIBUTE_NONMEMBER_OPTIONAL(RateControl, stream.EncodeVideoParameters.RateControl, encodingElem);
         XML_READ_STRING_ATTRIBUTE_NONMEMBER_OPTIONAL(DeadlineMode, stream.EncodeVideoParameters.DeadlineMode, encodingElem);
         XML_READ_BOOL_ATTRIBUTE_NONMEMBER_OPTIONAL(Lossless, stream.EncodeVideoParameters.Lossless, encodingElem);
+        XML_READ_BOOL_ATTRIBUTE_NONMEMBER_OPTIONAL(LowLatency, stream.EncodeVideoParameters.LowLatency, encodingElem);
         XML_READ_SCALAR_ATTRIBUTE_NONMEMBER_OPTIONAL(int, MinKeyframeDistance, stream.EncodeVideoParameters.MinKeyframeDistance, encodingElem);
         XML_READ_SCALAR_ATTRIBUTE_NONMEMBER_OPTIONAL(int, MaxKeyframeDistance, stream.EncodeVideoParameters.MaxKeyframeDistance, encodingElem);
         XML_READ_SCALAR_ATTRIBUTE_NONMEMBER_OPTIONAL(int, Speed, stream.EncodeVideoParameters.Speed, encodingElem);
         XML_READ_SCALAR_ATTRIBUTE_NONMEMBER_OPTIONAL(int, TargetBitrate, stream.EncodeVideoParameters.TargetBitrate, encodingElem);
+        XML_READ_SCALAR_ATTRIBUTE_NONMEMBER_OPTIONAL(int, MaxSendBacklog, stream.EncodeVideoParameters.MaxSendBacklog, encodingElem);
+        XML_READ_SCALAR_ATTRIBUTE_NONMEMBER_OPTIONAL(double, MaxRateHz, stream.EncodeVideoParameters.MaxRateHz, encodingElem);
       }
 
       clientInfo.VideoStreams.push_back(stream);
@@ -239,6 +297,19 @@ void PlusIgtlClientInfo::GetClientInfoInXmlData(std::string& strXmlData)
   xmldata->SetName("ClientInfo");
   xmldata->SetAttribute("TDATARequested", (this->GetTDATARequested() ? "TRUE" : "FALSE"));
   xmldata->SetIntAttribute("TDATAResolution", this->GetTDATAResolution());
+  if (this->SharedMemoryTransportRequested)
+  {
+    xmldata->SetAttribute("SharedMemoryTransport", "TRUE");
+  }
+  if (this->BinaryTrackedFrameFieldsRequested)
+  {
+    xmldata->SetAttribute("BinaryTrackedFrameFields", "TRUE");
+  }
+  if (std::find(this->IgtlMessageTypes.begin(), this->IgtlMessageTypes.end(), "TRACKEDBATCH") != this->IgtlMessageTypes.end())
+  {
+    xmldata->SetIntAttribute("TrackedFrameBatchSize", this->TrackedFrameBatchSize);
+    xmldata->SetDoubleAttribute("TrackedFrameBatchMaxDurationSec", this->TrackedFrameBatchMaxDurationSec);
+  }
 
   vtkSmartPointer<vtkXMLDataElement> messageTypes = vtkSmartPointer<vtkXMLDataElement>::New();
   messageTypes->SetName("MessageTypes");
@@ -247,6 +318,11 @@ void PlusIgtlClientInfo::GetClientInfoInXmlData(std::string& strXmlData)
     vtkSmartPointer<vtkXMLDataElement> message = vtkSmartPointer<vtkXMLDataElement>::New();
     message->SetName("Message");
     message->SetAttribute("Type", IgtlMessageTypes[i].c_str());
+    double maxRateHz = this->GetMessageTypeMaxRateHz(IgtlMessageTypes[i]);
+    if (maxRateHz > 0)
+    {
+      message->SetDoubleAttribute("MaxRateHz", maxRateHz);
+    }
     messageTypes->AddNestedElement(message);
   }
   xmldata->AddNestedElement(messageTypes);
@@ -295,6 +371,24 @@ void PlusIgtlClientInfo::GetClientInfoInXmlData(std::string& strXmlData)
     image->SetName("Image");
     image->SetAttribute("Name", ImageStreams[i].Name.c_str());
     image->SetAttribute("EmbeddedTransformToFrame", ImageStreams[i].EmbeddedTransformToFrame.c_str());
+    if (ImageStreams[i].MaxRateHz > 0)
+    {
+      image->SetDoubleAttribute("MaxRateHz", ImageStreams[i].MaxRateHz);
+    }
+    image->SetIntAttribute("SlabThickness", ImageStreams[i].SlabThickness);
+    image->SetIntAttribute("CompressionLevel", ImageStreams[i].CompressionLevel);
+    if (!ImageStreams[i].ByteShuffle)
+    {
+      image->SetAttribute("ByteShuffle", "FALSE");
+    }
+    if (ImageStreams[i].Crop[2] > 0 && ImageStreams[i].Crop[3] > 0)
+    {
+      image->SetVectorAttribute("Crop", 4, ImageStreams[i].Crop.data());
+    }
+    if (ImageStreams[i].Scale < 1.0)
+    {
+      image->SetDoubleAttribute("Scale", ImageStreams[i].Scale);
+    }
     imageNames->AddNestedElement(image);
   }
   xmldata->AddNestedElement(imageNames);
@@ -329,6 +423,9 @@ void PlusIgtlClientInfo::PrintSelf(ostream& os, vtkIndent indent)
   os << indent << "TDATARequested: " << (this->GetTDATARequested() ? "TRUE" : "FALSE") << ". ";
   os << indent << "LastTDATASentTimeStamp: " << this->GetLastTDATASentTimeStamp() << ". ";
   os << indent << "TDATAResolution: " << this->GetTDATAResolution() << ". ";
+  os << indent << "SharedMemoryTransport: " << (this->SharedMemoryTransportRequested ? "TRUE" : "FALSE") << ". ";
+  os << indent << "BinaryTrackedFrameFields: " << (this->BinaryTrackedFrameFieldsRequested ? "TRUE" : "FALSE") << ". ";
+  os << indent << "TrackedFrameBatchSize: " << this->TrackedFrameBatchSize << ". ";
 
   os << ". Transforms: ";
   if (!this->TransformNames.empty())
@@ -377,7 +474,16 @@ void PlusIgtlClientInfo::PrintSelf(ostream& os, vtkIndent indent)
       {
         os << ", ";
       }
-      os << this->ImageStreams[i].Name << " (EmbeddedTransformToFrame: " << this->ImageStreams[i].EmbeddedTransformToFrame << ")";
+      os << this->ImageStreams[i].Name << " (EmbeddedTransformToFrame: " << this->ImageStreams[i].EmbeddedTransformToFrame;
+      if (this->ImageStreams[i].Crop[2] > 0 && this->ImageStreams[i].Crop[3] > 0)
+      {
+        os << ", Crop: " << this->ImageStreams[i].Crop[0] << " " << this->ImageStreams[i].Crop[1] << " " << this->ImageStreams[i].Crop[2] << " " << this->ImageStreams[i].Crop[3];
+      }
+      if (this->ImageStreams[i].Scale < 1.0)
+      {
+        os << ", Scale: " << this->ImageStreams[i].Scale;
+      }
+      os << ")";
     }
   }
   else
@@ -433,3 +539,37 @@ void PlusIgtlClientInfo::SetLastTDATASentTimeStamp(double val)
 {
   this->LastTDATASentTimeStamp = val;
 }
+
+//----------------------------------------------------------------------------
+double PlusIgtlClientInfo::GetMessageTypeMaxRateHz(const std::string& messageType) const
+{
+  std::map<std::string, double>::const_iterator it = this->MessageTypeMaxRatesHz.find(messageType);
+  return (it == this->MessageTypeMaxRatesHz.end() ? 0.0 : it->second);
+}
+
+//----------------------------------------------------------------------------
+bool PlusIgtlClientInfo::IsMessageDue(const std::string& messageKey, double maxRateHz, double timestamp) const
+{
+  if (maxRateHz <= 0)
+  {
+    return true;
+  }
+  std::map<std::string, double>::iterator it = this->LastMessageSentTimestamps.find(messageKey);
+  if (it != this->LastMessageSentTimestamps.end() && !IsSendAllowed(it->second, timestamp, maxRateHz))
+  {
+    return false;
+  }
+  this->LastMessageSentTimestamps[messageKey] = timestamp;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool PlusIgtlClientInfo::IsSendAllowed(double lastSentTimestamp, double timestamp, double maxRateHz)
+{
+  if (maxRateHz <= 0 || timestamp < lastSentTimestamp)
+  {
+    // Not limited, or the time has been reset
+    return true;
+  }
+  return (timestamp - lastSentTimestamp) >= MESSAGE_RATE_PERIOD_TOLERANCE / maxRateHz;
+}
@@ -18,6 +18,8 @@
 #include <igtlClientSocket.h>
 
 // STL includes
+#include <array>
+#include <map>
 #include <string>
 #include <vector>
 
@@ -46,6 +48,18 @@ public:
     std::string RateControl;
     std::string DeadlineMode;
     int         TargetBitrate;
+    /*! If enabled then the encoder is configured for the lowest latency (real-time deadline, fastest speed, constant
+    bitrate if a target bitrate is set), overriding the DeadlineMode, Speed and RateControl parameters.
+    The encoder backend (software or hardware) is selected by the codec registered for the FourCC value. */
+    bool        LowLatency;
+    /*! If positive and more than this many messages are waiting to be sent to a client then video frames are skipped for
+    that client, until it catches up. Streaming is then resumed with a key frame, so the client can always decode the stream.
+    Clients with less bandwidth (e.g., on wireless networks) can request the stream with a lower TargetBitrate,
+    which creates a separate encoder for them. */
+    int         MaxSendBacklog;
+    /*! If positive then at most this many frames per second are encoded. The frames are skipped at the shared encoder,
+    so all clients that receive the encoded stream get the same frames and can decode them. */
+    double      MaxRateHz;
     EncodingParameters()
       : FourCC("VP90")
       , Lossless(false)
@@ -55,6 +69,9 @@ public:
       , RateControl("Q")
       , DeadlineMode("REALTIME")
       , TargetBitrate(-1)
+      , LowLatency(false)
+      , MaxSendBacklog(-1)
+      , MaxRateHz(0.0)
     {
     }
   };
@@ -70,10 +87,33 @@ public:
     std::string EmbeddedTransformToFrame;
     /*! Class for decoding and encoding frames */
     vtkSmartPointer<vtkIGSIOFrameConverter> FrameConverter;
+    /*! If positive then IMAGE messages of this stream are sent at most at this rate (frames per second) */
+    double MaxRateHz;
+    /*! Number of slices that are compressed together in SLABVOLUME messages (see igtl::PlusSlabVolumeMessage) */
+    int SlabThickness;
+    /*! zlib compression level of SLABVOLUME messages, from 1 (fastest) to 9 (smallest) */
+    int CompressionLevel;
+    /*! Regroup the bytes of multi-byte pixels before compression in SLABVOLUME messages, improves the compression of 16-bit and RF images */
+    bool ByteShuffle;
+    /*! Region of the frame that is sent in IMAGE messages: x, y, width, height in pixels. The full frame is sent if the width or height is 0. */
+    std::array<int, 4> Crop;
+    /*! Size of the IMAGE message image relative to the (cropped) frame, in the range (0, 1]. The image is shrunk by area averaging. */
+    double Scale;
     ImageStream()
       : FrameConverter(nullptr)
+      , MaxRateHz(0.0)
+      , SlabThickness(8)
+      , CompressionLevel(1)
+      , ByteShuffle(true)
+      , Scale(1.0)
     {
+      Crop.fill(0);
     };
+    /*! True if IMAGE messages of this stream are cropped or shrunk */
+    bool IsResized() const
+    {
+      return (Crop[2] > 0 && Crop[3] > 0) || Scale < 1.0;
+    }
   };
 
   /*! Helper struct for storing video stream and embedded transform frame names
@@ -85,14 +125,10 @@ public:
     std::string Name;
     /*! Name of the IGTL image message embedded transform "To" frame */
     std::string EmbeddedTransformToFrame;
-    /*! Parameters for how to encode video for compressed streams*/
+    /*! Parameters for how to encode video for compressed streams.
+    The encoder is shared by all clients that request the same stream with the same parameters (see vtkPlusIgtlMessageFactory).
+    */
     EncodingParameters EncodeVideoParameters;
-    /*! Class for decoding and encoding frames */
-    vtkSmartPointer<vtkIGSIOFrameConverter> FrameConverter;
-    VideoStream()
-      : FrameConverter(nullptr)
-    {
-    };
   };
 
   PlusIgtlClientInfo();
@@ -130,9 +166,28 @@ public:
   /*! timestamp of the last sent TDATA message. */
   void SetLastTDATASentTimeStamp(double val);
 
+  /*! Maximum send rate of the message type in frames per second, 0 if the rate is not limited */
+  double GetMessageTypeMaxRateHz(const std::string& messageType) const;
+
+  /*!
+    Check if a message identified by messageKey (e.g., the message type or the message type and stream name)
+    may be sent at the given time without exceeding maxRateHz. If it may be sent, the timestamp is recorded for the next check.
+    Always returns true if maxRateHz is not positive.
+  */
+  bool IsMessageDue(const std::string& messageKey, double maxRateHz, double timestamp) const;
+
+  /*!
+    Returns true if a message that was last sent at lastSentTimestamp may be sent again at timestamp without exceeding maxRateHz.
+    A small tolerance is allowed, so that e.g. a 10 Hz limit on a 30 Hz stream results in every third frame being sent.
+  */
+  static bool IsSendAllowed(double lastSentTimestamp, double timestamp, double maxRateHz);
+
   /*! Message types that client expects from the server */
   std::vector<std::string> IgtlMessageTypes;
 
+  /*! Maximum send rate (frames per second) of message types, types that are not listed are sent with every frame */
+  std::map<std::string, double> MessageTypeMaxRatesHz;
+
   /*! Transform names to send with IGT transform, position message */
   std::vector<igsioTransformName> TransformNames;
 
@@ -145,11 +200,29 @@ public:
   /*! Transform names to send with IGT VIDEO message */
   std::vector<VideoStream> VideoStreams;
 
+  /*! If true then the client runs on the same host as the server and reads IMAGE messages from a shared memory ring,
+  the server only sends a SHMFRAME notification on the socket (see PlusSharedMemoryFrameRing).
+  The server ignores the request for clients that are not connected through the loopback interface. */
+  bool SharedMemoryTransportRequested;
+
+  /*! If true then the fields and transforms of TRACKEDFRAME messages are sent in the binary encoding instead of XML
+  (see igtl::PlusTrackedFrameMessage) */
+  bool BinaryTrackedFrameFieldsRequested;
+
+  /*! Number of frames that are sent in one TRACKEDBATCH message */
+  int TrackedFrameBatchSize;
+
+  /*! A TRACKEDBATCH message is sent before it is full if its first frame is older than this, so frames are not delayed indefinitely */
+  double TrackedFrameBatchMaxDurationSec;
+
 protected:
   int     ClientHeaderVersion;
   bool    TDATARequested;
   double  LastTDATASentTimeStamp;
   int     TDATAResolution;
+
+  /*! Timestamp of the last sent message by message key, updated by IsMessageDue while packing messages */
+  mutable std::map<std::string, double> LastMessageSentTimestamps;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,209 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "PlusSharedMemoryEvent.h"
+
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <cerrno>
+  #include <fcntl.h>
+  #include <semaphore.h>
+  #include <string.h>
+  #include <sys/stat.h>
+  #include <time.h>
+#endif
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  std::string GetSystemName(const std::string& name)
+  {
+#ifdef _WIN32
+    return "Local\\" + name + "Event";
+#else
+    return "/" + name + "Event";
+#endif
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusSharedMemoryEvent::PlusSharedMemoryEvent()
+  : Writer(false)
+  , Handle(NULL)
+{
+}
+
+//----------------------------------------------------------------------------
+PlusSharedMemoryEvent::~PlusSharedMemoryEvent()
+{
+  this->Close();
+}
+
+//----------------------------------------------------------------------------
+bool PlusSharedMemoryEvent::IsOpen() const
+{
+  return this->Handle != NULL;
+}
+
+#ifdef _WIN32
+
+//----------------------------------------------------------------------------
+PlusStatus PlusSharedMemoryEvent::Create(const std::string& name)
+{
+  this->Close();
+  this->Handle = CreateEventA(NULL, FALSE, FALSE, GetSystemName(name).c_str());
+  if (this->Handle == NULL)
+  {
+    LOG_ERROR("Unable to create shared memory event " << name << ": error " << GetLastError());
+    return PLUS_FAIL;
+  }
+  this->Writer = true;
+  this->Name = name;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusSharedMemoryEvent::Open(const std::string& name)
+{
+  this->Close();
+  this->Handle = OpenEventA(SYNCHRONIZE, FALSE, GetSystemName(name).c_str());
+  if (this->Handle == NULL)
+  {
+    LOG_ERROR("Unable to open shared memory event " << name << ": error " << GetLastError());
+    return PLUS_FAIL;
+  }
+  this->Name = name;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void PlusSharedMemoryEvent::Close()
+{
+  if (this->Handle != NULL)
+  {
+    // The event is released when the last process closes its handle
+    CloseHandle(this->Handle);
+    this->Handle = NULL;
+  }
+  this->Writer = false;
+  this->Name.clear();
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusSharedMemoryEvent::Signal()
+{
+  if (this->Handle == NULL || !SetEvent(this->Handle))
+  {
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusSharedMemoryEvent::Wait(double timeoutSec)
+{
+  if (this->Handle == NULL)
+  {
+    return PLUS_FAIL;
+  }
+  return WaitForSingleObject(this->Handle, static_cast<DWORD>(timeoutSec * 1000)) == WAIT_OBJECT_0 ? PLUS_SUCCESS : PLUS_FAIL;
+}
+
+#else
+
+//----------------------------------------------------------------------------
+PlusStatus PlusSharedMemoryEvent::Create(const std::string& name)
+{
+  this->Close();
+  std::string systemName = GetSystemName(name);
+  // Remove the semaphore of a writer that was not stopped properly, so that no old signals are left
+  sem_unlink(systemName.c_str());
+  sem_t* semaphore = sem_open(systemName.c_str(), O_CREAT | O_EXCL, S_IRUSR | S_IWUSR, 0);
+  if (semaphore == SEM_FAILED)
+  {
+    LOG_ERROR("Unable to create shared memory event " << name << ": " << strerror(errno));
+    return PLUS_FAIL;
+  }
+  this->Handle = semaphore;
+  this->Writer = true;
+  this->Name = name;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusSharedMemoryEvent::Open(const std::string& name)
+{
+  this->Close();
+  sem_t* semaphore = sem_open(GetSystemName(name).c_str(), 0);
+  if (semaphore == SEM_FAILED)
+  {
+    LOG_ERROR("Unable to open shared memory event " << name << ": " << strerror(errno));
+    return PLUS_FAIL;
+  }
+  this->Handle = semaphore;
+  this->Name = name;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void PlusSharedMemoryEvent::Close()
+{
+  if (this->Handle != NULL)
+  {
+    sem_close(static_cast<sem_t*>(this->Handle));
+    this->Handle = NULL;
+  }
+  if (this->Writer)
+  {
+    sem_unlink(GetSystemName(this->Name).c_str());
+  }
+  this->Writer = false;
+  this->Name.clear();
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusSharedMemoryEvent::Signal()
+{
+  if (this->Handle == NULL || sem_post(static_cast<sem_t*>(this->Handle)) != 0)
+  {
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusSharedMemoryEvent::Wait(double timeoutSec)
+{
+  if (this->Handle == NULL)
+  {
+    return PLUS_FAIL;
+  }
+  sem_t* semaphore = static_cast<sem_t*>(this->Handle);
+
+  timespec deadline;
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  long long deadlineNsec = deadline.tv_nsec + static_cast<long long>(timeoutSec * 1e9);
+  deadline.tv_sec += static_cast<time_t>(deadlineNsec / 1000000000LL);
+  deadline.tv_nsec = static_cast<long>(deadlineNsec % 1000000000LL);
+
+  int result = 0;
+  while ((result = sem_timedwait(semaphore, &deadline)) != 0 && errno == EINTR)
+  {
+  }
+  if (result != 0)
+  {
+    return PLUS_FAIL;
+  }
+  // Behave like an event: signals that arrived while no one was waiting are merged into this one
+  while (sem_trywait(semaphore) == 0)
+  {
+  }
+  return PLUS_SUCCESS;
+}
+
+#endif
@@ -0,0 +1,60 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusSharedMemoryEvent_h
+#define __PlusSharedMemoryEvent_h
+
+#include "PlusConfigure.h"
+#include "vtkPlusOpenIGTLinkExport.h"
+
+#include <string>
+
+/*!
+  \class PlusSharedMemoryEvent
+  \brief Named event for notifying a process on the same host that new data is written into a PlusSharedMemoryFrameRing
+
+  A named auto-reset event is used on Windows and a named semaphore on other platforms. Signals that are sent while
+  the reader is not waiting are not lost, the next Wait returns immediately.
+
+  \ingroup PlusLibOpenIGTLink
+*/
+class vtkPlusOpenIGTLinkExport PlusSharedMemoryEvent
+{
+public:
+  PlusSharedMemoryEvent();
+  ~PlusSharedMemoryEvent();
+
+  /*! Create the named event (the writer side) */
+  PlusStatus Create(const std::string& name);
+
+  /*! Open a named event created by a writer (the reader side) */
+  PlusStatus Open(const std::string& name);
+
+  /*! Close the event. If this is the writer, the name is removed. */
+  void Close();
+
+  bool IsOpen() const;
+
+  /*! Notify the waiting reader */
+  PlusStatus Signal();
+
+  /*!
+    Wait until the event is signaled
+    \return PLUS_FAIL if the event is not signaled within the timeout
+  */
+  PlusStatus Wait(double timeoutSec);
+
+protected:
+  std::string Name;
+  bool Writer;
+  void* Handle;
+
+private:
+  PlusSharedMemoryEvent(const PlusSharedMemoryEvent&);
+  PlusSharedMemoryEvent& operator=(const PlusSharedMemoryEvent&);
+};
+
+#endif
@@ -0,0 +1,403 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "PlusSharedMemoryFrameRing.h"
+
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <cerrno>
+  #include <fcntl.h>
+  #include <string.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+// STL includes
+#include <atomic>
+#include <new>
+
+namespace
+{
+  const igtl_uint32 RING_MAGIC = 0x504c5352; // "PLSR"
+  const igtl_uint32 RING_VERSION = 1;
+  const size_t CACHE_LINE_SIZE = 64;
+
+  //----------------------------------------------------------------------------
+  size_t AlignToCacheLine(size_t size)
+  {
+    return (size + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+  }
+
+  //----------------------------------------------------------------------------
+  std::string GetSystemName(const std::string& name)
+  {
+#ifdef _WIN32
+    return "Local\\" + name;
+#else
+    return "/" + name;
+#endif
+  }
+}
+
+//----------------------------------------------------------------------------
+/*! Stored at the beginning of the shared memory region */
+struct PlusSharedMemoryFrameRing::RingHeader
+{
+  igtl_uint32 Magic;
+  igtl_uint32 Version;
+  igtl_uint32 NumberOfSlots;
+  igtl_uint32 Reserved;
+  igtl_uint64 SlotSizeInBytes;
+  std::atomic<igtl_uint64> LastSequenceNumber;
+};
+
+//----------------------------------------------------------------------------
+/*! Stored before the data of each slot. SequenceNumber is 0 while the slot is being written. */
+struct PlusSharedMemoryFrameRing::SlotHeader
+{
+  std::atomic<igtl_uint64> SequenceNumber;
+  igtl_uint64 DataSizeInBytes;
+};
+
+//----------------------------------------------------------------------------
+PlusSharedMemoryFrameRing::PlusSharedMemoryFrameRing()
+  : Writer(false)
+  , Memory(NULL)
+  , MemorySizeInBytes(0)
+  , SlotStrideInBytes(0)
+#ifdef _WIN32
+  , FileMappingHandle(NULL)
+#else
+  , FileDescriptor(-1)
+#endif
+{
+}
+
+//----------------------------------------------------------------------------
+PlusSharedMemoryFrameRing::~PlusSharedMemoryFrameRing()
+{
+  this->Close();
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusSharedMemoryFrameRing::Create(const std::string& name, unsigned int numberOfSlots, size_t slotSizeInBytes)
+{
+  this->Close();
+  if (numberOfSlots < 1 || slotSizeInBytes < 1)
+  {
+    LOG_ERROR("Unable to create shared memory ring " << name << ": invalid size (" << numberOfSlots << " slots of " << slotSizeInBytes << " bytes)");
+    return PLUS_FAIL;
+  }
+
+  size_t slotStrideInBytes = AlignToCacheLine(sizeof(SlotHeader) + slotSizeInBytes);
+  if (this->MapMemory(name, true, AlignToCacheLine(sizeof(RingHeader)) + numberOfSlots * slotStrideInBytes) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  this->Writer = true;
+  this->SlotStrideInBytes = slotStrideInBytes;
+
+  RingHeader* header = new (this->Memory) RingHeader;
+  header->Version = RING_VERSION;
+  header->NumberOfSlots = numberOfSlots;
+  header->Reserved = 0;
+  header->SlotSizeInBytes = slotSizeInBytes;
+  header->LastSequenceNumber = 0;
+  for (unsigned int slot = 0; slot < numberOfSlots; ++slot)
+  {
+    SlotHeader* slotHeader = new (this->GetSlotHeader(slot)) SlotHeader;
+    slotHeader->SequenceNumber = 0;
+    slotHeader->DataSizeInBytes = 0;
+  }
+  // Readers only accept the region after it is completely initialized
+  std::atomic_thread_fence(std::memory_order_release);
+  header->Magic = RING_MAGIC;
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusSharedMemoryFrameRing::Open(const std::string& name)
+{
+  this->Close();
+  if (this->MapMemory(name, false, 0) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+
+  RingHeader* header = this->GetRingHeader();
+  if (this->MemorySizeInBytes < sizeof(RingHeader) || header->Magic != RING_MAGIC || header->Version != RING_VERSION)
+  {
+    LOG_ERROR("Unable to open shared memory ring " << name << ": the region is not initialized or has an unsupported version");
+    this->Close();
+    return PLUS_FAIL;
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+
+  this->SlotStrideInBytes = AlignToCacheLine(sizeof(SlotHeader) + static_cast<size_t>(header->SlotSizeInBytes));
+  if (AlignToCacheLine(sizeof(RingHeader)) + header->NumberOfSlots * this->SlotStrideInBytes > this->MemorySizeInBytes)
+  {
+    LOG_ERROR("Unable to open shared memory ring " << name << ": the region is smaller than its slots");
+    this->Close();
+    return PLUS_FAIL;
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+size_t PlusSharedMemoryFrameRing::GetSlotSizeInBytes() const
+{
+  return this->IsOpen() ? static_cast<size_t>(this->GetRingHeader()->SlotSizeInBytes) : 0;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusSharedMemoryFrameRing::Write(const void* data, size_t dataSizeInBytes, igtl_uint64& sequenceNumber)
+{
+  return this->Write(NULL, 0, data, dataSizeInBytes, sequenceNumber);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusSharedMemoryFrameRing::Write(const void* headerData, size_t headerSizeInBytes, const void* data, size_t dataSizeInBytes, igtl_uint64& sequenceNumber)
+{
+  if (!this->IsOpen() || !this->Writer)
+  {
+    LOG_ERROR("Unable to write to shared memory ring " << this->Name << ": the ring is not created");
+    return PLUS_FAIL;
+  }
+  RingHeader* header = this->GetRingHeader();
+  if (headerSizeInBytes + dataSizeInBytes > header->SlotSizeInBytes)
+  {
+    return PLUS_FAIL;
+  }
+
+  sequenceNumber = header->LastSequenceNumber.load(std::memory_order_relaxed) + 1;
+  SlotHeader* slotHeader = this->GetSlotHeader(sequenceNumber);
+
+  // Invalidate the slot, so that readers of the previous data in this slot do not accept a partially overwritten copy
+  slotHeader->SequenceNumber.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slotHeader->DataSizeInBytes = headerSizeInBytes + dataSizeInBytes;
+  unsigned char* slotData = reinterpret_cast<unsigned char*>(slotHeader) + sizeof(SlotHeader);
+  if (headerSizeInBytes > 0)
+  {
+    memcpy(slotData, headerData, headerSizeInBytes);
+  }
+  memcpy(slotData + headerSizeInBytes, data, dataSizeInBytes);
+  slotHeader->SequenceNumber.store(sequenceNumber, std::memory_order_release);
+  header->LastSequenceNumber.store(sequenceNumber, std::memory_order_release);
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+igtl_uint64 PlusSharedMemoryFrameRing::GetLastSequenceNumber() const
+{
+  return this->IsOpen() ? this->GetRingHeader()->LastSequenceNumber.load(std::memory_order_acquire) : 0;
+}
+
+//----------------------------------------------------------------------------
+unsigned int PlusSharedMemoryFrameRing::GetNumberOfSlots() const
+{
+  return this->IsOpen() ? this->GetRingHeader()->NumberOfSlots : 0;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusSharedMemoryFrameRing::Read(igtl_uint64 sequenceNumber, size_t offset, void* output, size_t sizeInBytes) const
+{
+  if (!this->IsOpen() || sequenceNumber == 0)
+  {
+    return PLUS_FAIL;
+  }
+
+  SlotHeader* slotHeader = this->GetSlotHeader(sequenceNumber);
+  if (slotHeader->SequenceNumber.load(std::memory_order_acquire) != sequenceNumber)
+  {
+    return PLUS_FAIL;
+  }
+  if (offset + sizeInBytes > slotHeader->DataSizeInBytes)
+  {
+    LOG_ERROR("Unable to read from shared memory ring " << this->Name << ": requested range is out of the data of message " << sequenceNumber);
+    return PLUS_FAIL;
+  }
+  memcpy(output, reinterpret_cast<const unsigned char*>(slotHeader) + sizeof(SlotHeader) + offset, sizeInBytes);
+
+  // The copy is only valid if the writer has not started to reuse the slot in the meantime
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (slotHeader->SequenceNumber.load(std::memory_order_relaxed) != sequenceNumber)
+  {
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusSharedMemoryFrameRing::RingHeader* PlusSharedMemoryFrameRing::GetRingHeader() const
+{
+  return static_cast<RingHeader*>(this->Memory);
+}
+
+//----------------------------------------------------------------------------
+PlusSharedMemoryFrameRing::SlotHeader* PlusSharedMemoryFrameRing::GetSlotHeader(igtl_uint64 sequenceNumber) const
+{
+  igtl_uint64 slot = sequenceNumber % this->GetRingHeader()->NumberOfSlots;
+  return reinterpret_cast<SlotHeader*>(static_cast<unsigned char*>(this->Memory) + AlignToCacheLine(sizeof(RingHeader)) + slot * this->SlotStrideInBytes);
+}
+
+#ifdef _WIN32
+
+//----------------------------------------------------------------------------
+PlusStatus PlusSharedMemoryFrameRing::MapMemory(const std::string& name, bool create, size_t memorySizeInBytes)
+{
+  std::string systemName = GetSystemName(name);
+  if (create)
+  {
+    unsigned long long size = memorySizeInBytes;
+    this->FileMappingHandle = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, static_cast<DWORD>(size >> 32), static_cast<DWORD>(size & 0xFFFFFFFF), systemName.c_str());
+    if (this->FileMappingHandle != NULL && GetLastError() == ERROR_ALREADY_EXISTS)
+    {
+      LOG_ERROR("Unable to create shared memory ring " << name << ": the name is already in use");
+      CloseHandle(this->FileMappingHandle);
+      this->FileMappingHandle = NULL;
+      return PLUS_FAIL;
+    }
+  }
+  else
+  {
+    this->FileMappingHandle = OpenFileMappingA(FILE_MAP_READ, FALSE, systemName.c_str());
+  }
+  if (this->FileMappingHandle == NULL)
+  {
+    LOG_ERROR("Unable to " << (create ? "create" : "open") << " shared memory ring " << name << ": error " << GetLastError());
+    return PLUS_FAIL;
+  }
+
+  this->Memory = MapViewOfFile(this->FileMappingHandle, create ? FILE_MAP_ALL_ACCESS : FILE_MAP_READ, 0, 0, 0);
+  if (this->Memory == NULL)
+  {
+    LOG_ERROR("Unable to map shared memory ring " << name << ": error " << GetLastError());
+    CloseHandle(this->FileMappingHandle);
+    this->FileMappingHandle = NULL;
+    return PLUS_FAIL;
+  }
+
+  MEMORY_BASIC_INFORMATION memoryInfo;
+  VirtualQuery(this->Memory, &memoryInfo, sizeof(memoryInfo));
+  this->MemorySizeInBytes = create ? memorySizeInBytes : memoryInfo.RegionSize;
+  this->Name = name;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void PlusSharedMemoryFrameRing::Close()
+{
+  if (this->Memory != NULL)
+  {
+    UnmapViewOfFile(this->Memory);
+    this->Memory = NULL;
+  }
+  if (this->FileMappingHandle != NULL)
+  {
+    // The region is released when the last process closes its handle
+    CloseHandle(this->FileMappingHandle);
+    this->FileMappingHandle = NULL;
+  }
+  this->MemorySizeInBytes = 0;
+  this->Writer = false;
+  this->Name.clear();
+}
+
+#else
+
+//----------------------------------------------------------------------------
+PlusStatus PlusSharedMemoryFrameRing::MapMemory(const std::string& name, bool create, size_t memorySizeInBytes)
+{
+  std::string systemName = GetSystemName(name);
+  if (create)
+  {
+    // Remove the region of a server that was not stopped properly
+    shm_unlink(systemName.c_str());
+    this->FileDescriptor = shm_open(systemName.c_str(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+  }
+  else
+  {
+    this->FileDescriptor = shm_open(systemName.c_str(), O_RDONLY, 0);
+  }
+  if (this->FileDescriptor < 0)
+  {
+    LOG_ERROR("Unable to " << (create ? "create" : "open") << " shared memory ring " << name << ": " << strerror(errno));
+    return PLUS_FAIL;
+  }
+
+  if (create)
+  {
+    if (ftruncate(this->FileDescriptor, static_cast<off_t>(memorySizeInBytes)) != 0)
+    {
+      LOG_ERROR("Unable to allocate " << memorySizeInBytes << " bytes for shared memory ring " << name << ": " << strerror(errno));
+      close(this->FileDescriptor);
+      this->FileDescriptor = -1;
+      shm_unlink(systemName.c_str());
+      return PLUS_FAIL;
+    }
+  }
+  else
+  {
+    struct stat fileStatus;
+    if (fstat(this->FileDescriptor, &fileStatus) != 0)
+    {
+      LOG_ERROR("Unable to get the size of shared memory ring " << name << ": " << strerror(errno));
+      close(this->FileDescriptor);
+      this->FileDescriptor = -1;
+      return PLUS_FAIL;
+    }
+    memorySizeInBytes = static_cast<size_t>(fileStatus.st_size);
+  }
+
+  void* memory = mmap(NULL, memorySizeInBytes, create ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, this->FileDescriptor, 0);
+  if (memory == MAP_FAILED)
+  {
+    LOG_ERROR("Unable to map shared memory ring " << name << ": " << strerror(errno));
+    close(this->FileDescriptor);
+    this->FileDescriptor = -1;
+    if (create)
+    {
+      shm_unlink(systemName.c_str());
+    }
+    return PLUS_FAIL;
+  }
+
+  this->Memory = memory;
+  this->MemorySizeInBytes = memorySizeInBytes;
+  this->Name = name;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void PlusSharedMemoryFrameRing::Close()
+{
+  if (this->Memory != NULL)
+  {
+    munmap(this->Memory, this->MemorySizeInBytes);
+    this->Memory = NULL;
+  }
+  if (this->FileDescriptor >= 0)
+  {
+    close(this->FileDescriptor);
+    this->FileDescriptor = -1;
+  }
+  if (this->Writer)
+  {
+    shm_unlink(GetSystemName(this->Name).c_str());
+  }
+  this->MemorySizeInBytes = 0;
+  this->Writer = false;
+  this->Name.clear();
+}
+
+#endif
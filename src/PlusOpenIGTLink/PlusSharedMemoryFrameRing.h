@@ -0,0 +1,102 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusSharedMemoryFrameRing_h
+#define __PlusSharedMemoryFrameRing_h
+
+#include "PlusConfigure.h"
+#include "vtkPlusOpenIGTLinkExport.h"
+
+#include <igtl_types.h>
+
+#include <string>
+
+/*!
+  \class PlusSharedMemoryFrameRing
+  \brief Ring of fixed size slots in a named shared memory region, for passing packed OpenIGTLink messages to clients on the same host
+
+  The server writes each message once into the next slot and notifies the local clients on their OpenIGTLink
+  connection with a small SHMFRAME message (see igtl::PlusSharedMemoryFrameMessage) that contains the sequence number
+  of the message. Each slot is protected by its sequence number: a reader that is too slow to copy the message before
+  the slot is reused detects that the sequence number changed and discards the message.
+
+  There is one writer per ring. The writer removes the shared memory name when the ring is closed, readers that
+  mapped it keep access until they close it.
+
+  \ingroup PlusLibOpenIGTLink
+*/
+class vtkPlusOpenIGTLinkExport PlusSharedMemoryFrameRing
+{
+public:
+  PlusSharedMemoryFrameRing();
+  ~PlusSharedMemoryFrameRing();
+
+  /*! Create a new shared memory region with the given name (the writer side) */
+  PlusStatus Create(const std::string& name, unsigned int numberOfSlots, size_t slotSizeInBytes);
+
+  /*! Map an existing shared memory region created by a writer (the reader side) */
+  PlusStatus Open(const std::string& name);
+
+  /*! Unmap the shared memory region. If this is the writer, the name is removed. */
+  void Close();
+
+  bool IsOpen() const { return this->Memory != NULL; }
+  const std::string& GetName() const { return this->Name; }
+  size_t GetSlotSizeInBytes() const;
+
+  /*!
+    Copy the data into the next slot
+    \param sequenceNumber Sequence number of the written data, to be passed to readers
+    \return PLUS_FAIL if the data does not fit into a slot
+  */
+  PlusStatus Write(const void* data, size_t dataSizeInBytes, igtl_uint64& sequenceNumber);
+
+  /*!
+    Copy a header and the data after it into the next slot, without packing them into one buffer first
+    \param sequenceNumber Sequence number of the written data, to be passed to readers
+    eturn PLUS_FAIL if the header and the data do not fit into a slot
+  */
+  PlusStatus Write(const void* headerData, size_t headerSizeInBytes, const void* data, size_t dataSizeInBytes, igtl_uint64& sequenceNumber);
+
+  /*! Sequence number of the most recently written data, 0 if nothing is written yet */
+  igtl_uint64 GetLastSequenceNumber() const;
+
+  /*! Number of slots, data older than this many sequence numbers cannot be read anymore */
+  unsigned int GetNumberOfSlots() const;
+
+  /*!
+    Copy part of the data written with the given sequence number
+    \return PLUS_FAIL if the slot is already reused for newer data (or the range is invalid)
+  */
+  PlusStatus Read(igtl_uint64 sequenceNumber, size_t offset, void* output, size_t sizeInBytes) const;
+
+protected:
+  struct RingHeader;
+  struct SlotHeader;
+
+  RingHeader* GetRingHeader() const;
+  SlotHeader* GetSlotHeader(igtl_uint64 sequenceNumber) const;
+
+  /*! Map the region, memorySizeInBytes is ignored if opening an existing region */
+  PlusStatus MapMemory(const std::string& name, bool create, size_t memorySizeInBytes);
+
+  std::string Name;
+  bool Writer;
+  void* Memory;
+  size_t MemorySizeInBytes;
+  size_t SlotStrideInBytes;
+#ifdef _WIN32
+  void* FileMappingHandle;
+#else
+  int FileDescriptor;
+#endif
+
+private:
+  PlusSharedMemoryFrameRing(const PlusSharedMemoryFrameRing&);
+  PlusSharedMemoryFrameRing& operator=(const PlusSharedMemoryFrameRing&);
+};
+
+#endif
@@ -0,0 +1,140 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "igtlPlusDeltaImageMessage.h"
+#include "vtkMatrix4x4.h"
+#include "vtkPlusIgtlMessageFactory.h"
+
+namespace igtl
+{
+  //----------------------------------------------------------------------------
+  PlusDeltaImageMessage::PlusDeltaImageMessage()
+    : MessageBase()
+  {
+    this->m_SendMessageType = "DELTAIMAGE";
+  }
+
+  //----------------------------------------------------------------------------
+  PlusDeltaImageMessage::~PlusDeltaImageMessage()
+  {
+  }
+
+  //----------------------------------------------------------------------------
+  igtl::MessageBase::Pointer PlusDeltaImageMessage::Clone()
+  {
+    igtl::MessageBase::Pointer clone;
+    {
+      vtkSmartPointer<vtkPlusIgtlMessageFactory> factory = vtkSmartPointer<vtkPlusIgtlMessageFactory>::New();
+      clone = dynamic_cast<igtl::MessageBase*>(factory->CreateSendMessage(this->GetMessageType(), this->GetHeaderVersion()).GetPointer());
+    }
+
+    igtl::PlusDeltaImageMessage::Pointer msg = dynamic_cast<igtl::PlusDeltaImageMessage*>(clone.GetPointer());
+
+    int bodySize = this->m_MessageSize - IGTL_HEADER_SIZE;
+    msg->InitBuffer();
+    msg->CopyHeader(this);
+    msg->AllocateBuffer(bodySize);
+    if (bodySize > 0)
+    {
+      msg->CopyBody(this);
+    }
+
+    return clone;
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus PlusDeltaImageMessage::SetEmbeddedImageTransform(vtkSmartPointer<vtkMatrix4x4> matrix)
+  {
+    for (int i = 0; i < 4; ++i)
+    {
+      for (int j = 0; j < 4; ++j)
+      {
+        m_MessageHeader.m_EmbeddedImageTransform[i][j] = matrix->GetElement(i, j);
+      }
+    }
+
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  vtkSmartPointer<vtkMatrix4x4> PlusDeltaImageMessage::GetEmbeddedImageTransform()
+  {
+    vtkSmartPointer<vtkMatrix4x4> mat(vtkSmartPointer<vtkMatrix4x4>::New());
+    for (int i = 0; i < 4; ++i)
+    {
+      for (int j = 0; j < 4; ++j)
+      {
+        mat->SetElement(i, j, m_MessageHeader.m_EmbeddedImageTransform[i][j]);
+      }
+    }
+    return mat;
+  }
+
+  //----------------------------------------------------------------------------
+  int PlusDeltaImageMessage::CalculateContentBufferSize()
+  {
+    return this->m_MessageHeader.GetMessageHeaderSize()
+           + this->m_TileBitmap.size()
+           + this->m_Payload.size();
+  }
+
+  //----------------------------------------------------------------------------
+  int PlusDeltaImageMessage::PackContent()
+  {
+    AllocateBuffer();
+
+    this->m_MessageHeader.m_TileBitmapSizeInBytes = this->m_TileBitmap.size();
+    this->m_MessageHeader.m_PayloadSizeInBytes = this->m_Payload.size();
+
+    // Copy header
+    DeltaImageHeader* header = (DeltaImageHeader*)(this->m_Content);
+    memcpy(header, &this->m_MessageHeader, this->m_MessageHeader.GetMessageHeaderSize());
+
+    // Copy tile bitmap and payload
+    unsigned char* tileBitmap = this->m_Content + this->m_MessageHeader.GetMessageHeaderSize();
+    if (!this->m_TileBitmap.empty())
+    {
+      memcpy(tileBitmap, &this->m_TileBitmap[0], this->m_TileBitmap.size());
+    }
+    if (!this->m_Payload.empty())
+    {
+      memcpy(tileBitmap + this->m_TileBitmap.size(), &this->m_Payload[0], this->m_Payload.size());
+    }
+
+    // Convert header endian
+    header->ConvertEndianness();
+
+    return 1;
+  }
+
+  //----------------------------------------------------------------------------
+  int PlusDeltaImageMessage::UnpackContent()
+  {
+    DeltaImageHeader* header = (DeltaImageHeader*)(this->m_Content);
+
+    // Convert header endian
+    header->ConvertEndianness();
+
+    // Copy header
+    memcpy(&this->m_MessageHeader, header, this->m_MessageHeader.GetMessageHeaderSize());
+
+    size_t contentSize = this->m_MessageHeader.GetMessageHeaderSize() + this->m_MessageHeader.m_TileBitmapSizeInBytes + this->m_MessageHeader.m_PayloadSizeInBytes;
+    if (contentSize > static_cast<size_t>(this->GetBufferBodySize()))
+    {
+      LOG_ERROR("Invalid DELTAIMAGE message: data size (" << contentSize << " bytes) exceeds the message size (" << this->GetBufferBodySize() << " bytes)");
+      return 0;
+    }
+
+    // Copy tile bitmap and payload
+    unsigned char* tileBitmap = this->m_Content + this->m_MessageHeader.GetMessageHeaderSize();
+    this->m_TileBitmap.assign(tileBitmap, tileBitmap + this->m_MessageHeader.m_TileBitmapSizeInBytes);
+    unsigned char* payload = tileBitmap + this->m_MessageHeader.m_TileBitmapSizeInBytes;
+    this->m_Payload.assign(payload, payload + this->m_MessageHeader.m_PayloadSizeInBytes);
+
+    return 1;
+  }
+}
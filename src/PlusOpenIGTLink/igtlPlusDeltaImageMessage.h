@@ -0,0 +1,158 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __igtlPlusDeltaImageMessage_h
+#define __igtlPlusDeltaImageMessage_h
+
+#include "vtkPlusOpenIGTLinkExport.h"
+#include "PlusCommon.h"
+
+#include "igtl_types.h"
+#include "igtl_win32header.h"
+#include "igtlMessageBase.h"
+#include "igtlObject.h"
+#include "igtl_header.h"
+#include "igtl_util.h"
+#include "vtkMatrix4x4.h"
+#include "vtkSmartPointer.h"
+#include <vector>
+
+namespace igtl
+{
+  // This command prevents 4-byte alignment in the struct (which enables m_FrameSize[3])
+#pragma pack(1)     /* For 1-byte boundary in memory */
+
+  /*!
+    \class PlusDeltaImageMessage
+    \brief IGTL message for sending image frames losslessly, only with the tiles that changed since the previous frame
+
+    The image is divided into square tiles. A key frame contains the complete image. Other frames contain
+    a bitmap of the tiles that are different from the reference frame (the previous frame of the stream)
+    and the pixels of the changed tiles, in the order of the bitmap. A frame can only be decoded if the
+    reference frame has been decoded, see PlusDeltaImageEncoder and PlusDeltaImageDecoder.
+
+    \ingroup PlusLibOpenIGTLink
+  */
+  class vtkPlusOpenIGTLinkExport PlusDeltaImageMessage: public MessageBase
+  {
+  public:
+    igtlTypeMacro(igtl::PlusDeltaImageMessage, igtl::MessageBase);
+    igtlNewMacro(igtl::PlusDeltaImageMessage);
+
+  public:
+    class DeltaImageHeader
+    {
+    public:
+      DeltaImageHeader()
+        : m_ScalarType(0)
+        , m_NumberOfComponents(0)
+        , m_ImageType(0)
+        , m_ImageOrientation(0)
+        , m_TileSize(0)
+        , m_FrameIndex(0)
+        , m_ReferenceFrameIndex(0)
+        , m_TileBitmapSizeInBytes(0)
+        , m_PayloadSizeInBytes(0)
+      {
+        m_FrameSize[0] = m_FrameSize[1] = m_FrameSize[2] = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+          for (int j = 0; j < 4; ++j)
+          {
+            m_EmbeddedImageTransform[i][j] = (i == j) ? 1.f : 0.f;
+          }
+        }
+      }
+
+      size_t GetMessageHeaderSize()
+      {
+        size_t headersize = 0;
+        headersize += sizeof(igtl_uint16);        // m_ScalarType
+        headersize += sizeof(igtl_uint16);        // m_NumberOfComponents
+        headersize += sizeof(igtl_uint16);        // m_ImageType
+        headersize += sizeof(igtl_uint16) * 3;    // m_FrameSize[3]
+        headersize += sizeof(igtl_uint16);        // m_ImageOrientation
+        headersize += sizeof(igtl_uint16);        // m_TileSize
+        headersize += sizeof(igtl_uint32);        // m_FrameIndex
+        headersize += sizeof(igtl_uint32);        // m_ReferenceFrameIndex
+        headersize += sizeof(igtl_uint32);        // m_TileBitmapSizeInBytes
+        headersize += sizeof(igtl_uint32);        // m_PayloadSizeInBytes
+        headersize += sizeof(igtl::Matrix4x4);    // m_EmbeddedImageTransform[4][4]
+
+        return headersize;
+      }
+
+      void ConvertEndianness()
+      {
+        if (igtl_is_little_endian())
+        {
+          m_ScalarType = BYTE_SWAP_INT16(m_ScalarType);
+          m_NumberOfComponents = BYTE_SWAP_INT16(m_NumberOfComponents);
+          m_ImageType = BYTE_SWAP_INT16(m_ImageType);
+          m_FrameSize[0] = BYTE_SWAP_INT16(m_FrameSize[0]);
+          m_FrameSize[1] = BYTE_SWAP_INT16(m_FrameSize[1]);
+          m_FrameSize[2] = BYTE_SWAP_INT16(m_FrameSize[2]);
+          m_ImageOrientation = BYTE_SWAP_INT16(m_ImageOrientation);
+          m_TileSize = BYTE_SWAP_INT16(m_TileSize);
+          m_FrameIndex = BYTE_SWAP_INT32(m_FrameIndex);
+          m_ReferenceFrameIndex = BYTE_SWAP_INT32(m_ReferenceFrameIndex);
+          m_TileBitmapSizeInBytes = BYTE_SWAP_INT32(m_TileBitmapSizeInBytes);
+          m_PayloadSizeInBytes = BYTE_SWAP_INT32(m_PayloadSizeInBytes);
+        }
+      }
+
+      /*! Key frames contain the complete image and do not depend on other frames */
+      bool IsKeyFrame() const { return m_FrameIndex == m_ReferenceFrameIndex; }
+
+      igtl_uint16     m_ScalarType;             /* scalar type                     */
+      igtl_uint16     m_NumberOfComponents;     /* number of scalar components */
+      igtl_uint16     m_ImageType;              /* image type */
+      igtl_uint16     m_FrameSize[3];           /* entire image volume size */
+      igtl_uint16     m_ImageOrientation;       /* orientation of the image */
+      igtl_uint16     m_TileSize;               /* width and height of the tiles, in pixels */
+      igtl_uint32     m_FrameIndex;             /* index of this frame in the stream */
+      igtl_uint32     m_ReferenceFrameIndex;    /* index of the frame that the tiles are applied to, same as m_FrameIndex for key frames */
+      igtl_uint32     m_TileBitmapSizeInBytes;  /* size of the changed tile bitmap, in bytes (0 for key frames) */
+      igtl_uint32     m_PayloadSizeInBytes;     /* size of the pixel data of the changed tiles, in bytes */
+      igtl::Matrix4x4 m_EmbeddedImageTransform; /* matrix representing the IJK to world transformation */
+    };
+
+    /*! Override clone so that we use the plus igtl factory */
+    virtual igtl::MessageBase::Pointer Clone();
+
+    /*! Image properties, frame indices and data sizes */
+    DeltaImageHeader& GetDeltaImageHeader() { return this->m_MessageHeader; }
+
+    /*! One bit for each tile in row-major order, set if the tile is included in the payload */
+    std::vector<unsigned char>& GetTileBitmap() { return this->m_TileBitmap; }
+
+    /*! Pixels of the changed tiles (the complete image for key frames) */
+    std::vector<unsigned char>& GetPayload() { return this->m_Payload; }
+
+    /*! Set the embedded transform of the underlying image */
+    PlusStatus SetEmbeddedImageTransform(vtkSmartPointer<vtkMatrix4x4> matrix);
+
+    /*! Get the embedded transform of the underlying image */
+    vtkSmartPointer<vtkMatrix4x4> GetEmbeddedImageTransform();
+
+  protected:
+    virtual int  CalculateContentBufferSize();
+    virtual int  PackContent();
+    virtual int  UnpackContent();
+
+    PlusDeltaImageMessage();
+    ~PlusDeltaImageMessage();
+
+    DeltaImageHeader m_MessageHeader;
+    std::vector<unsigned char> m_TileBitmap;
+    std::vector<unsigned char> m_Payload;
+  };
+
+#pragma pack()
+
+} // namespace igtl
+
+#endif
@@ -0,0 +1,102 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "igtlPlusSharedMemoryFrameMessage.h"
+#include "vtkPlusIgtlMessageFactory.h"
+
+namespace igtl
+{
+  //----------------------------------------------------------------------------
+  PlusSharedMemoryFrameMessage::PlusSharedMemoryFrameMessage()
+    : MessageBase()
+  {
+    this->m_SendMessageType = "SHMFRAME";
+  }
+
+  //----------------------------------------------------------------------------
+  PlusSharedMemoryFrameMessage::~PlusSharedMemoryFrameMessage()
+  {
+  }
+
+  //----------------------------------------------------------------------------
+  igtl::MessageBase::Pointer PlusSharedMemoryFrameMessage::Clone()
+  {
+    igtl::MessageBase::Pointer clone;
+    {
+      vtkSmartPointer<vtkPlusIgtlMessageFactory> factory = vtkSmartPointer<vtkPlusIgtlMessageFactory>::New();
+      clone = dynamic_cast<igtl::MessageBase*>(factory->CreateSendMessage(this->GetMessageType(), this->GetHeaderVersion()).GetPointer());
+    }
+
+    igtl::PlusSharedMemoryFrameMessage::Pointer msg = dynamic_cast<igtl::PlusSharedMemoryFrameMessage*>(clone.GetPointer());
+
+    int bodySize = this->m_MessageSize - IGTL_HEADER_SIZE;
+    msg->InitBuffer();
+    msg->CopyHeader(this);
+    msg->AllocateBuffer(bodySize);
+    if (bodySize > 0)
+    {
+      msg->CopyBody(this);
+    }
+
+    return clone;
+  }
+
+  //----------------------------------------------------------------------------
+  void PlusSharedMemoryFrameMessage::SetRingName(const std::string& ringName)
+  {
+    memset(this->m_MessageHeader.m_RingName, 0, RING_NAME_SIZE);
+    // The last character is kept as the terminating zero
+    strncpy(this->m_MessageHeader.m_RingName, ringName.c_str(), RING_NAME_SIZE - 1);
+  }
+
+  //----------------------------------------------------------------------------
+  std::string PlusSharedMemoryFrameMessage::GetRingName() const
+  {
+    return std::string(this->m_MessageHeader.m_RingName, strnlen(this->m_MessageHeader.m_RingName, RING_NAME_SIZE));
+  }
+
+  //----------------------------------------------------------------------------
+  int PlusSharedMemoryFrameMessage::CalculateContentBufferSize()
+  {
+    return this->m_MessageHeader.GetMessageHeaderSize();
+  }
+
+  //----------------------------------------------------------------------------
+  int PlusSharedMemoryFrameMessage::PackContent()
+  {
+    AllocateBuffer();
+
+    // Copy header
+    SharedMemoryFrameHeader* header = (SharedMemoryFrameHeader*)(this->m_Content);
+    memcpy(header, &this->m_MessageHeader, this->m_MessageHeader.GetMessageHeaderSize());
+
+    // Convert header endian
+    header->ConvertEndianness();
+
+    return 1;
+  }
+
+  //----------------------------------------------------------------------------
+  int PlusSharedMemoryFrameMessage::UnpackContent()
+  {
+    if (static_cast<size_t>(this->GetBufferBodySize()) < this->m_MessageHeader.GetMessageHeaderSize())
+    {
+      LOG_ERROR("Invalid SHMFRAME message: message size (" << this->GetBufferBodySize() << " bytes) is smaller than the expected size");
+      return 0;
+    }
+
+    SharedMemoryFrameHeader* header = (SharedMemoryFrameHeader*)(this->m_Content);
+
+    // Convert header endian
+    header->ConvertEndianness();
+
+    // Copy header
+    memcpy(&this->m_MessageHeader, header, this->m_MessageHeader.GetMessageHeaderSize());
+
+    return 1;
+  }
+}
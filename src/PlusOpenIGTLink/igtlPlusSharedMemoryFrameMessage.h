@@ -0,0 +1,106 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __igtlPlusSharedMemoryFrameMessage_h
+#define __igtlPlusSharedMemoryFrameMessage_h
+
+#include "vtkPlusOpenIGTLinkExport.h"
+#include "PlusCommon.h"
+
+#include "igtl_types.h"
+#include "igtl_win32header.h"
+#include "igtlMessageBase.h"
+#include "igtlObject.h"
+#include "igtl_header.h"
+#include "igtl_util.h"
+
+namespace igtl
+{
+#pragma pack(1)     /* For 1-byte boundary in memory */
+
+  /*!
+    \class PlusSharedMemoryFrameMessage
+    \brief IGTL message notifying a client on the same host that a message is available in a shared memory ring
+
+    Sent instead of IMAGE messages to clients that requested the shared memory transport in their CLIENTINFO
+    message. The complete packed message (header and body) can be read from the ring, see PlusSharedMemoryFrameRing.
+
+    \ingroup PlusLibOpenIGTLink
+  */
+  class vtkPlusOpenIGTLinkExport PlusSharedMemoryFrameMessage: public MessageBase
+  {
+  public:
+    igtlTypeMacro(igtl::PlusSharedMemoryFrameMessage, igtl::MessageBase);
+    igtlNewMacro(igtl::PlusSharedMemoryFrameMessage);
+
+  public:
+    enum
+    {
+      RING_NAME_SIZE = 64
+    };
+
+    class SharedMemoryFrameHeader
+    {
+    public:
+      SharedMemoryFrameHeader()
+        : m_SequenceNumber(0)
+        , m_MessageSizeInBytes(0)
+      {
+        memset(m_RingName, 0, sizeof(m_RingName));
+      }
+
+      size_t GetMessageHeaderSize()
+      {
+        size_t headersize = 0;
+        headersize += sizeof(char) * RING_NAME_SIZE; // m_RingName
+        headersize += sizeof(igtl_uint64);           // m_SequenceNumber
+        headersize += sizeof(igtl_uint32);           // m_MessageSizeInBytes
+
+        return headersize;
+      }
+
+      void ConvertEndianness()
+      {
+        if (igtl_is_little_endian())
+        {
+          m_SequenceNumber = BYTE_SWAP_INT64(m_SequenceNumber);
+          m_MessageSizeInBytes = BYTE_SWAP_INT32(m_MessageSizeInBytes);
+        }
+      }
+
+      char            m_RingName[RING_NAME_SIZE]; /* name of the shared memory ring, zero terminated */
+      igtl_uint64     m_SequenceNumber;           /* sequence number of the message in the ring */
+      igtl_uint32     m_MessageSizeInBytes;       /* size of the packed message in the ring, including its header */
+    };
+
+    /*! Override clone so that we use the plus igtl factory */
+    virtual igtl::MessageBase::Pointer Clone();
+
+    void SetRingName(const std::string& ringName);
+    std::string GetRingName() const;
+
+    void SetSequenceNumber(igtl_uint64 sequenceNumber) { this->m_MessageHeader.m_SequenceNumber = sequenceNumber; }
+    igtl_uint64 GetSequenceNumber() const { return this->m_MessageHeader.m_SequenceNumber; }
+
+    void SetMessageSizeInBytes(igtl_uint32 size) { this->m_MessageHeader.m_MessageSizeInBytes = size; }
+    igtl_uint32 GetMessageSizeInBytes() const { return this->m_MessageHeader.m_MessageSizeInBytes; }
+
+  protected:
+    virtual int  CalculateContentBufferSize();
+    virtual int  PackContent();
+    virtual int  UnpackContent();
+
+    PlusSharedMemoryFrameMessage();
+    ~PlusSharedMemoryFrameMessage();
+
+    SharedMemoryFrameHeader m_MessageHeader;
+  };
+
+#pragma pack()
+
+} // namespace igtl
+
+#endif
@@ -0,0 +1,406 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "PlusParallelCompressor.h"
+#include "PlusWorkerPool.h"
+#include "igsioVideoFrame.h"
+#include "igtlPlusSlabVolumeMessage.h"
+#include "vtkMatrix4x4.h"
+#include "vtkPlusIgtlMessageFactory.h"
+
+// VTK includes
+#include <vtkImageData.h>
+
+// STL includes
+#include <algorithm>
+#include <future>
+#include <limits>
+#include <sstream>
+#include <streambuf>
+
+namespace
+{
+  /*! Read-only stream buffer on existing memory, so that the frame can be compressed without copying it into a string stream */
+  class MemoryStreamBuffer : public std::streambuf
+  {
+  public:
+    MemoryStreamBuffer(const unsigned char* data, size_t size)
+    {
+      char* begin = const_cast<char*>(reinterpret_cast<const char*>(data));
+      this->setg(begin, begin, begin + size);
+    }
+  };
+}
+
+namespace igtl
+{
+  //----------------------------------------------------------------------------
+  PlusSlabVolumeMessage::PlusSlabVolumeMessage()
+    : MessageBase()
+  {
+    this->m_SendMessageType = "SLABVOLUME";
+  }
+
+  //----------------------------------------------------------------------------
+  PlusSlabVolumeMessage::~PlusSlabVolumeMessage()
+  {
+  }
+
+  //----------------------------------------------------------------------------
+  igtl::MessageBase::Pointer PlusSlabVolumeMessage::Clone()
+  {
+    igtl::MessageBase::Pointer clone;
+    {
+      vtkSmartPointer<vtkPlusIgtlMessageFactory> factory = vtkSmartPointer<vtkPlusIgtlMessageFactory>::New();
+      clone = dynamic_cast<igtl::MessageBase*>(factory->CreateSendMessage(this->GetMessageType(), this->GetHeaderVersion()).GetPointer());
+    }
+
+    igtl::PlusSlabVolumeMessage::Pointer msg = dynamic_cast<igtl::PlusSlabVolumeMessage*>(clone.GetPointer());
+
+    int bodySize = this->m_MessageSize - IGTL_HEADER_SIZE;
+    msg->InitBuffer();
+    msg->CopyHeader(this);
+    msg->AllocateBuffer(bodySize);
+    if (bodySize > 0)
+    {
+      msg->CopyBody(this);
+    }
+
+    return clone;
+  }
+
+  //----------------------------------------------------------------------------
+  unsigned int PlusSlabVolumeMessage::GetNumberOfSlabUnits(const FrameSizeType& frameSize)
+  {
+    return frameSize[2] > 1 ? frameSize[2] : frameSize[1];
+  }
+
+  //----------------------------------------------------------------------------
+  void PlusSlabVolumeMessage::ShuffleBytes(const unsigned char* input, unsigned char* output, size_t sizeInBytes, unsigned int bytesPerScalar)
+  {
+    const size_t numberOfScalars = sizeInBytes / bytesPerScalar;
+    for (unsigned int byteIndex = 0; byteIndex < bytesPerScalar; ++byteIndex)
+    {
+      const unsigned char* inputByte = input + byteIndex;
+      unsigned char* outputPlane = output + byteIndex * numberOfScalars;
+      for (size_t i = 0; i < numberOfScalars; ++i)
+      {
+        outputPlane[i] = inputByte[i * bytesPerScalar];
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  void PlusSlabVolumeMessage::UnshuffleBytes(const unsigned char* input, unsigned char* output, size_t sizeInBytes, unsigned int bytesPerScalar)
+  {
+    const size_t numberOfScalars = sizeInBytes / bytesPerScalar;
+    for (unsigned int byteIndex = 0; byteIndex < bytesPerScalar; ++byteIndex)
+    {
+      const unsigned char* inputPlane = input + byteIndex * numberOfScalars;
+      unsigned char* outputByte = output + byteIndex;
+      for (size_t i = 0; i < numberOfScalars; ++i)
+      {
+        outputByte[i * bytesPerScalar] = inputPlane[i];
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus PlusSlabVolumeMessage::SetFrame(igsioVideoFrame& frame, int slabThickness, int compressionLevel, bool byteShuffle/*=true*/)
+  {
+    if (!frame.IsImageValid())
+    {
+      LOG_ERROR("Failed to set SLABVOLUME message frame - invalid frame");
+      return PLUS_FAIL;
+    }
+
+    FrameSizeType frameSize = frame.GetFrameSize();
+    if (frameSize[0] > static_cast<unsigned int>(std::numeric_limits<igtl_uint16>::max()) ||
+        frameSize[1] > static_cast<unsigned int>(std::numeric_limits<igtl_uint16>::max()) ||
+        frameSize[2] > static_cast<unsigned int>(std::numeric_limits<igtl_uint16>::max()))
+    {
+      LOG_ERROR("Frame size element is too large to be sent over OpenIGTLink. Cannot create SLABVOLUME message.");
+      return PLUS_FAIL;
+    }
+    if (slabThickness < 1 || slabThickness > std::numeric_limits<igtl_uint16>::max())
+    {
+      LOG_ERROR("Failed to set SLABVOLUME message frame - invalid slab thickness: " << slabThickness);
+      return PLUS_FAIL;
+    }
+    unsigned int numberOfScalarComponents(1);
+    if (frame.GetNumberOfScalarComponents(numberOfScalarComponents) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Unable to retrieve number of scalar components.");
+      return PLUS_FAIL;
+    }
+
+    const size_t frameSizeInBytes = frame.GetFrameSizeInBytes();
+    if (frameSizeInBytes == 0 || frameSizeInBytes > std::numeric_limits<igtl_uint32>::max())
+    {
+      LOG_ERROR("Failed to set SLABVOLUME message frame - invalid frame data size: " << frameSizeInBytes << " bytes");
+      return PLUS_FAIL;
+    }
+    const size_t unitSizeInBytes = frameSizeInBytes / GetNumberOfSlabUnits(frameSize);
+    if (frameSize[2] <= 1)
+    {
+      // Rows of 2D images are small, so the slab thickness is set to have enough data in each slab
+      slabThickness = static_cast<int>(std::min<size_t>((MINIMUM_2D_SLAB_SIZE_BYTES + unitSizeInBytes - 1) / unitSizeInBytes,
+                                       std::numeric_limits<igtl_uint16>::max()));
+    }
+    const size_t slabSizeInBytes = unitSizeInBytes * slabThickness;
+    const unsigned int bytesPerScalar = igsioVideoFrame::GetNumberOfBytesPerScalar(frame.GetVTKScalarPixelType());
+    byteShuffle = byteShuffle && bytesPerScalar > 1;
+
+    this->m_MessageHeader.m_ScalarType = PlusCommon::GetIGTLScalarPixelTypeFromVTK(frame.GetVTKScalarPixelType());
+    this->m_MessageHeader.m_NumberOfComponents = numberOfScalarComponents;
+    this->m_MessageHeader.m_ImageType = frame.GetImageType();
+    this->m_MessageHeader.m_FrameSize[0] = frameSize[0];
+    this->m_MessageHeader.m_FrameSize[1] = frameSize[1];
+    this->m_MessageHeader.m_FrameSize[2] = frameSize[2];
+    this->m_MessageHeader.m_ImageOrientation = (igtl_uint16)frame.GetImageOrientation();
+    this->m_MessageHeader.m_SlabThickness = slabThickness;
+    this->m_MessageHeader.m_Filter = byteShuffle ? FILTER_BYTE_SHUFFLE : FILTER_NONE;
+
+    const unsigned char* pixels = static_cast<const unsigned char*>(frame.GetScalarPointer());
+    if (byteShuffle)
+    {
+      // Shuffle within each slab, so that the slabs remain independent
+      this->m_ShuffledData.resize(frameSizeInBytes);
+      unsigned char* shuffledData = &this->m_ShuffledData[0];
+      const int numberOfSlabs = static_cast<int>((frameSizeInBytes + slabSizeInBytes - 1) / slabSizeInBytes);
+      PlusWorkerPool::GetInstance().ParallelFor(0, numberOfSlabs, 0, [=](int firstSlab, int lastSlab)
+      {
+        for (int slabIndex = firstSlab; slabIndex < lastSlab; ++slabIndex)
+        {
+          const size_t offset = slabIndex * slabSizeInBytes;
+          ShuffleBytes(pixels + offset, shuffledData + offset, std::min(slabSizeInBytes, frameSizeInBytes - offset), bytesPerScalar);
+        }
+      });
+      pixels = shuffledData;
+    }
+
+    // Each slab is one independent block of the compressed stream
+    PlusParallelCompressor compressor;
+    compressor.SetIndependentBlocks(true);
+    compressor.SetBlockSizeBytes(static_cast<unsigned int>(slabSizeInBytes));
+    compressor.SetCompressionLevel(compressionLevel);
+
+    MemoryStreamBuffer inputBuffer(pixels, frameSizeInBytes);
+    std::istream input(&inputBuffer);
+    std::ostringstream output(std::ios::binary);
+    if (compressor.CompressToGzip(input, output) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to compress SLABVOLUME message frame");
+      return PLUS_FAIL;
+    }
+
+    const std::string compressedData = output.str();
+    this->m_Payload.assign(compressedData.begin(), compressedData.end());
+    const std::vector<PlusParallelCompressor::BlockLocation>& blockLocations = compressor.GetBlockLocations();
+    this->m_SlabLocations.resize(blockLocations.size());
+    for (size_t i = 0; i < blockLocations.size(); ++i)
+    {
+      this->m_SlabLocations[i].m_Offset = static_cast<igtl_uint32>(blockLocations[i].Offset);
+      this->m_SlabLocations[i].m_Size = static_cast<igtl_uint32>(blockLocations[i].Size);
+    }
+    this->m_MessageHeader.m_NumberOfSlabs = this->m_SlabLocations.size();
+    this->m_MessageHeader.m_PayloadSizeInBytes = this->m_Payload.size();
+
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus PlusSlabVolumeMessage::GetFrame(igsioVideoFrame& frame)
+  {
+    const SlabVolumeHeader& header = this->m_MessageHeader;
+    FrameSizeType frameSize = { header.m_FrameSize[0], header.m_FrameSize[1], header.m_FrameSize[2] };
+    const unsigned int numberOfSlabUnits = GetNumberOfSlabUnits(frameSize);
+    if (header.m_SlabThickness == 0 || header.m_FrameSize[2] == 0 || numberOfSlabUnits == 0
+        || header.m_NumberOfSlabs != static_cast<igtl_uint32>((numberOfSlabUnits + header.m_SlabThickness - 1) / header.m_SlabThickness)
+        || this->m_SlabLocations.size() != header.m_NumberOfSlabs)
+    {
+      LOG_ERROR("Failed to decode SLABVOLUME message - invalid slab table");
+      return PLUS_FAIL;
+    }
+    for (std::vector<SlabLocation>::const_iterator it = this->m_SlabLocations.begin(); it != this->m_SlabLocations.end(); ++it)
+    {
+      if (static_cast<size_t>(it->m_Offset) + it->m_Size > this->m_Payload.size())
+      {
+        LOG_ERROR("Failed to decode SLABVOLUME message - slab data is outside of the payload");
+        return PLUS_FAIL;
+      }
+    }
+    if (header.m_Filter != FILTER_NONE && header.m_Filter != FILTER_BYTE_SHUFFLE)
+    {
+      LOG_ERROR("Failed to decode SLABVOLUME message - unknown filter: " << header.m_Filter);
+      return PLUS_FAIL;
+    }
+
+    if (frame.AllocateFrame(frameSize, PlusCommon::GetVTKScalarPixelTypeFromIGTL(header.m_ScalarType), header.m_NumberOfComponents) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to allocate memory for frame received in SLABVOLUME message");
+      return PLUS_FAIL;
+    }
+
+    const size_t frameSizeInBytes = frame.GetFrameSizeInBytes();
+    const size_t slabSizeInBytes = frameSizeInBytes / numberOfSlabUnits * header.m_SlabThickness;
+    unsigned char* pixels = static_cast<unsigned char*>(frame.GetScalarPointer());
+    const unsigned char* payload = this->m_Payload.empty() ? NULL : &this->m_Payload[0];
+    const unsigned int bytesPerScalar = igsioVideoFrame::GetNumberOfBytesPerScalar(frame.GetVTKScalarPixelType());
+    const bool byteShuffle = header.m_Filter == FILTER_BYTE_SHUFFLE && bytesPerScalar > 1;
+
+    // Decompress the slabs concurrently, each one into its part of the frame
+    PlusWorkerPool& workerPool = PlusWorkerPool::GetInstance();
+    std::vector<std::future<PlusStatus> > tasks;
+    for (size_t slabIndex = 0; slabIndex < this->m_SlabLocations.size(); ++slabIndex)
+    {
+      const SlabLocation location = this->m_SlabLocations[slabIndex];
+      unsigned char* slabPixels = pixels + slabIndex * slabSizeInBytes;
+      const size_t slabOutputSize = std::min(slabSizeInBytes, frameSizeInBytes - slabIndex * slabSizeInBytes);
+      tasks.push_back(workerPool.Submit([payload, location, slabPixels, slabOutputSize, byteShuffle, bytesPerScalar]()
+      {
+        if (!byteShuffle)
+        {
+          return PlusParallelCompressor::DecompressBlock(payload + location.m_Offset, location.m_Size, slabPixels, slabOutputSize);
+        }
+        std::vector<unsigned char> shuffledSlab(slabOutputSize);
+        if (PlusParallelCompressor::DecompressBlock(payload + location.m_Offset, location.m_Size, &shuffledSlab[0], slabOutputSize) != PLUS_SUCCESS)
+        {
+          return PLUS_FAIL;
+        }
+        UnshuffleBytes(&shuffledSlab[0], slabPixels, slabOutputSize, bytesPerScalar);
+        return PLUS_SUCCESS;
+      }));
+    }
+    PlusStatus status = PLUS_SUCCESS;
+    for (std::vector<std::future<PlusStatus> >::iterator it = tasks.begin(); it != tasks.end(); ++it)
+    {
+      workerPool.Wait(*it);
+      if (it->get() != PLUS_SUCCESS)
+      {
+        status = PLUS_FAIL;
+      }
+    }
+    if (status != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to decode SLABVOLUME message - slab data cannot be decompressed");
+      return PLUS_FAIL;
+    }
+
+    frame.SetImageType((US_IMAGE_TYPE)header.m_ImageType);
+    frame.SetImageOrientation((US_IMAGE_ORIENTATION)header.m_ImageOrientation);
+    frame.GetImage()->Modified();
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus PlusSlabVolumeMessage::SetEmbeddedImageTransform(vtkSmartPointer<vtkMatrix4x4> matrix)
+  {
+    for (int i = 0; i < 4; ++i)
+    {
+      for (int j = 0; j < 4; ++j)
+      {
+        m_MessageHeader.m_EmbeddedImageTransform[i][j] = matrix->GetElement(i, j);
+      }
+    }
+
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  vtkSmartPointer<vtkMatrix4x4> PlusSlabVolumeMessage::GetEmbeddedImageTransform()
+  {
+    vtkSmartPointer<vtkMatrix4x4> mat(vtkSmartPointer<vtkMatrix4x4>::New());
+    for (int i = 0; i < 4; ++i)
+    {
+      for (int j = 0; j < 4; ++j)
+      {
+        mat->SetElement(i, j, m_MessageHeader.m_EmbeddedImageTransform[i][j]);
+      }
+    }
+    return mat;
+  }
+
+  //----------------------------------------------------------------------------
+  int PlusSlabVolumeMessage::CalculateContentBufferSize()
+  {
+    return this->m_MessageHeader.GetMessageHeaderSize()
+           + this->m_SlabLocations.size() * sizeof(SlabLocation)
+           + this->m_Payload.size();
+  }
+
+  //----------------------------------------------------------------------------
+  int PlusSlabVolumeMessage::PackContent()
+  {
+    AllocateBuffer();
+
+    this->m_MessageHeader.m_NumberOfSlabs = this->m_SlabLocations.size();
+    this->m_MessageHeader.m_PayloadSizeInBytes = this->m_Payload.size();
+
+    // Copy header
+    SlabVolumeHeader* header = (SlabVolumeHeader*)(this->m_Content);
+    memcpy(header, &this->m_MessageHeader, this->m_MessageHeader.GetMessageHeaderSize());
+
+    // Copy slab table and payload
+    SlabLocation* slabLocations = (SlabLocation*)(this->m_Content + this->m_MessageHeader.GetMessageHeaderSize());
+    for (size_t i = 0; i < this->m_SlabLocations.size(); ++i)
+    {
+      slabLocations[i] = this->m_SlabLocations[i];
+      if (igtl_is_little_endian())
+      {
+        slabLocations[i].m_Offset = BYTE_SWAP_INT32(slabLocations[i].m_Offset);
+        slabLocations[i].m_Size = BYTE_SWAP_INT32(slabLocations[i].m_Size);
+      }
+    }
+    if (!this->m_Payload.empty())
+    {
+      memcpy(slabLocations + this->m_SlabLocations.size(), &this->m_Payload[0], this->m_Payload.size());
+    }
+
+    // Convert header endian
+    header->ConvertEndianness();
+
+    return 1;
+  }
+
+  //----------------------------------------------------------------------------
+  int PlusSlabVolumeMessage::UnpackContent()
+  {
+    SlabVolumeHeader* header = (SlabVolumeHeader*)(this->m_Content);
+
+    // Convert header endian
+    header->ConvertEndianness();
+
+    // Copy header
+    memcpy(&this->m_MessageHeader, header, this->m_MessageHeader.GetMessageHeaderSize());
+
+    size_t contentSize = this->m_MessageHeader.GetMessageHeaderSize()
+                         + static_cast<size_t>(this->m_MessageHeader.m_NumberOfSlabs) * sizeof(SlabLocation)
+                         + this->m_MessageHeader.m_PayloadSizeInBytes;
+    if (contentSize > static_cast<size_t>(this->GetBufferBodySize()))
+    {
+      LOG_ERROR("Invalid SLABVOLUME message: data size (" << contentSize << " bytes) exceeds the message size (" << this->GetBufferBodySize() << " bytes)");
+      return 0;
+    }
+
+    // Copy slab table and payload
+    SlabLocation* slabLocations = (SlabLocation*)(this->m_Content + this->m_MessageHeader.GetMessageHeaderSize());
+    this->m_SlabLocations.assign(slabLocations, slabLocations + this->m_MessageHeader.m_NumberOfSlabs);
+    if (igtl_is_little_endian())
+    {
+      for (std::vector<SlabLocation>::iterator it = this->m_SlabLocations.begin(); it != this->m_SlabLocations.end(); ++it)
+      {
+        it->m_Offset = BYTE_SWAP_INT32(it->m_Offset);
+        it->m_Size = BYTE_SWAP_INT32(it->m_Size);
+      }
+    }
+    unsigned char* payload = (unsigned char*)(slabLocations + this->m_MessageHeader.m_NumberOfSlabs);
+    this->m_Payload.assign(payload, payload + this->m_MessageHeader.m_PayloadSizeInBytes);
+
+    return 1;
+  }
+}
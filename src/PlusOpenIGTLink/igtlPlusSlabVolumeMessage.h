@@ -0,0 +1,191 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __igtlPlusSlabVolumeMessage_h
+#define __igtlPlusSlabVolumeMessage_h
+
+#include "vtkPlusOpenIGTLinkExport.h"
+#include "PlusCommon.h"
+
+#include "igtl_types.h"
+#include "igtl_win32header.h"
+#include "igtlMessageBase.h"
+#include "igtlObject.h"
+#include "igtl_header.h"
+#include "igtl_util.h"
+#include "vtkMatrix4x4.h"
+#include "vtkSmartPointer.h"
+#include <vector>
+
+class igsioVideoFrame;
+
+namespace igtl
+{
+  // This command prevents 4-byte alignment in the struct (which enables m_FrameSize[3])
+#pragma pack(1)     /* For 1-byte boundary in memory */
+
+  /*!
+    \class PlusSlabVolumeMessage
+    \brief IGTL message for sending images and volumes losslessly compressed, in slabs that can be decompressed independently
+
+    Volumes are split along the slice axis into slabs of m_SlabThickness slices, 2D images (e.g., RF or 16-bit B-mode
+    frames) are split into slabs of m_SlabThickness rows. Each slab is deflated independently and concurrently
+    (see PlusParallelCompressor), so compressing high rate streams does not stall the sending thread and the receiver
+    can decompress the slabs concurrently as well. The compressed data is a gzip stream, the slab table contains the
+    position and size of the deflate block of each slab in this stream.
+
+    If m_Filter is FILTER_BYTE_SHUFFLE then the bytes of the multi-byte scalars of each slab are regrouped before
+    compression: first the first byte of all scalars, then the second byte, etc. The high bytes of ultrasound samples
+    vary slowly, so they compress much better when they are not interleaved with the noisy low bytes.
+
+    \ingroup PlusLibOpenIGTLink
+  */
+  class vtkPlusOpenIGTLinkExport PlusSlabVolumeMessage: public MessageBase
+  {
+  public:
+    igtlTypeMacro(igtl::PlusSlabVolumeMessage, igtl::MessageBase);
+    igtlNewMacro(igtl::PlusSlabVolumeMessage);
+
+  public:
+    enum Filter
+    {
+      FILTER_NONE = 0,
+      FILTER_BYTE_SHUFFLE = 1
+    };
+
+    class SlabVolumeHeader
+    {
+    public:
+      SlabVolumeHeader()
+        : m_ScalarType(0)
+        , m_NumberOfComponents(0)
+        , m_ImageType(0)
+        , m_ImageOrientation(0)
+        , m_SlabThickness(0)
+        , m_Filter(FILTER_NONE)
+        , m_NumberOfSlabs(0)
+        , m_PayloadSizeInBytes(0)
+      {
+        m_FrameSize[0] = m_FrameSize[1] = m_FrameSize[2] = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+          for (int j = 0; j < 4; ++j)
+          {
+            m_EmbeddedImageTransform[i][j] = (i == j) ? 1.f : 0.f;
+          }
+        }
+      }
+
+      size_t GetMessageHeaderSize()
+      {
+        size_t headersize = 0;
+        headersize += sizeof(igtl_uint16);        // m_ScalarType
+        headersize += sizeof(igtl_uint16);        // m_NumberOfComponents
+        headersize += sizeof(igtl_uint16);        // m_ImageType
+        headersize += sizeof(igtl_uint16) * 3;    // m_FrameSize[3]
+        headersize += sizeof(igtl_uint16);        // m_ImageOrientation
+        headersize += sizeof(igtl_uint16);        // m_SlabThickness
+        headersize += sizeof(igtl_uint16);        // m_Filter
+        headersize += sizeof(igtl_uint32);        // m_NumberOfSlabs
+        headersize += sizeof(igtl_uint32);        // m_PayloadSizeInBytes
+        headersize += sizeof(igtl::Matrix4x4);    // m_EmbeddedImageTransform[4][4]
+
+        return headersize;
+      }
+
+      void ConvertEndianness()
+      {
+        if (igtl_is_little_endian())
+        {
+          m_ScalarType = BYTE_SWAP_INT16(m_ScalarType);
+          m_NumberOfComponents = BYTE_SWAP_INT16(m_NumberOfComponents);
+          m_ImageType = BYTE_SWAP_INT16(m_ImageType);
+          m_FrameSize[0] = BYTE_SWAP_INT16(m_FrameSize[0]);
+          m_FrameSize[1] = BYTE_SWAP_INT16(m_FrameSize[1]);
+          m_FrameSize[2] = BYTE_SWAP_INT16(m_FrameSize[2]);
+          m_ImageOrientation = BYTE_SWAP_INT16(m_ImageOrientation);
+          m_SlabThickness = BYTE_SWAP_INT16(m_SlabThickness);
+          m_Filter = BYTE_SWAP_INT16(m_Filter);
+          m_NumberOfSlabs = BYTE_SWAP_INT32(m_NumberOfSlabs);
+          m_PayloadSizeInBytes = BYTE_SWAP_INT32(m_PayloadSizeInBytes);
+        }
+      }
+
+      igtl_uint16     m_ScalarType;             /* scalar type                     */
+      igtl_uint16     m_NumberOfComponents;     /* number of scalar components */
+      igtl_uint16     m_ImageType;              /* image type */
+      igtl_uint16     m_FrameSize[3];           /* entire image volume size */
+      igtl_uint16     m_ImageOrientation;       /* orientation of the image */
+      igtl_uint16     m_SlabThickness;          /* number of slices (rows for 2D images) in each slab (the last slab may contain less) */
+      igtl_uint16     m_Filter;                 /* transformation of the slab data before compression */
+      igtl_uint32     m_NumberOfSlabs;          /* number of entries in the slab table */
+      igtl_uint32     m_PayloadSizeInBytes;     /* size of the compressed data, in bytes */
+      igtl::Matrix4x4 m_EmbeddedImageTransform; /* matrix representing the IJK to world transformation */
+    };
+
+    /*! Position and size of the compressed data of a slab, relative to the beginning of the payload */
+    struct SlabLocation
+    {
+      igtl_uint32 m_Offset;
+      igtl_uint32 m_Size;
+    };
+
+    /*! Override clone so that we use the plus igtl factory */
+    virtual igtl::MessageBase::Pointer Clone();
+
+    /*!
+      Compress the frame into the message. The message is not packed.
+      \param slabThickness Number of slices that are compressed together. Not used for 2D images, their slabs contain
+        as many rows as needed for about MINIMUM_2D_SLAB_SIZE_BYTES of data.
+      \param compressionLevel zlib compression level, from 1 (fastest) to 9 (smallest), -1 for the zlib default
+      \param byteShuffle Regroup the bytes of multi-byte scalars before compression (see FILTER_BYTE_SHUFFLE)
+    */
+    PlusStatus SetFrame(igsioVideoFrame& frame, int slabThickness, int compressionLevel, bool byteShuffle = true);
+
+    /*! Decompress the slabs of the message into the frame, concurrently */
+    PlusStatus GetFrame(igsioVideoFrame& frame);
+
+    /*! Image properties and data sizes */
+    SlabVolumeHeader& GetSlabVolumeHeader() { return this->m_MessageHeader; }
+
+    /*! Set the embedded transform of the underlying image */
+    PlusStatus SetEmbeddedImageTransform(vtkSmartPointer<vtkMatrix4x4> matrix);
+
+    /*! Get the embedded transform of the underlying image */
+    vtkSmartPointer<vtkMatrix4x4> GetEmbeddedImageTransform();
+
+    /*! Slabs of 2D images are made at least this large, smaller deflate blocks compress poorly */
+    static const unsigned int MINIMUM_2D_SLAB_SIZE_BYTES = 65536;
+
+  protected:
+    /*! Number of slices (rows for 2D images) of the frame, the slab thickness is expressed in this unit */
+    static unsigned int GetNumberOfSlabUnits(const FrameSizeType& frameSize);
+
+    /*! Regroup the bytes of the scalars: output contains the first byte of all scalars, then the second byte, etc. */
+    static void ShuffleBytes(const unsigned char* input, unsigned char* output, size_t sizeInBytes, unsigned int bytesPerScalar);
+
+    /*! Inverse of ShuffleBytes */
+    static void UnshuffleBytes(const unsigned char* input, unsigned char* output, size_t sizeInBytes, unsigned int bytesPerScalar);
+
+    virtual int  CalculateContentBufferSize();
+    virtual int  PackContent();
+    virtual int  UnpackContent();
+
+    PlusSlabVolumeMessage();
+    ~PlusSlabVolumeMessage();
+
+    SlabVolumeHeader m_MessageHeader;
+    std::vector<SlabLocation> m_SlabLocations;
+    std::vector<unsigned char> m_Payload;
+    /*! Shuffled frame data, kept for reuse between frames */
+    std::vector<unsigned char> m_ShuffledData;
+  };
+
+#pragma pack()
+
+} // namespace igtl
+
+#endif
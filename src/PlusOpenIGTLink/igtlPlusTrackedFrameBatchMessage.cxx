@@ -0,0 +1,430 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "igsioVideoFrame.h"
+#include "igtlPlusTrackedFrameBatchMessage.h"
+#include "vtkImageData.h"
+#include "vtkMatrix4x4.h"
+#include "vtkPlusIgtlMessageFactory.h"
+
+#include <cstring>
+#include <limits>
+#include <set>
+
+namespace
+{
+  const std::string TRANSFORM_FIELD_SUFFIX = "Transform";
+  const std::string TRANSFORM_STATUS_FIELD_SUFFIX = "TransformStatus";
+
+  //----------------------------------------------------------------------------
+  /*! Returns true if the field is a transform or transform status field of a transform that is not requested */
+  bool IsUnrequestedTransformField(const std::string& fieldName, const std::set<std::string>& requestedTransformNames)
+  {
+    if (requestedTransformNames.empty())
+    {
+      return false;
+    }
+    for (const std::string* suffix : { &TRANSFORM_STATUS_FIELD_SUFFIX, &TRANSFORM_FIELD_SUFFIX })
+    {
+      if (fieldName.size() > suffix->size() && fieldName.compare(fieldName.size() - suffix->size(), suffix->size(), *suffix) == 0)
+      {
+        return requestedTransformNames.count(fieldName.substr(0, fieldName.size() - suffix->size())) == 0;
+      }
+    }
+    return false;
+  }
+}
+
+namespace igtl
+{
+  //----------------------------------------------------------------------------
+  PlusTrackedFrameBatchMessage::PlusTrackedFrameBatchMessage()
+    : MessageBase()
+  {
+    this->m_SendMessageType = "TRACKEDBATCH";
+  }
+
+  //----------------------------------------------------------------------------
+  PlusTrackedFrameBatchMessage::~PlusTrackedFrameBatchMessage()
+  {
+  }
+
+  //----------------------------------------------------------------------------
+  igtl::MessageBase::Pointer PlusTrackedFrameBatchMessage::Clone()
+  {
+    igtl::MessageBase::Pointer clone;
+    {
+      vtkSmartPointer<vtkPlusIgtlMessageFactory> factory = vtkSmartPointer<vtkPlusIgtlMessageFactory>::New();
+      clone = dynamic_cast<igtl::MessageBase*>(factory->CreateSendMessage(this->GetMessageType(), this->GetHeaderVersion()).GetPointer());
+    }
+
+    igtl::PlusTrackedFrameBatchMessage::Pointer msg = dynamic_cast<igtl::PlusTrackedFrameBatchMessage*>(clone.GetPointer());
+
+    int bodySize = this->m_MessageSize - IGTL_HEADER_SIZE;
+    msg->InitBuffer();
+    msg->CopyHeader(this);
+    msg->AllocateBuffer(bodySize);
+    if (bodySize > 0)
+    {
+      msg->CopyBody(this);
+    }
+
+    return clone;
+  }
+
+  //----------------------------------------------------------------------------
+  void PlusTrackedFrameBatchMessage::ClearTrackedFrames()
+  {
+    this->m_MessageHeader.m_NumberOfFrames = 0;
+    this->m_MessageHeader.m_ImageDataSizeInBytes = 0;
+    this->m_FieldNames.clear();
+    this->m_FieldIndices.clear();
+    this->m_FrameTimestamps.clear();
+    this->m_FieldValues.clear();
+    this->m_ImageData.clear();
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus PlusTrackedFrameBatchMessage::AddTrackedFrame(igsioTrackedFrame& trackedFrame, const std::vector<igsioTransformName>& requestedTransforms)
+  {
+    igsioVideoFrame* videoFrame = trackedFrame.GetImageData();
+    bool hasImage = (videoFrame != NULL && videoFrame->IsImageValid());
+
+    FrameSizeType frameSize = { 0, 0, 0 };
+    igtl_uint16 scalarType = 0;
+    unsigned int numberOfScalarComponents(0);
+    igtl_uint16 imageType = 0;
+    igtl_uint16 imageOrientation = 0;
+    igtl_uint32 imageDataSizeInBytes = 0;
+    if (hasImage)
+    {
+      frameSize = trackedFrame.GetFrameSize();
+      if (frameSize[0] > static_cast<unsigned int>(std::numeric_limits<igtl_uint16>::max()) ||
+          frameSize[1] > static_cast<unsigned int>(std::numeric_limits<igtl_uint16>::max()) ||
+          frameSize[2] > static_cast<unsigned int>(std::numeric_limits<igtl_uint16>::max()))
+      {
+        LOG_ERROR("Frame size element is too large to be sent over OpenIGTLink. Cannot add tracked frame to batch.");
+        return PLUS_FAIL;
+      }
+      if (videoFrame->GetNumberOfScalarComponents(numberOfScalarComponents) == PLUS_FAIL)
+      {
+        LOG_ERROR("Unable to retrieve number of scalar components.");
+        return PLUS_FAIL;
+      }
+      scalarType = PlusCommon::GetIGTLScalarPixelTypeFromVTK(videoFrame->GetVTKScalarPixelType());
+      imageType = videoFrame->GetImageType();
+      imageOrientation = (igtl_uint16)videoFrame->GetImageOrientation();
+      imageDataSizeInBytes = videoFrame->GetFrameSizeInBytes();
+    }
+
+    if (this->m_MessageHeader.m_NumberOfFrames == 0)
+    {
+      this->m_MessageHeader.m_FrameSize[0] = frameSize[0];
+      this->m_MessageHeader.m_FrameSize[1] = frameSize[1];
+      this->m_MessageHeader.m_FrameSize[2] = frameSize[2];
+      this->m_MessageHeader.m_ScalarType = scalarType;
+      this->m_MessageHeader.m_NumberOfComponents = numberOfScalarComponents;
+      this->m_MessageHeader.m_ImageType = imageType;
+      this->m_MessageHeader.m_ImageOrientation = imageOrientation;
+      this->m_MessageHeader.m_ImageDataSizeInBytes = imageDataSizeInBytes;
+    }
+    else if (this->m_MessageHeader.m_FrameSize[0] != frameSize[0] || this->m_MessageHeader.m_FrameSize[1] != frameSize[1] || this->m_MessageHeader.m_FrameSize[2] != frameSize[2]
+             || this->m_MessageHeader.m_ScalarType != scalarType || this->m_MessageHeader.m_NumberOfComponents != numberOfScalarComponents
+             || this->m_MessageHeader.m_ImageType != imageType || this->m_MessageHeader.m_ImageOrientation != imageOrientation
+             || this->m_MessageHeader.m_ImageDataSizeInBytes != imageDataSizeInBytes)
+    {
+      // The batch has to be sent before frames with a different image can be added
+      return PLUS_FAIL;
+    }
+
+    std::set<std::string> requestedTransformNames;
+    for (std::vector<igsioTransformName>::const_iterator it = requestedTransforms.begin(); it != requestedTransforms.end(); ++it)
+    {
+      requestedTransformNames.insert(it->GetTransformName());
+    }
+
+    // Fields that are not defined in previous frames extend the schema, their value is empty in the previous frames
+    std::vector<std::string> fieldValues(this->m_FieldNames.size());
+    igsioFieldMapType frameFields = trackedFrame.GetFrameFields();
+    for (igsioFieldMapType::const_iterator fieldIt = frameFields.begin(); fieldIt != frameFields.end(); ++fieldIt)
+    {
+      if (fieldIt->second.second.empty() || IsUnrequestedTransformField(fieldIt->first, requestedTransformNames))
+      {
+        continue;
+      }
+      std::map<std::string, unsigned int>::iterator indexIt = this->m_FieldIndices.find(fieldIt->first);
+      if (indexIt == this->m_FieldIndices.end())
+      {
+        indexIt = this->m_FieldIndices.insert(std::make_pair(fieldIt->first, static_cast<unsigned int>(this->m_FieldNames.size()))).first;
+        this->m_FieldNames.push_back(fieldIt->first);
+        fieldValues.resize(this->m_FieldNames.size());
+      }
+      fieldValues[indexIt->second] = fieldIt->second.second;
+    }
+
+    this->m_FrameTimestamps.push_back(trackedFrame.GetTimestamp());
+    this->m_FieldValues.push_back(fieldValues);
+    if (imageDataSizeInBytes > 0)
+    {
+      const unsigned char* imageData = static_cast<const unsigned char*>(videoFrame->GetScalarPointer());
+      this->m_ImageData.insert(this->m_ImageData.end(), imageData, imageData + imageDataSizeInBytes);
+    }
+    this->m_MessageHeader.m_NumberOfFrames++;
+
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  unsigned int PlusTrackedFrameBatchMessage::GetNumberOfTrackedFrames() const
+  {
+    return this->m_MessageHeader.m_NumberOfFrames;
+  }
+
+  //----------------------------------------------------------------------------
+  double PlusTrackedFrameBatchMessage::GetFirstFrameTimestamp() const
+  {
+    return this->m_FrameTimestamps.empty() ? UNDEFINED_TIMESTAMP : this->m_FrameTimestamps[0];
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus PlusTrackedFrameBatchMessage::GetTrackedFrame(unsigned int frameIndex, igsioTrackedFrame& trackedFrame) const
+  {
+    if (frameIndex >= this->m_FrameTimestamps.size())
+    {
+      LOG_ERROR("Frame index " << frameIndex << " is out of range, the batch contains " << this->m_FrameTimestamps.size() << " frames");
+      return PLUS_FAIL;
+    }
+
+    trackedFrame = igsioTrackedFrame();
+    trackedFrame.SetTimestamp(this->m_FrameTimestamps[frameIndex]);
+    const std::vector<std::string>& fieldValues = this->m_FieldValues[frameIndex];
+    for (unsigned int fieldIndex = 0; fieldIndex < fieldValues.size() && fieldIndex < this->m_FieldNames.size(); ++fieldIndex)
+    {
+      if (!fieldValues[fieldIndex].empty())
+      {
+        trackedFrame.SetFrameField(this->m_FieldNames[fieldIndex], fieldValues[fieldIndex]);
+      }
+    }
+
+    if (this->m_MessageHeader.m_ImageDataSizeInBytes > 0)
+    {
+      FrameSizeType frameSize = { this->m_MessageHeader.m_FrameSize[0], this->m_MessageHeader.m_FrameSize[1], this->m_MessageHeader.m_FrameSize[2] };
+      if (trackedFrame.GetImageData()->AllocateFrame(frameSize, PlusCommon::GetVTKScalarPixelTypeFromIGTL(this->m_MessageHeader.m_ScalarType), this->m_MessageHeader.m_NumberOfComponents) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to allocate memory for frame received in Plus TrackedFrameBatch message");
+        return PLUS_FAIL;
+      }
+      if (trackedFrame.GetImageData()->GetFrameSizeInBytes() != this->m_MessageHeader.m_ImageDataSizeInBytes)
+      {
+        LOG_ERROR("Invalid TRACKEDBATCH message: image data size does not match the frame size");
+        return PLUS_FAIL;
+      }
+      trackedFrame.GetImageData()->SetImageType((US_IMAGE_TYPE)this->m_MessageHeader.m_ImageType);
+      trackedFrame.GetImageData()->SetImageOrientation((US_IMAGE_ORIENTATION)this->m_MessageHeader.m_ImageOrientation);
+      memcpy(trackedFrame.GetImageData()->GetScalarPointer(), &this->m_ImageData[static_cast<size_t>(frameIndex) * this->m_MessageHeader.m_ImageDataSizeInBytes], this->m_MessageHeader.m_ImageDataSizeInBytes);
+      trackedFrame.GetImageData()->GetImage()->Modified();
+    }
+
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus PlusTrackedFrameBatchMessage::SetEmbeddedImageTransform(vtkSmartPointer<vtkMatrix4x4> matrix)
+  {
+    for (int i = 0; i < 4; ++i)
+    {
+      for (int j = 0; j < 4; ++j)
+      {
+        m_MessageHeader.m_EmbeddedImageTransform[i][j] = matrix->GetElement(i, j);
+      }
+    }
+
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  vtkSmartPointer<vtkMatrix4x4> PlusTrackedFrameBatchMessage::GetEmbeddedImageTransform()
+  {
+    vtkSmartPointer<vtkMatrix4x4> mat(vtkSmartPointer<vtkMatrix4x4>::New());
+    for (int i = 0; i < 4; ++i)
+    {
+      for (int j = 0; j < 4; ++j)
+      {
+        mat->SetElement(i, j, m_MessageHeader.m_EmbeddedImageTransform[i][j]);
+      }
+    }
+    return mat;
+  }
+
+  //----------------------------------------------------------------------------
+  int PlusTrackedFrameBatchMessage::CalculateContentBufferSize()
+  {
+    // Field names and values are terminated by a null character, each frame starts with the 8-byte timestamp
+    size_t schemaSizeInBytes = 0;
+    for (std::vector<std::string>::const_iterator it = this->m_FieldNames.begin(); it != this->m_FieldNames.end(); ++it)
+    {
+      schemaSizeInBytes += it->size() + 1;
+    }
+    size_t fieldDataSizeInBytes = this->m_FrameTimestamps.size() * sizeof(igtl_uint64);
+    for (std::vector<std::vector<std::string> >::const_iterator frameIt = this->m_FieldValues.begin(); frameIt != this->m_FieldValues.end(); ++frameIt)
+    {
+      for (std::vector<std::string>::const_iterator valueIt = frameIt->begin(); valueIt != frameIt->end(); ++valueIt)
+      {
+        fieldDataSizeInBytes += valueIt->size() + 1;
+      }
+      // Values of fields that were added to the schema by later frames are empty
+      fieldDataSizeInBytes += this->m_FieldNames.size() - frameIt->size();
+    }
+    this->m_MessageHeader.m_SchemaSizeInBytes = static_cast<igtl_uint32>(schemaSizeInBytes);
+    this->m_MessageHeader.m_FieldDataSizeInBytes = static_cast<igtl_uint32>(fieldDataSizeInBytes);
+
+    return this->m_MessageHeader.GetMessageHeaderSize()
+           + this->m_MessageHeader.m_SchemaSizeInBytes
+           + this->m_MessageHeader.m_FieldDataSizeInBytes
+           + this->m_ImageData.size();
+  }
+
+  //----------------------------------------------------------------------------
+  int PlusTrackedFrameBatchMessage::PackContent()
+  {
+    AllocateBuffer();
+
+    // Copy header
+    TrackedFrameBatchHeader* header = (TrackedFrameBatchHeader*)(this->m_Content);
+    memcpy(header, &this->m_MessageHeader, this->m_MessageHeader.GetMessageHeaderSize());
+
+    // Copy field names
+    char* data = (char*)(this->m_Content + this->m_MessageHeader.GetMessageHeaderSize());
+    for (std::vector<std::string>::const_iterator it = this->m_FieldNames.begin(); it != this->m_FieldNames.end(); ++it)
+    {
+      memcpy(data, it->c_str(), it->size() + 1);
+      data += it->size() + 1;
+    }
+
+    // Copy timestamps and field values
+    for (unsigned int frameIndex = 0; frameIndex < this->m_FrameTimestamps.size(); ++frameIndex)
+    {
+      igtl_uint64 timestamp = 0;
+      memcpy(&timestamp, &this->m_FrameTimestamps[frameIndex], sizeof(igtl_uint64));
+      if (igtl_is_little_endian())
+      {
+        timestamp = BYTE_SWAP_INT64(timestamp);
+      }
+      memcpy(data, &timestamp, sizeof(igtl_uint64));
+      data += sizeof(igtl_uint64);
+
+      const std::vector<std::string>& fieldValues = this->m_FieldValues[frameIndex];
+      for (unsigned int fieldIndex = 0; fieldIndex < this->m_FieldNames.size(); ++fieldIndex)
+      {
+        const char* value = (fieldIndex < fieldValues.size() ? fieldValues[fieldIndex].c_str() : "");
+        size_t valueSize = strlen(value) + 1;
+        memcpy(data, value, valueSize);
+        data += valueSize;
+      }
+    }
+
+    // Copy image data
+    if (!this->m_ImageData.empty())
+    {
+      memcpy(data, &this->m_ImageData[0], this->m_ImageData.size());
+    }
+
+    // Set timestamp of the message to the timestamp of the last frame
+    if (!this->m_FrameTimestamps.empty())
+    {
+      igtl::TimeStamp::Pointer timestamp = igtl::TimeStamp::New();
+      timestamp->SetTime(this->m_FrameTimestamps.back());
+      this->SetTimeStamp(timestamp);
+    }
+
+    // Convert header endian
+    header->ConvertEndianness();
+
+    return 1;
+  }
+
+  //----------------------------------------------------------------------------
+  int PlusTrackedFrameBatchMessage::UnpackContent()
+  {
+    TrackedFrameBatchHeader* header = (TrackedFrameBatchHeader*)(this->m_Content);
+
+    // Convert header endian
+    header->ConvertEndianness();
+
+    // Copy header
+    memcpy(&this->m_MessageHeader, header, this->m_MessageHeader.GetMessageHeaderSize());
+
+    size_t imageDataSizeInBytes = static_cast<size_t>(this->m_MessageHeader.m_NumberOfFrames) * this->m_MessageHeader.m_ImageDataSizeInBytes;
+    size_t contentSize = this->m_MessageHeader.GetMessageHeaderSize() + this->m_MessageHeader.m_SchemaSizeInBytes + this->m_MessageHeader.m_FieldDataSizeInBytes + imageDataSizeInBytes;
+    if (contentSize > static_cast<size_t>(this->GetBufferBodySize()))
+    {
+      LOG_ERROR("Invalid TRACKEDBATCH message: data size (" << contentSize << " bytes) exceeds the message size (" << this->GetBufferBodySize() << " bytes)");
+      return 0;
+    }
+
+    // Field names
+    const char* data = (const char*)(this->m_Content + this->m_MessageHeader.GetMessageHeaderSize());
+    const char* schemaEnd = data + this->m_MessageHeader.m_SchemaSizeInBytes;
+    this->m_FieldNames.clear();
+    this->m_FieldIndices.clear();
+    while (data < schemaEnd)
+    {
+      size_t nameLength = strnlen(data, schemaEnd - data);
+      if (data + nameLength >= schemaEnd)
+      {
+        LOG_ERROR("Invalid TRACKEDBATCH message: field name is not terminated");
+        return 0;
+      }
+      this->m_FieldIndices[std::string(data, nameLength)] = static_cast<unsigned int>(this->m_FieldNames.size());
+      this->m_FieldNames.push_back(std::string(data, nameLength));
+      data += nameLength + 1;
+    }
+
+    // Timestamps and field values
+    const char* fieldDataEnd = data + this->m_MessageHeader.m_FieldDataSizeInBytes;
+    this->m_FrameTimestamps.clear();
+    this->m_FieldValues.clear();
+    for (unsigned int frameIndex = 0; frameIndex < this->m_MessageHeader.m_NumberOfFrames; ++frameIndex)
+    {
+      if (data + sizeof(igtl_uint64) > fieldDataEnd)
+      {
+        LOG_ERROR("Invalid TRACKEDBATCH message: field data is incomplete");
+        return 0;
+      }
+      igtl_uint64 timestampBits = 0;
+      memcpy(&timestampBits, data, sizeof(igtl_uint64));
+      if (igtl_is_little_endian())
+      {
+        timestampBits = BYTE_SWAP_INT64(timestampBits);
+      }
+      double timestamp = 0;
+      memcpy(&timestamp, &timestampBits, sizeof(double));
+      this->m_FrameTimestamps.push_back(timestamp);
+      data += sizeof(igtl_uint64);
+
+      std::vector<std::string> fieldValues(this->m_FieldNames.size());
+      for (unsigned int fieldIndex = 0; fieldIndex < this->m_FieldNames.size(); ++fieldIndex)
+      {
+        size_t valueLength = strnlen(data, fieldDataEnd - data);
+        if (data + valueLength >= fieldDataEnd)
+        {
+          LOG_ERROR("Invalid TRACKEDBATCH message: field value is not terminated");
+          return 0;
+        }
+        fieldValues[fieldIndex].assign(data, valueLength);
+        data += valueLength + 1;
+      }
+      this->m_FieldValues.push_back(fieldValues);
+    }
+
+    // Images
+    const unsigned char* imageData = (const unsigned char*)fieldDataEnd;
+    this->m_ImageData.assign(imageData, imageData + imageDataSizeInBytes);
+
+    return 1;
+  }
+}
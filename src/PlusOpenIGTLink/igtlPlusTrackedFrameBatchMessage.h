@@ -0,0 +1,174 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __igtlPlusTrackedFrameBatchMessage_h
+#define __igtlPlusTrackedFrameBatchMessage_h
+
+#include "vtkPlusOpenIGTLinkExport.h"
+
+#include "igsioTrackedFrame.h"
+#include "igtl_types.h"
+#include "igtl_win32header.h"
+#include "igtlMessageBase.h"
+#include "igtlObject.h"
+#include "igtl_header.h"
+#include "igtl_util.h"
+#include "vtkMatrix4x4.h"
+#include "vtkSmartPointer.h"
+#include <map>
+#include <string>
+#include <vector>
+
+namespace igtl
+{
+  // This command prevents 4-byte alignment in the struct (which enables m_FrameSize[3])
+#pragma pack(1)     /* For 1-byte boundary in memory */
+
+  /*!
+    \class PlusTrackedFrameBatchMessage
+    \brief IGTL message for sending multiple tracked frames in one message (TRACKEDBATCH)
+
+    All frames of a batch have the same image size, pixel type and image type. The names of the frame fields
+    (including the transforms) are sent once for the batch, followed by the timestamp and the field values of each frame
+    and one block that contains the images of all frames. Compared to sending a TRACKEDFRAME message for each frame,
+    this avoids serializing the field names and a message header for every frame, which matters for high-rate streams
+    (e.g., RF or 3D data) that are recorded on a remote computer.
+
+    \ingroup PlusLibOpenIGTLink
+  */
+  class vtkPlusOpenIGTLinkExport PlusTrackedFrameBatchMessage: public MessageBase
+  {
+  public:
+    igtlTypeMacro(igtl::PlusTrackedFrameBatchMessage, igtl::MessageBase);
+    igtlNewMacro(igtl::PlusTrackedFrameBatchMessage);
+
+  public:
+    /*! Override clone so that we use the plus igtl factory */
+    virtual igtl::MessageBase::Pointer Clone();
+
+    /*! Remove all frames from the batch */
+    void ClearTrackedFrames();
+
+    /*!
+      Append a frame to the batch.
+      \param requestedTransforms Only these transforms are included in the batch (all transforms if it is empty)
+      \return PLUS_FAIL if the image of the frame is different in size or type than the images already in the batch
+    */
+    PlusStatus AddTrackedFrame(igsioTrackedFrame& trackedFrame, const std::vector<igsioTransformName>& requestedTransforms);
+
+    /*! Number of frames in the batch */
+    unsigned int GetNumberOfTrackedFrames() const;
+
+    /*! Timestamp of the first frame of the batch, UNDEFINED_TIMESTAMP if the batch is empty */
+    double GetFirstFrameTimestamp() const;
+
+    /*! Get a frame of the batch (available after unpacking the message) */
+    PlusStatus GetTrackedFrame(unsigned int frameIndex, igsioTrackedFrame& trackedFrame) const;
+
+    /*! Set the embedded transform of the underlying images */
+    PlusStatus SetEmbeddedImageTransform(vtkSmartPointer<vtkMatrix4x4> matrix);
+
+    /*! Get the embedded transform of the underlying images */
+    vtkSmartPointer<vtkMatrix4x4> GetEmbeddedImageTransform();
+
+  protected:
+    class TrackedFrameBatchHeader
+    {
+    public:
+      TrackedFrameBatchHeader()
+        : m_ScalarType(0)
+        , m_NumberOfComponents(0)
+        , m_ImageType(0)
+        , m_ImageOrientation(0)
+        , m_NumberOfFrames(0)
+        , m_ImageDataSizeInBytes(0)
+        , m_SchemaSizeInBytes(0)
+        , m_FieldDataSizeInBytes(0)
+      {
+        m_FrameSize[0] = m_FrameSize[1] = m_FrameSize[2] = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+          for (int j = 0; j < 4; ++j)
+          {
+            m_EmbeddedImageTransform[i][j] = (i == j) ? 1.f : 0.f;
+          }
+        }
+      }
+
+      size_t GetMessageHeaderSize()
+      {
+        size_t headersize = 0;
+        headersize += sizeof(igtl_uint16);        // m_ScalarType
+        headersize += sizeof(igtl_uint16);        // m_NumberOfComponents
+        headersize += sizeof(igtl_uint16);        // m_ImageType
+        headersize += sizeof(igtl_uint16) * 3;    // m_FrameSize[3]
+        headersize += sizeof(igtl_uint16);        // m_ImageOrientation
+        headersize += sizeof(igtl_uint32);        // m_NumberOfFrames
+        headersize += sizeof(igtl_uint32);        // m_ImageDataSizeInBytes
+        headersize += sizeof(igtl_uint32);        // m_SchemaSizeInBytes
+        headersize += sizeof(igtl_uint32);        // m_FieldDataSizeInBytes
+        headersize += sizeof(igtl::Matrix4x4);    // m_EmbeddedImageTransform[4][4]
+
+        return headersize;
+      }
+
+      void ConvertEndianness()
+      {
+        if (igtl_is_little_endian())
+        {
+          m_ScalarType = BYTE_SWAP_INT16(m_ScalarType);
+          m_NumberOfComponents = BYTE_SWAP_INT16(m_NumberOfComponents);
+          m_ImageType = BYTE_SWAP_INT16(m_ImageType);
+          m_FrameSize[0] = BYTE_SWAP_INT16(m_FrameSize[0]);
+          m_FrameSize[1] = BYTE_SWAP_INT16(m_FrameSize[1]);
+          m_FrameSize[2] = BYTE_SWAP_INT16(m_FrameSize[2]);
+          m_ImageOrientation = BYTE_SWAP_INT16(m_ImageOrientation);
+          m_NumberOfFrames = BYTE_SWAP_INT32(m_NumberOfFrames);
+          m_ImageDataSizeInBytes = BYTE_SWAP_INT32(m_ImageDataSizeInBytes);
+          m_SchemaSizeInBytes = BYTE_SWAP_INT32(m_SchemaSizeInBytes);
+          m_FieldDataSizeInBytes = BYTE_SWAP_INT32(m_FieldDataSizeInBytes);
+        }
+      }
+
+      igtl_uint16     m_ScalarType;             /* scalar type                     */
+      igtl_uint16     m_NumberOfComponents;     /* number of scalar components */
+      igtl_uint16     m_ImageType;              /* image type */
+      igtl_uint16     m_FrameSize[3];           /* image volume size of each frame */
+      igtl_uint16     m_ImageOrientation;       /* orientation of the images */
+      igtl_uint32     m_NumberOfFrames;         /* number of frames in the batch */
+      igtl_uint32     m_ImageDataSizeInBytes;   /* size of the image of one frame, in bytes (0 if the frames have no image) */
+      igtl_uint32     m_SchemaSizeInBytes;      /* size of the field names, in bytes */
+      igtl_uint32     m_FieldDataSizeInBytes;   /* size of the timestamps and field values of all frames, in bytes */
+      igtl::Matrix4x4 m_EmbeddedImageTransform; /* matrix representing the IJK to world transformation */
+    };
+
+    virtual int  CalculateContentBufferSize();
+    virtual int  PackContent();
+    virtual int  UnpackContent();
+
+    PlusTrackedFrameBatchMessage();
+    ~PlusTrackedFrameBatchMessage();
+
+    TrackedFrameBatchHeader m_MessageHeader;
+
+    /*! Names of the frame fields of all frames in the batch */
+    std::vector<std::string> m_FieldNames;
+    std::map<std::string, unsigned int> m_FieldIndices;
+
+    std::vector<double> m_FrameTimestamps;
+
+    /*! Field values of each frame, in the order of m_FieldNames. Empty values are not defined in the frame. */
+    std::vector<std::vector<std::string> > m_FieldValues;
+
+    /*! Images of all frames */
+    std::vector<unsigned char> m_ImageData;
+  };
+
+#pragma pack()
+
+} // namespace igtl
+
+#endif
@@ -10,11 +10,240 @@ See License.txt for details.
 #include "vtkMatrix4x4.h"
 #include "vtkPlusIgtlMessageFactory.h"
 
+#include <cstring>
+#include <limits>
+
+namespace
+{
+  const char BINARY_FIELDS_SIGNATURE[4] = { 'P', 'T', 'F', 'B' };
+  // Increment when the layout of the binary field data changes
+  const igtl_uint16 BINARY_FIELDS_VERSION = 1;
+
+  //----------------------------------------------------------------------------
+  void AppendBigEndian(std::string& buffer, igtl_uint64 value, int numberOfBytes)
+  {
+    for (int i = numberOfBytes - 1; i >= 0; --i)
+    {
+      buffer.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  void AppendString(std::string& buffer, const std::string& value, int numberOfLengthBytes)
+  {
+    AppendBigEndian(buffer, value.size(), numberOfLengthBytes);
+    buffer.append(value);
+  }
+
+  //----------------------------------------------------------------------------
+  void AppendFloat64(std::string& buffer, double value)
+  {
+    igtl_uint64 bits = 0;
+    memcpy(&bits, &value, sizeof(igtl_uint64));
+    AppendBigEndian(buffer, bits, sizeof(igtl_uint64));
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Reads the values written by the Append... functions, fails if the data is shorter than expected */
+  class BinaryFieldReader
+  {
+  public:
+    BinaryFieldReader(const std::string& data) : Data(data), Position(0) {}
+
+    bool ReadBigEndian(igtl_uint64& value, int numberOfBytes)
+    {
+      if (this->Position + numberOfBytes > this->Data.size())
+      {
+        return false;
+      }
+      value = 0;
+      for (int i = 0; i < numberOfBytes; ++i)
+      {
+        value = (value << 8) | static_cast<unsigned char>(this->Data[this->Position++]);
+      }
+      return true;
+    }
+
+    bool ReadString(std::string& value, int numberOfLengthBytes)
+    {
+      igtl_uint64 length = 0;
+      if (!this->ReadBigEndian(length, numberOfLengthBytes) || this->Position + length > this->Data.size())
+      {
+        return false;
+      }
+      value.assign(this->Data, this->Position, static_cast<size_t>(length));
+      this->Position += static_cast<size_t>(length);
+      return true;
+    }
+
+    bool ReadFloat64(double& value)
+    {
+      igtl_uint64 bits = 0;
+      if (!this->ReadBigEndian(bits, sizeof(igtl_uint64)))
+      {
+        return false;
+      }
+      memcpy(&value, &bits, sizeof(double));
+      return true;
+    }
+
+  protected:
+    const std::string& Data;
+    size_t Position;
+  };
+
+  //----------------------------------------------------------------------------
+  bool IsBinaryFieldData(const std::string& data)
+  {
+    return data.size() >= sizeof(BINARY_FIELDS_SIGNATURE) && memcmp(data.c_str(), BINARY_FIELDS_SIGNATURE, sizeof(BINARY_FIELDS_SIGNATURE)) == 0;
+  }
+
+  //----------------------------------------------------------------------------
+  /*!
+    Layout (big-endian): signature, uint16 version, uint32 number of fields, for each field uint16 name length, name,
+    uint32 value length, value, then uint32 number of transforms, for each transform uint16 name length, name,
+    uint8 status and the 16 elements of the matrix in row-major order as float64.
+  */
+  PlusStatus EncodeBinaryFields(igsioTrackedFrame& trackedFrame, const std::vector<igsioTransformName>& requestedTransforms, std::string& data)
+  {
+    data.assign(BINARY_FIELDS_SIGNATURE, sizeof(BINARY_FIELDS_SIGNATURE));
+    AppendBigEndian(data, BINARY_FIELDS_VERSION, sizeof(igtl_uint16));
+
+    // Transforms are sent as matrices, not as fields
+    igsioFieldMapType frameFields = trackedFrame.GetFrameFields();
+    std::vector<const igsioFieldMapType::value_type*> fields;
+    for (igsioFieldMapType::const_iterator fieldIt = frameFields.begin(); fieldIt != frameFields.end(); ++fieldIt)
+    {
+      if (!igsioTrackedFrame::IsTransform(fieldIt->first) && !igsioTrackedFrame::IsTransformStatus(fieldIt->first))
+      {
+        fields.push_back(&(*fieldIt));
+      }
+    }
+    AppendBigEndian(data, fields.size(), sizeof(igtl_uint32));
+    for (std::vector<const igsioFieldMapType::value_type*>::const_iterator fieldIt = fields.begin(); fieldIt != fields.end(); ++fieldIt)
+    {
+      if ((*fieldIt)->first.size() > std::numeric_limits<igtl_uint16>::max())
+      {
+        LOG_ERROR("Frame field name is too long to be sent in binary encoding: " << (*fieldIt)->first.substr(0, 64) << "...");
+        return PLUS_FAIL;
+      }
+      AppendString(data, (*fieldIt)->first, sizeof(igtl_uint16));
+      AppendString(data, (*fieldIt)->second.second, sizeof(igtl_uint32));
+    }
+
+    std::vector<igsioTransformName> transformNames = requestedTransforms;
+    if (transformNames.empty())
+    {
+      trackedFrame.GetFrameTransformNameList(transformNames);
+    }
+    vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    std::string transformData;
+    unsigned int numberOfTransforms = 0;
+    for (std::vector<igsioTransformName>::const_iterator nameIt = transformNames.begin(); nameIt != transformNames.end(); ++nameIt)
+    {
+      ToolStatus status(TOOL_INVALID);
+      if (trackedFrame.GetFrameTransform(*nameIt, matrix) != PLUS_SUCCESS)
+      {
+        // Not available in this frame
+        continue;
+      }
+      trackedFrame.GetFrameTransformStatus(*nameIt, status);
+      AppendString(transformData, nameIt->GetTransformName(), sizeof(igtl_uint16));
+      AppendBigEndian(transformData, static_cast<igtl_uint8>(status), sizeof(igtl_uint8));
+      for (int i = 0; i < 4; ++i)
+      {
+        for (int j = 0; j < 4; ++j)
+        {
+          AppendFloat64(transformData, matrix->GetElement(i, j));
+        }
+      }
+      ++numberOfTransforms;
+    }
+    AppendBigEndian(data, numberOfTransforms, sizeof(igtl_uint32));
+    data.append(transformData);
+
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus DecodeBinaryFields(const std::string& data, igsioTrackedFrame& trackedFrame)
+  {
+    BinaryFieldReader reader(data);
+    igtl_uint64 value = 0;
+    reader.ReadBigEndian(value, sizeof(BINARY_FIELDS_SIGNATURE));
+    if (!reader.ReadBigEndian(value, sizeof(igtl_uint16)) || value > BINARY_FIELDS_VERSION)
+    {
+      LOG_ERROR("Unsupported binary field encoding version in Plus TrackedFrame message: " << value << " (supported: " << BINARY_FIELDS_VERSION << ")");
+      return PLUS_FAIL;
+    }
+
+    igtl_uint64 numberOfFields = 0;
+    if (!reader.ReadBigEndian(numberOfFields, sizeof(igtl_uint32)))
+    {
+      LOG_ERROR("Invalid binary field data in Plus TrackedFrame message");
+      return PLUS_FAIL;
+    }
+    for (igtl_uint64 i = 0; i < numberOfFields; ++i)
+    {
+      std::string fieldName;
+      std::string fieldValue;
+      if (!reader.ReadString(fieldName, sizeof(igtl_uint16)) || !reader.ReadString(fieldValue, sizeof(igtl_uint32)))
+      {
+        LOG_ERROR("Invalid binary field data in Plus TrackedFrame message: incomplete field");
+        return PLUS_FAIL;
+      }
+      trackedFrame.SetFrameField(fieldName, fieldValue);
+    }
+
+    igtl_uint64 numberOfTransforms = 0;
+    if (!reader.ReadBigEndian(numberOfTransforms, sizeof(igtl_uint32)))
+    {
+      LOG_ERROR("Invalid binary field data in Plus TrackedFrame message");
+      return PLUS_FAIL;
+    }
+    vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    for (igtl_uint64 t = 0; t < numberOfTransforms; ++t)
+    {
+      std::string transformNameStr;
+      igtl_uint64 status = 0;
+      if (!reader.ReadString(transformNameStr, sizeof(igtl_uint16)) || !reader.ReadBigEndian(status, sizeof(igtl_uint8)))
+      {
+        LOG_ERROR("Invalid binary field data in Plus TrackedFrame message: incomplete transform");
+        return PLUS_FAIL;
+      }
+      for (int i = 0; i < 4; ++i)
+      {
+        for (int j = 0; j < 4; ++j)
+        {
+          double element = 0;
+          if (!reader.ReadFloat64(element))
+          {
+            LOG_ERROR("Invalid binary field data in Plus TrackedFrame message: incomplete transform");
+            return PLUS_FAIL;
+          }
+          matrix->SetElement(i, j, element);
+        }
+      }
+      igsioTransformName transformName;
+      if (transformName.SetTransformName(transformNameStr) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Invalid transform name in Plus TrackedFrame message: " << transformNameStr);
+        return PLUS_FAIL;
+      }
+      trackedFrame.SetFrameTransform(transformName, matrix);
+      trackedFrame.SetFrameTransformStatus(transformName, static_cast<ToolStatus>(status));
+    }
+
+    return PLUS_SUCCESS;
+  }
+}
+
 namespace igtl
 {
   //----------------------------------------------------------------------------
   PlusTrackedFrameMessage::PlusTrackedFrameMessage()
     : MessageBase()
+    , m_BinaryFieldEncoding(false)
   {
     this->m_SendMessageType = "TRACKEDFRAME";
   }
@@ -52,7 +281,15 @@ namespace igtl
   {
     this->m_TrackedFrame = trackedFrame;
 
-    if (this->m_TrackedFrame.GetTrackedFrameInXmlData(this->m_TrackedFrameXmlData, requestedTransforms) != PLUS_SUCCESS)
+    if (this->m_BinaryFieldEncoding)
+    {
+      if (EncodeBinaryFields(this->m_TrackedFrame, requestedTransforms, this->m_TrackedFrameXmlData) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to pack Plus TrackedFrame message - unable to encode tracked frame fields.");
+        return PLUS_FAIL;
+      }
+    }
+    else if (this->m_TrackedFrame.GetTrackedFrameInXmlData(this->m_TrackedFrameXmlData, requestedTransforms) != PLUS_SUCCESS)
     {
       LOG_ERROR("Failed to pack Plus TrackedFrame message - unable to get tracked frame in xml data.");
       return PLUS_FAIL;
@@ -93,6 +330,18 @@ namespace igtl
     return this->m_TrackedFrame;
   }
 
+  //----------------------------------------------------------------------------
+  void PlusTrackedFrameMessage::SetBinaryFieldEncoding(bool enable)
+  {
+    this->m_BinaryFieldEncoding = enable;
+  }
+
+  //----------------------------------------------------------------------------
+  bool PlusTrackedFrameMessage::GetBinaryFieldEncoding() const
+  {
+    return this->m_BinaryFieldEncoding;
+  }
+
   //----------------------------------------------------------------------------
   PlusStatus PlusTrackedFrameMessage::SetEmbeddedImageTransform(vtkSmartPointer<vtkMatrix4x4> matrix)
   {
@@ -147,9 +396,9 @@ namespace igtl
     header->m_ImageOrientation = this->m_MessageHeader.m_ImageOrientation;
     memcpy(header->m_EmbeddedImageTransform, this->m_MessageHeader.m_EmbeddedImageTransform, sizeof(igtl::Matrix4x4));
 
-    // Copy xml data
+    // Copy xml or binary field data (binary data may contain null characters)
     char* xmlData = (char*)(this->m_Content + header->GetMessageHeaderSize());
-    strncpy(xmlData, this->m_TrackedFrameXmlData.c_str(), this->m_TrackedFrameXmlData.size());
+    memcpy(xmlData, this->m_TrackedFrameXmlData.data(), this->m_TrackedFrameXmlData.size());
     header->m_XmlDataSizeInBytes = this->m_MessageHeader.m_XmlDataSizeInBytes;
 
     // Copy image data
@@ -190,7 +439,17 @@ namespace igtl
     // Copy xml data
     char* xmlData = (char*)(this->m_Content + header->GetMessageHeaderSize());
     this->m_TrackedFrameXmlData.assign(xmlData, header->m_XmlDataSizeInBytes);
-    if (this->m_TrackedFrame.SetTrackedFrameFromXmlData(this->m_TrackedFrameXmlData) != PLUS_SUCCESS)
+    if (IsBinaryFieldData(this->m_TrackedFrameXmlData))
+    {
+      // The message object may be reused for receiving, do not keep the fields of the previous frame
+      this->m_TrackedFrame = igsioTrackedFrame();
+      if (DecodeBinaryFields(this->m_TrackedFrameXmlData, this->m_TrackedFrame) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to set tracked frame data from binary fields received in Plus TrackedFrame message");
+        return 0;
+      }
+    }
+    else if (this->m_TrackedFrame.SetTrackedFrameFromXmlData(this->m_TrackedFrameXmlData) != PLUS_SUCCESS)
     {
       LOG_ERROR("Failed to set tracked frame data from xml received in Plus TrackedFrame message");
       return 0;
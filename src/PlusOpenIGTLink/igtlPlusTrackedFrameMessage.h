@@ -28,6 +28,13 @@ namespace igtl
   /*!
     \class PlusTrackedFrameMessage
     \brief IGTL message helper class for tracked frame messages
+
+    The frame fields and transforms are sent either as an XML string or, if binary field encoding is enabled,
+    in a versioned binary block (4-byte "PTFB" signature, 16-bit version, then the length-prefixed fields and
+    the transforms as 4x4 matrices of 64-bit floats). The receiver detects the encoding from the data, so
+    receivers that support the binary encoding can read messages from all senders. Binary encoding must only be
+    used for clients that requested it, as older receivers expect XML.
+
     \ingroup PlusLibOpenIGTLink
   */
   class vtkPlusOpenIGTLinkExport PlusTrackedFrameMessage: public MessageBase
@@ -46,6 +53,10 @@ namespace igtl
     /*! Get Plus TrackedFrame */
     igsioTrackedFrame GetTrackedFrame();
 
+    /*! Enable sending the frame fields and transforms in the binary encoding instead of XML. Takes effect at the next SetTrackedFrame call. */
+    void SetBinaryFieldEncoding(bool enable);
+    bool GetBinaryFieldEncoding() const;
+
     /*! Set the embedded transform of the underlying image */
     PlusStatus SetEmbeddedImageTransform(vtkSmartPointer<vtkMatrix4x4> matrix);
 
@@ -110,7 +121,7 @@ namespace igtl
       igtl_uint16     m_ImageType;              /* image type */
       igtl_uint16     m_FrameSize[3];           /* entire image volume size */
       igtl_uint32     m_ImageDataSizeInBytes;   /* size of the image, in bytes */
-      igtl_uint32     m_XmlDataSizeInBytes;     /* size of the xml data, in bytes */
+      igtl_uint32     m_XmlDataSizeInBytes;     /* size of the xml or binary field data, in bytes */
       igtl_uint16     m_ImageOrientation;       /* orientation of the image */
       igtl::Matrix4x4 m_EmbeddedImageTransform; /* matrix representing the IJK to world transformation */
     };
@@ -123,8 +134,12 @@ namespace igtl
     ~PlusTrackedFrameMessage();
 
     igsioTrackedFrame m_TrackedFrame;
+
+    /*! Frame fields and transforms, as XML or in the binary encoding */
     std::string m_TrackedFrameXmlData;
 
+    bool m_BinaryFieldEncoding;
+
     TrackedFrameHeader m_MessageHeader;
   };
 
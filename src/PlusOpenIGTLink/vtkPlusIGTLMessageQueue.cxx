@@ -12,6 +12,7 @@ See License.txt for details.
 #include "vtkObjectFactory.h"
 #include <vtksys/SystemTools.hxx>
 
+#include <algorithm>
 #include <string>
 
 #include "igtlMessageBase.h"
@@ -40,7 +41,7 @@ igtl::MessageBase* vtkPlusIGTLMessageQueue::PullMessage()
   igtl::MessageBase* ret = NULL;
   if ( this->DataBuffer.size() > 0 )
   {
-    this->DataBuffer.front();
+    ret = this->DataBuffer.front();
     this->DataBuffer.pop_front();
   }
   this->Mutex->Unlock();
@@ -48,10 +49,36 @@ igtl::MessageBase* vtkPlusIGTLMessageQueue::PullMessage()
   return ret;
 }
 
+//----------------------------------------------------------------------------
+void vtkPlusIGTLMessageQueue::PushMessages( const std::vector< igtl::MessageBase* >& messages )
+{
+  this->Mutex->Lock();
+  this->DataBuffer.insert( this->DataBuffer.end(), messages.begin(), messages.end() );
+  this->Mutex->Unlock();
+}
+
+//----------------------------------------------------------------------------
+int vtkPlusIGTLMessageQueue::PullMessages( std::vector< igtl::MessageBase* >& messages, int maxNumberOfMessages )
+{
+  this->Mutex->Lock();
+  int numberOfMessages = std::min( maxNumberOfMessages, static_cast<int>( this->DataBuffer.size() ) );
+  if ( numberOfMessages > 0 )
+  {
+    messages.insert( messages.end(), this->DataBuffer.begin(), this->DataBuffer.begin() + numberOfMessages );
+    this->DataBuffer.erase( this->DataBuffer.begin(), this->DataBuffer.begin() + numberOfMessages );
+  }
+  this->Mutex->Unlock();
+
+  return std::max( numberOfMessages, 0 );
+}
+
 //----------------------------------------------------------------------------
 int vtkPlusIGTLMessageQueue::GetSize()
 {
-  return this->DataBuffer.size();
+  this->Mutex->Lock();
+  int size = this->DataBuffer.size();
+  this->Mutex->Unlock();
+  return size;
 }
 
 //----------------------------------------------------------------------------
@@ -12,6 +12,7 @@
 #include "vtkObject.h"
 
 #include <deque>
+#include <vector>
 
 #include "igtlMessageBase.h"
 
@@ -32,6 +33,15 @@ public:
 
   void PushMessage( igtl::MessageBase* message );
   igtl::MessageBase* PullMessage();
+
+  /*! Push multiple messages at once, with a single lock (bulk transfer of multi-frame streams) */
+  void PushMessages( const std::vector< igtl::MessageBase* >& messages );
+
+  /*!
+    Pull up to maxNumberOfMessages messages at once, with a single lock.
+    eturn Number of messages that were appended to the output
+  */
+  int PullMessages( std::vector< igtl::MessageBase* >& messages, int maxNumberOfMessages );
   
   int GetSize();
   
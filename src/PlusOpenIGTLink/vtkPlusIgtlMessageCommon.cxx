@@ -6,6 +6,7 @@ See License.txt for details.
 
 // Local includes
 #include "PlusConfigure.h"
+#include "PlusAreaAverageResize.h"
 #include "igsioTrackedFrame.h"
 #include "igsioVideoFrame.h"
 #include "vtkPlusIgtlMessageCommon.h"
@@ -161,6 +162,235 @@ PlusStatus vtkPlusIgtlMessageCommon::UnpackTrackedFrameMessage(igtl::MessageHead
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusIgtlMessageCommon::UnpackTrackedFrameBatchMessage(igtl::MessageHeader::Pointer headerMsg,
+    igtl::Socket* socket,
+    std::vector<igsioTrackedFrame>& trackedFrames,
+    int crccheck)
+{
+  trackedFrames.clear();
+
+  if (headerMsg.IsNull())
+  {
+    LOG_ERROR("Unable to unpack tracked frame batch message - header message is NULL!");
+    return PLUS_FAIL;
+  }
+
+  if (socket == NULL)
+  {
+    LOG_ERROR("Unable to unpack tracked frame batch message - socket is NULL!");
+    return PLUS_FAIL;
+  }
+
+  igtl::PlusTrackedFrameBatchMessage::Pointer batchMsg = dynamic_cast<igtl::PlusTrackedFrameBatchMessage*>(headerMsg.GetPointer());
+  if (batchMsg.IsNull())
+  {
+    batchMsg = igtl::PlusTrackedFrameBatchMessage::New();
+  }
+  batchMsg->SetMessageHeader(headerMsg);
+  batchMsg->AllocateBuffer();
+
+  socket->Receive(batchMsg->GetBufferBodyPointer(), batchMsg->GetBufferBodySize());
+
+  int c = batchMsg->Unpack(crccheck);
+  if (!(c & igtl::MessageHeader::UNPACK_BODY))
+  {
+    LOG_ERROR("Couldn't receive tracked frame batch message from server!");
+    return PLUS_FAIL;
+  }
+
+  trackedFrames.resize(batchMsg->GetNumberOfTrackedFrames());
+  for (unsigned int i = 0; i < batchMsg->GetNumberOfTrackedFrames(); ++i)
+  {
+    if (batchMsg->GetTrackedFrame(i, trackedFrames[i]) != PLUS_SUCCESS)
+    {
+      trackedFrames.clear();
+      return PLUS_FAIL;
+    }
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusIgtlMessageCommon::PackDeltaImageMessage(igtl::PlusDeltaImageMessage::Pointer deltaImageMessage,
+    igsioTrackedFrame& trackedFrame,
+    vtkSmartPointer<vtkMatrix4x4> embeddedImageTransform,
+    PlusDeltaImageEncoder& encoder)
+{
+  if (deltaImageMessage.IsNull())
+  {
+    LOG_ERROR("Failed to pack delta image message - input delta image message is NULL");
+    return PLUS_FAIL;
+  }
+
+  if (encoder.EncodeFrame(*trackedFrame.GetImageData(), deltaImageMessage) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  PlusStatus status = deltaImageMessage->SetEmbeddedImageTransform(embeddedImageTransform);
+  if (status == PLUS_FAIL)
+  {
+    return status;
+  }
+
+  igtl::TimeStamp::Pointer timestamp = igtl::TimeStamp::New();
+  timestamp->SetTime(trackedFrame.GetTimestamp());
+  deltaImageMessage->SetTimeStamp(timestamp);
+
+  deltaImageMessage->Pack();
+
+  return status;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusIgtlMessageCommon::UnpackDeltaImageMessage(igtl::MessageHeader::Pointer headerMsg,
+    igtl::Socket* socket,
+    igsioTrackedFrame& trackedFrame,
+    const igsioTransformName& embeddedTransformName,
+    PlusDeltaImageDecoder& decoder,
+    bool& frameDecoded,
+    int crccheck)
+{
+  frameDecoded = false;
+  if (headerMsg.IsNull())
+  {
+    LOG_ERROR("Unable to unpack delta image message - header message is NULL!");
+    return PLUS_FAIL;
+  }
+
+  if (socket == NULL)
+  {
+    LOG_ERROR("Unable to unpack delta image message - socket is NULL!");
+    return PLUS_FAIL;
+  }
+
+  igtl::PlusDeltaImageMessage::Pointer deltaImageMsg = dynamic_cast<igtl::PlusDeltaImageMessage*>(headerMsg.GetPointer());
+  if (deltaImageMsg.IsNull())
+  {
+    deltaImageMsg = igtl::PlusDeltaImageMessage::New();
+  }
+  deltaImageMsg->SetMessageHeader(headerMsg);
+  deltaImageMsg->AllocateBuffer();
+
+  socket->Receive(deltaImageMsg->GetBufferBodyPointer(), deltaImageMsg->GetBufferBodySize());
+
+  int c = deltaImageMsg->Unpack(crccheck);
+  if (!(c & igtl::MessageHeader::UNPACK_BODY))
+  {
+    LOG_ERROR("Couldn't receive delta image message from server!");
+    return PLUS_FAIL;
+  }
+
+  if (decoder.DecodeFrame(deltaImageMsg, *trackedFrame.GetImageData(), frameDecoded) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  if (!frameDecoded)
+  {
+    return PLUS_SUCCESS;
+  }
+
+  igtl::TimeStamp::Pointer timestamp = igtl::TimeStamp::New();
+  deltaImageMsg->GetTimeStamp(timestamp);
+  trackedFrame.SetTimestamp(timestamp->GetTimeStamp());
+
+  if (embeddedTransformName.IsValid())
+  {
+    // Save the transform that is embedded in the DELTAIMAGE message into the tracked frame
+    trackedFrame.SetFrameTransform(embeddedTransformName, deltaImageMsg->GetEmbeddedImageTransform());
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusIgtlMessageCommon::PackSlabVolumeMessage(igtl::PlusSlabVolumeMessage::Pointer slabVolumeMessage,
+    igsioTrackedFrame& trackedFrame,
+    vtkSmartPointer<vtkMatrix4x4> embeddedImageTransform,
+    int slabThickness,
+    int compressionLevel,
+    bool byteShuffle/*=true*/)
+{
+  if (slabVolumeMessage.IsNull())
+  {
+    LOG_ERROR("Failed to pack slab volume message - input slab volume message is NULL");
+    return PLUS_FAIL;
+  }
+
+  if (slabVolumeMessage->SetFrame(*trackedFrame.GetImageData(), slabThickness, compressionLevel, byteShuffle) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  PlusStatus status = slabVolumeMessage->SetEmbeddedImageTransform(embeddedImageTransform);
+  if (status == PLUS_FAIL)
+  {
+    return status;
+  }
+
+  igtl::TimeStamp::Pointer timestamp = igtl::TimeStamp::New();
+  timestamp->SetTime(trackedFrame.GetTimestamp());
+  slabVolumeMessage->SetTimeStamp(timestamp);
+
+  slabVolumeMessage->Pack();
+
+  return status;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusIgtlMessageCommon::UnpackSlabVolumeMessage(igtl::MessageHeader::Pointer headerMsg,
+    igtl::Socket* socket,
+    igsioTrackedFrame& trackedFrame,
+    const igsioTransformName& embeddedTransformName,
+    int crccheck)
+{
+  if (headerMsg.IsNull())
+  {
+    LOG_ERROR("Unable to unpack slab volume message - header message is NULL!");
+    return PLUS_FAIL;
+  }
+
+  if (socket == NULL)
+  {
+    LOG_ERROR("Unable to unpack slab volume message - socket is NULL!");
+    return PLUS_FAIL;
+  }
+
+  igtl::PlusSlabVolumeMessage::Pointer slabVolumeMsg = dynamic_cast<igtl::PlusSlabVolumeMessage*>(headerMsg.GetPointer());
+  if (slabVolumeMsg.IsNull())
+  {
+    slabVolumeMsg = igtl::PlusSlabVolumeMessage::New();
+  }
+  slabVolumeMsg->SetMessageHeader(headerMsg);
+  slabVolumeMsg->AllocateBuffer();
+
+  socket->Receive(slabVolumeMsg->GetBufferBodyPointer(), slabVolumeMsg->GetBufferBodySize());
+
+  int c = slabVolumeMsg->Unpack(crccheck);
+  if (!(c & igtl::MessageHeader::UNPACK_BODY))
+  {
+    LOG_ERROR("Couldn't receive slab volume message from server!");
+    return PLUS_FAIL;
+  }
+
+  if (slabVolumeMsg->GetFrame(*trackedFrame.GetImageData()) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+
+  igtl::TimeStamp::Pointer timestamp = igtl::TimeStamp::New();
+  slabVolumeMsg->GetTimeStamp(timestamp);
+  trackedFrame.SetTimestamp(timestamp->GetTimeStamp());
+
+  if (embeddedTransformName.IsValid())
+  {
+    // Save the transform that is embedded in the SLABVOLUME message into the tracked frame
+    trackedFrame.SetFrameTransform(embeddedTransformName, slabVolumeMsg->GetEmbeddedImageTransform());
+  }
+
+  return PLUS_SUCCESS;
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusIgtlMessageCommon::PackUsMessage(igtl::PlusUsMessage::Pointer usMessage, igsioTrackedFrame& trackedFrame)
 {
@@ -217,7 +447,9 @@ PlusStatus vtkPlusIgtlMessageCommon::UnpackUsMessage(igtl::MessageHeader::Pointe
 PlusStatus vtkPlusIgtlMessageCommon::PackImageMessage(igtl::ImageMessage::Pointer imageMessage,
     igsioTrackedFrame& trackedFrame,
     const vtkMatrix4x4& matrix,
-    vtkIGSIOFrameConverter* frameConverter/*=NULL*/)
+    vtkIGSIOFrameConverter* frameConverter/*=NULL*/,
+    const std::array<int, 4>& cropRectangle/*=std::array<int, 4>()*/,
+    double scale/*=1.0*/)
 {
   if (imageMessage.IsNull())
   {
@@ -259,7 +491,39 @@ PlusStatus vtkPlusIgtlMessageCommon::PackImageMessage(igtl::ImageMessage::Pointe
   frameImage->GetDimensions(imageSizePixels);
   frameImage->GetSpacing(imageSpacingMm);
   frameImage->GetOrigin(imageOriginMm);
-  frameImage->GetDimensions(subSizePixels);
+
+  // Region of the frame that is sent, shrunk to outputSizePixels
+  const FrameSizeType frameSizePixels = { static_cast<unsigned int>(imageSizePixels[0]), static_cast<unsigned int>(imageSizePixels[1]), static_cast<unsigned int>(imageSizePixels[2]) };
+  std::array<int, 2> cropOriginPixels = { 0, 0 };
+  std::array<int, 2> cropSizePixels = { imageSizePixels[0], imageSizePixels[1] };
+  if (cropRectangle[2] > 0 && cropRectangle[3] > 0)
+  {
+    for (int axis = 0; axis < 2; ++axis)
+    {
+      cropOriginPixels[axis] = std::min(std::max(cropRectangle[axis], 0), imageSizePixels[axis]);
+      cropSizePixels[axis] = std::min(cropRectangle[axis] + cropRectangle[axis + 2], imageSizePixels[axis]) - cropOriginPixels[axis];
+    }
+    if (cropSizePixels[0] <= 0 || cropSizePixels[1] <= 0)
+    {
+      LOG_ERROR("Failed to pack image message - crop rectangle (" << cropRectangle[0] << ", " << cropRectangle[1] << ", " << cropRectangle[2] << ", " << cropRectangle[3]
+                << ") is outside of the " << imageSizePixels[0] << "x" << imageSizePixels[1] << " image");
+      return PLUS_FAIL;
+    }
+  }
+  const std::array<int, 2> outputSizePixels = PlusAreaAverageResize::GetOutputSize(cropSizePixels, scale);
+  const bool resizeImage = (outputSizePixels[0] != imageSizePixels[0] || outputSizePixels[1] != imageSizePixels[1]);
+  if (resizeImage)
+  {
+    for (int axis = 0; axis < 2; ++axis)
+    {
+      // The first output pixel is centered on the middle of the input pixels that it averages
+      const double step = static_cast<double>(cropSizePixels[axis]) / outputSizePixels[axis];
+      imageOriginMm[axis] += (cropOriginPixels[axis] + (step - 1.0) / 2.0) * imageSpacingMm[axis];
+      imageSpacingMm[axis] *= step;
+      imageSizePixels[axis] = outputSizePixels[axis];
+    }
+  }
+  std::copy(imageSizePixels, imageSizePixels + 3, subSizePixels);
 
   float spacingFloat[3] = { 0 };
   for (int i = 0; i < 3; ++ i)
@@ -278,7 +542,19 @@ PlusStatus vtkPlusIgtlMessageCommon::PackImageMessage(igtl::ImageMessage::Pointe
   unsigned char* igtlImagePointer = (unsigned char*)(imageMessage->GetScalarPointer());
   unsigned char* vtkImagePointer = (unsigned char*)(frameImage->GetScalarPointer());
 
-  memcpy(igtlImagePointer, vtkImagePointer, imageMessage->GetImageSize());
+  if (resizeImage)
+  {
+    if (PlusAreaAverageResize::Resize(vtkImagePointer, frameSizePixels, frameImage->GetScalarType(), numScalarComponents,
+                                      cropOriginPixels, cropSizePixels, outputSizePixels, igtlImagePointer) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to pack image message - unable to crop and resize the image");
+      return PLUS_FAIL;
+    }
+  }
+  else
+  {
+    memcpy(igtlImagePointer, vtkImagePointer, imageMessage->GetImageSize());
+  }
 
   // Convert VTK transform to IGTL transform.
   if (igtlioImageConverter::VTKTransformToIGTLImage(matrix, imageSizePixels, imageSpacingMm, imageOriginMm, imageMessage) != 1)
@@ -391,6 +667,105 @@ PlusStatus vtkPlusIgtlMessageCommon::UnpackImageMessage(igtl::MessageHeader::Poi
   }
 
   // if CRC check is OK. Read data.
+  return GetTrackedFrameFromImageMessage(imgMsg, trackedFrame, embeddedTransformName);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusIgtlMessageCommon::UnpackSharedMemoryFrameMessage(igtl::MessageHeader::Pointer headerMsg,
+    igtl::Socket* socket,
+    PlusSharedMemoryFrameRing& ring,
+    igsioTrackedFrame& trackedFrame,
+    const igsioTransformName& embeddedTransformName,
+    bool& frameRead,
+    int crccheck)
+{
+  frameRead = false;
+  if (headerMsg.IsNull())
+  {
+    LOG_ERROR("Unable to unpack shared memory frame message - header message is NULL!");
+    return PLUS_FAIL;
+  }
+
+  if (socket == NULL)
+  {
+    LOG_ERROR("Unable to unpack shared memory frame message - socket is NULL!");
+    return PLUS_FAIL;
+  }
+
+  igtl::PlusSharedMemoryFrameMessage::Pointer frameMsg = dynamic_cast<igtl::PlusSharedMemoryFrameMessage*>(headerMsg.GetPointer());
+  if (frameMsg.IsNull())
+  {
+    frameMsg = igtl::PlusSharedMemoryFrameMessage::New();
+  }
+  frameMsg->SetMessageHeader(headerMsg);
+  frameMsg->AllocateBuffer();
+
+  socket->Receive(frameMsg->GetBufferBodyPointer(), frameMsg->GetBufferBodySize());
+
+  int c = frameMsg->Unpack(crccheck);
+  if (!(c & igtl::MessageHeader::UNPACK_BODY))
+  {
+    LOG_ERROR("Couldn't receive shared memory frame message from server!");
+    return PLUS_FAIL;
+  }
+
+  if (!ring.IsOpen() || ring.GetName() != frameMsg->GetRingName())
+  {
+    if (ring.Open(frameMsg->GetRingName()) != PLUS_SUCCESS)
+    {
+      return PLUS_FAIL;
+    }
+  }
+
+  // The packed message in the ring starts with the standard OpenIGTLink header
+  igtl::MessageHeader::Pointer imageHeaderMsg = igtl::MessageHeader::New();
+  imageHeaderMsg->InitBuffer();
+  if (frameMsg->GetMessageSizeInBytes() < IGTL_HEADER_SIZE
+      || ring.Read(frameMsg->GetSequenceNumber(), 0, imageHeaderMsg->GetBufferPointer(), IGTL_HEADER_SIZE) != PLUS_SUCCESS)
+  {
+    LOG_DEBUG("Shared memory frame " << frameMsg->GetSequenceNumber() << " has been overwritten before it could be read");
+    return PLUS_SUCCESS;
+  }
+  if (!(imageHeaderMsg->Unpack() & igtl::MessageHeader::UNPACK_HEADER) || std::string(imageHeaderMsg->GetMessageType()) != "IMAGE")
+  {
+    LOG_ERROR("Unable to unpack shared memory frame message - the ring does not contain an IMAGE message");
+    return PLUS_FAIL;
+  }
+
+  // Message body handler for IMAGE
+  igtl::ImageMessage::Pointer imgMsg = igtl::ImageMessage::New();
+  imgMsg->SetMessageHeader(imageHeaderMsg);
+  imgMsg->AllocateBuffer();
+  if (IGTL_HEADER_SIZE + imgMsg->GetBufferBodySize() != frameMsg->GetMessageSizeInBytes())
+  {
+    LOG_ERROR("Unable to unpack shared memory frame message - message size does not match the IMAGE message size");
+    return PLUS_FAIL;
+  }
+  if (ring.Read(frameMsg->GetSequenceNumber(), IGTL_HEADER_SIZE, imgMsg->GetBufferBodyPointer(), imgMsg->GetBufferBodySize()) != PLUS_SUCCESS)
+  {
+    LOG_DEBUG("Shared memory frame " << frameMsg->GetSequenceNumber() << " has been overwritten before it could be read");
+    return PLUS_SUCCESS;
+  }
+
+  // The message is copied in memory, so CRC check is not needed
+  c = imgMsg->Unpack(0);
+  if (!(c & igtl::MessageHeader::UNPACK_BODY))
+  {
+    LOG_ERROR("Couldn't unpack image message from shared memory!");
+    return PLUS_FAIL;
+  }
+
+  if (GetTrackedFrameFromImageMessage(imgMsg, trackedFrame, embeddedTransformName) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  frameRead = true;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusIgtlMessageCommon::GetTrackedFrameFromImageMessage(igtl::ImageMessage::Pointer imgMsg, igsioTrackedFrame& trackedFrame, const igsioTransformName& embeddedTransformName)
+{
   igtl::TimeStamp::Pointer igtlTimestamp = igtl::TimeStamp::New();
   imgMsg->GetTimeStamp(igtlTimestamp);
 
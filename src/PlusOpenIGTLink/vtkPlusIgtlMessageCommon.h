@@ -10,6 +10,8 @@ See License.txt for details.
 // Local includes
 #include "PlusConfigure.h"
 #include "vtkPlusOpenIGTLinkExport.h"
+#include "PlusDeltaImageCodec.h"
+#include "PlusSharedMemoryFrameRing.h"
 
 // VTK includes
 #include <vtkObject.h>
@@ -18,6 +20,10 @@ See License.txt for details.
 #include <igtlImageMessage.h>
 #include <igtlImageMetaMessage.h>
 #include <igtlMessageBase.h>
+#include <igtlPlusDeltaImageMessage.h>
+#include <igtlPlusSlabVolumeMessage.h>
+#include <igtlPlusSharedMemoryFrameMessage.h>
+#include <igtlPlusTrackedFrameBatchMessage.h>
 #include <igtlPlusTrackedFrameMessage.h>
 #include <igtlPlusUsMessage.h>
 #include <igtlPolyDataMessage.h>
@@ -31,6 +37,9 @@ See License.txt for details.
   #include <igtlVideoMessage.h>
 #endif
 
+// STL includes
+#include <array>
+
 class vtkXMLDataElement;
 //class igsioTrackedFrame;
 class vtkPolyData;
@@ -58,14 +67,38 @@ public:
   /*! Unpack tracked frame message to tracked frame */
   static PlusStatus UnpackTrackedFrameMessage(igtl::MessageHeader::Pointer headerMsg, igtl::Socket* socket, igsioTrackedFrame& trackedFrame, const igsioTransformName& embeddedTransformName, int crccheck);
 
+  /*! Unpack tracked frame batch message to tracked frames. The transforms of the frames are stored in the frame fields. */
+  static PlusStatus UnpackTrackedFrameBatchMessage(igtl::MessageHeader::Pointer headerMsg, igtl::Socket* socket, std::vector<igsioTrackedFrame>& trackedFrames, int crccheck);
+
+  /*! Pack delta image message from tracked frame. The encoder keeps the reference frame of the stream. */
+  static PlusStatus PackDeltaImageMessage(igtl::PlusDeltaImageMessage::Pointer deltaImageMessage, igsioTrackedFrame& trackedFrame, vtkSmartPointer<vtkMatrix4x4> embeddedImageTransform, PlusDeltaImageEncoder& encoder);
+
+  /*!
+    Unpack delta image message to tracked frame. The decoder keeps the reference frame of the stream.
+    \param frameDecoded Set to false if the frame cannot be decoded yet (the reference frame was not received), in this case trackedFrame is not set
+  */
+  static PlusStatus UnpackDeltaImageMessage(igtl::MessageHeader::Pointer headerMsg, igtl::Socket* socket, igsioTrackedFrame& trackedFrame, const igsioTransformName& embeddedTransformName, PlusDeltaImageDecoder& decoder, bool& frameDecoded, int crccheck);
+
+  /*! Pack slab volume message from tracked frame, the slabs are compressed concurrently */
+  static PlusStatus PackSlabVolumeMessage(igtl::PlusSlabVolumeMessage::Pointer slabVolumeMessage, igsioTrackedFrame& trackedFrame, vtkSmartPointer<vtkMatrix4x4> embeddedImageTransform, int slabThickness, int compressionLevel, bool byteShuffle = true);
+
+  /*! Unpack slab volume message to tracked frame, the slabs are decompressed concurrently */
+  static PlusStatus UnpackSlabVolumeMessage(igtl::MessageHeader::Pointer headerMsg, igtl::Socket* socket, igsioTrackedFrame& trackedFrame, const igsioTransformName& embeddedTransformName, int crccheck);
+
   /*! Pack US message from tracked frame */
   static PlusStatus PackUsMessage(igtl::PlusUsMessage::Pointer usMessage, igsioTrackedFrame& trackedFrame);
 
   /*! Unpack US message to tracked frame */
   static PlusStatus UnpackUsMessage(igtl::MessageHeader::Pointer headerMsg, igtl::Socket* socket, igsioTrackedFrame& trackedFrame, int crccheck);
 
-  /*! Pack image message from tracked frame */
-  static PlusStatus PackImageMessage(igtl::ImageMessage::Pointer imageMessage, igsioTrackedFrame& trackedFrame, const vtkMatrix4x4& imageToReferenceTransform, vtkIGSIOFrameConverter* frameConverter = NULL);
+  /*!
+    Pack image message from tracked frame.
+    If cropRectangle (x, y, width, height in pixels) has a nonzero size then only this region of the frame is sent.
+    If scale is less than 1 then the (cropped) image is shrunk by area averaging. The spacing and origin of the message
+    are adjusted, so that the sent image is at the same position as the original frame.
+  */
+  static PlusStatus PackImageMessage(igtl::ImageMessage::Pointer imageMessage, igsioTrackedFrame& trackedFrame, const vtkMatrix4x4& imageToReferenceTransform, vtkIGSIOFrameConverter* frameConverter = NULL,
+                                     const std::array<int, 4>& cropRectangle = std::array<int, 4>(), double scale = 1.0);
 
   /*! Pack image message from vtkImageData volume */
   static PlusStatus PackImageMessage(igtl::ImageMessage::Pointer imageMessage, vtkImageData* image, const vtkMatrix4x4& imageToReferenceTransform, double timestamp);
@@ -73,6 +106,13 @@ public:
   /*! Unpack image message to tracked frame */
   static PlusStatus UnpackImageMessage(igtl::MessageHeader::Pointer headerMsg, igtl::Socket* socket, igsioTrackedFrame& trackedFrame, const igsioTransformName& embeddedTransformName, int crccheck);
 
+  /*!
+    Unpack the IMAGE message referred to by a SHMFRAME message to tracked frame.
+    The ring is opened (or reopened) if the message refers to a different ring than the one that is open.
+    \param frameRead Set to false if the message in the ring has already been overwritten by newer messages
+  */
+  static PlusStatus UnpackSharedMemoryFrameMessage(igtl::MessageHeader::Pointer headerMsg, igtl::Socket* socket, PlusSharedMemoryFrameRing& ring, igsioTrackedFrame& trackedFrame, const igsioTransformName& embeddedTransformName, bool& frameRead, int crccheck);
+
   /*! Pack image meta deta message from vtkPlusServer::ImageMetaDataList  */
   static PlusStatus PackImageMetaMessage(igtl::ImageMetaMessage::Pointer imageMetaMessage, igsioCommon::ImageMetaDataList& imageMetaDataList);
 
@@ -119,6 +159,9 @@ protected:
   vtkPlusIgtlMessageCommon();
   virtual ~vtkPlusIgtlMessageCommon();
 
+  /*! Copy the image, timestamp and embedded transform of an unpacked image message to tracked frame */
+  static PlusStatus GetTrackedFrameFromImageMessage(igtl::ImageMessage::Pointer imgMsg, igsioTrackedFrame& trackedFrame, const igsioTransformName& embeddedTransformName);
+
 private:
   vtkPlusIgtlMessageCommon(const vtkPlusIgtlMessageCommon&);
   void operator=(const vtkPlusIgtlMessageCommon&);
@@ -5,6 +5,7 @@ See License.txt for details.
 =========================================================Plus=header=end*/
 
 #include "PlusConfigure.h"
+#include "PlusProfiler.h"
 
 #include "igsioTrackedFrame.h"
 #include "igsioVideoFrame.h"
@@ -14,16 +15,26 @@ See License.txt for details.
 #include "vtkObjectFactory.h"
 #include "vtkPlusIgtlMessageCommon.h"
 #include "vtkPlusIgtlMessageFactory.h"
+#include "vtkIGSIOAccurateTimer.h"
 #include "vtkIGSIOTrackedFrameList.h"
 #include "vtkIGSIOTransformRepository.h"
 #include "vtksys/SystemTools.hxx"
+#include <algorithm>
+#include <sstream>
 #include <typeinfo>
 
+// OpenIGTLinkIO includes
+#include <igtlioTransformConverter.h>
+
 //----------------------------------------------------------------------------
 // IGT message types
 #include "igtlCommandMessage.h"
 #include "igtlImageMessage.h"
 #include "igtlPlusClientInfoMessage.h"
+#include "igtlPlusDeltaImageMessage.h"
+#include "igtlPlusSharedMemoryFrameMessage.h"
+#include "igtlPlusSlabVolumeMessage.h"
+#include "igtlPlusTrackedFrameBatchMessage.h"
 #include "igtlPlusTrackedFrameMessage.h"
 #include "igtlPlusUsMessage.h"
 #include "igtlPositionMessage.h"
@@ -43,6 +54,12 @@ See License.txt for details.
   #endif
 #endif
 
+namespace
+{
+  /*! Maximum number of pooled messages of a stream, more are needed only if the messages of several frames are waiting to be sent */
+  const unsigned int MAX_NUMBER_OF_POOLED_MESSAGES_PER_STREAM = 4;
+}
+
 //----------------------------------------------------------------------------
 
 vtkStandardNewMacro(vtkPlusIgtlMessageFactory);
@@ -50,10 +67,19 @@ vtkStandardNewMacro(vtkPlusIgtlMessageFactory);
 //----------------------------------------------------------------------------
 vtkPlusIgtlMessageFactory::vtkPlusIgtlMessageFactory()
   : IgtlFactory(igtl::MessageFactory::New())
+  , MessageCacheEnabled(false)
+  , FrameTransformsSetFrame(NULL)
+  , FrameTransformsSetRepository(NULL)
+  , MessagePoolEnabled(false)
+  , LastVideoEncodingTimeSec(0.0)
 {
   this->IgtlFactory->AddMessageType("CLIENTINFO", (PointerToMessageBaseNew)&igtl::PlusClientInfoMessage::New);
   this->IgtlFactory->AddMessageType("TRACKEDFRAME", (PointerToMessageBaseNew)&igtl::PlusTrackedFrameMessage::New);
   this->IgtlFactory->AddMessageType("USMESSAGE", (PointerToMessageBaseNew)&igtl::PlusUsMessage::New);
+  this->IgtlFactory->AddMessageType("DELTAIMAGE", (PointerToMessageBaseNew)&igtl::PlusDeltaImageMessage::New);
+  this->IgtlFactory->AddMessageType("SHMFRAME", (PointerToMessageBaseNew)&igtl::PlusSharedMemoryFrameMessage::New);
+  this->IgtlFactory->AddMessageType("TRACKEDBATCH", (PointerToMessageBaseNew)&igtl::PlusTrackedFrameBatchMessage::New);
+  this->IgtlFactory->AddMessageType("SLABVOLUME", (PointerToMessageBaseNew)&igtl::PlusSlabVolumeMessage::New);
 }
 
 //----------------------------------------------------------------------------
@@ -138,21 +164,196 @@ igtl::MessageBase::Pointer vtkPlusIgtlMessageFactory::CreateSendMessage(const st
   return aMessageBase;
 }
 
+//----------------------------------------------------------------------------
+bool vtkPlusIgtlMessageFactory::MessageCacheKey::operator<(const MessageCacheKey& other) const
+{
+  if (this->HeaderVersion != other.HeaderVersion)
+  {
+    return this->HeaderVersion < other.HeaderVersion;
+  }
+  if (this->MessageType != other.MessageType)
+  {
+    return this->MessageType < other.MessageType;
+  }
+  if (this->DeviceName != other.DeviceName)
+  {
+    return this->DeviceName < other.DeviceName;
+  }
+  return this->Name < other.Name;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusIgtlMessageFactory::ClearMessageCache()
+{
+  this->MessageCache.clear();
+  this->FrameTransformsSetFrame = NULL;
+  this->FrameTransformsSetRepository = NULL;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusIgtlMessageFactory::SetFrameTransforms(igsioTrackedFrame& trackedFrame, vtkIGSIOTransformRepository* transformRepository)
+{
+  if (transformRepository == NULL)
+  {
+    return PLUS_SUCCESS;
+  }
+  if (this->MessageCacheEnabled && this->FrameTransformsSetFrame == &trackedFrame && this->FrameTransformsSetRepository == transformRepository)
+  {
+    // Already set for this frame
+    return PLUS_SUCCESS;
+  }
+  if (transformRepository->SetTransforms(trackedFrame) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to set current transforms to transform repository");
+    this->FrameTransformsSetFrame = NULL;
+    this->FrameTransformsSetRepository = NULL;
+    return PLUS_FAIL;
+  }
+  this->FrameTransformsSetFrame = &trackedFrame;
+  this->FrameTransformsSetRepository = transformRepository;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusIgtlMessageFactory::ClearMessagePool()
+{
+  this->MessagePool.clear();
+}
+
+//----------------------------------------------------------------------------
+igtl::MessageBase::Pointer vtkPlusIgtlMessageFactory::GetPooledMessage(const MessageCacheKey& key, igtl::MessageBase::Pointer prototype)
+{
+  if (!this->MessagePoolEnabled)
+  {
+    return prototype->Clone();
+  }
+
+  std::vector<igtl::MessageBase::Pointer>& pooledMessages = this->MessagePool[key];
+  for (std::vector<igtl::MessageBase::Pointer>::iterator it = pooledMessages.begin(); it != pooledMessages.end(); ++it)
+  {
+    if ((*it)->GetReferenceCount() == 1)
+    {
+      // Only the pool refers to the message, it has been sent to all clients
+      return *it;
+    }
+  }
+
+  igtl::MessageBase::Pointer message = prototype->Clone();
+  if (pooledMessages.size() < MAX_NUMBER_OF_POOLED_MESSAGES_PER_STREAM)
+  {
+    pooledMessages.push_back(message);
+  }
+  return message;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusIgtlMessageFactory::RemoveSubscriber(int clientId)
+{
+  this->PendingTrackedFrameBatches.erase(clientId);
+
+  for (std::map<std::string, SharedDeltaImageEncoder>::iterator encoderIt = this->SharedDeltaImageEncoders.begin(); encoderIt != this->SharedDeltaImageEncoders.end();)
+  {
+    encoderIt->second.Subscribers.erase(clientId);
+    encoderIt->second.SubscribersWaitingForKeyFrame.erase(clientId);
+    if (encoderIt->second.Subscribers.empty())
+    {
+      this->SharedDeltaImageEncoders.erase(encoderIt++);
+    }
+    else
+    {
+      ++encoderIt;
+    }
+  }
+
+  for (std::map<std::string, SharedVideoEncoder>::iterator encoderIt = this->SharedVideoEncoders.begin(); encoderIt != this->SharedVideoEncoders.end();)
+  {
+    encoderIt->second.Subscribers.erase(clientId);
+    encoderIt->second.SubscribersWaitingForKeyFrame.erase(clientId);
+    if (encoderIt->second.Subscribers.empty())
+    {
+      this->SharedVideoEncoders.erase(encoderIt++);
+    }
+    else
+    {
+      ++encoderIt;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+std::string vtkPlusIgtlMessageFactory::GetVideoEncoderKey(const PlusIgtlClientInfo::VideoStream& videoStream)
+{
+  const PlusIgtlClientInfo::EncodingParameters& parameters = videoStream.EncodeVideoParameters;
+  std::ostringstream key;
+  key << videoStream.Name << "To" << videoStream.EmbeddedTransformToFrame
+      << "|" << parameters.FourCC << "|" << parameters.Lossless
+      << "|" << parameters.MinKeyframeDistance << "|" << parameters.MaxKeyframeDistance
+      << "|" << parameters.Speed << "|" << parameters.RateControl
+      << "|" << parameters.DeadlineMode << "|" << parameters.TargetBitrate << "|" << parameters.LowLatency
+      << "|" << parameters.MaxRateHz;
+  // MaxSendBacklog is applied per client, it does not affect the encoder
+  return key.str();
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusIgtlMessageFactory::GetCachedMessage(const MessageCacheKey& key, igtl::MessageBase::Pointer& igtlMessage) const
+{
+  if (!this->MessageCacheEnabled)
+  {
+    return false;
+  }
+  std::map<MessageCacheKey, igtl::MessageBase::Pointer>::const_iterator it = this->MessageCache.find(key);
+  if (it == this->MessageCache.end())
+  {
+    return false;
+  }
+  igtlMessage = it->second;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusIgtlMessageFactory::AddCachedMessage(const MessageCacheKey& key, igtl::MessageBase::Pointer igtlMessage)
+{
+  if (!this->MessageCacheEnabled)
+  {
+    return;
+  }
+  this->MessageCache[key] = igtlMessage;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusIgtlMessageFactory::IsTrackingMessageType(const std::string& messageType)
+{
+  return messageType == "TRANSFORM" || messageType == "POSITION" || messageType == "TDATA";
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusIgtlMessageFactory::PackMessages(int clientId, const PlusIgtlClientInfo& clientInfo, std::vector<igtl::MessageBase::Pointer>& igtlMessages, igsioTrackedFrame& trackedFrame,
-    bool packValidTransformsOnly, vtkIGSIOTransformRepository* transformRepository/*=NULL*/)
+    bool packValidTransformsOnly, vtkIGSIOTransformRepository* transformRepository/*=NULL*/, int sendBacklog/*=0*/,
+    MessageSelection messageSelection/*=ALL_MESSAGES*/)
 {
+  PLUS_PROFILE_ZONE("vtkPlusIgtlMessageFactory::PackMessages");
   int numberOfErrors(0);
   igtlMessages.clear();
+  this->LastVideoEncodingTimeSec = 0.0;
 
-  if (transformRepository != NULL)
-  {
-    transformRepository->SetTransforms(trackedFrame);
-  }
+  this->SetFrameTransforms(trackedFrame, transformRepository);
 
   for (std::vector<std::string>::const_iterator messageTypeIterator = clientInfo.IgtlMessageTypes.begin(); messageTypeIterator != clientInfo.IgtlMessageTypes.end(); ++ messageTypeIterator)
   {
     std::string messageType = (*messageTypeIterator);
+    if ((messageSelection == TRACKING_MESSAGES && !IsTrackingMessageType(messageType))
+        || (messageSelection == NON_TRACKING_MESSAGES && IsTrackingMessageType(messageType)))
+    {
+      continue;
+    }
+
+    // Message types with a limited rate are not sent with every frame
+    if (!clientInfo.IsMessageDue(messageType, clientInfo.GetMessageTypeMaxRateHz(messageType), trackedFrame.GetTimestamp()))
+    {
+      continue;
+    }
+
     igtl::MessageBase::Pointer igtlMessage;
     try
     {
@@ -178,7 +379,7 @@ PlusStatus vtkPlusIgtlMessageFactory::PackMessages(int clientId, const PlusIgtlC
 #if defined(OpenIGTLink_ENABLE_VIDEOSTREAMING)
     else if (typeid(*igtlMessage) == typeid(igtl::VideoMessage))
     {
-      numberOfErrors += PackVideoMessage(clientInfo, *transformRepository, messageType, igtlMessage, trackedFrame, igtlMessages, clientId);
+      numberOfErrors += PackVideoMessage(clientInfo, *transformRepository, messageType, igtlMessage, trackedFrame, igtlMessages, clientId, sendBacklog);
     }
 #endif
     else if (typeid(*igtlMessage) == typeid(igtl::TransformMessage))
@@ -197,9 +398,21 @@ PlusStatus vtkPlusIgtlMessageFactory::PackMessages(int clientId, const PlusIgtlC
     {
       numberOfErrors += PackTrackedFrameMessage(igtlMessage, clientInfo, *transformRepository, trackedFrame, igtlMessages);
     }
+    else if (typeid(*igtlMessage) == typeid(igtl::PlusTrackedFrameBatchMessage))
+    {
+      numberOfErrors += PackTrackedFrameBatchMessage(clientId, igtlMessage, clientInfo, *transformRepository, trackedFrame, igtlMessages);
+    }
+    else if (typeid(*igtlMessage) == typeid(igtl::PlusDeltaImageMessage))
+    {
+      numberOfErrors += PackDeltaImageMessage(clientInfo, *transformRepository, messageType, igtlMessage, trackedFrame, igtlMessages, clientId);
+    }
+    else if (typeid(*igtlMessage) == typeid(igtl::PlusSlabVolumeMessage))
+    {
+      numberOfErrors += PackSlabVolumeMessage(clientInfo, *transformRepository, messageType, igtlMessage, trackedFrame, igtlMessages);
+    }
     else if (typeid(*igtlMessage) == typeid(igtl::PlusUsMessage))
     {
-      numberOfErrors += PackUsMessage(igtlMessage, trackedFrame, igtlMessages);
+      numberOfErrors += PackUsMessage(clientInfo, igtlMessage, trackedFrame, igtlMessages);
     }
     else if (typeid(*igtlMessage) == typeid(igtl::StringMessage))
     {
@@ -248,10 +461,11 @@ int vtkPlusIgtlMessageFactory::PackStringMessage(const PlusIgtlClientInfo& clien
 }
 
 //----------------------------------------------------------------------------
-int vtkPlusIgtlMessageFactory::PackUsMessage(igtl::MessageBase::Pointer igtlMessage, igsioTrackedFrame& trackedFrame, std::vector<igtl::MessageBase::Pointer>& igtlMessages)
+int vtkPlusIgtlMessageFactory::PackUsMessage(const PlusIgtlClientInfo& clientInfo, igtl::MessageBase::Pointer igtlMessage, igsioTrackedFrame& trackedFrame, std::vector<igtl::MessageBase::Pointer>& igtlMessages)
 {
   int numberOfErrors(0);
-  igtl::PlusUsMessage::Pointer usMessage = dynamic_cast<igtl::PlusUsMessage*>(igtlMessage->Clone().GetPointer());
+  igtl::PlusUsMessage::Pointer usMessage = dynamic_cast<igtl::PlusUsMessage*>(
+        this->GetPooledMessage(MessageCacheKey("USMESSAGE", "", clientInfo.GetClientHeaderVersion(), ""), igtlMessage).GetPointer());
   if (vtkPlusIgtlMessageCommon::PackUsMessage(usMessage, trackedFrame) != PLUS_SUCCESS)
   {
     LOG_ERROR("Failed to pack IGT messages - unable to pack US message");
@@ -266,7 +480,9 @@ int vtkPlusIgtlMessageFactory::PackUsMessage(igtl::MessageBase::Pointer igtlMess
 int vtkPlusIgtlMessageFactory::PackTrackedFrameMessage(igtl::MessageBase::Pointer igtlMessage, const PlusIgtlClientInfo& clientInfo, vtkIGSIOTransformRepository& transformRepository, igsioTrackedFrame& trackedFrame, std::vector<igtl::MessageBase::Pointer>& igtlMessages)
 {
   int numberOfErrors(0);
-  igtl::PlusTrackedFrameMessage::Pointer trackedFrameMessage = dynamic_cast<igtl::PlusTrackedFrameMessage*>(igtlMessage->Clone().GetPointer());
+  std::string imageStreamName = (clientInfo.ImageStreams.empty() ? "" : clientInfo.ImageStreams[0].Name);
+  igtl::PlusTrackedFrameMessage::Pointer trackedFrameMessage = dynamic_cast<igtl::PlusTrackedFrameMessage*>(
+        this->GetPooledMessage(MessageCacheKey("TRACKEDFRAME", "", clientInfo.GetClientHeaderVersion(), imageStreamName), igtlMessage).GetPointer());
 
   for (auto nameIter = clientInfo.TransformNames.begin(); nameIter != clientInfo.TransformNames.end(); ++nameIter)
   {
@@ -289,6 +505,7 @@ int vtkPlusIgtlMessageFactory::PackTrackedFrameMessage(igtl::MessageBase::Pointe
       return numberOfErrors;
     }
   }
+  trackedFrameMessage->SetBinaryFieldEncoding(clientInfo.BinaryTrackedFrameFieldsRequested);
   if (vtkPlusIgtlMessageCommon::PackTrackedFrameMessage(trackedFrameMessage, trackedFrame, imageMatrix, clientInfo.TransformNames) != PLUS_SUCCESS)
   {
     LOG_ERROR("Failed to pack IGT messages - unable to pack tracked frame message");
@@ -299,6 +516,73 @@ int vtkPlusIgtlMessageFactory::PackTrackedFrameMessage(igtl::MessageBase::Pointe
   return numberOfErrors;
 }
 
+//----------------------------------------------------------------------------
+int vtkPlusIgtlMessageFactory::PackTrackedFrameBatchMessage(int clientId, igtl::MessageBase::Pointer igtlMessage, const PlusIgtlClientInfo& clientInfo, vtkIGSIOTransformRepository& transformRepository, igsioTrackedFrame& trackedFrame, std::vector<igtl::MessageBase::Pointer>& igtlMessages)
+{
+  // The requested transforms and the image transform are sent in the frame fields
+  std::vector<igsioTransformName> requestedTransforms = clientInfo.TransformNames;
+  for (auto nameIter = clientInfo.TransformNames.begin(); nameIter != clientInfo.TransformNames.end(); ++nameIter)
+  {
+    ToolStatus status(TOOL_INVALID);
+    vtkSmartPointer<vtkMatrix4x4> matrix(vtkSmartPointer<vtkMatrix4x4>::New());
+    transformRepository.GetTransform(*nameIter, matrix, &status);
+    trackedFrame.SetFrameTransform(*nameIter, matrix);
+    trackedFrame.SetFrameTransformStatus(*nameIter, status);
+  }
+  vtkSmartPointer<vtkMatrix4x4> imageMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  imageMatrix->Identity();
+  if (!clientInfo.ImageStreams.empty())
+  {
+    igsioTransformName imageTransformName(clientInfo.ImageStreams[0].Name, clientInfo.ImageStreams[0].EmbeddedTransformToFrame);
+    ToolStatus status(TOOL_INVALID);
+    if (transformRepository.GetTransform(imageTransformName, imageMatrix, &status) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Unable to retrieve embedded image transform: " << imageTransformName.GetTransformName() << ".");
+      return 1;
+    }
+    trackedFrame.SetFrameTransform(imageTransformName, imageMatrix);
+    trackedFrame.SetFrameTransformStatus(imageTransformName, status);
+    requestedTransforms.push_back(imageTransformName);
+  }
+
+  igtl::MessageBase::Pointer& pendingBatch = this->PendingTrackedFrameBatches[clientId];
+  if (pendingBatch.IsNull())
+  {
+    pendingBatch = igtlMessage->Clone();
+  }
+  igtl::PlusTrackedFrameBatchMessage::Pointer batchMessage = dynamic_cast<igtl::PlusTrackedFrameBatchMessage*>(pendingBatch.GetPointer());
+
+  if (batchMessage->AddTrackedFrame(trackedFrame, requestedTransforms) != PLUS_SUCCESS)
+  {
+    if (batchMessage->GetNumberOfTrackedFrames() == 0)
+    {
+      LOG_ERROR("Failed to pack IGT messages - unable to add frame to tracked frame batch message");
+      return 1;
+    }
+    // The image size or type changed, send the collected frames and start a new batch
+    batchMessage->Pack();
+    igtlMessages.push_back(batchMessage.GetPointer());
+    pendingBatch = igtlMessage->Clone();
+    batchMessage = dynamic_cast<igtl::PlusTrackedFrameBatchMessage*>(pendingBatch.GetPointer());
+    if (batchMessage->AddTrackedFrame(trackedFrame, requestedTransforms) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to pack IGT messages - unable to add frame to tracked frame batch message");
+      return 1;
+    }
+  }
+
+  if (batchMessage->GetNumberOfTrackedFrames() >= static_cast<unsigned int>(std::max(clientInfo.TrackedFrameBatchSize, 1))
+      || trackedFrame.GetTimestamp() - batchMessage->GetFirstFrameTimestamp() >= clientInfo.TrackedFrameBatchMaxDurationSec)
+  {
+    batchMessage->SetEmbeddedImageTransform(imageMatrix);
+    batchMessage->Pack();
+    igtlMessages.push_back(batchMessage.GetPointer());
+    this->PendingTrackedFrameBatches.erase(clientId);
+  }
+
+  return 0;
+}
+
 //----------------------------------------------------------------------------
 int vtkPlusIgtlMessageFactory::PackPositionMessage(const PlusIgtlClientInfo& clientInfo, vtkIGSIOTransformRepository& transformRepository, igtl::MessageBase::Pointer igtlMessage, igsioTrackedFrame& trackedFrame, std::vector<igtl::MessageBase::Pointer>& igtlMessages)
 {
@@ -311,6 +595,14 @@ int vtkPlusIgtlMessageFactory::PackPositionMessage(const PlusIgtlClientInfo& cli
       pushing high frame-rate data from tracking devices.
     */
     igsioTransformName transformName = (*transformNameIterator);
+    MessageCacheKey cacheKey("POSITION", transformName.GetTransformName(), clientInfo.GetClientHeaderVersion(), transformName.GetTransformName());
+    igtl::MessageBase::Pointer cachedMessage;
+    if (this->GetCachedMessage(cacheKey, cachedMessage))
+    {
+      igtlMessages.push_back(cachedMessage);
+      continue;
+    }
+
     igtl::Matrix4x4 igtlMatrix;
     vtkPlusIgtlMessageCommon::GetIgtlMatrix(igtlMatrix, &transformRepository, transformName);
 
@@ -325,6 +617,7 @@ int vtkPlusIgtlMessageFactory::PackPositionMessage(const PlusIgtlClientInfo& cli
     igtl::PositionMessage::Pointer positionMessage = dynamic_cast<igtl::PositionMessage*>(igtlMessage->Clone().GetPointer());
     vtkPlusIgtlMessageCommon::PackPositionMessage(positionMessage, transformName, status, position, quaternion, trackedFrame.GetTimestamp());
     igtlMessages.push_back(positionMessage.GetPointer());
+    this->AddCachedMessage(cacheKey, positionMessage.GetPointer());
   }
 
   return 0; // no errors possible with this message type
@@ -367,7 +660,18 @@ int vtkPlusIgtlMessageFactory::PackTransformMessage(const PlusIgtlClientInfo& cl
 {
   for (std::vector<igsioTransformName>::const_iterator transformNameIterator = clientInfo.TransformNames.begin(); transformNameIterator != clientInfo.TransformNames.end(); ++transformNameIterator)
   {
+    // The transform name is formatted only once per transform
     igsioTransformName transformName = (*transformNameIterator);
+    const std::string transformNameString = transformName.GetTransformName();
+    MessageCacheKey cacheKey("TRANSFORM", transformNameString, clientInfo.GetClientHeaderVersion(), transformNameString);
+    igtl::MessageBase::Pointer cachedMessage;
+    if (this->GetCachedMessage(cacheKey, cachedMessage))
+    {
+      // Only valid transforms are cached, so the message can be sent regardless of packValidTransformsOnly
+      igtlMessages.push_back(cachedMessage);
+      continue;
+    }
+
     ToolStatus status(TOOL_UNKNOWN);
     vtkNew<vtkMatrix4x4> temp;
     transformRepository.GetTransform(transformName, temp.GetPointer(), &status);
@@ -378,24 +682,33 @@ int vtkPlusIgtlMessageFactory::PackTransformMessage(const PlusIgtlClientInfo& cl
       continue;
     }
 
+    // Same as vtkPlusIgtlMessageCommon::GetIgtlMatrix, without getting the transform from the repository again
     igtl::Matrix4x4 igtlMatrix;
-    vtkPlusIgtlMessageCommon::GetIgtlMatrix(igtlMatrix, &transformRepository, transformName);
+    igtl::IdentityMatrix(igtlMatrix);
+    if (status == TOOL_OK)
+    {
+      igtlioTransformConverter::VTKToIGTLTransform(*temp.GetPointer(), igtlMatrix);
+    }
     igtl::TransformMessage::Pointer transformMessage = dynamic_cast<igtl::TransformMessage*>(igtlMessage->Clone().GetPointer()); 
-    igsioFieldMapType frameFields = trackedFrame.GetFrameFields();
-    for (igsioFieldMapType::iterator iter = frameFields.begin(); iter != frameFields.end(); ++iter)
+    const igsioFieldMapType& frameFields = trackedFrame.GetFrameFields();
+    for (igsioFieldMapType::const_iterator iter = frameFields.begin(); iter != frameFields.end(); ++iter)
     {
-      if (iter->first.find(transformName.GetTransformName()) == 0)
+      if (iter->first.compare(0, transformNameString.length(), transformNameString) == 0)
       {
         // field starts with transform name, check flags
         if ((iter->second.first & igsioFrameFieldFlags::FRAMEFIELD_FORCE_SERVER_SEND) > 0)
         {
-          std::string stripped = iter->first.substr(transformName.GetTransformName().length());
+          std::string stripped = iter->first.substr(transformNameString.length());
           transformMessage->SetMetaDataElement(stripped, IANA_TYPE_US_ASCII, iter->second.second);
         }
       }
     }
     vtkPlusIgtlMessageCommon::PackTransformMessage(transformMessage, transformName, igtlMatrix, status, trackedFrame.GetTimestamp());
     igtlMessages.push_back(transformMessage.GetPointer());
+    if (status == TOOL_OK)
+    {
+      this->AddCachedMessage(cacheKey, transformMessage.GetPointer());
+    }
   }
 
   return 0; // no errors possible in this message type
@@ -412,6 +725,11 @@ int vtkPlusIgtlMessageFactory::PackImageMessage(const PlusIgtlClientInfo& client
     // Set transform name to [Name]To[CoordinateFrame]
     igsioTransformName imageTransformName = igsioTransformName(imageStream.Name, imageStream.EmbeddedTransformToFrame);
 
+    if (!clientInfo.IsMessageDue(messageType + "_" + imageTransformName.GetTransformName(), imageStream.MaxRateHz, trackedFrame.GetTimestamp()))
+    {
+      continue;
+    }
+
     vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
     ToolStatus status;
     if (transformRepository.GetTransform(imageTransformName, matrix.Get(), &status) != PLUS_SUCCESS)
@@ -422,18 +740,31 @@ int vtkPlusIgtlMessageFactory::PackImageMessage(const PlusIgtlClientInfo& client
     }
 
     std::string deviceName = imageTransformName.From() + std::string("_") + imageTransformName.To();
-
-    igtl::ImageMessage::Pointer imageMessage = dynamic_cast<igtl::ImageMessage*>(igtlMessage->Clone().GetPointer());
     if (trackedFrame.IsFrameFieldDefined(igsioTrackedFrame::FIELD_FRIENDLY_DEVICE_NAME))
     {
       // Allow overriding of device name with something human readable
       // The transform name is passed in the metadata
       deviceName = trackedFrame.GetFrameField(igsioTrackedFrame::FIELD_FRIENDLY_DEVICE_NAME);
     }
-    imageMessage->SetDeviceName(deviceName.c_str());
+
+    // Cropped and resized images are shared by the clients that request the same region and scale
+    std::ostringstream imageParameters;
+    imageParameters << imageTransformName.GetTransformName();
+    if (imageStream.IsResized())
+    {
+      imageParameters << "_" << imageStream.Crop[0] << "_" << imageStream.Crop[1] << "_" << imageStream.Crop[2] << "_" << imageStream.Crop[3] << "_" << imageStream.Scale;
+    }
+    MessageCacheKey cacheKey(messageType, deviceName, clientInfo.GetClientHeaderVersion(), imageParameters.str());
+    igtl::MessageBase::Pointer cachedMessage;
+    if (this->GetCachedMessage(cacheKey, cachedMessage))
+    {
+      igtlMessages.push_back(cachedMessage);
+      continue;
+    }
 
     // Send igsioTrackedFrame::CustomFrameFields as meta data in the image message.
     std::vector<std::string> frameFields;
+    std::vector<std::string> metaDataNames;
     trackedFrame.GetFrameFieldNameList(frameFields);
     for (std::vector<std::string>::const_iterator stringNameIterator = frameFields.begin(); stringNameIterator != frameFields.end(); ++stringNameIterator)
     {
@@ -443,23 +774,176 @@ int vtkPlusIgtlMessageFactory::PackImageMessage(const PlusIgtlClientInfo& client
         LOG_WARNING("No metadata value for: " << *stringNameIterator)
         continue;
       }
-      imageMessage->SetMetaDataElement(*stringNameIterator, IANA_TYPE_US_ASCII, trackedFrame.GetFrameField(*stringNameIterator));
+      metaDataNames.push_back(*stringNameIterator);
+    }
+
+    igtl::ImageMessage::Pointer imageMessage = dynamic_cast<igtl::ImageMessage*>(this->GetPooledMessage(cacheKey, igtlMessage).GetPointer());
+    imageMessage->SetDeviceName(deviceName.c_str());
+    for (std::vector<std::string>::const_iterator nameIterator = metaDataNames.begin(); nameIterator != metaDataNames.end(); ++nameIterator)
+    {
+      imageMessage->SetMetaDataElement(*nameIterator, IANA_TYPE_US_ASCII, trackedFrame.GetFrameField(*nameIterator));
+    }
+    if (imageMessage->GetMetaData().size() != metaDataNames.size())
+    {
+      // The reused message has meta data of frame fields that are not defined anymore (meta data elements cannot be removed)
+      imageMessage = dynamic_cast<igtl::ImageMessage*>(igtlMessage->Clone().GetPointer());
+      imageMessage->SetDeviceName(deviceName.c_str());
+      for (std::vector<std::string>::const_iterator nameIterator = metaDataNames.begin(); nameIterator != metaDataNames.end(); ++nameIterator)
+      {
+        imageMessage->SetMetaDataElement(*nameIterator, IANA_TYPE_US_ASCII, trackedFrame.GetFrameField(*nameIterator));
+      }
     }
 
-    if (vtkPlusIgtlMessageCommon::PackImageMessage(imageMessage, trackedFrame, *matrix, imageStream.FrameConverter) != PLUS_SUCCESS)
+    if (vtkPlusIgtlMessageCommon::PackImageMessage(imageMessage, trackedFrame, *matrix, imageStream.FrameConverter, imageStream.Crop, imageStream.Scale) != PLUS_SUCCESS)
     {
       LOG_ERROR("Failed to create " << messageType << " message - unable to pack image message");
       numberOfErrors++;
       continue;
     }
     igtlMessages.push_back(imageMessage.GetPointer());
+    this->AddCachedMessage(cacheKey, imageMessage.GetPointer());
+  }
+  return numberOfErrors;
+}
+
+//----------------------------------------------------------------------------
+int vtkPlusIgtlMessageFactory::PackDeltaImageMessage(const PlusIgtlClientInfo& clientInfo, vtkIGSIOTransformRepository& transformRepository, const std::string& messageType, igtl::MessageBase::Pointer igtlMessage, igsioTrackedFrame& trackedFrame, std::vector<igtl::MessageBase::Pointer>& igtlMessages, int clientId)
+{
+  int numberOfErrors = 0;
+  for (std::vector<PlusIgtlClientInfo::ImageStream>::const_iterator imageStreamIterator = clientInfo.ImageStreams.begin(); imageStreamIterator != clientInfo.ImageStreams.end(); ++imageStreamIterator)
+  {
+    // Set transform name to [Name]To[CoordinateFrame]
+    igsioTransformName imageTransformName = igsioTransformName(imageStreamIterator->Name, imageStreamIterator->EmbeddedTransformToFrame);
+
+    // Clients that request the same stream share the encoder
+    SharedDeltaImageEncoder& encoder = this->SharedDeltaImageEncoders[imageTransformName.GetTransformName()];
+    if (encoder.Subscribers.insert(clientId).second)
+    {
+      // New subscriber, it needs a key frame to start decoding
+      encoder.SubscribersWaitingForKeyFrame.insert(clientId);
+      encoder.Encoder.RequestKeyFrame();
+    }
+
+    if (!encoder.LastMessage.IsNull() && encoder.LastFrameTimestamp == trackedFrame.GetTimestamp())
+    {
+      // Already encoded for another subscriber
+      if (encoder.LastFrameIsKeyFrame)
+      {
+        encoder.SubscribersWaitingForKeyFrame.erase(clientId);
+      }
+      if (encoder.SubscribersWaitingForKeyFrame.find(clientId) == encoder.SubscribersWaitingForKeyFrame.end())
+      {
+        igtlMessages.push_back(encoder.LastMessage);
+      }
+      continue;
+    }
+    encoder.LastMessage = NULL;
+    encoder.LastFrameTimestamp = trackedFrame.GetTimestamp();
+
+    vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    ToolStatus status;
+    if (transformRepository.GetTransform(imageTransformName, matrix.Get(), &status) != PLUS_SUCCESS)
+    {
+      LOG_WARNING("Failed to create " << messageType << " message: cannot get image transform. ToolStatus: " << status);
+      numberOfErrors++;
+      continue;
+    }
+
+    std::string deviceName = imageTransformName.From() + std::string("_") + imageTransformName.To();
+    if (trackedFrame.IsFrameFieldDefined(igsioTrackedFrame::FIELD_FRIENDLY_DEVICE_NAME))
+    {
+      // Allow overriding of device name with something human readable
+      // The transform name is passed in the metadata
+      deviceName = trackedFrame.GetFrameField(igsioTrackedFrame::FIELD_FRIENDLY_DEVICE_NAME);
+    }
+
+    igtl::PlusDeltaImageMessage::Pointer deltaImageMessage = dynamic_cast<igtl::PlusDeltaImageMessage*>(igtlMessage->Clone().GetPointer());
+    deltaImageMessage->SetDeviceName(deviceName.c_str());
+    if (vtkPlusIgtlMessageCommon::PackDeltaImageMessage(deltaImageMessage, trackedFrame, matrix, encoder.Encoder) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to create " << messageType << " message - unable to pack delta image message");
+      // The reference frame of the clients is unknown now
+      encoder.Encoder.RequestKeyFrame();
+      numberOfErrors++;
+      continue;
+    }
+    encoder.LastMessage = deltaImageMessage.GetPointer();
+    encoder.LastFrameIsKeyFrame = deltaImageMessage->GetDeltaImageHeader().IsKeyFrame();
+    if (encoder.LastFrameIsKeyFrame)
+    {
+      encoder.SubscribersWaitingForKeyFrame.erase(clientId);
+    }
+    if (encoder.SubscribersWaitingForKeyFrame.find(clientId) != encoder.SubscribersWaitingForKeyFrame.end())
+    {
+      // Delta frame, the client cannot decode it before it receives a key frame
+      continue;
+    }
+    igtlMessages.push_back(deltaImageMessage.GetPointer());
+  }
+  return numberOfErrors;
+}
+
+//----------------------------------------------------------------------------
+int vtkPlusIgtlMessageFactory::PackSlabVolumeMessage(const PlusIgtlClientInfo& clientInfo, vtkIGSIOTransformRepository& transformRepository, const std::string& messageType, igtl::MessageBase::Pointer igtlMessage, igsioTrackedFrame& trackedFrame, std::vector<igtl::MessageBase::Pointer>& igtlMessages)
+{
+  int numberOfErrors = 0;
+  for (std::vector<PlusIgtlClientInfo::ImageStream>::const_iterator imageStreamIterator = clientInfo.ImageStreams.begin(); imageStreamIterator != clientInfo.ImageStreams.end(); ++imageStreamIterator)
+  {
+    const PlusIgtlClientInfo::ImageStream& imageStream = (*imageStreamIterator);
+
+    // Set transform name to [Name]To[CoordinateFrame]
+    igsioTransformName imageTransformName = igsioTransformName(imageStream.Name, imageStream.EmbeddedTransformToFrame);
+
+    if (!clientInfo.IsMessageDue(messageType + "_" + imageTransformName.GetTransformName(), imageStream.MaxRateHz, trackedFrame.GetTimestamp()))
+    {
+      continue;
+    }
+
+    vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    ToolStatus status;
+    if (transformRepository.GetTransform(imageTransformName, matrix.Get(), &status) != PLUS_SUCCESS)
+    {
+      LOG_WARNING("Failed to create " << messageType << " message: cannot get image transform. ToolStatus: " << status);
+      numberOfErrors++;
+      continue;
+    }
+
+    std::string deviceName = imageTransformName.From() + std::string("_") + imageTransformName.To();
+    if (trackedFrame.IsFrameFieldDefined(igsioTrackedFrame::FIELD_FRIENDLY_DEVICE_NAME))
+    {
+      // Allow overriding of device name with something human readable
+      // The transform name is passed in the metadata
+      deviceName = trackedFrame.GetFrameField(igsioTrackedFrame::FIELD_FRIENDLY_DEVICE_NAME);
+    }
+
+    // Compression is the expensive part, clients that request the same stream with the same parameters share the message
+    std::ostringstream compressionParameters;
+    compressionParameters << imageTransformName.GetTransformName() << "_" << imageStream.SlabThickness << "_" << imageStream.CompressionLevel << "_" << imageStream.ByteShuffle;
+    MessageCacheKey cacheKey(messageType, deviceName, clientInfo.GetClientHeaderVersion(), compressionParameters.str());
+    igtl::MessageBase::Pointer cachedMessage;
+    if (this->GetCachedMessage(cacheKey, cachedMessage))
+    {
+      igtlMessages.push_back(cachedMessage);
+      continue;
+    }
+
+    igtl::PlusSlabVolumeMessage::Pointer slabVolumeMessage = dynamic_cast<igtl::PlusSlabVolumeMessage*>(this->GetPooledMessage(cacheKey, igtlMessage).GetPointer());
+    slabVolumeMessage->SetDeviceName(deviceName.c_str());
+    if (vtkPlusIgtlMessageCommon::PackSlabVolumeMessage(slabVolumeMessage, trackedFrame, matrix, imageStream.SlabThickness, imageStream.CompressionLevel, imageStream.ByteShuffle) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to create " << messageType << " message - unable to pack slab volume message");
+      numberOfErrors++;
+      continue;
+    }
+    igtlMessages.push_back(slabVolumeMessage.GetPointer());
+    this->AddCachedMessage(cacheKey, slabVolumeMessage.GetPointer());
   }
   return numberOfErrors;
 }
 
 #if defined(OpenIGTLink_ENABLE_VIDEOSTREAMING)
 //----------------------------------------------------------------------------
-int vtkPlusIgtlMessageFactory::PackVideoMessage(const PlusIgtlClientInfo& clientInfo, vtkIGSIOTransformRepository& transformRepository, const std::string& messageType, igtl::MessageBase::Pointer igtlMessage, igsioTrackedFrame& trackedFrame, std::vector<igtl::MessageBase::Pointer>& igtlMessages, int clientId)
+int vtkPlusIgtlMessageFactory::PackVideoMessage(const PlusIgtlClientInfo& clientInfo, vtkIGSIOTransformRepository& transformRepository, const std::string& messageType, igtl::MessageBase::Pointer igtlMessage, igsioTrackedFrame& trackedFrame, std::vector<igtl::MessageBase::Pointer>& igtlMessages, int clientId, int sendBacklog)
 {
   int numberOfErrors = 0;
   for (std::vector<PlusIgtlClientInfo::VideoStream>::const_iterator videoStreamIterator = clientInfo.VideoStreams.begin(); videoStreamIterator != clientInfo.VideoStreams.end(); ++videoStreamIterator)
@@ -479,6 +963,63 @@ int vtkPlusIgtlMessageFactory::PackVideoMessage(const PlusIgtlClientInfo& client
 
     std::string deviceName = imageTransformName.From() + std::string("_") + imageTransformName.To();
 
+    // Clients that request the same stream with the same encoding parameters share the encoder
+    SharedVideoEncoder& encoder = this->SharedVideoEncoders[GetVideoEncoderKey(videoStream)];
+    if (encoder.FrameConverter == NULL)
+    {
+      encoder.FrameConverter = vtkSmartPointer<vtkIGSIOFrameConverter>::New();
+      encoder.FrameConverter->EnableCacheOn();
+    }
+    if (encoder.Subscribers.insert(clientId).second)
+    {
+      // New subscriber, it needs a key frame to start decoding
+      encoder.SubscribersWaitingForKeyFrame.insert(clientId);
+      encoder.FrameConverter->RequestKeyFrameOn();
+    }
+
+    const int maxSendBacklog = videoStream.EncodeVideoParameters.MaxSendBacklog;
+    if (maxSendBacklog > 0 && sendBacklog > maxSendBacklog)
+    {
+      // The client cannot keep up with the stream, skip frames until it catches up.
+      // Any later delta frame would refer to the skipped frames, so the client has to resume with a key frame.
+      if (encoder.SubscribersWaitingForKeyFrame.insert(clientId).second)
+      {
+        LOG_DEBUG("Client " << clientId << " has " << sendBacklog << " messages waiting to be sent, skipping frames of video stream " << videoStream.Name);
+      }
+      continue;
+    }
+    if (encoder.SubscribersWaitingForKeyFrame.find(clientId) != encoder.SubscribersWaitingForKeyFrame.end())
+    {
+      encoder.FrameConverter->RequestKeyFrameOn();
+    }
+
+    if (encoder.LastMessage.IsNull() || encoder.LastFrameTimestamp != trackedFrame.GetTimestamp())
+    {
+      if (encoder.LastMessage.IsNotNull()
+          && !PlusIgtlClientInfo::IsSendAllowed(encoder.LastFrameTimestamp, trackedFrame.GetTimestamp(), videoStream.EncodeVideoParameters.MaxRateHz))
+      {
+        // Frame rate is limited, the frame is skipped for all subscribers so that they remain able to decode the stream
+        continue;
+      }
+
+      // The frame has not been encoded yet
+      encoder.LastMessage = NULL;
+      encoder.LastFrameTimestamp = trackedFrame.GetTimestamp();
+    }
+    else
+    {
+      // Already encoded for another subscriber
+      if (encoder.LastFrameIsKeyFrame)
+      {
+        encoder.SubscribersWaitingForKeyFrame.erase(clientId);
+      }
+      if (encoder.SubscribersWaitingForKeyFrame.find(clientId) == encoder.SubscribersWaitingForKeyFrame.end())
+      {
+        igtlMessages.push_back(encoder.LastMessage);
+      }
+      continue;
+    }
+
     igtl::VideoMessage::Pointer videoMessage = dynamic_cast<igtl::VideoMessage*>(igtlMessage->Clone().GetPointer());
     if (trackedFrame.IsFrameFieldDefined(igsioTrackedFrame::FIELD_FRIENDLY_DEVICE_NAME))
     {
@@ -513,14 +1054,39 @@ int vtkPlusIgtlMessageFactory::PackVideoMessage(const PlusIgtlClientInfo& client
       parameters["encodingSpeed"] = igsioCommon::ToString(videoStream.EncodeVideoParameters.Speed);
       parameters["bitRate"] = igsioCommon::ToString(videoStream.EncodeVideoParameters.TargetBitrate);
       parameters["deadlineMode"] = videoStream.EncodeVideoParameters.DeadlineMode;
+      if (videoStream.EncodeVideoParameters.LowLatency)
+      {
+        // Encode each frame as fast as possible, with a constant frame size if a bitrate is set, so frames are not delayed by size peaks
+        parameters["deadlineMode"] = "REALTIME";
+        parameters["encodingSpeed"] = igsioCommon::ToString(std::max(videoStream.EncodeVideoParameters.Speed, 8));
+        if (videoStream.EncodeVideoParameters.TargetBitrate > 0)
+        {
+          parameters["rateControl"] = "CBR";
+        }
+      }
     }
 
-    if (vtkPlusIgtlMessageCommon::PackVideoMessage(videoMessage, trackedFrame, *matrix, videoStream.FrameConverter, videoStream.EncodeVideoParameters.FourCC, parameters) != PLUS_SUCCESS)
+    double encodingStartTime = vtkIGSIOAccurateTimer::GetSystemTime();
+    if (vtkPlusIgtlMessageCommon::PackVideoMessage(videoMessage, trackedFrame, *matrix, encoder.FrameConverter, videoStream.EncodeVideoParameters.FourCC, parameters) != PLUS_SUCCESS)
     {
       LOG_ERROR("Failed to create " << messageType << " message - unable to pack image message");
       numberOfErrors++;
       continue;
     }
+    this->LastVideoEncodingTimeSec += vtkIGSIOAccurateTimer::GetSystemTime() - encodingStartTime;
+    encoder.LastMessage = videoMessage.GetPointer();
+    // The frame type of grayscale frames is stored in the second byte
+    int frameType = videoMessage->GetFrameType();
+    encoder.LastFrameIsKeyFrame = (frameType == FrameTypeKey || (frameType >> 8) == FrameTypeKey);
+    if (encoder.LastFrameIsKeyFrame)
+    {
+      encoder.SubscribersWaitingForKeyFrame.erase(clientId);
+    }
+    if (encoder.SubscribersWaitingForKeyFrame.find(clientId) != encoder.SubscribersWaitingForKeyFrame.end())
+    {
+      // Delta frame, the client cannot decode it before it receives a key frame
+      continue;
+    }
     igtlMessages.push_back(videoMessage.GetPointer());
   }
   return numberOfErrors;
@@ -18,8 +18,13 @@
 #include "igtlMessageFactory.h"
 
 // PlusLib includes
+#include "PlusDeltaImageCodec.h"
 #include "PlusIgtlClientInfo.h"
 
+// STL includes
+#include <map>
+#include <set>
+
 class vtkXMLDataElement;
 //class igsioTrackedFrame; 
 //class vtkIGSIOTransformRepository;
@@ -68,6 +73,17 @@ public:
   /// Creates message, sets header onto message and calls AllocateBuffer() on the message.
   igtl::MessageBase::Pointer CreateSendMessage(const std::string& messageType, int headerVersion) const;
 
+  /*! Selects the message types of the client info that are packed by PackMessages */
+  enum MessageSelection
+  {
+    ALL_MESSAGES,
+    TRACKING_MESSAGES,    /*!< only TRANSFORM, POSITION and TDATA messages */
+    NON_TRACKING_MESSAGES /*!< all message types except TRANSFORM, POSITION and TDATA */
+  };
+
+  /*! Returns true for the message types that contain only tool poses (TRANSFORM, POSITION and TDATA) */
+  static bool IsTrackingMessageType(const std::string& messageType);
+
   /*!
   Generate and pack IGTL messages from tracked frame
   \param clientId Id of the client that messages will be sent to
@@ -76,9 +92,52 @@ public:
   \param igtMessages Output list for the generated IGTL messages
   \param trackedFrame Input tracked frame data used for IGTL message generation
   \param transformRepository Transform repository used for computing the selected transforms
+  \param sendBacklog Number of messages that are still waiting to be sent to the client, used for skipping video frames (see EncodingParameters::MaxSendBacklog)
+  \param messageSelection Message types of the client info that are packed, e.g. tracking messages are packed separately if they are sent at the tracker rate
   */
   PlusStatus PackMessages(int clientId, const PlusIgtlClientInfo& clientInfo, std::vector<igtl::MessageBase::Pointer>& igtMessages, igsioTrackedFrame& trackedFrame,
-                          bool packValidTransformsOnly, vtkIGSIOTransformRepository* transformRepository = NULL);
+                          bool packValidTransformsOnly, vtkIGSIOTransformRepository* transformRepository = NULL, int sendBacklog = 0,
+                          MessageSelection messageSelection = ALL_MESSAGES);
+
+  /*!
+  If enabled then IMAGE, TRANSFORM and POSITION messages packed by PackMessages are cached and
+  reused when another client requests the same message, so that each message is packed only once per frame.
+  Cached messages are shared between clients and must not be modified.
+  ClearMessageCache() must be called before packing messages for a new tracked frame.
+  */
+  vtkSetMacro(MessageCacheEnabled, bool);
+  vtkGetMacro(MessageCacheEnabled, bool);
+  vtkBooleanMacro(MessageCacheEnabled, bool);
+
+  /*! Discard all cached messages */
+  void ClearMessageCache();
+
+  /*!
+  Set the transforms of the tracked frame in the transform repository. If the message cache is enabled then the transforms
+  are set only once per frame, so packing messages for more clients does not set them again, until ClearMessageCache() is called.
+  */
+  PlusStatus SetFrameTransforms(igsioTrackedFrame& trackedFrame, vtkIGSIOTransformRepository* transformRepository);
+
+  /*!
+  If enabled then the IMAGE, TRACKEDFRAME and USMESSAGE messages created by PackMessages are kept in a pool
+  and reused for the next frame of the same stream once they are not referenced anymore (e.g., they have been sent and
+  removed from the send queues). The buffers of reused messages are only reallocated if the message size changes.
+  */
+  vtkSetMacro(MessagePoolEnabled, bool);
+  vtkGetMacro(MessagePoolEnabled, bool);
+  vtkBooleanMacro(MessagePoolEnabled, bool);
+
+  /*! Release all pooled messages */
+  void ClearMessagePool();
+
+  /*!
+  Remove the client from the subscribers of the shared video and delta image encoders. Encoders that have no more subscribers are deleted.
+  Frames that are collected for a TRACKEDBATCH message of the client are discarded. Must be called when a client disconnects.
+  */
+  void RemoveSubscriber(int clientId);
+
+  /*! Total duration of the video encoding done by the last PackMessages call. 0 if no frame was encoded (e.g., the encoded frame was reused). */
+  vtkGetMacro(LastVideoEncodingTimeSec, double);
 
 protected:
   vtkPlusIgtlMessageFactory();
@@ -86,13 +145,110 @@ protected:
 
   igtl::MessageFactory::Pointer IgtlFactory;
 
+  /*! Identifies a packed message within a frame */
+  struct MessageCacheKey
+  {
+    MessageCacheKey(const std::string& messageType, const std::string& deviceName, int headerVersion, const std::string& name)
+      : MessageType(messageType), DeviceName(deviceName), HeaderVersion(headerVersion), Name(name) {}
+    bool operator<(const MessageCacheKey& other) const;
+
+    std::string MessageType;
+    std::string DeviceName;
+    int HeaderVersion;
+    /*! Name of the transform or image stream that the message is created from */
+    std::string Name;
+  };
+
+  /*! Get a cached message. Returns false if caching is disabled or the message has not been packed yet for the current frame. */
+  bool GetCachedMessage(const MessageCacheKey& key, igtl::MessageBase::Pointer& igtlMessage) const;
+
+  /*! Store a packed message in the cache (if caching is enabled) */
+  void AddCachedMessage(const MessageCacheKey& key, igtl::MessageBase::Pointer igtlMessage);
+
+  bool MessageCacheEnabled;
+  std::map<MessageCacheKey, igtl::MessageBase::Pointer> MessageCache;
+
+  /*! Frame and repository of the last SetFrameTransforms call since the message cache was cleared */
+  igsioTrackedFrame* FrameTransformsSetFrame;
+  vtkIGSIOTransformRepository* FrameTransformsSetRepository;
+
+  /*!
+  Get a message for packing the stream identified by the key. Returns a pooled message that is not referenced anywhere else,
+  or a clone of the prototype message if there is none (or pooling is disabled).
+  */
+  igtl::MessageBase::Pointer GetPooledMessage(const MessageCacheKey& key, igtl::MessageBase::Pointer prototype);
+
+  bool MessagePoolEnabled;
+  std::map<MessageCacheKey, std::vector<igtl::MessageBase::Pointer> > MessagePool;
+
+  /*!
+  Encoder of a video stream, shared by all clients that request the same stream with the same encoding parameters.
+  Each frame is encoded only once and the encoded message is sent to all subscribers.
+  */
+  struct SharedVideoEncoder
+  {
+    vtkSmartPointer<vtkIGSIOFrameConverter> FrameConverter;
+    /*! Clients that receive this stream */
+    std::set<int> Subscribers;
+    /*! Subscribers that have not received a key frame yet. Delta frames are not sent to them, as they could not decode them. */
+    std::set<int> SubscribersWaitingForKeyFrame;
+    /*! Message of the last encoded frame, sent to the subscribers that request the same frame */
+    igtl::MessageBase::Pointer LastMessage;
+    double LastFrameTimestamp;
+    bool LastFrameIsKeyFrame;
+    SharedVideoEncoder()
+      : LastFrameTimestamp(UNDEFINED_TIMESTAMP)
+      , LastFrameIsKeyFrame(false)
+    {
+    }
+  };
+
+  /*! Identifies a shared video encoder by the stream name and the encoding parameters */
+  static std::string GetVideoEncoderKey(const PlusIgtlClientInfo::VideoStream& videoStream);
+
+  std::map<std::string, SharedVideoEncoder> SharedVideoEncoders;
+
+  double LastVideoEncodingTimeSec;
+
+  /*!
+  Encoder of a DELTAIMAGE stream, shared by all clients that request the same image stream.
+  Each frame is encoded only once, as the reference frame of the encoder must be the previous frame of the stream.
+  */
+  struct SharedDeltaImageEncoder
+  {
+    PlusDeltaImageEncoder Encoder;
+    /*! Clients that receive this stream */
+    std::set<int> Subscribers;
+    /*! Subscribers that have not received a key frame yet. Delta frames are not sent to them, as they could not decode them. */
+    std::set<int> SubscribersWaitingForKeyFrame;
+    /*! Message of the last encoded frame, sent to the subscribers that request the same frame */
+    igtl::MessageBase::Pointer LastMessage;
+    double LastFrameTimestamp;
+    bool LastFrameIsKeyFrame;
+    SharedDeltaImageEncoder()
+      : LastFrameTimestamp(UNDEFINED_TIMESTAMP)
+      , LastFrameIsKeyFrame(false)
+    {
+    }
+  };
+
+  /*! Encoders of the DELTAIMAGE streams, by image transform name */
+  std::map<std::string, SharedDeltaImageEncoder> SharedDeltaImageEncoders;
+
+  /*! TRACKEDBATCH messages that are being filled with frames, by client id */
+  std::map<int, igtl::MessageBase::Pointer> PendingTrackedFrameBatches;
+
 protected:
   int PackImageMessage(const PlusIgtlClientInfo& clientInfo, vtkIGSIOTransformRepository& transformRepository, const std::string& messageType,
                        igtl::MessageBase::Pointer igtlMessage, igsioTrackedFrame& trackedFrame, std::vector<igtl::MessageBase::Pointer>& igtlMessages, int clientId);
 #if defined(OpenIGTLink_ENABLE_VIDEOSTREAMING)
   int PackVideoMessage(const PlusIgtlClientInfo& clientInfo, vtkIGSIOTransformRepository& transformRepository, const std::string& messageType,
-                       igtl::MessageBase::Pointer igtlMessage, igsioTrackedFrame& trackedFrame, std::vector<igtl::MessageBase::Pointer>& igtlMessages, int clientId);
+                       igtl::MessageBase::Pointer igtlMessage, igsioTrackedFrame& trackedFrame, std::vector<igtl::MessageBase::Pointer>& igtlMessages, int clientId, int sendBacklog);
 #endif
+  int PackDeltaImageMessage(const PlusIgtlClientInfo& clientInfo, vtkIGSIOTransformRepository& transformRepository, const std::string& messageType,
+                            igtl::MessageBase::Pointer igtlMessage, igsioTrackedFrame& trackedFrame, std::vector<igtl::MessageBase::Pointer>& igtlMessages, int clientId);
+  int PackSlabVolumeMessage(const PlusIgtlClientInfo& clientInfo, vtkIGSIOTransformRepository& transformRepository, const std::string& messageType,
+                            igtl::MessageBase::Pointer igtlMessage, igsioTrackedFrame& trackedFrame, std::vector<igtl::MessageBase::Pointer>& igtlMessages);
   int PackTransformMessage(const PlusIgtlClientInfo& clientInfo, vtkIGSIOTransformRepository& transformRepository, bool packValidTransformsOnly,
                            igtl::MessageBase::Pointer igtlMessage, igsioTrackedFrame& trackedFrame, std::vector<igtl::MessageBase::Pointer>& igtlMessages);
   int PackTrackingDataMessage(const PlusIgtlClientInfo& clientInfo, igsioTrackedFrame& trackedFrame, vtkIGSIOTransformRepository& transformRepository, bool packValidTransformsOnly,
@@ -101,7 +257,9 @@ protected:
                           igsioTrackedFrame& trackedFrame, std::vector<igtl::MessageBase::Pointer>& igtlMessages);
   int PackTrackedFrameMessage(igtl::MessageBase::Pointer igtlMessage, const PlusIgtlClientInfo& clientInfo, vtkIGSIOTransformRepository& transformRepository,
                               igsioTrackedFrame& trackedFrame, std::vector<igtl::MessageBase::Pointer>& igtlMessages);
-  int PackUsMessage(igtl::MessageBase::Pointer igtlMessage, igsioTrackedFrame& trackedFrame, std::vector<igtl::MessageBase::Pointer>& igtlMessages);
+  int PackTrackedFrameBatchMessage(int clientId, igtl::MessageBase::Pointer igtlMessage, const PlusIgtlClientInfo& clientInfo, vtkIGSIOTransformRepository& transformRepository,
+                                   igsioTrackedFrame& trackedFrame, std::vector<igtl::MessageBase::Pointer>& igtlMessages);
+  int PackUsMessage(const PlusIgtlClientInfo& clientInfo, igtl::MessageBase::Pointer igtlMessage, igsioTrackedFrame& trackedFrame, std::vector<igtl::MessageBase::Pointer>& igtlMessages);
   int PackStringMessage(const PlusIgtlClientInfo& clientInfo, igsioTrackedFrame& trackedFrame, igtl::MessageBase::Pointer igtlMessage, std::vector<igtl::MessageBase::Pointer>& igtlMessages);
   int PackCommandMessage(igtl::MessageBase::Pointer igtlMessage, std::vector<igtl::MessageBase::Pointer>& igtlMessages);
 
@@ -6,6 +6,7 @@ See License.txt for details.
 
 // Local includes
 #include "PlusPlotter.h"
+#include "PlusWorkerPool.h"
 
 // VTK includes
 #include <vtkAxis.h>
@@ -15,6 +16,7 @@ See License.txt for details.
 #include <vtkDataArray.h>
 #include <vtkDelimitedTextWriter.h>
 #include <vtkDoubleArray.h>
+#include <vtkImageData.h>
 #include <vtkInformation.h>
 #include <vtkMultiBlockDataSet.h>
 #include <vtkPNGWriter.h>
@@ -27,6 +29,18 @@ See License.txt for details.
 #include <vtkTable.h>
 #include <vtkWindowToImageFilter.h>
 
+// STL includes
+#include <algorithm>
+#include <functional>
+#include <mutex>
+
+namespace
+{
+  // Offscreen render windows are not created and rendered concurrently, because not all OpenGL backends support it.
+  // Only the rendering is serialized, building the charts and writing the PNG files runs in parallel.
+  std::mutex ChartRenderingMutex;
+}
+
 //----------------------------------------------------------------------------
 PlusStatus PlusPlotter::WriteScatterChartToFile(const std::string& chartTitle,
     const std::string& yAxisText,
@@ -91,6 +105,106 @@ PlusStatus PlusPlotter::WriteLineChartToFile(const std::string& chartTitle,
   return WriteChartToFile(*view, imageSize, outputImageFilename);
 }
 
+//----------------------------------------------------------------------------
+std::future<PlusStatus> PlusPlotter::WriteLineChartToFileAsync(const std::string& chartTitle,
+    const std::string& yAxisText,
+    vtkTable& inputTable,
+    int xColumnIndex,
+    int y1ColumnIndex,
+    int y2ColumnIndex,
+    int imageSize[2],
+    const std::string& outputImageFilename)
+{
+  // A line chart cannot show more than two points per pixel column
+  vtkSmartPointer<vtkTable> decimatedTable = vtkSmartPointer<vtkTable>::New();
+  DecimateTableMinMax(inputTable, xColumnIndex, static_cast<unsigned int>(std::max(imageSize[0], 1)), *decimatedTable);
+
+  int chartImageSize[2] = { imageSize[0], imageSize[1] };
+  std::function<PlusStatus()> writeChart = [chartTitle, yAxisText, decimatedTable, xColumnIndex, y1ColumnIndex, y2ColumnIndex, chartImageSize, outputImageFilename]() mutable
+  {
+    return WriteLineChartToFile(chartTitle, yAxisText, *decimatedTable, xColumnIndex, y1ColumnIndex, y2ColumnIndex, chartImageSize, outputImageFilename);
+  };
+#ifdef __APPLE__
+  // Cocoa windows can only be created on the main thread
+  std::packaged_task<PlusStatus()> task(writeChart);
+  std::future<PlusStatus> result = task.get_future();
+  task();
+  return result;
+#else
+  return PlusWorkerPool::GetInstance().Submit(writeChart);
+#endif
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusPlotter::DecimateTableMinMax(vtkTable& inputTable, int xColumnIndex, unsigned int numberOfBins, vtkTable& outputTable)
+{
+  vtkIdType numberOfRows = inputTable.GetNumberOfRows();
+  vtkIdType numberOfColumns = inputTable.GetNumberOfColumns();
+  if (numberOfBins == 0 || numberOfRows <= 2 * static_cast<vtkIdType>(numberOfBins))
+  {
+    outputTable.DeepCopy(&inputTable);
+    return PLUS_SUCCESS;
+  }
+
+  std::vector<vtkDataArray*> inputColumns;
+  for (vtkIdType c = 0; c < numberOfColumns; ++c)
+  {
+    vtkDataArray* inputColumn = vtkDataArray::SafeDownCast(inputTable.GetColumn(c));
+    if (inputColumn == NULL || inputColumn->GetNumberOfComponents() != 1)
+    {
+      LOG_ERROR("PlusPlotter::DecimateTableMinMax failed: column " << c << " is not a numeric column with a single component");
+      return PLUS_FAIL;
+    }
+    inputColumns.push_back(inputColumn);
+  }
+
+  // Each bin is represented by two output rows
+  vtkIdType numberOfOutputRows = 2 * static_cast<vtkIdType>(numberOfBins);
+  outputTable.Initialize();
+  std::vector<vtkDataArray*> outputColumns;
+  for (vtkIdType c = 0; c < numberOfColumns; ++c)
+  {
+    vtkSmartPointer<vtkDataArray> outputColumn = vtkSmartPointer<vtkDataArray>::Take(inputColumns[c]->NewInstance());
+    outputColumn->SetName(inputColumns[c]->GetName());
+    outputColumn->SetNumberOfTuples(numberOfOutputRows);
+    outputTable.AddColumn(outputColumn);
+    outputColumns.push_back(outputColumn);
+  }
+
+  for (unsigned int bin = 0; bin < numberOfBins; ++bin)
+  {
+    vtkIdType firstRow = (numberOfRows * bin) / numberOfBins;
+    vtkIdType lastRow = (numberOfRows * (bin + 1)) / numberOfBins - 1;
+    for (vtkIdType c = 0; c < numberOfColumns; ++c)
+    {
+      if (c == xColumnIndex)
+      {
+        outputColumns[c]->SetTuple1(2 * bin, inputColumns[c]->GetTuple1(firstRow));
+        outputColumns[c]->SetTuple1(2 * bin + 1, inputColumns[c]->GetTuple1(lastRow));
+        continue;
+      }
+      vtkIdType minRow = firstRow;
+      vtkIdType maxRow = firstRow;
+      for (vtkIdType r = firstRow + 1; r <= lastRow; ++r)
+      {
+        double value = inputColumns[c]->GetTuple1(r);
+        if (value < inputColumns[c]->GetTuple1(minRow))
+        {
+          minRow = r;
+        }
+        if (value > inputColumns[c]->GetTuple1(maxRow))
+        {
+          maxRow = r;
+        }
+      }
+      outputColumns[c]->SetTuple1(2 * bin, inputColumns[c]->GetTuple1(std::min(minRow, maxRow)));
+      outputColumns[c]->SetTuple1(2 * bin + 1, inputColumns[c]->GetTuple1(std::max(minRow, maxRow)));
+    }
+  }
+
+  return PLUS_SUCCESS;
+}
+
 //----------------------------------------------------------------------------
 PlusStatus PlusPlotter::WriteHistogramChartToFile(const std::string& chartTitle,
     vtkTable& inputTable,
@@ -129,18 +243,23 @@ PlusStatus PlusPlotter::WriteChartToFile(vtkContextView& view,
     int imageSize[2],
     const std::string& outputImageFilename)
 {
-  vtkSmartPointer<vtkRenderWindow> renderWindow = vtkSmartPointer<vtkRenderWindow>::New();
-  renderWindow->AddRenderer(view.GetRenderer());
-  renderWindow->SetSize(imageSize);
-  renderWindow->OffScreenRenderingOn();
-
-  vtkSmartPointer<vtkWindowToImageFilter> windowToImageFilter = vtkSmartPointer<vtkWindowToImageFilter>::New();
-  windowToImageFilter->SetInput(renderWindow);
-  windowToImageFilter->Update();
+  vtkSmartPointer<vtkImageData> chartImage = vtkSmartPointer<vtkImageData>::New();
+  {
+    std::lock_guard<std::mutex> renderingLock(ChartRenderingMutex);
+    vtkSmartPointer<vtkRenderWindow> renderWindow = vtkSmartPointer<vtkRenderWindow>::New();
+    renderWindow->AddRenderer(view.GetRenderer());
+    renderWindow->SetSize(imageSize);
+    renderWindow->OffScreenRenderingOn();
+
+    vtkSmartPointer<vtkWindowToImageFilter> windowToImageFilter = vtkSmartPointer<vtkWindowToImageFilter>::New();
+    windowToImageFilter->SetInput(renderWindow);
+    windowToImageFilter->Update();
+    chartImage->ShallowCopy(windowToImageFilter->GetOutput());
+  }
 
   vtkSmartPointer<vtkPNGWriter> writer = vtkSmartPointer<vtkPNGWriter>::New();
   writer->SetFileName(outputImageFilename.c_str());
-  writer->SetInputData(windowToImageFilter->GetOutput());
+  writer->SetInputData(chartImage);
   writer->Write();
 
   return PLUS_SUCCESS;
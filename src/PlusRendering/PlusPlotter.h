@@ -12,6 +12,9 @@ See License.txt for details.
 // Local includes
 #include "PlusCommon.h"
 
+// STL includes
+#include <future>
+
 class vtkTable;
 class vtkContextView;
 
@@ -37,6 +40,28 @@ public:
                                          int imageSize[2],
                                          const std::string& outputImageFilename);
 
+  /*!
+    Write line plot to PNG file in a worker thread (see PlusWorkerPool).
+    The table is decimated to the image width (see DecimateTableMinMax) before the call returns, so the input table can be
+    modified or reused while the chart is written. Wait for the result with PlusWorkerPool::Wait before using the image file.
+  */
+  static std::future<PlusStatus> WriteLineChartToFileAsync(const std::string& chartTitle,
+      const std::string& yAxisText,
+      vtkTable& inputTable,
+      int xColumnIndex,
+      int y1ColumnIndex,
+      int y2ColumnIndex,
+      int imageSize[2],
+      const std::string& outputImageFilename);
+
+  /*!
+    Reduce the number of rows of a table for plotting. The rows are split into numberOfBins groups of consecutive rows and
+    the minimum and maximum of each column are kept from each group, in their original order, so that spikes remain visible
+    in the chart. The x column value of the first and last row of each group is used. If the table has no more than
+    2*numberOfBins rows then it is copied without decimation.
+  */
+  static PlusStatus DecimateTableMinMax(vtkTable& inputTable, int xColumnIndex, unsigned int numberOfBins, vtkTable& outputTable);
+
   /*! Compute histogram and write to PNG file */
   static PlusStatus WriteHistogramChartToFile(const std::string& chartTitle,
       vtkTable& inputTable,
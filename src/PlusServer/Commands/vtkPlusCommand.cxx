@@ -21,6 +21,7 @@ vtkPlusCommand::vtkPlusCommand()
   , ClientId(0)
   , Id(0)
   , RespondWithCommandMessage(true)
+  , SubscriptionRequest(SUBSCRIPTION_UNCHANGED)
 {
 }
 
@@ -48,6 +49,11 @@ PlusStatus vtkPlusCommand::ReadConfiguration(vtkXMLDataElement* aConfig)
   {
     return PLUS_FAIL;
   }
+  const char* subscribe = aConfig->GetAttribute("Subscribe");
+  if (subscribe != NULL)
+  {
+    this->SubscriptionRequest = (STRCASECMP(subscribe, "TRUE") == 0 ? SUBSCRIPTION_SUBSCRIBE : SUBSCRIPTION_UNSUBSCRIBE);
+  }
   return PLUS_SUCCESS;
 }
 
@@ -74,6 +80,10 @@ PlusStatus vtkPlusCommand::WriteConfiguration(vtkXMLDataElement* aConfig)
       aConfig->SetAttribute("Name", cmdNames.front().c_str());
     }
   }
+  if (this->SubscriptionRequest != SUBSCRIPTION_UNCHANGED)
+  {
+    aConfig->SetAttribute("Subscribe", this->SubscriptionRequest == SUBSCRIPTION_SUBSCRIBE ? "TRUE" : "FALSE");
+  }
   return PLUS_SUCCESS;
 }
 
@@ -115,7 +125,7 @@ vtkPlusDataCollector* vtkPlusCommand::GetDataCollector()
 }
 
 //----------------------------------------------------------------------------
-vtkIGSIOTransformRepository* vtkPlusCommand::GetTransformRepository()
+vtkSmartPointer<vtkIGSIOTransformRepository> vtkPlusCommand::GetTransformRepository()
 {
   if (this->CommandProcessor == NULL)
   {
@@ -130,7 +140,7 @@ vtkIGSIOTransformRepository* vtkPlusCommand::GetTransformRepository()
     return NULL;
   }
 
-  vtkIGSIOTransformRepository* aRepository = server->GetTransformRepository();
+  vtkSmartPointer<vtkIGSIOTransformRepository> aRepository = server->GetTransformRepository();
   if (aRepository == NULL)
   {
     LOG_ERROR("CommandProcessor::PlusServer::TransformRepository is invalid");
@@ -139,6 +149,17 @@ vtkIGSIOTransformRepository* vtkPlusCommand::GetTransformRepository()
   return aRepository;
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusCommand::UpdateTransformRepository(const PlusSharedTransformRepository::UpdateFunction& update)
+{
+  if (this->CommandProcessor == NULL || this->CommandProcessor->GetPlusServer() == NULL)
+  {
+    LOG_ERROR("CommandProcessor::PlusServer is invalid");
+    return PLUS_FAIL;
+  }
+  return this->CommandProcessor->GetPlusServer()->UpdateTransformRepository(update);
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusCommand::ValidateName()
 {
@@ -268,4 +289,40 @@ void vtkPlusCommand::QueueCommandResponse(PlusStatus status, const std::string&
     commandResponse->SetParameters(*replyMetaData);
   }
   this->CommandResponseQueue.push_back(commandResponse);
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusCommand::QueueCachedCommandResponse(const std::string& cacheKey, const std::string& replyVersion, PlusStatus& status)
+{
+  if (cacheKey.empty() || replyVersion.empty() || this->CommandProcessor == NULL)
+  {
+    return false;
+  }
+  vtkSmartPointer<vtkPlusCommandRTSCommandResponse> commandResponse = vtkSmartPointer<vtkPlusCommandRTSCommandResponse>::New();
+  if (!this->CommandProcessor->GetCachedCommandReply(cacheKey, replyVersion, commandResponse))
+  {
+    return false;
+  }
+  commandResponse->SetClientId(this->ClientId);
+  commandResponse->SetOriginalId(this->Id);
+  commandResponse->SetDeviceName(this->DeviceName);
+  commandResponse->SetCommandName(this->GetName());
+  commandResponse->SetRespondWithCommandMessage(this->RespondWithCommandMessage);
+  this->CommandResponseQueue.push_back(commandResponse);
+  status = commandResponse->GetStatus();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusCommand::CacheLastCommandResponse(const std::string& cacheKey, const std::string& replyVersion)
+{
+  if (cacheKey.empty() || replyVersion.empty() || this->CommandProcessor == NULL || this->CommandResponseQueue.empty())
+  {
+    return;
+  }
+  vtkPlusCommandRTSCommandResponse* commandResponse = vtkPlusCommandRTSCommandResponse::SafeDownCast(this->CommandResponseQueue.back());
+  if (commandResponse != NULL)
+  {
+    this->CommandProcessor->SetCachedCommandReply(cacheKey, replyVersion, commandResponse);
+  }
 }
\ No newline at end of file
@@ -14,6 +14,7 @@ class vtkPlusCommandProcessor;
 //class vtkIGSIOTransformRepository;
 class vtkImageData;
 
+#include "PlusSharedTransformRepository.h"
 #include "vtkPlusCommandResponse.h"
 
 // igtl includes
@@ -44,6 +45,37 @@ public:
   */
   virtual PlusStatus Execute() = 0;
 
+  /*!
+    Returns true if the command completes quickly (e.g., it only reads the current state of the server).
+    The command processor executes lightweight commands in a separate fast lane, so that they are not delayed by
+    long-running commands, such as volume reconstruction.
+  */
+  virtual bool IsLightweight() const { return false; }
+
+  /*!
+    Identifies the command and the parameters that its reply depends on (not the client or the command id).
+    Commands that return a non-empty key can cache their replies and can be subscribed to (see Subscribe attribute).
+  */
+  virtual std::string GetReplyCacheKey() { return ""; }
+
+  /*!
+    Identifies the state of the server that the reply depends on (e.g., the device configuration).
+    The reply of the command is the same as long as the version does not change. Empty if the version is not known.
+  */
+  virtual std::string GetReplyVersion() { return ""; }
+
+  /*!
+    Subscription change requested by the Subscribe attribute of the command.
+    A subscribed command is executed again and its reply is pushed to the client whenever its reply version changes.
+  */
+  enum SubscriptionRequestType
+  {
+    SUBSCRIPTION_UNCHANGED,
+    SUBSCRIPTION_SUBSCRIBE,
+    SUBSCRIPTION_UNSUBSCRIBE
+  };
+  vtkGetMacro(SubscriptionRequest, SubscriptionRequestType);
+
   /*! Read command parameters from XML */
   virtual PlusStatus ReadConfiguration(vtkXMLDataElement* aConfig);
 
@@ -132,8 +164,11 @@ protected:
   /*! Convenience function for getting a pointer to the data collector */
   virtual vtkPlusDataCollector* GetDataCollector();
 
-  /*! Convenience function for getting a pointer to the transform repository */
-  virtual vtkIGSIOTransformRepository* GetTransformRepository();
+  /*! Convenience function for getting the current snapshot of the transform repository. The snapshot must not be modified. */
+  virtual vtkSmartPointer<vtkIGSIOTransformRepository> GetTransformRepository();
+
+  /*! Convenience function for modifying the transform repository of the server (see PlusSharedTransformRepository::Update) */
+  virtual PlusStatus UpdateTransformRepository(const PlusSharedTransformRepository::UpdateFunction& update);
 
   /*! Check if the command name is in the list of command names */
   PlusStatus ValidateName();
@@ -141,6 +176,16 @@ protected:
   /*! Helper method to add a command response to the response queue */
   void QueueCommandResponse(PlusStatus status, const std::string& message, const std::string& error = "", const igtl::MessageBase::MetaDataMap* metaData = nullptr);
 
+  /*!
+    Add the cached reply of the command to the response queue if there is one for this key and version.
+    \param status Status of the cached reply
+    \return False if there is no cached reply (or key or version is empty), the reply must be computed then
+  */
+  bool QueueCachedCommandResponse(const std::string& cacheKey, const std::string& replyVersion, PlusStatus& status);
+
+  /*! Store the last queued command response for reuse by later commands with the same key, if the version is not empty */
+  void CacheLastCommandResponse(const std::string& cacheKey, const std::string& replyVersion);
+
   vtkPlusCommand();
   virtual ~vtkPlusCommand();
 
@@ -158,6 +203,8 @@ protected:
   /*! Should we respond using igtl::StringMessage or igtl::CommandMessage */
   bool RespondWithCommandMessage;
 
+  SubscriptionRequestType SubscriptionRequest;
+
   /*!
     Name of the command. One command class may handle multiple commands, this Name member defines
     which of the supported command should be executed.
@@ -145,6 +145,31 @@ PlusStatus vtkPlusGetImageCommand::ExecuteImageReply(std::string& outErrorString
     std::string deviceIdStr(plusDevice->GetDeviceId()); // SLD
     if (requestedDeviceId.compare(deviceIdStr) == 0)
     {
+      // Static images (e.g., CT volumes) are often requested repeatedly, reuse the message that was packed for the same image version
+      std::string imageVersion;
+      if (plusDevice->GetImageVersion(requestedImageId, std::string("Ras"), imageVersion) == PLUS_SUCCESS)
+      {
+        int headerVersion = IGTL_HEADER_VERSION_1;
+        PlusIgtlClientInfo clientInfo;
+        if (this->CommandProcessor->GetPlusServer()->GetClientInfo(this->ClientId, clientInfo) == PLUS_SUCCESS)
+        {
+          headerVersion = clientInfo.GetClientHeaderVersion();
+        }
+        igtl::MessageBase::Pointer packedMessage;
+        if (this->CommandProcessor->GetCachedImageReply(this->GetImageId(), headerVersion, imageVersion, packedMessage))
+        {
+          LOG_DEBUG("Image " << this->GetImageId() << " has not changed, reply from cache");
+          vtkSmartPointer<vtkPlusCommandImageResponse> imageResponse = vtkSmartPointer<vtkPlusCommandImageResponse>::New();
+          this->CommandResponseQueue.push_back(imageResponse);
+          imageResponse->SetClientId(this->ClientId);
+          imageResponse->SetImageName(this->GetImageId());
+          imageResponse->SetImageVersion(imageVersion);
+          imageResponse->SetPackedMessage(packedMessage);
+          imageResponse->SetRespondWithCommandMessage(this->RespondWithCommandMessage);
+          return PLUS_SUCCESS;
+        }
+      }
+
       std::string assignedImageId("");
       if (plusDevice->GetImage(requestedImageId, assignedImageId, std::string("Ras"), imageData, ijkToRasTransform))
       {
@@ -161,6 +186,7 @@ PlusStatus vtkPlusGetImageCommand::ExecuteImageReply(std::string& outErrorString
         imageResponse->SetImageData(imageData);
         imageResponse->SetRespondWithCommandMessage(this->RespondWithCommandMessage);
         imageResponse->SetImageToReferenceTransform(ijkToRasTransform);
+        imageResponse->SetImageVersion(imageVersion);
 
         return PLUS_SUCCESS;
       }
@@ -0,0 +1,108 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "vtkPlusDataCollector.h"
+#include "vtkPlusGetMemoryUsageCommand.h"
+
+vtkStandardNewMacro(vtkPlusGetMemoryUsageCommand);
+
+namespace
+{
+  static const std::string GET_MEMORY_USAGE_CMD = "GetMemoryUsage";
+}
+
+//----------------------------------------------------------------------------
+vtkPlusGetMemoryUsageCommand::vtkPlusGetMemoryUsageCommand()
+{
+  // It handles only one command, set its name by default
+  this->SetName(GET_MEMORY_USAGE_CMD);
+}
+
+//----------------------------------------------------------------------------
+vtkPlusGetMemoryUsageCommand::~vtkPlusGetMemoryUsageCommand()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusGetMemoryUsageCommand::SetNameToGetMemoryUsage()
+{
+  this->SetName(GET_MEMORY_USAGE_CMD);
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusGetMemoryUsageCommand::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusGetMemoryUsageCommand::GetCommandNames(std::list<std::string>& cmdNames)
+{
+  cmdNames.clear();
+  cmdNames.push_back(GET_MEMORY_USAGE_CMD);
+}
+
+//----------------------------------------------------------------------------
+std::string vtkPlusGetMemoryUsageCommand::GetDescription(const std::string& commandName)
+{
+  std::string desc;
+  if (commandName.empty() || igsioCommon::IsEqualInsensitive(commandName, GET_MEMORY_USAGE_CMD))
+  {
+    desc += GET_MEMORY_USAGE_CMD;
+    desc += ": Request the memory used by each buffer (items, frames, custom frame fields and timestamp report), the memory used by each device in addition to its buffers, and the total memory, in bytes.";
+  }
+  return desc;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusGetMemoryUsageCommand::Execute()
+{
+  vtkPlusDataCollector* dataCollector = this->GetDataCollector();
+  if (dataCollector == NULL)
+  {
+    this->QueueCommandResponse(PLUS_FAIL, "Command failed. See error message.", "Invalid data collector.");
+    return PLUS_FAIL;
+  }
+
+  std::vector<vtkPlusDataCollector::BufferMemoryReport> bufferReports;
+  std::map<std::string, unsigned long long> deviceInternalBytes;
+  unsigned long long totalBytes = dataCollector->GetMemoryUsage(bufferReports, deviceInternalBytes);
+
+  igtl::MessageBase::MetaDataMap metadata;
+  std::ostringstream responseMessage;
+  for (std::vector<vtkPlusDataCollector::BufferMemoryReport>::iterator it = bufferReports.begin(); it != bufferReports.end(); ++it)
+  {
+    const BufferMemoryUsage& usage = it->Usage;
+    std::ostringstream statistics;
+    statistics << "BufferSize=" << it->BufferSize
+               << ";NumberOfItems=" << it->NumberOfItems
+               << ";ItemBytes=" << usage.ItemBytes
+               << ";FrameBytes=" << usage.FrameBytes
+               << ";FieldBytes=" << usage.FieldBytes
+               << ";TimeStampReportBytes=" << usage.TimeStampReportBytes
+               << ";BytesPerItem=" << (it->BufferSize > 0 ? (usage.ItemBytes + usage.FrameBytes + usage.FieldBytes) / it->BufferSize : 0);
+    std::string key = std::string("Buffer") + it->Owner;
+    metadata[key] = std::pair<IANA_ENCODING_TYPE, std::string>(IANA_TYPE_US_ASCII, statistics.str());
+    responseMessage << key << ": " << statistics.str() << std::endl;
+  }
+  for (std::map<std::string, unsigned long long>::iterator it = deviceInternalBytes.begin(); it != deviceInternalBytes.end(); ++it)
+  {
+    if (it->second == 0)
+    {
+      continue;
+    }
+    std::string key = std::string("Device") + it->first;
+    std::string usedBytes = igsioCommon::ToString<unsigned long long>(it->second);
+    metadata[key] = std::pair<IANA_ENCODING_TYPE, std::string>(IANA_TYPE_US_ASCII, usedBytes);
+    responseMessage << key << ": " << usedBytes << std::endl;
+  }
+  metadata["TotalBytes"] = std::pair<IANA_ENCODING_TYPE, std::string>(IANA_TYPE_US_ASCII, igsioCommon::ToString<unsigned long long>(totalBytes));
+  responseMessage << "TotalBytes: " << totalBytes << std::endl;
+
+  this->QueueCommandResponse(PLUS_SUCCESS, responseMessage.str(), "", &metadata);
+  return PLUS_SUCCESS;
+}
@@ -0,0 +1,53 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __vtkPlusGetMemoryUsageCommand_h
+#define __vtkPlusGetMemoryUsageCommand_h
+
+#include "vtkPlusServerExport.h"
+
+#include "vtkPlusCommand.h"
+
+/*!
+  \class vtkPlusGetMemoryUsageCommand
+  \brief This command returns the memory used by the buffers and the devices
+
+  The memory of each buffer (items, frames, custom frame fields and timestamp report), the memory that each device uses
+  in addition to its buffers and the total are returned in the response metadata (see vtkPlusDataCollector::GetMemoryUsage).
+  The number of bytes per item of each buffer helps choosing the BufferSize of the data sources.
+
+  \ingroup PlusLibPlusServer
+ */
+class vtkPlusServerExport vtkPlusGetMemoryUsageCommand : public vtkPlusCommand
+{
+public:
+
+  static vtkPlusGetMemoryUsageCommand* New();
+  vtkTypeMacro(vtkPlusGetMemoryUsageCommand, vtkPlusCommand);
+  virtual void PrintSelf(ostream& os, vtkIndent indent);
+  virtual vtkPlusCommand* Clone() { return New(); }
+
+  /*! Executes the command  */
+  virtual PlusStatus Execute();
+
+  /*! Get all the command names that this class can execute */
+  virtual void GetCommandNames(std::list<std::string>& cmdNames);
+
+  /*! Gets the description for the specified command name. */
+  virtual std::string GetDescription(const std::string& commandName);
+
+  void SetNameToGetMemoryUsage();
+
+protected:
+  vtkPlusGetMemoryUsageCommand();
+  virtual ~vtkPlusGetMemoryUsageCommand();
+
+private:
+  vtkPlusGetMemoryUsageCommand(const vtkPlusGetMemoryUsageCommand&);
+  void operator=(const vtkPlusGetMemoryUsageCommand&);
+};
+
+#endif
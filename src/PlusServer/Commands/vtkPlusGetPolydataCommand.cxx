@@ -6,19 +6,33 @@ See License.txt for details.
 
 // Local includes
 #include "PlusConfigure.h"
+#include "vtkPlusCommandProcessor.h"
 #include "vtkPlusDataCollector.h"
 #include "vtkPlusGetPolydataCommand.h"
 
+// IGTL includes
+#include <igtl_header.h>
+
 // VTK includes
+#include <vtkCleanPolyData.h>
+#include <vtkDecimatePro.h>
 #include <vtkOBJReader.h>
 #include <vtkPLYReader.h>
 #include <vtkPolyData.h>
 #include <vtkPolyDataReader.h>
 #include <vtkSTLReader.h>
+#include <vtkTriangleFilter.h>
+
+// STL includes
+#include <cmath>
 
 namespace
 {
   static const std::string GET_POLYDATA = "GetPolydata";
+
+  /*! Each coarser level of detail keeps this fraction of the triangles of the next finer level */
+  static const double LEVEL_OF_DETAIL_TRIANGLE_FRACTION = 0.1;
+  static const int MAX_NUMBER_OF_LEVELS_OF_DETAIL = 4;
 }
 
 vtkStandardNewMacro(vtkPlusGetPolydataCommand);
@@ -26,6 +40,7 @@ vtkStandardNewMacro(vtkPlusGetPolydataCommand);
 //----------------------------------------------------------------------------
 vtkPlusGetPolydataCommand::vtkPlusGetPolydataCommand()
   : PolydataId("")
+  , NumberOfLevelsOfDetail(1)
 {
 
 }
@@ -59,6 +74,20 @@ PlusStatus vtkPlusGetPolydataCommand::ReadConfiguration(vtkXMLDataElement* aConf
     return PLUS_FAIL;
   }
 
+  if (aConfig->GetAttribute("NumberOfLevelsOfDetail") != nullptr)
+  {
+    XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, NumberOfLevelsOfDetail, aConfig);
+  }
+  else if (this->MetaData.find("NumberOfLevelsOfDetail") != this->MetaData.end())
+  {
+    this->NumberOfLevelsOfDetail = atoi(this->MetaData["NumberOfLevelsOfDetail"].second.c_str());
+  }
+  if (this->NumberOfLevelsOfDetail < 1 || this->NumberOfLevelsOfDetail > MAX_NUMBER_OF_LEVELS_OF_DETAIL)
+  {
+    LOG_ERROR("NumberOfLevelsOfDetail must be between 1 and " << MAX_NUMBER_OF_LEVELS_OF_DETAIL << " in " << this->GetName() << " command.");
+    return PLUS_FAIL;
+  }
+
   return Superclass::ReadConfiguration(aConfig);
 }
 
@@ -71,6 +100,10 @@ PlusStatus vtkPlusGetPolydataCommand::WriteConfiguration(vtkXMLDataElement* aCon
     return PLUS_FAIL;
   }
   aConfig->SetAttribute("FileName", this->GetPolydataId().c_str());
+  if (this->NumberOfLevelsOfDetail > 1)
+  {
+    aConfig->SetIntAttribute("NumberOfLevelsOfDetail", this->NumberOfLevelsOfDetail);
+  }
 
   return Superclass::WriteConfiguration(aConfig);
 }
@@ -89,7 +122,7 @@ std::string vtkPlusGetPolydataCommand::GetDescription(const std::string& command
   if (commandName.empty() || igsioCommon::IsEqualInsensitive(commandName, GET_POLYDATA))
   {
     desc += GET_POLYDATA;
-    desc += "Acquire the polydata.";
+    desc += ": Acquire the polydata. Attributes: FileName: name of the model file. NumberOfLevelsOfDetail: if more than 1 then decimated versions of the model are sent first, from the coarsest one, so that the client can show the model before the full resolution arrives.";
   }
   return desc;
 }
@@ -122,44 +155,93 @@ PlusStatus vtkPlusGetPolydataCommand::Execute()
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusGetPolydataCommand::ExecutePolydataReply(std::string& outErrorString)
 {
-  bool loaded(false);
+  std::string finalFileName(this->PolydataId);
+  if (!vtksys::SystemTools::FileExists(this->PolydataId)
+      && vtkPlusConfig::GetInstance()->FindModelPath(this->PolydataId, finalFileName) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to locate file with name " << this->PolydataId);
+    this->QueueCommandResponse(PLUS_FAIL, "Command failed.", std::string("Unable to locate file with name ") + this->PolydataId);
+    return PLUS_FAIL;
+  }
 
-  vtkSmartPointer<vtkPolyDataReader> reader = vtkSmartPointer<vtkPolyDataReader>::New();
+  // Replies are created in the order they are sent: coarsest level first, original model last
+  const std::string polydataVersion = this->GetPolydataVersion(finalFileName);
+  std::vector<vtkSmartPointer<vtkPlusCommandPolydataResponse> > responses;
+  for (int level = 0; level < this->NumberOfLevelsOfDetail; ++level)
+  {
+    vtkSmartPointer<vtkPlusCommandPolydataResponse> response = vtkSmartPointer<vtkPlusCommandPolydataResponse>::New();
+    response->SetClientId(this->ClientId);
+    response->SetPolyDataName(this->GetPolydataId());
+    response->SetPolyDataVersion(polydataVersion);
+    response->SetLevelOfDetail(level);
+    response->SetNumberOfLevelsOfDetail(this->NumberOfLevelsOfDetail);
+    response->SetRespondWithCommandMessage(this->RespondWithCommandMessage);
+    responses.push_back(response);
+  }
 
-  std::string finalFileName(this->PolydataId);
-  if (vtksys::SystemTools::FileExists(this->PolydataId))
+  // Large models are requested again by every client that connects, reuse the packed messages while the file is unchanged
+  int headerVersion = IGTL_HEADER_VERSION_1;
+  PlusIgtlClientInfo clientInfo;
+  if (this->CommandProcessor->GetPlusServer() != NULL
+      && this->CommandProcessor->GetPlusServer()->GetClientInfo(this->ClientId, clientInfo) == PLUS_SUCCESS)
+  {
+    headerVersion = clientInfo.GetClientHeaderVersion();
+  }
+  bool allLevelsCached = !polydataVersion.empty();
+  for (std::vector<vtkSmartPointer<vtkPlusCommandPolydataResponse> >::iterator it = responses.begin(); it != responses.end() && allLevelsCached; ++it)
   {
-    reader->SetFileName(this->PolydataId.c_str());
+    igtl::MessageBase::Pointer packedMessage;
+    allLevelsCached = this->CommandProcessor->GetCachedPolydataReply((*it)->GetReplyCacheKey(), headerVersion, (*it)->GetPolyDataVersion(), packedMessage);
+    (*it)->SetPackedMessage(packedMessage);
+  }
+
+  if (allLevelsCached)
+  {
+    LOG_DEBUG("Model file " << finalFileName << " has not changed, reply from cache");
   }
   else
   {
-    if (vtkPlusConfig::GetInstance()->FindModelPath(this->PolydataId, finalFileName) == PLUS_SUCCESS)
+    vtkSmartPointer<vtkPolyData> polyData;
+    if (this->ReadPolydataFile(finalFileName, polyData) != PLUS_SUCCESS)
     {
-      reader->SetFileName(finalFileName.c_str());
+      return PLUS_FAIL;
     }
-    else
+    // Each coarser level is decimated from the next finer one
+    responses.back()->SetPolyData(polyData);
+    for (int level = this->NumberOfLevelsOfDetail - 2; level >= 0; --level)
     {
-      LOG_ERROR("Unable to locate file with name " << this->PolydataId);
-      this->QueueCommandResponse(PLUS_FAIL, "Command failed.", std::string("Unable to locate file with name ") + this->PolydataId);
-      return PLUS_FAIL;
+      polyData = DecimatePolydata(polyData, LEVEL_OF_DETAIL_TRIANGLE_FRACTION);
+      responses[level]->SetPolyData(polyData);
     }
   }
+  this->CommandResponseQueue.insert(this->CommandResponseQueue.end(), responses.begin(), responses.end());
+
+  std::string name = vtksys::SystemTools::GetFilenameName(this->PolydataId);
+  this->QueueCommandResponse(PLUS_SUCCESS, name, "Command succeeded.");
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusGetPolydataCommand::ReadPolydataFile(const std::string& fileName, vtkSmartPointer<vtkPolyData>& polyData)
+{
+  vtkSmartPointer<vtkPolyDataReader> reader = vtkSmartPointer<vtkPolyDataReader>::New();
+  reader->SetFileName(fileName.c_str());
 
   vtkSmartPointer<vtkAbstractPolyDataReader> polyReader = vtkSmartPointer<vtkSTLReader>::New();
   if (!reader->IsFilePolyData())
   {
     reader = nullptr; // This flags later code to recognize that it's not a .vtk file
-    polyReader->SetFileName(finalFileName.c_str());
+    polyReader->SetFileName(fileName.c_str());
     polyReader->Update();
     if (polyReader->GetOutput() == nullptr)
     {
       polyReader = vtkSmartPointer<vtkOBJReader>::New();
-      polyReader->SetFileName(finalFileName.c_str());
+      polyReader->SetFileName(fileName.c_str());
       polyReader->Update();
       if (polyReader->GetOutput() == nullptr)
       {
         polyReader = vtkSmartPointer<vtkPLYReader>::New();
-        polyReader->SetFileName(finalFileName.c_str());
+        polyReader->SetFileName(fileName.c_str());
         polyReader->Update();
         if (polyReader->GetOutput() == nullptr)
         {
@@ -176,27 +258,52 @@ PlusStatus vtkPlusGetPolydataCommand::ExecutePolydataReply(std::string& outError
   }
 
   auto errorCode = (reader == nullptr ? polyReader->GetErrorCode() : reader->GetErrorCode());
-  vtkPolyData* polyData = (reader == nullptr ? polyReader->GetOutput() : reader->GetOutput());
+  polyData = (reader == nullptr ? polyReader->GetOutput() : reader->GetOutput());
   if (errorCode != 0)
   {
     std::stringstream ss;
     ss << "Reader threw error: " << errorCode;
     this->QueueCommandResponse(PLUS_FAIL, "PlusServer", ss.str());
+    return PLUS_FAIL;
   }
-  else if (polyData != nullptr)
+  if (polyData == nullptr)
   {
-    vtkSmartPointer<vtkPlusCommandPolydataResponse> response = vtkSmartPointer<vtkPlusCommandPolydataResponse>::New();
-    response->SetClientId(this->ClientId);
-    response->SetPolyDataName(this->GetPolydataId());
-    response->SetPolyData(polyData);
-    response->SetRespondWithCommandMessage(this->RespondWithCommandMessage);
-    this->CommandResponseQueue.push_back(response);
+    this->QueueCommandResponse(PLUS_FAIL, "Unable to load polydata.");
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
 
-    std::string name = vtksys::SystemTools::GetFilenameName(this->PolydataId);
-    this->QueueCommandResponse(PLUS_SUCCESS, name, "Command succeeded.");
-    return PLUS_SUCCESS;
+//----------------------------------------------------------------------------
+std::string vtkPlusGetPolydataCommand::GetPolydataVersion(const std::string& fileName)
+{
+  // Changes of the model file are detected by its modification time and size
+  if (!vtksys::SystemTools::FileExists(fileName, true))
+  {
+    return "";
   }
+  std::ostringstream version;
+  version << vtksys::SystemTools::CollapseFullPath(fileName) << "|" << vtksys::SystemTools::ModifiedTime(fileName)
+          << "|" << vtksys::SystemTools::FileLength(fileName);
+  return version.str();
+}
 
-  this->QueueCommandResponse(PLUS_FAIL, "Unable to load polydata.");
-  return PLUS_FAIL;
+//----------------------------------------------------------------------------
+vtkSmartPointer<vtkPolyData> vtkPlusGetPolydataCommand::DecimatePolydata(vtkPolyData* polyData, double triangleFraction)
+{
+  vtkSmartPointer<vtkTriangleFilter> triangleFilter = vtkSmartPointer<vtkTriangleFilter>::New();
+  triangleFilter->SetInputData(polyData);
+  vtkSmartPointer<vtkDecimatePro> decimator = vtkSmartPointer<vtkDecimatePro>::New();
+  decimator->SetInputConnection(triangleFilter->GetOutputPort());
+  decimator->SetTargetReduction(1.0 - triangleFraction);
+  // The target reduction cannot be reached on most anatomical meshes if the topology has to be preserved
+  decimator->PreserveTopologyOff();
+  decimator->SplittingOn();
+  // Remove the points that are not used by the remaining triangles
+  vtkSmartPointer<vtkCleanPolyData> cleaner = vtkSmartPointer<vtkCleanPolyData>::New();
+  cleaner->SetInputConnection(decimator->GetOutputPort());
+  cleaner->PointMergingOff();
+  cleaner->Update();
+  LOG_DEBUG("Model " << this->PolydataId << " is decimated from " << polyData->GetNumberOfCells() << " to " << cleaner->GetOutput()->GetNumberOfCells() << " cells");
+  return cleaner->GetOutput();
 }
\ No newline at end of file
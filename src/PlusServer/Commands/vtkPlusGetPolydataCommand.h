@@ -13,6 +13,11 @@
 /*!
   \class vtkPlusGetPolydataCommand
   \brief This command is used to answer the OpenIGTLink message GET_POLYDATA. GET_POLYDATA returns the requested polydata.
+
+  The packed POLYDATA messages are cached by the command processor until the model file changes, so large models are
+  read and packed only once, not at every client request. With NumberOfLevelsOfDetail > 1 decimated versions of the
+  model are sent before the original one (each keeping 10% of the triangles of the next finer level), so that
+  clients can show a coarse model while the full resolution is being transferred.
   \ingroup PlusLibPlusServer
  */
 class vtkPlusServerExport vtkPlusGetPolydataCommand : public vtkPlusCommand
@@ -45,15 +50,29 @@ public:
   vtkGetStdStringMacro(PolydataId);
   vtkSetStdStringMacro(PolydataId);
 
+  /*! Number of POLYDATA messages sent for the model, the last one is the original model. Between 1 and 4. */
+  vtkGetMacro(NumberOfLevelsOfDetail, int);
+  vtkSetMacro(NumberOfLevelsOfDetail, int);
+
 protected:
   /*! Prepare sending image as a response */
   PlusStatus ExecutePolydataReply(std::string& outErrorString);
 
+  /*! Read a .vtk, .stl, .obj or .ply file. Queues a failure response if the file cannot be read. */
+  PlusStatus ReadPolydataFile(const std::string& fileName, vtkSmartPointer<vtkPolyData>& polyData);
+
+  /*! Identifies the content of the model file (path, modification time, size). Empty if the file cannot be accessed. */
+  std::string GetPolydataVersion(const std::string& fileName);
+
+  /*! Reduce the number of triangles to approximately the given fraction */
+  vtkSmartPointer<vtkPolyData> DecimatePolydata(vtkPolyData* polyData, double triangleFraction);
+
   vtkPlusGetPolydataCommand();
   virtual ~vtkPlusGetPolydataCommand();
 
 protected:
   std::string PolydataId;
+  int NumberOfLevelsOfDetail;
 
 private:
   vtkPlusGetPolydataCommand(const vtkPlusGetPolydataCommand&);
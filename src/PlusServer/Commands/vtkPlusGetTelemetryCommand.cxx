@@ -0,0 +1,189 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "PlusTelemetry.h"
+#include "vtkPlusChannel.h"
+#include "vtkPlusCommandProcessor.h"
+#include "vtkPlusDataCollector.h"
+#include "vtkPlusDevice.h"
+#include "vtkPlusGetTelemetryCommand.h"
+#include "vtkPlusOpenIGTLinkServer.h"
+
+// STL includes
+#include <iomanip>
+
+vtkStandardNewMacro(vtkPlusGetTelemetryCommand);
+
+namespace
+{
+  static const std::string GET_TELEMETRY_CMD = "GetTelemetry";
+}
+
+//----------------------------------------------------------------------------
+vtkPlusGetTelemetryCommand::vtkPlusGetTelemetryCommand()
+  : Reset(false)
+{
+  // It handles only one command, set its name by default
+  this->SetName(GET_TELEMETRY_CMD);
+}
+
+//----------------------------------------------------------------------------
+vtkPlusGetTelemetryCommand::~vtkPlusGetTelemetryCommand()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusGetTelemetryCommand::SetNameToGetTelemetry()
+{
+  this->SetName(GET_TELEMETRY_CMD);
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusGetTelemetryCommand::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Reset: " << (this->Reset ? "TRUE" : "FALSE") << std::endl;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusGetTelemetryCommand::ReadConfiguration(vtkXMLDataElement* aConfig)
+{
+  if (vtkPlusCommand::ReadConfiguration(aConfig) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(Reset, aConfig);
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusGetTelemetryCommand::WriteConfiguration(vtkXMLDataElement* aConfig)
+{
+  if (vtkPlusCommand::WriteConfiguration(aConfig) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  XML_WRITE_BOOL_ATTRIBUTE(Reset, aConfig);
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusGetTelemetryCommand::GetCommandNames(std::list<std::string>& cmdNames)
+{
+  cmdNames.clear();
+  cmdNames.push_back(GET_TELEMETRY_CMD);
+}
+
+//----------------------------------------------------------------------------
+std::string vtkPlusGetTelemetryCommand::GetDescription(const std::string& commandName)
+{
+  std::string desc;
+  if (commandName.empty() || igsioCommon::IsEqualInsensitive(commandName, GET_TELEMETRY_CMD))
+  {
+    desc += GET_TELEMETRY_CMD;
+    desc += ": Request latency statistics of the acquisition, buffering, packing and sending stages and of each client, the number of failed frame lookups of each channel, and the update jitter and deadline overruns of each device. Attributes: Reset: clear the statistics after reporting them.";
+  }
+  return desc;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusGetTelemetryCommand::Execute()
+{
+  PlusTelemetry* telemetry = PlusTelemetry::Instance();
+
+  igtl::MessageBase::MetaDataMap metadata;
+  std::ostringstream responseMessage;
+  for (int stage = 0; stage < PlusTelemetry::NUMBER_OF_STAGES; ++stage)
+  {
+    const char* stageName = PlusTelemetry::GetStageName(static_cast<PlusTelemetry::Stage>(stage));
+    std::string statistics = telemetry->GetHistogram(static_cast<PlusTelemetry::Stage>(stage)).GetStatisticsString();
+    metadata[stageName] = std::pair<IANA_ENCODING_TYPE, std::string>(IANA_TYPE_US_ASCII, statistics);
+    responseMessage << stageName << ": " << statistics << std::endl;
+  }
+
+  vtkPlusOpenIGTLinkServer* server = this->CommandProcessor->GetPlusServer();
+  if (server != NULL)
+  {
+    std::map<int, std::string> clientStatistics;
+    server->GetClientSendStatistics(clientStatistics);
+    for (std::map<int, std::string>::iterator it = clientStatistics.begin(); it != clientStatistics.end(); ++it)
+    {
+      std::string key = std::string("Client") + igsioCommon::ToString<int>(it->first);
+      metadata[key] = std::pair<IANA_ENCODING_TYPE, std::string>(IANA_TYPE_US_ASCII, it->second);
+      responseMessage << key << ": " << it->second << std::endl;
+    }
+    metadata["LastProcessingTimePerFrameMs"] = std::pair<IANA_ENCODING_TYPE, std::string>(IANA_TYPE_US_ASCII, igsioCommon::ToString<int>(server->GetLastProcessingTimePerFrameMs()));
+  }
+
+  vtkPlusDataCollector* dataCollector = this->GetDataCollector();
+  if (dataCollector != NULL)
+  {
+    for (DeviceCollectionConstIterator deviceIt = dataCollector->GetDeviceConstIteratorBegin(); deviceIt != dataCollector->GetDeviceConstIteratorEnd(); ++deviceIt)
+    {
+      if ((*deviceIt)->GetNumberOfTools() > 0 || (*deviceIt)->GetNumberOfVideoSources() > 0)
+      {
+        // Shows the devices that do not keep up with the requested rate, e.g., slow serial trackers
+        std::ostringstream rates;
+        rates << std::fixed << std::setprecision(1)
+              << "RequestedHz=" << (*deviceIt)->GetAcquisitionRate()
+              << " UpdateHz=" << (*deviceIt)->GetInternalUpdateRate()
+              << " AchievedHz=" << (*deviceIt)->GetAchievedDataRate();
+        std::string key = std::string("DeviceRate") + (*deviceIt)->GetDeviceId();
+        metadata[key] = std::pair<IANA_ENCODING_TYPE, std::string>(IANA_TYPE_US_ASCII, rates.str());
+        responseMessage << key << ": " << rates.str() << std::endl;
+      }
+      PlusUpdateSchedule& updateSchedule = (*deviceIt)->GetUpdateSchedule();
+      if (updateSchedule.GetNumberOfUpdates() > 0)
+      {
+        std::string key = std::string("DeviceSchedule") + (*deviceIt)->GetDeviceId();
+        std::string statistics = updateSchedule.GetStatisticsString();
+        metadata[key] = std::pair<IANA_ENCODING_TYPE, std::string>(IANA_TYPE_US_ASCII, statistics);
+        responseMessage << key << ": " << statistics << std::endl;
+        if (this->Reset)
+        {
+          updateSchedule.ResetStatistics();
+        }
+      }
+      PlusDeviceClockModel& deviceClockModel = (*deviceIt)->GetDeviceClockModel();
+      if (deviceClockModel.GetNumberOfSamples() > 0)
+      {
+        std::string key = std::string("DeviceClock") + (*deviceIt)->GetDeviceId();
+        std::string statistics = deviceClockModel.GetStatisticsString();
+        metadata[key] = std::pair<IANA_ENCODING_TYPE, std::string>(IANA_TYPE_US_ASCII, statistics);
+        responseMessage << key << ": " << statistics << std::endl;
+        if (this->Reset)
+        {
+          deviceClockModel.ResetStatistics();
+        }
+      }
+      for (ChannelContainerConstIterator channelIt = (*deviceIt)->GetOutputChannelsStart(); channelIt != (*deviceIt)->GetOutputChannelsEnd(); ++channelIt)
+      {
+        vtkPlusChannel* channel = *channelIt;
+        if (channel->GetChannelId() == NULL)
+        {
+          continue;
+        }
+        std::string key = std::string("ChannelFrameMisses") + channel->GetChannelId();
+        std::string statistics = channel->GetFrameMissStatisticsString();
+        metadata[key] = std::pair<IANA_ENCODING_TYPE, std::string>(IANA_TYPE_US_ASCII, statistics);
+        responseMessage << key << ": " << statistics << std::endl;
+        if (this->Reset)
+        {
+          channel->ResetFrameMissCounters();
+        }
+      }
+    }
+  }
+
+  if (this->Reset)
+  {
+    telemetry->Reset();
+  }
+
+  this->QueueCommandResponse(PLUS_SUCCESS, responseMessage.str(), "", &metadata);
+  return PLUS_SUCCESS;
+}
@@ -0,0 +1,65 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __vtkPlusGetTelemetryCommand_h
+#define __vtkPlusGetTelemetryCommand_h
+
+#include "vtkPlusServerExport.h"
+
+#include "vtkPlusCommand.h"
+
+/*!
+  \class vtkPlusGetTelemetryCommand
+  \brief This command returns latency statistics of the acquisition and broadcasting pipeline
+
+  Statistics of each pipeline stage (see PlusTelemetry) and the send statistics of each connected client
+  are returned in the response metadata, as well as the requested and achieved acquisition rate of each device.
+
+  \ingroup PlusLibPlusServer
+ */
+class vtkPlusServerExport vtkPlusGetTelemetryCommand : public vtkPlusCommand
+{
+public:
+
+  static vtkPlusGetTelemetryCommand* New();
+  vtkTypeMacro(vtkPlusGetTelemetryCommand, vtkPlusCommand);
+  virtual void PrintSelf(ostream& os, vtkIndent indent);
+  virtual vtkPlusCommand* Clone() { return New(); }
+
+  /*! Executes the command  */
+  virtual PlusStatus Execute();
+
+  /*! Read command parameters from XML */
+  virtual PlusStatus ReadConfiguration(vtkXMLDataElement* aConfig);
+
+  /*! Write command parameters to XML */
+  virtual PlusStatus WriteConfiguration(vtkXMLDataElement* aConfig);
+
+  /*! Get all the command names that this class can execute */
+  virtual void GetCommandNames(std::list<std::string>& cmdNames);
+
+  /*! Gets the description for the specified command name. */
+  virtual std::string GetDescription(const std::string& commandName);
+
+  void SetNameToGetTelemetry();
+
+  /*! If enabled then the statistics are cleared after they are reported */
+  vtkSetMacro(Reset, bool);
+  vtkGetMacro(Reset, bool);
+  vtkBooleanMacro(Reset, bool);
+
+protected:
+  vtkPlusGetTelemetryCommand();
+  virtual ~vtkPlusGetTelemetryCommand();
+
+  bool Reset;
+
+private:
+  vtkPlusGetTelemetryCommand(const vtkPlusGetTelemetryCommand&);
+  void operator=(const vtkPlusGetTelemetryCommand&);
+};
+
+#endif
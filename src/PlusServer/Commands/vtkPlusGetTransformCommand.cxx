@@ -91,7 +91,9 @@ PlusStatus vtkPlusGetTransformCommand::Execute()
   std::string baseMessageString = std::string("GetTransform (") + (!this->GetTransformName().empty() ? this->GetTransformName() : "undefined") + ")";
   std::string warningString;
 
-  if (this->GetTransformRepository() == NULL)
+  // All the properties of the transform are read from the same snapshot
+  vtkSmartPointer<vtkIGSIOTransformRepository> transformRepository = this->GetTransformRepository();
+  if (transformRepository == NULL)
   {
     this->QueueCommandResponse(PLUS_FAIL, "Command failed. See error message.", baseMessageString + " Failed: invalid transform repository.");
     return PLUS_FAIL;
@@ -100,20 +102,20 @@ PlusStatus vtkPlusGetTransformCommand::Execute()
   igsioTransformName aName;
   aName.SetTransformName(this->GetTransformName());
 
-  if (this->GetTransformRepository()->IsExistingTransform(aName) != PLUS_SUCCESS)
+  if (transformRepository->IsExistingTransform(aName) != PLUS_SUCCESS)
   {
     this->QueueCommandResponse(PLUS_FAIL, "Command failed. See error message.", baseMessageString + " Failed. Transform not found.");
     return PLUS_SUCCESS;
   }
 
   bool persistent;
-  this->GetTransformRepository()->GetTransformPersistent(aName, persistent);
+  transformRepository->GetTransformPersistent(aName, persistent);
   vtkSmartPointer<vtkMatrix4x4> value = vtkSmartPointer<vtkMatrix4x4>::New();
-  this->GetTransformRepository()->GetTransform(aName, value);
+  transformRepository->GetTransform(aName, value);
   std::string date;
-  this->GetTransformRepository()->GetTransformDate(aName, date);
+  transformRepository->GetTransformDate(aName, date);
   double error;
-  this->GetTransformRepository()->GetTransformError(aName, error);
+  transformRepository->GetTransformError(aName, error);
   std::ostringstream errorStringStream;
   errorStringStream << error;
 
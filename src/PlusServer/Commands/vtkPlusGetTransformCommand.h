@@ -28,6 +28,9 @@ public:
   /*! Executes the command  */
   virtual PlusStatus Execute();
 
+  /*! Only reads the current state of the server */
+  virtual bool IsLightweight() const { return true; }
+
   /*! Read command parameters from XML */
   virtual PlusStatus ReadConfiguration(vtkXMLDataElement* aConfig);
 
@@ -68,7 +68,7 @@ std::string vtkPlusGetUsParameterCommand::GetDescription(const std::string& comm
   {
     desc += GET_US_PARAMETER_CMD;
     //TODO:
-    desc += ": Get ultrasound image parameter. Attributes: UsDeviceId: ID of the ultrasound device.";
+    desc += ": Get ultrasound image parameter. Attributes: UsDeviceId: ID of the ultrasound device. Subscribe: TRUE to push the parameters whenever they change, FALSE to stop.";
   }
 
   return desc;
@@ -127,6 +127,35 @@ PlusStatus vtkPlusGetUsParameterCommand::WriteConfiguration(vtkXMLDataElement* a
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+std::string vtkPlusGetUsParameterCommand::GetReplyCacheKey()
+{
+  if (this->Name.empty())
+  {
+    return "";
+  }
+  std::string key = this->Name + "|" + this->UsDeviceId;
+  for (std::vector<std::string>::iterator paramIt = this->RequestedParameters.begin(); paramIt != this->RequestedParameters.end(); ++paramIt)
+  {
+    key += "|" + *paramIt;
+  }
+  return key;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkPlusGetUsParameterCommand::GetReplyVersion()
+{
+  vtkPlusUsDevice* usDevice = this->GetUsDevice(false);
+  if (usDevice == NULL || usDevice->GetImagingParameters() == NULL)
+  {
+    return "";
+  }
+  // The modification time is unique across objects, so a recreated device has a different version
+  std::ostringstream version;
+  version << this->GetDataCollector()->GetDeviceConfigurationVersion() << "|" << usDevice->GetImagingParameters()->GetMTime();
+  return version.str();
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusGetUsParameterCommand::Execute()
 {
@@ -144,6 +173,22 @@ PlusStatus vtkPlusGetUsParameterCommand::Execute()
     return PLUS_FAIL;
   }
 
+  // The version is read before the reply is computed, so that a reply of changing parameters is not reused
+  const std::string cacheKey = this->GetReplyCacheKey();
+  const std::string replyVersion = this->GetReplyVersion();
+  PlusStatus status = PLUS_FAIL;
+  if (this->QueueCachedCommandResponse(cacheKey, replyVersion, status))
+  {
+    return status;
+  }
+  status = this->ExecuteRequest();
+  this->CacheLastCommandResponse(cacheKey, replyVersion);
+  return status;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusGetUsParameterCommand::ExecuteRequest()
+{
   vtkPlusUsDevice* usDevice = GetUsDevice();
   if (usDevice == NULL)
   {
@@ -171,7 +216,7 @@ PlusStatus vtkPlusGetUsParameterCommand::Execute()
       {
         std::stringstream ss;
         std::vector<double> numbers = imagingParameters->GetTimeGainCompensation();
-        for (std::vector<double>::iterator numberIt; numberIt != numbers.begin(); numberIt != numbers.end())
+        for (std::vector<double>::iterator numberIt = numbers.begin(); numberIt != numbers.end(); ++numberIt)
         {
           ss << *numberIt << " ";
         }
@@ -267,12 +312,15 @@ PlusStatus vtkPlusGetUsParameterCommand::Execute()
 }
 
 //----------------------------------------------------------------------------
-vtkPlusUsDevice* vtkPlusGetUsParameterCommand::GetUsDevice()
+vtkPlusUsDevice* vtkPlusGetUsParameterCommand::GetUsDevice(bool logErrors/*=true*/)
 {
   vtkPlusDataCollector* dataCollector = GetDataCollector();
   if (dataCollector == NULL)
   {
-    LOG_ERROR("Data collector is invalid");
+    if (logErrors)
+    {
+      LOG_ERROR("Data collector is invalid");
+    }
     return NULL;
   }
   vtkPlusUsDevice* usDevice = NULL;
@@ -282,7 +330,10 @@ vtkPlusUsDevice* vtkPlusGetUsParameterCommand::GetUsDevice()
     vtkPlusDevice* device = NULL;
     if (dataCollector->GetDevice(device, this->UsDeviceId) != PLUS_SUCCESS)
     {
-      LOG_ERROR("No ultrasound device has been found by the name " << this->UsDeviceId);
+      if (logErrors)
+      {
+        LOG_ERROR("No ultrasound device has been found by the name " << this->UsDeviceId);
+      }
       return NULL;
     }
     // device found
@@ -290,7 +341,10 @@ vtkPlusUsDevice* vtkPlusGetUsParameterCommand::GetUsDevice()
     if (usDevice == NULL)
     {
       // wrong type
-      LOG_ERROR("The specified device " << this->UsDeviceId << " is not UsDevice");
+      if (logErrors)
+      {
+        LOG_ERROR("The specified device " << this->UsDeviceId << " is not UsDevice");
+      }
       return NULL;
     }
   }
@@ -308,7 +362,10 @@ vtkPlusUsDevice* vtkPlusGetUsParameterCommand::GetUsDevice()
     }
     if (usDevice == NULL)
     {
-      LOG_ERROR("No UsDevice has been found");
+      if (logErrors)
+      {
+        LOG_ERROR("No UsDevice has been found");
+      }
       return NULL;
     }
   }
@@ -16,6 +16,9 @@ class vtkPlusUsDevice;
 /*!
   \class vtkPlusGetUsParameterCommand
   \brief This command requests ultrasound parameter change in the client
+
+  Replies are cached until the imaging parameters of the device change. With Subscribe="TRUE" the reply is pushed
+  to the client whenever a requested parameter changes.
   \ingroup PlusLibPlusServer
  */
 class vtkPlusServerExport vtkPlusGetUsParameterCommand : public vtkPlusCommand
@@ -30,6 +33,12 @@ public:
   /*! Executes the command  */
   virtual PlusStatus Execute();
 
+  /*! Command name, device id and requested parameter names */
+  virtual std::string GetReplyCacheKey();
+
+  /*! Device configuration version and modification time of the imaging parameters of the device */
+  virtual std::string GetReplyVersion();
+
   /*! Read command parameters from XML */
   virtual PlusStatus ReadConfiguration(vtkXMLDataElement* aConfig);
 
@@ -49,7 +58,11 @@ public:
   void SetNameToGetUsParameter();
 
 protected:
-  vtkPlusUsDevice* GetUsDevice();
+  /*! Get the device with UsDeviceId, or the first ultrasound device if UsDeviceId is empty */
+  vtkPlusUsDevice* GetUsDevice(bool logErrors = true);
+
+  /*! Compute the reply from the current imaging parameters and queue it */
+  PlusStatus ExecuteRequest();
 
   vtkPlusGetUsParameterCommand();
   virtual ~vtkPlusGetUsParameterCommand();
@@ -15,7 +15,9 @@ See License.txt for details.
 #include "vtkIGSIOTransformRepository.h"
 #include "vtkPlusVolumeReconstructor.h"
 #include "vtkPlusVirtualVolumeReconstructor.h"
+#include <vtkXMLUtilities.h>
 #include <limits>
+#include <sstream>
 
 namespace
 {
@@ -26,6 +28,28 @@ namespace
   static const std::string RESUME_LIVE_RECONSTRUCTION_CMD = "ResumeVolumeReconstruction";
   static const std::string STOP_LIVE_RECONSTRUCTION_CMD = "StopVolumeReconstruction";
   static const std::string GET_LIVE_RECONSTRUCTION_SNAPSHOT_CMD = "GetVolumeReconstructionSnapshot";
+  static const std::string GET_LIVE_RECONSTRUCTION_UPDATE_CMD = "GetVolumeReconstructionUpdate";
+  static const std::string CANCEL_RECONSTRUCTION_JOB_CMD = "CancelVolumeReconstructionJob";
+
+  static const std::string RECONSTRUCTION_JOB_NAME = "VolumeReconstructionJob";
+
+  //----------------------------------------------------------------------------
+  void SetVolumeSequenceNumber(unsigned long volumeSequenceNumber, igtl::MessageBase::MetaDataMap& metadata)
+  {
+    metadata["VolumeSequenceNumber"] = std::pair<IANA_ENCODING_TYPE, std::string>(IANA_TYPE_US_ASCII, igsioCommon::ToString<unsigned long>(volumeSequenceNumber));
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Report whether the live volume is complete: insertion rate versus input rate and the number of dropped frames */
+  void SetReconstructionStatistics(const vtkPlusVirtualVolumeReconstructor::ReconstructionStatistics& statistics, igtl::MessageBase::MetaDataMap& metadata)
+  {
+    metadata["InputFrameRate"] = std::pair<IANA_ENCODING_TYPE, std::string>(IANA_TYPE_US_ASCII, igsioCommon::ToString<double>(statistics.InputFrameRate));
+    metadata["InsertionFrameRate"] = std::pair<IANA_ENCODING_TYPE, std::string>(IANA_TYPE_US_ASCII, igsioCommon::ToString<double>(statistics.InsertionFrameRate));
+    metadata["InsertedFrames"] = std::pair<IANA_ENCODING_TYPE, std::string>(IANA_TYPE_US_ASCII, igsioCommon::ToString<long>(statistics.InsertedFrames));
+    metadata["DroppedFrames"] = std::pair<IANA_ENCODING_TYPE, std::string>(IANA_TYPE_US_ASCII, igsioCommon::ToString<long>(statistics.DroppedFrames));
+    metadata["QueuedFrames"] = std::pair<IANA_ENCODING_TYPE, std::string>(IANA_TYPE_US_ASCII, igsioCommon::ToString<int>(statistics.QueuedFrames));
+    metadata["ReconstructionLatencySec"] = std::pair<IANA_ENCODING_TYPE, std::string>(IANA_TYPE_US_ASCII, igsioCommon::ToString<double>(statistics.LatencySec));
+  }
 }
 
 vtkStandardNewMacro(vtkPlusReconstructVolumeCommand);
@@ -33,6 +57,10 @@ vtkStandardNewMacro(vtkPlusReconstructVolumeCommand);
 //----------------------------------------------------------------------------
 vtkPlusReconstructVolumeCommand::vtkPlusReconstructVolumeCommand()
   : ApplyHoleFilling(true)
+  , VolumeSequenceNumber(0)
+  , Asynchronous(false)
+  , ProgressIntervalSec(0.5)
+  , PartialVolumeIntervalSec(0.0)
 {
   this->OutputOrigin[0] = UNDEFINED_VALUE;
   this->OutputOrigin[1] = UNDEFINED_VALUE;
@@ -78,6 +106,14 @@ void vtkPlusReconstructVolumeCommand::SetNameToGetSnapshot()
 {
   SetName(GET_LIVE_RECONSTRUCTION_SNAPSHOT_CMD);
 }
+void vtkPlusReconstructVolumeCommand::SetNameToGetUpdate()
+{
+  SetName(GET_LIVE_RECONSTRUCTION_UPDATE_CMD);
+}
+void vtkPlusReconstructVolumeCommand::SetNameToCancelJob()
+{
+  SetName(CANCEL_RECONSTRUCTION_JOB_CMD);
+}
 
 //----------------------------------------------------------------------------
 void vtkPlusReconstructVolumeCommand::PrintSelf(ostream& os, vtkIndent indent)
@@ -95,6 +131,8 @@ void vtkPlusReconstructVolumeCommand::GetCommandNames(std::list<std::string>& cm
   cmdNames.push_back(RESUME_LIVE_RECONSTRUCTION_CMD);
   cmdNames.push_back(STOP_LIVE_RECONSTRUCTION_CMD);
   cmdNames.push_back(GET_LIVE_RECONSTRUCTION_SNAPSHOT_CMD);
+  cmdNames.push_back(GET_LIVE_RECONSTRUCTION_UPDATE_CMD);
+  cmdNames.push_back(CANCEL_RECONSTRUCTION_JOB_CMD);
 }
 
 //----------------------------------------------------------------------------
@@ -104,7 +142,7 @@ std::string vtkPlusReconstructVolumeCommand::GetDescription(const std::string& c
   if (commandName.empty() || igsioCommon::IsEqualInsensitive(commandName, RECONSTRUCT_PRERECORDED_CMD))
   {
     desc += RECONSTRUCT_PRERECORDED_CMD;
-    desc += ": Reconstruct a volume from a file and writes the result to a file. Attributes: InputSeqFilename: name of the input sequence file name that contains the list of frames. OutputVolFilename: name of the output volume file name (optional). OutputVolDeviceName: name of the OpenIGTLink device for the IMAGE message (optional).";
+    desc += ": Reconstruct a volume from a file and writes the result to a file. Attributes: InputSeqFilename: name of the input sequence file name that contains the list of frames. OutputVolFilename: name of the output volume file name (optional). OutputVolDeviceName: name of the OpenIGTLink device for the IMAGE message (optional). Asynchronous: if TRUE then the command responds immediately with the JobId of a background job and the progress is sent in STRING messages named by the JobId (optional, default: FALSE). ProgressIntervalSec: minimum time between progress messages (optional, default: 0.5). PartialVolumeIntervalSec: if positive then the partially reconstructed volume is sent in this interval (optional, default: 0).";
   }
   if (commandName.empty() || igsioCommon::IsEqualInsensitive(commandName, START_LIVE_RECONSTRUCTION_CMD))
   {
@@ -129,7 +167,17 @@ std::string vtkPlusReconstructVolumeCommand::GetDescription(const std::string& c
   if (commandName.empty() || igsioCommon::IsEqualInsensitive(commandName, GET_LIVE_RECONSTRUCTION_SNAPSHOT_CMD))
   {
     desc += GET_LIVE_RECONSTRUCTION_SNAPSHOT_CMD;
-    desc += ": Request a snapshot of the live reconstruction result. Attributes: VolumeReconstructorDeviceId: ID of the volume reconstructor device. OutputVolFilename: name of the output volume file name (optional). OutputVolDeviceName: name of the OpenIGTLink device for the IMAGE message (optional). ApplyHoleFilling: if FALSE then holes will not be filled (optional, default: TRUE).";
+    desc += ": Request a snapshot of the live reconstruction result. Attributes: VolumeReconstructorDeviceId: ID of the volume reconstructor device. OutputVolFilename: name of the output volume file name (optional). OutputVolDeviceName: name of the OpenIGTLink device for the IMAGE message (optional). ApplyHoleFilling: if FALSE then holes will not be filled (optional, default: TRUE). The VolumeSequenceNumber of the snapshot is returned in the response metadata.";
+  }
+  if (commandName.empty() || igsioCommon::IsEqualInsensitive(commandName, GET_LIVE_RECONSTRUCTION_UPDATE_CMD))
+  {
+    desc += GET_LIVE_RECONSTRUCTION_UPDATE_CMD;
+    desc += ": Request the parts of the live reconstruction result that have changed since the client received the volume. Each changed part is sent in a separate IMAGE message. Attributes: VolumeReconstructorDeviceId: ID of the volume reconstructor device. VolumeSequenceNumber: sequence number of the volume that the client has (returned in the response metadata of the previous snapshot or update). OutputVolDeviceName: name of the OpenIGTLink device for the IMAGE messages (optional). ApplyHoleFilling: if FALSE then holes will not be filled (optional, default: TRUE).";
+  }
+  if (commandName.empty() || igsioCommon::IsEqualInsensitive(commandName, CANCEL_RECONSTRUCTION_JOB_CMD))
+  {
+    desc += CANCEL_RECONSTRUCTION_JOB_CMD;
+    desc += ": Cancel an asynchronous reconstruction from a sequence file. Attributes: JobId: id of the job, returned in the response metadata of the asynchronous ReconstructVolume command.";
   }
 
   return desc;
@@ -154,6 +202,12 @@ PlusStatus vtkPlusReconstructVolumeCommand::ReadConfiguration(vtkXMLDataElement*
   XML_READ_VECTOR_ATTRIBUTE_OPTIONAL(int, 6, OutputExtent, aConfig);
 
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(ApplyHoleFilling, aConfig);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(unsigned long, VolumeSequenceNumber, aConfig);
+
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(Asynchronous, aConfig);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, ProgressIntervalSec, aConfig);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, PartialVolumeIntervalSec, aConfig);
+  XML_READ_STRING_ATTRIBUTE_OPTIONAL(JobId, aConfig);
   return PLUS_SUCCESS;
 }
 
@@ -192,6 +246,17 @@ PlusStatus vtkPlusReconstructVolumeCommand::WriteConfiguration(vtkXMLDataElement
   }
 
   XML_WRITE_BOOL_ATTRIBUTE(ApplyHoleFilling, aConfig);
+  if (igsioCommon::IsEqualInsensitive(this->Name, GET_LIVE_RECONSTRUCTION_UPDATE_CMD))
+  {
+    aConfig->SetUnsignedLongAttribute("VolumeSequenceNumber", this->VolumeSequenceNumber);
+  }
+  if (this->Asynchronous)
+  {
+    XML_WRITE_BOOL_ATTRIBUTE(Asynchronous, aConfig);
+    aConfig->SetDoubleAttribute("ProgressIntervalSec", this->ProgressIntervalSec);
+    aConfig->SetDoubleAttribute("PartialVolumeIntervalSec", this->PartialVolumeIntervalSec);
+  }
+  XML_WRITE_STRING_ATTRIBUTE_IF_NOT_EMPTY(JobId, aConfig);
 
   return PLUS_SUCCESS;
 }
@@ -208,6 +273,19 @@ PlusStatus vtkPlusReconstructVolumeCommand::Execute()
     return PLUS_FAIL;
   }
 
+  if (igsioCommon::IsEqualInsensitive(this->Name, CANCEL_RECONSTRUCTION_JOB_CMD))
+  {
+    // Jobs are not bound to the device, so the device does not have to be found
+    std::string baseMessage = this->Name + std::string("(") + (this->JobId.empty() ? "(undefined)" : this->JobId) + std::string(")");
+    if (this->JobId.empty() || this->CommandProcessor->CancelBackgroundJob(this->JobId) != PLUS_SUCCESS)
+    {
+      this->QueueCommandResponse(PLUS_FAIL, "Command failed. See error message.", baseMessage + " The job is not running.");
+      return PLUS_FAIL;
+    }
+    this->QueueCommandResponse(PLUS_SUCCESS, baseMessage + " Cancellation of the volume reconstruction job requested.");
+    return PLUS_SUCCESS;
+  }
+
   vtkPlusVirtualVolumeReconstructor* reconstructorDevice = GetVolumeReconstructorDevice();
   if (reconstructorDevice == NULL)
   {
@@ -259,6 +337,10 @@ PlusStatus vtkPlusReconstructVolumeCommand::Execute()
       this->QueueCommandResponse(PLUS_FAIL, "Command failed. See error message.", baseMessage + " Reconstruction from sequence file failed: live volume reconstruction is in progress.");
       return PLUS_FAIL;
     }
+    if (this->Asynchronous)
+    {
+      return this->StartReconstructionJob(reconstructorDevice, outputVolFilename, outputVolDeviceName, baseMessage);
+    }
     if (reconstructorDevice->UpdateTransformRepository(this->CommandProcessor->GetPlusServer()->GetTransformRepository()) != PLUS_SUCCESS)
     {
       this->QueueCommandResponse(PLUS_FAIL, "Command failed. See error message.", baseMessage + " Reconstruction from sequence file failed: cannot get transform repository.");
@@ -313,15 +395,24 @@ PlusStatus vtkPlusReconstructVolumeCommand::Execute()
       this->QueueCommandResponse(PLUS_FAIL, "Command failed. See error message.", baseMessage + "Reconstruction stop from live frames failed: " + errorMessage);
       return PLUS_FAIL;
     }
+    igtl::MessageBase::MetaDataMap metadata;
+    vtkPlusVirtualVolumeReconstructor::ReconstructionStatistics statistics = reconstructorDevice->GetReconstructionStatistics();
+    SetReconstructionStatistics(statistics, metadata);
     reconstructorDevice->Reset(); // Clear volume
     std::string statusMessage;
     PlusStatus status = ProcessImageReply(volumeToSend, outputVolFilename, outputVolDeviceName, statusMessage);
-    this->QueueCommandResponse(status, std::string("Command ") + std::string((status == PLUS_SUCCESS ? "succeeded." : "failed. See error message.")), baseMessage + " Reconstruction from live frames completed: " + statusMessage);
+    std::ostringstream statisticsMessage;
+    statisticsMessage << ", " << statistics.InsertedFrames << " frames inserted, " << statistics.DroppedFrames << " frames dropped";
+    this->QueueCommandResponse(status, std::string("Command ") + std::string((status == PLUS_SUCCESS ? "succeeded." : "failed. See error message.")), baseMessage + " Reconstruction from live frames completed: " + statusMessage + statisticsMessage.str(), &metadata);
     return status;
   }
   else if (igsioCommon::IsEqualInsensitive(this->Name, GET_LIVE_RECONSTRUCTION_SNAPSHOT_CMD))
   {
     LOG_INFO("Volume reconstruction from live frames snapshot request, device: " << reconstructorDeviceId);
+    // The sequence number is read before the volume, so frames that are inserted meanwhile are sent again in the next update
+    igtl::MessageBase::MetaDataMap metadata;
+    SetVolumeSequenceNumber(reconstructorDevice->GetVolumeSequenceNumber(), metadata);
+    SetReconstructionStatistics(reconstructorDevice->GetReconstructionStatistics(), metadata);
     vtkSmartPointer<vtkImageData> volumeToSend = vtkSmartPointer<vtkImageData>::New();
     std::string errorMessage;
     if (reconstructorDevice->GetReconstructedVolume(volumeToSend, errorMessage, this->ApplyHoleFilling) != PLUS_SUCCESS)
@@ -331,7 +422,44 @@ PlusStatus vtkPlusReconstructVolumeCommand::Execute()
     }
     std::string statusMessage;
     PlusStatus status = ProcessImageReply(volumeToSend, outputVolFilename, outputVolDeviceName, statusMessage);
-    this->QueueCommandResponse(status, std::string("Command ") + std::string((status == PLUS_SUCCESS ? "succeeded." : "failed. See error message.")), baseMessage + " " + statusMessage);
+    this->QueueCommandResponse(status, std::string("Command ") + std::string((status == PLUS_SUCCESS ? "succeeded." : "failed. See error message.")), baseMessage + " " + statusMessage, &metadata);
+    return status;
+  }
+  else if (igsioCommon::IsEqualInsensitive(this->Name, GET_LIVE_RECONSTRUCTION_UPDATE_CMD))
+  {
+    LOG_DEBUG("Volume reconstruction from live frames update request since " << this->VolumeSequenceNumber << ", device: " << reconstructorDeviceId);
+    if (outputVolDeviceName.empty())
+    {
+      this->QueueCommandResponse(PLUS_FAIL, "Command failed. See error message.", baseMessage + " Reconstruction update request failed: OutputVolDeviceName is not specified.");
+      return PLUS_FAIL;
+    }
+    std::vector<vtkSmartPointer<vtkImageData> > changedVolumes;
+    unsigned long currentSequenceNumber = 0;
+    bool fullVolume = false;
+    std::string errorMessage;
+    if (reconstructorDevice->GetReconstructedVolumeUpdate(this->VolumeSequenceNumber, changedVolumes, currentSequenceNumber, fullVolume, errorMessage, this->ApplyHoleFilling) != PLUS_SUCCESS)
+    {
+      this->QueueCommandResponse(PLUS_FAIL, "Command failed. See error message.", baseMessage + " Reconstruction update request failed: " + errorMessage);
+      return PLUS_FAIL;
+    }
+    PlusStatus status = PLUS_SUCCESS;
+    std::string statusMessage;
+    for (std::vector<vtkSmartPointer<vtkImageData> >::iterator changedVolume = changedVolumes.begin(); changedVolume != changedVolumes.end(); ++changedVolume)
+    {
+      // Changed parts are only sent, saving them to file would overwrite each other
+      if (ProcessImageReply(*changedVolume, "", outputVolDeviceName, statusMessage) != PLUS_SUCCESS)
+      {
+        status = PLUS_FAIL;
+      }
+    }
+    igtl::MessageBase::MetaDataMap metadata;
+    SetVolumeSequenceNumber(currentSequenceNumber, metadata);
+    metadata["FullVolume"] = std::pair<IANA_ENCODING_TYPE, std::string>(IANA_TYPE_US_ASCII, fullVolume ? "TRUE" : "FALSE");
+    metadata["NumberOfChangedVolumes"] = std::pair<IANA_ENCODING_TYPE, std::string>(IANA_TYPE_US_ASCII, igsioCommon::ToString<size_t>(changedVolumes.size()));
+    SetReconstructionStatistics(reconstructorDevice->GetReconstructionStatistics(), metadata);
+    std::ostringstream updateMessage;
+    updateMessage << " " << changedVolumes.size() << (fullVolume ? " full volume" : " changed parts") << " sent as: " << outputVolDeviceName << ", volume sequence number: " << currentSequenceNumber;
+    this->QueueCommandResponse(status, std::string("Command ") + std::string((status == PLUS_SUCCESS ? "succeeded." : "failed. See error message.")), baseMessage + updateMessage.str(), &metadata);
     return status;
   }
   else if (igsioCommon::IsEqualInsensitive(this->Name, SUSPEND_LIVE_RECONSTRUCTION_CMD))
@@ -404,6 +532,123 @@ PlusStatus vtkPlusReconstructVolumeCommand::ProcessImageReply(vtkImageData* volu
   return status;
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusReconstructVolumeCommand::StartReconstructionJob(vtkPlusVirtualVolumeReconstructor* reconstructorDevice, const std::string& outputVolFilename,
+    const std::string& outputVolDeviceName, const std::string& baseMessage)
+{
+  // The job reconstructs with its own copy of the transforms and its own reconstructor (see vtkPlusVirtualVolumeReconstructor::ReconstructVolumeFromFile),
+  // so it does not interfere with the live reconstruction of the device and several jobs can run at the same time
+  vtkSmartPointer<vtkIGSIOTransformRepository> transformRepository = vtkSmartPointer<vtkIGSIOTransformRepository>::New();
+  if (transformRepository->DeepCopy(this->CommandProcessor->GetPlusServer()->GetTransformRepository(), false) != PLUS_SUCCESS)
+  {
+    this->QueueCommandResponse(PLUS_FAIL, "Command failed. See error message.", baseMessage + " Reconstruction from sequence file failed: cannot get transform repository.");
+    return PLUS_FAIL;
+  }
+
+  // This command object is reused for the next command, so the job gets its own copy
+  vtkSmartPointer<vtkPlusReconstructVolumeCommand> jobCommand = vtkSmartPointer<vtkPlusReconstructVolumeCommand>::New();
+  jobCommand->SetCommandProcessor(this->CommandProcessor);
+  jobCommand->SetClientId(this->ClientId);
+  jobCommand->SetId(this->Id);
+  jobCommand->SetName(this->Name);
+  jobCommand->SetDeviceName(this->DeviceName);
+  jobCommand->SetRespondWithCommandMessage(this->RespondWithCommandMessage);
+  jobCommand->SetInputSeqFilename(this->InputSeqFilename);
+  jobCommand->SetProgressIntervalSec(this->ProgressIntervalSec);
+  jobCommand->SetPartialVolumeIntervalSec(this->PartialVolumeIntervalSec);
+
+  std::string jobId = this->CommandProcessor->StartBackgroundJob(RECONSTRUCTION_JOB_NAME,
+                      [jobCommand, reconstructorDevice, transformRepository, outputVolFilename, outputVolDeviceName](const std::string & jobId, const std::atomic<bool>& cancelRequested)
+  {
+    jobCommand->RunReconstructionJob(reconstructorDevice, transformRepository, outputVolFilename, outputVolDeviceName, jobId, cancelRequested);
+  });
+  if (jobId.empty())
+  {
+    this->QueueCommandResponse(PLUS_FAIL, "Command failed. See error message.", baseMessage + " Reconstruction from sequence file failed: too many background jobs are running.");
+    return PLUS_FAIL;
+  }
+
+  igtl::MessageBase::MetaDataMap metadata;
+  metadata["JobId"] = std::pair<IANA_ENCODING_TYPE, std::string>(IANA_TYPE_US_ASCII, jobId);
+  this->QueueCommandResponse(PLUS_SUCCESS, baseMessage + " Reconstruction from sequence file started as job: " + jobId, "", &metadata);
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusReconstructVolumeCommand::RunReconstructionJob(vtkPlusVirtualVolumeReconstructor* reconstructorDevice, vtkIGSIOTransformRepository* transformRepository,
+    const std::string& outputVolFilename, const std::string& outputVolDeviceName, const std::string& jobId, const std::atomic<bool>& cancelRequested)
+{
+  LOG_INFO("Volume reconstruction job " << jobId << " started from sequence file: " << this->InputSeqFilename);
+  this->SendJobStatus(jobId, "IN_PROGRESS", 0.0, "");
+
+  double lastProgressTimeSec = vtkIGSIOAccurateTimer::GetSystemTime();
+  double lastPartialVolumeTimeSec = lastProgressTimeSec;
+  vtkPlusVirtualVolumeReconstructor::ReconstructionProgressCallback progressCallback =
+    [&](double progress, vtkPlusVolumeReconstructor * reconstructor) -> bool
+  {
+    if (cancelRequested)
+    {
+      return false;
+    }
+    double currentTimeSec = vtkIGSIOAccurateTimer::GetSystemTime();
+    if (this->PartialVolumeIntervalSec > 0 && !outputVolDeviceName.empty() && currentTimeSec - lastPartialVolumeTimeSec >= this->PartialVolumeIntervalSec)
+    {
+      vtkSmartPointer<vtkImageData> partialVolume = vtkSmartPointer<vtkImageData>::New();
+      std::string statusMessage;
+      if (reconstructor->ExtractGrayLevels(partialVolume) == PLUS_SUCCESS)
+      {
+        // Partial volumes are only sent, the file is written once the reconstruction is completed
+        this->ProcessImageReply(partialVolume, "", outputVolDeviceName, statusMessage);
+      }
+      lastPartialVolumeTimeSec = currentTimeSec;
+    }
+    if (currentTimeSec - lastProgressTimeSec >= this->ProgressIntervalSec)
+    {
+      this->SendJobStatus(jobId, "IN_PROGRESS", progress, "");
+      lastProgressTimeSec = currentTimeSec;
+    }
+    return true;
+  };
+
+  vtkSmartPointer<vtkImageData> volumeToSend = vtkSmartPointer<vtkImageData>::New();
+  std::string errorMessage;
+  if (reconstructorDevice->ReconstructVolumeFromFile(this->InputSeqFilename, transformRepository, volumeToSend, errorMessage, progressCallback) != PLUS_SUCCESS)
+  {
+    LOG_INFO("Volume reconstruction job " << jobId << (cancelRequested ? " cancelled" : " failed: " + errorMessage));
+    this->SendJobStatus(jobId, cancelRequested ? "CANCELLED" : "FAILED", 0.0, errorMessage);
+    return;
+  }
+
+  std::string statusMessage;
+  PlusStatus status = this->ProcessImageReply(volumeToSend, outputVolFilename, outputVolDeviceName, statusMessage);
+  LOG_INFO("Volume reconstruction job " << jobId << " completed: " << statusMessage);
+  this->SendJobStatus(jobId, status == PLUS_SUCCESS ? "COMPLETED" : "FAILED", 1.0, statusMessage);
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusReconstructVolumeCommand::SendJobStatus(const std::string& jobId, const std::string& status, double progress, const std::string& message)
+{
+  std::ostringstream statusXml;
+  statusXml << "<VolumeReconstructionJob JobId=\"" << jobId << "\" Status=\"" << status << "\" Progress=\"" << progress << "\"";
+  if (!message.empty())
+  {
+    std::ostringstream encodedMessage;
+    vtkXMLUtilities::EncodeString(message.c_str(), VTK_ENCODING_NONE, encodedMessage, VTK_ENCODING_NONE, true);
+    statusXml << " Message=\"" << encodedMessage.str() << "\"";
+  }
+  statusXml << " />";
+
+  vtkSmartPointer<vtkPlusCommandStringResponse> statusResponse = vtkSmartPointer<vtkPlusCommandStringResponse>::New();
+  statusResponse->SetClientId(this->ClientId);
+  statusResponse->SetDeviceName(jobId);
+  statusResponse->SetMessage(statusXml.str());
+  this->CommandResponseQueue.push_back(statusResponse);
+
+  PlusCommandResponseList responses;
+  this->PopCommandResponses(responses);
+  this->CommandProcessor->QueueCommandResponses(responses);
+}
+
 //----------------------------------------------------------------------------
 vtkPlusVirtualVolumeReconstructor* vtkPlusReconstructVolumeCommand::GetVolumeReconstructorDevice()
 {
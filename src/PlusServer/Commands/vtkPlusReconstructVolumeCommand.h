@@ -11,6 +11,8 @@
 
 #include "vtkPlusCommand.h"
 
+#include <atomic>
+
 class vtkPlusVolumeReconstructor;
 //class vtkIGSIOTrackedFrameList;
 //class vtkIGSIOTransformRepository;
@@ -87,12 +89,38 @@ public:
   vtkGetMacro(ApplyHoleFilling, bool);
   vtkSetMacro(ApplyHoleFilling, bool);
 
+  /*! Sequence number of the volume content that the client already has, only the parts that changed since then are sent by GetVolumeReconstructionUpdate */
+  vtkGetMacro(VolumeSequenceNumber, unsigned long);
+  vtkSetMacro(VolumeSequenceNumber, unsigned long);
+
+  /*!
+    If enabled then ReconstructVolume responds immediately with the id of a background job (in the JobId metadata of the response)
+    and the reconstruction progress is reported in STRING messages that have the job id as device name
+  */
+  vtkGetMacro(Asynchronous, bool);
+  vtkSetMacro(Asynchronous, bool);
+  vtkBooleanMacro(Asynchronous, bool);
+
+  /*! Minimum time between progress reports of an asynchronous reconstruction */
+  vtkGetMacro(ProgressIntervalSec, double);
+  vtkSetMacro(ProgressIntervalSec, double);
+
+  /*! If positive then the partially reconstructed volume is sent in this interval during an asynchronous reconstruction */
+  vtkGetMacro(PartialVolumeIntervalSec, double);
+  vtkSetMacro(PartialVolumeIntervalSec, double);
+
+  /*! Id of the asynchronous reconstruction job to be cancelled by CancelVolumeReconstructionJob */
+  vtkGetStdStringMacro(JobId);
+  vtkSetStdStringMacro(JobId);
+
   void SetNameToReconstruct();
   void SetNameToStart();
   void SetNameToStop();
   void SetNameToSuspend();
   void SetNameToResume();
   void SetNameToGetSnapshot();
+  void SetNameToGetUpdate();
+  void SetNameToCancelJob();
 
 protected:
   /*! Saves image to disk (if requested) and prepare sending image as a response (if requested) */
@@ -100,6 +128,16 @@ protected:
 
   vtkPlusVirtualVolumeReconstructor* GetVolumeReconstructorDevice();
 
+  /*! Start reconstructing the volume from InputSeqFilename on a background job of the command processor */
+  PlusStatus StartReconstructionJob(vtkPlusVirtualVolumeReconstructor* reconstructorDevice, const std::string& outputVolFilename, const std::string& outputVolDeviceName, const std::string& baseMessage);
+
+  /*! Body of the background job, the responses are passed to the command processor as they are created */
+  void RunReconstructionJob(vtkPlusVirtualVolumeReconstructor* reconstructorDevice, vtkIGSIOTransformRepository* transformRepository,
+                            const std::string& outputVolFilename, const std::string& outputVolDeviceName, const std::string& jobId, const std::atomic<bool>& cancelRequested);
+
+  /*! Queue a STRING message that reports the state of a background job and pass all pending responses to the command processor */
+  void SendJobStatus(const std::string& jobId, const std::string& status, double progress, const std::string& message);
+
   vtkPlusReconstructVolumeCommand();
   virtual ~vtkPlusReconstructVolumeCommand();
 
@@ -115,6 +153,12 @@ protected:
   int OutputExtent[6];
 
   bool ApplyHoleFilling;
+  unsigned long VolumeSequenceNumber;
+
+  bool Asynchronous;
+  double ProgressIntervalSec;
+  double PartialVolumeIntervalSec;
+  std::string JobId;
 
   vtkPlusReconstructVolumeCommand(const vtkPlusReconstructVolumeCommand&);
   void operator=(const vtkPlusReconstructVolumeCommand&);
@@ -69,22 +69,22 @@ std::string vtkPlusRequestIdsCommand::GetDescription(const std::string& commandN
   if (commandName.empty() || igsioCommon::IsEqualInsensitive(commandName, REQUEST_CHANNEL_IDS_CMD))
   {
     desc += REQUEST_CHANNEL_IDS_CMD;
-    desc += ": Request the list of channels for all devices.";
+    desc += ": Request the list of channels for all devices. Attributes: Subscribe: TRUE to push the list whenever it changes, FALSE to stop.";
   }
   if (commandName.empty() || igsioCommon::IsEqualInsensitive(commandName, REQUEST_DEVICE_IDS_CMD))
   {
     desc += REQUEST_DEVICE_IDS_CMD;
-    desc += ": Request the list of devices. Attributes: DeviceType: restrict the returned list of devices to a specific type (VirtualCapture, VirtualVolumeReconstructor, etc.)";
+    desc += ": Request the list of devices. Attributes: DeviceType: restrict the returned list of devices to a specific type (VirtualCapture, VirtualVolumeReconstructor, etc.). Subscribe: TRUE to push the list whenever it changes, FALSE to stop.";
   }
   if (commandName.empty() || igsioCommon::IsEqualInsensitive(commandName, REQUEST_INPUT_DEVICE_IDS_CMD))
   {
     desc += REQUEST_INPUT_DEVICE_IDS_CMD;
-    desc += ": Request the list of devices that are used as input to the requested device. Attributes: DeviceId: the id of the device to query.";
+    desc += ": Request the list of devices that are used as input to the requested device. Attributes: DeviceId: the id of the device to query. Subscribe: TRUE to push the list whenever it changes, FALSE to stop.";
   }
   if (commandName.empty() || igsioCommon::IsEqualInsensitive(commandName, REQUEST_DEVICE_CHANNEL_IDS_CMD))
   {
     desc += REQUEST_DEVICE_CHANNEL_IDS_CMD;
-    desc += ": Request the list of channels for a given device. Attributes: DeviceId: the id of the device to query.";
+    desc += ": Request the list of channels for a given device. Attributes: DeviceId: the id of the device to query. Subscribe: TRUE to push the list whenever it changes, FALSE to stop.";
   }
   return desc;
 }
@@ -119,6 +119,36 @@ PlusStatus vtkPlusRequestIdsCommand::WriteConfiguration(vtkXMLDataElement* aConf
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+std::string vtkPlusRequestIdsCommand::GetReplyCacheKey()
+{
+  if (this->Name.empty() || this->CommandProcessor == NULL || this->CommandProcessor->GetPlusServer() == NULL)
+  {
+    return "";
+  }
+  PlusIgtlClientInfo info;
+  if (this->CommandProcessor->GetPlusServer()->GetClientInfo(this->GetClientId(), info) != PLUS_SUCCESS)
+  {
+    return "";
+  }
+  std::ostringstream key;
+  key << this->Name << "|" << this->DeviceType << "|" << this->DeviceId << "|" << info.GetClientHeaderVersion();
+  return key.str();
+}
+
+//----------------------------------------------------------------------------
+std::string vtkPlusRequestIdsCommand::GetReplyVersion()
+{
+  vtkPlusDataCollector* dataCollector = this->GetDataCollector();
+  if (dataCollector == NULL)
+  {
+    return "";
+  }
+  std::ostringstream version;
+  version << dataCollector->GetDeviceConfigurationVersion();
+  return version.str();
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusRequestIdsCommand::Execute()
 {
@@ -128,6 +158,22 @@ PlusStatus vtkPlusRequestIdsCommand::Execute()
     return PLUS_FAIL;
   }
 
+  // The version is read before the reply is computed, so that a reply of a changing configuration is not reused
+  const std::string cacheKey = this->GetReplyCacheKey();
+  const std::string replyVersion = this->GetReplyVersion();
+  PlusStatus status = PLUS_FAIL;
+  if (this->QueueCachedCommandResponse(cacheKey, replyVersion, status))
+  {
+    return status;
+  }
+  status = this->ExecuteRequest();
+  this->CacheLastCommandResponse(cacheKey, replyVersion);
+  return status;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusRequestIdsCommand::ExecuteRequest()
+{
   vtkPlusDataCollector* dataCollector = this->GetDataCollector();
   if (dataCollector == NULL)
   {
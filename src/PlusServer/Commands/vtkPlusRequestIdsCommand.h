@@ -14,6 +14,9 @@
 /*!
   \class vtkPlusRequestDeviceIDsCommand
   \brief This command returns the list of devices to the client
+
+  Replies are cached until the device configuration changes, so that clients polling the lists do not make the
+  server walk the devices each time. With Subscribe="TRUE" the reply is pushed to the client whenever it changes.
   \ingroup PlusLibPlusServer
  */
 class vtkPlusServerExport vtkPlusRequestIdsCommand : public vtkPlusCommand
@@ -28,6 +31,15 @@ public:
   /*! Executes the command  */
   virtual PlusStatus Execute();
 
+  /*! Only reads the current state of the server */
+  virtual bool IsLightweight() const { return true; }
+
+  /*! Command name, parameters and client header version (it determines the reply format) */
+  virtual std::string GetReplyCacheKey();
+
+  /*! Device configuration version of the data collector */
+  virtual std::string GetReplyVersion();
+
   /*! Get all the command names that this class can execute */
   virtual void GetCommandNames(std::list<std::string>& cmdNames);
 
@@ -57,6 +69,9 @@ protected:
   vtkPlusRequestIdsCommand();
   virtual ~vtkPlusRequestIdsCommand();
 
+  /*! Compute the reply from the current device list and queue it */
+  PlusStatus ExecuteRequest();
+
   std::string DeviceType;
   std::string DeviceId;
 
@@ -18,6 +18,7 @@ See License.txt for details.
 #include <vtkSmartPointer.h>
 
 #include <limits>
+#include <vector>
 #include <iterator>
 #include <string>
 
@@ -67,8 +68,8 @@ std::string vtkPlusSetUsParameterCommand::GetDescription(const std::string& comm
   if (commandName.empty() || igsioCommon::IsEqualInsensitive(commandName, SET_US_PARAMETER_CMD))
   {
     desc += SET_US_PARAMETER_CMD;
-    //TODO:
-    desc += ": Set depth image parameter. Attributes: UsDeviceId: ID of the ultrasound device.";
+    desc += ": Set ultrasound imaging parameters. Attributes: UsDeviceId: ID of the ultrasound device."
+            " Nested Parameter elements with Name and Value attributes, all parameters are applied to the device in a single update.";
   }
 
   return desc;
@@ -155,48 +156,43 @@ PlusStatus vtkPlusSetUsParameterCommand::Execute()
   }
 
   std::string usDeviceId = (usDevice->GetDeviceId().empty() ? "(unknown)" : usDevice->GetDeviceId());
-  vtkPlusUsImagingParameters* imagingParameters = usDevice->GetImagingParameters();
   std::string resultString = "<CommandReply>";
   std::string error = "";
   std::map < std::string, std::pair<IANA_ENCODING_TYPE, std::string> > metaData;
   PlusStatus status = PLUS_SUCCESS;
 
+  // All valid parameters are collected and applied to the device together, so the device is reconfigured only once
+  vtkSmartPointer<vtkPlusUsImagingParameters> parameterChanges = vtkSmartPointer<vtkPlusUsImagingParameters>::New();
+  std::vector<std::string> validParameterNames;
+
   std::map<std::string, std::string>::iterator paramIt;
   for (paramIt = this->RequestedParameterChanges.begin(); paramIt != this->RequestedParameterChanges.end(); ++paramIt)
   {
     std::string parameterName = paramIt->first;
     std::string value = paramIt->second;
-    resultString += "<Parameter Name=\"" + parameterName + "\"";
 
+    bool valid = false;
     if (parameterName == vtkPlusUsImagingParameters::KEY_TGC)
     {
       std::stringstream ss;
       ss.str(value);
       std::vector<double> numbers((std::istream_iterator<double>(ss)), std::istream_iterator<double>());
-      if (numbers.size() != 3)
+      valid = (numbers.size() == 3);
+      if (valid)
       {
-        error += "Failed to parse " + parameterName + ".";
-        resultString += " Success=\"false\"/>";
-        metaData[parameterName] = std::make_pair(IANA_TYPE_US_ASCII, "FAIL");
-        status = PLUS_FAIL;
-        continue;
+        parameterChanges->SetTimeGainCompensation(numbers);
       }
-      imagingParameters->SetTimeGainCompensation(numbers);
     }
     else if (parameterName == vtkPlusUsImagingParameters::KEY_IMAGESIZE)
     {
       std::stringstream ss;
       ss.str(value);
       std::vector<int> numbers((std::istream_iterator<int>(ss)), std::istream_iterator<int>());
-      if (numbers.size() != 3)
+      valid = (numbers.size() == 3);
+      if (valid)
       {
-        error += "Failed to parse " + parameterName + ". ";
-        resultString += " Success=\"false\"/>";
-        metaData[parameterName] = std::make_pair(IANA_TYPE_US_ASCII, "FAIL");
-        status = PLUS_FAIL;
-        continue;
+        parameterChanges->SetImageSize(numbers[0], numbers[1], numbers[2]);
       }
-      imagingParameters->SetImageSize(numbers[0], numbers[1], numbers[2]);
     }
     else if (parameterName == vtkPlusUsImagingParameters::KEY_FREQUENCY
              || parameterName == vtkPlusUsImagingParameters::KEY_DEPTH
@@ -211,39 +207,51 @@ PlusStatus vtkPlusSetUsParameterCommand::Execute()
              || parameterName == vtkPlusUsImagingParameters::KEY_VOLTAGE)
     {
       // double type parameter
-      bool valid = false;
       double parameterValue = vtkVariant(value).ToDouble(&valid);
-      if (!valid)
+      if (valid)
       {
-        error += "Failed to parse " + parameterName + ". ";
-        resultString += " Success=\"false\"/>";
-        metaData[parameterName] = std::make_pair(IANA_TYPE_US_ASCII, "FAIL");
-        status = PLUS_FAIL;
-        continue;
+        parameterChanges->SetValue<double>(parameterName, parameterValue);
       }
-      imagingParameters->SetValue<double>(parameterName, parameterValue);
     }
     else
     {
       error += "Invalid parameter " + parameterName + ". ";
-      resultString += " Success=\"false\"/>";
+      resultString += "<Parameter Name=\"" + parameterName + "\" Success=\"false\"/>";
       metaData[parameterName] = std::make_pair(IANA_TYPE_US_ASCII, "FAIL");
       status = PLUS_FAIL;
       continue;
     }
 
-    if (usDevice->SetNewImagingParameters(*imagingParameters) == PLUS_FAIL)
+    if (!valid)
     {
-      error += "Failed to set " + parameterName + ". ";
-      resultString += " Success=\"false\"/>";
+      error += "Failed to parse " + parameterName + ". ";
+      resultString += "<Parameter Name=\"" + parameterName + "\" Success=\"false\"/>";
       metaData[parameterName] = std::make_pair(IANA_TYPE_US_ASCII, "FAIL");
       status = PLUS_FAIL;
       continue;
     }
 
-    resultString += " Success=\"true\"/>";
-    metaData[parameterName] = std::make_pair(IANA_TYPE_US_ASCII, "SUCCESS");
+    validParameterNames.push_back(parameterName);
   } // For each parameter
+
+  if (!validParameterNames.empty())
+  {
+    // The device either applies all changes or restores the previous parameters
+    bool applied = (usDevice->ApplyImagingParameterChanges(*parameterChanges) == PLUS_SUCCESS);
+    for (std::vector<std::string>::iterator nameIt = validParameterNames.begin(); nameIt != validParameterNames.end(); ++nameIt)
+    {
+      resultString += "<Parameter Name=\"" + *nameIt + "\" Success=\"" + (applied ? "true" : "false") + "\"/>";
+      metaData[*nameIt] = std::make_pair(IANA_TYPE_US_ASCII, applied ? "SUCCESS" : "FAIL");
+      if (!applied)
+      {
+        error += "Failed to set " + *nameIt + ". ";
+      }
+    }
+    if (!applied)
+    {
+      status = PLUS_FAIL;
+    }
+  }
   resultString += "</CommandReply>";
   
   vtkSmartPointer<vtkPlusCommandRTSCommandResponse> commandResponse = vtkSmartPointer<vtkPlusCommandRTSCommandResponse>::New();
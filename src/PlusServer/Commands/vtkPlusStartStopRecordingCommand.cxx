@@ -25,6 +25,14 @@ namespace
   static const std::string SUSPEND_CMD = "SuspendRecording";
   static const std::string RESUME_CMD = "ResumeRecording";
   static const std::string STOP_CMD = "StopRecording";
+
+  //----------------------------------------------------------------------------
+  // Back-pressure statistics of the writer of the capture device, returned in the metadata of the command response
+  void GetRecordingStatistics(vtkPlusVirtualCapture* captureDevice, igtl::MessageBase::MetaDataMap& metadata)
+  {
+    metadata["NumberOfDroppedFrames"] = std::pair<IANA_ENCODING_TYPE, std::string>(IANA_TYPE_US_ASCII, igsioCommon::ToString<long>(captureDevice->GetNumberOfDroppedFrames()));
+    metadata["NumberOfQueuedBytes"] = std::pair<IANA_ENCODING_TYPE, std::string>(IANA_TYPE_US_ASCII, igsioCommon::ToString<unsigned long long>(captureDevice->GetNumberOfQueuedBytes()));
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -292,6 +300,7 @@ PlusStatus vtkPlusStartStopRecordingCommand::Execute()
   }
 
   std::string responseMessageBase = std::string("VirtualCapture (") + captureDevice->GetDeviceId() + ") " + this->Name + " ";
+  igtl::MessageBase::MetaDataMap metadata;
   LOG_INFO("vtkPlusStartStopRecordingCommand::Execute: " << this->Name);
 
   if (igsioCommon::IsEqualInsensitive(this->Name, START_CMD))
@@ -315,7 +324,8 @@ PlusStatus vtkPlusStartStopRecordingCommand::Execute()
       return PLUS_FAIL;
     }
     captureDevice->SetEnableCapturing(true);
-    this->QueueCommandResponse(PLUS_SUCCESS, responseMessageBase + "successful.");
+    GetRecordingStatistics(captureDevice, metadata);
+    this->QueueCommandResponse(PLUS_SUCCESS, responseMessageBase + "successful.", "", &metadata);
     return PLUS_SUCCESS;
   }
   else if (igsioCommon::IsEqualInsensitive(this->Name, SUSPEND_CMD))
@@ -326,7 +336,8 @@ PlusStatus vtkPlusStartStopRecordingCommand::Execute()
       return PLUS_FAIL;
     }
     captureDevice->SetEnableCapturing(false);
-    this->QueueCommandResponse(PLUS_SUCCESS, responseMessageBase + "successful.");
+    GetRecordingStatistics(captureDevice, metadata);
+    this->QueueCommandResponse(PLUS_SUCCESS, responseMessageBase + "successful.", "", &metadata);
     return PLUS_SUCCESS;
   }
   else if (igsioCommon::IsEqualInsensitive(this->Name, RESUME_CMD))
@@ -337,7 +348,8 @@ PlusStatus vtkPlusStartStopRecordingCommand::Execute()
       return PLUS_FAIL;
     }
     captureDevice->SetEnableCapturing(true);
-    this->QueueCommandResponse(PLUS_SUCCESS, responseMessageBase + "successful.");
+    GetRecordingStatistics(captureDevice, metadata);
+    this->QueueCommandResponse(PLUS_SUCCESS, responseMessageBase + "successful.", "", &metadata);
     return PLUS_SUCCESS;
   }
   else if (igsioCommon::IsEqualInsensitive(this->Name, STOP_CMD))
@@ -360,6 +372,9 @@ PlusStatus vtkPlusStartStopRecordingCommand::Execute()
     }
 
     long numberOfFramesRecorded = captureDevice->GetTotalFramesRecorded();
+    // Statistics are reset when the file is closed
+    GetRecordingStatistics(captureDevice, metadata);
+    long numberOfDroppedFrames = captureDevice->GetNumberOfDroppedFrames();
     std::string actualOutputFilename;
     if (captureDevice->CloseFile(this->OutputFilename.c_str(), &actualOutputFilename) != PLUS_SUCCESS)
     {
@@ -368,7 +383,11 @@ PlusStatus vtkPlusStartStopRecordingCommand::Execute()
     }
     std::ostringstream ss;
     ss << "Recording " << numberOfFramesRecorded << " frames successful to file " << actualOutputFilename;
-    this->QueueCommandResponse(PLUS_SUCCESS, responseMessageBase + ss.str());
+    if (numberOfDroppedFrames > 0)
+    {
+      ss << " (" << numberOfDroppedFrames << " frames dropped because writing could not keep up with the acquisition)";
+    }
+    this->QueueCommandResponse(PLUS_SUCCESS, responseMessageBase + ss.str(), "", &metadata);
     return PLUS_SUCCESS;
   }
 
@@ -124,34 +124,44 @@ PlusStatus vtkPlusUpdateTransformCommand::Execute()
   igsioTransformName aName;
   aName.SetTransformName(this->GetTransformName());
 
-  if (this->GetTransformRepository()->IsExistingTransform(aName) == PLUS_SUCCESS)
+  // The transform is changed in a new snapshot of the repository, the frames that are being sent keep using the previous one
+  PlusStatus status = this->UpdateTransformRepository([this, &aName, &warningString](vtkIGSIOTransformRepository * repository)
   {
-    bool persistent = false;
-    this->GetTransformRepository()->GetTransformPersistent(aName, persistent);
-    if (!persistent && this->GetTransformPersistent())
+    if (repository->IsExistingTransform(aName) == PLUS_SUCCESS)
     {
-      warningString += " WARNING: replacing non-persistent transform with a persistent transform.";
+      bool persistent = false;
+      repository->GetTransformPersistent(aName, persistent);
+      if (!persistent && this->GetTransformPersistent())
+      {
+        warningString += " WARNING: replacing non-persistent transform with a persistent transform.";
+      }
     }
-  }
 
-  if (this->TransformValue)
-  {
-    this->GetTransformRepository()->SetTransform(aName, this->TransformValue);
-  }
-  else
-  {
-    warningString += " WARNING: transform is not specified.";
-  }
+    if (this->TransformValue)
+    {
+      repository->SetTransform(aName, this->TransformValue);
+    }
+    else
+    {
+      warningString += " WARNING: transform is not specified.";
+    }
 
-  this->GetTransformRepository()->SetTransformPersistent(aName, this->GetTransformPersistent());
+    repository->SetTransformPersistent(aName, this->GetTransformPersistent());
 
-  if (!this->GetTransformDate().empty())
-  {
-    this->GetTransformRepository()->SetTransformDate(aName, this->GetTransformDate());
-  }
-  if (this->GetTransformError() >= 0)
+    if (!this->GetTransformDate().empty())
+    {
+      repository->SetTransformDate(aName, this->GetTransformDate());
+    }
+    if (this->GetTransformError() >= 0)
+    {
+      repository->SetTransformError(aName, this->GetTransformError());
+    }
+    return PLUS_SUCCESS;
+  });
+  if (status != PLUS_SUCCESS)
   {
-    this->GetTransformRepository()->SetTransformError(aName, this->GetTransformError());
+    this->QueueCommandResponse(PLUS_FAIL, "Command failed. See error message.", baseMessageString + " failed: the transform repository could not be updated");
+    return PLUS_FAIL;
   }
 
   this->QueueCommandResponse(PLUS_SUCCESS, baseMessageString + " completed successfully" + warningString);
@@ -27,6 +27,9 @@ public:
   /*! Executes the command  */
   virtual PlusStatus Execute();
 
+  /*! Only reads the current state of the server */
+  virtual bool IsLightweight() const { return true; }
+
   /*! Get all the command names that this class can execute */
   virtual void GetCommandNames(std::list<std::string>& cmdNames);
 
@@ -0,0 +1,160 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "PlusIgtlClientSendQueue.h"
+
+//----------------------------------------------------------------------------
+PlusIgtlClientSendQueue::PlusIgtlClientSendQueue(int maxNumberOfMessages)
+  : MaxNumberOfMessages(maxNumberOfMessages)
+  , NumberOfDroppedMessages(0)
+  , Closed(false)
+{
+}
+
+//----------------------------------------------------------------------------
+bool PlusIgtlClientSendQueue::Push(igtl::MessageBase::Pointer message, DropPolicy policy)
+{
+  bool queued(true);
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    if (this->Closed)
+    {
+      return true;
+    }
+    queued = this->PushWithoutLock(message, policy);
+  }
+  this->MessageAvailable.notify_one();
+  return queued;
+}
+
+//----------------------------------------------------------------------------
+int PlusIgtlClientSendQueue::Push(const std::vector<igtl::MessageBase::Pointer>& messages, DropPolicy policy)
+{
+  int numberOfDroppedMessages(0);
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    if (this->Closed)
+    {
+      return 0;
+    }
+    for (std::vector<igtl::MessageBase::Pointer>::const_iterator it = messages.begin(); it != messages.end(); ++it)
+    {
+      if (it->IsNotNull() && !this->PushWithoutLock(*it, policy))
+      {
+        numberOfDroppedMessages++;
+      }
+    }
+  }
+  this->MessageAvailable.notify_one();
+  return numberOfDroppedMessages;
+}
+
+//----------------------------------------------------------------------------
+bool PlusIgtlClientSendQueue::PushWithoutLock(igtl::MessageBase::Pointer message, DropPolicy policy)
+{
+  bool dropped(false);
+  if (this->MaxNumberOfMessages > 0 && static_cast<int>(this->Items.size()) >= this->MaxNumberOfMessages && policy == DROP_OLDEST)
+  {
+    // Make room by removing the oldest message that is allowed to be dropped
+    std::deque<Item>::iterator it = this->Items.begin();
+    while (it != this->Items.end() && it->Policy != DROP_OLDEST)
+    {
+      ++it;
+    }
+    if (it == this->Items.end())
+    {
+      // Only messages that must be sent are in the queue, discard the new one
+      this->NumberOfDroppedMessages++;
+      return false;
+    }
+    this->Items.erase(it);
+    this->NumberOfDroppedMessages++;
+    dropped = true;
+  }
+
+  Item item;
+  item.Message = message;
+  item.Policy = policy;
+  item.QueuedTime = std::chrono::steady_clock::now();
+  this->Items.push_back(item);
+  return !dropped;
+}
+
+//----------------------------------------------------------------------------
+bool PlusIgtlClientSendQueue::Pop(igtl::MessageBase::Pointer& message, double timeoutSec, double* timeInQueueSec/*=NULL*/)
+{
+  std::unique_lock<std::mutex> lock(this->Mutex);
+  if (this->Items.empty() && !this->Closed && timeoutSec > 0)
+  {
+    this->MessageAvailable.wait_for(lock, std::chrono::duration<double>(timeoutSec), [this] { return !this->Items.empty() || this->Closed; });
+  }
+  if (this->Items.empty() || this->Closed)
+  {
+    return false;
+  }
+  message = this->Items.front().Message;
+  if (timeInQueueSec != NULL)
+  {
+    *timeInQueueSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - this->Items.front().QueuedTime).count();
+  }
+  this->Items.pop_front();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void PlusIgtlClientSendQueue::Close()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    this->Closed = true;
+    this->Items.clear();
+  }
+  this->MessageAvailable.notify_all();
+}
+
+//----------------------------------------------------------------------------
+int PlusIgtlClientSendQueue::GetNumberOfMessages() const
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  return static_cast<int>(this->Items.size());
+}
+
+//----------------------------------------------------------------------------
+int PlusIgtlClientSendQueue::GetNumberOfDroppedMessages() const
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  return this->NumberOfDroppedMessages;
+}
+
+//----------------------------------------------------------------------------
+const char* PlusIgtlClientSendQueue::DropPolicyToString(DropPolicy policy)
+{
+  switch (policy)
+  {
+    case DROP_OLDEST:
+      return "DropOldest";
+    case NEVER_DROP:
+      return "NeverDrop";
+  }
+  return "Unknown";
+}
+
+//----------------------------------------------------------------------------
+bool PlusIgtlClientSendQueue::DropPolicyFromString(const std::string& policyString, DropPolicy& policy)
+{
+  if (igsioCommon::IsEqualInsensitive(policyString, "DropOldest"))
+  {
+    policy = DROP_OLDEST;
+    return true;
+  }
+  if (igsioCommon::IsEqualInsensitive(policyString, "NeverDrop"))
+  {
+    policy = NEVER_DROP;
+    return true;
+  }
+  return false;
+}
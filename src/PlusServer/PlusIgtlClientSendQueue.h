@@ -0,0 +1,97 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusIgtlClientSendQueue_h
+#define __PlusIgtlClientSendQueue_h
+
+#include "vtkPlusServerExport.h"
+
+// IGTL includes
+#include <igtlMessageBase.h>
+
+// STL includes
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*!
+  \class PlusIgtlClientSendQueue
+  \brief Bounded queue of OpenIGTLink messages waiting to be sent to one client
+
+  The server pushes messages into the queue and a dedicated writer thread pops and sends them,
+  so a slow client only delays its own messages. If the queue is full then the oldest droppable
+  message is discarded. Messages that must never be dropped (e.g., command responses) are always queued.
+
+  \ingroup PlusLibPlusServer
+*/
+class vtkPlusServerExport PlusIgtlClientSendQueue
+{
+public:
+  enum DropPolicy
+  {
+    DROP_OLDEST, /*!< the message may be discarded if newer messages are waiting */
+    NEVER_DROP   /*!< the message is always sent */
+  };
+
+  explicit PlusIgtlClientSendQueue(int maxNumberOfMessages);
+
+  /*!
+    Add a message to the end of the queue.
+    \return False if a droppable message had to be discarded to make room
+  */
+  bool Push(igtl::MessageBase::Pointer message, DropPolicy policy);
+
+  /*!
+    Add all messages to the end of the queue at once, so that the writer can send them together (e.g., all messages of a frame).
+    NULL messages are ignored.
+    \return Number of droppable messages that had to be discarded to make room
+  */
+  int Push(const std::vector<igtl::MessageBase::Pointer>& messages, DropPolicy policy);
+
+  /*!
+    Remove the first message of the queue. Waits at most timeoutSec for a message to arrive.
+    \param timeInQueueSec If not NULL then it is set to the time the message spent in the queue
+    \return False if no message is available or the queue is closed
+  */
+  bool Pop(igtl::MessageBase::Pointer& message, double timeoutSec, double* timeInQueueSec = NULL);
+
+  /*! Discard all messages and wake up the writer. Messages pushed after closing are ignored. */
+  void Close();
+
+  int GetNumberOfMessages() const;
+  int GetNumberOfDroppedMessages() const;
+
+  /*! Convert between drop policy and its string representation in the configuration file */
+  static const char* DropPolicyToString(DropPolicy policy);
+  static bool DropPolicyFromString(const std::string& policyString, DropPolicy& policy);
+
+protected:
+  struct Item
+  {
+    igtl::MessageBase::Pointer Message;
+    DropPolicy Policy;
+    std::chrono::steady_clock::time_point QueuedTime;
+  };
+
+  /*! Add a message, the mutex must be locked. Returns false if a droppable message was discarded. */
+  bool PushWithoutLock(igtl::MessageBase::Pointer message, DropPolicy policy);
+
+  mutable std::mutex Mutex;
+  std::condition_variable MessageAvailable;
+  std::deque<Item> Items;
+  int MaxNumberOfMessages;
+  int NumberOfDroppedMessages;
+  bool Closed;
+
+private:
+  PlusIgtlClientSendQueue(const PlusIgtlClientSendQueue&);
+  void operator=(const PlusIgtlClientSendQueue&);
+};
+
+#endif
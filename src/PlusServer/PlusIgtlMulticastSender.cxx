@@ -0,0 +1,173 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "PlusIgtlMulticastSender.h"
+
+#ifdef _WIN32
+  #include <winsock2.h>
+  #include <ws2tcpip.h>
+#else
+  #include <arpa/inet.h>
+  #include <cerrno>
+  #include <netinet/in.h>
+  #include <string.h>
+  #include <sys/socket.h>
+  #include <unistd.h>
+#endif
+
+// STL includes
+#include <algorithm>
+#include <sstream>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  void CloseSocketDescriptor(intptr_t socketDescriptor)
+  {
+#ifdef _WIN32
+    closesocket(static_cast<SOCKET>(socketDescriptor));
+    WSACleanup();
+#else
+    close(static_cast<int>(socketDescriptor));
+#endif
+  }
+
+  //----------------------------------------------------------------------------
+  std::string GetLastSocketError()
+  {
+#ifdef _WIN32
+    std::ostringstream ss;
+    ss << "error " << WSAGetLastError();
+    return ss.str();
+#else
+    return strerror(errno);
+#endif
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusIgtlMulticastSender::PlusIgtlMulticastSender()
+  : SocketDescriptor(-1)
+  , GroupAddress(0)
+  , Port(0)
+  , SequenceNumber(0)
+{
+}
+
+//----------------------------------------------------------------------------
+PlusIgtlMulticastSender::~PlusIgtlMulticastSender()
+{
+  this->Close();
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusIgtlMulticastSender::Open(const std::string& groupAddress, int port, int timeToLive)
+{
+  this->Close();
+
+  struct in_addr address;
+  if (inet_pton(AF_INET, groupAddress.c_str(), &address) != 1 || !IN_MULTICAST(ntohl(address.s_addr)))
+  {
+    LOG_ERROR("Invalid multicast group address: " << groupAddress << ". An IPv4 address in the 224.0.0.0/4 range is expected.");
+    return PLUS_FAIL;
+  }
+  if (port <= 0 || port > 65535)
+  {
+    LOG_ERROR("Invalid multicast port: " << port);
+    return PLUS_FAIL;
+  }
+
+#ifdef _WIN32
+  WSADATA wsaData;
+  if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+  {
+    LOG_ERROR("Unable to initialize Windows sockets for multicast output");
+    return PLUS_FAIL;
+  }
+  SOCKET socketDescriptor = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if (socketDescriptor == INVALID_SOCKET)
+  {
+    LOG_ERROR("Unable to create multicast socket: " << GetLastSocketError());
+    WSACleanup();
+    return PLUS_FAIL;
+  }
+#else
+  int socketDescriptor = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if (socketDescriptor < 0)
+  {
+    LOG_ERROR("Unable to create multicast socket: " << GetLastSocketError());
+    return PLUS_FAIL;
+  }
+#endif
+
+  unsigned char ttl = static_cast<unsigned char>(std::min(std::max(timeToLive, 0), 255));
+  if (setsockopt(socketDescriptor, IPPROTO_IP, IP_MULTICAST_TTL, reinterpret_cast<const char*>(&ttl), sizeof(ttl)) != 0)
+  {
+    LOG_WARNING("Unable to set the time to live of multicast datagrams: " << GetLastSocketError());
+  }
+
+  this->SocketDescriptor = static_cast<intptr_t>(socketDescriptor);
+  this->GroupAddress = address.s_addr;
+  this->Port = htons(static_cast<uint16_t>(port));
+  this->SequenceNumber = 0;
+
+  LOG_INFO("Plus OpenIGTLink server multicasting tracking data to " << groupAddress << ":" << port);
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void PlusIgtlMulticastSender::Close()
+{
+  if (this->SocketDescriptor == -1)
+  {
+    return;
+  }
+  CloseSocketDescriptor(this->SocketDescriptor);
+  this->SocketDescriptor = -1;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusIgtlMulticastSender::Send(igtl::MessageBase* message)
+{
+  if (!this->IsOpen() || message == NULL)
+  {
+    return PLUS_FAIL;
+  }
+
+  size_t messageSize = static_cast<size_t>(message->GetBufferSize());
+  if (DATAGRAM_HEADER_SIZE + messageSize > MAX_DATAGRAM_SIZE)
+  {
+    LOG_WARNING("Unable to multicast " << message->GetMessageType() << " message (" << messageSize << " bytes): it does not fit into one datagram");
+    return PLUS_FAIL;
+  }
+
+  this->SequenceNumber++;
+  uint32_t header[2] = { htonl(DATAGRAM_MAGIC), htonl(this->SequenceNumber) };
+  this->Datagram.resize(DATAGRAM_HEADER_SIZE + messageSize);
+  memcpy(&this->Datagram[0], header, DATAGRAM_HEADER_SIZE);
+  memcpy(&this->Datagram[DATAGRAM_HEADER_SIZE], message->GetBufferPointer(), messageSize);
+
+  struct sockaddr_in destination;
+  memset(&destination, 0, sizeof(destination));
+  destination.sin_family = AF_INET;
+  destination.sin_addr.s_addr = this->GroupAddress;
+  destination.sin_port = this->Port;
+
+#ifdef _WIN32
+  int sentBytes = sendto(static_cast<SOCKET>(this->SocketDescriptor), reinterpret_cast<const char*>(&this->Datagram[0]), static_cast<int>(this->Datagram.size()), 0,
+                         reinterpret_cast<const struct sockaddr*>(&destination), sizeof(destination));
+#else
+  ssize_t sentBytes = sendto(static_cast<int>(this->SocketDescriptor), &this->Datagram[0], this->Datagram.size(), 0,
+                             reinterpret_cast<const struct sockaddr*>(&destination), sizeof(destination));
+#endif
+  if (sentBytes < 0 || static_cast<size_t>(sentBytes) != this->Datagram.size())
+  {
+    LOG_DEBUG("Unable to send multicast datagram " << this->SequenceNumber << ": " << GetLastSocketError());
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
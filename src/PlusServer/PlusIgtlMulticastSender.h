@@ -0,0 +1,77 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusIgtlMulticastSender_h
+#define __PlusIgtlMulticastSender_h
+
+#include "PlusConfigure.h"
+#include "vtkPlusServerExport.h"
+
+// IGTL includes
+#include <igtlMessageBase.h>
+
+// STL includes
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/*!
+  \class PlusIgtlMulticastSender
+  \brief Sends packed OpenIGTLink messages as UDP datagrams to a multicast group
+
+  Each datagram contains one complete OpenIGTLink message (header and body), preceded by an 8 byte header:
+  the magic number 0x504c4d43 ("PLMC") and a sequence number that is incremented for each datagram. Both are
+  unsigned 32-bit integers in network byte order. Receivers discard datagrams with a lower sequence number than
+  the last one they received for the same device name, so a pose never arrives after a newer one, and lost
+  datagrams are not retransmitted. Messages that do not fit into one datagram are not sent.
+
+  \ingroup PlusLibPlusServer
+*/
+class vtkPlusServerExport PlusIgtlMulticastSender
+{
+public:
+  static const uint32_t DATAGRAM_MAGIC = 0x504c4d43;
+  static const size_t DATAGRAM_HEADER_SIZE = 8;
+  static const size_t MAX_DATAGRAM_SIZE = 65507;
+
+  PlusIgtlMulticastSender();
+  ~PlusIgtlMulticastSender();
+
+  /*!
+    Create the UDP socket for sending to the multicast group
+    \param timeToLive Number of routers the datagrams may pass, 1 keeps them in the local network
+  */
+  PlusStatus Open(const std::string& groupAddress, int port, int timeToLive);
+
+  void Close();
+
+  bool IsOpen() const { return this->SocketDescriptor != -1; }
+
+  /*! Send the packed message in one datagram */
+  PlusStatus Send(igtl::MessageBase* message);
+
+  /*! Sequence number of the last sent datagram */
+  uint32_t GetSequenceNumber() const { return this->SequenceNumber; }
+
+protected:
+  /*! Platform socket handle, -1 if not open */
+  intptr_t SocketDescriptor;
+
+  /*! Destination address and port in network byte order */
+  uint32_t GroupAddress;
+  uint16_t Port;
+
+  uint32_t SequenceNumber;
+
+  /*! Reused buffer of the datagram being sent */
+  std::vector<unsigned char> Datagram;
+
+private:
+  PlusIgtlMulticastSender(const PlusIgtlMulticastSender&);
+  void operator=(const PlusIgtlMulticastSender&);
+};
+
+#endif
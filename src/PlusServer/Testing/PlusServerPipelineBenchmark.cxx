@@ -0,0 +1,479 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file PlusServerPipelineBenchmark.cxx
+  \brief Measures the end-to-end performance of the acquisition, mixing, capture and OpenIGTLink sending pipeline.
+
+  Each device set configuration is started the same way as in PlusServer. Saved data sources are switched to
+  repeated replay with current timestamps and their acquisition rate is multiplied by the replay speed, so that the
+  pipeline can be loaded beyond the rate of the recording. Local clients connect to the server and measure
+  the message rate, throughput and latency (from the acquisition timestamp of the frame to the reception of the
+  message) for each message type. With multiple clients the server sends each message to all of them, the reported
+  rates are the totals of all clients. CPU usage and peak memory usage of the process are reported as well, so that
+  results of different builds or configurations can be compared. With --metrics-file, the rates and the 99th percentile
+  latencies are written to a performance metrics file, which can be compared to a baseline by ComparePerformanceMetrics.
+*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "PlusPerformanceMetrics.h"
+#include "vtkIGSIOAccurateTimer.h"
+#include "vtkIGSIOTransformRepository.h"
+#include "vtkPlusDataCollector.h"
+#include "vtkPlusDevice.h"
+#include "vtkPlusOpenIGTLinkClient.h"
+#include "vtkPlusOpenIGTLinkServer.h"
+#include "vtkPlusSavedDataSource.h"
+#include "vtkPlusVirtualCapture.h"
+
+// OpenIGTLink includes
+#include <igtlMessageHeader.h>
+#include <igtlTimeStamp.h>
+
+// VTK includes
+#include <vtkObjectFactory.h>
+#include <vtkSmartPointer.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <mutex>
+
+#if defined(_WIN32)
+  #include <windows.h>
+  #include <psapi.h>
+#else
+  #include <sys/resource.h>
+#endif
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  // Total user and kernel CPU time used by the process so far, in seconds
+  double GetProcessCpuTimeSec()
+  {
+#if defined(_WIN32)
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    if (!GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime))
+    {
+      return 0.0;
+    }
+    ULARGE_INTEGER kernel, user;
+    kernel.LowPart = kernelTime.dwLowDateTime;
+    kernel.HighPart = kernelTime.dwHighDateTime;
+    user.LowPart = userTime.dwLowDateTime;
+    user.HighPart = userTime.dwHighDateTime;
+    // FILETIME is in 100ns units
+    return (kernel.QuadPart + user.QuadPart) * 1e-7;
+#else
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+      return 0.0;
+    }
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+#endif
+  }
+
+  //----------------------------------------------------------------------------
+  // Peak resident memory size of the process, in MB
+  double GetPeakMemoryUsageMb()
+  {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS memoryCounters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &memoryCounters, sizeof(memoryCounters)))
+    {
+      return 0.0;
+    }
+    return memoryCounters.PeakWorkingSetSize / (1024.0 * 1024.0);
+#else
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+      return 0.0;
+    }
+  #if defined(__APPLE__)
+    // ru_maxrss is in bytes on macOS
+    return usage.ru_maxrss / (1024.0 * 1024.0);
+  #else
+    // ru_maxrss is in kilobytes on Linux
+    return usage.ru_maxrss / 1024.0;
+  #endif
+#endif
+  }
+
+  //----------------------------------------------------------------------------
+  double GetPercentile(const std::vector<double>& sortedValues, double percentile)
+  {
+    if (sortedValues.empty())
+    {
+      return 0.0;
+    }
+    size_t index = static_cast<size_t>(percentile / 100.0 * (sortedValues.size() - 1) + 0.5);
+    return sortedValues[std::min(index, sortedValues.size() - 1)];
+  }
+}
+
+//----------------------------------------------------------------------------
+// A vtkPlusOpenIGTLinkClient that discards the received data messages and records their size and latency
+class vtkPlusOpenIGTLinkClientWithStatistics : public vtkPlusOpenIGTLinkClient
+{
+public:
+  static vtkPlusOpenIGTLinkClientWithStatistics* New();
+  vtkTypeMacro(vtkPlusOpenIGTLinkClientWithStatistics, vtkPlusOpenIGTLinkClient);
+
+  struct MessageStatistics
+  {
+    MessageStatistics() : NumberOfMessages(0), NumberOfBytes(0) {}
+    unsigned long NumberOfMessages;
+    unsigned long long NumberOfBytes;
+    std::vector<double> LatenciesSec;
+  };
+  typedef std::map<std::string, MessageStatistics> MessageStatisticsMap;
+
+  bool OnMessageReceived(igtl::MessageHeader::Pointer messageHeader)
+  {
+    std::string messageType = messageHeader->GetMessageType();
+    if (messageType == "STATUS" || messageType == "STRING" || messageType == "COMMAND" || messageType.compare(0, 4, "RTS_") == 0)
+    {
+      // Command replies are processed by the base class
+      return false;
+    }
+
+    const double receiveTimeUniversal = vtkIGSIOAccurateTimer::GetUniversalTime();
+    igtl::TimeStamp::Pointer timestamp = igtl::TimeStamp::New();
+    messageHeader->GetTimeStamp(timestamp);
+
+    {
+      igsioLockGuard<vtkIGSIORecursiveCriticalSection> socketGuard(this->SocketMutex);
+      this->ClientSocket->Skip(messageHeader->GetBodySizeToRead(), 0);
+    }
+
+    std::lock_guard<std::mutex> statisticsGuard(this->StatisticsMutex);
+    MessageStatistics& statistics = this->Statistics[messageType];
+    statistics.NumberOfMessages++;
+    statistics.NumberOfBytes += messageHeader->GetPackSize() + messageHeader->GetBodySizeToRead();
+    statistics.LatenciesSec.push_back(receiveTimeUniversal - timestamp->GetTimeStamp());
+    return true;
+  }
+
+  void ResetStatistics()
+  {
+    std::lock_guard<std::mutex> statisticsGuard(this->StatisticsMutex);
+    this->Statistics.clear();
+  }
+
+  MessageStatisticsMap GetStatistics()
+  {
+    std::lock_guard<std::mutex> statisticsGuard(this->StatisticsMutex);
+    return this->Statistics;
+  }
+
+protected:
+  vtkPlusOpenIGTLinkClientWithStatistics() {};
+  virtual ~vtkPlusOpenIGTLinkClientWithStatistics() {};
+
+  std::mutex StatisticsMutex;
+  MessageStatisticsMap Statistics;
+
+private:
+  vtkPlusOpenIGTLinkClientWithStatistics(const vtkPlusOpenIGTLinkClientWithStatistics&);
+  void operator=(const vtkPlusOpenIGTLinkClientWithStatistics&);
+};
+
+vtkStandardNewMacro(vtkPlusOpenIGTLinkClientWithStatistics);
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  PlusStatus SetUpDevices(vtkPlusDataCollector* dataCollector, double replaySpeed, bool enableCapture)
+  {
+    for (DeviceCollectionConstIterator it = dataCollector->GetDeviceConstIteratorBegin(); it != dataCollector->GetDeviceConstIteratorEnd(); ++it)
+    {
+      vtkPlusSavedDataSource* savedDataSource = vtkPlusSavedDataSource::SafeDownCast(*it);
+      if (savedDataSource != NULL)
+      {
+        // With current timestamps a new frame is added in each update, so the acquisition rate sets the replay rate
+        savedDataSource->SetUseOriginalTimestamps(false);
+        savedDataSource->SetRepeatEnabled(true);
+        if (savedDataSource->SetAcquisitionRate(savedDataSource->GetAcquisitionRate() * replaySpeed) != PLUS_SUCCESS)
+        {
+          LOG_ERROR("Failed to set acquisition rate of device " << savedDataSource->GetDeviceId());
+          return PLUS_FAIL;
+        }
+        LOG_INFO("Replaying " << savedDataSource->GetDeviceId() << " at " << savedDataSource->GetAcquisitionRate() << " fps");
+      }
+
+      vtkPlusVirtualCapture* capture = vtkPlusVirtualCapture::SafeDownCast(*it);
+      if (capture != NULL && enableCapture)
+      {
+        capture->SetEnableCapturing(true);
+      }
+    }
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  vtkSmartPointer<vtkPlusOpenIGTLinkServer> StartServer(const std::string& configFilePath, vtkPlusDataCollector* dataCollector, double replaySpeed, bool enableCapture)
+  {
+    vtkSmartPointer<vtkXMLDataElement> configRootElement = vtkSmartPointer<vtkXMLDataElement>::Take(vtkXMLUtilities::ReadElementFromFile(configFilePath.c_str()));
+    if (configRootElement == NULL)
+    {
+      LOG_ERROR("Reading device set configuration file failed: syntax error in " << configFilePath);
+      return nullptr;
+    }
+    vtkPlusConfig::GetInstance()->SetDeviceSetConfigurationData(configRootElement);
+
+    if (dataCollector->ReadConfiguration(configRootElement) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Datacollector failed to read configuration");
+      return nullptr;
+    }
+    if (SetUpDevices(dataCollector, replaySpeed, enableCapture) != PLUS_SUCCESS)
+    {
+      return nullptr;
+    }
+
+    vtkSmartPointer<vtkIGSIOTransformRepository> transformRepository = vtkSmartPointer<vtkIGSIOTransformRepository>::New();
+    if (transformRepository->ReadConfiguration(configRootElement) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Transform repository failed to read configuration");
+      return nullptr;
+    }
+
+    if (dataCollector->Connect() != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Datacollector failed to connect to devices");
+      return nullptr;
+    }
+    if (dataCollector->Start() != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Datacollector failed to start");
+      return nullptr;
+    }
+
+    for (int i = 0; i < configRootElement->GetNumberOfNestedElements(); ++i)
+    {
+      vtkXMLDataElement* serverElement = configRootElement->GetNestedElement(i);
+      if (STRCASECMP(serverElement->GetName(), "PlusOpenIGTLinkServer") != 0)
+      {
+        continue;
+      }
+      vtkSmartPointer<vtkPlusOpenIGTLinkServer> server = vtkSmartPointer<vtkPlusOpenIGTLinkServer>::New();
+      if (server->Start(dataCollector, transformRepository, serverElement, configFilePath) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to start OpenIGTLink server");
+        return nullptr;
+      }
+      return server;
+    }
+
+    LOG_ERROR("No PlusOpenIGTLinkServer element is found in " << configFilePath);
+    return nullptr;
+  }
+
+  //----------------------------------------------------------------------------
+  void WaitAndProcessCommands(vtkPlusOpenIGTLinkServer* server, double waitTimeSec)
+  {
+    const double commandQueuePollIntervalSec = 0.010;
+    const double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+    while (vtkIGSIOAccurateTimer::GetSystemTime() < startTime + waitTimeSec)
+    {
+      server->ProcessPendingCommands();
+      vtkIGSIOAccurateTimer::DelayWithEventProcessing(commandQueuePollIntervalSec);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Add the statistics of a client to the statistics of all clients */
+  void MergeStatistics(const vtkPlusOpenIGTLinkClientWithStatistics::MessageStatisticsMap& clientStatistics, vtkPlusOpenIGTLinkClientWithStatistics::MessageStatisticsMap& statistics)
+  {
+    for (vtkPlusOpenIGTLinkClientWithStatistics::MessageStatisticsMap::const_iterator it = clientStatistics.begin(); it != clientStatistics.end(); ++it)
+    {
+      vtkPlusOpenIGTLinkClientWithStatistics::MessageStatistics& merged = statistics[it->first];
+      merged.NumberOfMessages += it->second.NumberOfMessages;
+      merged.NumberOfBytes += it->second.NumberOfBytes;
+      merged.LatenciesSec.insert(merged.LatenciesSec.end(), it->second.LatenciesSec.begin(), it->second.LatenciesSec.end());
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus RunBenchmark(const std::string& inputConfigFileName, double replaySpeed, bool enableCapture, double warmUpTimeSec, double measurementTimeSec,
+                          int numberOfClients, PlusPerformanceMetrics& metrics)
+  {
+    std::string configFilePath = inputConfigFileName;
+    if (!vtksys::SystemTools::FileExists(configFilePath.c_str(), true))
+    {
+      configFilePath = vtkPlusConfig::GetInstance()->GetDeviceSetConfigurationPath(inputConfigFileName);
+      if (!vtksys::SystemTools::FileExists(configFilePath.c_str(), true))
+      {
+        LOG_ERROR("Reading device set configuration file failed: " << inputConfigFileName << " does not exist in the current directory or in " << vtkPlusConfig::GetInstance()->GetDeviceSetConfigurationDirectory());
+        return PLUS_FAIL;
+      }
+    }
+
+    // The server keeps a raw pointer to the data collector, so it must outlive the server
+    vtkSmartPointer<vtkPlusDataCollector> dataCollector = vtkSmartPointer<vtkPlusDataCollector>::New();
+    vtkSmartPointer<vtkPlusOpenIGTLinkServer> server = StartServer(configFilePath, dataCollector, replaySpeed, enableCapture);
+    if (server == nullptr)
+    {
+      dataCollector->Stop();
+      dataCollector->Disconnect();
+      return PLUS_FAIL;
+    }
+
+    PlusStatus status = PLUS_SUCCESS;
+    std::vector<vtkSmartPointer<vtkPlusOpenIGTLinkClientWithStatistics> > clients;
+    for (int clientIndex = 0; clientIndex < numberOfClients; ++clientIndex)
+    {
+      vtkSmartPointer<vtkPlusOpenIGTLinkClientWithStatistics> client = vtkSmartPointer<vtkPlusOpenIGTLinkClientWithStatistics>::New();
+      client->SetServerHost("127.0.0.1");
+      client->SetServerPort(server->GetListeningPort());
+      if (client->Connect(10.0) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Benchmark client " << clientIndex << " failed to connect to the server");
+        status = PLUS_FAIL;
+        break;
+      }
+      clients.push_back(client);
+    }
+
+    if (status == PLUS_SUCCESS)
+    {
+      WaitAndProcessCommands(server, warmUpTimeSec);
+      for (size_t clientIndex = 0; clientIndex < clients.size(); ++clientIndex)
+      {
+        clients[clientIndex]->ResetStatistics();
+      }
+      const double cpuTimeAtStartSec = GetProcessCpuTimeSec();
+      const double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+
+      WaitAndProcessCommands(server, measurementTimeSec);
+
+      const double elapsedTimeSec = vtkIGSIOAccurateTimer::GetSystemTime() - startTime;
+      const double cpuTimeSec = GetProcessCpuTimeSec() - cpuTimeAtStartSec;
+      vtkPlusOpenIGTLinkClientWithStatistics::MessageStatisticsMap statistics;
+      for (size_t clientIndex = 0; clientIndex < clients.size(); ++clientIndex)
+      {
+        MergeStatistics(clients[clientIndex]->GetStatistics(), statistics);
+      }
+
+      std::cout << "Configuration: " << inputConfigFileName << " (replay speed: " << replaySpeed << "x"
+                << (numberOfClients > 1 ? ", " + std::to_string(numberOfClients) + " clients" : "")
+                << (enableCapture ? ", capture enabled" : "") << ")" << std::endl;
+      if (statistics.empty())
+      {
+        LOG_ERROR("No data messages were received from the server in " << measurementTimeSec << " sec");
+        status = PLUS_FAIL;
+      }
+      std::cout << std::setw(16) << "Message type" << std::setw(12) << "Msg/s" << std::setw(12) << "MB/s"
+                << std::setw(12) << "p50 [ms]" << std::setw(12) << "p90 [ms]" << std::setw(12) << "p99 [ms]" << std::setw(12) << "max [ms]" << std::endl;
+      const std::string metricNamePrefix = vtksys::SystemTools::GetFilenameWithoutLastExtension(inputConfigFileName) + "/";
+      for (vtkPlusOpenIGTLinkClientWithStatistics::MessageStatisticsMap::iterator it = statistics.begin(); it != statistics.end(); ++it)
+      {
+        std::vector<double>& latencies = it->second.LatenciesSec;
+        std::sort(latencies.begin(), latencies.end());
+        metrics.SetMetric(metricNamePrefix + it->first + "/MessagesPerSec", it->second.NumberOfMessages / elapsedTimeSec, PlusPerformanceMetrics::THROUGHPUT);
+        metrics.SetMetric(metricNamePrefix + it->first + "/LatencyP99Ms", GetPercentile(latencies, 99) * 1000.0, PlusPerformanceMetrics::LATENCY);
+        std::cout << std::setw(16) << it->first << std::fixed << std::setprecision(1)
+                  << std::setw(12) << it->second.NumberOfMessages / elapsedTimeSec
+                  << std::setw(12) << it->second.NumberOfBytes / elapsedTimeSec / (1024.0 * 1024.0)
+                  << std::setprecision(2)
+                  << std::setw(12) << GetPercentile(latencies, 50) * 1000.0
+                  << std::setw(12) << GetPercentile(latencies, 90) * 1000.0
+                  << std::setw(12) << GetPercentile(latencies, 99) * 1000.0
+                  << std::setw(12) << (latencies.empty() ? 0.0 : latencies.back()) * 1000.0 << std::endl;
+      }
+      std::cout << std::fixed << std::setprecision(1) << "CPU usage: " << 100.0 * cpuTimeSec / elapsedTimeSec << "%"
+                << ", peak memory usage: " << GetPeakMemoryUsageMb() << " MB" << std::endl << std::endl;
+    }
+
+    for (size_t clientIndex = 0; clientIndex < clients.size(); ++clientIndex)
+    {
+      clients[clientIndex]->Disconnect();
+    }
+    server->Stop();
+    dataCollector->Stop();
+    dataCollector->Disconnect();
+    return status;
+  }
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  std::vector<std::string> inputConfigFileNames;
+  double replaySpeed = 4.0;
+  double warmUpTimeSec = 2.0;
+  double measurementTimeSec = 10.0;
+  bool enableCapture(false);
+  int numberOfClients = 1;
+  std::string metricsFileName;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--server-config-file", vtksys::CommandLineArguments::MULTI_ARGUMENT, &inputConfigFileNames, "Name of the server configuration files. Each configuration is benchmarked separately.");
+  args.AddArgument("--replay-speed", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &replaySpeed, "Acquisition rate of saved data sources is multiplied by this factor (default: 4).");
+  args.AddArgument("--warm-up-sec", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &warmUpTimeSec, "Time before the measurement is started, in seconds (default: 2).");
+  args.AddArgument("--duration-sec", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &measurementTimeSec, "Duration of the measurement for each configuration, in seconds (default: 10).");
+  args.AddArgument("--enable-capture", vtksys::CommandLineArguments::NO_ARGUMENT, &enableCapture, "Enable capturing in all virtual capture devices, to include writing to file in the measurement.");
+  args.AddArgument("--clients", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfClients, "Number of local clients that receive the messages of the server (default: 1).");
+  args.AddArgument("--metrics-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &metricsFileName, "Write the message rates and the 99th percentile latencies to this performance metrics file (.json).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments." << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (inputConfigFileNames.empty())
+  {
+    LOG_ERROR("--server-config-file argument is required!");
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (replaySpeed <= 0 || measurementTimeSec <= 0 || numberOfClients <= 0)
+  {
+    LOG_ERROR("--replay-speed, --duration-sec and --clients must be positive");
+    exit(EXIT_FAILURE);
+  }
+
+  PlusPerformanceMetrics metrics;
+  int numberOfFailures = 0;
+  for (std::vector<std::string>::iterator it = inputConfigFileNames.begin(); it != inputConfigFileNames.end(); ++it)
+  {
+    if (RunBenchmark(*it, replaySpeed, enableCapture, warmUpTimeSec, measurementTimeSec, numberOfClients, metrics) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Benchmark failed for configuration " << *it);
+      numberOfFailures++;
+    }
+  }
+
+  if (!metricsFileName.empty() && metrics.WriteToFile(metricsFileName) != PLUS_SUCCESS)
+  {
+    numberOfFailures++;
+  }
+
+  return (numberOfFailures == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -10,7 +10,9 @@ See License.txt for details.
 */
 
 #include "PlusConfigure.h"
+#include "PlusIgtlClientInfo.h"
 #include "igtlCommon.h"
+#include "igtlPlusClientInfoMessage.h"
 #include "igtlTrackingDataMessage.h"
 #include "igtl_header.h"
 #include "vtkPlusGetTransformCommand.h"
@@ -23,6 +25,7 @@ See License.txt for details.
 #include "vtkPlusUpdateTransformCommand.h"
 #include "vtkPlusVersionCommand.h"
 #include "vtkPlusIgtlMessageFactory.h"
+#include "vtkIGSIORecursiveCriticalSection.h"
 #ifdef PLUS_USE_STEALTHLINK
   #include "vtkPlusStealthLinkCommand.h"
 #endif
@@ -35,6 +38,7 @@ See License.txt for details.
 #include "vtksys/Process.h"
 #include "vtkXMLUtilities.h"
 
+#include "igtlTimeStamp.h"
 #include "igtlTransformMessage.h"
 
 // For catching Ctrl-C
@@ -42,6 +46,15 @@ See License.txt for details.
 #include <cstdlib>
 #include <cstdio>
 
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <future>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <vector>
+
 //----------------------------------------------------------------------------
 // For CTRL-C signal handling
 static bool StopClientRequested = false;
@@ -103,6 +116,91 @@ private:
 
 vtkStandardNewMacro(vtkPlusOpenIGTLinkClientWithTransformLogging);
 
+//----------------------------------------------------------------------------
+// A vtkPlusOpenIGTLinkClient for load testing, that discards the received data messages and records their size, timestamp and latency
+class vtkPlusOpenIGTLinkLoadTestClient : public vtkPlusOpenIGTLinkClient
+{
+public:
+  static vtkPlusOpenIGTLinkLoadTestClient* New();
+  vtkTypeMacro(vtkPlusOpenIGTLinkLoadTestClient, vtkPlusOpenIGTLinkClient);
+
+  struct StreamStatistics
+  {
+    StreamStatistics() : NumberOfBytes(0) {}
+    std::string MessageType;
+    unsigned long long NumberOfBytes;
+    /*! IGTL timestamps of the received messages */
+    std::vector<double> TimestampsSec;
+    std::vector<double> LatenciesSec;
+  };
+  /*! Statistics of each stream, by message type and device name */
+  typedef std::map<std::string, StreamStatistics> StreamStatisticsMap;
+
+  bool OnMessageReceived(igtl::MessageHeader::Pointer messageHeader)
+  {
+    std::string messageType = messageHeader->GetMessageType();
+    if (messageType == "STATUS" || messageType == "STRING" || messageType == "COMMAND" || messageType.compare(0, 4, "RTS_") == 0)
+    {
+      // Command replies are processed by the base class
+      return false;
+    }
+
+    const double receiveTimeUniversal = vtkIGSIOAccurateTimer::GetUniversalTime();
+    igtl::TimeStamp::Pointer timestamp = igtl::TimeStamp::New();
+    messageHeader->GetTimeStamp(timestamp);
+
+    SocketSkip(messageHeader->GetBodySizeToRead());
+
+    std::lock_guard<std::mutex> statisticsGuard(this->StatisticsMutex);
+    StreamStatistics& statistics = this->Statistics[messageType + " " + messageHeader->GetDeviceName()];
+    statistics.MessageType = messageType;
+    statistics.NumberOfBytes += messageHeader->GetPackSize() + messageHeader->GetBodySizeToRead();
+    statistics.TimestampsSec.push_back(timestamp->GetTimeStamp());
+    statistics.LatenciesSec.push_back(receiveTimeUniversal - timestamp->GetTimeStamp());
+    return true;
+  }
+
+  /*! Subscribe to the streams specified in the client info */
+  PlusStatus SendClientInfo(const PlusIgtlClientInfo& clientInfo)
+  {
+    igtl::PlusClientInfoMessage::Pointer clientInfoMsg = igtl::PlusClientInfoMessage::New();
+    clientInfoMsg->SetClientInfo(clientInfo);
+    clientInfoMsg->Pack();
+    return this->SendMessage(clientInfoMsg.GetPointer());
+  }
+
+  void ResetStatistics()
+  {
+    std::lock_guard<std::mutex> statisticsGuard(this->StatisticsMutex);
+    this->Statistics.clear();
+  }
+
+  StreamStatisticsMap GetStatistics()
+  {
+    std::lock_guard<std::mutex> statisticsGuard(this->StatisticsMutex);
+    return this->Statistics;
+  }
+
+protected:
+  vtkPlusOpenIGTLinkLoadTestClient() {};
+  virtual ~vtkPlusOpenIGTLinkLoadTestClient() {};
+
+  void SocketSkip(int length)
+  {
+    igsioLockGuard<vtkIGSIORecursiveCriticalSection> socketGuard(this->SocketMutex);
+    this->ClientSocket->Skip(length, 0);
+  }
+
+  std::mutex StatisticsMutex;
+  StreamStatisticsMap Statistics;
+
+private:
+  vtkPlusOpenIGTLinkLoadTestClient(const vtkPlusOpenIGTLinkLoadTestClient&);
+  void operator=(const vtkPlusOpenIGTLinkLoadTestClient&);
+};
+
+vtkStandardNewMacro(vtkPlusOpenIGTLinkLoadTestClient);
+
 // Utility functions for sending commands
 
 //----------------------------------------------------------------------------
@@ -267,6 +365,25 @@ PlusStatus ExecuteGetSnapshotReconstruction(vtkPlusOpenIGTLinkClient* client, co
   return client->SendCommand(cmd);
 }
 
+//----------------------------------------------------------------------------
+PlusStatus ExecuteGetUpdateReconstruction(vtkPlusOpenIGTLinkClient* client, const std::string& deviceId, const std::string& outputImageName, unsigned long volumeSequenceNumber, int commandId)
+{
+  vtkSmartPointer<vtkPlusReconstructVolumeCommand> cmd = vtkSmartPointer<vtkPlusReconstructVolumeCommand>::New();
+  cmd->SetNameToGetUpdate();
+  cmd->SetId(commandId);
+  if (!deviceId.empty())
+  {
+    cmd->SetVolumeReconstructorDeviceId(deviceId.c_str());
+  }
+  if (!outputImageName.empty())
+  {
+    cmd->SetOutputVolDeviceName(outputImageName.c_str());
+  }
+  cmd->SetVolumeSequenceNumber(volumeSequenceNumber);
+  PrintCommand(cmd);
+  return client->SendCommand(cmd);
+}
+
 //----------------------------------------------------------------------------
 PlusStatus ExecuteStopReconstruction(vtkPlusOpenIGTLinkClient* client, const std::string& deviceId, const std::string& outputFilename, const std::string& outputImageName, int commandId)
 {
@@ -475,6 +592,22 @@ PlusStatus ExecuteSendText(vtkPlusOpenIGTLinkClient* client, const std::string&
   return client->SendCommand(cmd);
 }
 
+//----------------------------------------------------------------------------
+void PrintReply(const vtkPlusOpenIGTLinkClient::CommandReply& reply)
+{
+  LOG_INFO("Command ID: " << reply.OriginalCommandId);
+  LOG_INFO("Status: " << (reply.Result == PLUS_SUCCESS ? "SUCCESS" : "FAIL"));
+  if (reply.Result == PLUS_FAIL)
+  {
+    LOG_INFO("Error: " << reply.ErrorString);
+  }
+  LOG_INFO("Message: " << reply.Content);
+  for (igtl::MessageBase::MetaDataMap::const_iterator it = reply.Parameters.begin(); it != reply.Parameters.end(); ++it)
+  {
+    LOG_INFO(it->first << ": " << it->second.second);
+  }
+}
+
 //----------------------------------------------------------------------------
 PlusStatus ReceiveAndPrintReply(vtkPlusOpenIGTLinkClient* client,
                                 bool& didTimeout,
@@ -483,32 +616,263 @@ PlusStatus ReceiveAndPrintReply(vtkPlusOpenIGTLinkClient* client,
                                 igtl::MessageBase::MetaDataMap& parameters,
                                 int timeoutSec = 30)
 {
-  int32_t commandId;
-  std::string commandName;
-
-  PlusStatus result;
+  vtkPlusOpenIGTLinkClient::CommandReply reply;
 
   const double replyTimeoutSec = timeoutSec;
-  if (client->ReceiveReply(result, commandId, outErrorMessage, outContent, parameters, commandName, replyTimeoutSec) != PLUS_SUCCESS)
+  if (client->ReceiveReply(reply.Result, reply.OriginalCommandId, outErrorMessage, outContent, parameters, reply.CommandName, replyTimeoutSec) != PLUS_SUCCESS)
   {
     LOG_ERROR("Failed to receive reply to the command");
     didTimeout = true;
     return PLUS_FAIL;
   }
 
-  LOG_INFO("Command ID: " << commandId);
-  LOG_INFO("Status: " << (result == PLUS_SUCCESS ? "SUCCESS" : "FAIL"));
-  if (result == PLUS_FAIL)
+  reply.ErrorString = outErrorMessage;
+  reply.Content = outContent;
+  reply.Parameters = parameters;
+  PrintReply(reply);
+
+  return reply.Result;
+}
+
+//----------------------------------------------------------------------------
+/*!
+  Execute all commands of a batch file. The batch file contains Command elements (in the same format as sent to the server,
+  for example <Command Name="GetTransform" TransformName="StylusToReference" />) within a root element.
+  The commands are pipelined: up to pipelineDepth commands are sent before waiting for the reply of the oldest one,
+  so the round-trip time of the connection is not added to the execution time of each command.
+*/
+PlusStatus ExecuteBatchFile(vtkPlusOpenIGTLinkClient* client, const std::string& batchFilename, int pipelineDepth, double replyTimeoutSec = 30)
+{
+  vtkSmartPointer<vtkXMLDataElement> batchElement = vtkSmartPointer<vtkXMLDataElement>::Take(vtkXMLUtilities::ReadElementFromFile(batchFilename.c_str()));
+  if (batchElement == NULL)
   {
-    LOG_INFO("Error: " << outErrorMessage);
+    LOG_ERROR("Unable to read batch file: " << batchFilename);
+    return PLUS_FAIL;
   }
-  LOG_INFO("Message: " << outContent);
-  for (igtl::MessageBase::MetaDataMap::const_iterator it = parameters.begin(); it != parameters.end(); ++it)
+  if (pipelineDepth < 1)
   {
-    LOG_INFO(it->first << ": " << it->second.second);
+    pipelineDepth = 1;
+  }
+
+  PlusStatus status = PLUS_SUCCESS;
+  int numberOfCommands = 0;
+  std::deque<std::future<vtkPlusOpenIGTLinkClient::CommandReply> > pendingReplies;
+  const double startTimeSec = vtkIGSIOAccurateTimer::GetSystemTime();
+  for (int i = 0; i <= batchElement->GetNumberOfNestedElements(); ++i)
+  {
+    const bool allCommandsSent = (i == batchElement->GetNumberOfNestedElements());
+    if (!allCommandsSent)
+    {
+      vtkXMLDataElement* commandElement = batchElement->GetNestedElement(i);
+      if (commandElement->GetName() == NULL || STRCASECMP(commandElement->GetName(), "Command") != 0)
+      {
+        continue;
+      }
+      std::ostringstream xmlStr;
+      vtkXMLUtilities::FlattenElement(commandElement, xmlStr);
+      LOG_INFO(">>> Command: " << xmlStr.str());
+      pendingReplies.push_back(client->SendCommandAsync(commandElement));
+      numberOfCommands++;
+    }
+
+    // Wait for the oldest replies when the pipeline is full, or for all of them when all commands are sent
+    while (!pendingReplies.empty() && (allCommandsSent || static_cast<int>(pendingReplies.size()) >= pipelineDepth))
+    {
+      std::future<vtkPlusOpenIGTLinkClient::CommandReply>& replyFuture = pendingReplies.front();
+      if (replyFuture.wait_for(std::chrono::duration<double>(replyTimeoutSec)) != std::future_status::ready)
+      {
+        LOG_ERROR("Failed to receive reply to the command");
+        status = PLUS_FAIL;
+      }
+      else
+      {
+        vtkPlusOpenIGTLinkClient::CommandReply reply = replyFuture.get();
+        PrintReply(reply);
+        if (reply.Result != PLUS_SUCCESS)
+        {
+          status = PLUS_FAIL;
+        }
+      }
+      pendingReplies.pop_front();
+    }
+  }
+  const double elapsedTimeSec = vtkIGSIOAccurateTimer::GetSystemTime() - startTimeSec;
+  LOG_INFO("Executed " << numberOfCommands << " commands in " << elapsedTimeSec << " sec");
+
+  return status;
+}
+
+//----------------------------------------------------------------------------
+double GetPercentile(const std::vector<double>& sortedValues, double percentile)
+{
+  if (sortedValues.empty())
+  {
+    return 0.0;
   }
+  size_t index = static_cast<size_t>(percentile / 100.0 * (sortedValues.size() - 1) + 0.5);
+  return sortedValues[std::min(index, sortedValues.size() - 1)];
+}
 
-  return result;
+//----------------------------------------------------------------------------
+// Estimate the number of dropped frames of a stream from the gaps between the message timestamps:
+// a gap that is longer than 1.5 times the median frame interval is counted as the number of missing frame intervals
+int EstimateNumberOfDroppedFrames(std::vector<double> timestampsSec)
+{
+  if (timestampsSec.size() < 3)
+  {
+    return 0;
+  }
+  std::sort(timestampsSec.begin(), timestampsSec.end());
+  std::vector<double> intervalsSec;
+  for (size_t i = 1; i < timestampsSec.size(); ++i)
+  {
+    intervalsSec.push_back(timestampsSec[i] - timestampsSec[i - 1]);
+  }
+  std::vector<double> sortedIntervalsSec = intervalsSec;
+  std::sort(sortedIntervalsSec.begin(), sortedIntervalsSec.end());
+  const double medianIntervalSec = GetPercentile(sortedIntervalsSec, 50);
+  if (medianIntervalSec <= 0)
+  {
+    return 0;
+  }
+  int numberOfDroppedFrames = 0;
+  for (std::vector<double>::iterator it = intervalsSec.begin(); it != intervalsSec.end(); ++it)
+  {
+    if (*it > 1.5 * medianIntervalSec)
+    {
+      numberOfDroppedFrames += static_cast<int>(*it / medianIntervalSec + 0.5) - 1;
+    }
+  }
+  return numberOfDroppedFrames;
+}
+
+//----------------------------------------------------------------------------
+// Read the client info (stream subscriptions) from a file that contains a ClientInfo element, or a server configuration file with a DefaultClientInfo element
+PlusStatus ReadClientInfoFromFile(const std::string& clientInfoFilename, PlusIgtlClientInfo& clientInfo)
+{
+  vtkSmartPointer<vtkXMLDataElement> rootElement = vtkSmartPointer<vtkXMLDataElement>::Take(vtkXMLUtilities::ReadElementFromFile(clientInfoFilename.c_str()));
+  if (rootElement == NULL)
+  {
+    LOG_ERROR("Unable to read client info file: " << clientInfoFilename);
+    return PLUS_FAIL;
+  }
+  vtkXMLDataElement* clientInfoElement = rootElement;
+  if (STRCASECMP(rootElement->GetName(), "ClientInfo") != 0 && STRCASECMP(rootElement->GetName(), "DefaultClientInfo") != 0)
+  {
+    clientInfoElement = rootElement->LookupElementWithName("DefaultClientInfo");
+  }
+  if (clientInfoElement == NULL)
+  {
+    LOG_ERROR("No ClientInfo or DefaultClientInfo element is found in " << clientInfoFilename);
+    return PLUS_FAIL;
+  }
+  return clientInfo.SetClientInfoFromXmlData(clientInfoElement);
+}
+
+//----------------------------------------------------------------------------
+/*!
+  Connect many simulated clients to the server and measure the throughput and latency of the received data messages.
+  Client info files are assigned to the clients in turn, if no file is specified then the server default client info is used.
+  Latency is computed from the IGTL timestamp of the message, therefore the clocks of the client and server computers must be synchronized.
+*/
+PlusStatus RunLoadTest(const std::string& serverHost, int serverPort, int numberOfClients, const std::vector<std::string>& clientInfoFilenames, double warmUpTimeSec, double durationSec)
+{
+  std::vector<PlusIgtlClientInfo> clientInfos(clientInfoFilenames.size());
+  for (size_t i = 0; i < clientInfoFilenames.size(); ++i)
+  {
+    if (ReadClientInfoFromFile(clientInfoFilenames[i], clientInfos[i]) != PLUS_SUCCESS)
+    {
+      return PLUS_FAIL;
+    }
+  }
+
+  PlusStatus status = PLUS_SUCCESS;
+  std::vector<vtkSmartPointer<vtkPlusOpenIGTLinkLoadTestClient> > clients;
+  for (int i = 0; i < numberOfClients; ++i)
+  {
+    vtkSmartPointer<vtkPlusOpenIGTLinkLoadTestClient> client = vtkSmartPointer<vtkPlusOpenIGTLinkLoadTestClient>::New();
+    client->SetServerHost(serverHost.c_str());
+    client->SetServerPort(serverPort);
+    if (client->Connect(15.0) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Load test client " << i << " failed to connect to server at " << serverHost << ":" << serverPort);
+      status = PLUS_FAIL;
+      break;
+    }
+    clients.push_back(client);
+    if (!clientInfos.empty() && client->SendClientInfo(clientInfos[i % clientInfos.size()]) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Load test client " << i << " failed to send client info");
+      status = PLUS_FAIL;
+      break;
+    }
+  }
+
+  if (status == PLUS_SUCCESS)
+  {
+    LOG_INFO("Connected " << numberOfClients << " load test clients");
+    vtkIGSIOAccurateTimer::DelayWithEventProcessing(warmUpTimeSec);
+    for (size_t i = 0; i < clients.size(); ++i)
+    {
+      clients[i]->ResetStatistics();
+    }
+    const double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+    vtkIGSIOAccurateTimer::DelayWithEventProcessing(durationSec);
+    const double elapsedTimeSec = vtkIGSIOAccurateTimer::GetSystemTime() - startTime;
+
+    // Aggregate the statistics of all clients by message type
+    std::map<std::string, vtkPlusOpenIGTLinkLoadTestClient::StreamStatistics> messageTypeStatistics;
+    std::map<std::string, int> numberOfDroppedFrames;
+    double minClientMessageRate = -1;
+    double maxClientMessageRate = 0;
+    for (size_t i = 0; i < clients.size(); ++i)
+    {
+      vtkPlusOpenIGTLinkLoadTestClient::StreamStatisticsMap streamStatistics = clients[i]->GetStatistics();
+      size_t numberOfClientMessages = 0;
+      for (vtkPlusOpenIGTLinkLoadTestClient::StreamStatisticsMap::iterator it = streamStatistics.begin(); it != streamStatistics.end(); ++it)
+      {
+        vtkPlusOpenIGTLinkLoadTestClient::StreamStatistics& statistics = messageTypeStatistics[it->second.MessageType];
+        statistics.NumberOfBytes += it->second.NumberOfBytes;
+        statistics.LatenciesSec.insert(statistics.LatenciesSec.end(), it->second.LatenciesSec.begin(), it->second.LatenciesSec.end());
+        numberOfDroppedFrames[it->second.MessageType] += EstimateNumberOfDroppedFrames(it->second.TimestampsSec);
+        numberOfClientMessages += it->second.LatenciesSec.size();
+      }
+      const double clientMessageRate = numberOfClientMessages / elapsedTimeSec;
+      minClientMessageRate = (minClientMessageRate < 0) ? clientMessageRate : std::min(minClientMessageRate, clientMessageRate);
+      maxClientMessageRate = std::max(maxClientMessageRate, clientMessageRate);
+    }
+
+    if (messageTypeStatistics.empty())
+    {
+      LOG_ERROR("No data messages were received from the server in " << durationSec << " sec");
+      status = PLUS_FAIL;
+    }
+    std::cout << "Load test: " << clients.size() << " clients, " << elapsedTimeSec << " sec" << std::endl;
+    std::cout << std::setw(16) << "Message type" << std::setw(12) << "Msg/s" << std::setw(12) << "MB/s"
+              << std::setw(12) << "p50 [ms]" << std::setw(12) << "p90 [ms]" << std::setw(12) << "p99 [ms]" << std::setw(12) << "max [ms]"
+              << std::setw(12) << "Dropped" << std::endl;
+    for (std::map<std::string, vtkPlusOpenIGTLinkLoadTestClient::StreamStatistics>::iterator it = messageTypeStatistics.begin(); it != messageTypeStatistics.end(); ++it)
+    {
+      std::vector<double>& latencies = it->second.LatenciesSec;
+      std::sort(latencies.begin(), latencies.end());
+      std::cout << std::setw(16) << it->first << std::fixed << std::setprecision(1)
+                << std::setw(12) << latencies.size() / elapsedTimeSec
+                << std::setw(12) << it->second.NumberOfBytes / elapsedTimeSec / (1024.0 * 1024.0)
+                << std::setprecision(2)
+                << std::setw(12) << GetPercentile(latencies, 50) * 1000.0
+                << std::setw(12) << GetPercentile(latencies, 90) * 1000.0
+                << std::setw(12) << GetPercentile(latencies, 99) * 1000.0
+                << std::setw(12) << (latencies.empty() ? 0.0 : latencies.back()) * 1000.0
+                << std::setw(12) << numberOfDroppedFrames[it->first] << std::endl;
+    }
+    std::cout << std::fixed << std::setprecision(1) << "Messages per client: " << std::max(minClientMessageRate, 0.0) << " - " << maxClientMessageRate << " msg/s" << std::endl;
+  }
+
+  for (size_t i = 0; i < clients.size(); ++i)
+  {
+    clients[i]->Disconnect();
+  }
+  return status;
 }
 
 //----------------------------------------------------------------------------
@@ -722,6 +1086,15 @@ PlusStatus RunTests(vtkPlusOpenIGTLinkClient* client)
   vtkIGSIOAccurateTimer::DelayWithEventProcessing(2.0);
   ExecuteGetSnapshotReconstruction(client, volumeReconstructionDeviceId, snapshotReconstructionOutputFileName, snapshotReconstructionOutputImageName, commandId++);
   RETURN_IF_FAIL(ReceiveAndPrintReply(client, didTimeout, replyMessage, errorMessage, parameters));
+  unsigned long volumeSequenceNumber = 0;
+  if (parameters.find("VolumeSequenceNumber") != parameters.end())
+  {
+    igsioCommon::StringToNumber<unsigned long>(parameters["VolumeSequenceNumber"].second, volumeSequenceNumber);
+  }
+  parameters.clear();
+  vtkIGSIOAccurateTimer::DelayWithEventProcessing(2.0);
+  ExecuteGetUpdateReconstruction(client, volumeReconstructionDeviceId, snapshotReconstructionOutputImageName, volumeSequenceNumber, commandId++);
+  RETURN_IF_FAIL(ReceiveAndPrintReply(client, didTimeout, replyMessage, errorMessage, parameters));
   parameters.clear();
   vtkIGSIOAccurateTimer::DelayWithEventProcessing(2.0);
   ExecuteStopReconstruction(client, volumeReconstructionDeviceId, liveReconstructionOutputFileName, liveReconstructionOutputImageName, commandId++);
@@ -769,6 +1142,13 @@ int main(int argc, char** argv)
   int serverIGTLVersion(-1);
   int commandId(0);
   double lastNSeconds(-1.0);
+  int volumeSequenceNumber(0);
+  std::string batchFilename;
+  int pipelineDepth(16);
+  int loadTestClients(0);
+  std::vector<std::string> loadTestClientInfoFilenames;
+  double loadTestWarmUpTimeSec(2.0);
+  double loadTestDurationSec(10.0);
 
   vtksys::CommandLineArguments args;
   args.Initialize(argc, argv);
@@ -776,13 +1156,20 @@ int main(int argc, char** argv)
   args.AddArgument("--host", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &serverHost, "Host name of the OpenIGTLink server (default: 127.0.0.1)");
   args.AddArgument("--port", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &serverPort, "Port address of the OpenIGTLink server (default: 18944)");
   args.AddArgument("--command", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &command,
-                   "Command name to be executed on the server (START_ACQUISITION, STOP_ACQUISITION, SUSPEND_ACQUISITION, RESUME_ACQUISITION, RECONSTRUCT, START_RECONSTRUCTION, SUSPEND_RECONSTRUCTION, RESUME_RECONSTRUCTION, STOP_RECONSTRUCTION, GET_RECONSTRUCTION_SNAPSHOT, GET_CHANNEL_IDS, GET_DEVICE_IDS, GET_EXAM_DATA, SAVE_RAW_DATA, SEND_TEXT, UPDATE_TRANSFORM, GET_TRANSFORM, GET_POINT)");
+                   "Command name to be executed on the server (START_ACQUISITION, STOP_ACQUISITION, SUSPEND_ACQUISITION, RESUME_ACQUISITION, RECONSTRUCT, START_RECONSTRUCTION, SUSPEND_RECONSTRUCTION, RESUME_RECONSTRUCTION, STOP_RECONSTRUCTION, GET_RECONSTRUCTION_SNAPSHOT, GET_RECONSTRUCTION_UPDATE, GET_CHANNEL_IDS, GET_DEVICE_IDS, GET_EXAM_DATA, SAVE_RAW_DATA, SEND_TEXT, UPDATE_TRANSFORM, GET_TRANSFORM, GET_POINT)");
+  args.AddArgument("--batch-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &batchFilename, "XML file that contains Command elements to be executed on the server. The commands are sent without waiting for the previous replies.");
+  args.AddArgument("--pipeline-depth", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &pipelineDepth, "Maximum number of batch file commands that are waiting for their reply (default: 16)");
+  args.AddArgument("--load-test-clients", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &loadTestClients, "Number of simulated clients that are connected to the server to measure throughput, latency and dropped frames of the received data messages. Latency is computed from the message timestamps, so the client and server clocks must be synchronized.");
+  args.AddArgument("--load-test-client-info", vtksys::CommandLineArguments::MULTI_ARGUMENT, &loadTestClientInfoFilenames, "Files that contain a ClientInfo (or DefaultClientInfo) element that specifies the streams requested by the load test clients. Files are assigned to the clients in turn (optional, default: server default client info).");
+  args.AddArgument("--load-test-warm-up-sec", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &loadTestWarmUpTimeSec, "Time between connecting the load test clients and starting the measurement, in seconds (default: 2).");
+  args.AddArgument("--load-test-duration-sec", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &loadTestDurationSec, "Duration of the load test measurement, in seconds (default: 10).");
   args.AddArgument("--command-id", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &commandId, "Command ID to send to the server.");
   args.AddArgument("--server-igtl-version", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &serverHeaderVersion, "The version of IGTL used by the server. Remove this parameter when querying is dynamic.");
   args.AddArgument("--device", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &deviceId, "ID of the controlled device (optional, default: first VirtualStreamCapture or VirtualVolumeReconstructor device). In case of GET_DEVICE_IDS it is not an ID but a device type.");
   args.AddArgument("--input-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputFilename, "File name of the input, used for RECONSTRUCT command");
   args.AddArgument("--output-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &outputFilename, "File name of the output, used for START command (optional, default: 'PlusServerRecording.nrrd' for acquisition, no output for volume reconstruction)");
   args.AddArgument("--output-image-name", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &outputImageName, "OpenIGTLink device name of the reconstructed file (optional, default: image is not sent)");
+  args.AddArgument("--volume-sequence-number", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &volumeSequenceNumber, "Sequence number of the volume that was received in the response of the previous GET_RECONSTRUCTION_SNAPSHOT or GET_RECONSTRUCTION_UPDATE command, used for GET_RECONSTRUCTION_UPDATE command (default: 0)");
   args.AddArgument("--text", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &text, "Text to be sent to the device");
   args.AddArgument("--transform-name", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &transformName, "The name of the transform to update. Form=[From]To[To]Transform");
   args.AddArgument("--transform-date", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &transformDate, "The date of the transform to update.");
@@ -807,9 +1194,9 @@ int main(int argc, char** argv)
     exit(EXIT_FAILURE);
   }
 
-  if (command.empty() && !keepConnected && !runTests)
+  if (command.empty() && batchFilename.empty() && loadTestClients <= 0 && !keepConnected && !runTests)
   {
-    LOG_ERROR("The program has nothing to do, as neither --command, --keep-connected, nor --run-tests is specifed");
+    LOG_ERROR("The program has nothing to do, as neither --command, --batch-file, --load-test-clients, --keep-connected, nor --run-tests is specifed");
     std::cout << "Help: " << args.GetHelp() << std::endl;
     exit(EXIT_FAILURE);
   }
@@ -887,6 +1274,10 @@ int main(int argc, char** argv)
     {
       commandExecutionStatus = ExecuteGetSnapshotReconstruction(client, deviceId, outputFilename, outputImageName, commandId);
     }
+    else if (igsioCommon::IsEqualInsensitive(command, "GET_RECONSTRUCTION_UPDATE"))
+    {
+      commandExecutionStatus = ExecuteGetUpdateReconstruction(client, deviceId, outputImageName, static_cast<unsigned long>(volumeSequenceNumber), commandId);
+    }
     else if (igsioCommon::IsEqualInsensitive(command, "STOP_RECONSTRUCTION"))
     {
       commandExecutionStatus = ExecuteStopReconstruction(client, deviceId, outputFilename, outputImageName, commandId);
@@ -970,6 +1361,32 @@ int main(int argc, char** argv)
     }
   }
 
+  // Run the commands of a batch file
+  if (!batchFilename.empty())
+  {
+    if (ExecuteBatchFile(client, batchFilename, pipelineDepth) != PLUS_SUCCESS)
+    {
+      processReturnValue = EXIT_FAILURE;
+    }
+    if (!keepConnected)
+    {
+      StopClientRequested = true;
+    }
+  }
+
+  // Run load test
+  if (loadTestClients > 0)
+  {
+    if (RunLoadTest(serverHost, serverPort, loadTestClients, loadTestClientInfoFilenames, loadTestWarmUpTimeSec, loadTestDurationSec) != PLUS_SUCCESS)
+    {
+      processReturnValue = EXIT_FAILURE;
+    }
+    if (!keepConnected)
+    {
+      StopClientRequested = true;
+    }
+  }
+
   // Run automatic tests
   if (runTests)
   {
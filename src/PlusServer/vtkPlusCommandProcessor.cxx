@@ -27,7 +27,9 @@ See License.txt for details.
 #endif
 
 #include "vtkPlusAddRecordingDeviceCommand.h"
+#include "vtkPlusGetMemoryUsageCommand.h"
 #include "vtkPlusGetPolydataCommand.h"
+#include "vtkPlusGetTelemetryCommand.h"
 #include "vtkPlusGetTransformCommand.h"
 #include "vtkPlusGetUsParameterCommand.h"
 #include "vtkPlusRequestIdsCommand.h"
@@ -47,19 +49,25 @@ See License.txt for details.
 #include <vtkObjectFactory.h>
 #include <vtkXMLUtilities.h>
 
+// STL includes
+#include <algorithm>
+
 vtkStandardNewMacro(vtkPlusCommandProcessor);
 
 //----------------------------------------------------------------------------
 vtkPlusCommandProcessor::vtkPlusCommandProcessor()
   : PlusServer(NULL)
-  , Threader(vtkSmartPointer<vtkMultiThreader>::New())
   , Mutex(vtkSmartPointer<vtkIGSIORecursiveCriticalSection>::New())
-  , CommandExecutionActive(std::make_pair(false, false))
-  , CommandExecutionThreadId(-1)
+  , NumberOfWorkerThreads(1)
+  , CommandExecutionActive(false)
+  , BackgroundJobCounter(0)
+  , MaxNumberOfBackgroundJobs(4)
 {
   // Register default commands
   RegisterPlusCommand(vtkSmartPointer<vtkPlusGetImageCommand>::New());
+  RegisterPlusCommand(vtkSmartPointer<vtkPlusGetMemoryUsageCommand>::New());
   RegisterPlusCommand(vtkSmartPointer<vtkPlusGetPolydataCommand>::New());
+  RegisterPlusCommand(vtkSmartPointer<vtkPlusGetTelemetryCommand>::New());
   RegisterPlusCommand(vtkSmartPointer<vtkPlusGetTransformCommand>::New());
   RegisterPlusCommand(vtkSmartPointer<vtkPlusReconstructVolumeCommand>::New());
   RegisterPlusCommand(vtkSmartPointer<vtkPlusRequestIdsCommand>::New());
@@ -88,6 +96,7 @@ vtkPlusCommandProcessor::vtkPlusCommandProcessor()
 //----------------------------------------------------------------------------
 vtkPlusCommandProcessor::~vtkPlusCommandProcessor()
 {
+  this->Stop();
   SetPlusServer(NULL);
 }
 
@@ -100,100 +109,430 @@ void vtkPlusCommandProcessor::PrintSelf(ostream& os, vtkIndent indent)
   {
     os << indent << "  " << iter->first << std::endl;
   }
+  os << indent << "NumberOfWorkerThreads: " << this->NumberOfWorkerThreads << std::endl;
+
+  CommandTimingStatisticsMap statistics;
+  this->GetCommandTimingStatistics(statistics);
+  os << indent << "Command timing statistics:" << std::endl;
+  for (auto iter = statistics.begin(); iter != statistics.end(); ++iter)
+  {
+    const CommandTimingStatistics& stats = iter->second;
+    os << indent << "  " << iter->first << ": executed " << stats.NumberOfExecutedCommands << " times"
+       << ", queuing time (average/max): " << stats.TotalQueuingTimeSec / stats.NumberOfExecutedCommands << "/" << stats.MaxQueuingTimeSec << " sec"
+       << ", execution time (average/max): " << stats.TotalExecutionTimeSec / stats.NumberOfExecutedCommands << "/" << stats.MaxExecutionTimeSec << " sec" << std::endl;
+  }
 }
 
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusCommandProcessor::Start()
 {
-  if (this->CommandExecutionThreadId < 0)
+  if (!this->WorkerThreads.empty())
+  {
+    return PLUS_SUCCESS;
+  }
+
+  this->CommandExecutionActive = true;
+  int numberOfWorkerThreads = std::max(this->NumberOfWorkerThreads, 1);
+  for (int i = 0; i < numberOfWorkerThreads; ++i)
   {
-    this->CommandExecutionActive.first = true;
-    this->CommandExecutionThreadId = this->Threader->SpawnThread((vtkThreadFunctionType)&CommandExecutionThread, this);
+    this->WorkerThreads.push_back(std::thread(&vtkPlusCommandProcessor::CommandExecutionThread, this, false));
   }
+  this->WorkerThreads.push_back(std::thread(&vtkPlusCommandProcessor::CommandExecutionThread, this, true));
+
+  LOG_DEBUG("Command execution started with " << numberOfWorkerThreads << " worker thread(s) and a fast lane thread");
+
   return PLUS_SUCCESS;
 }
 
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusCommandProcessor::Stop()
 {
-  // Stop the command execution thread
-  if (this->CommandExecutionThreadId >= 0)
+  this->JoinBackgroundJobs(true);
+
+  if (this->WorkerThreads.empty())
   {
-    this->CommandExecutionActive.first = false;
-    while (this->CommandExecutionActive.second)
-    {
-      // Wait until the thread stops
-      vtkIGSIOAccurateTimer::Delay(0.2);
-    }
-    this->CommandExecutionThreadId = -1;
+    return PLUS_SUCCESS;
   }
 
-  LOG_DEBUG("Command execution thread stopped");
+  // Stop the command execution threads, they execute the already queued commands before returning
+  {
+    std::lock_guard<std::mutex> queueLock(this->QueueMutex);
+    this->CommandExecutionActive = false;
+  }
+  this->QueueCondition.notify_all();
+  for (std::vector<std::thread>::iterator threadIt = this->WorkerThreads.begin(); threadIt != this->WorkerThreads.end(); ++threadIt)
+  {
+    threadIt->join();
+  }
+  this->WorkerThreads.clear();
+
+  LOG_DEBUG("Command execution threads stopped");
 
   return PLUS_SUCCESS;
 }
 
 //----------------------------------------------------------------------------
-void* vtkPlusCommandProcessor::CommandExecutionThread(vtkMultiThreader::ThreadInfo* data)
+void vtkPlusCommandProcessor::CommandExecutionThread(bool fastLane)
 {
-  vtkPlusCommandProcessor* self = (vtkPlusCommandProcessor*)(data->UserData);
-
-  self->CommandExecutionActive.second = true;
-
-  // Execute commands until a stop is requested
-  while (self->CommandExecutionActive.first)
+  while (true)
   {
-    self->ExecuteCommands();
-    // no commands in the queue, wait a bit before checking again
-    const double commandQueuePollIntervalSec = 0.010;
-#ifdef _WIN32
-    Sleep(commandQueuePollIntervalSec * 1000);
-#else
-    usleep(commandQueuePollIntervalSec * 1000000);
-#endif
+    QueuedCommand queuedCommand;
+    {
+      std::unique_lock<std::mutex> queueLock(this->QueueMutex);
+      this->QueueCondition.wait(queueLock, [this, fastLane]()
+      {
+        return !this->FastLaneCommandQueue.empty() || (!fastLane && !this->CommandQueue.empty()) || !this->CommandExecutionActive;
+      });
+      if (!this->TakeQueuedCommand(fastLane, queuedCommand))
+      {
+        // Stop is requested and there are no more commands
+        return;
+      }
+    }
+    this->ExecuteQueuedCommand(queuedCommand);
   }
+}
 
-  // Close thread
-  self->CommandExecutionThreadId = -1;
-  self->CommandExecutionActive.second = false;
-  return NULL;
+//----------------------------------------------------------------------------
+bool vtkPlusCommandProcessor::TakeQueuedCommand(bool fastLaneOnly, QueuedCommand& queuedCommand)
+{
+  // Lightweight commands first, so that they do not wait for long-running commands that were queued earlier
+  PlusCommandList* queue = &this->FastLaneCommandQueue;
+  if (queue->empty() && !fastLaneOnly)
+  {
+    queue = &this->CommandQueue;
+  }
+  if (queue->empty())
+  {
+    return false;
+  }
+  queuedCommand = queue->front();
+  queue->pop_front();
+  return true;
 }
 
 //----------------------------------------------------------------------------
 int vtkPlusCommandProcessor::ExecuteCommands()
 {
+  if (this->IsRunning())
+  {
+    // The worker threads execute the commands
+    return 0;
+  }
+
   // Implemented in a while loop to not block the mutex during command execution, only during management of the queue.
   int numberOfExecutedCommands(0);
   while (1)
   {
-    vtkSmartPointer<vtkPlusCommand> cmd; // next command to be processed
+    QueuedCommand queuedCommand; // next command to be processed
     {
-      igsioLockGuard<vtkIGSIORecursiveCriticalSection> updateMutexGuardedLock(this->Mutex);
-      if (this->CommandQueue.empty())
+      std::lock_guard<std::mutex> queueLock(this->QueueMutex);
+      if (!this->TakeQueuedCommand(false, queuedCommand))
       {
         return numberOfExecutedCommands;
       }
-      cmd = this->CommandQueue.front();
-      this->CommandQueue.pop_front();
     }
 
-    LOG_DEBUG("Executing command");
-    if (cmd->Execute() != PLUS_SUCCESS)
+    this->ExecuteQueuedCommand(queuedCommand);
+    numberOfExecutedCommands++;
+  }
+
+  // we never actually reach this point
+  return numberOfExecutedCommands;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusCommandProcessor::ExecuteQueuedCommand(const QueuedCommand& queuedCommand)
+{
+  vtkPlusCommand* cmd = queuedCommand.Command;
+  double startTimeSec = vtkIGSIOAccurateTimer::GetSystemTime();
+
+  LOG_DEBUG("Executing command " << cmd->GetName());
+  if (cmd->Execute() != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Command execution failed");
+  }
+
+  double queuingTimeSec = startTimeSec - queuedCommand.QueueTimeSec;
+  double executionTimeSec = vtkIGSIOAccurateTimer::GetSystemTime() - startTimeSec;
+
+  // move the response objects from the command to the processor's queue
+  {
+    igsioLockGuard<vtkIGSIORecursiveCriticalSection> updateMutexGuardedLock(this->Mutex);
+    cmd->PopCommandResponses(this->CommandResponseQueue);
+
+    CommandTimingStatistics& stats = this->TimingStatistics[cmd->GetName()];
+    stats.NumberOfExecutedCommands++;
+    stats.TotalQueuingTimeSec += queuingTimeSec;
+    stats.MaxQueuingTimeSec = std::max(stats.MaxQueuingTimeSec, queuingTimeSec);
+    stats.TotalExecutionTimeSec += executionTimeSec;
+    stats.MaxExecutionTimeSec = std::max(stats.MaxExecutionTimeSec, executionTimeSec);
+  }
+
+  LOG_DEBUG("Command " << cmd->GetName() << " executed in " << executionTimeSec << " sec after waiting " << queuingTimeSec << " sec in the queue");
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusCommandProcessor::EnqueueCommand(vtkPlusCommand* cmd)
+{
+  QueuedCommand queuedCommand;
+  queuedCommand.Command = cmd;
+  queuedCommand.QueueTimeSec = vtkIGSIOAccurateTimer::GetSystemTime();
+  {
+    std::lock_guard<std::mutex> queueLock(this->QueueMutex);
+    if (cmd->IsLightweight())
+    {
+      this->FastLaneCommandQueue.push_back(queuedCommand);
+    }
+    else
+    {
+      this->CommandQueue.push_back(queuedCommand);
+    }
+  }
+  // Both the fast lane and the other worker threads may take the command
+  this->QueueCondition.notify_all();
+}
+
+//----------------------------------------------------------------------------
+std::string vtkPlusCommandProcessor::StartBackgroundJob(const std::string& jobNamePrefix, const BackgroundJobFunction& job)
+{
+  this->JoinBackgroundJobs(false);
+
+  std::lock_guard<std::mutex> jobsLock(this->BackgroundJobsMutex);
+  if (static_cast<int>(this->BackgroundJobs.size()) >= this->MaxNumberOfBackgroundJobs)
+  {
+    LOG_ERROR("Cannot start " << jobNamePrefix << " job: " << this->BackgroundJobs.size() << " background jobs are already running");
+    return "";
+  }
+
+  std::ostringstream jobIdStr;
+  jobIdStr << jobNamePrefix << "_" << ++this->BackgroundJobCounter;
+  std::string jobId = jobIdStr.str();
+
+  BackgroundJob& backgroundJob = this->BackgroundJobs[jobId];
+  std::shared_ptr<std::atomic<bool> > cancelRequested = std::make_shared<std::atomic<bool> >(false);
+  std::shared_ptr<std::atomic<bool> > completed = std::make_shared<std::atomic<bool> >(false);
+  backgroundJob.CancelRequested = cancelRequested;
+  backgroundJob.Completed = completed;
+  backgroundJob.Thread = std::thread([job, jobId, cancelRequested, completed]()
+  {
+    job(jobId, *cancelRequested);
+    *completed = true;
+  });
+
+  LOG_DEBUG("Background job " << jobId << " started");
+  return jobId;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusCommandProcessor::CancelBackgroundJob(const std::string& jobId)
+{
+  std::lock_guard<std::mutex> jobsLock(this->BackgroundJobsMutex);
+  std::map<std::string, BackgroundJob>::iterator jobIt = this->BackgroundJobs.find(jobId);
+  if (jobIt == this->BackgroundJobs.end() || *jobIt->second.Completed)
+  {
+    LOG_ERROR("Cannot cancel background job " << jobId << ": the job is not running");
+    return PLUS_FAIL;
+  }
+  *jobIt->second.CancelRequested = true;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusCommandProcessor::JoinBackgroundJobs(bool cancelAll)
+{
+  std::vector<std::thread> threadsToJoin;
+  {
+    std::lock_guard<std::mutex> jobsLock(this->BackgroundJobsMutex);
+    for (std::map<std::string, BackgroundJob>::iterator jobIt = this->BackgroundJobs.begin(); jobIt != this->BackgroundJobs.end();)
     {
-      LOG_ERROR("Command execution failed");
+      if (cancelAll)
+      {
+        *jobIt->second.CancelRequested = true;
+      }
+      else if (!*jobIt->second.Completed)
+      {
+        ++jobIt;
+        continue;
+      }
+      threadsToJoin.push_back(std::move(jobIt->second.Thread));
+      jobIt = this->BackgroundJobs.erase(jobIt);
     }
+  }
+  // Join without holding the lock, the jobs may start other jobs or cancel them
+  for (std::vector<std::thread>::iterator threadIt = threadsToJoin.begin(); threadIt != threadsToJoin.end(); ++threadIt)
+  {
+    threadIt->join();
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusCommandProcessor::GetCachedImageReply(const std::string& imageName, int headerVersion, const std::string& imageVersion, igtl::MessageBase::Pointer& packedMessage)
+{
+  std::lock_guard<std::mutex> cacheLock(this->ImageReplyCacheMutex);
+  std::map<std::pair<std::string, int>, CachedPackedReply>::iterator cacheIt = this->ImageReplyCache.find(std::make_pair(imageName, headerVersion));
+  if (cacheIt == this->ImageReplyCache.end() || cacheIt->second.Version != imageVersion)
+  {
+    return false;
+  }
+  packedMessage = cacheIt->second.PackedMessage;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusCommandProcessor::SetCachedImageReply(const std::string& imageName, int headerVersion, const std::string& imageVersion, igtl::MessageBase::Pointer packedMessage)
+{
+  std::lock_guard<std::mutex> cacheLock(this->ImageReplyCacheMutex);
+  // Only the latest version is kept for each image, older versions are not requested anymore
+  CachedPackedReply& cachedReply = this->ImageReplyCache[std::make_pair(imageName, headerVersion)];
+  cachedReply.Version = imageVersion;
+  cachedReply.PackedMessage = packedMessage;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusCommandProcessor::GetCachedPolydataReply(const std::string& cacheKey, int headerVersion, const std::string& polydataVersion, igtl::MessageBase::Pointer& packedMessage)
+{
+  std::lock_guard<std::mutex> cacheLock(this->PolydataReplyCacheMutex);
+  std::map<std::pair<std::string, int>, CachedPackedReply>::iterator cacheIt = this->PolydataReplyCache.find(std::make_pair(cacheKey, headerVersion));
+  if (cacheIt == this->PolydataReplyCache.end() || cacheIt->second.Version != polydataVersion)
+  {
+    return false;
+  }
+  packedMessage = cacheIt->second.PackedMessage;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusCommandProcessor::SetCachedPolydataReply(const std::string& cacheKey, int headerVersion, const std::string& polydataVersion, igtl::MessageBase::Pointer packedMessage)
+{
+  std::lock_guard<std::mutex> cacheLock(this->PolydataReplyCacheMutex);
+  // Only the latest version of the model file is kept, the memory of large meshes is released when the file changes
+  CachedPackedReply& cachedReply = this->PolydataReplyCache[std::make_pair(cacheKey, headerVersion)];
+  cachedReply.Version = polydataVersion;
+  cachedReply.PackedMessage = packedMessage;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusCommandProcessor::GetCachedCommandReply(const std::string& cacheKey, const std::string& replyVersion, vtkPlusCommandRTSCommandResponse* reply)
+{
+  std::lock_guard<std::mutex> cacheLock(this->CommandReplyCacheMutex);
+  std::map<std::string, CachedCommandReply>::iterator cacheIt = this->CommandReplyCache.find(cacheKey);
+  if (cacheIt == this->CommandReplyCache.end() || cacheIt->second.ReplyVersion != replyVersion)
+  {
+    return false;
+  }
+  reply->SetStatus(cacheIt->second.Status);
+  reply->SetResultString(cacheIt->second.ResultString);
+  reply->SetErrorString(cacheIt->second.ErrorString);
+  reply->SetUseDefaultFormat(cacheIt->second.UseDefaultFormat);
+  reply->SetParameters(cacheIt->second.Parameters);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusCommandProcessor::SetCachedCommandReply(const std::string& cacheKey, const std::string& replyVersion, vtkPlusCommandRTSCommandResponse* reply)
+{
+  std::lock_guard<std::mutex> cacheLock(this->CommandReplyCacheMutex);
+  CachedCommandReply& cachedReply = this->CommandReplyCache[cacheKey];
+  cachedReply.ReplyVersion = replyVersion;
+  cachedReply.Status = reply->GetStatus();
+  cachedReply.ResultString = reply->GetResultString();
+  cachedReply.ErrorString = reply->GetErrorString();
+  cachedReply.UseDefaultFormat = reply->GetUseDefaultFormat();
+  cachedReply.Parameters = reply->GetParameters();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusCommandProcessor::UpdateCommandSubscription(vtkPlusCommand* cmd, const std::string& commandName, const std::string& commandString, const igtl::MessageBase::MetaDataMap& metaData)
+{
+  const std::string cacheKey = cmd->GetReplyCacheKey();
+  if (cacheKey.empty())
+  {
+    LOG_WARNING("Command " << cmd->GetName() << " does not support subscription, the Subscribe attribute is ignored");
+    return;
+  }
+  const std::pair<unsigned int, std::string> subscriptionKey(cmd->GetClientId(), cacheKey);
+
+  std::lock_guard<std::mutex> subscriptionsLock(this->CommandSubscriptionsMutex);
+  if (cmd->GetSubscriptionRequest() == vtkPlusCommand::SUBSCRIPTION_UNSUBSCRIBE)
+  {
+    this->CommandSubscriptions.erase(subscriptionKey);
+    return;
+  }
+
+  CommandSubscription& subscription = this->CommandSubscriptions[subscriptionKey];
+  subscription.CommandName = commandName;
+  subscription.CommandString = commandString;
+  subscription.DeviceName = cmd->GetDeviceName();
+  subscription.Id = cmd->GetId();
+  subscription.RespondWithCommandMessage = cmd->GetRespondWithCommandMessage();
+  subscription.MetaData = metaData;
+  subscription.Command = vtkSmartPointer<vtkPlusCommand>::Take(cmd->Clone());
+  subscription.Command->SetCommandProcessor(this);
+  subscription.Command->SetClientId(cmd->GetClientId());
+  subscription.Command->SetMetaData(metaData);
+  vtkSmartPointer<vtkXMLDataElement> cmdElement = vtkSmartPointer<vtkXMLDataElement>::Take(vtkXMLUtilities::ReadElementFromString(commandString.c_str()));
+  subscription.Command->ReadConfiguration(cmdElement);
+  // The command is about to be executed, so the client gets the reply of this version
+  subscription.ReplyVersion = subscription.Command->GetReplyVersion();
+}
 
-    // move the response objects from the command to the processor's queue
+//----------------------------------------------------------------------------
+int vtkPlusCommandProcessor::QueueChangedSubscribedCommands()
+{
+  std::vector<std::pair<unsigned int, CommandSubscription> > changedSubscriptions;
+  {
+    std::lock_guard<std::mutex> subscriptionsLock(this->CommandSubscriptionsMutex);
+    for (std::map<std::pair<unsigned int, std::string>, CommandSubscription>::iterator it = this->CommandSubscriptions.begin(); it != this->CommandSubscriptions.end(); ++it)
     {
-      igsioLockGuard<vtkIGSIORecursiveCriticalSection> updateMutexGuardedLock(this->Mutex);
-      cmd->PopCommandResponses(this->CommandResponseQueue);
+      std::string replyVersion = it->second.Command->GetReplyVersion();
+      if (replyVersion != it->second.ReplyVersion)
+      {
+        it->second.ReplyVersion = replyVersion;
+        changedSubscriptions.push_back(std::make_pair(it->first.first, it->second));
+      }
     }
+  }
+  // Queued without holding the lock, as the commands update their subscriptions
+  for (std::vector<std::pair<unsigned int, CommandSubscription> >::iterator it = changedSubscriptions.begin(); it != changedSubscriptions.end(); ++it)
+  {
+    const CommandSubscription& subscription = it->second;
+    LOG_DEBUG("Reply of subscribed command " << subscription.Command->GetName() << " changed, pushing it to client " << it->first);
+    this->QueueCommand(subscription.RespondWithCommandMessage, it->first, subscription.CommandName, subscription.CommandString,
+                       subscription.DeviceName, subscription.Id, subscription.MetaData);
+  }
+  return static_cast<int>(changedSubscriptions.size());
+}
 
-    numberOfExecutedCommands++;
+//----------------------------------------------------------------------------
+void vtkPlusCommandProcessor::RemoveCommandSubscriptions(unsigned int clientId)
+{
+  std::lock_guard<std::mutex> subscriptionsLock(this->CommandSubscriptionsMutex);
+  for (std::map<std::pair<unsigned int, std::string>, CommandSubscription>::iterator it = this->CommandSubscriptions.begin(); it != this->CommandSubscriptions.end();)
+  {
+    if (it->first.first == clientId)
+    {
+      it = this->CommandSubscriptions.erase(it);
+    }
+    else
+    {
+      ++it;
+    }
   }
+}
 
-  // we never actually reach this point
-  return numberOfExecutedCommands;
+//----------------------------------------------------------------------------
+void vtkPlusCommandProcessor::GetCommandTimingStatistics(CommandTimingStatisticsMap& statistics)
+{
+  igsioLockGuard<vtkIGSIORecursiveCriticalSection> updateMutexGuardedLock(this->Mutex);
+  statistics = this->TimingStatistics;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusCommandProcessor::ResetCommandTimingStatistics()
+{
+  igsioLockGuard<vtkIGSIORecursiveCriticalSection> updateMutexGuardedLock(this->Mutex);
+  this->TimingStatistics.clear();
 }
 
 //----------------------------------------------------------------------------
@@ -291,9 +630,13 @@ PlusStatus vtkPlusCommandProcessor::QueueCommand(bool respondUsingIGTLCommand, u
   cmd->SetId(uid);
   cmd->SetRespondWithCommandMessage(respondUsingIGTLCommand);
 
+  if (cmd->GetSubscriptionRequest() != vtkPlusCommand::SUBSCRIPTION_UNCHANGED)
+  {
+    this->UpdateCommandSubscription(cmd, commandName, commandString, metaData);
+  }
+
   // Add command to the execution queue
-  igsioLockGuard<vtkIGSIORecursiveCriticalSection> updateMutexGuardedLock(this->Mutex);
-  this->CommandQueue.push_back(cmd);
+  this->EnqueueCommand(cmd);
 
   return PLUS_SUCCESS;
 }
@@ -350,11 +693,7 @@ PlusStatus vtkPlusCommandProcessor::QueueGetImageMetaData(unsigned int clientId,
   cmdGetImage->SetDeviceName(deviceName.c_str());
   cmdGetImage->SetNameToGetImageMeta();
   cmdGetImage->SetImageId(deviceName.c_str());
-  {
-    // Add command to the execution queue
-    igsioLockGuard<vtkIGSIORecursiveCriticalSection> updateMutexGuardedLock(this->Mutex);
-    this->CommandQueue.push_back(cmdGetImage);
-  }
+  this->EnqueueCommand(cmdGetImage);
   return PLUS_SUCCESS;
 }
 
@@ -367,14 +706,17 @@ PlusStatus vtkPlusCommandProcessor::QueueGetImage(unsigned int clientId, const s
   cmdGetImage->SetDeviceName(deviceName.c_str());
   cmdGetImage->SetNameToGetImage();
   cmdGetImage->SetImageId(deviceName.c_str());
-  {
-    // Add command to the execution queue
-    igsioLockGuard<vtkIGSIORecursiveCriticalSection> updateMutexGuardedLock(this->Mutex);
-    this->CommandQueue.push_back(cmdGetImage);
-  }
+  this->EnqueueCommand(cmdGetImage);
   return PLUS_SUCCESS;
 }
 
+//------------------------------------------------------------------------------
+void vtkPlusCommandProcessor::QueueCommandResponses(PlusCommandResponseList& responses)
+{
+  igsioLockGuard<vtkIGSIORecursiveCriticalSection> updateMutexGuardedLock(this->Mutex);
+  this->CommandResponseQueue.splice(this->CommandResponseQueue.end(), responses, responses.begin(), responses.end());
+}
+
 //------------------------------------------------------------------------------
 void vtkPlusCommandProcessor::PopCommandResponses(PlusCommandResponseList& responses)
 {
@@ -388,6 +730,6 @@ void vtkPlusCommandProcessor::PopCommandResponses(PlusCommandResponseList& respo
 //------------------------------------------------------------------------------
 bool vtkPlusCommandProcessor::IsRunning()
 {
-  return this->CommandExecutionActive.second;
+  return this->CommandExecutionActive;
 }
 
@@ -9,12 +9,19 @@
 
 #include "vtkPlusServerExport.h"
 
-#include "vtkMultiThreader.h"
 #include "vtkObject.h"
 #include "vtkPlusCommand.h"
 #include "vtkPlusCommandResponse.h"
 #include "vtkPlusOpenIGTLinkServer.h"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 class vtkImageData;
 class vtkMatrix4x4;
@@ -23,7 +30,10 @@ class vtkMatrix4x4;
   \class vtkPlusCommandProcessor
   \brief Creates a PlusCommand from a string.
   If the commands are to be executed on the main thread then call ExecuteCommands() periodically from the main thread.
-  If the commands are to be executed on a separate thread (to allow background processing, but maybe requiring more synchronization) call Start() to start an internal processing thread.
+  If the commands are to be executed on separate threads (to allow background processing, but maybe requiring more synchronization) call Start() to start
+  the worker threads. Commands are executed by a pool of NumberOfWorkerThreads threads, except lightweight commands (see vtkPlusCommand::IsLightweight),
+  which are executed by a separate fast lane thread so that they are not blocked by long-running commands. With one worker thread the commands that are
+  not lightweight are executed one after the other, in the order they are received.
   Probably one of the processing models would be enough, but at this point it's not clear which one is better.
   TODO: keep only one method and remove the other approach completely once the processing model decision is finalized.
   \ingroup PlusLibPlusServer
@@ -41,15 +51,47 @@ public:
   */
   int ExecuteCommands();
 
-  /*! Start thread for processing the commands in the queue. Must be called from the main thread. */
+  /*!
+    Start the worker threads for processing the commands. While the worker threads are running, ExecuteCommands() does nothing.
+    Must be called from the main thread.
+  */
   virtual PlusStatus Start();
 
-  /*! Stop command processing. Must be called from the main thread. */
+  /*! Stop command processing. Commands that are already queued are executed before the worker threads stop. Must be called from the main thread. */
   virtual PlusStatus Stop();
 
-  /*! Returns true if the command processing thread is running. Can be called from any thread. */
+  /*! Returns true if the command processing threads are running. Can be called from any thread. */
   virtual bool IsRunning();
 
+  /*! Number of threads that execute the commands that are not lightweight. Takes effect at the next Start(). */
+  vtkSetMacro(NumberOfWorkerThreads, int);
+  vtkGetMacro(NumberOfWorkerThreads, int);
+
+  /*! Time spent by the commands with the same name in the queue and in execution */
+  struct CommandTimingStatistics
+  {
+    CommandTimingStatistics()
+      : NumberOfExecutedCommands(0)
+      , TotalQueuingTimeSec(0.0)
+      , MaxQueuingTimeSec(0.0)
+      , TotalExecutionTimeSec(0.0)
+      , MaxExecutionTimeSec(0.0)
+    {
+    }
+    unsigned int NumberOfExecutedCommands;
+    double TotalQueuingTimeSec;
+    double MaxQueuingTimeSec;
+    double TotalExecutionTimeSec;
+    double MaxExecutionTimeSec;
+  };
+  typedef std::map<std::string, CommandTimingStatistics> CommandTimingStatisticsMap;
+
+  /*! Get the timing statistics of the executed commands, by command name. Can be called from any thread. */
+  void GetCommandTimingStatistics(CommandTimingStatisticsMap& statistics);
+
+  /*! Clear the timing statistics. Can be called from any thread. */
+  void ResetCommandTimingStatistics();
+
   /*!
     Register custom command. Must be called from the main thread.
     \param cmd It should point to a valid vtkPlusCommand instance. The caller can delete the cmd object after the call.
@@ -81,6 +123,71 @@ public:
   !*/
   PlusStatus QueueGetImage(unsigned int clientId, const std::string& deviceName);
 
+  /*! Add responses to the response queue, the responses are removed from the provided list. Can be called from any thread. */
+  virtual void QueueCommandResponses(PlusCommandResponseList& responses);
+
+  /*!
+    Long-running part of a command that is executed after the command has responded.
+    The job should check cancelRequested regularly and return soon after it is set.
+    Responses of the job (e.g., progress reports) can be sent using QueueCommandResponses.
+  */
+  typedef std::function<void(const std::string& jobId, const std::atomic<bool>& cancelRequested)> BackgroundJobFunction;
+
+  /*!
+    Start a background job on its own thread, so that neither the command execution nor the data sending is blocked by it.
+    Can be called from any thread.
+    \param jobNamePrefix The job id is created from this prefix and a counter
+    eturn Id of the job, empty if MaxNumberOfBackgroundJobs jobs are already running
+  */
+  std::string StartBackgroundJob(const std::string& jobNamePrefix, const BackgroundJobFunction& job);
+
+  /*! Request a running background job to stop. Can be called from any thread. */
+  PlusStatus CancelBackgroundJob(const std::string& jobId);
+
+  /*!
+    Get the packed IMAGE message that was sent last time for the given image name and header version.
+    Returns false if there is no cached message or it was packed from a different version of the image.
+    Can be called from any thread.
+  */
+  bool GetCachedImageReply(const std::string& imageName, int headerVersion, const std::string& imageVersion, igtl::MessageBase::Pointer& packedMessage);
+
+  /*! Store a packed IMAGE message for reuse by later requests for the same image version. Can be called from any thread. */
+  void SetCachedImageReply(const std::string& imageName, int headerVersion, const std::string& imageVersion, igtl::MessageBase::Pointer packedMessage);
+
+  /*!
+    Get the packed POLYDATA message that was sent last time for the given key (see vtkPlusCommandPolydataResponse::GetReplyCacheKey)
+    and header version. Returns false if there is no cached message or it was packed from a different version of the model file.
+    Can be called from any thread.
+  */
+  bool GetCachedPolydataReply(const std::string& cacheKey, int headerVersion, const std::string& polydataVersion, igtl::MessageBase::Pointer& packedMessage);
+
+  /*! Store a packed POLYDATA message for reuse by later requests for the same model file version. Can be called from any thread. */
+  void SetCachedPolydataReply(const std::string& cacheKey, int headerVersion, const std::string& polydataVersion, igtl::MessageBase::Pointer packedMessage);
+
+  /*!
+    Get the reply of a command that was stored for the same cache key and reply version (see vtkPlusCommand::GetReplyCacheKey).
+    The status, result, error and parameters are copied to reply. Returns false if there is no such reply.
+    Can be called from any thread.
+  */
+  bool GetCachedCommandReply(const std::string& cacheKey, const std::string& replyVersion, vtkPlusCommandRTSCommandResponse* reply);
+
+  /*! Store the reply of a command for reuse by later commands with the same cache key and reply version. Can be called from any thread. */
+  void SetCachedCommandReply(const std::string& cacheKey, const std::string& replyVersion, vtkPlusCommandRTSCommandResponse* reply);
+
+  /*!
+    Queue the subscribed commands whose reply version changed since they were last queued, so that the new replies are pushed to the clients.
+    Called periodically by the data sender thread of the server. Can be called from any thread.
+    \return Number of queued commands
+  */
+  int QueueChangedSubscribedCommands();
+
+  /*! Remove the command subscriptions of a client (e.g., when it disconnects). Can be called from any thread. */
+  void RemoveCommandSubscriptions(unsigned int clientId);
+
+  /*! Maximum number of background jobs that can run concurrently */
+  vtkSetMacro(MaxNumberOfBackgroundJobs, int);
+  vtkGetMacro(MaxNumberOfBackgroundJobs, int);
+
   /*!
     Return the queued command responses and removes the items from the queue (so that each item is returned only once) and clears the response queue.
     The caller is responsible for deleting the returned response objects.
@@ -94,8 +201,30 @@ public:
 protected:
   vtkPlusCommand* CreatePlusCommand(const std::string& commandName, const std::string& commandStr, const igtl::MessageBase::MetaDataMap& metaData);
 
-  /*! Thread for client connection handling */
-  static void* CommandExecutionThread(vtkMultiThreader::ThreadInfo* data);
+  struct QueuedCommand
+  {
+    vtkSmartPointer<vtkPlusCommand> Command;
+    /*! System time when the command was queued */
+    double QueueTimeSec;
+  };
+
+  /*! Add the command to the fast lane queue (if it is lightweight) or to the command queue */
+  void EnqueueCommand(vtkPlusCommand* cmd);
+
+  /*! Take the next command from the fast lane queue or, if allowed, from the command queue. Returns false if both are empty. QueueMutex must be locked. */
+  bool TakeQueuedCommand(bool fastLaneOnly, QueuedCommand& queuedCommand);
+
+  /*! Add, update or remove the subscription of the client to the command, as requested by its Subscribe attribute */
+  void UpdateCommandSubscription(vtkPlusCommand* cmd, const std::string& commandName, const std::string& commandString, const igtl::MessageBase::MetaDataMap& metaData);
+
+  /*! Execute a command, collect its responses and update the timing statistics */
+  void ExecuteQueuedCommand(const QueuedCommand& queuedCommand);
+
+  /*! Main function of the worker threads. Returns when stop is requested and the queue is empty. */
+  void CommandExecutionThread(bool fastLane);
+
+  /*! Wait for the threads of the background jobs that have completed. If cancelAll is true then all jobs are canceled and waited for. */
+  void JoinBackgroundJobs(bool cancelAll);
 
   vtkPlusCommandProcessor();
   virtual ~vtkPlusCommandProcessor();
@@ -104,29 +233,93 @@ private:
   /*! Link to the server that owns this command processor */
   vtkPlusOpenIGTLinkServer* PlusServer;
 
-  /*! vtkMultiThreader instance for controlling threads */
-  vtkSmartPointer<vtkMultiThreader> Threader;
-
   /*! Mutex instance for safe data access */
   vtkSmartPointer<vtkIGSIORecursiveCriticalSection> Mutex;
 
-  // Active flag for threads (first: request, second: respond )
-  std::pair<bool, bool> CommandExecutionActive;
+  int NumberOfWorkerThreads;
+
+  /*! Threads executing the commands, the last one is the fast lane thread that only executes lightweight commands */
+  std::vector<std::thread> WorkerThreads;
+
+  /*! Set while the worker threads should run, guarded by QueueMutex */
+  std::atomic<bool> CommandExecutionActive;
+
+  /*! Guards the command queues, the worker threads wait on QueueCondition for new commands */
+  std::mutex QueueMutex;
+  std::condition_variable QueueCondition;
+
+  CommandTimingStatisticsMap TimingStatistics;
+
+  struct BackgroundJob
+  {
+    std::thread Thread;
+    std::shared_ptr<std::atomic<bool> > CancelRequested;
+    std::shared_ptr<std::atomic<bool> > Completed;
+  };
+
+  /*! Running background jobs by job id, guarded by BackgroundJobsMutex */
+  std::map<std::string, BackgroundJob> BackgroundJobs;
+  std::mutex BackgroundJobsMutex;
+  unsigned int BackgroundJobCounter;
+  int MaxNumberOfBackgroundJobs;
+
+  struct CachedPackedReply
+  {
+    std::string Version;
+    igtl::MessageBase::Pointer PackedMessage;
+  };
+
+  /*! Packed image replies by image name and header version, guarded by ImageReplyCacheMutex */
+  std::map<std::pair<std::string, int>, CachedPackedReply> ImageReplyCache;
+  std::mutex ImageReplyCacheMutex;
+
+  /*! Packed polydata replies by cache key and header version, guarded by PolydataReplyCacheMutex */
+  std::map<std::pair<std::string, int>, CachedPackedReply> PolydataReplyCache;
+  std::mutex PolydataReplyCacheMutex;
+
+  struct CachedCommandReply
+  {
+    std::string ReplyVersion;
+    PlusStatus Status;
+    std::string ResultString;
+    std::string ErrorString;
+    bool UseDefaultFormat;
+    igtl::MessageBase::MetaDataMap Parameters;
+  };
+
+  /*! Command replies by cache key, only the latest version is kept. Guarded by CommandReplyCacheMutex. */
+  std::map<std::string, CachedCommandReply> CommandReplyCache;
+  std::mutex CommandReplyCacheMutex;
+
+  /*! Everything that is needed for queuing a subscribed command again */
+  struct CommandSubscription
+  {
+    std::string CommandName;
+    std::string CommandString;
+    std::string DeviceName;
+    uint32_t Id;
+    bool RespondWithCommandMessage;
+    igtl::MessageBase::MetaDataMap MetaData;
+    /*! Only used for getting the current reply version, it is not executed */
+    vtkSmartPointer<vtkPlusCommand> Command;
+    /*! Reply version when the command was last queued */
+    std::string ReplyVersion;
+  };
 
-  // Thread identifier
-  int CommandExecutionThreadId;
+  /*! Subscriptions by client id and reply cache key, guarded by CommandSubscriptionsMutex */
+  std::map<std::pair<unsigned int, std::string>, CommandSubscription> CommandSubscriptions;
+  std::mutex CommandSubscriptionsMutex;
 
   /*! Map command names and the New() static methods of vtkPlusCommand classes */
   std::map<std::string, vtkPlusCommand*> RegisteredCommands;
 
   /*!
-    This queue contains all the active commands.
-    After a command's execute method is called it may still remain active (remain in the queue),
-    until it signals that it is completed.
+    These queues contain the commands that are waiting for execution, guarded by QueueMutex.
+    Lightweight commands are queued in FastLaneCommandQueue.
   */
-  //std::list<vtkPlusCommand*> CommandQueue;
-  typedef std::list< vtkSmartPointer<vtkPlusCommand> > PlusCommandList;
+  typedef std::list<QueuedCommand> PlusCommandList;
   PlusCommandList CommandQueue;
+  PlusCommandList FastLaneCommandQueue;
   PlusCommandResponseList CommandResponseQueue;
 
   vtkPlusCommandProcessor(const vtkPlusCommandProcessor&);  // Not implemented.
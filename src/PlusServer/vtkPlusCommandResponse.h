@@ -132,6 +132,14 @@ public:
   vtkGetMacro(ImageData, vtkImageData*);
   vtkSetObjectMacro(ImageToReferenceTransform, vtkMatrix4x4);
   vtkGetMacro(ImageToReferenceTransform, vtkMatrix4x4*);
+
+  /*! Version of the image content as reported by the device, if not empty then the packed message is cached for this version */
+  vtkGetMacro(ImageVersion, std::string);
+  vtkSetMacro(ImageVersion, std::string);
+
+  /*! Already packed IMAGE message from the image reply cache, if set then it is sent instead of packing ImageData */
+  igtl::MessageBase::Pointer GetPackedMessage() const { return this->PackedMessage; }
+  void SetPackedMessage(igtl::MessageBase::Pointer packedMessage) { this->PackedMessage = packedMessage; }
 protected:
   vtkPlusCommandImageResponse()
     : ImageData(NULL)
@@ -146,6 +154,8 @@ protected:
   std::string ImageName;
   vtkImageData* ImageData;
   vtkMatrix4x4* ImageToReferenceTransform;
+  std::string ImageVersion;
+  igtl::MessageBase::Pointer PackedMessage;
 private:
   // We have pointers in this class, so make sure we don't try to accidentally copy it
   vtkPlusCommandImageResponse(const vtkPlusCommandImageResponse&);
@@ -163,9 +173,33 @@ public:
   vtkSetMacro(PolyDataName, std::string);
   vtkSetObjectMacro(PolyData, vtkPolyData);
   vtkGetMacro(PolyData, vtkPolyData*);
+
+  /*! Version of the model file the polydata is read from, if not empty then the packed message is cached for this version */
+  vtkGetMacro(PolyDataVersion, std::string);
+  vtkSetMacro(PolyDataVersion, std::string);
+
+  /*! Level of detail of the polydata, 0 is the coarsest and NumberOfLevelsOfDetail-1 is the original model */
+  vtkGetMacro(LevelOfDetail, int);
+  vtkSetMacro(LevelOfDetail, int);
+  vtkGetMacro(NumberOfLevelsOfDetail, int);
+  vtkSetMacro(NumberOfLevelsOfDetail, int);
+
+  /*! Name of the packed message in the polydata reply cache */
+  std::string GetReplyCacheKey() const
+  {
+    std::ostringstream key;
+    key << this->PolyDataName << "|" << this->LevelOfDetail << "/" << this->NumberOfLevelsOfDetail;
+    return key.str();
+  }
+
+  /*! Already packed POLYDATA message from the polydata reply cache, if set then it is sent instead of packing PolyData */
+  igtl::MessageBase::Pointer GetPackedMessage() const { return this->PackedMessage; }
+  void SetPackedMessage(igtl::MessageBase::Pointer packedMessage) { this->PackedMessage = packedMessage; }
 protected:
   vtkPlusCommandPolydataResponse()
     : PolyData(NULL)
+    , LevelOfDetail(0)
+    , NumberOfLevelsOfDetail(1)
   {
   }
   virtual ~vtkPlusCommandPolydataResponse()
@@ -174,6 +208,10 @@ protected:
   }
   std::string   PolyDataName;
   vtkPolyData*  PolyData;
+  std::string   PolyDataVersion;
+  int           LevelOfDetail;
+  int           NumberOfLevelsOfDetail;
+  igtl::MessageBase::Pointer PackedMessage;
 
 private:
   vtkPlusCommandPolydataResponse(const vtkPlusCommandPolydataResponse&);
@@ -5,6 +5,7 @@ See License.txt for details.
 =========================================================Plus=header=end*/
 
 #include "PlusConfigure.h"
+#include "PlusPacingTimer.h"
 #include "igtlCommandMessage.h"
 #include "igtlCommon.h"
 #include "igtlMessageHeader.h"
@@ -17,6 +18,9 @@ See License.txt for details.
 #include "vtkIGSIORecursiveCriticalSection.h"
 #include "vtkXMLUtilities.h"
 
+// STL includes
+#include <memory>
+
 const float vtkPlusOpenIGTLinkClient::CLIENT_SOCKET_TIMEOUT_SEC = 0.5;
 
 vtkStandardNewMacro(vtkPlusOpenIGTLinkClient);
@@ -42,6 +46,8 @@ vtkPlusOpenIGTLinkClient::vtkPlusOpenIGTLinkClient()
 //----------------------------------------------------------------------------
 vtkPlusOpenIGTLinkClient::~vtkPlusOpenIGTLinkClient()
 {
+  // Futures of the asynchronous commands must not be left without a value
+  this->FailPendingCommands("Client is destroyed before the reply was received");
 }
 
 //----------------------------------------------------------------------------
@@ -99,6 +105,9 @@ PlusStatus vtkPlusOpenIGTLinkClient::Disconnect()
     this->DataReceiverThreadId = -1;
   }
 
+  // No more replies can be received
+  this->FailPendingCommands("Disconnected from the server before the reply was received");
+
   return PLUS_SUCCESS;
 }
 
@@ -108,11 +117,6 @@ PlusStatus vtkPlusOpenIGTLinkClient::SendCommand(vtkPlusCommand* command)
   // Get the XML string
   vtkSmartPointer<vtkXMLDataElement> cmdConfig = vtkSmartPointer<vtkXMLDataElement>::New();
   command->WriteConfiguration(cmdConfig);
-  std::ostringstream xmlStr;
-  vtkXMLUtilities::FlattenElement(cmdConfig, xmlStr);
-  xmlStr << std::ends;
-
-  std::ostringstream commandUidStringStream;
 
   // Ensure commandUid is populated
   igtlUint32 commandUid;
@@ -130,11 +134,115 @@ PlusStatus vtkPlusOpenIGTLinkClient::SendCommand(vtkPlusCommand* command)
     else
     {
       // command UID is not specified, generate one automatically
+      igsioLockGuard<vtkIGSIORecursiveCriticalSection> updateMutexGuardedLock(this->Mutex);
       commandUid = LastGeneratedCommandId;
       LastGeneratedCommandId++;
     }
   }
 
+  return this->SendCommandMessage(command->GetName(), cmdConfig, commandUid);
+}
+
+//----------------------------------------------------------------------------
+std::future<vtkPlusOpenIGTLinkClient::CommandReply> vtkPlusOpenIGTLinkClient::SendCommandAsync(vtkPlusCommand* command)
+{
+  std::shared_ptr<std::promise<CommandReply> > replyPromise = std::make_shared<std::promise<CommandReply> >();
+  std::future<CommandReply> replyFuture = replyPromise->get_future();
+  if (this->SendCommandAsync(command, [replyPromise](const CommandReply & reply) { replyPromise->set_value(reply); }) != PLUS_SUCCESS)
+  {
+    CommandReply failedReply;
+    failedReply.OriginalCommandId = command->GetId();
+    failedReply.CommandName = command->GetName();
+    failedReply.ErrorString = "Failed to send command";
+    replyPromise->set_value(failedReply);
+  }
+  return replyFuture;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusOpenIGTLinkClient::SendCommandAsync(vtkPlusCommand* command, ReplyCallback callback)
+{
+  vtkSmartPointer<vtkXMLDataElement> cmdConfig = vtkSmartPointer<vtkXMLDataElement>::New();
+  command->WriteConfiguration(cmdConfig);
+  return this->SendPipelinedCommand(command->GetName(), cmdConfig, command->GetId(), callback);
+}
+
+//----------------------------------------------------------------------------
+std::future<vtkPlusOpenIGTLinkClient::CommandReply> vtkPlusOpenIGTLinkClient::SendCommandAsync(vtkXMLDataElement* commandConfig)
+{
+  std::shared_ptr<std::promise<CommandReply> > replyPromise = std::make_shared<std::promise<CommandReply> >();
+  std::future<CommandReply> replyFuture = replyPromise->get_future();
+
+  PlusStatus sendStatus = PLUS_FAIL;
+  if (commandConfig == NULL || commandConfig->GetAttribute("Name") == NULL)
+  {
+    LOG_ERROR("Failed to send command: command name is not specified");
+  }
+  else
+  {
+    int commandId = 0;
+    commandConfig->GetScalarAttribute("Id", commandId);
+    sendStatus = this->SendPipelinedCommand(commandConfig->GetAttribute("Name"), commandConfig, static_cast<igtlUint32>(commandId),
+                                            [replyPromise](const CommandReply & reply) { replyPromise->set_value(reply); });
+  }
+  if (sendStatus != PLUS_SUCCESS)
+  {
+    CommandReply failedReply;
+    failedReply.ErrorString = "Failed to send command";
+    replyPromise->set_value(failedReply);
+  }
+  return replyFuture;
+}
+
+//----------------------------------------------------------------------------
+int vtkPlusOpenIGTLinkClient::GetNumberOfPendingCommands()
+{
+  igsioLockGuard<vtkIGSIORecursiveCriticalSection> updateMutexGuardedLock(this->Mutex);
+  return static_cast<int>(this->PendingCommands.size());
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusOpenIGTLinkClient::SendPipelinedCommand(const std::string& commandName, vtkXMLDataElement* commandConfig, igtlUint32 commandUid, ReplyCallback callback)
+{
+  {
+    igsioLockGuard<vtkIGSIORecursiveCriticalSection> updateMutexGuardedLock(this->Mutex);
+    if (commandUid == 0)
+    {
+      // command UID is not specified, generate one that is not used by any pending command
+      // (the timestamp is not used even for v1 servers, as many commands may be sent within the same second)
+      do
+      {
+        commandUid = ++LastGeneratedCommandId;
+      }
+      while (commandUid == 0 || this->PendingCommands.find(commandUid) != this->PendingCommands.end());
+    }
+    else if (this->PendingCommands.find(commandUid) != this->PendingCommands.end())
+    {
+      LOG_ERROR("Failed to send command " << commandName << ": a command with the same ID (" << commandUid << ") is waiting for its reply");
+      return PLUS_FAIL;
+    }
+    // The callback is registered before sending, as the reply may arrive before the send returns
+    this->PendingCommands[commandUid] = callback;
+  }
+
+  if (this->SendCommandMessage(commandName, commandConfig, commandUid) != PLUS_SUCCESS)
+  {
+    igsioLockGuard<vtkIGSIORecursiveCriticalSection> updateMutexGuardedLock(this->Mutex);
+    this->PendingCommands.erase(commandUid);
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusOpenIGTLinkClient::SendCommandMessage(const std::string& commandName, vtkXMLDataElement* commandConfig, igtlUint32 commandUid)
+{
+  std::ostringstream xmlStr;
+  vtkXMLUtilities::FlattenElement(commandConfig, xmlStr);
+  xmlStr << std::ends;
+
+  std::ostringstream commandUidStringStream;
+
   // Generate the device name
   std::ostringstream deviceNameSs;
   if (igtl::IGTLProtocolToHeaderLookup(this->GetServerIGTLVersion()) >= IGTL_HEADER_VERSION_2)
@@ -165,7 +273,7 @@ PlusStatus vtkPlusOpenIGTLinkClient::SendCommand(vtkPlusCommand* command)
     igtl::CommandMessage::Pointer cmdMsg = dynamic_cast<igtl::CommandMessage*>(this->IgtlMessageFactory->CreateSendMessage("COMMAND", igtl::IGTLProtocolToHeaderLookup(this->GetServerIGTLVersion())).GetPointer());
     cmdMsg->SetDeviceName(deviceNameSs.str().c_str());
     cmdMsg->SetCommandId(commandUid);
-    cmdMsg->SetCommandName(command->GetName());
+    cmdMsg->SetCommandName(commandName);
     cmdMsg->SetCommandContent(xmlStr.str().c_str());
     cmdMsg->Pack();
     message = cmdMsg;
@@ -213,81 +321,22 @@ PlusStatus vtkPlusOpenIGTLinkClient::ReceiveReply(PlusStatus& result, int32_t& o
     {
       // save command reply
       igsioLockGuard<vtkIGSIORecursiveCriticalSection> updateMutexGuardedLock(this->Mutex);
-      if (!this->Replies.empty())
+      while (!this->Replies.empty())
       {
         igtl::MessageBase::Pointer message = this->Replies.front();
-        if (typeid(*message) == typeid(igtl::StringMessage))
-        {
-          // Process the command as v1/v2 string reply
-          igtl::StringMessage::Pointer strMsg = dynamic_cast<igtl::StringMessage*>(message.GetPointer());
-
-          if (vtkPlusCommand::IsReplyDeviceName(strMsg->GetDeviceName()))
-          {
-            if (igsioCommon::StringToInt<int32_t>(vtkPlusCommand::GetUidFromCommandDeviceName(strMsg->GetDeviceName()).c_str(), outOriginalCommandId) != PLUS_SUCCESS)
-            {
-              LOG_ERROR("Failed to get UID from command device name.");
-              continue;
-            }
-          }
-          vtkSmartPointer<vtkXMLDataElement> cmdElement = vtkSmartPointer<vtkXMLDataElement>::Take(vtkXMLUtilities::ReadElementFromString(strMsg->GetString()));
-          if (cmdElement == NULL)
-          {
-            LOG_ERROR("Unable to parse command reply as XML. Skipping.");
-            continue;
-          }
-          if (cmdElement->GetAttribute("Status") == NULL)
-          {
-            LOG_ERROR("No status returned. Skipping.");
-            continue;
-          }
-          result = std::string(cmdElement->GetAttribute("Status")) == "SUCCESS" ? PLUS_SUCCESS : PLUS_FAIL;
-          if (cmdElement->GetAttribute("Message") == NULL)
-          {
-            LOG_ERROR("No message returned. Skipping.");
-            continue;
-          }
-          outContent = cmdElement->GetAttribute("Message");
-        }
-        else if (typeid(*message) == typeid(igtl::RTSCommandMessage))
-        {
-          // Process the command as v3 RTS_Command
-          igtl::RTSCommandMessage::Pointer rtsCommandMsg = dynamic_cast<igtl::RTSCommandMessage*>(message.GetPointer());
-
-          vtkSmartPointer<vtkXMLDataElement> cmdElement = vtkSmartPointer<vtkXMLDataElement>::Take(vtkXMLUtilities::ReadElementFromString(rtsCommandMsg->GetCommandContent().c_str()));
-
-          outCommandName = rtsCommandMsg->GetCommandName();
-          outOriginalCommandId = rtsCommandMsg->GetCommandId();
-
-          XML_FIND_NESTED_ELEMENT_OPTIONAL(resultElement, cmdElement, "Result");
-          if (resultElement != NULL)
-          {
-            result = STRCASECMP(resultElement->GetCharacterData(), "true") == 0 ? PLUS_SUCCESS : PLUS_FAIL;
-          }
-          XML_FIND_NESTED_ELEMENT_OPTIONAL(errorElement, cmdElement, "Error");
-          if (!result && errorElement == NULL)
-          {
-            LOG_ERROR("Server sent error without reason. Notify server developers.");
-          }
-          else if (!result && errorElement != NULL)
-          {
-            outErrorString = errorElement->GetCharacterData();
-          }
-          XML_FIND_NESTED_ELEMENT_REQUIRED(messageElement, cmdElement, "Message");
-          outContent = messageElement->GetCharacterData();
-
-          outParameters = rtsCommandMsg->GetMetaData();
-        }
-        else if (typeid(*message) == typeid(igtl::RTSTrackingDataMessage))
+        this->Replies.pop_front();
+        CommandReply reply;
+        if (ParseReply(message, reply) != PLUS_SUCCESS)
         {
-          igtl::RTSTrackingDataMessage* rtsTrackingMsg = dynamic_cast<igtl::RTSTrackingDataMessage*>(message.GetPointer());
-
-          result = rtsTrackingMsg->GetStatus() == 0 ? PLUS_SUCCESS : PLUS_FAIL;
-          outContent = (rtsTrackingMsg->GetStatus() == 0 ? "SUCCESS" : "FAILURE");
-          outCommandName = "RTSTrackingDataMessage";
-          outOriginalCommandId = -1;
+          // the reason is already logged, skip the reply
+          continue;
         }
-
-        this->Replies.pop_front();
+        result = reply.Result;
+        outOriginalCommandId = reply.OriginalCommandId;
+        outErrorString = reply.ErrorString;
+        outContent = reply.Content;
+        outParameters = reply.Parameters;
+        outCommandName = reply.CommandName;
         return PLUS_SUCCESS;
       }
     }
@@ -296,11 +345,131 @@ PlusStatus vtkPlusOpenIGTLinkClient::ReceiveReply(PlusStatus& result, int32_t& o
       LOG_DEBUG("vtkPlusOpenIGTLinkClient::ReceiveReply timeout passed (" << timeoutSec << "sec)");
       return PLUS_FAIL;
     }
-    vtkIGSIOAccurateTimer::Delay(0.010);
+    PlusPacingTimer::Delay(0.010);
   }
   return PLUS_FAIL;
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusOpenIGTLinkClient::ParseReply(igtl::MessageBase::Pointer message, CommandReply& reply)
+{
+  if (typeid(*message) == typeid(igtl::StringMessage))
+  {
+    // Process the command as v1/v2 string reply
+    igtl::StringMessage::Pointer strMsg = dynamic_cast<igtl::StringMessage*>(message.GetPointer());
+
+    if (vtkPlusCommand::IsReplyDeviceName(strMsg->GetDeviceName()))
+    {
+      if (igsioCommon::StringToInt<int32_t>(vtkPlusCommand::GetUidFromCommandDeviceName(strMsg->GetDeviceName()).c_str(), reply.OriginalCommandId) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to get UID from command device name.");
+        return PLUS_FAIL;
+      }
+    }
+    vtkSmartPointer<vtkXMLDataElement> cmdElement = vtkSmartPointer<vtkXMLDataElement>::Take(vtkXMLUtilities::ReadElementFromString(strMsg->GetString()));
+    if (cmdElement == NULL)
+    {
+      LOG_ERROR("Unable to parse command reply as XML. Skipping.");
+      return PLUS_FAIL;
+    }
+    if (cmdElement->GetAttribute("Status") == NULL)
+    {
+      LOG_ERROR("No status returned. Skipping.");
+      return PLUS_FAIL;
+    }
+    reply.Result = std::string(cmdElement->GetAttribute("Status")) == "SUCCESS" ? PLUS_SUCCESS : PLUS_FAIL;
+    if (cmdElement->GetAttribute("Message") == NULL)
+    {
+      LOG_ERROR("No message returned. Skipping.");
+      return PLUS_FAIL;
+    }
+    reply.Content = cmdElement->GetAttribute("Message");
+  }
+  else if (typeid(*message) == typeid(igtl::RTSCommandMessage))
+  {
+    // Process the command as v3 RTS_Command
+    igtl::RTSCommandMessage::Pointer rtsCommandMsg = dynamic_cast<igtl::RTSCommandMessage*>(message.GetPointer());
+
+    vtkSmartPointer<vtkXMLDataElement> cmdElement = vtkSmartPointer<vtkXMLDataElement>::Take(vtkXMLUtilities::ReadElementFromString(rtsCommandMsg->GetCommandContent().c_str()));
+
+    reply.CommandName = rtsCommandMsg->GetCommandName();
+    reply.OriginalCommandId = rtsCommandMsg->GetCommandId();
+
+    XML_FIND_NESTED_ELEMENT_OPTIONAL(resultElement, cmdElement, "Result");
+    if (resultElement != NULL)
+    {
+      reply.Result = STRCASECMP(resultElement->GetCharacterData(), "true") == 0 ? PLUS_SUCCESS : PLUS_FAIL;
+    }
+    XML_FIND_NESTED_ELEMENT_OPTIONAL(errorElement, cmdElement, "Error");
+    if (!reply.Result && errorElement == NULL)
+    {
+      LOG_ERROR("Server sent error without reason. Notify server developers.");
+    }
+    else if (!reply.Result && errorElement != NULL)
+    {
+      reply.ErrorString = errorElement->GetCharacterData();
+    }
+    XML_FIND_NESTED_ELEMENT_REQUIRED(messageElement, cmdElement, "Message");
+    reply.Content = messageElement->GetCharacterData();
+
+    reply.Parameters = rtsCommandMsg->GetMetaData();
+  }
+  else if (typeid(*message) == typeid(igtl::RTSTrackingDataMessage))
+  {
+    igtl::RTSTrackingDataMessage* rtsTrackingMsg = dynamic_cast<igtl::RTSTrackingDataMessage*>(message.GetPointer());
+
+    reply.Result = rtsTrackingMsg->GetStatus() == 0 ? PLUS_SUCCESS : PLUS_FAIL;
+    reply.Content = (rtsTrackingMsg->GetStatus() == 0 ? "SUCCESS" : "FAILURE");
+    reply.CommandName = "RTSTrackingDataMessage";
+    reply.OriginalCommandId = -1;
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusOpenIGTLinkClient::DispatchReply(igtl::MessageBase::Pointer message)
+{
+  ReplyCallback callback;
+  CommandReply reply;
+  {
+    igsioLockGuard<vtkIGSIORecursiveCriticalSection> updateMutexGuardedLock(this->Mutex);
+    if (!this->PendingCommands.empty() && ParseReply(message, reply) == PLUS_SUCCESS && reply.OriginalCommandId >= 0)
+    {
+      std::map<igtlUint32, ReplyCallback>::iterator pendingCommandIt = this->PendingCommands.find(static_cast<igtlUint32>(reply.OriginalCommandId));
+      if (pendingCommandIt != this->PendingCommands.end())
+      {
+        callback = pendingCommandIt->second;
+        this->PendingCommands.erase(pendingCommandIt);
+      }
+    }
+    if (!callback)
+    {
+      // not a reply to an asynchronous command, keep it for ReceiveReply
+      this->Replies.push_back(message);
+      return;
+    }
+  }
+  // The callback is called without holding the mutex, so that it may send further commands
+  callback(reply);
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusOpenIGTLinkClient::FailPendingCommands(const std::string& errorString)
+{
+  std::map<igtlUint32, ReplyCallback> pendingCommands;
+  {
+    igsioLockGuard<vtkIGSIORecursiveCriticalSection> updateMutexGuardedLock(this->Mutex);
+    pendingCommands.swap(this->PendingCommands);
+  }
+  for (std::map<igtlUint32, ReplyCallback>::iterator pendingCommandIt = pendingCommands.begin(); pendingCommandIt != pendingCommands.end(); ++pendingCommandIt)
+  {
+    CommandReply reply;
+    reply.OriginalCommandId = static_cast<int32_t>(pendingCommandIt->first);
+    reply.ErrorString = errorString;
+    pendingCommandIt->second(reply);
+  }
+}
+
 //----------------------------------------------------------------------------
 void vtkPlusOpenIGTLinkClient::PrintSelf(ostream& os, vtkIndent indent)
 {
@@ -371,11 +540,7 @@ void* vtkPlusOpenIGTLinkClient::DataReceiverThread(vtkMultiThreader::ThreadInfo*
         LOG_ERROR("Failed to receive reply (invalid body)");
         continue;
       }
-      {
-        // save command reply
-        igsioLockGuard<vtkIGSIORecursiveCriticalSection> updateMutexGuardedLock(self->Mutex);
-        self->Replies.push_back(bodyMsg);
-      }
+      self->DispatchReply(bodyMsg);
     }
     else if (typeid(*bodyMsg) == typeid(igtl::RTSTrackingDataMessage))
     {
@@ -392,11 +557,7 @@ void* vtkPlusOpenIGTLinkClient::DataReceiverThread(vtkMultiThreader::ThreadInfo*
         LOG_ERROR("Failed to receive reply (invalid body)");
         continue;
       }
-      {
-        // save command reply
-        igsioLockGuard<vtkIGSIORecursiveCriticalSection> updateMutexGuardedLock(self->Mutex);
-        self->Replies.push_back(bodyMsg);
-      }
+      self->DispatchReply(bodyMsg);
     }
     else
     {
@@ -24,6 +24,9 @@
 
 // STL includes
 #include <deque>
+#include <functional>
+#include <future>
+#include <map>
 #include <string>
 
 class vtkMultiThreader;
@@ -35,6 +38,13 @@ class vtkIGSIORecursiveCriticalSection;
 
   It connects to a Plus server, sends requests and receives responses.
 
+  Commands can be pipelined: SendCommandAsync sends a command without waiting for the reply, so many commands
+  can be in flight at the same time. The data receiver thread matches the replies to the pending commands by
+  the command UID and completes the returned future (or calls the callback). Replies that do not belong to a
+  pending asynchronous command are available through ReceiveReply, the same way as before.
+  Matching requires replies that contain the command UID, which is the case for OpenIGTLink v1 (ACK_ device name)
+  and v3 (RTS_COMMAND) servers.
+
   \ingroup PlusLibPlusServer
 */
 class vtkPlusServerExport vtkPlusOpenIGTLinkClient : public vtkObject
@@ -53,6 +63,22 @@ public:
   vtkSetMacro(ServerIGTLVersion, int);
   vtkGetMacroConst(ServerIGTLVersion, int);
 
+  /*! Reply of a command sent by SendCommandAsync */
+  struct CommandReply
+  {
+    CommandReply() : Result(PLUS_FAIL), OriginalCommandId(-1) {}
+    /*! Result of the command execution reported by the server */
+    PlusStatus Result;
+    int32_t OriginalCommandId;
+    std::string ErrorString;
+    std::string Content;
+    igtl::MessageBase::MetaDataMap Parameters;
+    std::string CommandName;
+  };
+
+  /*! Called with the reply of an asynchronous command. Executed from the data receiver thread. */
+  typedef std::function<void(const CommandReply&)> ReplyCallback;
+
   /*! If timeoutSec<0 then connection will be attempted multiple times until successfully connected or the timeout elapse */
   PlusStatus Connect(double timeoutSec = -1);
 
@@ -62,6 +88,30 @@ public:
   /*! Send a command to the connected server */
   PlusStatus SendCommand(vtkPlusCommand* command);
 
+  /*!
+    Send a command to the connected server without waiting for the reply.
+    If the command has no ID then a unique command UID is generated.
+    The future is ready when the reply is received. If the command cannot be sent or the client is disconnected
+    before the reply arrives then the reply Result is PLUS_FAIL and ErrorString contains the reason.
+  */
+  std::future<CommandReply> SendCommandAsync(vtkPlusCommand* command);
+
+  /*!
+    Send a command to the connected server without waiting for the reply, the callback is called with the reply.
+    Returns PLUS_FAIL (and the callback is not called) if the command cannot be sent.
+  */
+  PlusStatus SendCommandAsync(vtkPlusCommand* command, ReplyCallback callback);
+
+  /*!
+    Send a command that is defined by its XML configuration (Command element with Name attribute, as written by
+    vtkPlusCommand::WriteConfiguration), for example a command read from a file. The optional Id attribute specifies
+    the command UID.
+  */
+  std::future<CommandReply> SendCommandAsync(vtkXMLDataElement* commandConfig);
+
+  /*! Number of asynchronous commands that are sent but their reply is not received yet */
+  int GetNumberOfPendingCommands();
+
   /*! Send a packed message to the connected server */
   PlusStatus SendMessage(igtl::MessageBase::Pointer packedMessage);
 
@@ -100,6 +150,21 @@ protected:
   /*! Thread for receiving control data from clients */
   static void* DataReceiverThread(vtkMultiThreader::ThreadInfo* data);
 
+  /*! Build the command message (STRING or COMMAND, depending on the server version) and send it */
+  PlusStatus SendCommandMessage(const std::string& commandName, vtkXMLDataElement* commandConfig, igtlUint32 commandUid);
+
+  /*! Register the callback for the reply of the command then send the command. If commandUid is 0 then a UID is generated. */
+  PlusStatus SendPipelinedCommand(const std::string& commandName, vtkXMLDataElement* commandConfig, igtlUint32 commandUid, ReplyCallback callback);
+
+  /*! Extract the result, command UID and content from a received reply message */
+  static PlusStatus ParseReply(igtl::MessageBase::Pointer message, CommandReply& reply);
+
+  /*! Pass a received reply to the callback of the pending command with the same UID, or queue it for ReceiveReply */
+  void DispatchReply(igtl::MessageBase::Pointer message);
+
+  /*! Complete all pending asynchronous commands with a failed reply */
+  void FailPendingCommands(const std::string& errorString);
+
 protected:
   /*! igtl Factory for message sending */
   vtkSmartPointer<vtkPlusIgtlMessageFactory>        IgtlMessageFactory;
@@ -121,6 +186,9 @@ protected:
 
   std::deque<igtl::MessageBase::Pointer>            Replies;
 
+  /*! Reply callbacks of the asynchronous commands that are waiting for their reply, by command UID. Protected by Mutex. */
+  std::map<igtlUint32, ReplyCallback>               PendingCommands;
+
   int                                               ServerPort;
   std::string                                       ServerHost;
 
@@ -7,12 +7,15 @@ See License.txt for details.
 // Local includes
 #include "PlusConfigure.h"
 #include "PlusCommon.h"
+#include "PlusPacingTimer.h"
+#include "PlusProfiler.h"
 #include "PlusConfigure.h"
 #include "igsioTrackedFrame.h"
 #include "vtkPlusChannel.h"
 #include "vtkPlusCommand.h"
 #include "vtkPlusCommandProcessor.h"
 #include "vtkPlusDataCollector.h"
+#include "vtkPlusDataSource.h"
 #include "vtkPlusIgtlMessageCommon.h"
 #include "vtkPlusIgtlMessageFactory.h"
 #include "vtkPlusOpenIGTLinkServer.h"
@@ -33,6 +36,7 @@ See License.txt for details.
 #include <igtlImageMetaMessage.h>
 #include <igtlMessageHeader.h>
 #include <igtlPlusClientInfoMessage.h>
+#include <igtlPlusSharedMemoryFrameMessage.h>
 #include <igtlPointMessage.h>
 #include <igtlPolyDataMessage.h>
 #include <igtlStatusMessage.h>
@@ -51,7 +55,10 @@ See License.txt for details.
 #endif
 
 // STL includes
+#include <algorithm>
 #include <fstream>
+#include <map>
+#include <set>
 #include <streambuf>
 
 namespace
@@ -63,11 +70,41 @@ namespace
   const double SERVER_START_CHECK_DELAY_SEC = 2.0;
   const double SERVER_START_CHECK_DELAY_INTERVAL_SEC = 0.05;
 
+  // Client ID used for packing the multicast messages, valid client IDs start at 1
+  const int MULTICAST_CLIENT_ID = 0;
+
   //----------------------------------------------------------------------------
   // If a frame cannot be retrieved from the device buffers (because it was overwritten by new frames)
   // then we skip a SAMPLING_SKIPPING_MARGIN_SEC long period to allow the application to catch up.
   // This time should be long enough to comfortably retrieve a frame from the buffer.
   const double SAMPLING_SKIPPING_MARGIN_SEC = 0.1;
+
+  //----------------------------------------------------------------------------
+  // Maximum time the client receiver event loop waits for incoming data, also the maximum delay of handling newly connected clients
+  const double CLIENT_RECEIVER_EVENT_LOOP_TIMEOUT_SEC = 0.1;
+
+  //----------------------------------------------------------------------------
+  // Maximum number of queued messages that are sent to a client with one system call if batched sending is enabled
+  const size_t MAX_NUMBER_OF_MESSAGES_PER_BATCH = 64;
+
+  //----------------------------------------------------------------------------
+  // Time between checks for new tracker samples of the tracking data sender thread, much shorter than the period of the fastest trackers
+  const double TRACKING_DATA_POLLING_INTERVAL_SEC = 0.001;
+
+  //----------------------------------------------------------------------------
+  // Delay between attempts to connect to the primary server in relay mode
+  const double RELAY_RECONNECT_DELAY_SEC = 1.0;
+
+  //----------------------------------------------------------------------------
+  /*! Provides access to the descriptor of OpenIGTLink sockets, to be able to wait on multiple sockets at once */
+  class SocketDescriptorAccess : public igtl::Socket
+  {
+  public:
+    static int GetSocketDescriptor(igtl::Socket* socket)
+    {
+      return socket->*(&SocketDescriptorAccess::m_SocketDescriptor);
+    }
+  };
 }
 
 //----------------------------------------------------------------------------
@@ -79,7 +116,6 @@ const float vtkPlusOpenIGTLinkServer::CLIENT_SOCKET_TIMEOUT_SEC = 0.5f;
 //----------------------------------------------------------------------------
 vtkPlusOpenIGTLinkServer::vtkPlusOpenIGTLinkServer()
   : ServerSocket(igtl::ServerSocket::New())
-  , TransformRepository(NULL)
   , DataCollector(NULL)
   , Threader(vtkSmartPointer<vtkMultiThreader>::New())
   , IGTLProtocolVersion(OpenIGTLink_PROTOCOL_VERSION)
@@ -90,6 +126,9 @@ vtkPlusOpenIGTLinkServer::vtkPlusOpenIGTLinkServer()
   , MaxNumberOfIgtlMessagesToSend(100)
   , ConnectionReceiverThreadId(-1)
   , DataSenderThreadId(-1)
+  , ClientReceiverEventLoopThreadId(-1)
+  , TrackingDataSenderThreadId(-1)
+  , RelayReceiverThreadId(-1)
   , IgtlMessageFactory(vtkSmartPointer<vtkPlusIgtlMessageFactory>::New())
   , IgtlClientsMutex(vtkSmartPointer<vtkIGSIORecursiveCriticalSection>::New())
   , LastSentTrackedFrameTimestamp(0)
@@ -98,6 +137,21 @@ vtkPlusOpenIGTLinkServer::vtkPlusOpenIGTLinkServer()
   , SendValidTransformsOnly(true)
   , DefaultClientSendTimeoutSec(CLIENT_SOCKET_TIMEOUT_SEC)
   , DefaultClientReceiveTimeoutSec(CLIENT_SOCKET_TIMEOUT_SEC)
+  , DefaultClientTcpNoDelay(false)
+  , DefaultClientSendBufferSizeBytes(0)
+  , DefaultClientBatchedSendEnabled(false)
+  , MaxNumberOfQueuedMessagesPerClient(100)
+  , DataDropPolicy(PlusIgtlClientSendQueue::DROP_OLDEST)
+  , ClientReceiveEventLoopEnabled(false)
+  , SharedMemoryTransportEnabled(true)
+  , SharedMemoryRingSize(8)
+  , SharedMemoryRingCounter(0)
+  , HighRateTrackingEnabled(false)
+  , CommandWorkerThreads(0)
+  , DataSenderThreadPriority(PlusThreadScheduling::PRIORITY_NORMAL)
+  , MulticastPort(18945)
+  , MulticastTimeToLive(1)
+  , RelayServerPort(18944)
   , IgtlMessageCrcCheckEnabled(0)
   , PlusCommandProcessor(vtkSmartPointer<vtkPlusCommandProcessor>::New())
   , MessageResponseQueueMutex(vtkSmartPointer<vtkIGSIORecursiveCriticalSection>::New())
@@ -107,9 +161,11 @@ vtkPlusOpenIGTLinkServer::vtkPlusOpenIGTLinkServer()
   , GracePeriodLogLevel(vtkPlusLogger::LOG_LEVEL_DEBUG)
   , MissingInputGracePeriodSec(0.0)
   , BroadcastStartTime(0.0)
-  , NewClientConnected(false)
 {
-
+  // Messages that are requested by multiple clients are packed only once for each frame
+  this->IgtlMessageFactory->MessageCacheEnabledOn();
+  // Image buffers are reused for the next frames instead of reallocated for each frame
+  this->IgtlMessageFactory->MessagePoolEnabledOn();
 }
 
 //----------------------------------------------------------------------------
@@ -176,6 +232,18 @@ PlusStatus vtkPlusOpenIGTLinkServer::StartOpenIGTLinkService()
     this->DataSenderThreadId = this->Threader->SpawnThread((vtkThreadFunctionType)&DataSenderThread, this);
   }
 
+  if (this->ClientReceiveEventLoopEnabled && this->ClientReceiverEventLoopThreadId < 0)
+  {
+    this->ClientReceiverEventLoopActive.Request = true;
+    this->ClientReceiverEventLoopThreadId = this->Threader->SpawnThread((vtkThreadFunctionType)&ClientReceiverEventLoopThread, this);
+  }
+
+  if (!this->RelayServerHost.empty() && this->RelayReceiverThreadId < 0)
+  {
+    this->RelayReceiverActive.Request = true;
+    this->RelayReceiverThreadId = this->Threader->SpawnThread((vtkThreadFunctionType)&RelayReceiverThread, this);
+  }
+
   // Wait a short duration to see if both threads initialized properly, check at 50ms interval
   RETRY_UNTIL_TRUE(this->ConnectionActive.Respond,
                    vtkMath::Round(SERVER_START_CHECK_DELAY_SEC / SERVER_START_CHECK_DELAY_INTERVAL_SEC),
@@ -192,6 +260,11 @@ PlusStatus vtkPlusOpenIGTLinkServer::StartOpenIGTLinkService()
   LOG_DEBUG(ss.str());
 
   this->PlusCommandProcessor->SetPlusServer(this);
+  if (this->CommandWorkerThreads > 0)
+  {
+    this->PlusCommandProcessor->SetNumberOfWorkerThreads(this->CommandWorkerThreads);
+    this->PlusCommandProcessor->Start();
+  }
 
   this->BroadcastStartTime = vtkIGSIOAccurateTimer::GetSystemTime();
 
@@ -201,6 +274,9 @@ PlusStatus vtkPlusOpenIGTLinkServer::StartOpenIGTLinkService()
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusOpenIGTLinkServer::StopOpenIGTLinkService()
 {
+  // Wait for the commands that are being executed, they may use the data collector
+  this->PlusCommandProcessor->Stop();
+
   // Stop connection receiver thread
   if (this->ConnectionReceiverThreadId >= 0)
   {
@@ -214,6 +290,19 @@ PlusStatus vtkPlusOpenIGTLinkServer::StopOpenIGTLinkService()
     LOG_DEBUG("ConnectionReceiverThread stopped");
   }
 
+  // Stop relaying messages of the primary server
+  if (this->RelayReceiverThreadId >= 0)
+  {
+    this->RelayReceiverActive.Request = false;
+    while (this->RelayReceiverActive.Respond)
+    {
+      // Wait until the thread stops
+      vtkIGSIOAccurateTimer::DelayWithEventProcessing(0.2);
+    }
+    this->RelayReceiverThreadId = -1;
+    LOG_DEBUG("RelayReceiverThread stopped");
+  }
+
   // Disconnect clients (stop receiving thread, close socket)
   std::vector< int > clientIds;
   {
@@ -229,6 +318,32 @@ PlusStatus vtkPlusOpenIGTLinkServer::StopOpenIGTLinkService()
     DisconnectClient(*it);
   }
 
+  // Stop client receiver event loop thread
+  if (this->ClientReceiverEventLoopThreadId >= 0)
+  {
+    this->ClientReceiverEventLoopActive.Request = false;
+    while (this->ClientReceiverEventLoopActive.Respond)
+    {
+      // Wait until the thread stops
+      vtkIGSIOAccurateTimer::DelayWithEventProcessing(0.2);
+    }
+    this->ClientReceiverEventLoopThreadId = -1;
+    LOG_DEBUG("ClientReceiverEventLoopThread stopped");
+  }
+
+  // Stop tracking data sender thread, it uses the data collector
+  if (this->TrackingDataSenderThreadId >= 0)
+  {
+    this->TrackingDataSenderActive.Request = false;
+    while (this->TrackingDataSenderActive.Respond)
+    {
+      // Wait until the thread stops
+      vtkIGSIOAccurateTimer::DelayWithEventProcessing(0.2);
+    }
+    this->TrackingDataSenderThreadId = -1;
+    LOG_DEBUG("TrackingDataSenderThread stopped");
+  }
+
   LOG_INFO("Plus OpenIGTLink server stopped.");
 
   return PLUS_SUCCESS;
@@ -260,7 +375,6 @@ void* vtkPlusOpenIGTLinkServer::ConnectionReceiverThread(vtkMultiThreader::Threa
       igsioLockGuard<vtkIGSIORecursiveCriticalSection> igtlClientsMutexGuardedLock(self->IgtlClientsMutex);
       ClientData newClient;
       self->IgtlClients.push_back(newClient);
-      self->NewClientConnected = true;
 
       ClientData* client = &(self->IgtlClients.back());   // get a reference to the client data that is stored in the list
       client->ClientId = self->ClientIdCounter;
@@ -268,10 +382,14 @@ void* vtkPlusOpenIGTLinkServer::ConnectionReceiverThread(vtkMultiThreader::Threa
       client->ClientSocket = newClientSocket;
       client->ClientSocket->SetReceiveTimeout(self->DefaultClientReceiveTimeoutSec * 1000);
       client->ClientSocket->SetSendTimeout(self->DefaultClientSendTimeoutSec * 1000);
+      if (self->DefaultClientTcpNoDelay || self->DefaultClientSendBufferSizeBytes > 0)
+      {
+        SetClientSocketOptions(SocketDescriptorAccess::GetSocketDescriptor(client->ClientSocket), self->DefaultClientTcpNoDelay, self->DefaultClientSendBufferSizeBytes);
+      }
       client->ClientInfo = self->DefaultClientInfo;
       client->Server = self;
 
-      // Setup vtkIGSIOFrameConverters for each stream
+      // Setup vtkIGSIOFrameConverters for each image stream (video stream encoders are shared between clients by the message factory)
       for (std::vector<PlusIgtlClientInfo::ImageStream>::iterator imageStreamIterator = client->ClientInfo.ImageStreams.begin();
         imageStreamIterator != client->ClientInfo.ImageStreams.end(); ++imageStreamIterator)
       {
@@ -281,25 +399,31 @@ void* vtkPlusOpenIGTLinkServer::ConnectionReceiverThread(vtkMultiThreader::Threa
           imageStream->FrameConverter = vtkSmartPointer<vtkIGSIOFrameConverter>::New();
         }
       }
-      for (std::vector<PlusIgtlClientInfo::VideoStream>::iterator videoStreamIterator = client->ClientInfo.VideoStreams.begin();
-           videoStreamIterator != client->ClientInfo.VideoStreams.end(); ++videoStreamIterator)
-      {
-        PlusIgtlClientInfo::VideoStream* videoStream = &(*videoStreamIterator);
-        if (!videoStream->FrameConverter)
-        {
-          videoStream->FrameConverter = vtkSmartPointer<vtkIGSIOFrameConverter>::New();
-        }
-      }
 
       int port = 0;
       std::string address = "unknown";
 #if (OPENIGTLINK_VERSION_MAJOR > 1) || ( OPENIGTLINK_VERSION_MAJOR == 1 && OPENIGTLINK_VERSION_MINOR > 9 ) || ( OPENIGTLINK_VERSION_MAJOR == 1 && OPENIGTLINK_VERSION_MINOR == 9 && OPENIGTLINK_VERSION_PATCH > 4 )
       newClientSocket->GetSocketAddressAndPort(address, port);
 #endif
+      client->LocalClient = (address == "127.0.0.1" || address == "::1");
       LOG_INFO("Received new client connection (client " << client->ClientId << " at " << address << ":" << port << "). Number of connected clients: " << self->GetNumberOfConnectedClients());
 
+      // The send queue is created before the threads are started, as both threads use it
+      client->SendQueue = std::make_shared<PlusIgtlClientSendQueue>(self->MaxNumberOfQueuedMessagesPerClient);
+      client->SendLatency = std::make_shared<PlusLatencyHistogram>();
+      client->DataSenderActive.first = true;
+      client->DataSenderThreadId = self->Threader->SpawnThread((vtkThreadFunctionType)&ClientDataSenderThread, client);
+
       client->DataReceiverActive.first = true;
-      client->DataReceiverThreadId = self->Threader->SpawnThread((vtkThreadFunctionType)&DataReceiverThread, client);
+      if (self->ClientReceiverEventLoopThreadId >= 0)
+      {
+        // Messages are received by the client receiver event loop thread, it clears the respond flag when the client is disconnected
+        client->DataReceiverActive.second = true;
+      }
+      else
+      {
+        client->DataReceiverThreadId = self->Threader->SpawnThread((vtkThreadFunctionType)&DataReceiverThread, client);
+      }
     }
   }
 
@@ -320,12 +444,20 @@ void* vtkPlusOpenIGTLinkServer::DataSenderThread(vtkMultiThreader::ThreadInfo* d
 {
   vtkPlusOpenIGTLinkServer* self = (vtkPlusOpenIGTLinkServer*)(data->UserData);
   self->DataSenderActive.Respond = true;
+  PLUS_PROFILE_THREAD_NAME("Plus server data sender");
+  PlusThreadScheduling::SetCurrentThreadPriority(self->DataSenderThreadPriority);
+  PlusThreadScheduling::SetCurrentThreadAffinity(self->DataSenderCpuAffinity);
 
   vtkPlusDevice* aDevice(NULL);
   vtkPlusChannel* aChannel(NULL);
 
   DeviceCollection aCollection;
-  if (self->DataCollector->GetDevices(aCollection) != PLUS_SUCCESS || aCollection.size() == 0)
+  if (!self->RelayServerHost.empty())
+  {
+    // In relay mode the data is received from the primary server, this thread only sends command responses and keep alive messages
+    LOG_INFO("Relaying data of PlusServer at " << self->RelayServerHost << ":" << self->RelayServerPort);
+  }
+  else if (self->DataCollector->GetDevices(aCollection) != PLUS_SUCCESS || aCollection.size() == 0)
   {
     LOG_ERROR("Unable to retrieve devices. Check configuration and connection.");
     return NULL;
@@ -364,7 +496,7 @@ void* vtkPlusOpenIGTLinkServer::DataSenderThread(vtkMultiThreader::ThreadInfo* d
   }
 
   // If we didn't find any channel then return
-  if (aChannel == NULL)
+  if (aChannel == NULL && self->RelayServerHost.empty())
   {
     LOG_WARNING("There are no channels to broadcast. Only command processing is available.");
   }
@@ -375,6 +507,28 @@ void* vtkPlusOpenIGTLinkServer::DataSenderThread(vtkMultiThreader::ThreadInfo* d
     self->BroadcastChannel->GetMostRecentTimestamp(self->LastSentTrackedFrameTimestamp);
   }
 
+  if (self->HighRateTrackingEnabled && self->BroadcastChannel != NULL && self->TrackingDataSenderThreadId < 0)
+  {
+    if (self->BroadcastChannel->HasVideoSource() && self->BroadcastChannel->ToolCount() > 0)
+    {
+      self->TrackingDataSenderActive.Request = true;
+      self->TrackingDataSenderThreadId = self->Threader->SpawnThread((vtkThreadFunctionType)&TrackingDataSenderThread, self);
+    }
+    else
+    {
+      // Without video the tracked frames are already sampled at the tracker rate
+      LOG_INFO("HighRateTrackingEnabled is ignored, the broadcast channel " << self->BroadcastChannel->GetChannelId() << " does not have both video and tool data");
+    }
+  }
+
+  if (!self->MulticastAddress.empty())
+  {
+    if (self->MulticastSender.Open(self->MulticastAddress, self->MulticastPort, self->MulticastTimeToLive) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Unable to start multicast output of tracking data to " << self->MulticastAddress << ":" << self->MulticastPort);
+    }
+  }
+
   double elapsedTimeSinceLastPacketSentSec = 0;
   while (self->ConnectionActive.Request && self->DataSenderActive.Request)
   {
@@ -401,18 +555,213 @@ void* vtkPlusOpenIGTLinkServer::DataSenderThread(vtkMultiThreader::ThreadInfo* d
 
     SendMessageResponses(*self);
 
+    // Execute the subscribed commands again if their reply changed, the replies are pushed to the subscribers
+    self->PlusCommandProcessor->QueueChangedSubscribedCommands();
+
     // Send remote command execution replies to clients before sending any images/transforms/etc...
     SendCommandResponses(*self);
 
     // Send image/tracking/string data
     SendLatestFramesToClients(*self, elapsedTimeSinceLastPacketSentSec);
   }
+
+  // Remove the shared memory rings, local clients that mapped them keep access until they close them
+  self->SharedMemoryRings.clear();
+  self->MulticastSender.Close();
+
   // Close thread
   self->DataSenderThreadId = -1;
   self->DataSenderActive.Respond = false;
   return NULL;
 }
 
+//----------------------------------------------------------------------------
+void* vtkPlusOpenIGTLinkServer::RelayReceiverThread(vtkMultiThreader::ThreadInfo* data)
+{
+  vtkPlusOpenIGTLinkServer* self = (vtkPlusOpenIGTLinkServer*)(data->UserData);
+  self->RelayReceiverActive.Respond = true;
+
+  igtl::ClientSocket::Pointer primarySocket;
+  while (self->RelayReceiverActive.Request)
+  {
+    if (primarySocket.IsNull() || !primarySocket->GetConnected())
+    {
+      // (Re)connect to the primary server and request the data that this server sends by default
+      primarySocket = igtl::ClientSocket::New();
+      if (primarySocket->ConnectToServer(self->RelayServerHost.c_str(), self->RelayServerPort) != 0)
+      {
+        LOG_DYNAMIC("Unable to connect to the primary PlusServer at " << self->RelayServerHost << ":" << self->RelayServerPort, self->GracePeriodLogLevel);
+        primarySocket = NULL;
+        vtkIGSIOAccurateTimer::Delay(RELAY_RECONNECT_DELAY_SEC);
+        continue;
+      }
+      primarySocket->SetTimeout(CLIENT_SOCKET_TIMEOUT_SEC * 1000);
+      igtl::PlusClientInfoMessage::Pointer clientInfoMsg = igtl::PlusClientInfoMessage::New();
+      clientInfoMsg->SetClientInfo(self->DefaultClientInfo);
+      clientInfoMsg->Pack();
+      if (!primarySocket->Send(clientInfoMsg->GetBufferPointer(), clientInfoMsg->GetBufferSize()))
+      {
+        LOG_ERROR("Failed to send client info to the primary PlusServer at " << self->RelayServerHost << ":" << self->RelayServerPort);
+        primarySocket->CloseSocket();
+        primarySocket = NULL;
+        vtkIGSIOAccurateTimer::Delay(RELAY_RECONNECT_DELAY_SEC);
+        continue;
+      }
+      LOG_INFO("Connected to the primary PlusServer at " << self->RelayServerHost << ":" << self->RelayServerPort);
+    }
+
+    igtl::MessageHeader::Pointer headerMsg = self->IgtlMessageFactory->CreateHeaderMessage(IGTL_HEADER_VERSION_1);
+    int numOfBytesReceived = primarySocket->Receive(headerMsg->GetBufferPointer(), headerMsg->GetBufferSize());
+    if (numOfBytesReceived == 0 || numOfBytesReceived != headerMsg->GetBufferSize())
+    {
+      // Receive timeout or the primary server is disconnected, which is detected at the next iteration
+      continue;
+    }
+    int c = headerMsg->Unpack(self->IgtlMessageCrcCheckEnabled);
+    if (!(c & igtl::MessageHeader::UNPACK_HEADER))
+    {
+      LOG_ERROR("Failed to receive message from the primary PlusServer (invalid header), reconnecting");
+      primarySocket->CloseSocket();
+      continue;
+    }
+
+    if (STRCASECMP(headerMsg->GetMessageType(), "STATUS") == 0)
+    {
+      // Keep alive messages of the primary server are not forwarded, this server sends its own
+      primarySocket->Skip(headerMsg->GetBodySizeToRead(), 0);
+      continue;
+    }
+
+    // The packed message is kept as received (header and body), it is not unpacked
+    igtl::MessageBase::Pointer relayedMsg = igtl::MessageBase::New();
+    relayedMsg->SetMessageHeader(headerMsg);
+    relayedMsg->AllocateBuffer();
+    if (relayedMsg->GetBufferBodySize() > 0
+        && primarySocket->Receive(relayedMsg->GetBufferBodyPointer(), relayedMsg->GetBufferBodySize()) != static_cast<int>(relayedMsg->GetBufferBodySize()))
+    {
+      LOG_ERROR("Failed to receive " << headerMsg->GetMessageType() << " message body from the primary PlusServer, reconnecting");
+      primarySocket->CloseSocket();
+      continue;
+    }
+    self->RelayMessage(relayedMsg);
+  }
+
+  if (primarySocket.IsNotNull())
+  {
+    primarySocket->CloseSocket();
+  }
+
+  // Close thread
+  self->RelayReceiverThreadId = -1;
+  self->RelayReceiverActive.Respond = false;
+  return NULL;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusOpenIGTLinkServer::RelayMessage(igtl::MessageBase::Pointer message)
+{
+  const std::string messageType = message->GetMessageType();
+  igsioLockGuard<vtkIGSIORecursiveCriticalSection> igtlClientsMutexGuardedLock(this->IgtlClientsMutex);
+  for (std::list<ClientData>::iterator clientIterator = this->IgtlClients.begin(); clientIterator != this->IgtlClients.end(); ++clientIterator)
+  {
+    if (clientIterator->SendFailed)
+    {
+      // The client is removed at the next keep alive
+      continue;
+    }
+    // The upstream subscription is shared by all clients, they can only select from it by message type
+    const std::vector<std::string>& messageTypes = clientIterator->ClientInfo.IgtlMessageTypes;
+    if (!messageTypes.empty() && std::find(messageTypes.begin(), messageTypes.end(), messageType) == messageTypes.end())
+    {
+      continue;
+    }
+    // The same message object is queued for all clients, it is only read by the client data sender threads
+    if (!clientIterator->SendQueue->Push(message, this->DataDropPolicy))
+    {
+      LOG_TRACE("Send queue of client " << clientIterator->ClientId << " is full, relayed message dropped");
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+void* vtkPlusOpenIGTLinkServer::TrackingDataSenderThread(vtkMultiThreader::ThreadInfo* data)
+{
+  vtkPlusOpenIGTLinkServer* self = (vtkPlusOpenIGTLinkServer*)(data->UserData);
+  self->TrackingDataSenderActive.Respond = true;
+  PlusThreadScheduling::SetCurrentThreadPriority(self->DataSenderThreadPriority);
+  PlusThreadScheduling::SetCurrentThreadAffinity(self->DataSenderCpuAffinity);
+
+  vtkPlusChannel* channel = self->BroadcastChannel;
+  vtkPlusDataSource* masterTool(NULL);
+  if (channel->GetTimestampMasterTool(masterTool) != PLUS_SUCCESS || masterTool == NULL)
+  {
+    LOG_ERROR("Unable to send tracking data at the tracker rate: no timestamp master tool in channel " << channel->GetChannelId());
+    self->TrackingDataSenderThreadId = -1;
+    self->TrackingDataSenderActive.Respond = false;
+    return NULL;
+  }
+
+  // The tracking messages are packed from a private copy of the transform repository, which is refreshed when a new snapshot
+  // is published (e.g., a transform is updated by a command), so the shared snapshots are not modified by the tracking frames
+  vtkSmartPointer<vtkIGSIOTransformRepository> transformRepository;
+  unsigned long transformRepositoryVersion = 0;
+
+  LOG_INFO("Sending tracking data at the rate of tool " << masterTool->GetId());
+
+  // Start with the samples that are acquired from now on
+  BufferItemUidType lastSentItemUid = masterTool->GetLatestItemUidInBuffer();
+  while (self->ConnectionActive.Request && self->TrackingDataSenderActive.Request)
+  {
+    BufferItemUidType latestItemUid = masterTool->GetLatestItemUidInBuffer();
+    bool clientsConnected = false;
+    {
+      igsioLockGuard<vtkIGSIORecursiveCriticalSection> igtlClientsMutexGuardedLock(self->IgtlClientsMutex);
+      clientsConnected = !self->IgtlClients.empty() || self->MulticastSender.IsOpen();
+    }
+    if (masterTool->GetNumberOfItems() == 0 || latestItemUid == lastSentItemUid || !clientsConnected)
+    {
+      lastSentItemUid = latestItemUid;
+      PlusPacingTimer::Delay(TRACKING_DATA_POLLING_INTERVAL_SEC);
+      continue;
+    }
+
+    // Samples that have been overwritten in the buffer meanwhile are skipped
+    for (BufferItemUidType itemUid = std::max(lastSentItemUid + 1, masterTool->GetOldestItemUidInBuffer()); itemUid <= latestItemUid; ++itemUid)
+    {
+      double timestamp(0);
+      if (masterTool->GetTimeStamp(itemUid, timestamp) != ITEM_OK)
+      {
+        continue;
+      }
+      igsioTrackedFrame trackedFrame;
+      trackedFrame.SetTimestamp(timestamp);
+      if (channel->GetToolTransformsAtTime(timestamp, trackedFrame) != PLUS_SUCCESS)
+      {
+        // Tools of other devices may not have data for the latest sample yet, their status is set to invalid
+        LOG_TRACE("Not all tool transforms are available at " << std::fixed << timestamp);
+      }
+      PlusTelemetry::Instance()->AddSampleSince(PlusTelemetry::STAGE_BUFFER_TO_SERVER, timestamp);
+      if (transformRepository == NULL || self->TransformRepository.GetVersion() != transformRepositoryVersion)
+      {
+        transformRepositoryVersion = self->TransformRepository.GetVersion();
+        vtkSmartPointer<vtkIGSIOTransformRepository> snapshot = self->TransformRepository.GetSnapshot();
+        if (snapshot != NULL)
+        {
+          transformRepository = vtkSmartPointer<vtkIGSIOTransformRepository>::New();
+          transformRepository->DeepCopy(snapshot);
+        }
+      }
+      self->SendTrackingFrame(trackedFrame, transformRepository);
+    }
+    lastSentItemUid = latestItemUid;
+  }
+
+  // Close thread
+  self->TrackingDataSenderThreadId = -1;
+  self->TrackingDataSenderActive.Respond = false;
+  return NULL;
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusOpenIGTLinkServer::SendLatestFramesToClients(vtkPlusOpenIGTLinkServer& self, double& elapsedTimeSinceLastPacketSentSec)
 {
@@ -451,7 +800,7 @@ PlusStatus vtkPlusOpenIGTLinkServer::SendLatestFramesToClients(vtkPlusOpenIGTLin
           self.LastSentTrackedFrameTimestamp = oldestDataTimestamp + SAMPLING_SKIPPING_MARGIN_SEC;
         }
         static vtkIGSIOLogHelper logHelper(60.0, 500000);
-        CUSTOM_RETURN_WITH_FAIL_IF(self.BroadcastChannel->GetTrackedFrameList(self.LastSentTrackedFrameTimestamp, trackedFrameList, numberOfFramesToGet) != PLUS_SUCCESS,
+        CUSTOM_RETURN_WITH_FAIL_IF(self.BroadcastChannel->GetTrackedFrameList(self.LastSentTrackedFrameTimestamp, trackedFrameList, numberOfFramesToGet, true) != PLUS_SUCCESS,
                                    "Failed to get tracked frame list from data collector (last recorded timestamp: " << std::fixed << self.LastSentTrackedFrameTimestamp);
       }
     }
@@ -460,7 +809,7 @@ PlusStatus vtkPlusOpenIGTLinkServer::SendLatestFramesToClients(vtkPlusOpenIGTLin
   // There is no new frame in the buffer
   if (trackedFrameList->GetNumberOfTrackedFrames() == 0)
   {
-    vtkIGSIOAccurateTimer::Delay(DELAY_ON_NO_NEW_FRAMES_SEC);
+    PlusPacingTimer::Delay(DELAY_ON_NO_NEW_FRAMES_SEC);
     elapsedTimeSinceLastPacketSentSec += vtkIGSIOAccurateTimer::GetSystemTime() - startTimeSec;
 
     // Send keep alive packet to clients
@@ -476,6 +825,8 @@ PlusStatus vtkPlusOpenIGTLinkServer::SendLatestFramesToClients(vtkPlusOpenIGTLin
 
   for (unsigned int i = 0; i < trackedFrameList->GetNumberOfTrackedFrames(); ++i)
   {
+    PlusTelemetry::Instance()->AddSampleSince(PlusTelemetry::STAGE_BUFFER_TO_SERVER, trackedFrameList->GetTrackedFrame(i)->GetTimestamp());
+
     // Send tracked frame
     self.SendTrackedFrame(*trackedFrameList->GetTrackedFrame(i));
     elapsedTimeSinceLastPacketSentSec = 0;
@@ -501,17 +852,17 @@ PlusStatus vtkPlusOpenIGTLinkServer::SendMessageResponses(vtkPlusOpenIGTLinkServ
     for (ClientIdToMessageListMap::iterator it = self.MessageResponseQueue.begin(); it != self.MessageResponseQueue.end(); ++it)
     {
       igsioLockGuard<vtkIGSIORecursiveCriticalSection> igtlClientsMutexGuardedLock(self.IgtlClientsMutex);
-      igtl::ClientSocket::Pointer clientSocket = NULL;
+      std::shared_ptr<PlusIgtlClientSendQueue> sendQueue;
 
       for (std::list<ClientData>::iterator clientIterator = self.IgtlClients.begin(); clientIterator != self.IgtlClients.end(); ++clientIterator)
       {
         if (clientIterator->ClientId == it->first)
         {
-          clientSocket = clientIterator->ClientSocket;
+          sendQueue = clientIterator->SendQueue;
           break;
         }
       }
-      if (clientSocket.IsNull())
+      if (!sendQueue)
       {
         LOG_WARNING("Message reply cannot be sent to client " << it->first << ", probably client has been disconnected.");
         continue;
@@ -519,7 +870,7 @@ PlusStatus vtkPlusOpenIGTLinkServer::SendMessageResponses(vtkPlusOpenIGTLinkServ
 
       for (std::vector<igtl::MessageBase::Pointer>::iterator messageIt = it->second.begin(); messageIt != it->second.end(); ++messageIt)
       {
-        clientSocket->Send((*messageIt)->GetBufferPointer(), (*messageIt)->GetBufferSize());
+        sendQueue->Push(*messageIt, PlusIgtlClientSendQueue::NEVER_DROP);
       }
     }
     self.MessageResponseQueue.clear();
@@ -537,33 +888,37 @@ PlusStatus vtkPlusOpenIGTLinkServer::SendCommandResponses(vtkPlusOpenIGTLinkServ
   {
     for (PlusCommandResponseList::iterator responseIt = replies.begin(); responseIt != replies.end(); responseIt++)
     {
-      igtl::MessageBase::Pointer igtlResponseMessage = self.CreateIgtlMessageFromCommandResponse(*responseIt);
+      bool isPacked = false;
+      igtl::MessageBase::Pointer igtlResponseMessage = self.CreateIgtlMessageFromCommandResponse(*responseIt, isPacked);
       if (igtlResponseMessage.IsNull())
       {
         LOG_ERROR("Failed to create OpenIGTLink message from command response");
         continue;
       }
-      igtlResponseMessage->Pack();
+      if (!isPacked)
+      {
+        igtlResponseMessage->Pack();
+      }
 
       // Only send the response to the client that requested the command
       LOG_DEBUG("Send command reply to client " << (*responseIt)->GetClientId() << ": " << igtlResponseMessage->GetDeviceName());
       igsioLockGuard<vtkIGSIORecursiveCriticalSection> igtlClientsMutexGuardedLock(self.IgtlClientsMutex);
-      igtl::ClientSocket::Pointer clientSocket = NULL;
+      std::shared_ptr<PlusIgtlClientSendQueue> sendQueue;
       for (std::list<ClientData>::iterator clientIterator = self.IgtlClients.begin(); clientIterator != self.IgtlClients.end(); ++clientIterator)
       {
         if (clientIterator->ClientId == (*responseIt)->GetClientId())
         {
-          clientSocket = clientIterator->ClientSocket;
+          sendQueue = clientIterator->SendQueue;
           break;
         }
       }
 
-      if (clientSocket.IsNull())
+      if (!sendQueue)
       {
         LOG_WARNING("Message reply cannot be sent to client " << (*responseIt)->GetClientId() << ", probably client has been disconnected");
         continue;
       }
-      clientSocket->Send(igtlResponseMessage->GetBufferPointer(), igtlResponseMessage->GetBufferSize());
+      sendQueue->Push(igtlResponseMessage, PlusIgtlClientSendQueue::NEVER_DROP);
     }
   }
 
@@ -577,430 +932,633 @@ void* vtkPlusOpenIGTLinkServer::DataReceiverThread(vtkMultiThreader::ThreadInfo*
   client->DataReceiverActive.second = true;
   vtkPlusOpenIGTLinkServer* self = client->Server;
 
-  /*! Store the IDs of recent commands to be able to detect duplicate command IDs */
-  std::deque<uint32_t> previousCommandIds;
-
-  // Make copy of frequently used data to avoid locking of client data
-  igtl::ClientSocket::Pointer clientSocket = client->ClientSocket;
-  int clientId = client->ClientId;
-
   igtl::MessageHeader::Pointer headerMsg = self->IgtlMessageFactory->CreateHeaderMessage(IGTL_HEADER_VERSION_1);
 
   while (client->DataReceiverActive.first)
   {
-    headerMsg->InitBuffer();
-
-    // Receive generic header from the socket
-    int bytesReceived = clientSocket->Receive(headerMsg->GetBufferPointer(), headerMsg->GetBufferSize());
-    if (bytesReceived == IGTL_EMPTY_DATA_SIZE || bytesReceived != headerMsg->GetBufferSize())
+    bool messageReceived = false;
+    if (ReceiveClientMessage(client, headerMsg, messageReceived) != PLUS_SUCCESS)
     {
-      vtkIGSIOAccurateTimer::Delay(0.1);
-      continue;
+      break;
     }
-
-    headerMsg->Unpack(self->IgtlMessageCrcCheckEnabled);
-
+    if (!messageReceived)
     {
-      igsioLockGuard<vtkIGSIORecursiveCriticalSection> igtlClientsMutexGuardedLock(self->IgtlClientsMutex);
-      // Keep track of the highest known version of message ever sent by this client, this is the version that we reply with
-      // (upper bounded by the servers version)
-      if (headerMsg->GetHeaderVersion() > client->ClientInfo.GetClientHeaderVersion())
-      {
-        client->ClientInfo.SetClientHeaderVersion(std::min<int>(self->GetIGTLHeaderVersion(), headerMsg->GetHeaderVersion()));
-      }
+      vtkIGSIOAccurateTimer::Delay(0.1);
     }
+  }
 
-    igtl::MessageBase::Pointer bodyMessage = self->IgtlMessageFactory->CreateReceiveMessage(headerMsg);
-    if (bodyMessage.IsNull())
-    {
-      LOG_ERROR("Unable to receive message from client: " << client->ClientId);
-      continue;
-    }
+  // Close thread
+  client->DataReceiverThreadId = -1;
+  client->DataReceiverActive.second = false;
+  return NULL;
+}
 
-    if (typeid(*bodyMessage) == typeid(igtl::PlusClientInfoMessage))
-    {
-      igtl::PlusClientInfoMessage::Pointer clientInfoMsg = dynamic_cast<igtl::PlusClientInfoMessage*>(bodyMessage.GetPointer());
-      clientInfoMsg->SetMessageHeader(headerMsg);
-      clientInfoMsg->AllocateBuffer();
+//----------------------------------------------------------------------------
+void* vtkPlusOpenIGTLinkServer::ClientReceiverEventLoopThread(vtkMultiThreader::ThreadInfo* data)
+{
+  vtkPlusOpenIGTLinkServer* self = (vtkPlusOpenIGTLinkServer*)(data->UserData);
+  self->ClientReceiverEventLoopActive.Respond = true;
 
-      clientSocket->Receive(clientInfoMsg->GetBufferBodyPointer(), clientInfoMsg->GetBufferBodySize());
+  ClientSocketPoller poller;
+  igtl::MessageHeader::Pointer headerMsg = self->IgtlMessageFactory->CreateHeaderMessage(IGTL_HEADER_VERSION_1);
 
-      int c = clientInfoMsg->Unpack(self->IgtlMessageCrcCheckEnabled);
-      if (c & igtl::MessageHeader::UNPACK_BODY || clientInfoMsg->GetBufferBodySize() == 0)
-      {
-        // Message received from client, need to lock to modify client info
-        igsioLockGuard<vtkIGSIORecursiveCriticalSection> igtlClientsMutexGuardedLock(self->IgtlClientsMutex);
-        client->ClientInfo = clientInfoMsg->GetClientInfo();
-        LOG_DEBUG("Client info message received from client " << clientId);
-      }
-    }
-    else if (typeid(*bodyMessage) == typeid(igtl::GetStatusMessage))
-    {
-      // Just ping server, we can skip message and respond
-      clientSocket->Skip(headerMsg->GetBodySizeToRead(), 0);
+  std::map<int, ClientData*> socketDescriptorToClientMap;
+  std::set<int> socketDescriptors;
+  std::vector<ClientData*> stoppedClients;
+  std::vector<int> readableSocketDescriptors;
 
-      igtl::StatusMessage::Pointer replyMsg = dynamic_cast<igtl::StatusMessage*>(self->IgtlMessageFactory->CreateSendMessage("STATUS", client->ClientInfo.GetClientHeaderVersion()).GetPointer());
-      replyMsg->SetCode(igtl::StatusMessage::STATUS_OK);
-      replyMsg->Pack();
-      clientSocket->Send(replyMsg->GetBufferPointer(), replyMsg->GetBufferSize());
-    }
-    else if (typeid(*bodyMessage) == typeid(igtl::StringMessage)
-             && vtkPlusCommand::IsCommandDeviceName(headerMsg->GetDeviceName()))
+  while (self->ClientReceiverEventLoopActive.Request)
+  {
+    // Collect the clients to wait for. Client data is not removed from the list until the respond flag is cleared,
+    // so the pointers remain valid until then.
+    socketDescriptorToClientMap.clear();
+    socketDescriptors.clear();
+    stoppedClients.clear();
     {
-      igtl::StringMessage::Pointer stringMsg = dynamic_cast<igtl::StringMessage*>(bodyMessage.GetPointer());
-      stringMsg->SetMessageHeader(headerMsg);
-      stringMsg->AllocateBuffer();
-      clientSocket->Receive(stringMsg->GetBufferBodyPointer(), stringMsg->GetBufferBodySize());
-
-      // We are receiving old style commands, handle it
-      int c = stringMsg->Unpack(self->IgtlMessageCrcCheckEnabled);
-      if (c & igtl::MessageHeader::UNPACK_BODY || stringMsg->GetBufferBodySize() == 0)
+      igsioLockGuard<vtkIGSIORecursiveCriticalSection> igtlClientsMutexGuardedLock(self->IgtlClientsMutex);
+      for (std::list<ClientData>::iterator clientIterator = self->IgtlClients.begin(); clientIterator != self->IgtlClients.end(); ++clientIterator)
       {
-        std::string deviceName(headerMsg->GetDeviceName());
-        if (deviceName.empty())
+        if (clientIterator->DataReceiverThreadId >= 0 || !clientIterator->DataReceiverActive.second)
         {
-          self->PlusCommandProcessor->QueueStringResponse(PLUS_FAIL, std::string(vtkPlusCommand::DEVICE_NAME_REPLY), clientId, "Unable to read DeviceName.");
+          // not received by the event loop or already released
           continue;
         }
-
-        uint32_t uid(0);
-        try
-        {
-#if (_MSC_VER == 1500)
-          std::istringstream ss(vtkPlusCommand::GetUidFromCommandDeviceName(deviceName));
-          ss >> uid;
-#else
-          uid = std::stoi(vtkPlusCommand::GetUidFromCommandDeviceName(deviceName));
-#endif
-        }
-        catch (std::invalid_argument e)
+        if (!clientIterator->DataReceiverActive.first)
         {
-          LOG_ERROR("Unable to extract command UID from device name string.");
-          // Removing support for malformed command strings, reply with error
-          self->PlusCommandProcessor->QueueStringResponse(PLUS_FAIL, std::string(vtkPlusCommand::DEVICE_NAME_REPLY), clientId, "Malformed DeviceName. Expected CMD_cmdId (ex: CMD_001)");
+          stoppedClients.push_back(&(*clientIterator));
           continue;
         }
-
-        deviceName = vtkPlusCommand::GetPrefixFromCommandDeviceName(deviceName);
-
-        if (std::find(previousCommandIds.begin(), previousCommandIds.end(), uid) != previousCommandIds.end())
+        if (clientIterator->SendFailed || clientIterator->ClientSocket.IsNull())
         {
-          // Command already exists
-          LOG_WARNING("Already received a command with id = " << uid << " from client " << clientId << ". This repeated command will be ignored.");
+          // waiting for disconnection
           continue;
         }
-        // New command, remember its ID
-        previousCommandIds.push_back(uid);
-        if (previousCommandIds.size() > NUMBER_OF_RECENT_COMMAND_IDS_STORED)
-        {
-          previousCommandIds.pop_front();
-        }
-
-        LOG_DEBUG("Received command from client " << clientId << ", device " << deviceName << " with UID " << uid << ": " << stringMsg->GetString());
-
-        vtkSmartPointer<vtkXMLDataElement> cmdElement = vtkSmartPointer<vtkXMLDataElement>::Take(vtkXMLUtilities::ReadElementFromString(stringMsg->GetString()));
-        std::string commandName = std::string(cmdElement->GetAttribute("Name") == NULL ? "" : cmdElement->GetAttribute("Name"));
-
-        self->PlusCommandProcessor->QueueCommand(false, clientId, commandName, stringMsg->GetString(), deviceName, uid, stringMsg->GetMetaData());
+        int socketDescriptor = SocketDescriptorAccess::GetSocketDescriptor(clientIterator->ClientSocket);
+        socketDescriptorToClientMap[socketDescriptor] = &(*clientIterator);
+        socketDescriptors.insert(socketDescriptor);
       }
-
     }
-    else if (typeid(*bodyMessage) == typeid(igtl::CommandMessage))
-    {
-      igtl::CommandMessage::Pointer commandMsg = dynamic_cast<igtl::CommandMessage*>(bodyMessage.GetPointer());
-      commandMsg->SetMessageHeader(headerMsg);
-      commandMsg->AllocateBuffer();
-      clientSocket->Receive(commandMsg->GetBufferBodyPointer(), commandMsg->GetBufferBodySize());
-
-      int c = commandMsg->Unpack(self->IgtlMessageCrcCheckEnabled);
-      if (c & igtl::MessageHeader::UNPACK_BODY || commandMsg->GetBufferBodySize() == 0)
-      {
-        std::string deviceName(headerMsg->GetDeviceName());
-
-        uint32_t uid;
-        uid = commandMsg->GetCommandId();
 
-        if (std::find(previousCommandIds.begin(), previousCommandIds.end(), uid) != previousCommandIds.end())
-        {
-          // Command already exists
-          LOG_WARNING("Already received a command with id = " << uid << " from client " << clientId << ". This repeated command will be ignored.");
-          continue;
-        }
-        // New command, remember its ID
-        previousCommandIds.push_back(uid);
-        if (previousCommandIds.size() > NUMBER_OF_RECENT_COMMAND_IDS_STORED)
-        {
-          previousCommandIds.pop_front();
-        }
-
-        LOG_DEBUG("Received header version " << commandMsg->GetHeaderVersion() << " command " << commandMsg->GetCommandName()
-                  << " from client " << clientId << ", device " << deviceName << " with UID " << uid << ": " << commandMsg->GetCommandContent());
-
-        self->PlusCommandProcessor->QueueCommand(true, clientId, commandMsg->GetCommandName(), commandMsg->GetCommandContent(), deviceName, uid, commandMsg->GetMetaData());
-      }
-      else
+    // Sockets of stopped clients are removed from the poller before the clients are released (and their sockets closed)
+    poller.SetSocketDescriptors(socketDescriptors);
+    if (!stoppedClients.empty())
+    {
+      igsioLockGuard<vtkIGSIORecursiveCriticalSection> igtlClientsMutexGuardedLock(self->IgtlClientsMutex);
+      for (std::vector<ClientData*>::iterator clientIterator = stoppedClients.begin(); clientIterator != stoppedClients.end(); ++clientIterator)
       {
-        LOG_ERROR("STRING message unpacking failed for client " << clientId);
+        (*clientIterator)->DataReceiverActive.second = false;
       }
     }
-    else if (typeid(*bodyMessage) == typeid(igtl::StartTrackingDataMessage))
-    {
-      std::string deviceName("");
-
-      igtl::StartTrackingDataMessage::Pointer startTracking = dynamic_cast<igtl::StartTrackingDataMessage*>(bodyMessage.GetPointer());
-      startTracking->SetMessageHeader(headerMsg);
-      startTracking->AllocateBuffer();
 
-      clientSocket->Receive(startTracking->GetBufferBodyPointer(), startTracking->GetBufferBodySize());
+    if (poller.Wait(CLIENT_RECEIVER_EVENT_LOOP_TIMEOUT_SEC * 1000, readableSocketDescriptors) != PLUS_SUCCESS)
+    {
+      vtkIGSIOAccurateTimer::Delay(CLIENT_RECEIVER_EVENT_LOOP_TIMEOUT_SEC);
+      continue;
+    }
 
-      int c = startTracking->Unpack(self->IgtlMessageCrcCheckEnabled);
-      if (c & igtl::MessageHeader::UNPACK_BODY || startTracking->GetBufferBodySize() == 0)
+    // Messages are processed without holding the client list lock, the same way as on the per-client receiver threads
+    for (std::vector<int>::iterator socketIterator = readableSocketDescriptors.begin(); socketIterator != readableSocketDescriptors.end(); ++socketIterator)
+    {
+      std::map<int, ClientData*>::iterator clientIterator = socketDescriptorToClientMap.find(*socketIterator);
+      if (clientIterator == socketDescriptorToClientMap.end())
       {
-        client->ClientInfo.SetTDATAResolution(startTracking->GetResolution());
-        client->ClientInfo.SetTDATARequested(true);
+        continue;
       }
-      else
+      ClientData* client = clientIterator->second;
+      bool messageReceived = false;
+      if (ReceiveClientMessage(client, headerMsg, messageReceived) != PLUS_SUCCESS || !messageReceived)
       {
-        LOG_ERROR("Client " << clientId << " STT_TDATA failed: could not retrieve startTracking message");
-        return NULL;
+        // The socket was readable but no message could be read: the client closed the connection or the stream is corrupted
+        LOG_INFO("Client disconnected - could not receive message from client " << client->ClientId << ".");
+        // The client is removed by the server's data sender thread
+        client->SendFailed = true;
       }
-
-      igtl::MessageBase::Pointer msg = self->IgtlMessageFactory->CreateSendMessage("RTS_TDATA", client->ClientInfo.GetClientHeaderVersion());
-      igtl::RTSTrackingDataMessage* rtsMsg = dynamic_cast<igtl::RTSTrackingDataMessage*>(msg.GetPointer());
-      rtsMsg->SetStatus(0);
-      rtsMsg->Pack();
-      self->QueueMessageResponseForClient(client->ClientId, msg);
     }
-    else if (typeid(*bodyMessage) == typeid(igtl::StopTrackingDataMessage))
-    {
-      igtl::StopTrackingDataMessage::Pointer stopTracking = dynamic_cast<igtl::StopTrackingDataMessage*>(bodyMessage.GetPointer());
-      stopTracking->SetMessageHeader(headerMsg);
-      stopTracking->AllocateBuffer();
-
-      clientSocket->Receive(stopTracking->GetBufferBodyPointer(), stopTracking->GetBufferBodySize());
+  }
 
-      client->ClientInfo.SetTDATARequested(false);
-      igtl::MessageBase::Pointer msg = self->IgtlMessageFactory->CreateSendMessage("RTS_TDATA", client->ClientInfo.GetClientHeaderVersion());
-      igtl::RTSTrackingDataMessage* rtsMsg = dynamic_cast<igtl::RTSTrackingDataMessage*>(msg.GetPointer());
-      rtsMsg->SetStatus(0);
-      rtsMsg->Pack();
-      self->QueueMessageResponseForClient(client->ClientId, msg);
-    }
-    else if (typeid(*bodyMessage) == typeid(igtl::GetPolyDataMessage))
+  // Release all clients, so that they can be disconnected
+  {
+    igsioLockGuard<vtkIGSIORecursiveCriticalSection> igtlClientsMutexGuardedLock(self->IgtlClientsMutex);
+    for (std::list<ClientData>::iterator clientIterator = self->IgtlClients.begin(); clientIterator != self->IgtlClients.end(); ++clientIterator)
     {
-      igtl::GetPolyDataMessage::Pointer polyDataMessage = dynamic_cast<igtl::GetPolyDataMessage*>(bodyMessage.GetPointer());
-      polyDataMessage->SetMessageHeader(headerMsg);
-      polyDataMessage->AllocateBuffer();
-
-      clientSocket->Receive(polyDataMessage->GetBufferBodyPointer(), polyDataMessage->GetBufferBodySize());
-
-      int c = polyDataMessage->Unpack(self->IgtlMessageCrcCheckEnabled);
-      if (c & igtl::MessageHeader::UNPACK_BODY || polyDataMessage->GetBufferBodySize() == 0)
+      if (clientIterator->DataReceiverThreadId < 0)
       {
-        std::string fileName;
-        // Check metadata for requisite parameters, if absent, check deviceName
-        if (polyDataMessage->GetHeaderVersion() > IGTL_HEADER_VERSION_1)
-        {
-          if (!polyDataMessage->GetMetaDataElement("filename", fileName))
-          {
-            fileName = polyDataMessage->GetDeviceName();
-            if (fileName.empty())
-            {
-              LOG_ERROR("GetPolyData message sent with no filename in either metadata or deviceName field.");
-              continue;
-            }
-          }
-        }
-        else
+        clientIterator->DataReceiverActive.second = false;
+      }
+    }
+  }
+
+  // Close thread
+  self->ClientReceiverEventLoopThreadId = -1;
+  self->ClientReceiverEventLoopActive.Respond = false;
+  return NULL;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusOpenIGTLinkServer::ReceiveClientMessage(ClientData* client, igtl::MessageHeader::Pointer headerMsg, bool& messageReceived)
+{
+  messageReceived = false;
+  vtkPlusOpenIGTLinkServer* self = client->Server;
+
+  // Make copy of frequently used data to avoid locking of client data
+  igtl::ClientSocket::Pointer clientSocket = client->ClientSocket;
+  int clientId = client->ClientId;
+
+  headerMsg->InitBuffer();
+
+  // Receive generic header from the socket
+  int bytesReceived = clientSocket->Receive(headerMsg->GetBufferPointer(), headerMsg->GetBufferSize());
+  if (bytesReceived == IGTL_EMPTY_DATA_SIZE || bytesReceived != headerMsg->GetBufferSize())
+  {
+    return PLUS_SUCCESS;
+  }
+  messageReceived = true;
+
+  headerMsg->Unpack(self->IgtlMessageCrcCheckEnabled);
+
+  {
+    igsioLockGuard<vtkIGSIORecursiveCriticalSection> igtlClientsMutexGuardedLock(self->IgtlClientsMutex);
+    // Keep track of the highest known version of message ever sent by this client, this is the version that we reply with
+    // (upper bounded by the servers version)
+    if (headerMsg->GetHeaderVersion() > client->ClientInfo.GetClientHeaderVersion())
+    {
+      client->ClientInfo.SetClientHeaderVersion(std::min<int>(self->GetIGTLHeaderVersion(), headerMsg->GetHeaderVersion()));
+    }
+  }
+
+  igtl::MessageBase::Pointer bodyMessage = self->IgtlMessageFactory->CreateReceiveMessage(headerMsg);
+  if (bodyMessage.IsNull())
+  {
+    LOG_ERROR("Unable to receive message from client: " << client->ClientId);
+    return PLUS_SUCCESS;
+  }
+
+  if (typeid(*bodyMessage) == typeid(igtl::PlusClientInfoMessage))
+  {
+    igtl::PlusClientInfoMessage::Pointer clientInfoMsg = dynamic_cast<igtl::PlusClientInfoMessage*>(bodyMessage.GetPointer());
+    clientInfoMsg->SetMessageHeader(headerMsg);
+    clientInfoMsg->AllocateBuffer();
+
+    clientSocket->Receive(clientInfoMsg->GetBufferBodyPointer(), clientInfoMsg->GetBufferBodySize());
+
+    int c = clientInfoMsg->Unpack(self->IgtlMessageCrcCheckEnabled);
+    if (c & igtl::MessageHeader::UNPACK_BODY || clientInfoMsg->GetBufferBodySize() == 0)
+    {
+      // Message received from client, need to lock to modify client info
+      igsioLockGuard<vtkIGSIORecursiveCriticalSection> igtlClientsMutexGuardedLock(self->IgtlClientsMutex);
+      client->ClientInfo = clientInfoMsg->GetClientInfo();
+      LOG_DEBUG("Client info message received from client " << clientId);
+    }
+  }
+  else if (typeid(*bodyMessage) == typeid(igtl::GetStatusMessage))
+  {
+    // Just ping server, we can skip message and respond
+    clientSocket->Skip(headerMsg->GetBodySizeToRead(), 0);
+
+    igtl::StatusMessage::Pointer replyMsg = dynamic_cast<igtl::StatusMessage*>(self->IgtlMessageFactory->CreateSendMessage("STATUS", client->ClientInfo.GetClientHeaderVersion()).GetPointer());
+    replyMsg->SetCode(igtl::StatusMessage::STATUS_OK);
+    replyMsg->Pack();
+    client->SendQueue->Push(replyMsg.GetPointer(), PlusIgtlClientSendQueue::NEVER_DROP);
+  }
+  else if (typeid(*bodyMessage) == typeid(igtl::StringMessage)
+           && vtkPlusCommand::IsCommandDeviceName(headerMsg->GetDeviceName()))
+  {
+    igtl::StringMessage::Pointer stringMsg = dynamic_cast<igtl::StringMessage*>(bodyMessage.GetPointer());
+    stringMsg->SetMessageHeader(headerMsg);
+    stringMsg->AllocateBuffer();
+    clientSocket->Receive(stringMsg->GetBufferBodyPointer(), stringMsg->GetBufferBodySize());
+
+    // We are receiving old style commands, handle it
+    int c = stringMsg->Unpack(self->IgtlMessageCrcCheckEnabled);
+    if (c & igtl::MessageHeader::UNPACK_BODY || stringMsg->GetBufferBodySize() == 0)
+    {
+      std::string deviceName(headerMsg->GetDeviceName());
+      if (deviceName.empty())
+      {
+        self->PlusCommandProcessor->QueueStringResponse(PLUS_FAIL, std::string(vtkPlusCommand::DEVICE_NAME_REPLY), clientId, "Unable to read DeviceName.");
+        return PLUS_SUCCESS;
+      }
+
+      uint32_t uid(0);
+      try
+      {
+#if (_MSC_VER == 1500)
+        std::istringstream ss(vtkPlusCommand::GetUidFromCommandDeviceName(deviceName));
+        ss >> uid;
+#else
+        uid = std::stoi(vtkPlusCommand::GetUidFromCommandDeviceName(deviceName));
+#endif
+      }
+      catch (std::invalid_argument e)
+      {
+        LOG_ERROR("Unable to extract command UID from device name string.");
+        // Removing support for malformed command strings, reply with error
+        self->PlusCommandProcessor->QueueStringResponse(PLUS_FAIL, std::string(vtkPlusCommand::DEVICE_NAME_REPLY), clientId, "Malformed DeviceName. Expected CMD_cmdId (ex: CMD_001)");
+        return PLUS_SUCCESS;
+      }
+
+      deviceName = vtkPlusCommand::GetPrefixFromCommandDeviceName(deviceName);
+
+      if (std::find(client->PreviousCommandIds.begin(), client->PreviousCommandIds.end(), uid) != client->PreviousCommandIds.end())
+      {
+        // Command already exists
+        LOG_WARNING("Already received a command with id = " << uid << " from client " << clientId << ". This repeated command will be ignored.");
+        return PLUS_SUCCESS;
+      }
+      // New command, remember its ID
+      client->PreviousCommandIds.push_back(uid);
+      if (client->PreviousCommandIds.size() > NUMBER_OF_RECENT_COMMAND_IDS_STORED)
+      {
+        client->PreviousCommandIds.pop_front();
+      }
+
+      LOG_DEBUG("Received command from client " << clientId << ", device " << deviceName << " with UID " << uid << ": " << stringMsg->GetString());
+
+      vtkSmartPointer<vtkXMLDataElement> cmdElement = vtkSmartPointer<vtkXMLDataElement>::Take(vtkXMLUtilities::ReadElementFromString(stringMsg->GetString()));
+      std::string commandName = std::string(cmdElement->GetAttribute("Name") == NULL ? "" : cmdElement->GetAttribute("Name"));
+
+      self->PlusCommandProcessor->QueueCommand(false, clientId, commandName, stringMsg->GetString(), deviceName, uid, stringMsg->GetMetaData());
+    }
+
+  }
+  else if (typeid(*bodyMessage) == typeid(igtl::CommandMessage))
+  {
+    igtl::CommandMessage::Pointer commandMsg = dynamic_cast<igtl::CommandMessage*>(bodyMessage.GetPointer());
+    commandMsg->SetMessageHeader(headerMsg);
+    commandMsg->AllocateBuffer();
+    clientSocket->Receive(commandMsg->GetBufferBodyPointer(), commandMsg->GetBufferBodySize());
+
+    int c = commandMsg->Unpack(self->IgtlMessageCrcCheckEnabled);
+    if (c & igtl::MessageHeader::UNPACK_BODY || commandMsg->GetBufferBodySize() == 0)
+    {
+      std::string deviceName(headerMsg->GetDeviceName());
+
+      uint32_t uid;
+      uid = commandMsg->GetCommandId();
+
+      if (std::find(client->PreviousCommandIds.begin(), client->PreviousCommandIds.end(), uid) != client->PreviousCommandIds.end())
+      {
+        // Command already exists
+        LOG_WARNING("Already received a command with id = " << uid << " from client " << clientId << ". This repeated command will be ignored.");
+        return PLUS_SUCCESS;
+      }
+      // New command, remember its ID
+      client->PreviousCommandIds.push_back(uid);
+      if (client->PreviousCommandIds.size() > NUMBER_OF_RECENT_COMMAND_IDS_STORED)
+      {
+        client->PreviousCommandIds.pop_front();
+      }
+
+      LOG_DEBUG("Received header version " << commandMsg->GetHeaderVersion() << " command " << commandMsg->GetCommandName()
+                << " from client " << clientId << ", device " << deviceName << " with UID " << uid << ": " << commandMsg->GetCommandContent());
+
+      self->PlusCommandProcessor->QueueCommand(true, clientId, commandMsg->GetCommandName(), commandMsg->GetCommandContent(), deviceName, uid, commandMsg->GetMetaData());
+    }
+    else
+    {
+      LOG_ERROR("STRING message unpacking failed for client " << clientId);
+    }
+  }
+  else if (typeid(*bodyMessage) == typeid(igtl::StartTrackingDataMessage))
+  {
+    std::string deviceName("");
+
+    igtl::StartTrackingDataMessage::Pointer startTracking = dynamic_cast<igtl::StartTrackingDataMessage*>(bodyMessage.GetPointer());
+    startTracking->SetMessageHeader(headerMsg);
+    startTracking->AllocateBuffer();
+
+    clientSocket->Receive(startTracking->GetBufferBodyPointer(), startTracking->GetBufferBodySize());
+
+    int c = startTracking->Unpack(self->IgtlMessageCrcCheckEnabled);
+    if (c & igtl::MessageHeader::UNPACK_BODY || startTracking->GetBufferBodySize() == 0)
+    {
+      client->ClientInfo.SetTDATAResolution(startTracking->GetResolution());
+      client->ClientInfo.SetTDATARequested(true);
+    }
+    else
+    {
+      LOG_ERROR("Client " << clientId << " STT_TDATA failed: could not retrieve startTracking message");
+      return PLUS_FAIL;
+    }
+
+    igtl::MessageBase::Pointer msg = self->IgtlMessageFactory->CreateSendMessage("RTS_TDATA", client->ClientInfo.GetClientHeaderVersion());
+    igtl::RTSTrackingDataMessage* rtsMsg = dynamic_cast<igtl::RTSTrackingDataMessage*>(msg.GetPointer());
+    rtsMsg->SetStatus(0);
+    rtsMsg->Pack();
+    self->QueueMessageResponseForClient(client->ClientId, msg);
+  }
+  else if (typeid(*bodyMessage) == typeid(igtl::StopTrackingDataMessage))
+  {
+    igtl::StopTrackingDataMessage::Pointer stopTracking = dynamic_cast<igtl::StopTrackingDataMessage*>(bodyMessage.GetPointer());
+    stopTracking->SetMessageHeader(headerMsg);
+    stopTracking->AllocateBuffer();
+
+    clientSocket->Receive(stopTracking->GetBufferBodyPointer(), stopTracking->GetBufferBodySize());
+
+    client->ClientInfo.SetTDATARequested(false);
+    igtl::MessageBase::Pointer msg = self->IgtlMessageFactory->CreateSendMessage("RTS_TDATA", client->ClientInfo.GetClientHeaderVersion());
+    igtl::RTSTrackingDataMessage* rtsMsg = dynamic_cast<igtl::RTSTrackingDataMessage*>(msg.GetPointer());
+    rtsMsg->SetStatus(0);
+    rtsMsg->Pack();
+    self->QueueMessageResponseForClient(client->ClientId, msg);
+  }
+  else if (typeid(*bodyMessage) == typeid(igtl::GetPolyDataMessage))
+  {
+    igtl::GetPolyDataMessage::Pointer polyDataMessage = dynamic_cast<igtl::GetPolyDataMessage*>(bodyMessage.GetPointer());
+    polyDataMessage->SetMessageHeader(headerMsg);
+    polyDataMessage->AllocateBuffer();
+
+    clientSocket->Receive(polyDataMessage->GetBufferBodyPointer(), polyDataMessage->GetBufferBodySize());
+
+    int c = polyDataMessage->Unpack(self->IgtlMessageCrcCheckEnabled);
+    if (c & igtl::MessageHeader::UNPACK_BODY || polyDataMessage->GetBufferBodySize() == 0)
+    {
+      std::string fileName;
+      // Check metadata for requisite parameters, if absent, check deviceName
+      if (polyDataMessage->GetHeaderVersion() > IGTL_HEADER_VERSION_1)
+      {
+        if (!polyDataMessage->GetMetaDataElement("filename", fileName))
         {
           fileName = polyDataMessage->GetDeviceName();
           if (fileName.empty())
           {
             LOG_ERROR("GetPolyData message sent with no filename in either metadata or deviceName field.");
-            continue;
+            return PLUS_SUCCESS;
           }
         }
+      }
+      else
+      {
+        fileName = polyDataMessage->GetDeviceName();
+        if (fileName.empty())
+        {
+          LOG_ERROR("GetPolyData message sent with no filename in either metadata or deviceName field.");
+          return PLUS_SUCCESS;
+        }
+      }
 
-        vtkSmartPointer<vtkPolyDataReader> reader = vtkSmartPointer<vtkPolyDataReader>::New();
-        reader->SetFileName(fileName.c_str());
-        reader->Update();
+      vtkSmartPointer<vtkPolyDataReader> reader = vtkSmartPointer<vtkPolyDataReader>::New();
+      reader->SetFileName(fileName.c_str());
+      reader->Update();
 
-        auto polyData = reader->GetOutput();
-        if (polyData != nullptr)
-        {
-          igtl::MessageBase::Pointer msg = self->IgtlMessageFactory->CreateSendMessage("POLYDATA", client->ClientInfo.GetClientHeaderVersion());
-          igtl::PolyDataMessage* polyMsg = dynamic_cast<igtl::PolyDataMessage*>(msg.GetPointer());
+      auto polyData = reader->GetOutput();
+      if (polyData != nullptr)
+      {
+        igtl::MessageBase::Pointer msg = self->IgtlMessageFactory->CreateSendMessage("POLYDATA", client->ClientInfo.GetClientHeaderVersion());
+        igtl::PolyDataMessage* polyMsg = dynamic_cast<igtl::PolyDataMessage*>(msg.GetPointer());
 
-          igtlioPolyDataConverter::ContentData data;
-          data.deviceName = "PlusServer";
-          data.polydata = polyData;
+        igtlioPolyDataConverter::ContentData data;
+        data.deviceName = "PlusServer";
+        data.polydata = polyData;
 
-          igtlioBaseConverter::HeaderData header;
-          header.deviceName = "PlusServer";
+        igtlioBaseConverter::HeaderData header;
+        header.deviceName = "PlusServer";
 
-          igtlioPolyDataConverter::toIGTL(header, data, (igtl::PolyDataMessage::Pointer*)&msg);
-          if (!msg->SetMetaDataElement("fileName", IANA_TYPE_US_ASCII, fileName))
-          {
-            LOG_ERROR("Filename too long to be sent back to client. Aborting.");
-            continue;
-          }
-          self->QueueMessageResponseForClient(client->ClientId, msg);
-          continue;
+        igtlioPolyDataConverter::toIGTL(header, data, (igtl::PolyDataMessage::Pointer*)&msg);
+        if (!msg->SetMetaDataElement("fileName", IANA_TYPE_US_ASCII, fileName))
+        {
+          LOG_ERROR("Filename too long to be sent back to client. Aborting.");
+          return PLUS_SUCCESS;
         }
-
-        igtl::MessageBase::Pointer msg = self->IgtlMessageFactory->CreateSendMessage("RTS_POLYDATA", polyDataMessage->GetHeaderVersion());
-        igtl::RTSPolyDataMessage* rtsPolyMsg = dynamic_cast<igtl::RTSPolyDataMessage*>(msg.GetPointer());
-        rtsPolyMsg->SetStatus(false);
-        self->QueueMessageResponseForClient(client->ClientId, rtsPolyMsg);
+        self->QueueMessageResponseForClient(client->ClientId, msg);
+        return PLUS_SUCCESS;
       }
-      else
+
+      igtl::MessageBase::Pointer msg = self->IgtlMessageFactory->CreateSendMessage("RTS_POLYDATA", polyDataMessage->GetHeaderVersion());
+      igtl::RTSPolyDataMessage* rtsPolyMsg = dynamic_cast<igtl::RTSPolyDataMessage*>(msg.GetPointer());
+      rtsPolyMsg->SetStatus(false);
+      self->QueueMessageResponseForClient(client->ClientId, rtsPolyMsg);
+    }
+    else
+    {
+      LOG_ERROR("Client " << clientId << " GET_POLYDATA failed: could not retrieve message");
+      return PLUS_FAIL;
+    }
+  }
+  else if (typeid(*bodyMessage) == typeid(igtl::StatusMessage))
+  {
+    // status message is used as a keep-alive, don't do anything
+    clientSocket->Skip(headerMsg->GetBodySizeToRead(), 0);
+  }
+  else if (typeid(*bodyMessage) == typeid(igtl::GetImageMetaMessage))
+  {
+    igtl::GetImageMetaMessage::Pointer getImageMetaMsg = dynamic_cast<igtl::GetImageMetaMessage*>(bodyMessage.GetPointer());
+    getImageMetaMsg->SetMessageHeader(headerMsg);
+    getImageMetaMsg->AllocateBuffer();
+
+    clientSocket->Receive(getImageMetaMsg->GetBufferBodyPointer(), getImageMetaMsg->GetBufferBodySize());
+
+    int c = getImageMetaMsg->Unpack(self->IgtlMessageCrcCheckEnabled);
+    if (c & igtl::MessageHeader::UNPACK_BODY || getImageMetaMsg->GetBufferBodySize() == 0)
+    {
+      // Image meta message
+      std::string deviceName("");
+      if (headerMsg->GetDeviceName() != NULL)
       {
-        LOG_ERROR("Client " << clientId << " GET_POLYDATA failed: could not retrieve message");
-        return NULL;
+        deviceName = headerMsg->GetDeviceName();
       }
+      self->PlusCommandProcessor->QueueGetImageMetaData(clientId, deviceName);
     }
-    else if (typeid(*bodyMessage) == typeid(igtl::StatusMessage))
+    else
     {
-      // status message is used as a keep-alive, don't do anything
-      clientSocket->Skip(headerMsg->GetBodySizeToRead(), 0);
+      LOG_ERROR("Client " << clientId << " GET_IMGMETA failed: could not retrieve message");
+      return PLUS_FAIL;
     }
-    else if (typeid(*bodyMessage) == typeid(igtl::GetImageMetaMessage))
-    {
-      igtl::GetImageMetaMessage::Pointer getImageMetaMsg = dynamic_cast<igtl::GetImageMetaMessage*>(bodyMessage.GetPointer());
-      getImageMetaMsg->SetMessageHeader(headerMsg);
-      getImageMetaMsg->AllocateBuffer();
+  }
+  else if (typeid(*bodyMessage) == typeid(igtl::GetImageMessage))
+  {
+    igtl::GetImageMessage::Pointer getImageMsg = dynamic_cast<igtl::GetImageMessage*>(bodyMessage.GetPointer());
+    getImageMsg->SetMessageHeader(headerMsg);
+    getImageMsg->AllocateBuffer();
 
-      clientSocket->Receive(getImageMetaMsg->GetBufferBodyPointer(), getImageMetaMsg->GetBufferBodySize());
+    clientSocket->Receive(getImageMsg->GetBufferBodyPointer(), getImageMsg->GetBufferBodySize());
 
-      int c = getImageMetaMsg->Unpack(self->IgtlMessageCrcCheckEnabled);
-      if (c & igtl::MessageHeader::UNPACK_BODY || getImageMetaMsg->GetBufferBodySize() == 0)
+    int c = getImageMsg->Unpack(self->IgtlMessageCrcCheckEnabled);
+    if (c & igtl::MessageHeader::UNPACK_BODY || getImageMsg->GetBufferBodySize() == 0)
+    {
+      std::string deviceName("");
+      if (headerMsg->GetDeviceName() != NULL)
       {
-        // Image meta message
-        std::string deviceName("");
-        if (headerMsg->GetDeviceName() != NULL)
-        {
-          deviceName = headerMsg->GetDeviceName();
-        }
-        self->PlusCommandProcessor->QueueGetImageMetaData(clientId, deviceName);
+        deviceName = headerMsg->GetDeviceName();
       }
       else
       {
-        LOG_ERROR("Client " << clientId << " GET_IMGMETA failed: could not retrieve message");
-        return NULL;
+        LOG_ERROR("Please select the image you want to acquire");
+        return PLUS_FAIL;
       }
+      self->PlusCommandProcessor->QueueGetImage(clientId, deviceName);
     }
-    else if (typeid(*bodyMessage) == typeid(igtl::GetImageMessage))
+    else
     {
-      igtl::GetImageMessage::Pointer getImageMsg = dynamic_cast<igtl::GetImageMessage*>(bodyMessage.GetPointer());
-      getImageMsg->SetMessageHeader(headerMsg);
-      getImageMsg->AllocateBuffer();
+      LOG_ERROR("Client " << clientId << " GET_IMAGE failed: could not retrieve message");
+      return PLUS_FAIL;
+    }
+
+  }
+  else if (typeid(*bodyMessage) == typeid(igtl::GetPointMessage))
+  {
+    igtl::GetPointMessage* getPointMsg = dynamic_cast<igtl::GetPointMessage*>(bodyMessage.GetPointer());
+    getPointMsg->SetMessageHeader(headerMsg);
+    getPointMsg->AllocateBuffer();
 
-      clientSocket->Receive(getImageMsg->GetBufferBodyPointer(), getImageMsg->GetBufferBodySize());
+    clientSocket->Receive(getPointMsg->GetBufferBodyPointer(), getPointMsg->GetBufferBodySize());
 
-      int c = getImageMsg->Unpack(self->IgtlMessageCrcCheckEnabled);
-      if (c & igtl::MessageHeader::UNPACK_BODY || getImageMsg->GetBufferBodySize() == 0)
+    int c = getPointMsg->Unpack(self->IgtlMessageCrcCheckEnabled);
+    if (c & igtl::MessageHeader::UNPACK_BODY || getPointMsg->GetBufferBodySize() == 0)
+    {
+      std::string fileName;
+      if (!getPointMsg->GetMetaDataElement("Filename", fileName))
       {
-        std::string deviceName("");
-        if (headerMsg->GetDeviceName() != NULL)
-        {
-          deviceName = headerMsg->GetDeviceName();
-        }
-        else
-        {
-          LOG_ERROR("Please select the image you want to acquire");
-          return NULL;
-        }
-        self->PlusCommandProcessor->QueueGetImage(clientId, deviceName);
+        fileName = getPointMsg->GetDeviceName();
       }
-      else
+
+      if (igsioCommon::Tail(fileName, 4) != "fcsv")
       {
-        LOG_ERROR("Client " << clientId << " GET_IMAGE failed: could not retrieve message");
-        return NULL;
+        LOG_WARNING("Filename does not end in fcsv. GetPoint behaviour may not function correctly.");
       }
 
-    }
-    else if (typeid(*bodyMessage) == typeid(igtl::GetPointMessage))
-    {
-      igtl::GetPointMessage* getPointMsg = dynamic_cast<igtl::GetPointMessage*>(bodyMessage.GetPointer());
-      getPointMsg->SetMessageHeader(headerMsg);
-      getPointMsg->AllocateBuffer();
+      if (!vtksys::SystemTools::FileExists(fileName) &&
+          !vtksys::SystemTools::FileExists(vtkPlusConfig::GetInstance()->GetImagePath(fileName)))
+      {
+        LOG_ERROR("File: " << fileName << " requested but does not exist. Cannot get POINT data from it.");
+        return PLUS_FAIL;
+      }
 
-      clientSocket->Receive(getPointMsg->GetBufferBodyPointer(), getPointMsg->GetBufferBodySize());
+      igtl::MessageBase::Pointer msg = self->IgtlMessageFactory->CreateSendMessage("POINT", client->ClientInfo.GetClientHeaderVersion());
+      igtl::PointMessage* pointMsg = dynamic_cast<igtl::PointMessage*>(msg.GetPointer());
 
-      int c = getPointMsg->Unpack(self->IgtlMessageCrcCheckEnabled);
-      if (c & igtl::MessageHeader::UNPACK_BODY || getPointMsg->GetBufferBodySize() == 0)
+      std::ifstream t(fileName);
+      if (!t.is_open())
       {
-        std::string fileName;
-        if (!getPointMsg->GetMetaDataElement("Filename", fileName))
+        t.open(vtkPlusConfig::GetInstance()->GetImagePath(fileName));
+        if (!t.is_open())
         {
-          fileName = getPointMsg->GetDeviceName();
+          LOG_ERROR("Cannot read file: " << fileName);
+          return PLUS_FAIL;
         }
-
-        if (igsioCommon::Tail(fileName, 4) != "fcsv")
+      }
+      std::stringstream buffer;
+      buffer << t.rdbuf();
+      std::vector<std::string> lines = igsioCommon::SplitStringIntoTokens(buffer.str(), '\n', false);
+      for (std::vector<std::string>::iterator it = lines.begin(); it != lines.end(); ++it)
+      {
+        std::string line = igsioCommon::Trim(*it);
+        if (line[0] == '#')
         {
-          LOG_WARNING("Filename does not end in fcsv. GetPoint behaviour may not function correctly.");
+          continue;
         }
 
-        if (!vtksys::SystemTools::FileExists(fileName) &&
-            !vtksys::SystemTools::FileExists(vtkPlusConfig::GetInstance()->GetImagePath(fileName)))
-        {
-          LOG_ERROR("File: " << fileName << " requested but does not exist. Cannot get POINT data from it.");
-          return NULL;
-        }
+        std::vector<std::string> tokens = igsioCommon::SplitStringIntoTokens(line, ',', true);
+        igtl::PointElement::Pointer elem = igtl::PointElement::New();
+        elem->SetPosition(std::stof(tokens[1]), std::stof(tokens[2]), std::stof(tokens[3]));
+        elem->SetName(tokens[0].c_str());
+        elem->SetGroupName("Point");
+        pointMsg->AddPointElement(elem);
+      }
 
-        igtl::MessageBase::Pointer msg = self->IgtlMessageFactory->CreateSendMessage("POINT", client->ClientInfo.GetClientHeaderVersion());
-        igtl::PointMessage* pointMsg = dynamic_cast<igtl::PointMessage*>(msg.GetPointer());
+      self->QueueMessageResponseForClient(client->ClientId, pointMsg);
+    }
+    else
+    {
+      LOG_ERROR("Client " << clientId << " GET_POINT failed: could not retrieve message");
+      return PLUS_FAIL;
+    }
+  }
+  else
+  {
+    // if the device type is unknown, skip reading.
+    LOG_WARNING("Unknown OpenIGTLink message is received from client " << clientId << ". Device type: " << headerMsg->GetMessageType()
+                << ". Device name: " << headerMsg->GetDeviceName() << ".");
+    clientSocket->Skip(headerMsg->GetBodySizeToRead(), 0);
+    return PLUS_SUCCESS;
+  }
 
-        std::ifstream t(fileName);
-        if (!t.is_open())
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void* vtkPlusOpenIGTLinkServer::ClientDataSenderThread(vtkMultiThreader::ThreadInfo* data)
+{
+  ClientData* client = (ClientData*)(data->UserData);
+  client->DataSenderActive.second = true;
+  vtkPlusOpenIGTLinkServer* self = client->Server;
+  PLUS_PROFILE_THREAD_NAME("Plus server client data sender");
+
+  // Make copy of frequently used data to avoid locking of client data
+  igtl::ClientSocket::Pointer clientSocket = client->ClientSocket;
+  std::shared_ptr<PlusIgtlClientSendQueue> sendQueue = client->SendQueue;
+  std::shared_ptr<PlusLatencyHistogram> sendLatency = client->SendLatency;
+  int socketDescriptor = SocketDescriptorAccess::GetSocketDescriptor(clientSocket);
+
+  while (client->DataSenderActive.first)
+  {
+    igtl::MessageBase::Pointer igtlMessage;
+    double timeInQueueSec = 0;
+    if (!sendQueue->Pop(igtlMessage, CLIENT_SOCKET_TIMEOUT_SEC, &timeInQueueSec) || igtlMessage.IsNull())
+    {
+      continue;
+    }
+
+    if (self->DefaultClientBatchedSendEnabled)
+    {
+      // Take all messages that are already waiting and send them together
+      std::vector<igtl::MessageBase::Pointer> batchMessages(1, igtlMessage);
+      std::vector<double> batchTimesInQueueSec(1, timeInQueueSec);
+      igtl::MessageBase::Pointer nextMessage;
+      while (batchMessages.size() < MAX_NUMBER_OF_MESSAGES_PER_BATCH && sendQueue->Pop(nextMessage, 0, &timeInQueueSec))
+      {
+        if (nextMessage.IsNotNull())
         {
-          t.open(vtkPlusConfig::GetInstance()->GetImagePath(fileName));
-          if (!t.is_open())
-          {
-            LOG_ERROR("Cannot read file: " << fileName);
-            return NULL;
-          }
+          batchMessages.push_back(nextMessage);
+          batchTimesInQueueSec.push_back(timeInQueueSec);
         }
-        std::stringstream buffer;
-        buffer << t.rdbuf();
-        std::vector<std::string> lines = igsioCommon::SplitStringIntoTokens(buffer.str(), '\n', false);
-        for (std::vector<std::string>::iterator it = lines.begin(); it != lines.end(); ++it)
-        {
-          std::string line = igsioCommon::Trim(*it);
-          if (line[0] == '#')
-          {
-            continue;
-          }
+      }
 
-          std::vector<std::string> tokens = igsioCommon::SplitStringIntoTokens(line, ',', true);
-          igtl::PointElement::Pointer elem = igtl::PointElement::New();
-          elem->SetPosition(std::stof(tokens[1]), std::stof(tokens[2]), std::stof(tokens[3]));
-          elem->SetName(tokens[0].c_str());
-          elem->SetGroupName("Point");
-          pointMsg->AddPointElement(elem);
+      double sendStartTime = vtkIGSIOAccurateTimer::GetSystemTime();
+      bool sent = SendClientSocketMessages(socketDescriptor, batchMessages);
+      if (PlusTelemetry::Instance()->GetEnabled())
+      {
+        double sendTimeSec = vtkIGSIOAccurateTimer::GetSystemTime() - sendStartTime;
+        for (std::vector<double>::iterator it = batchTimesInQueueSec.begin(); it != batchTimesInQueueSec.end(); ++it)
+        {
+          PlusTelemetry::Instance()->AddSample(PlusTelemetry::STAGE_QUEUE_TO_SOCKET, *it + sendTimeSec);
+          sendLatency->AddSample(*it + sendTimeSec);
         }
-
-        self->QueueMessageResponseForClient(client->ClientId, pointMsg);
       }
-      else
+      if (!sent)
       {
-        LOG_ERROR("Client " << clientId << " GET_POINT failed: could not retrieve message");
-        return NULL;
+        LOG_INFO("Client disconnected - could not send " << batchMessages.size() << " messages to client.");
+        // The client is removed by the server's data sender thread
+        client->SendFailed = true;
+        break;
       }
+      continue;
     }
-    else
+
+    double sendStartTime = vtkIGSIOAccurateTimer::GetSystemTime();
+    int retValue = 0;
+    RETRY_UNTIL_TRUE((retValue = clientSocket->Send(igtlMessage->GetBufferPointer(), igtlMessage->GetBufferSize())) != 0, self->NumberOfRetryAttempts, self->DelayBetweenRetryAttemptsSec);
+    if (PlusTelemetry::Instance()->GetEnabled())
     {
-      // if the device type is unknown, skip reading.
-      LOG_WARNING("Unknown OpenIGTLink message is received from client " << clientId << ". Device type: " << headerMsg->GetMessageType()
-                  << ". Device name: " << headerMsg->GetDeviceName() << ".");
-      clientSocket->Skip(headerMsg->GetBodySizeToRead(), 0);
-      continue;
+      double latencySec = timeInQueueSec + vtkIGSIOAccurateTimer::GetSystemTime() - sendStartTime;
+      PlusTelemetry::Instance()->AddSample(PlusTelemetry::STAGE_QUEUE_TO_SOCKET, latencySec);
+      sendLatency->AddSample(latencySec);
+    }
+    if (retValue == 0)
+    {
+      igtl::TimeStamp::Pointer ts = igtl::TimeStamp::New();
+      igtlMessage->GetTimeStamp(ts);
+      LOG_INFO("Client disconnected - could not send " << igtlMessage->GetMessageType() << " message to client (device name: " << igtlMessage->GetDeviceName()
+               << "  Timestamp: " << std::fixed << ts->GetTimeStamp() << ").");
+      // The client is removed by the server's data sender thread
+      client->SendFailed = true;
+      break;
     }
-  } // ConnectionActive
+  }
 
   // Close thread
-  client->DataReceiverThreadId = -1;
-  client->DataReceiverActive.second = false;
+  client->DataSenderThreadId = -1;
+  client->DataSenderActive.second = false;
   return NULL;
 }
 
@@ -1009,16 +1567,6 @@ PlusStatus vtkPlusOpenIGTLinkServer::SendTrackedFrame(igsioTrackedFrame& tracked
 {
   int numberOfErrors = 0;
 
-  // Update transform repository with the tracked frame
-  if (this->TransformRepository != NULL)
-  {
-    if (this->TransformRepository->SetTransforms(trackedFrame) != PLUS_SUCCESS)
-    {
-      LOG_ERROR("Failed to set current transforms to transform repository");
-      numberOfErrors++;
-    }
-  }
-
   // Convert relative timestamp to UTC
   double timestampSystem = trackedFrame.GetTimestamp(); // save original timestamp, we'll restore it later
   double timestampUniversal = vtkIGSIOAccurateTimer::GetUniversalTimeFromSystemTime(timestampSystem);
@@ -1028,37 +1576,56 @@ PlusStatus vtkPlusOpenIGTLinkServer::SendTrackedFrame(igsioTrackedFrame& tracked
   {
     // Lock before we send message to the clients
     igsioLockGuard<vtkIGSIORecursiveCriticalSection> igtlClientsMutexGuardedLock(this->IgtlClientsMutex);
-    if (this->NewClientConnected)
+    // Cached messages are only valid for the current frame
+    this->IgtlMessageFactory->ClearMessageCache();
+
+    // Update transform repository with the tracked frame, once for all the clients. The transforms are set in a new snapshot,
+    // so the commands can read the transform repository meanwhile, and all the messages of the frame are packed from this snapshot.
+    vtkSmartPointer<vtkIGSIOTransformRepository> transformRepository;
+    if (this->TransformRepository.GetSnapshot() != NULL)
     {
-      for (std::list<ClientData>::iterator clientIterator = this->IgtlClients.begin(); clientIterator != this->IgtlClients.end(); ++clientIterator)
+      vtkPlusIgtlMessageFactory* messageFactory = this->IgtlMessageFactory;
+      PlusStatus status = this->TransformRepository.Update([messageFactory, &trackedFrame](vtkIGSIOTransformRepository* repository)
       {
-        std::vector<PlusIgtlClientInfo::VideoStream> videoStreams = (*clientIterator).ClientInfo.VideoStreams;
-        for (std::vector<PlusIgtlClientInfo::VideoStream>::iterator videoStream = videoStreams.begin(); videoStream != videoStreams.end(); ++videoStream)
-        {
-          vtkIGSIOFrameConverter* frameConverter = videoStream->FrameConverter;
-          if (frameConverter)
-          {
-            frameConverter->RequestKeyFrameOn();
-          }
-        }
+        return messageFactory->SetFrameTransforms(trackedFrame, repository);
+      }, &transformRepository);
+      if (status != PLUS_SUCCESS)
+      {
+        numberOfErrors++;
       }
     }
-    this->NewClientConnected = false;
+
+    // Messages that are requested by multiple local clients are written into shared memory only once
+    std::map<igtl::MessageBase*, igtl::MessageBase::Pointer> sharedMemoryFrameMessages;
 
     for (std::list<ClientData>::iterator clientIterator = this->IgtlClients.begin(); clientIterator != this->IgtlClients.end(); ++clientIterator)
     {
-      igtl::ClientSocket::Pointer clientSocket = (*clientIterator).ClientSocket;
+      if (clientIterator->SendFailed)
+      {
+        disconnectedClientIds.push_back(clientIterator->ClientId);
+        continue;
+      }
 
       // Create IGT messages
       std::vector<igtl::MessageBase::Pointer> igtlMessages;
       std::vector<igtl::MessageBase::Pointer>::iterator igtlMessageIterator;
 
-      if (this->IgtlMessageFactory->PackMessages(clientIterator->ClientId, clientIterator->ClientInfo, igtlMessages, trackedFrame, this->SendValidTransformsOnly, this->TransformRepository) != PLUS_SUCCESS)
+      double packingStartTime = vtkIGSIOAccurateTimer::GetSystemTime();
+      // Tracking messages are sent by the tracking data sender thread if it is running
+      if (this->IgtlMessageFactory->PackMessages(clientIterator->ClientId, clientIterator->ClientInfo, igtlMessages, trackedFrame, this->SendValidTransformsOnly, transformRepository,
+          clientIterator->SendQueue->GetNumberOfMessages(),
+          (this->TrackingDataSenderThreadId >= 0 ? vtkPlusIgtlMessageFactory::NON_TRACKING_MESSAGES : vtkPlusIgtlMessageFactory::ALL_MESSAGES)) != PLUS_SUCCESS)
       {
         LOG_WARNING("Failed to pack all IGT messages");
       }
+      PlusTelemetry::Instance()->AddSampleSince(PlusTelemetry::STAGE_PACKING, packingStartTime);
+      if (this->IgtlMessageFactory->GetLastVideoEncodingTimeSec() > 0.0)
+      {
+        PlusTelemetry::Instance()->AddSample(PlusTelemetry::STAGE_ENCODING, this->IgtlMessageFactory->GetLastVideoEncodingTimeSec());
+      }
 
-      // Send all messages to a client
+      // Queue all messages of the frame for the client at once, they are sent by the client's data sender thread,
+      // so a slow client does not delay the other clients
       for (igtlMessageIterator = igtlMessages.begin(); igtlMessageIterator != igtlMessages.end(); ++igtlMessageIterator)
       {
         igtl::MessageBase::Pointer igtlMessage = (*igtlMessageIterator);
@@ -1067,22 +1634,42 @@ PlusStatus vtkPlusOpenIGTLinkServer::SendTrackedFrame(igsioTrackedFrame& tracked
           continue;
         }
 
-        int retValue = 0;
-        RETRY_UNTIL_TRUE((retValue = clientSocket->Send(igtlMessage->GetBufferPointer(), igtlMessage->GetBufferSize())) != 0, this->NumberOfRetryAttempts, this->DelayBetweenRetryAttemptsSec);
-        if (retValue == 0)
+        if (this->SharedMemoryTransportEnabled && clientIterator->LocalClient && clientIterator->ClientInfo.SharedMemoryTransportRequested
+            && dynamic_cast<igtl::ImageMessage*>(igtlMessage.GetPointer()) != NULL)
         {
-          disconnectedClientIds.push_back(clientIterator->ClientId);
-          igtl::TimeStamp::Pointer ts = igtl::TimeStamp::New();
-          igtlMessage->GetTimeStamp(ts);
-          LOG_INFO("Client disconnected - could not send " << igtlMessage->GetMessageType() << " message to client (device name: " << igtlMessage->GetDeviceName()
-                   << "  Timestamp: " << std::fixed << ts->GetTimeStamp() << ").");
-          break;
+          (*igtlMessageIterator) = this->CreateSharedMemoryFrameMessage(igtlMessage, sharedMemoryFrameMessages);
         }
 
         // Update the TDATA timestamp, even if TDATA isn't sent (cheaper than checking for existing TDATA message type)
         clientIterator->ClientInfo.SetLastTDATASentTimeStamp(trackedFrame.GetTimestamp());
       }
+      int numberOfDroppedMessages = clientIterator->SendQueue->Push(igtlMessages, this->DataDropPolicy);
+      if (numberOfDroppedMessages > 0)
+      {
+        LOG_TRACE("Send queue of client " << clientIterator->ClientId << " is full, " << numberOfDroppedMessages << " messages dropped");
+      }
+    }
+
+    // Multicast the tracking data once for all subscribers, cached messages of the clients are reused
+    if (this->MulticastSender.IsOpen() && this->TrackingDataSenderThreadId < 0)
+    {
+      std::vector<igtl::MessageBase::Pointer> multicastMessages;
+      if (this->IgtlMessageFactory->PackMessages(MULTICAST_CLIENT_ID, this->MulticastClientInfo, multicastMessages, trackedFrame, this->SendValidTransformsOnly, transformRepository) != PLUS_SUCCESS)
+      {
+        LOG_WARNING("Failed to pack all multicast IGT messages");
+      }
+      for (std::vector<igtl::MessageBase::Pointer>::iterator messageIterator = multicastMessages.begin(); messageIterator != multicastMessages.end(); ++messageIterator)
+      {
+        if (messageIterator->IsNotNull())
+        {
+          this->MulticastSender.Send(*messageIterator);
+        }
+      }
+      this->MulticastClientInfo.SetLastTDATASentTimeStamp(trackedFrame.GetTimestamp());
     }
+
+    // Release the message buffers
+    this->IgtlMessageFactory->ClearMessageCache();
   }
 
   // Clean up disconnected clients
@@ -1097,6 +1684,115 @@ PlusStatus vtkPlusOpenIGTLinkServer::SendTrackedFrame(igsioTrackedFrame& tracked
   return (numberOfErrors == 0 ? PLUS_SUCCESS : PLUS_FAIL);
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusOpenIGTLinkServer::SendTrackingFrame(igsioTrackedFrame& trackedFrame, vtkIGSIOTransformRepository* transformRepository)
+{
+  int numberOfErrors = 0;
+
+  // Convert relative timestamp to UTC
+  trackedFrame.SetTimestamp(vtkIGSIOAccurateTimer::GetUniversalTimeFromSystemTime(trackedFrame.GetTimestamp()));
+
+  {
+    // Lock before we send message to the clients, this also serializes use of the message factory with the data sender thread
+    igsioLockGuard<vtkIGSIORecursiveCriticalSection> igtlClientsMutexGuardedLock(this->IgtlClientsMutex);
+    this->IgtlMessageFactory->ClearMessageCache();
+
+    for (std::list<ClientData>::iterator clientIterator = this->IgtlClients.begin(); clientIterator != this->IgtlClients.end(); ++clientIterator)
+    {
+      if (clientIterator->SendFailed)
+      {
+        // Disconnected by the data sender thread
+        continue;
+      }
+
+      std::vector<igtl::MessageBase::Pointer> igtlMessages;
+      if (this->IgtlMessageFactory->PackMessages(clientIterator->ClientId, clientIterator->ClientInfo, igtlMessages, trackedFrame, this->SendValidTransformsOnly, transformRepository,
+          0, vtkPlusIgtlMessageFactory::TRACKING_MESSAGES) != PLUS_SUCCESS)
+      {
+        LOG_WARNING("Failed to pack all IGT tracking messages");
+        numberOfErrors++;
+      }
+      if (clientIterator->SendQueue->Push(igtlMessages, this->DataDropPolicy) > 0)
+      {
+        LOG_TRACE("Send queue of client " << clientIterator->ClientId << " is full, tracking messages dropped");
+      }
+      clientIterator->ClientInfo.SetLastTDATASentTimeStamp(trackedFrame.GetTimestamp());
+    }
+
+    if (this->MulticastSender.IsOpen())
+    {
+      std::vector<igtl::MessageBase::Pointer> multicastMessages;
+      if (this->IgtlMessageFactory->PackMessages(MULTICAST_CLIENT_ID, this->MulticastClientInfo, multicastMessages, trackedFrame, this->SendValidTransformsOnly, transformRepository) != PLUS_SUCCESS)
+      {
+        LOG_WARNING("Failed to pack all multicast IGT messages");
+        numberOfErrors++;
+      }
+      for (std::vector<igtl::MessageBase::Pointer>::iterator messageIterator = multicastMessages.begin(); messageIterator != multicastMessages.end(); ++messageIterator)
+      {
+        if (messageIterator->IsNotNull())
+        {
+          this->MulticastSender.Send(*messageIterator);
+        }
+      }
+      this->MulticastClientInfo.SetLastTDATASentTimeStamp(trackedFrame.GetTimestamp());
+    }
+
+    // The cached messages must not be reused for the next video frame
+    this->IgtlMessageFactory->ClearMessageCache();
+  }
+
+  return (numberOfErrors == 0 ? PLUS_SUCCESS : PLUS_FAIL);
+}
+
+//----------------------------------------------------------------------------
+igtl::MessageBase::Pointer vtkPlusOpenIGTLinkServer::CreateSharedMemoryFrameMessage(igtl::MessageBase::Pointer message, std::map<igtl::MessageBase*, igtl::MessageBase::Pointer>& writtenMessages)
+{
+  std::map<igtl::MessageBase*, igtl::MessageBase::Pointer>::iterator writtenMessage = writtenMessages.find(message.GetPointer());
+  if (writtenMessage != writtenMessages.end())
+  {
+    return writtenMessage->second;
+  }
+
+  size_t messageSize = static_cast<size_t>(message->GetBufferSize());
+  std::shared_ptr<PlusSharedMemoryFrameRing>& ring = this->SharedMemoryRings[message->GetDeviceName()];
+  if (!ring || ring->GetSlotSizeInBytes() < messageSize)
+  {
+    // Create the ring with some margin, so that it does not have to be recreated for small changes of the message size
+    std::ostringstream ringName;
+    ringName << "PlusServer" << this->ListeningPort << "_" << ++this->SharedMemoryRingCounter;
+    ring = std::make_shared<PlusSharedMemoryFrameRing>();
+    if (ring->Create(ringName.str(), std::max(this->SharedMemoryRingSize, 2), messageSize + messageSize / 4) != PLUS_SUCCESS)
+    {
+      LOG_WARNING("Unable to create shared memory ring for " << message->GetDeviceName() << " messages, they are sent on the socket");
+      ring.reset();
+      writtenMessages[message.GetPointer()] = message;
+      return message;
+    }
+    LOG_DEBUG("Created shared memory ring " << ringName.str() << " for " << message->GetDeviceName() << " messages");
+  }
+
+  igtl_uint64 sequenceNumber = 0;
+  if (ring->Write(message->GetBufferPointer(), messageSize, sequenceNumber) != PLUS_SUCCESS)
+  {
+    writtenMessages[message.GetPointer()] = message;
+    return message;
+  }
+
+  igtl::PlusSharedMemoryFrameMessage::Pointer frameMessage = igtl::PlusSharedMemoryFrameMessage::New();
+  frameMessage->SetHeaderVersion(message->GetHeaderVersion());
+  frameMessage->SetDeviceName(message->GetDeviceName());
+  igtl::TimeStamp::Pointer timestamp = igtl::TimeStamp::New();
+  message->GetTimeStamp(timestamp);
+  frameMessage->SetTimeStamp(timestamp);
+  frameMessage->SetRingName(ring->GetName());
+  frameMessage->SetSequenceNumber(sequenceNumber);
+  frameMessage->SetMessageSizeInBytes(static_cast<igtl_uint32>(messageSize));
+  frameMessage->Pack();
+
+  writtenMessages[message.GetPointer()] = frameMessage.GetPointer();
+  return frameMessage.GetPointer();
+}
+
 //----------------------------------------------------------------------------
 void vtkPlusOpenIGTLinkServer::DisconnectClient(int clientId)
 {
@@ -1111,17 +1807,23 @@ void vtkPlusOpenIGTLinkServer::DisconnectClient(int clientId)
         continue;
       }
       clientIterator->DataReceiverActive.first = false;
+      clientIterator->DataSenderActive.first = false;
+      if (clientIterator->SendQueue)
+      {
+        // Discard unsent messages and wake up the data sender thread
+        clientIterator->SendQueue->Close();
+      }
       break;
     }
   }
 
-  // Wait for the thread to stop
-  bool clientDataReceiverThreadStillActive = false;
+  // Wait for the threads to stop
+  bool clientThreadsStillActive = false;
   do
   {
-    clientDataReceiverThreadStillActive = false;
+    clientThreadsStillActive = false;
     {
-      // check if any of the receiver threads are still active
+      // check if the receiver or sender thread of the client is still active
       igsioLockGuard<vtkIGSIORecursiveCriticalSection> igtlClientsMutexGuardedLock(this->IgtlClientsMutex);
       for (std::list<ClientData>::iterator clientIterator = this->IgtlClients.begin(); clientIterator != this->IgtlClients.end(); ++clientIterator)
       {
@@ -1129,29 +1831,31 @@ void vtkPlusOpenIGTLinkServer::DisconnectClient(int clientId)
         {
           continue;
         }
-        if (clientIterator->DataReceiverThreadId > 0)
+        if (clientIterator->DataReceiverActive.second)
         {
-          if (clientIterator->DataReceiverActive.second)
-          {
-            // thread still running
-            clientDataReceiverThreadStillActive = true;
-          }
-          else
-          {
-            // thread stopped
-            clientIterator->DataReceiverThreadId = -1;
-          }
-          break;
+          // receiver thread still running or the client receiver event loop has not released the client yet
+          clientThreadsStillActive = true;
+        }
+        else
+        {
+          // thread stopped
+          clientIterator->DataReceiverThreadId = -1;
+        }
+        if (clientIterator->DataSenderActive.second)
+        {
+          // sender thread still running
+          clientThreadsStillActive = true;
         }
+        break;
       }
     }
-    if (clientDataReceiverThreadStillActive)
+    if (clientThreadsStillActive)
     {
       // give some time for the threads to finish
       vtkIGSIOAccurateTimer::DelayWithEventProcessing(0.2);
     }
   }
-  while (clientDataReceiverThreadStillActive);
+  while (clientThreadsStillActive);
 
   // Close socket and remove client from the list
   int port = 0;
@@ -1172,9 +1876,12 @@ void vtkPlusOpenIGTLinkServer::DisconnectClient(int clientId)
         clientIterator->ClientSocket->CloseSocket();
       }
       this->IgtlClients.erase(clientIterator);
+      // Release the video encoders that are not used by other clients
+      this->IgtlMessageFactory->RemoveSubscriber(clientId);
       break;
     }
   }
+  this->PlusCommandProcessor->RemoveCommandSubscriptions(clientId);
 
   LOG_INFO("Client disconnected (" <<  address << ":" << port << "). Number of connected clients: " << GetNumberOfConnectedClients());
 }
@@ -1192,23 +1899,17 @@ void vtkPlusOpenIGTLinkServer::KeepAlive()
 
     for (std::list<ClientData>::iterator clientIterator = this->IgtlClients.begin(); clientIterator != this->IgtlClients.end(); ++clientIterator)
     {
-      igtl::StatusMessage::Pointer replyMsg = igtl::StatusMessage::New();
-      replyMsg->SetCode(igtl::StatusMessage::STATUS_OK);
-      replyMsg->Pack();
-
-      int retValue = 0;
-      RETRY_UNTIL_TRUE(
-        (retValue = clientIterator->ClientSocket->Send(replyMsg->GetPackPointer(), replyMsg->GetPackSize())) != 0,
-        this->NumberOfRetryAttempts, this->DelayBetweenRetryAttemptsSec);
-      if (retValue == 0)
+      if (clientIterator->SendFailed)
       {
+        // The client's data sender thread could not send the last message
         disconnectedClientIds.push_back(clientIterator->ClientId);
-        igtl::TimeStamp::Pointer ts = igtl::TimeStamp::New();
-        replyMsg->GetTimeStamp(ts);
-
-        LOG_DEBUG("Client disconnected - could not send " << replyMsg->GetMessageType() << " message to client (device name: " << replyMsg->GetDeviceName()
-                  << "  Timestamp: " << std::fixed <<  ts->GetTimeStamp() << ").");
+        continue;
       }
+
+      igtl::StatusMessage::Pointer replyMsg = igtl::StatusMessage::New();
+      replyMsg->SetCode(igtl::StatusMessage::STATUS_OK);
+      replyMsg->Pack();
+      clientIterator->SendQueue->Push(replyMsg.GetPointer(), PlusIgtlClientSendQueue::DROP_OLDEST);
     } // clientIterator
   } // unlock client list
 
@@ -1219,6 +1920,24 @@ void vtkPlusOpenIGTLinkServer::KeepAlive()
   }
 }
 
+//------------------------------------------------------------------------------
+void vtkPlusOpenIGTLinkServer::SetTransformRepository(vtkIGSIOTransformRepository* transformRepository)
+{
+  this->TransformRepository.Reset(transformRepository);
+}
+
+//------------------------------------------------------------------------------
+vtkSmartPointer<vtkIGSIOTransformRepository> vtkPlusOpenIGTLinkServer::GetTransformRepository() const
+{
+  return this->TransformRepository.GetSnapshot();
+}
+
+//------------------------------------------------------------------------------
+PlusStatus vtkPlusOpenIGTLinkServer::UpdateTransformRepository(const PlusSharedTransformRepository::UpdateFunction& update)
+{
+  return this->TransformRepository.Update(update);
+}
+
 //------------------------------------------------------------------------------
 unsigned int vtkPlusOpenIGTLinkServer::GetNumberOfConnectedClients() const
 {
@@ -1227,6 +1946,26 @@ unsigned int vtkPlusOpenIGTLinkServer::GetNumberOfConnectedClients() const
   return this->IgtlClients.size();
 }
 
+//------------------------------------------------------------------------------
+void vtkPlusOpenIGTLinkServer::GetClientSendStatistics(std::map<int, std::string>& clientStatistics) const
+{
+  clientStatistics.clear();
+  igsioLockGuard<vtkIGSIORecursiveCriticalSection> igtlClientsMutexGuardedLock(this->IgtlClientsMutex);
+  for (std::list<ClientData>::const_iterator clientIterator = this->IgtlClients.begin(); clientIterator != this->IgtlClients.end(); ++clientIterator)
+  {
+    std::ostringstream ss;
+    if (clientIterator->SendLatency)
+    {
+      ss << clientIterator->SendLatency->GetStatisticsString();
+    }
+    if (clientIterator->SendQueue)
+    {
+      ss << " Queued=" << clientIterator->SendQueue->GetNumberOfMessages() << " Dropped=" << clientIterator->SendQueue->GetNumberOfDroppedMessages();
+    }
+    clientStatistics[clientIterator->ClientId] = ss.str();
+  }
+}
+
 //------------------------------------------------------------------------------
 PlusStatus vtkPlusOpenIGTLinkServer::GetClientInfo(unsigned int clientId, PlusIgtlClientInfo& outClientInfo) const
 {
@@ -1256,7 +1995,17 @@ PlusStatus vtkPlusOpenIGTLinkServer::ReadConfiguration(vtkXMLDataElement* server
   this->SetConfigFilename(aFilename);
 
   XML_READ_SCALAR_ATTRIBUTE_REQUIRED(int, ListeningPort, serverElement);
-  XML_READ_STRING_ATTRIBUTE_REQUIRED(OutputChannelId, serverElement);
+  XML_READ_STRING_ATTRIBUTE_OPTIONAL(RelayServerHost, serverElement);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, RelayServerPort, serverElement);
+  if (this->RelayServerHost.empty())
+  {
+    XML_READ_STRING_ATTRIBUTE_REQUIRED(OutputChannelId, serverElement);
+  }
+  else
+  {
+    // The data is received from the primary server, the output channel is not used
+    XML_READ_STRING_ATTRIBUTE_OPTIONAL(OutputChannelId, serverElement);
+  }
   XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, MissingInputGracePeriodSec, serverElement);
   XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, MaxTimeSpentWithProcessingMs, serverElement);
   XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, MaxNumberOfIgtlMessagesToSend, serverElement);
@@ -1286,6 +2035,65 @@ PlusStatus vtkPlusOpenIGTLinkServer::ReadConfiguration(vtkXMLDataElement* server
 
   XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(float, DefaultClientSendTimeoutSec, serverElement);
   XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(float, DefaultClientReceiveTimeoutSec, serverElement);
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(DefaultClientTcpNoDelay, serverElement);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, DefaultClientSendBufferSizeBytes, serverElement);
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(DefaultClientBatchedSendEnabled, serverElement);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, MaxNumberOfQueuedMessagesPerClient, serverElement);
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(ClientReceiveEventLoopEnabled, serverElement);
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(SharedMemoryTransportEnabled, serverElement);
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(HighRateTrackingEnabled, serverElement);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, SharedMemoryRingSize, serverElement);
+
+  XML_READ_STRING_ATTRIBUTE_OPTIONAL(MulticastAddress, serverElement);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, MulticastPort, serverElement);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, MulticastTimeToLive, serverElement);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, CommandWorkerThreads, serverElement);
+  XML_READ_ENUM3_ATTRIBUTE_OPTIONAL(DataSenderThreadPriority, serverElement,
+                                    "NORMAL", PlusThreadScheduling::PRIORITY_NORMAL,
+                                    "HIGH", PlusThreadScheduling::PRIORITY_HIGH,
+                                    "REALTIME", PlusThreadScheduling::PRIORITY_REALTIME);
+  const char* dataSenderCpuAffinity = serverElement->GetAttribute("DataSenderCpuAffinity");
+  if (dataSenderCpuAffinity != NULL && PlusThreadScheduling::GetCpuIndicesFromString(dataSenderCpuAffinity, this->DataSenderCpuAffinity) != PLUS_SUCCESS)
+  {
+    LOG_WARNING("Invalid DataSenderCpuAffinity attribute: '" << dataSenderCpuAffinity << "', the data sender threads will not be bound to processor cores");
+  }
+  if (!this->MulticastAddress.empty())
+  {
+    // The same transforms as for the clients are multicast, unless a separate selection is specified
+    this->MulticastClientInfo = this->DefaultClientInfo;
+    vtkXMLDataElement* multicastClientInfo = serverElement->FindNestedElementWithName("MulticastClientInfo");
+    if (multicastClientInfo != NULL && this->MulticastClientInfo.SetClientInfoFromXmlData(multicastClientInfo) != PLUS_SUCCESS)
+    {
+      return PLUS_FAIL;
+    }
+
+    // Only tracking data messages are small enough for one datagram
+    std::vector<std::string> multicastMessageTypes;
+    for (std::vector<std::string>::iterator typeIterator = this->MulticastClientInfo.IgtlMessageTypes.begin(); typeIterator != this->MulticastClientInfo.IgtlMessageTypes.end(); ++typeIterator)
+    {
+      if (vtkPlusIgtlMessageFactory::IsTrackingMessageType(*typeIterator))
+      {
+        multicastMessageTypes.push_back(*typeIterator);
+      }
+      else
+      {
+        LOG_WARNING("Message type " << *typeIterator << " is not sent to the multicast group. Supported message types: TDATA, TRANSFORM, POSITION.");
+      }
+    }
+    this->MulticastClientInfo.IgtlMessageTypes = multicastMessageTypes;
+    this->MulticastClientInfo.ImageStreams.clear();
+    this->MulticastClientInfo.VideoStreams.clear();
+    this->MulticastClientInfo.StringNames.clear();
+    this->MulticastClientInfo.SetTDATARequested(true);
+    this->MulticastClientInfo.SetLastTDATASentTimeStamp(-1);
+  }
+
+  const char* dataDropPolicy = serverElement->GetAttribute("DataDropPolicy");
+  if (dataDropPolicy != NULL && !PlusIgtlClientSendQueue::DropPolicyFromString(dataDropPolicy, this->DataDropPolicy))
+  {
+    LOG_ERROR("Invalid DataDropPolicy attribute value: " << dataDropPolicy << ". Valid values: DropOldest, NeverDrop.");
+    return PLUS_FAIL;
+  }
 
   return PLUS_SUCCESS;
 }
@@ -1346,8 +2154,9 @@ PlusStatus vtkPlusOpenIGTLinkServer::Stop()
 }
 
 //------------------------------------------------------------------------------
-igtl::MessageBase::Pointer vtkPlusOpenIGTLinkServer::CreateIgtlMessageFromCommandResponse(vtkPlusCommandResponse* response)
+igtl::MessageBase::Pointer vtkPlusOpenIGTLinkServer::CreateIgtlMessageFromCommandResponse(vtkPlusCommandResponse* response, bool& isPacked)
 {
+  isPacked = false;
   int replyHeaderVersion = IGTL_HEADER_VERSION_1;
   PlusIgtlClientInfo info;
   if (GetClientInfo(response->GetClientId(), info) == PLUS_FAIL)
@@ -1377,6 +2186,13 @@ igtl::MessageBase::Pointer vtkPlusOpenIGTLinkServer::CreateIgtlMessageFromComman
       imageName = "PlusServerImage";
     }
 
+    if (imageResponse->GetPackedMessage().IsNotNull())
+    {
+      // The image has not changed since it was last packed, the message can be sent as is
+      isPacked = true;
+      return imageResponse->GetPackedMessage();
+    }
+
     vtkSmartPointer<vtkMatrix4x4> imageToReferenceTransform = vtkSmartPointer<vtkMatrix4x4>::New();
     if (imageResponse->GetImageToReferenceTransform() != NULL)
     {
@@ -1398,6 +2214,12 @@ igtl::MessageBase::Pointer vtkPlusOpenIGTLinkServer::CreateIgtlMessageFromComman
       LOG_ERROR("Failed to create image mesage from command response");
       return NULL;
     }
+    if (!imageResponse->GetImageVersion().empty())
+    {
+      igtlMessage->Pack();
+      isPacked = true;
+      this->PlusCommandProcessor->SetCachedImageReply(imageName, replyHeaderVersion, imageResponse->GetImageVersion(), igtlMessage.GetPointer());
+    }
     return igtlMessage.GetPointer();
   }
 
@@ -1410,6 +2232,13 @@ igtl::MessageBase::Pointer vtkPlusOpenIGTLinkServer::CreateIgtlMessageFromComman
       polydataName = "UnknownFile";
     }
 
+    if (polydataResponse->GetPackedMessage().IsNotNull())
+    {
+      // The model file has not changed since it was last packed, the message can be sent as is
+      isPacked = true;
+      return polydataResponse->GetPackedMessage();
+    }
+
     vtkSmartPointer<vtkPolyData> polyData = polydataResponse->GetPolyData();
     if (polyData == NULL)
     {
@@ -1420,12 +2249,24 @@ igtl::MessageBase::Pointer vtkPlusOpenIGTLinkServer::CreateIgtlMessageFromComman
     igtl::PolyDataMessage::Pointer igtlMessage = dynamic_cast<igtl::PolyDataMessage*>(this->IgtlMessageFactory->CreateSendMessage("POLYDATA", replyHeaderVersion).GetPointer());
     igtlMessage->SetDeviceName("PlusServer");
     igtlMessage->SetMetaDataElement("fileName", IANA_TYPE_US_ASCII, polydataName);
+    if (polydataResponse->GetNumberOfLevelsOfDetail() > 1)
+    {
+      // Clients replace the model when a finer level arrives
+      igtlMessage->SetMetaDataElement("LevelOfDetail", IANA_TYPE_US_ASCII, igsioCommon::ToString<int>(polydataResponse->GetLevelOfDetail()));
+      igtlMessage->SetMetaDataElement("NumberOfLevelsOfDetail", IANA_TYPE_US_ASCII, igsioCommon::ToString<int>(polydataResponse->GetNumberOfLevelsOfDetail()));
+    }
 
+    // PackPolyDataMessage packs the message
     if (vtkPlusIgtlMessageCommon::PackPolyDataMessage(igtlMessage, polyData, vtkIGSIOAccurateTimer::GetSystemTime()) != PLUS_SUCCESS)
     {
       LOG_ERROR("Failed to create polydata mesage from command response");
       return NULL;
     }
+    isPacked = true;
+    if (!polydataResponse->GetPolyDataVersion().empty())
+    {
+      this->PlusCommandProcessor->SetCachedPolydataReply(polydataResponse->GetReplyCacheKey(), replyHeaderVersion, polydataResponse->GetPolyDataVersion(), igtlMessage.GetPointer());
+    }
     return igtlMessage.GetPointer();
   }
 
@@ -10,6 +10,11 @@
 // Local includes
 #include "vtkPlusServerExport.h"
 #include "PlusIgtlClientInfo.h"
+#include "PlusIgtlClientSendQueue.h"
+#include "PlusIgtlMulticastSender.h"
+#include "PlusSharedMemoryFrameRing.h"
+#include "PlusSharedTransformRepository.h"
+#include "PlusTelemetry.h"
 #include "vtkPlusDataCollector.h"
 #include "vtkPlusIgtlMessageFactory.h"
 #include "vtkIGSIOTransformRepository.h"
@@ -21,6 +26,7 @@
 
 // STL includes
 #include <deque>
+#include <memory>
 
 // OS includes
 #if (_MSC_VER == 1500)
@@ -29,6 +35,7 @@
 
 // IGTL includes
 #include <igtlMessageBase.h>
+#include <igtlMessageHeader.h>
 #include <igtlServerSocket.h>
 
 //class igsioTrackedFrame; 
@@ -47,6 +54,10 @@ struct ClientData
     , ClientSocket(NULL)
     , DataReceiverActive(std::make_pair(false, false))
     , DataReceiverThreadId(-1)
+    , DataSenderActive(std::make_pair(false, false))
+    , DataSenderThreadId(-1)
+    , SendFailed(false)
+    , LocalClient(false)
     , Server(NULL)
   {
   }
@@ -62,9 +73,29 @@ struct ClientData
   uint32_t ClientSocketReceiveTimeout;
 
   /// Active flag for thread (first: request, second: respond )
+  /// In event loop mode the respond flag is cleared by the client receiver event loop thread instead.
   std::pair<bool, bool> DataReceiverActive;
   int DataReceiverThreadId;
 
+  /// IDs of recent commands, to be able to detect duplicate command IDs
+  std::deque<uint32_t> PreviousCommandIds;
+
+  /// Messages waiting to be sent to the client by the client's data sender thread
+  std::shared_ptr<PlusIgtlClientSendQueue> SendQueue;
+
+  /// Active flag for the data sender thread (first: request, second: respond )
+  std::pair<bool, bool> DataSenderActive;
+  int DataSenderThreadId;
+
+  /// Set by the data sender thread if a message could not be sent (the client has to be disconnected)
+  bool SendFailed;
+
+  /// The client is connected through the loopback interface, so it can use the shared memory transport
+  bool LocalClient;
+
+  /// Time from queuing a message for this client to the completion of the socket send
+  std::shared_ptr<PlusLatencyHistogram> SendLatency;
+
   PlusIgtlClientInfo ClientInfo;
 
   vtkPlusOpenIGTLinkServer* Server;
@@ -126,17 +157,126 @@ public:
   vtkSetMacro(DefaultClientReceiveTimeoutSec, float);
   vtkGetMacroConst(DefaultClientReceiveTimeoutSec, float);
 
+  /*! If enabled, Nagle's algorithm is disabled on the client sockets (TCP_NODELAY), so small messages are not delayed */
+  vtkSetMacro(DefaultClientTcpNoDelay, bool);
+  vtkGetMacroConst(DefaultClientTcpNoDelay, bool);
+  vtkBooleanMacro(DefaultClientTcpNoDelay, bool);
+
+  /*! Send buffer size of the client sockets (SO_SNDBUF). If not positive then the operating system default is used. */
+  vtkSetMacro(DefaultClientSendBufferSizeBytes, int);
+  vtkGetMacroConst(DefaultClientSendBufferSizeBytes, int);
+
+  /*!
+    If enabled, the data sender thread of each client sends all messages that are waiting in its queue
+    (e.g., all messages of a frame) with one gather system call instead of one call per message
+  */
+  vtkSetMacro(DefaultClientBatchedSendEnabled, bool);
+  vtkGetMacroConst(DefaultClientBatchedSendEnabled, bool);
+  vtkBooleanMacro(DefaultClientBatchedSendEnabled, bool);
+
+  /*! Maximum number of messages waiting to be sent to a client. Data messages are dropped as specified by DataDropPolicy if it is exceeded. */
+  vtkSetMacro(MaxNumberOfQueuedMessagesPerClient, int);
+  vtkGetMacroConst(MaxNumberOfQueuedMessagesPerClient, int);
+
+  /*! Drop policy of image, transform, etc. messages. Command responses are never dropped. */
+  vtkSetMacro(DataDropPolicy, PlusIgtlClientSendQueue::DropPolicy);
+  vtkGetMacroConst(DataDropPolicy, PlusIgtlClientSendQueue::DropPolicy);
+
+  /*!
+    If enabled, messages of all clients are received by one thread that waits on all client sockets at once
+    (epoll on Linux, kqueue on macOS, WSAPoll on Windows) instead of one receiver thread per client.
+    Must be set before the server is started.
+  */
+  vtkSetMacro(ClientReceiveEventLoopEnabled, bool);
+  vtkGetMacroConst(ClientReceiveEventLoopEnabled, bool);
+  vtkBooleanMacro(ClientReceiveEventLoopEnabled, bool);
+
+  /*!
+    If enabled, IMAGE messages for clients on the same host that request it in their client info are written into
+    a shared memory ring and only a SHMFRAME notification is sent on the socket (see PlusSharedMemoryFrameRing)
+  */
+  vtkSetMacro(SharedMemoryTransportEnabled, bool);
+  vtkGetMacroConst(SharedMemoryTransportEnabled, bool);
+  vtkBooleanMacro(SharedMemoryTransportEnabled, bool);
+
+  /*! Number of messages kept in each shared memory ring. A notification that is queued longer than this many frames cannot be read. */
+  vtkSetMacro(SharedMemoryRingSize, int);
+  vtkGetMacroConst(SharedMemoryRingSize, int);
+
+  /*!
+    If not empty, the TDATA, TRANSFORM and POSITION messages selected by the multicast client info are also sent
+    as UDP datagrams to this IPv4 multicast group (see PlusIgtlMulticastSender). Must be set before the server is started.
+  */
+  vtkSetStdStringMacro(MulticastAddress);
+  vtkGetStdStringMacro(MulticastAddress);
+
+  vtkSetMacro(MulticastPort, int);
+  vtkGetMacroConst(MulticastPort, int);
+
+  /*! Number of routers the multicast datagrams may pass, 1 keeps them in the local network */
+  vtkSetMacro(MulticastTimeToLive, int);
+  vtkGetMacroConst(MulticastTimeToLive, int);
+
+  /*!
+    If enabled and the broadcast channel has both video and tool data, then TRANSFORM, POSITION and TDATA messages
+    are sent by a separate thread for each new sample of the tracker (read directly from the tool buffers),
+    instead of once per video frame. Images are still sent at the video rate. Must be set before the server is started.
+  */
+  vtkSetMacro(HighRateTrackingEnabled, bool);
+  vtkGetMacroConst(HighRateTrackingEnabled, bool);
+  vtkBooleanMacro(HighRateTrackingEnabled, bool);
+
+  /*!
+    Number of threads that execute the received commands. If 0 then the commands are executed by ProcessPendingCommands
+    (called from the main thread). Otherwise lightweight commands (e.g., GetTransform) are executed by an additional fast lane
+    thread, so that they are not delayed by long-running commands. Must be set before the server is started.
+  */
+  vtkSetMacro(CommandWorkerThreads, int);
+  vtkGetMacroConst(CommandWorkerThreads, int);
+
+  /*! Scheduling priority of the data sender threads (DataSenderThreadPriority attribute: NORMAL, HIGH, REALTIME). Must be set before the server is started. */
+  vtkSetMacro(DataSenderThreadPriority, PlusThreadScheduling::ThreadPriority);
+  vtkGetMacroConst(DataSenderThreadPriority, PlusThreadScheduling::ThreadPriority);
+
+  /*! Processor cores that the data sender threads are bound to (DataSenderCpuAffinity attribute, e.g., "1"). Not bound if empty. Must be set before the server is started. */
+  void SetDataSenderCpuAffinity(const std::vector<int>& cpuAffinity) { this->DataSenderCpuAffinity = cpuAffinity; }
+  const std::vector<int>& GetDataSenderCpuAffinity() const { return this->DataSenderCpuAffinity; }
+
+  /*!
+    If not empty, the server runs in relay mode: it connects to the primary PlusServer at this host as a client,
+    requests the data of its DefaultClientInfo once, and forwards the received messages to its own clients as they are
+    (without unpacking and packing them again). Data of the local data collector is not broadcast in relay mode.
+    Commands of the clients are still executed by this server. Must be set before the server is started.
+  */
+  vtkSetStdStringMacro(RelayServerHost);
+  vtkGetStdStringMacro(RelayServerHost);
+  /*! Listening port of the primary PlusServer in relay mode */
+  vtkSetMacro(RelayServerPort, int);
+  vtkGetMacroConst(RelayServerPort, int);
+
   /*! Set data collector instance */
   vtkSetMacro(DataCollector, vtkPlusDataCollector*);
   vtkGetMacroConst(DataCollector, vtkPlusDataCollector*);
 
-  /*! Set transform repository instance */
-  vtkSetMacro(TransformRepository, vtkIGSIOTransformRepository*);
-  vtkGetMacroConst(TransformRepository, vtkIGSIOTransformRepository*);
+  /*!
+    Set transform repository instance. The server keeps a copy, which is shared between the server threads and the
+    commands as immutable snapshots (see PlusSharedTransformRepository).
+  */
+  void SetTransformRepository(vtkIGSIOTransformRepository* transformRepository);
+  /*! Get the current snapshot of the transform repository. The snapshot must not be modified, use UpdateTransformRepository instead. */
+  vtkSmartPointer<vtkIGSIOTransformRepository> GetTransformRepository() const;
+  /*! Modify the transform repository copy-on-write, the frames that are being sent keep using the previous snapshot */
+  PlusStatus UpdateTransformRepository(const PlusSharedTransformRepository::UpdateFunction& update);
 
   /*! Get number of connected clients */
   virtual unsigned int GetNumberOfConnectedClients() const;
 
+  /*! Get send latency and queue statistics of each connected client, as a human-readable string for each client ID */
+  virtual void GetClientSendStatistics(std::map<int, std::string>& clientStatistics) const;
+
+  /*! Time needed to process one frame in the latest recording round (in milliseconds) */
+  vtkGetMacroConst(LastProcessingTimePerFrameMs, int);
+
   /*! Retrieve a COPY of client info for a given clientId
     Locks access to the client info for the duration of the function
     */
@@ -181,14 +321,42 @@ protected:
   /*! Process the command replies queue and send messages */
   static PlusStatus SendCommandResponses(vtkPlusOpenIGTLinkServer& self);
 
+  /*! Thread for receiving the messages of the primary server and forwarding them to the clients, if RelayServerHost is set */
+  static void* RelayReceiverThread(vtkMultiThreader::ThreadInfo* data);
+
+  /*! Queue a packed message received from the primary server for all clients that accept its message type */
+  void RelayMessage(igtl::MessageBase::Pointer message);
+
+  /*! Thread for sending tool poses to clients at the tracker rate, if HighRateTrackingEnabled is set */
+  static void* TrackingDataSenderThread(vtkMultiThreader::ThreadInfo* data);
+
   /*! Thread for receiving control data from clients */
   static void* DataReceiverThread(vtkMultiThreader::ThreadInfo* data);
 
+  /*! Thread for receiving control data from all clients, if ClientReceiveEventLoopEnabled is set */
+  static void* ClientReceiverEventLoopThread(vtkMultiThreader::ThreadInfo* data);
+
+  /*!
+    Receive one message from the client and process it
+    \param messageReceived Set to false if no message header could be received (e.g., receive timeout)
+    \return PLUS_FAIL if the message could not be read from the socket, receiving from the client should be stopped
+  */
+  static PlusStatus ReceiveClientMessage(ClientData* client, igtl::MessageHeader::Pointer headerMsg, bool& messageReceived);
+
+  /*! Thread for sending the queued messages to one client */
+  static void* ClientDataSenderThread(vtkMultiThreader::ThreadInfo* data);
+
   /*! Tracked frame interface, sends the selected message type and data to all clients */
   virtual PlusStatus SendTrackedFrame(igsioTrackedFrame& trackedFrame);
 
-  /*! Converts a command response to an OpenIGTLink message that can be sent to the client */
-  igtl::MessageBase::Pointer CreateIgtlMessageFromCommandResponse(vtkPlusCommandResponse* response);
+  /*! Sends the tracking messages (TRANSFORM, POSITION, TDATA) of a frame that only contains tool transforms to all clients */
+  virtual PlusStatus SendTrackingFrame(igsioTrackedFrame& trackedFrame, vtkIGSIOTransformRepository* transformRepository);
+
+  /*!
+    Converts a command response to an OpenIGTLink message that can be sent to the client
+    \param isPacked Set to true if the returned message is already packed (it is shared with other replies and must not be modified)
+  */
+  igtl::MessageBase::Pointer CreateIgtlMessageFromCommandResponse(vtkPlusCommandResponse* response, bool& isPacked);
 
   /*! Send status message to clients to keep alive the connection */
   virtual void KeepAlive();
@@ -196,6 +364,12 @@ protected:
   /*! Stops client's data receiving thread, closes the socket, and removes the client from the client list */
   void DisconnectClient(int clientId);
 
+  /*!
+    Write the packed message into the shared memory ring of its stream and return the notification message for local clients.
+    Messages already written for other clients are looked up in writtenMessages. Returns the message itself if it cannot be written.
+  */
+  igtl::MessageBase::Pointer CreateSharedMemoryFrameMessage(igtl::MessageBase::Pointer message, std::map<igtl::MessageBase*, igtl::MessageBase::Pointer>& writtenMessages);
+
   /*! Set IGTL CRC check flag (0: disabled, 1: enabled) */
   vtkSetMacro(IgtlMessageCrcCheckEnabled, bool);
   /*! Get IGTL CRC check flag (0: disabled, 1: enabled) */
@@ -228,8 +402,8 @@ private:
   /*! IGTL server socket */
   igtl::ServerSocket::Pointer ServerSocket;
 
-  /*! Transform repository instance */
-  vtkSmartPointer<vtkIGSIOTransformRepository> TransformRepository;
+  /*! Transform repository, each sent video frame publishes a new snapshot with the transforms of the frame */
+  PlusSharedTransformRepository TransformRepository;
 
   /*! Data collector instance */
   vtkSmartPointer<vtkPlusDataCollector> DataCollector;
@@ -265,10 +439,16 @@ private:
   };
   ThreadFlags ConnectionActive;
   ThreadFlags DataSenderActive;
+  ThreadFlags ClientReceiverEventLoopActive;
+  ThreadFlags TrackingDataSenderActive;
+  ThreadFlags RelayReceiverActive;
 
   // Thread IDs
   int ConnectionReceiverThreadId;
   int DataSenderThreadId;
+  int ClientReceiverEventLoopThreadId;
+  int TrackingDataSenderThreadId;
+  int RelayReceiverThreadId;
 
   /*! List of connected clients */
   std::list<ClientData> IgtlClients;
@@ -300,6 +480,51 @@ private:
   float DefaultClientSendTimeoutSec;
   float DefaultClientReceiveTimeoutSec;
 
+  /*! Socket options of the clients */
+  bool DefaultClientTcpNoDelay;
+  int DefaultClientSendBufferSizeBytes;
+  bool DefaultClientBatchedSendEnabled;
+
+  /*! Maximum number of messages in the send queue of each client */
+  int MaxNumberOfQueuedMessagesPerClient;
+
+  /*! Drop policy of data messages in the client send queues */
+  PlusIgtlClientSendQueue::DropPolicy DataDropPolicy;
+
+  /*! Receive messages of all clients on one event loop thread */
+  bool ClientReceiveEventLoopEnabled;
+
+  /*! Shared memory transport for clients on the same host */
+  bool SharedMemoryTransportEnabled;
+  int SharedMemoryRingSize;
+
+  /*! Shared memory rings by the device name of the message stream, only accessed by the data sender thread */
+  std::map<std::string, std::shared_ptr<PlusSharedMemoryFrameRing> > SharedMemoryRings;
+
+  /*! Counter to generate unique shared memory ring names, rings are recreated with a new name if the frame size grows */
+  int SharedMemoryRingCounter;
+
+  /*! Send tool poses at the tracker rate on a separate thread */
+  bool HighRateTrackingEnabled;
+
+  /*! Number of command processor worker threads, 0 if commands are executed from the main thread */
+  int CommandWorkerThreads;
+
+  /*! Scheduling of the data sender and tracking data sender threads */
+  PlusThreadScheduling::ThreadPriority DataSenderThreadPriority;
+  std::vector<int> DataSenderCpuAffinity;
+
+  /*! Multicast output of tracking data, only accessed by the data sender thread (or the tracking data sender thread if it is running) */
+  std::string MulticastAddress;
+  int MulticastPort;
+  int MulticastTimeToLive;
+  PlusIgtlClientInfo MulticastClientInfo;
+  PlusIgtlMulticastSender MulticastSender;
+
+  /*! Primary server of the relay mode, only used if the host is not empty */
+  std::string RelayServerHost;
+  int RelayServerPort;
+
   /*! Flag for IGTL CRC check */
   bool IgtlMessageCrcCheckEnabled;
 
@@ -332,8 +557,6 @@ private:
   static int ClientIdCounter;
 
   static const float CLIENT_SOCKET_TIMEOUT_SEC;
-
-  bool NewClientConnected;
 };
 
 #endif
\ No newline at end of file
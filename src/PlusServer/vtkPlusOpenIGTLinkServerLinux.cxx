@@ -2,6 +2,16 @@
 #include <sys/socket.h>
 #include <ifaddrs.h>
 #include <stdio.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+#include <cerrno>
+#include <algorithm>
+#include <climits>
+#include <set>
 
 void PrintServerInfo(vtkPlusOpenIGTLinkServer* self)
 {
@@ -35,4 +45,167 @@ void PrintServerInfo(vtkPlusOpenIGTLinkServer* self)
   }
   ss << " -- port " << self->GetListeningPort();
   LOG_INFO(ss.str());
-}
\ No newline at end of file
+}
+
+//----------------------------------------------------------------------------
+/*! Waits until data is available on any of the client sockets, used by the client receiver event loop of the server (epoll based) */
+class ClientSocketPoller
+{
+public:
+  ClientSocketPoller();
+  ~ClientSocketPoller();
+
+  /*! Set the descriptors of the sockets to wait for */
+  void SetSocketDescriptors(const std::set<int>& socketDescriptors);
+
+  /*! Wait until at least one of the sockets is readable (or the peer closed the connection) or the timeout expires */
+  PlusStatus Wait(int timeoutMs, std::vector<int>& readableSocketDescriptors);
+
+private:
+  int EpollDescriptor;
+  std::set<int> SocketDescriptors;
+};
+
+//----------------------------------------------------------------------------
+ClientSocketPoller::ClientSocketPoller()
+  : EpollDescriptor(epoll_create1(EPOLL_CLOEXEC))
+{
+  if (this->EpollDescriptor < 0)
+  {
+    LOG_ERROR("Unable to create epoll instance: " << strerror(errno));
+  }
+}
+
+//----------------------------------------------------------------------------
+ClientSocketPoller::~ClientSocketPoller()
+{
+  if (this->EpollDescriptor >= 0)
+  {
+    close(this->EpollDescriptor);
+  }
+}
+
+//----------------------------------------------------------------------------
+void ClientSocketPoller::SetSocketDescriptors(const std::set<int>& socketDescriptors)
+{
+  for (std::set<int>::iterator it = this->SocketDescriptors.begin(); it != this->SocketDescriptors.end(); ++it)
+  {
+    if (socketDescriptors.find(*it) == socketDescriptors.end())
+    {
+      // Fails with ENOENT if the socket has been closed already, which removes it from the epoll set anyway
+      epoll_ctl(this->EpollDescriptor, EPOLL_CTL_DEL, *it, NULL);
+    }
+  }
+  for (std::set<int>::const_iterator it = socketDescriptors.begin(); it != socketDescriptors.end(); ++it)
+  {
+    if (this->SocketDescriptors.find(*it) == this->SocketDescriptors.end())
+    {
+      struct epoll_event event;
+      memset(&event, 0, sizeof(event));
+      // Level triggered, so that sockets with more than one pending message are reported again
+      event.events = EPOLLIN | EPOLLRDHUP;
+      event.data.fd = *it;
+      if (epoll_ctl(this->EpollDescriptor, EPOLL_CTL_ADD, *it, &event) != 0 && errno != EEXIST)
+      {
+        LOG_ERROR("Unable to add client socket " << *it << " to epoll instance: " << strerror(errno));
+      }
+    }
+  }
+  this->SocketDescriptors = socketDescriptors;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus ClientSocketPoller::Wait(int timeoutMs, std::vector<int>& readableSocketDescriptors)
+{
+  readableSocketDescriptors.clear();
+  if (this->EpollDescriptor < 0)
+  {
+    return PLUS_FAIL;
+  }
+
+  struct epoll_event events[64];
+  int numberOfEvents = epoll_wait(this->EpollDescriptor, events, 64, timeoutMs);
+  if (numberOfEvents < 0)
+  {
+    if (errno == EINTR)
+    {
+      return PLUS_SUCCESS;
+    }
+    LOG_ERROR("Unable to wait for client sockets: " << strerror(errno));
+    return PLUS_FAIL;
+  }
+  for (int i = 0; i < numberOfEvents; ++i)
+  {
+    readableSocketDescriptors.push_back(events[i].data.fd);
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+/*! Set TCP_NODELAY and, if sendBufferSizeBytes is positive, the send buffer size of a connected client socket */
+PlusStatus SetClientSocketOptions(int socketDescriptor, bool tcpNoDelay, int sendBufferSizeBytes)
+{
+  PlusStatus status = PLUS_SUCCESS;
+  int noDelay = tcpNoDelay ? 1 : 0;
+  if (setsockopt(socketDescriptor, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay)) != 0)
+  {
+    LOG_WARNING("Unable to set TCP_NODELAY option of client socket: " << strerror(errno));
+    status = PLUS_FAIL;
+  }
+  if (sendBufferSizeBytes > 0 && setsockopt(socketDescriptor, SOL_SOCKET, SO_SNDBUF, &sendBufferSizeBytes, sizeof(sendBufferSizeBytes)) != 0)
+  {
+    LOG_WARNING("Unable to set send buffer size of client socket to " << sendBufferSizeBytes << " bytes: " << strerror(errno));
+    status = PLUS_FAIL;
+  }
+  return status;
+}
+
+//----------------------------------------------------------------------------
+// Broken connections are reported by the return value instead of SIGPIPE
+const int SEND_FLAGS = MSG_NOSIGNAL;
+
+//----------------------------------------------------------------------------
+/*! Send the messages with as few system calls as possible (one sendmsg call with a gather array). Returns false if sending failed. */
+bool SendClientSocketMessages(int socketDescriptor, const std::vector<igtl::MessageBase::Pointer>& messages)
+{
+  std::vector<struct iovec> buffers;
+  for (std::vector<igtl::MessageBase::Pointer>::const_iterator it = messages.begin(); it != messages.end(); ++it)
+  {
+    struct iovec buffer;
+    buffer.iov_base = (*it)->GetBufferPointer();
+    buffer.iov_len = (*it)->GetBufferSize();
+    buffers.push_back(buffer);
+  }
+
+  size_t firstBuffer = 0;
+  while (firstBuffer < buffers.size())
+  {
+    struct msghdr header;
+    memset(&header, 0, sizeof(header));
+    header.msg_iov = &buffers[firstBuffer];
+    header.msg_iovlen = std::min<size_t>(buffers.size() - firstBuffer, IOV_MAX);
+    ssize_t sentBytes = sendmsg(socketDescriptor, &header, SEND_FLAGS);
+    if (sentBytes < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      LOG_DEBUG("Unable to send messages to client socket: " << strerror(errno));
+      return false;
+    }
+
+    // Skip the buffers that have been sent completely and continue with the rest of a partially sent buffer
+    while (firstBuffer < buffers.size() && static_cast<size_t>(sentBytes) >= buffers[firstBuffer].iov_len)
+    {
+      sentBytes -= buffers[firstBuffer].iov_len;
+      firstBuffer++;
+    }
+    if (firstBuffer < buffers.size())
+    {
+      buffers[firstBuffer].iov_base = static_cast<char*>(buffers[firstBuffer].iov_base) + sentBytes;
+      buffers[firstBuffer].iov_len -= sentBytes;
+    }
+  }
+  return true;
+}
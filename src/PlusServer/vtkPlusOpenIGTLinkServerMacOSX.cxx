@@ -2,6 +2,17 @@
 #include <sys/socket.h>
 #include <ifaddrs.h>
 #include <stdio.h>
+#include <string.h>
+#include <sys/event.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <cerrno>
+#include <algorithm>
+#include <climits>
+#include <set>
 
 void PrintServerInfo(vtkPlusOpenIGTLinkServer* self)
 {
@@ -35,4 +46,173 @@ void PrintServerInfo(vtkPlusOpenIGTLinkServer* self)
   }
   ss << " -- port " << self->GetListeningPort();
   LOG_INFO(ss.str());
-}
\ No newline at end of file
+}
+
+//----------------------------------------------------------------------------
+/*! Waits until data is available on any of the client sockets, used by the client receiver event loop of the server (kqueue based) */
+class ClientSocketPoller
+{
+public:
+  ClientSocketPoller();
+  ~ClientSocketPoller();
+
+  /*! Set the descriptors of the sockets to wait for */
+  void SetSocketDescriptors(const std::set<int>& socketDescriptors);
+
+  /*! Wait until at least one of the sockets is readable (or the peer closed the connection) or the timeout expires */
+  PlusStatus Wait(int timeoutMs, std::vector<int>& readableSocketDescriptors);
+
+private:
+  int KqueueDescriptor;
+  std::set<int> SocketDescriptors;
+};
+
+//----------------------------------------------------------------------------
+ClientSocketPoller::ClientSocketPoller()
+  : KqueueDescriptor(kqueue())
+{
+  if (this->KqueueDescriptor < 0)
+  {
+    LOG_ERROR("Unable to create kqueue: " << strerror(errno));
+  }
+}
+
+//----------------------------------------------------------------------------
+ClientSocketPoller::~ClientSocketPoller()
+{
+  if (this->KqueueDescriptor >= 0)
+  {
+    close(this->KqueueDescriptor);
+  }
+}
+
+//----------------------------------------------------------------------------
+void ClientSocketPoller::SetSocketDescriptors(const std::set<int>& socketDescriptors)
+{
+  for (std::set<int>::iterator it = this->SocketDescriptors.begin(); it != this->SocketDescriptors.end(); ++it)
+  {
+    if (socketDescriptors.find(*it) == socketDescriptors.end())
+    {
+      // Fails with ENOENT if the socket has been closed already, which removes it from the kqueue anyway
+      struct kevent change;
+      EV_SET(&change, *it, EVFILT_READ, EV_DELETE, 0, 0, NULL);
+      kevent(this->KqueueDescriptor, &change, 1, NULL, 0, NULL);
+    }
+  }
+  for (std::set<int>::const_iterator it = socketDescriptors.begin(); it != socketDescriptors.end(); ++it)
+  {
+    if (this->SocketDescriptors.find(*it) == this->SocketDescriptors.end())
+    {
+      // Level triggered (no EV_CLEAR), so that sockets with more than one pending message are reported again
+      struct kevent change;
+      EV_SET(&change, *it, EVFILT_READ, EV_ADD | EV_ENABLE, 0, 0, NULL);
+      if (kevent(this->KqueueDescriptor, &change, 1, NULL, 0, NULL) != 0)
+      {
+        LOG_ERROR("Unable to add client socket " << *it << " to kqueue: " << strerror(errno));
+      }
+    }
+  }
+  this->SocketDescriptors = socketDescriptors;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus ClientSocketPoller::Wait(int timeoutMs, std::vector<int>& readableSocketDescriptors)
+{
+  readableSocketDescriptors.clear();
+  if (this->KqueueDescriptor < 0)
+  {
+    return PLUS_FAIL;
+  }
+
+  struct timespec timeout;
+  timeout.tv_sec = timeoutMs / 1000;
+  timeout.tv_nsec = (timeoutMs % 1000) * 1000000L;
+  struct kevent events[64];
+  int numberOfEvents = kevent(this->KqueueDescriptor, NULL, 0, events, 64, &timeout);
+  if (numberOfEvents < 0)
+  {
+    if (errno == EINTR)
+    {
+      return PLUS_SUCCESS;
+    }
+    LOG_ERROR("Unable to wait for client sockets: " << strerror(errno));
+    return PLUS_FAIL;
+  }
+  for (int i = 0; i < numberOfEvents; ++i)
+  {
+    readableSocketDescriptors.push_back(static_cast<int>(events[i].ident));
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+/*! Set TCP_NODELAY and, if sendBufferSizeBytes is positive, the send buffer size of a connected client socket */
+PlusStatus SetClientSocketOptions(int socketDescriptor, bool tcpNoDelay, int sendBufferSizeBytes)
+{
+  PlusStatus status = PLUS_SUCCESS;
+  int noDelay = tcpNoDelay ? 1 : 0;
+  if (setsockopt(socketDescriptor, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay)) != 0)
+  {
+    LOG_WARNING("Unable to set TCP_NODELAY option of client socket: " << strerror(errno));
+    status = PLUS_FAIL;
+  }
+  if (sendBufferSizeBytes > 0 && setsockopt(socketDescriptor, SOL_SOCKET, SO_SNDBUF, &sendBufferSizeBytes, sizeof(sendBufferSizeBytes)) != 0)
+  {
+    LOG_WARNING("Unable to set send buffer size of client socket to " << sendBufferSizeBytes << " bytes: " << strerror(errno));
+    status = PLUS_FAIL;
+  }
+  // Report broken connections by the return value of sendmsg instead of SIGPIPE
+  int noSigPipe = 1;
+  setsockopt(socketDescriptor, SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, sizeof(noSigPipe));
+  return status;
+}
+
+//----------------------------------------------------------------------------
+// MSG_NOSIGNAL is not available, SIGPIPE is disabled by the SO_NOSIGPIPE socket option instead
+const int SEND_FLAGS = 0;
+
+//----------------------------------------------------------------------------
+/*! Send the messages with as few system calls as possible (one sendmsg call with a gather array). Returns false if sending failed. */
+bool SendClientSocketMessages(int socketDescriptor, const std::vector<igtl::MessageBase::Pointer>& messages)
+{
+  std::vector<struct iovec> buffers;
+  for (std::vector<igtl::MessageBase::Pointer>::const_iterator it = messages.begin(); it != messages.end(); ++it)
+  {
+    struct iovec buffer;
+    buffer.iov_base = (*it)->GetBufferPointer();
+    buffer.iov_len = (*it)->GetBufferSize();
+    buffers.push_back(buffer);
+  }
+
+  size_t firstBuffer = 0;
+  while (firstBuffer < buffers.size())
+  {
+    struct msghdr header;
+    memset(&header, 0, sizeof(header));
+    header.msg_iov = &buffers[firstBuffer];
+    header.msg_iovlen = std::min<size_t>(buffers.size() - firstBuffer, IOV_MAX);
+    ssize_t sentBytes = sendmsg(socketDescriptor, &header, SEND_FLAGS);
+    if (sentBytes < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      LOG_DEBUG("Unable to send messages to client socket: " << strerror(errno));
+      return false;
+    }
+
+    // Skip the buffers that have been sent completely and continue with the rest of a partially sent buffer
+    while (firstBuffer < buffers.size() && static_cast<size_t>(sentBytes) >= buffers[firstBuffer].iov_len)
+    {
+      sentBytes -= buffers[firstBuffer].iov_len;
+      firstBuffer++;
+    }
+    if (firstBuffer < buffers.size())
+    {
+      buffers[firstBuffer].iov_base = static_cast<char*>(buffers[firstBuffer].iov_base) + sentBytes;
+      buffers[firstBuffer].iov_len -= sentBytes;
+    }
+  }
+  return true;
+}
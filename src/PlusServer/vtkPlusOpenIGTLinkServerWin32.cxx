@@ -1,6 +1,7 @@
 #include <WS2tcpip.h>
 #include <winsock2.h>
 #include <iphlpapi.h>
+#include <set>
 #pragma comment(lib, "Iphlpapi.lib")
 
 void PrintServerInfo(vtkPlusOpenIGTLinkServer* self)
@@ -79,4 +80,132 @@ void PrintServerInfo(vtkPlusOpenIGTLinkServer* self)
   }
   ss << " -- port " << self->GetListeningPort();
   LOG_INFO(ss.str());
-}
\ No newline at end of file
+}
+
+//----------------------------------------------------------------------------
+/*! Waits until data is available on any of the client sockets, used by the client receiver event loop of the server (WSAPoll based) */
+class ClientSocketPoller
+{
+public:
+  ClientSocketPoller();
+  ~ClientSocketPoller();
+
+  /*! Set the descriptors of the sockets to wait for */
+  void SetSocketDescriptors(const std::set<int>& socketDescriptors);
+
+  /*! Wait until at least one of the sockets is readable (or the peer closed the connection) or the timeout expires */
+  PlusStatus Wait(int timeoutMs, std::vector<int>& readableSocketDescriptors);
+
+private:
+  std::vector<WSAPOLLFD> PollDescriptors;
+};
+
+//----------------------------------------------------------------------------
+ClientSocketPoller::ClientSocketPoller()
+{
+}
+
+//----------------------------------------------------------------------------
+ClientSocketPoller::~ClientSocketPoller()
+{
+}
+
+//----------------------------------------------------------------------------
+void ClientSocketPoller::SetSocketDescriptors(const std::set<int>& socketDescriptors)
+{
+  this->PollDescriptors.clear();
+  for (std::set<int>::const_iterator it = socketDescriptors.begin(); it != socketDescriptors.end(); ++it)
+  {
+    WSAPOLLFD pollDescriptor;
+    pollDescriptor.fd = static_cast<SOCKET>(*it);
+    pollDescriptor.events = POLLRDNORM;
+    pollDescriptor.revents = 0;
+    this->PollDescriptors.push_back(pollDescriptor);
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusStatus ClientSocketPoller::Wait(int timeoutMs, std::vector<int>& readableSocketDescriptors)
+{
+  readableSocketDescriptors.clear();
+  if (this->PollDescriptors.empty())
+  {
+    // WSAPoll fails if there are no sockets to wait for
+    Sleep(timeoutMs);
+    return PLUS_SUCCESS;
+  }
+
+  int numberOfEvents = WSAPoll(&this->PollDescriptors[0], static_cast<ULONG>(this->PollDescriptors.size()), timeoutMs);
+  if (numberOfEvents == SOCKET_ERROR)
+  {
+    LOG_ERROR("Unable to wait for client sockets: error " << WSAGetLastError());
+    return PLUS_FAIL;
+  }
+  for (std::vector<WSAPOLLFD>::iterator it = this->PollDescriptors.begin(); it != this->PollDescriptors.end(); ++it)
+  {
+    // POLLHUP and POLLERR are reported for closed connections, the receive detects that the client is gone
+    if (it->revents & (POLLRDNORM | POLLHUP | POLLERR))
+    {
+      readableSocketDescriptors.push_back(static_cast<int>(it->fd));
+    }
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+/*! Set TCP_NODELAY and, if sendBufferSizeBytes is positive, the send buffer size of a connected client socket */
+PlusStatus SetClientSocketOptions(int socketDescriptor, bool tcpNoDelay, int sendBufferSizeBytes)
+{
+  PlusStatus status = PLUS_SUCCESS;
+  BOOL noDelay = tcpNoDelay ? TRUE : FALSE;
+  if (setsockopt(static_cast<SOCKET>(socketDescriptor), IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay)) != 0)
+  {
+    LOG_WARNING("Unable to set TCP_NODELAY option of client socket: error " << WSAGetLastError());
+    status = PLUS_FAIL;
+  }
+  if (sendBufferSizeBytes > 0
+      && setsockopt(static_cast<SOCKET>(socketDescriptor), SOL_SOCKET, SO_SNDBUF, reinterpret_cast<const char*>(&sendBufferSizeBytes), sizeof(sendBufferSizeBytes)) != 0)
+  {
+    LOG_WARNING("Unable to set send buffer size of client socket to " << sendBufferSizeBytes << " bytes: error " << WSAGetLastError());
+    status = PLUS_FAIL;
+  }
+  return status;
+}
+
+//----------------------------------------------------------------------------
+/*! Send the messages with as few system calls as possible (one WSASend call with a buffer array). Returns false if sending failed. */
+bool SendClientSocketMessages(int socketDescriptor, const std::vector<igtl::MessageBase::Pointer>& messages)
+{
+  std::vector<WSABUF> buffers;
+  for (std::vector<igtl::MessageBase::Pointer>::const_iterator it = messages.begin(); it != messages.end(); ++it)
+  {
+    WSABUF buffer;
+    buffer.buf = static_cast<CHAR*>((*it)->GetBufferPointer());
+    buffer.len = static_cast<ULONG>((*it)->GetBufferSize());
+    buffers.push_back(buffer);
+  }
+
+  size_t firstBuffer = 0;
+  while (firstBuffer < buffers.size())
+  {
+    DWORD sentBytes = 0;
+    if (WSASend(static_cast<SOCKET>(socketDescriptor), &buffers[firstBuffer], static_cast<DWORD>(buffers.size() - firstBuffer), &sentBytes, 0, NULL, NULL) != 0)
+    {
+      LOG_DEBUG("Unable to send messages to client socket: error " << WSAGetLastError());
+      return false;
+    }
+
+    // Skip the buffers that have been sent completely and continue with the rest of a partially sent buffer
+    while (firstBuffer < buffers.size() && sentBytes >= buffers[firstBuffer].len)
+    {
+      sentBytes -= buffers[firstBuffer].len;
+      firstBuffer++;
+    }
+    if (firstBuffer < buffers.size())
+    {
+      buffers[firstBuffer].buf += sentBytes;
+      buffers[firstBuffer].len -= sentBytes;
+    }
+  }
+  return true;
+}
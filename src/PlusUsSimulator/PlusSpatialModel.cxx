@@ -7,6 +7,9 @@ See License.txt for details.
 #include "PlusConfigure.h"
 
 #include "PlusSpatialModel.h"
+#include "PlusWorkerPool.h"
+
+#include <algorithm>
 
 #include "vtkMath.h"
 #include "vtkMatrix4x4.h"
@@ -19,10 +22,15 @@ See License.txt for details.
 #include "vtkPointData.h"
 #include "vtkIdList.h"
 #include "vtkTriangle.h"
+#include "vtkDecimatePro.h"
+#include "vtkTriangleFilter.h"
 
 // If fraction of the transmitted beam intensity is smaller then this value then we consider the beam to be completely absorbed
 const double MINIMUM_BEAM_INTENSITY = 1e-9;
 
+// Number of neighbor lines whose bounding box is tested against the model bounds at once
+const int LINE_GROUP_SIZE = 16;
+
 // Characterizes the specular reflection BRDF. If the value is smaller then reflection is limited to a smaller angle range (closer to 90deg incidence angle).
 double SPECULAR_REFLECTION_BRDF_STDEV = 30.0;
 
@@ -43,9 +51,11 @@ PlusSpatialModel::PlusSpatialModel()
   , TransducerSpatialModelMaxOverlapMm(10.0)
   , SurfaceSpecularReflectionCoefficient(0.0)
   , SurfaceDiffuseReflectionCoefficient(0.1)
+  , DecimationMaxErrorMm(0.0)
   , ModelLocalizer(vtkModifiedBSPTree::New())
   , PolyData(NULL)
 {
+  std::fill(this->ModelBounds, this->ModelBounds + 6, 0.0);
 }
 
 //-----------------------------------------------------------------------------
@@ -80,8 +90,11 @@ PlusSpatialModel::PlusSpatialModel(const PlusSpatialModel& model)
   SetModelLocalizer(model.ModelLocalizer);
   SetPolyData(model.PolyData);
   this->ModelFileNeedsUpdate = model.ModelFileNeedsUpdate;
-  this->PrecomputedAttenuations = model.PrecomputedAttenuations;
+  this->IntensityTable = model.IntensityTable;
   this->TransducerSpatialModelMaxOverlapMm = model.TransducerSpatialModelMaxOverlapMm;
+  this->TriangleBvh = model.TriangleBvh;
+  this->DecimationMaxErrorMm = model.DecimationMaxErrorMm;
+  std::copy(model.ModelBounds, model.ModelBounds + 6, this->ModelBounds);
 }
 
 //-----------------------------------------------------------------------------
@@ -103,8 +116,11 @@ void PlusSpatialModel::operator=(const PlusSpatialModel& model)
   SetModelLocalizer(model.ModelLocalizer);
   SetPolyData(model.PolyData);
   this->ModelFileNeedsUpdate = model.ModelFileNeedsUpdate;
-  this->PrecomputedAttenuations = model.PrecomputedAttenuations;
+  this->IntensityTable = model.IntensityTable;
   this->TransducerSpatialModelMaxOverlapMm = model.TransducerSpatialModelMaxOverlapMm;
+  this->TriangleBvh = model.TriangleBvh;
+  this->DecimationMaxErrorMm = model.DecimationMaxErrorMm;
+  std::copy(model.ModelBounds, model.ModelBounds + 6, this->ModelBounds);
 }
 
 //-----------------------------------------------------------------------------
@@ -196,6 +212,7 @@ PlusStatus PlusSpatialModel::ReadConfiguration(vtkXMLDataElement* spatialModelEl
   XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, SurfaceDiffuseReflectionCoefficient, spatialModelElement);
   XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, SurfaceSpecularReflectionCoefficient, spatialModelElement);
   XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, TransducerSpatialModelMaxOverlapMm, spatialModelElement);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, DecimationMaxErrorMm, spatialModelElement);
 
   return PLUS_SUCCESS;
 }
@@ -252,22 +269,18 @@ void PlusSpatialModel::CalculateIntensity(std::vector<double>& reflectedIntensit
     backscatteredReflectedIntensity += reflectionDirectionFactor * this->SurfaceSpecularReflectionCoefficient * surfaceReflectedBeamIntensity;
   }
 
-  // Compute attenuation within this model
-  double intensityAttenuationCoefficientdBPerPixel = this->AttenuationCoefficientDbPerCmMhz * (distanceBetweenScanlineSamplePointsMm / 10.0) * this->ImagingFrequencyMhz;
-  // intensityAttenuationCoefficientPerPixel: should be close to 1, as it's the ratio of (transmitted beam intensity / incident beam intensity) after traversing through a single pixel
-  double intensityAttenuationCoefficientPerPixel = pow(10.0, -intensityAttenuationCoefficientdBPerPixel / 10.0);
+  // Attenuation within this model and surface reflection decay only depend on the material, the imaging frequency and the sample point distance,
+  // so they are taken from the lookup table, which is only recomputed if any of these change
+  UpdateIntensityLookupTable(distanceBetweenScanlineSamplePointsMm, numberOfFilledPixels);
+  const IntensityLookupTable& lookupTable = this->IntensityTable;
+
   // intensityAttenuatedFractionPerPixel: how big fraction of the intensity is attenuated during traversing through one voxel
-  double intensityAttenuatedFractionPerPixel = (1 - intensityAttenuationCoefficientPerPixel);
+  double intensityAttenuatedFractionPerPixel = (1 - lookupTable.IntensityAttenuationCoefficientPerPixel);
   // intensityTransmittedFractionPerPixelTwoWay: how big fraction of the intensity is transmitted during traversing through one voxel; takes into account both propagation directions
-  double intensityTransmittedFractionPerPixelTwoWay = intensityAttenuationCoefficientPerPixel * intensityAttenuationCoefficientPerPixel;
+  double intensityTransmittedFractionPerPixelTwoWay = lookupTable.IntensityTransmittedFractionPerPixelTwoWay;
 
   transmittedIntensity = surfaceTransmittedBeamIntensity * intensityTransmittedFractionPerPixelTwoWay;
 
-  if ((numberOfFilledPixels > 0 && this->PrecomputedAttenuations.size() < numberOfFilledPixels) || intensityTransmittedFractionPerPixelTwoWay != this->PrecomputedAttenuations[0])
-  {
-    UpdatePrecomputedAttenuations(intensityTransmittedFractionPerPixelTwoWay, numberOfFilledPixels);
-  }
-
   // We iterate until transmittedIntensity * intensityTransmittedFractionPerPixelTwoWay^n > MINIMUM_BEAM_INTENSITY
   // So, n = log(MINIMUM_BEAM_INTENSITY/transmittedIntensity) / log(intensityTransmittedFractionPerPixelTwoWay)
   unsigned int numberOfIterationsToReachMinimumBeamIntensity = 0;
@@ -276,15 +289,18 @@ void PlusSpatialModel::CalculateIntensity(std::vector<double>& reflectedIntensit
     numberOfIterationsToReachMinimumBeamIntensity =
       std::min<unsigned int>(numberOfFilledPixels,  // value may be larger than number of pixels to fill -> clamp it to the number of pixels to fill
                              static_cast<unsigned int>(std::max<int>(0,   // value may be negative when AttenuationCoefficientDbPerCmMhz is close to 0 -> clamp it to zero
-                                 floor(log(MINIMUM_BEAM_INTENSITY / transmittedIntensity) / log(intensityTransmittedFractionPerPixelTwoWay)) + 1)));
+                                 floor(log(MINIMUM_BEAM_INTENSITY / transmittedIntensity) / lookupTable.LogIntensityTransmittedFractionPerPixelTwoWay) + 1)));
     double backScatterFactor = transmittedIntensity * intensityAttenuatedFractionPerPixel * this->BackscatterDiffuseReflectionCoefficient / intensityTransmittedFractionPerPixelTwoWay;
     for (unsigned int currentPixelInFilledPixels = 0; currentPixelInFilledPixels < numberOfIterationsToReachMinimumBeamIntensity; currentPixelInFilledPixels++)
     {
       // a fraction of the attenuation is caused by backscattering, the backscattering is sensed by the transducer
-      //reflectedIntensity[currentPixelInFilledPixels] = *(attenuation++) * backScatterFactor;
-      reflectedIntensity[currentPixelInFilledPixels] = this->PrecomputedAttenuations[currentPixelInFilledPixels] * backScatterFactor;
+      reflectedIntensity[currentPixelInFilledPixels] = lookupTable.Attenuations[currentPixelInFilledPixels] * backScatterFactor;
+    }
+    if (numberOfIterationsToReachMinimumBeamIntensity > 0)
+    {
+      // Attenuations[n-1] = intensityTransmittedFractionPerPixelTwoWay^n
+      transmittedIntensity *= lookupTable.Attenuations[numberOfIterationsToReachMinimumBeamIntensity - 1];
     }
-    transmittedIntensity *= pow(intensityTransmittedFractionPerPixelTwoWay, static_cast<double>(numberOfIterationsToReachMinimumBeamIntensity));
   }
   else
   {
@@ -299,20 +315,26 @@ void PlusSpatialModel::CalculateIntensity(std::vector<double>& reflectedIntensit
   // Add surface reflection
   if (backscatteredReflectedIntensity > MINIMUM_BEAM_INTENSITY)
   {
-    double surfaceReflectionIntensityDecayPerPixel = pow(10.0, -this->SurfaceReflectionIntensityDecayDbPerMm * distanceBetweenScanlineSamplePointsMm / 10.0);
     // We iterate until backscatteredReflectedIntensity * surfaceReflectionIntensityDecayPerPixel^n > MINIMUM_BEAM_INTENSITY
     // So, n = log(MINIMUM_BEAM_INTENSITY/backscatteredReflectedIntensity) / log(surfaceReflectionIntensityDecayPerPixel)
-    int numberOfIterationsToReachMinimumBackscatteredIntensity = std::min<int>(numberOfFilledPixels, floor(log(MINIMUM_BEAM_INTENSITY / backscatteredReflectedIntensity) / log(surfaceReflectionIntensityDecayPerPixel)) + 1);
+    int numberOfIterationsToReachMinimumBackscatteredIntensity = std::min<int>(numberOfFilledPixels, floor(log(MINIMUM_BEAM_INTENSITY / backscatteredReflectedIntensity) / lookupTable.LogSurfaceReflectionIntensityDecayPerPixel) + 1);
     for (int currentPixelInFilledPixels = 0; currentPixelInFilledPixels < numberOfIterationsToReachMinimumBackscatteredIntensity; currentPixelInFilledPixels++)
     {
       // a fraction of the attenuation is caused by backscattering, the backscattering is sensed by the transducer
-      reflectedIntensity[currentPixelInFilledPixels] += backscatteredReflectedIntensity;
-      backscatteredReflectedIntensity *= surfaceReflectionIntensityDecayPerPixel;
+      // SurfaceReflectionDecays[n] = surfaceReflectionIntensityDecayPerPixel^n
+      reflectedIntensity[currentPixelInFilledPixels] += backscatteredReflectedIntensity * lookupTable.SurfaceReflectionDecays[currentPixelInFilledPixels];
     }
   }
   // TODO: to simulate beamwidth, take into account the incidence angle and disperse the reflection on a larger area if the angle is large
 }
 
+//-----------------------------------------------------------------------------
+void PlusSpatialModel::PrepareIntensityCalculation(double distanceBetweenScanlineSamplePointsMm, unsigned int maximumNumberOfFilledPixels)
+{
+  UpdateModelFile();
+  UpdateIntensityLookupTable(distanceBetweenScanlineSamplePointsMm, maximumNumberOfFilledPixels);
+}
+
 //-----------------------------------------------------------------------------
 void PlusSpatialModel::GetLineIntersections(std::deque<LineIntersectionInfo>& lineIntersections, double* scanLineStartPoint_Reference, double* scanLineEndPoint_Reference)
 {
@@ -330,6 +352,17 @@ void PlusSpatialModel::GetLineIntersections(std::deque<LineIntersectionInfo>& li
     return;
   }
 
+  if (this->TriangleBvh)
+  {
+    vtkSmartPointer<vtkMatrix4x4> referenceToModelMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    GetReferenceToModelMatrix(referenceToModelMatrix);
+    vtkSmartPointer<vtkMatrix4x4> modelToReferenceMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    vtkMatrix4x4::Invert(referenceToModelMatrix, modelToReferenceMatrix);
+    std::vector<PlusTriangleBvh::Hit> hits;
+    GetLineIntersectionsWithTriangleBvh(lineIntersections, scanLineStartPoint_Reference, scanLineEndPoint_Reference, referenceToModelMatrix, modelToReferenceMatrix, hits);
+    return;
+  }
+
   // non-normalized direction vector of the scanline
   double scanLineDirectionVector_Reference[4] =
   {
@@ -345,16 +378,20 @@ void PlusSpatialModel::GetLineIntersections(std::deque<LineIntersectionInfo>& li
     searchLineStartPoint_Reference[i] = scanLineStartPoint_Reference[i] - this->TransducerSpatialModelMaxOverlapMm * scanLineDirectionVector_Reference[i] / scanLineDirectionVectorNorm_Reference;
   }
 
-  vtkSmartPointer<vtkMatrix4x4> objectToModelMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
-  vtkMatrix4x4::Invert(this->ModelToObjectTransform, objectToModelMatrix);
   vtkSmartPointer<vtkMatrix4x4> referenceToModelMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
-  vtkMatrix4x4::Multiply4x4(objectToModelMatrix, this->ReferenceToObjectTransform, referenceToModelMatrix);
+  GetReferenceToModelMatrix(referenceToModelMatrix);
 
   double searchLineStartPoint_Model[4] = {0, 0, 0, 1};
   double scanLineEndPoint_Model[4] = {0, 0, 0, 1};
   referenceToModelMatrix->MultiplyPoint(searchLineStartPoint_Reference, searchLineStartPoint_Model);
   referenceToModelMatrix->MultiplyPoint(scanLineEndPoint_Reference, scanLineEndPoint_Model);
 
+  if (IsLineOutsideModelBounds(searchLineStartPoint_Model, scanLineEndPoint_Model))
+  {
+    // no intersections with this model
+    return;
+  }
+
   vtkSmartPointer<vtkPoints> intersectionPoints_Model = vtkSmartPointer<vtkPoints>::New();
   vtkSmartPointer<vtkIdList> intersectionCellIds = vtkSmartPointer<vtkIdList>::New();
   this->ModelLocalizer->IntersectWithLine(searchLineStartPoint_Model, scanLineEndPoint_Model, 0.0, intersectionPoints_Model, intersectionCellIds);
@@ -451,6 +488,292 @@ void PlusSpatialModel::GetLineIntersections(std::deque<LineIntersectionInfo>& li
   }
 }
 
+//-----------------------------------------------------------------------------
+void PlusSpatialModel::GetLineIntersections(std::vector< std::deque<LineIntersectionInfo> >& lineIntersections,
+    const std::vector<double>& scanLineStartPoints_Reference, const std::vector<double>& scanLineEndPoints_Reference, int numberOfThreads)
+{
+  UpdateModelFile();
+
+  int numberOfLines = static_cast<int>(lineIntersections.size());
+  if (scanLineStartPoints_Reference.size() < 3 * lineIntersections.size() || scanLineEndPoints_Reference.size() < 3 * lineIntersections.size())
+  {
+    LOG_ERROR("SpatialModel::GetLineIntersections error: coordinates of " << numberOfLines << " line start and end points are expected");
+    return;
+  }
+
+  if (this->ModelFile.empty())
+  {
+    // Background model, all lines are completely inside
+    for (int lineIndex = 0; lineIndex < numberOfLines; lineIndex++)
+    {
+      double scanLineStartPoint_Reference[4] = {scanLineStartPoints_Reference[3 * lineIndex], scanLineStartPoints_Reference[3 * lineIndex + 1], scanLineStartPoints_Reference[3 * lineIndex + 2], 1};
+      double scanLineEndPoint_Reference[4] = {scanLineEndPoints_Reference[3 * lineIndex], scanLineEndPoints_Reference[3 * lineIndex + 1], scanLineEndPoints_Reference[3 * lineIndex + 2], 1};
+      GetLineIntersections(lineIntersections[lineIndex], scanLineStartPoint_Reference, scanLineEndPoint_Reference);
+    }
+    return;
+  }
+  if (this->PolyData == NULL)
+  {
+    // The model could not be loaded
+    return;
+  }
+
+  // The transforms are the same for all the lines, compute them only once
+  vtkSmartPointer<vtkMatrix4x4> referenceToModelMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  GetReferenceToModelMatrix(referenceToModelMatrix);
+  vtkSmartPointer<vtkMatrix4x4> modelToReferenceMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  vtkMatrix4x4::Invert(referenceToModelMatrix, modelToReferenceMatrix);
+
+  // Only lines that may intersect the model are processed, small models are usually intersected by a few lines only
+  std::vector<int> candidateLineIndices;
+  GetCandidateLines(scanLineStartPoints_Reference, scanLineEndPoints_Reference, numberOfLines, referenceToModelMatrix, candidateLineIndices);
+  if (candidateLineIndices.empty())
+  {
+    return;
+  }
+
+  if (!this->TriangleBvh)
+  {
+    // The model is stored in the localizer, which cannot be used from multiple threads
+    for (std::vector<int>::iterator lineIndexIt = candidateLineIndices.begin(); lineIndexIt != candidateLineIndices.end(); ++lineIndexIt)
+    {
+      const int lineIndex = *lineIndexIt;
+      double scanLineStartPoint_Reference[4] = {scanLineStartPoints_Reference[3 * lineIndex], scanLineStartPoints_Reference[3 * lineIndex + 1], scanLineStartPoints_Reference[3 * lineIndex + 2], 1};
+      double scanLineEndPoint_Reference[4] = {scanLineEndPoints_Reference[3 * lineIndex], scanLineEndPoints_Reference[3 * lineIndex + 1], scanLineEndPoints_Reference[3 * lineIndex + 2], 1};
+      GetLineIntersections(lineIntersections[lineIndex], scanLineStartPoint_Reference, scanLineEndPoint_Reference);
+    }
+    return;
+  }
+
+  PlusWorkerPool::GetInstance().ParallelFor(0, static_cast<int>(candidateLineIndices.size()), numberOfThreads, [&](int firstCandidateIndex, int lastCandidateIndex)
+  {
+    // One hits buffer for all the lines of this task
+    std::vector<PlusTriangleBvh::Hit> hits;
+    for (int candidateIndex = firstCandidateIndex; candidateIndex < lastCandidateIndex; candidateIndex++)
+    {
+      const int lineIndex = candidateLineIndices[candidateIndex];
+      GetLineIntersectionsWithTriangleBvh(lineIntersections[lineIndex], &scanLineStartPoints_Reference[3 * lineIndex], &scanLineEndPoints_Reference[3 * lineIndex],
+                                          referenceToModelMatrix, modelToReferenceMatrix, hits);
+    }
+  });
+}
+
+//-----------------------------------------------------------------------------
+void PlusSpatialModel::GetLineIntersectionsWithTriangleBvh(std::deque<LineIntersectionInfo>& lineIntersections, const double* scanLineStartPoint_Reference, const double* scanLineEndPoint_Reference,
+    vtkMatrix4x4* referenceToModelMatrix, vtkMatrix4x4* modelToReferenceMatrix, std::vector<PlusTriangleBvh::Hit>& hits)
+{
+  // non-normalized direction vector of the scanline
+  double scanLineDirectionVector_Reference[4] =
+  {
+    scanLineEndPoint_Reference[0] - scanLineStartPoint_Reference[0],
+    scanLineEndPoint_Reference[1] - scanLineStartPoint_Reference[1],
+    scanLineEndPoint_Reference[2] - scanLineStartPoint_Reference[2],
+    0
+  };
+  double scanLineDirectionVectorNorm_Reference = vtkMath::Norm(scanLineDirectionVector_Reference);
+  double searchLineStartPoint_Reference[4] = {0, 0, 0, 1};
+  double scanLineEndPointHomogeneous_Reference[4] = {scanLineEndPoint_Reference[0], scanLineEndPoint_Reference[1], scanLineEndPoint_Reference[2], 1};
+  for (int i = 0; i < 3; i++)
+  {
+    searchLineStartPoint_Reference[i] = scanLineStartPoint_Reference[i] - this->TransducerSpatialModelMaxOverlapMm * scanLineDirectionVector_Reference[i] / scanLineDirectionVectorNorm_Reference;
+  }
+
+  double searchLineStartPoint_Model[4] = {0, 0, 0, 1};
+  double scanLineEndPoint_Model[4] = {0, 0, 0, 1};
+  referenceToModelMatrix->MultiplyPoint(searchLineStartPoint_Reference, searchLineStartPoint_Model);
+  referenceToModelMatrix->MultiplyPoint(scanLineEndPointHomogeneous_Reference, scanLineEndPoint_Model);
+  double searchLineVector_Model[3] =
+  {
+    scanLineEndPoint_Model[0] - searchLineStartPoint_Model[0],
+    scanLineEndPoint_Model[1] - searchLineStartPoint_Model[1],
+    scanLineEndPoint_Model[2] - searchLineStartPoint_Model[2]
+  };
+
+  hits.clear();
+  this->TriangleBvh->IntersectWithLine(searchLineStartPoint_Model, searchLineVector_Model, hits);
+  if (hits.empty())
+  {
+    // no intersections with this model
+    return;
+  }
+  std::sort(hits.begin(), hits.end());
+
+  // Measure the distance from the starting point in the reference coordinate system
+  double intersectionPoint_Model[4] = {0, 0, 0, 1};
+  double intersectionPoint_Reference[4] = {0, 0, 0, 1};
+  std::vector<PlusTriangleBvh::Hit>::iterator hitIt = hits.begin();
+  bool scanLineStartPointInsideModel = false;
+  // Search for intersection points in the search line that are not part of the scanline to detect
+  // potential model/transducer overlap
+  for (; hitIt != hits.end(); ++hitIt)
+  {
+    for (int i = 0; i < 3; i++)
+    {
+      intersectionPoint_Model[i] = searchLineStartPoint_Model[i] + hitIt->LineParameter * searchLineVector_Model[i];
+    }
+    modelToReferenceMatrix->MultiplyPoint(intersectionPoint_Model, intersectionPoint_Reference);
+    double intersectionDistanceFromSearchLineStartPointMm = sqrt(vtkMath::Distance2BetweenPoints(searchLineStartPoint_Reference, intersectionPoint_Reference));
+    if (intersectionDistanceFromSearchLineStartPointMm <= this->TransducerSpatialModelMaxOverlapMm)
+    {
+      // there is an intersection point in the search line that is not part of the scanline
+      scanLineStartPointInsideModel = (!scanLineStartPointInsideModel);
+    }
+    else
+    {
+      // we reached the scanline starting point
+      break;
+    }
+  }
+  LineIntersectionInfo intersectionInfo;
+  intersectionInfo.Model = this;
+  if (scanLineStartPointInsideModel)
+  {
+    // the scanline starting point is inside the model, so add an intersection point at 0 distance
+    intersectionInfo.IntersectionDistanceFromStartPointMm = 0;
+    lineIntersections.push_back(intersectionInfo);
+  }
+
+  double scanLineDirectionVector_Model[4] = {0, 0, 0, 0};
+  referenceToModelMatrix->MultiplyPoint(scanLineDirectionVector_Reference, scanLineDirectionVector_Model);
+  vtkMath::Normalize(scanLineDirectionVector_Model);
+
+  for (; hitIt != hits.end(); ++hitIt)
+  {
+    for (int i = 0; i < 3; i++)
+    {
+      intersectionPoint_Model[i] = searchLineStartPoint_Model[i] + hitIt->LineParameter * searchLineVector_Model[i];
+    }
+    modelToReferenceMatrix->MultiplyPoint(intersectionPoint_Model, intersectionPoint_Reference);
+    intersectionInfo.IntersectionDistanceFromStartPointMm = sqrt(vtkMath::Distance2BetweenPoints(scanLineStartPoint_Reference, intersectionPoint_Reference));
+    double interpolatedNormal_Model[3] = {0, 0, 0};
+    this->TriangleBvh->GetInterpolatedNormal(*hitIt, interpolatedNormal_Model);
+    vtkMath::Normalize(interpolatedNormal_Model);
+    intersectionInfo.IntersectionIncidenceAngleRad = acos(vtkMath::Dot(interpolatedNormal_Model, scanLineDirectionVector_Model));
+    lineIntersections.push_back(intersectionInfo);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void PlusSpatialModel::GetReferenceToModelMatrix(vtkMatrix4x4* referenceToModelMatrix)
+{
+  vtkSmartPointer<vtkMatrix4x4> objectToModelMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  vtkMatrix4x4::Invert(this->ModelToObjectTransform, objectToModelMatrix);
+  vtkMatrix4x4::Multiply4x4(objectToModelMatrix, this->ReferenceToObjectTransform, referenceToModelMatrix);
+}
+
+//-----------------------------------------------------------------------------
+bool PlusSpatialModel::IsLineOutsideModelBounds(const double* lineStartPoint_Model, const double* lineEndPoint_Model) const
+{
+  // Slab test of the line segment and the bounding box
+  double minLineParameter = 0.0;
+  double maxLineParameter = 1.0;
+  for (int i = 0; i < 3; i++)
+  {
+    const double boundsMin = this->ModelBounds[2 * i];
+    const double boundsMax = this->ModelBounds[2 * i + 1];
+    const double lineVector = lineEndPoint_Model[i] - lineStartPoint_Model[i];
+    if (fabs(lineVector) < 1e-12)
+    {
+      if (lineStartPoint_Model[i] < boundsMin || lineStartPoint_Model[i] > boundsMax)
+      {
+        return true;
+      }
+      continue;
+    }
+    double t1 = (boundsMin - lineStartPoint_Model[i]) / lineVector;
+    double t2 = (boundsMax - lineStartPoint_Model[i]) / lineVector;
+    if (t1 > t2)
+    {
+      std::swap(t1, t2);
+    }
+    minLineParameter = std::max(minLineParameter, t1);
+    maxLineParameter = std::min(maxLineParameter, t2);
+    if (minLineParameter > maxLineParameter)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+//-----------------------------------------------------------------------------
+void PlusSpatialModel::GetCandidateLines(const std::vector<double>& scanLineStartPoints_Reference, const std::vector<double>& scanLineEndPoints_Reference,
+    int numberOfLines, vtkMatrix4x4* referenceToModelMatrix, std::vector<int>& candidateLineIndices) const
+{
+  candidateLineIndices.clear();
+
+  // Search line end points of all the lines in the Model coordinate system
+  std::vector<double> searchLineStartPoints_Model(3 * numberOfLines);
+  std::vector<double> searchLineEndPoints_Model(3 * numberOfLines);
+  for (int lineIndex = 0; lineIndex < numberOfLines; lineIndex++)
+  {
+    const double* scanLineStartPoint_Reference = &scanLineStartPoints_Reference[3 * lineIndex];
+    const double* scanLineEndPoint_Reference = &scanLineEndPoints_Reference[3 * lineIndex];
+    double scanLineDirectionVector_Reference[3] =
+    {
+      scanLineEndPoint_Reference[0] - scanLineStartPoint_Reference[0],
+      scanLineEndPoint_Reference[1] - scanLineStartPoint_Reference[1],
+      scanLineEndPoint_Reference[2] - scanLineStartPoint_Reference[2]
+    };
+    const double scanLineDirectionVectorNorm_Reference = vtkMath::Norm(scanLineDirectionVector_Reference);
+    double searchLineStartPoint_Reference[4] = {scanLineStartPoint_Reference[0], scanLineStartPoint_Reference[1], scanLineStartPoint_Reference[2], 1};
+    if (scanLineDirectionVectorNorm_Reference > 0)
+    {
+      for (int i = 0; i < 3; i++)
+      {
+        searchLineStartPoint_Reference[i] -= this->TransducerSpatialModelMaxOverlapMm * scanLineDirectionVector_Reference[i] / scanLineDirectionVectorNorm_Reference;
+      }
+    }
+    double scanLineEndPointHomogeneous_Reference[4] = {scanLineEndPoint_Reference[0], scanLineEndPoint_Reference[1], scanLineEndPoint_Reference[2], 1};
+
+    double searchLineStartPoint_Model[4] = {0, 0, 0, 1};
+    double searchLineEndPoint_Model[4] = {0, 0, 0, 1};
+    referenceToModelMatrix->MultiplyPoint(searchLineStartPoint_Reference, searchLineStartPoint_Model);
+    referenceToModelMatrix->MultiplyPoint(scanLineEndPointHomogeneous_Reference, searchLineEndPoint_Model);
+    std::copy(searchLineStartPoint_Model, searchLineStartPoint_Model + 3, searchLineStartPoints_Model.begin() + 3 * lineIndex);
+    std::copy(searchLineEndPoint_Model, searchLineEndPoint_Model + 3, searchLineEndPoints_Model.begin() + 3 * lineIndex);
+  }
+
+  for (int firstLineIndex = 0; firstLineIndex < numberOfLines; firstLineIndex += LINE_GROUP_SIZE)
+  {
+    const int lastLineIndex = std::min(firstLineIndex + LINE_GROUP_SIZE, numberOfLines);
+
+    // The lines of an image are in a plane, so the bounding box of neighbor lines is tight
+    double groupBounds_Model[6] = { VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX, VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX, VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX };
+    for (int lineIndex = firstLineIndex; lineIndex < lastLineIndex; lineIndex++)
+    {
+      for (int i = 0; i < 3; i++)
+      {
+        const double startCoordinate = searchLineStartPoints_Model[3 * lineIndex + i];
+        const double endCoordinate = searchLineEndPoints_Model[3 * lineIndex + i];
+        groupBounds_Model[2 * i] = std::min(groupBounds_Model[2 * i], std::min(startCoordinate, endCoordinate));
+        groupBounds_Model[2 * i + 1] = std::max(groupBounds_Model[2 * i + 1], std::max(startCoordinate, endCoordinate));
+      }
+    }
+    bool groupOutsideModelBounds = false;
+    for (int i = 0; i < 3; i++)
+    {
+      if (groupBounds_Model[2 * i + 1] < this->ModelBounds[2 * i] || groupBounds_Model[2 * i] > this->ModelBounds[2 * i + 1])
+      {
+        groupOutsideModelBounds = true;
+        break;
+      }
+    }
+    if (groupOutsideModelBounds)
+    {
+      continue;
+    }
+
+    for (int lineIndex = firstLineIndex; lineIndex < lastLineIndex; lineIndex++)
+    {
+      if (!IsLineOutsideModelBounds(&searchLineStartPoints_Model[3 * lineIndex], &searchLineEndPoints_Model[3 * lineIndex]))
+      {
+        candidateLineIndices.push_back(lineIndex);
+      }
+    }
+  }
+}
+
 //-----------------------------------------------------------------------------
 PlusStatus PlusSpatialModel::UpdateModelFile()
 {
@@ -461,6 +784,7 @@ PlusStatus PlusSpatialModel::UpdateModelFile()
 
   this->ModelFileNeedsUpdate = false;
 
+  this->TriangleBvh.reset();
   if (this->PolyData != NULL)
   {
     this->PolyData->Delete();
@@ -506,12 +830,39 @@ PlusStatus PlusSpatialModel::UpdateModelFile()
     return PLUS_FAIL;
   }
 
+  if (this->DecimationMaxErrorMm > 0)
+  {
+    vtkSmartPointer<vtkTriangleFilter> triangleFilter = vtkSmartPointer<vtkTriangleFilter>::New();
+    triangleFilter->SetInputData(polyData);
+    vtkSmartPointer<vtkDecimatePro> decimator = vtkSmartPointer<vtkDecimatePro>::New();
+    decimator->SetInputConnection(triangleFilter->GetOutputPort());
+    // The reduction is limited by the error, not by the target
+    decimator->SetTargetReduction(0.99);
+    decimator->PreserveTopologyOn();
+    decimator->SplittingOff();
+    decimator->BoundaryVertexDeletionOff();
+    decimator->ErrorIsAbsoluteOn();
+    decimator->SetAbsoluteError(this->DecimationMaxErrorMm);
+    decimator->Update();
+    LOG_DEBUG("Model " << this->ModelFile << " is decimated from " << polyData->GetNumberOfCells() << " to " << decimator->GetOutput()->GetNumberOfCells() << " cells");
+    polyData = decimator->GetOutput();
+  }
+
   vtkSmartPointer<vtkPolyDataNormals> polyDataNormalsComputer = vtkSmartPointer<vtkPolyDataNormals>::New();
   polyDataNormalsComputer->SetInputData(polyData);
   polyDataNormalsComputer->Update();
   this->PolyData = polyDataNormalsComputer->GetOutput();
   this->PolyData->Register(NULL);
+  this->PolyData->GetBounds(this->ModelBounds);
+
+  std::shared_ptr<PlusTriangleBvh> triangleBvh = std::make_shared<PlusTriangleBvh>();
+  if (triangleBvh->Build(this->PolyData) == PLUS_SUCCESS)
+  {
+    this->TriangleBvh = triangleBvh;
+    return PLUS_SUCCESS;
+  }
 
+  LOG_DEBUG("Model " << this->ModelFile << " cannot be stored in a triangle hierarchy, line intersections are computed using a BSP tree");
   this->ModelLocalizer->SetDataSet(this->PolyData);
   this->ModelLocalizer->SetMaxLevel(24);
   this->ModelLocalizer->SetNumberOfCellsPerNode(32);
@@ -531,14 +882,43 @@ void PlusSpatialModel::SetModelFile(const std::string& modelFile)
 }
 
 //-----------------------------------------------------------------------------
-void PlusSpatialModel::UpdatePrecomputedAttenuations(double intensityTransmittedFractionPerPixelTwoWay, int numberOfElements)
+void PlusSpatialModel::UpdateIntensityLookupTable(double distanceBetweenScanlineSamplePointsMm, unsigned int numberOfElements)
 {
-  this->PrecomputedAttenuations.resize(numberOfElements);
-  double attenuation = intensityTransmittedFractionPerPixelTwoWay;
-  for (int i = 0; i < numberOfElements; i++)
-  {
-    this->PrecomputedAttenuations[i] = attenuation;
-    attenuation *= intensityTransmittedFractionPerPixelTwoWay;
+  IntensityLookupTable& lookupTable = this->IntensityTable;
+  bool parametersChanged = (lookupTable.DistanceBetweenScanlineSamplePointsMm != distanceBetweenScanlineSamplePointsMm
+                            || lookupTable.ImagingFrequencyMhz != this->ImagingFrequencyMhz
+                            || lookupTable.AttenuationCoefficientDbPerCmMhz != this->AttenuationCoefficientDbPerCmMhz
+                            || lookupTable.SurfaceReflectionIntensityDecayDbPerMm != this->SurfaceReflectionIntensityDecayDbPerMm);
+  if (!parametersChanged && lookupTable.Attenuations.size() >= numberOfElements)
+  {
+    // the lookup table is up-to-date
+    return;
+  }
+
+  lookupTable.DistanceBetweenScanlineSamplePointsMm = distanceBetweenScanlineSamplePointsMm;
+  lookupTable.ImagingFrequencyMhz = this->ImagingFrequencyMhz;
+  lookupTable.AttenuationCoefficientDbPerCmMhz = this->AttenuationCoefficientDbPerCmMhz;
+  lookupTable.SurfaceReflectionIntensityDecayDbPerMm = this->SurfaceReflectionIntensityDecayDbPerMm;
+
+  double intensityAttenuationCoefficientdBPerPixel = this->AttenuationCoefficientDbPerCmMhz * (distanceBetweenScanlineSamplePointsMm / 10.0) * this->ImagingFrequencyMhz;
+  lookupTable.IntensityAttenuationCoefficientPerPixel = pow(10.0, -intensityAttenuationCoefficientdBPerPixel / 10.0);
+  lookupTable.IntensityTransmittedFractionPerPixelTwoWay = lookupTable.IntensityAttenuationCoefficientPerPixel * lookupTable.IntensityAttenuationCoefficientPerPixel;
+  lookupTable.LogIntensityTransmittedFractionPerPixelTwoWay = log(lookupTable.IntensityTransmittedFractionPerPixelTwoWay);
+  lookupTable.SurfaceReflectionIntensityDecayPerPixel = pow(10.0, -this->SurfaceReflectionIntensityDecayDbPerMm * distanceBetweenScanlineSamplePointsMm / 10.0);
+  lookupTable.LogSurfaceReflectionIntensityDecayPerPixel = log(lookupTable.SurfaceReflectionIntensityDecayPerPixel);
+
+  // Keep the tables large enough for the longest segment requested so far
+  numberOfElements = std::max<unsigned int>(numberOfElements, lookupTable.Attenuations.size());
+  lookupTable.Attenuations.resize(numberOfElements);
+  lookupTable.SurfaceReflectionDecays.resize(numberOfElements);
+  double attenuation = lookupTable.IntensityTransmittedFractionPerPixelTwoWay;
+  double surfaceReflectionDecay = 1.0;
+  for (unsigned int i = 0; i < numberOfElements; i++)
+  {
+    lookupTable.Attenuations[i] = attenuation;
+    attenuation *= lookupTable.IntensityTransmittedFractionPerPixelTwoWay;
+    lookupTable.SurfaceReflectionDecays[i] = surfaceReflectionDecay;
+    surfaceReflectionDecay *= lookupTable.SurfaceReflectionIntensityDecayPerPixel;
   }
 }
 
@@ -7,10 +7,14 @@
 #define __SpatialModel_h
 
 #include <deque>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "vtkPlusUsSimulatorExport.h"
 
+#include "PlusTriangleBvh.h"
+
 class vtkMatrix4x4;
 class vtkModifiedBSPTree;
 class vtkPolyData;
@@ -72,6 +76,15 @@ public:
   */
   void GetLineIntersections(std::deque<LineIntersectionInfo>& lineIntersections, double* scanLineStartPoint_Reference, double* scanLineEndPoint_Reference);
 
+  /*!
+    Get all the intersection points of the model and multiple lines (e.g., all the scanlines of an image).
+    Start and end points are stored as consecutive x, y, z coordinates in the Reference coordinate system.
+    The intersections with the i-th line are appended to lineIntersections[i], the number of lines is the size of lineIntersections.
+    Lines are processed in parallel on numberOfThreads threads of the shared worker pool (0 = all threads).
+  */
+  void GetLineIntersections(std::vector< std::deque<LineIntersectionInfo> >& lineIntersections,
+                            const std::vector<double>& scanLineStartPoints_Reference, const std::vector<double>& scanLineEndPoints_Reference, int numberOfThreads);
+
   double GetAcousticImpedanceMegarayls();
 
   /*!
@@ -83,6 +96,13 @@ public:
   void CalculateIntensity(std::vector<double>& reflectedIntensity, unsigned int numberOfFilledPixels, double distanceBetweenScanlineSamplePointsMm,
                           double previousModelAcousticImpedanceMegarayls, double incidentIntensity, double& transmittedIntensity, double incidenceAngleRad);
 
+  /*!
+    Update the internal data that CalculateIntensity needs for segments of up to maximumNumberOfFilledPixels pixels.
+    After this CalculateIntensity does not modify the model (if the imaging frequency and sample point distance do not change),
+    so it can be called from multiple threads at the same time.
+  */
+  void PrepareIntensityCalculation(double distanceBetweenScanlineSamplePointsMm, unsigned int maximumNumberOfFilledPixels);
+
   SetMacro(DensityKgPerM3, double);
   SetMacro(SoundVelocityMPerSec, double);
   SetMacro(AttenuationCoefficientDbPerCmMhz, double);
@@ -91,6 +111,7 @@ public:
   SetMacro(SurfaceDiffuseReflectionCoefficient, double);
   SetMacro(SurfaceSpecularReflectionCoefficient, double);
   SetMacro(TransducerSpatialModelMaxOverlapMm, double);
+  SetMacro(DecimationMaxErrorMm, double);
 
 protected:
   void SetPolyData(vtkPolyData* polyData);
@@ -99,7 +120,30 @@ protected:
   void SetModelToObjectTransform(double* matrixElements);
 
   PlusStatus UpdateModelFile();
-  void UpdatePrecomputedAttenuations(double intensityTransmittedFractionPerPixelTwoWay, int numberOfElements);
+
+  /*! Compute the transform from the Reference to the Model coordinate system */
+  void GetReferenceToModelMatrix(vtkMatrix4x4* referenceToModelMatrix);
+
+  /*! Returns true if the line segment (in the Model coordinate system) cannot intersect the model, as it does not intersect its bounding box */
+  bool IsLineOutsideModelBounds(const double* lineStartPoint_Model, const double* lineEndPoint_Model) const;
+
+  /*!
+    Get the indices of the lines that may intersect the model. Consecutive lines (e.g., neighbor scanlines) are grouped,
+    and the lines of groups whose bounding box does not intersect the bounding box of the model are skipped without
+    testing them individually. The search line extension inside the transducer (TransducerSpatialModelMaxOverlapMm) is included.
+  */
+  void GetCandidateLines(const std::vector<double>& scanLineStartPoints_Reference, const std::vector<double>& scanLineEndPoints_Reference,
+                         int numberOfLines, vtkMatrix4x4* referenceToModelMatrix, std::vector<int>& candidateLineIndices) const;
+
+  /*!
+    Get the intersections of the model and a line using the triangle hierarchy. Does not modify the model, so it can be called from multiple threads.
+    The hits buffer is only used for temporary storage, it is reused between calls to avoid memory allocations.
+  */
+  void GetLineIntersectionsWithTriangleBvh(std::deque<LineIntersectionInfo>& lineIntersections, const double* scanLineStartPoint_Reference, const double* scanLineEndPoint_Reference,
+      vtkMatrix4x4* referenceToModelMatrix, vtkMatrix4x4* modelToReferenceMatrix, std::vector<PlusTriangleBvh::Hit>& hits);
+
+  /*! Recompute IntensityTable if the parameters it depends on have changed or it has less than numberOfElements elements */
+  void UpdateIntensityLookupTable(double distanceBetweenScanlineSamplePointsMm, unsigned int numberOfElements);
 
 protected:
   //PlusStatus LoadModel(const std::string& absoluteImagePath);
@@ -184,13 +228,57 @@ protected:
   */
   double SurfaceDiffuseReflectionCoefficient;
 
+  /*!
+    If positive, the surface mesh is simplified when it is loaded, so that it approximately deviates from the original
+    surface by at most this distance (in the units of the model file, normally mm). Topology is preserved, so that closed
+    surfaces remain closed. Reduces the time of computing the line intersections of models that have many small triangles.
+  */
+  double DecimationMaxErrorMm;
+
+  /*! Bounding box of the surface mesh in the Model coordinate system (xmin, xmax, ymin, ymax, zmin, zmax) */
+  double ModelBounds[6];
+
+  /*! Used for computing line intersections if the mesh cannot be stored in TriangleBvh (it contains non-triangle cells) */
   vtkModifiedBSPTree* ModelLocalizer;
 
+  /*! Bounding volume hierarchy of the triangles of the surface mesh. Not modified after it is built, shared between the copies of the model. */
+  std::shared_ptr<PlusTriangleBvh> TriangleBvh;
+
   /*! Surface mesh. Points are stored in the Model coordinate system (as in the input file) */
   vtkPolyData* PolyData;
 
-  /*! List of attenuations: intensityTransmittedFractionPerPixelTwoWay, intensityTransmittedFractionPerPixelTwoWay^2, intensityTransmittedFractionPerPixelTwoWay^3, ... */
-  std::vector<double> PrecomputedAttenuations;
+  /*! Values used by CalculateIntensity that only change if the material, the imaging frequency, or the sample point distance changes */
+  struct IntensityLookupTable
+  {
+    IntensityLookupTable()
+      : DistanceBetweenScanlineSamplePointsMm(-1.0)
+      , ImagingFrequencyMhz(0.0)
+      , AttenuationCoefficientDbPerCmMhz(0.0)
+      , SurfaceReflectionIntensityDecayDbPerMm(0.0)
+      , IntensityAttenuationCoefficientPerPixel(1.0)
+      , IntensityTransmittedFractionPerPixelTwoWay(1.0)
+      , LogIntensityTransmittedFractionPerPixelTwoWay(0.0)
+      , SurfaceReflectionIntensityDecayPerPixel(1.0)
+      , LogSurfaceReflectionIntensityDecayPerPixel(0.0)
+    {
+    }
+    // Parameters that the table was computed for
+    double DistanceBetweenScanlineSamplePointsMm;
+    double ImagingFrequencyMhz;
+    double AttenuationCoefficientDbPerCmMhz;
+    double SurfaceReflectionIntensityDecayDbPerMm;
+    // Ratio of (transmitted beam intensity / incident beam intensity) after traversing through a single pixel
+    double IntensityAttenuationCoefficientPerPixel;
+    double IntensityTransmittedFractionPerPixelTwoWay;
+    double LogIntensityTransmittedFractionPerPixelTwoWay;
+    double SurfaceReflectionIntensityDecayPerPixel;
+    double LogSurfaceReflectionIntensityDecayPerPixel;
+    /*! List of attenuations: intensityTransmittedFractionPerPixelTwoWay, intensityTransmittedFractionPerPixelTwoWay^2, intensityTransmittedFractionPerPixelTwoWay^3, ... */
+    std::vector<double> Attenuations;
+    /*! List of surface reflection decays: 1, surfaceReflectionIntensityDecayPerPixel, surfaceReflectionIntensityDecayPerPixel^2, ... */
+    std::vector<double> SurfaceReflectionDecays;
+  };
+  IntensityLookupTable IntensityTable;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,298 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+
+#include "PlusTriangleBvh.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "vtkCellType.h"
+#include "vtkDataArray.h"
+#include "vtkIdList.h"
+#include "vtkPointData.h"
+#include "vtkPolyData.h"
+#include "vtkSmartPointer.h"
+
+// Nodes with this many triangles or less are not split further
+const int BVH_MAX_NUMBER_OF_TRIANGLES_PER_LEAF = 4;
+
+// Nodes are split at the median, therefore the depth of the tree is about log2(numberOfTriangles)
+const int BVH_MAX_TRAVERSAL_STACK_SIZE = 64;
+
+//-----------------------------------------------------------------------------
+PlusTriangleBvh::PlusTriangleBvh()
+{
+}
+
+//-----------------------------------------------------------------------------
+PlusTriangleBvh::~PlusTriangleBvh()
+{
+}
+
+//-----------------------------------------------------------------------------
+bool PlusTriangleBvh::IsEmpty() const
+{
+  return this->Nodes.empty();
+}
+
+//-----------------------------------------------------------------------------
+int PlusTriangleBvh::GetNumberOfTriangles() const
+{
+  return static_cast<int>(this->TriangleVertices.size() / 9);
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus PlusTriangleBvh::Build(vtkPolyData* polyData)
+{
+  this->Nodes.clear();
+  this->TriangleVertices.clear();
+  this->TriangleNormals.clear();
+
+  if (polyData == NULL)
+  {
+    LOG_ERROR("PlusTriangleBvh::Build failed: invalid mesh");
+    return PLUS_FAIL;
+  }
+  vtkDataArray* normals = (polyData->GetPointData() != NULL ? polyData->GetPointData()->GetNormals() : NULL);
+  if (normals == NULL)
+  {
+    LOG_DEBUG("PlusTriangleBvh::Build failed: the mesh has no point normals");
+    return PLUS_FAIL;
+  }
+
+  vtkIdType numberOfCells = polyData->GetNumberOfCells();
+  std::vector<double> vertices;
+  std::vector<double> vertexNormals;
+  std::vector<double> centroids;
+  vertices.reserve(9 * numberOfCells);
+  vertexNormals.reserve(9 * numberOfCells);
+  centroids.reserve(3 * numberOfCells);
+  vtkSmartPointer<vtkIdList> pointIds = vtkSmartPointer<vtkIdList>::New();
+  for (vtkIdType cellId = 0; cellId < numberOfCells; ++cellId)
+  {
+    if (polyData->GetCellType(cellId) != VTK_TRIANGLE)
+    {
+      LOG_DEBUG("PlusTriangleBvh::Build failed: the mesh contains non-triangle cells");
+      return PLUS_FAIL;
+    }
+    polyData->GetCellPoints(cellId, pointIds);
+    double centroid[3] = {0, 0, 0};
+    for (int cornerIndex = 0; cornerIndex < 3; ++cornerIndex)
+    {
+      double point[3] = {0, 0, 0};
+      double normal[3] = {0, 0, 0};
+      polyData->GetPoint(pointIds->GetId(cornerIndex), point);
+      normals->GetTuple(pointIds->GetId(cornerIndex), normal);
+      for (int i = 0; i < 3; ++i)
+      {
+        vertices.push_back(point[i]);
+        vertexNormals.push_back(normal[i]);
+        centroid[i] += point[i] / 3.0;
+      }
+    }
+    centroids.insert(centroids.end(), centroid, centroid + 3);
+  }
+
+  int numberOfTriangles = static_cast<int>(numberOfCells);
+  if (numberOfTriangles == 0)
+  {
+    return PLUS_SUCCESS;
+  }
+
+  std::vector<int> triangleIds(numberOfTriangles);
+  for (int triangleIndex = 0; triangleIndex < numberOfTriangles; ++triangleIndex)
+  {
+    triangleIds[triangleIndex] = triangleIndex;
+  }
+  this->Nodes.reserve(2 * (numberOfTriangles / BVH_MAX_NUMBER_OF_TRIANGLES_PER_LEAF + 1));
+  BuildNode(triangleIds, centroids, vertices, 0, numberOfTriangles);
+
+  // Store the triangles in the order of the leaves so that each leaf refers to a contiguous range
+  this->TriangleVertices.resize(9 * numberOfTriangles);
+  this->TriangleNormals.resize(9 * numberOfTriangles);
+  for (int triangleIndex = 0; triangleIndex < numberOfTriangles; ++triangleIndex)
+  {
+    std::copy(vertices.begin() + 9 * triangleIds[triangleIndex], vertices.begin() + 9 * triangleIds[triangleIndex] + 9, this->TriangleVertices.begin() + 9 * triangleIndex);
+    std::copy(vertexNormals.begin() + 9 * triangleIds[triangleIndex], vertexNormals.begin() + 9 * triangleIds[triangleIndex] + 9, this->TriangleNormals.begin() + 9 * triangleIndex);
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+int PlusTriangleBvh::BuildNode(std::vector<int>& triangleIds, const std::vector<double>& centroids, const std::vector<double>& vertices, int first, int last)
+{
+  int nodeIndex = static_cast<int>(this->Nodes.size());
+  this->Nodes.push_back(Node());
+
+  // Bounds of the triangles and of their centroids
+  double boundsMin[3] = { std::numeric_limits<double>::max(), std::numeric_limits<double>::max(), std::numeric_limits<double>::max() };
+  double boundsMax[3] = { -std::numeric_limits<double>::max(), -std::numeric_limits<double>::max(), -std::numeric_limits<double>::max() };
+  double centroidMin[3] = { boundsMin[0], boundsMin[1], boundsMin[2] };
+  double centroidMax[3] = { boundsMax[0], boundsMax[1], boundsMax[2] };
+  for (int i = first; i < last; ++i)
+  {
+    const double* triangleVertices = &vertices[9 * triangleIds[i]];
+    const double* centroid = &centroids[3 * triangleIds[i]];
+    for (int axis = 0; axis < 3; ++axis)
+    {
+      for (int cornerIndex = 0; cornerIndex < 3; ++cornerIndex)
+      {
+        boundsMin[axis] = std::min(boundsMin[axis], triangleVertices[3 * cornerIndex + axis]);
+        boundsMax[axis] = std::max(boundsMax[axis], triangleVertices[3 * cornerIndex + axis]);
+      }
+      centroidMin[axis] = std::min(centroidMin[axis], centroid[axis]);
+      centroidMax[axis] = std::max(centroidMax[axis], centroid[axis]);
+    }
+  }
+  std::copy(boundsMin, boundsMin + 3, this->Nodes[nodeIndex].BoundsMin);
+  std::copy(boundsMax, boundsMax + 3, this->Nodes[nodeIndex].BoundsMax);
+
+  if (last - first <= BVH_MAX_NUMBER_OF_TRIANGLES_PER_LEAF)
+  {
+    this->Nodes[nodeIndex].FirstIndex = first;
+    this->Nodes[nodeIndex].NumberOfTriangles = last - first;
+    return nodeIndex;
+  }
+
+  // Split at the median of the centroids along the longest axis
+  int splitAxis = 0;
+  for (int axis = 1; axis < 3; ++axis)
+  {
+    if (centroidMax[axis] - centroidMin[axis] > centroidMax[splitAxis] - centroidMin[splitAxis])
+    {
+      splitAxis = axis;
+    }
+  }
+  int middle = first + (last - first) / 2;
+  std::nth_element(triangleIds.begin() + first, triangleIds.begin() + middle, triangleIds.begin() + last,
+                   [&centroids, splitAxis](int a, int b) { return centroids[3 * a + splitAxis] < centroids[3 * b + splitAxis]; });
+
+  // The first child is always the next node, only the index of the second child has to be stored
+  BuildNode(triangleIds, centroids, vertices, first, middle);
+  int secondChildIndex = BuildNode(triangleIds, centroids, vertices, middle, last);
+  this->Nodes[nodeIndex].FirstIndex = secondChildIndex;
+  this->Nodes[nodeIndex].NumberOfTriangles = 0;
+  return nodeIndex;
+}
+
+//-----------------------------------------------------------------------------
+void PlusTriangleBvh::IntersectWithLine(const double lineStartPoint[3], const double lineVector[3], std::vector<Hit>& hits) const
+{
+  if (this->Nodes.empty())
+  {
+    return;
+  }
+
+  double inverseLineVector[3] = {0, 0, 0};
+  for (int axis = 0; axis < 3; ++axis)
+  {
+    inverseLineVector[axis] = (lineVector[axis] != 0.0 ? 1.0 / lineVector[axis] : std::numeric_limits<double>::max());
+  }
+
+  int nodeStack[BVH_MAX_TRAVERSAL_STACK_SIZE];
+  int stackSize = 0;
+  nodeStack[stackSize++] = 0;
+  while (stackSize > 0)
+  {
+    const Node& node = this->Nodes[nodeStack[--stackSize]];
+
+    // Slab test of the line segment (parameter range 0..1) and the node bounding box
+    double parameterMin = 0.0;
+    double parameterMax = 1.0;
+    for (int axis = 0; axis < 3 && parameterMin <= parameterMax; ++axis)
+    {
+      double parameterNear = (node.BoundsMin[axis] - lineStartPoint[axis]) * inverseLineVector[axis];
+      double parameterFar = (node.BoundsMax[axis] - lineStartPoint[axis]) * inverseLineVector[axis];
+      if (parameterNear > parameterFar)
+      {
+        std::swap(parameterNear, parameterFar);
+      }
+      parameterMin = std::max(parameterMin, parameterNear);
+      parameterMax = std::min(parameterMax, parameterFar);
+    }
+    if (parameterMin > parameterMax)
+    {
+      continue;
+    }
+
+    if (node.NumberOfTriangles == 0)
+    {
+      if (stackSize + 2 > BVH_MAX_TRAVERSAL_STACK_SIZE)
+      {
+        LOG_ERROR("PlusTriangleBvh::IntersectWithLine: traversal stack is full, some intersections are ignored");
+        continue;
+      }
+      nodeStack[stackSize++] = node.FirstIndex;
+      nodeStack[stackSize++] = static_cast<int>(&node - &this->Nodes[0]) + 1;
+      continue;
+    }
+
+    // Moller-Trumbore line-triangle intersection
+    for (int triangleIndex = node.FirstIndex; triangleIndex < node.FirstIndex + node.NumberOfTriangles; ++triangleIndex)
+    {
+      const double* v0 = &this->TriangleVertices[9 * triangleIndex];
+      const double* v1 = v0 + 3;
+      const double* v2 = v0 + 6;
+      double edge1[3] = { v1[0] - v0[0], v1[1] - v0[1], v1[2] - v0[2] };
+      double edge2[3] = { v2[0] - v0[0], v2[1] - v0[1], v2[2] - v0[2] };
+      double p[3] =
+      {
+        lineVector[1] * edge2[2] - lineVector[2] * edge2[1],
+        lineVector[2] * edge2[0] - lineVector[0] * edge2[2],
+        lineVector[0] * edge2[1] - lineVector[1] * edge2[0]
+      };
+      double determinant = edge1[0] * p[0] + edge1[1] * p[1] + edge1[2] * p[2];
+      if (determinant == 0.0)
+      {
+        // the line is parallel to the triangle
+        continue;
+      }
+      double inverseDeterminant = 1.0 / determinant;
+      double s[3] = { lineStartPoint[0] - v0[0], lineStartPoint[1] - v0[1], lineStartPoint[2] - v0[2] };
+      double u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * inverseDeterminant;
+      if (u < 0.0 || u > 1.0)
+      {
+        continue;
+      }
+      double q[3] =
+      {
+        s[1] * edge1[2] - s[2] * edge1[1],
+        s[2] * edge1[0] - s[0] * edge1[2],
+        s[0] * edge1[1] - s[1] * edge1[0]
+      };
+      double v = (lineVector[0] * q[0] + lineVector[1] * q[1] + lineVector[2] * q[2]) * inverseDeterminant;
+      if (v < 0.0 || u + v > 1.0)
+      {
+        continue;
+      }
+      double lineParameter = (edge2[0] * q[0] + edge2[1] * q[1] + edge2[2] * q[2]) * inverseDeterminant;
+      if (lineParameter < 0.0 || lineParameter > 1.0)
+      {
+        continue;
+      }
+      Hit hit;
+      hit.LineParameter = lineParameter;
+      hit.TriangleIndex = triangleIndex;
+      hit.U = u;
+      hit.V = v;
+      hits.push_back(hit);
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+void PlusTriangleBvh::GetInterpolatedNormal(const Hit& hit, double normal[3]) const
+{
+  const double* cornerNormals = &this->TriangleNormals[9 * hit.TriangleIndex];
+  double w0 = 1.0 - hit.U - hit.V;
+  for (int i = 0; i < 3; ++i)
+  {
+    normal[i] = w0 * cornerNormals[i] + hit.U * cornerNormals[3 + i] + hit.V * cornerNormals[6 + i];
+  }
+}
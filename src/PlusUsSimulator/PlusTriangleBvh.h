@@ -0,0 +1,89 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+#ifndef __PlusTriangleBvh_h
+#define __PlusTriangleBvh_h
+
+#include <vector>
+
+#include "vtkPlusUsSimulatorExport.h"
+
+class vtkPolyData;
+
+/*!
+  \class PlusTriangleBvh
+  \brief Bounding volume hierarchy of the triangles of a surface mesh, for computing line intersections
+
+  Nodes are stored in depth-first order in a flat array and the triangle vertices and point normals are copied
+  in the order of the leaves, so the intersections of a line can be computed without any memory allocation
+  (if the hits buffer is already large enough). The structure is not modified after it is built, therefore
+  intersections can be computed from multiple threads at the same time.
+
+  \ingroup PlusLibUsSimulatorAlgo
+*/
+class vtkPlusUsSimulatorExport PlusTriangleBvh
+{
+public:
+  /*! Intersection of a line and a triangle */
+  struct Hit
+  {
+    /*! Position of the intersection along the line: 0 = line start point, 1 = line end point */
+    double LineParameter;
+    /*! Index of the triangle in the order that the triangles are stored in the hierarchy */
+    int TriangleIndex;
+    /*! Barycentric coordinates of the intersection point in the triangle (weight of the second and third vertex) */
+    double U;
+    double V;
+
+    bool operator<(const Hit& other) const { return this->LineParameter < other.LineParameter; }
+  };
+
+  PlusTriangleBvh();
+  virtual ~PlusTriangleBvh();
+
+  /*!
+    Build the hierarchy from the triangles of the mesh. Point normals are copied from the point data of the mesh.
+    Fails if the mesh contains cells other than triangles or it does not have point normals.
+  */
+  PlusStatus Build(vtkPolyData* polyData);
+
+  /*! Returns true if the hierarchy contains no triangles */
+  bool IsEmpty() const;
+
+  int GetNumberOfTriangles() const;
+
+  /*!
+    Append all intersections of the triangles with the line segment between lineStartPoint and lineStartPoint + lineVector to hits.
+    The hits are not sorted.
+  */
+  void IntersectWithLine(const double lineStartPoint[3], const double lineVector[3], std::vector<Hit>& hits) const;
+
+  /*! Get the point normal interpolated at the intersection point. The result is not normalized. */
+  void GetInterpolatedNormal(const Hit& hit, double normal[3]) const;
+
+protected:
+  struct Node
+  {
+    double BoundsMin[3];
+    double BoundsMax[3];
+    /*! Leaf node: index of the first triangle. Inner node: index of the second child node (the first child node is the next node). */
+    int FirstIndex;
+    /*! Number of triangles in a leaf node, 0 for inner nodes */
+    int NumberOfTriangles;
+  };
+
+  /*! Create the node of the triangles in [first, last) of the triangleIds list and its child nodes. Returns the index of the created node. */
+  int BuildNode(std::vector<int>& triangleIds, const std::vector<double>& centroids, const std::vector<double>& vertices, int first, int last);
+
+  std::vector<Node> Nodes;
+
+  /*! Coordinates of the three vertices of each triangle (9 values per triangle) */
+  std::vector<double> TriangleVertices;
+
+  /*! Point normals at the three vertices of each triangle (9 values per triangle) */
+  std::vector<double> TriangleNormals;
+};
+
+#endif
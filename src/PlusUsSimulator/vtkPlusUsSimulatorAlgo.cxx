@@ -7,6 +7,8 @@ See License.txt for details.
 #include "PlusConfigure.h"
 
 #include <algorithm>
+#include <atomic>
+#include <cstring>
 #include <list>
 #include <map>
 
@@ -28,11 +30,11 @@ See License.txt for details.
 #include "vtkPolyData.h"
 #include "vtksys/SystemTools.hxx"
 
+#include "PlusWorkerPool.h"
 #include "vtkPlusRfProcessor.h"
 #include "vtkPlusUsScanConvert.h"
 
 // For noise generation
-#include "vtkLineSource.h"
 #include "vtkPerlinNoise.h"
 #include "vtkProbeFilter.h"
 #include "vtkSampleFunction.h"
@@ -68,6 +70,15 @@ vtkPlusUsSimulatorAlgo::vtkPlusUsSimulatorAlgo()
   this->NoisePhase[0] = 0;
   this->NoisePhase[1] = 0;
   this->NoisePhase[2] = 0;
+  this->NoiseResolutionMm = 0;
+
+  this->NumberOfThreads = 0;
+
+  this->BrightnessLookupTableEnabled = false;
+  // Make sure the lookup table is built for the first frame
+  this->BrightnessLookupTableParameters[0] = -1;
+  this->BrightnessLookupTableParameters[1] = 0;
+  this->BrightnessLookupTableParameters[2] = 0;
 
   // this->TransducerSpatialModel doesn't have to be initialized, as the default parameters of SpatialModel
   // are for soft tissue that should match the transducer material in acoustic impedance
@@ -112,6 +123,36 @@ inline double fastPow(double a, double b)
   return u.d;
 }
 
+namespace
+{
+  // Intensities whose upper 32 bits are at or above this are negative, infinite or not a number
+  const unsigned int INVALID_INTENSITY_HIGH_WORD = 0x7FF00000;
+
+  //-----------------------------------------------------------------------------
+  unsigned int GetHighWord(double value)
+  {
+    vtkTypeUInt64 bits = 0;
+    memcpy(&bits, &value, sizeof(bits));
+    return static_cast<unsigned int>(bits >> 32);
+  }
+
+  //-----------------------------------------------------------------------------
+  unsigned char ConvertToBrightness(double intensity, double gamma, double offset, double scale)
+  {
+    return std::max(std::min(offset + scale * fastPow(intensity, gamma), 255.0), 0.0);
+  }
+
+  //-----------------------------------------------------------------------------
+  /*! Brightness of the intensities with the given upper 32 bits (fastPow ignores the lower 32 bits) */
+  unsigned char ConvertHighWordToBrightness(unsigned int highWord, double gamma, double offset, double scale)
+  {
+    vtkTypeUInt64 bits = static_cast<vtkTypeUInt64>(highWord) << 32;
+    double intensity = 0;
+    memcpy(&intensity, &bits, sizeof(intensity));
+    return ConvertToBrightness(intensity, gamma, offset, scale);
+  }
+}
+
 //-----------------------------------------------------------------------------
 int vtkPlusUsSimulatorAlgo::RequestData(vtkInformation* request, vtkInformationVector** inputVector, vtkInformationVector* outputVector)
 {
@@ -153,12 +194,9 @@ int vtkPlusUsSimulatorAlgo::RequestData(vtkInformation* request, vtkInformationV
   double distanceBetweenScanlineSamplePointsMm = scanConverter->GetDistanceBetweenScanlineSamplePointsMm();
 
   // Initialize noise generator
-  vtkSmartPointer<vtkLineSource> noiseSamplerLine_Reference = vtkSmartPointer<vtkLineSource>::New();
   vtkSmartPointer<vtkPerlinNoise> noiseFunction = vtkSmartPointer<vtkPerlinNoise>::New();
-  double samplePointPosition_Reference[3] = {0, 0, 0};
   if (this->NoiseAmplitude > 0)
   {
-    noiseSamplerLine_Reference->SetResolution(this->NumberOfSamplesPerScanline - 1);
     noiseFunction->SetAmplitude(this->NoiseAmplitude);
     noiseFunction->SetFrequency(this->NoiseFrequency);
     noiseFunction->SetPhase(this->NoisePhase);
@@ -186,10 +224,6 @@ int vtkPlusUsSimulatorAlgo::RequestData(vtkInformation* request, vtkInformationV
   vtkSmartPointer<vtkMatrix4x4> referenceToImageMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
   vtkMatrix4x4::Invert(imageToReferenceMatrix, referenceToImageMatrix);
 
-  // Create a few variables outside the loop to avoid reallocations and to make the code easier to read
-  vtkPoints* samplePointPositions_Reference = 0;
-  // Create a buffer outside the for loop to allow reusing it
-  std::vector<double> intensities;
   // scanline start/end positions in Image and Reference coordinate systems
   double scanLineStartPoint_Image[4] = {0, 0, 0, 1};
   double scanLineEndPoint_Image[4] = {0, 0, 0, 1};
@@ -212,116 +246,271 @@ int vtkPlusUsSimulatorAlgo::RequestData(vtkInformation* request, vtkInformationV
     spatialModelIt->SetReferenceToObjectTransform(referenceToObjectMatrix);
   }
 
+  // Compute the intersections of all the scanlines with each model at once
+  this->ScanLineStartPoints_Reference.resize(3 * this->NumberOfScanlines);
+  this->ScanLineEndPoints_Reference.resize(3 * this->NumberOfScanlines);
   for (int scanLineIndex = 0; scanLineIndex < this->NumberOfScanlines; scanLineIndex++)
   {
     scanConverter->GetScanLineEndPoints(scanLineIndex, scanLineStartPoint_Image, scanLineEndPoint_Image);
     imageToReferenceMatrix->MultiplyPoint(scanLineStartPoint_Image, scanLineStartPoint_Reference);
     imageToReferenceMatrix->MultiplyPoint(scanLineEndPoint_Image, scanLineEndPoint_Reference);
+    std::copy(scanLineStartPoint_Reference, scanLineStartPoint_Reference + 3, this->ScanLineStartPoints_Reference.begin() + 3 * scanLineIndex);
+    std::copy(scanLineEndPoint_Reference, scanLineEndPoint_Reference + 3, this->ScanLineEndPoints_Reference.begin() + 3 * scanLineIndex);
+  }
+  this->ScanLineIntersections.resize(this->NumberOfScanlines);
+  for (std::vector< std::deque<PlusSpatialModel::LineIntersectionInfo> >::iterator scanLineIt = this->ScanLineIntersections.begin(); scanLineIt != this->ScanLineIntersections.end(); ++scanLineIt)
+  {
+    scanLineIt->clear();
+  }
+  for (std::vector<PlusSpatialModel>::iterator spatialModelIt = this->SpatialModels.begin(); spatialModelIt != this->SpatialModels.end(); ++spatialModelIt)
+  {
+    // Append line intersections found with this model to the intersections of each scanline
+    spatialModelIt->GetLineIntersections(this->ScanLineIntersections, this->ScanLineStartPoints_Reference, this->ScanLineEndPoints_Reference, this->NumberOfThreads);
+  }
 
-    if (this->NoiseAmplitude > 0)
+  // After this the models are not modified by CalculateIntensity, so scanlines can be computed in parallel
+  for (std::vector<PlusSpatialModel>::iterator spatialModelIt = this->SpatialModels.begin(); spatialModelIt != this->SpatialModels.end(); ++spatialModelIt)
+  {
+    spatialModelIt->PrepareIntensityCalculation(distanceBetweenScanlineSamplePointsMm, this->NumberOfSamplesPerScanline);
+  }
+
+  this->UpdateBrightnessLookupTable();
+
+  // Each scanline is written to a separate row of the image
+  unsigned char* scanLinePixels = static_cast<unsigned char*>(scanLines->GetScalarPointer());
+  std::atomic<bool> scanLineSimulationFailed(false);
+  PlusWorkerPool::GetInstance().ParallelFor(0, this->NumberOfScanlines, this->NumberOfThreads, [&](int firstScanLineIndex, int lastScanLineIndex)
+  {
+    // Buffers of this task, reused for all its scanlines
+    std::vector<double> intensities;
+    std::vector<double> noiseValues;
+    for (int scanLineIndex = firstScanLineIndex; scanLineIndex < lastScanLineIndex; scanLineIndex++)
     {
-      noiseSamplerLine_Reference->SetPoint1(scanLineStartPoint_Reference);
-      noiseSamplerLine_Reference->SetPoint2(scanLineEndPoint_Reference);
-      noiseSamplerLine_Reference->Update();
-      samplePointPositions_Reference = noiseSamplerLine_Reference->GetOutput()->GetPoints();
+      unsigned char* dstPixelAddress = scanLinePixels + scanLineIndex * this->NumberOfSamplesPerScanline;
+      if (SimulateScanLine(scanLineIndex, dstPixelAddress, distanceBetweenScanlineSamplePointsMm, noiseFunction, intensities, noiseValues) != PLUS_SUCCESS)
+      {
+        scanLineSimulationFailed = true;
+      }
     }
+  });
+  if (scanLineSimulationFailed)
+  {
+    return 0;
+  }
 
-    // Get model intersection positions along the scanline for all the models
-    std::deque<PlusSpatialModel::LineIntersectionInfo> lineIntersectionsWithModels;
-    for (std::vector<PlusSpatialModel>::iterator spatialModelIt = this->SpatialModels.begin(); spatialModelIt != this->SpatialModels.end(); ++spatialModelIt)
+  vtkImageData* simulatedUsImage = vtkImageData::SafeDownCast(outInfo->Get(vtkDataObject::DATA_OBJECT()));
+  if (simulatedUsImage == NULL)
+  {
+    LOG_ERROR("vtkPlusUsSimulatorAlgo output type is invalid");
+    return 0;
+  }
+  this->RfProcessor->SetRfFrame(scanLines, US_IMG_BRIGHTNESS);
+  simulatedUsImage->DeepCopy(this->RfProcessor->GetBrightnessScanConvertedImage());
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusUsSimulatorAlgo::SimulateScanLine(int scanLineIndex, unsigned char* dstPixelAddress, double distanceBetweenScanlineSamplePointsMm,
+    vtkPerlinNoise* noiseFunction, std::vector<double>& intensities, std::vector<double>& noiseValues)
+{
+  // Model intersection positions along the scanline for all the models
+  std::deque<PlusSpatialModel::LineIntersectionInfo>& lineIntersectionsWithModels = this->ScanLineIntersections[scanLineIndex];
+
+  ConvertLineModelIntersectionsToSegmentDescriptor(lineIntersectionsWithModels);
+
+  int currentPixelIndex = 0;
+  double incomingBeamIntensity = this->IncomingIntensityMwPerCm2 * 1000;
+  int numIntersectionPoints = lineIntersectionsWithModels.size();
+  if (numIntersectionPoints < 1)
+  {
+    LOG_ERROR("No intersections with any SpatialObjects. Probably no background object is specified.");
+    return PLUS_FAIL;
+  }
+  if (this->NoiseAmplitude > 0)
+  {
+    ComputeScanLineNoise(scanLineIndex, distanceBetweenScanlineSamplePointsMm, noiseFunction, noiseValues);
+  }
+
+  PlusSpatialModel* previousModel = &this->TransducerSpatialModel;
+  for (vtkIdType intersectionIndex = 0; (intersectionIndex <= numIntersectionPoints) && (currentPixelIndex < this->NumberOfSamplesPerScanline); intersectionIndex++)
+  {
+    // determine end of segment position and pixel color
+    int endOfSegmentPixelIndex = currentPixelIndex;
+    double distanceOfIntersectionPointFromScanLineStartPointMm = 0; // defined here to allow for access later on in code
+    if (intersectionIndex + 1 < numIntersectionPoints)
+    {
+      distanceOfIntersectionPointFromScanLineStartPointMm = lineIntersectionsWithModels[intersectionIndex + 1].IntersectionDistanceFromStartPointMm;
+      endOfSegmentPixelIndex = distanceOfIntersectionPointFromScanLineStartPointMm / distanceBetweenScanlineSamplePointsMm;
+      if (endOfSegmentPixelIndex > this->NumberOfSamplesPerScanline)
+      {
+        // the next intersection point is out of the image
+        endOfSegmentPixelIndex = this->NumberOfSamplesPerScanline;
+      }
+    }
+    else
     {
-      // Append line intersections found with this model to lineIntersectionsWithModels
-      spatialModelIt->GetLineIntersections(lineIntersectionsWithModels, scanLineStartPoint_Reference, scanLineEndPoint_Reference);
+      // last segment, after all the intersection points
+      endOfSegmentPixelIndex = this->NumberOfSamplesPerScanline;
     }
 
-    ConvertLineModelIntersectionsToSegmentDescriptor(lineIntersectionsWithModels);
+    int numberOfFilledPixels = endOfSegmentPixelIndex - currentPixelIndex;
+    if (numberOfFilledPixels < 1)
+    {
+      continue;
+    }
 
-    int currentPixelIndex = 0;
-    int scanLineExtent[6] = {0, this->NumberOfSamplesPerScanline - 1, scanLineIndex, scanLineIndex, 0, 0};
-    unsigned char* dstPixelAddress = (unsigned char*)scanLines->GetScalarPointerForExtent(scanLineExtent);
-    double incomingBeamIntensity = this->IncomingIntensityMwPerCm2 * 1000;
-    int numIntersectionPoints = lineIntersectionsWithModels.size();
-    if (numIntersectionPoints < 1)
+    PlusSpatialModel* currentModel = NULL;
+    if (intersectionIndex < numIntersectionPoints)
     {
-      LOG_ERROR("No intersections with any SpatialObjects. Probably no background object is specified.");
-      return 0;
+      currentModel = lineIntersectionsWithModels[intersectionIndex].Model;
     }
-    PlusSpatialModel* previousModel = &this->TransducerSpatialModel;
-    for (vtkIdType intersectionIndex = 0; (intersectionIndex <= numIntersectionPoints) && (currentPixelIndex < this->NumberOfSamplesPerScanline); intersectionIndex++)
+    else
     {
-      // determine end of segment position and pixel color
-      int endOfSegmentPixelIndex = currentPixelIndex;
-      double distanceOfIntersectionPointFromScanLineStartPointMm = 0; // defined here to allow for access later on in code
-      if (intersectionIndex + 1 < numIntersectionPoints)
+      // the segment after the last intersection point is assumed to belong to the model of the last intersection
+      currentModel = lineIntersectionsWithModels[numIntersectionPoints - 1].Model;
+    }
+
+    double outgoingBeamIntensity = 0;
+    currentModel->CalculateIntensity(intensities, numberOfFilledPixels, distanceBetweenScanlineSamplePointsMm, previousModel->GetAcousticImpedanceMegarayls(), incomingBeamIntensity, outgoingBeamIntensity, lineIntersectionsWithModels[intersectionIndex].IntersectionIncidenceAngleRad);
+    previousModel = currentModel;
+
+    if (this->NoiseAmplitude > 0)
+    {
+      const double* noise = &noiseValues[currentPixelIndex];
+      for (int pixelIndex = 0; pixelIndex < numberOfFilledPixels; pixelIndex++)
       {
-        distanceOfIntersectionPointFromScanLineStartPointMm = lineIntersectionsWithModels[intersectionIndex + 1].IntersectionDistanceFromStartPointMm;
-        endOfSegmentPixelIndex = distanceOfIntersectionPointFromScanLineStartPointMm / distanceBetweenScanlineSamplePointsMm;
-        if (endOfSegmentPixelIndex > this->NumberOfSamplesPerScanline)
-        {
-          // the next intersection point is out of the image
-          endOfSegmentPixelIndex = this->NumberOfSamplesPerScanline;
-        }
+        // Noise is multiplicative: NoisySignal = signal + noise * (signal-SignalMean) = signal*(1+noise) - noise*SignalMean;
+        (*dstPixelAddress++) = std::max(std::min(this->BrightnessConversionOffset + this->BrightnessConversionScale * fastPow(intensities[pixelIndex], this->BrightnessConversionGamma) + noise[pixelIndex], 255.0), 0.0);
       }
-      else
+    }
+    else
+    {
+      for (int pixelIndex = 0; pixelIndex < numberOfFilledPixels; pixelIndex++)
       {
-        // last segment, after all the intersection points
-        endOfSegmentPixelIndex = this->NumberOfSamplesPerScanline;
+        (*dstPixelAddress++) = ConvertIntensityToBrightness(intensities[pixelIndex]);
       }
+    }
 
-      int numberOfFilledPixels = endOfSegmentPixelIndex - currentPixelIndex;
-      if (numberOfFilledPixels < 1)
-      {
-        continue;
-      }
+    incomingBeamIntensity = outgoingBeamIntensity;
 
-      PlusSpatialModel* currentModel = NULL;
-      if (intersectionIndex < numIntersectionPoints)
-      {
-        currentModel = lineIntersectionsWithModels[intersectionIndex].Model;
-      }
-      else
+    currentPixelIndex += numberOfFilledPixels;
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+void vtkPlusUsSimulatorAlgo::ComputeScanLineNoise(int scanLineIndex, double distanceBetweenScanlineSamplePointsMm, vtkPerlinNoise* noiseFunction, std::vector<double>& noiseValues)
+{
+  noiseValues.resize(this->NumberOfSamplesPerScanline);
+  if (this->NumberOfSamplesPerScanline < 1)
+  {
+    return;
+  }
+  int sampleStep = 1;
+  if (this->NoiseResolutionMm > 0 && distanceBetweenScanlineSamplePointsMm > 0)
+  {
+    sampleStep = std::max(1, static_cast<int>(this->NoiseResolutionMm / distanceBetweenScanlineSamplePointsMm));
+  }
+
+  double samplePointPosition_Reference[3] = {0, 0, 0};
+  int previousSampleIndex = -1;
+  for (int sampleIndex = 0; previousSampleIndex < this->NumberOfSamplesPerScanline - 1; sampleIndex = std::min(sampleIndex + sampleStep, this->NumberOfSamplesPerScanline - 1))
+  {
+    GetScanLineSamplePointPosition(scanLineIndex, sampleIndex, samplePointPosition_Reference);
+    noiseValues[sampleIndex] = noiseFunction->EvaluateFunction(samplePointPosition_Reference);
+    if (previousSampleIndex >= 0)
+    {
+      const double previousNoise = noiseValues[previousSampleIndex];
+      const double noiseStep = (noiseValues[sampleIndex] - previousNoise) / (sampleIndex - previousSampleIndex);
+      for (int interpolatedSampleIndex = previousSampleIndex + 1; interpolatedSampleIndex < sampleIndex; interpolatedSampleIndex++)
       {
-        // the segment after the last intersection point is assumed to belong to the model of the last intersection
-        currentModel = lineIntersectionsWithModels[numIntersectionPoints - 1].Model;
+        noiseValues[interpolatedSampleIndex] = previousNoise + noiseStep * (interpolatedSampleIndex - previousSampleIndex);
       }
+    }
+    previousSampleIndex = sampleIndex;
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkPlusUsSimulatorAlgo::UpdateBrightnessLookupTable()
+{
+  const double gamma = this->BrightnessConversionGamma;
+  const double offset = this->BrightnessConversionOffset;
+  const double scale = this->BrightnessConversionScale;
+  if (this->BrightnessLookupTableParameters[0] == gamma && this->BrightnessLookupTableParameters[1] == offset
+      && this->BrightnessLookupTableParameters[2] == scale)
+  {
+    return;
+  }
+  this->BrightnessLookupTableParameters[0] = gamma;
+  this->BrightnessLookupTableParameters[1] = offset;
+  this->BrightnessLookupTableParameters[2] = scale;
 
-      double outgoingBeamIntensity = 0;
-      currentModel->CalculateIntensity(intensities, numberOfFilledPixels, distanceBetweenScanlineSamplePointsMm, previousModel->GetAcousticImpedanceMegarayls(), incomingBeamIntensity, outgoingBeamIntensity, lineIntersectionsWithModels[intersectionIndex].IntersectionIncidenceAngleRad);
-      previousModel = currentModel;
+  this->BrightnessLookupTableEnabled = (gamma >= 0 && gamma <= 1 && scale >= 0);
+  if (!this->BrightnessLookupTableEnabled)
+  {
+    LOG_DEBUG("Brightness conversion is not monotonic, lookup table is not used");
+    this->BrightnessLookupTableBucketValues.clear();
+    this->BrightnessLookupTableThresholds.clear();
+    return;
+  }
 
-      if (this->NoiseAmplitude > 0)
+  // Smallest high word that is converted to at least the given pixel value
+  this->BrightnessLookupTableThresholds.resize(256);
+  for (int pixelValue = 0; pixelValue < 256; pixelValue++)
+  {
+    unsigned int lowHighWord = 0;
+    unsigned int highHighWord = INVALID_INTENSITY_HIGH_WORD;
+    while (lowHighWord < highHighWord)
+    {
+      unsigned int middleHighWord = lowHighWord + (highHighWord - lowHighWord) / 2;
+      if (ConvertHighWordToBrightness(middleHighWord, gamma, offset, scale) >= pixelValue)
       {
-        for (int pixelIndex = 0; pixelIndex < numberOfFilledPixels; pixelIndex++)
-        {
-          samplePointPositions_Reference->GetPoint(currentPixelIndex + pixelIndex, samplePointPosition_Reference);
-          double noise = noiseFunction->EvaluateFunction(samplePointPosition_Reference);
-          // Noise is multiplicative: NoisySignal = signal + noise * (signal-SignalMean) = signal*(1+noise) - noise*SignalMean;
-          (*dstPixelAddress++) = std::max(std::min(this->BrightnessConversionOffset + this->BrightnessConversionScale * fastPow(intensities[pixelIndex], this->BrightnessConversionGamma) + noise, 255.0), 0.0);
-        }
+        highHighWord = middleHighWord;
       }
       else
       {
-        for (int pixelIndex = 0; pixelIndex < numberOfFilledPixels; pixelIndex++)
-        {
-          (*dstPixelAddress++) = std::max(std::min(this->BrightnessConversionOffset + this->BrightnessConversionScale * fastPow(intensities[pixelIndex], this->BrightnessConversionGamma), 255.0), 0.0);
-        }
+        lowHighWord = middleHighWord + 1;
       }
+    }
+    this->BrightnessLookupTableThresholds[pixelValue] = lowHighWord;
+  }
 
-      incomingBeamIntensity = outgoingBeamIntensity;
+  this->BrightnessLookupTableBucketValues.resize(INVALID_INTENSITY_HIGH_WORD >> 16);
+  for (unsigned int bucket = 0; bucket < this->BrightnessLookupTableBucketValues.size(); bucket++)
+  {
+    this->BrightnessLookupTableBucketValues[bucket] = ConvertHighWordToBrightness(bucket << 16, gamma, offset, scale);
+  }
+}
 
-      currentPixelIndex += numberOfFilledPixels;
-    }
+//-----------------------------------------------------------------------------
+unsigned char vtkPlusUsSimulatorAlgo::ConvertIntensityToBrightness(double intensity) const
+{
+  const unsigned int highWord = GetHighWord(intensity);
+  if (!this->BrightnessLookupTableEnabled || highWord >= INVALID_INTENSITY_HIGH_WORD)
+  {
+    return ConvertToBrightness(intensity, this->BrightnessConversionGamma, this->BrightnessConversionOffset, this->BrightnessConversionScale);
   }
+  unsigned int pixelValue = this->BrightnessLookupTableBucketValues[highWord >> 16];
+  while (pixelValue < 255 && this->BrightnessLookupTableThresholds[pixelValue + 1] <= highWord)
+  {
+    pixelValue++;
+  }
+  return static_cast<unsigned char>(pixelValue);
+}
 
-  vtkImageData* simulatedUsImage = vtkImageData::SafeDownCast(outInfo->Get(vtkDataObject::DATA_OBJECT()));
-  if (simulatedUsImage == NULL)
+//-----------------------------------------------------------------------------
+void vtkPlusUsSimulatorAlgo::GetScanLineSamplePointPosition(int scanLineIndex, int sampleIndex, double* samplePointPosition_Reference)
+{
+  // Sample points are distributed the same way as by vtkLineSource (single-precision points, evenly spaced between the end points)
+  const double* scanLineStartPoint_Reference = &this->ScanLineStartPoints_Reference[3 * scanLineIndex];
+  const double* scanLineEndPoint_Reference = &this->ScanLineEndPoints_Reference[3 * scanLineIndex];
+  double t = static_cast<double>(sampleIndex) / std::max(1, this->NumberOfSamplesPerScanline - 1);
+  for (int i = 0; i < 3; i++)
   {
-    LOG_ERROR("vtkPlusUsSimulatorAlgo output type is invalid");
-    return 0;
+    samplePointPosition_Reference[i] = static_cast<float>(scanLineStartPoint_Reference[i] + t * (scanLineEndPoint_Reference[i] - scanLineStartPoint_Reference[i]));
   }
-  this->RfProcessor->SetRfFrame(scanLines, US_IMG_BRIGHTNESS);
-  simulatedUsImage->DeepCopy(this->RfProcessor->GetBrightnessScanConvertedImage());
-  return 1;
 }
 
 bool lineIntersectionLessThan(PlusSpatialModel::LineIntersectionInfo a, PlusSpatialModel::LineIntersectionInfo b)
@@ -405,6 +594,8 @@ PlusStatus vtkPlusUsSimulatorAlgo::ReadConfiguration(vtkXMLDataElement* config)
   XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, NoiseAmplitude, usSimulatorAlgoElement);
   XML_READ_VECTOR_ATTRIBUTE_OPTIONAL(double, 3, NoiseFrequency, usSimulatorAlgoElement);
   XML_READ_VECTOR_ATTRIBUTE_OPTIONAL(double, 3, NoisePhase, usSimulatorAlgoElement);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, NoiseResolutionMm, usSimulatorAlgoElement);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, NumberOfThreads, usSimulatorAlgoElement);
   XML_READ_CSTRING_ATTRIBUTE_REQUIRED(ImageCoordinateFrame, usSimulatorAlgoElement);
   XML_READ_CSTRING_ATTRIBUTE_REQUIRED(ReferenceCoordinateFrame, usSimulatorAlgoElement);
 
@@ -18,6 +18,7 @@ class vtkPolyDataNormals;
 class vtkTriangleFilter;
 class vtkStripper;
 class vtkModifiedBSPTree;
+class vtkPerlinNoise;
 class vtkPlusRfProcessor;
 
 /*!
@@ -104,6 +105,18 @@ public:
   vtkSetVector3Macro(NoiseFrequency, double);
   vtkSetVector3Macro(NoisePhase, double);
 
+  /*!
+    Distance between the points along the scanlines where the noise function is evaluated. The noise between these
+    points is linearly interpolated. 0 (default) means the noise function is evaluated at each sample.
+  */
+  vtkSetMacro(NoiseResolutionMm, double);
+  vtkGetMacro(NoiseResolutionMm, double);
+
+  /*! Set the number of threads that compute the scanlines (0 = all threads of the shared worker pool) */
+  vtkSetMacro(NumberOfThreads, int);
+  /*! Get the number of threads that compute the scanlines */
+  vtkGetMacro(NumberOfThreads, int);
+
 protected:
   virtual int FillOutputPortInformation(int port, vtkInformation* info);
   virtual int RequestData(vtkInformation* request,
@@ -112,6 +125,30 @@ protected:
 
   void ConvertLineModelIntersectionsToSegmentDescriptor(std::deque<PlusSpatialModel::LineIntersectionInfo>& lineIntersectionsWithModels);
 
+  /*!
+    Compute the pixels of a scanline from its model intersections. Called from multiple threads at the same time,
+    each with its own intensities buffer, so it must not modify anything else than the intersections and pixels of this scanline.
+  */
+  PlusStatus SimulateScanLine(int scanLineIndex, unsigned char* dstPixelAddress, double distanceBetweenScanlineSamplePointsMm,
+                              vtkPerlinNoise* noiseFunction, std::vector<double>& intensities, std::vector<double>& noiseValues);
+
+  /*! Compute the noise of all samples of a scanline, evaluating the noise function at NoiseResolutionMm intervals */
+  void ComputeScanLineNoise(int scanLineIndex, double distanceBetweenScanlineSamplePointsMm, vtkPerlinNoise* noiseFunction, std::vector<double>& noiseValues);
+
+  /*!
+    Rebuild the lookup tables of the brightness conversion if its parameters changed since they were last built.
+    The conversion only depends on the upper 32 bits of the intensity and it is monotonic for non-negative intensities
+    if 0 <= gamma <= 1 and scale >= 0. In this case the pixel value is found from the pixel value at the start of the
+    bucket of the upper 16 bits of the intensity, and the intensity thresholds of the pixel values within the bucket.
+  */
+  void UpdateBrightnessLookupTable();
+
+  /*! Convert intensity to pixel value. The result is the same with and without the lookup table. */
+  unsigned char ConvertIntensityToBrightness(double intensity) const;
+
+  /*! Get the position of a scanline sample point in the Reference coordinate system */
+  void GetScanLineSamplePointPosition(int scanLineIndex, int sampleIndex, double* samplePointPosition_Reference);
+
 protected:
   vtkPlusUsSimulatorAlgo();
   ~vtkPlusUsSimulatorAlgo();
@@ -163,6 +200,25 @@ private:
   double NoiseAmplitude;
   double NoiseFrequency[3];
   double NoisePhase[3];
+
+  double NoiseResolutionMm;
+  int NumberOfThreads;
+
+  /*! Pixel value at the first intensity of each bucket of the upper 16 bits of the intensity */
+  std::vector<unsigned char> BrightnessLookupTableBucketValues;
+  /*! Smallest upper 32 bits of the intensity that is converted to each pixel value */
+  std::vector<unsigned int> BrightnessLookupTableThresholds;
+  /*! The lookup table is only used if the conversion is monotonic */
+  bool BrightnessLookupTableEnabled;
+  /*! Gamma, offset, scale that the lookup table was built for */
+  double BrightnessLookupTableParameters[3];
+
+  /*! Start and end points of all the scanlines in the Reference coordinate system (x, y, z for each scanline) */
+  std::vector<double> ScanLineStartPoints_Reference;
+  std::vector<double> ScanLineEndPoints_Reference;
+
+  /*! Intersections of each scanline with the models. Kept between frames to avoid reallocations. */
+  std::vector< std::deque<PlusSpatialModel::LineIntersectionInfo> > ScanLineIntersections;
 };
 
 #endif // __vtkPlusUsSimulatorAlgo_h
@@ -321,6 +321,8 @@ int main( int argc, char** argv )
   histogramGenerator->SetInputTest( testingImageRoi );
   histogramGenerator->SetInputTestAlpha( testingAlphaRoi );
   histogramGenerator->SetInputSliceAlpha( slicesAlphaRoi );
+  // Difference images are only computed if they are saved
+  histogramGenerator->SetComputeStatisticsOnly( outputTrueDiffFileName.empty() && outputAbsoluteDiffFileName.empty() );
   histogramGenerator->Update();
 
   // write data to a CSV
@@ -5,7 +5,10 @@
 =========================================================Plus=header=end*/
 
 #include "PlusConfigure.h"
+#include "PlusPerformanceMetrics.h"
+#include "PlusSequenceFrameIndex.h"
 #include "igsioTrackedFrame.h"
+#include "vtkIGSIOAccurateTimer.h"
 #include "vtkImageData.h"
 #include "vtkMatrix4x4.h"
 #include "vtkIGSIOSequenceIO.h"
@@ -15,6 +18,146 @@
 #include "vtkXMLUtilities.h"
 #include "vtksys/CommandLineArguments.hxx"
 
+// STL includes
+#include <algorithm>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <thread>
+
+namespace
+{
+  /*! Number of frames decoded or prepared by each thread in one batch */
+  const unsigned int FRAMES_PER_THREAD_IN_BATCH = 8;
+
+  /*! Transforms of a frame, looked up before the frame is inserted into the volume */
+  struct PreparedFrame
+  {
+    int FrameIndex;
+    vtkSmartPointer<vtkIGSIOTransformRepository> TransformRepository;
+    PlusStatus Status;
+  };
+
+  //----------------------------------------------------------------------------
+  unsigned int GetNumberOfThreads(int requestedNumberOfThreads)
+  {
+    if (requestedNumberOfThreads > 0)
+    {
+      return static_cast<unsigned int>(requestedNumberOfThreads);
+    }
+    return std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  //----------------------------------------------------------------------------
+  /*!
+    Read all frames of a sequence file. If the location of the frames in the file is known (see PlusSequenceFrameIndex)
+    then the frames are read and decompressed on multiple threads, a batch at a time.
+  */
+  PlusStatus ReadSequenceFile(const std::string& filename, unsigned int numberOfThreads, vtkIGSIOTrackedFrameList* trackedFrameList)
+  {
+    PlusSequenceFrameIndex frameIndex;
+    // Frames are read as stored in the file, so they can only be used directly if they are stored in MF orientation
+    if (numberOfThreads < 2 || frameIndex.Load(filename, false) != PLUS_SUCCESS || frameIndex.GetImageOrientation() != US_IMG_ORIENT_MF)
+    {
+      return vtkIGSIOSequenceIO::Read(filename, trackedFrameList);
+    }
+
+    std::vector<std::unique_ptr<std::ifstream> > dataFiles;
+    for (unsigned int threadIndex = 0; threadIndex < numberOfThreads; ++threadIndex)
+    {
+      dataFiles.push_back(std::unique_ptr<std::ifstream>(new std::ifstream(frameIndex.GetDataFilename().c_str(), std::ios::in | std::ios::binary)));
+      if (!dataFiles.back()->is_open())
+      {
+        LOG_ERROR("Failed to open sequence data file: " << frameIndex.GetDataFilename());
+        return PLUS_FAIL;
+      }
+    }
+
+    trackedFrameList->Clear();
+    for (PlusSequenceFrameIndex::FrameFieldList::const_iterator field = frameIndex.GetCustomFields().begin(); field != frameIndex.GetCustomFields().end(); ++field)
+    {
+      trackedFrameList->SetCustomString(field->first.c_str(), field->second.c_str());
+    }
+
+    const unsigned int numberOfFrames = frameIndex.GetNumberOfFrames();
+    const unsigned int batchSize = numberOfThreads * FRAMES_PER_THREAD_IN_BATCH;
+    for (unsigned int batchStart = 0; batchStart < numberOfFrames; batchStart += batchSize)
+    {
+      const unsigned int batchEnd = std::min(batchStart + batchSize, numberOfFrames);
+      std::vector<igsioTrackedFrame> frames(batchEnd - batchStart);
+      std::vector<int> threadSucceeded(numberOfThreads, 1);
+      std::vector<std::thread> threads;
+      for (unsigned int threadIndex = 0; threadIndex < numberOfThreads; ++threadIndex)
+      {
+        threads.push_back(std::thread([&, threadIndex]()
+        {
+          for (unsigned int i = batchStart + threadIndex; i < batchEnd; i += numberOfThreads)
+          {
+            if (frameIndex.ReadTrackedFrame(*dataFiles[threadIndex], i, frames[i - batchStart]) != PLUS_SUCCESS)
+            {
+              threadSucceeded[threadIndex] = 0;
+              return;
+            }
+          }
+        }));
+      }
+      for (std::vector<std::thread>::iterator thread = threads.begin(); thread != threads.end(); ++thread)
+      {
+        thread->join();
+      }
+      if (std::find(threadSucceeded.begin(), threadSucceeded.end(), 0) != threadSucceeded.end())
+      {
+        LOG_ERROR("Failed to read frames " << batchStart << "-" << batchEnd - 1 << " of " << filename);
+        return PLUS_FAIL;
+      }
+      for (std::vector<igsioTrackedFrame>::iterator frame = frames.begin(); frame != frames.end(); ++frame)
+      {
+        trackedFrameList->AddTrackedFrame(&(*frame));
+        // Release the image right away, the frame list has its own copy
+        *frame = igsioTrackedFrame();
+      }
+    }
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  /*!
+    Set the transforms of each frame in a copy of the transform repository. Frames are distributed between the threads
+    and each frame gets its own repository, so the frames can be inserted into the volume after the threads finished.
+  */
+  std::vector<PreparedFrame> PrepareFrames(vtkIGSIOTrackedFrameList* trackedFrameList, vtkIGSIOTransformRepository* transformRepository,
+      const std::vector<int>& frameIndices, size_t firstFrame, size_t lastFrame, unsigned int numberOfThreads)
+  {
+    std::vector<PreparedFrame> preparedFrames(lastFrame - firstFrame);
+    auto prepareFrames = [&](unsigned int threadIndex)
+    {
+      for (size_t i = firstFrame + threadIndex; i < lastFrame; i += numberOfThreads)
+      {
+        PreparedFrame& preparedFrame = preparedFrames[i - firstFrame];
+        preparedFrame.FrameIndex = frameIndices[i];
+        preparedFrame.TransformRepository = vtkSmartPointer<vtkIGSIOTransformRepository>::New();
+        preparedFrame.Status = preparedFrame.TransformRepository->DeepCopy(transformRepository);
+        if (preparedFrame.Status == PLUS_SUCCESS)
+        {
+          preparedFrame.Status = preparedFrame.TransformRepository->SetTransforms(*trackedFrameList->GetTrackedFrame(preparedFrame.FrameIndex));
+        }
+      }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned int threadIndex = 1; threadIndex < numberOfThreads; ++threadIndex)
+    {
+      threads.push_back(std::thread(prepareFrames, threadIndex));
+    }
+    prepareFrames(0);
+    for (std::vector<std::thread>::iterator thread = threads.begin(); thread != threads.end(); ++thread)
+    {
+      thread->join();
+    }
+    return preparedFrames;
+  }
+}
+
 int main(int argc, char* argv[])
 {
   bool printHelp(false);
@@ -36,6 +179,12 @@ int main(int argc, char* argv[])
   int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
 
   bool disableCompression = false;
+  bool writeVolumeInSlabs = false;
+
+  int numberOfPreparationThreads = 1;
+  int numberOfReconstructionThreads = -1;
+
+  std::string metricsFileName;
 
   vtksys::CommandLineArguments cmdargs;
   cmdargs.Initialize(argc, argv);
@@ -48,8 +197,12 @@ int main(int argc, char* argv[])
   cmdargs.AddArgument("--output-frame-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &outputFrameFileName, "A filename that will be used for storing the tracked image frames. Each frame will be exported individually, with the proper position and orientation in the reference coordinate system");
   cmdargs.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
   cmdargs.AddArgument("--disable-compression", vtksys::CommandLineArguments::NO_ARGUMENT, &disableCompression, "Do not compress output image files.");
+  cmdargs.AddArgument("--write-volume-in-slabs", vtksys::CommandLineArguments::NO_ARGUMENT, &writeVolumeInSlabs, "Write the output volume files (.mha/.nrrd) a slab at a time, without copying the whole volume, and compress the slabs on multiple threads. Use this for volumes that are too large to be kept in memory twice.");
   cmdargs.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
   cmdargs.AddArgument("--importance-mask-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &importanceMaskFileName, "The file to use as the importance mask.");
+  cmdargs.AddArgument("--preparation-threads", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfPreparationThreads, "Number of threads used for reading the frames and looking up their transforms, in batches, while the previous batch is inserted into the volume. 0 means the number of processor cores. Default: 1 (frames are read and inserted one by one).");
+  cmdargs.AddArgument("--reconstruction-threads", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfReconstructionThreads, "Number of threads used for inserting a frame into the volume, each thread fills a different part of the volume. Overrides the NumberOfThreads attribute of the configuration file. 0 means the number of processor cores.");
+  cmdargs.AddArgument("--metrics-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &metricsFileName, "Write the number of frames reconstructed per second and the 99th percentile of the frame insertion times to this performance metrics file (.json).");
 
   // Deprecated arguments (2013-07-29, #800)
   cmdargs.AddArgument("--transform", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputImageToReferenceTransformNameDeprecated, "Image to reference transform name used for the reconstruction. DEPRECATED, use --image-to-reference-transform argument instead");
@@ -128,6 +281,12 @@ int main(int argc, char* argv[])
     reconstructor->SetImportanceMaskFilename(importanceMaskFileName);
   }
 
+  if (numberOfReconstructionThreads >= 0)
+  {
+    reconstructor->SetNumberOfThreads(numberOfReconstructionThreads);
+  }
+  const unsigned int preparationThreads = GetNumberOfThreads(numberOfPreparationThreads);
+
   vtkSmartPointer<vtkIGSIOTransformRepository> transformRepository = vtkSmartPointer<vtkIGSIOTransformRepository>::New();
   if (configRootElement->FindNestedElementWithName("CoordinateDefinitions") != NULL)
   {
@@ -150,11 +309,15 @@ int main(int argc, char* argv[])
   // Read image sequence
   LOG_INFO("Reading image sequence " << inputImgSeqFileName);
   vtkSmartPointer<vtkIGSIOTrackedFrameList> trackedFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
-  if (vtkIGSIOSequenceIO::Read(inputImgSeqFileName, trackedFrameList) != PLUS_SUCCESS)
+  double startTimeSec = vtkIGSIOAccurateTimer::GetSystemTime();
+  if (ReadSequenceFile(inputImgSeqFileName, preparationThreads, trackedFrameList) != PLUS_SUCCESS)
   {
     LOG_ERROR("Unable to load input sequences file.");
     exit(EXIT_FAILURE);
   }
+  double elapsedTimeSec = vtkIGSIOAccurateTimer::GetSystemTime() - startTimeSec;
+  LOG_INFO("Read " << trackedFrameList->GetNumberOfTrackedFrames() << " frames in " << elapsedTimeSec << " sec ("
+           << (elapsedTimeSec > 0 ? trackedFrameList->GetNumberOfTrackedFrames() / elapsedTimeSec : 0) << " frames/sec)");
 
   // Reconstruct volume
   igsioTransformName imageToReferenceTransformName;
@@ -182,75 +345,151 @@ int main(int argc, char* argv[])
   const int numberOfFrames = trackedFrameList->GetNumberOfTrackedFrames();
   int numberOfFramesAddedToVolume = 0;
 
+  std::vector<int> frameIndices;
+  std::vector<double> frameInsertionTimesSec;
   for (int frameIndex = 0; frameIndex < numberOfFrames; frameIndex += reconstructor->GetSkipInterval())
   {
-    LOG_DEBUG("Frame: " << frameIndex);
-    vtkPlusLogger::PrintProgressbar((100.0 * frameIndex) / numberOfFrames);
+    frameIndices.push_back(frameIndex);
+  }
 
-    igsioTrackedFrame* frame = trackedFrameList->GetTrackedFrame(frameIndex);
+  // Transforms of the next batch of frames are looked up while the current batch is inserted into the volume
+  const size_t batchSize = (preparationThreads > 1 ? preparationThreads * FRAMES_PER_THREAD_IN_BATCH : 1);
+  std::future<std::vector<PreparedFrame> > nextBatch;
+  if (!frameIndices.empty())
+  {
+    nextBatch = std::async(preparationThreads > 1 ? std::launch::async : std::launch::deferred, PrepareFrames,
+                           trackedFrameList.GetPointer(), transformRepository.GetPointer(), std::cref(frameIndices), 0, std::min(batchSize, frameIndices.size()), preparationThreads);
+  }
 
-    if (transformRepository->SetTransforms(*frame) != PLUS_SUCCESS)
+  startTimeSec = vtkIGSIOAccurateTimer::GetSystemTime();
+  for (size_t batchStart = 0; batchStart < frameIndices.size(); batchStart += batchSize)
+  {
+    std::vector<PreparedFrame> batch = nextBatch.get();
+    const size_t nextBatchStart = batchStart + batchSize;
+    if (nextBatchStart < frameIndices.size())
     {
-      LOG_ERROR("Failed to update transform repository with frame #" << frameIndex);
-      continue;
+      nextBatch = std::async(preparationThreads > 1 ? std::launch::async : std::launch::deferred, PrepareFrames,
+                             trackedFrameList.GetPointer(), transformRepository.GetPointer(), std::cref(frameIndices), nextBatchStart, std::min(nextBatchStart + batchSize, frameIndices.size()), preparationThreads);
     }
 
-    // Insert slice for reconstruction
-    bool insertedIntoVolume = false;
-    if (reconstructor->AddTrackedFrame(frame, transformRepository, &insertedIntoVolume) != PLUS_SUCCESS)
+    for (std::vector<PreparedFrame>::iterator preparedFrame = batch.begin(); preparedFrame != batch.end(); ++preparedFrame)
     {
-      LOG_ERROR("Failed to add tracked frame to volume with frame #" << frameIndex);
-      continue;
-    }
+      const int frameIndex = preparedFrame->FrameIndex;
+      LOG_DEBUG("Frame: " << frameIndex);
+      vtkPlusLogger::PrintProgressbar((100.0 * frameIndex) / numberOfFrames);
 
-    if (insertedIntoVolume)
-    {
-      numberOfFramesAddedToVolume++;
-    }
+      igsioTrackedFrame* frame = trackedFrameList->GetTrackedFrame(frameIndex);
 
-    // Write an ITK image with the image pose in the reference coordinate system
-    if (!outputFrameFileName.empty())
-    {
-      vtkSmartPointer<vtkMatrix4x4> imageToReferenceTransformMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
-      if (transformRepository->GetTransform(imageToReferenceTransformName, imageToReferenceTransformMatrix) != PLUS_SUCCESS)
+      if (preparedFrame->Status != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to update transform repository with frame #" << frameIndex);
+        continue;
+      }
+      vtkIGSIOTransformRepository* frameTransformRepository = preparedFrame->TransformRepository;
+
+      // Insert slice for reconstruction
+      bool insertedIntoVolume = false;
+      const double insertionStartTimeSec = vtkIGSIOAccurateTimer::GetSystemTime();
+      if (reconstructor->AddTrackedFrame(frame, frameTransformRepository, &insertedIntoVolume) != PLUS_SUCCESS)
       {
-        std::string strImageToReferenceTransformName;
-        imageToReferenceTransformName.GetTransformName(strImageToReferenceTransformName);
-        LOG_ERROR("Failed to get transform '" << strImageToReferenceTransformName << "' from transform repository!");
+        LOG_ERROR("Failed to add tracked frame to volume with frame #" << frameIndex);
         continue;
       }
+      frameInsertionTimesSec.push_back(vtkIGSIOAccurateTimer::GetSystemTime() - insertionStartTimeSec);
 
-      // Print the image to reference transform
-      std::ostringstream os;
-      imageToReferenceTransformMatrix->Print(os);
-      LOG_TRACE("Image to reference transform: \n" << os.str());
-
-      // Insert frame index before the file extension (image.mha => image001.mha)
-      std::ostringstream ss;
-      size_t found;
-      found = outputFrameFileName.find_last_of(".");
-      ss << outputFrameFileName.substr(0, found);
-      ss.width(3);
-      ss.fill('0');
-      ss << frameIndex;
-      ss << outputFrameFileName.substr(found);
-
-      PlusCommon::WriteToFile(frame, ss.str(), imageToReferenceTransformMatrix);
+      if (insertedIntoVolume)
+      {
+        numberOfFramesAddedToVolume++;
+      }
+
+      // Write an ITK image with the image pose in the reference coordinate system
+      if (!outputFrameFileName.empty())
+      {
+        vtkSmartPointer<vtkMatrix4x4> imageToReferenceTransformMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+        if (frameTransformRepository->GetTransform(imageToReferenceTransformName, imageToReferenceTransformMatrix) != PLUS_SUCCESS)
+        {
+          std::string strImageToReferenceTransformName;
+          imageToReferenceTransformName.GetTransformName(strImageToReferenceTransformName);
+          LOG_ERROR("Failed to get transform '" << strImageToReferenceTransformName << "' from transform repository!");
+          continue;
+        }
+
+        // Print the image to reference transform
+        std::ostringstream os;
+        imageToReferenceTransformMatrix->Print(os);
+        LOG_TRACE("Image to reference transform: \n" << os.str());
+
+        // Insert frame index before the file extension (image.mha => image001.mha)
+        std::ostringstream ss;
+        size_t found;
+        found = outputFrameFileName.find_last_of(".");
+        ss << outputFrameFileName.substr(0, found);
+        ss.width(3);
+        ss.fill('0');
+        ss << frameIndex;
+        ss << outputFrameFileName.substr(found);
+
+        PlusCommon::WriteToFile(frame, ss.str(), imageToReferenceTransformMatrix);
+      }
     }
   }
 
   vtkPlusLogger::PrintProgressbar(100);
+  elapsedTimeSec = vtkIGSIOAccurateTimer::GetSystemTime() - startTimeSec;
+  LOG_INFO("Reconstructed volume from " << frameIndices.size() << " frames in " << elapsedTimeSec << " sec ("
+           << (elapsedTimeSec > 0 ? frameIndices.size() / elapsedTimeSec : 0) << " frames/sec)");
 
   trackedFrameList->Clear();
 
   LOG_INFO("Number of frames added to the volume: " << numberOfFramesAddedToVolume << " out of " << numberOfFrames);
 
+  if (!metricsFileName.empty())
+  {
+    PlusPerformanceMetrics metrics;
+    if (elapsedTimeSec > 0)
+    {
+      metrics.SetMetric("VolumeReconstruction/FramesPerSec", frameIndices.size() / elapsedTimeSec, PlusPerformanceMetrics::THROUGHPUT);
+    }
+    if (!frameInsertionTimesSec.empty())
+    {
+      std::sort(frameInsertionTimesSec.begin(), frameInsertionTimesSec.end());
+      const size_t p99Index = std::min(frameInsertionTimesSec.size() - 1, static_cast<size_t>(0.99 * (frameInsertionTimesSec.size() - 1) + 0.5));
+      metrics.SetMetric("VolumeReconstruction/FrameInsertionP99Ms", frameInsertionTimesSec[p99Index] * 1000.0, PlusPerformanceMetrics::LATENCY);
+    }
+    if (metrics.WriteToFile(metricsFileName) != PLUS_SUCCESS)
+    {
+      return EXIT_FAILURE;
+    }
+  }
+
   LOG_INFO("Saving volume to file...");
-  reconstructor->SaveReconstructedVolumeToFile(outputVolumeFileName, false, !disableCompression);
+  if (writeVolumeInSlabs)
+  {
+    if (reconstructor->SaveReconstructedVolumeToFileInSlabs(outputVolumeFileName, false, !disableCompression) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to save volume to " << outputVolumeFileName);
+      return EXIT_FAILURE;
+    }
+  }
+  else
+  {
+    reconstructor->SaveReconstructedVolumeToFile(outputVolumeFileName, false, !disableCompression);
+  }
 
   if (!outputVolumeAccumulationFileName.empty())
   {
-    reconstructor->SaveReconstructedVolumeToFile(outputVolumeAccumulationFileName, true, !disableCompression);
+    if (writeVolumeInSlabs)
+    {
+      if (reconstructor->SaveReconstructedVolumeToFileInSlabs(outputVolumeAccumulationFileName, true, !disableCompression) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to save accumulation buffer to " << outputVolumeAccumulationFileName);
+        return EXIT_FAILURE;
+      }
+    }
+    else
+    {
+      reconstructor->SaveReconstructedVolumeToFile(outputVolumeAccumulationFileName, true, !disableCompression);
+    }
   }
 
   return EXIT_SUCCESS;
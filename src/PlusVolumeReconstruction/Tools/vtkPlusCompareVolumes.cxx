@@ -18,6 +18,7 @@
 #include "vtkPlusCompareVolumes.h"
 
 #include "igsioMath.h"
+#include "PlusWorkerPool.h"
 
 #include "vtkImageData.h"
 #include "vtkImageProgressIterator.h"
@@ -25,8 +26,10 @@
 #include "vtkInformationVector.h"
 #include "vtkObjectFactory.h"
 #include "vtkStreamingDemandDrivenPipeline.h"
+#include <algorithm>
 #include <vector>
 #include <list>
+#include <mutex>
 
 static const int INPUT_GROUND_TRUTH_VOLUME = 0;
 static const int INPUT_GROUND_TRUTH_VOLUME_ALPHA = 1;
@@ -36,6 +39,10 @@ static const int INPUT_SLICES_VOLUME_ALPHA = 4;
 
 static const int OUTPUT_ABS_DIFF_VOLUME = 1;
 
+static const int NUMBER_OF_INPUTS = 5;
+// Differences of unsigned char voxels are in the range [-255, 255]
+static const int MAX_ABS_DIFFERENCE = 255;
+
 vtkStandardNewMacro( vtkPlusCompareVolumes );
 
 //----------------------------------------------------------------------------
@@ -101,7 +108,7 @@ int* vtkPlusCompareVolumes::GetAbsoluteHistogramWithHolesPtr()
 //----------------------------------------------------------------------------
 void vtkPlusCompareVolumes::incTrueHistogramAtIndex( int value )
 {
-  int index = value + 256;
+  int index = value + MAX_ABS_DIFFERENCE;
   TrueHistogram[index]++;
 }
 
@@ -151,6 +158,7 @@ vtkPlusCompareVolumes::vtkPlusCompareVolumes()
   this->SetNumberOfInputPorts( 5 );
   this->SetNumberOfOutputPorts( 2 );
   this->SetNumberOfThreads( 1 ); // TODO: Remove when vtkPlusCompareVolumesExecute is made thread-safe (e.g., simultaneous access to member variables are protected by locking)
+  this->ComputeStatisticsOnly = false;
 }
 
 int vtkPlusCompareVolumes::RequestInformation (
@@ -489,3 +497,221 @@ int vtkPlusCompareVolumes::FillInputPortInformation( int port, vtkInformation* i
   info->Set( vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkImageData" );
   return 1;
 }
+
+//----------------------------------------------------------------------------
+int vtkPlusCompareVolumes::RequestData( vtkInformation* request, vtkInformationVector** inputVector, vtkInformationVector* outputVector )
+{
+  if ( !this->ComputeStatisticsOnly )
+  {
+    return this->Superclass::RequestData( request, inputVector, outputVector );
+  }
+
+  vtkImageData* inputs[NUMBER_OF_INPUTS] = {0};
+  for ( int i = 0; i < NUMBER_OF_INPUTS; i++ )
+  {
+    inputs[i] = vtkImageData::GetData( inputVector[i] );
+  }
+  return this->ComputeStatistics( inputs ) == PLUS_SUCCESS ? 1 : 0;
+}
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  // Counts of the voxel differences in a part of the volume. Unsigned char differences are integers, so the
+  // histograms contain all the information that is needed for exact statistics.
+  struct DifferenceCounts
+  {
+    DifferenceCounts()
+      : NumberVoxelsVisible( 0 )
+      , TrueHistogram( 2 * MAX_ABS_DIFFERENCE + 1, 0 )
+      , AbsoluteHistogramWithHoles( MAX_ABS_DIFFERENCE + 1, 0 )
+    {
+    }
+
+    void Add( const DifferenceCounts& other )
+    {
+      this->NumberVoxelsVisible += other.NumberVoxelsVisible;
+      for ( size_t i = 0; i < this->TrueHistogram.size(); i++ )
+      {
+        this->TrueHistogram[i] += other.TrueHistogram[i];
+      }
+      for ( size_t i = 0; i < this->AbsoluteHistogramWithHoles.size(); i++ )
+      {
+        this->AbsoluteHistogramWithHoles[i] += other.AbsoluteHistogramWithHoles[i];
+      }
+    }
+
+    long long NumberVoxelsVisible;
+    // Differences in the filled holes, the difference value is the index - MAX_ABS_DIFFERENCE
+    std::vector<long long> TrueHistogram;
+    // Absolute differences in all the holes
+    std::vector<long long> AbsoluteHistogramWithHoles;
+  };
+
+  //----------------------------------------------------------------------------
+  // Value at the given position of the sorted values. histogram[i] is the number of (firstValue + i) values.
+  double GetSortedValue( const std::vector<long long>& histogram, int firstValue, long long position )
+  {
+    long long count = 0;
+    for ( size_t i = 0; i < histogram.size(); i++ )
+    {
+      count += histogram[i];
+      if ( count > position )
+      {
+        return firstValue + static_cast<int>( i );
+      }
+    }
+    return firstValue + static_cast<int>( histogram.size() ) - 1;
+  }
+
+  //----------------------------------------------------------------------------
+  // Percentile of the sorted values, interpolated between neighbors the same way as in vtkPlusCompareVolumesExecute
+  double GetPercentile( const std::vector<long long>& histogram, int firstValue, long long numberOfValues, double fraction )
+  {
+    double rank = ( numberOfValues - 1 ) * fraction;
+    double rankFraction = fmod( rank, 1.0 );
+    long long rankFloor = std::max( static_cast<long long>( floor( rank ) ), 0LL );
+    long long rankCeil = std::min( static_cast<long long>( ceil( rank ) ), numberOfValues - 1 );
+    return GetSortedValue( histogram, firstValue, rankFloor ) * ( 1 - rankFraction ) + GetSortedValue( histogram, firstValue, rankCeil ) * rankFraction;
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusCompareVolumes::ComputeStatistics( vtkImageData* inputs[5] )
+{
+  for ( int i = 0; i < NUMBER_OF_INPUTS; i++ )
+  {
+    if ( inputs[i] == NULL )
+    {
+      vtkErrorMacro( << "Input must be specified." );
+      return PLUS_FAIL;
+    }
+    if ( inputs[i]->GetScalarType() != VTK_UNSIGNED_CHAR || inputs[i]->GetNumberOfScalarComponents() != 1 )
+    {
+      vtkErrorMacro( << "Statistics only computation requires single component unsigned char inputs" );
+      return PLUS_FAIL;
+    }
+    int* extent = inputs[i]->GetExtent();
+    int* gtExtent = inputs[INPUT_GROUND_TRUTH_VOLUME]->GetExtent();
+    for ( int j = 0; j < 6; j++ )
+    {
+      if ( extent[j] != gtExtent[j] )
+      {
+        vtkErrorMacro( << "Input extents do not match" );
+        return PLUS_FAIL;
+      }
+    }
+  }
+
+  const unsigned char* gtPtr = static_cast<unsigned char*>( inputs[INPUT_GROUND_TRUTH_VOLUME]->GetScalarPointer() );
+  const unsigned char* gtAlphaPtr = static_cast<unsigned char*>( inputs[INPUT_GROUND_TRUTH_VOLUME_ALPHA]->GetScalarPointer() );
+  const unsigned char* testPtr = static_cast<unsigned char*>( inputs[INPUT_TEST_VOLUME]->GetScalarPointer() );
+  const unsigned char* testAlphaPtr = static_cast<unsigned char*>( inputs[INPUT_TEST_VOLUME_ALPHA]->GetScalarPointer() );
+  const unsigned char* slicesAlphaPtr = static_cast<unsigned char*>( inputs[INPUT_SLICES_VOLUME_ALPHA]->GetScalarPointer() );
+  int dims[3] = {0};
+  inputs[INPUT_GROUND_TRUTH_VOLUME]->GetDimensions( dims );
+  const size_t sliceSize = static_cast<size_t>( dims[0] ) * dims[1];
+
+  // Each task counts the differences in a range of slices, then adds its counts to the total
+  DifferenceCounts totalCounts;
+  std::mutex totalCountsMutex;
+  PlusWorkerPool::GetInstance().ParallelFor( 0, dims[2], 0, [&]( int firstSlice, int lastSlice )
+  {
+    DifferenceCounts counts;
+    const size_t lastVoxel = lastSlice * sliceSize;
+    for ( size_t voxel = firstSlice * sliceSize; voxel < lastVoxel; voxel++ )
+    {
+      if ( gtAlphaPtr[voxel] == 0 )
+      {
+        continue;
+      }
+      counts.NumberVoxelsVisible++;
+      if ( slicesAlphaPtr[voxel] != 0 )
+      {
+        // Not a hole
+        continue;
+      }
+      int difference = static_cast<int>( gtPtr[voxel] ) - testPtr[voxel];
+      counts.AbsoluteHistogramWithHoles[abs( difference )]++;
+      if ( testAlphaPtr[voxel] != 0 )
+      {
+        counts.TrueHistogram[difference + MAX_ABS_DIFFERENCE]++;
+      }
+    }
+    std::lock_guard<std::mutex> lock( totalCountsMutex );
+    totalCounts.Add( counts );
+  } );
+
+  // Histograms of the filled holes and sums for the means
+  this->resetTrueHistogram();
+  this->resetAbsoluteHistogram();
+  this->resetAbsoluteHistogramWithHoles();
+  std::vector<long long> absoluteHistogram( MAX_ABS_DIFFERENCE + 1, 0 );
+  long long countFilledHoles = 0;
+  double trueSum = 0;
+  double absoluteSum = 0;
+  double squaredSum = 0;
+  for ( int i = 0; i <= 2 * MAX_ABS_DIFFERENCE; i++ )
+  {
+    long long count = totalCounts.TrueHistogram[i];
+    int difference = i - MAX_ABS_DIFFERENCE;
+    this->TrueHistogram[i] = static_cast<int>( count );
+    absoluteHistogram[abs( difference )] += count;
+    countFilledHoles += count;
+    trueSum += static_cast<double>( count ) * difference;
+    absoluteSum += static_cast<double>( count ) * abs( difference );
+    squaredSum += static_cast<double>( count ) * difference * difference;
+  }
+  long long countHoles = 0;
+  double absoluteSumWithHoles = 0;
+  for ( int i = 0; i <= MAX_ABS_DIFFERENCE; i++ )
+  {
+    this->AbsoluteHistogram[i] = static_cast<int>( absoluteHistogram[i] );
+    this->AbsoluteHistogramWithHoles[i] = static_cast<int>( totalCounts.AbsoluteHistogramWithHoles[i] );
+    countHoles += totalCounts.AbsoluteHistogramWithHoles[i];
+    absoluteSumWithHoles += static_cast<double>( totalCounts.AbsoluteHistogramWithHoles[i] ) * i;
+  }
+
+  this->NumberVoxelsVisible = static_cast<int>( totalCounts.NumberVoxelsVisible );
+  this->NumberOfHoles = static_cast<int>( countHoles );
+  this->NumberOfFilledHoles = static_cast<int>( countFilledHoles );
+  this->AbsoluteMeanWithHoles = ( countHoles != 0 ) ? absoluteSumWithHoles / countHoles : 0.0;
+
+  this->TrueMean = this->TrueStdev = this->TrueMedian = this->TrueMinimum = this->TrueMaximum = this->True5thPercentile = this->True95thPercentile = 0.0;
+  this->AbsoluteMean = this->AbsoluteStdev = this->AbsoluteMedian = this->AbsoluteMinimum = this->AbsoluteMaximum = this->Absolute5thPercentile = this->Absolute95thPercentile = 0.0;
+  this->RMS = 0.0;
+  if ( countFilledHoles == 0 )
+  {
+    return PLUS_SUCCESS;
+  }
+
+  this->TrueMean = trueSum / countFilledHoles;
+  this->AbsoluteMean = absoluteSum / countFilledHoles;
+  this->RMS = sqrt( squaredSum / countFilledHoles );
+  double trueVarianceSum = 0;
+  double absoluteVarianceSum = 0;
+  for ( int i = 0; i <= 2 * MAX_ABS_DIFFERENCE; i++ )
+  {
+    trueVarianceSum += totalCounts.TrueHistogram[i] * pow( i - MAX_ABS_DIFFERENCE - this->TrueMean, 2 );
+  }
+  for ( int i = 0; i <= MAX_ABS_DIFFERENCE; i++ )
+  {
+    absoluteVarianceSum += absoluteHistogram[i] * pow( i - this->AbsoluteMean, 2 );
+  }
+  this->TrueStdev = sqrt( trueVarianceSum / countFilledHoles );
+  this->AbsoluteStdev = sqrt( absoluteVarianceSum / countFilledHoles );
+
+  this->TrueMinimum = GetSortedValue( totalCounts.TrueHistogram, -MAX_ABS_DIFFERENCE, 0 );
+  this->TrueMaximum = GetSortedValue( totalCounts.TrueHistogram, -MAX_ABS_DIFFERENCE, countFilledHoles - 1 );
+  this->TrueMedian = GetPercentile( totalCounts.TrueHistogram, -MAX_ABS_DIFFERENCE, countFilledHoles, 0.5 );
+  this->True5thPercentile = GetPercentile( totalCounts.TrueHistogram, -MAX_ABS_DIFFERENCE, countFilledHoles, 0.05 );
+  this->True95thPercentile = GetPercentile( totalCounts.TrueHistogram, -MAX_ABS_DIFFERENCE, countFilledHoles, 0.95 );
+
+  this->AbsoluteMinimum = GetSortedValue( absoluteHistogram, 0, 0 );
+  this->AbsoluteMaximum = GetSortedValue( absoluteHistogram, 0, countFilledHoles - 1 );
+  this->AbsoluteMedian = GetPercentile( absoluteHistogram, 0, countFilledHoles, 0.5 );
+  this->Absolute5thPercentile = GetPercentile( absoluteHistogram, 0, countFilledHoles, 0.05 );
+  this->Absolute95thPercentile = GetPercentile( absoluteHistogram, 0, countFilledHoles, 0.95 );
+
+  return PLUS_SUCCESS;
+}
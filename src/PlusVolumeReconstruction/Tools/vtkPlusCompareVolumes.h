@@ -58,6 +58,13 @@ public:
   vtkImageData* GetOutputTrueDifferenceImage();
   vtkImageData* GetOutputAbsoluteDifferenceImage();
 
+  // Description:
+  // If enabled then only the statistics and histograms are computed, in a single parallel pass over the
+  // inputs. The difference images are not allocated, the outputs remain empty. Requires unsigned char inputs.
+  vtkGetMacro(ComputeStatisticsOnly, bool);
+  vtkSetMacro(ComputeStatisticsOnly, bool);
+  vtkBooleanMacro(ComputeStatisticsOnly, bool);
+
   vtkGetMacro(RMS,double);
   vtkSetMacro(RMS,double);
 
@@ -124,6 +131,7 @@ protected:
   int NumberOfHoles;
   int NumberOfFilledHoles;
   int NumberVoxelsVisible;
+  bool ComputeStatisticsOnly;
 
   virtual int RequestInformation (vtkInformation *, vtkInformationVector**, vtkInformationVector *);
 
@@ -135,6 +143,14 @@ protected:
 
   virtual int FillInputPortInformation(int port, vtkInformation* info);
 
+  // Description:
+  // Computes the statistics without the difference images if ComputeStatisticsOnly is enabled
+  virtual int RequestData(vtkInformation* request, vtkInformationVector** inputVector, vtkInformationVector* outputVector);
+
+  // Description:
+  // Count the differences of all voxels in parallel and compute the statistics from the histograms
+  PlusStatus ComputeStatistics(vtkImageData* inputs[5]);
+
 
 private:
   vtkPlusCompareVolumes(const vtkPlusCompareVolumes&);  // Not implemented.
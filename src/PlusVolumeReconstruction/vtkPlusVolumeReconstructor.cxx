@@ -6,6 +6,7 @@
 
 // Local includes
 #include "PlusConfigure.h"
+#include "PlusVolumeSlabWriter.h"
 #include "vtkPlusSequenceIO.h"
 #include "vtkPlusVolumeReconstructor.h"
 
@@ -86,6 +87,44 @@ PlusStatus vtkPlusVolumeReconstructor::SaveReconstructedVolumeToFile(vtkImageDat
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVolumeReconstructor::SaveReconstructedVolumeToFileInSlabs(const std::string& filename, bool accumulation/*=false*/, bool useCompression/*=true*/, int numberOfCompressionThreads/*=0*/)
+{
+  if (accumulation)
+  {
+    return PlusVolumeSlabWriter::WriteVolume(this->Reconstructor->GetAccumulationBuffer(), filename, useCompression, -1, numberOfCompressionThreads);
+  }
+  if (this->GetFillHoles())
+  {
+    // Hole filling creates a new volume, which is then written in slabs
+    vtkSmartPointer<vtkImageData> volumeToSave = vtkSmartPointer<vtkImageData>::New();
+    if (this->ExtractGrayLevels(volumeToSave) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Extracting gray channel failed!");
+      return PLUS_FAIL;
+    }
+    return PlusVolumeSlabWriter::WriteVolume(volumeToSave, filename, useCompression, -1, numberOfCompressionThreads);
+  }
+  // The first component of the reconstructed volume is the gray level, the second one is the alpha channel
+  return PlusVolumeSlabWriter::WriteVolume(this->Reconstructor->GetReconstructedVolume(), filename, useCompression, 0, numberOfCompressionThreads);
+}
+
+//----------------------------------------------------------------------------
+unsigned long long vtkPlusVolumeReconstructor::GetMemoryUsageInBytes()
+{
+  unsigned long long usedBytes = 0;
+  vtkImageData* volumes[2] = { this->Reconstructor->GetReconstructedVolume(), this->Reconstructor->GetAccumulationBuffer() };
+  for (int i = 0; i < 2; ++i)
+  {
+    if (volumes[i] != NULL)
+    {
+      // VTK reports the allocated memory in kibibytes
+      usedBytes += static_cast<unsigned long long>(volumes[i]->GetActualMemorySize()) * 1024;
+    }
+  }
+  return usedBytes;
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusVolumeReconstructor::UpdateImportanceMask()
 {
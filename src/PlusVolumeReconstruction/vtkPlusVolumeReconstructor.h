@@ -67,6 +67,20 @@ public:
   static PlusStatus SaveReconstructedVolumeToFile(vtkImageData* volumeToSave, const std::string& filename, bool useCompression = true);
   static PlusStatus SaveReconstructedVolumeToMetafile(vtkImageData* volumeToSave, const std::string& filename, bool useCompression = true) { return vtkPlusVolumeReconstructor::SaveReconstructedVolumeToFile(volumeToSave, filename, useCompression); }
 
+  /*!
+    Save reconstructed volume to a .mha or .nrrd file slab by slab (see PlusVolumeSlabWriter).
+    Unless holes are filled, the volume is written directly from the reconstruction buffers, so a copy of the
+    whole volume is not needed. This allows saving volumes that are too large to be kept in memory twice.
+    \param filename Path and filename of the output file
+    \param accumulation True if accumulation buffer needs to be saved, false if gray levels (default)
+    \param useCompression True if compression is turned on (default), false otherwise
+    \param numberOfCompressionThreads Number of slabs compressed at the same time, 0 means the number of processor cores
+  */
+  virtual PlusStatus SaveReconstructedVolumeToFileInSlabs(const std::string& filename, bool accumulation = false, bool useCompression = true, int numberOfCompressionThreads = 0);
+
+  /*! Memory allocated for the reconstructed volume and the accumulation buffer, in bytes */
+  unsigned long long GetMemoryUsageInBytes();
+
 protected:
   vtkPlusVolumeReconstructor();
   virtual ~vtkPlusVolumeReconstructor();
@@ -8,6 +8,7 @@ See License.txt for details.
 #include "QPlusDeviceSetSelectorWidget.h"
 
 // PlusLib includes
+#include "PlusXmlFileCache.h"
 //#include <vtkIGSIOTransformRepository.h>
 
 // Qt includes
@@ -18,11 +19,13 @@ See License.txt for details.
 #include <QDesktopWidget>
 #include <QDomDocument>
 #include <QFileDialog>
+#include <QFileSystemWatcher>
 #include <QKeyEvent>
 #include <QMenu>
 #include <QMessageBox>
 #include <QMimeData>
 #include <QProcess>
+#include <QTimer>
 #include <QUrl>
 
 #if !defined(_WIN32)
@@ -44,6 +47,9 @@ QPlusDeviceSetSelectorWidget::QPlusDeviceSetSelectorWidget(QWidget* aParent)
   , m_EditorSelectAction(NULL)
   , m_EditApplicationConfigFileAction(NULL)
   , m_DeviceSetComboBoxMaximumSizeRatio(-1)
+  , m_DirectoryWatcher(NULL)
+  , m_DirectoryChangeTimer(NULL)
+  , m_DirectoryScanCancelled(false)
 {
   // Accept drop of files from explorer (and others)
   setAcceptDrops(true);
@@ -67,6 +73,17 @@ QPlusDeviceSetSelectorWidget::QPlusDeviceSetSelectorWidget(QWidget* aParent)
 
   connect(ui.pushButton_EditConfiguration, SIGNAL(customContextMenuRequested(QPoint)), this, SLOT(ShowEditContextMenu(QPoint)));
 
+  // The directory scan thread notifies the widget about the parsed files
+  connect(this, SIGNAL(DeviceSetFilesScanned()), this, SLOT(AddScannedDeviceSets()), Qt::QueuedConnection);
+
+  // Changes of the configuration directory are collected for a short time, so that saving several files refreshes the list only once
+  m_DirectoryChangeTimer = new QTimer(this);
+  m_DirectoryChangeTimer->setSingleShot(true);
+  m_DirectoryChangeTimer->setInterval(1000);
+  connect(m_DirectoryChangeTimer, SIGNAL(timeout()), this, SLOT(ConfigurationDirectoryModified()));
+  m_DirectoryWatcher = new QFileSystemWatcher(this);
+  connect(m_DirectoryWatcher, SIGNAL(directoryChanged(QString)), m_DirectoryChangeTimer, SLOT(start()));
+
   SetConfigurationDirectory(vtkPlusConfig::GetInstance()->GetDeviceSetConfigurationDirectory().c_str());
 }
 
@@ -79,6 +96,8 @@ void QPlusDeviceSetSelectorWidget::SetDeviceSetComboBoxMaximumSizeRatio(double r
 //-----------------------------------------------------------------------------
 QPlusDeviceSetSelectorWidget::~QPlusDeviceSetSelectorWidget()
 {
+  this->StopDirectoryScan();
+
   if (this->m_EditMenu)
   {
     delete this->m_EditMenu;
@@ -119,12 +138,7 @@ PlusStatus QPlusDeviceSetSelectorWidget::SetConfigurationDirectory(const QString
   }
   else
   {
-    ui.lineEdit_ConfigurationDirectory->setText(tr("Invalid configuration directory"));
-    ui.lineEdit_ConfigurationDirectory->setToolTip("No valid configuration files in directory, please select another");
-
-    ui.textEdit_Description->setTextColor(QColor(Qt::darkRed));
-    ui.textEdit_Description->setText("Selected directory does not contain valid device set configuration files!\n\nPlease select another directory");
-
+    this->ShowInvalidDirectoryMessage();
     return PLUS_FAIL;
   }
 }
@@ -138,8 +152,9 @@ PlusStatus QPlusDeviceSetSelectorWidget::SetConfigurationFile(const QString& aFi
   {
     if (this->SetConfigurationDirectory(info.absoluteDir().absolutePath()) == PLUS_SUCCESS)
     {
-      QString fileName = QDir::toNativeSeparators(info.absoluteFilePath());
-      ui.comboBox_DeviceSet->setCurrentIndex(ui.comboBox_DeviceSet->findData(fileName));
+      // The file is selected when it is added to the list, if it is still being parsed
+      m_PendingSelectionFileName = QDir::toNativeSeparators(info.absoluteFilePath());
+      this->SelectPendingDeviceSet();
       return PLUS_SUCCESS;
     }
   }
@@ -309,6 +324,8 @@ PlusStatus QPlusDeviceSetSelectorWidget::ParseDirectory(const QString& aDirector
 {
   LOG_TRACE("DeviceSetSelectorWidget::ParseDirectory(" << aDirectory.toStdString() << ")");
 
+  this->StopDirectoryScan();
+
   QDir configDir(aDirectory);
   QStringList fileList(configDir.entryList());
 
@@ -320,13 +337,31 @@ PlusStatus QPlusDeviceSetSelectorWidget::ParseDirectory(const QString& aDirector
     }
   }
 
+  // Keep the current selection, or if there is none then restore the saved selection, when the file is added to the list
+  if (ui.comboBox_DeviceSet->currentIndex() >= 0)
+  {
+    m_PendingSelectionFileName = ui.comboBox_DeviceSet->itemData(ui.comboBox_DeviceSet->currentIndex(), FileNameRole).toString();
+  }
+  else
+  {
+    m_PendingSelectionFileName = QDir::toNativeSeparators(QString(vtkPlusConfig::GetInstance()->GetDeviceSetConfigurationFileName().c_str()));
+  }
+
+  // Changes of the directory refresh the list
+  if (!m_DirectoryWatcher->directories().isEmpty())
+  {
+    m_DirectoryWatcher->removePaths(m_DirectoryWatcher->directories());
+  }
+  m_DirectoryWatcher->addPath(configDir.absolutePath());
+
   // Block signals before we add items
   ui.comboBox_DeviceSet->blockSignals(true);
   ui.comboBox_DeviceSet->clear();
+  m_DeviceSetVersion.clear();
 
+  // Files that have not changed since the previous parsing are added now, the others are parsed in the background
+  QStringList filesToScan;
   QStringListIterator filesIterator(fileList);
-  QHash<QString, int> deviceSetVersion;
-
   while (filesIterator.hasNext())
   {
     QString fileName = QDir::toNativeSeparators(QString(configDir.absoluteFilePath(filesIterator.next())));
@@ -336,151 +371,328 @@ PlusStatus QPlusDeviceSetSelectorWidget::ParseDirectory(const QString& aDirector
       continue;
     }
 
-    QFile file(fileName);
     QFileInfo fileInfo(fileName);
-    QDomDocument doc;
-
-    // If file is not readable then skip
-    if (!file.open(QIODevice::ReadOnly))
+    QHash<QString, DeviceSetFileDetails>::iterator detailsIt = m_DeviceSetFileDetailsCache.find(fileName);
+    if (detailsIt == m_DeviceSetFileDetailsCache.end()
+        || detailsIt.value().LastModified != fileInfo.lastModified()
+        || detailsIt.value().Size != fileInfo.size())
     {
+      filesToScan << fileName;
       continue;
     }
+    this->AddDeviceSetItem(fileName, detailsIt.value());
+  }
+
+  // Set current index to default so that setting the last selected item raises the event even if it is the first item
+  ui.comboBox_DeviceSet->setCurrentIndex(-1);
+
+  ui.comboBox_DeviceSet->model()->sort(0);
+
+  // Unblock signals after we add items
+  ui.comboBox_DeviceSet->blockSignals(false);
+
+  this->SelectPendingDeviceSet();
+
+  this->FixComboBoxDropDownListSizeAdjustemnt(ui.comboBox_DeviceSet);
 
-    // If parsing is successful then check the content and if data collection config file is found then add it to combo box
-    if (doc.setContent(&file))
+  if (!filesToScan.isEmpty())
+  {
+    if (ui.comboBox_DeviceSet->count() < 1)
     {
-      QDomElement docElem = doc.documentElement();
+      ui.textEdit_Description->setTextColor(QColor(Qt::black));
+      ui.textEdit_Description->setText(tr("Reading device set configuration files..."));
+    }
+    this->StartDirectoryScan(filesToScan);
+    return PLUS_SUCCESS;
+  }
 
-      // Check if the root element is PlusConfiguration and contains a DataCollection child
-      if (!docElem.tagName().compare("PlusConfiguration", Qt::CaseInsensitive))
-      {
-        QDomNodeList list = docElem.elementsByTagName("DataCollection");
+  // If no valid configuration files have been parsed then warn user
+  if (ui.comboBox_DeviceSet->count() < 1)
+  {
+    LOG_ERROR("Selected directory (" << aDirectory.toStdString() << ") does not contain valid device set configuration files!");
+    return PLUS_FAIL;
+  }
 
-        if (list.count() > 0)
-        {
-          // If it has a DataCollection children then use the first one
-          docElem = list.at(0).toElement();
-        }
-        else
-        {
-          // If it does not have a DataCollection then it cannot be used for connecting
-          continue;
-        }
-      }
-      else
-      {
-        continue;
-      }
+  return PLUS_SUCCESS;
+}
 
-      // Add the name attribute to the first node named DeviceSet to the combo box
-      QDomNodeList list(doc.elementsByTagName("DeviceSet"));
-      if (list.size() <= 0)
-      {
-        continue;
-      }
+//-----------------------------------------------------------------------------
+void QPlusDeviceSetSelectorWidget::AddDeviceSetItem(const QString& fileName, const DeviceSetFileDetails& details)
+{
+  if (!details.ValidXml)
+  {
+    LOG_WARNING("Unable to parse file '" << fileName.toStdString() << "' as an XML. It will not appear in the device set configuration file list!");
+    return;
+  }
+  if (!details.DeviceSet)
+  {
+    return;
+  }
 
-      // Detect previous calibrations and if so, display details
-      QString calibDetails;
-      vtkSmartPointer<vtkXMLDataElement> configRootElement = vtkSmartPointer<vtkXMLDataElement>::Take(vtkXMLUtilities::ReadElementFromFile(fileName.toStdString().c_str()));
-      if (configRootElement != NULL)
-      {
-        auto tr = vtkSmartPointer<vtkIGSIOTransformRepository>::New();
-        if (tr->ReadConfiguration(configRootElement) == PLUS_SUCCESS)
-        {
-          QString pivotString;
-          pivotString = FindCalibrationDetails(doc, tr, "vtkPlusPivotCalibrationAlgo", "Pivot calibration: ", "ObjectPivotPointCoordinateFrame", "ObjectMarkerCoordinateFrame");
-          if (!pivotString.isEmpty())
-          {
-            calibDetails += pivotString;
-          }
+  QString name(details.Name);
+  QString description(details.Description);
+  if (name.isEmpty())
+  {
+    LOG_WARNING("Name field is empty in device set configuration file '" << fileName.toStdString() << "', it is not added to the list");
+    return;
+  }
 
-          QString phantomString;
-          phantomString = FindCalibrationDetails(doc, tr, "vtkPlusPhantomLandmarkRegistrationAlgo", "Phantom calibration: ", "PhantomCoordinateFrame", "ReferenceCoordinateFrame");
-          if (!phantomString.isEmpty())
-          {
-            calibDetails += phantomString;
-          }
+  // Check if the same name already exists, add a version number if it does.
+  int foundIndex = ui.comboBox_DeviceSet->findText(name, Qt::MatchExactly);
+  if (foundIndex > -1)
+  {
+    QHash<QString, int>::iterator deviceIt = m_DeviceSetVersion.find(name);
+    if (deviceIt == m_DeviceSetVersion.end())
+    {
+      m_DeviceSetVersion.insert(name, 0);
+      name.append(" [0]");
+    }
+    else
+    {
+      deviceIt.value() += 1;
+      name.append(" [" + QString::number(deviceIt.value()) + "]");
+    }
+  }
 
-          QString probeString;
-          probeString = FindCalibrationDetails(doc, tr, "vtkPlusProbeCalibrationAlgo", "Probe calibration: ", "ImageCoordinateFrame", "ProbeCoordinateFrame");
-          if (!probeString.isEmpty())
-          {
-            calibDetails += probeString;
-          }
-        }
-      }
+  ui.comboBox_DeviceSet->addItem(name, fileName);
+  int currentIndex = ui.comboBox_DeviceSet->findText(name, Qt::MatchExactly);
 
-      QDomElement elem = list.at(0).toElement();
+  ui.comboBox_DeviceSet->setItemData(currentIndex, description, DescriptionRole);
 
-      QString name(elem.attribute("Name"));
-      QString description(elem.attribute("Description"));
-      if (name.isEmpty())
-      {
-        LOG_WARNING("Name field is empty in device set configuration file '" << fileName.toStdString() << "', it is not added to the list");
-        continue;
-      }
+  // Add tooltip word wrapped rich text
+  name.prepend("<p>");
+  name.append(tr("</p> <p>") + QFileInfo(fileName).fileName() + tr("</p> <p>") + description + tr("</p>"));
+  ui.comboBox_DeviceSet->setItemData(currentIndex, name, Qt::ToolTipRole);
+}
 
-      if (!calibDetails.isEmpty())
-      {
-        description += "\n\n";
-        description += calibDetails;
-      }
+//-----------------------------------------------------------------------------
+void QPlusDeviceSetSelectorWidget::SelectPendingDeviceSet()
+{
+  if (m_PendingSelectionFileName.isEmpty())
+  {
+    return;
+  }
+  int index = ui.comboBox_DeviceSet->findData(m_PendingSelectionFileName);
+  if (index < 0)
+  {
+    // The file may be added later by the directory scan
+    return;
+  }
+  m_PendingSelectionFileName.clear();
+  ui.comboBox_DeviceSet->setCurrentIndex(index);
+}
 
-      // Check if the same name already exists, add a version number if it does.
-      int foundIndex = ui.comboBox_DeviceSet->findText(name, Qt::MatchExactly);
-      if (foundIndex > -1)
-      {
-        QHash<QString, int>::iterator deviceIt = deviceSetVersion.find(name);
-        if (deviceIt == deviceSetVersion.end())
-        {
-          deviceSetVersion.insert(name, 0);
-          name.append(" [0]");
-        }
-        else
-        {
-          deviceIt.value() += 1;
-          name.append(" [" + QString::number(deviceIt.value()) + "]");
-        }
-      }
+//-----------------------------------------------------------------------------
+void QPlusDeviceSetSelectorWidget::StartDirectoryScan(const QStringList& fileNames)
+{
+  this->StopDirectoryScan();
+  {
+    std::lock_guard<std::mutex> lock(m_ScannedFilesMutex);
+    m_ScannedFiles.clear();
+  }
+  m_DirectoryScanCancelled = false;
+  m_DirectoryScanThread = std::thread(&QPlusDeviceSetSelectorWidget::RunDirectoryScan, this, fileNames);
+}
 
-      ui.comboBox_DeviceSet->addItem(name, fileName);
-      int currentIndex = ui.comboBox_DeviceSet->findText(name, Qt::MatchExactly);
+//-----------------------------------------------------------------------------
+void QPlusDeviceSetSelectorWidget::StopDirectoryScan()
+{
+  if (m_DirectoryScanThread.joinable())
+  {
+    m_DirectoryScanCancelled = true;
+    m_DirectoryScanThread.join();
+  }
+}
 
-      ui.comboBox_DeviceSet->setItemData(currentIndex, description, DescriptionRole);
+//-----------------------------------------------------------------------------
+void QPlusDeviceSetSelectorWidget::RunDirectoryScan(QStringList fileNames)
+{
+  for (QStringList::const_iterator fileIt = fileNames.constBegin(); fileIt != fileNames.constEnd() && !m_DirectoryScanCancelled; ++fileIt)
+  {
+    DeviceSetFileDetails details;
+    if (!ReadDeviceSetFileDetails(*fileIt, details))
+    {
+      // If file is not readable then skip
+      continue;
+    }
+    {
+      std::lock_guard<std::mutex> lock(m_ScannedFilesMutex);
+      m_ScannedFiles.push_back(std::make_pair(*fileIt, details));
+    }
+    // The list is updated in the main thread, file by file
+    emit DeviceSetFilesScanned();
+  }
 
-      // Add tooltip word wrapped rich text
-      name.prepend("<p>");
-      name.append(tr("</p> <p>") + fileInfo.fileName() + tr("</p> <p>") + description + tr("</p>"));
-      ui.comboBox_DeviceSet->setItemData(currentIndex, name, Qt::ToolTipRole);
+  if (!m_DirectoryScanCancelled)
+  {
+    // Empty file name marks the end of the scan
+    {
+      std::lock_guard<std::mutex> lock(m_ScannedFilesMutex);
+      m_ScannedFiles.push_back(std::make_pair(QString(), DeviceSetFileDetails()));
     }
-    else
+    emit DeviceSetFilesScanned();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void QPlusDeviceSetSelectorWidget::AddScannedDeviceSets()
+{
+  std::deque<std::pair<QString, DeviceSetFileDetails> > scannedFiles;
+  {
+    std::lock_guard<std::mutex> lock(m_ScannedFilesMutex);
+    scannedFiles.swap(m_ScannedFiles);
+  }
+  if (scannedFiles.empty())
+  {
+    return;
+  }
+
+  bool scanCompleted = false;
+  const int previousIndex = ui.comboBox_DeviceSet->currentIndex();
+  ui.comboBox_DeviceSet->blockSignals(true);
+  for (std::deque<std::pair<QString, DeviceSetFileDetails> >::const_iterator fileIt = scannedFiles.begin(); fileIt != scannedFiles.end(); ++fileIt)
+  {
+    if (fileIt->first.isEmpty())
     {
-      LOG_WARNING("Unable to parse file '" << fileName.toStdString() << "' as an XML. It will not appear in the device set configuration file list!");
+      scanCompleted = true;
+      continue;
     }
+    m_DeviceSetFileDetailsCache.insert(fileIt->first, fileIt->second);
+    this->AddDeviceSetItem(fileIt->first, fileIt->second);
   }
+  if (previousIndex < 0)
+  {
+    // Adding the first item would select it
+    ui.comboBox_DeviceSet->setCurrentIndex(-1);
+  }
+  ui.comboBox_DeviceSet->model()->sort(0);
+  ui.comboBox_DeviceSet->blockSignals(false);
+
+  this->SelectPendingDeviceSet();
+  this->FixComboBoxDropDownListSizeAdjustemnt(ui.comboBox_DeviceSet);
+
+  if (!scanCompleted)
+  {
+    return;
+  }
+  if (m_DirectoryScanThread.joinable())
+  {
+    m_DirectoryScanThread.join();
+  }
+  m_PendingSelectionFileName.clear();
 
-  // If no valid configuration files have been parsed then warn user
   if (ui.comboBox_DeviceSet->count() < 1)
   {
-    LOG_ERROR("Selected directory (" << aDirectory.toStdString() << ") does not contain valid device set configuration files!");
-    return PLUS_FAIL;
+    LOG_ERROR("Selected directory (" << m_ConfigurationDirectory.toStdString() << ") does not contain valid device set configuration files!");
+    this->ShowInvalidDirectoryMessage();
   }
+  else if (ui.comboBox_DeviceSet->currentIndex() < 0)
+  {
+    ui.textEdit_Description->clear();
+  }
+}
 
-  // Set current index to default so that setting the last selected item raises the event even if it is the first item
-  ui.comboBox_DeviceSet->setCurrentIndex(-1);
+//-----------------------------------------------------------------------------
+void QPlusDeviceSetSelectorWidget::ShowInvalidDirectoryMessage()
+{
+  ui.lineEdit_ConfigurationDirectory->setText(tr("Invalid configuration directory"));
+  ui.lineEdit_ConfigurationDirectory->setToolTip("No valid configuration files in directory, please select another");
 
-  ui.comboBox_DeviceSet->model()->sort(0);
+  ui.textEdit_Description->setTextColor(QColor(Qt::darkRed));
+  ui.textEdit_Description->setText("Selected directory does not contain valid device set configuration files!\n\nPlease select another directory");
+}
 
-  // Unblock signals after we add items
-  ui.comboBox_DeviceSet->blockSignals(false);
+//-----------------------------------------------------------------------------
+void QPlusDeviceSetSelectorWidget::ConfigurationDirectoryModified()
+{
+  if (m_ConnectionSuccessful)
+  {
+    // The list cannot be changed while connected, it is refreshed when disconnecting
+    return;
+  }
+  LOG_DEBUG("Configuration directory has changed, refreshing device set list");
+  this->RefreshFolder();
+}
 
-  // Restore the saved selection
-  int lastSelectedDeviceSetIndex = ui.comboBox_DeviceSet->findData(QDir::toNativeSeparators(QString(vtkPlusConfig::GetInstance()->GetDeviceSetConfigurationFileName().c_str())));
-  ui.comboBox_DeviceSet->setCurrentIndex(lastSelectedDeviceSetIndex);
+//-----------------------------------------------------------------------------
+bool QPlusDeviceSetSelectorWidget::ReadDeviceSetFileDetails(const QString& fileName, DeviceSetFileDetails& details)
+{
+  QFile file(fileName);
+  QFileInfo fileInfo(fileName);
+  QDomDocument doc;
 
-  this->FixComboBoxDropDownListSizeAdjustemnt(ui.comboBox_DeviceSet);
+  if (!file.open(QIODevice::ReadOnly))
+  {
+    return false;
+  }
 
-  return PLUS_SUCCESS;
+  details.LastModified = fileInfo.lastModified();
+  details.Size = fileInfo.size();
+  details.ValidXml = doc.setContent(&file);
+  details.DeviceSet = false;
+  details.Name.clear();
+  details.Description.clear();
+  if (!details.ValidXml)
+  {
+    return true;
+  }
+
+  // Check if the root element is PlusConfiguration and contains a DataCollection child
+  QDomElement docElem = doc.documentElement();
+  if (docElem.tagName().compare("PlusConfiguration", Qt::CaseInsensitive) || docElem.elementsByTagName("DataCollection").count() <= 0)
+  {
+    // If it does not have a DataCollection then it cannot be used for connecting
+    return true;
+  }
+
+  // The name attribute of the first node named DeviceSet is shown in the combo box
+  QDomNodeList list(doc.elementsByTagName("DeviceSet"));
+  if (list.size() <= 0)
+  {
+    return true;
+  }
+  details.DeviceSet = true;
+
+  // Detect previous calibrations and if so, display details
+  QString calibDetails;
+  vtkSmartPointer<vtkXMLDataElement> configRootElement = PlusXmlFileCache::GetInstance().ReadElementFromFile(fileName.toStdString());
+  if (configRootElement != NULL)
+  {
+    auto tr = vtkSmartPointer<vtkIGSIOTransformRepository>::New();
+    if (tr->ReadConfiguration(configRootElement) == PLUS_SUCCESS)
+    {
+      QString pivotString;
+      pivotString = FindCalibrationDetails(doc, tr, "vtkPlusPivotCalibrationAlgo", "Pivot calibration: ", "ObjectPivotPointCoordinateFrame", "ObjectMarkerCoordinateFrame");
+      if (!pivotString.isEmpty())
+      {
+        calibDetails += pivotString;
+      }
+
+      QString phantomString;
+      phantomString = FindCalibrationDetails(doc, tr, "vtkPlusPhantomLandmarkRegistrationAlgo", "Phantom calibration: ", "PhantomCoordinateFrame", "ReferenceCoordinateFrame");
+      if (!phantomString.isEmpty())
+      {
+        calibDetails += phantomString;
+      }
+
+      QString probeString;
+      probeString = FindCalibrationDetails(doc, tr, "vtkPlusProbeCalibrationAlgo", "Probe calibration: ", "ImageCoordinateFrame", "ProbeCoordinateFrame");
+      if (!probeString.isEmpty())
+      {
+        calibDetails += probeString;
+      }
+    }
+  }
+
+  QDomElement elem = list.at(0).toElement();
+  details.Name = elem.attribute("Name");
+  details.Description = elem.attribute("Description");
+  if (!calibDetails.isEmpty())
+  {
+    details.Description += "\n\n";
+    details.Description += calibDetails;
+  }
+  return true;
 }
 
 //----------------------------------------------------------------------------
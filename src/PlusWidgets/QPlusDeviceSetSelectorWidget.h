@@ -14,6 +14,8 @@ See License.txt for details.
 #include "vtkIGSIOTransformRepository.h"
 
 // Qt includes
+#include <QDateTime>
+#include <QHash>
 #include <QString>
 #include <QWidget>
 
@@ -21,11 +23,20 @@ class QAction;
 class QDomDocument;
 class QDragEnterEvent;
 class QDropEvent;
+class QFileSystemWatcher;
 class QMenu;
+class QTimer;
 
 // VTK includes
 #include <vtkSmartPointer.h>
 
+// STL includes
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+
 //-----------------------------------------------------------------------------
 
 /*! \class DeviceSetSelectorWidget
@@ -137,14 +148,54 @@ signals:
   */
   void ResetTracker();
 
+  /*!
+  * Emitted by the directory scan thread when files have been parsed
+  */
+  void DeviceSetFilesScanned();
+
 protected:
   /*!
-  * Fills the combo box with the valid device set configuration files found in input directory
+  * Fills the combo box with the valid device set configuration files found in input directory.
+  * Files that have not changed since they were last parsed are added immediately, the others are parsed
+  * in a background thread and added to the combo box as they are parsed.
   * \param aDirectory The directory to search in
-  * \param Success flag
+  * \param Success flag (if files are parsed in the background then they may not contain any device sets)
   */
   PlusStatus ParseDirectory(const QString& aDirectory);
 
+  /*! Information shown in the combo box about a configuration file */
+  struct DeviceSetFileDetails
+  {
+    QDateTime LastModified;
+    qint64 Size;
+    bool ValidXml;
+    /*! The file is a device set configuration file that can be used for connecting */
+    bool DeviceSet;
+    QString Name;
+    QString Description;
+  };
+
+  /*!
+  * Parse a configuration file and get its device set name and description
+  * eturn False if the file cannot be read
+  */
+  bool ReadDeviceSetFileDetails(const QString& fileName, DeviceSetFileDetails& details);
+
+  /*! Add a device set to the combo box, if the file is a valid device set configuration file */
+  void AddDeviceSetItem(const QString& fileName, const DeviceSetFileDetails& details);
+
+  /*! Select the device set that should be selected once its file is in the combo box */
+  void SelectPendingDeviceSet();
+
+  /*! Parse the files in a background thread (see DeviceSetFilesScanned) */
+  void StartDirectoryScan(const QStringList& fileNames);
+  /*! Stop the background thread, the files that have not been parsed yet are not added */
+  void StopDirectoryScan();
+  /*! Body of the background thread */
+  void RunDirectoryScan(QStringList fileNames);
+
+  void ShowInvalidDirectoryMessage();
+
   virtual void resizeEvent(QResizeEvent* event);
 
   QString FindCalibrationDetails(const QDomDocument& doc,
@@ -210,6 +261,16 @@ protected slots:
   */
   void ResetTrackerButtonClicked();
 
+  /*!
+  * Add the files parsed by the directory scan thread to the combo box
+  */
+  void AddScannedDeviceSets();
+
+  /*!
+  * Called when files have been added, removed or renamed in the configuration directory - refreshes device set list
+  */
+  void ConfigurationDirectoryModified();
+
 protected:
   /*! Configuration directory path */
   QString       m_ConfigurationDirectory;
@@ -234,6 +295,26 @@ protected:
   /*! Suffix to the description in the main text box */
   QString       m_DescriptionSuffix;
 
+  /*! Details of the parsed configuration files, by file name. Files are parsed again only if they have changed. */
+  QHash<QString, DeviceSetFileDetails> m_DeviceSetFileDetailsCache;
+
+  /*! Number of device sets with the same name in the combo box, for adding a version number to the name */
+  QHash<QString, int> m_DeviceSetVersion;
+
+  /*! File of the device set that is selected when it is added to the combo box */
+  QString m_PendingSelectionFileName;
+
+  /*! Refreshes the list when the configuration directory changes */
+  QFileSystemWatcher* m_DirectoryWatcher;
+  QTimer* m_DirectoryChangeTimer;
+
+  /*! Background parsing of the configuration files */
+  std::thread m_DirectoryScanThread;
+  std::atomic<bool> m_DirectoryScanCancelled;
+  std::mutex m_ScannedFilesMutex;
+  /*! Parsed files that are not added to the combo box yet, an empty file name marks the end of the scan */
+  std::deque<std::pair<QString, DeviceSetFileDetails> > m_ScannedFiles;
+
 protected:
   Ui::DeviceSetSelectorWidget ui;
 };
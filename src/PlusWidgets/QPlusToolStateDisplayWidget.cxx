@@ -17,6 +17,17 @@
 #include <QLabel>
 #include <QTextEdit>
 
+// STL includes
+#include <algorithm>
+
+namespace
+{
+  bool CompareToolStatusSnapshotByName(const vtkPlusChannel::ToolStatusSnapshot& a, const vtkPlusChannel::ToolStatusSnapshot& b)
+  {
+    return a.TransformName.GetTransformName() < b.TransformName.GetTransformName();
+  }
+}
+
 //-----------------------------------------------------------------------------
 QPlusToolStateDisplayWidget::QPlusToolStateDisplayWidget(QWidget* aParent, Qt::WindowFlags aFlags)
   : QWidget(aParent, aFlags)
@@ -66,6 +77,8 @@ PlusStatus QPlusToolStateDisplayWidget::InitializeTools(vtkPlusChannel* aChannel
     delete (*it);
   }
   m_ToolStateLabels.clear();
+  m_ToolStatusSnapshot.clear();
+  m_DisplayedToolStatuses.clear();
 
   // If connection was unsuccessful, create default appearance
   if (!aConnectionSuccessful)
@@ -94,26 +107,24 @@ PlusStatus QPlusToolStateDisplayWidget::InitializeTools(vtkPlusChannel* aChannel
   }
 
   // Get transforms
-  std::vector<igsioTransformName> transformNames;
-  igsioTrackedFrame trackedFrame;
-  m_SelectedChannel->GetTrackedFrame(trackedFrame);
-  trackedFrame.GetFrameTransformNameList(transformNames);
+  UpdateToolStatusSnapshot();
 
   // Set up layout
   QGridLayout* grid = new QGridLayout(this);
-  grid->setColumnStretch(transformNames.size(), 1);
+  grid->setColumnStretch(m_ToolStatusSnapshot.size(), 1);
   grid->setSpacing(2);
   grid->setVerticalSpacing(4);
   grid->setContentsMargins(4, 4, 4, 4);
 
-  m_ToolStateLabels.resize(transformNames.size(), NULL);
+  m_ToolStateLabels.resize(m_ToolStatusSnapshot.size(), NULL);
+  m_DisplayedToolStatuses.resize(m_ToolStatusSnapshot.size(), -1);
 
   int i;
-  std::vector<igsioTransformName>::iterator it;
-  for (it = transformNames.begin(), i = 0; it != transformNames.end(); ++it, ++i)
+  std::vector<vtkPlusChannel::ToolStatusSnapshot>::iterator it;
+  for (it = m_ToolStatusSnapshot.begin(), i = 0; it != m_ToolStatusSnapshot.end(); ++it, ++i)
   {
     // Assemble tool name and add label to layout and label list
-    QString toolNameString = QString("%1: %2").arg(i).arg(it->GetTransformName().c_str());
+    QString toolNameString = QString("%1: %2").arg(i).arg(it->TransformName.GetTransformName().c_str());
 
     QLabel* toolNameLabel = new QLabel(this);
     toolNameLabel->setText(toolNameString);
@@ -165,16 +176,10 @@ PlusStatus QPlusToolStateDisplayWidget::Update()
     return PLUS_FAIL;
   }
 
-  // Re-initialize widget if enabled statuses have changed
-  int numberOfDisplayedTools = 0;
-
-  // Get transforms
-  std::vector<igsioTransformName> transformNames;
-  igsioTrackedFrame trackedFrame;
-  m_SelectedChannel->GetTrackedFrame(trackedFrame);
-  trackedFrame.GetFrameTransformNameList(transformNames);
+  // Re-initialize widget if the tools have changed
+  UpdateToolStatusSnapshot();
 
-  if (transformNames.size() != m_ToolStateLabels.size())
+  if (m_ToolStatusSnapshot.size() != m_ToolStateLabels.size())
   {
     LOG_WARNING("Tool number inconsistency!");
 
@@ -185,11 +190,9 @@ PlusStatus QPlusToolStateDisplayWidget::Update()
     }
   }
 
-  std::vector<igsioTransformName>::iterator transformIt;
-  std::vector<QTextEdit*>::iterator labelIt;
-  for (transformIt = transformNames.begin(), labelIt = m_ToolStateLabels.begin(); transformIt != transformNames.end() && labelIt != m_ToolStateLabels.end(); ++transformIt, ++labelIt)
+  for (unsigned int i = 0; i < m_ToolStatusSnapshot.size() && i < m_ToolStateLabels.size(); ++i)
   {
-    QTextEdit* label = (*labelIt);
+    QTextEdit* label = m_ToolStateLabels[i];
 
     if (label == NULL)
     {
@@ -197,29 +200,37 @@ PlusStatus QPlusToolStateDisplayWidget::Update()
       continue;
     }
 
-    ToolStatus status(TOOL_INVALID);
-    if (trackedFrame.GetFrameTransformStatus(*transformIt, status) != PLUS_SUCCESS)
+    if (m_ToolStatusSnapshot[i].Timestamp == UNDEFINED_TIMESTAMP)
     {
-      std::string transformNameStr;
-      transformIt->GetTransformName(transformNameStr);
-      LOG_WARNING("Unable to get transform status for transform" << transformNameStr);
-      label->setText("STATUS ERROR");
-      label->setTextColor(QColor::fromRgb(223, 0, 0));
+      // No data has been acquired for the tool yet, keep showing N/A
+      continue;
     }
-    else
+
+    ToolStatus status = m_ToolStatusSnapshot[i].Status;
+    if (m_DisplayedToolStatuses[i] == status)
+    {
+      continue;
+    }
+    m_DisplayedToolStatuses[i] = status;
+
+    label->setText(igsioCommon::ConvertToolStatusToString(status).c_str());
+    switch (status)
     {
-      label->setText(igsioCommon::ConvertToolStatusToString(status).c_str());
-      switch (status)
-      {
-      case (TOOL_OK):
-        label->setTextColor(Qt::green);
-        break;
-      default:
-        label->setTextColor(QColor::fromRgb(223, 0, 0));
-        break;
-      }
+    case (TOOL_OK):
+      label->setTextColor(Qt::green);
+      break;
+    default:
+      label->setTextColor(QColor::fromRgb(223, 0, 0));
+      break;
     }
   }
 
   return PLUS_SUCCESS;
 }
+
+//-----------------------------------------------------------------------------
+void QPlusToolStateDisplayWidget::UpdateToolStatusSnapshot()
+{
+  m_SelectedChannel->GetToolStatusSnapshot(m_ToolStatusSnapshot);
+  std::sort(m_ToolStatusSnapshot.begin(), m_ToolStatusSnapshot.end(), CompareToolStatusSnapshotByName);
+}
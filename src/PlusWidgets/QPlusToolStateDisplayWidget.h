@@ -11,12 +11,14 @@
 #include "PlusConfigure.h"
 #include "PlusWidgetsExport.h"
 
+// PlusLib includes
+#include <vtkPlusChannel.h>
+
 // Qt includes
 #include <QWidget>
 
 class QLabel;
 class QTextEdit;
-class vtkPlusChannel;
 
 //-----------------------------------------------------------------------------
 
@@ -50,7 +52,7 @@ public:
   PlusStatus InitializeTools(vtkPlusChannel* aChannel, bool aConnectionSuccessful);
 
   /*!
-  * Get tool statuses and display them
+  * Get tool statuses and display them. The statuses published by the devices are read, the buffers are not accessed.
   */
   PlusStatus Update();
 
@@ -65,6 +67,14 @@ protected:
   std::vector<QLabel*>      m_ToolNameLabels;
   std::vector<QTextEdit*>   m_ToolStateLabels;
   bool                      m_Initialized;
+
+  /*! Latest tool statuses, sorted by transform name (the order of the labels) */
+  std::vector<vtkPlusChannel::ToolStatusSnapshot> m_ToolStatusSnapshot;
+  /*! Status shown in each label, -1 if no status is shown yet; the label is only updated if the status changes */
+  std::vector<int>          m_DisplayedToolStatuses;
+
+  /*! Get the tool statuses from the channel into m_ToolStatusSnapshot */
+  void UpdateToolStatusSnapshot();
 };
 
 #endif
\ No newline at end of file